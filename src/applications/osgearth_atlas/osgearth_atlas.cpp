@@ -70,6 +70,8 @@ usage(const char* msg, const char* name =0L)
             << "\n        --out-image <path>              : Output path for the atlas image (defaults to an OSGB file in"
             << "\n                                          the working directory). The paths in the resulting catalog"
             << "\n                                          file will point to this location using a relative path if possible."
+            << "\n        --compress <method>             : Compress the atlas layers (e.g. \"cpu\", \"gpu\") when they load;"
+            << "\n                                          see ImageLayer compression methods"
             << "\n        --aux <pattern> <r> <g> <b> <a> : Build an auxiliary atlas for files matching the pattern"
             << "\n                                          \"filename_pattern.ext\", e.g., \"texture.jpg\" will match"
             << "\n                                          \"texture_NML.jpg\" for pattern = \"NML\". The RGBA are the"
@@ -130,6 +132,11 @@ build(osg::ArgumentParser& arguments)
     bool rgb = arguments.read("--rgb");
     builder.setRGB( rgb );
 
+    // Compression to apply to the atlas layers at load time
+    std::string compression;
+    if ( arguments.read("--compress", compression) )
+        builder.setCompressionMethod( compression );
+
 
     // auxiliary atlas patterns:
     std::string pattern;
@@ -31,6 +31,7 @@
 #include <osgEarth/MapNode>
 #include <osgEarth/OGRFeatureSource>
 #include <osgEarth/ImageUtils>
+#include <osgEarth/Threading>
 
 #include <osg/ArgumentParser>
 #include <osg/Timer>
@@ -39,6 +40,13 @@
 #include <iomanip>
 #include <algorithm>
 #include <iterator>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 using namespace osgEarth;
 
@@ -59,6 +67,14 @@ int usage(char** argv)
         << "\n    --extents [minLat] [minLong] [maxLat] [maxLong] : Lat/Long extends to copy"
         << "\n    --no-overwrite                      : skip tiles that already exist in the destination"
         << "\n    --threads [int]                     : go faster by using [n] working threads"
+        << "\n    --pipeline                          : read, convert and write in separate stages, with the"
+        << "\n                                          --threads reading, and one writer thread per output"
+        << "\n    --convert-threads [int]             : with --pipeline, threads that compress tiles"
+        << "\n    --write-buffer [int]                : with --pipeline, tiles each writer sorts by level before"
+        << "\n                                          writing them (default = 1024)"
+        << "\n    --out-target [n] [prop_name] [prop_value] : set a property of additional output [n] (1, 2, ...);"
+        << "\n                                          every output gets the same tiles from a single read"
+        << "\n                                          (implies --pipeline)"
         << std::endl;
 
     return 0;
@@ -167,6 +183,296 @@ struct ElevationLayerTileCopy : public TileHandler
 };
 
 
+// Writes tiles to one output layer on its own thread. Tiles wait in a
+// buffer sorted by level, column and row, and the lowest one goes out
+// whenever the buffer fills, so the output sees (nearly) level-ordered
+// writes. For MBTiles that keeps inserts close together in the index.
+struct TileWriter
+{
+    TileWriter(TileLayer* layer, unsigned bufferSize) :
+        _layer(layer),
+        _imageLayer(dynamic_cast<ImageLayer*>(layer)),
+        _elevationLayer(dynamic_cast<ElevationLayer*>(layer)),
+        _bufferSize(osg::maximum(bufferSize, 1u)),
+        _done(false),
+        _written(0u),
+        _failed(0u),
+        _bytes(0u)
+    {
+        _thread = std::thread([this]() { run(); });
+    }
+
+    // Queues a tile for writing; blocks while the writer is far behind
+    void push(const TileKey& key, const osg::Object* data)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _canPush.wait(lock, [this]() { return _buffer.size() < _bufferSize * 2u; });
+        _buffer[key] = data;
+        _canWrite.notify_one();
+    }
+
+    // Writes whatever is left and stops the thread
+    void finish()
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done = true;
+        }
+        _canWrite.notify_one();
+        _thread.join();
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            TileKey key;
+            osg::ref_ptr<const osg::Object> data;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _canWrite.wait(lock, [this]() { return _done || _buffer.size() >= _bufferSize; });
+                if (_buffer.empty())
+                    return;
+
+                key = _buffer.begin()->first;
+                data = _buffer.begin()->second;
+                _buffer.erase(_buffer.begin());
+            }
+            _canPush.notify_all();
+
+            write(key, data.get());
+        }
+    }
+
+    void write(const TileKey& key, const osg::Object* data)
+    {
+        Status status;
+        const osg::Image* image = dynamic_cast<const osg::Image*>(data);
+        const osg::HeightField* hf = dynamic_cast<const osg::HeightField*>(data);
+
+        if (image && _imageLayer.valid())
+        {
+            status = _imageLayer->writeImage(key, image, 0L);
+            if (status.isOK())
+                _bytes += image->getTotalSizeInBytesIncludingMipmaps();
+        }
+        else if (hf && _elevationLayer.valid())
+        {
+            status = _elevationLayer->writeHeightField(key, hf, 0L);
+            if (status.isOK())
+                _bytes += hf->getFloatArray()->getTotalDataSize();
+        }
+        else
+        {
+            status = Status(Status::AssertionFailure, "Tile type doesn't match the output layer");
+        }
+
+        if (status.isOK())
+        {
+            ++_written;
+        }
+        else
+        {
+            ++_failed;
+            OE_WARN << key.str() << ": " << status.message() << std::endl;
+        }
+    }
+
+    osg::ref_ptr<TileLayer> _layer;
+    osg::ref_ptr<ImageLayer> _imageLayer;
+    osg::ref_ptr<ElevationLayer> _elevationLayer;
+    unsigned _bufferSize;
+    bool _done;
+    std::map<TileKey, osg::ref_ptr<const osg::Object> > _buffer;
+    std::mutex _mutex;
+    std::condition_variable _canPush;
+    std::condition_variable _canWrite;
+    std::thread _thread;
+    std::atomic<unsigned> _written;
+    std::atomic<unsigned> _failed;
+    std::atomic<std::uint64_t> _bytes;
+};
+
+// Pipelined copy: the visitor's threads read each tile once, a separate
+// pool compresses the tiles that need it, and a TileWriter per output
+// writes them.
+struct PipelinedTileCopy : public TileHandler
+{
+    struct Target
+    {
+        osg::ref_ptr<TileLayer> _layer;
+        bool _compress;
+        std::shared_ptr<TileWriter> _writer;
+    };
+
+    PipelinedTileCopy(TileLayer* source, std::vector<Target>& targets, unsigned writeBuffer, unsigned convertThreads, bool overwrite) :
+        _source(source),
+        _targets(targets),
+        _overwrite(overwrite),
+        _read(0u),
+        _converted(0u),
+        _converting(0)
+    {
+        for (auto& target : _targets)
+            target._writer = std::make_shared<TileWriter>(target._layer.get(), writeBuffer);
+
+        _convertArena = std::make_shared<JobArena>("oe.conv.convert", osg::maximum(convertThreads, 1u));
+    }
+
+    bool hasData(const TileKey& key) const
+    {
+        return _source->mayHaveData(key);
+    }
+
+    bool handleTile(const TileKey& key, const TileVisitor& tv)
+    {
+        // outputs that still need this tile
+        std::vector<unsigned> needed;
+        for (unsigned i = 0; i < _targets.size(); ++i)
+        {
+            if (_overwrite || !exists(_targets[i]._layer.get(), key))
+                needed.push_back(i);
+        }
+        if (needed.empty())
+            return true;
+
+        osg::ref_ptr<const osg::Object> data;
+        ImageLayer* imageSource = dynamic_cast<ImageLayer*>(_source.get());
+        ElevationLayer* elevationSource = dynamic_cast<ElevationLayer*>(_source.get());
+        if (imageSource)
+        {
+            GeoImage image = imageSource->createImage(key);
+            if (image.valid())
+                data = image.getImage();
+        }
+        else if (elevationSource)
+        {
+            GeoHeightField hf = elevationSource->createHeightField(key, 0L);
+            if (hf.valid())
+                data = hf.getHeightField();
+        }
+
+        if (!data.valid())
+            return false;
+
+        ++_read;
+
+        bool compress = false;
+        for (auto i : needed)
+            compress = compress || _targets[i]._compress;
+
+        const osg::Image* image = dynamic_cast<const osg::Image*>(data.get());
+        if (compress && image)
+        {
+            // don't let the conversion backlog grow without bound
+            while (_converting > 1000)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            ++_converting;
+            osg::ref_ptr<const osg::Image> original = image;
+            auto delegate = [this, key, original, needed](Cancelable*)
+            {
+                osg::ref_ptr<const osg::Image> compressed = ImageUtils::compressImage(original.get(), "cpu");
+                ++_converted;
+                deliver(key, original.get(), compressed.get(), needed);
+                --_converting;
+            };
+
+            Job job(_convertArena.get(), &_convertGroup);
+            job.setName("convert");
+            job.dispatch(delegate);
+        }
+        else
+        {
+            deliver(key, data.get(), data.get(), needed);
+        }
+
+        return true;
+    }
+
+    // Waits for every stage to drain
+    void finish()
+    {
+        _convertGroup.join();
+        for (auto& target : _targets)
+            target._writer->finish();
+    }
+
+    void deliver(const TileKey& key, const osg::Object* original, const osg::Object* compressed, const std::vector<unsigned>& needed)
+    {
+        for (auto i : needed)
+            _targets[i]._writer->push(key, _targets[i]._compress ? compressed : original);
+    }
+
+    static bool exists(TileLayer* layer, const TileKey& key)
+    {
+        ImageLayer* imageLayer = dynamic_cast<ImageLayer*>(layer);
+        if (imageLayer)
+            return imageLayer->createImage(key).valid();
+
+        ElevationLayer* elevationLayer = dynamic_cast<ElevationLayer*>(layer);
+        if (elevationLayer)
+            return elevationLayer->createHeightField(key, 0L).valid();
+
+        return false;
+    }
+
+    osg::ref_ptr<TileLayer> _source;
+    std::vector<Target> _targets;
+    bool _overwrite;
+    std::atomic<unsigned> _read;
+    std::atomic<unsigned> _converted;
+    std::atomic<int> _converting;
+    std::shared_ptr<JobArena> _convertArena;
+    JobGroup _convertGroup;
+};
+
+
+// Creates and opens an output layer in the output profile, and gives it
+// the input's data extents.
+TileLayer* createOutput(Config outConf, const Profile* outputProfile, TileLayer* input, const osgDB::Options* dbo)
+{
+    ProfileOptions profileOptions = outputProfile->toProfileOptions();
+    outConf.add("profile", profileOptions.getConfig());
+
+    osg::ref_ptr<TileLayer> output = dynamic_cast<TileLayer*>(Layer::create(ConfigOptions(outConf)));
+    if ( !output.valid() )
+    {
+        OE_WARN << LC << "Failed to create output layer" << std::endl;
+        return 0L;
+    }
+
+    output->setReadOptions(dbo);
+    Status outputStatus = output->openForWriting();
+    if (outputStatus.isError())
+    {
+        OE_WARN << LC << "Error initializing output: " << outputStatus.message() << std::endl;
+        return 0L;
+    }
+
+    // Transfomr and copy over the data extents to the output datasource.
+    DataExtentList outputExtents;
+    for (DataExtentList::const_iterator itr = input->getDataExtents().begin(); itr != input->getDataExtents().end(); ++itr)
+    {
+        // Convert the data extent to the profile that is actually used by the output tile source
+        const DataExtent& inputExtent = *itr;
+        GeoExtent outputExtent = outputProfile->clampAndTransformExtent(inputExtent);
+        unsigned int minLevel = 0;
+        unsigned int maxLevel = outputProfile->getEquivalentLOD(input->getProfile(), inputExtent.maxLevel().get());
+        DataExtent result(outputExtent, minLevel, maxLevel);
+        outputExtents.push_back(result);
+    }
+    if (!outputExtents.empty())
+    {
+        output->setDataExtents(outputExtents);
+    }
+
+    return output.release();
+}
+
+
 // Custom progress reporter
 struct ProgressReporter : public osgEarth::ProgressCallback
 {
@@ -205,7 +511,8 @@ struct ProgressReporter : public osgEarth::ProgressCallback
             << (int)current << "/" << (int)total
             << " " << int(100.0f*percentage) << "% complete, "
             << (int)minsTotal << "m" << (int)secsTotal << "s projected, "
-            << (int)minsToGo << "m" << (int)secsToGo << "s remaining          "
+            << (int)minsToGo << "m" << (int)secsToGo << "s remaining, "
+            << (int)(current/osg::maximum(timeSoFar, 0.001)) << " tiles/s          "
             << std::flush;
 
         if ( percentage >= 100.0f )
@@ -387,43 +694,52 @@ main(int argc, char** argv)
         isSameProfile = outputProfile->isHorizEquivalentTo(input->getProfile());
     }
 
-    // set the output profile.
-    ProfileOptions profileOptions = outputProfile->toProfileOptions();
-    outConf.add("profile", profileOptions.getConfig());
-
     // open the output tile source:
-    osg::ref_ptr<TileLayer> output = dynamic_cast<TileLayer*>(Layer::create(ConfigOptions(outConf)));
+    osg::ref_ptr<TileLayer> output = createOutput(outConf, outputProfile.get(), input.get(), dbo.get());
     if ( !output.valid() )
     {
-        OE_WARN << LC << "Failed to create output layer" << std::endl;
         return -1;
     }
 
-    output->setReadOptions(dbo.get());
-    Status outputStatus = output->openForWriting();
-    if (outputStatus.isError())
-    {
-        OE_WARN << LC << "Error initializing output: " << outputStatus.message() << std::endl;
-        return -1;
-    }
+    // additional outputs, each fed by the same read:
+    std::vector<PipelinedTileCopy::Target> targets(1);
+    targets[0]._layer = output;
+    targets[0]._compress = compress;
 
-    // Transfomr and copy over the data extents to the output datasource.
-    DataExtentList outputExtents;
-    for (DataExtentList::const_iterator itr = input->getDataExtents().begin(); itr != input->getDataExtents().end(); ++itr)
+    std::map<unsigned, Config> extraConfs;
+    unsigned targetNum;
+    while (args.read("--out-target", targetNum, key, value))
     {
-        // Convert the data extent to the profile that is actually used by the output tile source
-        const DataExtent& inputExtent = *itr;
-        GeoExtent outputExtent = outputProfile->clampAndTransformExtent(inputExtent);
-        unsigned int minLevel = 0;
-        unsigned int maxLevel = outputProfile->getEquivalentLOD(input->getProfile(), inputExtent.maxLevel().get());
-        DataExtent result(outputExtent, minLevel, maxLevel);
-        outputExtents.push_back(result);
+        extraConfs[targetNum].set(key, value);
     }
-    if (!outputExtents.empty())
+
+    for (auto& extra : extraConfs)
     {
-        output->setDataExtents(outputExtents);
+        Config& conf = extra.second;
+        conf.key() = conf.value("driver");
+
+        OE_NOTICE << LC << "TO (" << extra.first << "):\n"
+            << conf.toJSON(true)
+            << std::endl;
+
+        PipelinedTileCopy::Target target;
+        target._layer = createOutput(conf, outputProfile.get(), input.get(), dbo.get());
+        target._compress = (conf.value("format") == "dds");
+        if (!target._layer.valid())
+        {
+            return -1;
+        }
+        targets.push_back(target);
     }
 
+    bool pipeline = args.read("--pipeline") || targets.size() > 1;
+
+    unsigned convertThreads = osg::maximum(1u, Threading::getConcurrency());
+    args.read("--convert-threads", convertThreads);
+
+    unsigned writeBuffer = 1024u;
+    args.read("--write-buffer", writeBuffer);
+
     bool debug = args.read("--debug");
 
     // Dump out some stuff...
@@ -454,7 +770,26 @@ main(int argc, char** argv)
     if (args.read("--no-overwrite"))
         overwrite = false;
 
-    if (dynamic_cast<ImageLayer*>(input.get()) && dynamic_cast<ImageLayer*>(output.get()))
+    osg::ref_ptr<PipelinedTileCopy> pipelined;
+
+    if (pipeline)
+    {
+        for (auto& target : targets)
+        {
+            bool sameType =
+                (dynamic_cast<ImageLayer*>(input.get()) && dynamic_cast<ImageLayer*>(target._layer.get())) ||
+                (dynamic_cast<ElevationLayer*>(input.get()) && dynamic_cast<ElevationLayer*>(target._layer.get()));
+            if (!sameType)
+            {
+                OE_WARN << LC << "Every output must be the same kind of layer as the input" << std::endl;
+                return -1;
+            }
+        }
+
+        pipelined = new PipelinedTileCopy(input.get(), targets, writeBuffer, convertThreads, overwrite);
+        visitor->setTileHandler(pipelined.get());
+    }
+    else if (dynamic_cast<ImageLayer*>(input.get()) && dynamic_cast<ImageLayer*>(output.get()))
     {
         visitor->setTileHandler(new ImageLayerTileCopy(
             dynamic_cast<ImageLayer*>(input.get()),
@@ -556,15 +891,47 @@ main(int argc, char** argv)
 
     visitor->run( outputProfile.get() );
 
+    // drain the convert and write stages
+    if (pipelined.valid())
+    {
+        pipelined->finish();
+    }
+
+    // some outputs (MBTiles) write behind; wait for them to finish
+    for (auto& target : targets)
+    {
+        target._layer->close();
+    }
+
     osg::Timer_t t1 = osg::Timer::instance()->tick();
+    double seconds = osg::maximum(osg::Timer::instance()->delta_s(t0, t1), 0.001);
 
     std::cout
         << std::endl
         << "Complete. Time = "
         << std::fixed
         << std::setprecision(1)
-        << osg::Timer::instance()->delta_s(t0, t1)
+        << seconds
         << " seconds." << std::endl;
 
+    if (pipelined.valid())
+    {
+        std::cout
+            << "Read " << pipelined->_read << " tiles ("
+            << pipelined->_read / seconds << " tiles/s), converted "
+            << pipelined->_converted << " tiles ("
+            << pipelined->_converted / seconds << " tiles/s)" << std::endl;
+
+        for (unsigned i = 0; i < pipelined->_targets.size(); ++i)
+        {
+            const TileWriter& writer = *pipelined->_targets[i]._writer;
+            std::cout
+                << "Output " << i << ": wrote " << writer._written << " tiles ("
+                << writer._written / seconds << " tiles/s, "
+                << (double)writer._bytes / 1048576.0 << " MB), "
+                << writer._failed << " failed" << std::endl;
+        }
+    }
+
     return 0;
 }
@@ -28,6 +28,7 @@
 #include <osgDB/WriteFile>
 #include <osgEarth/FileUtils>
 #include <osgEarth/ImageLayer>
+#include <osgEarth/OGRFeatureSource>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -188,6 +189,7 @@ int usage(const char* name)
         << "osgearth_heatmap < points.txt  where points.txt contains a series of lat lon points separated by a space"
         << name
         << "\n    --weighted                          : If set the incoming points have a third component which represents the weight of the point"
+        << "\n    --features [path]                   : Read the points from a feature file (the center of each feature) instead of stdin"
         << "\n    --min-level [level]                 : The minimum zoom level to generate map image layer.  Heat map points are aggregated together for lower lods."
         << "\n    --max-level [level]                 : The maximum zoom level to generate map image layer, higher levels take longer"
         << "\n    --max-heat [maxHeat]                : The maximum heat value to scale the color ramp to."
@@ -265,6 +267,43 @@ void ReadFile(std::istream& in, bool weighted)
     }
 }
 
+bool ReadFeatures(const std::string& url)
+{
+    osg::ref_ptr<OGRFeatureSource> features = new OGRFeatureSource();
+    features->setURL(url);
+    Status status = features->open();
+    if (status.isError())
+    {
+        OE_WARN << "Failed to open " << url << ": " << status.message() << std::endl;
+        return false;
+    }
+
+    // Only the locations are needed, so skip building the features
+    FeatureSource::FeatureBoundsList list;
+    if (!features->getFeatureBounds(Query(), list, nullptr))
+    {
+        OE_WARN << "Failed to query " << url << std::endl;
+        return false;
+    }
+
+    const SpatialReference* srs = features->getFeatureProfile()->getSRS();
+
+    std::cout << "Reading features..." << std::endl;
+    for (auto& entry : list)
+    {
+        osg::Vec2d center = entry.bounds.center2d();
+        GeoPoint point(srs, center.x(), center.y());
+        if (point.transformInPlace(wgs84->getSRS()))
+        {
+            ++numRead;
+            if (numRead % 50000 == 0) std::cout << "Read " << numRead << std::endl;
+
+            addPoint(point.x(), point.y(), 1.0);
+        }
+    }
+    return true;
+}
+
 void WriteKeys(ImageLayer* layer, const heatmap_colorscheme_t* colorScheme)
 {
     unsigned int numKeys = s_keys.size();
@@ -444,7 +483,16 @@ main(int argc, char** argv)
 
     std::cout << "Generating heatmap to max level of " << maxLevel << " with max heat " << maxHeat << std::endl;
 
-    ReadFile(std::cin, weighted);
+    std::string featuresURL;
+    if (arguments.read("--features", featuresURL))
+    {
+        if (!ReadFeatures(featuresURL))
+            return -1;
+    }
+    else
+    {
+        ReadFile(std::cin, weighted);
+    }
 
     std::cout << "Read " << numRead << " points" << std::endl;
 
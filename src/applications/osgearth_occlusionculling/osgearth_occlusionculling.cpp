@@ -23,6 +23,7 @@
 #include <osgEarth/MapNode>
 #include <osgEarth/ScreenSpaceLayout>
 #include <osgEarth/ECEF>
+#include <osgEarth/HiZCuller>
 
 #include <osgEarth/EarthManipulator>
 #include <osgEarth/AutoClipPlaneHandler>
@@ -75,6 +76,9 @@ main(int argc, char** argv)
     bool declutter = false;
     if (arguments.read("--declutter")) declutter = true;
 
+    // hierarchical-Z culling of 3D tiles and feature tiles behind the terrain
+    bool hiz = arguments.read("--hiz");
+
     // initialize the viewer:
     viewer.setCameraManipulator( new EarthManipulator() );
 
@@ -134,6 +138,11 @@ main(int argc, char** argv)
 
     viewer.setSceneData( root );
 
+    if (hiz)
+    {
+        HiZCuller::install(viewer.getCamera(), mapNode->getTerrainEngine());
+    }
+
     viewer.getCamera()->addCullCallback( new AutoClipPlaneCullCallback(mapNode) );
     viewer.addEventHandler(new osgViewer::StatsHandler());
     viewer.addEventHandler(new osgViewer::WindowSizeHandler());
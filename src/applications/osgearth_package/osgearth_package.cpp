@@ -75,6 +75,9 @@ usage( const std::string& msg = "" )
         << "            [--mp]                          : Use multiprocessing to process the tiles.  Useful for GDAL sources as this avoids the global GDAL lock" << std::endl
         << "            [--mt]                          : Use multithreading to process the tiles." << std::endl
         << "            [--concurrency]                 : The number of threads or processes to use if --mp or --mt are provided." << std::endl
+        << "            [--encode-threads <num>]        : The number of threads that encode tiles (0 to encode in the reading thread)" << std::endl
+        << "            [--write-threads <num>]         : The number of threads that write tiles to disk" << std::endl
+        << "            [--rewrite-unchanged]           : Rewrite tiles even when their contents have not changed" << std::endl
         << "            [--alpha-mask]                  : Mask out imagery that isn't in the provided extents." << std::endl
         << "            [--verbose]                     : Displays progress of the operation" << std::endl;
 
@@ -331,6 +334,17 @@ makeTMS( osg::ArgumentParser& args )
     packager.setKeepEmpties(keepEmpties);
     packager.setApplyAlphaMask(applyAlphaMask);
 
+    unsigned encodeThreads = packager.getNumEncodeThreads();
+    args.read("--encode-threads", encodeThreads);
+    packager.setNumEncodeThreads(encodeThreads);
+
+    unsigned writeThreads = packager.getNumWriteThreads();
+    args.read("--write-threads", writeThreads);
+    packager.setNumWriteThreads(writeThreads);
+
+    if (args.read("--rewrite-unchanged"))
+        packager.setSkipUnchanged(false);
+
 
     // new map for an output earth file if necessary.
     osg::ref_ptr<Map> outMap = 0L;
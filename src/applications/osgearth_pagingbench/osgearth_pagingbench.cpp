@@ -0,0 +1,420 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+/**
+ * Replays a recorded camera path over an earth file without a window and
+ * reports how long the terrain takes to page in at each waypoint.
+ *
+ * The path is an osg::AnimationPath file, the kind osgViewer records with
+ * the 'z' key. Each control point is a waypoint. The camera moves to each
+ * waypoint in turn (optionally interpolating over a number of frames) and
+ * then holds still until paging is done: no osgEarth jobs pending, no
+ * database pager requests, and no new tile models for a number of frames.
+ *
+ * Run it against a populated cache with --cache-only so that the network
+ * doesn't affect the numbers.
+ */
+
+#include <osgEarth/MapNode>
+#include <osgEarth/TerrainEngineNode>
+#include <osgEarth/TerrainTileModel>
+#include <osgEarth/AutoClipPlaneHandler>
+#include <osgEarth/Registry>
+#include <osgEarth/Threading>
+#include <osgEarth/Memory>
+#include <osgEarth/Version>
+
+#include <osg/AnimationPath>
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osgDB/ReadFile>
+#include <osgDB/DatabasePager>
+#include <osgViewer/Viewer>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+int
+usage(const char* name)
+{
+    std::cout
+        << "Replays a camera path over an earth file and reports terrain paging performance.\n\n"
+        << name << " file.earth --path file.path [options]\n"
+        << "\n    --path <file>               : camera path recorded with osgViewer ('z' key)"
+        << "\n    --cache-only                : read data only from the cache"
+        << "\n    --size <w> <h>              : size of the offscreen surface (default 1280 720)"
+        << "\n    --transition <frames>       : frames spent flying between waypoints (default 0)"
+        << "\n    --settle <frames>           : idle frames that count as fully loaded (default 10)"
+        << "\n    --timeout <seconds>         : give up on a waypoint after this long (default 60)"
+        << "\n    --tile-size <n>             : terrain option tileSize"
+        << "\n    --range-factor <f>          : terrain option minTileRangeFactor"
+        << "\n    --concurrency <n>           : terrain option concurrency"
+        << "\n    --merges-per-frame <n>      : terrain option mergesPerFrame"
+        << "\n    --progressive <true|false>  : terrain option progressive"
+        << "\n    --json <file|->             : also write the results as JSON"
+        << std::endl;
+    return 0;
+}
+
+namespace
+{
+    // Counts the tile models the terrain engine creates, and the bytes of
+    // texture imagery they carry. The bytes stand in for GPU upload volume.
+    struct TileCounter : public TerrainEngine::CreateTileModelCallback
+    {
+        std::atomic<unsigned> _tiles;
+        std::atomic<unsigned long long> _bytes;
+
+        TileCounter() : _tiles(0u), _bytes(0ull) { }
+
+        static unsigned long long sizeOf(const osg::Texture* tex)
+        {
+            unsigned long long bytes = 0ull;
+            if (tex)
+            {
+                for (unsigned i = 0; i < tex->getNumImages(); ++i)
+                {
+                    const osg::Image* image = tex->getImage(i);
+                    if (image)
+                        bytes += image->getTotalSizeInBytesIncludingMipmaps();
+                }
+            }
+            return bytes;
+        }
+
+        void onCreateTileModel(TerrainEngineNode*, TerrainTileModel* model) override
+        {
+            unsigned long long bytes = 0ull;
+            for (auto& layer : model->colorLayers())
+                if (layer.valid())
+                    bytes += sizeOf(layer->getTexture());
+            if (model->elevationModel().valid())
+                bytes += sizeOf(model->elevationModel()->getTexture());
+            if (model->normalModel().valid())
+                bytes += sizeOf(model->normalModel()->getTexture());
+            if (model->landCoverModel().valid())
+                bytes += sizeOf(model->landCoverModel()->getTexture());
+
+            _tiles.fetch_add(1u);
+            _bytes.fetch_add(bytes);
+        }
+    };
+
+    struct WaypointResult
+    {
+        double _secondsToLoaded;
+        unsigned _frames;
+        unsigned _tiles;
+        unsigned long long _bytes;
+        bool _timedOut;
+    };
+
+    double percentile(std::vector<double> v, double p)
+    {
+        if (v.empty())
+            return 0.0;
+        std::sort(v.begin(), v.end());
+        unsigned i = (unsigned)std::min((double)(v.size() - 1), p * (double)(v.size() - 1) + 0.5);
+        return v[i];
+    }
+
+    bool busy(osgViewer::Viewer& viewer)
+    {
+        if (JobArena::metrics().totalJobs() > 0)
+            return true;
+        osgDB::DatabasePager* pager = viewer.getDatabasePager();
+        return pager && pager->getRequestsInProgress();
+    }
+
+    osg::Matrixd viewMatrixOf(const osg::AnimationPath::ControlPoint& cp)
+    {
+        osg::Matrixd m;
+        cp.getInverse(m);
+        return m;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser args(&argc, argv);
+
+    if (args.read("--help") || args.read("-h") || argc < 2)
+        return usage(argv[0]);
+
+    std::string pathFile, jsonFile;
+    unsigned width = 1280u, height = 720u;
+    unsigned transition = 0u, settle = 10u;
+    double timeout = 60.0;
+
+    args.read("--path", pathFile);
+    args.read("--json", jsonFile);
+    args.read("--size", width, height);
+    args.read("--transition", transition);
+    args.read("--settle", settle);
+    args.read("--timeout", timeout);
+
+    if (pathFile.empty())
+        return usage(argv[0]);
+
+    osg::ref_ptr<osg::AnimationPath> path = new osg::AnimationPath();
+    {
+        std::ifstream in(pathFile.c_str());
+        if (!in.is_open())
+        {
+            std::cerr << "Cannot open camera path " << pathFile << std::endl;
+            return -1;
+        }
+        path->read(in);
+    }
+    if (path->empty())
+    {
+        std::cerr << "Camera path " << pathFile << " has no control points" << std::endl;
+        return -1;
+    }
+
+    if (args.read("--cache-only"))
+    {
+        Registry::instance()->setOverrideCachePolicy(CachePolicy::CACHE_ONLY);
+    }
+
+    osgEarth::initialize();
+
+    osg::ref_ptr<osg::Node> node = osgDB::readNodeFiles(args);
+    MapNode* mapNode = MapNode::get(node.get());
+    if (!mapNode)
+    {
+        std::cerr << "No earth file loaded" << std::endl;
+        return -1;
+    }
+
+    // terrain options take effect when the map node opens, so apply
+    // them before the first frame
+    TerrainOptionsAPI& terrain = mapNode->getTerrainOptions();
+    int tileSize;
+    float rangeFactor;
+    unsigned concurrency, mergesPerFrame;
+    std::string progressive;
+    if (args.read("--tile-size", tileSize))
+        terrain.setTileSize(tileSize);
+    if (args.read("--range-factor", rangeFactor))
+        terrain.setMinTileRangeFactor(rangeFactor);
+    if (args.read("--concurrency", concurrency))
+        terrain.setConcurrency(concurrency);
+    if (args.read("--merges-per-frame", mergesPerFrame))
+        terrain.setMergesPerFrame(mergesPerFrame);
+    if (args.read("--progressive", progressive))
+        terrain.setProgressive(progressive == "true");
+
+    if (!mapNode->open())
+    {
+        std::cerr << "Map failed to open" << std::endl;
+        return -1;
+    }
+
+    osg::ref_ptr<TileCounter> counter = new TileCounter();
+    mapNode->getTerrainEngine()->addCreateTileModelCallback(counter.get());
+
+    // offscreen surface, so the benchmark runs the same on any desktop
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits();
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = width;
+    traits->height = height;
+    traits->red = traits->green = traits->blue = traits->alpha = 8;
+    traits->depth = 24;
+    traits->doubleBuffer = false;
+    traits->pbuffer = true;
+    traits->sharedContext = 0L;
+
+    osg::ref_ptr<osg::GraphicsContext> gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if (!gc.valid())
+    {
+        std::cerr << "Cannot create an offscreen graphics context" << std::endl;
+        return -1;
+    }
+
+    osgViewer::Viewer viewer;
+    viewer.setThreadingModel(viewer.SingleThreaded);
+    viewer.getCamera()->setGraphicsContext(gc.get());
+    viewer.getCamera()->setViewport(0, 0, width, height);
+    viewer.getCamera()->setProjectionMatrixAsPerspective(30.0, (double)width / (double)height, 1.0, 1e7);
+    viewer.getCamera()->addCullCallback(new AutoClipPlaneCullCallback(mapNode));
+    viewer.setSceneData(node.get());
+    viewer.realize();
+
+    const osg::AnimationPath::TimeControlPointMap& points = path->getTimeControlPointMap();
+
+    std::vector<WaypointResult> results;
+    std::vector<double> frameTimes;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    osg::Timer_t frameStart = start;
+
+    auto frame = [&]()
+    {
+        viewer.frame();
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        frameTimes.push_back(osg::Timer::instance()->delta_m(frameStart, now));
+        frameStart = now;
+    };
+
+    double prevTime = points.begin()->first;
+
+    for (auto& point : points)
+    {
+        WaypointResult r;
+        unsigned tiles0 = counter->_tiles;
+        unsigned long long bytes0 = counter->_bytes;
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        unsigned frames = 0u;
+
+        for (unsigned i = 1; i <= transition && point.first > prevTime; ++i)
+        {
+            osg::AnimationPath::ControlPoint cp;
+            path->getInterpolatedControlPoint(prevTime + (point.first - prevTime)*(double)i / (double)transition, cp);
+            viewer.getCamera()->setViewMatrix(viewMatrixOf(cp));
+            frame();
+            ++frames;
+        }
+
+        viewer.getCamera()->setViewMatrix(viewMatrixOf(point.second));
+
+        unsigned idle = 0u;
+        unsigned lastTiles = counter->_tiles;
+        osg::Timer_t loadedAt = t0;
+        r._timedOut = false;
+
+        while (idle < settle)
+        {
+            frame();
+            ++frames;
+
+            unsigned tiles = counter->_tiles;
+            if (busy(viewer) || tiles != lastTiles)
+            {
+                idle = 0u;
+                loadedAt = osg::Timer::instance()->tick();
+            }
+            else
+            {
+                ++idle;
+            }
+            lastTiles = tiles;
+
+            if (osg::Timer::instance()->delta_s(t0, osg::Timer::instance()->tick()) > timeout)
+            {
+                r._timedOut = true;
+                loadedAt = osg::Timer::instance()->tick();
+                break;
+            }
+        }
+
+        r._secondsToLoaded = osg::Timer::instance()->delta_s(t0, loadedAt);
+        r._frames = frames;
+        r._tiles = counter->_tiles - tiles0;
+        r._bytes = counter->_bytes - bytes0;
+        results.push_back(r);
+
+        std::cerr << "Waypoint " << results.size() << "/" << points.size()
+            << ": " << std::fixed << std::setprecision(3) << r._secondsToLoaded << "s"
+            << (r._timedOut ? " (timed out)" : "") << std::endl;
+
+        prevTime = point.first;
+    }
+
+    double totalSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    double p50 = percentile(frameTimes, 0.50);
+    double p90 = percentile(frameTimes, 0.90);
+    double p99 = percentile(frameTimes, 0.99);
+    double pmax = percentile(frameTimes, 1.0);
+    double peakMB = (double)Memory::getProcessPeakPhysicalUsage() / 1048576.0;
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "tileSize=" << terrain.getTileSize()
+        << " minTileRangeFactor=" << terrain.getMinTileRangeFactor()
+        << " concurrency=" << terrain.getConcurrency()
+        << " mergesPerFrame=" << terrain.getMergesPerFrame()
+        << " progressive=" << (terrain.getProgressive() ? "true" : "false")
+        << std::endl << std::endl;
+
+    std::cout << std::setw(8) << "waypoint" << std::setw(12) << "loaded (s)" << std::setw(10) << "frames"
+        << std::setw(10) << "tiles" << std::setw(14) << "texture MB" << std::endl;
+    for (unsigned i = 0; i < results.size(); ++i)
+    {
+        const WaypointResult& r = results[i];
+        std::cout << std::setw(8) << (i + 1) << std::setw(12) << r._secondsToLoaded << std::setw(10) << r._frames
+            << std::setw(10) << r._tiles << std::setw(14) << (double)r._bytes / 1048576.0
+            << (r._timedOut ? "  timed out" : "") << std::endl;
+    }
+
+    std::cout << std::endl
+        << "Total time      " << totalSeconds << " s, " << frameTimes.size() << " frames" << std::endl
+        << "Frame time      p50 " << p50 << "  p90 " << p90 << "  p99 " << p99 << "  max " << pmax << " ms" << std::endl
+        << "Tile models     " << (unsigned)counter->_tiles << std::endl
+        << "Texture data    " << (double)counter->_bytes / 1048576.0 << " MB" << std::endl
+        << "Peak memory     " << peakMB << " MB" << std::endl;
+
+    if (!jsonFile.empty())
+    {
+        std::ofstream file;
+        if (jsonFile != "-")
+            file.open(jsonFile.c_str());
+        std::ostream& out = jsonFile == "-" ? std::cout : file;
+
+        out << std::fixed << std::setprecision(3)
+            << "{\n"
+            << "  \"osgearth_version\": \"" << osgEarthGetVersion() << "\",\n"
+            << "  \"terrain\": {\"tileSize\": " << terrain.getTileSize()
+            << ", \"minTileRangeFactor\": " << terrain.getMinTileRangeFactor()
+            << ", \"concurrency\": " << terrain.getConcurrency()
+            << ", \"mergesPerFrame\": " << terrain.getMergesPerFrame()
+            << ", \"progressive\": " << (terrain.getProgressive() ? "true" : "false") << "},\n"
+            << "  \"total_seconds\": " << totalSeconds << ",\n"
+            << "  \"frames\": " << frameTimes.size() << ",\n"
+            << "  \"frame_ms\": {\"p50\": " << p50 << ", \"p90\": " << p90 << ", \"p99\": " << p99 << ", \"max\": " << pmax << "},\n"
+            << "  \"tiles\": " << (unsigned)counter->_tiles << ",\n"
+            << "  \"texture_bytes\": " << (unsigned long long)counter->_bytes << ",\n"
+            << "  \"peak_memory_mb\": " << peakMB << ",\n"
+            << "  \"waypoints\": [";
+        for (unsigned i = 0; i < results.size(); ++i)
+        {
+            const WaypointResult& r = results[i];
+            out << (i > 0 ? "," : "") << "\n    {"
+                << "\"seconds_to_loaded\": " << r._secondsToLoaded << ", "
+                << "\"frames\": " << r._frames << ", "
+                << "\"tiles\": " << r._tiles << ", "
+                << "\"texture_bytes\": " << r._bytes << ", "
+                << "\"timed_out\": " << (r._timedOut ? "true" : "false") << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    mapNode->getTerrainEngine()->removeCreateTileModelCallback(counter.get());
+
+    return 0;
+}
@@ -84,6 +84,7 @@ int usage( const std::string& msg )
         << std::endl
         << "    --seed file.earth                   ; Seeds the cache in a .earth file"  << std::endl
         << "        [--estimate]                    ; Print out an estimation of the number of tiles, disk space and time it will take to perform this seed operation" << std::endl
+        << "        [--samples n]                   ; Number of tiles per level to read from each layer for the estimate (default=4)" << std::endl
         << "        [--min-level level]             ; Lowest LOD level to seed (default=0)" << std::endl
         << "        [--max-level level]             ; Highest LOD level to seed (default=highest available)" << std::endl
         << "        [--bounds xmin ymin xmax ymax]* ; Geospatial bounding box to seed (in map coordinates; default=entire map)" << std::endl
@@ -92,6 +93,7 @@ int usage( const std::string& msg )
         << "        [--mt]                          ; Use multithreading to process the tiles." << std::endl
         << "        [--concurrency]                 ; The number of threads or processes to use if --mp or --mt are provided." << std::endl
         << "        [--verbose]                     ; Displays progress of the seed operation" << std::endl
+        << "        [--checkpoint folder]           ; Saves progress in this folder and resumes from it on the next run" << std::endl
         << std::endl
         << "    --purge file.earth                  ; Purges a layer cache in a .earth file (interactive)" << std::endl
         << std::endl;
@@ -123,6 +125,9 @@ int seed( osg::ArgumentParser& args )
     while (args.read("--max-level", maxLevel));
 
     bool estimate = args.read("--estimate");        
+
+    unsigned int samplesPerLevel = 4;
+    args.read("--samples", samplesPerLevel);
     
 
     std::vector< Bounds > bounds;
@@ -140,6 +145,9 @@ int seed( osg::ArgumentParser& args )
 
     bool verbose = args.read("--verbose");
 
+    std::string checkpointPath;
+    args.read("--checkpoint", checkpointPath);
+
     unsigned int batchSize = 0;
     args.read("--batchsize", batchSize);
 
@@ -192,25 +200,57 @@ int seed( osg::ArgumentParser& args )
     // If they requested to do an estimate then don't do the seed, just print out the estimated values.
     if (estimate)
     {        
-        CacheEstimator est;
-        if ( minLevel >= 0 )
-            est.setMinLevel( minLevel );
-        if ( maxLevel >= 0 )
-            est.setMaxLevel( maxLevel );
-        est.setProfile( mapNode->getMap()->getProfile() );
-
-        for (unsigned int i = 0; i < bounds.size(); i++)
-        {
-            GeoExtent extent(mapNode->getMapSRS(), bounds[i]);
-            OE_DEBUG << "Adding extent " << extent.toString() << std::endl;
-            est.addExtent( extent );
-        } 
-
-        unsigned int numTiles = est.getNumTiles();
-        double size = est.getSizeInMB();
-        double time = est.getTotalTimeInSeconds();
+        // estimate each layer that would be seeded, from its own data extents
+        // and a sample of its actual tiles:
+        osgEarth::Map* map = mapNode->getMap();
+        std::vector< osg::ref_ptr<TileLayer> > layers;
+        if (imageLayerIndex >= 0)
+            layers.push_back(map->getLayerAt<ImageLayer>(imageLayerIndex));
+        else if (elevationLayerIndex >= 0)
+            layers.push_back(map->getLayerAt<ElevationLayer>(elevationLayerIndex));
+        else
+            map->getLayers(layers);
+
+        unsigned int numTiles = 0;
+        double size = 0.0;
+        double time = 0.0;
+
         std::cout << "Cache Estimation " << std::endl
-            << "---------------- " << std::endl
+            << "---------------- " << std::endl;
+
+        for (unsigned int j = 0; j < layers.size(); ++j)
+        {
+            TileLayer* layer = layers[j].get();
+            if (!layer || !layer->isOpen())
+                continue;
+
+            CacheEstimator est;
+            if ( minLevel >= 0 )
+                est.setMinLevel( minLevel );
+            if ( maxLevel >= 0 )
+                est.setMaxLevel( maxLevel );
+            est.setProfile( map->getProfile() );
+
+            for (unsigned int i = 0; i < bounds.size(); i++)
+            {
+                GeoExtent extent(mapNode->getMapSRS(), bounds[i]);
+                OE_DEBUG << "Adding extent " << extent.toString() << std::endl;
+                est.addExtent( extent );
+            } 
+
+            est.sample( layer, samplesPerLevel );
+
+            std::cout << layer->getName() << ": "
+                << est.getNumTiles() << " tiles, "
+                << osgEarth::prettyPrintSize( est.getSizeInMB() ) << ", "
+                << osgEarth::prettyPrintTime( est.getTotalTimeInSeconds() ) << std::endl;
+
+            numTiles += est.getNumTiles();
+            size += est.getSizeInMB();
+            time += est.getTotalTimeInSeconds();
+        }
+
+        std::cout
             << "Total number of tiles: " << numTiles << std::endl
             << "Size on disk:          " << osgEarth::prettyPrintSize( size ) << std::endl
             << "Total time:            " << osgEarth::prettyPrintTime( time ) << std::endl;
@@ -305,6 +345,7 @@ int seed( osg::ArgumentParser& args )
     // Initialize the seeder
     osgEarth::Contrib::CacheSeed seeder;
     seeder.setVisitor(visitor.get());
+    seeder.setCheckpointPath(checkpointPath);
 
     osgEarth::Map* map = mapNode->getMap();
 
@@ -27,6 +27,11 @@
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/ExampleResources>
 #include <osgEarth/Threading>
+#include <osgEarth/Containers>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/ImageToHeightFieldConverter>
 #include <osgDB/ReaderWriter>
 #include <osgDB/ReadFile>
 #include <osgDB/Registry>
@@ -43,6 +48,8 @@
 #include <Poco/Timestamp.h>
 #include <Poco/DateTimeFormatter.h>
 #include <Poco/DateTimeFormat.h>
+#include <Poco/DateTimeParser.h>
+#include <Poco/URI.h>
 #include <Poco/Exception.h>
 #include <Poco/ThreadPool.h>
 #include <Poco/Util/ServerApplication.h>
@@ -50,6 +57,9 @@
 #include <Poco/Util/OptionSet.h>
 #include <Poco/Util/HelpFormatter.h>
 #include <iostream>
+#include <sstream>
+#include <memory>
+#include <iomanip>
 
 using Poco::Net::ServerSocket;
 using Poco::Net::HTTPRequestHandler;
@@ -61,6 +71,7 @@ using Poco::Net::HTTPServerParams;
 using Poco::Timestamp;
 using Poco::DateTimeFormatter;
 using Poco::DateTimeFormat;
+using Poco::DateTimeParser;
 using Poco::ThreadPool;
 using Poco::Util::ServerApplication;
 using Poco::Util::Application;
@@ -297,6 +308,14 @@ usage(const char* name)
 {
     OE_NOTICE
         << "\nUsage: " << name << " file.earth" << std::endl
+        << "    --port <num>        : port to listen on (default = 8000)" << std::endl
+        << "    --threads <num>     : number of request worker threads (default = number of cores)" << std::endl
+        << "    --cache-size <num>  : number of encoded tiles to keep in memory (default = 4096)" << std::endl
+        << "    --max-age <seconds> : how long clients may cache a tile (default = 3600)" << std::endl
+        << "    --no-render         : only serve layer tiles; don't create a graphics context" << std::endl
+        << std::endl
+        << "    Layer tiles:    /<layer name>/z/x/y.<png|jpg|tif>" << std::endl
+        << "    Rendered tiles: /z/x/y.<png|jpg>" << std::endl
         << MapNodeHelper().usage() << std::endl;
 
     return 0;
@@ -462,7 +481,141 @@ public:
 };
 
 
+/**
+ * Tile that's ready to send: the encoded bytes and the headers
+ * that describe them.
+ */
+struct EncodedTile
+{
+    std::shared_ptr<const std::string> _data;
+    std::string _mime;
+    std::string _etag;
+};
+
+std::string
+mimeTypeForExtension(const std::string& ext)
+{
+    if (ext == "jpg" || ext == "jpeg") return "image/jpeg";
+    if (ext == "tif" || ext == "tiff") return "image/tiff";
+    return "image/png";
+}
+
+// Strong ETag from the tile's contents (FNV-1a)
+std::string
+makeETag(const std::string& data)
+{
+    unsigned long long fnv = 14695981039346656037ull;
+    for (unsigned char c : data)
+    {
+        fnv ^= c;
+        fnv *= 1099511628211ull;
+    }
+    std::ostringstream buf;
+    buf << '"' << std::hex << std::setfill('0') << std::setw(16) << fnv << '-' << std::dec << data.size() << '"';
+    return buf.str();
+}
+
+bool
+encodeImage(const osg::Image* image, const std::string& ext, EncodedTile& output)
+{
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+    if (!rw || !image)
+        return false;
+
+    std::stringstream buf;
+    if (!rw->writeImage(*image, buf).success())
+        return false;
+
+    std::shared_ptr<std::string> data = std::make_shared<std::string>(buf.str());
+    output._etag = makeETag(*data);
+    output._mime = mimeTypeForExtension(ext);
+    output._data = data;
+    return true;
+}
+
+/**
+ * Serves tiles straight from the map's image and elevation layers
+ * (including feature layers that rasterize to images). Each layer reads
+ * through its own memory (L2) cache and the disk cache configured in the
+ * earth file, and layers are safe to query from many threads at once, so
+ * unlike the rendered tiles these don't share a lock.
+ */
+class LayerTileServer
+{
+public:
+    LayerTileServer(MapNode* mapNode) :
+        _map(mapNode ? mapNode->getMap() : 0L)
+    {
+    }
+
+    //! Creates and encodes a tile from the named layer, with the
+    //! y axis running south to north like TMS.
+    bool getTile(const std::string& layerName, unsigned z, unsigned x, unsigned y, const std::string& ext, EncodedTile& output)
+    {
+        if (!_map.valid())
+            return false;
+
+        TileLayer* layer = _map->getLayerByName<TileLayer>(layerName);
+        if (!layer || !layer->isOpen())
+            return false;
+
+        const Profile* profile = layer->getProfile();
+        if (!profile)
+            return false;
+
+        unsigned cols = 0, rows = 0;
+        profile->getNumTiles(z, cols, rows);
+        if (x >= cols || y >= rows)
+            return false;
+
+        TileKey key(z, x, rows - y - 1, profile);
+        if (!layer->isKeyInLegalRange(key) || !layer->mayHaveData(key))
+            return false;
+
+        ImageLayer* imageLayer = dynamic_cast<ImageLayer*>(layer);
+        ElevationLayer* elevationLayer = dynamic_cast<ElevationLayer*>(layer);
+
+        if (imageLayer)
+        {
+            GeoImage geoImage = imageLayer->createImage(key);
+            if (!geoImage.valid())
+                return false;
+
+            osg::ref_ptr<const osg::Image> image = geoImage.getImage();
+            if ((ext == "jpg" || ext == "jpeg") && image->getPixelFormat() != GL_RGB)
+            {
+                image = ImageUtils::convertToRGB8(image.get());
+            }
+            return encodeImage(image.get(), ext, output);
+        }
+
+        else if (elevationLayer)
+        {
+            // Heights go out as a single band 32-bit float image
+            if (ext != "tif" && ext != "tiff")
+                return false;
+
+            GeoHeightField hf = elevationLayer->createHeightField(key);
+            if (!hf.valid())
+                return false;
+
+            ImageToHeightFieldConverter conv;
+            osg::ref_ptr<osg::Image> image = conv.convert(hf.getHeightField(), 32);
+            return encodeImage(image.get(), ext, output);
+        }
+
+        return false;
+    }
+
+private:
+    osg::observer_ptr<Map> _map;
+};
+
 static TileImageServer* _server;
+static LayerTileServer* _layerServer;
+static LRUCache<std::string, EncodedTile>* _tileCache;
+static Timestamp _startTime;
+static int _maxAge = 3600;
 
 class TileRequestHandler: public HTTPRequestHandler
 {
@@ -474,48 +627,109 @@ public:
     void handleRequest(HTTPServerRequest& request,
                        HTTPServerResponse& response)
     {
-        StringTokenizer tok("/");
-        StringVector tized;
-        tok.tokenize(request.getURI(), tized);
-        if ( tized.size() == 4 )
+        // the path alone identifies the tile, so it keys the cache
+        std::string path = Poco::URI(request.getURI()).getPath();
+
+        EncodedTile tile;
+        LRUCache<std::string, EncodedTile>::Record record;
+        if (_tileCache->get(path, record))
+        {
+            tile = record.value();
+        }
+        else if (createTile(path, tile))
+        {
+            _tileCache->insert(path, tile);
+        }
+        else
+        {
+            response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+            response.setContentLength(0);
+            response.send();
+            return;
+        }
+
+        std::string lastModified = DateTimeFormatter::format(_startTime, DateTimeFormat::HTTP_FORMAT);
+        response.set("ETag", tile._etag);
+        response.set("Last-Modified", lastModified);
+        response.set("Cache-Control", Stringify() << "max-age=" << _maxAge);
+
+        if (isNotModified(request, tile))
         {
-            int z = as<int>(tized[1], 0);
-            int x = as<int>(tized[2], 0);
-            unsigned int y = as<int>(osgDB::getNameLessExtension(tized[3]),0);
-            std::string ext = osgDB::getFileExtension(tized[3]);
+            response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED);
+            response.setContentLength(0);
+            response.send();
+            return;
+        }
 
-            OE_DEBUG << "z=" << z << std::endl;
-            OE_DEBUG << "x=" << x << std::endl;
-            OE_DEBUG << "y=" << y << std::endl;
-            OE_DEBUG << "ext=" << ext << std::endl;
+        // a known length (instead of chunks) lets the connection stay alive
+        response.setContentType(tile._mime);
+        response.setContentLength(tile._data->size());
+        response.sendBuffer(tile._data->data(), tile._data->size());
+    }
 
-            response.setChunkedTransferEncoding(true);
+private:
+    // Tiles don't change while the server runs, so a client's copy is
+    // current if it has the same ETag or is newer than the server.
+    bool isNotModified(HTTPServerRequest& request, const EncodedTile& tile)
+    {
+        if (request.has("If-None-Match"))
+        {
+            const std::string& match = request.get("If-None-Match");
+            return match == "*" || match.find(tile._etag) != std::string::npos;
+        }
+
+        if (request.has("If-Modified-Since"))
+        {
+            int tzd;
+            Poco::DateTime since;
+            if (DateTimeParser::tryParse(DateTimeFormat::HTTP_FORMAT, request.get("If-Modified-Since"), since, tzd))
+            {
+                // HTTP dates have one second resolution
+                return since.timestamp().epochTime() >= _startTime.epochTime();
+            }
+        }
+
+        return false;
+    }
+
+    bool createTile(const std::string& path, EncodedTile& output)
+    {
+        StringTokenizer tok("/");
+        StringVector tized;
+        tok.tokenize(path, tized);
+
+        // /z/x/y.ext renders the whole scene
+        if (tized.size() == 4 && _server)
+        {
+            unsigned z = as<unsigned>(tized[1], 0u);
+            unsigned x = as<unsigned>(tized[2], 0u);
+            unsigned y = as<unsigned>(osgDB::getNameLessExtension(tized[3]), 0u);
+            std::string ext = osgDB::getLowerCaseFileExtension(tized[3]);
 
             osg::ref_ptr< osg::Image > image = _server->getTile(z, x, y);
+            return image.valid() && encodeImage(image.get(), ext, output);
+        }
 
-            if (image)
-            {
-                osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
-                if (rw)
-                {
-                    std::string mime = "image/png";
-                    if (ext == "jpeg" || ext == "jpg")
-                    {
-                        mime = "image/jpeg";
-                    }
-                    response.setContentType(mime);
-                    std::ostream& ostr = response.send();
-                    rw->writeImage(*image.get(), ostr);
-                }
+        // /layer/z/x/y.ext comes from a single layer
+        else if (tized.size() == 5)
+        {
+            unsigned z = as<unsigned>(tized[2], 0u);
+            unsigned x = as<unsigned>(tized[3], 0u);
+            unsigned y = as<unsigned>(osgDB::getNameLessExtension(tized[4]), 0u);
+            std::string ext = osgDB::getLowerCaseFileExtension(tized[4]);
 
-            }
+            return _layerServer->getTile(decode(tized[1]), z, x, y, ext, output);
         }
 
-        response.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+        return false;
     }
 
-private:
-    std::string _format;
+    static std::string decode(const std::string& input)
+    {
+        std::string output;
+        Poco::URI::decode(input, output);
+        return output;
+    }
 };
 
 class TileRequestHandlerFactory : public HTTPRequestHandlerFactory
@@ -528,33 +742,17 @@ class TileRequestHandlerFactory : public HTTPRequestHandlerFactory
     HTTPRequestHandler* createRequestHandler(
         const HTTPServerRequest& request)
     {
-        StringTokenizer tok("/");
-        StringVector tized;
-        tok.tokenize(request.getURI(), tized);
-        if ( tized.size() == 4 )
-        {
-            int z = as<int>(tized[1], 0);
-            int x = as<int>(tized[2], 0);
-            unsigned int y = as<int>(osgDB::getNameLessExtension(tized[3]),0);
-            std::string ext = osgDB::getFileExtension(tized[3]);
-
-            OE_DEBUG << "z=" << z << std::endl;
-            OE_DEBUG << "x=" << x << std::endl;
-            OE_DEBUG << "y=" << y << std::endl;
-            OE_DEBUG << "ext=" << ext << std::endl;
-
-            return new TileRequestHandler();
-        }
-
-        return 0;
+        // the handler answers 404 for anything that isn't a tile
+        return new TileRequestHandler();
     }
 };
 
 class TileHTTPServer: public Poco::Util::ServerApplication
 {
 public:
-    TileHTTPServer(int port):
-      _port(port)
+    TileHTTPServer(int port, int threads):
+      _port(port),
+      _threads(threads)
     {
     }
 
@@ -577,7 +775,18 @@ protected:
     int main(const std::vector<std::string>& args)
     {
         ServerSocket svs(_port);
-        HTTPServer srv(new TileRequestHandlerFactory(), svs, new HTTPServerParams);
+
+        HTTPServerParams* params = new HTTPServerParams;
+        params->setMaxThreads(_threads);
+        params->setMaxQueued(1024);
+        params->setKeepAlive(true);
+        params->setMaxKeepAliveRequests(0); // unlimited
+        params->setKeepAliveTimeout(Poco::Timespan(15, 0));
+
+        // worker pool that handles the connections
+        ThreadPool pool(1, _threads);
+
+        HTTPServer srv(new TileRequestHandlerFactory(), pool, svs, params);
         srv.start();
         waitForTerminationRequest();
         srv.stop();
@@ -586,6 +795,7 @@ protected:
 
 private:
     int _port;
+    int _threads;
 };
 
 
@@ -605,6 +815,17 @@ main(int argc, char** argv)
     arguments.read("--port", port);
     OE_NOTICE << "Listening on port " << port << std::endl;
 
+    int threads = Threading::getConcurrency();
+    arguments.read("--threads", threads);
+    threads = osg::maximum(threads, 1);
+
+    unsigned cacheSize = 4096u;
+    arguments.read("--cache-size", cacheSize);
+
+    arguments.read("--max-age", _maxAge);
+
+    bool render = !arguments.read("--no-render");
+
     // thread-safe initialization of the OSG wrapper manager. Calling this here
     // prevents the "unsupported wrapper" messages from OSG
     osgDB::Registry::instance()->getObjectWrapperManager()->findWrapper("osg::Image");
@@ -619,8 +840,17 @@ main(int argc, char** argv)
         OE_NOTICE << "Found map node" << std::endl;
     }
 
-    _server = new TileImageServer( mapNode.get() );
+    // The rendered tiles need a graphics context, so a headless
+    // server can skip them and only serve layer tiles.
+    if (render)
+    {
+        _server = new TileImageServer( mapNode.get() );
+    }
+
+    _layerServer = new LayerTileServer( mapNode.get() );
+    _tileCache = new LRUCache<std::string, EncodedTile>( true, cacheSize );
+    _startTime.update();
 
-    TileHTTPServer app(port);
+    TileHTTPServer app(port, threads);
     return app.run(argc, argv);
 }
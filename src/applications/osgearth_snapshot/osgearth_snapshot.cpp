@@ -0,0 +1,508 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+/**
+ * Renders a batch of viewpoints over an earth file without a window and
+ * writes one image per viewpoint.
+ *
+ * The viewpoints file uses the same XML as the viewpoints extension:
+ * a <viewpoints> element holding <viewpoint> elements. For each one the
+ * camera jumps to the viewpoint and holds still until the scene is done
+ * loading: no osgEarth jobs pending, no database pager requests, nothing
+ * waiting to merge into the terrain or any paged feature layer, and no
+ * new tile models, for a number of frames. Then the frame is read back.
+ *
+ * Readback goes through a pair of pixel buffer objects, so the GPU copies
+ * the pixels while the next viewpoint starts loading, and the images are
+ * encoded and written in the background.
+ *
+ * The surface is a pbuffer. On a GPU server with no display, use an
+ * OpenSceneGraph built for EGL, whose pbuffers need no X server.
+ */
+
+#include <osgEarth/MapNode>
+#include <osgEarth/TerrainEngineNode>
+#include <osgEarth/EarthManipulator>
+#include <osgEarth/AutoClipPlaneHandler>
+#include <osgEarth/PagedNode>
+#include <osgEarth/NodeUtils>
+#include <osgEarth/GLUtils>
+#include <osgEarth/Registry>
+#include <osgEarth/Threading>
+#include <osgEarth/StringUtils>
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgDB/FileUtils>
+#include <osgDB/DatabasePager>
+#include <osgViewer/Viewer>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define SNAPSHOT_ARENA_NAME "oe.snapshot"
+
+int
+usage(const char* name)
+{
+    std::cout
+        << "Renders a batch of viewpoints over an earth file to image files.\n\n"
+        << name << " file.earth --viewpoints file.xml [options]\n"
+        << "\n    --viewpoints <file>         : XML file of <viewpoint> elements"
+        << "\n    --out <folder>              : folder for the images (default .)"
+        << "\n    --prefix <name>             : image file name prefix (default snapshot_)"
+        << "\n    --ext <extension>           : image file extension (default png)"
+        << "\n    --size <w> <h>              : size of the images (default 1920 1080)"
+        << "\n    --samples <n>               : multisamples (default 0)"
+        << "\n    --settle <frames>           : idle frames that count as fully loaded (default 10)"
+        << "\n    --timeout <seconds>         : take the snapshot anyway after this long (default 120)"
+        << "\n    --cache-only                : read data only from the cache"
+        << std::endl;
+    return 0;
+}
+
+namespace
+{
+    // Counts the tile models the terrain engine creates. A count that is
+    // still moving means the terrain is still refining.
+    struct TileCounter : public TerrainEngine::CreateTileModelCallback
+    {
+        std::atomic<unsigned> _tiles;
+
+        TileCounter() : _tiles(0u) { }
+
+        void onCreateTileModel(TerrainEngineNode*, TerrainTileModel*) override
+        {
+            _tiles.fetch_add(1u);
+        }
+    };
+
+    // Reads the framebuffer back through two pixel buffer objects. A frame
+    // marked for capture starts an asynchronous copy; a later frame maps
+    // it once its fence has signaled. The viewer runs single-threaded, so
+    // this runs on the same thread as the batch loop.
+    struct Readback : public osg::Camera::DrawCallback
+    {
+        struct Slot
+        {
+            Slot() : _pbo(0), _sync(0), _index(-1) { }
+            GLuint _pbo;
+            GLsync _sync;
+            int _index;
+        };
+
+        struct Result
+        {
+            int _index;
+            osg::ref_ptr<osg::Image> _image;
+        };
+
+        unsigned _width, _height;
+        mutable int _capture;
+        mutable Slot _slots[2];
+        mutable unsigned _next;
+        mutable std::vector<Result> _results;
+
+        Readback(unsigned width, unsigned height) :
+            _width(width), _height(height), _capture(-1), _next(0u) { }
+
+        unsigned getNumInFlight() const
+        {
+            return (_slots[0]._index >= 0 ? 1u : 0u) + (_slots[1]._index >= 0 ? 1u : 0u);
+        }
+
+        osg::Image* createImage() const
+        {
+            osg::Image* image = new osg::Image();
+            image->allocateImage(_width, _height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+            return image;
+        }
+
+        void operator () (osg::RenderInfo& renderInfo) const override
+        {
+            osg::State* state = renderInfo.getState();
+            osg::GLExtensions* ext = osg::GLExtensions::Get(state->getContextID(), true);
+            GLFunctions& gl = GLFunctions::get(*state);
+
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+            if (!ext->isPBOSupported || !gl.glFenceSync || !gl.glClientWaitSync || !gl.glDeleteSync)
+            {
+                // no asynchronous path; this waits for the GPU
+                if (_capture >= 0)
+                {
+                    Result r;
+                    r._index = _capture;
+                    r._image = createImage();
+                    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, r._image->data());
+                    _results.push_back(r);
+                    _capture = -1;
+                }
+                return;
+            }
+
+            // collect finished transfers, oldest first, without waiting
+            for (unsigned k = 0; k < 2; ++k)
+            {
+                Slot& slot = _slots[(_next + k) % 2];
+                if (slot._index < 0)
+                    continue;
+
+                GLenum status = gl.glClientWaitSync(slot._sync, 0, 0);
+                if (status == GL_TIMEOUT_EXPIRED)
+                    break;
+
+                gl.glDeleteSync(slot._sync);
+                slot._sync = 0;
+
+                if (status != GL_WAIT_FAILED)
+                {
+                    ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+                    const void* pixels = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+                    if (pixels)
+                    {
+                        Result r;
+                        r._index = slot._index;
+                        r._image = createImage();
+                        ::memcpy(r._image->data(), pixels, r._image->getTotalSizeInBytes());
+                        _results.push_back(r);
+                        ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+                    }
+                    ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+                }
+                slot._index = -1;
+            }
+
+            // start this frame's transfer, unless both buffers are still in flight;
+            // in that case the capture waits for the next frame
+            Slot& slot = _slots[_next];
+            if (_capture >= 0 && slot._index < 0)
+            {
+                if (slot._pbo == 0)
+                {
+                    ext->glGenBuffers(1, &slot._pbo);
+                    ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+                    ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, _width*_height*4u, 0, GL_STREAM_READ);
+                }
+
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+                glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+                slot._sync = gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                slot._index = _capture;
+                _capture = -1;
+                _next = (_next + 1) % 2;
+            }
+        }
+    };
+
+    // Loader idle signals for everything that pages in the scene
+    struct Idle
+    {
+        osgViewer::Viewer& _viewer;
+        TerrainEngineNode* _engine;
+        std::vector<osg::observer_ptr<PagingManager> > _pagers;
+
+        Idle(osgViewer::Viewer& viewer, TerrainEngineNode* engine) :
+            _viewer(viewer), _engine(engine) { }
+
+        // Paged feature layers create their paging managers as they
+        // open and build, so look for new ones now and then.
+        void findPagingManagers()
+        {
+            FindNodesVisitor<PagingManager> find;
+            _viewer.getSceneData()->accept(find);
+            _pagers.assign(find._results.begin(), find._results.end());
+        }
+
+        bool busy() const
+        {
+            if (JobArena::metrics().totalJobs() > 0)
+                return true;
+
+            osgDB::DatabasePager* pager = _viewer.getDatabasePager();
+            if (pager && pager->getRequestsInProgress())
+                return true;
+
+            if (_engine && _engine->getNumPendingMerges() > 0)
+                return true;
+
+            for (auto& p : _pagers)
+            {
+                osg::ref_ptr<PagingManager> manager;
+                if (p.lock(manager) && manager->getNumPendingMerges() > 0)
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    struct SnapshotResult
+    {
+        double _secondsToLoaded;
+        unsigned _frames;
+        bool _timedOut;
+    };
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser args(&argc, argv);
+
+    if (args.read("--help") || args.read("-h") || argc < 2)
+        return usage(argv[0]);
+
+    std::string viewpointsFile, outFolder = ".", prefix = "snapshot_", extension = "png";
+    unsigned width = 1920u, height = 1080u, samples = 0u;
+    unsigned settle = 10u;
+    double timeout = 120.0;
+
+    args.read("--viewpoints", viewpointsFile);
+    args.read("--out", outFolder);
+    args.read("--prefix", prefix);
+    args.read("--ext", extension);
+    args.read("--size", width, height);
+    args.read("--samples", samples);
+    args.read("--settle", settle);
+    args.read("--timeout", timeout);
+
+    if (viewpointsFile.empty())
+        return usage(argv[0]);
+
+    std::vector<Viewpoint> viewpoints;
+    {
+        std::ifstream in(viewpointsFile.c_str());
+        Config conf;
+        if (!in.is_open() || !conf.fromXML(in))
+        {
+            std::cerr << "Cannot read viewpoints from " << viewpointsFile << std::endl;
+            return -1;
+        }
+        const Config& root = conf.hasChild("viewpoints") ? conf.child("viewpoints") : conf;
+        for (auto& c : root.children("viewpoint"))
+        {
+            Viewpoint vp(c);
+            if (vp.isValid())
+                viewpoints.push_back(vp);
+        }
+    }
+    if (viewpoints.empty())
+    {
+        std::cerr << "No viewpoints in " << viewpointsFile << std::endl;
+        return -1;
+    }
+
+    if (!osgDB::makeDirectory(outFolder))
+    {
+        std::cerr << "Cannot create output folder " << outFolder << std::endl;
+        return -1;
+    }
+
+    if (args.read("--cache-only"))
+    {
+        Registry::instance()->setOverrideCachePolicy(CachePolicy::CACHE_ONLY);
+    }
+
+    osgEarth::initialize();
+
+    osg::ref_ptr<osg::Node> node = osgDB::readNodeFiles(args);
+    MapNode* mapNode = MapNode::get(node.get());
+    if (!mapNode || !mapNode->open())
+    {
+        std::cerr << "No earth file loaded" << std::endl;
+        return -1;
+    }
+
+    osg::ref_ptr<TileCounter> counter = new TileCounter();
+    mapNode->getTerrainEngine()->addCreateTileModelCallback(counter.get());
+
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits();
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = width;
+    traits->height = height;
+    traits->red = traits->green = traits->blue = traits->alpha = 8;
+    traits->depth = 24;
+    traits->samples = samples;
+    traits->sampleBuffers = samples > 0 ? 1 : 0;
+    traits->doubleBuffer = false;
+    traits->pbuffer = true;
+    traits->sharedContext = 0L;
+
+    osg::ref_ptr<osg::GraphicsContext> gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if (!gc.valid())
+    {
+        std::cerr << "Cannot create an offscreen graphics context" << std::endl;
+        return -1;
+    }
+
+    osg::ref_ptr<Readback> readback = new Readback(width, height);
+
+    osgViewer::Viewer viewer;
+    viewer.setThreadingModel(viewer.SingleThreaded);
+    viewer.getCamera()->setGraphicsContext(gc.get());
+    viewer.getCamera()->setViewport(0, 0, width, height);
+    viewer.getCamera()->setProjectionMatrixAsPerspective(30.0, (double)width / (double)height, 1.0, 1e7);
+    viewer.getCamera()->setDrawBuffer(GL_FRONT);
+    viewer.getCamera()->setReadBuffer(GL_FRONT);
+    viewer.getCamera()->addCullCallback(new AutoClipPlaneCullCallback(mapNode));
+    viewer.getCamera()->setFinalDrawCallback(readback.get());
+
+    EarthManipulator* manip = new EarthManipulator();
+    viewer.setCameraManipulator(manip);
+    viewer.setSceneData(node.get());
+    viewer.realize();
+
+    Idle idle(viewer, mapNode->getTerrainEngine());
+
+    JobArena::setConcurrency(SNAPSHOT_ARENA_NAME, 2u);
+    JobArena* arena = JobArena::get(SNAPSHOT_ARENA_NAME);
+    JobGroup writes;
+    std::atomic<unsigned> failures(0u);
+
+    // hands finished readbacks over to the writer jobs
+    auto write = [&]()
+    {
+        for (auto& r : readback->_results)
+        {
+            std::string filename = Stringify()
+                << outFolder << "/" << prefix
+                << std::setw(4) << std::setfill('0') << (r._index + 1)
+                << "." << extension;
+
+            osg::ref_ptr<osg::Image> image = r._image;
+            Job(arena, &writes).dispatch([image, filename, &failures](Cancelable*)
+            {
+                if (!osgDB::writeImageFile(*image.get(), filename))
+                {
+                    std::cerr << "Failed to write " << filename << std::endl;
+                    failures.fetch_add(1u);
+                }
+            });
+        }
+        readback->_results.clear();
+    };
+
+    std::vector<SnapshotResult> results;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    for (unsigned v = 0; v < viewpoints.size(); ++v)
+    {
+        SnapshotResult r;
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        unsigned frames = 0u;
+
+        manip->setViewpoint(viewpoints[v], 0.0);
+        idle.findPagingManagers();
+
+        unsigned idleFrames = 0u;
+        unsigned lastTiles = counter->_tiles;
+        osg::Timer_t loadedAt = t0;
+        bool rescanned = false;
+        r._timedOut = false;
+
+        while (idleFrames < settle)
+        {
+            viewer.frame();
+            write();
+            ++frames;
+
+            unsigned tiles = counter->_tiles;
+            if (idle.busy() || tiles != lastTiles)
+            {
+                idleFrames = 0u;
+                rescanned = false;
+                loadedAt = osg::Timer::instance()->tick();
+            }
+            else if (++idleFrames == settle && !rescanned)
+            {
+                // before calling it loaded, make sure no feature layer
+                // started paging since the last look
+                idle.findPagingManagers();
+                rescanned = true;
+                if (idle.busy())
+                    idleFrames = 0u;
+            }
+            lastTiles = tiles;
+
+            if (osg::Timer::instance()->delta_s(t0, osg::Timer::instance()->tick()) > timeout)
+            {
+                r._timedOut = true;
+                loadedAt = osg::Timer::instance()->tick();
+                break;
+            }
+        }
+
+        // capture on the next frame; the copy completes while the next
+        // viewpoint loads
+        readback->_capture = v;
+        while (readback->_capture >= 0)
+        {
+            viewer.frame();
+            write();
+            ++frames;
+        }
+
+        r._secondsToLoaded = osg::Timer::instance()->delta_s(t0, loadedAt);
+        r._frames = frames;
+        results.push_back(r);
+
+        std::cerr << "Snapshot " << (v + 1) << "/" << viewpoints.size()
+            << ": " << std::fixed << std::setprecision(3) << r._secondsToLoaded << "s"
+            << (r._timedOut ? " (timed out)" : "") << std::endl;
+    }
+
+    // drain the readbacks still in flight
+    while (readback->getNumInFlight() > 0)
+    {
+        viewer.frame();
+        write();
+    }
+
+    writes.join();
+
+    double totalSeconds = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    unsigned timedOut = 0u;
+    for (auto& r : results)
+        if (r._timedOut)
+            ++timedOut;
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "Snapshots       " << results.size() << " in " << totalSeconds << " s ("
+        << (totalSeconds / (double)results.size()) << " s each)" << std::endl
+        << "Timed out       " << timedOut << std::endl
+        << "Write failures  " << (unsigned)failures << std::endl;
+
+    mapNode->getTerrainEngine()->removeCreateTileModelCallback(counter.get());
+
+    return failures > 0 ? -1 : 0;
+}
@@ -52,6 +52,8 @@ usage( const std::string& msg )
         << "    --crop             ; Crops features instead of doing a centroid check.  Features can be added to multiple tiles when cropping is enabled" << std::endl
         << "    --dest-srs         ; The destination SRS string in any format osgEarth can understand (wkt, proj4, epsg).  If none is specified the source data SRS will be used" << std::endl
         << "    --bounds minx miny maxx maxy ; The bounding box to use as Level 0.  Feature extent will be used by default" << std::endl
+        << "    --streaming        ; Partitions the features on disk in one pass, then writes each first level tile separately.  Bounds memory use on large datasets" << std::endl
+        << "    --writers          ; The number of threads that write tiles in streaming mode" << std::endl
         << std::endl;
 
     return -1;
@@ -106,6 +108,11 @@ int main(int argc, char** argv)
     std::string destSRS;
     while(arguments.read("--dest-srs", destSRS));
 
+    bool streaming = arguments.read("--streaming");
+
+    unsigned int writers = 0;
+    while (arguments.read("--writers", writers));
+
     std::string grid;
     float gridSizeMeters = -1.0f;
     while (arguments.read("--grid", grid));
@@ -221,6 +228,9 @@ int main(int argc, char** argv)
     packager.setMethod( cropMethod );    
     packager.setDestSRS( destSRS );
     packager.setLod0Extent(ext);
+    packager.setStreaming( streaming );
+    if (writers > 0)
+        packager.setNumWriters( writers );
 
     packager.package( features.get(), destination, layer, description );
     osg::Timer_t endTime = osg::Timer::instance()->tick();
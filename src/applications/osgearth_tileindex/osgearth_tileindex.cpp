@@ -41,6 +41,9 @@ int main(int argc, char** argv)
     std::string indexFilename = "index.shp";
     while (arguments.read("--index", indexFilename));
 
+    unsigned int numThreads = 0;
+    bool setThreads = arguments.read("--threads", numThreads);
+
     OE_NOTICE << "index name = " << indexFilename << std::endl;
 
     std::vector< std::string > filenames;
@@ -71,6 +74,10 @@ int main(int argc, char** argv)
 
     TileIndexBuilder builder;
     builder.setProgressCallback( new ConsoleProgressCallback() );
+    if (setThreads)
+    {
+        builder.setNumThreads( numThreads );
+    }
     for (unsigned int i = 0; i < filenames.size(); i++)
     {
         builder.getFilenames().push_back( filenames[i] );
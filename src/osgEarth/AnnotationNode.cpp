@@ -68,6 +68,8 @@ AnnotationNode::construct()
     _dynamic = false;
     _depthAdj = false;
     _priority = 0.0f;
+    _deferRebuild = false;
+    _rebuildPending = false;
 
     this->getOrCreateStateSet()->setMode( GL_BLEND, osg::StateAttribute::ON );
 
@@ -112,10 +114,46 @@ AnnotationNode::traverse(osg::NodeVisitor& nv)
                 ADJUST_UPDATE_TRAV_COUNT(this, -1);
             }
         }
+
+        // Coalesced rebuild
+        if (_rebuildPending)
+        {
+            _rebuildPending = false;
+            ADJUST_UPDATE_TRAV_COUNT(this, -1);
+            rebuild();
+        }
     }
     osg::Group::traverse(nv);
 }
 
+void
+AnnotationNode::setDeferredRebuild(bool value)
+{
+    _deferRebuild = value;
+
+    // don't strand a pending rebuild
+    if (!_deferRebuild && _rebuildPending)
+    {
+        _rebuildPending = false;
+        ADJUST_UPDATE_TRAV_COUNT(this, -1);
+        rebuild();
+    }
+}
+
+void
+AnnotationNode::requestRebuild()
+{
+    if (!_deferRebuild)
+    {
+        rebuild();
+    }
+    else if (!_rebuildPending)
+    {
+        _rebuildPending = true;
+        ADJUST_UPDATE_TRAV_COUNT(this, +1);
+    }
+}
+
 void
 AnnotationNode::setDefaultLighting( bool lighting )
 {
@@ -20,6 +20,7 @@
 #include <osgEarth/Registry>
 #include <osgEarth/JsonUtils>
 #include <osgEarth/ImageToHeightFieldConverter>
+#include <osgEarth/ImageUtils>
 
 using namespace osgEarth;
 
@@ -167,7 +168,7 @@ ArcGISServer::MapService::init( const URI& _uri, const osgDB::ReaderWriter::Opti
         return setError( "Unable to read metadata from ArcGIS service" );
 
     Json::Value doc;
-    Json::Reader reader;
+    Json::FastReader reader;
 //    if ( !reader.parse( response.getPartStream(0), doc ) )
     if ( !reader.parse( r.getString(), doc ) )
 	{
@@ -408,6 +409,7 @@ ArcGISServerOptions::readFrom(const Config& conf)
     conf.get("token", token());
     conf.get("format", format());
     conf.get("layers", layers());
+    conf.get("metatile_size", metaTileSize());
 }
 
 void
@@ -417,6 +419,7 @@ ArcGISServerOptions::writeTo(Config& conf) const
     conf.set("token", token());
     conf.set("format", format());
     conf.set("layers", layers());
+    conf.set("metatile_size", metaTileSize());
 }
 
 
@@ -461,6 +464,10 @@ ArcGISServerImageLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     // Default cache policy to NO_CACHE for public services
     if (options().cachePolicy().isSet() == false &&
         options().url()->full().find("arcgisonline.com") != std::string::npos)
@@ -547,6 +554,12 @@ ArcGISServerImageLayer::openImplementation()
     // set the tile size from the map service
     setTileSize(_map_service.getTileInfo().getTileSize());
 
+    // a dynamic service can render a block of tiles in one export request
+    if (!_map_service.isTiled() && options().metaTileSize().isSet())
+    {
+        setMetaTileSize(options().metaTileSize().get());
+    }
+
     // establish a profile if we don't already have one:
     if (!getProfile())
     {
@@ -571,9 +584,14 @@ ArcGISServerImageLayer::openImplementation()
     return Status::NoError;
 }
 
-GeoImage
-ArcGISServerImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
+std::string
+ArcGISServerImageLayer::createURL(const TileKey& key) const
 {
+    if (!_map_service.isTiled())
+    {
+        return createExportURL(key.getExtent(), 256, 256);
+    }
+
     std::stringstream buf;
 
     int level = key.getLevelOfDetail();
@@ -581,25 +599,35 @@ ArcGISServerImageLayer::createImageImplementation(const TileKey& key, ProgressCa
     unsigned int tile_x, tile_y;
     key.getTileXY(tile_x, tile_y);
 
-    if (_map_service.isTiled())
-    {
-        buf << options().url()->full() << "/tile"
-            << "/" << level
-            << "/" << tile_y
-            << "/" << tile_x << _dot_format;
-    }
-    else
-    {
-        const GeoExtent& ex = key.getExtent();
-
-        buf << std::setprecision(16)
-            << options().url()->full() << "/export"
-            << "?bbox=" << ex.xMin() << "," << ex.yMin() << "," << ex.xMax() << "," << ex.yMax()
-            << "&format=" << _format
-            << "&size=256,256"
-            << "&transparent=true"
-            << "&f=image";
-    }
+    buf << options().url()->full() << "/tile"
+        << "/" << level
+        << "/" << tile_y
+        << "/" << tile_x << _dot_format;
+
+    return finishURL(buf.str());
+}
+
+std::string
+ArcGISServerImageLayer::createExportURL(const GeoExtent& ex, unsigned width, unsigned height) const
+{
+    std::stringstream buf;
+
+    buf << std::setprecision(16)
+        << options().url()->full() << "/export"
+        << "?bbox=" << ex.xMin() << "," << ex.yMin() << "," << ex.xMax() << "," << ex.yMax()
+        << "&format=" << _format
+        << "&size=" << width << "," << height
+        << "&transparent=true"
+        << "&f=image";
+
+    return finishURL(buf.str());
+}
+
+std::string
+ArcGISServerImageLayer::finishURL(const std::string& url) const
+{
+    std::stringstream buf;
+    buf << url;
 
     //Add the token if necessary
     if (options().token().isSet())
@@ -607,9 +635,7 @@ ArcGISServerImageLayer::createImageImplementation(const TileKey& key, ProgressCa
         std::string token = options().token().value();
         if (!token.empty())
         {
-            std::string str;
-            str = buf.str();
-            std::string sep = str.find('?') == std::string::npos ? "?" : "&";
+            std::string sep = url.find('?') == std::string::npos ? "?" : "&";
             buf << sep << "token=" << token;
         }
     }
@@ -625,12 +651,86 @@ ArcGISServerImageLayer::createImageImplementation(const TileKey& key, ProgressCa
 
     std::string bufStr;
     bufStr = buf.str();
+    return bufStr;
+}
 
-    osg::Image* image = URI(bufStr, options().url()->context()).getImage(getReadOptions(), progress);
+GeoImage
+ArcGISServerImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
+{
+    osg::Image* image = URI(createURL(key), options().url()->context()).getImage(getReadOptions(), progress);
 
     return GeoImage(image, key.getExtent());
 }
 
+bool
+ArcGISServerImageLayer::createImageImplementationAsync(const TileKey& key,
+                                                       const std::function<void(const GeoImage&)>& onComplete,
+                                                       ProgressCallback* progress) const
+{
+    URI(createURL(key), options().url()->context()).readImageAsync(getReadOptions(), progress,
+        [key, onComplete](const ReadResult& r)
+        {
+            onComplete(GeoImage(r.getImage(), key.getExtent()));
+        });
+
+    return true;
+}
+
+bool
+ArcGISServerImageLayer::createImageBlockImplementation(const std::vector<TileKey>& keys,
+                                                       std::vector<GeoImage>& out,
+                                                       ProgressCallback* progress) const
+{
+    if (_map_service.isTiled() || keys.empty())
+        return false;
+
+    const unsigned tileSize = 256u;
+
+    // find the tile range and the extent covering the whole block:
+    unsigned xmin = ~0u, ymin = ~0u, xmax = 0u, ymax = 0u;
+    GeoExtent extent = keys.front().getExtent();
+    for (const auto& key : keys)
+    {
+        unsigned tx, ty;
+        key.getTileXY(tx, ty);
+        xmin = osg::minimum(xmin, tx), xmax = osg::maximum(xmax, tx);
+        ymin = osg::minimum(ymin, ty), ymax = osg::maximum(ymax, ty);
+        extent.expandToInclude(key.getExtent());
+    }
+
+    unsigned cols = xmax - xmin + 1u;
+    unsigned rows = ymax - ymin + 1u;
+
+    osg::ref_ptr<osg::Image> image = URI(
+        createExportURL(extent, cols*tileSize, rows*tileSize),
+        options().url()->context()).getImage(getReadOptions(), progress);
+
+    if (!image.valid() ||
+        image->s() != (int)(cols*tileSize) ||
+        image->t() != (int)(rows*tileSize))
+    {
+        return false;
+    }
+
+    // cut the block into tiles; tile rows run north to south,
+    // image rows run bottom to top.
+    out.clear();
+    out.reserve(keys.size());
+    for (const auto& key : keys)
+    {
+        unsigned tx, ty;
+        key.getTileXY(tx, ty);
+        osg::Image* tile = ImageUtils::cropImage(
+            image.get(),
+            (tx - xmin)*tileSize,
+            (ymax - ty)*tileSize,
+            tileSize, tileSize);
+        out.push_back(GeoImage(tile, key.getExtent()));
+    }
+
+    return true;
+}
+
 
 //........................................................................
 
@@ -669,6 +769,10 @@ ArcGISServerElevationLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     _imageLayer = new ArcGISServerImageLayer(options());
 
     // Initialize and open the image layer
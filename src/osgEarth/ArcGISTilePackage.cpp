@@ -627,7 +627,7 @@ VTPKFeatureSource::openImplementation()
     const osgEarth::Profile* profile = osgEarth::Registry::instance()->getSphericalMercatorProfile();
     FeatureProfile* featureProfile = new FeatureProfile(profile->getExtent());
 
-    Json::Reader reader;
+    Json::FastReader reader;
     Json::Value root(Json::objectValue);
 
     std::stringstream buf;
@@ -636,7 +636,7 @@ VTPKFeatureSource::openImplementation()
     std::string rootPath = buf.str();
 
     std::ifstream in(rootPath);
-    if (!reader.parse(in, root, false))
+    if (!reader.parse(in, root))
         return Status::Error(Stringify() << "Failed to parse " << rootPath);
 
     _bundleSize = root["resourceInfo"]["cacheInfo"]["storageInfo"]["packetSize"].asUInt();
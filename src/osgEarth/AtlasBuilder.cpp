@@ -208,6 +208,9 @@ AtlasBuilder::build(const ResourceLibrary* inputLib,
             // re-write the URI to point at our new atlas:
             skin->imageURI() = newAtlasURI;
 
+            if ( !_compression.empty() )
+                skin->compression() = _compression;
+
             // save the associate so we can come back later:
             sourceSkins[maintab->getSourceList().back().get()] = skin;
 
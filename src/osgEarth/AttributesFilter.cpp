@@ -94,3 +94,35 @@ AttributesFilter::push(FeatureList& input, FilterContext& context)
 
     return context;
 }
+
+FilterContext
+AttributesFilter::push(FeatureBatch& input, FilterContext& context)
+{
+    if (!isSupported())
+    {
+        OE_WARN << "AttributeFilter support not enabled" << std::endl;
+        return context;
+    }
+
+    std::vector<const FeatureBatch::Column*> columns;
+    for (auto& a : _attributes)
+    {
+        const FeatureBatch::Column* column = input.getColumn(a);
+        if (column)
+            columns.push_back(column);
+    }
+
+    std::vector<bool> keep(input.size(), false);
+    for (auto column : columns)
+    {
+        for (unsigned row = 0; row < input.size(); ++row)
+        {
+            if (!keep[row] && column->has(row))
+                keep[row] = true;
+        }
+    }
+
+    input.filter(keep);
+
+    return context;
+}
@@ -22,6 +22,7 @@
 #include <osgEarth/XmlUtils>
 #include <osgEarth/JsonUtils>
 #include <osgEarth/Progress>
+#include <osgEarth/ServiceMetadataCache>
 #include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
 #include <cstdlib>
@@ -31,6 +32,20 @@ using namespace osgEarth;
 #undef LC
 #define LC "[Bing] "
 
+// seconds to reuse an imagery set's URL template
+#define URL_TEMPLATE_MAX_AGE (12 * 60 * 60)
+
+namespace
+{
+    // Tile URLs from the metadata API, shared by all layers. The requests
+    // include the imagery set and API key, so layers can't collide.
+    LRUCache<std::string, std::string>* getSharedTileURICache()
+    {
+        static LRUCache<std::string, std::string> s_cache(true, 4096u);
+        return &s_cache;
+    }
+}
+
 //........................................................................
 
 Config
@@ -40,6 +55,7 @@ BingImageLayer::Options::getConfig() const
     conf.set("key", _apiKey);
     conf.set("imagery_set", _imagerySet);
     conf.set("imagery_metadata_api_url", _imageryMetadataURL);
+    conf.set("use_url_template", _useURLTemplate);
     return conf;
 }
 
@@ -48,10 +64,12 @@ BingImageLayer::Options::fromConfig(const Config& conf)
 {
     _imagerySet.init("Aerial");
     _imageryMetadataURL.init("https://dev.virtualearth.net/REST/v1/Imagery/Metadata");
+    _useURLTemplate.init(false);
 
     conf.get("key", _apiKey);
     conf.get("imagery_set", _imagerySet);
     conf.get("imagery_metadata_api_url", _imageryMetadataURL);
+    conf.get("use_url_template", _useURLTemplate);
 }
 
 
@@ -62,6 +80,7 @@ REGISTER_OSGEARTH_LAYER(bingimage, BingImageLayer);
 OE_LAYER_PROPERTY_IMPL(BingImageLayer, std::string, APIKey, apiKey);
 OE_LAYER_PROPERTY_IMPL(BingImageLayer, std::string, ImagerySet, imagerySet);
 OE_LAYER_PROPERTY_IMPL(BingImageLayer, URI, ImageryMetadataURL, imageryMetadataURL);
+OE_LAYER_PROPERTY_IMPL(BingImageLayer, bool, UseURLTemplate, useURLTemplate);
 
 void
 BingImageLayer::init()
@@ -69,7 +88,7 @@ BingImageLayer::init()
     ImageLayer::init();
 
     _debugDirect = false;
-    _tileURICache = new TileURICache(true, 1024u);
+    _tileURICache = getSharedTileURICache();
     
     if ( ::getenv("OSGEARTH_BING_DIRECT") )
         _debugDirect = true;
@@ -80,7 +99,7 @@ BingImageLayer::init()
 
 BingImageLayer::~BingImageLayer()
 {
-    delete _tileURICache;
+    //nop - the tile URI cache is shared
 }
 
 Status
@@ -107,16 +126,74 @@ BingImageLayer::openImplementation()
             MERC_MINX, MERC_MINY, MERC_MAXX, MERC_MAXY,
             2u, 2u));
 
+    if (options().useURLTemplate() == true && !_debugDirect)
+    {
+        Status status = readURLTemplate();
+        if (status.isError())
+            return status;
+    }
+
     return Status::NoError;
 }
 
 Status
 BingImageLayer::closeImplementation()
 {
-    _tileURICache->clear();
+    _urlTemplate.clear();
+    _urlSubdomains.clear();
     return ImageLayer::closeImplementation();
 }
 
+Status
+BingImageLayer::readURLTemplate()
+{
+    // Imagery metadata without a location returns the imagery set's
+    // tile URL template. Docs are here:
+    // https://docs.microsoft.com/en-us/bingmaps/rest-services/imagery/get-imagery-metadata
+    URI request(Stringify()
+        << options().imageryMetadataURL()->full()
+        << "/" << options().imagerySet().get()
+        << "?uriScheme=https"
+        << "&o=json"
+        << "&key=" << _key);
+
+    ReadResult r = ServiceMetadataCache::readString(
+        request, URL_TEMPLATE_MAX_AGE, getCacheSettings(), getReadOptions());
+
+    if (r.failed())
+    {
+        return Status(Status::ResourceUnavailable, "Bing: imagery metadata request failed");
+    }
+
+    Json::FastReader reader;
+    Json::Value metadata;
+    if (!reader.parse(r.getString(), metadata))
+    {
+        ServiceMetadataCache::remove(request, getCacheSettings());
+        return Status(Status::ResourceUnavailable, "Bing: Error decoding REST API response");
+    }
+
+    const Json::Value& imageUrl = Json::Path(".resourceSets[0].resources[0].imageUrl").resolve(metadata);
+    if (imageUrl.empty())
+    {
+        ServiceMetadataCache::remove(request, getCacheSettings());
+        return Status(Status::ResourceUnavailable, "Bing: REST API JSON parsing error (imageUrl not found)");
+    }
+
+    _urlTemplate = imageUrl.asString();
+
+    _urlSubdomains.clear();
+    const Json::Value& subdomains = Json::Path(".resourceSets[0].resources[0].imageUrlSubdomains").resolve(metadata);
+    for (Json::ValueConstIterator i = subdomains.begin(); i != subdomains.end(); ++i)
+    {
+        _urlSubdomains.push_back((*i).asString());
+    }
+
+    OE_DEBUG << LC << "URL template = " << _urlTemplate << std::endl;
+
+    return Status::NoError;
+}
+
 GeoImage
 BingImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
 {
@@ -128,31 +205,14 @@ BingImageLayer::createImageImplementation(const TileKey& key, ProgressCallback*
         image = URI(getDirectURI(key)).getImage(getReadOptions(), progress);
     }
 
+    else if (!_urlTemplate.empty())
+    {
+        image = URI(getTemplateURI(key)).getImage(getReadOptions(), progress);
+    }
+
     else
     {
-        // center point of the tile (will be in spherical mercator)
-        double x, y;
-        key.getExtent().getCentroid(x, y);
-
-        // transform it to lat/long:
-        GeoPoint geo;
-
-        GeoPoint(getProfile()->getSRS(), x, y).transform(
-            getProfile()->getSRS()->getGeographicSRS(),
-            geo);
-
-        // contact the REST API. Docs are here:
-        // http://msdn.microsoft.com/en-us/library/ff701716.aspx
-
-        // construct the request URI:
-        std::string request = Stringify()
-            << std::setprecision(12)
-            << options().imageryMetadataURL()->full()  // base REST API
-            << "/" << options().imagerySet().get()     // imagery set to use
-            << "/" << geo.y() << "," << geo.x()        // center point in lat/long
-            << "?zl=" << key.getLOD() + 1              // zoom level
-            << "&o=json"                               // response format
-            << "&key=" << _key;                        // API key
+        std::string request = getMetadataRequest(key);
 
         // check the URI cache.
         URI                  location;
@@ -186,7 +246,7 @@ BingImageLayer::createImageImplementation(const TileKey& key, ProgressCallback*
                 return GeoImage::INVALID;
             }
 
-            Json::Reader reader;
+            Json::FastReader reader;
 
             Json::Value metadata;
             if (!reader.parse(metadataResult.getString(), metadata))
@@ -220,6 +280,70 @@ BingImageLayer::createImageImplementation(const TileKey& key, ProgressCallback*
     return GeoImage(image.get(), key.getExtent());
 }
 
+bool
+BingImageLayer::createImageImplementationAsync(const TileKey& key,
+                                               const std::function<void(const GeoImage&)>& onComplete,
+                                               ProgressCallback* progress) const
+{
+    URI location;
+
+    if (_debugDirect)
+    {
+        ++_apiCount;
+        location = URI(getDirectURI(key));
+    }
+    else if (!_urlTemplate.empty())
+    {
+        location = URI(getTemplateURI(key));
+    }
+    else
+    {
+        // Only the tile itself is fetched asynchronously. A metadata miss
+        // takes the blocking path, which queries the REST API first.
+        TileURICache::Record rec;
+        if (!_tileURICache->get(getMetadataRequest(key), rec))
+            return false;
+
+        location = URI(rec.value());
+    }
+
+    location.readImageAsync(getReadOptions(), progress,
+        [key, onComplete](const ReadResult& r)
+        {
+            onComplete(GeoImage(r.getImage(), key.getExtent()));
+        });
+
+    return true;
+}
+
+std::string
+BingImageLayer::getMetadataRequest(const TileKey& key) const
+{
+    // center point of the tile (will be in spherical mercator)
+    double x, y;
+    key.getExtent().getCentroid(x, y);
+
+    // transform it to lat/long:
+    GeoPoint geo;
+
+    GeoPoint(getProfile()->getSRS(), x, y).transform(
+        getProfile()->getSRS()->getGeographicSRS(),
+        geo);
+
+    // contact the REST API. Docs are here:
+    // http://msdn.microsoft.com/en-us/library/ff701716.aspx
+
+    // construct the request URI:
+    return Stringify()
+        << std::setprecision(12)
+        << options().imageryMetadataURL()->full()  // base REST API
+        << "/" << options().imagerySet().get()     // imagery set to use
+        << "/" << geo.y() << "," << geo.x()        // center point in lat/long
+        << "?zl=" << key.getLOD() + 1              // zoom level
+        << "&o=json"                               // response format
+        << "&key=" << _key;                        // API key
+}
+
 std::string
 BingImageLayer::getQuadKey(const TileKey& key) const
 {
@@ -256,6 +380,25 @@ BingImageLayer::getDirectURI(const TileKey& key) const
         << ".jpeg?g=1236";
 }
 
+std::string
+BingImageLayer::getTemplateURI(const TileKey& key) const
+{
+    std::string quadKey = getQuadKey(key);
+
+    std::string uri = _urlTemplate;
+    replaceIn(uri, "{quadkey}", quadKey);
+    replaceIn(uri, "{culture}", "en-US");
+
+    if (!_urlSubdomains.empty())
+    {
+        // spread the load the same way for every session
+        unsigned i = hashString(quadKey) % _urlSubdomains.size();
+        replaceIn(uri, "{subdomain}", _urlSubdomains[i]);
+    }
+
+    return uri;
+}
+
 //........................................................................
 
 Config
@@ -369,8 +512,8 @@ BingElevationLayer::createHeightFieldImplementation(const TileKey& key, Progress
 
     Json::Value response;
 
-    Json::Reader reader;
-    if (!reader.parse(result.getString(), response, false))
+    Json::FastReader reader;
+    if (!reader.parse(result.getString(), response))
     {
         return Status("Bing response: Invalid JSON in response");
     }
@@ -18,6 +18,7 @@
  */
 #include <osgEarth/BufferFilter>
 #include <osgEarth/FilterContext>
+#include <osgEarth/GeometryIndex>
 
 #define LC "[BufferFilter] "
 
@@ -84,34 +85,52 @@ BufferFilter::push( FeatureList& input, FilterContext& context )
         return context;
     }
 
-    //OE_NOTICE << "Buffer: input = " << input.size() << " features" << std::endl;
-    for( FeatureList::iterator i = input.begin(); i != input.end(); )
-    {
-        Feature* feature = i->get();
-        if ( !feature || !feature->getGeometry() )
-            continue;
+    BufferParameters params;
+
+    params._capStyle =
+            _capStyle == Stroke::LINECAP_ROUND  ? BufferParameters::CAP_ROUND :
+            _capStyle == Stroke::LINECAP_SQUARE ? BufferParameters::CAP_SQUARE :
+            _capStyle == Stroke::LINECAP_FLAT   ? BufferParameters::CAP_FLAT :
+                                                  BufferParameters::CAP_SQUARE;
+
+    params._cornerSegs = _numQuadSegs;
+
+    double distance = _distance.value();
 
-        osg::ref_ptr<Geometry> output;
+    // Each feature buffers on its own, so spread them over the GEOS
+    // arena; every thread works in its own GEOS context.
+    std::vector<Feature*> features;
+    features.reserve(input.size());
+    for (auto& feature : input)
+        features.push_back(feature.get());
 
-        BufferParameters params;
-        
-        params._capStyle =
-                _capStyle == Stroke::LINECAP_ROUND  ? BufferParameters::CAP_ROUND :
-                _capStyle == Stroke::LINECAP_SQUARE ? BufferParameters::CAP_SQUARE :
-                _capStyle == Stroke::LINECAP_FLAT   ? BufferParameters::CAP_FLAT :
-                                                      BufferParameters::CAP_SQUARE;
+    std::vector<osg::ref_ptr<Geometry> > outputs(features.size());
 
-        params._cornerSegs = _numQuadSegs;
+    GeometryIndex::parallelFor(features.size(), [&](unsigned i)
+    {
+        Feature* feature = features[i];
+        if (feature && feature->getGeometry())
+        {
+            feature->getGeometry()->buffer(distance, outputs[i], params);
+        }
+    });
 
-        if ( feature->getGeometry()->buffer( _distance.value(), output, params ) )
+    unsigned i = 0;
+    for( FeatureList::iterator f = input.begin(); f != input.end(); ++i )
+    {
+        Feature* feature = f->get();
+        if ( outputs[i].valid() )
         {
-            feature->setGeometry( output.get() );
-            ++i;
+            feature->setGeometry( outputs[i].get() );
+            ++f;
         }
         else
         {
-            i = input.erase( i );
-            OE_DEBUG << LC << "feature " << feature->getFID() << " yielded no geometry" << std::endl;
+            if ( feature )
+            {
+                OE_DEBUG << LC << "feature " << feature->getFID() << " yielded no geometry" << std::endl;
+            }
+            f = input.erase( f );
         }
     }
 
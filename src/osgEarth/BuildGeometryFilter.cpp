@@ -974,7 +974,6 @@ BuildGeometryFilter::tileAndBuildPolygon(
         // for geographic data we need to project into 2D before tessellating:
         if (outputSRS->isGeographic())
         {
-            osg::Vec3d temp;
             osg::BoundingBoxd ecef_bb;
 
             bool allOnEquator = true;
@@ -983,14 +982,17 @@ BuildGeometryFilter::tileAndBuildPolygon(
             {
                 Geometry* part = xform_iter.next();
                 part->open();
-                for (osg::Vec3d& p : *part)
+                inputSRS->transform(part->asVector(), outputSRS);
+                for (const osg::Vec3d& p : *part)
                 {
-                    inputSRS->transform(p, outputSRS, temp);
-                    if (temp.y() != 0.0)
+                    if (p.y() != 0.0)
                     {
                         allOnEquator = false;
                     }
-                    outputSRS->transformToWorld(temp, p);
+                }
+                outputSRS->transformToWorld(part->asVector());
+                for (const osg::Vec3d& p : *part)
+                {
                     ecef_bb.expandBy(p);
                 }
             }
@@ -1038,20 +1040,19 @@ BuildGeometryFilter::tileAndBuildPolygon(
 
     int offset = verts->size();
 
-    osg::Vec3d temp, vert;
-
     if (outputSRS && outputSRS->isGeographic())
     {
+        std::vector<osg::Vec3d> world;
         ConstGeometryIterator verts_iter(input, true);
         while (verts_iter.hasMore())
         {
             const Geometry* part = verts_iter.next();
-            for (const auto& p : *part)
+            world.assign(part->begin(), part->end());
+            inputSRS->transform(world, outputSRS);
+            outputSRS->transformToWorld(world);
+            for (const auto& p : world)
             {
-                inputSRS->transform(p, outputSRS, temp);
-                outputSRS->transformToWorld(temp, vert);
-                vert = vert * world2local;
-                verts->push_back(vert);
+                verts->push_back(p * world2local);
             }
         }
     }
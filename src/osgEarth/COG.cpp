@@ -0,0 +1,1370 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "COG"
+#include <osgEarth/Registry>
+#include <osgEarth/HTTPClient>
+#include <osgEarth/Threading>
+#include <osgEarth/StringUtils>
+#include <osgDB/Registry>
+#include <osgDB/ObjectWrapper>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace osgEarth;
+using namespace osgEarth::COG;
+
+#undef LC
+#define LC "[COG] "
+
+// bytes to read up front; a COG keeps its IFDs at the start of the file
+#define COG_HEADER_SIZE 16384
+
+// decoded blocks to keep around for neighboring tiles
+#define COG_BLOCK_CACHE_SIZE 256
+
+//............................................................................
+
+namespace
+{
+    enum Tag
+    {
+        TAG_NEW_SUBFILE_TYPE    = 254,
+        TAG_IMAGE_WIDTH         = 256,
+        TAG_IMAGE_LENGTH        = 257,
+        TAG_BITS_PER_SAMPLE     = 258,
+        TAG_COMPRESSION         = 259,
+        TAG_PHOTOMETRIC         = 262,
+        TAG_SAMPLES_PER_PIXEL   = 277,
+        TAG_PLANAR_CONFIG       = 284,
+        TAG_PREDICTOR           = 317,
+        TAG_TILE_WIDTH          = 322,
+        TAG_TILE_LENGTH         = 323,
+        TAG_TILE_OFFSETS        = 324,
+        TAG_TILE_BYTE_COUNTS    = 325,
+        TAG_SAMPLE_FORMAT       = 339,
+        TAG_JPEG_TABLES         = 347,
+        TAG_MODEL_PIXEL_SCALE   = 33550,
+        TAG_MODEL_TIEPOINT      = 33922,
+        TAG_MODEL_TRANSFORM     = 34264,
+        TAG_GEO_KEY_DIRECTORY   = 34735,
+        TAG_GDAL_NODATA         = 42113
+    };
+
+    enum Compression
+    {
+        COMPRESSION_NONE        = 1,
+        COMPRESSION_LZW         = 5,
+        COMPRESSION_JPEG        = 7,
+        COMPRESSION_DEFLATE     = 8,
+        COMPRESSION_ADOBE_DEFLATE = 32946
+    };
+
+    enum SampleFormat
+    {
+        SAMPLE_UINT  = 1,
+        SAMPLE_INT   = 2,
+        SAMPLE_FLOAT = 3
+    };
+
+    bool hostIsLittleEndian()
+    {
+        const unsigned short one = 1u;
+        return *(const unsigned char*)&one == 1u;
+    }
+
+    // Reads integers out of a buffer in the file's byte order
+    struct Bytes
+    {
+        const std::string& _buf;
+        bool _le;
+
+        Bytes(const std::string& buf, bool le) : _buf(buf), _le(le) { }
+
+        bool has(unsigned long long offset, unsigned long long length) const {
+            return offset + length <= _buf.size();
+        }
+
+        unsigned long long get(unsigned long long offset, unsigned size) const {
+            const unsigned char* p = (const unsigned char*)_buf.data() + offset;
+            unsigned long long v = 0;
+            for (unsigned i = 0; i < size; ++i)
+                v |= (unsigned long long)p[_le ? i : size - 1 - i] << (8 * i);
+            return v;
+        }
+
+        unsigned short u16(unsigned long long offset) const { return (unsigned short)get(offset, 2); }
+        unsigned u32(unsigned long long offset) const { return (unsigned)get(offset, 4); }
+        unsigned long long u64(unsigned long long offset) const { return get(offset, 8); }
+        double f64(unsigned long long offset) const {
+            unsigned long long bits = get(offset, 8);
+            double d;
+            ::memcpy(&d, &bits, 8);
+            return d;
+        }
+    };
+
+    // Size in bytes of one value of a TIFF field type
+    unsigned fieldTypeSize(unsigned type)
+    {
+        switch (type)
+        {
+        case 1: case 2: case 6: case 7: return 1;   // BYTE, ASCII, SBYTE, UNDEFINED
+        case 3: case 8: return 2;                   // SHORT, SSHORT
+        case 4: case 9: case 11: case 13: return 4; // LONG, SLONG, FLOAT, IFD
+        case 5: case 10: case 12: return 8;         // RATIONAL, SRATIONAL, DOUBLE
+        case 16: case 17: case 18: return 8;        // LONG8, SLONG8, IFD8
+        default: return 0;
+        }
+    }
+
+    // One IFD entry with its values resolved
+    struct Field
+    {
+        unsigned type;
+        unsigned long long count;
+        std::string data; // raw values in file byte order
+    };
+
+    typedef std::map<unsigned, Field> Fields;
+
+    // Reads the i'th value of an integer field
+    unsigned long long fieldInt(const Field& f, const Bytes& b, unsigned i)
+    {
+        unsigned size = fieldTypeSize(f.type);
+        Bytes fb(f.data, b._le);
+        return i < f.count && fb.has((unsigned long long)i*size, size) ? fb.get((unsigned long long)i*size, size) : 0ull;
+    }
+
+    bool getInt(const Fields& fields, unsigned tag, const Bytes& b, unsigned long long& out)
+    {
+        Fields::const_iterator i = fields.find(tag);
+        if (i == fields.end() || i->second.count == 0)
+            return false;
+        out = fieldInt(i->second, b, 0);
+        return true;
+    }
+
+    void getDoubles(const Fields& fields, unsigned tag, const Bytes& b, std::vector<double>& out)
+    {
+        out.clear();
+        Fields::const_iterator i = fields.find(tag);
+        if (i == fields.end() || i->second.type != 12)
+            return;
+        Bytes fb(i->second.data, b._le);
+        for (unsigned long long k = 0; k < i->second.count; ++k)
+            out.push_back(fb.f64(k * 8));
+    }
+
+    //! TIFF-flavored LZW: MSB-first codes, 9 to 12 bits, and the code
+    //! width grows one code early.
+    bool decodeLZW(const unsigned char* in, std::size_t inLength, std::vector<unsigned char>& out)
+    {
+        const unsigned CLEAR = 256u, EOI = 257u;
+
+        unsigned short prefix[4096];
+        unsigned char suffix[4096];
+        unsigned char first[4096];
+        unsigned short length[4096];
+
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            prefix[i] = 0xFFFF;
+            suffix[i] = first[i] = (unsigned char)i;
+            length[i] = 1;
+        }
+
+        unsigned next = 258u, width = 9u;
+        int old = -1;
+        std::size_t pos = 0;
+
+        unsigned long long bits = 0ull;
+        unsigned numBits = 0u;
+        std::size_t inPos = 0;
+
+        // writes the string for a code, clipped to the output block
+        auto emit = [&](unsigned code)
+        {
+            unsigned len = length[code];
+            std::size_t end = pos + len;
+            unsigned c = code;
+            for (std::size_t k = end; k > pos; --k)
+            {
+                if (k - 1 < out.size())
+                    out[k - 1] = suffix[c];
+                c = prefix[c];
+            }
+            pos = end;
+        };
+
+        auto add = [&](unsigned p, unsigned char ch)
+        {
+            if (next < 4096u)
+            {
+                prefix[next] = (unsigned short)p;
+                suffix[next] = ch;
+                first[next] = first[p];
+                length[next] = (unsigned short)std::min(length[p] + 1u, 0xFFFFu);
+                ++next;
+            }
+            if (next >= (1u << width) - 1u && width < 12u)
+                ++width;
+        };
+
+        while (pos < out.size())
+        {
+            while (numBits < width && inPos < inLength)
+            {
+                bits = (bits << 8) | in[inPos++];
+                numBits += 8u;
+            }
+            if (numBits < width)
+                break;
+
+            unsigned code = (unsigned)(bits >> (numBits - width)) & ((1u << width) - 1u);
+            numBits -= width;
+
+            if (code == EOI)
+                break;
+
+            if (code == CLEAR)
+            {
+                next = 258u;
+                width = 9u;
+                old = -1;
+                continue;
+            }
+
+            if (old < 0)
+            {
+                if (code >= 256u)
+                    return false;
+                emit(code);
+            }
+            else if (code < next)
+            {
+                emit(code);
+                add((unsigned)old, first[code]);
+            }
+            else if (code == next)
+            {
+                add((unsigned)old, first[old]);
+                emit(code);
+            }
+            else
+            {
+                return false;
+            }
+            old = (int)code;
+        }
+
+        return pos > 0;
+    }
+
+    //! Undoes horizontal differencing (predictor 2), in host order
+    template<typename T>
+    void undoHorizontalPredictor(unsigned char* data, unsigned width, unsigned height, unsigned spp)
+    {
+        for (unsigned r = 0; r < height; ++r)
+        {
+            T* row = (T*)(data + (std::size_t)r * width * spp * sizeof(T));
+            for (unsigned i = spp; i < width * spp; ++i)
+                row[i] = (T)(row[i] + row[i - spp]);
+        }
+    }
+
+    //! Undoes floating-point prediction (predictor 3). Each row holds the
+    //! bytes of its samples split into planes, most significant first,
+    //! and differenced; this writes them back as host-order samples.
+    void undoFloatPredictor(unsigned char* data, unsigned width, unsigned height, unsigned spp, unsigned bytesPerSample)
+    {
+        const std::size_t wc = (std::size_t)width * spp;
+        const std::size_t rowBytes = wc * bytesPerSample;
+        const bool le = hostIsLittleEndian();
+        std::vector<unsigned char> tmp(rowBytes);
+
+        for (unsigned r = 0; r < height; ++r)
+        {
+            unsigned char* row = data + r * rowBytes;
+            for (std::size_t i = spp; i < rowBytes; ++i)
+                row[i] = (unsigned char)(row[i] + row[i - spp]);
+
+            ::memcpy(tmp.data(), row, rowBytes);
+            for (std::size_t k = 0; k < wc; ++k)
+            {
+                for (unsigned b = 0; b < bytesPerSample; ++b)
+                {
+                    unsigned plane = le ? bytesPerSample - 1 - b : b;
+                    row[k * bytesPerSample + b] = tmp[plane * wc + k];
+                }
+            }
+        }
+    }
+
+    void swapBytes(unsigned char* data, std::size_t length, unsigned size)
+    {
+        for (std::size_t i = 0; i + size <= length; i += size)
+            std::reverse(data + i, data + i + size);
+    }
+
+    //! Reads one sample as a double, from host-order data
+    double sampleValue(const unsigned char* p, unsigned bits, unsigned format)
+    {
+        if (format == SAMPLE_FLOAT)
+        {
+            if (bits == 32) { float v; ::memcpy(&v, p, 4); return v; }
+            if (bits == 64) { double v; ::memcpy(&v, p, 8); return v; }
+        }
+        else if (format == SAMPLE_INT)
+        {
+            if (bits == 8) return *(const signed char*)p;
+            if (bits == 16) { short v; ::memcpy(&v, p, 2); return v; }
+            if (bits == 32) { int v; ::memcpy(&v, p, 4); return v; }
+        }
+        else
+        {
+            if (bits == 8) return *p;
+            if (bits == 16) { unsigned short v; ::memcpy(&v, p, 2); return v; }
+            if (bits == 32) { unsigned v; ::memcpy(&v, p, 4); return v; }
+        }
+        return 0.0;
+    }
+
+    //! Blocks of one level covering a pixel window, for sampling
+    struct Window
+    {
+        const Driver::Level* _level;
+        int _bx0, _by0, _across;
+        std::vector<Driver::Block> _blocks;
+        optional<double> _noData;
+
+        //! Sample at a pixel; false if it's outside the data or no-data
+        bool get(int x, int y, unsigned band, double& out) const
+        {
+            if (x < 0 || y < 0 || x >= (int)_level->width || y >= (int)_level->height)
+                return false;
+
+            int bx = x / (int)_level->tileWidth - _bx0;
+            int by = y / (int)_level->tileHeight - _by0;
+            const Driver::Block& block = _blocks[by * _across + bx];
+            if (!block)
+                return false;
+
+            unsigned bps = _level->bytesPerSample();
+            std::size_t offset =
+                (((std::size_t)(y % _level->tileHeight) * _level->tileWidth + (x % _level->tileWidth))
+                * _level->samplesPerPixel + band) * bps;
+
+            out = sampleValue(block->data() + offset, _level->bitsPerSample, _level->sampleFormat);
+
+            return !_noData.isSet() || out != _noData.get();
+        }
+    };
+}
+
+//............................................................................
+
+Driver::Driver() :
+    _swap(false),
+    _maxRangeGap(16384u),
+    _originX(0.0), _originY(0.0),
+    _resX(1.0), _resY(1.0),
+    _blockCache(true, COG_BLOCK_CACHE_SIZE)
+{
+    //nop
+}
+
+unsigned
+Driver::getSamplesPerPixel() const
+{
+    return _levels.empty() ? 0u : _levels.front().samplesPerPixel;
+}
+
+unsigned
+Driver::getBitsPerSample() const
+{
+    return _levels.empty() ? 0u : _levels.front().bitsPerSample;
+}
+
+bool
+Driver::readRanges(std::vector<Range>& ranges, ProgressCallback* progress) const
+{
+    if (ranges.empty())
+        return true;
+
+    if (!_uri.isRemote())
+    {
+        std::ifstream in(_uri.full().c_str(), std::ios::binary);
+        if (!in.is_open())
+            return false;
+
+        for (auto& range : ranges)
+        {
+            range.data.resize(range.length);
+            in.seekg(range.offset);
+            in.read(&range.data[0], range.length);
+            range.data.resize((std::size_t)std::max((std::streamsize)0, in.gcount()));
+            in.clear();
+        }
+        return true;
+    }
+
+    // Issue every range at once and wait for them all
+    struct State
+    {
+        State() : _mutex("OE.COG.Ranges") { }
+        std::atomic<unsigned> _pending;
+        std::atomic<bool> _ok;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _done;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->_pending = (unsigned)ranges.size();
+    state->_ok = true;
+
+    for (auto& range : ranges)
+    {
+        HTTPRequest request(_uri.full());
+        request.addHeader("Range", Stringify()
+            << "bytes=" << range.offset << "-" << (range.offset + range.length - 1));
+
+        Range* target = &range;
+
+        HTTPClient::getAsync(request, _readOptions.get(), progress,
+            [state, target](const HTTPResponse& response)
+            {
+                if (response.getCode() == 206 && response.getNumParts() > 0)
+                {
+                    target->data = response.getPartAsString(0);
+                }
+                else if (response.getCode() == 200 && response.getNumParts() > 0)
+                {
+                    // server ignored the range and sent the whole file
+                    std::string all = response.getPartAsString(0);
+                    if (target->offset < all.size())
+                        target->data = all.substr(target->offset, target->length);
+                }
+                else
+                {
+                    state->_ok = false;
+                }
+
+                Threading::ScopedMutexLock lock(state->_mutex);
+                if (--state->_pending == 0u)
+                    state->_done.notify_all();
+            });
+    }
+
+    Threading::ScopedMutexLock lock(state->_mutex);
+    while (state->_pending > 0u)
+        state->_done.wait(state->_mutex);
+
+    return state->_ok;
+}
+
+Status
+Driver::open(const URI& uri,
+             unsigned maxRangeGap,
+             const osgDB::Options* readOptions)
+{
+    if (uri.empty())
+    {
+        return Status::Error(Status::ConfigurationError, "Valid URL is missing");
+    }
+
+    _uri = uri;
+    _maxRangeGap = maxRangeGap;
+    _readOptions = readOptions;
+    _levels.clear();
+    _blockCache.clear();
+
+    std::vector<Range> header(1);
+    header[0].offset = 0;
+    header[0].length = COG_HEADER_SIZE;
+    if (!readRanges(header, nullptr) || header[0].data.size() < 8)
+    {
+        return Status::Error(Status::ResourceUnavailable, Stringify() << "Failed to read " << uri.full());
+    }
+
+    std::string buf;
+    buf.swap(header[0].data);
+
+    bool le;
+    if (buf[0] == 'I' && buf[1] == 'I') le = true;
+    else if (buf[0] == 'M' && buf[1] == 'M') le = false;
+    else return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " is not a TIFF");
+
+    _swap = (le != hostIsLittleEndian());
+
+    Bytes b(buf, le);
+    unsigned version = b.u16(2);
+    bool big = (version == 43);
+    if (version != 42 && !big)
+    {
+        return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " is not a TIFF");
+    }
+
+    // reads bytes that may lie past the header we already have
+    auto fetch = [&](unsigned long long offset, unsigned long long length, std::string& out) -> bool
+    {
+        if (b.has(offset, length))
+        {
+            out.assign(buf, (std::size_t)offset, (std::size_t)length);
+            return true;
+        }
+        std::vector<Range> r(1);
+        r[0].offset = offset;
+        r[0].length = length;
+        if (!readRanges(r, nullptr) || r[0].data.size() < length)
+            return false;
+        out.swap(r[0].data);
+        return true;
+    };
+
+    unsigned long long ifdOffset = big ? b.u64(8) : b.u32(4);
+    const unsigned countSize = big ? 8u : 2u;
+    const unsigned entrySize = big ? 20u : 12u;
+    const unsigned inlineSize = big ? 8u : 4u;
+
+    Fields geoFields;
+
+    for (unsigned ifdIndex = 0; ifdOffset != 0 && ifdIndex < 64; ++ifdIndex)
+    {
+        std::string countBytes;
+        if (!fetch(ifdOffset, countSize, countBytes))
+            break;
+        Bytes cb(countBytes, le);
+        unsigned long long numEntries = cb.get(0, countSize);
+
+        std::string ifd;
+        if (!fetch(ifdOffset + countSize, numEntries * entrySize + inlineSize, ifd))
+            break;
+        Bytes ib(ifd, le);
+
+        Fields fields;
+        for (unsigned long long e = 0; e < numEntries; ++e)
+        {
+            unsigned long long p = e * entrySize;
+            Field f;
+            unsigned tag = ib.u16(p);
+            f.type = ib.u16(p + 2);
+            f.count = big ? ib.u64(p + 4) : ib.u32(p + 4);
+            unsigned long long valueOffset = p + (big ? 12 : 8);
+            unsigned long long size = f.count * fieldTypeSize(f.type);
+
+            if (size <= inlineSize)
+            {
+                f.data.assign(ifd, (std::size_t)valueOffset, (std::size_t)size);
+            }
+            else
+            {
+                unsigned long long where = big ? ib.u64(valueOffset) : ib.u32(valueOffset);
+                if (!fetch(where, size, f.data))
+                    continue;
+            }
+            fields[tag] = f;
+        }
+
+        ifdOffset = big ? ib.u64(numEntries * entrySize) : ib.u32(numEntries * entrySize);
+
+        // skip masks; they have nothing we draw
+        unsigned long long subfileType = 0;
+        if (getInt(fields, TAG_NEW_SUBFILE_TYPE, b, subfileType) && (subfileType & 4u) != 0)
+            continue;
+
+        unsigned long long v;
+        Level level;
+        level.width = getInt(fields, TAG_IMAGE_WIDTH, b, v) ? (unsigned)v : 0u;
+        level.height = getInt(fields, TAG_IMAGE_LENGTH, b, v) ? (unsigned)v : 0u;
+        level.tileWidth = getInt(fields, TAG_TILE_WIDTH, b, v) ? (unsigned)v : 0u;
+        level.tileHeight = getInt(fields, TAG_TILE_LENGTH, b, v) ? (unsigned)v : 0u;
+        level.bitsPerSample = getInt(fields, TAG_BITS_PER_SAMPLE, b, v) ? (unsigned)v : 1u;
+        level.samplesPerPixel = getInt(fields, TAG_SAMPLES_PER_PIXEL, b, v) ? (unsigned)v : 1u;
+        level.sampleFormat = getInt(fields, TAG_SAMPLE_FORMAT, b, v) ? (unsigned)v : (unsigned)SAMPLE_UINT;
+        level.compression = getInt(fields, TAG_COMPRESSION, b, v) ? (unsigned)v : (unsigned)COMPRESSION_NONE;
+        level.predictor = getInt(fields, TAG_PREDICTOR, b, v) ? (unsigned)v : 1u;
+        level.photometric = getInt(fields, TAG_PHOTOMETRIC, b, v) ? (unsigned)v : 1u;
+        unsigned planar = getInt(fields, TAG_PLANAR_CONFIG, b, v) ? (unsigned)v : 1u;
+
+        if (level.width == 0u || level.height == 0u)
+            continue;
+
+        if (level.tileWidth == 0u || level.tileHeight == 0u)
+        {
+            return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " is not tiled");
+        }
+
+        if (planar != 1u)
+        {
+            return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " has separate sample planes, which are not supported");
+        }
+
+        if (level.bitsPerSample != 8u && level.bitsPerSample != 16u && level.bitsPerSample != 32u && level.bitsPerSample != 64u)
+        {
+            return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " has unsupported " << level.bitsPerSample << "-bit samples");
+        }
+
+        if (level.compression != COMPRESSION_NONE &&
+            level.compression != COMPRESSION_LZW &&
+            level.compression != COMPRESSION_JPEG &&
+            level.compression != COMPRESSION_DEFLATE &&
+            level.compression != COMPRESSION_ADOBE_DEFLATE)
+        {
+            return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " uses unsupported compression " << level.compression);
+        }
+
+        level.tilesAcross = (level.width + level.tileWidth - 1) / level.tileWidth;
+        level.tilesDown = (level.height + level.tileHeight - 1) / level.tileHeight;
+
+        Fields::const_iterator offsets = fields.find(TAG_TILE_OFFSETS);
+        Fields::const_iterator counts = fields.find(TAG_TILE_BYTE_COUNTS);
+        unsigned long long numTiles = (unsigned long long)level.tilesAcross * level.tilesDown;
+        if (offsets == fields.end() || counts == fields.end() ||
+            offsets->second.count < numTiles || counts->second.count < numTiles)
+        {
+            return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " has an incomplete tile index");
+        }
+
+        level.offsets.resize((std::size_t)numTiles);
+        level.byteCounts.resize((std::size_t)numTiles);
+        for (unsigned i = 0; i < numTiles; ++i)
+        {
+            level.offsets[i] = fieldInt(offsets->second, b, i);
+            level.byteCounts[i] = fieldInt(counts->second, b, i);
+        }
+
+        Fields::const_iterator tables = fields.find(TAG_JPEG_TABLES);
+        if (tables != fields.end())
+            level.jpegTables = tables->second.data;
+
+        // georeferencing and no-data live with the first image
+        if (_levels.empty())
+        {
+            geoFields = fields;
+        }
+
+        _levels.push_back(level);
+    }
+
+    if (_levels.empty())
+    {
+        return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " contains no usable images");
+    }
+
+    // finest first
+    std::stable_sort(_levels.begin(), _levels.end(),
+        [](const Level& lhs, const Level& rhs) { return lhs.width > rhs.width; });
+
+    const Level& full = _levels.front();
+
+    // Georeferencing
+    std::vector<double> scale, tiepoint, transform;
+    getDoubles(geoFields, TAG_MODEL_PIXEL_SCALE, b, scale);
+    getDoubles(geoFields, TAG_MODEL_TIEPOINT, b, tiepoint);
+    getDoubles(geoFields, TAG_MODEL_TRANSFORM, b, transform);
+
+    if (scale.size() >= 2 && tiepoint.size() >= 6)
+    {
+        _resX = scale[0];
+        _resY = scale[1];
+        _originX = tiepoint[3] - tiepoint[0] * _resX;
+        _originY = tiepoint[4] + tiepoint[1] * _resY;
+    }
+    else if (transform.size() >= 16 && transform[1] == 0.0 && transform[4] == 0.0)
+    {
+        _resX = transform[0];
+        _resY = -transform[5];
+        _originX = transform[3];
+        _originY = transform[7];
+    }
+    else
+    {
+        return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " is not georeferenced, or is rotated");
+    }
+
+    if (_resX <= 0.0 || _resY <= 0.0)
+    {
+        return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " has an unsupported pixel orientation");
+    }
+
+    unsigned modelType = 0u, rasterType = 1u, geographicType = 0u, projectedType = 0u;
+    Fields::const_iterator keys = geoFields.find(TAG_GEO_KEY_DIRECTORY);
+    if (keys != geoFields.end())
+    {
+        const Field& f = keys->second;
+        unsigned numKeys = (unsigned)fieldInt(f, b, 3);
+        for (unsigned k = 0; k < numKeys; ++k)
+        {
+            unsigned id = (unsigned)fieldInt(f, b, 4 + k * 4);
+            unsigned location = (unsigned)fieldInt(f, b, 4 + k * 4 + 1);
+            unsigned value = (unsigned)fieldInt(f, b, 4 + k * 4 + 3);
+            if (location != 0u)
+                continue;
+            if (id == 1024u) modelType = value;
+            else if (id == 1025u) rasterType = value;
+            else if (id == 2048u) geographicType = value;
+            else if (id == 3072u) projectedType = value;
+        }
+    }
+
+    // PixelIsPoint puts the tie point on the center of the first pixel
+    if (rasterType == 2u)
+    {
+        _originX -= 0.5 * _resX;
+        _originY += 0.5 * _resY;
+    }
+
+    std::string init;
+    if (projectedType != 0u && projectedType != 32767u)
+    {
+        if (projectedType == 3857u || projectedType == 3785u || projectedType == 900913u)
+            init = "spherical-mercator";
+        else
+            init = Stringify() << "epsg:" << projectedType;
+    }
+    else if (geographicType != 0u && geographicType != 32767u)
+    {
+        init = Stringify() << "epsg:" << geographicType;
+    }
+    else if (modelType == 2u)
+    {
+        init = "wgs84";
+    }
+    else
+    {
+        return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " has a user-defined coordinate system, which is not supported");
+    }
+
+    osg::ref_ptr<const SpatialReference> srs = SpatialReference::get(init);
+    if (!srs.valid())
+    {
+        return Status::Error(Status::ResourceUnavailable, Stringify() << uri.full() << " has an unknown coordinate system, " << init);
+    }
+
+    double xmin = _originX, xmax = _originX + _resX * full.width;
+    double ymax = _originY, ymin = _originY - _resY * full.height;
+
+    const Profile* geodetic = Registry::instance()->getGlobalGeodeticProfile();
+    const Profile* mercator = Registry::instance()->getSphericalMercatorProfile();
+
+    if (srs->isHorizEquivalentTo(geodetic->getSRS()))
+        _profile = geodetic;
+    else if (srs->isHorizEquivalentTo(mercator->getSRS()))
+        _profile = mercator;
+    else
+        _profile = Profile::create(srs.get(), xmin, ymin, xmax, ymax);
+
+    _extent = GeoExtent(_profile->getSRS(), xmin, ymin, xmax, ymax);
+
+    Fields::const_iterator noData = geoFields.find(TAG_GDAL_NODATA);
+    if (noData != geoFields.end())
+    {
+        std::string text = trim(std::string(noData->second.data.c_str()));
+        if (!text.empty())
+            _noData = as<double>(text, 0.0);
+    }
+
+    OE_INFO << LC << uri.full() << ": " << full.width << "x" << full.height
+        << ", " << _levels.size() << " level(s), " << init << std::endl;
+
+    return Status::NoError;
+}
+
+unsigned
+Driver::chooseLevel(double resolution) const
+{
+    // the coarsest level that is still at least as sharp as the target
+    const double fullWidth = (double)_levels.front().width;
+    unsigned best = 0u;
+    for (unsigned i = 1; i < _levels.size(); ++i)
+    {
+        double res = _resX * fullWidth / (double)_levels[i].width;
+        if (res <= resolution * 1.001)
+            best = i;
+    }
+    return best;
+}
+
+bool
+Driver::decodeBlock(const Level& level,
+                    const char* data,
+                    std::size_t length,
+                    std::vector<unsigned char>& out) const
+{
+    out.assign(level.blockBytes(), 0u);
+    bool samplesAreHostOrder = false;
+
+    if (level.compression == COMPRESSION_NONE)
+    {
+        ::memcpy(out.data(), data, std::min(length, out.size()));
+    }
+
+    else if (level.compression == COMPRESSION_LZW)
+    {
+        if (!decodeLZW((const unsigned char*)data, length, out))
+            return false;
+    }
+
+    else if (level.compression == COMPRESSION_DEFLATE || level.compression == COMPRESSION_ADOBE_DEFLATE)
+    {
+        osg::ref_ptr<osgDB::BaseCompressor> compressor =
+            osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+        if (!compressor.valid())
+            return false;
+
+        std::stringstream in(std::string(data, length));
+        std::string inflated;
+        if (!compressor->decompress(in, inflated))
+            return false;
+
+        ::memcpy(out.data(), inflated.data(), std::min(inflated.size(), out.size()));
+    }
+
+    else if (level.compression == COMPRESSION_JPEG)
+    {
+        if (level.bitsPerSample != 8u)
+            return false;
+
+        // an abbreviated JPEG stream: splice the shared tables in ahead of it
+        std::string stream;
+        if (level.jpegTables.size() > 4 && length > 2)
+        {
+            stream.assign(level.jpegTables, 0, level.jpegTables.size() - 2); // drop EOI
+            stream.append(data + 2, length - 2); // drop SOI
+        }
+        else
+        {
+            stream.assign(data, length);
+        }
+
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("jpg");
+        if (!rw)
+            return false;
+
+        std::stringstream in(stream);
+        osgDB::ReaderWriter::ReadResult r = rw->readImage(in, _readOptions.get());
+        if (!r.success() || !r.getImage())
+            return false;
+
+        const osg::Image* image = r.getImage();
+        unsigned components = osg::Image::computeNumComponents(image->getPixelFormat());
+        unsigned spp = level.samplesPerPixel;
+        unsigned cols = std::min((unsigned)image->s(), level.tileWidth);
+        unsigned rows = std::min((unsigned)image->t(), level.tileHeight);
+
+        // OSG images are bottom-up
+        for (unsigned row = 0; row < rows; ++row)
+        {
+            const unsigned char* src = image->data(0, image->t() - 1 - row);
+            unsigned char* dst = out.data() + (std::size_t)row * level.tileWidth * spp;
+            for (unsigned col = 0; col < cols; ++col)
+                for (unsigned c = 0; c < spp; ++c)
+                    dst[col * spp + c] = src[col * components + std::min(c, components - 1u)];
+        }
+        samplesAreHostOrder = true;
+    }
+
+    if (level.predictor == 3u && level.sampleFormat == SAMPLE_FLOAT)
+    {
+        undoFloatPredictor(out.data(), level.tileWidth, level.tileHeight, level.samplesPerPixel, level.bytesPerSample());
+        samplesAreHostOrder = true;
+    }
+
+    if (_swap && !samplesAreHostOrder && level.bytesPerSample() > 1u)
+    {
+        swapBytes(out.data(), out.size(), level.bytesPerSample());
+    }
+
+    if (level.predictor == 2u)
+    {
+        if (level.bitsPerSample == 8u)
+            undoHorizontalPredictor<unsigned char>(out.data(), level.tileWidth, level.tileHeight, level.samplesPerPixel);
+        else if (level.bitsPerSample == 16u)
+            undoHorizontalPredictor<unsigned short>(out.data(), level.tileWidth, level.tileHeight, level.samplesPerPixel);
+        else if (level.bitsPerSample == 32u)
+            undoHorizontalPredictor<unsigned>(out.data(), level.tileWidth, level.tileHeight, level.samplesPerPixel);
+    }
+
+    return true;
+}
+
+bool
+Driver::readBlocks(unsigned levelIndex,
+                   int bx0, int by0, int bx1, int by1,
+                   std::vector<Block>& out,
+                   ProgressCallback* progress) const
+{
+    const Level& level = _levels[levelIndex];
+    const int across = bx1 - bx0 + 1;
+
+    out.assign((std::size_t)across * (by1 - by0 + 1), Block());
+
+    // which blocks we still need, in file order
+    struct Need { unsigned slot; unsigned index; };
+    std::vector<Need> needs;
+
+    for (int by = by0; by <= by1; ++by)
+    {
+        for (int bx = bx0; bx <= bx1; ++bx)
+        {
+            unsigned index = by * level.tilesAcross + bx;
+            unsigned slot = (by - by0) * across + (bx - bx0);
+
+            // empty blocks in a sparse file have no data
+            if (level.byteCounts[index] == 0ull)
+                continue;
+
+            LRUCache<unsigned long long, Block>::Record rec;
+            if (_blockCache.get(((unsigned long long)levelIndex << 40) | index, rec))
+                out[slot] = rec.value();
+            else
+                needs.push_back(Need { slot, index });
+        }
+    }
+
+    if (needs.empty())
+        return true;
+
+    std::sort(needs.begin(), needs.end(),
+        [&level](const Need& lhs, const Need& rhs) { return level.offsets[lhs.index] < level.offsets[rhs.index]; });
+
+    // merge blocks that sit close together into one request
+    std::vector<Range> ranges;
+    std::vector<unsigned> rangeOf(needs.size());
+    for (unsigned i = 0; i < needs.size(); ++i)
+    {
+        unsigned long long offset = level.offsets[needs[i].index];
+        unsigned long long end = offset + level.byteCounts[needs[i].index];
+
+        if (!ranges.empty() && offset <= ranges.back().offset + ranges.back().length + _maxRangeGap)
+        {
+            Range& r = ranges.back();
+            r.length = std::max(r.offset + r.length, end) - r.offset;
+        }
+        else
+        {
+            Range r;
+            r.offset = offset;
+            r.length = end - offset;
+            ranges.push_back(r);
+        }
+        rangeOf[i] = (unsigned)ranges.size() - 1u;
+    }
+
+    if (!readRanges(ranges, progress))
+        return false;
+
+    if (progress && progress->isCanceled())
+        return false;
+
+    for (unsigned i = 0; i < needs.size(); ++i)
+    {
+        const Range& r = ranges[rangeOf[i]];
+        unsigned long long start = level.offsets[needs[i].index] - r.offset;
+        unsigned long long length = level.byteCounts[needs[i].index];
+        if (start + length > r.data.size())
+            continue;
+
+        std::shared_ptr<std::vector<unsigned char> > block = std::make_shared<std::vector<unsigned char> >();
+        if (!decodeBlock(level, r.data.data() + start, (std::size_t)length, *block))
+        {
+            OE_DEBUG << LC << "Failed to decode block " << needs[i].index << " of level " << levelIndex << std::endl;
+            continue;
+        }
+
+        out[needs[i].slot] = block;
+        _blockCache.insert(((unsigned long long)levelIndex << 40) | needs[i].index, block);
+    }
+
+    return true;
+}
+
+osg::Image*
+Driver::createImage(const GeoExtent& extent,
+                    unsigned tileSize,
+                    bool bilinear,
+                    ProgressCallback* progress) const
+{
+    if (_levels.empty() || tileSize == 0u || !extent.intersects(_extent))
+        return 0L;
+
+    const double dx = extent.width() / (double)tileSize;
+    const double dy = extent.height() / (double)tileSize;
+
+    unsigned levelIndex = chooseLevel(osg::minimum(dx, dy));
+    const Level& level = _levels[levelIndex];
+    const double resX = _resX * (double)_levels.front().width / (double)level.width;
+    const double resY = _resY * (double)_levels.front().height / (double)level.height;
+
+    // pixel window covering the tile, in continuous pixel-center coordinates
+    double px0 = (extent.xMin() + 0.5*dx - _originX) / resX - 0.5;
+    double px1 = (extent.xMax() - 0.5*dx - _originX) / resX - 0.5;
+    double py0 = (_originY - (extent.yMax() - 0.5*dy)) / resY - 0.5;
+    double py1 = (_originY - (extent.yMin() + 0.5*dy)) / resY - 0.5;
+
+    int x0 = osg::clampBetween((int)floor(px0), 0, (int)level.width - 1);
+    int x1 = osg::clampBetween((int)floor(px1) + 1, 0, (int)level.width - 1);
+    int y0 = osg::clampBetween((int)floor(py0), 0, (int)level.height - 1);
+    int y1 = osg::clampBetween((int)floor(py1) + 1, 0, (int)level.height - 1);
+
+    Window window;
+    window._level = &level;
+    window._bx0 = x0 / (int)level.tileWidth;
+    window._by0 = y0 / (int)level.tileHeight;
+    window._across = x1 / (int)level.tileWidth - window._bx0 + 1;
+    window._noData = _noData;
+
+    if (!readBlocks(levelIndex, window._bx0, window._by0, x1 / (int)level.tileWidth, y1 / (int)level.tileHeight, window._blocks, progress))
+        return 0L;
+
+    // 16-bit imagery is scaled down to 8
+    const double scale = level.bitsPerSample == 16u ? 1.0 / 257.0 : 1.0;
+    const unsigned spp = level.samplesPerPixel;
+    const unsigned colorBands = spp >= 3u ? 3u : 1u;
+    const bool hasAlpha = (spp == 2u || spp >= 4u);
+
+    // every band of a pixel, or false if it has no data
+    auto pixel = [&](int x, int y, double* v) -> bool
+    {
+        unsigned valid = 0u;
+        for (unsigned c = 0; c < colorBands; ++c)
+            if (window.get(x, y, c, v[c])) ++valid;
+        if (valid == 0u)
+            return false;
+        if (hasAlpha)
+            window.get(x, y, spp == 2u ? 1u : 3u, v[3]);
+        else
+            v[3] = 255.0 / scale;
+        return true;
+    };
+
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(tileSize, tileSize, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    ::memset(image->data(), 0, image->getTotalSizeInBytes());
+
+    bool empty = true;
+
+    for (unsigned t = 0; t < tileSize; ++t)
+    {
+        // osg row 0 is the south edge
+        double y = extent.yMin() + (t + 0.5) * dy;
+        double py = (_originY - y) / resY - 0.5;
+
+        unsigned char* out = image->data(0, t);
+
+        for (unsigned s = 0; s < tileSize; ++s, out += 4)
+        {
+            double x = extent.xMin() + (s + 0.5) * dx;
+            double px = (x - _originX) / resX - 0.5;
+
+            double v[4];
+            bool ok = false;
+
+            if (bilinear)
+            {
+                int ix = (int)floor(px), iy = (int)floor(py);
+                double fx = px - ix, fy = py - iy;
+                double v00[4], v10[4], v01[4], v11[4];
+                if (pixel(ix, iy, v00) && pixel(ix + 1, iy, v10) && pixel(ix, iy + 1, v01) && pixel(ix + 1, iy + 1, v11))
+                {
+                    for (unsigned c = 0; c < 4; ++c)
+                    {
+                        v[c] =
+                            (v00[c] * (1.0 - fx) + v10[c] * fx) * (1.0 - fy) +
+                            (v01[c] * (1.0 - fx) + v11[c] * fx) * fy;
+                    }
+                    ok = true;
+                }
+            }
+
+            if (!ok)
+            {
+                ok = pixel((int)floor(px + 0.5), (int)floor(py + 0.5), v);
+            }
+
+            if (ok)
+            {
+                for (unsigned c = 0; c < 3; ++c)
+                    out[c] = (unsigned char)osg::clampBetween(v[colorBands == 3u ? c : 0u] * scale + 0.5, 0.0, 255.0);
+                out[3] = (unsigned char)osg::clampBetween(v[3] * scale + 0.5, 0.0, 255.0);
+                empty = false;
+            }
+        }
+    }
+
+    return empty ? 0L : image.release();
+}
+
+osg::HeightField*
+Driver::createHeightField(const GeoExtent& extent,
+                          unsigned tileSize,
+                          ProgressCallback* progress) const
+{
+    if (_levels.empty() || tileSize < 2u || !extent.intersects(_extent))
+        return 0L;
+
+    // heightfield samples sit on the tile corners
+    const double dx = extent.width() / (double)(tileSize - 1);
+    const double dy = extent.height() / (double)(tileSize - 1);
+
+    unsigned levelIndex = chooseLevel(osg::minimum(dx, dy));
+    const Level& level = _levels[levelIndex];
+    const double resX = _resX * (double)_levels.front().width / (double)level.width;
+    const double resY = _resY * (double)_levels.front().height / (double)level.height;
+
+    int x0 = osg::clampBetween((int)floor((extent.xMin() - _originX) / resX - 0.5), 0, (int)level.width - 1);
+    int x1 = osg::clampBetween((int)floor((extent.xMax() - _originX) / resX - 0.5) + 1, 0, (int)level.width - 1);
+    int y0 = osg::clampBetween((int)floor((_originY - extent.yMax()) / resY - 0.5), 0, (int)level.height - 1);
+    int y1 = osg::clampBetween((int)floor((_originY - extent.yMin()) / resY - 0.5) + 1, 0, (int)level.height - 1);
+
+    Window window;
+    window._level = &level;
+    window._bx0 = x0 / (int)level.tileWidth;
+    window._by0 = y0 / (int)level.tileHeight;
+    window._across = x1 / (int)level.tileWidth - window._bx0 + 1;
+    window._noData = _noData;
+
+    if (!readBlocks(levelIndex, window._bx0, window._by0, x1 / (int)level.tileWidth, y1 / (int)level.tileHeight, window._blocks, progress))
+        return 0L;
+
+    osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+    hf->allocate(tileSize, tileSize);
+
+    bool empty = true;
+
+    for (unsigned r = 0; r < tileSize; ++r)
+    {
+        double y = extent.yMin() + r * dy;
+        double py = (_originY - y) / resY - 0.5;
+
+        for (unsigned c = 0; c < tileSize; ++c)
+        {
+            double x = extent.xMin() + c * dx;
+            double px = (x - _originX) / resX - 0.5;
+
+            int ix = (int)floor(px), iy = (int)floor(py);
+            double fx = px - ix, fy = py - iy;
+
+            float h = NO_DATA_VALUE;
+            double h00, h10, h01, h11;
+            if (window.get(ix, iy, 0, h00) && window.get(ix + 1, iy, 0, h10) &&
+                window.get(ix, iy + 1, 0, h01) && window.get(ix + 1, iy + 1, 0, h11))
+            {
+                h = (float)(
+                    (h00 * (1.0 - fx) + h10 * fx) * (1.0 - fy) +
+                    (h01 * (1.0 - fx) + h11 * fx) * fy);
+            }
+            else
+            {
+                double nn;
+                if (window.get((int)floor(px + 0.5), (int)floor(py + 0.5), 0, nn))
+                    h = (float)nn;
+            }
+
+            if (h != NO_DATA_VALUE)
+                empty = false;
+
+            hf->setHeight(c, r, h);
+        }
+    }
+
+    return empty ? 0L : hf.release();
+}
+
+//........................................................................
+
+Config
+COGImageLayerOptions::getConfig() const
+{
+    Config conf = ImageLayer::Options::getConfig();
+    conf.set("url", _url);
+    conf.set("max_range_gap", _maxRangeGap);
+    return conf;
+}
+
+void
+COGImageLayerOptions::fromConfig(const Config& conf)
+{
+    _maxRangeGap.init(16384u);
+    conf.get("url", _url);
+    conf.get("max_range_gap", _maxRangeGap);
+}
+
+Config
+COGImageLayerOptions::getMetadata()
+{
+    return Config::readJSON( OE_MULTILINE(
+        { "name" : "Cloud-Optimized GeoTIFF Image",
+            "properties": [
+            { "name": "url",           "description": "Location of the GeoTIFF", "type": "string", "default": "" },
+            { "name": "max_range_gap", "description": "Byte ranges closer than this are fetched together", "type": "integer", "default": "16384" }
+            ]
+        }
+    ) );
+}
+
+//........................................................................
+
+Config
+COGElevationLayerOptions::getConfig() const
+{
+    Config conf = ElevationLayer::Options::getConfig();
+    conf.set("url", _url);
+    conf.set("max_range_gap", _maxRangeGap);
+    return conf;
+}
+
+void
+COGElevationLayerOptions::fromConfig(const Config& conf)
+{
+    _maxRangeGap.init(16384u);
+    conf.get("url", _url);
+    conf.get("max_range_gap", _maxRangeGap);
+}
+
+Config
+COGElevationLayerOptions::getMetadata()
+{
+    return Config::readJSON( OE_MULTILINE(
+        { "name" : "Cloud-Optimized GeoTIFF Elevation",
+            "properties": [
+            { "name": "url",           "description": "Location of the GeoTIFF", "type": "string", "default": "" },
+            { "name": "max_range_gap", "description": "Byte ranges closer than this are fetched together", "type": "integer", "default": "16384" }
+            ]
+        }
+    ) );
+}
+
+//........................................................................
+
+REGISTER_OSGEARTH_LAYER(cogimage, COGImageLayer);
+
+OE_LAYER_PROPERTY_IMPL(COGImageLayer, URI, URL, url);
+OE_LAYER_PROPERTY_IMPL(COGImageLayer, unsigned, MaxRangeGap, maxRangeGap);
+
+void
+COGImageLayer::init()
+{
+    ImageLayer::init();
+}
+
+Status
+COGImageLayer::openImplementation()
+{
+    Status parent = ImageLayer::openImplementation();
+    if (parent.isError())
+        return parent;
+
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
+    Status status = _driver.open(
+        options().url().get(),
+        options().maxRangeGap().get(),
+        getReadOptions());
+
+    if (status.isError())
+        return status;
+
+    if (_driver.getBitsPerSample() > 16u)
+    {
+        return Status::Error(Status::ResourceUnavailable, "Imagery must have 8- or 16-bit samples");
+    }
+
+    setProfile(_driver.getProfile());
+
+    dataExtents().clear();
+    dataExtents().push_back(DataExtent(
+        _driver.getExtent(),
+        0u,
+        getProfile()->getLevelOfDetailForHorizResolution(_driver.getResolution(), getTileSize())));
+
+    return Status::NoError;
+}
+
+GeoImage
+COGImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
+{
+    osg::ref_ptr<osg::Image> image = _driver.createImage(key.getExtent(), getTileSize(), true, progress);
+
+    if (!image.valid())
+        return GeoImage::INVALID;
+
+    return GeoImage(image.release(), key.getExtent());
+}
+
+//........................................................................
+
+REGISTER_OSGEARTH_LAYER(cogelevation, COGElevationLayer);
+
+OE_LAYER_PROPERTY_IMPL(COGElevationLayer, URI, URL, url);
+OE_LAYER_PROPERTY_IMPL(COGElevationLayer, unsigned, MaxRangeGap, maxRangeGap);
+
+void
+COGElevationLayer::init()
+{
+    ElevationLayer::init();
+}
+
+Status
+COGElevationLayer::openImplementation()
+{
+    Status parent = ElevationLayer::openImplementation();
+    if (parent.isError())
+        return parent;
+
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
+    Status status = _driver.open(
+        options().url().get(),
+        options().maxRangeGap().get(),
+        getReadOptions());
+
+    if (status.isError())
+        return status;
+
+    setProfile(_driver.getProfile());
+
+    dataExtents().clear();
+    dataExtents().push_back(DataExtent(
+        _driver.getExtent(),
+        0u,
+        getProfile()->getLevelOfDetailForHorizResolution(_driver.getResolution(), getTileSize())));
+
+    return Status::NoError;
+}
+
+GeoHeightField
+COGElevationLayer::createHeightFieldImplementation(const TileKey& key, ProgressCallback* progress) const
+{
+    osg::ref_ptr<osg::HeightField> hf = _driver.createHeightField(key.getExtent(), getTileSize(), progress);
+
+    if (!hf.valid())
+        return GeoHeightField::INVALID;
+
+    return GeoHeightField(hf.release(), key.getExtent());
+}
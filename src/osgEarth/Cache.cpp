@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/Cache>
+#include <osgEarth/WriteBehindCacheBin>
 #include <osgEarth/Registry>
 #include <osgEarth/Utils>
 #include "sha1.hpp"
@@ -115,7 +116,8 @@ CacheSettings::toString() const
 
 Cache::Cache( const CacheOptions& options ) :
 _options( options ),
-_bins("OE.Cache.bins")
+_bins("OE.Cache.bins"),
+_writeBehindBins("OE.Cache.writeBehindBins")
 {
     //nop
 }
@@ -126,7 +128,8 @@ Cache::~Cache()
 
 Cache::Cache( const Cache& rhs, const osg::CopyOp& op ) :
 osg::Object( rhs, op ),
-_bins("OE.Cache.bins")
+_bins("OE.Cache.bins"),
+_writeBehindBins("OE.Cache.writeBehindBins")
 {
     _status = rhs._status;
 }
@@ -142,9 +145,26 @@ Cache::getBin( const std::string& binID )
 void
 Cache::removeBin( CacheBin* bin )
 {
+    _writeBehindBins.remove( bin->getID() );
     _bins.remove( bin->getID() );
 }
 
+CacheBin*
+Cache::getWriteBehindBin( CacheBin* bin )
+{
+    if ( !bin )
+        return 0L;
+
+    CacheBin* queued = _writeBehindBins.get( bin->getID() );
+    if ( !queued )
+    {
+        queued = _writeBehindBins.getOrCreate(
+            bin->getID(),
+            new WriteBehindCacheBin(bin, _options.writeBehindQueueSize().get()) );
+    }
+    return queued;
+}
+
 namespace
 {
     int hash8(const std::string& str)
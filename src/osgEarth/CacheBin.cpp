@@ -19,10 +19,13 @@
 #include <osgEarth/CacheBin>
 #include <osgEarth/Registry>
 #include <osgEarth/Cache>
+#include <osgEarth/TileKey>
+#include <osgEarth/StringUtils>
 
 #include <osgDB/FileNameUtils>
 #include <osgDB/Registry>
 #include <osg/TextureBuffer>
+#include <cstring>
 
 using namespace osgEarth;
 
@@ -266,6 +269,61 @@ CacheBin::writeNode(const std::string&    key,
     return true;
 }
 
+unsigned
+CacheBin::writeBatch(const std::vector<WriteRecord>& records)
+{
+    unsigned count = 0u;
+    for (const auto& record : records)
+    {
+        bool ok = record._isTileRecord ?
+            write(record._tileKey, record._object.get(), record._metadata, record._dbo.get()) :
+            write(record._key, record._object.get(), record._metadata, record._dbo.get());
+
+        if (ok)
+            ++count;
+    }
+    return count;
+}
+
+CacheBin::TileRecordKey::TileRecordKey(const TileKey& key, const char* prefix) :
+    _lod(key.getLOD()),
+    _x(key.getTileX()),
+    _y(key.getTileY()),
+    _profile(key.getProfile() ? key.getProfile()->getHorizSignatureHash() : 0u),
+    _prefix(prefix ? prefix : "")
+{
+    //nop
+}
+
+std::string
+CacheBin::TileRecordKey::str() const
+{
+    // Same as building the key from TileKey::str() and the profile's
+    // horizontal signature, so both interfaces find the same records.
+    return Cache::makeCacheKey(
+        Stringify() << _lod << "/" << _x << "/" << _y << "-" << std::hex << _profile,
+        _prefix);
+}
+
+std::string
+CacheBin::TileRecordKey::bytes() const
+{
+    std::size_t prefixSize = strlen(_prefix);
+    std::string out(14u + prefixSize, '\0');
+    char* p = &out[0];
+
+    // big-endian fields so the bytes sort by LOD, x, then y
+    p[1] = (char)(_lod & 0xff);
+    for (unsigned i = 0; i < 4u; ++i)
+    {
+        p[2 + i]  = (char)((_x >> (24u - 8u*i)) & 0xff);
+        p[6 + i]  = (char)((_y >> (24u - 8u*i)) & 0xff);
+        p[10 + i] = (char)((_profile >> (24u - 8u*i)) & 0xff);
+    }
+    memcpy(p + 14, _prefix, prefixSize);
+    return out;
+}
+
 
 #undef  LC
 #define LC "[ReadImageFromCachePseudoLoader] "
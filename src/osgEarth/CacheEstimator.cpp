@@ -19,6 +19,13 @@
 #include <osgEarth/CacheEstimator>
 #include <osgEarth/Registry>
 #include <osgEarth/TileKey>
+#include <osgEarth/ImageLayer>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/Progress>
+#include <osgDB/Registry>
+#include <osg/Timer>
+#include <algorithm>
+#include <sstream>
 
 using namespace osgEarth;
 
@@ -43,49 +50,266 @@ CacheEstimator::addExtent( const GeoExtent& value)
     _extents.push_back( value );
 }
 
+void
+CacheEstimator::addDataExtents( const DataExtentList& value)
+{
+    _dataExtents.insert(_dataExtents.end(), value.begin(), value.end());
+}
+
+void
+CacheEstimator::getTileRanges(unsigned int level, std::vector<TileRange>& output) const
+{
+    std::vector<GeoExtent> extents;
+    if (_extents.empty())
+    {
+        extents.push_back(_profile->getExtent());
+    }
+    else
+    {
+        for (std::vector< GeoExtent >::const_iterator itr = _extents.begin(); itr != _extents.end(); ++itr)
+            extents.push_back(_profile->clampAndTransformExtent(*itr));
+    }
+
+    // clip to the data extents that have data at this level:
+    if (!_dataExtents.empty())
+    {
+        std::vector<GeoExtent> clipped;
+        for (DataExtentList::const_iterator d = _dataExtents.begin(); d != _dataExtents.end(); ++d)
+        {
+            if (d->minLevel().isSet() && level < d->minLevel().get())
+                continue;
+            if (d->maxLevel().isSet() && level > d->maxLevel().get())
+                continue;
+
+            GeoExtent dataExtent = _profile->clampAndTransformExtent(*d);
+            if (!dataExtent.isValid())
+                continue;
+
+            for (std::vector<GeoExtent>::const_iterator e = extents.begin(); e != extents.end(); ++e)
+            {
+                if (e->isValid() && e->intersects(dataExtent, false))
+                    clipped.push_back(e->intersectionSameSRS(dataExtent));
+            }
+        }
+        extents.swap(clipped);
+    }
+
+    for (std::vector<GeoExtent>::const_iterator e = extents.begin(); e != extents.end(); ++e)
+    {
+        if (!e->isValid())
+            continue;
+
+        constexpr double eps = 0.001;
+        TileKey ll = _profile->createTileKey(e->xMin()+eps, e->yMin()+eps, level);
+        TileKey ur = _profile->createTileKey(e->xMax()-eps, e->yMax()-eps, level);
+
+        if (!ll.valid() || !ur.valid()) continue;
+
+        TileRange range;
+        range._xmin = ll.getTileX();
+        range._xmax = ur.getTileX();
+        range._ymin = ur.getTileY();
+        range._ymax = ll.getTileY();
+        if (range._xmin <= range._xmax && range._ymin <= range._ymax)
+            output.push_back(range);
+    }
+}
+
+unsigned int
+CacheEstimator::getNumTiles(unsigned int level) const
+{
+    std::vector<TileRange> ranges;
+    getTileRanges(level, ranges);
+
+    // Count each tile once even where the ranges overlap: split the columns
+    // at every range edge, and merge the rows covered within each slab.
+    std::vector<unsigned> edges;
+    for (auto& r : ranges)
+    {
+        edges.push_back(r._xmin);
+        edges.push_back(r._xmax + 1);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    unsigned int total = 0;
+    std::vector<std::pair<unsigned, unsigned> > rows;
+
+    for (unsigned i = 0; i + 1 < edges.size(); ++i)
+    {
+        rows.clear();
+        for (auto& r : ranges)
+        {
+            if (r._xmin <= edges[i] && r._xmax >= edges[i])
+                rows.push_back(std::make_pair(r._ymin, r._ymax));
+        }
+        if (rows.empty())
+            continue;
+
+        std::sort(rows.begin(), rows.end());
+
+        unsigned int rowCount = 0;
+        unsigned first = rows[0].first, last = rows[0].second;
+        for (unsigned j = 1; j < rows.size(); ++j)
+        {
+            if (rows[j].first > last + 1)
+            {
+                rowCount += last - first + 1;
+                first = rows[j].first;
+            }
+            last = std::max(last, rows[j].second);
+        }
+        rowCount += last - first + 1;
+
+        total += rowCount * (edges[i + 1] - edges[i]);
+    }
+
+    return total;
+}
+
 unsigned int
 CacheEstimator::getNumTiles() const
 {
     unsigned int total = 0;
+    for (unsigned int level = _minLevel; level <= _maxLevel; level++)
+    {
+        total += getNumTiles(level);
+    }
+    return total;
+}
+
+void
+CacheEstimator::sample(TileLayer* layer, unsigned samplesPerLevel, const std::string& format, ProgressCallback* progress)
+{
+    if (!layer || samplesPerLevel == 0u)
+        return;
+
+    // take the layer's data extents, with their levels in this profile:
+    if (_dataExtents.empty() && layer->getProfile())
+    {
+        for (DataExtentList::const_iterator d = layer->getDataExtents().begin(); d != layer->getDataExtents().end(); ++d)
+        {
+            DataExtent dataExtent = *d;
+            if (d->minLevel().isSet())
+                dataExtent.minLevel() = _profile->getEquivalentLOD(layer->getProfile(), d->minLevel().get());
+            if (d->maxLevel().isSet())
+                dataExtent.maxLevel() = _profile->getEquivalentLOD(layer->getProfile(), d->maxLevel().get());
+            _dataExtents.push_back(dataExtent);
+        }
+    }
+
+    ImageLayer* imageLayer = dynamic_cast<ImageLayer*>(layer);
+    ElevationLayer* elevationLayer = dynamic_cast<ElevationLayer*>(layer);
+    if (!imageLayer && !elevationLayer)
+        return;
 
-    GeoExtent extentsUnion;
-    for (std::vector< GeoExtent >::const_iterator itr = _extents.begin(); itr != _extents.end(); ++itr)
-        extentsUnion.expandToInclude(*itr);
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(format);
 
     for (unsigned int level = _minLevel; level <= _maxLevel; level++)
     {
-        if (_extents.empty())
+        std::vector<TileRange> ranges;
+        getTileRanges(level, ranges);
+        if (ranges.empty())
+            continue;
+
+        double totalSize = 0.0, totalTime = 0.0;
+        unsigned count = 0;
+
+        for (unsigned s = 0; s < samplesPerLevel; ++s)
         {
-            unsigned int wide, high;
-            _profile->getNumTiles( level, wide, high );
-            total += (wide * high);
+            if (progress && progress->isCanceled())
+                return;
+
+            // spread the samples over the ranges, and over each range
+            // along a low-discrepancy sequence so they don't all fall
+            // on the diagonal
+            const TileRange& r = ranges[s % ranges.size()];
+            double u = (0.5 + (double)s) / (double)samplesPerLevel;
+            double v = fmod(0.5 + (double)s * 0.6180339887, 1.0);
+            unsigned x = r._xmin + std::min((unsigned)(u * (double)(r._xmax - r._xmin + 1)), r._xmax - r._xmin);
+            unsigned y = r._ymin + std::min((unsigned)(v * (double)(r._ymax - r._ymin + 1)), r._ymax - r._ymin);
+
+            TileKey key(level, x, y, _profile.get());
+            if (!layer->mayHaveData(key))
+                continue;
+
+            osg::Timer_t t0 = osg::Timer::instance()->tick();
+            double bytes = 0.0;
+
+            if (imageLayer)
+            {
+                GeoImage image = imageLayer->createImage(key, progress);
+                if (!image.valid())
+                    continue;
+
+                std::stringstream buf;
+                if (rw && rw->writeImage(*image.getImage(), buf).success())
+                    bytes = (double)buf.str().size();
+                else
+                    bytes = (double)image.getImage()->getTotalSizeInBytes();
+            }
+            else
+            {
+                GeoHeightField hf = elevationLayer->createHeightField(key, progress);
+                if (!hf.valid())
+                    continue;
+
+                std::stringstream buf;
+                if (rw && rw->writeObject(*hf.getHeightField(), buf).success())
+                    bytes = (double)buf.str().size();
+                else
+                    bytes = (double)hf.getHeightField()->getFloatArray()->getTotalDataSize();
+            }
+
+            totalTime += osg::Timer::instance()->delta_s(t0, osg::Timer::instance()->tick());
+            totalSize += bytes / 1048576.0;
+            ++count;
         }
-        else
+
+        if (count > 0)
         {
-            constexpr double e = 0.001;
-            TileKey ll = _profile->createTileKey(extentsUnion.xMin()+e, extentsUnion.yMin()+e, level);
-            TileKey ur = _profile->createTileKey(extentsUnion.xMax()-e, extentsUnion.yMax()-e, level);
-
-            if (!ll.valid() || !ur.valid()) continue;
-                
-            int tilesWide = ur.getTileX() - ll.getTileX() + 1;
-            int tilesHigh = ll.getTileY() - ur.getTileY() + 1;
-            int tilesAtLevel = tilesWide * tilesHigh;                
-            total += tilesAtLevel;
+            LevelSample& sample = _samples[level];
+            sample._sizeInMB = totalSize / (double)count;
+            sample._timeInSeconds = totalTime / (double)count;
         }
     }
-    return total;
+}
+
+const CacheEstimator::LevelSample*
+CacheEstimator::getSample(unsigned int level) const
+{
+    if (_samples.empty())
+        return 0L;
+
+    std::map<unsigned int, LevelSample>::const_iterator above = _samples.lower_bound(level);
+    if (above == _samples.end())
+        return &(--above)->second;
+    if (above->first == level || above == _samples.begin())
+        return &above->second;
+
+    std::map<unsigned int, LevelSample>::const_iterator below = above;
+    --below;
+    return (level - below->first) <= (above->first - level) ? &below->second : &above->second;
 }
 
 double CacheEstimator::getSizeInMB() const
 {
-    return getNumTiles() * _sizeInMBPerTile;
+    double total = 0.0;
+    for (unsigned int level = _minLevel; level <= _maxLevel; level++)
+    {
+        const LevelSample* sample = getSample(level);
+        total += (double)getNumTiles(level) * (sample ? sample->_sizeInMB : _sizeInMBPerTile);
+    }
+    return total;
 }
 
 double CacheEstimator::getTotalTimeInSeconds() const
 {
-    return getNumTiles() * _timeInSecondsPerTile;
+    double total = 0.0;
+    for (unsigned int level = _minLevel; level <= _maxLevel; level++)
+    {
+        const LevelSample* sample = getSample(level);
+        total += (double)getNumTiles(level) * (sample ? sample->_timeInSeconds : _timeInSecondsPerTile);
+    }
+    return total;
 }
-
-
-
@@ -22,6 +22,10 @@
 
 #include <osgEarth/CacheSeed>
 #include <osgEarth/ImageLayer>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/StringUtils>
+#include <osgEarth/WriteBehindCacheBin>
+#include <osgDB/FileNameUtils>
 
 #define LC "[CacheSeed] "
 
@@ -116,6 +120,56 @@ void CacheSeed::setVisitor(TileVisitor* visitor)
 
 void CacheSeed::run( TileLayer* layer, const Map* map )
 {
+    CacheSettings* cacheSettings = layer->getCacheSettings();
+    bool cacheEnabled = cacheSettings && cacheSettings->isCacheEnabled() && cacheSettings->getCacheBin();
+
+    // Queue the cache writes on their own thread so the workers can go
+    // straight on to the next tile; record encoding happens there too.
+    osg::ref_ptr<CacheBin> originalBin;
+    if (cacheEnabled && dynamic_cast<WriteBehindCacheBin*>(cacheSettings->getCacheBin()) == 0L)
+    {
+        CacheBin* queued = cacheSettings->getCache()->getWriteBehindBin(cacheSettings->getCacheBin());
+        if (queued)
+        {
+            originalBin = cacheSettings->getCacheBin();
+            cacheSettings->setCacheBin(queued);
+        }
+    }
+
+    osg::ref_ptr<TileCheckpoint> checkpoint;
+    if (!_checkpointPath.empty())
+    {
+        std::stringstream signature;
+        signature << layer->getCacheID()
+            << " " << _visitor->getMinLevel() << "-" << _visitor->getMaxLevel();
+        for (unsigned i = 0; i < _visitor->getExtents().size(); ++i)
+            signature << " " << _visitor->getExtents()[i].toString();
+
+        checkpoint = new TileCheckpoint(
+            osgDB::concatPaths(_checkpointPath, layer->getCacheID() + ".checkpoint"),
+            signature.str());
+
+        checkpoint->load();
+
+        if (cacheEnabled)
+            checkpoint->setCacheBin(cacheSettings->getCacheBin());
+    }
+
+    _visitor->setCheckpoint(checkpoint.get());
     _visitor->setTileHandler( new CacheTileHandler( layer, map ) );
     _visitor->run( map->getProfile() );
-}
\ No newline at end of file
+    _visitor->setCheckpoint(0L);
+
+    // Compact after the bulk load. Caches that write a whole bin out at
+    // once (like the pack cache) finish the bin here. The write queue
+    // commits everything first.
+    if (cacheEnabled)
+    {
+        cacheSettings->getCacheBin()->compact();
+    }
+
+    if (originalBin.valid())
+    {
+        cacheSettings->setCacheBin(originalBin.get());
+    }
+}
@@ -162,7 +162,10 @@ _supportsRGTC           ( false ),
 _supportsTextureBuffer  ( false ),
 _maxTextureBufferSize   ( 0 ),
 _isCoreProfile          ( true ),
-_supportsVertexArrayObjects ( false )
+_supportsVertexArrayObjects ( false ),
+_supportsMultiDrawIndirect ( false ),
+_supportsBindlessTexture ( false ),
+_supportsDrawElementsBaseVertex ( false )
 {
     // little hack to force the osgViewer library to link so we can create a graphics context
     osgViewerGetVersion();
@@ -414,6 +417,18 @@ _supportsVertexArrayObjects ( false )
         OE_DEBUG << LC << buf.str() << std::endl;
 
         _supportsVertexArrayObjects = osg::isGLExtensionOrVersionSupported(id, "GL_ARB_vertex_array_object", 3.0);
+
+        _supportsMultiDrawIndirect =
+            osg::isGLExtensionOrVersionSupported(id, "GL_ARB_multi_draw_indirect", 4.3) &&
+            osg::isGLExtensionOrVersionSupported(id, "GL_ARB_shader_draw_parameters", 4.6) &&
+            osg::isGLExtensionOrVersionSupported(id, "GL_ARB_shader_storage_buffer_object", 4.3);
+        OE_DEBUG << LC << "  Multi-draw indirect = " << SAYBOOL(_supportsMultiDrawIndirect) << std::endl;
+
+        _supportsBindlessTexture = osg::isGLExtensionSupported(id, "GL_ARB_bindless_texture");
+        OE_DEBUG << LC << "  Bindless textures = " << SAYBOOL(_supportsBindlessTexture) << std::endl;
+
+        _supportsDrawElementsBaseVertex = osg::isGLExtensionOrVersionSupported(id, "GL_ARB_draw_elements_base_vertex", 3.2);
+        OE_DEBUG << LC << "  Draw elements base vertex = " << SAYBOOL(_supportsDrawElementsBaseVertex) << std::endl;
     }
 }
 
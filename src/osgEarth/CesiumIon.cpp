@@ -24,6 +24,7 @@
 #include <osgEarth/TDTiles>
 #include <osgEarth/TMS>
 #include <osgEarth/Bing>
+#include <osgEarth/ServiceMetadataCache>
 #include <osgDB/FileUtils>
 
 using namespace osgEarth;
@@ -38,8 +39,11 @@ Status
 CesiumIonResource::open(const URI& server,
                         const std::string& assetId,
                         const std::string& token,
-                        const osgDB::Options* readOptions)
+                        const osgDB::Options* readOptions,
+                        CacheSettings* cacheSettings)
 {
+    _fromCache = false;
+
     if (assetId.empty())
     {
         return Status::Error(Status::ConfigurationError, "Fail: driver requires a valid \"asset_id\" property");
@@ -54,20 +58,25 @@ CesiumIonResource::open(const URI& server,
     buf << server.full();
     if (!endsWith(server.full(), "/")) buf << "/";
     buf << "v1/assets/" << assetId << "/endpoint?access_token=" << token;
-    URI endpoint(buf.str());
-    OE_DEBUG << "Getting endpoint " << endpoint.full() << std::endl;
+    _endpoint = URI(buf.str());
+    _cacheSettings = cacheSettings;
+    OE_DEBUG << "Getting endpoint " << _endpoint.full() << std::endl;
 
-    ReadResult r = URI(endpoint).readString(readOptions);
+    ReadResult r = ServiceMetadataCache::readString(
+        _endpoint, ENDPOINT_MAX_AGE, cacheSettings, readOptions);
     if (r.failed())
         return Status::Error(Status::ConfigurationError, "Failed to get metadata from asset endpoint");
 
     Json::Value doc;
-    Json::Reader reader;
+    Json::FastReader reader;
     if (!reader.parse(r.getString(), doc))
     {
+        invalidate();
         return Status::Error(Status::ConfigurationError, "Failed to parse metadata from asset endpoint");
     }
 
+    _fromCache = r.isFromCache();
+
     _resourceUrl = doc["url"].asString();
     _resourceToken = doc["accessToken"].asString();
 
@@ -89,6 +98,13 @@ CesiumIonResource::open(const URI& server,
     return STATUS_OK;
 }
 
+void
+CesiumIonResource::invalidate()
+{
+    ServiceMetadataCache::remove(_endpoint, _cacheSettings.get());
+    _fromCache = false;
+}
+
 //........................................................................
 
 Config
@@ -158,46 +174,70 @@ CesiumIonImageLayer::openImplementation()
         options().server().get(),
         options().assetId().get(),
         _key,
-        getReadOptions());
+        getReadOptions(),
+        getCacheSettings());
 
     if (status.isOK())
     {
-        URIContext uriContext(ionResource._resourceUrl);
-        uriContext.addHeader("authorization", ionResource._acceptHeader);
-        URI tmsURI = URI("tilemapresource.xml", uriContext);
+        status = openResource(ionResource);
 
-
-        if (ionResource._externalType.empty())
-        {
-            TMSImageLayer* tmsImageLayer = new TMSImageLayer();
-            tmsImageLayer->setURL(tmsURI);
-            _imageLayer = tmsImageLayer;
-        }
-        else
+        // a reused endpoint may carry a token the server no longer accepts
+        if (status.isError() && ionResource._fromCache)
         {
-            if (ionResource._externalType == "BING")
-            {
-                BingImageLayer *bingImageLayer = new BingImageLayer();
-                bingImageLayer->setAPIKey(ionResource._externalOptions["key"].asString());
-                bingImageLayer->setImagerySet(ionResource._externalOptions["mapStyle"].asString());
-                _imageLayer = bingImageLayer;
-            }
+            ionResource.invalidate();
+            status = ionResource.open(
+                options().server().get(),
+                options().assetId().get(),
+                _key,
+                getReadOptions(),
+                getCacheSettings());
+
+            if (status.isOK())
+                status = openResource(ionResource);
         }
+    }
 
-        if (_imageLayer)
-        {
-            status = _imageLayer->open();
-            if (status.isError())
-                return status;
-            setProfile(_imageLayer->getProfile());
-            dataExtents() = _imageLayer->getDataExtents();
-        }
-        else
+    return status;
+}
+
+Status
+CesiumIonImageLayer::openResource(const CesiumIonResource& ionResource)
+{
+    URIContext uriContext(ionResource._resourceUrl);
+    uriContext.addHeader("authorization", ionResource._acceptHeader);
+    URI tmsURI = URI("tilemapresource.xml", uriContext);
+
+    if (ionResource._externalType.empty())
+    {
+        TMSImageLayer* tmsImageLayer = new TMSImageLayer();
+        tmsImageLayer->setURL(tmsURI);
+        _imageLayer = tmsImageLayer;
+    }
+    else
+    {
+        if (ionResource._externalType == "BING")
         {
-            return Status::Error("Unsupported Cesium Ion image layer");
+            BingImageLayer *bingImageLayer = new BingImageLayer();
+            bingImageLayer->setAPIKey(ionResource._externalOptions["key"].asString());
+            bingImageLayer->setImagerySet(ionResource._externalOptions["mapStyle"].asString());
+            _imageLayer = bingImageLayer;
         }
     }
 
+    if (!_imageLayer)
+    {
+        return Status::Error("Unsupported Cesium Ion image layer");
+    }
+
+    Status status = _imageLayer->open();
+    if (status.isError())
+    {
+        _imageLayer = NULL;
+        return status;
+    }
+
+    setProfile(_imageLayer->getProfile());
+    dataExtents() = _imageLayer->getDataExtents();
     return status;
 }
 
@@ -266,7 +306,8 @@ CesiumIon3DTilesLayer::openImplementation()
         options().server().get(),
         options().assetId().get(),
         _key,
-        getReadOptions());
+        getReadOptions(),
+        getCacheSettings());
 
     URI serverURI;
     if (status.isOK())
@@ -281,6 +322,27 @@ CesiumIon3DTilesLayer::openImplementation()
         return parentStatus;
 
     ReadResult rr = serverURI.readString();
+
+    // a reused endpoint may carry a token the server no longer accepts
+    if (rr.failed() && ionResource._fromCache)
+    {
+        ionResource.invalidate();
+        status = ionResource.open(
+            options().server().get(),
+            options().assetId().get(),
+            _key,
+            getReadOptions(),
+            getCacheSettings());
+
+        if (status.isOK())
+        {
+            URIContext uriContext;
+            uriContext.addHeader("authorization", ionResource._acceptHeader);
+            serverURI = URI(ionResource._resourceUrl, uriContext);
+            rr = serverURI.readString();
+        }
+    }
+
     if (rr.failed())
     {
         return Status(Status::ResourceUnavailable, Stringify() << "Error loading tileset: " << rr.errorDetail());
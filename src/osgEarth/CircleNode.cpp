@@ -56,7 +56,7 @@ CircleNode::set(const GeoPoint&    position,
 
     setPosition(position);
 
-    buildGeometry();
+    requestRebuild();
 }
 
 void
@@ -83,7 +83,7 @@ CircleNode::setRadius( const Linear& radius )
     if (_radius != radius )
     {
         _radius = radius;
-        buildGeometry();
+        requestRebuild();
     }
 }
 
@@ -99,7 +99,7 @@ CircleNode::setNumSegments(unsigned int numSegments )
     if (_numSegments != numSegments )
     {
         _numSegments = numSegments;
-        buildGeometry();
+        requestRebuild();
     }
 }
 
@@ -113,7 +113,7 @@ void
 CircleNode::setArcStart(const Angle& arcStart)
 {
 	_arcStart = arcStart;
-	buildGeometry();
+	requestRebuild();
 }
 
 const Angle&
@@ -126,7 +126,7 @@ void
 CircleNode::setArcEnd(const Angle& arcEnd)
 {
 	_arcEnd = arcEnd;
-	buildGeometry();
+	requestRebuild();
 }
 
 const bool&
@@ -139,7 +139,7 @@ void
 CircleNode::setPie(const bool& pie)
 {
     _pie = pie;
-    buildGeometry();
+    requestRebuild();
 }
 
 void
@@ -159,10 +159,17 @@ CircleNode::buildGeometry()
 
     if ( geom.valid() )
     {
-        setGeometry(geom.get());
+        _geom = geom.get();
+        compileGeometry();
     }
 }
 
+void
+CircleNode::rebuild()
+{
+    buildGeometry();
+}
+
 
 //-------------------------------------------------------------------
 
@@ -24,10 +24,14 @@
 #include <osgEarth/CullingUtils>
 #include <osgEarth/Registry>
 #include <osgEarth/Shaders>
+#include <osgEarth/Terrain>
+#include <osgEarth/TerrainEngineNode>
+#include <osgEarth/GPUTimer>
 
 #include <osg/Depth>
 #include <osg/PolygonMode>
 #include <osg/Texture2D>
+#include <atomic>
 
 #define LC "[ClampingTechnique] "
 
@@ -79,24 +83,45 @@ namespace
 
         osg::ref_ptr<osg::Uniform>   _horizonDistance2Uniform;
 
+        // near cascade, centered under the eye
+        osg::ref_ptr<osg::Camera>    _nearCamera;
+        osg::ref_ptr<osg::Texture2D> _nearTexture;
+        osg::ref_ptr<osg::Uniform>   _camViewToNearClipUniform;
+        osg::ref_ptr<osg::Uniform>   _nearClipToCamViewUniform;
+
+        // what the depth textures currently hold
+        bool        _captured;
+        unsigned    _capturedRevision;
+        osg::Matrix _capturedViewMatrix;
+        osg::Matrix _capturedProjMatrix;
+        osg::Matrix _capturedNearProjMatrix;
+
         unsigned _renderLeafCount;
 
         META_Object(osgEarth,LocalPerViewData);
-        LocalPerViewData() : _renderLeafCount(0) { }
+        LocalPerViewData() : _captured(false), _capturedRevision(0u), _renderLeafCount(0) { }
         LocalPerViewData(const LocalPerViewData& rhs, const osg::CopyOp& co) 
-           : _renderLeafCount(0) { }
+           : _captured(false), _capturedRevision(0u), _renderLeafCount(0) { }
         
         void resizeGLObjectBuffers(unsigned maxSize) {
             if (_rttTexture.valid())
                 _rttTexture->resizeGLObjectBuffers(maxSize);
             if (_groupStateSet.valid())
                 _groupStateSet->resizeGLObjectBuffers(maxSize);
+            if (_nearCamera.valid())
+                _nearCamera->resizeGLObjectBuffers(maxSize);
+            if (_nearTexture.valid())
+                _nearTexture->resizeGLObjectBuffers(maxSize);
         }
         void releaseGLObjects(osg::State* state) const {
             if (_rttTexture.valid())
                 _rttTexture->releaseGLObjects(state);
             if (_groupStateSet.valid())
                 _groupStateSet->releaseGLObjects(state);
+            if (_nearCamera.valid())
+                _nearCamera->releaseGLObjects(state);
+            if (_nearTexture.valid())
+                _nearTexture->releaseGLObjects(state);
         }
 
 
@@ -119,19 +144,79 @@ namespace
         }
     };
 #endif
+
+    osg::Texture2D* createDepthTexture(int size)
+    {
+        osg::Texture2D* tex = new osg::Texture2D();
+        tex->setTextureSize( size, size );
+        tex->setInternalFormat( GL_DEPTH_COMPONENT );
+        tex->setFilter( osg::Texture::MIN_FILTER, osg::Texture::NEAREST );
+        tex->setFilter( osg::Texture::MAG_FILTER, osg::Texture::LINEAR );
+
+        // this is important. geometry that is outside the depth texture will clamp to the
+        // closest edge value in the texture -- this is good when you are rendering a 
+        // primitive that has one or more of its verts off-screen.
+        tex->setWrap( osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE );
+        tex->setWrap( osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE );
+        //tex->setBorderColor( osg::Vec4(0,0,0,1) );
+        return tex;
+    }
+
+    osg::Camera* createDepthCamera(const std::string& name, int size, osg::Texture2D* tex)
+    {
+        osg::Camera* camera = new osg::Camera();
+        camera->setName( name );
+        camera->setReferenceFrame( osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT );
+        camera->setClearDepth( 1.0 );
+        camera->setClearMask( GL_DEPTH_BUFFER_BIT );
+        camera->setComputeNearFarMode( osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR );
+        camera->setViewport( 0, 0, size, size );
+        camera->setRenderOrder( osg::Camera::PRE_RENDER );
+        camera->setRenderTargetImplementation( osg::Camera::FRAME_BUFFER_OBJECT );
+        camera->setImplicitBufferAttachmentMask(0, 0);
+        camera->attach( osg::Camera::DEPTH_BUFFER, tex );
+        return camera;
+    }
 }
 
 //---------------------------------------------------------------------------
 
+class ClampingTechnique::TerrainRevision : public TerrainCallback
+{
+public:
+    TerrainRevision() : _revision(0u) { }
+
+    unsigned get() const { return _revision; }
+
+    // any new or updated tile may change the depth under the capture
+    void onTileUpdate(const TileKey& key, osg::Node* graph, TerrainCallbackContext& context)
+    {
+        ++_revision;
+    }
+
+private:
+    std::atomic<unsigned> _revision;
+};
+
+//---------------------------------------------------------------------------
+
 ClampingTechnique::ClampingTechnique() :
 _textureSize( 1024 ),
+_recaptureThreshold( 1.0f ),
+_cascadeRatio( 4.0f ),
 _engine(0L)
 {
     // disable if GLSL is not supported
     _supported = Registry::capabilities().supportsGLSL();
 
-    // use the maximum available unit.
+    // use the maximum available units.
     _textureUnit = Registry::capabilities().getMaxGPUTextureUnits() - 1;
+    _nearTextureUnit = _textureUnit - 1;
+}
+
+ClampingTechnique::~ClampingTechnique()
+{
+    //nop
 }
 
 
@@ -157,32 +242,10 @@ ClampingTechnique::setUpCamera(OverlayDecorator::TechRTTParams& params)
     LocalPerViewData* local = new LocalPerViewData();
     params._techniqueData = local;
 
-    // create the projected texture:
-    local->_rttTexture = new osg::Texture2D();
-    local->_rttTexture->setTextureSize( *_textureSize, *_textureSize );
-    local->_rttTexture->setInternalFormat( GL_DEPTH_COMPONENT );
-    local->_rttTexture->setFilter( osg::Texture::MIN_FILTER, osg::Texture::NEAREST );
-    local->_rttTexture->setFilter( osg::Texture::MAG_FILTER, osg::Texture::LINEAR );
-
-    // this is important. geometry that is outside the depth texture will clamp to the
-    // closest edge value in the texture -- this is good when you are rendering a 
-    // primitive that has one or more of its verts off-screen.
-    local->_rttTexture->setWrap( osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE );
-    local->_rttTexture->setWrap( osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE );
-    //local->_rttTexture->setBorderColor( osg::Vec4(0,0,0,1) );
-
-    // set up the RTT camera for rendering a depth map of the terrain:
-    params._rttCamera = new osg::Camera();
-    params._rttCamera->setName("GPU Clamping");
-    params._rttCamera->setReferenceFrame( osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT );
-    params._rttCamera->setClearDepth( 1.0 );
-    params._rttCamera->setClearMask( GL_DEPTH_BUFFER_BIT );
-    params._rttCamera->setComputeNearFarMode( osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR );
-    params._rttCamera->setViewport( 0, 0, *_textureSize, *_textureSize );
-    params._rttCamera->setRenderOrder( osg::Camera::PRE_RENDER );
-    params._rttCamera->setRenderTargetImplementation( osg::Camera::FRAME_BUFFER_OBJECT );
-    params._rttCamera->setImplicitBufferAttachmentMask(0, 0);
-    params._rttCamera->attach( osg::Camera::DEPTH_BUFFER, local->_rttTexture.get() );
+    // create the projected texture and the RTT camera for rendering
+    // a depth map of the terrain into it:
+    local->_rttTexture = createDepthTexture( *_textureSize );
+    params._rttCamera = createDepthCamera( "GPU Clamping", *_textureSize, local->_rttTexture.get() );
 
 #ifdef DUMP_RTT_IMAGE
     local->_rttDebugImage = new osg::Image();
@@ -197,6 +260,8 @@ ClampingTechnique::setUpCamera(OverlayDecorator::TechRTTParams& params)
     params._rttCamera->setFinalDrawCallback( new RttOut() );
 #endif
 
+    GPUTimer::install(params._rttCamera.get(), "clamping");
+
     // set up a StateSet for the RTT camera.
     osg::StateSet* rttStateSet = params._rttCamera->getOrCreateStateSet();
 
@@ -228,6 +293,16 @@ ClampingTechnique::setUpCamera(OverlayDecorator::TechRTTParams& params)
     // todo: should probably protect this with a mutex.....
     params._rttCamera->addChild( _engine ); // the terrain itself.
 
+    // the near cascade sees the same terrain from the same view, only closer
+    bool useCascade = _cascadeRatio > 1.0f && _nearTextureUnit >= 0;
+    if ( useCascade )
+    {
+        local->_nearTexture = createDepthTexture( *_textureSize );
+        local->_nearCamera = createDepthCamera( "GPU Clamping (near)", *_textureSize, local->_nearTexture.get() );
+        local->_nearCamera->setStateSet( rttStateSet );
+        local->_nearCamera->addChild( _engine );
+    }
+
     // assemble the overlay graph stateset.
     local->_groupStateSet = new osg::StateSet();
 
@@ -286,6 +361,28 @@ ClampingTechnique::setUpCamera(OverlayDecorator::TechRTTParams& params)
 
 #endif
 
+    if ( useCascade )
+    {
+        local->_groupStateSet->setTextureAttributeAndModes(
+            _nearTextureUnit,
+            local->_nearTexture.get(),
+            osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE );
+
+        local->_groupStateSet->getOrCreateUniform(
+            "oe_clamp_nearDepthTex",
+            osg::Uniform::SAMPLER_2D )->set( _nearTextureUnit );
+
+        local->_camViewToNearClipUniform = local->_groupStateSet->getOrCreateUniform(
+            "oe_clamp_cameraView2nearClip",
+            osg::Uniform::FLOAT_MAT4 );
+
+        local->_nearClipToCamViewUniform = local->_groupStateSet->getOrCreateUniform(
+            "oe_clamp_nearClip2cameraView",
+            osg::Uniform::FLOAT_MAT4 );
+
+        local->_groupStateSet->setDefine("OE_CLAMP_CASCADE");
+    }
+
     // default value for altitude offset; can be overriden by geometry.
     local->_groupStateSet->addUniform( new osg::Uniform(Clamping::AltitudeOffsetUniformName, 0.0f) );
 
@@ -323,29 +420,92 @@ ClampingTechnique::getBound(OverlayDecorator::TechRTTParams& params) const
     return _clampingManager.get(params._mainCamera).getBound();
 }
 
+bool
+ClampingTechnique::needsCapture(OverlayDecorator::TechRTTParams& params) const
+{
+    const LocalPerViewData& local = *static_cast<const LocalPerViewData*>(params._techniqueData.get());
+
+    if ( !local._captured || _recaptureThreshold <= 0.0f )
+        return true;
+
+    if ( _terrainRevision.valid() && _terrainRevision->get() != local._capturedRevision )
+        return true;
+
+    // How far the corners of the region we'd capture now land from where
+    // they were in the last capture, in that capture's texels.
+    osg::Matrix currentClipToCapturedClip =
+        osg::Matrix::inverse( params._rttViewMatrix * params._rttProjMatrix ) *
+        local._capturedViewMatrix *
+        local._capturedProjMatrix;
+
+    double maxDrift = 0.0;
+    for(int i=0; i<8; ++i)
+    {
+        osg::Vec3d corner( (i&1)? 1.0 : -1.0, (i&2)? 1.0 : -1.0, (i&4)? 1.0 : -1.0 );
+        osg::Vec3d drift = corner * currentClipToCapturedClip - corner;
+        maxDrift = osg::maximum( maxDrift, osg::maximum( fabs(drift.x()), osg::maximum(fabs(drift.y()), fabs(drift.z())) ) );
+    }
+
+    // clip space spans 2 units across the texture
+    return maxDrift * 0.5 * (double)(*_textureSize) > (double)_recaptureThreshold;
+}
+
 void
 ClampingTechnique::cullOverlayGroup(OverlayDecorator::TechRTTParams& params,
                                     osgUtil::CullVisitor*            cv )
 {
     if ( params._rttCamera.valid() && hasData(params) )
     {
-        // update the RTT camera.
-        params._rttCamera->setViewMatrix      ( params._rttViewMatrix );
-        params._rttCamera->setProjectionMatrix( params._rttProjMatrix );
-        
-        // set the primary-camera-to-rtt-camera transformation matrix,
-        // which lets you perform vertex shader operations from the perspective
-        // of the primary camera (morphing, etc.) so that things match up
-        // between the two cameras.
-        osg::Matrix viewMatrixInverse = osg::Matrix::inverse(params._rttViewMatrix);
-        params._rttToPrimaryMatrixUniform->set(viewMatrixInverse * (*cv->getModelViewMatrix()));
-
-        // create the depth texture (render the terrain to tex)
-        params._rttCamera->accept( *cv );
-        
-
         LocalPerViewData& local = *static_cast<LocalPerViewData*>(params._techniqueData.get());
 
+        // Only redraw the depth map(s) when what they hold is out of date;
+        // otherwise the overlay keeps sampling the last capture.
+        if ( needsCapture(params) )
+        {
+            local._capturedViewMatrix = params._rttViewMatrix;
+            local._capturedProjMatrix = params._rttProjMatrix;
+            local._capturedRevision = _terrainRevision.valid() ? _terrainRevision->get() : 0u;
+            local._captured = true;
+
+            // update the RTT camera.
+            params._rttCamera->setViewMatrix      ( params._rttViewMatrix );
+            params._rttCamera->setProjectionMatrix( params._rttProjMatrix );
+        
+            // set the primary-camera-to-rtt-camera transformation matrix,
+            // which lets you perform vertex shader operations from the perspective
+            // of the primary camera (morphing, etc.) so that things match up
+            // between the two cameras.
+            osg::Matrix viewMatrixInverse = osg::Matrix::inverse(params._rttViewMatrix);
+            params._rttToPrimaryMatrixUniform->set(viewMatrixInverse * (*cv->getModelViewMatrix()));
+
+            // create the depth texture (render the terrain to tex)
+            params._rttCamera->accept( *cv );
+
+            if ( local._nearCamera.valid() )
+            {
+                // The near capture is a window into the full one, centered on the
+                // eye where the camera needs the detail, and kept inside it.
+                double L, R, B, T, N, F;
+                if ( params._rttProjMatrix.getOrtho(L, R, B, T, N, F) )
+                {
+                    osg::Vec3d eyeRTT = params._eyeWorld * params._rttViewMatrix;
+                    double halfW = 0.5*(R-L)/(double)_cascadeRatio;
+                    double halfH = 0.5*(T-B)/(double)_cascadeRatio;
+                    double cx = osg::clampBetween( eyeRTT.x(), L+halfW, R-halfW );
+                    double cy = osg::clampBetween( eyeRTT.y(), B+halfH, T-halfH );
+                    local._capturedNearProjMatrix.makeOrtho( cx-halfW, cx+halfW, cy-halfH, cy+halfH, N, F );
+                }
+                else
+                {
+                    local._capturedNearProjMatrix = params._rttProjMatrix;
+                }
+
+                local._nearCamera->setViewMatrix      ( params._rttViewMatrix );
+                local._nearCamera->setProjectionMatrix( local._capturedNearProjMatrix );
+                local._nearCamera->accept( *cv );
+            }
+        }
+
         // construct a matrix that transforms from camera view coords to depth texture
         // clip coords directly. This will avoid precision loss in the 32-bit shader.
         static osg::Matrix s_scaleBiasMat = 
@@ -356,14 +516,16 @@ ClampingTechnique::cullOverlayGroup(OverlayDecorator::TechRTTParams& params,
             osg::Matrix::translate(1.0,1.0,1.0) * 
             osg::Matrix::scale    (0.5,0.5,0.5) );
 
+        // everything below maps to the captured textures, which may be
+        // from an earlier frame than the current RTT matrices.
         osg::Matrix vm;
         vm.invert( *cv->getModelViewMatrix() );
         osg::Matrix cameraViewToDepthView =
             vm *
-            params._rttViewMatrix;
+            local._capturedViewMatrix;
 
         osg::Matrix depthViewToDepthClip = 
-            params._rttProjMatrix *
+            local._capturedProjMatrix *
             s_scaleBiasMat;
 
         osg::Matrix cameraViewToDepthClip =
@@ -391,6 +553,19 @@ ClampingTechnique::cullOverlayGroup(OverlayDecorator::TechRTTParams& params,
         local._depthClipToCamViewUniform->set( depthClipToCameraView );
 #endif
 
+        if ( local._nearCamera.valid() )
+        {
+            osg::Matrix cameraViewToNearClip =
+                cameraViewToDepthView *
+                local._capturedNearProjMatrix *
+                s_scaleBiasMat;
+            local._camViewToNearClipUniform->set( cameraViewToNearClip );
+
+            osg::Matrix nearClipToCameraView;
+            nearClipToCameraView.invert( cameraViewToNearClip );
+            local._nearClipToCamViewUniform->set( nearClipToCameraView );
+        }
+
         // traverse the overlay nodes, applying the clamping shader.
         cv->pushStateSet(local._groupStateSet.get());
 
@@ -399,7 +574,7 @@ ClampingTechnique::cullOverlayGroup(OverlayDecorator::TechRTTParams& params,
         // cull geometry which is invisible when NOT clamped, but becomes visible after
         // GPU clamping.) We work around that by using a Proxy cull visitor that will 
         // use the RTT camera's matrixes for frustum culling (instead of the main camera's).
-        ProxyCullVisitor pcv(cv, params._rttProjMatrix, params._rttViewMatrix);
+        ProxyCullVisitor pcv(cv, local._capturedProjMatrix, local._capturedViewMatrix);
 
         // cull the clampable geometry.
         getClampingManager().get(cv->getCurrentCamera()).accept(pcv);
@@ -426,6 +601,13 @@ ClampingTechnique::onInstall( TerrainEngineNode* engine )
     // save a pointer to the terrain engine.
     _engine = engine;
 
+    // track terrain changes so we know when to re-capture.
+    if ( _engine && _engine->getTerrain() )
+    {
+        _terrainRevision = new TerrainRevision();
+        _engine->getTerrain()->addTerrainCallback( _terrainRevision.get() );
+    }
+
     if ( !_textureSize.isSet() )
     {
         unsigned maxSize = Registry::capabilities().getMaxFastTextureSize();
@@ -437,5 +619,11 @@ ClampingTechnique::onInstall( TerrainEngineNode* engine )
 void
 ClampingTechnique::onUninstall( TerrainEngineNode* engine )
 {
+    if ( engine && engine->getTerrain() && _terrainRevision.valid() )
+    {
+        engine->getTerrain()->removeTerrainCallback( _terrainRevision.get() );
+    }
+    _terrainRevision = 0L;
+
     _engine = 0L;
 }
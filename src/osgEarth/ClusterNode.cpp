@@ -1,6 +1,8 @@
 #include <osgEarth/ClusterNode>
 
 #include <osgEarth/kdbush.hpp>
+#include <functional>
+#include <cmath>
 
 typedef std::pair<int, int> TPoint;
 typedef std::vector< std::size_t > TIds;
@@ -56,6 +58,7 @@ void ClusterNode::setRadius(unsigned int radius)
 {
     _radius = radius;
     _dirty = true;
+    _dirtyIndex = true;
 }
 
 bool ClusterNode::getEnabled() const
@@ -107,41 +110,183 @@ void ClusterNode::setCanClusterCallback(ClusterNode::CanClusterCallback* callbac
 {
     _canClusterCallback = callback;
     _dirty = true;
+    _dirtyIndex = true;
 }
 
 namespace
 {
-    bool boundSort(const osg::ref_ptr< osg::Node> &i, const osg::ref_ptr< osg::Node> &j)
+    const int MIN_ZOOM = 0;
+    const int MAX_ZOOM = 16;
+
+    // tile size the cluster radius is measured against, in pixels
+    const double TILE_SIZE = 256.0;
+
+    // the index stores normalized Web Mercator coordinates as integers
+    const double INDEX_SCALE = (double)(1 << 28);
+
+    const double MAX_LAT = 85.05112878;
+
+    inline double lonToX(double lon)
     {
-        osg::BoundingSphere bsI = i->getBound();
-        osg::BoundingSphere bsJ = j->getBound();
+        return lon / 360.0 + 0.5;
+    }
 
-        return bsI.center().x() < bsJ.center().x();
+    inline double latToY(double lat)
+    {
+        double s = sin(osg::DegreesToRadians(osg::clampBetween(lat, -MAX_LAT, MAX_LAT)));
+        return 0.5 - 0.25 * log((1.0 + s) / (1.0 - s)) / osg::PI;
+    }
+
+    inline int toIndex(double v)
+    {
+        return (int)(v * INDEX_SCALE);
     }
 }
+
+struct ClusterNode::LevelIndex : public kdbush::KDBush<TPoint>
+{
+    LevelIndex(const std::vector<TPoint>& points) : kdbush::KDBush<TPoint>(points) { }
+};
+
+void ClusterNode::dirty()
+{
+    _dirty = true;
+    _dirtyIndex = true;
+}
+
 void ClusterNode::buildIndex()
 {
-    if (_dirtyIndex)
-    {
-        _clusterIndex.clear();
+    if (!_dirtyIndex)
+        return;
+
+    _levels.clear();
+    _leafOrder.clear();
+    _dirtyIndex = false;
 
-        std::sort(_nodes.begin(), _nodes.end(), boundSort);
+    if (_nodes.empty() || !_mapNode.valid())
+        return;
 
-        unsigned int maxNodes = 10000;
+    const SpatialReference* geoSRS = _mapNode->getMapSRS()->getGeographicSRS();
 
-        osg::Group* currentGroup = 0;
+    _levels.resize(MAX_ZOOM - MIN_ZOOM + 2);
 
-        for (unsigned int i = 0; i < _nodes.size(); i++)
+    auto makeIndex = [](Level& level)
+    {
+        std::vector<TPoint> points;
+        points.reserve(level.items.size());
+        for (auto& item : level.items)
+            points.push_back(TPoint(toIndex(item.x), toIndex(item.y)));
+        level.index = std::make_shared<LevelIndex>(points);
+    };
+
+    // first node under an item, for the CanClusterCallback
+    auto seedNode = [&](unsigned li, unsigned i)
+    {
+        for (; li + 1 < _levels.size(); ++li)
+            i = _levels[li].items[i].children[0];
+        return _nodes[i].get();
+    };
+
+    // the unclustered nodes
+    Level& leaves = _levels.back();
+    leaves.items.resize(_nodes.size());
+    for (unsigned i = 0; i < _nodes.size(); ++i)
+    {
+        Item& item = leaves.items[i];
+        item.world = _nodes[i]->getBound().center();
+        GeoPoint p;
+        p.fromWorld(geoSRS, item.world);
+        item.x = lonToX(p.x());
+        item.y = latToY(p.y());
+        item.numPoints = 1u;
+    }
+    makeIndex(leaves);
+
+    // Cluster each level into the one above it. Every item in the lower level
+    // ends up in exactly one cluster, so the levels form a forest.
+    TIds neighbors;
+    for (int z = MAX_ZOOM; z >= MIN_ZOOM; --z)
+    {
+        unsigned li = z - MIN_ZOOM;
+        const Level& input = _levels[li + 1];
+        Level& output = _levels[li];
+
+        double r = (double)_radius / (TILE_SIZE * (double)(1u << z));
+        std::vector<bool> visited(input.items.size(), false);
+
+        for (unsigned i = 0; i < input.items.size(); ++i)
         {
-            if (!currentGroup || currentGroup->getNumChildren() >= maxNodes)
+            if (visited[i])
+                continue;
+            visited[i] = true;
+
+            const Item& seed = input.items[i];
+
+            Item cluster;
+            cluster.world = seed.world;
+            cluster.children.push_back(i);
+            cluster.numPoints = seed.numPoints;
+            double wx = seed.x * seed.numPoints;
+            double wy = seed.y * seed.numPoints;
+
+            neighbors.clear();
+            input.index->range(
+                toIndex(seed.x - r), toIndex(seed.y - r),
+                toIndex(seed.x + r), toIndex(seed.y + r),
+                neighbors);
+
+            for (auto j : neighbors)
             {
-                currentGroup = new osg::Group;
-                _clusterIndex.push_back(currentGroup);
+                if (visited[j])
+                    continue;
+
+                const Item& other = input.items[j];
+                double dx = other.x - seed.x, dy = other.y - seed.y;
+                if (dx*dx + dy*dy > r*r)
+                    continue;
+
+                if (_canClusterCallback.valid() &&
+                    !(*_canClusterCallback)(seedNode(li + 1, i), seedNode(li + 1, j)))
+                {
+                    continue;
+                }
+
+                visited[j] = true;
+                cluster.children.push_back(j);
+                cluster.numPoints += other.numPoints;
+                wx += other.x * other.numPoints;
+                wy += other.y * other.numPoints;
             }
-            currentGroup->addChild(_nodes[i]);                      
+
+            cluster.x = wx / (double)cluster.numPoints;
+            cluster.y = wy / (double)cluster.numPoints;
+            output.items.push_back(cluster);
         }
+
+        makeIndex(output);
+    }
+
+    // Order the nodes depth first so that every item's nodes are contiguous
+    std::function<void(unsigned, unsigned)> assign = [&](unsigned li, unsigned i)
+    {
+        Item& item = _levels[li].items[i];
+        item.firstLeaf = _leafOrder.size();
+        if (li + 1 == _levels.size())
+        {
+            _leafOrder.push_back(i);
+        }
+        else
+        {
+            for (auto child : item.children)
+                assign(li + 1, child);
+        }
+    };
+
+    _leafOrder.reserve(_nodes.size());
+    for (unsigned i = 0; i < _levels[0].items.size(); ++i)
+    {
+        assign(0, i);
     }
-    _dirtyIndex = false;
 }
 
 
@@ -161,105 +306,121 @@ void ClusterNode::getClusters(osgUtil::CullVisitor* cv, ClusterList& out)
         camera->getProjectionMatrix() *
         camera->getViewport()->computeWindowMatrix();
 
-    std::vector<TPoint> points;
-
-    osg::NodeList validPlaces;
-
     buildIndex();
 
-    for (osg::NodeList::iterator itr = _clusterIndex.begin(); itr != _clusterIndex.end(); ++itr)
+    if (_levels.empty())
     {
-        osg::Group* index = static_cast<osg::Group*>(itr->get());
-        if (cv->isCulled(index->getBound()))
-        {
-            continue;
-        }
+        return;
+    }
 
-        for (unsigned int i = 0; i < index->getNumChildren(); i++)
-        {
-            osg::Node* node = index->getChild(i);
-            osg::Vec3d world = node->getBound().center();
+    const SpatialReference* geoSRS = _mapNode->getMapSRS()->getGeographicSRS();
+    double R = geoSRS->getEllipsoid()->getRadiusEquator();
 
-            if (cv->isCulled(*node))
-            {
-                continue;
-            }
+    osg::Vec3d eye = osg::Vec3d(0, 0, 0) * camera->getInverseViewMatrix();
+    GeoPoint eyeGeo;
+    eyeGeo.fromWorld(geoSRS, eye);
+    double altitude = osg::maximum(eyeGeo.alt(), 1.0);
 
-            if (!_horizon->isVisible(world))
-            {
-                continue;
-            }
+    // Pick the zoom level whose pixels match the ground resolution under the camera
+    double fovy, aspect, zn, zf;
+    if (!camera->getProjectionMatrixAsPerspective(fovy, aspect, zn, zf))
+    {
+        fovy = 30.0;
+    }
+    double metersPerPixel = 2.0 * altitude * tan(osg::DegreesToRadians(fovy) * 0.5) / viewport->height();
+    double zoom = log(2.0 * osg::PI * R / (TILE_SIZE * metersPerPixel)) / log(2.0);
 
-            osg::Vec3d screen = world * mvpw;
+    unsigned li = _levels.size() - 1;
+    if (zoom < (double)MAX_ZOOM + 1.0)
+    {
+        li = (unsigned)osg::clampBetween((int)floor(zoom) - MIN_ZOOM, 0, MAX_ZOOM - MIN_ZOOM);
+    }
+    const Level& level = _levels[li];
 
-            if (screen.x() >= 0 && screen.x() <= viewport->width() &&
-                screen.y() >= 0 && screen.y() <= viewport->height())
-            {
-                validPlaces.push_back(node);
-                points.push_back(TPoint(screen.x(), screen.y()));
-            }
+    // Only look up items in the part of the globe inside the horizon
+    std::vector<osg::Vec4d> boxes; // xmin, ymin, xmax, ymax
+    double lonMin = -180.0, lonMax = 180.0, latMin = -90.0, latMax = 90.0;
+    if (_mapNode->isGeocentric())
+    {
+        double cap = acos(R / (R + altitude));
+        latMin = eyeGeo.y() - osg::RadiansToDegrees(cap);
+        latMax = eyeGeo.y() + osg::RadiansToDegrees(cap);
+
+        double c = cos(osg::DegreesToRadians(eyeGeo.y()));
+        if (latMin > -90.0 && latMax < 90.0 && sin(cap) < c)
+        {
+            double halfLon = osg::RadiansToDegrees(asin(sin(cap) / c));
+            lonMin = eyeGeo.x() - halfLon;
+            lonMax = eyeGeo.x() + halfLon;
         }
     }
 
-    if (validPlaces.size() == 0) return;
+    double yMin = latToY(latMax), yMax = latToY(latMin);
+    if (lonMin < -180.0)
+    {
+        boxes.push_back(osg::Vec4d(lonToX(lonMin + 360.0), yMin, 1.0, yMax));
+        boxes.push_back(osg::Vec4d(0.0, yMin, lonToX(lonMax), yMax));
+    }
+    else if (lonMax > 180.0)
+    {
+        boxes.push_back(osg::Vec4d(lonToX(lonMin), yMin, 1.0, yMax));
+        boxes.push_back(osg::Vec4d(0.0, yMin, lonToX(lonMax - 360.0), yMax));
+    }
+    else
+    {
+        boxes.push_back(osg::Vec4d(lonToX(lonMin), yMin, lonToX(lonMax), yMax));
+    }
 
-    kdbush::KDBush<TPoint> index(points);
-    std::set< unsigned int > clustered;
+    TIds hits;
+    for (auto& box : boxes)
+    {
+        level.index->range(
+            toIndex(box[0]), toIndex(box[1]),
+            toIndex(box[2]), toIndex(box[3]),
+            hits);
+    }
 
-    for (unsigned int i = 0; i < validPlaces.size(); i++)
+    for (auto id : hits)
     {
-        TPoint &screen = points[i];
-        osg::Node* node = validPlaces[i].get();
+        const Item& item = level.items[id];
 
-        // If this thing is already part of a cluster then just continue.
-        if (clustered.find(i) != clustered.end())
+        if (!_horizon->isVisible(item.world))
         {
             continue;
         }
 
-        osg::Vec3d world = node->getBound().center();
+        if (item.numPoints == 1 && cv->isCulled(*_nodes[_leafOrder[item.firstLeaf]]))
+        {
+            continue;
+        }
 
-        // Get any matching indices that are part of this cluster.
-        TIds indices;
+        osg::Vec3d screen = item.world * mvpw;
 
-        index.range(screen.first - _radius, screen.second - _radius, screen.first + _radius, screen.second + _radius, indices);
+        if (screen.x() < 0 || screen.x() > viewport->width() ||
+            screen.y() < 0 || screen.y() > viewport->height())
+        {
+            continue;
+        }
 
         // Create a new cluster.
         Cluster cluster;
-
-        unsigned int actualCount = 0;
-
-        // Add all of the points to the cluster.
-        for (unsigned int j = 0; j < indices.size(); j++)
+        cluster.nodes.reserve(item.numPoints);
+        for (unsigned k = item.firstLeaf; k < item.firstLeaf + item.numPoints; ++k)
         {
-            if (clustered.find(indices[j]) == clustered.end())
-            {
-                if (_canClusterCallback.valid())
-                {
-                    bool canCluster = (*_canClusterCallback)(node, validPlaces[indices[j]].get());
-                    if (!canCluster) {
-                        continue;
-                    }
-                }
-                cluster.nodes.push_back(validPlaces[indices[j]]);
-                actualCount++;
-                clustered.insert(indices[j]);
-            }
+            cluster.nodes.push_back(_nodes[_leafOrder[k]]);
         }
 
         std::stringstream buf;
-        buf << actualCount << std::endl;
+        buf << item.numPoints << std::endl;
 
         PlaceNode* marker = getOrCreateLabel();
         GeoPoint markerPos;
-        markerPos.fromWorld(_mapNode->getMapSRS(), world);
+        markerPos.fromWorld(_mapNode->getMapSRS(), item.world);
         marker->setPosition(markerPos);
         marker->setText(buf.str());
 
         cluster.marker = marker;
         out.push_back(cluster);
-
-        clustered.insert(i);
     }
 }
 
@@ -18,12 +18,17 @@
  */
 #include <osgEarth/Composite>
 #include <osgEarth/Progress>
+#include <osgEarth/Threading>
+#include <algorithm>
+#include <atomic>
 
 using namespace osgEarth;
 
 #undef  LC
 #define LC "[CompositeImageLayer] "
 
+#define ARENA_COMPOSITE "oe.composite"
+
 //........................................................................
 
 Config
@@ -72,6 +77,84 @@ namespace osgEarth { namespace Composite
 
     // some helper types.    
     typedef std::vector<ImageInfo> ImageMixVector;   
+
+    JobArena* getCompositeArena()
+    {
+        static JobArena* arena = []()
+        {
+            JobArena::setConcurrency(ARENA_COMPOSITE, Threading::getConcurrency());
+            return JobArena::get(ARENA_COMPOSITE);
+        }();
+        return arena;
+    }
+
+    // Component fetches for one tile, shared with the jobs that run them.
+    // Layers are taken from the top down; once one returns an opaque image
+    // at full opacity, the layers beneath it are skipped since they would
+    // be covered anyway. A job that starts after all the layers are taken
+    // just returns.
+    struct FetchState
+    {
+        FetchState() : _next(0u), _done(0u), _opaque(-1), _progress(0L), _mutex("OE.CompositeImageLayer") { }
+
+        ImageLayerVector _layers;
+        ImageMixVector _images;
+        TileKey _key;
+        std::atomic<unsigned> _next;
+        std::atomic<unsigned> _done;
+        std::atomic<int> _opaque; // highest opaque layer, or -1
+        ProgressCallback* _progress;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _finished;
+
+        void fetch(int i)
+        {
+            ImageLayer* layer = _layers[i].get();
+            ImageInfo& imageInfo = _images[i];
+            imageInfo.opacity = layer->getOpacity();
+            imageInfo.bestAvailableKey = layer->getBestAvailableTileKey(_key);
+
+            // if there is possibly actual data for this key...
+            if (imageInfo.bestAvailableKey == _key)
+            {
+                GeoImage image = layer->createImage(_key, _progress);
+                if (image.valid())
+                {
+                    imageInfo.image = image.getImage();
+
+                    if (imageInfo.opacity >= 1.0f && !ImageUtils::hasTransparency(imageInfo.image.get()))
+                    {
+                        int opaque = _opaque.load();
+                        while (i > opaque && !_opaque.compare_exchange_weak(opaque, i));
+                    }
+                }
+            }
+        }
+
+        void work()
+        {
+            for (;;)
+            {
+                unsigned n = _next++;
+                if (n >= _images.size())
+                    break;
+
+                int i = (int)_images.size() - 1 - (int)n;
+
+                bool canceled = _progress && _progress->isCanceled();
+                if (!canceled && i > _opaque.load())
+                {
+                    fetch(i);
+                }
+
+                if (++_done == _images.size())
+                {
+                    Threading::ScopedMutexLock lock(_mutex);
+                    _finished.notify_all();
+                }
+            }
+        }
+    };
 } }
 
 REGISTER_OSGEARTH_LAYER(compositeimage, CompositeImageLayer);
@@ -298,37 +381,45 @@ CompositeImageLayer::closeImplementation()
 GeoImage
 CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
 {
-    Composite::ImageMixVector images;
-    images.reserve(_layers.size());
-
-    // Try to get an image from each of the layers for the given key.
-    for (ImageLayerVector::const_iterator itr = _layers.begin(); itr != _layers.end(); ++itr)
+    // Fetch the component images. They share nothing, so they can be
+    // fetched in parallel. The calling thread takes layers too, so this
+    // finishes even when it's called from a job in a busy arena.
+    std::shared_ptr<Composite::FetchState> state = std::make_shared<Composite::FetchState>();
+    state->_layers = _layers;
+    state->_images.resize(_layers.size());
+    state->_key = key;
+    state->_progress = progress;
+
+    unsigned numJobs = std::min((unsigned)_layers.size(), Threading::getConcurrency());
+    if (numJobs > 1u)
     {
-        ImageLayer* layer = itr->get();
-        Composite::ImageInfo imageInfo;
-        imageInfo.opacity = layer->getOpacity();
-        imageInfo.bestAvailableKey = layer->getBestAvailableTileKey(key);
-        
-        // if there is possibly actual data for this key...
-        if (imageInfo.bestAvailableKey == key)
+        JobArena* arena = Composite::getCompositeArena();
+        for (unsigned j = 0; j < numJobs - 1u; ++j)
         {
-            GeoImage image = layer->createImage(key, progress);
-            if (image.valid())
-            {
-                imageInfo.image = image.getImage();
-            }
-
-            // If the progress got cancelled or it needs a retry then return NULL to prevent this tile from being built and cached with incomplete or partial data.
-            if (progress && progress->isCanceled())
-            {
-                OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
-                return GeoImage::INVALID;
-            }
+            Job job(arena);
+            job.setName("oe.composite");
+            job.dispatch([state](Cancelable*) { state->work(); });
         }
+    }
 
-        images.push_back(imageInfo);
+    state->work();
+
+    {
+        std::unique_lock<Threading::Mutex> lock(state->_mutex);
+        state->_finished.wait(lock, [&state]() { return state->_done == state->_images.size(); });
     }
 
+    // If the progress got cancelled or it needs a retry then return NULL to prevent this tile from being built and cached with incomplete or partial data.
+    if (progress && progress->isCanceled())
+    {
+        OE_DEBUG << LC << " createImage was cancelled or needs retry for " << key.str() << std::endl;
+        return GeoImage::INVALID;
+    }
+
+    // Everything under an opaque layer is hidden, so drop it.
+    unsigned firstLayer = (unsigned)std::max(state->_opaque.load(), 0);
+    Composite::ImageMixVector images(state->_images.begin() + firstLayer, state->_images.end());
+
     // Determine the output texture size to use based on the image that were created.
     unsigned numValidImages = 0;
     osg::Vec2s textureSize;
@@ -351,7 +442,7 @@ CompositeImageLayer::createImageImplementation(const TileKey& key, ProgressCallb
         for (unsigned int i = 0; i < images.size(); i++)
         {
             Composite::ImageInfo& info = images[i];
-            ImageLayer* layer = _layers[i].get();
+            ImageLayer* layer = _layers[firstLayer + i].get();
             if (info.image.valid() == false && info.bestAvailableKey.valid())
             {
                 TileKey currentKey = info.bestAvailableKey; //key.createParentKey();
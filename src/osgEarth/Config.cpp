@@ -33,6 +33,41 @@ Config::~Config()
 {
 }
 
+Config&
+Config::operator = (const Config& rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    _key = rhs._key;
+    _defaultValue = rhs._defaultValue;
+    _referrer = rhs._referrer;
+    _isLocation = rhs._isLocation;
+    _isNumber = rhs._isNumber;
+    _externalRef = rhs._externalRef;
+    _refMap = rhs._refMap;
+
+    // Someone may still hold the list children() returned, so refill
+    // that one instead of sharing the other object's. (Copy first, since
+    // rhs may live inside that list.)
+    if (_exposed && _children)
+    {
+        ConfigSet temp(rhs.kids());
+        _children->swap(temp);
+    }
+    else
+        _children = rhs.shareChildren();
+
+    return *this;
+}
+
+const ConfigSet&
+Config::emptyChildren()
+{
+    static const ConfigSet s_empty;
+    return s_empty;
+}
+
 void
 Config::setReferrer( const std::string& referrer )
 {
@@ -55,18 +90,43 @@ Config::setReferrer( const std::string& referrer )
         absReferrer = referrer;
     }
 
+    applyReferrer( absReferrer );
+}
+
+void
+Config::applyReferrer( const std::string& absReferrer )
+{
     // Don't overwrite an existing referrer:
     if ( _referrer.empty() )
     {
         _referrer = absReferrer;
     }
 
-    for( ConfigSet::iterator i = _children.begin(); i != _children.end(); i++ )
-    { 
-        i->setReferrer( absReferrer );
+    // Only un-share the children if one of them will actually change.
+    for( ConfigSet::const_iterator i = kids().begin(); i != kids().end(); ++i )
+    {
+        if ( i->needsReferrer() )
+        {
+            for( ConfigSet::iterator j = mutableKids().begin(); j != mutableKids().end(); ++j )
+                j->applyReferrer( absReferrer );
+            break;
+        }
     }
 }
 
+bool
+Config::needsReferrer() const
+{
+    if ( _referrer.empty() )
+        return true;
+
+    for( ConfigSet::const_iterator i = kids().begin(); i != kids().end(); ++i )
+        if ( i->needsReferrer() )
+            return true;
+
+    return false;
+}
+
 bool
 Config::fromXML( std::istream& in )
 {
@@ -80,7 +140,7 @@ Config::fromXML( std::istream& in )
 const Config&
 Config::child( const std::string& childName ) const
 {
-    for( ConfigSet::const_iterator i = _children.begin(); i != _children.end(); i++ ) {
+    for( ConfigSet::const_iterator i = kids().begin(); i != kids().end(); i++ ) {
         if ( i->key() == childName )
             return *i;
     }
@@ -94,7 +154,7 @@ Config::child( const std::string& childName ) const
 Config
 Config::child( const std::string& childName ) const
 {
-    for( ConfigSet::const_iterator i = _children.begin(); i != _children.end(); i++ ) {
+    for( ConfigSet::const_iterator i = kids().begin(); i != kids().end(); i++ ) {
         if ( i->key() == childName )
             return *i;
     }
@@ -107,7 +167,7 @@ Config::child( const std::string& childName ) const
 const Config*
 Config::child_ptr( const std::string& childName ) const
 {
-    for( ConfigSet::const_iterator i = _children.begin(); i != _children.end(); i++ ) {
+    for( ConfigSet::const_iterator i = kids().begin(); i != kids().end(); i++ ) {
         if ( i->key() == childName )
             return &(*i);
     }
@@ -117,7 +177,10 @@ Config::child_ptr( const std::string& childName ) const
 Config*
 Config::mutable_child( const std::string& childName )
 {
-    for( ConfigSet::iterator i = _children.begin(); i != _children.end(); i++ ) {
+    if ( !child_ptr(childName) )
+        return 0L;
+
+    for( ConfigSet::iterator i = exposedKids().begin(); i != exposedKids().end(); i++ ) {
         if ( i->key() == childName )
             return &(*i);
     }
@@ -128,12 +191,17 @@ Config::mutable_child( const std::string& childName )
 void
 Config::merge( const Config& rhs ) 
 {
+    // hold on to rhs's children; rhs might be this object
+    std::shared_ptr<ConfigSet> rhsChildren = rhs._children;
+    if ( !rhsChildren )
+        return;
+
     // remove any matching keys first; this will allow the addition of multi-key values
-    for( ConfigSet::const_iterator c = rhs._children.begin(); c != rhs._children.end(); ++c )
+    for( ConfigSet::const_iterator c = rhsChildren->begin(); c != rhsChildren->end(); ++c )
         remove( c->key() );
 
     // add in the new values.
-    for( ConfigSet::const_iterator c = rhs._children.begin(); c != rhs._children.end(); ++c )
+    for( ConfigSet::const_iterator c = rhsChildren->begin(); c != rhsChildren->end(); ++c )
         add( *c );
 }
 
@@ -143,11 +211,11 @@ Config::find( const std::string& key, bool checkMe ) const
     if ( checkMe && key == this->key() )
         return this;
 
-    for( ConfigSet::const_iterator c = _children.begin(); c != _children.end(); ++c )
+    for( ConfigSet::const_iterator c = kids().begin(); c != kids().end(); ++c )
         if ( key == c->key() )
             return &(*c);
 
-    for( ConfigSet::const_iterator c = _children.begin(); c != _children.end(); ++c )
+    for( ConfigSet::const_iterator c = kids().begin(); c != kids().end(); ++c )
     {
         const Config* r = c->find(key, false);
         if ( r ) return r;
@@ -162,14 +230,19 @@ Config::find( const std::string& key, bool checkMe )
     if ( checkMe && key == this->key() )
         return this;
 
-    for( ConfigSet::iterator c = _children.begin(); c != _children.end(); ++c )
+    // Search read-only first, so only the path to the match is un-shared.
+    const Config* match = static_cast<const Config*>(this)->find(key, false);
+    if ( !match )
+        return 0L;
+
+    for( ConfigSet::iterator c = exposedKids().begin(); c != exposedKids().end(); ++c )
         if ( key == c->key() )
             return &(*c);
 
-    for( ConfigSet::iterator c = _children.begin(); c != _children.end(); ++c )
+    for( ConfigSet::iterator c = exposedKids().begin(); c != exposedKids().end(); ++c )
     {
-        Config* r = c->find(key, false);
-        if ( r ) return r;
+        if ( static_cast<const Config&>(*c).find(key, false) )
+            return c->find(key, false);
     }
 
     return 0L;
@@ -411,7 +484,7 @@ Config::toJSON( bool pretty ) const
 bool
 Config::fromJSON( const std::string& input )
 {
-    Json::Reader reader;
+    Json::FastReader reader;
     Json::Value root( Json::objectValue );
     if ( reader.parse( input, root ) )
     {
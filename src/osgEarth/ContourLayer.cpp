@@ -0,0 +1,467 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ContourLayer>
+#include <osgEarth/SimplePager>
+#include <osgEarth/ElevationPool>
+#include <osgEarth/LineDrawable>
+#include <osgEarth/LabelNode>
+#include <osgEarth/Containers>
+#include <osgEarth/GLUtils>
+#include <osgEarth/Map>
+#include <osgEarth/NodeUtils>
+#include <osgEarth/StringUtils>
+#include <osgEarth/TextSymbol>
+#include <osg/MatrixTransform>
+#include <cmath>
+#include <unordered_map>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[ContourLayer] "
+
+REGISTER_OSGEARTH_LAYER(contours, ContourLayer);
+
+//........................................................................
+
+Config
+ContourLayer::Options::getMetadata()
+{
+    return Config::readJSON(OE_MULTILINE(
+        { "name" : "Contours",
+          "properties" : [
+            { "name": "interval", "description": "Elevation difference between neighboring contours", "type": "Distance", "default": "100m" },
+            { "name": "index_interval", "description": "Every Nth contour is an index contour", "type": "unsigned", "default": "5" },
+            { "name": "color", "description": "Color of the contour lines", "type": "Color", "default": "#ffffff7f" },
+            { "name": "index_color", "description": "Color of the index contour lines", "type": "Color", "default": "#ffffffff" },
+            { "name": "line_width", "description": "Width of the contour lines in pixels", "type": "float", "default": "1.0" },
+            { "name": "index_line_width", "description": "Width of the index contour lines in pixels", "type": "float", "default": "2.0" },
+            { "name": "labels", "description": "Label the index contours with their elevation", "type": "bool", "default": "true" },
+            { "name": "min_level", "description": "Lowest tile level that draws contours", "type": "unsigned", "default": "10" },
+            { "name": "max_level", "description": "Highest tile level that draws contours", "type": "unsigned", "default": "14" },
+            { "name": "cache_size", "description": "Number of generated tiles to keep in memory", "type": "unsigned", "default": "256" },
+          ]
+        }
+    ));
+}
+
+Config
+ContourLayer::Options::getConfig() const
+{
+    Config conf = VisibleLayer::Options::getConfig();
+    conf.set("interval", interval());
+    conf.set("index_interval", indexInterval());
+    conf.set("color", color());
+    conf.set("index_color", indexColor());
+    conf.set("line_width", lineWidth());
+    conf.set("index_line_width", indexLineWidth());
+    conf.set("labels", labels());
+    conf.set("min_level", minLevel());
+    conf.set("max_level", maxLevel());
+    conf.set("cache_size", cacheSize());
+    return conf;
+}
+
+void
+ContourLayer::Options::fromConfig(const Config& conf)
+{
+    interval().setDefault(Distance(100.0, Units::METERS));
+    indexInterval().setDefault(5u);
+    color().setDefault(Color(1.0f, 1.0f, 1.0f, 0.5f));
+    indexColor().setDefault(Color::White);
+    lineWidth().setDefault(1.0f);
+    indexLineWidth().setDefault(2.0f);
+    labels().setDefault(true);
+    minLevel().setDefault(10u);
+    maxLevel().setDefault(14u);
+    cacheSize().setDefault(256u);
+
+    conf.get("interval", interval());
+    conf.get("index_interval", indexInterval());
+    conf.get("color", color());
+    conf.get("index_color", indexColor());
+    conf.get("line_width", lineWidth());
+    conf.get("index_line_width", indexLineWidth());
+    conf.get("labels", labels());
+    conf.get("min_level", minLevel());
+    conf.get("max_level", maxLevel());
+    conf.get("cache_size", cacheSize());
+}
+
+//........................................................................
+
+namespace
+{
+    // Corners of a marching squares cell, counter-clockwise from the
+    // southwest; bit i of a case index is set when corner i is at or
+    // above the contour level.
+    //
+    // Edges of a cell: 0 = south, 1 = east, 2 = north, 3 = west.
+    // Each case lists up to two segments as pairs of edges (-1 = none).
+    // The saddles (5 and 10) are resolved separately.
+    const int s_segments[16][4] = {
+        { -1, -1, -1, -1 }, //  0: all below
+        {  3,  0, -1, -1 }, //  1: sw
+        {  0,  1, -1, -1 }, //  2: se
+        {  3,  1, -1, -1 }, //  3: sw se
+        {  1,  2, -1, -1 }, //  4: ne
+        { -1, -1, -1, -1 }, //  5: sw ne (saddle)
+        {  0,  2, -1, -1 }, //  6: se ne
+        {  3,  2, -1, -1 }, //  7: sw se ne
+        {  2,  3, -1, -1 }, //  8: nw
+        {  0,  2, -1, -1 }, //  9: sw nw
+        { -1, -1, -1, -1 }, // 10: se nw (saddle)
+        {  1,  2, -1, -1 }, // 11: sw se nw
+        {  3,  1, -1, -1 }, // 12: ne nw
+        {  0,  1, -1, -1 }, // 13: sw ne nw
+        {  3,  0, -1, -1 }, // 14: se ne nw
+        { -1, -1, -1, -1 }  // 15: all above
+    };
+
+    // Contour segments of one tile, in grid coordinates with the
+    // contour elevation in Z
+    struct Segments
+    {
+        std::vector<osg::Vec3d> _lines;
+        std::vector<osg::Vec3d> _indexLines;
+
+        // per index contour level: a segment midpoint near the tile center
+        struct Label { double _distance2; osg::Vec3d _point; };
+        std::unordered_map<int, Label> _labels;
+    };
+
+    // Where the level crosses an edge of cell (c,r), in grid coordinates
+    inline osg::Vec3d crossing(int edge, int c, int r, const float* h, double level)
+    {
+        // h = heights at sw, se, ne, nw
+        switch (edge)
+        {
+        case 0:  return osg::Vec3d(c + (level - h[0]) / (h[1] - h[0]), r, level);
+        case 1:  return osg::Vec3d(c + 1, r + (level - h[1]) / (h[2] - h[1]), level);
+        case 2:  return osg::Vec3d(c + (level - h[3]) / (h[2] - h[3]), r + 1, level);
+        default: return osg::Vec3d(c, r + (level - h[0]) / (h[3] - h[0]), level);
+        }
+    }
+
+    // Runs marching squares over a height field for every contour level.
+    // Each cell only visits the levels between its lowest and highest
+    // corner, so the cost follows the number of segments, not the number
+    // of levels times the number of cells.
+    void trace(const osg::HeightField* hf, double interval, unsigned indexInterval, bool labels, Segments& out)
+    {
+        const int cols = hf->getNumColumns();
+        const int rows = hf->getNumRows();
+        const double cx = 0.5 * (cols - 1), cy = 0.5 * (rows - 1);
+
+        for (int r = 0; r < rows - 1; ++r)
+        {
+            for (int c = 0; c < cols - 1; ++c)
+            {
+                const float h[4] = {
+                    hf->getHeight(c, r),
+                    hf->getHeight(c + 1, r),
+                    hf->getHeight(c + 1, r + 1),
+                    hf->getHeight(c, r + 1) };
+
+                if (h[0] == NO_DATA_VALUE || h[1] == NO_DATA_VALUE ||
+                    h[2] == NO_DATA_VALUE || h[3] == NO_DATA_VALUE)
+                    continue;
+
+                float lo = std::min(std::min(h[0], h[1]), std::min(h[2], h[3]));
+                float hi = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+
+                // levels with a corner on either side; a level equal to the
+                // highest corner would only touch the cell
+                int first = (int)std::ceil(lo / interval);
+                int last = (int)std::ceil(hi / interval) - 1;
+
+                for (int i = first; i <= last; ++i)
+                {
+                    double level = i * interval;
+
+                    int index =
+                        (h[0] >= level ? 1 : 0) |
+                        (h[1] >= level ? 2 : 0) |
+                        (h[2] >= level ? 4 : 0) |
+                        (h[3] >= level ? 8 : 0);
+
+                    int edges[4];
+                    if (index == 5 || index == 10)
+                    {
+                        // saddle: the cell center decides which corners connect
+                        bool centerAbove = 0.25 * (h[0] + h[1] + h[2] + h[3]) >= level;
+                        if ((index == 5) == centerAbove)
+                        {
+                            edges[0] = 0; edges[1] = 1; edges[2] = 2; edges[3] = 3;
+                        }
+                        else
+                        {
+                            edges[0] = 3; edges[1] = 0; edges[2] = 1; edges[3] = 2;
+                        }
+                    }
+                    else
+                    {
+                        for (int e = 0; e < 4; ++e)
+                            edges[e] = s_segments[index][e];
+                    }
+
+                    bool isIndex = indexInterval > 0 && (i % (int)indexInterval) == 0;
+                    std::vector<osg::Vec3d>& lines = isIndex ? out._indexLines : out._lines;
+
+                    for (int s = 0; s < 4 && edges[s] >= 0; s += 2)
+                    {
+                        osg::Vec3d a = crossing(edges[s], c, r, h, level);
+                        osg::Vec3d b = crossing(edges[s + 1], c, r, h, level);
+                        lines.push_back(a);
+                        lines.push_back(b);
+
+                        if (isIndex && labels)
+                        {
+                            osg::Vec3d mid = (a + b) * 0.5;
+                            double d2 = (mid.x() - cx)*(mid.x() - cx) + (mid.y() - cy)*(mid.y() - cy);
+                            auto label = out._labels.find(i);
+                            if (label == out._labels.end())
+                                out._labels[i] = Segments::Label{ d2, mid };
+                            else if (d2 < label->second._distance2)
+                                label->second = Segments::Label{ d2, mid };
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Pages in the contours of each elevation tile
+    class ContourGraph : public SimplePager
+    {
+    public:
+        ContourGraph(const Map* map, const ContourLayer::Options& options) :
+            SimplePager(map->getProfile()),
+            _map(map),
+            _options(options),
+            _cache(true, options.cacheSize().get())
+        {
+            setMinLevel(options.minLevel().get());
+            setMaxLevel(options.maxLevel().get());
+
+            _labelStyle.getOrCreate<TextSymbol>()->fill()->color() = options.indexColor().get();
+            _labelStyle.getOrCreate<TextSymbol>()->halo()->color() = Color::Black;
+            _labelStyle.getOrCreate<TextSymbol>()->size() = 14.0f;
+            _labelStyle.getOrCreate<TextSymbol>()->alignment() = TextSymbol::ALIGN_CENTER_CENTER;
+        }
+
+        osg::ref_ptr<osg::Node> createNode(const TileKey& key, ProgressCallback* progress) override
+        {
+            Cache::Record cached;
+            if (_cache.get(key, cached))
+                return cached.value();
+
+            osg::ref_ptr<const Map> map;
+            if (!_map.lock(map))
+                return nullptr;
+
+            osg::ref_ptr<ElevationTexture> elevation;
+            if (!map->getElevationPool()->getTile(key, true, elevation, nullptr, progress) ||
+                !elevation.valid() ||
+                elevation->getHeightField() == nullptr)
+            {
+                // an empty group still lets the pager subdivide
+                return new osg::Group();
+            }
+
+            if (progress && progress->isCanceled())
+                return nullptr;
+
+            osg::ref_ptr<osg::Node> node = build(elevation.get(), map->getSRS());
+            _cache.insert(key, node);
+            return node;
+        }
+
+    private:
+        osg::observer_ptr<const Map> _map;
+        ContourLayer::Options _options;
+        Style _labelStyle;
+
+        typedef LRUCache<TileKey, osg::ref_ptr<osg::Node> > Cache;
+        Cache _cache;
+
+        osg::ref_ptr<osg::Node> build(const ElevationTexture* elevation, const SpatialReference* srs) const
+        {
+            const osg::HeightField* hf = elevation->getHeightField();
+            const GeoExtent& extent = elevation->getExtent();
+
+            Segments segments;
+            trace(
+                hf,
+                _options.interval()->as(Units::METERS),
+                _options.indexInterval().get(),
+                _options.labels().get(),
+                segments);
+
+            // grid to map coordinates
+            const double dx = extent.width() / (double)(hf->getNumColumns() - 1);
+            const double dy = extent.height() / (double)(hf->getNumRows() - 1);
+            auto toMap = [&](osg::Vec3d& p) {
+                p.set(extent.xMin() + p.x()*dx, extent.yMin() + p.y()*dy, p.z());
+            };
+
+            // Vertices are relative to the tile center to keep float precision
+            osg::Vec3d center;
+            extent.getCentroid(center.x(), center.y());
+            srs->transformToWorld(osg::Vec3d(center.x(), center.y(), 0.0), center);
+
+            osg::MatrixTransform* xform = new osg::MatrixTransform(osg::Matrix::translate(center));
+
+            auto addLines = [&](std::vector<osg::Vec3d>& lines, const Color& color, float width)
+            {
+                if (lines.empty())
+                    return;
+
+                for (auto& p : lines)
+                    toMap(p);
+                srs->transformToWorld(lines);
+
+                LineDrawable* drawable = new LineDrawable(GL_LINES);
+                drawable->reserve(lines.size());
+                for (auto& p : lines)
+                    drawable->pushVertex(p - center);
+                drawable->setColor(color);
+                drawable->setLineWidth(width);
+                drawable->finish();
+                xform->addChild(drawable);
+            };
+
+            addLines(segments._lines, _options.color().get(), _options.lineWidth().get());
+            addLines(segments._indexLines, _options.indexColor().get(), _options.indexLineWidth().get());
+
+            osg::Group* tile = new osg::Group();
+            tile->addChild(xform);
+
+            for (auto& label : segments._labels)
+            {
+                osg::Vec3d p = label.second._point;
+                toMap(p);
+                GeoPoint position(srs, p.x(), p.y(), p.z(), ALTMODE_ABSOLUTE);
+                tile->addChild(new LabelNode(position, Stringify() << (int)p.z(), _labelStyle));
+            }
+
+            return tile;
+        }
+    };
+}
+
+//........................................................................
+
+OE_LAYER_PROPERTY_IMPL(ContourLayer, Distance, Interval, interval);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, unsigned, IndexInterval, indexInterval);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, Color, Color, color);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, Color, IndexColor, indexColor);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, float, LineWidth, lineWidth);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, float, IndexLineWidth, indexLineWidth);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, bool, Labels, labels);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, unsigned, MinLevel, minLevel);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, unsigned, MaxLevel, maxLevel);
+OE_LAYER_PROPERTY_IMPL(ContourLayer, unsigned, CacheSize, cacheSize);
+
+void
+ContourLayer::init()
+{
+    VisibleLayer::init();
+
+    _root = new osg::Group();
+    _root->setStateSet(getOrCreateStateSet());
+
+    GLUtils::setLighting(getOrCreateStateSet(), osg::StateAttribute::OFF);
+
+    // lift the lines off the terrain they lie on
+    DepthOffsetOptions depthOffset;
+    depthOffset.enabled() = true;
+    _depthOffset.setGraph(_root.get());
+    _depthOffset.setDepthOffsetOptions(depthOffset);
+
+    // activate opacity support
+    installDefaultOpacityShader();
+}
+
+osg::Node*
+ContourLayer::getNode() const
+{
+    return _root.get();
+}
+
+Status
+ContourLayer::closeImplementation()
+{
+    if (_root.valid())
+    {
+        ContourGraph* graph = findTopMostNodeOfType<ContourGraph>(_root.get());
+        if (graph) graph->shutdown();
+        _root->removeChildren(0, _root->getNumChildren());
+    }
+    return VisibleLayer::closeImplementation();
+}
+
+void
+ContourLayer::addedToMap(const Map* map)
+{
+    VisibleLayer::addedToMap(map);
+    _map = map;
+    create();
+}
+
+void
+ContourLayer::removedFromMap(const Map* map)
+{
+    VisibleLayer::removedFromMap(map);
+    if (_root.valid())
+    {
+        _root->removeChildren(0, _root->getNumChildren());
+    }
+    _map = nullptr;
+}
+
+void
+ContourLayer::dirty()
+{
+    create();
+}
+
+void
+ContourLayer::create()
+{
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map) || !isOpen())
+        return;
+
+    if (options().interval()->as(Units::METERS) <= 0.0)
+    {
+        setStatus(Status::ConfigurationError, "Contour interval must be positive");
+        return;
+    }
+
+    ContourGraph* old = findTopMostNodeOfType<ContourGraph>(_root.get());
+    if (old) old->shutdown();
+
+    // a new graph comes with an empty cache
+    osg::ref_ptr<ContourGraph> graph = new ContourGraph(map.get(), options());
+    graph->build();
+
+    _root->removeChildren(0, _root->getNumChildren());
+    _root->addChild(graph.get());
+}
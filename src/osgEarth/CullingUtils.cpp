@@ -1012,6 +1012,26 @@ ClipToGeocentricHorizon::operator()(osg::Node* node, osg::NodeVisitor* nv)
 
 //..........................................................................
 
+TileHorizonCullCallback::TileHorizonCullCallback(const osg::BoundingSphered& worldBound) :
+    _worldBound(worldBound)
+{
+    //nop
+}
+
+void
+TileHorizonCullCallback::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    osg::ref_ptr<Horizon> horizon;
+    if (_worldBound.valid() && ObjectStorage::get(nv, horizon))
+    {
+        if (!horizon->isVisible(_worldBound.center(), _worldBound.radius()))
+            return;
+    }
+    traverse(node, nv);
+}
+
+//..........................................................................
+
 void
 AltitudeCullCallback::operator()(osg::Node* node, osg::NodeVisitor* nv)
 {
@@ -31,7 +31,9 @@ using namespace osgEarth;
 
 
 DrapeableNode::DrapeableNode() :
-_drapingEnabled( true )
+_drapingEnabled( true ),
+_static( false ),
+_drapingRevision( 0u )
 {
     // Unfortunetly, there's no way to return a correct bounding sphere for
     // the node since the draping will move it to the ground. The bounds
@@ -43,7 +45,9 @@ _drapingEnabled( true )
 
 DrapeableNode::DrapeableNode(const DrapeableNode& rhs, const osg::CopyOp& copy) :
 osg::Group(rhs, copy),
-_drapingEnabled(rhs._drapingEnabled)
+_drapingEnabled(rhs._drapingEnabled),
+_static(rhs._static),
+_drapingRevision(0u)
 {
     //nop
 }
@@ -55,6 +59,17 @@ DrapeableNode::setDrapingEnabled(bool value)
     {
         _drapingEnabled = value;
         setCullingActive( !_drapingEnabled );
+        dirtyDraping();
+    }
+}
+
+void
+DrapeableNode::setStatic(bool value)
+{
+    if ( value != _static )
+    {
+        _static = value;
+        dirtyDraping();
     }
 }
 
@@ -21,6 +21,7 @@
 */
 #include <osgEarth/DrapingCullSet>
 #include <osgUtil/CullVisitor>
+#include <functional>
 
 #define LC "[DrapingCullSet] "
 
@@ -49,7 +50,9 @@ DrapingManager::get(const osg::Camera* cam)
 
 
 DrapingCullSet::DrapingCullSet() :
-_frameCulled( true )
+_frameCulled( true ),
+_static( false ),
+_signature( 0u )
 {
     // nop
 }
@@ -63,6 +66,8 @@ DrapingCullSet::push(DrapeableNode* node, const osg::NodePath& path, const osg::
         _frameCulled = false;
         _entries.clear();
         _bs.init();
+        _static = true;
+        _signature = 0u;
     }
 
     _entries.emplace_back();
@@ -73,6 +78,18 @@ DrapingCullSet::push(DrapeableNode* node, const osg::NodePath& path, const osg::
     _bs.expandBy( osg::BoundingSphere(
         node->getBound().center() * (*entry._matrix.get()),
         node->getBound().radius() ));
+
+    _static = _static && node->getStatic() && node->getDrapingEnabled();
+
+    // boost-style hash combine over everything that shapes the overlay
+    auto combine = [this](std::size_t h) {
+        _signature ^= h + 0x9e3779b9u + (_signature << 6) + (_signature >> 2);
+    };
+    combine( std::hash<const void*>()(node) );
+    combine( std::hash<unsigned>()(node->getDrapingRevision()) );
+    const osg::Matrix::value_type* m = entry._matrix->ptr();
+    for(unsigned i=0; i<16; ++i)
+        combine( std::hash<osg::Matrix::value_type>()(m[i]) );
 }
 
 void
@@ -24,9 +24,11 @@
 #include <osgEarth/Registry>
 #include <osgEarth/Shaders>
 #include <osgEarth/Lighting>
+#include <osgEarth/GPUTimer>
 
 #include <osg/BlendFunc>
 #include <osg/Texture2D>
+#include <osg/BoundingBox>
 
 #define LC "[DrapingTechnique] "
 
@@ -123,6 +125,12 @@ namespace
 
         osg::ref_ptr<osg::Uniform> _texGenUniform;
 
+        // last capture of a static overlay, reused until it goes stale
+        bool        _captured;
+        std::size_t _capturedSignature;
+        osg::Matrix _capturedView;
+        osg::Matrix _capturedProj;
+
         void resizeGLObjectBuffers(unsigned maxSize) {
             if (_texGenUniform.valid())
                 _texGenUniform->resizeGLObjectBuffers(maxSize);
@@ -132,9 +140,50 @@ namespace
                 _texGenUniform->releaseGLObjects(state);
         }
 
-        LocalPerViewData() { }
-        LocalPerViewData(const LocalPerViewData& rhs, const osg::CopyOp& co) { }
+        LocalPerViewData() : _captured(false), _capturedSignature(0u) { }
+        LocalPerViewData(const LocalPerViewData& rhs, const osg::CopyOp& co) : _captured(false), _capturedSignature(0u) { }
     };
+
+    // fraction of the captured clip space the current RTT region must fill
+    // for the capture to keep its resolution; anything less means the view
+    // has zoomed in and the overlay should be re-rendered.
+    const double MIN_CAPTURE_FILL = 0.5;
+
+    // Whether a capture taken with (capturedView, capturedProj) still covers
+    // the region the current RTT matrices would render, at adequate resolution.
+    bool captureCovers(
+        const osg::Matrix& capturedView, const osg::Matrix& capturedProj,
+        const osg::Matrix& view, const osg::Matrix& proj,
+        double margin)
+    {
+        osg::Matrix currentToCaptured;
+        if (!currentToCaptured.invert(view * proj))
+            return false;
+        currentToCaptured.postMult(capturedView * capturedProj);
+
+        osg::BoundingBoxd box;
+        for (int i = 0; i < 8; ++i)
+        {
+            osg::Vec4d corner(
+                (i & 1) ? 1.0 : -1.0,
+                (i & 2) ? 1.0 : -1.0,
+                (i & 4) ? 1.0 : -1.0,
+                1.0);
+
+            osg::Vec4d c = corner * currentToCaptured;
+            if (c.w() <= 0.0)
+                return false;
+
+            box.expandBy(c.x() / c.w(), c.y() / c.w(), 0.0);
+        }
+
+        if (box.xMin() < -1.0 || box.xMax() > 1.0 || box.yMin() < -1.0 || box.yMax() > 1.0)
+            return false;
+
+        // a fresh capture fills 1/margin of the clip extent
+        double fill = osg::maximum(box.xMax() - box.xMin(), box.yMax() - box.yMin()) * 0.5;
+        return fill >= MIN_CAPTURE_FILL / margin;
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -378,7 +427,8 @@ _textureSize     ( 1024 ),
 _mipmapping      ( false ),
 _rttBlending     ( true ),
 _attachStencil   ( false ),
-_maxFarNearRatio ( 5.0 )
+_maxFarNearRatio ( 5.0 ),
+_cacheStaticOverlays( true )
 {
     _supported = Registry::capabilities().supportsGLSL();
 
@@ -458,6 +508,7 @@ DrapingTechnique::setUpCamera(OverlayDecorator::TechRTTParams& params)
     params._rttCamera->setRenderTargetImplementation( osg::Camera::FRAME_BUFFER_OBJECT );
     params._rttCamera->setImplicitBufferAttachmentMask(0, 0);
     params._rttCamera->attach( osg::Camera::COLOR_BUFFER0, projTexture, 0, 0, _mipmapping );
+    GPUTimer::install(params._rttCamera.get(), "draping");
 
     if ( _attachStencil )
     {
@@ -647,10 +698,43 @@ DrapingTechnique::cullOverlayGroup(OverlayDecorator::TechRTTParams& params,
             optimizeProjectionMatrix( params, _maxFarNearRatio );
         }
 
-        params._rttCamera->setViewMatrix      ( params._rttViewMatrix );
-        params._rttCamera->setProjectionMatrix( params._rttProjMatrix );
+        const DrapingCullSet& cullSet = _drapingManager->get(cv->getCurrentCamera());
+        bool capture = true;
 
-        osg::Matrix VPT = params._rttViewMatrix * params._rttProjMatrix * s_scaleBiasMat;
+        if ( _cacheStaticOverlays && cullSet.isStatic() )
+        {
+            // Nothing in the overlay changes from frame to frame, so the last
+            // capture is good as long as it still covers the visible region.
+            // Captures are taken with some room to spare so that small camera
+            // motions don't trigger a re-render.
+            const double margin = 1.25;
+
+            if (local._captured &&
+                local._capturedSignature == cullSet.getSignature() &&
+                captureCovers(local._capturedView, local._capturedProj,
+                              params._rttViewMatrix, params._rttProjMatrix, margin))
+            {
+                capture = false;
+            }
+            else
+            {
+                local._capturedView = params._rttViewMatrix;
+                local._capturedProj = params._rttProjMatrix * osg::Matrix::scale(1.0/margin, 1.0/margin, 1.0);
+                local._capturedSignature = cullSet.getSignature();
+                local._captured = true;
+            }
+        }
+        else
+        {
+            local._capturedView = params._rttViewMatrix;
+            local._capturedProj = params._rttProjMatrix;
+            local._captured = false;
+        }
+
+        params._rttCamera->setViewMatrix      ( local._capturedView );
+        params._rttCamera->setProjectionMatrix( local._capturedProj );
+
+        osg::Matrix VPT = local._capturedView * local._capturedProj * s_scaleBiasMat;
 
         if ( local._texGenUniform.valid() )
         {
@@ -671,8 +755,12 @@ DrapingTechnique::cullOverlayGroup(OverlayDecorator::TechRTTParams& params,
             local._texGenUniform->set( vm * VPT );
         }
 
-        // traverse the overlay group (via the RTT camera).
-        static_cast<DrapingCamera*>(params._rttCamera.get())->accept( *cv, cv->getCurrentCamera() );
+        // traverse the overlay group (via the RTT camera). Skipping it leaves
+        // the previous contents in the overlay texture.
+        if ( capture )
+        {
+            static_cast<DrapingCamera*>(params._rttCamera.get())->accept( *cv, cv->getCurrentCamera() );
+        }
     }
 }
 
@@ -744,6 +832,18 @@ DrapingTechnique::getResolutionRatio() const
     return (float)_maxFarNearRatio;
 }
 
+void
+DrapingTechnique::setCacheStaticOverlays(bool value)
+{
+    _cacheStaticOverlays = value;
+}
+
+bool
+DrapingTechnique::getCacheStaticOverlays() const
+{
+    return _cacheStaticOverlays;
+}
+
 void
 DrapingTechnique::onInstall( TerrainEngineNode* engine )
 {
@@ -24,8 +24,12 @@
 #include <osgEarth/Shaders>
 #include <osgEarth/ObjectIndex>
 #include <osgEarth/TextureBuffer>
+#include <osgEarth/GLUtils>
+#include <osgEarth/ShaderLoader>
+#include <osgEarth/Threading>
 
 #include <osg/ComputeBoundsVisitor>
+#include <osg/Polytope>
 #include <osgDB/ObjectWrapper>
 #include <osgUtil/Optimizer>
 
@@ -36,6 +40,16 @@ using namespace osgEarth::Util;
 
 // Ref: http://sol.gfxile.net/instancing.html
 
+// must match Instancing.CS.glsl and Instancing.glsl
+#define WORK_GROUP_SIZE 64u
+#define MAX_WORK_GROUPS_X 65535u
+#define BINDING_COMMAND_BUFFER 0
+#define BINDING_VISIBLE_BUFFER 3
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
 //Uncomment to experiment with instance count adjustment
 //#define USE_INSTANCE_LODS
 
@@ -137,6 +151,371 @@ namespace
 
 }
 
+namespace
+{
+    // Shared by all the culled drawables; one link per context.
+    osg::Program* getCullProgram()
+    {
+        static osg::ref_ptr<osg::Program> s_program;
+        static Threading::Mutex s_mutex;
+        Threading::ScopedMutexLock lock(s_mutex);
+        if (!s_program.valid())
+        {
+            Shaders package;
+            std::string source = ShaderLoader::load(package.InstancingCull, package);
+            s_program = new osg::Program();
+            s_program->setName("DrawInstanced GPU cull");
+            s_program->addShader(new osg::Shader(osg::Shader::COMPUTE, source));
+        }
+        return s_program.get();
+    }
+}
+
+namespace osgEarth { namespace Util { namespace DrawInstanced
+{
+    /**
+     * Draws an instanced geometry through a visible list built on the GPU.
+     * Before each draw a compute pass tests every instance against the
+     * frustum and this drawable's LOD range and writes the survivors and
+     * their count into a visible buffer and one indirect command per
+     * primitive set. If the pass can't run, the visible buffer keeps its
+     * identity contents and the geometry draws all instances as usual.
+     * Serializable, since the OE_DI_GPU_CULL define that depends on it
+     * lives in the (cached) scene graph too.
+     */
+    class GPUCullCallback : public osg::Drawable::DrawCallback
+    {
+    public:
+        META_Object(osgEarth::Util::DrawInstanced, GPUCullCallback);
+
+        // Elements and arrays commands share this stride; see the shader.
+        struct DrawCommand
+        {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint first;
+            GLuint baseVertex;
+            GLuint baseInstance;
+        };
+
+        struct GLObjects
+        {
+            GLObjects() : _culling(false) { }
+            osg::ref_ptr<GLBuffer> _commandBuffer;
+            osg::ref_ptr<GLBuffer> _visibleBuffer;
+            bool _culling;
+            GLint _numInstancesUL, _numCommandsUL, _tboUL;
+            GLint _frustumUL, _boundUL, _eyeUL, _lodCenterUL, _lodRangeUL;
+        };
+
+        GPUCullCallback() :
+            _numInstances(0u),
+            _minRange(0.0f),
+            _maxRange(FLT_MAX),
+            _indirect(true)
+        {
+            //nop
+        }
+
+        GPUCullCallback(const GPUCullCallback& rhs, const osg::CopyOp& copyop = osg::CopyOp::SHALLOW_COPY) :
+            osg::Drawable::DrawCallback(rhs, copyop),
+            _numInstances(rhs._numInstances),
+            _bound(rhs._bound),
+            _lodCenter(rhs._lodCenter),
+            _minRange(rhs._minRange),
+            _maxRange(rhs._maxRange),
+            _tboUniform(rhs._tboUniform),
+            _indirect(true)
+        {
+            //nop
+        }
+
+        GPUCullCallback(
+            unsigned                numInstances,
+            const osg::BoundingBox& localBox,
+            const osg::Vec3f&       lodCenter,
+            float                   minRange,
+            float                   maxRange,
+            osg::Uniform*           tboUniform) :
+            _numInstances(numInstances),
+            _bound(localBox.center(), localBox.radius()),
+            _lodCenter(lodCenter),
+            _minRange(minRange),
+            _maxRange(maxRange),
+            _tboUniform(tboUniform),
+            _indirect(true)
+        {
+            //nop
+        }
+
+        void setNumInstances(unsigned value) { _numInstances = value; }
+        unsigned getNumInstances() const { return _numInstances; }
+
+        //! Bounding sphere of one un-instanced drawable (center, radius)
+        void setBound(const osg::Vec4f& value) { _bound = value; }
+        const osg::Vec4f& getBound() const { return _bound; }
+
+        void setLODCenter(const osg::Vec3f& value) { _lodCenter = value; }
+        const osg::Vec3f& getLODCenter() const { return _lodCenter; }
+
+        void setMinRange(float value) { _minRange = value; }
+        float getMinRange() const { return _minRange; }
+
+        void setMaxRange(float value) { _maxRange = value; }
+        float getMaxRange() const { return _maxRange; }
+
+        void setTBOUniform(osg::Uniform* value) { _tboUniform = value; }
+        const osg::Uniform* getTBOUniform() const { return _tboUniform.get(); }
+
+        //! One command per primitive set, with the instance count zeroed
+        void buildCommands(const osg::Geometry& geom) const
+        {
+            Threading::ScopedMutexLock lock(_commandsMutex);
+            if (!_commands.empty())
+                return;
+
+            for (unsigned p = 0; p < geom.getNumPrimitiveSets(); ++p)
+            {
+                const osg::PrimitiveSet* ps = geom.getPrimitiveSet(p);
+                DrawCommand cmd = { 0u, 0u, 0u, 0u, 0u };
+
+                if (ps->getDrawElements())
+                {
+                    cmd.count = ps->getNumIndices();
+                }
+                else if (ps->getType() == osg::PrimitiveSet::DrawArraysPrimitiveType)
+                {
+                    const osg::DrawArrays* da = static_cast<const osg::DrawArrays*>(ps);
+                    cmd.count = da->getCount();
+                    cmd.first = da->getFirst();
+                }
+                else
+                {
+                    // no indirect form for array lengths; draw everything
+                    _indirect = false;
+                }
+                _commands.push_back(cmd);
+            }
+        }
+
+        void drawImplementation(osg::RenderInfo& ri, const osg::Drawable* drawable) const
+        {
+            const osg::Geometry* geom = drawable->asGeometry();
+            if (geom == nullptr || geom->getNumPrimitiveSets() == 0)
+            {
+                drawable->drawImplementation(ri);
+                return;
+            }
+
+            osg::State& state = *ri.getState();
+            osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+            GLObjects& gl = _globjects[state.getContextID()];
+
+            if (!gl._visibleBuffer.valid())
+            {
+                buildCommands(*geom);
+                allocateGLObjects(state, gl);
+            }
+
+            if (gl._culling)
+            {
+                gl._culling = cull(ri, gl);
+            }
+
+            ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_VISIBLE_BUFFER, gl._visibleBuffer->name());
+
+            if (!gl._culling)
+            {
+                drawable->drawImplementation(ri);
+                return;
+            }
+
+            GLFunctions& f = GLFunctions::get(state);
+
+            geom->drawVertexArraysImplementation(ri);
+
+            gl._commandBuffer->bind(GL_DRAW_INDIRECT_BUFFER);
+
+            for (unsigned p = 0; p < geom->getNumPrimitiveSets() && p < _commands.size(); ++p)
+            {
+                const osg::PrimitiveSet* ps = geom->getPrimitiveSet(p);
+                const void* offset = (const void*)(p * sizeof(DrawCommand));
+                const osg::DrawElements* de = ps->getDrawElements();
+                if (de)
+                {
+                    state.bindElementBufferObject(de->getOrCreateGLBufferObject(state.getContextID()));
+                    f.glDrawElementsIndirect(ps->getMode(), de->getDataType(), offset);
+                }
+                else
+                {
+                    f.glDrawArraysIndirect(ps->getMode(), offset);
+                }
+            }
+
+            ext->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            state.unbindElementBufferObject();
+            state.unbindVertexBufferObject();
+        }
+
+        void allocateGLObjects(osg::State& state, GLObjects& gl) const
+        {
+            GLFunctions& f = GLFunctions::get(state);
+
+            // identity list, so a frame without the compute pass draws everything
+            std::vector<GLuint> identity(_numInstances);
+            for (unsigned i = 0; i < _numInstances; ++i)
+                identity[i] = i;
+
+            gl._visibleBuffer = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.di.visible");
+            state.get<osg::GLExtensions>()->glBufferData(
+                GL_SHADER_STORAGE_BUFFER,
+                identity.size() * sizeof(GLuint),
+                identity.data(),
+                GL_DYNAMIC_COPY);
+
+            gl._culling =
+                _indirect &&
+                _numInstances > 0u &&
+                f.glDrawElementsIndirect != nullptr &&
+                f.glDrawArraysIndirect != nullptr &&
+                state.get<osg::GLExtensions>()->glDispatchCompute != nullptr;
+
+            if (!gl._culling)
+                return;
+
+            osg::Program::PerContextProgram* pcp = getCullProgram()->getPCP(state);
+            if (pcp->needsLink())
+            {
+                pcp->linkProgram(state);
+            }
+
+            if (!pcp->isLinked())
+            {
+                OE_WARN << LC << "GPU cull program failed to link; drawing all instances" << std::endl;
+                gl._culling = false;
+                return;
+            }
+
+            gl._numInstancesUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_numInstances"));
+            gl._numCommandsUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_numCommands"));
+            gl._tboUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_postex_TBO"));
+            gl._frustumUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_frustum"));
+            gl._boundUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_bound"));
+            gl._eyeUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_eye"));
+            gl._lodCenterUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_lodCenter"));
+            gl._lodRangeUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_di_lodRange"));
+
+            gl._commandBuffer = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.di.commands");
+            f.glBufferStorage(
+                GL_SHADER_STORAGE_BUFFER,
+                _commands.size() * sizeof(DrawCommand),
+                nullptr,                 // uninitialized memory
+                GL_DYNAMIC_STORAGE_BIT); // so we can reset each draw
+        }
+
+        //! Runs the compute pass. Returns false if it can't.
+        bool cull(osg::RenderInfo& ri, GLObjects& gl) const
+        {
+            osg::State& state = *ri.getState();
+            osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+
+            int unit = -1;
+            if (!_tboUniform.valid() || !_tboUniform->get(unit) || unit < 0)
+                return false;
+
+            // Everything goes to the shader in model space.
+            const osg::Matrix& mv = state.getModelViewMatrix();
+            osg::Matrix mvp = mv * state.getProjectionMatrix();
+
+            osg::Polytope frustum;
+            frustum.setToUnitFrustum(true, true);
+            frustum.transformProvidingInverse(mvp);
+
+            GLfloat planes[6u * 4u];
+            for (unsigned p = 0; p < 6u; ++p)
+            {
+                const osg::Plane& plane = frustum.getPlaneList()[p];
+                for (unsigned j = 0; j < 4u; ++j)
+                    planes[p * 4u + j] = (GLfloat)plane[j];
+            }
+
+            osg::Vec3d eye = osg::Vec3d(0, 0, 0) * osg::Matrix::inverse(mv);
+
+            float lodScale = ri.getCurrentCamera() ? ri.getCurrentCamera()->getLODScale() : 1.0f;
+            if (lodScale <= 0.0f)
+                lodScale = 1.0f;
+
+            // reset the instance counts
+            gl._commandBuffer->bind();
+            ext->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, _commands.size() * sizeof(DrawCommand), _commands.data());
+
+            osg::Program::PerContextProgram* pcp = getCullProgram()->getPCP(state);
+            pcp->useProgram();
+
+            ext->glUniform1i(gl._numInstancesUL, (GLint)_numInstances);
+            ext->glUniform1i(gl._numCommandsUL, (GLint)_commands.size());
+            ext->glUniform1i(gl._tboUL, unit);
+            ext->glUniform4fv(gl._frustumUL, 6, planes);
+            ext->glUniform4f(gl._boundUL, _bound.x(), _bound.y(), _bound.z(), _bound.w());
+            ext->glUniform3f(gl._eyeUL, (GLfloat)eye.x(), (GLfloat)eye.y(), (GLfloat)eye.z());
+            ext->glUniform3f(gl._lodCenterUL, _lodCenter.x(), _lodCenter.y(), _lodCenter.z());
+            ext->glUniform2f(gl._lodRangeUL, _minRange / lodScale, _maxRange < FLT_MAX ? _maxRange / lodScale : FLT_MAX);
+
+            ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_COMMAND_BUFFER, gl._commandBuffer->name());
+            ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_VISIBLE_BUFFER, gl._visibleBuffer->name());
+
+            GLuint numGroups = (_numInstances + WORK_GROUP_SIZE - 1u) / WORK_GROUP_SIZE;
+            GLuint groupsX = std::min(numGroups, MAX_WORK_GROUPS_X);
+            GLuint groupsY = (numGroups + groupsX - 1u) / groupsX;
+            ext->glDispatchCompute(groupsX, groupsY, 1);
+
+            // the vertex shader reads the list, the draw reads the counts
+            ext->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+            // Put back whatever program was active without telling osg::State it ever changed.
+            const osg::Program::PerContextProgram* last = state.getLastAppliedProgramObject();
+            if (last)
+                last->useProgram();
+            else
+                ext->glUseProgram(0);
+
+            return true;
+        }
+
+        void resizeGLObjectBuffers(unsigned maxSize)
+        {
+            _globjects.resize(maxSize);
+        }
+
+        void releaseGLObjects(osg::State* state) const
+        {
+            if (state)
+            {
+                GLObjects& gl = _globjects[state->getContextID()];
+                gl = GLObjects();
+            }
+            else
+            {
+                for (unsigned i = 0; i < _globjects.size(); ++i)
+                    _globjects[i] = GLObjects();
+            }
+        }
+
+    protected:
+        virtual ~GPUCullCallback() { }
+
+        unsigned _numInstances;
+        osg::Vec4f _bound;
+        osg::Vec3f _lodCenter;
+        float _minRange, _maxRange;
+        osg::ref_ptr<osg::Uniform> _tboUniform;
+        mutable std::vector<DrawCommand> _commands;
+        mutable bool _indirect;
+        mutable Threading::Mutex _commandsMutex;
+        mutable osg::buffered_object<GLObjects> _globjects;
+    };
+} } }
+
 //----------------------------------------------------------------------
 
 
@@ -161,11 +540,13 @@ _numInstances( numInstances ),
 _bbox(bbox),
 _optimize( optimize ),
 _tbo(tbo),
-_tboUnit(defaultUnit)
+_tboUnit(defaultUnit),
+_useGPUCulling(false)
 {
     setTraversalMode( TRAVERSE_ALL_CHILDREN );
     setNodeMaskOverride( ~0 );
     _bboxComputer = new StaticBBox(bbox);
+    _tboUniform = new osg::Uniform(osg::Uniform::SAMPLER_BUFFER, "oe_di_postex_TBO");
 }
 
 
@@ -182,6 +563,9 @@ ConvertToDrawInstanced::apply(osg::Drawable& drawable)
             geom->setUseVertexBufferObjects( true );
         }
 
+        // the bounds of one instance, before we replace them:
+        osg::BoundingBox localBox = geom->getBoundingBox();
+
         geom->setComputeBoundingBoxCallback(_bboxComputer.get());
         geom->dirtyBound();
 
@@ -196,6 +580,16 @@ ConvertToDrawInstanced::apply(osg::Drawable& drawable)
 #ifdef USE_INSTANCE_LODS
         geom->setDrawCallback( new LODCallback() );
 #endif
+
+        if ( _useGPUCulling && localBox.valid() )
+        {
+            LODRange range = { 0.0f, FLT_MAX, localBox.center() };
+            if ( !_lodStack.empty() )
+                range = _lodStack.back();
+
+            geom->setDrawCallback( new GPUCullCallback(
+                _numInstances, localBox, range.center, range.minRange, range.maxRange, _tboUniform.get()) );
+        }
     }
     apply(static_cast<osg::Node&>(drawable));
 }
@@ -203,6 +597,47 @@ ConvertToDrawInstanced::apply(osg::Drawable& drawable)
 void
 ConvertToDrawInstanced::apply(osg::LOD& lod)
 {
+    // With GPU culling each instance picks its own level, so keep them all
+    // and let the cull pass apply the ranges against the instance's LOD center.
+    if ( _useGPUCulling && lod.getRangeMode() == osg::LOD::DISTANCE_FROM_EYE_POINT )
+    {
+        osg::Vec3f center = lod.getCenterMode() == osg::LOD::USER_DEFINED_CENTER ?
+            osg::Vec3f(lod.getCenter()) :
+            osg::Vec3f(lod.getBound().center());
+
+        std::vector<osg::ref_ptr<osg::Node> > children;
+        std::vector<LODRange> ranges;
+        for(unsigned i=0; i<lod.getNumChildren() && i<lod.getNumRanges(); ++i)
+        {
+            LODRange range = { lod.getMinRange(i), lod.getMaxRange(i), center };
+            if ( !_lodStack.empty() )
+            {
+                // nested LODs, keep the overlap
+                range.minRange = osg::maximum(range.minRange, _lodStack.back().minRange);
+                range.maxRange = osg::minimum(range.maxRange, _lodStack.back().maxRange);
+            }
+            children.push_back( lod.getChild(i) );
+            ranges.push_back( range );
+        }
+
+        // every level is always traversed; the GPU does the selecting.
+        lod.removeChildren( 0, lod.getNumChildren() );
+        for(unsigned i=0; i<children.size(); ++i)
+        {
+            lod.addChild( children[i].get(), 0.0f, FLT_MAX );
+
+            _lodStack.push_back( ranges[i] );
+            children[i]->accept( *this );
+            _lodStack.pop_back();
+        }
+
+        if ( lod.getStateSet() )
+        {
+            _tboUnit = osg::maximum(_tboUnit, (int)lod.getStateSet()->getNumTextureAttributeLists());
+        }
+        return;
+    }
+
     // find the highest LOD:
     int   minIndex = 0;
     float minRange = FLT_MAX;
@@ -254,6 +689,13 @@ DrawInstanced::install(osg::StateSet* stateset)
     return true;
 }
 
+bool
+DrawInstanced::supportsGPUCulling()
+{
+    return
+        Registry::capabilities().supportsDrawInstanced() &&
+        Registry::capabilities().getGLSLVersion() >= 4.3f;
+}
 
 void
 DrawInstanced::remove(osg::StateSet* stateset)
@@ -364,16 +806,35 @@ namespace osgEarth {
                 ADD_USER_SERIALIZER(Matrices);
             }
         }
+
+        namespace GPUCullCallback
+        {
+            REGISTER_OBJECT_WRAPPER(
+                GPUCullCallback,
+                new osgEarth::Util::DrawInstanced::GPUCullCallback,
+                osgEarth::Util::DrawInstanced::GPUCullCallback,
+                "osg::Object osg::Callback osgEarth::Util::DrawInstanced::GPUCullCallback")
+            {
+                ADD_UINT_SERIALIZER(NumInstances, 0u);
+                ADD_VEC4F_SERIALIZER(Bound, osg::Vec4f());
+                ADD_VEC3F_SERIALIZER(LODCenter, osg::Vec3f());
+                ADD_FLOAT_SERIALIZER(MinRange, 0.0f);
+                ADD_FLOAT_SERIALIZER(MaxRange, FLT_MAX);
+                ADD_OBJECT_SERIALIZER(TBOUniform, osg::Uniform, NULL);
+            }
+        }
     }
 }
 
 
 bool
-DrawInstanced::convertGraphToUseDrawInstanced( osg::Group* parent )
+DrawInstanced::convertGraphToUseDrawInstanced( osg::Group* parent, bool useGPUCulling )
 {
     if ( !Registry::capabilities().supportsDrawInstanced() )
         return false;
 
+    useGPUCulling = useGPUCulling && supportsGPUCulling();
+
     // place a static bounding sphere on the graph since we intend to alter
     // the structure of the subgraph.
     const osg::BoundingSphere& bs = parent->getBound();
@@ -522,12 +983,20 @@ DrawInstanced::convertGraphToUseDrawInstanced( osg::Group* parent )
         // same time, assign our computed bounding box as the static bounds for all
         // geometries. (As DI's they cannot report bounds naturally.)
         ConvertToDrawInstanced cdi(numInstancesToStore, bbox, true, posTBO, 0);
+        cdi.setUseGPUCulling( useGPUCulling );
         node->accept( cdi );
 
         // Bind the TBO sampler:
         osg::StateSet* stateset = instanceGroup->getOrCreateStateSet();
         stateset->setTextureAttribute(cdi.getTextureImageUnit(), posTBO);
-        stateset->getOrCreateUniform("oe_di_postex_TBO", osg::Uniform::SAMPLER_BUFFER)->set(cdi.getTextureImageUnit());
+        cdi.getTBOUniform()->set(cdi.getTextureImageUnit());
+        stateset->addUniform(cdi.getTBOUniform());
+
+        if ( useGPUCulling )
+        {
+            // the vertex shader reads instances through the visible list
+            stateset->setDefine("OE_DI_GPU_CULL");
+        }
 
         // Tell the SG to skip the positioning TBO.
         ShaderGenerator::setIgnoreHint(posTBO, true);
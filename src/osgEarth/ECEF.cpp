@@ -51,14 +51,15 @@ ECEF::transformAndLocalize(const std::vector<osg::Vec3d>& input,
     if (inputSRS==NULL || outputSRS==NULL)
         return false;
 
-    const SpatialReference* geocentricSRS = outputSRS->getGeocentricSRS();
-    output->reserve( output->size() + input.size() );
+    // one batch transform instead of one per point
+    std::vector<osg::Vec3d> geoc( input );
+    inputSRS->transform( geoc, outputSRS->getGeocentricSRS() );
 
-    for( std::vector<osg::Vec3d>::const_iterator i = input.begin(); i != input.end(); ++i )
+    output->reserve( output->size() + geoc.size() );
+
+    for( std::vector<osg::Vec3d>::const_iterator i = geoc.begin(); i != geoc.end(); ++i )
     {
-        osg::Vec3d geoc;
-        inputSRS->transform( *i, geocentricSRS, geoc );
-        output->push_back( geoc * world2local );
+        output->push_back( (*i) * world2local );
     }
 
     return true;
@@ -76,14 +77,14 @@ ECEF::transformAndLocalize(const std::vector<osg::Vec3d>& input,
     if (inputSRS==NULL || outputSRS==NULL)
         return false;
 
-    const SpatialReference* ecefSRS = outputSRS->getGeocentricSRS();
-    out_verts->reserve( out_verts->size() + input.size() );
+    std::vector<osg::Vec3d> ecef( input );
+    inputSRS->transform( ecef, outputSRS->getGeocentricSRS() );
+
+    out_verts->reserve( out_verts->size() + ecef.size() );
     
-    for( std::vector<osg::Vec3d>::const_iterator i = input.begin(); i != input.end(); ++i )
+    for( std::vector<osg::Vec3d>::const_iterator i = ecef.begin(); i != ecef.end(); ++i )
     {
-        osg::Vec3d ecef;
-        inputSRS->transform( *i, ecefSRS, ecef );
-        out_verts->push_back( ecef * world2local );
+        out_verts->push_back( (*i) * world2local );
     }
 
     if ( out_normals )
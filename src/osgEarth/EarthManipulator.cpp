@@ -295,6 +295,7 @@ _max_vp_duration_s              ( 8.0 ),
 _orthoTracksPerspective         ( true ),
 _terrainAvoidanceEnabled        ( true ),
 _terrainAvoidanceMinDistance    ( 1.0 ),
+_useElevationPool               ( false ),
 _throwingEnabled                ( false ),
 _throwDecayRate                 ( 0.05 ),
 _zoomToMouse                    ( false )
@@ -327,6 +328,7 @@ _orthoTracksPerspective( rhs._orthoTracksPerspective ),
 _breakTetherActions( rhs._breakTetherActions ),
 _terrainAvoidanceEnabled( rhs._terrainAvoidanceEnabled ),
 _terrainAvoidanceMinDistance( rhs._terrainAvoidanceMinDistance ),
+_useElevationPool( rhs._useElevationPool ),
 _throwingEnabled( rhs._throwingEnabled ),
 _throwDecayRate( rhs._throwDecayRate ),
 _zoomToMouse( rhs._zoomToMouse )
@@ -1362,6 +1364,13 @@ void EarthManipulator::collisionDetect()
 bool
 EarthManipulator::intersect(const osg::Vec3d& start, const osg::Vec3d& end, osg::Vec3d& intersection, osg::Vec3d& normal) const
 {
+    if (_settings.valid() && _settings->getUseElevationPoolIntersections())
+    {
+        bool hit;
+        if (intersectElevation(start, end, hit, intersection, normal))
+            return hit;
+    }
+
     osg::ref_ptr<MapNode> mapNode;
     if ( _mapNode.lock(mapNode) && mapNode->getTerrainEngine() )
     {
@@ -1384,6 +1393,164 @@ EarthManipulator::intersect(const osg::Vec3d& start, const osg::Vec3d& end, osg:
     return false;
 }
 
+namespace
+{
+    // Altitudes that bound any terrain, so a ray is only marched where
+    // it could possibly hit
+    const double MAX_TERRAIN_HEIGHT = 9000.0;
+    const double MIN_TERRAIN_HEIGHT = -12000.0;
+
+    // Samples marched along a ray, and bisection steps to refine a hit
+    const unsigned MARCH_SAMPLES = 128u;
+    const unsigned REFINE_STEPS = 16u;
+
+    // Clips the segment start + t*dir, t in [t0,t1], to the inside of a sphere
+    bool clipToSphere(const osg::Vec3d& start, const osg::Vec3d& dir, double R, double& t0, double& t1)
+    {
+        double a = dir * dir;
+        double b = 2.0 * (start * dir);
+        double c = start * start - R*R;
+        double disc = b*b - 4.0*a*c;
+        if (a <= 0.0 || disc < 0.0)
+            return false;
+        double root = sqrt(disc);
+        t0 = osg::maximum(t0, (-b - root) / (2.0*a));
+        t1 = osg::minimum(t1, (-b + root) / (2.0*a));
+        return t0 < t1;
+    }
+}
+
+bool
+EarthManipulator::intersectElevation(const osg::Vec3d& start,
+                                     const osg::Vec3d& end,
+                                     bool& out_hit,
+                                     osg::Vec3d& intersection,
+                                     osg::Vec3d& normal) const
+{
+    osg::ref_ptr<MapNode> mapNode;
+    if (!_mapNode.lock(mapNode) || !_srs.valid() || !mapNode->getMap())
+        return false;
+
+    ElevationPool* pool = mapNode->getMap()->getElevationPool();
+    if (!pool)
+        return false;
+
+    const SpatialReference* srs = mapNode->getMapSRS();
+    osg::Vec3d dir = end - start;
+    double length = dir.length();
+    if (length <= 0.0)
+        return false;
+
+    // Only march the part of the ray that's within the terrain's altitude range.
+    double t0 = 0.0, t1 = 1.0;
+    if (mapNode->isGeocentric())
+    {
+        const Ellipsoid* e = srs->getEllipsoid();
+        if (!clipToSphere(start, dir, e->getRadiusEquator() + MAX_TERRAIN_HEIGHT, t0, t1))
+        {
+            out_hit = false;
+            return true;
+        }
+    }
+    else
+    {
+        double z0 = start.z(), z1 = end.z();
+        if (z0 != z1)
+        {
+            double ta = (MAX_TERRAIN_HEIGHT - z0) / (z1 - z0);
+            double tb = (MIN_TERRAIN_HEIGHT - z0) / (z1 - z0);
+            t0 = osg::maximum(t0, osg::minimum(ta, tb));
+            t1 = osg::minimum(t1, osg::maximum(ta, tb));
+        }
+        if (t0 >= t1 || (z0 == z1 && (z0 > MAX_TERRAIN_HEIGHT || z0 < MIN_TERRAIN_HEIGHT)))
+        {
+            out_hit = false;
+            return true;
+        }
+    }
+
+    // Samples grow farther apart with distance from the start, and coarser:
+    // each one reads the elevation at about its own spacing, so distant
+    // steps come from low-resolution tiles, like levels of a pyramid.
+    double d0 = t0 * length, d1 = t1 * length;
+    double first = osg::maximum(1.0, (d1 - d0) * 1e-5);
+    double ratio = pow((d1 - d0) / first, 1.0 / (double)(MARCH_SAMPLES - 2u));
+
+    // meters to map units, roughly, for the sampling resolution:
+    double toMapUnits = srs->isGeographic() ? 1.0 / 111000.0 : 1.0;
+
+    std::vector<double> dists(MARCH_SAMPLES);
+    std::vector<osg::Vec4d> points(MARCH_SAMPLES);
+    std::vector<double> heights(MARCH_SAMPLES);
+    dists[0] = d0;
+    for (unsigned i = 1; i < MARCH_SAMPLES; ++i)
+        dists[i] = osg::minimum(d0 + first * pow(ratio, (double)(i - 1u)), d1);
+
+    for (unsigned i = 0; i < MARCH_SAMPLES; ++i)
+    {
+        osg::Vec3d world = start + dir * (dists[i] / length);
+        osg::Vec3d map;
+        if (!srs->transformFromWorld(world, map))
+            return false;
+        double spacing = i + 1u < MARCH_SAMPLES ? dists[i + 1u] - dists[i] : dists[i] - dists[i - 1u];
+        points[i].set(map.x(), map.y(), 0.0, osg::maximum(spacing, 1.0) * toMapUnits);
+        heights[i] = map.z();
+    }
+
+    if (pool->sampleMapCoords(points, &_elevationWorkingSet, nullptr) < 0)
+        return false;
+
+    // Find the first sample under the ground.
+    unsigned under = MARCH_SAMPLES;
+    for (unsigned i = 0; i < MARCH_SAMPLES && under == MARCH_SAMPLES; ++i)
+    {
+        // missing data around a hit means the answer is a guess
+        if (points[i].z() == NO_DATA_VALUE)
+            return false;
+        if (heights[i] <= points[i].z())
+            under = i;
+    }
+
+    if (under == MARCH_SAMPLES)
+    {
+        out_hit = false;
+        return true;
+    }
+
+    // Bisect between the last sample above the ground and the first one below.
+    double lo = under > 0u ? dists[under - 1u] : dists[0];
+    double hi = dists[under];
+    std::vector<osg::Vec4d> probe(1);
+    for (unsigned step = 0; step < REFINE_STEPS && under > 0u; ++step)
+    {
+        double mid = 0.5*(lo + hi);
+        osg::Vec3d map;
+        if (!srs->transformFromWorld(start + dir * (mid / length), map))
+            return false;
+        probe[0].set(map.x(), map.y(), 0.0, osg::maximum(hi - lo, 1.0) * toMapUnits);
+        if (pool->sampleMapCoords(probe, &_elevationWorkingSet, nullptr) < 0 ||
+            probe[0].z() == NO_DATA_VALUE)
+        {
+            break;
+        }
+
+        if (map.z() <= probe[0].z())
+            hi = mid;
+        else
+            lo = mid;
+    }
+
+    intersection = start + dir * (hi / length);
+
+    // the data has no normals, so use the surface up vector
+    osg::CoordinateFrame frame;
+    createLocalCoordFrame(intersection, frame);
+    normal = getUpVector(frame);
+
+    out_hit = true;
+    return true;
+}
+
 bool
 EarthManipulator::intersectLookVector(osg::Vec3d& out_eye,
                                       osg::Vec3d& out_target,
@@ -1399,22 +1566,41 @@ EarthManipulator::intersectLookVector(osg::Vec3d& out_eye,
         getWorldInverseMatrix().getLookAt(out_eye, out_target, out_up, 1.0);
         osg::Vec3d look = out_target-out_eye;
 
-		osg::ref_ptr<osgUtil::LineSegmentIntersector> lsi =
-		    new osgUtil::LineSegmentIntersector(out_eye, out_eye+look*1e8);
+        bool answered = false;
+        if (_settings.valid() && _settings->getUseElevationPoolIntersections())
+        {
+            bool hit;
+            osg::Vec3d ip, normal;
+            if (intersectElevation(out_eye, out_eye+look*1e8, hit, ip, normal))
+            {
+                answered = true;
+                if (hit)
+                {
+                    out_target = ip;
+                    success = true;
+                }
+            }
+        }
 
-        lsi->setIntersectionLimit(lsi->LIMIT_NEAREST);
+        if (!answered)
+        {
+            osg::ref_ptr<osgUtil::LineSegmentIntersector> lsi =
+                new osgUtil::LineSegmentIntersector(out_eye, out_eye+look*1e8);
 
-        osgUtil::IntersectionVisitor iv(lsi.get());
-        iv.setTraversalMask(_intersectTraversalMask);
+            lsi->setIntersectionLimit(lsi->LIMIT_NEAREST);
 
-        mapNode->getTerrainEngine()->getNode()->accept(iv);
+            osgUtil::IntersectionVisitor iv(lsi.get());
+            iv.setTraversalMask(_intersectTraversalMask);
 
-        if (lsi->containsIntersections())
-        {
-            out_target = lsi->getIntersections().begin()->getWorldIntersectPoint();
-            if ( !_srs->isGeographic() || GeoMath::isPointVisible(out_eye, out_target, R) )
+            mapNode->getTerrainEngine()->getNode()->accept(iv);
+
+            if (lsi->containsIntersections())
             {
-                success = true;
+                out_target = lsi->getIntersections().begin()->getWorldIntersectPoint();
+                if ( !_srs->isGeographic() || GeoMath::isPointVisible(out_eye, out_target, R) )
+                {
+                    success = true;
+                }
             }
         }
 
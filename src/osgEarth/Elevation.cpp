@@ -21,6 +21,7 @@
 #include <osgEarth/Map>
 #include <osgEarth/Progress>
 #include <osgEarth/Metrics>
+#include <osgEarth/Memory>
 
 using namespace osgEarth;
 
@@ -80,22 +81,20 @@ ElevationTexture::ElevationTexture(const TileKey& key, const GeoHeightField& in_
     {
         _heightField = in_hf.getHeightField();
 
-        osg::Vec4 value;
-
+        // The heightfield is already row-major R32F, south row first, which is
+        // exactly the layout of the texture image. Point the image at its
+        // heights instead of copying them; the texture holds the heightfield
+        // for as long as it lives and never writes to the image.
         osg::Image* heights = new osg::Image();
-        heights->allocateImage(_heightField->getNumColumns(), _heightField->getNumRows(), 1, GL_RED, GL_FLOAT);
-        heights->setInternalTextureFormat(GL_R32F);
-
-        ImageUtils::PixelWriter write(heights);
-        // TODO: speed this up since we know the format
-        for(unsigned row=0; row<_heightField->getNumRows(); ++row)
-        {
-            for(unsigned col=0; col<_heightField->getNumColumns(); ++col)
-            {
-                value.r() = _heightField->getHeight(col, row);
-                write(value, col, row);
-            }
-        }
+        heights->setImage(
+            _heightField->getNumColumns(),
+            _heightField->getNumRows(),
+            1,
+            GL_R32F,
+            GL_RED,
+            GL_FLOAT,
+            (unsigned char*)(&_heightField->getFloatArray()->front()),
+            osg::Image::NO_DELETE);
         setImage(heights);
 
         setDataVariance(osg::Object::STATIC);
@@ -116,6 +115,10 @@ ElevationTexture::ElevationTexture(const TileKey& key, const GeoHeightField& in_
         _resolution = Distance(
             getExtent().height() / ((double)(getImage(0)->s()-1)),
             getExtent().getSRS()->getUnits());
+
+        // heights plus the matching resolutions
+        std::size_t samples = _heightField->getNumColumns() * _heightField->getNumRows();
+        Memory::track(this, Memory::ELEVATION, samples * (_resolutions ? 2u : 1u) * sizeof(float));
     }
 }
 
@@ -175,6 +178,12 @@ ElevationTexture::generateNormalMap(
             {
                 // these are pooled, so do not expire them.
                 _normalTex->setUnRefImageDataAfterApply(false);
+
+                if (_normalTex->getImage())
+                {
+                    Memory::track(_normalTex.get(), Memory::ELEVATION,
+                        _normalTex->getImage()->getTotalSizeInBytes());
+                }
             }
         }
     }
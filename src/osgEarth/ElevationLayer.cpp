@@ -17,12 +17,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/ElevationLayer>
+#include <osgEarth/RasterPool>
 #include <osgEarth/HeightFieldUtils>
 #include <osgEarth/Progress>
 #include <osgEarth/MemCache>
 #include <osgEarth/Metrics>
 #include <osgEarth/NetworkMonitor>
 #include <cinttypes>
+#include <algorithm>
 
 using namespace osgEarth;
 
@@ -30,6 +32,10 @@ using namespace osgEarth;
 
 //#define ANALYZE
 
+#define UNIFORM_TILE_FIELD "oe.uniform_tile"
+#define UNIFORM_TILE_COLUMNS "oe.uniform_columns"
+#define UNIFORM_TILE_ROWS "oe.uniform_rows"
+
 //------------------------------------------------------------------------
 
 Config
@@ -62,6 +68,24 @@ ElevationLayer::Options::fromConfig( const Config& conf )
 
 namespace
 {
+    // heightfield shaped like another one, with every post at one height
+    osg::HeightField* createUniformHeightField(
+        const osg::HeightField* like,
+        unsigned numColumns,
+        unsigned numRows,
+        float height)
+    {
+        osg::HeightField* hf = new osg::HeightField();
+        hf->allocate(numColumns, numRows);
+        hf->setOrigin(like->getOrigin());
+        hf->setXInterval(like->getXInterval());
+        hf->setYInterval(like->getYInterval());
+        hf->setSkirtHeight(like->getSkirtHeight());
+        hf->setBorderWidth(like->getBorderWidth());
+        std::fill(hf->getFloatArray()->begin(), hf->getFloatArray()->end(), height);
+        return hf;
+    }
+
     // perform very basic sanity-check validation on a heightfield.
     bool validateHeightField(osg::HeightField* hf)
     {
@@ -281,8 +305,7 @@ ElevationLayer::assembleHeightField(const TileKey& key,
             //Now sort the heightfields by resolution to make sure we're sampling the highest resolution one first.
             std::sort( heightFields.begin(), heightFields.end(), GeoHeightField::SortByResolutionFunctor());
 
-            out_hf = new osg::HeightField();
-            out_hf->allocate(width, height);
+            out_hf = RasterPool::createHeightField(width, height);
 
             //Go ahead and set up the heightfield so we don't have to worry about it later
             double minx, miny, maxx, maxy;
@@ -356,6 +379,8 @@ ElevationLayer::createHeightField(const TileKey& key, ProgressCallback* progress
         return GeoHeightField::INVALID;
     }
 
+    _stats.count(_stats._requests);
+
     NetworkMonitor::ScopedRequestLayer layerRequest(getName());
 
     // prevents 2 threads from creating the same object at the same time
@@ -379,18 +404,17 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
 
     // cache key combines the key with the full signature (incl vdatum)
     // the cache key combines the Key and the horizontal profile.
-    std::string cacheKey = Cache::makeCacheKey(
-        Stringify() << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature(),
-        "elevation");
+    CacheBin::TileRecordKey cacheKey(key, "elevation");
     const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
 
-    char memCacheKey[64];
+    char memCacheKey[96];
 
     // Try the L2 memory cache first:
     if ( _memCache.valid() )
     {
-        sprintf(memCacheKey, "%d/%s/%s",
+        sprintf(memCacheKey, "%d/%u/%s/%s",
             getRevision(),
+            getDirtyRegionRevision(key),
             key.str().c_str(),
             key.getProfile()->getHorizSignature().c_str());
 
@@ -403,6 +427,7 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                 key.getExtent());
 
             fromMemCache = true;
+            _stats.count(_stats._memCacheHits);
         }
     }
 
@@ -427,17 +452,35 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
 
         if ( cacheBin && policy.isCacheReadable() )
         {
-            ReadResult r = cacheBin->readObject(cacheKey, 0L);
+            ReadResult r;
+            {
+                ScopedCacheTimer timeRead(_stats._cacheReadTime);
+                r = cacheBin->readObject(cacheKey, 0L);
+            }
+            _stats.count(r.succeeded() ? _stats._cacheHits : _stats._cacheMisses);
             if ( r.succeeded() )
             {
-                bool expired = policy.isExpired(r.lastModifiedTime());
+                bool expired = isCachedTileExpired(key, r.lastModifiedTime());
                 cachedHF = r.get<osg::HeightField>();
+
+                // a uniform tile is cached as a single post
+                if (cachedHF.valid() &&
+                    r.metadata().hasValue(UNIFORM_TILE_FIELD) &&
+                    cachedHF->getHeightList().size() == 1)
+                {
+                    cachedHF = createUniformHeightField(
+                        cachedHF.get(),
+                        r.metadata().value<unsigned>(UNIFORM_TILE_COLUMNS, getTileSize()),
+                        r.metadata().value<unsigned>(UNIFORM_TILE_ROWS, getTileSize()),
+                        cachedHF->getHeightList().front());
+                }
                 if ( cachedHF && validateHeightField(cachedHF.get()) )
                 {
                     if (!expired)
                     {
                         hf = cachedHF;
                         fromCache = true;
+                        _stats.count(_stats._cacheBytes, hf->getHeightList().size() * sizeof(float));
                     }
                 }
             }
@@ -458,6 +501,8 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                 return GeoHeightField::INVALID;
             }
 
+            std::chrono::steady_clock::time_point sourceStart = std::chrono::steady_clock::now();
+
             if (key.getProfile()->isHorizEquivalentTo(getProfile()))
             {
                 result = createHeightFieldImplementation(key, progress);
@@ -476,6 +521,12 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                 return GeoHeightField::INVALID;
             }
 
+            _stats.sourceRead(
+                sourceStart,
+                result.valid(),
+                result.getStatus(),
+                result.valid() ? result.getHeightField()->getHeightList().size() * sizeof(float) : 0u);
+
             // The const_cast is safe here because we just created the
             // heightfield from scratch...not from a cache.
             hf = const_cast<osg::HeightField*>(result.getHeightField());
@@ -520,7 +571,22 @@ ElevationLayer::createHeightFieldInKeyProfile(const TileKey& key, ProgressCallba
                  policy.isCacheWriteable() )
             {
                 OE_PROFILING_ZONE_NAMED("cache write");
-                cacheBin->write(cacheKey, hf.get(), 0L);
+                ScopedCacheTimer timeWrite(_stats._cacheWriteTime);
+
+                float height;
+                if (getDetectUniformTiles() && HeightFieldUtils::isUniform(hf.get(), height))
+                {
+                    Config meta;
+                    meta.set(UNIFORM_TILE_FIELD, true);
+                    meta.set(UNIFORM_TILE_COLUMNS, hf->getNumColumns());
+                    meta.set(UNIFORM_TILE_ROWS, hf->getNumRows());
+                    osg::ref_ptr<osg::HeightField> post = createUniformHeightField(hf.get(), 1, 1, height);
+                    cacheBin->write(cacheKey, post.get(), meta, 0L);
+                }
+                else
+                {
+                    cacheBin->write(cacheKey, hf.get(), Config(), 0L);
+                }
             }
 
             // If we have an expired heightfield from the cache and were not able to create
@@ -642,9 +708,49 @@ namespace
         TileKey key;
         bool isFallback;
         int index;
+        // window of output samples the layer's data extents can reach
+        int colMin, colMax, rowMin, rowMax;
     };
 
     typedef std::vector<LayerData> LayerDataVector;
+
+    // Finds the window of output samples that fall inside a layer's data
+    // extents, so the mosaic can skip the layer everywhere else. Local
+    // high-res insets usually touch only a corner of any tile they intersect.
+    void computeFootprint(LayerData& ld, const GeoExtent& tileExtent, unsigned numColumns, unsigned numRows)
+    {
+        ld.colMin = 0, ld.colMax = (int)numColumns - 1;
+        ld.rowMin = 0, ld.rowMax = (int)numRows - 1;
+
+        if (ld.layer->getDataExtents().empty())
+            return;
+
+        const GeoExtent& dataUnion = ld.layer->getDataExtentsUnion();
+        if (!dataUnion.isValid())
+            return;
+
+        GeoExtent local = dataUnion.transform(tileExtent.getSRS());
+
+        // anything odd, just sample the whole tile like before
+        if (!local.isValid() || local.crossesAntimeridian() || !local.intersects(tileExtent, false))
+            return;
+
+        double dx = tileExtent.width() / (double)(numColumns - 1);
+        double dy = tileExtent.height() / (double)(numRows - 1);
+
+        // pad by a sample so bilinear lookups at the edges still see the data
+        ld.colMin = osg::clampBetween((int)floor((local.xMin() - tileExtent.xMin()) / dx) - 1, 0, ld.colMax);
+        ld.colMax = osg::clampBetween((int)ceil ((local.xMax() - tileExtent.xMin()) / dx) + 1, ld.colMin, ld.colMax);
+        ld.rowMin = osg::clampBetween((int)floor((local.yMin() - tileExtent.yMin()) / dy) - 1, 0, ld.rowMax);
+        ld.rowMax = osg::clampBetween((int)ceil ((local.yMax() - tileExtent.yMin()) / dy) + 1, ld.rowMin, ld.rowMax);
+    }
+
+    bool coversTile(const LayerData& ld, unsigned numColumns, unsigned numRows)
+    {
+        return
+            ld.colMin == 0 && ld.colMax == (int)numColumns - 1 &&
+            ld.rowMin == 0 && ld.rowMax == (int)numRows - 1;
+    }
 }
 
 bool
@@ -801,22 +907,37 @@ ElevationLayerVector::populateHeightField(
 
     bool requiresResample = true;
 
-    // If we only have a single contender layer, and the tile is the same size as the requested
-    // heightfield then we just use it directly and avoid having to resample it
-    if (contenders.size() == 1 && offsets.empty())
+    for (auto& ld : contenders)
+    {
+        computeFootprint(ld, key.getExtent(), numColumns, numRows);
+    }
+
+    // Heightfield of the top contender, if we had to load it up front
+    GeoHeightField topHF;
+
+    // If the top contender covers the whole tile at the requested resolution and
+    // the tile is the same size as the requested heightfield, we just use it
+    // directly and avoid having to resample it. With other contenders under it,
+    // that only works if it has no holes for them to fill.
+    if (!contenders.empty() && offsets.empty() &&
+        !contenders[0].isFallback &&
+        (contenders.size() == 1 || coversTile(contenders[0], numColumns, numRows)))
     {
         ElevationLayer* layer = contenders[0].layer.get();
 
-        GeoHeightField layerHF = layer->createHeightField(contenders[0].key, progress);
-        if (layerHF.valid())
+        topHF = layer->createHeightField(contenders[0].key, progress);
+        if (topHF.valid())
         {
-            if (layerHF.getHeightField()->getNumColumns() == hf->getNumColumns() &&
-                layerHF.getHeightField()->getNumRows() == hf->getNumRows())
+            const osg::FloatArray::vector_type& src = topHF.getHeightField()->getFloatArray()->asVector();
+
+            if (topHF.getHeightField()->getNumColumns() == hf->getNumColumns() &&
+                topHF.getHeightField()->getNumRows() == hf->getNumRows() &&
+                (contenders.size() == 1 || std::find(src.begin(), src.end(), NO_DATA_VALUE) == src.end()))
             {
                 requiresResample = false;
 
                 memcpy(hf->getFloatArray()->asVector().data(),
-                    layerHF.getHeightField()->getFloatArray()->asVector().data(),
+                    src.data(),
                     sizeof(float) * hf->getFloatArray()->size()
                 );
 
@@ -824,9 +945,11 @@ ElevationLayerVector::populateHeightField(
 
                 if (resolutions)
                 {
+                    // no-data samples get FLT_MAX, same as the resampling path below
                     std::pair<double,double> res = contenders[0].key.getResolution(hf->getNumColumns());
+                    const osg::FloatArray::vector_type& heights = hf->getFloatArray()->asVector();
                     for(unsigned i=0; i<hf->getNumColumns()*hf->getNumRows(); ++i)
-                        resolutions[i] = res.second;
+                        resolutions[i] = heights[i] != NO_DATA_VALUE ? res.second : FLT_MAX;
                 }
             }
         }
@@ -854,6 +977,14 @@ ElevationLayerVector::populateHeightField(
         const unsigned maxHeightFields = 50;
         unsigned numHeightFieldsInCache = 0;
 
+        // Don't load the top contender twice
+        if (topHF.valid())
+        {
+            heightFields[0] = topHF;
+            heightFallback[0] = contenders[0].isFallback;
+            numHeightFieldsInCache++;
+        }
+
         for (unsigned c = 0; c < numColumns; ++c)
         {
             double x = xmin + (dx * (double)c);
@@ -884,6 +1015,11 @@ ElevationLayerVector::populateHeightField(
                     if (heightFailed[i])
                         continue;
 
+                    // outside this layer's data; don't even load it
+                    if ((int)c < contenders[i].colMin || (int)c > contenders[i].colMax ||
+                        (int)r < contenders[i].rowMin || (int)r > contenders[i].rowMax)
+                        continue;
+
                     GeoHeightField& layerHF = heightFields[i];
                     TileKey& actualKey = heightFieldActualKeys[i];
 
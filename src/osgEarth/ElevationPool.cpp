@@ -19,6 +19,7 @@
 #include <osgEarth/ElevationPool>
 #include <osgEarth/Map>
 #include <osgEarth/Metrics>
+#include <osgEarth/Stats>
 #include <osgEarth/rtree.h>
 #include <osgEarth/HeightFieldUtils>
 #include <osgEarth/Registry>
@@ -27,6 +28,12 @@
 
 #include <thread>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <unordered_set>
 
 using namespace osgEarth;
 
@@ -71,10 +78,13 @@ ElevationPool::ElevationPool() :
     _mapDataDirty(true),
     _workers(0),
     _refreshMutex("OE.ElevPool.RM"),
-    _globalLUTMutex("OE.ElevPool.GLUT"),
     _L2(64u)
 {
     _L2._lru.setName("OE.ElevPool.LRU");
+    _snapshotTiles.setName("OE.ElevPool.Snapshot");
+
+    for (unsigned i = 0; i < NUM_LUT_SHARDS; ++i)
+        _globalLUT[i]._mutex.setName("OE.ElevPool.GLUT");
 
     // adapter for detecting elevation layer changes
     _mapCallback = new MapCallbackAdapter();
@@ -191,9 +201,220 @@ ElevationPool::refresh(const Map* map)
 
     _L2.clear();
 
-    _globalLUTMutex.write_lock();
-    _globalLUT.clear();
-    _globalLUTMutex.write_unlock();
+    {
+        ScopedMutexLock lock(_snapshotTiles);
+        _snapshotTiles.clear();
+    }
+
+    for (unsigned i = 0; i < NUM_LUT_SHARDS; ++i)
+    {
+        ScopedMutexLock lock(_globalLUT[i]._mutex);
+        _globalLUT[i]._lut.clear();
+    }
+}
+
+#define SNAPSHOT_MAGIC   "OEEPSNAP"
+#define SNAPSHOT_VERSION 1u
+
+namespace
+{
+    template<typename T>
+    inline void writePOD(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    inline bool readPOD(std::istream& in, T& value) {
+        return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+}
+
+std::uint64_t
+ElevationPool::getSnapshotSignature(const Map* map, int revision) const
+{
+    // Revisions alone don't change when a layer's source data or options
+    // change between sessions, so fold in the layer configurations too.
+    std::string sig = map->getProfile()->getFullSignature();
+    sig += "|" + std::to_string(revision) + "|" + std::to_string(_tileSize);
+
+    for (auto& layer : _elevationLayers)
+    {
+        if (layer->getEnabled())
+            sig += "|" + layer->getConfig().toJSON(false);
+    }
+
+    return (std::uint64_t)std::hash<std::string>()(sig);
+}
+
+unsigned
+ElevationPool::writeSnapshot(const std::string& filename)
+{
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map) || map->getProfile() == nullptr)
+        return 0u;
+
+    sync(map.get(), nullptr);
+
+    int revision = getElevationRevision(map.get());
+
+    // Collect the live tiles for the current revision. Several keys can
+    // point at the same (fallback) tile, so only take each tile once.
+    std::vector<Pointer> tiles;
+    std::unordered_set<const ElevationTexture*> seen;
+
+    for (unsigned i = 0; i < NUM_LUT_SHARDS; ++i)
+    {
+        ScopedMutexLock lock(_globalLUT[i]._mutex);
+        for (auto& entry : _globalLUT[i]._lut)
+        {
+            Pointer tile;
+            if (entry.first._revision == revision &&
+                entry.second.lock(tile) &&
+                tile->getHeightField() != nullptr &&
+                tile->getResolutions() != nullptr &&
+                seen.insert(tile.get()).second)
+            {
+                tiles.push_back(tile);
+            }
+        }
+    }
+
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        OE_WARN << LC << "Failed to open \"" << filename << "\" for writing" << std::endl;
+        return 0u;
+    }
+
+    out.write(SNAPSHOT_MAGIC, 8);
+    writePOD(out, (std::uint32_t)SNAPSHOT_VERSION);
+    writePOD(out, getSnapshotSignature(map.get(), revision));
+    writePOD(out, (std::uint32_t)tiles.size());
+
+    for (auto& tile : tiles)
+    {
+        const TileKey& key = tile->getTileKey();
+        const osg::HeightField* hf = tile->getHeightField();
+        std::uint32_t cols = hf->getNumColumns(), rows = hf->getNumRows();
+
+        writePOD(out, (std::uint32_t)key.getLOD());
+        writePOD(out, (std::uint32_t)key.getTileX());
+        writePOD(out, (std::uint32_t)key.getTileY());
+        writePOD(out, cols);
+        writePOD(out, rows);
+        out.write(reinterpret_cast<const char*>(&hf->getFloatArray()->front()), sizeof(float)*cols*rows);
+        out.write(reinterpret_cast<const char*>(tile->getResolutions()), sizeof(float)*cols*rows);
+    }
+
+    if (!out.good())
+    {
+        OE_WARN << LC << "Failed to write \"" << filename << "\"" << std::endl;
+        return 0u;
+    }
+
+    OE_INFO << LC << "Wrote " << tiles.size() << " tiles to \"" << filename << "\"" << std::endl;
+    return tiles.size();
+}
+
+unsigned
+ElevationPool::readSnapshot(const std::string& filename)
+{
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map) || map->getProfile() == nullptr)
+        return 0u;
+
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!in.is_open())
+        return 0u;
+
+    sync(map.get(), nullptr);
+
+    int revision = getElevationRevision(map.get());
+
+    char magic[8];
+    std::uint32_t version, count;
+    std::uint64_t signature;
+
+    if (!in.read(magic, 8) || ::memcmp(magic, SNAPSHOT_MAGIC, 8) != 0 ||
+        !readPOD(in, version) || version != SNAPSHOT_VERSION ||
+        !readPOD(in, signature) ||
+        !readPOD(in, count))
+    {
+        OE_WARN << LC << "\"" << filename << "\" is not an elevation snapshot" << std::endl;
+        return 0u;
+    }
+
+    if (signature != getSnapshotSignature(map.get(), revision))
+    {
+        OE_INFO << LC << "Snapshot \"" << filename << "\" is out of date; ignoring it" << std::endl;
+        return 0u;
+    }
+
+    const Profile* profile = map->getProfile();
+    std::vector<Pointer> tiles;
+    tiles.reserve(count);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        std::uint32_t lod, x, y, cols, rows;
+        if (!readPOD(in, lod) || !readPOD(in, x) || !readPOD(in, y) ||
+            !readPOD(in, cols) || !readPOD(in, rows) ||
+            cols != _tileSize || rows != _tileSize)
+        {
+            break;
+        }
+
+        TileKey key(lod, x, y, profile);
+
+        osg::ref_ptr<osg::HeightField> hf = HeightFieldUtils::createReferenceHeightField(
+            key.getExtent(),
+            cols, rows,
+            false,      // no border
+            true);      // initialize to HAE (0.0) heights
+
+        float* resolutions = new float[cols*rows];
+
+        // read straight into the tile's own storage
+        if (!in.read(reinterpret_cast<char*>(&hf->getFloatArray()->front()), sizeof(float)*cols*rows) ||
+            !in.read(reinterpret_cast<char*>(resolutions), sizeof(float)*cols*rows))
+        {
+            delete [] resolutions;
+            break;
+        }
+
+        tiles.push_back(new ElevationTexture(
+            key,
+            GeoHeightField(hf.get(), key.getExtent()),
+            resolutions));
+    }
+
+    for (auto& tile : tiles)
+    {
+        Internal::RevElevationKey key;
+        key._tilekey = tile->getTileKey();
+        key._revision = revision;
+
+        LUTShard& shard = getLUTShard(key);
+        ScopedMutexLock lock(shard._mutex);
+        shard._lut[key] = tile.get();
+    }
+
+    {
+        ScopedMutexLock lock(_snapshotTiles);
+        _snapshotTiles.insert(_snapshotTiles.end(), tiles.begin(), tiles.end());
+    }
+
+    if (tiles.size() < count)
+    {
+        OE_WARN << LC << "Snapshot \"" << filename << "\" is truncated; loaded "
+            << tiles.size() << " of " << count << " tiles" << std::endl;
+    }
+    else
+    {
+        OE_INFO << LC << "Loaded " << tiles.size() << " tiles from \"" << filename << "\"" << std::endl;
+    }
+
+    return tiles.size();
 }
 
 int
@@ -270,30 +491,24 @@ ElevationPool::findExistingRaster(
 
     // Next check the system LUT -- see if someone somewhere else
     // already has it (the terrain or another WorkingSet)
-    optional<Internal::RevElevationKey> orphanedKey;
-    _globalLUTMutex.read_lock();
-    OE_DEBUG << "Global LUT size = " << _globalLUT.size() << std::endl;
-    auto i =_globalLUT.find(key);
-    if (i != _globalLUT.end())
-    {
-        i->second.lock(output);
-        if (output.valid())
-        {
-            *fromLUT = true;
-        }
-        else
+    LUTShard& shard = getLUTShard(key);
+    {
+        ScopedMutexLock lock(shard._mutex);
+        auto i = shard._lut.find(key);
+        if (i != shard._lut.end())
         {
-            // observer was orphaned..remove it
-            orphanedKey = key;
+            i->second.lock(output);
+            if (output.valid())
+            {
+                *fromLUT = true;
+            }
+            else
+            {
+                // observer was orphaned..remove it
+                shard._lut.erase(i);
+            }
         }
     }
-    _globalLUTMutex.read_unlock();
-
-    if (orphanedKey.isSet())
-    {
-        Threading::ScopedWriteLock lock(_globalLUTMutex);
-        _globalLUT.erase(orphanedKey.get());
-    }
 
     // found it, so stick it in the L2 cache
     if (output.valid())
@@ -320,8 +535,19 @@ ElevationPool::getOrCreateRaster(
 
     findExistingRaster(key, ws, result, &fromWS, &fromL2, &fromLUT);
 
+    static Stats::Counter& s_rasterHits = Stats::counter("osgearth_elevationpool_raster_hits");
+    static Stats::Counter& s_rasterMisses = Stats::counter("osgearth_elevationpool_raster_misses");
+    static Stats::Timer& s_rasterBuild = Stats::timer("osgearth_elevationpool_raster_build");
+
+    if (result.valid())
+        s_rasterHits.add();
+    else
+        s_rasterMisses.add();
+
     if (!result.valid())
     {
+        Stats::ScopedTimer timeBuild(s_rasterBuild);
+
         // need to build NEW data for this key
         osg::ref_ptr<osg::HeightField> hf = HeightFieldUtils::createReferenceHeightField(
             key._tilekey.getExtent(),
@@ -400,8 +626,9 @@ ElevationPool::getOrCreateRaster(
     // update system weak-LUT:
     if (!fromLUT)
     {
-        Threading::ScopedWriteLock lock(_globalLUTMutex);
-        _globalLUT[key] = result.get();
+        LUTShard& shard = getLUTShard(key);
+        ScopedMutexLock lock(shard._mutex);
+        shard._lut[key] = result.get();
     }
 
     return result;
@@ -460,11 +687,203 @@ namespace
     }
 }
 
+namespace
+{
+    // Packs a tile's LOD and location into one bucket ID
+    inline std::uint64_t bucketID(unsigned lod, unsigned tx, unsigned ty)
+    {
+        return ((std::uint64_t)lod << 58) | ((std::uint64_t)tx << 29) | (std::uint64_t)ty;
+    }
+
+    // Shared by the threads working through one batch of buckets.
+    // Jobs that start after the batch is done find no work and leave
+    // without touching anything else.
+    struct BatchState
+    {
+        BatchState(unsigned numBuckets) :
+            _numBuckets(numBuckets), _next(0u), _done(0u), _count(0), _mutex("OE.ElevPool.Batch") { }
+
+        const unsigned _numBuckets;
+        std::atomic<unsigned> _next;
+        std::atomic<unsigned> _done;
+        std::atomic<int> _count;
+        std::function<int(unsigned)> _sample;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _finished;
+
+        void work()
+        {
+            for (;;)
+            {
+                unsigned i = _next++;
+                if (i >= _numBuckets)
+                    break;
+
+                _count += _sample(i);
+
+                if (++_done == _numBuckets)
+                {
+                    Threading::ScopedMutexLock lock(_mutex);
+                    _finished.notify_all();
+                }
+            }
+        }
+    };
+}
+
+template<typename T>
+int
+ElevationPool::sampleTileBuckets(
+    std::vector<T>& points,
+    std::vector<TileBucket>& buckets,
+    const Map* map,
+    WorkingSet* ws,
+    ProgressCallback* progress,
+    JobArena* arena)
+{
+    auto sampleBucket = [&](unsigned b) -> int
+    {
+        TileBucket& bucket = buckets[b];
+
+        if (progress && progress->isCanceled())
+            return 0;
+
+        osg::ref_ptr<ElevationTexture> raster = getOrCreateRaster(
+            bucket._key, // key to query
+            map,         // map to query
+            true,        // fall back on lower resolution data if necessary
+            ws,          // user's workingset
+            progress);
+
+        if (!raster.valid())
+        {
+            for (auto i : bucket._points)
+                points[i].z() = NO_DATA_VALUE;
+            return 0;
+        }
+
+        const GeoExtent& ex = raster->getExtent();
+        const double xmin = ex.xMin(), ymin = ex.yMin();
+        const double invWidth = 1.0 / ex.width(), invHeight = 1.0 / ex.height();
+
+        int count = 0;
+
+        const osg::Image* image = raster->getImage(0);
+        if (image &&
+            image->getDataType() == GL_FLOAT &&
+            image->getPixelFormat() == GL_RED &&
+            image->s() > 1 && image->t() > 1)
+        {
+            // All points in the tile at once, straight from the float grid.
+            const float* heights = reinterpret_cast<const float*>(image->data());
+            const int rowStep = image->getRowStepInBytes() / sizeof(float);
+            const double sizeS = (double)(image->s() - 1);
+            const double sizeT = (double)(image->t() - 1);
+
+            for (auto i : bucket._points)
+            {
+                T& p = points[i];
+
+                // Note: clamping can happen on the map edges..
+                const double s = osg::clampBetween((p.x() - xmin) * invWidth, 0.0, 1.0) * sizeS;
+                const double t = osg::clampBetween((p.y() - ymin) * invHeight, 0.0, 1.0) * sizeT;
+
+                const double s0 = floor(s);
+                const double t0 = floor(t);
+                const int intS0 = (int)s0;
+                const int intT0 = (int)t0;
+                const int intS1 = std::min(intS0 + 1, (int)sizeS);
+                const int intT1 = std::min(intT0 + 1, (int)sizeT);
+                const double smix = intS1 > intS0 ? s - s0 : 0.0;
+                const double tmix = intT1 > intT0 ? t - t0 : 0.0;
+
+                const float* row0 = heights + intT0 * rowStep;
+                const float* row1 = heights + intT1 * rowStep;
+
+                const double top = row0[intS0] * (1.0 - smix) + row0[intS1] * smix;
+                const double bot = row1[intS0] * (1.0 - smix) + row1[intS1] * smix;
+                p.z() = (float)(top * (1.0 - tmix) + bot * tmix);
+
+                if (p.z() != NO_DATA_VALUE)
+                    ++count;
+            }
+        }
+        else
+        {
+            QuickSampleVars qvars;
+            osg::Vec4f elev;
+
+            for (auto i : bucket._points)
+            {
+                T& p = points[i];
+                double u = osg::clampBetween((p.x() - xmin) * invWidth, 0.0, 1.0);
+                double v = osg::clampBetween((p.y() - ymin) * invHeight, 0.0, 1.0);
+                quickSample(raster->reader(), u, v, elev, qvars);
+                p.z() = elev.r();
+
+                if (p.z() != NO_DATA_VALUE)
+                    ++count;
+            }
+        }
+
+        return count;
+    };
+
+    int count = 0;
+
+    if (arena && buckets.size() > 1)
+    {
+        // The calling thread works too, so all the tiles get done
+        // even if the arena is busy.
+        std::shared_ptr<BatchState> state = std::make_shared<BatchState>(buckets.size());
+        state->_sample = sampleBucket;
+
+        unsigned numJobs = std::min((unsigned)buckets.size() - 1u, Threading::getConcurrency());
+        for (unsigned j = 0; j < numJobs; ++j)
+        {
+            Job job(arena);
+            job.setName("oe.elevpool.sample");
+            job.dispatch([state](Cancelable*) { state->work(); });
+        }
+
+        state->work();
+
+        {
+            std::unique_lock<Threading::Mutex> lock(state->_mutex);
+            state->_finished.wait(lock, [&state]() { return state->_done == state->_numBuckets; });
+        }
+
+        count = state->_count;
+    }
+    else
+    {
+        for (unsigned b = 0; b < buckets.size(); ++b)
+        {
+            count += sampleBucket(b);
+        }
+    }
+
+    if (progress && progress->isCanceled())
+        return -1;
+
+    return count;
+}
+
 int
 ElevationPool::sampleMapCoords(
     std::vector<osg::Vec4d>& points,
     WorkingSet* ws,
     ProgressCallback* progress)
+{
+    return sampleMapCoords(points, ws, progress, nullptr);
+}
+
+int
+ElevationPool::sampleMapCoords(
+    std::vector<osg::Vec4d>& points,
+    WorkingSet* ws,
+    ProgressCallback* progress,
+    JobArena* arena)
 {
     OE_PROFILING_ZONE;
 
@@ -478,12 +897,24 @@ ElevationPool::sampleMapCoords(
     sync(map.get(), ws);
     ScopedAtomicCounter counter(_workers);
 
-    Internal::RevElevationKey key;
-    key._revision = getElevationRevision(map.get());
+    static Stats::Counter& s_samples = Stats::counter("osgearth_elevationpool_samples");
+    s_samples.add(points.size());
 
-    osg::ref_ptr<ElevationTexture> raster;
-    osg::Vec4 elev;
-    double u, v;
+    // Sort the points into tiles first, so each tile is fetched once
+    // and all of its points are sampled together.
+    std::vector<TileBucket> buckets;
+    bucketMapCoords(points, map.get(), buckets);
+
+    return sampleTileBuckets(points, buckets, map.get(), ws, progress, arena);
+}
+
+void
+ElevationPool::bucketMapCoords(
+    std::vector<osg::Vec4d>& points,
+    const Map* map,
+    std::vector<TileBucket>& buckets)
+{
+    int revision = getElevationRevision(map);
 
     const Profile* profile = map->getProfile();
     double pw = profile->getExtent().width();
@@ -491,123 +922,57 @@ ElevationPool::sampleMapCoords(
     double pxmin = profile->getExtent().xMin();
     double pymin = profile->getExtent().yMin();
 
-    int count = 0;
-
-    QuickCache quickCache;
-    QuickSampleVars qvars;
+    std::unordered_map<std::uint64_t, unsigned> bucketIndex;
 
-    //TODO: TESTING..?
-    //ws = NULL;
-
-    unsigned tw, th;
+    unsigned tw = 0u, th = 0u;
     double rx, ry;
-    int tx, ty;
-    int tx_prev = INT_MAX, ty_prev = INT_MAX;
-    float lastRes = -1.0f;
-    int lod;
-    int lod_prev = INT_MAX;
+    unsigned tx, ty;
+    double lastRes = -1.0;
+    int lod = -1;
     const Units& units = map->getSRS()->getUnits();
     Distance pointRes(0.0, units);
 
-    for(auto& p : points)
+    for(unsigned i = 0; i < points.size(); ++i)
     {
-        {
-            //OE_PROFILING_ZONE_NAMED("createTileKey");
-
-            // Reconsider, b/c an inset could mean we need to re-query the LOD.
-            if ((p.w() >= 0.0f && p.w() != lastRes) ||
-                (lod < 0))
-            {
-                pointRes.set(p.w(), units);
-
-                double resolutionInMapUnits = pointRes.asDistance(units, p.y());
-
-                unsigned maxLOD = profile->getLevelOfDetailForHorizResolution(
-                    resolutionInMapUnits,
-                    ELEVATION_TILE_SIZE);
+        osg::Vec4d& p = points[i];
 
-                lod = osg::minimum( getLOD(p.x(), p.y()), (int)maxLOD );
-                if (lod < 0)
-                {
-                    p.z() = NO_DATA_VALUE;
-                    continue;
-                }
+        // Reconsider, b/c an inset could mean we need to re-query the LOD.
+        if ((p.w() >= 0.0 && p.w() != lastRes) ||
+            (lod < 0))
+        {
+            pointRes.set(p.w(), units);
 
-                profile->getNumTiles(lod, tw, th);
+            double resolutionInMapUnits = pointRes.asDistance(units, p.y());
 
-                lastRes = p.w();
-            }
+            unsigned maxLOD = profile->getLevelOfDetailForHorizResolution(
+                resolutionInMapUnits,
+                ELEVATION_TILE_SIZE);
 
-            rx = (p.x()-pxmin)/pw, ry = (p.y()-pymin)/ph;
-            tx = osg::clampBelow((unsigned)(rx * (double)tw), tw-1u ); // TODO: wrap around for geo
-            ty = osg::clampBelow((unsigned)((1.0-ry) * (double)th), th-1u );
-
-            if (lod != lod_prev || tx != tx_prev || ty != ty_prev)
+            lod = osg::minimum( getLOD(p.x(), p.y()), (int)maxLOD );
+            if (lod < 0)
             {
-                key._tilekey = TileKey(lod, tx, ty, profile);
-                lod_prev = lod;
-                tx_prev = tx;
-                ty_prev = ty;
+                p.z() = NO_DATA_VALUE;
+                continue;
             }
-        }
-        
-        if (key._tilekey.valid())
-        {
-            auto iter = quickCache.find(key);
 
-            if (iter == quickCache.end())
-            {
-                raster = getOrCreateRaster(
-                    key,   // key to query
-                    map.get(), // map to query
-                    true,  // fall back on lower resolution data if necessary
-                    ws,    // user's workingset
-                    progress);
-
-                // bail on cancelation before using the quickcache
-                if (progress && progress->isCanceled())
-                {
-                    return -1;
-                }
-
-                quickCache[key] = raster.get();
-            }
-            else
-            {
-                raster = iter->second;
-            }
+            profile->getNumTiles(lod, tw, th);
 
-            {
-                //OE_PROFILING_ZONE_NAMED("sample");
-                if (raster.valid())
-                {
-                    u = (p.x() - raster->getExtent().xMin()) /  raster->getExtent().width();
-                    v = (p.y() - raster->getExtent().yMin()) /  raster->getExtent().height();
+            lastRes = p.w();
+        }
 
-                    // Note: This can happen on the map edges..
-                    // TODO: consider looping around for geo and clamping for projected
-                    u = osg::clampBetween(u, 0.0, 1.0);
-                    v = osg::clampBetween(v, 0.0, 1.0);
+        rx = (p.x()-pxmin)/pw, ry = (p.y()-pymin)/ph;
+        tx = osg::clampBelow((unsigned)(rx * (double)tw), tw-1u ); // TODO: wrap around for geo
+        ty = osg::clampBelow((unsigned)((1.0-ry) * (double)th), th-1u );
 
-                    quickSample(raster->reader(), u, v, elev, qvars);
-                    p.z() = elev.r();
-                }
-                else
-                {
-                    p.z() = NO_DATA_VALUE;
-                }
-            }
-        }
-        else
+        auto b = bucketIndex.emplace(bucketID(lod, tx, ty), (unsigned)buckets.size());
+        if (b.second)
         {
-            p.z() = NO_DATA_VALUE;
+            buckets.emplace_back();
+            buckets.back()._key._tilekey = TileKey(lod, tx, ty, profile);
+            buckets.back()._key._revision = revision;
         }
-
-        if (p.z() != NO_DATA_VALUE)
-            ++count;
+        buckets[b.first->second]._points.push_back(i);
     }
-
-    return count;
 }
 
 int
@@ -616,6 +981,17 @@ ElevationPool::sampleMapCoords(
     const Distance& resolution,
     WorkingSet* ws,
     ProgressCallback* progress)
+{
+    return sampleMapCoords(points, resolution, ws, progress, nullptr);
+}
+
+int
+ElevationPool::sampleMapCoords(
+    std::vector<osg::Vec3d>& points,
+    const Distance& resolution,
+    WorkingSet* ws,
+    ProgressCallback* progress,
+    JobArena* arena)
 {
     //OE_PROFILING_ZONE;
 
@@ -629,12 +1005,10 @@ ElevationPool::sampleMapCoords(
     sync(map.get(), ws);
     ScopedAtomicCounter counter(_workers);
 
-    Internal::RevElevationKey key;
-    key._revision = getElevationRevision(map.get());
+    static Stats::Counter& s_samples = Stats::counter("osgearth_elevationpool_samples");
+    s_samples.add(points.size());
 
-    osg::ref_ptr<ElevationTexture> raster;
-    osg::Vec4 elev;
-    double u, v;
+    int revision = getElevationRevision(map.get());
 
     const Profile* profile = map->getProfile();
     double pw = profile->getExtent().width();
@@ -642,23 +1016,7 @@ ElevationPool::sampleMapCoords(
     double pxmin = profile->getExtent().xMin();
     double pymin = profile->getExtent().yMin();
 
-    int count = 0;
-
-    QuickCache quickCache;
-    QuickSampleVars qvars;
-
-    //TODO: TESTING..?
-    //ws = NULL;
-
-    unsigned tw, th;
-    double rx, ry;
-    int tx, ty;
-    int tx_prev = INT_MAX, ty_prev = INT_MAX;
-    float lastRes = -1.0f;
-    unsigned lod;
-    unsigned lod_prev = INT_MAX;
     const Units& units = map->getSRS()->getUnits();
-    Distance pointRes(0.0, units);
 
     double resolutionInMapUnits = resolution.asDistance(units, points[0].y());
 
@@ -666,89 +1024,42 @@ ElevationPool::sampleMapCoords(
         resolutionInMapUnits,
         ELEVATION_TILE_SIZE);
 
-    lod = osg::minimum( getLOD(points[0].x(), points[0].y()), (int)maxLOD );
+    int lod = osg::minimum( getLOD(points[0].x(), points[0].y()), (int)maxLOD );
 
     //TODO: Fix this mess, doesn't work for insets.
     if (lod < 0)
         lod = 0;
 
+    unsigned tw, th;
     profile->getNumTiles(lod, tw, th);
 
-    for(auto& p : points)
-    {
-        {
-            //OE_PROFILING_ZONE_NAMED("createTileKey");
-
-            rx = (p.x()-pxmin)/pw, ry = (p.y()-pymin)/ph;
-            tx = osg::clampBelow((unsigned)(rx * (double)tw), tw-1u ); // TODO: wrap around for geo
-            ty = osg::clampBelow((unsigned)((1.0-ry) * (double)th), th-1u );
-
-            if (lod != lod_prev || tx != tx_prev || ty != ty_prev)
-            {
-                key._tilekey = TileKey(lod, tx, ty, profile);
-                lod_prev = lod;
-                tx_prev = tx;
-                ty_prev = ty;
-            }
-        }
-
-        if (key._tilekey.valid())
-        {
-            auto iter = quickCache.find(key);
-
-            if (iter == quickCache.end())
-            {
-                raster = getOrCreateRaster(
-                    key,   // key to query
-                    map.get(), // map to query
-                    true,  // fall back on lower resolution data if necessary
-                    ws,    // user's workingset
-                    progress);
-
-                // bail on cancelation before using the quickcache
-                if (progress && progress->isCanceled())
-                {
-                    return -1;
-                }
+    // Sort the points into tiles first, so each tile is fetched once
+    // and all of its points are sampled together.
+    std::vector<TileBucket> buckets;
+    std::unordered_map<std::uint64_t, unsigned> bucketIndex;
 
-                quickCache[key] = raster.get();
-            }
-            else
-            {
-                raster = iter->second;
-            }
+    double rx, ry;
+    unsigned tx, ty;
 
-            {
-                //OE_PROFILING_ZONE_NAMED("sample");
-                if (raster.valid())
-                {
-                    u = (p.x() - raster->getExtent().xMin()) /  raster->getExtent().width();
-                    v = (p.y() - raster->getExtent().yMin()) /  raster->getExtent().height();
+    for(unsigned i = 0; i < points.size(); ++i)
+    {
+        const osg::Vec3d& p = points[i];
 
-                    // Note: This can happen on the map edges..
-                    // TODO: consider looping around for geo and clamping for projected
-                    u = osg::clampBetween(u, 0.0, 1.0);
-                    v = osg::clampBetween(v, 0.0, 1.0);
+        rx = (p.x()-pxmin)/pw, ry = (p.y()-pymin)/ph;
+        tx = osg::clampBelow((unsigned)(rx * (double)tw), tw-1u ); // TODO: wrap around for geo
+        ty = osg::clampBelow((unsigned)((1.0-ry) * (double)th), th-1u );
 
-                    quickSample(raster->reader(), u, v, elev, qvars);
-                    p.z() = elev.r();
-                }
-                else
-                {
-                    p.z() = NO_DATA_VALUE;
-                }
-            }
-        }
-        else
+        auto b = bucketIndex.emplace(bucketID(lod, tx, ty), (unsigned)buckets.size());
+        if (b.second)
         {
-            p.z() = NO_DATA_VALUE;
+            buckets.emplace_back();
+            buckets.back()._key._tilekey = TileKey(lod, tx, ty, profile);
+            buckets.back()._key._revision = revision;
         }
-
-        if (p.z() != NO_DATA_VALUE)
-            ++count;
+        buckets[b.first->second]._points.push_back(i);
     }
 
-    return count;
+    return sampleTileBuckets(points, buckets, map.get(), ws, progress, arena);
 }
 
 ElevationSample
@@ -764,6 +1075,9 @@ ElevationPool::getSample(
 
     ScopedAtomicCounter counter(_workers);
 
+    static Stats::Counter& s_samples = Stats::counter("osgearth_elevationpool_samples");
+    s_samples.add();
+
     Internal::RevElevationKey key;
     // Need to limit maxLOD <= INT_MAX else osg::minimum for lod will return -1 due to cast
     maxLOD = osg::minimum(maxLOD, static_cast<unsigned>(std::numeric_limits<int>::max()));
@@ -918,7 +1232,9 @@ AsyncElevationSampler::AsyncElevationSampler(
     unsigned numThreads) :
 
     _map(map),
-    _arena("oe.AsyncElevationSampler", numThreads)
+    _arena("oe.AsyncElevationSampler", numThreads),
+    _numThreads(numThreads),
+    _chunkSize(1024u)
 {
     //nop
 }
@@ -956,3 +1272,49 @@ AsyncElevationSampler::getSample(
         }
     );
 }
+
+Future<std::vector<osg::Vec4d>>
+AsyncElevationSampler::getSamples(
+    const std::vector<osg::Vec4d>& input,
+    const BatchCallback& callback)
+{
+    std::shared_ptr<std::vector<osg::Vec4d>> points =
+        std::make_shared<std::vector<osg::Vec4d>>(input);
+
+    unsigned chunkSize = osg::maximum(_chunkSize, 1u);
+
+    // with more than one thread, spread each chunk's tiles across the arena
+    JobArena* arena = _numThreads > 1u ? &_arena : nullptr;
+
+    return Job(&_arena).dispatch<std::vector<osg::Vec4d>>(
+        [=](Cancelable* cancelable)
+        {
+            osg::ref_ptr<const Map> map(_map);
+            if (map.valid())
+            {
+                osg::ref_ptr<ProgressCallback> progress = new ProgressCallback(cancelable);
+
+                std::vector<osg::Vec4d> chunk;
+                chunk.reserve(chunkSize);
+
+                for (unsigned first = 0; first < points->size(); first += chunkSize)
+                {
+                    if (progress->isCanceled())
+                        break;
+
+                    unsigned count = osg::minimum(chunkSize, (unsigned)points->size() - first);
+                    chunk.assign(points->begin() + first, points->begin() + first + count);
+
+                    if (map->getElevationPool()->sampleMapCoords(chunk, &_ws, progress.get(), arena) < 0)
+                        break;
+
+                    std::copy(chunk.begin(), chunk.end(), points->begin() + first);
+
+                    if (callback)
+                        callback(first, &(*points)[first], count);
+                }
+            }
+            return *points;
+        }
+    );
+}
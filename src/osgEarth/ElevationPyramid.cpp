@@ -0,0 +1,532 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ElevationPyramid>
+#include <osgEarth/Map>
+#include <osgEarth/Progress>
+#include <cfloat>
+
+using namespace osgEarth;
+
+#define LC "[ElevationPyramid] "
+
+struct ElevationPyramid::TileRanges
+{
+    // elevation tile the ranges were built from
+    osg::observer_ptr<ElevationTexture> _source;
+    osg::ref_ptr<const osg::HeightField> _hf;
+    GeoExtent _extent;
+
+    // cells at level 0 (one per 2x2 block of samples)
+    int _cellsS, _cellsT;
+
+    // nodes per level, and min/max per node for levels >= 1.
+    // Level 0 comes straight from the heightfield.
+    std::vector<int> _w, _h;
+    std::vector<std::vector<float> > _min, _max;
+
+    int getNumLevels() const { return (int)_w.size(); }
+
+    void getRange(int l, int i, int j, float& out_min, float& out_max) const
+    {
+        if (l == 0)
+        {
+            out_min = FLT_MAX, out_max = -FLT_MAX;
+            for (int dj = 0; dj <= 1; ++dj)
+            {
+                for (int di = 0; di <= 1; ++di)
+                {
+                    float h = _hf->getHeight(i + di, j + dj);
+                    if (h != NO_DATA_VALUE)
+                    {
+                        out_min = std::min(out_min, h);
+                        out_max = std::max(out_max, h);
+                    }
+                }
+            }
+        }
+        else
+        {
+            int k = j*_w[l] + i;
+            out_min = _min[l][k];
+            out_max = _max[l][k];
+        }
+    }
+
+    //! Bilinear height at cell coordinates (s,t) inside cell (i,j)
+    float getHeight(int i, int j, double s, double t) const
+    {
+        float h00 = _hf->getHeight(i, j);
+        float h10 = _hf->getHeight(i + 1, j);
+        float h01 = _hf->getHeight(i, j + 1);
+        float h11 = _hf->getHeight(i + 1, j + 1);
+
+        if (h00 == NO_DATA_VALUE || h10 == NO_DATA_VALUE ||
+            h01 == NO_DATA_VALUE || h11 == NO_DATA_VALUE)
+        {
+            return NO_DATA_VALUE;
+        }
+
+        double smix = osg::clampBetween(s - (double)i, 0.0, 1.0);
+        double tmix = osg::clampBetween(t - (double)j, 0.0, 1.0);
+        double bot = h00 * (1.0 - smix) + h10 * smix;
+        double top = h01 * (1.0 - smix) + h11 * smix;
+        return (float)(bot * (1.0 - tmix) + top * tmix);
+    }
+
+    //! Min/max over the level 0 cells [c0..c1] x [r0..r1]
+    void query(int l, int i, int j, int c0, int c1, int r0, int r1, float& out_min, float& out_max) const
+    {
+        const int span = 1 << l;
+        const int i0 = i*span, i1 = std::min((i + 1)*span, _cellsS) - 1;
+        const int j0 = j*span, j1 = std::min((j + 1)*span, _cellsT) - 1;
+
+        if (i1 < c0 || i0 > c1 || j1 < r0 || j0 > r1)
+            return;
+
+        if (l == 0 || (i0 >= c0 && i1 <= c1 && j0 >= r0 && j1 <= r1))
+        {
+            float mn, mx;
+            getRange(l, i, j, mn, mx);
+            out_min = std::min(out_min, mn);
+            out_max = std::max(out_max, mx);
+            return;
+        }
+
+        for (int cj = 2*j; cj <= 2*j + 1 && cj < _h[l - 1]; ++cj)
+            for (int ci = 2*i; ci <= 2*i + 1 && ci < _w[l - 1]; ++ci)
+                query(l - 1, ci, cj, c0, c1, r0, r1, out_min, out_max);
+    }
+};
+
+namespace
+{
+    typedef LRUCache<TileKey, std::shared_ptr<ElevationPyramid::TileRanges> > TileRangesLRU;
+
+    // Clips the parameter range [ta,tb] of p(t) = p0 + dp*t to [lo,hi].
+    inline bool clip(double p0, double dp, double lo, double hi, double& ta, double& tb)
+    {
+        if (dp == 0.0)
+            return p0 >= lo && p0 <= hi && ta <= tb;
+
+        double t0 = (lo - p0) / dp;
+        double t1 = (hi - p0) / dp;
+        if (t0 > t1)
+            std::swap(t0, t1);
+
+        ta = std::max(ta, t0);
+        tb = std::min(tb, t1);
+        return ta <= tb;
+    }
+
+    // Segment in map coordinates, t in [0..1]. On a round earth the straight
+    // line between two points sags below the linear altitude profile by
+    // about t(1-t)d^2/2R; "bulge" is d^2/2R.
+    struct Ray
+    {
+        double _x0, _y0, _z0;
+        double _dx, _dy, _dz;
+        double _bulge;
+
+        Ray(const osg::Vec3d& start, const osg::Vec3d& end, double bulge) :
+            _x0(start.x()), _y0(start.y()), _z0(start.z()),
+            _dx(end.x() - start.x()), _dy(end.y() - start.y()), _dz(end.z() - start.z()),
+            _bulge(bulge) { }
+
+        double x(double t) const { return _x0 + _dx*t; }
+        double y(double t) const { return _y0 + _dy*t; }
+        double z(double t) const { return _z0 + _dz*t - _bulge*t*(1.0 - t); }
+
+        double minZ(double ta, double tb) const
+        {
+            double m = std::min(z(ta), z(tb));
+            if (_bulge > 0.0)
+            {
+                double ts = (_bulge - _dz) / (2.0*_bulge);
+                if (ts > ta && ts < tb)
+                    m = std::min(m, z(ts));
+            }
+            return m;
+        }
+    };
+
+    // The same ray in the cell coordinates of one tile
+    struct TileRay
+    {
+        const Ray& _ray;
+        double _s0, _ds, _t0, _dt;
+
+        TileRay(const Ray& ray, const ElevationPyramid::TileRanges& r) : _ray(ray)
+        {
+            double scaleS = (double)r._cellsS / r._extent.width();
+            double scaleT = (double)r._cellsT / r._extent.height();
+            _s0 = (ray._x0 - r._extent.xMin()) * scaleS;
+            _ds = ray._dx * scaleS;
+            _t0 = (ray._y0 - r._extent.yMin()) * scaleT;
+            _dt = ray._dy * scaleT;
+        }
+
+        double u(double t) const { return _s0 + _ds*t; }
+        double v(double t) const { return _t0 + _dt*t; }
+    };
+
+    // Finds where the ray enters the bilinear surface of one cell.
+    bool hitCell(const ElevationPyramid::TileRanges& r, const TileRay& ray, int i, int j, double ta, double tb, double& out_t)
+    {
+        const int steps = 4;
+        double prev = ta;
+
+        for (int k = 0; k <= steps; ++k)
+        {
+            double t = ta + (tb - ta)*(double)k / (double)steps;
+            float h = r.getHeight(i, j, ray.u(t), ray.v(t));
+
+            if (h != NO_DATA_VALUE && ray._ray.z(t) <= h)
+            {
+                if (k > 0)
+                {
+                    // narrow it down
+                    double lo = prev, hi = t;
+                    for (int n = 0; n < 8; ++n)
+                    {
+                        double mid = 0.5*(lo + hi);
+                        float hm = r.getHeight(i, j, ray.u(mid), ray.v(mid));
+                        if (hm != NO_DATA_VALUE && ray._ray.z(mid) <= hm)
+                            hi = mid;
+                        else
+                            lo = mid;
+                    }
+                    t = hi;
+                }
+                out_t = t;
+                return true;
+            }
+            prev = t;
+        }
+        return false;
+    }
+
+    // Walks the quadtree of one tile, nearest nodes first, skipping
+    // any node the ray passes entirely above.
+    bool march(const ElevationPyramid::TileRanges& r, const TileRay& ray, int l, int i, int j, double ta, double tb, double& out_t)
+    {
+        const int span = 1 << l;
+        if (!clip(ray._s0, ray._ds, (double)(i*span), (double)std::min((i + 1)*span, r._cellsS), ta, tb) ||
+            !clip(ray._t0, ray._dt, (double)(j*span), (double)std::min((j + 1)*span, r._cellsT), ta, tb))
+        {
+            return false;
+        }
+
+        float mn, mx;
+        r.getRange(l, i, j, mn, mx);
+
+        // no data, or the ray stays above everything here
+        if (mn > mx || ray._ray.minZ(ta, tb) > mx)
+            return false;
+
+        // the ray is already below everything here
+        if (ray._ray.z(ta) <= mn)
+        {
+            out_t = ta;
+            return true;
+        }
+
+        if (l == 0)
+            return hitCell(r, ray, i, j, ta, tb, out_t);
+
+        struct Child { double _t; int _i, _j; };
+        Child children[4];
+        int num = 0;
+
+        const int childSpan = span >> 1;
+        for (int cj = 2*j; cj <= 2*j + 1 && cj < r._h[l - 1]; ++cj)
+        {
+            for (int ci = 2*i; ci <= 2*i + 1 && ci < r._w[l - 1]; ++ci)
+            {
+                double ca = ta, cb = tb;
+                if (clip(ray._s0, ray._ds, (double)(ci*childSpan), (double)std::min((ci + 1)*childSpan, r._cellsS), ca, cb) &&
+                    clip(ray._t0, ray._dt, (double)(cj*childSpan), (double)std::min((cj + 1)*childSpan, r._cellsT), ca, cb))
+                {
+                    Child c = { ca, ci, cj };
+                    int k = num++;
+                    for (; k > 0 && children[k - 1]._t > c._t; --k)
+                        children[k] = children[k - 1];
+                    children[k] = c;
+                }
+            }
+        }
+
+        for (int k = 0; k < num; ++k)
+        {
+            if (march(r, ray, l - 1, children[k]._i, children[k]._j, ta, tb, out_t))
+                return true;
+        }
+        return false;
+    }
+
+    std::shared_ptr<ElevationPyramid::TileRanges> buildTileRanges(ElevationTexture* tex)
+    {
+        const osg::HeightField* hf = tex->getHeightField();
+        if (!hf || hf->getNumColumns() < 2 || hf->getNumRows() < 2)
+            return nullptr;
+
+        std::shared_ptr<ElevationPyramid::TileRanges> r = std::make_shared<ElevationPyramid::TileRanges>();
+        r->_source = tex;
+        r->_hf = hf;
+        r->_extent = tex->getExtent();
+        r->_cellsS = hf->getNumColumns() - 1;
+        r->_cellsT = hf->getNumRows() - 1;
+
+        r->_w.push_back(r->_cellsS);
+        r->_h.push_back(r->_cellsT);
+        r->_min.emplace_back();
+        r->_max.emplace_back();
+
+        while (r->_w.back() > 1 || r->_h.back() > 1)
+        {
+            const int l = r->getNumLevels();
+            const int pw = r->_w.back(), ph = r->_h.back();
+            const int w = (pw + 1) / 2, h = (ph + 1) / 2;
+
+            std::vector<float> mins(w*h, FLT_MAX);
+            std::vector<float> maxs(w*h, -FLT_MAX);
+
+            for (int j = 0; j < h; ++j)
+            {
+                for (int i = 0; i < w; ++i)
+                {
+                    float& mn = mins[j*w + i];
+                    float& mx = maxs[j*w + i];
+                    for (int cj = 2*j; cj <= 2*j + 1 && cj < ph; ++cj)
+                    {
+                        for (int ci = 2*i; ci <= 2*i + 1 && ci < pw; ++ci)
+                        {
+                            float cmin, cmax;
+                            r->getRange(l - 1, ci, cj, cmin, cmax);
+                            mn = std::min(mn, cmin);
+                            mx = std::max(mx, cmax);
+                        }
+                    }
+                }
+            }
+
+            r->_w.push_back(w);
+            r->_h.push_back(h);
+            r->_min.push_back(std::move(mins));
+            r->_max.push_back(std::move(maxs));
+        }
+
+        return r;
+    }
+}
+
+ElevationPyramid::ElevationPyramid(const Map* map, unsigned maxTiles) :
+    _map(map),
+    _tiles(true, maxTiles)
+{
+    //nop
+}
+
+void
+ElevationPyramid::clear()
+{
+    _tiles.clear();
+}
+
+std::shared_ptr<ElevationPyramid::TileRanges>
+ElevationPyramid::getTileRanges(
+    const TileKey& key,
+    ElevationPool::WorkingSet* ws,
+    ProgressCallback* progress)
+{
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map))
+        return nullptr;
+
+    osg::ref_ptr<ElevationTexture> tex;
+    if (!map->getElevationPool()->getTile(key, true, tex, ws, progress))
+        return nullptr;
+
+    // reuse the ranges as long as the pool hands out the same tile
+    TileRangesLRU::Record record;
+    if (_tiles.get(key, record) && record.value()->_source.get() == tex.get())
+        return record.value();
+
+    std::shared_ptr<TileRanges> ranges = buildTileRanges(tex.get());
+    if (ranges)
+        _tiles.insert(key, ranges);
+
+    return ranges;
+}
+
+bool
+ElevationPyramid::getElevationRange(
+    const TileKey& key,
+    float& out_min,
+    float& out_max,
+    ProgressCallback* progress)
+{
+    ElevationPool::WorkingSet ws(4u);
+
+    std::shared_ptr<TileRanges> r = getTileRanges(key, &ws, progress);
+    if (!r)
+        return false;
+
+    // the key may fall inside a lower resolution tile,
+    // so only look at the cells under its own extent.
+    const GeoExtent& ex = key.getExtent();
+    double scaleS = (double)r->_cellsS / r->_extent.width();
+    double scaleT = (double)r->_cellsT / r->_extent.height();
+
+    int c0 = osg::clampBetween((int)floor((ex.xMin() - r->_extent.xMin()) * scaleS), 0, r->_cellsS - 1);
+    int c1 = osg::clampBetween((int)ceil((ex.xMax() - r->_extent.xMin()) * scaleS) - 1, c0, r->_cellsS - 1);
+    int r0 = osg::clampBetween((int)floor((ex.yMin() - r->_extent.yMin()) * scaleT), 0, r->_cellsT - 1);
+    int r1 = osg::clampBetween((int)ceil((ex.yMax() - r->_extent.yMin()) * scaleT) - 1, r0, r->_cellsT - 1);
+
+    out_min = FLT_MAX, out_max = -FLT_MAX;
+    r->query(r->getNumLevels() - 1, 0, 0, c0, c1, r0, r1, out_min, out_max);
+
+    return out_min <= out_max;
+}
+
+bool
+ElevationPyramid::intersectMapCoords(
+    const Map* map,
+    const osg::Vec3d& start,
+    const osg::Vec3d& end,
+    double bulge,
+    const Distance& resolution,
+    double& out_t,
+    ProgressCallback* progress)
+{
+    const Profile* profile = map->getProfile();
+    if (!profile)
+        return false;
+
+    double resolutionInMapUnits = resolution.asDistance(map->getSRS()->getUnits(), start.y());
+    unsigned lod = profile->getLevelOfDetailForHorizResolution(resolutionInMapUnits, ELEVATION_TILE_SIZE);
+
+    Ray ray(start, end, bulge);
+    ElevationPool::WorkingSet ws(8u);
+
+    // visit the tiles along the ray in order
+    // TODO: wrap around for geo
+    const double epsilon = 1e-9;
+    double t = 0.0;
+    while (t < 1.0)
+    {
+        if (progress && progress->isCanceled())
+            return false;
+
+        double tp = std::min(t + epsilon, 1.0);
+        TileKey key = profile->createTileKey(ray.x(tp), ray.y(tp), lod);
+        if (!key.valid())
+            break;
+
+        std::shared_ptr<TileRanges> r = getTileRanges(key, &ws, progress);
+        const GeoExtent& ex = r ? r->_extent : key.getExtent();
+
+        double ta = t, tb = 1.0;
+        if (!clip(ray._x0, ray._dx, ex.xMin(), ex.xMax(), ta, tb) ||
+            !clip(ray._y0, ray._dy, ex.yMin(), ex.yMax(), ta, tb))
+        {
+            break;
+        }
+
+        if (r && march(*r, TileRay(ray, *r), r->getNumLevels() - 1, 0, 0, ta, tb, out_t))
+            return true;
+
+        t = std::max(tb, tp);
+    }
+
+    return false;
+}
+
+bool
+ElevationPyramid::intersect(
+    const GeoPoint& start,
+    const GeoPoint& end,
+    const Distance& resolution,
+    GeoPoint& out_hit,
+    ProgressCallback* progress)
+{
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map))
+        return false;
+
+    GeoPoint startMap, endMap;
+    if (!start.transform(map->getSRS(), startMap) ||
+        !end.transform(map->getSRS(), endMap))
+    {
+        return false;
+    }
+
+    if (map->getSRS()->isProjected())
+    {
+        double t;
+        if (!intersectMapCoords(map.get(), startMap.vec3d(), endMap.vec3d(), 0.0, resolution, t, progress))
+            return false;
+
+        out_hit.set(map->getSRS(), startMap.vec3d() + (endMap.vec3d() - startMap.vec3d())*t, ALTMODE_ABSOLUTE);
+        return true;
+    }
+
+    osg::Vec3d startWorld, endWorld, hitWorld;
+    startMap.toWorld(startWorld);
+    endMap.toWorld(endWorld);
+
+    if (!intersect(startWorld, endWorld, resolution, hitWorld, progress))
+        return false;
+
+    return out_hit.fromWorld(map->getSRS(), hitWorld);
+}
+
+bool
+ElevationPyramid::intersect(
+    const osg::Vec3d& startWorld,
+    const osg::Vec3d& endWorld,
+    const Distance& resolution,
+    osg::Vec3d& out_hitWorld,
+    ProgressCallback* progress)
+{
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map))
+        return false;
+
+    GeoPoint startMap, endMap;
+    if (!startMap.fromWorld(map->getSRS(), startWorld) ||
+        !endMap.fromWorld(map->getSRS(), endWorld))
+    {
+        return false;
+    }
+
+    double bulge = 0.0;
+    if (map->getSRS()->isGeographic())
+    {
+        double d = (endWorld - startWorld).length();
+        double R = map->getSRS()->getEllipsoid()->getRadiusEquator();
+        bulge = d*d / (2.0*R);
+    }
+
+    double t;
+    if (!intersectMapCoords(map.get(), startMap.vec3d(), endMap.vec3d(), bulge, resolution, t, progress))
+        return false;
+
+    out_hitWorld = startWorld + (endWorld - startWorld)*t;
+    return true;
+}
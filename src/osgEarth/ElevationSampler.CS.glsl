@@ -0,0 +1,74 @@
+#version 430
+
+// Bilinear elevation sampling for GPUElevationSampler.
+// Matches the CPU path in ElevationPool::sampleMapCoords.
+
+#define WORK_GROUP_SIZE 64
+layout(local_size_x=WORK_GROUP_SIZE, local_size_y=1, local_size_z=1) in;
+
+// keep me vec4-aligned
+struct TileData {
+    int offset;  // first height of the tile
+    int cols;
+    int rows;
+    int pad;
+};
+
+// keep me vec4-aligned
+struct PointData {
+    float u;     // normalized tile coordinates
+    float v;
+    int tile;    // index into tiles[], or -1 for no data
+    int pad;
+};
+
+layout(binding=0, std430) readonly buffer HeightBuffer {
+    float heights[];
+};
+
+layout(binding=1, std430) readonly buffer TileBuffer {
+    TileData tiles[];
+};
+
+layout(binding=2, std430) readonly buffer PointBuffer {
+    PointData points[];
+};
+
+layout(binding=3, std430) writeonly buffer ResultBuffer {
+    float results[];
+};
+
+const float NO_DATA_VALUE = -3.402823466e+38;
+
+void main()
+{
+    // large batches dispatch more than one row of work groups
+    uint i = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * WORK_GROUP_SIZE + gl_GlobalInvocationID.x;
+
+    PointData p = points[i];
+    if (p.tile < 0)
+    {
+        results[i] = NO_DATA_VALUE;
+        return;
+    }
+
+    TileData tile = tiles[p.tile];
+
+    float s = clamp(p.u, 0.0, 1.0) * float(tile.cols - 1);
+    float t = clamp(p.v, 0.0, 1.0) * float(tile.rows - 1);
+
+    int s0 = int(floor(s));
+    int t0 = int(floor(t));
+    int s1 = min(s0 + 1, tile.cols - 1);
+    int t1 = min(t0 + 1, tile.rows - 1);
+
+    float smix = s1 > s0 ? s - float(s0) : 0.0;
+    float tmix = t1 > t0 ? t - float(t0) : 0.0;
+
+    float h00 = heights[tile.offset + t0*tile.cols + s0];
+    float h10 = heights[tile.offset + t0*tile.cols + s1];
+    float h01 = heights[tile.offset + t1*tile.cols + s0];
+    float h11 = heights[tile.offset + t1*tile.cols + s1];
+
+    results[i] = mix(mix(h00, h10, smix), mix(h01, h11, smix), tmix);
+}
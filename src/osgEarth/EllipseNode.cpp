@@ -70,7 +70,7 @@ EllipseNode::set(const GeoPoint& position,
 
     setPosition(position);
 
-    buildGeometry();
+    requestRebuild();
 }
 
 unsigned int
@@ -85,7 +85,7 @@ EllipseNode::setNumSegments(unsigned numSegments)
     if (_numSegments != numSegments )
     {
         _numSegments = numSegments;
-        buildGeometry();
+        requestRebuild();
     }
 }
 
@@ -122,7 +122,7 @@ EllipseNode::setRadii( const Linear& radiusMajor, const Linear& radiusMinor )
     {
         _radiusMajor = radiusMajor;
         _radiusMinor = radiusMinor;
-        buildGeometry();
+        requestRebuild();
     }
 }
 
@@ -138,7 +138,7 @@ EllipseNode::setRotationAngle(const Angular& rotationAngle)
     if (_rotationAngle != rotationAngle)
     {
         _rotationAngle = rotationAngle;
-        buildGeometry();
+        requestRebuild();
     }
 }
 const Angle&
@@ -151,7 +151,7 @@ void
 EllipseNode::setArcStart(const Angle& arcStart)
 {
     _arcStart = arcStart;
-    buildGeometry();
+    requestRebuild();
 }
 
 const Angle&
@@ -164,7 +164,7 @@ void
 EllipseNode::setArcEnd(const Angle& arcEnd)
 {
     _arcEnd = arcEnd;
-    buildGeometry();
+    requestRebuild();
 }
 
 const bool&
@@ -177,7 +177,7 @@ void
 EllipseNode::setPie(const bool& pie)
 {
 	_pie = pie;
-	buildGeometry();
+	requestRebuild();
 }
 
 void
@@ -199,10 +199,17 @@ EllipseNode::buildGeometry()
 
     if ( geom.valid() )
     {
-        setGeometry( geom.get() );
+        _geom = geom.get();
+        compileGeometry();
     }
 }
 
+void
+EllipseNode::rebuild()
+{
+    buildGeometry();
+}
+
 
 
 //-------------------------------------------------------------------
@@ -0,0 +1,324 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/EncodingCacheBin>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/StringUtils>
+#include <osgDB/Registry>
+#include <osg/Shape>
+#include <sstream>
+
+using namespace osgEarth;
+
+#define LC "[EncodingCacheBin] "
+
+// Metadata field naming the encoding of a record
+#define ENCODING_FIELD "oe.cache_encoding"
+
+// Record encodings
+#define ENCODING_JPG  "jpg"
+#define ENCODING_PNG  "png"
+#define ENCODING_WEBP "webp"
+#define ENCODING_ZLIB "osgb+zlib"
+
+namespace
+{
+    // Whether an image is 8-bit pixels that the image codecs can take
+    bool isCodecFriendly(const osg::Image* image)
+    {
+        return
+            image->getDataType() == GL_UNSIGNED_BYTE &&
+            image->r() == 1 &&
+            !ImageUtils::isCompressed(image) &&
+            (image->getPixelFormat() == GL_RGB || image->getPixelFormat() == GL_RGBA);
+    }
+
+    osgDB::ReaderWriter* getReaderWriter(const std::string& ext)
+    {
+        return osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+    }
+
+    bool writeImage(const std::string& ext, const osg::Image* image, std::string& output)
+    {
+        osgDB::ReaderWriter* rw = getReaderWriter(ext);
+        if (!rw)
+            return false;
+
+        std::stringstream buf;
+        osgDB::ReaderWriter::WriteResult wr = rw->writeImage(*image, buf, 0L);
+        if (!wr.success())
+            return false;
+
+        output = buf.str();
+        return true;
+    }
+
+    bool writeCompressedObject(const osg::Object* object, std::string& output)
+    {
+        osgDB::ReaderWriter* rw = getReaderWriter("osgb");
+        if (!rw)
+            return false;
+
+        osg::ref_ptr<osgDB::Options> dbo = new osgDB::Options();
+        dbo->setPluginStringData("Compressor", "zlib");
+
+        std::stringstream buf;
+        osgDB::ReaderWriter::WriteResult wr;
+        const osg::Image* image = dynamic_cast<const osg::Image*>(object);
+        if (image)
+            wr = rw->writeImage(*image, buf, dbo.get());
+        else
+            wr = rw->writeObject(*object, buf, dbo.get());
+
+        if (!wr.success())
+            return false;
+
+        output = buf.str();
+        return true;
+    }
+}
+
+EncodingCacheBin::EncodingCacheBin(CacheBin* bin, const std::string& encoding) :
+    CacheBin(bin->getID()),
+    _bin(bin),
+    _encoding(toLower(encoding))
+{
+    setHashKeys(bin->getHashKeys());
+
+    if (_encoding == "jpeg")
+        _encoding = "jpg";
+
+    if (_encoding != "jpg" && _encoding != "png" && _encoding != "webp" &&
+        _encoding != "zlib" && _encoding != "auto")
+    {
+        OE_WARN << LC << getID() << ": unknown cache encoding \"" << encoding << "\"; records will be stored as is" << std::endl;
+    }
+}
+
+osg::ref_ptr<const osg::Object>
+EncodingCacheBin::encode(const osg::Object* object, Config& metadata) const
+{
+    const osg::Image* image = dynamic_cast<const osg::Image*>(object);
+    const osg::HeightField* hf = dynamic_cast<const osg::HeightField*>(object);
+
+    // metadata records, nodes, etc. stay as they are
+    if (!image && !hf)
+        return object;
+
+    std::string format;
+
+    if (image && isCodecFriendly(image))
+    {
+        if (_encoding == "jpg" || _encoding == "auto")
+        {
+            // JPEG has no alpha channel
+            format = ImageUtils::hasTransparency(image) ? ENCODING_PNG : ENCODING_JPG;
+        }
+        else if (_encoding == "png")
+        {
+            format = ENCODING_PNG;
+        }
+        else if (_encoding == "webp")
+        {
+            format = ENCODING_WEBP;
+        }
+    }
+
+    if (format.empty() && (_encoding == "zlib" || _encoding == "auto"))
+    {
+        format = ENCODING_ZLIB;
+    }
+
+    if (format.empty())
+        return object;
+
+    std::string data;
+    bool ok;
+
+    if (format == ENCODING_ZLIB)
+    {
+        ok = writeCompressedObject(object, data);
+    }
+    else if (format == ENCODING_JPG && image->getPixelFormat() == GL_RGBA)
+    {
+        osg::ref_ptr<osg::Image> rgb = ImageUtils::convertToRGB8(image);
+        ok = rgb.valid() && writeImage(format, rgb.get(), data);
+    }
+    else
+    {
+        ok = writeImage(format, image, data);
+    }
+
+    if (!ok)
+    {
+        OE_DEBUG << LC << getID() << ": failed to encode a record as " << format << "; storing it as is" << std::endl;
+        return object;
+    }
+
+    metadata.set(ENCODING_FIELD, format);
+    return new StringObject(data);
+}
+
+ReadResult
+EncodingCacheBin::decode(const ReadResult& r, const osgDB::Options* dbo) const
+{
+    if (!r.succeeded() || !r.metadata().hasValue(ENCODING_FIELD))
+        return r;
+
+    const StringObject* so = r.get<StringObject>();
+    if (!so)
+        return r;
+
+    std::string format = r.metadata().value(ENCODING_FIELD);
+
+    osgDB::ReaderWriter* rw = getReaderWriter(format == ENCODING_ZLIB ? "osgb" : format);
+    if (!rw)
+    {
+        OE_WARN << LC << getID() << ": no reader for cache encoding \"" << format << "\"" << std::endl;
+        return ReadResult(ReadResult::RESULT_NO_READER);
+    }
+
+    std::istringstream buf(so->getString());
+    osgDB::ReaderWriter::ReadResult rr =
+        format == ENCODING_ZLIB ? rw->readObject(buf, dbo) : rw->readImage(buf, dbo);
+
+    if (!rr.success() || !rr.getObject())
+    {
+        OE_DEBUG << LC << getID() << ": failed to decode a " << format << " record" << std::endl;
+        return ReadResult(ReadResult::RESULT_READER_ERROR);
+    }
+
+    Config meta = r.metadata();
+    meta.remove(ENCODING_FIELD);
+
+    ReadResult output(rr.getObject(), meta);
+    output.setLastModifiedTime(r.lastModifiedTime());
+    output.setIsFromCache(r.isFromCache());
+    return output;
+}
+
+ReadResult
+EncodingCacheBin::decodeImage(const ReadResult& r, const osgDB::Options* dbo) const
+{
+    ReadResult output = decode(r, dbo);
+    if (output.succeeded() && !output.getImage())
+        return ReadResult(ReadResult::RESULT_READER_ERROR);
+    return output;
+}
+
+ReadResult
+EncodingCacheBin::readObject(const std::string& key, const osgDB::Options* dbo)
+{
+    return decode(_bin->readObject(key, dbo), dbo);
+}
+
+ReadResult
+EncodingCacheBin::readImage(const std::string& key, const osgDB::Options* dbo)
+{
+    // encoded records are not images in the bin's eyes
+    return decodeImage(_bin->readObject(key, dbo), dbo);
+}
+
+ReadResult
+EncodingCacheBin::readString(const std::string& key, const osgDB::Options* dbo)
+{
+    return _bin->readString(key, dbo);
+}
+
+bool
+EncodingCacheBin::write(const std::string& key, const osg::Object* object, const Config& metadata, const osgDB::Options* dbo)
+{
+    Config meta = metadata;
+    osg::ref_ptr<const osg::Object> encoded = encode(object, meta);
+    return _bin->write(key, encoded.get(), meta, dbo);
+}
+
+CacheBin::RecordStatus
+EncodingCacheBin::getRecordStatus(const std::string& key)
+{
+    return _bin->getRecordStatus(key);
+}
+
+ReadResult
+EncodingCacheBin::readObject(const TileRecordKey& key, const osgDB::Options* dbo)
+{
+    return decode(_bin->readObject(key, dbo), dbo);
+}
+
+ReadResult
+EncodingCacheBin::readImage(const TileRecordKey& key, const osgDB::Options* dbo)
+{
+    return decodeImage(_bin->readObject(key, dbo), dbo);
+}
+
+bool
+EncodingCacheBin::write(const TileRecordKey& key, const osg::Object* object, const Config& metadata, const osgDB::Options* dbo)
+{
+    Config meta = metadata;
+    osg::ref_ptr<const osg::Object> encoded = encode(object, meta);
+    return _bin->write(key, encoded.get(), meta, dbo);
+}
+
+CacheBin::RecordStatus
+EncodingCacheBin::getRecordStatus(const TileRecordKey& key)
+{
+    return _bin->getRecordStatus(key);
+}
+
+unsigned
+EncodingCacheBin::writeBatch(const std::vector<WriteRecord>& records)
+{
+    // encode the whole batch and hand it on, so the bin can still
+    // commit it in one go
+    std::vector<WriteRecord> encoded(records);
+    for (auto& record : encoded)
+    {
+        record._object = encode(record._object.get(), record._metadata);
+    }
+    return _bin->writeBatch(encoded);
+}
+
+bool
+EncodingCacheBin::remove(const std::string& key)
+{
+    return _bin->remove(key);
+}
+
+bool
+EncodingCacheBin::touch(const std::string& key)
+{
+    return _bin->touch(key);
+}
+
+bool
+EncodingCacheBin::clear()
+{
+    return _bin->clear();
+}
+
+bool
+EncodingCacheBin::compact()
+{
+    return _bin->compact();
+}
+
+unsigned
+EncodingCacheBin::getStorageSize()
+{
+    return _bin->getStorageSize();
+}
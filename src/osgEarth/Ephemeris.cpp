@@ -316,16 +316,56 @@ namespace
 #undef  LC
 #define LC "[Ephemeris] "
 
+Ephemeris::Ephemeris() :
+    _timeResolution(1.0)
+{
+    _cacheMutex.setName(OE_MUTEX_NAME);
+}
+
+void
+Ephemeris::setTimeResolution(double seconds)
+{
+    Threading::ScopedMutexLock lock(_cacheMutex);
+    _timeResolution = osg::maximum(seconds, 0.0);
+    _sun = Cached();
+    _moon = Cached();
+}
+
+double
+Ephemeris::getInterval(const DateTime& dt) const
+{
+    // negative means "don't cache"
+    return _timeResolution > 0.0 ?
+        floor((double)dt.asTimeStamp() / _timeResolution) :
+        -1.0;
+}
+
 CelestialBody
 Ephemeris::getSunPosition(const DateTime& dt) const
 {
-    return Sun().getPosition(dt);
+    Threading::ScopedMutexLock lock(_cacheMutex);
+
+    double interval = getInterval(dt);
+    if (interval < 0.0 || interval != _sun._interval)
+    {
+        _sun._body = Sun().getPosition(dt);
+        _sun._interval = interval;
+    }
+    return _sun._body;
 }
 
 CelestialBody
 Ephemeris::getMoonPosition(const DateTime& dt) const
 {
-    return Moon().getPosition(dt);
+    Threading::ScopedMutexLock lock(_cacheMutex);
+
+    double interval = getInterval(dt);
+    if (interval < 0.0 || interval != _moon._interval)
+    {
+        _moon._body = Moon().getPosition(dt);
+        _moon._interval = interval;
+    }
+    return _moon._body;
 }
 
 osg::Vec3d
@@ -450,6 +450,7 @@ MapNodeHelper::parse(MapNode*             mapNode,
     bool useLogDepth2  = args.read("--logdepth2");
     bool useLogDepth   = !args.read("--nologdepth") && !useLogDepth2; //args.read("--logdepth");
     bool kmlUI         = args.read("--kmlui");
+    bool kmlAsync      = args.read("--kmlasync");
 
     std::string kmlFile;
     args.read( "--kml", kmlFile );
@@ -499,6 +500,7 @@ MapNodeHelper::parse(MapNode*             mapNode,
     {
         KML::KMLOptions kml_options;
         kml_options.declutter() = true;
+        kml_options.asynchronous() = kmlAsync;
 
         // set up a default icon for point placemarks:
         IconSymbol* defaultIcon = new IconSymbol();
@@ -712,6 +714,9 @@ MapNodeHelper::parse(MapNode*             mapNode,
             ShadowCaster* caster = new ShadowCaster();
             caster->setTextureImageUnit( unit );
             caster->setLight( view->getLight() );
+            unsigned cachedSlices;
+            if (args.read("--shadows-cached", cachedSlices))
+                caster->setNumCachedSlices( cachedSlices );
             caster->getShadowCastingGroup()->addChild(mapNode->getLayerNodeGroup());
             caster->getShadowCastingGroup()->addChild(mapNode->getTerrainEngine()->getNode());
             if ( mapNode->getNumParents() > 0 )
@@ -764,11 +769,13 @@ MapNodeHelper::usage() const
         << "  --sky                         : add a sky model\n"
         << "  --kml <file.kml>              : load a KML or KMZ file\n"
         << "  --kmlui                       : display a UI for toggling nodes loaded with --kml\n"
+        << "  --kmlasync                    : load the --kml file in the background\n"
         << "  --coords                      : display map coords under mouse\n"
         << "  --ortho                       : use an orthographic camera\n"
         << "  --logdepth                    : activates the logarithmic depth buffer\n"
         << "  --logdepth2                   : activates logarithmic depth buffer with per-fragment interpolation\n"
         << "  --shadows                     : activates model layer shadows\n"
+        << "  --shadows-cached [n]          : only re-render the n farthest shadow slices when the camera or sun moves\n"
         << "  --out-earth [file]            : write the loaded map to an earth file\n"
         << "  --uniform [name] [min] [max]  : create a uniform controller with min/max values\n"
         << "  --define [name]               : install a shader #define\n"
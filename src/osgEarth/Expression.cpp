@@ -281,82 +281,42 @@ NumericExpression::eval() const
 {
     if ( _dirty )
     {
-        std::stack<double> s;
+        // the RPN never needs more stack than it has atoms, so the stack
+        // is sized once and reused rather than allocated per evaluation
+        std::vector<double>& s = const_cast<NumericExpression*>(this)->_stack;
+        if (s.size() < _rpn.size())
+            s.resize(_rpn.size());
+
+        unsigned top = 0;
 
         for( unsigned i=0; i<_rpn.size(); ++i )
         {
             const Atom& a = _rpn[i];
 
-            if ( a.first == ADD )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 + op2 );
-                }
-            }
-            else if ( a.first == SUB )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 - op2 );
-                }
-            }
-            else if ( a.first == MULT )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 * op2 );
-                }
-            }
-            else if ( a.first == DIV )
+            if ( a.first == OPERAND || a.first == VARIABLE )
             {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( op1 / op2 );
-                }
+                s[top++] = a.second;
             }
-            else if ( a.first == MOD )
+            else if ( top >= 2 )
             {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( fmod(op1, op2) );
-                }
-            }
-            else if ( a.first == MIN )
-            {
-                if ( s.size() >= 2 )
-                {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( osg::minimum(op1, op2) );
-                }
-            }
-            else if ( a.first == MAX )
-            {
-                if ( s.size() >= 2 )
+                double op2 = s[--top];
+                double& op1 = s[top-1];
+
+                switch( a.first )
                 {
-                    double op2 = s.top(); s.pop();
-                    double op1 = s.top(); s.pop();
-                    s.push( osg::maximum(op1, op2) );
+                case ADD:  op1 = op1 + op2; break;
+                case SUB:  op1 = op1 - op2; break;
+                case MULT: op1 = op1 * op2; break;
+                case DIV:  op1 = op1 / op2; break;
+                case MOD:  op1 = fmod(op1, op2); break;
+                case MIN:  op1 = osg::minimum(op1, op2); break;
+                case MAX:  op1 = osg::maximum(op1, op2); break;
+                default:   s[top++] = op2; break;
                 }
             }
-            else // OPERAND or VARIABLE
-            {
-                s.push( a.second );
-            }
         }
 
-        const_cast<NumericExpression*>(this)->_value = s.size() > 0 ? s.top() : 0.0;
+        const_cast<NumericExpression*>(this)->_value = top > 0 ? s[top-1] : 0.0;
         const_cast<NumericExpression*>(this)->_dirty = false;
     }
 
@@ -549,11 +509,11 @@ StringExpression::eval() const
 {
     if ( _dirty )
     {
-        std::stringstream buf;
+        std::string& value = const_cast<StringExpression*>(this)->_value;
+        value.clear();
         for( AtomVector::const_iterator i = _infix.begin(); i != _infix.end(); ++i )
-            buf << i->second;
+            value += i->second;
 
-        const_cast<StringExpression*>(this)->_value = buf.str();
         const_cast<StringExpression*>(this)->_dirty = false;
     }
 
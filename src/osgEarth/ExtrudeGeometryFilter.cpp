@@ -73,6 +73,26 @@ namespace
 
         return atan2( p2.x()-p1.x(), p2.y()-p1.y() );
     }
+
+    // Tessellates the line loops in a geometry into triangles with the
+    // earcut tessellator, or with the OSG tessellator if asked to or if
+    // earcut can't handle the primitives.
+    void tessellateLoops( osg::Geometry& geom, bool useOSGTessellator )
+    {
+        if ( !useOSGTessellator )
+        {
+            osgEarth::Tessellator oeTess;
+            if ( oeTess.tessellateGeometry(geom) )
+                return;
+
+            OE_DEBUG << LC << "Falling back on OSG tessellator (" << geom.getName() << ")" << std::endl;
+        }
+
+        osgUtil::Tessellator tess;
+        tess.setTessellationType( osgUtil::Tessellator::TESS_TYPE_GEOMETRY );
+        tess.setWindingType( osgUtil::Tessellator::TESS_WINDING_ODD );
+        tess.retessellatePolygons( geom );
+    }
 }
 
 #define AS_VEC4(V3, X) osg::Vec4f( (V3).x(), (V3).y(), (V3).z(), X )
@@ -84,7 +104,8 @@ _mergeGeometry         ( true ),
 _wallAngleThresh_deg   ( 60.0 ),
 _styleDirty            ( true ),
 _makeStencilVolume     ( false ),
-_gpuClamping           ( false )
+_gpuClamping           ( false ),
+_useOSGTessellator     ( false )
 {
     _cosWallAngleThresh = cos( _wallAngleThresh_deg );
 }
@@ -101,6 +122,7 @@ ExtrudeGeometryFilter::reset( const FilterContext& context )
 {
     _cosWallAngleThresh = cos( _wallAngleThresh_deg );
     _geodes.clear();
+    _wallBatches.clear();
     
     if ( _styleDirty )
     {
@@ -324,6 +346,15 @@ ExtrudeGeometryFilter::buildStructure(const Geometry*         input,
     double texWidthM  = wallSkin ? *wallSkin->imageWidth() : 0.0;
     double texHeightM = wallSkin ? *wallSkin->imageHeight() : 1.0;
 
+    // set up the transforms once for all the parts
+    SRSTransformer roofProjXform;
+    if ( roofSkin && srs.valid() && srs->isGeographic() && roofProjSRS.valid() )
+        roofProjXform = SRSTransformer( srs.get(), roofProjSRS.get() );
+
+    SRSTransformer targetXform;
+    if ( srs.valid() && mapSRS.valid() )
+        targetXform = SRSTransformer( srs.get(), makeECEF ? mapSRS->getGeocentricSRS() : mapSRS.get() );
+
     ConstGeometryIterator iter( input );
     while( iter.hasMore() )
     {
@@ -366,38 +397,60 @@ ExtrudeGeometryFilter::buildStructure(const Geometry*         input,
                 corner->roof = *m;
                 corner->base.z() += height;
             }
-            
-            // figure out the rooftop texture coords before doing any transformation:
-            if ( roofSkin && srs )
+        }
+
+        // The transforms below run once per part over all its corners; going
+        // through the SRS one point at a time costs far more than the math.
+
+        // figure out the rooftop texture coords before doing any transformation:
+        if ( roofSkin && srs )
+        {
+            std::vector<osg::Vec3d> roofs;
+            roofs.reserve( corners.size() );
+            for(Corners::const_iterator c = corners.begin(); c != corners.end(); ++c)
+                roofs.push_back( c->roof );
+
+            if ( roofProjXform.valid() )
             {
-                double xr, yr;
+                roofProjXform.transform( roofs );
+            }
 
-                if ( srs && srs->isGeographic() && roofProjSRS )
-                {
-                    osg::Vec3d projRoofPt;
-                    srs->transform( corner->roof, roofProjSRS.get(), projRoofPt );
-                    xr = (projRoofPt.x() - roofBounds.xMin());
-                    yr = (projRoofPt.y() - roofBounds.yMin());
-                }
-                else
-                {
-                    xr = (corner->roof.x() - roofBounds.xMin());
-                    yr = (corner->roof.y() - roofBounds.yMin());
-                }
+            unsigned i = 0;
+            for(Corners::iterator c = corners.begin(); c != corners.end(); ++c, ++i)
+            {
+                double xr = (roofs[i].x() - roofBounds.xMin());
+                double yr = (roofs[i].y() - roofBounds.yMin());
+
+                c->roofTexU = (cosR*xr - sinR*yr) / roofTexSpanX;
+                c->roofTexV = (sinR*xr + cosR*yr) / roofTexSpanY;
+            }
+        }
 
-                corner->roofTexU = (cosR*xr - sinR*yr) / roofTexSpanX;
-                corner->roofTexV = (sinR*xr + cosR*yr) / roofTexSpanY;
+        // transform into target SRS.
+        if (targetXform.valid())
+        {
+            std::vector<osg::Vec3d> points;
+            points.reserve( corners.size()*2 );
+            for(Corners::const_iterator c = corners.begin(); c != corners.end(); ++c)
+            {
+                points.push_back( c->base );
+                points.push_back( c->roof );
             }
 
-            // transform into target SRS.
-            if (srs.valid() && mapSRS.valid())
+            targetXform.transform( points );
+
+            unsigned i = 0;
+            for(Corners::iterator c = corners.begin(); c != corners.end(); ++c)
             {
-                transformAndLocalize( corner->base, srs.get(), corner->base, mapSRS.get(), _world2local, makeECEF );
-                transformAndLocalize( corner->roof, srs.get(), corner->roof, mapSRS.get(), _world2local, makeECEF );
+                c->base = points[i++] * _world2local;
+                c->roof = points[i++] * _world2local;
             }
+        }
 
-            // cache the length for later use.
-            corner->height = (corner->roof - corner->base).length();
+        // cache the length for later use.
+        for(Corners::iterator c = corners.begin(); c != corners.end(); ++c)
+        {
+            c->height = (c->roof - c->base).length();
         }
 
         // Step 2 - Insert intermediate Corners as needed to satify texturing
@@ -555,53 +608,83 @@ ExtrudeGeometryFilter::buildWallGeometry(const Structure&     structure,
         layer = (float)wallSkin->imageLayer().get();
     }
 
-    // create all the OSG geometry components
-    osg::Vec3Array* verts = new osg::Vec3Array( numWallVerts );
-    walls->setVertexArray( verts );
-    
-    osg::Vec3Array* tex = 0L;
-    if ( wallSkin )
-    { 
-        tex = new osg::Vec3Array( numWallVerts );
+    if ( numWallVerts == 0 )
+        return madeGeom;
+
+    // The walls are appended to whatever the geometry already holds, so
+    // every array is sized once for the new total rather than grown per vertex.
+    osg::Vec3Array* verts = static_cast<osg::Vec3Array*>( walls->getVertexArray() );
+    if ( !verts )
+    {
+        verts = new osg::Vec3Array();
+        walls->setVertexArray( verts );
+    }
+
+    const unsigned base  = verts->size();
+    const unsigned total = base + numWallVerts;
+    verts->resize( total );
+
+    osg::Vec3Array* tex = static_cast<osg::Vec3Array*>( walls->getTexCoordArray(0) );
+    if ( !tex && wallSkin )
+    {
+        tex = new osg::Vec3Array( base );
         walls->setTexCoordArray( 0, tex );
     }
+    if ( tex )
+    {
+        tex->resize( total );
+    }
 
-    osg::Vec4Array* colors = 0L;
-    if ( useColor )
+    osg::Vec4Array* colors = static_cast<osg::Vec4Array*>( walls->getColorArray() );
+    if ( !colors && useColor )
     {
-        colors = new osg::Vec4Array( osg::Array::BIND_PER_VERTEX, numWallVerts );
+        colors = new osg::Vec4Array( osg::Array::BIND_PER_VERTEX, base );
         walls->setColorArray( colors );
     }
+    if ( colors )
+    {
+        colors->resize( total, osg::Vec4f(1,1,1,1) );
+    }
 
-    osg::Vec4Array* anchors = 0L;
-    
     // If GPU clamping is in effect, create clamping attributes.
-    if ( _gpuClamping )
+    osg::Vec4Array* anchors = static_cast<osg::Vec4Array*>( walls->getVertexAttribArray(Clamping::AnchorAttrLocation) );
+    if ( !anchors && _gpuClamping )
     {
-        anchors = new osg::Vec4Array( osg::Array::BIND_PER_VERTEX, numWallVerts );
+        anchors = new osg::Vec4Array( osg::Array::BIND_PER_VERTEX, base );
         anchors->setNormalize(false);
         walls->setVertexAttribArray    ( Clamping::AnchorAttrLocation, anchors );
     }
+    if ( anchors )
+    {
+        anchors->resize( total );
+    }
 
-    unsigned vertptr = 0;
-    bool     tex_repeats_y = wallSkin && wallSkin->isTiled() == true;
-
-    bool flatten =
-        _style.has<ExtrusionSymbol>() &&
-        _style.get<ExtrusionSymbol>()->flatten() == true;
+    // A geometry that already holds walls carries the primitive set to append
+    // to; otherwise make one sized for these walls alone.
+    osg::DrawElements* de = walls->getNumPrimitiveSets() > 0 ?
+        walls->getPrimitiveSet(0)->getDrawElements() : 0L;
 
-    for(Elevations::const_iterator elev = structure.elevations.begin(); elev != structure.elevations.end(); ++elev)
+    if ( !de )
     {
-        osg::DrawElements* de = 
+        de = 
             numWallVerts > 0xFFFF ? (osg::DrawElements*) new osg::DrawElementsUInt  ( GL_TRIANGLES ) :
             numWallVerts > 0xFF   ? (osg::DrawElements*) new osg::DrawElementsUShort( GL_TRIANGLES ) :
                                     (osg::DrawElements*) new osg::DrawElementsUByte ( GL_TRIANGLES );
+        walls->addPrimitiveSet( de );
+    }
 
-        // pre-allocate for speed
-        de->reserveElements( numWallVerts );
+    // pre-allocate for speed
+    de->reserveElements( de->getNumIndices() + numWallVerts );
 
-        walls->addPrimitiveSet( de );
+    unsigned vertptr = base;
+    bool     tex_repeats_y = wallSkin && wallSkin->isTiled() == true;
 
+    bool flatten =
+        _style.has<ExtrusionSymbol>() &&
+        _style.get<ExtrusionSymbol>()->flatten() == true;
+
+    for(Elevations::const_iterator elev = structure.elevations.begin(); elev != structure.elevations.end(); ++elev)
+    {
         for(Faces::const_iterator f = elev->faces.begin(); f != elev->faces.end(); ++f, vertptr+=6)
         {
             // set the 6 wall verts.
@@ -686,15 +769,9 @@ ExtrudeGeometryFilter::buildWallGeometry(const Structure&     structure,
             }
         }
     }
-    
-    // generate per-vertex normals, altering the geometry as necessary to avoid
-    // smoothing around sharp corners
 
-    // TODO: reconsider this, given the new Structure setup
-    // it won't actual smooth corners since we don't have shared edges.
-    osgUtil::SmoothingVisitor::smooth(
-        *walls,
-        osg::DegreesToRadians(_wallAngleThresh_deg) );
+    // normals are generated by the caller (see smoothWalls) so that walls
+    // appended to a shared geometry are smoothed once, not once per feature.
 
     return madeGeom;
 }
@@ -706,16 +783,26 @@ ExtrudeGeometryFilter::buildRoofGeometry(const Structure&     structure,
                                          const osg::Vec4&     roofColor,
                                          const SkinResource*  roofSkin)
 {    
+    // count the source corners up front so the arrays are allocated once
+    unsigned numRoofVerts = 0;
+    for(Elevations::const_iterator e = structure.elevations.begin(); e != structure.elevations.end(); ++e)
+        for(Faces::const_iterator f = e->faces.begin(); f != e->faces.end(); ++f)
+            if ( f->left.isFromSource )
+                ++numRoofVerts;
+
     osg::Vec3Array* verts = new osg::Vec3Array();
+    verts->reserve( numRoofVerts );
     roof->setVertexArray( verts );
 
     osg::Vec4Array* color = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX);
+    color->reserve( numRoofVerts );
     roof->setColorArray( color );
 
     osg::Vec3Array* tex = 0L;
     if ( roofSkin )
     {
         tex = new osg::Vec3Array();
+        tex->reserve( numRoofVerts );
         roof->setTexCoordArray(0, tex);
     }
 
@@ -726,6 +813,7 @@ ExtrudeGeometryFilter::buildRoofGeometry(const Structure&     structure,
         // so we will put them in one of the texture arrays and copy them to an attrib array 
         // after tessellation. #osghack
         anchors = new osg::Vec4Array();
+        anchors->reserve( numRoofVerts );
         roof->setTexCoordArray(1, anchors);
     }
 
@@ -780,20 +868,8 @@ ExtrudeGeometryFilter::buildRoofGeometry(const Structure&     structure,
     roof->setNormalArray( normal );
     normal->assign( verts->size(), osg::Vec3(0,0,1) );
 
-    int v = verts->size();
-
     // Tessellate the roof lines into polygons.
-    osgEarth::Tessellator oeTess;
-    if (!oeTess.tessellateGeometry(*roof))
-    {
-        //fallback to osg tessellator
-        OE_DEBUG << LC << "Falling back on OSG tessellator (" << roof->getName() << ")" << std::endl;
-
-        osgUtil::Tessellator tess;
-        tess.setTessellationType( osgUtil::Tessellator::TESS_TYPE_GEOMETRY );
-        tess.setWindingType( osgUtil::Tessellator::TESS_WINDING_ODD );
-        tess.retessellatePolygons( *roof );
-    }
+    tessellateLoops( *roof, _useOSGTessellator );
 
     // Move the anchors to the correct place. :)
     if ( _gpuClamping )
@@ -993,9 +1069,55 @@ ExtrudeGeometryFilter::addDrawable(osg::Drawable*       drawable,
     }
 }
 
+osg::Geometry*
+ExtrudeGeometryFilter::getWallBatch(osg::StateSet* stateSet, unsigned numVerts)
+{
+    std::vector< osg::ref_ptr<osg::Geometry> >& batches = _wallBatches[stateSet];
+
+    if ( !batches.empty() )
+    {
+        osg::Geometry* batch = batches.back().get();
+        if ( batch->getVertexArray()->getNumElements() + numVerts <= Registry::instance()->getMaxNumberOfVertsPerDrawable() )
+        {
+            return batch;
+        }
+    }
+
+    // start a new batch. It always uses 32-bit indices since we don't know
+    // yet how many features will end up in it.
+    osg::Geometry* batch = new osg::Geometry();
+    batch->setUseVertexBufferObjects(true);
+    batch->setVertexArray( new osg::Vec3Array() );
+    batch->addPrimitiveSet( new osg::DrawElementsUInt(GL_TRIANGLES) );
+    batches.push_back( batch );
+
+    addDrawable( batch, stateSet, std::string(), 0L, 0L );
+
+    return batch;
+}
+
+void
+ExtrudeGeometryFilter::smoothWalls(osg::Geometry* walls)
+{
+    // generate per-vertex normals, altering the geometry as necessary to avoid
+    // smoothing around sharp corners
+
+    // TODO: reconsider this, given the new Structure setup
+    // it won't actual smooth corners since we don't have shared edges.
+    osgUtil::SmoothingVisitor::smooth(
+        *walls,
+        osg::DegreesToRadians(_wallAngleThresh_deg) );
+}
+
 bool
 ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
 {
+    // When merging, all the walls that share a stateset are written straight
+    // into one geometry instead of being built per feature and merged later.
+    bool batchWalls = _mergeGeometry && _featureNameExpr.empty();
+
+    FeatureIndexBuilder* index = context.featureIndex();
+
     for( FeatureList::iterator f = features.begin(); f != features.end(); ++f )
     {
         Feature* input = f->get();
@@ -1026,9 +1148,6 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
         {
             Geometry* part = iter.next();
 
-            osg::ref_ptr<osg::Geometry> walls = new osg::Geometry();
-            walls->setUseVertexBufferObjects(true);
-            
             osg::ref_ptr<osg::Geometry> rooflines = 0L;
             osg::ref_ptr<osg::Geometry> baselines = 0L;
             osg::ref_ptr<osg::Drawable> outlines  = 0L;
@@ -1124,8 +1243,27 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
                 context);
 
             // Create the walls.
-            if ( walls.valid() )
+            osg::ref_ptr<osg::Geometry> walls;
+            unsigned numWallVerts = structure.getNumPoints();
+
+            if ( numWallVerts > 0 )
             {
+                if ( wallSkin )
+                {
+                    // Get a stateset for the individual wall stateset
+                    context.resourceCache()->getOrCreateStateSet(wallSkin, wallStateSet, context.getDBOptions());
+                }
+
+                if ( batchWalls )
+                {
+                    walls = getWallBatch( wallStateSet.get(), numWallVerts );
+                }
+                else
+                {
+                    walls = new osg::Geometry();
+                    walls->setUseVertexBufferObjects(true);
+                }
+
                 osg::Vec4f wallColor(1,1,1,1), wallBaseColor(1,1,1,1);
 
                 if ( _wallPolygonSymbol.valid() )
@@ -1142,12 +1280,22 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
                     wallBaseColor = wallColor;
                 }
 
+                unsigned first = walls->getVertexArray() ? walls->getVertexArray()->getNumElements() : 0u;
+
                 buildWallGeometry(structure, walls.get(), wallColor, wallBaseColor, wallSkin);
 
-                if ( wallSkin )
+                if ( batchWalls )
                 {
-                    // Get a stateset for the individual wall stateset
-                    context.resourceCache()->getOrCreateStateSet(wallSkin, wallStateSet, context.getDBOptions());
+                    // the batch is already in the scene graph; tag just this feature's verts.
+                    if ( index )
+                    {
+                        index->tagRange( walls.get(), input, first, numWallVerts );
+                    }
+                    walls = 0L;
+                }
+                else
+                {
+                    smoothWalls( walls.get() );
                 }
             }
 
@@ -1176,10 +1324,7 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
 
             if ( baselines.valid() )
             {
-                osgUtil::Tessellator tess;
-                tess.setTessellationType( osgUtil::Tessellator::TESS_TYPE_GEOMETRY );
-                tess.setWindingType( osgUtil::Tessellator::TESS_WINDING_ODD );
-                tess.retessellatePolygons( *(baselines.get()) );
+                tessellateLoops( *baselines.get(), _useOSGTessellator );
             }
 
             // Set up for feature naming and feature indexing:
@@ -1187,8 +1332,6 @@ ExtrudeGeometryFilter::process( FeatureList& features, FilterContext& context )
             if ( !_featureNameExpr.empty() )
                 name = input->eval( _featureNameExpr, &context );
 
-            FeatureIndexBuilder* index = context.featureIndex();
-
             if ( walls.valid() && walls->getVertexArray() && walls->getVertexArray()->getNumElements() > 0 )
             {
                 addDrawable( walls.get(), wallStateSet.get(), name, input, index );
@@ -1264,6 +1407,16 @@ ExtrudeGeometryFilter::push( FeatureList& input, FilterContext& context )
     // push all the features through the extruder.
     bool ok = process( input, context );
 
+    // the batched walls are complete, so generate their normals.
+    for( WallBatchMap::iterator i = _wallBatches.begin(); i != _wallBatches.end(); ++i )
+    {
+        for( unsigned b = 0; b < i->second.size(); ++b )
+        {
+            smoothWalls( i->second[b].get() );
+        }
+    }
+    _wallBatches.clear();
+
     // parent geometry with a delocalizer (if necessary)
     osg::Group* group = createDelocalizeGroup();
     
@@ -25,6 +25,12 @@
 #include <osgEarth/JsonUtils>
 #include <algorithm>
 
+#if defined(WIN32) && !defined(__CYGWIN__)
+#  define STRICMP ::stricmp
+#else
+#  define STRICMP ::strcasecmp
+#endif
+
 using namespace osgEarth;
 using namespace osgEarth::Util;
 
@@ -93,6 +99,158 @@ FeatureProfile::setTilingProfile( const osgEarth::Profile* profile )
 
 //----------------------------------------------------------------------------
 
+AttributeString::AttributeString(const std::string& value)
+{
+    if (!value.empty())
+        _ptr = std::make_shared<const std::string>(value);
+}
+
+AttributeString&
+AttributeString::operator = (const std::string& value)
+{
+    if (value.empty())
+        _ptr = nullptr;
+    else if (!_ptr || *_ptr != value)
+        _ptr = std::make_shared<const std::string>(value);
+    return *this;
+}
+
+const std::string&
+AttributeString::str() const
+{
+    return _ptr ? *_ptr : EMPTY_STRING;
+}
+
+//----------------------------------------------------------------------------
+
+StringPool::StringPool()
+{
+    _mutex.setName("oe.StringPool");
+}
+
+AttributeString
+StringPool::intern(const std::string& value)
+{
+    AttributeString result;
+    if (!value.empty())
+    {
+        // non-owning key, so looking up an existing string doesn't allocate
+        Entry key(Entry(), &value);
+
+        ScopedMutexLock lock(_mutex);
+        auto i = _strings.find(key);
+        if (i != _strings.end())
+            result._ptr = *i;
+        else
+            result._ptr = *_strings.insert(std::make_shared<const std::string>(value)).first;
+    }
+    return result;
+}
+
+void
+StringPool::intern(AttributeString& value)
+{
+    if (value._ptr)
+    {
+        ScopedMutexLock lock(_mutex);
+        // a string the pool hasn't seen becomes the pooled copy itself
+        value._ptr = *_strings.insert(value._ptr).first;
+    }
+}
+
+unsigned
+StringPool::size() const
+{
+    ScopedMutexLock lock(_mutex);
+    return _strings.size();
+}
+
+void
+StringPool::prune()
+{
+    ScopedMutexLock lock(_mutex);
+    for (auto i = _strings.begin(); i != _strings.end(); )
+    {
+        if (i->use_count() == 1)
+            i = _strings.erase(i);
+        else
+            ++i;
+    }
+}
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+    struct LessByName
+    {
+        bool operator()(const AttributeTable::value_type& lhs, const std::string& rhs) const {
+            return STRICMP(lhs.first.c_str(), rhs.c_str()) < 0;
+        }
+    };
+}
+
+std::vector<AttributeTable::value_type>::iterator
+AttributeTable::lowerBound(const std::string& name)
+{
+    return std::lower_bound(_entries.begin(), _entries.end(), name, LessByName());
+}
+
+AttributeTable::const_iterator
+AttributeTable::find(const std::string& name) const
+{
+    const_iterator i = std::lower_bound(_entries.begin(), _entries.end(), name, LessByName());
+    if (i != _entries.end() && STRICMP(i->first.c_str(), name.c_str()) == 0)
+        return i;
+    return _entries.end();
+}
+
+AttributeTable::const_iterator
+AttributeTable::find(const std::string& name, unsigned& hint) const
+{
+    if (hint < _entries.size() && STRICMP(_entries[hint].first.c_str(), name.c_str()) == 0)
+        return _entries.begin() + hint;
+
+    const_iterator i = find(name);
+    if (i != _entries.end())
+        hint = (unsigned)(i - _entries.begin());
+    return i;
+}
+
+AttributeValue&
+AttributeTable::operator[](const std::string& name)
+{
+    std::vector<value_type>::iterator i = lowerBound(name);
+    if (i == _entries.end() || STRICMP(i->first.c_str(), name.c_str()) != 0)
+    {
+        i = _entries.insert(i, value_type(AttributeString(name), AttributeValue()));
+    }
+    return i->second;
+}
+
+void
+AttributeTable::erase(const std::string& name)
+{
+    std::vector<value_type>::iterator i = lowerBound(name);
+    if (i != _entries.end() && STRICMP(i->first.c_str(), name.c_str()) == 0)
+    {
+        _entries.erase(i);
+    }
+}
+
+void
+AttributeTable::intern(StringPool& pool)
+{
+    for (auto& entry : _entries)
+    {
+        pool.intern(entry.first);
+        if (entry.second.first == ATTRTYPE_STRING)
+            pool.intern(entry.second.second.stringValue);
+    }
+}
+
+//----------------------------------------------------------------------------
+
 std::string
 AttributeValue::getString() const
 {
@@ -349,48 +507,48 @@ Feature::setNull( const std::string& name, AttributeType type)
 bool
 Feature::hasAttr( const std::string& name ) const
 {
-    return _attrs.find(toLower(name)) != _attrs.end();
+    return _attrs.find(name) != _attrs.end();
 }
 
 std::string
 Feature::getString( const std::string& name ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
+    AttributeTable::const_iterator i = _attrs.find(name);
     return i != _attrs.end()? i->second.getString() : EMPTY_STRING;
 }
 
 double
 Feature::getDouble( const std::string& name, double defaultValue ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
+    AttributeTable::const_iterator i = _attrs.find(name);
     return i != _attrs.end()? i->second.getDouble(defaultValue) : defaultValue;
 }
 
 long long
 Feature::getInt( const std::string& name, long long defaultValue ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
+    AttributeTable::const_iterator i = _attrs.find(name);
     return i != _attrs.end()? i->second.getInt(defaultValue) : defaultValue;
 }
 
 const std::vector<double>*
 Feature::getDoubleArray( const std::string& name ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
+    AttributeTable::const_iterator i = _attrs.find(name);
     return i != _attrs.end()? &i->second.getDoubleArrayValue() : 0L;
 }
 
 bool
 Feature::getBool( const std::string& name, bool defaultValue ) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
+    AttributeTable::const_iterator i = _attrs.find(name);
     return i != _attrs.end()? i->second.getBool(defaultValue) : defaultValue;
 }
 
 bool
 Feature::isSet( const std::string& name) const
 {
-    AttributeTable::const_iterator i = _attrs.find(toLower(name));
+    AttributeTable::const_iterator i = _attrs.find(name);
     return i != _attrs.end()? i->second.second.set : false;
 }
 
@@ -401,7 +559,7 @@ Feature::eval( NumericExpression& expr, FilterContext const* context ) const
     for( NumericExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
       double val = 0.0;
-      AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+      AttributeTable::const_iterator ai = _attrs.find(i->first);
       if (ai != _attrs.end())
       {
         val = ai->second.getDouble(0.0);
@@ -434,7 +592,7 @@ Feature::eval(NumericExpression& expr, Session* session) const
     for( NumericExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
         double val = 0.0;
-        AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+        AttributeTable::const_iterator ai = _attrs.find(i->first);
         if (ai != _attrs.end())
         {
             val = ai->second.getDouble(0.0);
@@ -470,7 +628,7 @@ Feature::eval( StringExpression& expr, FilterContext const* context ) const
     for( StringExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
       std::string val = "";
-      AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+      AttributeTable::const_iterator ai = _attrs.find(i->first);
       if (ai != _attrs.end())
       {
         val = ai->second.getString();
@@ -506,7 +664,7 @@ Feature::eval(StringExpression& expr, Session* session) const
     for( StringExpression::Variables::const_iterator i = vars.begin(); i != vars.end(); ++i )
     {
         std::string val = "";
-        AttributeTable::const_iterator ai = _attrs.find(toLower(i->first));
+        AttributeTable::const_iterator ai = _attrs.find(i->first);
         if (ai != _attrs.end())
         {
             val = ai->second.getString();
@@ -535,6 +693,125 @@ Feature::eval(StringExpression& expr, Session* session) const
     return expr.eval();
 }
 
+void
+Feature::eval(NumericExpression& expr, const FeatureList& features, FilterContext const* context, std::vector<double>& results)
+{
+    const NumericExpression::Variables& vars = expr.variables();
+    ScriptEngine* engine = context && context->getSession() ? context->getSession()->getScriptEngine() : 0L;
+
+    // resolve each variable for the whole list before evaluating anything,
+    // so that all the features needing a script go to the engine together
+    std::vector<std::vector<double> > values(vars.size(), std::vector<double>(features.size(), 0.0));
+
+    for (unsigned v = 0; v < vars.size(); ++v)
+    {
+        const std::string& name = vars[v].first;
+        unsigned hint = 0u;
+        FeatureList scripted;
+        std::vector<unsigned> scriptedRows;
+
+        unsigned row = 0u;
+        for (FeatureList::const_iterator f = features.begin(); f != features.end(); ++f, ++row)
+        {
+            AttributeTable::const_iterator ai = f->get()->_attrs.find(name, hint);
+            if (ai != f->get()->_attrs.end())
+            {
+                values[v][row] = ai->second.getDouble(0.0);
+            }
+            else if (engine)
+            {
+                scripted.push_back(f->get());
+                scriptedRows.push_back(row);
+            }
+        }
+
+        if (!scripted.empty())
+        {
+            std::vector<ScriptResult> scriptResults;
+            engine->run(name, scripted, scriptResults, context);
+
+            for (unsigned k = 0; k < scriptResults.size() && k < scriptedRows.size(); ++k)
+            {
+                if (scriptResults[k].success())
+                    values[v][scriptedRows[k]] = scriptResults[k].asDouble();
+                else
+                    OE_WARN << LC << "Feature Script error on '" << expr.expr() << "': " << scriptResults[k].message() << std::endl;
+            }
+        }
+    }
+
+    results.resize(features.size());
+    for (unsigned row = 0; row < features.size(); ++row)
+    {
+        for (unsigned v = 0; v < vars.size(); ++v)
+            expr.set(vars[v], values[v][row]);
+
+        results[row] = expr.eval();
+    }
+}
+
+void
+Feature::eval(StringExpression& expr, const FeatureList& features, FilterContext const* context, std::vector<std::string>& results)
+{
+    const StringExpression::Variables& vars = expr.variables();
+    ScriptEngine* engine = context && context->getSession() ? context->getSession()->getScriptEngine() : 0L;
+
+    // resolve each variable for the whole list before evaluating anything,
+    // so that all the features needing a script go to the engine together
+    std::vector<std::vector<std::string> > values(vars.size(), std::vector<std::string>(features.size()));
+
+    for (unsigned v = 0; v < vars.size(); ++v)
+    {
+        const std::string& name = vars[v].first;
+        unsigned hint = 0u;
+        FeatureList scripted;
+        std::vector<unsigned> scriptedRows;
+
+        unsigned row = 0u;
+        for (FeatureList::const_iterator f = features.begin(); f != features.end(); ++f, ++row)
+        {
+            AttributeTable::const_iterator ai = f->get()->_attrs.find(name, hint);
+            if (ai != f->get()->_attrs.end())
+            {
+                values[v][row] = ai->second.getString();
+            }
+            else if (engine)
+            {
+                scripted.push_back(f->get());
+                scriptedRows.push_back(row);
+            }
+        }
+
+        if (!scripted.empty())
+        {
+            std::vector<ScriptResult> scriptResults;
+            engine->run(name, scripted, scriptResults, context);
+
+            for (unsigned k = 0; k < scriptResults.size() && k < scriptedRows.size(); ++k)
+            {
+                if (scriptResults[k].success())
+                {
+                    values[v][scriptedRows[k]] = scriptResults[k].asString();
+                }
+                else
+                {
+                    // Couldn't execute it as code, just take it as a string literal.
+                    values[v][scriptedRows[k]] = name;
+                    OE_DEBUG << LC << "Feature Script error on '" << expr.expr() << "': " << scriptResults[k].message() << std::endl;
+                }
+            }
+        }
+    }
+
+    results.resize(features.size());
+    for (unsigned row = 0; row < features.size(); ++row)
+    {
+        for (unsigned v = 0; v < vars.size(); ++v)
+            expr.set(vars[v], values[v][row]);
+
+        results[row] = expr.eval();
+    }
+}
 
 bool
 Feature::getWorldBound(const SpatialReference* srs,
@@ -647,7 +924,7 @@ Feature::getGeoJSON() const
     root["type"] = "Feature";
     root["id"] = (double)getFID(); //TODO:  Update JSON to use unsigned longs
 
-    Json::Reader reader;
+    Json::FastReader reader;
     Json::Value geometryValue( Json::objectValue );
     if ( reader.parse( geometry, geometryValue ) )
     {
@@ -665,44 +942,44 @@ Feature::getGeoJSON() const
             {
                 if (itr->second.second.set)
                 {
-                    props[itr->first] = (double)itr->second.getInt();
+                    props[itr->first.str()] = (double)itr->second.getInt();
                 }
                 else
                 {
-                    props[itr->first] = Json::nullValue;
+                    props[itr->first.str()] = Json::nullValue;
                 }
             }
             else if (itr->second.first == ATTRTYPE_DOUBLE)
             {
                 if (itr->second.second.set)
                 {
-                    props[itr->first] = itr->second.getDouble();
+                    props[itr->first.str()] = itr->second.getDouble();
                 }
                 else
                 {
-                    props[itr->first] = Json::nullValue;
+                    props[itr->first.str()] = Json::nullValue;
                 }
             }
             else if (itr->second.first == ATTRTYPE_BOOL)
             {
                 if (itr->second.second.set)
                 {
-                    props[itr->first] = itr->second.getBool();
+                    props[itr->first.str()] = itr->second.getBool();
                 }
                 else
                 {
-                    props[itr->first] = Json::nullValue;
+                    props[itr->first.str()] = Json::nullValue;
                 }
             }
             else
             {
                 if (itr->second.second.set)
                 {
-                    props[itr->first] = itr->second.getString();
+                    props[itr->first.str()] = itr->second.getString();
                 }
                 else
                 {
-                    props[itr->first] = Json::nullValue;
+                    props[itr->first.str()] = Json::nullValue;
                 }
             }
         }
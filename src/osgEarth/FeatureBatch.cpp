@@ -0,0 +1,468 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/FeatureBatch>
+
+using namespace osgEarth;
+
+#define LC "[FeatureBatch] "
+
+namespace
+{
+    template<typename T>
+    void compactArray(std::vector<T>& data, const std::vector<unsigned>& keep)
+    {
+        if (data.empty())
+            return;
+
+        for (unsigned i = 0; i < keep.size(); ++i)
+        {
+            if (keep[i] != i)
+                data[i] = std::move(data[keep[i]]);
+        }
+        data.resize(keep.size());
+    }
+}
+
+//........................................................................
+
+void
+FeatureBatch::Column::resize(unsigned rows)
+{
+    _state.resize(rows, STATE_ABSENT);
+
+    switch (_type)
+    {
+    case ATTRTYPE_STRING:      _strings.resize(rows); break;
+    case ATTRTYPE_DOUBLE:      _doubles.resize(rows, 0.0); break;
+    case ATTRTYPE_INT:         _ints.resize(rows, 0LL); break;
+    case ATTRTYPE_BOOL:        _bools.resize(rows, 0); break;
+    case ATTRTYPE_DOUBLEARRAY: _doubleArrays.resize(rows); break;
+    default: break;
+    }
+}
+
+void
+FeatureBatch::Column::append(const AttributeValue* value)
+{
+    unsigned row = _state.size();
+
+    if (value && value->first != ATTRTYPE_UNSPECIFIED)
+    {
+        if (_type == ATTRTYPE_UNSPECIFIED)
+        {
+            _type = value->first;
+            resize(row);
+        }
+        else if (value->first != _type && _type != ATTRTYPE_STRING && value->second.set)
+        {
+            promoteToString();
+        }
+    }
+
+    resize(row + 1);
+
+    if (value == nullptr)
+        return;
+
+    if (!value->second.set)
+    {
+        _state[row] = STATE_NULL;
+        return;
+    }
+
+    _state[row] = STATE_SET;
+
+    switch (_type)
+    {
+    case ATTRTYPE_STRING:
+        _strings[row] = value->first == ATTRTYPE_STRING ? value->second.stringValue.str() : value->getString();
+        break;
+    case ATTRTYPE_DOUBLE:
+        _doubles[row] = value->second.doubleValue; break;
+    case ATTRTYPE_INT:
+        _ints[row] = value->second.intValue; break;
+    case ATTRTYPE_BOOL:
+        _bools[row] = value->second.boolValue ? 1 : 0; break;
+    case ATTRTYPE_DOUBLEARRAY:
+        _doubleArrays[row] = value->second.doubleArrayValue; break;
+    default:
+        break;
+    }
+}
+
+void
+FeatureBatch::Column::promoteToString()
+{
+    std::vector<std::string> strings(_state.size());
+    for (unsigned row = 0; row < _state.size(); ++row)
+    {
+        if (_state[row] == STATE_SET)
+            strings[row] = getString(row);
+    }
+
+    _strings.swap(strings);
+    _doubles.clear();
+    _ints.clear();
+    _bools.clear();
+    _doubleArrays.clear();
+    _type = ATTRTYPE_STRING;
+}
+
+void
+FeatureBatch::Column::getValue(unsigned row, AttributeValue& out) const
+{
+    out.first = _type;
+    out.second.set = _state[row] == STATE_SET;
+    if (!out.second.set)
+        return;
+
+    switch (_type)
+    {
+    case ATTRTYPE_STRING:      out.second.stringValue = _strings[row]; break;
+    case ATTRTYPE_DOUBLE:      out.second.doubleValue = _doubles[row]; break;
+    case ATTRTYPE_INT:         out.second.intValue = _ints[row]; break;
+    case ATTRTYPE_BOOL:        out.second.boolValue = _bools[row] != 0; break;
+    case ATTRTYPE_DOUBLEARRAY: out.second.doubleArrayValue = _doubleArrays[row]; break;
+    default: break;
+    }
+}
+
+void
+FeatureBatch::Column::compact(const std::vector<unsigned>& keep)
+{
+    compactArray(_state, keep);
+    compactArray(_strings, keep);
+    compactArray(_doubles, keep);
+    compactArray(_ints, keep);
+    compactArray(_bools, keep);
+    compactArray(_doubleArrays, keep);
+}
+
+std::string
+FeatureBatch::Column::getString(unsigned row) const
+{
+    if (_type == ATTRTYPE_STRING)
+        return _state[row] == STATE_SET ? _strings[row] : std::string();
+
+    AttributeValue value;
+    getValue(row, value);
+    return value.getString();
+}
+
+double
+FeatureBatch::Column::getDouble(unsigned row, double defaultValue) const
+{
+    if (_state[row] != STATE_SET)
+        return defaultValue;
+
+    if (_type == ATTRTYPE_DOUBLE)
+        return _doubles[row];
+
+    AttributeValue value;
+    getValue(row, value);
+    return value.getDouble(defaultValue);
+}
+
+long long
+FeatureBatch::Column::getInt(unsigned row, long long defaultValue) const
+{
+    if (_state[row] != STATE_SET)
+        return defaultValue;
+
+    if (_type == ATTRTYPE_INT)
+        return _ints[row];
+
+    AttributeValue value;
+    getValue(row, value);
+    return value.getInt(defaultValue);
+}
+
+bool
+FeatureBatch::Column::getBool(unsigned row, bool defaultValue) const
+{
+    if (_state[row] != STATE_SET)
+        return defaultValue;
+
+    if (_type == ATTRTYPE_BOOL)
+        return _bools[row] != 0;
+
+    AttributeValue value;
+    getValue(row, value);
+    return value.getBool(defaultValue);
+}
+
+//........................................................................
+
+FeatureBatch::FeatureBatch()
+{
+    _rowParts.push_back(0u);
+}
+
+void
+FeatureBatch::clear()
+{
+    _srs = nullptr;
+    _fids.clear();
+    _rowParts.assign(1, 0u);
+    _parts.clear();
+    _points.clear();
+    _columns.clear();
+    _styles.clear();
+    _geoInterps.clear();
+}
+
+void
+FeatureBatch::add(const Feature* feature)
+{
+    if (feature == nullptr)
+        return;
+
+    unsigned row = size();
+
+    if (row == 0)
+    {
+        _srs = feature->getSRS();
+    }
+    else if (feature->getSRS() != _srs.get() &&
+             feature->getSRS() && !feature->getSRS()->isEquivalentTo(_srs.get()))
+    {
+        OE_DEBUG << LC << "Feature " << feature->getFID() << " has a different SRS than the batch" << std::endl;
+    }
+
+    _fids.push_back(feature->getFID());
+
+    addGeometry(feature->getGeometry());
+    _rowParts.push_back(_parts.size());
+
+    const AttributeTable& attrs = feature->getAttrs();
+
+    // existing columns first, so new ones below don't get two entries
+    for (auto& column : _columns)
+    {
+        AttributeTable::const_iterator i = attrs.find(column.first);
+        column.second.append(i != attrs.end() ? &i->second : nullptr);
+    }
+
+    for (auto& attr : attrs)
+    {
+        if (_columns.find(attr.first.str()) == _columns.end())
+        {
+            Column& column = _columns[attr.first.str()];
+            column.resize(row);
+            column.append(&attr.second);
+        }
+    }
+
+    if (feature->style().isSet())
+        _styles[row] = feature->style().get();
+
+    if (feature->geoInterp().isSet())
+        _geoInterps[row] = feature->geoInterp().get();
+}
+
+void
+FeatureBatch::fromList(const FeatureList& input)
+{
+    _fids.reserve(_fids.size() + input.size());
+    _rowParts.reserve(_rowParts.size() + input.size());
+
+    for (auto& feature : input)
+    {
+        add(feature.get());
+    }
+}
+
+void
+FeatureBatch::toList(FeatureList& output) const
+{
+    AttributeValue value;
+
+    for (unsigned row = 0; row < size(); ++row)
+    {
+        Geometry* geom = nullptr;
+        unsigned partIndex = _rowParts[row];
+        if (partIndex < _rowParts[row+1])
+        {
+            geom = createGeometry(partIndex);
+        }
+
+        osg::ref_ptr<Feature> feature = new Feature(geom, _srs.get(), Style(), _fids[row]);
+
+        for (auto& column : _columns)
+        {
+            if (column.second.has(row))
+            {
+                column.second.getValue(row, value);
+                feature->set(column.first, value);
+            }
+        }
+
+        std::map<unsigned, Style>::const_iterator style = _styles.find(row);
+        if (style != _styles.end())
+            feature->style() = style->second;
+
+        std::map<unsigned, GeoInterpolation>::const_iterator geoInterp = _geoInterps.find(row);
+        if (geoInterp != _geoInterps.end())
+            feature->geoInterp() = geoInterp->second;
+
+        output.push_back(feature.get());
+    }
+}
+
+void
+FeatureBatch::filter(const std::vector<bool>& keep)
+{
+    std::vector<unsigned> rows;
+    rows.reserve(size());
+    for (unsigned row = 0; row < size(); ++row)
+    {
+        if (row < keep.size() && keep[row])
+            rows.push_back(row);
+    }
+
+    if (rows.size() == size())
+        return;
+
+    // geometry: copy the kept rows' parts and points down in order
+    std::vector<unsigned> rowParts(1, 0u);
+    std::vector<Part> parts;
+    std::vector<osg::Vec3d> points;
+    rowParts.reserve(rows.size() + 1);
+
+    for (auto row : rows)
+    {
+        for (unsigned p = _rowParts[row]; p < _rowParts[row+1]; ++p)
+        {
+            Part part = _parts[p];
+            unsigned first = part.firstPoint;
+            part.firstPoint = points.size();
+            points.insert(points.end(), _points.begin() + first, _points.begin() + first + part.numPoints);
+            parts.push_back(part);
+        }
+        rowParts.push_back(parts.size());
+    }
+
+    _rowParts.swap(rowParts);
+    _parts.swap(parts);
+    _points.swap(points);
+
+    compactArray(_fids, rows);
+
+    for (auto& column : _columns)
+    {
+        column.second.compact(rows);
+    }
+
+    std::map<unsigned, Style> styles;
+    std::map<unsigned, GeoInterpolation> geoInterps;
+    for (unsigned i = 0; i < rows.size(); ++i)
+    {
+        std::map<unsigned, Style>::iterator style = _styles.find(rows[i]);
+        if (style != _styles.end())
+            styles[i] = style->second;
+
+        std::map<unsigned, GeoInterpolation>::iterator geoInterp = _geoInterps.find(rows[i]);
+        if (geoInterp != _geoInterps.end())
+            geoInterps[i] = geoInterp->second;
+    }
+    _styles.swap(styles);
+    _geoInterps.swap(geoInterps);
+}
+
+const FeatureBatch::Column*
+FeatureBatch::getColumn(const std::string& name) const
+{
+    Columns::const_iterator i = _columns.find(name);
+    return i != _columns.end() ? &i->second : nullptr;
+}
+
+void
+FeatureBatch::addGeometry(const Geometry* geom)
+{
+    if (geom == nullptr)
+        return;
+
+    Part part;
+    part.type = geom->getType();
+    part.firstPoint = _points.size();
+    part.numPoints = geom->size();
+    part.numChildren = 0u;
+
+    const Polygon* polygon = geom->getType() == Geometry::TYPE_POLYGON ? static_cast<const Polygon*>(geom) : nullptr;
+    const MultiGeometry* multi = geom->getType() == Geometry::TYPE_MULTI ? static_cast<const MultiGeometry*>(geom) : nullptr;
+
+    if (polygon)
+        part.numChildren = polygon->getHoles().size();
+    else if (multi)
+        part.numChildren = multi->getComponents().size();
+
+    _parts.push_back(part);
+    _points.insert(_points.end(), geom->begin(), geom->end());
+
+    if (polygon)
+    {
+        for (auto& hole : polygon->getHoles())
+            addGeometry(hole.get());
+    }
+    else if (multi)
+    {
+        for (auto& component : multi->getComponents())
+            addGeometry(component.get());
+    }
+}
+
+Geometry*
+FeatureBatch::createGeometry(unsigned& partIndex) const
+{
+    const Part& part = _parts[partIndex++];
+
+    Geometry* geom = nullptr;
+    switch (part.type)
+    {
+    case Geometry::TYPE_POINT:      geom = new Point(part.numPoints); break;
+    case Geometry::TYPE_POINTSET:   geom = new PointSet(part.numPoints); break;
+    case Geometry::TYPE_LINESTRING: geom = new LineString(part.numPoints); break;
+    case Geometry::TYPE_RING:       geom = new Ring(part.numPoints); break;
+    case Geometry::TYPE_POLYGON:    geom = new Polygon(part.numPoints); break;
+    case Geometry::TYPE_MULTI:      geom = new MultiGeometry(); break;
+    default:                        geom = new Geometry(part.numPoints); break;
+    }
+
+    geom->insert(geom->end(), _points.begin() + part.firstPoint, _points.begin() + part.firstPoint + part.numPoints);
+
+    for (unsigned c = 0; c < part.numChildren; ++c)
+    {
+        Geometry* child = createGeometry(partIndex);
+
+        if (part.type == Geometry::TYPE_POLYGON)
+        {
+            Ring* ring = dynamic_cast<Ring*>(child);
+            if (ring)
+                static_cast<Polygon*>(geom)->getHoles().push_back(ring);
+            else
+                delete child;
+        }
+        else
+        {
+            static_cast<MultiGeometry*>(geom)->add(child);
+        }
+    }
+
+    return geom;
+}
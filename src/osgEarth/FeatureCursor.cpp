@@ -45,6 +45,16 @@ FeatureCursor::fill(FeatureList& list)
     }
 }
 
+void
+FeatureCursor::fill(FeatureBatch& batch)
+{
+    while (hasMore())
+    {
+        osg::ref_ptr<Feature> feature = nextFeature();
+        batch.add(feature.get());
+    }
+}
+
 //---------------------------------------------------------------------------
 
 FeatureListCursor::FeatureListCursor(const FeatureList& features) :
@@ -89,6 +89,7 @@ FeatureDisplayLayout::fromConfig( const Config& conf )
     conf.get( "min_range",        _minRange );
     conf.get( "max_range",        _maxRange );
     conf.get("paged", _paged);
+    conf.get("simplification_error", _simplificationError);
     ConfigSet children = conf.children( "level" );
     for( ConfigSet::const_iterator i = children.begin(); i != children.end(); ++i )
         addLevel( FeatureLevel( *i ) );
@@ -107,6 +108,7 @@ FeatureDisplayLayout::getConfig() const
     conf.set( "min_range",        _minRange );
     conf.set( "max_range",        _maxRange );
     conf.set("paged", _paged);
+    conf.set("simplification_error", _simplificationError);
     for( Levels::const_iterator i = _levels.begin(); i != _levels.end(); ++i )
         conf.add( i->second.getConfig() );
     return conf;
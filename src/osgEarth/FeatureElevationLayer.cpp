@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/FeatureElevationLayer>
+#include <algorithm>
 
 using namespace osgEarth;
 
@@ -183,85 +184,151 @@ FeatureElevationLayer::createHeightFieldImplementation(const TileKey& key, Progr
             if (progress && progress->isCanceled())
                 return GeoHeightField::INVALID;
 
+            // Sample locations of the output heightfield's columns and rows.
+            double dx = (xmax - xmin) / (tileSize - 1);
+            double dy = (ymax - ymin) / (tileSize - 1);
+
+            std::vector<double> colX(tileSize), rowY(tileSize);
+            for (int i = 0; i < tileSize; ++i)
+            {
+                colX[i] = xmin + (dx * (double)i);
+                rowY[i] = ymin + (dy * (double)i);
+            }
+
             //Only allocate the heightfield if we actually intersect any features.
             osg::ref_ptr<osg::HeightField> hf = new osg::HeightField;
             hf->allocate(tileSize, tileSize);
             for (unsigned int i = 0; i < hf->getHeightList().size(); ++i) hf->getHeightList()[i] = NO_DATA_VALUE;
 
-            // Iterate over the output heightfield and sample the data that was read into it.
-            double dx = (xmax - xmin) / (tileSize - 1);
-            double dy = (ymax - ymin) / (tileSize - 1);
+            // Samples already claimed by a feature; the first feature
+            // in the list that contains a sample sets its height.
+            std::vector<bool> written(tileSize * tileSize, false);
+            std::vector<char> inside(tileSize);
+            std::vector<double> crossings;
 
-            for (int c = 0; c < tileSize; ++c)
+            // Toggles the samples of row r that fall inside a ring, using
+            // the same edge rule as Ring::contains2D.
+            auto scanRing = [&](const std::vector<osg::Vec3d>& ring, int r)
             {
-                double geoX = xmin + (dx * (double)c);
-                for (int r = 0; r < tileSize; ++r)
+                double y = rowY[r];
+                crossings.clear();
+                for (unsigned i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+                {
+                    const osg::Vec3d& pi = ring[i];
+                    const osg::Vec3d& pj = ring[j];
+                    if (((pi.y() <= y) && (y < pj.y())) || ((pj.y() <= y) && (y < pi.y())))
+                    {
+                        crossings.push_back((pj.x() - pi.x()) * (y - pi.y()) / (pj.y() - pi.y()) + pi.x());
+                    }
+                }
+                std::sort(crossings.begin(), crossings.end());
+
+                // a sample is inside when an odd number of crossings lie to its right
+                for (unsigned k = 0; k + 1 < crossings.size(); k += 2)
+                {
+                    int c0 = std::lower_bound(colX.begin(), colX.end(), crossings[k]) - colX.begin();
+                    int c1 = std::lower_bound(colX.begin(), colX.end(), crossings[k + 1]) - colX.begin();
+                    for (int c = c0; c < c1; ++c)
+                        inside[c] = !inside[c];
+                }
+            };
+
+            for (FeatureList::iterator f = featureList.begin(); f != featureList.end(); ++f)
+            {
+                if (progress && progress->isCanceled())
+                    return GeoHeightField::INVALID;
+
+                double featureHeight = (*f)->getDouble(options().attr().get());
+
+                GeometryIterator parts((*f)->getGeometry(), false);
+                while (parts.hasMore())
                 {
-                    double geoY = ymin + (dy * (double)r);
+                    osgEarth::Polygon* boundary = dynamic_cast<osgEarth::Polygon*>(parts.next());
+                    if (!boundary || boundary->size() < 3)
+                        continue;
+
+                    // Rings in the key SRS, so we can scan them along the tile's rows:
+                    std::vector<std::vector<osg::Vec3d>> rings;
+                    rings.push_back(boundary->asVector());
+                    for (auto& hole : boundary->getHoles())
+                    {
+                        if (hole.valid() && hole->size() >= 3)
+                            rings.push_back(hole->asVector());
+                    }
+
+                    if (transformRequired)
+                    {
+                        for (auto& ring : rings)
+                            featureSRS->transform(ring, keySRS);
+                    }
 
-                    float h = NO_DATA_VALUE;
+                    Bounds bounds;
+                    for (auto& p : rings.front())
+                        bounds.expandBy(p.x(), p.y());
 
-                    for (FeatureList::iterator f = featureList.begin(); f != featureList.end(); ++f)
+                    int r0 = std::lower_bound(rowY.begin(), rowY.end(), bounds.yMin()) - rowY.begin();
+                    int r1 = std::upper_bound(rowY.begin(), rowY.end(), bounds.yMax()) - rowY.begin();
+                    if (r0 >= r1 || bounds.xMax() < colX.front() || bounds.xMin() > colX.back())
+                        continue;
+
+                    // for a round earth, must adjust the final elevation accounting for the
+                    // curvature of the earth; so we have to adjust it in the feature boundary's
+                    // local tangent plane.
+                    osg::Matrix localToWorld, worldToLocal;
+                    if (keySRS->isGeographic())
                     {
-                        if (progress && progress->isCanceled())
-                            return GeoHeightField::INVALID;
+                        Bounds featureBounds = boundary->getBounds();
+                        GeoPoint anchor(featureSRS, featureBounds.center().x(), featureBounds.center().y(), featureHeight, ALTMODE_ABSOLUTE);
+                        if (transformRequired)
+                            anchor = anchor.transform(keySRS);
+
+                        // For transforming between ECEF and local tangent plane:
+                        anchor.createLocalToWorld(localToWorld);
+                        worldToLocal.invert(localToWorld);
+                    }
 
-                        osgEarth::Polygon* boundary = dynamic_cast<osgEarth::Polygon*>((*f)->getGeometry());
+                    for (int r = r0; r < r1; ++r)
+                    {
+                        std::fill(inside.begin(), inside.end(), 0);
 
-                        if (!boundary)
-                        {
-                            OE_WARN << LC << "NOT A POLYGON" << std::endl;
-                        }
-                        else
+                        // inside the outer ring, but NOT inside any of the holes
+                        for (auto& ring : rings)
+                            scanRing(ring, r);
+
+                        for (int c = 0; c < tileSize; ++c)
                         {
-                            GeoPoint geo(keySRS, geoX, geoY, 0.0, ALTMODE_ABSOLUTE);
+                            if (!inside[c] || written[r * tileSize + c])
+                                continue;
+
+                            written[r * tileSize + c] = true;
 
-                            if (transformRequired)
-                                geo = geo.transform(featureSRS);
+                            float h = featureHeight;
 
-                            if (boundary->contains2D(geo.x(), geo.y()))
+                            if (keySRS->isGeographic())
                             {
-                                h = (*f)->getDouble(options().attr().get());
-
-                                if (keySRS->isGeographic())
-                                {
-                                    // for a round earth, must adjust the final elevation accounting for the
-                                    // curvature of the earth; so we have to adjust it in the feature boundary's
-                                    // local tangent plane.
-                                    Bounds bounds = boundary->getBounds();
-                                    GeoPoint anchor(featureSRS, bounds.center().x(), bounds.center().y(), h, ALTMODE_ABSOLUTE);
-                                    if (transformRequired)
-                                        anchor = anchor.transform(keySRS);
-
-                                    // For transforming between ECEF and local tangent plane:
-                                    osg::Matrix localToWorld, worldToLocal;
-                                    anchor.createLocalToWorld(localToWorld);
-                                    worldToLocal.invert(localToWorld);
-
-                                    // Get the ECEF location of the anchor point:
-                                    osg::Vec3d ecef;
-                                    geo.toWorld(ecef);
-
-                                    // Move it into Local Tangent Plane coordinates:
-                                    osg::Vec3d local = ecef * worldToLocal;
-
-                                    // Reset the Z to zero, since the LTP is centered on the "h" elevation:
-                                    local.z() = 0.0;
-
-                                    // Back into ECEF:
-                                    ecef = local * localToWorld;
-
-                                    // And back into lat/long/alt:
-                                    geo.fromWorld(geo.getSRS(), ecef);
-
-                                    h = geo.z();
-                                }
-                                break;
+                                // Get the ECEF location of the sample point:
+                                osg::Vec3d ecef;
+                                keySRS->transformToWorld(osg::Vec3d(colX[c], rowY[r], 0.0), ecef);
+
+                                // Move it into Local Tangent Plane coordinates:
+                                osg::Vec3d local = ecef * worldToLocal;
+
+                                // Reset the Z to zero, since the LTP is centered on the "h" elevation:
+                                local.z() = 0.0;
+
+                                // Back into ECEF:
+                                ecef = local * localToWorld;
+
+                                // And back into lat/long/alt:
+                                osg::Vec3d geo;
+                                keySRS->transformFromWorld(ecef, geo);
+
+                                h = geo.z();
                             }
+
+                            hf->setHeight(c, r, h + options().offset().get());
                         }
                     }
-
-                    hf->setHeight(c, r, h + options().offset().get());
                 }
             }
             return GeoHeightField(hf.release(), key.getExtent());
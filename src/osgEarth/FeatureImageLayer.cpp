@@ -28,11 +28,26 @@
 #include <osgEarth/Progress>
 #include <osgEarth/LandCover>
 #include <osgEarth/Metrics>
+#include <osgEarth/Tessellator>
+#include <osgEarth/TileRasterizer>
+#include <osg/BlendFunc>
+#include <atomic>
+#include <cfloat>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OE_FEATURE_IMAGE_SSE2
+#include <emmintrin.h>
+#endif
 
 using namespace osgEarth;
 
 #define LC "[FeatureImageLayer] " << getName() << ": "
 
+#define ARENA_FEATURE_RASTERIZER "oe.rasterizer"
+
 
 REGISTER_OSGEARTH_LAYER(featureimage, FeatureImageLayer);
 REGISTER_OSGEARTH_LAYER(feature_image, FeatureImageLayer);
@@ -95,61 +110,416 @@ namespace osgEarth { namespace FeatureImageLayerImpl
         }
     };
 
-    // rasterizes a geometry to color
-    void rasterize(const Geometry* geometry, const osg::Vec4& color, RenderFrame& frame,
-                   agg::rasterizer& ras, agg::rendering_buffer& buffer)
+    // AGG's span_abgr32, with the blend done four pixels at a time where
+    // SSE2 is available. Produces exactly the same bytes as the scalar
+    // version: d' = d + floor((c-d)*alpha / 65536), alpha = cover * c.a.
+    struct span_abgr32_simd
+    {
+        static void render(unsigned char* ptr,
+                           int x,
+                           unsigned count,
+                           const unsigned char* covers,
+                           const agg::rgba8& c)
+        {
+            unsigned char* p = ptr + (x << 2);
+
+#ifdef OE_FEATURE_IMAGE_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i bias = _mm_set1_epi16((short)0x8000);
+            const __m128i src = _mm_set_epi16(c.r, c.g, c.b, c.a, c.r, c.g, c.b, c.a);
+
+            for (; count >= 4; count -= 4, covers += 4, p += 16)
+            {
+                // skip runs that leave the destination alone
+                std::uint32_t run;
+                memcpy(&run, covers, 4);
+                if (run == 0u)
+                    continue;
+
+                __m128i dst = _mm_loadu_si128((const __m128i*)p);
+                __m128i lo = _mm_unpacklo_epi8(dst, zero);
+                __m128i hi = _mm_unpackhi_epi8(dst, zero);
+
+                short a0 = (short)(covers[0] * c.a), a1 = (short)(covers[1] * c.a);
+                short a2 = (short)(covers[2] * c.a), a3 = (short)(covers[3] * c.a);
+                lo = blend(lo, src, _mm_set_epi16(a1, a1, a1, a1, a0, a0, a0, a0), bias);
+                hi = blend(hi, src, _mm_set_epi16(a3, a3, a3, a3, a2, a2, a2, a2), bias);
+
+                _mm_storeu_si128((__m128i*)p, _mm_packus_epi16(lo, hi));
+            }
+
+            if (count == 0)
+                return;
+#endif
+            do
+            {
+                int alpha = (*covers++) * c.a;
+                int a = p[0];
+                int b = p[1];
+                int g = p[2];
+                int r = p[3];
+                *p++ = (((c.a - a) * alpha) + (a << 16)) >> 16;
+                *p++ = (((c.b - b) * alpha) + (b << 16)) >> 16;
+                *p++ = (((c.g - g) * alpha) + (g << 16)) >> 16;
+                *p++ = (((c.r - r) * alpha) + (r << 16)) >> 16;
+            }
+            while(--count);
+        }
+
+#ifdef OE_FEATURE_IMAGE_SSE2
+        // d + floor((c*alpha - d*alpha) / 65536), on unsigned 16-bit lanes.
+        // The 32-bit products are split into high and low halves; a borrow
+        // out of the low halves takes one off the result.
+        static __m128i blend(__m128i d, __m128i c, __m128i alpha, __m128i bias)
+        {
+            __m128i ch = _mm_mulhi_epu16(c, alpha);
+            __m128i cl = _mm_mullo_epi16(c, alpha);
+            __m128i dh = _mm_mulhi_epu16(d, alpha);
+            __m128i dl = _mm_mullo_epi16(d, alpha);
+            __m128i borrow = _mm_cmplt_epi16(_mm_xor_si128(cl, bias), _mm_xor_si128(dl, bias));
+            return _mm_add_epi16(_mm_add_epi16(d, _mm_sub_epi16(ch, dh)), borrow);
+        }
+#endif
+
+        static void hline(unsigned char* ptr,
+                          int x,
+                          unsigned count,
+                          const agg::rgba8& c)
+        {
+            agg::span_abgr32::hline(ptr, x, count, c);
+        }
+
+        static agg::rgba8 get(unsigned char* ptr, int x)
+        {
+            return agg::span_abgr32::get(ptr, x);
+        }
+    };
+
+    // A cropped feature geometry in pixel space, waiting to be rasterized.
+    struct RasterShape
+    {
+        std::vector<osg::Vec2d> points;
+        std::vector<unsigned>   ringEnds;
+        std::vector<unsigned>   triangles; // only for the GPU path
+        double                  ymin, ymax;
+        bool                    coverage;
+        agg::rgba8              color;
+        float                   value;
+    };
+
+    // Gathers the shapes of every style rendered into one tile, so they
+    // can be rasterized together once the whole tile is known. Attached
+    // to the target image as user data for the duration of the render.
+    struct ShapeCollector : public osg::Referenced
     {
-        unsigned a = (unsigned)(127.0f+(color.a()*255.0f)/2.0f); // scale alpha up
-        agg::rgba8 fgColor = agg::rgba8( (unsigned)(color.r()*255.0f), (unsigned)(color.g()*255.0f), (unsigned)(color.b()*255.0f), a );
+        ShapeCollector(bool triangulate) : _triangulate(triangulate) { }
+        std::vector<RasterShape> _shapes;
+        bool _triangulate;
+    };
 
-        ConstGeometryIterator gi( geometry );
-        while( gi.hasMore() )
+    void addShape(const Geometry* geometry, RenderFrame& frame, bool triangulate, std::vector<RasterShape>& shapes)
+    {
+        shapes.emplace_back();
+        RasterShape& shape = shapes.back();
+        shape.ymin = DBL_MAX, shape.ymax = -DBL_MAX;
+
+        ConstGeometryIterator parts( geometry, false );
+        while( parts.hasMore() )
         {
-            const Geometry* g = gi.next();
+            const Geometry* part = parts.next();
+            unsigned base = shape.points.size();
 
-            for( Geometry::const_iterator p = g->begin(); p != g->end(); p++ )
+            ConstGeometryIterator rings( part, true );
+            while( rings.hasMore() )
             {
-                const osg::Vec3d& p0 = *p;
-                double x0 = frame.xf*(p0.x()-frame.xmin);
-                double y0 = frame.yf*(p0.y()-frame.ymin);
+                const Geometry* g = rings.next();
+                if (g->empty())
+                    continue;
 
-                if ( p == g->begin() )
-                    ras.move_to_d( x0, y0 );
-                else
-                    ras.line_to_d( x0, y0 );
+                for( Geometry::const_iterator p = g->begin(); p != g->end(); p++ )
+                {
+                    double x0 = frame.xf*(p->x()-frame.xmin);
+                    double y0 = frame.yf*(p->y()-frame.ymin);
+                    shape.points.emplace_back(x0, y0);
+                    shape.ymin = osg::minimum(shape.ymin, y0);
+                    shape.ymax = osg::maximum(shape.ymax, y0);
+                }
+                shape.ringEnds.push_back(shape.points.size());
+            }
+
+            // the tessellator indexes the part's rings in the same order
+            std::vector<uint32_t> indices;
+            if (triangulate && shape.points.size() > base + 2u && Tessellator().tessellate2D(part, indices))
+            {
+                for (auto i : indices)
+                    shape.triangles.push_back(base + i);
             }
         }
-        agg::renderer<agg::span_abgr32, agg::rgba8> ren(buffer);
-        ras.render(ren, fgColor);
 
+        if (shape.points.empty())
+            shapes.pop_back();
+    }
+
+    void addShape(const Geometry* geometry, const osg::Vec4& color, RenderFrame& frame, bool triangulate, std::vector<RasterShape>& shapes)
+    {
+        unsigned n = shapes.size();
+        addShape(geometry, frame, triangulate, shapes);
+        if (shapes.size() > n)
+        {
+            unsigned a = (unsigned)(127.0f+(color.a()*255.0f)/2.0f); // scale alpha up
+            shapes.back().coverage = false;
+            shapes.back().color = agg::rgba8( (unsigned)(color.r()*255.0f), (unsigned)(color.g()*255.0f), (unsigned)(color.b()*255.0f), a );
+        }
+    }
+
+    void addCoverageShape(const Geometry* geometry, float value, RenderFrame& frame, std::vector<RasterShape>& shapes)
+    {
+        unsigned n = shapes.size();
+        addShape(geometry, frame, false, shapes);
+        if (shapes.size() > n)
+        {
+            shapes.back().coverage = true;
+            shapes.back().value = value;
+        }
+    }
+
+    // Clips a closed ring to the rows [y0, y1]. Clipping each ring on its
+    // own is safe under the even-odd rule, and the edges this adds run
+    // along the clip lines where they cancel out.
+    void clipRing(const osg::Vec2d* ring, unsigned n, double y0, double y1,
+                  std::vector<osg::Vec2d>& temp, std::vector<osg::Vec2d>& out)
+    {
+        temp.clear();
+        for (unsigned i = 0; i < n; ++i)
+        {
+            const osg::Vec2d& a = ring[i];
+            const osg::Vec2d& b = ring[(i + 1) % n];
+            if (a.y() >= y0) temp.push_back(a);
+            if ((a.y() >= y0) != (b.y() >= y0))
+                temp.emplace_back(a.x() + (b.x() - a.x()) * (y0 - a.y()) / (b.y() - a.y()), y0);
+        }
+
+        out.clear();
+        for (unsigned i = 0; i < temp.size(); ++i)
+        {
+            const osg::Vec2d& a = temp[i];
+            const osg::Vec2d& b = temp[(i + 1) % temp.size()];
+            if (a.y() <= y1) out.push_back(a);
+            if ((a.y() <= y1) != (b.y() <= y1))
+                out.emplace_back(a.x() + (b.x() - a.x()) * (y1 - a.y()) / (b.y() - a.y()), y1);
+        }
+    }
+
+    // Per-thread rasterizer state. AGG keeps its cell blocks and row tables
+    // across reset() and attach(), so reusing these avoids re-allocating
+    // them for every band of every tile.
+    struct RasterWorkspace
+    {
+        RasterWorkspace() : rbuf(nullptr, 0, 0, 0) { }
+        agg::rasterizer         ras;
+        agg::rendering_buffer   rbuf;
+        std::vector<osg::Vec2d> temp, clipped;
+    };
+
+    RasterWorkspace& getRasterWorkspace()
+    {
+        thread_local RasterWorkspace workspace;
+        return workspace;
+    }
+
+    // Renders every shape, in order, into image rows [row0, row1).
+    void rasterizeBand(const std::vector<RasterShape>& shapes, osg::Image* image,
+                       int row0, int row1, double gamma)
+    {
+        RasterWorkspace& ws = getRasterWorkspace();
+
+        int stride = image->s() * 4;
+        ws.rbuf.attach(image->data() + row0 * stride, image->s(), row1 - row0, stride);
+
+        agg::rasterizer& ras = ws.ras;
         ras.reset();
+        ras.gamma(gamma);
+        ras.filling_rule(agg::fill_even_odd);
+
+        // one row of slack on either side so the band's edge rows get
+        // their full antialiasing coverage
+        double y0 = (double)(row0 - 1), y1 = (double)(row1 + 1);
+
+        for (auto& shape : shapes)
+        {
+            if (shape.ymax < y0 || shape.ymin > y1)
+                continue;
+
+            bool wholeShape = shape.ymin >= y0 && shape.ymax <= y1;
+
+            unsigned begin = 0u;
+            for (unsigned end : shape.ringEnds)
+            {
+                const osg::Vec2d* ring = &shape.points[begin];
+                unsigned n = end - begin;
+                begin = end;
+
+                if (!wholeShape)
+                {
+                    clipRing(ring, n, y0, y1, ws.temp, ws.clipped);
+                    if (ws.clipped.size() < 3)
+                        continue;
+                    ring = &ws.clipped[0];
+                    n = ws.clipped.size();
+                }
+
+                ras.move_to_d(ring[0].x(), ring[0].y() - row0);
+                for (unsigned i = 1; i < n; ++i)
+                    ras.line_to_d(ring[i].x(), ring[i].y() - row0);
+            }
+
+            if (shape.coverage)
+            {
+                agg::renderer<span_coverage32, float32> ren(ws.rbuf);
+                ras.render(ren, float32(shape.value));
+            }
+            else
+            {
+                agg::renderer<span_abgr32_simd, agg::rgba8> ren(ws.rbuf);
+                ras.render(ren, shape.color);
+            }
+
+            ras.reset();
+        }
     }
 
+    // Below this many rows per band, splitting costs more than it saves.
+    const int MIN_BAND_ROWS = 32;
+
+    // Below this many points in a tile, render on the calling thread.
+    const std::size_t MIN_PARALLEL_POINTS = 2048u;
 
-    void rasterizeCoverage(const Geometry* geometry, float value, RenderFrame& frame,
-                           agg::rasterizer& ras, agg::rendering_buffer& buffer)
+    JobArena* getRasterizerArena()
     {
-        ConstGeometryIterator gi( geometry );
-        while( gi.hasMore() )
+        static JobArena* arena = []()
         {
-            const Geometry* g = gi.next();
+            JobArena::setConcurrency(ARENA_FEATURE_RASTERIZER, Threading::getConcurrency());
+            return JobArena::get(ARENA_FEATURE_RASTERIZER);
+        }();
+        return arena;
+    }
 
-            for( Geometry::const_iterator p = g->begin(); p != g->end(); p++ )
+    struct BandState
+    {
+        BandState() : _next(0u), _done(0u), _mutex("OE.FeatureRasterizer") { }
+
+        const std::vector<RasterShape>* _shapes;
+        osg::Image* _image;
+        double _gamma;
+        int _numBands;
+        std::atomic<int> _next;
+        std::atomic<int> _done;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _finished;
+
+        void work()
+        {
+            for (;;)
             {
-                const osg::Vec3d& p0 = *p;
-                double x0 = frame.xf*(p0.x()-frame.xmin);
-                double y0 = frame.yf*(p0.y()-frame.ymin);
+                int b = _next++;
+                if (b >= _numBands)
+                    break;
 
-                if ( p == g->begin() )
-                    ras.move_to_d( x0, y0 );
-                else
-                    ras.line_to_d( x0, y0 );
+                int rows = _image->t();
+                rasterizeBand(*_shapes, _image, (b * rows) / _numBands, ((b + 1) * rows) / _numBands, _gamma);
+
+                if (++_done == _numBands)
+                {
+                    Threading::ScopedMutexLock lock(_mutex);
+                    _finished.notify_all();
+                }
             }
         }
+    };
 
-        agg::renderer<span_coverage32, float32> ren(buffer);
-        ras.render(ren, value);
-        ras.reset();
+    // Renders the shapes into the image, splitting it into bands of rows
+    // that rasterize in parallel. Every band draws the shapes in the same
+    // order, so the result is identical to a single pass.
+    void rasterizeShapes(const std::vector<RasterShape>& shapes, osg::Image* image, double gamma)
+    {
+        if (shapes.empty())
+            return;
+
+        std::size_t numPoints = 0u;
+        for (auto& shape : shapes)
+            numPoints += shape.points.size();
+
+        unsigned concurrency = Threading::getConcurrency();
+        int numBands = osg::minimum(image->t() / MIN_BAND_ROWS, (int)concurrency * 2);
+
+        if (numBands <= 1 || concurrency <= 1u || numPoints < MIN_PARALLEL_POINTS)
+        {
+            rasterizeBand(shapes, image, 0, image->t(), gamma);
+            return;
+        }
+
+        auto state = std::make_shared<BandState>();
+        state->_shapes = &shapes;
+        state->_image = image;
+        state->_gamma = gamma;
+        state->_numBands = numBands;
+
+        // the calling thread takes bands too, so this never waits on an
+        // arena that's busy with other tiles
+        unsigned numJobs = osg::minimum((unsigned)numBands, concurrency);
+        JobArena* arena = getRasterizerArena();
+        for (unsigned j = 0; j < numJobs - 1u; ++j)
+        {
+            Job job(arena);
+            job.dispatch([state](Cancelable*) { state->work(); });
+        }
+
+        state->work();
+
+        std::unique_lock<Threading::Mutex> lock(state->_mutex);
+        state->_finished.wait(lock, [&state]() { return state->_done == state->_numBands; });
+    }
+
+    // Builds a graph that draws the shapes' triangles, in order, in pixel
+    // space; blending matches the "over" compositing of the AGG path.
+    osg::Node* createShapesNode(const std::vector<RasterShape>& shapes)
+    {
+        osg::ref_ptr<osg::Vec3Array> verts = new osg::Vec3Array();
+        osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array();
+        osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+
+        for (auto& shape : shapes)
+        {
+            if (shape.triangles.empty())
+                continue;
+
+            unsigned base = verts->size();
+            osg::Vec4 color(shape.color.r / 255.0f, shape.color.g / 255.0f, shape.color.b / 255.0f, shape.color.a / 255.0f);
+
+            for (auto& p : shape.points)
+            {
+                verts->push_back(osg::Vec3(p.x(), p.y(), 0.0f));
+                colors->push_back(color);
+            }
+
+            for (auto i : shape.triangles)
+                triangles->push_back(base + i);
+        }
+
+        if (triangles->empty())
+            return nullptr;
+
+        osg::Geometry* geom = new osg::Geometry();
+        geom->setUseVertexBufferObjects(true);
+        geom->setUseDisplayList(false);
+        geom->setVertexArray(verts.get());
+        geom->setColorArray(colors.get(), osg::Array::BIND_PER_VERTEX);
+        geom->addPrimitiveSet(triangles.get());
+
+        geom->getOrCreateStateSet()->setAttributeAndModes(
+            new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), 1);
+
+        return geom;
     }
 
     FeatureCursor* createCursor(FeatureSource* fs, FeatureFilterChain* chain, FilterContext& cx, const Query& query, ProgressCallback* progress)
@@ -172,6 +542,7 @@ FeatureImageLayer::Options::getConfig() const
     featureSource().set(conf, "features");
     styleSheet().set(conf, "styles");
     conf.set("gamma", gamma());
+    conf.set("use_gpu", useGPU());
 
     if (filters().empty() == false)
     {
@@ -188,10 +559,12 @@ void
 FeatureImageLayer::Options::fromConfig(const Config& conf)
 {
     gamma().init(1.3);
+    useGPU().init(false);
 
     featureSource().get(conf, "features");
     styleSheet().get(conf, "styles");
     conf.get("gamma", gamma());
+    conf.get("use_gpu", useGPU());
 
     const Config& filtersConf = conf.child("filters");
     for(ConfigSet::const_iterator i = filtersConf.children().begin(); i != filtersConf.children().end(); ++i)
@@ -232,6 +605,12 @@ FeatureImageLayer::openImplementation()
 
     _filterChain = FeatureFilterChain::create(options().filters(), getReadOptions());
 
+    // coverage values don't blend, so they always rasterize with AGG
+    if (options().useGPU() == true && options().coverage() == false && _rasterizer == nullptr)
+    {
+        _rasterizer = std::make_shared<TileRasterizer>(getTileSize(), getTileSize(), 4u);
+    }
+
     return Status::NoError;
 }
 
@@ -386,17 +765,55 @@ FeatureImageLayer::createImageImplementation(const TileKey& key, ProgressCallbac
 
     preProcess(image.get());
 
+    // The GPU rasterizer needs a live graphics context; without one
+    // (e.g. when seeding headless) use AGG.
+    bool useGPU = _rasterizer != nullptr && TileRasterizer::isAvailable();
+
+    osg::ref_ptr<ShapeCollector> collector = new ShapeCollector(useGPU);
+    image->setUserData(collector.get());
+
     bool ok = render(key, _session.get(), getStyleSheet(), image.get(), progress);
 
-    if (ok)
+    image->setUserData(nullptr);
+
+    if (!ok)
     {
-        postProcess(image.get());
-        return GeoImage(image.get(), key.getExtent());
+        return GeoImage::INVALID;
+    }
+
+    if (useGPU)
+    {
+        osg::ref_ptr<osg::Node> node = createShapesNode(collector->_shapes);
+        if (node.valid())
+        {
+            OE_PROFILING_ZONE_NAMED("Rasterize");
+
+            Future<osg::ref_ptr<osg::Image>> result = _rasterizer->render(
+                node.get(),
+                osg::Matrix::ortho2D(0.0, image->s(), 0.0, image->t()));
+
+            osg::ref_ptr<osg::Image> rendered = result.get(progress);
+
+            if (progress && progress->isCanceled())
+                return GeoImage::INVALID;
+
+            // a null result means nothing was drawn; keep the cleared image
+            if (rendered.valid())
+                image = rendered;
+        }
     }
     else
     {
-        return GeoImage::INVALID;
+        {
+            OE_PROFILING_ZONE_NAMED("Render");
+            double gamma = options().coverage() == true ? 1.0 : options().gamma().get();
+            rasterizeShapes(collector->_shapes, image.get(), gamma);
+        }
+
+        postProcess(image.get());
     }
+
+    return GeoImage(image.get(), key.getExtent());
 }
 
 bool
@@ -603,19 +1020,7 @@ FeatureImageLayer::renderFeaturesForStyle(Session*           session,
         xform.push(lines, context);
     }
 
-    // set up the AGG renderer:
-    agg::rendering_buffer rbuf(image->data(), image->s(), image->t(), image->s() * 4);
-
-    // Create the renderer and the rasterizer
-    agg::rasterizer ras;
-
-    // Setup the rasterizer
-    if (options().coverage() == true)
-        ras.gamma(1.0);
-    else
-        ras.gamma(options().gamma().get());
-
-    ras.filling_rule(agg::fill_even_odd);
+    double gamma = options().coverage() == true ? 1.0 : options().gamma().get();
 
     // construct an extent for cropping the geometry to our tile.
     // extend just outside the actual extents so we don't get edge artifacts:
@@ -653,10 +1058,17 @@ FeatureImageLayer::renderFeaturesForStyle(Session*           session,
     if (covsym && covsym->valueExpression().isSet())
         covValue = covsym->valueExpression().get();
 
+    // when rendering a whole tile, the shapes are rasterized together at the end
+    ShapeCollector* collector = dynamic_cast<ShapeCollector*>(image->getUserData());
+    bool triangulate = collector && collector->_triangulate;
+
+    std::vector<RasterShape> localShapes;
+    std::vector<RasterShape>& shapes = collector ? collector->_shapes : localShapes;
+
     {
-        OE_PROFILING_ZONE_NAMED("Crop/Render");
+        OE_PROFILING_ZONE_NAMED("Crop");
 
-        // render the polygons
+        // collect the polygons
         for (FeatureList::iterator i = polygons.begin(); i != polygons.end(); i++)
         {
             Feature*  feature = i->get();
@@ -672,17 +1084,17 @@ FeatureImageLayer::renderFeaturesForStyle(Session*           session,
                 if (options().coverage() == true && covValue.isSet())
                 {
                     float value = (float)feature->eval(covValue.mutable_value(), &context);
-                    rasterizeCoverage(croppedGeometry.get(), value, frame, ras, rbuf);
+                    addCoverageShape(croppedGeometry.get(), value, frame, shapes);
                 }
                 else
                 {
                     Color color = poly ? poly->fill()->color() : Color::White;
-                    rasterize(croppedGeometry.get(), color, frame, ras, rbuf);
+                    addShape(croppedGeometry.get(), color, frame, triangulate, shapes);
                 }
             }
         }
 
-        // render the lines
+        // collect the lines
         for (FeatureList::iterator i = lines.begin(); i != lines.end(); i++)
         {
             Feature*  feature = i->get();
@@ -698,17 +1110,23 @@ FeatureImageLayer::renderFeaturesForStyle(Session*           session,
                 if (options().coverage() == true && covValue.isSet())
                 {
                     float value = (float)feature->eval(covValue.mutable_value(), &context);
-                    rasterizeCoverage(croppedGeometry.get(), value, frame, ras, rbuf);
+                    addCoverageShape(croppedGeometry.get(), value, frame, shapes);
                 }
                 else
                 {
                     osg::Vec4f color = line ? static_cast<osg::Vec4>(line->stroke()->color()) : osg::Vec4(1, 1, 1, 1);
-                    rasterize(croppedGeometry.get(), color, frame, ras, rbuf);
+                    addShape(croppedGeometry.get(), color, frame, triangulate, shapes);
                 }
             }
         }
     }
 
+    if (!collector)
+    {
+        OE_PROFILING_ZONE_NAMED("Render");
+        rasterizeShapes(shapes, image, gamma);
+    }
+
     return true;
 }
 
@@ -0,0 +1,375 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/FeatureListSource>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/Registry>
+#include <osgEarth/Metrics>
+#include "rtree.h"
+#include <algorithm>
+#include <limits>
+
+#define LC "[FeatureListSource] "
+
+using namespace osgEarth;
+
+//........................................................................
+
+Config
+FeatureListSource::Options::getConfig() const
+{
+    return FeatureSource::Options::getConfig();
+}
+
+void
+FeatureListSource::Options::fromConfig(const Config& conf)
+{
+    //nop
+}
+
+//........................................................................
+
+struct FeatureListSource::SpatialIndex : public RTree<FeatureID, double, 2>
+{
+    static bool getBounds(const Feature* feature, double a_min[2], double a_max[2])
+    {
+        if (feature->getGeometry() == nullptr)
+            return false;
+
+        Bounds b = feature->getGeometry()->getBounds();
+        if (!b.isValid())
+            return false;
+
+        a_min[0] = b.xMin(), a_min[1] = b.yMin();
+        a_max[0] = b.xMax(), a_max[1] = b.yMax();
+        return true;
+    }
+};
+
+REGISTER_OSGEARTH_LAYER(featurelist, FeatureListSource);
+
+void
+FeatureListSource::init()
+{
+    FeatureSource::init();
+    _index.reset(new SpatialIndex());
+    _nextFID = 1;
+}
+
+FeatureListSource::~FeatureListSource()
+{
+    //nop - here so the SpatialIndex is complete at destruction
+}
+
+Status
+FeatureListSource::openImplementation()
+{
+    Status parent = FeatureSource::openImplementation();
+    if (parent.isError())
+        return parent;
+
+    updateFeatureProfile();
+
+    return Status::NoError;
+}
+
+void
+FeatureListSource::updateFeatureProfile()
+{
+    GeoExtent extent;
+
+    if (options().profile().isSet())
+    {
+        osg::ref_ptr<const Profile> profile = Profile::create(options().profile().get());
+        if (profile.valid())
+            extent = profile->getExtent();
+    }
+
+    if (!extent.isValid())
+    {
+        Threading::ScopedReadLock lock(_featuresMutex);
+
+        for (auto& i : _features)
+        {
+            GeoExtent featureExtent = i.second->getExtent();
+            if (!featureExtent.isValid())
+                continue;
+
+            if (!extent.isValid())
+                extent = featureExtent;
+            else
+                extent.expandToInclude(featureExtent);
+        }
+    }
+
+    // nothing to go on yet; assume the whole world
+    if (!extent.isValid())
+    {
+        extent = Registry::instance()->getGlobalGeodeticProfile()->getExtent();
+    }
+
+    FeatureProfile* fp = new FeatureProfile(extent);
+    if (options().geoInterp().isSet())
+    {
+        fp->geoInterp() = options().geoInterp().get();
+    }
+
+    setFeatureProfile(fp);
+}
+
+void
+FeatureListSource::setFeatures(const FeatureList& features)
+{
+    {
+        Threading::ScopedWriteLock lock(_featuresMutex);
+        _features.clear();
+        _index->RemoveAll();
+
+        for (auto& feature : features)
+        {
+            if (feature.valid())
+                insertFeatureUnderLock(feature.get());
+        }
+    }
+
+    if (isOpen())
+    {
+        updateFeatureProfile();
+    }
+
+    dirty();
+}
+
+void
+FeatureListSource::clear()
+{
+    setFeatures(FeatureList());
+}
+
+void
+FeatureListSource::insertFeatureUnderLock(Feature* feature)
+{
+    if (feature->getFID() == 0 || _features.find(feature->getFID()) != _features.end())
+    {
+        while (_features.find(_nextFID) != _features.end())
+            ++_nextFID;
+        feature->setFID(_nextFID++);
+    }
+
+    // keep a private copy so the caller can't move it out from under the index
+    Feature* copy = osg::clone(feature, osg::CopyOp::DEEP_COPY_ALL);
+    copy->internStrings(*getStringPool());
+    _features[copy->getFID()] = copy;
+
+    double a_min[2], a_max[2];
+    if (SpatialIndex::getBounds(copy, a_min, a_max))
+    {
+        _index->Insert(a_min, a_max, copy->getFID());
+    }
+}
+
+bool
+FeatureListSource::insertFeature(Feature* feature)
+{
+    if (feature == nullptr)
+        return false;
+
+    {
+        Threading::ScopedWriteLock lock(_featuresMutex);
+        insertFeatureUnderLock(feature);
+    }
+
+    featuresChanged(std::vector<FeatureID>(), feature->getExtent());
+    return true;
+}
+
+bool
+FeatureListSource::deleteFeature(FeatureID fid)
+{
+    GeoExtent extent;
+    {
+        Threading::ScopedWriteLock lock(_featuresMutex);
+
+        std::map<FeatureID, osg::ref_ptr<Feature> >::iterator i = _features.find(fid);
+        if (i == _features.end())
+            return false;
+
+        double a_min[2], a_max[2];
+        if (SpatialIndex::getBounds(i->second.get(), a_min, a_max))
+        {
+            _index->Remove(a_min, a_max, fid);
+        }
+
+        extent = i->second->getExtent();
+        _features.erase(i);
+    }
+
+    featuresChanged(std::vector<FeatureID>(1, fid), extent);
+    return true;
+}
+
+int
+FeatureListSource::getFeatureCount() const
+{
+    Threading::ScopedReadLock lock(_featuresMutex);
+    return (int)_features.size();
+}
+
+Feature*
+FeatureListSource::getFeature(FeatureID fid)
+{
+    Threading::ScopedReadLock lock(_featuresMutex);
+
+    std::map<FeatureID, osg::ref_ptr<Feature> >::const_iterator i = _features.find(fid);
+    if (i == _features.end())
+        return 0L;
+
+    return osg::clone(i->second.get(), osg::CopyOp::DEEP_COPY_ALL);
+}
+
+Geometry::Type
+FeatureListSource::getGeometryType() const
+{
+    Threading::ScopedReadLock lock(_featuresMutex);
+
+    if (_features.empty() || _features.begin()->second->getGeometry() == nullptr)
+        return Geometry::TYPE_UNKNOWN;
+
+    return _features.begin()->second->getGeometry()->getType();
+}
+
+bool
+FeatureListSource::getFeatureBoundsImplementation(const Query& query, FeatureBoundsList& output, ProgressCallback* progress)
+{
+    OE_PROFILING_ZONE;
+
+    Bounds bounds;
+    if (query.bounds().isSet())
+    {
+        bounds = query.bounds().get();
+    }
+    else if (query.tileKey().isSet() && getFeatureProfile())
+    {
+        bounds = query.tileKey()->getExtent().transform(getFeatureProfile()->getSRS()).bounds();
+    }
+
+    Threading::ScopedReadLock lock(_featuresMutex);
+
+    // Same selection as a cursor, but nothing is copied
+    auto add = [&](FeatureID fid, const Feature* feature)
+    {
+        if (feature->getGeometry() && !isBlacklisted(fid))
+        {
+            FeatureBounds entry;
+            entry.fid = fid;
+            entry.bounds = feature->getGeometry()->getBounds();
+            output.push_back(entry);
+        }
+    };
+
+    if (bounds.isValid())
+    {
+        double a_min[2] = { bounds.xMin(), bounds.yMin() };
+        double a_max[2] = { bounds.xMax(), bounds.yMax() };
+
+        std::vector<FeatureID> hits;
+        _index->Search(a_min, a_max, &hits, std::numeric_limits<int>::max());
+
+        std::sort(hits.begin(), hits.end());
+        hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+        for (auto fid : hits)
+        {
+            std::map<FeatureID, osg::ref_ptr<Feature> >::const_iterator i = _features.find(fid);
+            if (i != _features.end())
+                add(fid, i->second.get());
+        }
+    }
+    else
+    {
+        for (auto& i : _features)
+            add(i.first, i.second.get());
+    }
+
+    return !(progress && progress->isCanceled());
+}
+
+FeatureCursor*
+FeatureListSource::createFeatureCursorImplementation(const Query& query, ProgressCallback* progress)
+{
+    OE_PROFILING_ZONE;
+
+    // work out the query bounds in the feature SRS, if there are any
+    Bounds bounds;
+    if (query.bounds().isSet())
+    {
+        bounds = query.bounds().get();
+    }
+    else if (query.tileKey().isSet() && getFeatureProfile())
+    {
+        bounds = query.tileKey()->getExtent().transform(getFeatureProfile()->getSRS()).bounds();
+    }
+
+    FeatureList features;
+    {
+        Threading::ScopedReadLock lock(_featuresMutex);
+
+        if (bounds.isValid())
+        {
+            double a_min[2] = { bounds.xMin(), bounds.yMin() };
+            double a_max[2] = { bounds.xMax(), bounds.yMax() };
+
+            std::vector<FeatureID> hits;
+            _index->Search(a_min, a_max, &hits, std::numeric_limits<int>::max());
+
+            // keep results in FID order, as for an unbounded query
+            std::sort(hits.begin(), hits.end());
+            hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+            for (auto fid : hits)
+            {
+                std::map<FeatureID, osg::ref_ptr<Feature> >::const_iterator i = _features.find(fid);
+                if (i != _features.end() && !isBlacklisted(fid))
+                {
+                    features.push_back(osg::clone(i->second.get(), osg::CopyOp::DEEP_COPY_ALL));
+                }
+            }
+        }
+        else
+        {
+            for (auto& i : _features)
+            {
+                if (!isBlacklisted(i.first))
+                {
+                    features.push_back(osg::clone(i.second.get(), osg::CopyOp::DEEP_COPY_ALL));
+                }
+            }
+        }
+    }
+
+    if (progress && progress->isCanceled())
+        return 0L;
+
+    GeoExtent extent;
+    if (bounds.isValid() && getFeatureProfile())
+        extent = GeoExtent(getFeatureProfile()->getSRS(), bounds);
+
+    applyFilters(features, extent);
+
+    return new FeatureListCursor(features);
+}
@@ -33,13 +33,17 @@
 #include <osgEarth/Threading>
 #include <osgEarth/Utils>
 #include <osgEarth/GLUtils>
+#include <osgEarth/HiZCuller>
 #include <osgEarth/Metrics>
+#include <osgEarth/Memory>
 #include <osgEarth/ElevationRanges>
 #include <osgEarth/LineDrawable>
 #include <osgEarth/NetworkMonitor>
 #include <osgEarth/PagedNode>
+#include <osgEarth/SimplifyFilter>
 
 #include <osg/CullFace>
+#include <osg/Geometry>
 #include <osg/PagedLOD>
 #include <osg/ProxyNode>
 #include <osg/PolygonOffset>
@@ -52,6 +56,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <unordered_set>
 
 #define LC "[FeatureModelGraph] " << _ownerName << ": "
 
@@ -404,6 +409,72 @@ namespace
     }
 
 
+    // forwards feature source edits to the graph
+    struct FeatureChangeCallback : public FeatureSource::ChangeCallback
+    {
+        osg::observer_ptr<FeatureModelGraph> _graph;
+
+        FeatureChangeCallback(FeatureModelGraph* graph) : _graph(graph) { }
+
+        void onFeaturesChanged(const std::vector<FeatureID>& fids, const GeoExtent& extent) override
+        {
+            osg::ref_ptr<FeatureModelGraph> graph;
+            if (_graph.lock(graph))
+                graph->dirtyFeatures(fids, extent);
+        }
+    };
+
+    // collects the FIDs indexed anywhere under a node
+    struct CollectFIDs : public osg::NodeVisitor
+    {
+        std::vector<FeatureID> _fids;
+
+        CollectFIDs()
+        {
+            setNodeMaskOverride(~0);
+            setTraversalMode(TRAVERSE_ALL_CHILDREN);
+        }
+
+        void apply(osg::Group& group) override
+        {
+            FeatureSourceIndexNode* index = dynamic_cast<FeatureSourceIndexNode*>(&group);
+            if (index)
+                index->getAllFIDs(_fids);
+            traverse(group);
+        }
+    };
+
+    // Sums the vertex and index data of the geometry under a node
+    struct CountGeometryBytes : public osg::NodeVisitor
+    {
+        std::size_t _bytes;
+        std::unordered_set<const osg::Geometry*> _seen;
+
+        CountGeometryBytes() : _bytes(0u)
+        {
+            setNodeMaskOverride(~0);
+            setTraversalMode(TRAVERSE_ALL_CHILDREN);
+        }
+
+        void apply(osg::Drawable& drawable) override
+        {
+            const osg::Geometry* geom = drawable.asGeometry();
+            if (geom && _seen.insert(geom).second)
+            {
+                const osg::Geometry::ArrayList& arrays = geom->getVertexAttribArrayList();
+                if (geom->getVertexArray()) _bytes += geom->getVertexArray()->getTotalDataSize();
+                if (geom->getNormalArray()) _bytes += geom->getNormalArray()->getTotalDataSize();
+                if (geom->getColorArray()) _bytes += geom->getColorArray()->getTotalDataSize();
+                for (unsigned i = 0; i < geom->getNumTexCoordArrays(); ++i)
+                    if (geom->getTexCoordArray(i)) _bytes += geom->getTexCoordArray(i)->getTotalDataSize();
+                for (auto& array : arrays)
+                    if (array.valid()) _bytes += array->getTotalDataSize();
+                for (unsigned i = 0; i < geom->getNumPrimitiveSets(); ++i)
+                    _bytes += geom->getPrimitiveSet(i)->getTotalDataSize();
+            }
+        }
+    };
+
     struct SetupFading : public SceneGraphCallback
     {
         void onPostMergeNode(osg::Node* node, osg::Object* sender)
@@ -423,7 +494,8 @@ FeatureModelGraph::FeatureModelGraph(const FeatureModelOptions& options) :
     _featureExtentClamped(false),
     _useTiledSource(false),
     _blacklistMutex("FMG BlackList(OE)"),
-    _isActive(false)
+    _isActive(false),
+    _redrawRequested(false)
 {
     //NOP
 }
@@ -723,6 +795,17 @@ FeatureModelGraph::open()
 
     ADJUST_EVENT_TRAV_COUNT(this, 1);
 
+    // feature edits are applied during the update traversal
+    ADJUST_UPDATE_TRAV_COUNT(this, 1);
+
+    // listen for edits so we can reload just the tiles they affect
+    FeatureSource* fs = _session->getFeatureSource();
+    if (fs)
+    {
+        _changeCallback = new FeatureChangeCallback(this);
+        fs->addChangeCallback(_changeCallback.get());
+    }
+
     _isActive = true;
 
     redraw();
@@ -735,13 +818,21 @@ FeatureModelGraph::shutdown()
 {
     _isActive = false;
 
+    if (_changeCallback.valid())
+    {
+        FeatureSource* fs = _session.valid() ? _session->getFeatureSource() : nullptr;
+        if (fs)
+            fs->removeChangeCallback(_changeCallback.get());
+        _changeCallback = nullptr;
+    }
+
     // Block until all active pager tasks have returned/canceled
     //ScopedWriteLock waiter(getSync());
 }
 
 FeatureModelGraph::~FeatureModelGraph()
 {
-    //nop
+    shutdown();
 }
 
 void
@@ -919,6 +1010,8 @@ FeatureModelGraph::setupPaging()
             _defaultFileLocationCallback.get(),
             _session->getDBOptions(),
             this);
+
+        trackPagedTile(uri, node.get(), 0, 0, 0);
     }
     else
     {
@@ -984,6 +1077,7 @@ FeatureModelGraph::load(
             TileKey key(lod, tileX, invertedTileY, featureProfile->getTilingProfile());
 
             geometry = buildTile(level, tileExtent, &key, readOptions);
+            trackTileFeatures(uri, geometry.get());
             result = geometry;
         }
 
@@ -1016,6 +1110,7 @@ FeatureModelGraph::load(
 
         FeatureLevel all(0.0f, FLT_MAX);
         result = buildTile(all, GeoExtent::INVALID, (const TileKey*)0L, readOptions);
+        trackTileFeatures(uri, result.get());
     }
 
     else if ((int)lod < _lodmap.size())
@@ -1038,6 +1133,7 @@ FeatureModelGraph::load(
                 _usableFeatureExtent;
 
             geometry = buildTile(*level, tileExtent, (const TileKey*)0L, readOptions);
+            trackTileFeatures(uri, geometry.get());
             result = geometry;
         }
 
@@ -1187,6 +1283,17 @@ FeatureModelGraph::buildSubTilePagedLODs(
                         readOptions,
                         this);
 
+                    trackPagedTile(uri, childNode.get(), subtileLOD, u, v);
+
+                    // skip tiles on the far side of the globe
+                    if (_session->isMapGeocentric())
+                    {
+                        childNode->addCullCallback(new TileHorizonCullCallback(subtile_bs));
+                    }
+
+                    // skip tiles hidden behind the terrain when the camera has a HiZCuller
+                    childNode->addCullCallback(new HiZCullCallback());
+
 #ifdef USE_POLYTOPE_CULLING
                     // TEST: polytope culler
                     // Thoughts. How should we set the Z-range? How much does it matter?
@@ -1200,6 +1307,11 @@ FeatureModelGraph::buildSubTilePagedLODs(
                 else
                 {
                     childNode = load(subtileLOD, u, v, uri, readOptions);
+
+                    if (childNode.valid() && _session->isMapGeocentric())
+                    {
+                        childNode->addCullCallback(new TileHorizonCullCallback(subtile_bs));
+                    }
                 }
 
                 parent->addChild(childNode);
@@ -1212,20 +1324,49 @@ namespace
 {
     std::string makeCacheKey(const FeatureLevel& level,
         const GeoExtent& extent,
-        const TileKey* key)
+        const TileKey* key,
+        const std::string& signature)
     {
         if (key)
         {
-            return Cache::makeCacheKey(key->str(), "fmg");
+            return Cache::makeCacheKey(key->str() + "_" + signature, "fmg");
         }
         else
         {
-            std::string b = Stringify() << extent.toString() << level.styleName().get();
+            std::string b = Stringify() << extent.toString() << level.styleName().get() << "_" << signature;
             return Cache::makeCacheKey(b, "fmg");
         }
     }
 }
 
+std::string
+FeatureModelGraph::getCacheSignature()
+{
+    ScopedMutexLock lock(_cacheSignature);
+    return _cacheSignature;
+}
+
+void
+FeatureModelGraph::updateCacheSignature()
+{
+    // Cached tiles are only valid for the feature data and styles that built them,
+    // so fold both into the cache keys. Anything else that changes the output
+    // (filters, layout, etc.) is part of the layer config and therefore already
+    // part of the layer's cache bin ID.
+    std::stringstream buf;
+
+    FeatureSource* fs = _session->getFeatureSource();
+    if (fs)
+        buf << fs->getRevision();
+
+    const StyleSheet* styles = _session->styles();
+    if (styles)
+        buf << styles->getConfig().toJSON(false);
+
+    ScopedMutexLock lock(_cacheSignature);
+    _cacheSignature.assign(hashToString(buf.str()));
+}
+
 osg::Group*
 FeatureModelGraph::readTileFromCache(const std::string&    cacheKey,
     const osgDB::Options* readOptions)
@@ -1340,7 +1481,7 @@ FeatureModelGraph::buildTile(const FeatureLevel& level,
     osg::ref_ptr<osg::Group> group;
 
     // Try to read it from a cache:
-    std::string cacheKey = makeCacheKey(level, extent, key);
+    std::string cacheKey = makeCacheKey(level, extent, key, getCacheSignature());
 
     if (_options.nodeCaching() == true)
     {
@@ -1731,24 +1872,33 @@ FeatureModelGraph::queryAndSortIntoStyleGroups(const Query&            query,
 
     StringExpression styleExprCopy(styleExpr);
 
-    // visit each feature and run the expression to sort it into a bin.
-    std::map<std::string, FeatureList> styleBins;
+    FeatureList features;
     while (cursor->hasMore())
     {
         osg::ref_ptr<Feature> feature = cursor->nextFeature();
         if (feature.valid())
-        {
-            const std::string& styleString = feature->eval(styleExprCopy, &context);
-            if (!styleString.empty() && styleString != "null")
-            {
-                styleBins[styleString].push_back(feature.get());
-            }
-        }
+            features.push_back(feature.get());
 
         if (progress && progress->isCanceled())
             return;
     }
 
+    // run the expression over all the features at once (so any script runs
+    // in one engine call) and sort each feature into a bin.
+    std::vector<std::string> styleStrings;
+    Feature::eval(styleExprCopy, features, &context, styleStrings);
+
+    std::map<std::string, FeatureList> styleBins;
+    unsigned row = 0u;
+    for (FeatureList::iterator f = features.begin(); f != features.end(); ++f, ++row)
+    {
+        const std::string& styleString = styleStrings[row];
+        if (!styleString.empty() && styleString != "null")
+        {
+            styleBins[styleString].push_back(f->get());
+        }
+    }
+
     // next create a style group per bin.
     for (std::map<std::string, FeatureList>::iterator i = styleBins.begin(); i != styleBins.end(); ++i)
     {
@@ -1833,6 +1983,18 @@ FeatureModelGraph::createStyleGroup(const Style&          style,
         context = crop2.push(workingSet, context);
     }
 
+    // simplify the geometry down to the detail the tile can show.
+    if (_options.layout().isSet() &&
+        _options.layout()->simplificationError().isSet() &&
+        context.extent().isSet() &&
+        context.extent()->isValid())
+    {
+        const double tilePixels = 256.0;
+        double tileSize = osg::maximum(context.extent()->width(), context.extent()->height());
+        SimplifyFilter simplify(tileSize / tilePixels * _options.layout()->simplificationError().get());
+        context = simplify.push(workingSet, context);
+    }
+
     // finally, compile the features into a node.
     if (workingSet.size() > 0)
     {
@@ -1998,6 +2160,21 @@ FeatureModelGraph::redraw()
     // clear it out
     removeChildren(0, getNumChildren());
 
+    // every tile is about to be rebuilt
+    {
+        ScopedMutexLock lock(_tileTrackingMutex);
+        _pagedTiles.clear();
+        _featureTiles.clear();
+        _tilesToReload.clear();
+        _redrawRequested = false;
+    }
+
+    // new data or styles invalidate any cached tiles
+    if (_options.nodeCaching() == true)
+    {
+        updateCacheSignature();
+    }
+
     // initialize the index if necessary.
     if (_options.featureIndexing()->enabled() == true)
     {
@@ -2078,8 +2255,188 @@ FeatureModelGraph::traverse(osg::NodeVisitor& nv)
 
         osg::Group::traverse(nv);
     }
+    else if (nv.getVisitorType() == nv.UPDATE_VISITOR)
+    {
+        applyFeatureChanges();
+        osg::Group::traverse(nv);
+    }
     else
     {
         osg::Group::traverse(nv);
     }
 }
+
+void
+FeatureModelGraph::trackPagedTile(
+    const std::string& uri,
+    osg::Node* node,
+    unsigned lod, unsigned tileX, unsigned tileY)
+{
+#ifdef USE_PAGING_MANAGER
+    if (node == nullptr)
+        return;
+
+    ScopedMutexLock lock(_tileTrackingMutex);
+    PagedTile& tile = _pagedTiles[uri];
+    tile._node = node;
+    tile._lod = lod, tile._tileX = tileX, tile._tileY = tileY;
+    tile._hasGeometry = false;
+#endif
+}
+
+void
+FeatureModelGraph::trackTileFeatures(
+    const std::string& uri,
+    osg::Node* geometry)
+{
+    CollectFIDs collect;
+    if (geometry && _featureIndex.valid())
+    {
+        geometry->accept(collect);
+    }
+
+    // charge the tile's geometry to the feature subsystem until it pages out
+    if (geometry)
+    {
+        CountGeometryBytes count;
+        geometry->accept(count);
+        Memory::track(geometry, Memory::FEATURE_GEOMETRY, count._bytes);
+    }
+
+    ScopedMutexLock lock(_tileTrackingMutex);
+
+    auto i = _pagedTiles.find(uri);
+    if (i == _pagedTiles.end())
+        return;
+
+    // even an empty tile needs reloading if a feature moves into it
+    i->second._hasGeometry = true;
+
+    for (auto fid : collect._fids)
+    {
+        _featureTiles[fid].insert(uri);
+    }
+}
+
+void
+FeatureModelGraph::dirtyFeatures(
+    const std::vector<FeatureID>& fids,
+    const GeoExtent& extent)
+{
+    ScopedMutexLock lock(_tileTrackingMutex);
+
+    // Without paged tiles there's nothing smaller than the whole graph
+    // to rebuild. Same if we can't tell where the change happened.
+    if (_pagedTiles.empty() ||
+        (!extent.isValid() && (fids.empty() || !_featureIndex.valid())))
+    {
+        _redrawRequested = true;
+        return;
+    }
+
+    // tiles that drew the features:
+    for (auto fid : fids)
+    {
+        auto f = _featureTiles.find(fid);
+        if (f != _featureTiles.end())
+        {
+            _tilesToReload.insert(f->second.begin(), f->second.end());
+            _featureTiles.erase(f);
+        }
+    }
+
+    // tiles the old or new geometry falls in:
+    if (extent.isValid())
+    {
+        GeoExtent localExtent = extent.transform(_usableFeatureExtent.getSRS());
+        if (!localExtent.isValid())
+        {
+            _redrawRequested = true;
+            return;
+        }
+
+        Threading::ScopedReadLock sharedLock(_blacklistMutex);
+
+        for (auto& i : _pagedTiles)
+        {
+            const PagedTile& tile = i.second;
+            if (tile._hasGeometry &&
+                s_getTileExtent(tile._lod, tile._tileX, tile._tileY, _usableFeatureExtent).intersects(localExtent))
+            {
+                _tilesToReload.insert(i.first);
+
+                // A blacklisted tile whose node is gone won't come back when its
+                // parent pages in again, so the parent has to reload as well.
+                if (tile._lod > 0 && !tile._node.valid() && _blacklist.find(i.first) != _blacklist.end())
+                {
+                    _tilesToReload.insert(s_makeURI(tile._lod - 1, tile._tileX / 2, tile._tileY / 2));
+                }
+            }
+        }
+    }
+}
+
+void
+FeatureModelGraph::applyFeatureChanges()
+{
+    bool redrawRequested;
+    std::vector<osg::ref_ptr<osg::Node> > nodes;
+    std::set<std::string> uris;
+    {
+        ScopedMutexLock lock(_tileTrackingMutex);
+
+        redrawRequested = _redrawRequested;
+        _redrawRequested = false;
+
+        if (!redrawRequested)
+        {
+            uris.swap(_tilesToReload);
+
+            for (auto& uri : uris)
+            {
+                auto i = _pagedTiles.find(uri);
+                if (i == _pagedTiles.end())
+                    continue;
+
+                osg::ref_ptr<osg::Node> node;
+                if (i->second._node.lock(node))
+                    nodes.push_back(node);
+                else
+                    _pagedTiles.erase(i); // paged out; will reload fresh
+            }
+        }
+    }
+
+    if (redrawRequested)
+    {
+        redraw();
+        return;
+    }
+
+    if (uris.empty())
+        return;
+
+    OE_DEBUG << LC << "Reloading " << nodes.size() << " tiles after a feature change" << std::endl;
+
+    // any cached copies of these tiles are out of date
+    if (_options.nodeCaching() == true)
+    {
+        updateCacheSignature();
+    }
+
+    // a tile that was empty may not be any more
+    {
+        Threading::ScopedWriteLock exclusiveLock(_blacklistMutex);
+        for (auto& uri : uris)
+            _blacklist.erase(uri);
+    }
+
+#ifdef USE_PAGING_MANAGER
+    for (auto& node : nodes)
+    {
+        PagedNode2* pagedNode = dynamic_cast<PagedNode2*>(node.get());
+        if (pagedNode)
+            pagedNode->reset();
+    }
+#endif
+}
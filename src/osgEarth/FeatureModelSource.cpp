@@ -121,7 +121,11 @@ FeatureNodeFactory::getOrCreateStyleGroup(const Style& style,
         alt->clamping() == AltitudeSymbol::CLAMP_TO_TERRAIN &&
         alt->technique() == AltitudeSymbol::TECHNIQUE_DRAPE )
     {
-        group = new DrapeableNode();
+        // compiled feature geometry doesn't change in place; tiles come
+        // and go as whole nodes, so the overlay can be cached.
+        DrapeableNode* drapeable = new DrapeableNode();
+        drapeable->setStatic(true);
+        group = drapeable;
     }
 
     else if (alt &&
@@ -253,7 +253,7 @@ FeatureNode::setStyle(const Style& style)
     AnnotationNode::setStyle( style );
 
     _needsRebuild = true;
-    build();
+    requestRebuild();
 }
 
 const GeometryCompilerOptions&
@@ -290,7 +290,7 @@ void FeatureNode::setIndex(FeatureIndexBuilder* index)
     {
         _index = index;
         _needsRebuild = true;
-        build();
+        requestRebuild();
     }
 }
 
@@ -311,12 +311,18 @@ void FeatureNode::setFeature(Feature* feature)
         _features.push_back( feature );
     }
     _needsRebuild = true;
-    build();
+    requestRebuild();
 }
 
 void FeatureNode::dirty()
 {
     _needsRebuild = true;
+    requestRebuild();
+}
+
+void
+FeatureNode::rebuild()
+{
     build();
 }
 
@@ -18,6 +18,7 @@
  */
 #include <osgEarth/FeatureSource>
 #include <osgEarth/Filter>
+#include <algorithm>
 
 #define LC "[FeatureSource] " << getName() << ": "
 
@@ -95,6 +96,7 @@ FeatureSource::init()
     Layer::init();
     _blacklistMutex.setName(getName());
     _blacklistSize = 0u;
+    _stringPool = new StringPool();
 }
 
 Status
@@ -183,6 +185,49 @@ FeatureSource::isBlacklisted( FeatureID fid ) const
     return _blacklist.find( fid ) != _blacklist.end();
 }
 
+void
+FeatureSource::dirty()
+{
+    featuresChanged(std::vector<FeatureID>(), GeoExtent::INVALID);
+}
+
+void
+FeatureSource::addChangeCallback(ChangeCallback* cb)
+{
+    if (cb)
+    {
+        Threading::ScopedMutexLock lock(_changeCallbacksMutex);
+        _changeCallbacks.push_back(cb);
+    }
+}
+
+void
+FeatureSource::removeChangeCallback(ChangeCallback* cb)
+{
+    Threading::ScopedMutexLock lock(_changeCallbacksMutex);
+    _changeCallbacks.erase(
+        std::remove(_changeCallbacks.begin(), _changeCallbacks.end(), cb),
+        _changeCallbacks.end());
+}
+
+void
+FeatureSource::featuresChanged(const std::vector<FeatureID>& fids, const GeoExtent& extent)
+{
+    bumpRevision();
+
+    // copy so a callback can remove itself
+    std::vector<osg::ref_ptr<ChangeCallback> > callbacks;
+    {
+        Threading::ScopedMutexLock lock(_changeCallbacksMutex);
+        callbacks = _changeCallbacks;
+    }
+
+    for (auto& cb : callbacks)
+    {
+        cb->onFeaturesChanged(fids, extent);
+    }
+}
+
 void
 FeatureSource::applyFilters(FeatureList& features, const GeoExtent& extent) const
 {
@@ -214,6 +259,38 @@ FeatureSource::createFeatureCursor(const Query& query, ProgressCallback* progres
     return createFeatureCursorImplementation(query, progress);
 }
 
+bool
+FeatureSource::getFeatureBounds(const Query& query, FeatureBoundsList& output, ProgressCallback* progress)
+{
+    // Filters only run on real features, so go through a cursor
+    if (_filters.valid() && _filters->empty() == false)
+        return FeatureSource::getFeatureBoundsImplementation(query, output, progress);
+
+    return getFeatureBoundsImplementation(query, output, progress);
+}
+
+bool
+FeatureSource::getFeatureBoundsImplementation(const Query& query, FeatureBoundsList& output, ProgressCallback* progress)
+{
+    osg::ref_ptr<FeatureCursor> cursor = createFeatureCursor(query, progress);
+    if (!cursor.valid())
+        return false;
+
+    while (cursor->hasMore())
+    {
+        Feature* feature = cursor->nextFeature();
+        if (feature && feature->getGeometry())
+        {
+            FeatureBounds entry;
+            entry.fid = feature->getFID();
+            entry.bounds = feature->getGeometry()->getBounds();
+            output.push_back(entry);
+        }
+    }
+
+    return !(progress && progress->isCanceled());
+}
+
 namespace
 {
     struct MultiCursor : public FeatureCursor
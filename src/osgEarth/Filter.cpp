@@ -40,6 +40,19 @@ FeatureFilter::~FeatureFilter()
 {
 }
 
+FilterContext
+FeatureFilter::push(FeatureBatch& input, FilterContext& context)
+{
+    FeatureList features;
+    input.toList(features);
+
+    FilterContext result = push(features, context);
+
+    input.clear();
+    input.fromList(features);
+    return result;
+}
+
 /********************************************************************************/
 
 #undef LC
@@ -34,6 +34,10 @@ REGISTER_OSGEARTH_LAYER(flattened_elevation, FlatteningLayer);
 
 #define OE_TEST OE_DEBUG
 
+// Width (and height) of the blocks of heightfield samples that share
+// one search of the segment index
+#define SEGMENT_SEARCH_BLOCK_SIZE 8u
+
 namespace
 {
     // linear interpolation between a and b
@@ -405,12 +409,18 @@ namespace
 
     typedef RTree<unsigned, double, 2> LineSegmentIndex;
 
-    void buildSegmentList(const MultiGeometry* geom, LineSegmentList& segments, LineSegmentIndex& index)
+    // Indexes each segment by its bounds grown by the full width of its
+    // flattening, so a search over some samples finds exactly the segments
+    // that can affect them.
+    void buildSegmentList(const MultiGeometry* geom, const WidthsList& widths, LineSegmentList& segments, LineSegmentIndex& index)
     {
         for (unsigned int geomIndex = 0; geomIndex < geom->getNumComponents(); geomIndex++)
         {
             Geometry* component = geom->getComponents()[geomIndex].get();
 
+            const Widths& w = widths[geomIndex];
+            double outerRadius = w.lineWidth * 0.5 + w.bufferWidth;
+
             ConstGeometryIterator giter(component);
             while (giter.hasMore())
             {
@@ -423,8 +433,8 @@ namespace
                     const osg::Vec3d& B = (*part)[i + 1];
                     segments.emplace_back(A, B, geomIndex);
 
-                    double min[2] = { osg::minimum(A.x(), B.x()), osg::minimum(A.y(), B.y()) };
-                    double max[2] = { osg::maximum(A.x(), B.x()), osg::maximum(A.y(), B.y()) };
+                    double min[2] = { osg::minimum(A.x(), B.x()) - outerRadius, osg::minimum(A.y(), B.y()) - outerRadius };
+                    double max[2] = { osg::maximum(A.x(), B.x()) + outerRadius, osg::maximum(A.y(), B.y()) + outerRadius };
 
                     unsigned int segmentIndex = segments.size() - 1;
 
@@ -434,6 +444,68 @@ namespace
         }
     }
 
+    // The segments near one block of samples, stored as flat arrays so the
+    // distance from a sample to every one of them is a simple loop the
+    // compiler can vectorize.
+    struct SegmentBatch
+    {
+        std::vector<unsigned> segment;
+        std::vector<double> ax, ay, az;
+        std::vector<double> abx, aby, abz;
+        std::vector<double> invL2;
+        std::vector<double> outerRadius2;
+
+        // outputs of distances():
+        std::vector<double> t, d2;
+
+        unsigned size() const { return segment.size(); }
+
+        void clear()
+        {
+            segment.clear();
+            ax.clear(), ay.clear(), az.clear();
+            abx.clear(), aby.clear(), abz.clear();
+            invL2.clear();
+            outerRadius2.clear();
+        }
+
+        void add(unsigned index, const LineSegment& s, double outerRadius)
+        {
+            segment.push_back(index);
+            ax.push_back(s.A.x()), ay.push_back(s.A.y()), az.push_back(s.A.z());
+            abx.push_back(s.AB.x()), aby.push_back(s.AB.y()), abz.push_back(s.AB.z());
+            // a zero-length segment gets t = 0, i.e. the distance to A
+            invL2.push_back(s.length2 > 0.0 ? 1.0 / s.length2 : 0.0);
+            outerRadius2.push_back(outerRadius * outerRadius);
+        }
+
+        // For every segment, the parameter [0..1] of the point closest
+        // to P and the squared distance to it
+        void distances(const osg::Vec3d& P)
+        {
+            const unsigned n = size();
+            t.resize(n);
+            d2.resize(n);
+
+            const double* AX = ax.data(); const double* AY = ay.data(); const double* AZ = az.data();
+            const double* ABX = abx.data(); const double* ABY = aby.data(); const double* ABZ = abz.data();
+            const double* IL2 = invL2.data();
+            double* T = t.data();
+            double* D2 = d2.data();
+            const double px = P.x(), py = P.y(), pz = P.z();
+
+            for (unsigned k = 0; k < n; ++k)
+            {
+                double apx = px - AX[k], apy = py - AY[k], apz = pz - AZ[k];
+                double tk = (apx*ABX[k] + apy*ABY[k] + apz*ABZ[k]) * IL2[k];
+                tk = tk < 0.0 ? 0.0 : tk > 1.0 ? 1.0 : tk;
+                double dx = apx - ABX[k] * tk, dy = apy - ABY[k] * tk, dz = apz - ABZ[k] * tk;
+                T[k] = tk;
+                D2[k] = dx*dx + dy*dy + dz*dz;
+            }
+        }
+    };
+
     /**
      * Create a heightfield that flattens the terrain around linear geometry.
      * lineWidth = width of completely flat area
@@ -455,13 +527,6 @@ namespace
     {
         OE_PROFILING_ZONE;
 
-        double maxBufferDistance = 0.0;
-        for (auto& w : widths)
-        {
-            double d = w.bufferWidth + w.lineWidth;
-            if (d > maxBufferDistance) maxBufferDistance = d;
-        }
-
         bool wroteChanges = false;
 
         GeoExtent ex = key.getExtent();
@@ -473,225 +538,231 @@ namespace
         double col_interval = ex.width() / (double)(hf->getNumColumns() - 1);
         double row_interval = ex.height() / (double)(hf->getNumRows() - 1);
 
-        osg::Vec3d P, PROJ;
+        osg::Vec3d P;
         GeoPoint EP(geomSRS, 0, 0, 0);
 
         ElevationSample elevSample;
 
-        for (unsigned row = 0; row < hf->getNumRows(); ++row)
-        {
-            P.y() = ex.yMin() + (double)row * row_interval;
+        const unsigned numCols = hf->getNumColumns();
+        const unsigned numRows = hf->getNumRows();
 
-            std::vector< unsigned int > hits;
+        std::vector<unsigned int> hits;
+        SegmentBatch batch;
 
-            double searchMin[2] = { ex.xMin() - maxBufferDistance, P.y() - maxBufferDistance };
-            double searchMax[2] = { ex.xMax() + maxBufferDistance, P.y() + maxBufferDistance };
-            index.Search(searchMin, searchMax, &hits, ~0u);
+        // For each point, we need to find the closest line segments to that point
+        // because the elevation values on these line segments will be the flattening
+        // value. There may be more than one line segment that falls within the search
+        // radius; we will collect up to MaxSamples of these for each heightfield point.
+        static const unsigned Maxsamples = 4;
+        Samples samples;
+        samples.reserve(Maxsamples);
 
-            // If there are no hits just skip the whole row.
-            if (hits.size() == 0)
-            {
-                continue;
-            }
+        for (unsigned row0 = 0; row0 < numRows; row0 += SEGMENT_SEARCH_BLOCK_SIZE)
+        {
+            unsigned row1 = osg::minimum(row0 + SEGMENT_SEARCH_BLOCK_SIZE, numRows);
 
-            for (unsigned col = 0; col < hf->getNumColumns(); ++col)
+            for (unsigned col0 = 0; col0 < numCols; col0 += SEGMENT_SEARCH_BLOCK_SIZE)
             {
-                P.x() = ex.xMin() + (double)col * col_interval;
+                unsigned col1 = osg::minimum(col0 + SEGMENT_SEARCH_BLOCK_SIZE, numCols);
+
+                if (progress && progress->isCanceled())
+                    return false;
+
+                // Find the segments whose flattening can reach this block of samples.
+                // The index holds each segment's bounds grown by its own outer radius.
+                double searchMin[2] = { ex.xMin() + (double)col0 * col_interval, ex.yMin() + (double)row0 * row_interval };
+                double searchMax[2] = { ex.xMin() + (double)(col1 - 1) * col_interval, ex.yMin() + (double)(row1 - 1) * row_interval };
 
-                // For each point, we need to find the closest line segments to that point
-                // because the elevation values on these line segments will be the flattening
-                // value. There may be more than one line segment that falls within the search
-                // radius; we will collect up to MaxSamples of these for each heightfield point.
-                static const unsigned Maxsamples = 4;
-                Samples samples;
+                hits.clear();
+                index.Search(searchMin, searchMax, &hits, ~0u);
+
+                // If there are no hits just skip the whole block.
+                if (hits.empty())
+                {
+                    continue;
+                }
 
-                unsigned int hitIndex = 0;
-                // What is the maximum number of hits we see in this area?
+                batch.clear();
                 for (auto hit : hits)
                 {
-                    LineSegment& segment = segments[hit];
+                    const Widths& w = widths[segments[hit].geomIndex];
+                    batch.add(hit, segments[hit], w.lineWidth * 0.5 + w.bufferWidth);
+                }
 
-                    const Widths& w = widths[segment.geomIndex];
+                for (unsigned row = row0; row < row1; ++row)
+                {
+                    P.y() = ex.yMin() + (double)row * row_interval;
 
-                    double innerRadius = w.lineWidth * 0.5;
-                    double outerRadius = innerRadius + w.bufferWidth;
-                    double outerRadius2 = outerRadius * outerRadius;
+                    for (unsigned col = col0; col < col1; ++col)
+                    {
+                        P.x() = ex.xMin() + (double)col * col_interval;
 
-                    // AB is a candidate line segment:
-                    const osg::Vec3d& A = segment.A;
-                    const osg::Vec3d& B = segment.B;
+                        samples.clear();
 
-                    //osg::Vec3d AB = B - A;    // current segment AB
-                    const osg::Vec3d& AB = segment.AB;
+                        // Distance to all the nearby segments at once:
+                        batch.distances(P);
 
-                    double t;                 // parameter [0..1] on segment AB
-                    double D2;                // shortest distance from point P to segment AB, squared
-                    //double L2 = AB.length2(); // length (squared) of segment AB
-                    double L2 = segment.length2; // length (squared) of segment AB
+                        for (unsigned k = 0; k < batch.size(); ++k)
+                        {
+                            double D2 = batch.d2[k]; // shortest distance from point P to segment AB, squared
 
-                    osg::Vec3d AP = P - A;    // vector from endpoint A to point P
+                            // If the distance from our point to the line segment falls within
+                            // the maximum flattening distance, store it.
+                            if (D2 <= batch.outerRadius2[k])
+                            {
+                                LineSegment& segment = segments[batch.segment[k]];
 
-                    if (L2 == 0.0)
-                    {
-                        // trivial case: zero-length segment
-                        t = 0.0;
-                        D2 = AP.length2();
-                    }
-                    else
-                    {
-                        // Calculate parameter "t" [0..1] which will yield the closest point on AB to P.
-                        // Clamping it means the closest point won't be beyond the endpoints of the segment.
-                        t = clamp((AP * AB) / L2, 0.0, 1.0);
+                                const Widths& w = widths[segment.geomIndex];
 
-                        // project our point P onto segment AB:
-                        PROJ.set(A + AB * t);
+                                double innerRadius = w.lineWidth * 0.5;
+                                double outerRadius = innerRadius + w.bufferWidth;
 
-                        // measure the distance (squared) from P to the projected point on AB:
-                        D2 = (P - PROJ).length2();
-                    }
+                                // AB is a candidate line segment:
+                                const osg::Vec3d& A = segment.A;
+                                const osg::Vec3d& B = segment.B;
 
-                    // If the distance from our point to the line segment falls within
-                    // the maximum flattening distance, store it.
-                    if (D2 <= outerRadius2)
-                    {
-                        // see if P is a new sample.
-                        Sample* b;
-                        if (samples.size() < Maxsamples)
-                        {
-                            // If we haven't collected the maximum number of samples yet,
-                            // just add this to the list:
-                            samples.emplace_back(std::move(Sample()));
-                            b = &samples.back();
-                        }
-                        else
-                        {
-                            // If we are maxed out on samples, find the farthest one we have so far
-                            // and replace it if the new point is closer:
-                            unsigned max_i = 0;
-                            for (unsigned i = 1; i < samples.size(); ++i)
-                                if (samples[i].D2 > samples[max_i].D2)
-                                    max_i = i;
+                                double t = batch.t[k]; // parameter [0..1] on segment AB
 
-                            b = &samples[max_i];
+                                // see if P is a new sample.
+                                Sample* b;
+                                if (samples.size() < Maxsamples)
+                                {
+                                    // If we haven't collected the maximum number of samples yet,
+                                    // just add this to the list:
+                                    samples.emplace_back(std::move(Sample()));
+                                    b = &samples.back();
+                                }
+                                else
+                                {
+                                    // If we are maxed out on samples, find the farthest one we have so far
+                                    // and replace it if the new point is closer:
+                                    unsigned max_i = 0;
+                                    for (unsigned i = 1; i < samples.size(); ++i)
+                                        if (samples[i].D2 > samples[max_i].D2)
+                                            max_i = i;
 
-                            if (b->D2 < D2)
-                                b = 0L;
-                        }
+                                    b = &samples[max_i];
 
-                        if (b)
-                        {
-                            b->D2 = D2;
-                            b->A = A;
-                            b->B = B;
-                            b->T = t;
+                                    if (b->D2 < D2)
+                                        b = 0L;
+                                }
 
-                            // Sample the segment start and end elevations if they haven't been previously set.
-                            if (segment.AElev == NO_DATA_VALUE)
-                            {
-                                EP.x() = segment.A.x(), EP.y() = segment.A.y();
-                                segment.AElev = pool->getSample(EP, workingSet).elevation();
+                                if (b)
+                                {
+                                    b->D2 = D2;
+                                    b->A = A;
+                                    b->B = B;
+                                    b->T = t;
+
+                                    // Sample the segment start and end elevations if they haven't been previously set.
+                                    if (segment.AElev == NO_DATA_VALUE)
+                                    {
+                                        EP.x() = segment.A.x(), EP.y() = segment.A.y();
+                                        segment.AElev = pool->getSample(EP, workingSet).elevation();
+                                    }
+
+                                    if (segment.BElev == NO_DATA_VALUE)
+                                    {
+                                        EP.x() = segment.B.x(), EP.y() = segment.B.y();
+                                        segment.BElev = pool->getSample(EP, workingSet).elevation();
+                                    }
+
+                                    b->AElev = segment.AElev;
+                                    b->BElev = segment.BElev;
+
+                                    b->innerRadius = innerRadius;
+                                    b->outerRadius = outerRadius;
+                                }
                             }
+                        }
 
-                            if (segment.BElev == NO_DATA_VALUE)
-                            {
-                                EP.x() = segment.B.x(), EP.y() = segment.B.y();
-                                segment.BElev = pool->getSample(EP, workingSet).elevation();
+                        // Remove unnecessary sample points that lie on the endpoint of a segment
+                        // that abuts another segment in our list.
+                        for (unsigned i = 0; i < samples.size();) {
+                            if (!isSampleValid(&samples[i], samples)) {
+                                samples[i] = samples[samples.size() - 1];
+                                samples.resize(samples.size() - 1);
                             }
-
-                            b->AElev = segment.AElev;
-                            b->BElev = segment.BElev;
-
-                            b->innerRadius = innerRadius;
-                            b->outerRadius = outerRadius;
+                            else ++i;
                         }
-                    }
-                }
 
-                // Remove unnecessary sample points that lie on the endpoint of a segment
-                // that abuts another segment in our list.
-                for (unsigned i = 0; i < samples.size();) {
-                    if (!isSampleValid(&samples[i], samples)) {
-                        samples[i] = samples[samples.size() - 1];
-                        samples.resize(samples.size() - 1);
-                    }
-                    else ++i;
-                }
-
-                // Now that we are done searching for line segments close to our point,
-                // we will collect the elevations at our sample points and use them to
-                // create a new elevation value for our point.
-                if (samples.size() > 0)
-                {
-                    // The original elevation at our point:
-                    //float elevP = pool->getElevation(P.x(), P.y());
+                        // Now that we are done searching for line segments close to our point,
+                        // we will collect the elevations at our sample points and use them to
+                        // create a new elevation value for our point.
+                        if (samples.size() > 0)
+                        {
+                            // The original elevation at our point:
+                            //float elevP = pool->getElevation(P.x(), P.y());
 
-                    EP.x() = P.x(), EP.y() = P.y();
+                            EP.x() = P.x(), EP.y() = P.y();
 
-                    elevSample = pool->getSample(EP, workingSet);
+                            elevSample = pool->getSample(EP, workingSet);
 
-                    float elevP = elevSample.elevation().getValue();
+                            float elevP = elevSample.elevation().getValue();
 
-                    for (unsigned i = 0; i < samples.size(); ++i)
-                    {
-                        Sample& sample = samples[i];
+                            for (unsigned i = 0; i < samples.size(); ++i)
+                            {
+                                Sample& sample = samples[i];
 
-                        sample.D = sqrt(sample.D2);
+                                sample.D = sqrt(sample.D2);
 
-                        // Blend factor. 0 = distance is less than or equal to the inner radius;
-                        //               1 = distance is greater than or equal to the outer radius.
-                        double blend = clamp(
-                            (sample.D - sample.innerRadius) / (sample.outerRadius - sample.innerRadius),
-                            0.0, 1.0);
+                                // Blend factor. 0 = distance is less than or equal to the inner radius;
+                                //               1 = distance is greater than or equal to the outer radius.
+                                double blend = clamp(
+                                    (sample.D - sample.innerRadius) / (sample.outerRadius - sample.innerRadius),
+                                    0.0, 1.0);
 
-                        if (sample.T == 0.0)
-                        {
-                            sample.elevPROJ = sample.AElev;
-                            if (sample.elevPROJ == NO_DATA_VALUE)
-                                sample.elevPROJ = elevP;
-                        }
-                        else if (sample.T == 1.0)
-                        {
-                            sample.elevPROJ = sample.BElev;
-                            if (sample.elevPROJ == NO_DATA_VALUE)
-                                sample.elevPROJ = elevP;
-                        }
-                        else
-                        {
-                            float elevA = sample.AElev;
-                            if (elevA == NO_DATA_VALUE)
-                                elevA = elevP;
+                                if (sample.T == 0.0)
+                                {
+                                    sample.elevPROJ = sample.AElev;
+                                    if (sample.elevPROJ == NO_DATA_VALUE)
+                                        sample.elevPROJ = elevP;
+                                }
+                                else if (sample.T == 1.0)
+                                {
+                                    sample.elevPROJ = sample.BElev;
+                                    if (sample.elevPROJ == NO_DATA_VALUE)
+                                        sample.elevPROJ = elevP;
+                                }
+                                else
+                                {
+                                    float elevA = sample.AElev;
+                                    if (elevA == NO_DATA_VALUE)
+                                        elevA = elevP;
 
-                            float elevB = sample.BElev;
-                            if (elevB == NO_DATA_VALUE)
-                                elevB = elevP;
+                                    float elevB = sample.BElev;
+                                    if (elevB == NO_DATA_VALUE)
+                                        elevB = elevP;
 
-                            // linear interpolation of height from point A to point B on the segment:
-                            sample.elevPROJ = mix(elevA, elevB, sample.T);
-                        }
+                                    // linear interpolation of height from point A to point B on the segment:
+                                    sample.elevPROJ = mix(elevA, elevB, sample.T);
+                                }
 
-                        // smoothstep interpolation of along the buffer (perpendicular to the segment)
-                        // will gently integrate the new value into the existing terrain.
-                        sample.elev = smootherstep(sample.elevPROJ, elevP, blend);
-                    }
+                                // smoothstep interpolation of along the buffer (perpendicular to the segment)
+                                // will gently integrate the new value into the existing terrain.
+                                sample.elev = smootherstep(sample.elevPROJ, elevP, blend);
+                            }
 
-                    // Finally, combine our new elevation values and set the new value in the output.
-                    float finalElev = interpolateSamplesIDW(samples);
-                    if (finalElev < FLT_MAX)
-                        hf->setHeight(col, row, finalElev);
-                    else
-                        hf->setHeight(col, row, elevP);
+                            // Finally, combine our new elevation values and set the new value in the output.
+                            float finalElev = interpolateSamplesIDW(samples);
+                            if (finalElev < FLT_MAX)
+                                hf->setHeight(col, row, finalElev);
+                            else
+                                hf->setHeight(col, row, elevP);
 
-                    wroteChanges = true;
-                }
+                            wroteChanges = true;
+                        }
 
-                else if (fillAllPixels)
-                {
-                    // No close segments were found, so just copy over the source data.
-                    EP.x() = P.x(), EP.y() = P.y();
-                    float h = pool->getSample(EP, workingSet).elevation();
-                    hf->setHeight(col, row, h);
+                        else if (fillAllPixels)
+                        {
+                            // No close segments were found, so just copy over the source data.
+                            EP.x() = P.x(), EP.y() = P.y();
+                            float h = pool->getSample(EP, workingSet).elevation();
+                            hf->setHeight(col, row, h);
 
-                    // Note: do not set wroteChanges to true.
+                            // Note: do not set wroteChanges to true.
+                        }
+                    }
                 }
             }
         }
@@ -708,7 +779,7 @@ namespace
         {
             LineSegmentList segments;
             LineSegmentIndex index;
-            buildSegmentList(geom, segments, index);
+            buildSegmentList(geom, widths, segments, index);
             return integrateLines(key, hf, segments, index, geomSRS, widths, pool, workingSet, fillAllPixels, progress);
         }
         else
@@ -21,33 +21,35 @@
 using namespace osgEarth;
 
 FrameClock::FrameClock() :
+    _tick(0),
     _updateFrame(0u),
     _cullFrame(0u)
 {
     _zero = std::chrono::steady_clock::now();
-    _tick = _zero;
 }
 
 double
 FrameClock::getTime() const
 {
-    auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(_tick - _zero);
-    return 0.001 * (double)(diff.count());
+    return 0.001 * (double)_tick.load();
 }
 
 unsigned
 FrameClock::getFrame() const
 {
-    return _updateFrame;
+    return _updateFrame.load();
 }
 
 bool
 FrameClock::update()
 {
-    if (_updateFrame == _cullFrame)
+    unsigned frame = _updateFrame.load();
+    if (frame == _cullFrame.load())
     {
-        _tick = std::chrono::steady_clock::now();
-        ++_updateFrame;
+        auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - _zero);
+        _tick.store(diff.count());
+        _updateFrame.store(frame + 1u);
         return true;
     }
     return false;
@@ -56,5 +58,5 @@ FrameClock::update()
 void
 FrameClock::cull()
 {
-    _cullFrame = _updateFrame;
+    _cullFrame.store(_updateFrame.load());
 }
@@ -26,6 +26,7 @@
 #include <osgEarth/Progress>
 #include <osgEarth/LandCover>
 #include <osgEarth/Metrics>
+#include <osgEarth/RasterPool>
 
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
@@ -35,6 +36,10 @@
 #include <osgDB/ImageOptions>
 
 #include <sstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
 #include <stdlib.h>
 #include <memory.h>
 
@@ -382,6 +387,16 @@ namespace osgEarth
             }
         }
 
+#if GDAL_VERSION_2_0_OR_NEWER
+        // GDAL progress function that aborts a RasterIO operation
+        // as soon as the osgEarth task is canceled
+        int CPL_STDCALL cancelableRasterIOProgress(double, const char*, void* data)
+        {
+            ProgressCallback* progress = static_cast<ProgressCallback*>(data);
+            return (progress && progress->isCanceled()) ? FALSE : TRUE;
+        }
+#endif
+
         // GDALRasterBand::RasterIO helper method
         bool rasterIO(GDALRasterBand *band,
             GDALRWFlag eRWFlag,
@@ -395,15 +410,28 @@ namespace osgEarth
             GDALDataType eBufType,
             GSpacing nPixelSpace,
             GSpacing nLineSpace,
-            RasterInterpolation interpolation = INTERP_NEAREST
+            RasterInterpolation interpolation = INTERP_NEAREST,
+            ProgressCallback* progress = nullptr
         )
         {
+            if (progress && progress->isCanceled())
+            {
+                return false;
+            }
+
 #if GDAL_VERSION_2_0_OR_NEWER
             GDALRasterIOExtraArg psExtraArg;
 
             // defaults to GRIORA_NearestNeighbour
             INIT_RASTERIO_EXTRA_ARG(psExtraArg);
 
+            // lets an abandoned read stop mid-stream
+            if (progress)
+            {
+                psExtraArg.pfnProgress = cancelableRasterIOProgress;
+                psExtraArg.pProgressData = progress;
+            }
+
             switch (interpolation)
             {
             case INTERP_AVERAGE:
@@ -437,6 +465,298 @@ namespace osgEarth
             }
             return (err == CE_None);
         }
+
+        // Sample type for each GDAL data type the block reader handles.
+        template<typename T> struct BlockSample;
+        template<> struct BlockSample<GByte>   { static GByte   convert(double v) { return (GByte)osg::clampBetween(v + 0.5, 0.0, 255.0); } };
+        template<> struct BlockSample<GUInt16> { static GUInt16 convert(double v) { return (GUInt16)osg::clampBetween(v + 0.5, 0.0, 65535.0); } };
+        template<> struct BlockSample<GInt16>  { static GInt16  convert(double v) { return (GInt16)floor(osg::clampBetween(v + 0.5, -32768.0, 32767.0)); } };
+        template<> struct BlockSample<float>   { static float   convert(double v) { return (float)v; } };
+
+        inline int sampleSize(GDALDataType type)
+        {
+            return
+                type == GDT_Byte ? 1 :
+                type == GDT_UInt16 || type == GDT_Int16 ? 2 :
+                type == GDT_Float32 ? 4 :
+                0;
+        }
+
+        /**
+         * LRU of decoded raster blocks, shared by the per-thread drivers of a
+         * layer. Each thread has its own GDALDataset (and therefore its own
+         * GDAL block cache), so without this adjacent tiles read on different
+         * threads would decode the same blocks over and over.
+         */
+        class BlockCache
+        {
+        public:
+            struct Key
+            {
+                int band, overview, bx, by, type;
+                bool operator==(const Key& rhs) const {
+                    return band == rhs.band && overview == rhs.overview && bx == rhs.bx && by == rhs.by && type == rhs.type;
+                }
+            };
+
+            struct KeyHash
+            {
+                std::size_t operator()(const Key& k) const {
+                    std::size_t h = std::hash<int>()(k.bx);
+                    h = h*31u + std::hash<int>()(k.by);
+                    h = h*31u + std::hash<int>()(k.band);
+                    h = h*31u + std::hash<int>()(k.overview);
+                    return h*31u + std::hash<int>()(k.type);
+                }
+            };
+
+            typedef std::shared_ptr<const std::vector<unsigned char> > Block;
+
+            BlockCache(std::size_t maxBytes) :
+                _maxBytes(maxBytes),
+                _bytes(0u),
+                _mutex("OE.GDAL.BlockCache") { }
+
+            Block get(const Key& key)
+            {
+                Threading::ScopedMutexLock lock(_mutex);
+                Map::iterator i = _map.find(key);
+                if (i == _map.end())
+                    return nullptr;
+                _lru.splice(_lru.begin(), _lru, i->second.second);
+                return i->second.first;
+            }
+
+            void insert(const Key& key, Block block)
+            {
+                Threading::ScopedMutexLock lock(_mutex);
+                if (_map.find(key) != _map.end())
+                    return; // another thread decoded it first
+
+                _lru.push_front(key);
+                _map[key] = std::make_pair(block, _lru.begin());
+                _bytes += block->size();
+
+                while (_bytes > _maxBytes && _lru.size() > 1u)
+                {
+                    Map::iterator last = _map.find(_lru.back());
+                    _bytes -= last->second.first->size();
+                    _map.erase(last);
+                    _lru.pop_back();
+                }
+            }
+
+        private:
+            typedef std::list<Key> LRU;
+            typedef std::unordered_map<Key, std::pair<Block, LRU::iterator>, KeyHash> Map;
+            Map _map;
+            LRU _lru;
+            std::size_t _maxBytes;
+            std::size_t _bytes;
+            Threading::Mutex _mutex;
+        };
+
+        // Resamples a region assembled from whole blocks into the caller's
+        // buffer. (x0,y0) and (sx,sy) map destination pixel centers into
+        // region pixel space.
+        template<typename T>
+        void resampleRegion(
+            const unsigned char* region, int regionWidth, int regionHeight,
+            double x0, double y0, double sx, double sy,
+            T* out, int outWidth, int outHeight,
+            bool bilinear,
+            const std::function<bool(float)>& isValid)
+        {
+            const T* src = reinterpret_cast<const T*>(region);
+
+            for (int j = 0; j < outHeight; ++j)
+            {
+                double y = y0 + ((double)j + 0.5)*sy;
+                for (int i = 0; i < outWidth; ++i)
+                {
+                    double x = x0 + ((double)i + 0.5)*sx;
+
+                    int nx = osg::clampBetween((int)floor(x), 0, regionWidth-1);
+                    int ny = osg::clampBetween((int)floor(y), 0, regionHeight-1);
+                    T nearest = src[ny*regionWidth + nx];
+
+                    if (!bilinear)
+                    {
+                        out[j*outWidth + i] = nearest;
+                        continue;
+                    }
+
+                    double fx = x - 0.5, fy = y - 0.5;
+                    int c0 = (int)floor(fx), r0 = (int)floor(fy);
+                    double wx = fx - (double)c0, wy = fy - (double)r0;
+                    int c1 = osg::clampBetween(c0+1, 0, regionWidth-1);
+                    int r1 = osg::clampBetween(r0+1, 0, regionHeight-1);
+                    c0 = osg::clampBetween(c0, 0, regionWidth-1);
+                    r0 = osg::clampBetween(r0, 0, regionHeight-1);
+
+                    T v00 = src[r0*regionWidth + c0], v10 = src[r0*regionWidth + c1];
+                    T v01 = src[r1*regionWidth + c0], v11 = src[r1*regionWidth + c1];
+
+                    // don't blend no-data into valid samples
+                    if (!isValid((float)v00) || !isValid((float)v10) || !isValid((float)v01) || !isValid((float)v11))
+                    {
+                        out[j*outWidth + i] = nearest;
+                        continue;
+                    }
+
+                    double v =
+                        ((double)v00*(1.0-wx) + (double)v10*wx)*(1.0-wy) +
+                        ((double)v01*(1.0-wx) + (double)v11*wx)*wy;
+
+                    out[j*outWidth + i] = BlockSample<T>::convert(v);
+                }
+            }
+        }
+
+        // Reads a window like rasterIO does, but from whole blocks that are
+        // cached and shared across tiles, on an overview picked to match the
+        // target resolution. Returns false if the read can't be handled
+        // here, so the caller can fall back on rasterIO.
+        bool readWindowFromBlocks(
+            BlockCache& cache,
+            GDALRasterBand* band,
+            int nXOff, int nYOff, int nXSize, int nYSize,
+            void* pData, int nBufXSize, int nBufYSize,
+            GDALDataType eBufType,
+            RasterInterpolation interpolation,
+            ProgressCallback* progress,
+            const std::function<bool(float)>& isValid,
+            bool& ok)
+        {
+            // cubic kernels are left to GDAL
+            if (interpolation != INTERP_NEAREST &&
+                interpolation != INTERP_BILINEAR &&
+                interpolation != INTERP_AVERAGE)
+            {
+                return false;
+            }
+
+            int size = sampleSize(eBufType);
+            if (size == 0)
+                return false;
+
+            // Pick the coarsest overview that still has at least the
+            // resolution of the target.
+            double factor = std::min((double)nXSize/(double)nBufXSize, (double)nYSize/(double)nBufYSize);
+            GDALRasterBand* source = band;
+            int overview = -1;
+            for (int i = 0; i < band->GetOverviewCount(); ++i)
+            {
+                GDALRasterBand* ov = band->GetOverview(i);
+                if (ov == nullptr || ov->GetXSize() <= 0)
+                    continue;
+
+                double ovFactor = (double)band->GetXSize() / (double)ov->GetXSize();
+                if (ovFactor <= factor * 1.001 && ovFactor > (double)band->GetXSize() / (double)source->GetXSize())
+                {
+                    source = ov;
+                    overview = i;
+                }
+            }
+
+            double scaleX = (double)source->GetXSize() / (double)band->GetXSize();
+            double scaleY = (double)source->GetYSize() / (double)band->GetYSize();
+
+            // Point sampling a much denser level would alias, and would pull
+            // in far too many blocks; GDAL's own resampler does it better.
+            double remaining = factor * std::min(scaleX, scaleY);
+            if (remaining > 2.0)
+                return false;
+
+            int blockW, blockH;
+            source->GetBlockSize(&blockW, &blockH);
+            if (blockW <= 0 || blockH <= 0)
+                return false;
+
+            // window on the chosen level
+            double wx0 = (double)nXOff * scaleX, wy0 = (double)nYOff * scaleY;
+            double wx1 = (double)(nXOff + nXSize) * scaleX, wy1 = (double)(nYOff + nYSize) * scaleY;
+
+            int px0 = osg::clampBetween((int)floor(wx0), 0, source->GetXSize());
+            int py0 = osg::clampBetween((int)floor(wy0), 0, source->GetYSize());
+            int px1 = osg::clampBetween((int)ceil(wx1), 0, source->GetXSize());
+            int py1 = osg::clampBetween((int)ceil(wy1), 0, source->GetYSize());
+            if (px1 <= px0 || py1 <= py0)
+                return false;
+
+            int regionW = px1 - px0, regionH = py1 - py0;
+            std::vector<unsigned char> region((std::size_t)regionW * regionH * size);
+
+            ok = true;
+
+            for (int by = py0 / blockH; by <= (py1 - 1) / blockH && ok; ++by)
+            {
+                for (int bx = px0 / blockW; bx <= (px1 - 1) / blockW && ok; ++bx)
+                {
+                    if (progress && progress->isCanceled())
+                    {
+                        ok = false;
+                        break;
+                    }
+
+                    int bw = std::min(blockW, source->GetXSize() - bx*blockW);
+                    int bh = std::min(blockH, source->GetYSize() - by*blockH);
+
+                    BlockCache::Key key = { band->GetBand(), overview, bx, by, (int)eBufType };
+                    BlockCache::Block block = cache.get(key);
+                    if (!block)
+                    {
+                        std::shared_ptr<std::vector<unsigned char> > decoded =
+                            std::make_shared<std::vector<unsigned char> >((std::size_t)bw * bh * size);
+
+                        if (!rasterIO(source, GF_Read, bx*blockW, by*blockH, bw, bh, &(*decoded)[0], bw, bh, eBufType, 0, 0, INTERP_NEAREST, progress))
+                        {
+                            ok = false;
+                            break;
+                        }
+
+                        block = decoded;
+                        cache.insert(key, block);
+                    }
+
+                    // copy the part of the block inside the region
+                    int cx0 = std::max(bx*blockW, px0), cx1 = std::min(bx*blockW + bw, px1);
+                    int cy0 = std::max(by*blockH, py0), cy1 = std::min(by*blockH + bh, py1);
+                    for (int y = cy0; y < cy1; ++y)
+                    {
+                        ::memcpy(
+                            &region[((std::size_t)(y - py0) * regionW + (cx0 - px0)) * size],
+                            &(*block)[((std::size_t)(y - by*blockH) * bw + (cx0 - bx*blockW)) * size],
+                            (std::size_t)(cx1 - cx0) * size);
+                    }
+                }
+            }
+
+            if (!ok)
+                return true;
+
+            double x0 = wx0 - (double)px0, y0 = wy0 - (double)py0;
+            double sx = (wx1 - wx0) / (double)nBufXSize, sy = (wy1 - wy0) / (double)nBufYSize;
+            bool bilinear = interpolation != INTERP_NEAREST;
+
+            switch (eBufType)
+            {
+            case GDT_Byte:
+                resampleRegion(&region[0], regionW, regionH, x0, y0, sx, sy, (GByte*)pData, nBufXSize, nBufYSize, bilinear, isValid);
+                break;
+            case GDT_UInt16:
+                resampleRegion(&region[0], regionW, regionH, x0, y0, sx, sy, (GUInt16*)pData, nBufXSize, nBufYSize, bilinear, isValid);
+                break;
+            case GDT_Int16:
+                resampleRegion(&region[0], regionW, regionH, x0, y0, sx, sy, (GInt16*)pData, nBufXSize, nBufYSize, bilinear, isValid);
+                break;
+            default:
+                resampleRegion(&region[0], regionW, regionH, x0, y0, sx, sy, (float*)pData, nBufXSize, nBufYSize, bilinear, isValid);
+                break;
+            }
+
+            return true;
+        }
     }
 } // namespace osgEarth::GDAL
 
@@ -467,6 +787,12 @@ GDAL::Driver::setExternalDataset(GDAL::ExternalDataset* value)
     _externalDataset = value;
 }
 
+void
+GDAL::Driver::setBlockCache(std::shared_ptr<BlockCache> value)
+{
+    _blockCache = value;
+}
+
 // Open the data source and prepare it for reading
 Status
 GDAL::Driver::open(const std::string& name,
@@ -1188,6 +1514,20 @@ GDAL::Driver::createImage(const TileKey& key,
     //The pixel format is always RGBA to support transparency
     GLenum pixelFormat = GL_RGBA;
 
+    // Reads the source window for one band into a target-sized buffer,
+    // through the shared block cache when there is one.
+    auto readWindow = [&](GDALRasterBand* band, void* data, GDALDataType type, RasterInterpolation interp)
+    {
+        if (_blockCache)
+        {
+            std::function<bool(float)> isValid = [this, band](float v) { return isValidValue(v, band); };
+            bool ok = false;
+            if (readWindowFromBlocks(*_blockCache, band, off_x, off_y, width, height, data, target_width, target_height, type, interp, progress, isValid, ok))
+                return ok;
+        }
+        return rasterIO(band, GF_Read, off_x, off_y, width, height, data, target_width, target_height, type, 0, 0, interp, progress);
+    };
+
 
     if (bandRed && bandGreen && bandBlue)
     {
@@ -1199,17 +1539,16 @@ GDAL::Driver::createImage(const TileKey& key,
         //Initialize the alpha values to 255.
         memset(alpha, 255, target_width * target_height);
 
-        image = new osg::Image;
-        image->allocateImage(tileSize, tileSize, 1, pixelFormat, GL_UNSIGNED_BYTE);
+        image = RasterPool::createImage(tileSize, tileSize, 1, pixelFormat, GL_UNSIGNED_BYTE);
         memset(image->data(), 0, image->getImageSizeInBytes());
 
-        rasterIO(bandRed, GF_Read, off_x, off_y, width, height, red, target_width, target_height, GDT_Byte, 0, 0, gdalOptions().interpolation().get());
-        rasterIO(bandGreen, GF_Read, off_x, off_y, width, height, green, target_width, target_height, GDT_Byte, 0, 0, gdalOptions().interpolation().get());
-        rasterIO(bandBlue, GF_Read, off_x, off_y, width, height, blue, target_width, target_height, GDT_Byte, 0, 0, gdalOptions().interpolation().get());
+        readWindow(bandRed, red, GDT_Byte, gdalOptions().interpolation().get());
+        readWindow(bandGreen, green, GDT_Byte, gdalOptions().interpolation().get());
+        readWindow(bandBlue, blue, GDT_Byte, gdalOptions().interpolation().get());
 
         if (bandAlpha)
         {
-            rasterIO(bandAlpha, GF_Read, off_x, off_y, width, height, alpha, target_width, target_height, GDT_Byte, 0, 0, gdalOptions().interpolation().get());
+            readWindow(bandAlpha, alpha, GDT_Byte, gdalOptions().interpolation().get());
         }
 
         for (int src_row = 0, dst_row = tile_offset_top;
@@ -1274,7 +1613,7 @@ GDAL::Driver::createImage(const TileKey& key,
             if (!success)
                 nodata = NO_DATA_VALUE; //getNoDataValue(); //getOptions().noDataValue().get();
 
-            if (rasterIO(bandGray, GF_Read, off_x, off_y, width, height, data, target_width, target_height, gdalDataType, 0, 0, INTERP_NEAREST))
+            if (readWindow(bandGray, data, gdalDataType, INTERP_NEAREST))
             {
                 // copy from data to image.
                 for (int src_row = 0, dst_row = tile_offset_top; src_row < target_height; src_row++, dst_row++)
@@ -1315,16 +1654,15 @@ GDAL::Driver::createImage(const TileKey& key,
             //Initialize the alpha values to 255.
             memset(alpha, 255, target_width * target_height);
 
-            image = new osg::Image;
-            image->allocateImage(tileSize, tileSize, 1, pixelFormat, GL_UNSIGNED_BYTE);
+            image = RasterPool::createImage(tileSize, tileSize, 1, pixelFormat, GL_UNSIGNED_BYTE);
             memset(image->data(), 0, image->getImageSizeInBytes());
 
 
-            rasterIO(bandGray, GF_Read, off_x, off_y, width, height, gray, target_width, target_height, GDT_Byte, 0, 0, gdalOptions().interpolation().get());
+            readWindow(bandGray, gray, GDT_Byte, gdalOptions().interpolation().get());
 
             if (bandAlpha)
             {
-                rasterIO(bandAlpha, GF_Read, off_x, off_y, width, height, alpha, target_width, target_height, GDT_Byte, 0, 0, gdalOptions().interpolation().get());
+                readWindow(bandAlpha, alpha, GDT_Byte, gdalOptions().interpolation().get());
             }
 
             for (int src_row = 0, dst_row = tile_offset_top;
@@ -1372,12 +1710,11 @@ GDAL::Driver::createImage(const TileKey& key,
         }
         else
         {
-            image = new osg::Image();
-            image->allocateImage(tileSize, tileSize, 1, pixelFormat, GL_UNSIGNED_BYTE);
+            image = RasterPool::createImage(tileSize, tileSize, 1, pixelFormat, GL_UNSIGNED_BYTE);
             memset(image->data(), 0, image->getImageSizeInBytes());
         }
 
-        rasterIO(bandPalette, GF_Read, off_x, off_y, width, height, palette, target_width, target_height, GDT_Byte, 0, 0, INTERP_NEAREST);
+        readWindow(bandPalette, palette, GDT_Byte, INTERP_NEAREST);
 
         ImageUtils::PixelWriter write(image.get());
 
@@ -1449,6 +1786,12 @@ GDAL::Driver::createImage(const TileKey& key,
         return NULL;
     }
 
+    // reads bail out early when canceled, so the image may be incomplete
+    if (progress && progress->isCanceled())
+    {
+        return NULL;
+    }
+
     return image.release();
 }
 
@@ -1466,8 +1809,7 @@ GDAL::Driver::createHeightField(const TileKey& key,
     //GDAL_SCOPED_LOCK;
 
     //Allocate the heightfield
-    osg::ref_ptr<osg::HeightField> hf = new osg::HeightField;
-    hf->allocate(tileSize, tileSize);
+    osg::ref_ptr<osg::HeightField> hf = RasterPool::createHeightField(tileSize, tileSize);
 
     if (intersects(key))
     {
@@ -1489,7 +1831,6 @@ GDAL::Driver::createHeightField(const TileKey& key,
             double rowMin, rowMax;
             geoToPixel(xmin, ymin, colMin, rowMax);
             geoToPixel(xmax, ymax, colMax, rowMin);
-            std::vector<float> buffer(tileSize * tileSize, NO_DATA_VALUE);
 
             int iColMin = floor(colMin);
             int iColMax = ceil(colMax);
@@ -1512,16 +1853,22 @@ GDAL::Driver::createHeightField(const TileKey& key,
             int iNumBufCols = iBufColMax - iBufColMin + 1;
             int iNumBufRows = iBufRowMax - iBufRowMin + 1;
 
-            int startOffset = iBufRowMin * tileSize + iBufColMin;
-            int lineSpace = tileSize * sizeof(float);
+            // Read straight into the heightfield. GDAL rows run north to south and
+            // heightfield rows south to north, so start at the top row and use a
+            // negative line spacing instead of flipping a copy afterwards.
+            std::vector<float>& heightList = hf->getHeightList();
+            std::fill(heightList.begin(), heightList.end(), NO_DATA_VALUE);
 
-            rasterIO(band, GF_Read, iWinColMin, iWinRowMin, iNumWinCols, iNumWinRows, &buffer[startOffset], iNumBufCols, iNumBufRows, GDT_Float32, 0, lineSpace);
+            int startOffset = (tileSize - 1 - iBufRowMin) * tileSize + iBufColMin;
+            int lineSpace = -(int)(tileSize * sizeof(float));
 
-            for (unsigned r = 0, ir = tileSize - 1; r < tileSize; ++r, --ir)
+            rasterIO(band, GF_Read, iWinColMin, iWinRowMin, iNumWinCols, iNumWinRows, &heightList[startOffset], iNumBufCols, iNumBufRows, GDT_Float32, 0, lineSpace, INTERP_NEAREST, progress);
+
+            if (_linearUnits != 1.0)
             {
-                for (unsigned c = 0; c < tileSize; ++c)
+                for (auto& h : heightList)
                 {
-                    hf->setHeight(c, ir, _linearUnits * buffer[r * tileSize + c]);
+                    h *= _linearUnits;
                 }
             }
         }
@@ -1546,6 +1893,12 @@ GDAL::Driver::createHeightField(const TileKey& key,
         std::vector<float>& heightList = hf->getHeightList();
         std::fill(heightList.begin(), heightList.end(), NO_DATA_VALUE);
     }
+
+    if (progress && progress->isCanceled())
+    {
+        return NULL;
+    }
+
     return hf.release();
 }
 
@@ -1562,8 +1915,7 @@ GDAL::Driver::createHeightFieldWithVRT(const TileKey& key,
     //GDAL_SCOPED_LOCK;
 
     //Allocate the heightfield
-    osg::ref_ptr<osg::HeightField> hf = new osg::HeightField;
-    hf->allocate(tileSize, tileSize);
+    osg::ref_ptr<osg::HeightField> hf = RasterPool::createHeightField(tileSize, tileSize);
     for (unsigned int i = 0; i < hf->getHeightList().size(); ++i) hf->getHeightList()[i] = NO_DATA_VALUE;
 
     if (intersects(key))
@@ -1641,32 +1993,24 @@ GDAL::Driver::createHeightFieldWithVRT(const TileKey& key,
         // Set the geotransform back to what it should actually be.
         GDALSetGeoTransform(tileDS, adfGeoTransform);
 
-        float* heights = new float[tileSize * tileSize];
-        for (unsigned int i = 0; i < tileSize * tileSize; i++)
-        {
-            heights[i] = NO_DATA_VALUE;
-        }
-        GDALRasterBand* band = static_cast<GDALRasterBand*>(GDALGetRasterBand(tileDS, 1));
-        band->RasterIO(GF_Read, 0, 0, tileSize, tileSize, heights, tileSize, tileSize, GDT_Float32, 0, 0);
-
+        // Read straight into the heightfield, bottom row first (see createHeightField)
         hf = new osg::HeightField();
         hf->allocate(tileSize, tileSize);
-        for (unsigned int c = 0; c < tileSize; c++)
+
+        std::vector<float>& heightList = hf->getHeightList();
+        std::fill(heightList.begin(), heightList.end(), NO_DATA_VALUE);
+
+        GDALRasterBand* band = static_cast<GDALRasterBand*>(GDALGetRasterBand(tileDS, 1));
+        band->RasterIO(GF_Read, 0, 0, tileSize, tileSize, &heightList[(tileSize - 1) * tileSize], tileSize, tileSize, GDT_Float32, 0, -(int)(tileSize * sizeof(float)));
+
+        for (auto& h : heightList)
         {
-            for (unsigned int r = 0; r < tileSize; r++)
+            if (!isValidValue(h, band))
             {
-                unsigned inv_r = tileSize - r - 1;
-                float h = heights[r * tileSize + c];
-                if (!isValidValue(h, band))
-                {
-                    h = NO_DATA_VALUE;
-                }
-                hf->setHeight(c, inv_r, h);
+                h = NO_DATA_VALUE;
             }
         }
 
-        delete[] heights;
-
         // Close the dataset
         if (tileDS != NULL)
         {
@@ -1697,6 +2041,7 @@ GDAL::Options::readFrom(const Config& conf)
     _useVRT.init(false);
     coverageUsesPaletteIndex().setDefault(true);
     singleThreaded().setDefault(false);
+    blockCacheSize().setDefault(32u);
 
     conf.get("url", _url);
     conf.get("connection", _connection);
@@ -1710,6 +2055,7 @@ GDAL::Options::readFrom(const Config& conf)
     conf.get("interpolation", "cubicspline", _interpolation, osgEarth::INTERP_CUBICSPLINE);
     conf.get("coverage_uses_palette_index", coverageUsesPaletteIndex());
     conf.get("single_threaded", singleThreaded());
+    conf.get("block_cache_size", blockCacheSize());
 }
 
 void
@@ -1727,6 +2073,7 @@ GDAL::Options::writeTo(Config& conf) const
     conf.set("interpolation", "cubicspline", _interpolation, osgEarth::INTERP_CUBICSPLINE);
     conf.set("coverage_uses_palette_index", coverageUsesPaletteIndex());
     conf.set("single_threaded", singleThreaded());
+    conf.set("block_cache_size", blockCacheSize());
 }
 
 //......................................................................
@@ -1764,6 +2111,8 @@ namespace
             driver->setOverrideProfile(layer->overrideProfile().get());
         }
 
+        driver->setBlockCache(layer->blockCache());
+
         Status status = driver->open(
             layer->getName(),
             layer->options(),
@@ -1829,6 +2178,10 @@ GDALImageLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     unsigned id = getSingleThreaded() ? 0u : Threading::getCurrentThreadId();
 
     osg::ref_ptr<const Profile> profile;
@@ -1839,6 +2192,10 @@ GDALImageLayer::openImplementation()
 
     ScopedMutexLock lock(_driversMutex);
 
+    // decoded blocks are shared by all the per-thread drivers
+    if (options().blockCacheSize() > 0u)
+        _blockCache = std::make_shared<GDAL::BlockCache>((std::size_t)options().blockCacheSize().get() * 1024u * 1024u);
+
     osg::ref_ptr<GDAL::Driver>& driver = _drivers[id];
 
     Status s = openOnThisThread(
@@ -1863,6 +2220,7 @@ GDALImageLayer::closeImplementation()
     // safely shut down all per-thread handles.
     Threading::ScopedMutexLock lock(_driversMutex);
     _drivers.clear();
+    _blockCache = nullptr;
     dataExtents().clear();
     setProfile(nullptr); // must do this to support override profiles
     return ImageLayer::closeImplementation();
@@ -1973,6 +2331,10 @@ GDALElevationLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     unsigned id = getSingleThreaded() ? 0u : Threading::getCurrentThreadId();
 
     osg::ref_ptr<const Profile> profile;
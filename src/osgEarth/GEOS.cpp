@@ -20,6 +20,7 @@
 
 #include <osgEarth/GEOS>
 #include <osg/Notify>
+#include <cstdarg>
 
 using namespace osgEarth;
 
@@ -30,6 +31,34 @@ using namespace osgEarth;
 
 namespace
 {
+    static void OSGEARTH_GEOSErrorHandler(const char *fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        char buffer[512];
+        vsprintf(buffer, fmt, args);
+        OE_DEBUG << " [GEOS Error] " << buffer << std::endl;
+        va_end(args);
+    }
+
+    static void OSGEARTH_WarningHandler(const char *fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        char buffer[512];
+        vsprintf(buffer, fmt, args);
+        OE_DEBUG << " [GEOS Warning] " << buffer << std::endl;
+        va_end(args);
+    }
+
+    // finishes the thread's context when the thread exits
+    struct ThreadContext
+    {
+        GEOSContextHandle_t _handle;
+        ThreadContext() : _handle(GEOS::createContext()) { }
+        ~ThreadContext() { finishGEOS_r(_handle); }
+    };
+
     GEOSCoordSequence*
         vec3dArray2CoordSeq(GEOSContextHandle_t handle, const Geometry* input, bool close)
     {
@@ -303,5 +332,18 @@ Geometry* GEOS::exportGeometry(GEOSContextHandle_t handle, const GEOSGeometry* i
     }
 }
 
+GEOSContextHandle_t
+GEOS::createContext()
+{
+    return initGEOS_r(OSGEARTH_WarningHandler, OSGEARTH_GEOSErrorHandler);
+}
+
+GEOSContextHandle_t
+GEOS::getThreadContext()
+{
+    thread_local ThreadContext t_context;
+    return t_context._handle;
+}
+
 #endif // OSGEARTH_HAVE_GEOS
 
@@ -868,6 +868,13 @@ GLFunctions::get(unsigned contextID)
         osg::setGLExtensionFuncPtr(f.glMultiDrawElementsIndirect, "glMultiDrawElementsIndirect", "glMultiDrawElementsIndirectARB");
         osg::setGLExtensionFuncPtr(f.glDispatchComputeIndirect, "glDispatchComputeIndirect", "glDispatchComputeIndirectARB");
         osg::setGLExtensionFuncPtr(f.glTexStorage3D, "glTexStorage3D", "glTexStorage3DARB");
+        osg::setGLExtensionFuncPtr(f.glIsTextureHandleResident, "glIsTextureHandleResidentARB");
+        osg::setGLExtensionFuncPtr(f.glDrawElementsBaseVertex, "glDrawElementsBaseVertex", "glDrawElementsBaseVertexARB");
+        osg::setGLExtensionFuncPtr(f.glDrawElementsIndirect, "glDrawElementsIndirect", "glDrawElementsIndirectARB");
+        osg::setGLExtensionFuncPtr(f.glDrawArraysIndirect, "glDrawArraysIndirect", "glDrawArraysIndirectARB");
+        osg::setGLExtensionFuncPtr(f.glFenceSync, "glFenceSync");
+        osg::setGLExtensionFuncPtr(f.glClientWaitSync, "glClientWaitSync");
+        osg::setGLExtensionFuncPtr(f.glDeleteSync, "glDeleteSync");
     }
     return f;
 }
\ No newline at end of file
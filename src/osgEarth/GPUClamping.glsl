@@ -6,6 +6,7 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma vp_order      0.5
 #pragma import_defines(OE_CLAMP_HAS_ATTRIBUTES)
 #pragma import_defines(OE_IS_GEOCENTRIC)
+#pragma import_defines(OE_CLAMP_CASCADE)
 #pragma include GPUClamping.lib.glsl
 
 #ifdef OE_CLAMP_HAS_ATTRIBUTES
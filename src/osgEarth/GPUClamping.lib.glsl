@@ -9,11 +9,29 @@ uniform mat4 oe_clamp_cameraView2depthClip;
 // matrix transform from depth-tecture clip space to view space
 uniform mat4 oe_clamp_depthClip2cameraView;
 
+#ifdef OE_CLAMP_CASCADE
+// sharper capture of the area under the eye, same view as the one above
+uniform sampler2D oe_clamp_nearDepthTex;
+uniform mat4 oe_clamp_cameraView2nearClip;
+uniform mat4 oe_clamp_nearClip2cameraView;
+#endif
+
 // Given a vertex in view space, clamp it to the "ground" as represented
 // by an orthographic depth texture. Return the clamped vertex in view space,
 // along with the associated depth value.
 void oe_getClampedViewVertex(in vec4 vertView, out vec4 out_clampedVertView, out float out_depth)
 {
+#ifdef OE_CLAMP_CASCADE
+    // use the near capture wherever it covers the vertex (ortho, so w == 1)
+    vec4 vertNearClip = oe_clamp_cameraView2nearClip * vertView;
+    if (all(greaterThan(vertNearClip.xy, vec2(0.0))) && all(lessThan(vertNearClip.xy, vec2(1.0))))
+    {
+        out_depth = textureProj( oe_clamp_nearDepthTex, vertNearClip ).r;
+        out_clampedVertView = oe_clamp_nearClip2cameraView * vec4(vertNearClip.x, vertNearClip.y, out_depth, 1.0);
+        return;
+    }
+#endif
+
     // transform the vertex into the depth texture's clip coordinates.
     vec4 vertDepthClip = oe_clamp_cameraView2depthClip * vertView;
 
@@ -0,0 +1,294 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GPUElevationSampler>
+#include <osgEarth/GLUtils>
+#include <osgEarth/Map>
+#include <osgEarth/Progress>
+#include <osgEarth/ShaderLoader>
+#include <osgEarth/Shaders>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[GPUElevationSampler] "
+
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+
+// must match ElevationSampler.CS.glsl
+#define WORK_GROUP_SIZE 64u
+#define MAX_WORK_GROUPS_X 65535u
+
+namespace
+{
+    // keep me vec4-aligned (std430)
+    struct TileData {
+        GLint offset;
+        GLint cols;
+        GLint rows;
+        GLint pad;
+    };
+
+    // keep me vec4-aligned (std430)
+    struct PointData {
+        GLfloat u;
+        GLfloat v;
+        GLint tile;
+        GLint pad;
+    };
+}
+
+struct GPUElevationSampler::Batch
+{
+    std::vector<osg::Vec4d> _points;
+    std::vector<GLfloat> _heights;
+    std::vector<TileData> _tiles;
+    std::vector<PointData> _pointData; // padded to whole work groups
+    GLuint _groupsX, _groupsY;
+
+    //! Same sampling as the compute shader, for when it can't run
+    void sampleOnCPU()
+    {
+        for (unsigned i = 0; i < _points.size(); ++i)
+        {
+            const PointData& p = _pointData[i];
+            if (p.tile < 0)
+                continue;
+
+            const TileData& tile = _tiles[p.tile];
+
+            double s = osg::clampBetween((double)p.u, 0.0, 1.0) * (double)(tile.cols - 1);
+            double t = osg::clampBetween((double)p.v, 0.0, 1.0) * (double)(tile.rows - 1);
+            int s0 = (int)floor(s), t0 = (int)floor(t);
+            int s1 = std::min(s0 + 1, tile.cols - 1), t1 = std::min(t0 + 1, tile.rows - 1);
+            double smix = s1 > s0 ? s - (double)s0 : 0.0;
+            double tmix = t1 > t0 ? t - (double)t0 : 0.0;
+
+            const GLfloat* h = &_heights[tile.offset];
+            double bot = h[t0*tile.cols + s0] * (1.0 - smix) + h[t0*tile.cols + s1] * smix;
+            double top = h[t1*tile.cols + s0] * (1.0 - smix) + h[t1*tile.cols + s1] * smix;
+            _points[i].z() = bot * (1.0 - tmix) + top * tmix;
+        }
+    }
+};
+
+GPUElevationSampler::GPUElevationSampler(const Map* map) :
+    _map(map),
+    _minGPUBatchSize(4096u),
+    _computeSupported(-1)
+{
+    Shaders package;
+    std::string source = ShaderLoader::load(package.ElevationSampler, package);
+    _program = new osg::Program();
+    _program->setName("GPUElevationSampler");
+    _program->addShader(new osg::Shader(osg::Shader::COMPUTE, source));
+}
+
+Future<std::vector<osg::Vec4d>>
+GPUElevationSampler::sample(
+    const std::vector<osg::Vec4d>& points,
+    ElevationPool::WorkingSet* ws,
+    ProgressCallback* progress)
+{
+    Promise<std::vector<osg::Vec4d>> promise;
+
+    osg::ref_ptr<const Map> map;
+    if (!_map.lock(map) || map->getProfile() == nullptr || points.empty())
+    {
+        promise.resolve(points);
+        return promise.getFuture();
+    }
+
+    ElevationPool* pool = map->getElevationPool();
+
+    // not worth the round trip, or no way to make it
+    if (points.size() < _minGPUBatchSize || _computeSupported == 0)
+    {
+        std::vector<osg::Vec4d> output(points);
+        pool->sampleMapCoords(output, ws, progress);
+        promise.resolve(output);
+        return promise.getFuture();
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->_points = points;
+
+    // lay out the work groups, padding the points to fill them
+    GLuint numGroups = ((GLuint)points.size() + WORK_GROUP_SIZE - 1u) / WORK_GROUP_SIZE;
+    batch->_groupsX = std::min(numGroups, MAX_WORK_GROUPS_X);
+    batch->_groupsY = (numGroups + batch->_groupsX - 1u) / batch->_groupsX;
+
+    PointData noData = { 0.0f, 0.0f, -1, 0 };
+    batch->_pointData.assign(batch->_groupsX * batch->_groupsY * WORK_GROUP_SIZE, noData);
+
+    // gather the tiles on this thread; only the sampling goes to the GPU
+    {
+        pool->sync(map.get(), ws);
+        ScopedAtomicCounter counter(pool->_workers);
+
+        std::vector<ElevationPool::TileBucket> buckets;
+        pool->bucketMapCoords(batch->_points, map.get(), buckets);
+
+        for (auto& bucket : buckets)
+        {
+            if (progress && progress->isCanceled())
+            {
+                promise.resolve(points);
+                return promise.getFuture();
+            }
+
+            osg::ref_ptr<ElevationTexture> raster = pool->getOrCreateRaster(
+                bucket._key,
+                map.get(),
+                true,
+                ws,
+                progress);
+
+            const osg::HeightField* hf = raster.valid() ? raster->getHeightField() : nullptr;
+
+            if (hf == nullptr)
+            {
+                for (auto i : bucket._points)
+                    batch->_points[i].z() = NO_DATA_VALUE;
+                continue;
+            }
+
+            TileData tile;
+            tile.offset = (GLint)batch->_heights.size();
+            tile.cols = (GLint)hf->getNumColumns();
+            tile.rows = (GLint)hf->getNumRows();
+            tile.pad = 0;
+
+            const osg::FloatArray* hfHeights = hf->getFloatArray();
+            batch->_heights.insert(batch->_heights.end(), hfHeights->begin(), hfHeights->end());
+
+            GLint tileIndex = (GLint)batch->_tiles.size();
+            batch->_tiles.push_back(tile);
+
+            const GeoExtent& ex = raster->getExtent();
+            for (auto i : bucket._points)
+            {
+                PointData& p = batch->_pointData[i];
+                p.u = (GLfloat)((batch->_points[i].x() - ex.xMin()) / ex.width());
+                p.v = (GLfloat)((batch->_points[i].y() - ex.yMin()) / ex.height());
+                p.tile = tileIndex;
+            }
+        }
+    }
+
+    if (batch->_tiles.empty())
+    {
+        promise.resolve(batch->_points);
+        return promise.getFuture();
+    }
+
+    osg::ref_ptr<const GPUElevationSampler> self(this);
+
+    return GPUJob<std::vector<osg::Vec4d>>::dispatch(
+        [self, batch](osg::State* state, Cancelable* cancelable)
+        {
+            if (cancelable == nullptr || !cancelable->isCanceled())
+            {
+                if (!self->runCompute(*state, *batch))
+                {
+                    batch->sampleOnCPU();
+                }
+            }
+            return batch->_points;
+        }
+    );
+}
+
+bool
+GPUElevationSampler::runCompute(osg::State& state, Batch& batch) const
+{
+    osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+
+    if (_computeSupported < 0)
+    {
+        _computeSupported = ext->glDispatchCompute != nullptr ? 1 : 0;
+        if (_computeSupported == 0)
+        {
+            OE_INFO << LC << "No compute shader support; sampling on the CPU" << std::endl;
+        }
+    }
+
+    if (_computeSupported == 0)
+        return false;
+
+    osg::Program::PerContextProgram* pcp = _program->getPCP(state);
+    if (pcp->needsLink())
+    {
+        pcp->linkProgram(state);
+    }
+
+    if (!pcp->isLinked())
+    {
+        OE_WARN << LC << "Compute program failed to link; sampling on the CPU" << std::endl;
+        _computeSupported = 0;
+        return false;
+    }
+
+    const GLsizeiptr numPoints = (GLsizeiptr)batch._pointData.size();
+
+    osg::ref_ptr<GLBuffer> heights = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.elevsampler.heights");
+    ext->glBufferData(GL_SHADER_STORAGE_BUFFER, batch._heights.size() * sizeof(GLfloat), batch._heights.data(), GL_STREAM_DRAW);
+
+    osg::ref_ptr<GLBuffer> tiles = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.elevsampler.tiles");
+    ext->glBufferData(GL_SHADER_STORAGE_BUFFER, batch._tiles.size() * sizeof(TileData), batch._tiles.data(), GL_STREAM_DRAW);
+
+    osg::ref_ptr<GLBuffer> pointData = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.elevsampler.points");
+    ext->glBufferData(GL_SHADER_STORAGE_BUFFER, numPoints * sizeof(PointData), batch._pointData.data(), GL_STREAM_DRAW);
+
+    osg::ref_ptr<GLBuffer> results = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.elevsampler.results");
+    ext->glBufferData(GL_SHADER_STORAGE_BUFFER, numPoints * sizeof(GLfloat), nullptr, GL_STREAM_READ);
+
+    pcp->useProgram();
+
+    ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, heights->name());
+    ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, tiles->name());
+    ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, pointData->name());
+    ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, results->name());
+
+    ext->glDispatchCompute(batch._groupsX, batch._groupsY, 1);
+
+    // results are read back through glGetBufferSubData
+    ext->glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    std::vector<GLfloat> output(numPoints);
+    results->bind();
+    ext->glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numPoints * sizeof(GLfloat), output.data());
+    ext->glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Put back whatever program was active without telling osg::State it ever changed.
+    const osg::Program::PerContextProgram* last = state.getLastAppliedProgramObject();
+    if (last)
+        last->useProgram();
+    else
+        ext->glUseProgram(0);
+
+    for (unsigned i = 0; i < batch._points.size(); ++i)
+    {
+        if (batch._pointData[i].tile >= 0)
+            batch._points[i].z() = output[i];
+    }
+
+    return true;
+}
@@ -0,0 +1,226 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GPUTimer>
+#include <osgEarth/Stats>
+#include <osgEarth/Metrics>
+#include <osg/GLExtensions>
+#include <cstdlib>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[GPUTimer] "
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+// Stop issuing queries if this many are waiting for results,
+// which means the GPU (or the driver) has stopped answering.
+#define MAX_PENDING 1024u
+
+namespace
+{
+    bool s_enabled = ::getenv("OSGEARTH_GPU_TIMERS") != nullptr;
+
+    struct PassStats
+    {
+        Stats::Timer* _timer;
+        std::string _plotName;
+    };
+
+    struct Query
+    {
+        GLuint _begin, _end;
+        PassStats* _pass;
+        bool _ended;
+    };
+
+    // Queries of one graphics context. Only its draw thread touches it.
+    struct ContextTimers
+    {
+        std::vector<GLuint> _free;
+        std::deque<Query> _pending;     // in begin order
+        std::vector<Query*> _open;      // nested passes; NULL = not timed
+        std::unordered_map<std::string, PassStats> _passes;
+
+        GLuint allocate(osg::GLExtensions* ext)
+        {
+            if (_free.empty())
+            {
+                GLuint ids[16];
+                ext->glGenQueries(16, ids);
+                _free.insert(_free.end(), ids, ids + 16);
+            }
+            GLuint id = _free.back();
+            _free.pop_back();
+            return id;
+        }
+
+        PassStats* getPass(const std::string& name)
+        {
+            auto i = _passes.find(name);
+            if (i == _passes.end())
+            {
+                PassStats& pass = _passes[name];
+                pass._timer = &Stats::timer("osgearth_gpu_pass", "pass=\"" + name + "\"");
+                pass._plotName = "GPU " + name + " (ms)";
+                return &pass;
+            }
+            return &i->second;
+        }
+
+        // Records the results the GPU has finished, oldest first
+        void collect(osg::GLExtensions* ext)
+        {
+            while (!_pending.empty() && _pending.front()._ended)
+            {
+                Query& q = _pending.front();
+
+                GLint available = 0;
+                ext->glGetQueryObjectiv(q._end, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available)
+                    break;
+
+                GLuint64 t0 = 0, t1 = 0;
+                ext->glGetQueryObjectui64v(q._begin, GL_QUERY_RESULT, &t0);
+                ext->glGetQueryObjectui64v(q._end, GL_QUERY_RESULT, &t1);
+
+                std::uint64_t ns = t1 > t0 ? (std::uint64_t)(t1 - t0) : 0u;
+                q._pass->_timer->record(std::chrono::nanoseconds(ns));
+                OE_PROFILING_PLOT(q._pass->_plotName.c_str(), (float)(1e-6 * (double)ns));
+
+                _free.push_back(q._begin);
+                _free.push_back(q._end);
+                _pending.pop_front();
+            }
+        }
+    };
+
+    ContextTimers s_contexts[256];
+
+    osg::GLExtensions* getExtensions(osg::State& state)
+    {
+        osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+        return ext && ext->glQueryCounter && ext->glGetQueryObjectui64v ? ext : nullptr;
+    }
+
+    struct BeginCameraPass : public osg::Camera::DrawCallback
+    {
+        std::string _pass;
+        BeginCameraPass(const std::string& pass) : _pass(pass) { }
+        void operator()(osg::RenderInfo& ri) const override
+        {
+            GPUTimer::begin(*ri.getState(), _pass);
+        }
+    };
+
+    struct EndCameraPass : public osg::Camera::DrawCallback
+    {
+        void operator()(osg::RenderInfo& ri) const override
+        {
+            GPUTimer::end(*ri.getState());
+        }
+    };
+}
+
+bool
+GPUTimer::enabled()
+{
+    return s_enabled;
+}
+
+void
+GPUTimer::setEnabled(bool value)
+{
+    s_enabled = value;
+}
+
+void
+GPUTimer::begin(osg::State& state, const std::string& pass)
+{
+    ContextTimers& timers = s_contexts[state.getContextID() & 0xff];
+
+    osg::GLExtensions* ext = enabled() ? getExtensions(state) : nullptr;
+    if (!ext)
+    {
+        timers._open.push_back(nullptr);
+        return;
+    }
+
+    timers.collect(ext);
+
+    if (timers._pending.size() >= MAX_PENDING)
+    {
+        timers._open.push_back(nullptr);
+        return;
+    }
+
+    Query q;
+    q._begin = timers.allocate(ext);
+    q._end = timers.allocate(ext);
+    q._pass = timers.getPass(pass);
+    q._ended = false;
+    ext->glQueryCounter(q._begin, GL_TIMESTAMP);
+
+    timers._pending.push_back(q);
+    timers._open.push_back(&timers._pending.back());
+}
+
+void
+GPUTimer::end(osg::State& state)
+{
+    ContextTimers& timers = s_contexts[state.getContextID() & 0xff];
+    if (timers._open.empty())
+        return;
+
+    Query* q = timers._open.back();
+    timers._open.pop_back();
+
+    if (q)
+    {
+        osg::GLExtensions* ext = getExtensions(state);
+        if (ext)
+            ext->glQueryCounter(q->_end, GL_TIMESTAMP);
+        q->_ended = true;
+    }
+}
+
+void
+GPUTimer::install(osg::Camera* camera, const std::string& pass)
+{
+    if (camera &&
+        camera->getPreDrawCallback() == nullptr &&
+        camera->getPostDrawCallback() == nullptr)
+    {
+        camera->setPreDrawCallback(new BeginCameraPass(pass));
+        camera->setPostDrawCallback(new EndCameraPass());
+    }
+}
@@ -18,12 +18,19 @@
  */
 
 #include <osgEarth/GeoData>
+#include <osgEarth/RasterPool>
 #include <osgEarth/GeoMath>
 #include <osgEarth/HeightFieldUtils>
 #include <osgEarth/Registry>
 #include <osgEarth/Terrain>
 #include <osgEarth/GDAL>
 #include <osgEarth/Metrics>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OE_GEODATA_SSE2
+#include <emmintrin.h>
+#endif
 
 using namespace osgEarth;
 
@@ -1877,64 +1884,28 @@ GeoImage::crop( const GeoExtent& extent, bool exact, unsigned int width, unsigne
 
 namespace
 {
-    osg::Image* manualReproject(
-        const osg::Image* image, 
-        const GeoExtent&  src_extent, 
-        const GeoExtent&  dest_extent,
-        bool              interpolate,
-        unsigned int      width = 0, 
-        unsigned int      height = 0)
+    // Samples the source image at each point of the reprojected grid and
+    // writes the result into the destination. Templated on the reader and
+    // writer so the common formats get inlined pixel access; PixelReader
+    // and PixelWriter handle everything else.
+    template<class READER, class WRITER>
+    void reprojectSamples(
+        const READER&       ia,
+        WRITER&             writer,
+        const osg::Image*   image,
+        const GeoExtent&    src_extent,
+        const double*       srcPointsX,
+        const double*       srcPointsY,
+        unsigned int        width,
+        unsigned int        height,
+        bool                interpolate)
     {
-        OE_PROFILING_ZONE;
-
-        if (width == 0 || height == 0)
-        {
-            //If no width and height are specified, just use the minimum dimension for the image
-            width = osg::minimum(image->s(), image->t());
-            height = osg::minimum(image->s(), image->t());
-        }
-
-        osg::Image *result = new osg::Image();
-        //result->allocateImage(width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
-        result->allocateImage(width, height, image->r(), image->getPixelFormat(), image->getDataType()); //GL_UNSIGNED_BYTE);
-        result->setInternalTextureFormat(image->getInternalTextureFormat());
-
-        //Initialize the image to be completely transparent/black
-        memset(result->data(), 0, result->getImageSizeInBytes());
-
-        //ImageUtils::PixelReader ra(result);
-        ImageUtils::PixelWriter writer(result);
-        const double dx = dest_extent.width() / (double)width;
-        const double dy = dest_extent.height() / (double)height;
-
-        // offset the sample points by 1/2 a pixel so we are sampling "pixel center".
-        // (This is especially useful in the UnifiedCubeProfile since it nullifes the chances for
-        // edge ambiguity.)
-
-        unsigned int numPixels = width * height;
-
-        // Start by creating a sample grid over the destination
-        // extent. These will be the source coordinates. Then, reproject
-        // the sample grid into the source coordinate system.
-        double *srcPointsX = new double[numPixels * 2];
-        double *srcPointsY = srcPointsX + numPixels;
-
-        dest_extent.getSRS()->transformExtentPoints(
-            src_extent.getSRS(),
-            dest_extent.xMin() + .5 * dx, dest_extent.yMin() + .5 * dy,
-            dest_extent.xMax() - .5 * dx, dest_extent.yMax() - .5 * dy,
-            srcPointsX, srcPointsY, width, height);
-
-        ImageUtils::PixelReader ia(image);
         osg::Vec4 color;
         osg::Vec4 urColor;
         osg::Vec4 llColor;
         osg::Vec4 ulColor;
         osg::Vec4 lrColor;
 
-        double xfac = (image->s() - 1) / src_extent.width();
-        double yfac = (image->t() - 1) / src_extent.height();
-
         for (int depth = 0; depth < image->r(); depth++)
         {
            // Next, go through the source-SRS sample grid, read the color at each point from the source image,
@@ -2033,6 +2004,87 @@ namespace
               }
            }
         }
+    }
+
+    osg::Image* manualReproject(
+        const osg::Image* image, 
+        const GeoExtent&  src_extent, 
+        const GeoExtent&  dest_extent,
+        bool              interpolate,
+        unsigned int      width = 0, 
+        unsigned int      height = 0)
+    {
+        OE_PROFILING_ZONE;
+
+        if (width == 0 || height == 0)
+        {
+            //If no width and height are specified, just use the minimum dimension for the image
+            width = osg::minimum(image->s(), image->t());
+            height = osg::minimum(image->s(), image->t());
+        }
+
+        osg::Image *result = RasterPool::createImage(width, height, image->r(), image->getPixelFormat(), image->getDataType());
+        result->setInternalTextureFormat(image->getInternalTextureFormat());
+
+        //Initialize the image to be completely transparent/black
+        memset(result->data(), 0, result->getImageSizeInBytes());
+
+        const double dx = dest_extent.width() / (double)width;
+        const double dy = dest_extent.height() / (double)height;
+
+        // offset the sample points by 1/2 a pixel so we are sampling "pixel center".
+        // (This is especially useful in the UnifiedCubeProfile since it nullifes the chances for
+        // edge ambiguity.)
+
+        unsigned int numPixels = width * height;
+
+        // Start by creating a sample grid over the destination
+        // extent. These will be the source coordinates. Then, reproject
+        // the sample grid into the source coordinate system.
+        double *srcPointsX = new double[numPixels * 2];
+        double *srcPointsY = srcPointsX + numPixels;
+
+        dest_extent.getSRS()->transformExtentPoints(
+            src_extent.getSRS(),
+            dest_extent.xMin() + .5 * dx, dest_extent.yMin() + .5 * dy,
+            dest_extent.xMax() - .5 * dx, dest_extent.yMax() - .5 * dy,
+            srcPointsX, srcPointsY, width, height);
+
+        typedef ImageUtils::TypedPixelReader<GL_RGBA, GLubyte> RGBA8Reader;
+        typedef ImageUtils::TypedPixelWriter<GL_RGBA, GLubyte> RGBA8Writer;
+        typedef ImageUtils::TypedPixelReader<GL_RGB, GLubyte> RGB8Reader;
+        typedef ImageUtils::TypedPixelWriter<GL_RGB, GLubyte> RGB8Writer;
+        typedef ImageUtils::TypedPixelReader<GL_RED, GLfloat> R32FReader;
+        typedef ImageUtils::TypedPixelWriter<GL_RED, GLfloat> R32FWriter;
+        typedef ImageUtils::TypedPixelReader<GL_LUMINANCE, GLfloat> L32FReader;
+        typedef ImageUtils::TypedPixelWriter<GL_LUMINANCE, GLfloat> L32FWriter;
+
+        // the result has the same format as the source, so one check covers both
+        if (RGBA8Reader::supports(image))
+        {
+            RGBA8Writer writer(result);
+            reprojectSamples(RGBA8Reader(image), writer, image, src_extent, srcPointsX, srcPointsY, width, height, interpolate);
+        }
+        else if (RGB8Reader::supports(image))
+        {
+            RGB8Writer writer(result);
+            reprojectSamples(RGB8Reader(image), writer, image, src_extent, srcPointsX, srcPointsY, width, height, interpolate);
+        }
+        else if (R32FReader::supports(image))
+        {
+            R32FWriter writer(result);
+            reprojectSamples(R32FReader(image), writer, image, src_extent, srcPointsX, srcPointsY, width, height, interpolate);
+        }
+        else if (L32FReader::supports(image))
+        {
+            L32FWriter writer(result);
+            reprojectSamples(L32FReader(image), writer, image, src_extent, srcPointsX, srcPointsY, width, height, interpolate);
+        }
+        else
+        {
+            ImageUtils::PixelWriter writer(result);
+            reprojectSamples(ImageUtils::PixelReader(image), writer, image, src_extent, srcPointsX, srcPointsY, width, height, interpolate);
+        }
 
         delete[] srcPointsX;
 
@@ -2040,6 +2092,248 @@ namespace
     }
 }
 
+namespace
+{
+    // Linear interpolation helpers for the separable mercator warp.
+    // 8-bit data uses 8-bit fixed point weights; float data interpolates
+    // directly.
+    template<typename T> struct RowLerp;
+
+    template<> struct RowLerp<GLubyte>
+    {
+        typedef unsigned Weight;
+
+        static Weight weight(double f) {
+            return (Weight)(f*256.0 + 0.5);
+        }
+
+        static GLubyte lerp(GLubyte a, GLubyte b, Weight w) {
+            return (GLubyte)((a*(256u-w) + b*w + 128u) >> 8);
+        }
+
+        static void lerpRow(const GLubyte* a, const GLubyte* b, Weight w, GLubyte* out, unsigned n)
+        {
+            unsigned i = 0;
+#ifdef OE_GEODATA_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i wb = _mm_set1_epi16((short)w);
+            const __m128i wa = _mm_set1_epi16((short)(256u-w));
+            const __m128i half = _mm_set1_epi16(128);
+            for (; i + 16 <= n; i += 16)
+            {
+                __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+                __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+
+                // the sums stay below 65536 so 16-bit unsigned math is exact
+                __m128i lo = _mm_add_epi16(
+                    _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                    _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+                __m128i hi = _mm_add_epi16(
+                    _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                    _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+
+                _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+            }
+#endif
+            for (; i < n; ++i)
+                out[i] = lerp(a[i], b[i], w);
+        }
+    };
+
+    template<> struct RowLerp<GLfloat>
+    {
+        typedef float Weight;
+
+        static Weight weight(double f) {
+            return (float)f;
+        }
+
+        static GLfloat lerp(GLfloat a, GLfloat b, Weight w) {
+            return a + (b-a)*w;
+        }
+
+        static void lerpRow(const GLfloat* a, const GLfloat* b, Weight w, GLfloat* out, unsigned n)
+        {
+            for (unsigned i = 0; i < n; ++i)
+                out[i] = lerp(a[i], b[i], w);
+        }
+    };
+
+    // Where one destination row or column samples the source: the two
+    // neighboring source pixels and the weight of the second.
+    struct WarpTap
+    {
+        int i0, i1;
+        double frac;
+        bool valid;
+    };
+
+    // Maps a source pixel-space coordinate (pixel centers at +0.5) to a tap,
+    // clamping to the edge pixels.
+    inline void makeTap(double p, int size, bool interpolate, WarpTap& tap)
+    {
+        if (!interpolate)
+        {
+            tap.i0 = tap.i1 = osg::clampBetween((int)floor(p + 0.5), 0, size-1);
+            tap.frac = 0.0;
+        }
+        else
+        {
+            double f = floor(p);
+            int i = (int)f;
+            tap.frac = p - f;
+            tap.i0 = osg::clampBetween(i, 0, size-1);
+            tap.i1 = osg::clampBetween(i+1, 0, size-1);
+            if (tap.i0 == tap.i1)
+                tap.frac = 0.0;
+        }
+    }
+
+    template<typename T>
+    void warpSeparable(
+        const osg::Image* image,
+        osg::Image* result,
+        unsigned comps,
+        const std::vector<WarpTap>& cols,
+        const std::vector<WarpTap>& rows,
+        bool identityCols)
+    {
+        typedef RowLerp<T> Lerp;
+
+        const unsigned srcComps = image->s() * comps;
+        const unsigned pixelBytes = comps * sizeof(T);
+        std::vector<T> blended(srcComps);
+
+        for (unsigned r = 0; r < rows.size(); ++r)
+        {
+            const WarpTap& row = rows[r];
+            if (!row.valid)
+                continue;
+
+            T* out = reinterpret_cast<T*>(result->data(0, r));
+
+            // vertical pass: blend the two source rows into one
+            const T* src = reinterpret_cast<const T*>(image->data(0, row.i0));
+            typename Lerp::Weight wy = Lerp::weight(row.frac);
+            if (wy != 0)
+            {
+                const T* src1 = reinterpret_cast<const T*>(image->data(0, row.i1));
+                Lerp::lerpRow(src, src1, wy, &blended[0], srcComps);
+                src = &blended[0];
+            }
+
+            // horizontal pass
+            if (identityCols)
+            {
+                ::memcpy(out, src, srcComps * sizeof(T));
+                continue;
+            }
+
+            for (unsigned c = 0; c < cols.size(); ++c)
+            {
+                const WarpTap& col = cols[c];
+                if (!col.valid)
+                    continue;
+
+                T* pixel = out + c*comps;
+                typename Lerp::Weight wx = Lerp::weight(col.frac);
+                if (wx == 0)
+                {
+                    ::memcpy(pixel, src + col.i0*comps, pixelBytes);
+                }
+                else
+                {
+                    const T* p0 = src + col.i0*comps;
+                    const T* p1 = src + col.i1*comps;
+                    for (unsigned k = 0; k < comps; ++k)
+                        pixel[k] = Lerp::lerp(p0[k], p1[k], wx);
+                }
+            }
+        }
+    }
+
+    // Spherical mercator to geodetic reprojection. Longitude maps linearly
+    // to mercator X and latitude maps to Y independently of longitude, so
+    // the warp is separable: one lookup table for columns, one for rows,
+    // and no per-pixel SRS transforms. Returns NULL if the image isn't in a
+    // layout this handles, in which case the caller takes the general path.
+    osg::Image* reprojectMercatorToGeodetic(
+        const osg::Image* image,
+        const GeoExtent&  src_extent,
+        const GeoExtent&  dest_extent,
+        bool              interpolate,
+        unsigned int      width,
+        unsigned int      height)
+    {
+        if (image->r() != 1 || image->isCompressed())
+            return 0L;
+
+        GLenum dataType = image->getDataType();
+        unsigned typeSize =
+            dataType == GL_UNSIGNED_BYTE ? sizeof(GLubyte) :
+            dataType == GL_FLOAT ? sizeof(GLfloat) :
+            0u;
+
+        unsigned pixelBytes = image->getPixelSizeInBits() / 8;
+        if (typeSize == 0u || pixelBytes == 0u || pixelBytes % typeSize != 0u)
+            return 0L;
+
+        unsigned comps = pixelBytes / typeSize;
+
+        OE_PROFILING_ZONE;
+
+        if (width == 0 || height == 0)
+        {
+            width = image->s();
+            height = image->t();
+        }
+
+        osg::Image* result = RasterPool::createImage(width, height, 1, image->getPixelFormat(), dataType);
+        result->setInternalTextureFormat(image->getInternalTextureFormat());
+
+        //Initialize the image to be completely transparent/black
+        memset(result->data(), 0, result->getImageSizeInBytes());
+
+        const double R = src_extent.getSRS()->getEllipsoid()->getRadiusEquator();
+        const double dx = dest_extent.width() / (double)width;
+        const double dy = dest_extent.height() / (double)height;
+
+        // source pixel space, with pixel centers at half-pixel offsets
+        const double sx = (double)image->s() / src_extent.width();
+        const double sy = (double)image->t() / src_extent.height();
+
+        std::vector<WarpTap> cols(width);
+        bool identityCols = (width == (unsigned)image->s());
+        for (unsigned c = 0; c < width; ++c)
+        {
+            double x = osg::DegreesToRadians(dest_extent.xMin() + ((double)c + 0.5)*dx) * R;
+            cols[c].valid = x >= src_extent.xMin() && x <= src_extent.xMax();
+            makeTap((x - src_extent.xMin())*sx - 0.5, image->s(), interpolate, cols[c]);
+            identityCols = identityCols && cols[c].valid && cols[c].i0 == (int)c && cols[c].frac < 1e-6;
+        }
+
+        std::vector<WarpTap> rows(height);
+        for (unsigned r = 0; r < height; ++r)
+        {
+            double lat = osg::DegreesToRadians(dest_extent.yMin() + ((double)r + 0.5)*dy);
+            lat = osg::clampBetween(lat, -osg::PI_2 + 1e-9, osg::PI_2 - 1e-9);
+            double y = R * log(tan(osg::PI_4 + 0.5*lat));
+            rows[r].valid = y >= src_extent.yMin() && y <= src_extent.yMax();
+            makeTap((y - src_extent.yMin())*sy - 0.5, image->t(), interpolate, rows[r]);
+        }
+
+        if (dataType == GL_UNSIGNED_BYTE)
+            warpSeparable<GLubyte>(image, result, comps, cols, rows, identityCols);
+        else
+            warpSeparable<GLfloat>(image, result, comps, cols, rows, identityCols);
+
+        return result;
+    }
+}
+
 GeoImage
 GeoImage::reproject(const SpatialReference* to_srs, const GeoExtent* to_extent, unsigned int width, unsigned int height, bool useBilinearInterpolation) const
 {  
@@ -2054,23 +2348,35 @@ GeoImage::reproject(const SpatialReference* to_srs, const GeoExtent* to_extent,
     }
 
     osg::Image* resultImage = 0L;
-    if (getSRS()->isUserDefined() || to_srs->isUserDefined() || getImage()->r() > 1)
+
+    // Spherical mercator to geodetic is by far the most common case
+    // (web basemaps on a geodetic map), and is separable.
+    if (getSRS()->isSphericalMercator() && to_srs->isHorizEquivalentTo(getSRS()->getGeographicSRS()))
     {
-        // if either of the SRS is a custom projection or it is a 3D image, we have to do a manual reprojection since
-        // GDAL will not recognize the SRS and does not handle 3D images.
-        resultImage = manualReproject(getImage(), getExtent(), destExtent, useBilinearInterpolation, width, height);
+        resultImage = reprojectMercatorToGeodetic(getImage(), getExtent(), destExtent, useBilinearInterpolation, width, height);
     }
-    else
+
+    if (resultImage == 0L)
     {
-        // otherwise use GDAL.
-        resultImage = osgEarth::GDAL::reprojectImage(
-            getImage(),
-            getSRS()->getWKT(),
-            getExtent().xMin(), getExtent().yMin(), getExtent().xMax(), getExtent().yMax(),
-            to_srs->getWKT(),
-            destExtent.xMin(), destExtent.yMin(), destExtent.xMax(), destExtent.yMax(),
-            width, height, useBilinearInterpolation);
-    }   
+        if (getSRS()->isUserDefined() || to_srs->isUserDefined() || getImage()->r() > 1)
+        {
+            // if either of the SRS is a custom projection or it is a 3D image, we have to do a manual reprojection since
+            // GDAL will not recognize the SRS and does not handle 3D images.
+            resultImage = manualReproject(getImage(), getExtent(), destExtent, useBilinearInterpolation, width, height);
+        }
+        else
+        {
+            // otherwise use GDAL.
+            resultImage = osgEarth::GDAL::reprojectImage(
+                getImage(),
+                getSRS()->getWKT(),
+                getExtent().xMin(), getExtent().yMin(), getExtent().xMax(), getExtent().yMax(),
+                to_srs->getWKT(),
+                destExtent.xMin(), destExtent.yMin(), destExtent.xMax(), destExtent.yMax(),
+                width, height, useBilinearInterpolation);
+        }
+    }
+
     return GeoImage(resultImage, destExtent);
 }
 
@@ -0,0 +1,715 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GeoJSON>
+#include <osgEarth/HTTPClient>
+#include <osgEarth/Registry>
+#include <osgEarth/Cache>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Threading>
+#include <osgEarth/Metrics>
+
+#include <rapidjson/reader.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/error/en.h>
+
+#include <condition_variable>
+#include <deque>
+#include <limits>
+
+#define LC "[GeoJSON] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // Nested coordinate arrays; which geometry they make depends
+    // on the "type", which may come before or after them.
+    struct Coords
+    {
+        std::vector<double> _values;
+        std::vector<Coords> _children;
+
+        osg::Vec3d point() const
+        {
+            return osg::Vec3d(
+                _values.size() > 0 ? _values[0] : 0.0,
+                _values.size() > 1 ? _values[1] : 0.0,
+                _values.size() > 2 ? _values[2] : 0.0);
+        }
+
+        template<typename T>
+        T* points(T* output) const
+        {
+            output->reserve(_children.size());
+            for (auto& c : _children)
+                output->push_back(c.point());
+            return output;
+        }
+    };
+
+    struct GeometryState
+    {
+        std::string _type;
+        Coords _coords;
+        std::vector<osg::ref_ptr<Geometry> > _components; // of a GeometryCollection
+    };
+
+    Polygon* createPolygon(const Coords& rings, bool rewindPolygons)
+    {
+        if (rings._children.empty())
+            return 0L;
+
+        Polygon* output = rings._children.front().points(new Polygon());
+        if (rewindPolygons)
+        {
+            output->open();
+            output->rewind(Ring::ORIENTATION_CCW);
+        }
+
+        for (unsigned i = 1; i < rings._children.size(); ++i)
+        {
+            Ring* hole = rings._children[i].points(new Ring());
+            if (rewindPolygons)
+            {
+                hole->open();
+                hole->rewind(Ring::ORIENTATION_CW);
+            }
+            output->getHoles().push_back(hole);
+        }
+        return output;
+    }
+
+    // Same mapping as OgrUtils::createGeometry.
+    Geometry* createGeometry(GeometryState& g, bool rewindPolygons)
+    {
+        const Coords& c = g._coords;
+
+        if (g._type == "Point")
+        {
+            if (c._values.empty())
+                return 0L;
+            Point* output = new Point(1);
+            output->push_back(c.point());
+            return output;
+        }
+        else if (g._type == "MultiPoint")
+        {
+            return c.points(new PointSet());
+        }
+        else if (g._type == "LineString")
+        {
+            return c.points(new LineString());
+        }
+        else if (g._type == "Polygon")
+        {
+            return createPolygon(c, rewindPolygons);
+        }
+        else if (g._type == "MultiLineString")
+        {
+            MultiGeometry* output = new MultiGeometry();
+            for (auto& line : c._children)
+                output->getComponents().push_back(line.points(new LineString()));
+            return output;
+        }
+        else if (g._type == "MultiPolygon")
+        {
+            MultiGeometry* output = new MultiGeometry();
+            for (auto& rings : c._children)
+            {
+                Polygon* polygon = createPolygon(rings, rewindPolygons);
+                if (polygon)
+                    output->getComponents().push_back(polygon);
+            }
+            return output;
+        }
+        else if (g._type == "GeometryCollection")
+        {
+            MultiGeometry* output = new MultiGeometry();
+            output->getComponents().swap(g._components);
+            return output;
+        }
+
+        return 0L;
+    }
+
+    /**
+     * SAX handler that builds Features. Keeps only the feature being read,
+     * so memory use doesn't depend on the size of the document.
+     */
+    class FeatureHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, FeatureHandler>
+    {
+    public:
+        FeatureHandler(const FeatureProfile* profile, bool rewindPolygons, FeatureList& output) :
+            _srs(profile ? profile->getSRS() : 0L),
+            _profile(profile),
+            _rewindPolygons(rewindPolygons),
+            _output(output),
+            _count(0),
+            _hasGeometry(false),
+            _jsonDepth(0)
+        {
+            //nop
+        }
+
+        bool Null()
+        {
+            if (top() == CX_PROPERTY_JSON) return _json.Null();
+            if (top() == CX_PROPERTIES) _feature->setNull(_key);
+            return true;
+        }
+
+        bool Bool(bool b)
+        {
+            if (top() == CX_PROPERTY_JSON) return _json.Bool(b);
+            if (top() == CX_PROPERTIES) _feature->set(_key, b);
+            return true;
+        }
+
+        bool Int(int i) { return Int64(i); }
+        bool Uint(unsigned u) { return Int64(u); }
+
+        bool Int64(int64_t i)
+        {
+            switch (top())
+            {
+            case CX_PROPERTY_JSON: return _json.Int64(i);
+            case CX_PROPERTIES: _feature->set(_key, (long long)i); break;
+            case CX_COORDINATES: _coords.back()->_values.push_back((double)i); break;
+            case CX_FEATURE: if (_key == "id") _fid = (FeatureID)i; break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool Uint64(uint64_t u)
+        {
+            if (u <= (uint64_t)std::numeric_limits<long long>::max())
+                return Int64((int64_t)u);
+            if (top() == CX_PROPERTY_JSON)
+                return _json.Uint64(u);
+            return Double((double)u);
+        }
+
+        bool Double(double d)
+        {
+            switch (top())
+            {
+            case CX_PROPERTY_JSON: return _json.Double(d);
+            case CX_PROPERTIES: _feature->set(_key, d); break;
+            case CX_COORDINATES: _coords.back()->_values.push_back(d); break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool String(const char* str, rapidjson::SizeType length, bool copy)
+        {
+            switch (top())
+            {
+            case CX_PROPERTY_JSON: return _json.String(str, length, copy);
+            case CX_PROPERTIES: _feature->set(_key, std::string(str, length)); break;
+            case CX_GEOMETRY: if (_key == "type") _geoms.back()._type.assign(str, length); break;
+            case CX_FEATURE: if (_key == "id") _fid = as<FeatureID>(std::string(str, length), _fid); break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, bool copy)
+        {
+            if (top() == CX_PROPERTY_JSON)
+                return _json.Key(str, length, copy);
+
+            if (top() == CX_PROPERTIES)
+                _key = toLower(std::string(str, length));
+            else
+                _key.assign(str, length);
+            return true;
+        }
+
+        bool StartObject()
+        {
+            switch (top())
+            {
+            case CX_NONE:
+                // the document: a FeatureCollection, or a Feature itself
+                beginFeature();
+                push(CX_FEATURE);
+                break;
+            case CX_FEATURES:
+                beginFeature();
+                push(CX_FEATURE);
+                break;
+            case CX_FEATURE:
+                if (!_feature.valid()) push(CX_SKIP); // a collection's own members
+                else if (_key == "geometry") beginGeometry();
+                else if (_key == "properties") push(CX_PROPERTIES);
+                else push(CX_SKIP);
+                break;
+            case CX_GEOMETRIES:
+                beginGeometry();
+                break;
+            case CX_PROPERTIES:
+                beginJSONValue();
+                return _json.StartObject();
+            case CX_PROPERTY_JSON:
+                ++_jsonDepth;
+                return _json.StartObject();
+            default:
+                push(CX_SKIP);
+                break;
+            }
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType memberCount)
+        {
+            if (top() == CX_PROPERTY_JSON)
+                return _json.EndObject(memberCount) && endJSONContainer();
+
+            Context cx = top();
+            pop();
+
+            if (cx == CX_FEATURE)
+            {
+                // a collection isn't a feature, but a lone Feature is
+                if (top() == CX_FEATURES || _hasGeometry)
+                    endFeature();
+            }
+            else if (cx == CX_GEOMETRY)
+            {
+                endGeometry();
+            }
+            return true;
+        }
+
+        bool StartArray()
+        {
+            switch (top())
+            {
+            case CX_FEATURE:
+                if (_key == "features" && _stack.size() == 1) push(CX_FEATURES);
+                else push(CX_SKIP);
+                break;
+            case CX_GEOMETRY:
+                if (_key == "coordinates")
+                {
+                    _coords.assign(1, &_geoms.back()._coords);
+                    push(CX_COORDINATES);
+                }
+                else if (_key == "geometries") push(CX_GEOMETRIES);
+                else push(CX_SKIP);
+                break;
+            case CX_COORDINATES:
+                _coords.back()->_children.emplace_back();
+                _coords.push_back(&_coords.back()->_children.back());
+                push(CX_COORDINATES);
+                break;
+            case CX_PROPERTIES:
+                beginJSONValue();
+                return _json.StartArray();
+            case CX_PROPERTY_JSON:
+                ++_jsonDepth;
+                return _json.StartArray();
+            default:
+                push(CX_SKIP);
+                break;
+            }
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType elementCount)
+        {
+            if (top() == CX_PROPERTY_JSON)
+                return _json.EndArray(elementCount) && endJSONContainer();
+
+            if (top() == CX_COORDINATES)
+                _coords.pop_back();
+
+            pop();
+            return true;
+        }
+
+    private:
+        enum Context
+        {
+            CX_NONE,
+            CX_FEATURE,         // a Feature, or the top-level object
+            CX_FEATURES,        // the "features" array
+            CX_PROPERTIES,
+            CX_PROPERTY_JSON,   // object or array value of a property
+            CX_GEOMETRY,
+            CX_GEOMETRIES,      // members of a GeometryCollection
+            CX_COORDINATES,
+            CX_SKIP
+        };
+
+        const SpatialReference* _srs;
+        const FeatureProfile* _profile;
+        bool _rewindPolygons;
+        FeatureList& _output;
+        unsigned _count;
+
+        std::vector<Context> _stack;
+        std::string _key;
+
+        osg::ref_ptr<Feature> _feature;
+        FeatureID _fid;
+        bool _hasGeometry;
+
+        std::vector<GeometryState> _geoms;
+        std::vector<Coords*> _coords;
+
+        // properties that are objects or arrays are kept as JSON strings, like OGR does
+        rapidjson::StringBuffer _jsonBuffer;
+        rapidjson::Writer<rapidjson::StringBuffer> _json;
+        std::string _jsonKey;
+        unsigned _jsonDepth;
+
+        Context top() const { return _stack.empty() ? CX_NONE : _stack.back(); }
+        void push(Context cx) { _stack.push_back(cx); }
+        void pop() { _stack.pop_back(); }
+
+        void beginFeature()
+        {
+            _feature = new Feature(0L, _srs);
+            if (_profile && _profile->geoInterp().isSet())
+                _feature->geoInterp() = _profile->geoInterp().get();
+
+            // same as OGR: use the "id" if there is one, otherwise the index
+            _fid = (FeatureID)_count;
+            _hasGeometry = false;
+        }
+
+        void endFeature()
+        {
+            _feature->setFID(_fid);
+            _output.push_back(_feature.get());
+            _feature = 0L;
+            _hasGeometry = false;
+            ++_count;
+        }
+
+        void beginGeometry()
+        {
+            _geoms.emplace_back();
+            push(CX_GEOMETRY);
+        }
+
+        void endGeometry()
+        {
+            osg::ref_ptr<Geometry> geom = createGeometry(_geoms.back(), _rewindPolygons);
+            _geoms.pop_back();
+
+            if (!_geoms.empty())
+            {
+                if (geom.valid())
+                    _geoms.back()._components.push_back(geom.get());
+            }
+            else if (_feature.valid())
+            {
+                _feature->setGeometry(geom.get());
+                _hasGeometry = true;
+            }
+        }
+
+        void beginJSONValue()
+        {
+            _jsonBuffer.Clear();
+            _json.Reset(_jsonBuffer);
+            _jsonKey = _key;
+            _jsonDepth = 0;
+            push(CX_PROPERTY_JSON);
+        }
+
+        bool endJSONContainer()
+        {
+            if (_jsonDepth > 0)
+            {
+                --_jsonDepth;
+            }
+            else
+            {
+                pop();
+                _feature->set(_jsonKey, std::string(_jsonBuffer.GetString(), _jsonBuffer.GetSize()));
+            }
+            return true;
+        }
+    };
+
+    template<typename STREAM>
+    bool parse(STREAM& stream, const FeatureProfile* profile, bool rewindPolygons, FeatureList& output, std::string& error)
+    {
+        FeatureHandler handler(profile, rewindPolygons, output);
+        rapidjson::Reader reader;
+        rapidjson::ParseResult ok = reader.Parse(stream, handler);
+        if (!ok)
+        {
+            error = Stringify()
+                << rapidjson::GetParseError_En(ok.Code()) << " at offset " << ok.Offset();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Response data passed from the HTTP I/O thread to the parsing thread.
+     */
+    struct ChunkQueue
+    {
+        Threading::Mutex _mutex;
+        std::condition_variable_any _ready;
+        std::deque<std::string> _chunks;
+        bool _receivedData;
+        bool _aborted;
+        bool _done;
+        HTTPResponse _response;
+
+        ChunkQueue() : _receivedData(false), _aborted(false), _done(false) { }
+
+        // on the I/O thread:
+        bool push(const char* data, size_t size)
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            if (_aborted)
+                return false;
+            _chunks.emplace_back(data, size);
+            _receivedData = true;
+            _ready.notify_all();
+            return true;
+        }
+
+        void finish(const HTTPResponse& response)
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            _response = response;
+
+            // an implementation that didn't stream leaves the body in the response
+            if (!_receivedData && !_aborted && response.isOK() && response.getNumParts() > 0)
+                _chunks.emplace_back(response.getPartAsString(0));
+
+            _done = true;
+            _ready.notify_all();
+        }
+
+        // on the parsing thread:
+        bool pop(std::string& output)
+        {
+            std::unique_lock<Threading::Mutex> lock(_mutex);
+            _ready.wait(lock, [this]() { return !_chunks.empty() || _done; });
+            if (_chunks.empty())
+                return false;
+            output.swap(_chunks.front());
+            _chunks.pop_front();
+            return true;
+        }
+
+        void abort()
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            _aborted = true;
+            _chunks.clear();
+        }
+
+        HTTPResponse wait()
+        {
+            std::unique_lock<Threading::Mutex> lock(_mutex);
+            _ready.wait(lock, [this]() { return _done; });
+            return _response;
+        }
+    };
+
+    //! rapidjson input stream that reads chunks from the queue as they arrive
+    struct ChunkStream
+    {
+        typedef char Ch;
+
+        ChunkStream(ChunkQueue& queue) : _queue(queue), _pos(0), _count(0) { }
+
+        Ch Peek()
+        {
+            return (_pos < _chunk.size() || next()) ? _chunk[_pos] : '\0';
+        }
+
+        Ch Take()
+        {
+            if (_pos < _chunk.size() || next())
+            {
+                ++_count;
+                return _chunk[_pos++];
+            }
+            return '\0';
+        }
+
+        size_t Tell() const { return _count; }
+
+        // read-only
+        Ch* PutBegin() { RAPIDJSON_ASSERT(false); return 0; }
+        void Put(Ch) { RAPIDJSON_ASSERT(false); }
+        void Flush() { RAPIDJSON_ASSERT(false); }
+        size_t PutEnd(Ch*) { RAPIDJSON_ASSERT(false); return 0; }
+
+    private:
+        ChunkQueue& _queue;
+        std::string _chunk;
+        size_t _pos;
+        size_t _count;
+
+        bool next()
+        {
+            _pos = 0;
+            _chunk.clear();
+            while (_queue.pop(_chunk))
+            {
+                if (!_chunk.empty())
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    // Whether a URI can be fetched directly; anything else goes through URI::readString.
+    bool canStream(const URI& uri, const osgDB::Options* readOptions)
+    {
+        const osgDB::Options* localOptions = readOptions ? readOptions : Registry::instance()->getDefaultOptions();
+
+        if (uri.empty() ||
+            !uri.isRemote() ||
+            uri.optionString().isSet() ||
+            Registry::instance()->getURIReadCallback() != 0L ||
+            URIAliasMap::from(localOptions) != 0L ||
+            URIResultCache::from(localOptions) != 0L ||
+            Registry::instance()->isBlacklisted(uri.full()))
+        {
+            return false;
+        }
+
+        // let the cache see the whole response
+        CacheSettings* cacheSettings = CacheSettings::get(localOptions);
+        if (cacheSettings && cacheSettings->isCacheEnabled())
+        {
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool
+GeoJSON::readFeatures(const char*           data,
+                      std::size_t           length,
+                      const FeatureProfile* profile,
+                      bool                  rewindPolygons,
+                      FeatureList&          features)
+{
+    OE_PROFILING_ZONE;
+
+    rapidjson::MemoryStream stream(data, length);
+    std::string error;
+    if (!parse(stream, profile, rewindPolygons, features, error))
+    {
+        OE_WARN << LC << "Failed to parse GeoJSON: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ReadResult
+GeoJSON::readFeatures(const URI&            uri,
+                      const FeatureProfile* profile,
+                      bool                  rewindPolygons,
+                      FeatureList&          features,
+                      const osgDB::Options* readOptions,
+                      ProgressCallback*     progress)
+{
+    OE_PROFILING_ZONE;
+
+    if (!canStream(uri, readOptions))
+    {
+        ReadResult r = uri.readString(readOptions, progress);
+        if (r.succeeded())
+        {
+            const std::string& buffer = r.getString();
+            if (!readFeatures(buffer.data(), buffer.size(), profile, rewindPolygons, features))
+            {
+                features.clear();
+                ReadResult error(ReadResult::RESULT_READER_ERROR);
+                error.setMetadata(r.metadata());
+                return error;
+            }
+        }
+        return r;
+    }
+
+    std::shared_ptr<ChunkQueue> queue = std::make_shared<ChunkQueue>();
+
+    HTTPRequest request(uri.full());
+    request.getHeaders() = uri.context().getHeaders();
+    request.setDataCallback([queue](const char* data, size_t size)
+    {
+        return queue->push(data, size);
+    });
+
+    HTTPClient::getAsync(request, readOptions, progress, [queue](const HTTPResponse& response)
+    {
+        queue->finish(response);
+    });
+
+    // parse on this thread while the I/O thread keeps downloading
+    ChunkStream stream(*queue);
+    std::string error;
+    bool parsed = parse(stream, profile, rewindPolygons, features, error);
+
+    // no point reading the rest
+    if (!parsed)
+        queue->abort();
+
+    HTTPResponse response = queue->wait();
+
+    ReadResult result(
+        response.isCanceled() ? ReadResult::RESULT_CANCELED :
+        response.getCode() == HTTPResponse::NOT_FOUND ? ReadResult::RESULT_NOT_FOUND :
+        response.getCodeCategory() == HTTPResponse::CATEGORY_SERVER_ERROR ? ReadResult::RESULT_SERVER_ERROR :
+        !response.isOK() ? ReadResult::RESULT_UNKNOWN_ERROR :
+        !parsed ? ReadResult::RESULT_READER_ERROR :
+        ReadResult::RESULT_OK);
+
+    if (result.code() != ReadResult::RESULT_OK)
+    {
+        features.clear();
+
+        if (result.code() == ReadResult::RESULT_READER_ERROR)
+        {
+            OE_WARN << LC << "Failed to parse GeoJSON from " << uri.full() << ": " << error << std::endl;
+        }
+        else if (HTTPClient::isRecoverable(result.code()) && progress)
+        {
+            // same as a blocking read: let the caller try again later
+            progress->setRetryDelay(HTTPClient::getRetryDelay());
+            progress->cancel();
+        }
+    }
+
+    result.setMetadata(response.getHeadersAsConfig());
+    result.setLastModifiedTime(response.getLastModified());
+    return result;
+}
@@ -149,6 +149,42 @@ GeoPositionNode::setPosition(const GeoPoint& pos)
     _geoxform->setPosition(pos);
 }
 
+unsigned
+GeoPositionNode::setPositions(GeoPositionNode* const* nodes, const GeoPoint* positions, unsigned count)
+{
+    std::vector<GeoTransform*> xforms;
+    std::vector<GeoPoint> points;
+    xforms.reserve(count);
+    points.reserve(count);
+
+    unsigned numSet = 0u;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        GeoPositionNode* node = nodes[i];
+        if (node == nullptr)
+            continue;
+
+        if (node->supportsBatchPositions())
+        {
+            xforms.push_back(node->_geoxform);
+            points.push_back(positions[i]);
+        }
+        else
+        {
+            node->setPosition(positions[i]);
+            ++numSet;
+        }
+    }
+
+    if (!xforms.empty())
+    {
+        numSet += GeoTransform::setPositions(&xforms[0], &points[0], xforms.size());
+    }
+
+    return numSet;
+}
+
 bool
 GeoPositionNode::getOcclusionCulling() const
 {
@@ -19,9 +19,15 @@
 #include <osgEarth/GeoTransform>
 #include <osgEarth/MapNode>
 #include <osgEarth/NodeUtils>
+#include <osgEarth/Threading>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 
 #define LC "[GeoTransform] "
 
+#define ARENA_GEOTRANSFORM "oe.geotransform"
+
 #define OE_TEST OE_DEBUG
 
 using namespace osgEarth;
@@ -97,14 +103,58 @@ GeoTransform::getPosition() const
     return _position;
 }
 
-bool
-GeoTransform::setPosition(const GeoPoint& position)
+namespace
 {
-    if ( !position.isValid() )
-        return false;
+    // Positions per parallel chunk in setPositions
+    const unsigned CHUNK_SIZE = 256u;
+
+    JobArena* getGeoTransformArena()
+    {
+        static JobArena* arena = []()
+        {
+            JobArena::setConcurrency(ARENA_GEOTRANSFORM, Threading::getConcurrency());
+            return JobArena::get(ARENA_GEOTRANSFORM);
+        }();
+        return arena;
+    }
+
+    bool computeLocalToWorld(const GeoPoint& position, Terrain* terrain, osg::Matrixd& local2world)
+    {
+        GeoPoint p;
+
+        // transform into terrain SRS if neccesary:
+        if (terrain && !terrain->getSRS()->isEquivalentTo(position.getSRS()))
+        {
+            p = position.transform(terrain->getSRS());
+        }
+        else
+        {
+            p = position;
+        }
+
+        // bail if the transformation failed:
+        if ( !p.isValid() )
+        {
+            OE_TEST << LC << "setPosition failed condition 2\n";
+            return false;
+        }
+
+        // Convert the point to an absolute Z if necessry. If we don't have
+        // a terrain, skip and hope for the best.
+        if (terrain)
+        {
+            p.makeAbsolute(terrain);
+        }
 
-    bool result = true;
+        // Finally, assemble the matrix from our position point.
+        p.createLocalToWorld( local2world );
+        return true;
+    }
+}
 
+osg::ref_ptr<Terrain>
+GeoTransform::acceptPosition(const GeoPoint& position)
+{
     _position = position;
 
     // relative Z or reprojection require a terrain:
@@ -119,32 +169,6 @@ GeoTransform::setPosition(const GeoPoint& position)
         ADJUST_UPDATE_TRAV_COUNT(this, +1);
     }
 
-    GeoPoint p;
-
-    // transform into terrain SRS if neccesary:
-    if (terrain.valid() && !terrain->getSRS()->isEquivalentTo(position.getSRS()))
-    {
-        p = position.transform(terrain->getSRS());
-    }
-    else
-    {
-        p = position;
-    }
-
-    // bail if the transformation failed:
-    if ( !p.isValid() )
-    {
-        OE_TEST << LC << "setPosition failed condition 2\n";
-        return false;
-    }
-
-    // Convert the point to an absolute Z if necessry. If we don't have
-    // a terrain, skip and hope for the best.
-    if (terrain.valid())
-    {
-        result = p.makeAbsolute(terrain.get()) && result;
-    }
-
     // Is this is a relative-Z position, we need to install a terrain callback
     // so we can recompute the altitude when new terrain tiles become available.
     if (_position.altitudeMode() == ALTMODE_RELATIVE &&
@@ -157,14 +181,127 @@ GeoTransform::setPosition(const GeoPoint& position)
         _terrainCallbackInstalled = true;
     }
 
-    // Finally, assemble the matrix from our position point.
+    return terrain;
+}
+
+bool
+GeoTransform::setPosition(const GeoPoint& position)
+{
+    if ( !position.isValid() )
+        return false;
+
+    osg::ref_ptr<Terrain> terrain = acceptPosition(position);
+
     osg::Matrixd local2world;
-    p.createLocalToWorld( local2world );
-    this->setMatrix( local2world );
+    if (!computeLocalToWorld(position, terrain.get(), local2world))
+        return false;
 
+    this->setMatrix( local2world );
     return true;
 }
 
+unsigned
+GeoTransform::setPositions(GeoTransform* const* xforms, const GeoPoint* positions, unsigned count)
+{
+    struct Work
+    {
+        std::vector<unsigned> _indices;
+        std::vector<osg::ref_ptr<Terrain>> _terrains;
+        std::vector<osg::Matrixd> _matrices;
+        std::vector<char> _ok;
+        const GeoPoint* _positions;
+        std::atomic<unsigned> _next;
+        std::atomic<unsigned> _done;
+        unsigned _numChunks;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _finished;
+
+        void work()
+        {
+            for (;;)
+            {
+                unsigned c = _next++;
+                if (c >= _numChunks)
+                    break;
+
+                unsigned end = osg::minimum((c + 1u) * CHUNK_SIZE, (unsigned)_indices.size());
+                for (unsigned i = c * CHUNK_SIZE; i < end; ++i)
+                {
+                    _ok[i] = computeLocalToWorld(_positions[_indices[i]], _terrains[i].get(), _matrices[i]);
+                }
+
+                if (++_done == _numChunks)
+                {
+                    Threading::ScopedMutexLock lock(_mutex);
+                    _finished.notify_all();
+                }
+            }
+        }
+    };
+
+    std::shared_ptr<Work> w = std::make_shared<Work>();
+    w->_positions = positions;
+    w->_indices.reserve(count);
+    w->_terrains.reserve(count);
+
+    unsigned numSet = 0u;
+
+    // Bookkeeping happens here, in order; absolute positions are
+    // queued for the parallel pass and relative ones are done now,
+    // since resolving them queries the terrain.
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (xforms[i] == nullptr || !positions[i].isValid())
+            continue;
+
+        if (positions[i].altitudeMode() != ALTMODE_ABSOLUTE)
+        {
+            if (xforms[i]->setPosition(positions[i]))
+                ++numSet;
+            continue;
+        }
+
+        w->_indices.push_back(i);
+        w->_terrains.push_back(xforms[i]->acceptPosition(positions[i]));
+    }
+
+    if (w->_indices.empty())
+        return numSet;
+
+    w->_matrices.resize(w->_indices.size());
+    w->_ok.resize(w->_indices.size(), 0);
+    w->_next = 0u;
+    w->_done = 0u;
+    w->_numChunks = (w->_indices.size() + CHUNK_SIZE - 1u) / CHUNK_SIZE;
+
+    // The calling thread works too, so a busy arena can't stall the frame.
+    JobArena* arena = getGeoTransformArena();
+    for (unsigned j = 0; j + 1u < w->_numChunks; ++j)
+    {
+        Job job(arena);
+        job.setName("oe.geotransform.chunk");
+        job.dispatch([w](Cancelable*) { w->work(); });
+    }
+
+    w->work();
+
+    {
+        std::unique_lock<Threading::Mutex> lock(w->_mutex);
+        w->_finished.wait(lock, [&w]() { return w->_done == w->_numChunks; });
+    }
+
+    for (unsigned i = 0; i < w->_indices.size(); ++i)
+    {
+        if (w->_ok[i])
+        {
+            xforms[w->_indices[i]]->setMatrix(w->_matrices[i]);
+            ++numSet;
+        }
+    }
+
+    return numSet;
+}
+
 void
 GeoTransform::onTileUpdate(const TileKey&          key,
                           osg::Node*              node,
@@ -19,11 +19,24 @@
 
 #include <osgEarth/Geoid>
 #include <osgEarth/HeightFieldUtils>
+#include <algorithm>
+#include <vector>
 
 #define LC "[Geoid] "
 
 using namespace osgEarth;
 
+namespace
+{
+    // Splits a normalized grid coordinate into a cell index and the
+    // blend weight within that cell, clamping to the grid's edges.
+    inline void findCell(double n, unsigned size, unsigned& index, float& weight)
+    {
+        double p = osg::clampBetween(n, 0.0, 1.0) * (double)(size - 1);
+        index = osg::minimum((unsigned)p, size - 2);
+        weight = (float)(p - (double)index);
+    }
+}
 
 Geoid::Geoid() :
 _units( Units::METERS ),
@@ -70,6 +83,10 @@ Geoid::validate()
     {
         OE_WARN << LC << "ILLEGAL GEOID: heightfield must be geodetic" << std::endl;
     }
+    else if ( _hf->getNumColumns() < 2 || _hf->getNumRows() < 2 )
+    {
+        OE_WARN << LC << "ILLEGAL GEOID: heightfield must be at least 2x2" << std::endl;
+    }
     else
     {
         _valid = true;
@@ -85,12 +102,86 @@ Geoid::getHeight(double lat_deg, double lon_deg, const RasterInterpolation& inte
     {
         double nlon = (lon_deg-_bounds.xMin())/_bounds.width();
         double nlat = (lat_deg-_bounds.yMin())/_bounds.height();
-        result = HeightFieldUtils::getHeightAtNormalizedLocation( _hf.get(), nlon, nlat, interp );
+
+        if ( interp == INTERP_BILINEAR )
+        {
+            unsigned c, r;
+            float s, t;
+            findCell(nlon, _hf->getNumColumns(), c, s);
+            findCell(nlat, _hf->getNumRows(), r, t);
+            float south = _hf->getHeight(c, r) + (_hf->getHeight(c+1, r) - _hf->getHeight(c, r)) * s;
+            float north = _hf->getHeight(c, r+1) + (_hf->getHeight(c+1, r+1) - _hf->getHeight(c, r+1)) * s;
+            result = south + (north - south) * t;
+        }
+        else
+        {
+            result = HeightFieldUtils::getHeightAtNormalizedLocation( _hf.get(), nlon, nlat, interp );
+        }
     }
 
     return result;
 }
 
+void
+Geoid::getHeights(double south_deg,
+                  double west_deg,
+                  double latInterval_deg,
+                  double lonInterval_deg,
+                  unsigned cols,
+                  unsigned rows,
+                  float* output) const
+{
+    if ( !_valid )
+    {
+        std::fill(output, output + cols*rows, 0.0f);
+        return;
+    }
+
+    const unsigned hfCols = _hf->getNumColumns();
+    const unsigned hfRows = _hf->getNumRows();
+    const float* heights = &_hf->getHeight(0, 0);
+
+    // cell and weight of every column, with a mask that zeroes the
+    // points outside the geoid the same way getHeight() does
+    std::vector<unsigned> cellCols(cols);
+    std::vector<float> weights(cols);
+    std::vector<float> masks(cols);
+    for (unsigned c = 0; c < cols; ++c)
+    {
+        double lon = west_deg + lonInterval_deg * (double)c;
+        findCell((lon - _bounds.xMin()) / _bounds.width(), hfCols, cellCols[c], weights[c]);
+        masks[c] = (lon >= _bounds.xMin() && lon <= _bounds.xMax()) ? 1.0f : 0.0f;
+    }
+
+    for (unsigned r = 0; r < rows; ++r)
+    {
+        float* out = output + r*cols;
+
+        double lat = south_deg + latInterval_deg * (double)r;
+        if (lat < _bounds.yMin() || lat > _bounds.yMax())
+        {
+            std::fill(out, out + cols, 0.0f);
+            continue;
+        }
+
+        unsigned cellRow;
+        float t;
+        findCell((lat - _bounds.yMin()) / _bounds.height(), hfRows, cellRow, t);
+
+        const float* south = heights + cellRow*hfCols;
+        const float* north = south + hfCols;
+
+        for (unsigned c = 0; c < cols; ++c)
+        {
+            unsigned i = cellCols[c];
+            float s = weights[c];
+            float h0 = south[i] + (south[i+1] - south[i]) * s;
+            float h1 = north[i] + (north[i+1] - north[i]) * s;
+            out[c] = (h0 + (h1 - h0) * t) * masks[c];
+        }
+    }
+}
+
 bool
 Geoid::isEquivalentTo( const Geoid& rhs ) const
 {
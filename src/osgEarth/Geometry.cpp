@@ -23,7 +23,6 @@
 #include <osgEarth/GEOS>
 #include <algorithm>
 #include <iterator>
-#include <cstdarg>
 
 using namespace osgEarth;
 
@@ -31,29 +30,6 @@ using namespace osgEarth;
 
 #define LC "[Geometry] "
 
-namespace
-{
-    static void OSGEARTH_GEOSErrorHandler(const char *fmt, ...)
-    {
-        va_list args;
-        va_start(args, fmt);
-        char buffer[512];
-        vsprintf(buffer, fmt, args);
-        OE_DEBUG << " [GEOS Error] " << buffer << std::endl;
-        va_end(args);
-    }
-
-    static void OSGEARTH_WarningHandler(const char *fmt, ...)
-    {
-        va_list args;
-        va_start(args, fmt);
-        char buffer[512];
-        vsprintf(buffer, fmt, args);
-        OE_DEBUG << " [GEOS Warning] " << buffer << std::endl;
-        va_end(args);
-    }
-}
-
 Geometry::Geometry( const Geometry& rhs ) :
 osgEarth::InlineVector<osg::Vec3d,osg::Referenced>( rhs )
 {
@@ -174,7 +150,7 @@ Geometry::buffer(double distance,
 {
 #ifdef OSGEARTH_HAVE_GEOS
 
-    GEOSContextHandle_t handle = initGEOS_r(OSGEARTH_WarningHandler, OSGEARTH_GEOSErrorHandler);
+    GEOSContextHandle_t handle = GEOS::getThreadContext();
 
     GEOSGeometry* inGeom = GEOS::importGeometry(handle, this);
     if (inGeom)
@@ -213,8 +189,6 @@ Geometry::buffer(double distance,
         GEOSGeom_destroy_r(handle, inGeom);
     }
 
-    finishGEOS_r(handle);
-
     return output.valid();
 
 #else // OSGEARTH_HAVE_GEOS
@@ -229,7 +203,7 @@ bool
 Geometry::crop( const Polygon* cropPoly, osg::ref_ptr<Geometry>& output ) const
 {
 #ifdef OSGEARTH_HAVE_GEOS
-    GEOSContextHandle_t handle = initGEOS_r(OSGEARTH_WarningHandler, OSGEARTH_GEOSErrorHandler);
+    GEOSContextHandle_t handle = GEOS::getThreadContext();
 
     bool success = false;
     output = 0L;
@@ -275,8 +249,6 @@ Geometry::crop( const Polygon* cropPoly, osg::ref_ptr<Geometry>& output ) const
     GEOSGeom_destroy_r(handle, cropGeom);
     GEOSGeom_destroy_r(handle, inGeom);
 
-    finishGEOS_r(handle);
-
     return success;
 
 #else // OSGEARTH_HAVE_GEOS
@@ -306,7 +278,7 @@ Geometry::geounion( const Geometry* other, osg::ref_ptr<Geometry>& output ) cons
     bool success = false;
     output = 0L;
 
-    GEOSContextHandle_t handle = initGEOS_r(OSGEARTH_WarningHandler, OSGEARTH_GEOSErrorHandler);
+    GEOSContextHandle_t handle = GEOS::getThreadContext();
 
     //Create the GEOS Geometries
     GEOSGeometry* inGeom = GEOS::importGeometry(handle, this);
@@ -346,8 +318,6 @@ Geometry::geounion( const Geometry* other, osg::ref_ptr<Geometry>& output ) cons
     GEOSGeom_destroy_r(handle, otherGeom );
     GEOSGeom_destroy_r(handle, inGeom );
 
-    finishGEOS_r(handle);
-
     return success;
 
 #else // OSGEARTH_HAVE_GEOS
@@ -363,7 +333,7 @@ Geometry::difference( const Polygon* diffPolygon, osg::ref_ptr<Geometry>& output
 {
 #ifdef OSGEARTH_HAVE_GEOS
 
-    GEOSContextHandle_t handle = initGEOS_r(OSGEARTH_WarningHandler, OSGEARTH_GEOSErrorHandler);
+    GEOSContextHandle_t handle = GEOS::getThreadContext();
 
     //Create the GEOS Geometries
     GEOSGeometry* inGeom = GEOS::importGeometry(handle, this);
@@ -388,8 +358,6 @@ Geometry::difference( const Polygon* diffPolygon, osg::ref_ptr<Geometry>& output
     GEOSGeom_destroy_r(handle, diffGeom);
     GEOSGeom_destroy_r(handle, inGeom);
 
-    finishGEOS_r(handle);
-
     return output.valid();
 
 #else // OSGEARTH_HAVE_GEOS
@@ -407,7 +375,7 @@ Geometry::intersects(
 {
 #ifdef OSGEARTH_HAVE_GEOS
 
-    GEOSContextHandle_t handle = initGEOS_r(OSGEARTH_WarningHandler, OSGEARTH_GEOSErrorHandler);
+    GEOSContextHandle_t handle = GEOS::getThreadContext();
 
     //Create the GEOS Geometries
     GEOSGeometry* inGeom = GEOS::importGeometry(handle, this);
@@ -419,8 +387,6 @@ Geometry::intersects(
     GEOSGeom_destroy_r(handle, inGeom);
     GEOSGeom_destroy_r(handle, otherGeom);
 
-    finishGEOS_r(handle);
-
     return intersects;
 
 #else // OSGEARTH_HAVE_GEOS
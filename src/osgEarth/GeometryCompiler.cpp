@@ -36,6 +36,9 @@
 #include <osgEarth/ShaderUtils>
 #include <osgEarth/Utils>
 #include <osgEarth/Metrics>
+#include <osgEarth/MeshConsolidator>
+#include <osgEarth/StateSetCache>
+#include <osgEarth/Threading>
 
 #include <osg/MatrixTransform>
 #include <osg/Timer>
@@ -43,9 +46,15 @@
 #include <osgUtil/Optimizer>
 
 #include <cstdlib>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <typeinfo>
 
 #define LC "[GeometryCompiler] "
 
+#define ARENA_GEOMETRY_COMPILER "oe.geometrycompiler"
+
 using namespace osgEarth;
 using namespace osgEarth::Util;
 using namespace osgEarth::Util;
@@ -76,7 +85,8 @@ _optimize              ( false ),
 _optimizeVertexOrdering( true ),
 _validate              ( false ),
 _maxPolyTilingAngle    ( 45.0f ),
-_useOSGTessellator     ( false )
+_useOSGTessellator     ( false ),
+_parallelChunkSize     ( 0u )
 {
     //nop
 }
@@ -96,7 +106,8 @@ _optimize              ( s_defaults.optimize().value() ),
 _optimizeVertexOrdering( s_defaults.optimizeVertexOrdering().value() ),
 _validate              ( s_defaults.validate().value() ),
 _maxPolyTilingAngle    ( s_defaults.maxPolygonTilingAngle().value() ),
-_useOSGTessellator     (s_defaults.useOSGTessellator().value())
+_useOSGTessellator     (s_defaults.useOSGTessellator().value()),
+_parallelChunkSize     ( s_defaults.parallelChunkSize().value() )
 {
     fromConfig(conf.getConfig());
 }
@@ -118,6 +129,7 @@ GeometryCompilerOptions::fromConfig( const Config& conf )
     conf.get( "validate", _validate );
     conf.get( "max_polygon_tiling_angle", _maxPolyTilingAngle );
     conf.get( "use_osg_tessellator", _useOSGTessellator);
+    conf.get( "parallel_chunk_size", _parallelChunkSize);
 
     conf.get( "shader_policy", "disable",  _shaderPolicy, SHADERPOLICY_DISABLE );
     conf.get( "shader_policy", "inherit",  _shaderPolicy, SHADERPOLICY_INHERIT );
@@ -142,6 +154,7 @@ GeometryCompilerOptions::getConfig() const
     conf.set( "validate", _validate );
     conf.set( "max_polygon_tiling_angle", _maxPolyTilingAngle );
     conf.set( "use_osg_tessellator", _useOSGTessellator);
+    conf.set( "parallel_chunk_size", _parallelChunkSize);
 
     conf.set( "shader_policy", "disable",  _shaderPolicy, SHADERPOLICY_DISABLE );
     conf.set( "shader_policy", "inherit",  _shaderPolicy, SHADERPOLICY_INHERIT );
@@ -217,32 +230,18 @@ GeometryCompiler::compile(FeatureCursor*        cursor,
     return compile(workingSet, style, context);
 }
 
-osg::Node*
-GeometryCompiler::compile(FeatureList&          workingSet,
-                          const Style&          style,
-                          const FilterContext&  context)
+osg::Group*
+GeometryCompiler::compileFeatures(FeatureList&             workingSet,
+                                  const Style&             style,
+                                  const FilterContext&     context,
+                                  std::vector<std::string>& history)
 {
-    OE_PROFILING_ZONE;
-
-#ifdef PROFILING
-    osg::Timer_t p_start = osg::Timer::instance()->tick();
-    unsigned p_features = workingSet.size();
-#endif
-
-    // for debugging/validation.
-    std::vector<std::string> history;
     bool trackHistory = (_options.validate() == true);
 
     osg::ref_ptr<osg::Group> resultGroup = new osg::Group();
 
-    // create a filter context that will track feature data through the process
     FilterContext sharedCX = context;
 
-    if ( !sharedCX.extent().isSet() && sharedCX.profile() )
-    {
-        sharedCX.extent() = sharedCX.profile()->getExtent();
-    }
-
     // ref_ptr's to hold defaults in case we need them.
     osg::ref_ptr<PointSymbol>   defaultPoint;
     osg::ref_ptr<LineSymbol>    defaultLine;
@@ -412,6 +411,8 @@ GeometryCompiler::compile(FeatureList&          workingSet,
         if ( _options.mergeGeometry().isSet() )
             extrude.setMergeGeometry( *_options.mergeGeometry() );
 
+        extrude.setUseOSGTessellator( *_options.useOSGTessellator() );
+
         osg::Node* node = extrude.push( workingSet, sharedCX );
         if ( node )
         {
@@ -486,6 +487,241 @@ GeometryCompiler::compile(FeatureList&          workingSet,
         }
     }
 
+    return resultGroup.release();
+}
+
+namespace
+{
+    JobArena* getCompilerArena()
+    {
+        static JobArena* arena = []()
+        {
+            JobArena::setConcurrency(ARENA_GEOMETRY_COMPILER, Threading::getConcurrency());
+            return JobArena::get(ARENA_GEOMETRY_COMPILER);
+        }();
+        return arena;
+    }
+
+    struct ChunkState
+    {
+        ChunkState(unsigned numChunks) :
+            _chunks(numChunks), _results(numChunks), _histories(numChunks),
+            _next(0u), _done(0u), _mutex("OE.GeometryCompiler.Chunks") { }
+
+        std::vector<FeatureList> _chunks;
+        std::vector<osg::ref_ptr<osg::Group> > _results;
+        std::vector<std::vector<std::string> > _histories;
+        std::function<void(unsigned)> _compile;
+        std::atomic<unsigned> _next;
+        std::atomic<unsigned> _done;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _finished;
+
+        void work()
+        {
+            for (;;)
+            {
+                unsigned i = _next++;
+                if (i >= _chunks.size())
+                    break;
+
+                _compile(i);
+
+                if (++_done == _chunks.size())
+                {
+                    Threading::ScopedMutexLock lock(_mutex);
+                    _finished.notify_all();
+                }
+            }
+        }
+    };
+
+    bool isPlain(const osg::Node* node)
+    {
+        return typeid(*node) == typeid(osg::Group) || typeid(*node) == typeid(osg::MatrixTransform);
+    }
+
+    bool isMergeable(const osg::Geode* geode)
+    {
+        if (typeid(*geode) != typeid(osg::Geode))
+            return false;
+        for (unsigned i = 0; i < geode->getNumDrawables(); ++i)
+            if (typeid(*geode->getDrawable(i)) != typeid(osg::Geometry))
+                return false;
+        return true;
+    }
+
+    // Folds together the subgraphs compiled from separate chunks: sibling groups
+    // and transforms that only differ by chunk become one, and sibling geodes
+    // with the same state have their geometry consolidated.
+    void mergeChunkResults(osg::Group* group)
+    {
+        for (unsigned i = 0; i < group->getNumChildren(); ++i)
+        {
+            osg::Node* first = group->getChild(i);
+
+            for (unsigned j = i + 1; j < group->getNumChildren(); )
+            {
+                osg::Node* other = group->getChild(j);
+                bool merged = false;
+
+                if (typeid(*first) == typeid(*other) && first->getStateSet() == other->getStateSet())
+                {
+                    osg::Geode* firstGeode = first->asGeode();
+                    osg::Geode* otherGeode = other->asGeode();
+
+                    if (firstGeode && otherGeode && isMergeable(firstGeode) && isMergeable(otherGeode))
+                    {
+                        for (unsigned d = 0; d < otherGeode->getNumDrawables(); ++d)
+                            firstGeode->addDrawable(otherGeode->getDrawable(d));
+                        merged = true;
+                    }
+
+                    else if (isPlain(first))
+                    {
+                        osg::MatrixTransform* firstXform = dynamic_cast<osg::MatrixTransform*>(first);
+                        osg::MatrixTransform* otherXform = dynamic_cast<osg::MatrixTransform*>(other);
+
+                        if (firstXform == nullptr || firstXform->getMatrix() == otherXform->getMatrix())
+                        {
+                            osg::Group* firstGroup = first->asGroup();
+                            osg::Group* otherGroup = other->asGroup();
+                            for (unsigned c = 0; c < otherGroup->getNumChildren(); ++c)
+                                firstGroup->addChild(otherGroup->getChild(c));
+                            merged = true;
+                        }
+                    }
+                }
+
+                if (merged)
+                    group->removeChild(j);
+                else
+                    ++j;
+            }
+
+            if (first->asGeode() && isMergeable(first->asGeode()))
+            {
+                MeshConsolidator::run(*first->asGeode());
+            }
+            else if (isPlain(first))
+            {
+                mergeChunkResults(first->asGroup());
+            }
+        }
+    }
+}
+
+osg::Group*
+GeometryCompiler::compileChunks(FeatureList&             workingSet,
+                                const Style&             style,
+                                const FilterContext&     context,
+                                unsigned                 numChunks,
+                                std::vector<std::string>& history)
+{
+    OE_PROFILING_ZONE;
+
+    std::shared_ptr<ChunkState> state = std::make_shared<ChunkState>(numChunks);
+
+    // deal out contiguous runs of features so each chunk stays spatially coherent
+    unsigned chunkSize = ((unsigned)workingSet.size() + numChunks - 1u) / numChunks;
+    unsigned f = 0u;
+    for (auto& feature : workingSet)
+    {
+        state->_chunks[f++ / chunkSize].push_back(feature.get());
+    }
+
+    // each chunk gets its own filter context, copied from the shared one
+    state->_compile = [&](unsigned c)
+    {
+        state->_results[c] = compileFeatures(state->_chunks[c], style, context, state->_histories[c]);
+    };
+
+    // The calling thread works too, so all the chunks get done
+    // even if the arena is busy.
+    JobArena* arena = getCompilerArena();
+    for (unsigned j = 0; j < numChunks - 1u; ++j)
+    {
+        Job job(arena);
+        job.setName("oe.geometrycompiler.chunk");
+        job.dispatch([state](Cancelable*) { state->work(); });
+    }
+
+    state->work();
+
+    {
+        std::unique_lock<Threading::Mutex> lock(state->_mutex);
+        state->_finished.wait(lock, [&state]() { return state->_done == state->_chunks.size(); });
+    }
+
+    // filters may have added or removed features, so gather them back
+    workingSet.clear();
+    osg::ref_ptr<osg::Group> resultGroup = new osg::Group();
+    for (unsigned c = 0; c < numChunks; ++c)
+    {
+        workingSet.insert(workingSet.end(), state->_chunks[c].begin(), state->_chunks[c].end());
+
+        osg::Group* result = state->_results[c].get();
+        for (unsigned i = 0; result && i < result->getNumChildren(); ++i)
+        {
+            resultGroup->addChild(result->getChild(i));
+        }
+    }
+
+    history = state->_histories[0];
+    history.push_back("chunks");
+
+    if (_options.mergeGeometry() == true)
+    {
+        // chunks built their own copies of the same states; share them so
+        // the merge can find siblings with identical state
+        osg::ref_ptr<StateSetCache> cache = Registry::stateSetCache();
+        if (!cache.valid())
+            cache = new StateSetCache();
+        cache->consolidateStateSets(resultGroup.get());
+
+        mergeChunkResults(resultGroup.get());
+    }
+
+    return resultGroup.release();
+}
+
+osg::Node*
+GeometryCompiler::compile(FeatureList&          workingSet,
+                          const Style&          style,
+                          const FilterContext&  context)
+{
+    OE_PROFILING_ZONE;
+
+#ifdef PROFILING
+    osg::Timer_t p_start = osg::Timer::instance()->tick();
+    unsigned p_features = workingSet.size();
+#endif
+
+    // for debugging/validation.
+    std::vector<std::string> history;
+    bool trackHistory = (_options.validate() == true);
+
+    // create a filter context that will track feature data through the process
+    FilterContext sharedCX = context;
+
+    if ( !sharedCX.extent().isSet() && sharedCX.profile() )
+    {
+        sharedCX.extent() = sharedCX.profile()->getExtent();
+    }
+
+    // dense working sets compile in parallel chunks
+    unsigned numChunks = 1u;
+    if (_options.parallelChunkSize().isSet() && _options.parallelChunkSize().get() > 0u)
+    {
+        numChunks = std::min(
+            (unsigned)workingSet.size() / _options.parallelChunkSize().get(),
+            Threading::getConcurrency());
+    }
+
+    osg::ref_ptr<osg::Group> resultGroup = numChunks > 1u ?
+        compileChunks(workingSet, style, sharedCX, numChunks, history) :
+        compileFeatures(workingSet, style, sharedCX, history);
+
     if (Registry::capabilities().supportsGLSL())
     {
         ShaderPolicy shaderPolicy = _options.shaderPolicy().get();
@@ -514,16 +750,25 @@ GeometryCompiler::compile(FeatureList&          workingSet,
         osg::ref_ptr<StateSetCache> sscache;
         if ( sharedCX.getSession() )
         {
-            // with a shared cache, don't combine statesets. They may be
-            // in the live graph
             sscache = sharedCX.getSession()->getStateSetCache();
-            sscache->consolidateStateAttributes( resultGroup.get() );
         }
-        else 
+        else if ( Registry::stateSetCache() )
+        {
+            sscache = Registry::stateSetCache();
+        }
+        else
         {
-            // isolated: perform full optimization
             sscache = new StateSetCache();
-            sscache->optimize( resultGroup.get() );
+        }
+
+        sscache->consolidateStateAttributes( resultGroup.get() );
+
+        // The cache only holds weak references, so statesets below the
+        // root can be combined with ones already in the live graph. Leave
+        // the root's own stateset alone since callers tend to modify it.
+        for (unsigned i = 0; i < resultGroup->getNumChildren(); ++i)
+        {
+            sscache->consolidateStateSets( resultGroup->getChild(i) );
         }
         
         if ( trackHistory ) history.push_back( "share state" );
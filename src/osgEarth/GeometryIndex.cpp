@@ -0,0 +1,284 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/GeometryIndex>
+#include <osgEarth/GEOS>
+#include <osgEarth/Threading>
+#include <osgEarth/rtree.h>
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+#define LC "[GeometryIndex] "
+
+#define GEOS_ARENA_NAME "oe.geos"
+
+// inputs smaller than this don't pay for dispatching jobs
+#define MIN_PARALLEL_COUNT 64u
+
+namespace
+{
+    typedef RTree<unsigned, double, 2> BoundsIndex;
+
+#ifdef OSGEARTH_HAVE_GEOS
+    // GEOS data one thread builds for its own queries. It owns a separate
+    // context so it can be torn down from whichever thread destroys the index.
+    struct ThreadData
+    {
+        GEOSContextHandle_t _handle;
+        std::vector<GEOSGeometry*> _geoms;
+        std::vector<const GEOSPreparedGeometry*> _prepared;
+
+        ThreadData() : _handle(nullptr) { }
+
+        ~ThreadData()
+        {
+            if (_handle)
+            {
+                for (auto p : _prepared)
+                    if (p) GEOSPreparedGeom_destroy_r(_handle, p);
+                for (auto g : _geoms)
+                    if (g) GEOSGeom_destroy_r(_handle, g);
+                finishGEOS_r(_handle);
+            }
+        }
+    };
+#endif
+}
+
+struct GeometryIndex::Impl
+{
+    std::vector<osg::ref_ptr<const Geometry> > _geometries;
+    BoundsIndex _bounds;
+
+#ifdef OSGEARTH_HAVE_GEOS
+    mutable PerThread<std::shared_ptr<ThreadData> > _threadData;
+
+    ThreadData& getThreadData() const
+    {
+        std::shared_ptr<ThreadData>& data = _threadData.get();
+        if (!data)
+        {
+            data = std::make_shared<ThreadData>();
+            data->_handle = GEOS::createContext();
+        }
+        if (data->_prepared.size() < _geometries.size())
+        {
+            data->_geoms.resize(_geometries.size(), nullptr);
+            data->_prepared.resize(_geometries.size(), nullptr);
+        }
+        return *data.get();
+    }
+
+    // prepares the geometry on first use by this thread
+    const GEOSPreparedGeometry* getPrepared(ThreadData& data, unsigned i) const
+    {
+        if (data._prepared[i] == nullptr && data._geoms[i] == nullptr)
+        {
+            data._geoms[i] = GEOS::importGeometry(data._handle, _geometries[i].get());
+            if (data._geoms[i])
+                data._prepared[i] = GEOSPrepare_r(data._handle, data._geoms[i]);
+        }
+        return data._prepared[i];
+    }
+#endif
+
+    void candidates(const Bounds& b, std::vector<unsigned>& hits) const
+    {
+        double a_min[2] = { b.xMin(), b.yMin() };
+        double a_max[2] = { b.xMax(), b.yMax() };
+        _bounds.Search(a_min, a_max, &hits, std::numeric_limits<int>::max());
+
+        // test in insertion order, so "first" means the earliest insert
+        std::sort(hits.begin(), hits.end());
+        hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    }
+};
+
+GeometryIndex::GeometryIndex() :
+    _impl(new Impl())
+{
+    //nop
+}
+
+GeometryIndex::~GeometryIndex()
+{
+    //nop - here so the Impl is complete at destruction
+}
+
+unsigned
+GeometryIndex::insert(const Geometry* geometry)
+{
+    unsigned index = _impl->_geometries.size();
+    _impl->_geometries.push_back(geometry);
+
+    if (geometry)
+    {
+        Bounds b = geometry->getBounds();
+        if (b.isValid())
+        {
+            double a_min[2] = { b.xMin(), b.yMin() };
+            double a_max[2] = { b.xMax(), b.yMax() };
+            _impl->_bounds.Insert(a_min, a_max, index);
+        }
+    }
+    return index;
+}
+
+unsigned
+GeometryIndex::size() const
+{
+    return _impl->_geometries.size();
+}
+
+void
+GeometryIndex::findIntersecting(
+    const Geometry* geometry,
+    std::vector<unsigned>& output,
+    bool firstOnly) const
+{
+    if (!geometry)
+        return;
+
+    Bounds b = geometry->getBounds();
+    if (!b.isValid())
+        return;
+
+    std::vector<unsigned> hits;
+    _impl->candidates(b, hits);
+    if (hits.empty())
+        return;
+
+#ifdef OSGEARTH_HAVE_GEOS
+
+    ThreadData& data = _impl->getThreadData();
+
+    GEOSGeometry* input = GEOS::importGeometry(data._handle, geometry);
+    if (!input)
+        return;
+
+    for (auto i : hits)
+    {
+        const GEOSPreparedGeometry* prepared = _impl->getPrepared(data, i);
+        if (prepared && GEOSPreparedIntersects_r(data._handle, prepared, input) == 1)
+        {
+            output.push_back(i);
+            if (firstOnly)
+                break;
+        }
+    }
+
+    GEOSGeom_destroy_r(data._handle, input);
+
+#else
+
+    for (auto i : hits)
+    {
+        if (_impl->_geometries[i]->intersects(geometry))
+        {
+            output.push_back(i);
+            if (firstOnly)
+                break;
+        }
+    }
+
+#endif
+}
+
+void
+GeometryIndex::findContaining(
+    double x, double y,
+    std::vector<unsigned>& output,
+    bool firstOnly) const
+{
+    std::vector<unsigned> hits;
+    _impl->candidates(Bounds(x, y, x, y), hits);
+    if (hits.empty())
+        return;
+
+#ifdef OSGEARTH_HAVE_GEOS
+
+    ThreadData& data = _impl->getThreadData();
+
+    GEOSCoordSequence* coords = GEOSCoordSeq_create_r(data._handle, 1, 2);
+    GEOSCoordSeq_setX_r(data._handle, coords, 0, x);
+    GEOSCoordSeq_setY_r(data._handle, coords, 0, y);
+    GEOSGeometry* point = GEOSGeom_createPoint_r(data._handle, coords);
+    if (!point)
+        return;
+
+    for (auto i : hits)
+    {
+        const GEOSPreparedGeometry* prepared = _impl->getPrepared(data, i);
+        if (prepared && GEOSPreparedContains_r(data._handle, prepared, point) == 1)
+        {
+            output.push_back(i);
+            if (firstOnly)
+                break;
+        }
+    }
+
+    GEOSGeom_destroy_r(data._handle, point);
+
+#else
+
+    for (auto i : hits)
+    {
+        if (_impl->_geometries[i]->contains2D(x, y))
+        {
+            output.push_back(i);
+            if (firstOnly)
+                break;
+        }
+    }
+
+#endif
+}
+
+void
+GeometryIndex::parallelFor(
+    unsigned count,
+    const std::function<void(unsigned)>& func)
+{
+    unsigned bands = osg::minimum(Threading::getConcurrency(), count / MIN_PARALLEL_COUNT);
+    if (bands <= 1u)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    static JobArena* arena = []()
+    {
+        JobArena::setConcurrency(GEOS_ARENA_NAME, Threading::getConcurrency());
+        return JobArena::get(GEOS_ARENA_NAME);
+    }();
+
+    JobGroup group;
+    unsigned perBand = (count + bands - 1u) / bands;
+    for (unsigned first = 0; first < count; first += perBand)
+    {
+        unsigned last = osg::minimum(first + perBand, count);
+        Job(arena, &group).dispatch([&func, first, last](Cancelable*)
+        {
+            for (unsigned i = first; i < last; ++i)
+                func(i);
+        });
+    }
+    group.join();
+}
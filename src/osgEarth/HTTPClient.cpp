@@ -18,11 +18,18 @@
  */
 #include <osgEarth/HTTPClient>
 #include <osgEarth/Progress>
+#include <osgEarth/Threading>
 #include <osgEarth/Metrics>
+#include <osgEarth/NetworkMonitor>
 #include <osgEarth/Version>
 #include <osgDB/ReadFile>
 #include <osgDB/FileNameUtils>
 #include <curl/curl.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 // Whether to use WinInet instead of cURL - CMAKE option
 #ifdef OSGEARTH_USE_WININET_FOR_HTTP
@@ -32,6 +39,9 @@
 
 #define LC "[HTTPClient] "
 
+#define ARENA_HTTP "oe.http"
+#define ARENA_HTTP_DECODE "oe.http.decode"
+
 //#define OE_TEST OE_NOTICE
 #define OE_TEST OE_NULL
 
@@ -44,11 +54,16 @@ namespace osgEarth
 
     struct StreamObject
     {
-        StreamObject(std::ostream* stream) : _stream(stream) { }
+        StreamObject(std::ostream* stream) : _stream(stream), _buffer(0L) { }
+
+        StreamObject(ByteBuffer* buffer) : _stream(0L), _buffer(buffer) { }
 
-        void write(const char* ptr, size_t realsize)
+        bool write(const char* ptr, size_t realsize)
         {
-            if (_stream) _stream->write(ptr, realsize);
+            if (_dataCallback) return _dataCallback(ptr, realsize);
+            else if (_buffer) _buffer->data().append(ptr, realsize);
+            else if (_stream) _stream->write(ptr, realsize);
+            return true;
         }
 
         void writeHeader(const char* ptr, size_t realsize)
@@ -58,10 +73,22 @@ namespace osgEarth
             StringVector tized;
             tok.tokenize(header, tized);
             if ( tized.size() >= 2 )
+            {
                 _headers[tized[0]] = tized[1];
+
+                // size the buffer up front so the payload is written exactly once
+                if (_buffer && ciEquals(tized[0], "Content-Length"))
+                {
+                    unsigned long length = as<unsigned long>(tized[1], 0ul);
+                    if (length > 0ul && length < (1ul << 28))
+                        _buffer->data().reserve(length);
+                }
+            }
         }
 
         std::ostream* _stream;
+        ByteBuffer* _buffer;
+        HTTPRequest::DataCallback _dataCallback;
         Headers _headers;
         std::string     _resultMimeType;
     };
@@ -71,8 +98,8 @@ namespace osgEarth
     {
         size_t realsize = size* nmemb;
         StreamObject* sp = (StreamObject*)data;
-        sp->write((const char*)ptr, realsize);
-        return realsize;
+        // returning less than we were given aborts the transfer
+        return sp->write((const char*)ptr, realsize) ? realsize : 0;
     }
 
     static size_t
@@ -110,7 +137,7 @@ namespace osgEarth
     }
 
     bool decodeMultipartStream(const std::string&   boundary,
-                               HTTPResponse::Part*  input,
+                               std::istream&        input,
                                HTTPResponse::Parts& output)
     {
         std::string bstr = std::string("--") + boundary;
@@ -118,7 +145,7 @@ namespace osgEarth
         char tempbuf[256];
 
         // first thing in the stream should be the boundary.
-        input->_stream.read( tempbuf, bstr.length() );
+        input.read( tempbuf, bstr.length() );
         tempbuf[bstr.length()] = 0;
         line = tempbuf;
         if ( line != bstr )
@@ -136,7 +163,7 @@ namespace osgEarth
             osg::ref_ptr<HTTPResponse::Part> next_part = new HTTPResponse::Part();
 
             // first finish off the boundary.
-            std::getline( input->_stream, line );
+            std::getline( input, line );
             if ( line == "--" )
             {
                 done = true;
@@ -147,7 +174,7 @@ namespace osgEarth
                 line = " ";
                 while( line.length() > 0 && !done )
                 {
-                    std::getline( input->_stream, line );
+                    std::getline( input, line );
 
                     // check for EOS:
                     if ( line == "--" )
@@ -174,7 +201,7 @@ namespace osgEarth
                 while( bstr_ptr < bstr.length() )
                 {
                     char b;
-                    input->_stream.read( &b, 1 );
+                    input.read( &b, 1 );
                     if ( b == bstr[bstr_ptr] )
                     {
                         bstr_ptr++;
@@ -209,7 +236,8 @@ HTTPRequest::HTTPRequest( const std::string& url )
 HTTPRequest::HTTPRequest( const HTTPRequest& rhs ) :
 _parameters( rhs._parameters ),
 _headers(rhs._headers),
-_url( rhs._url )
+_url( rhs._url ),
+_dataCallback( rhs._dataCallback )
 {
     //nop
 }
@@ -308,8 +336,9 @@ _response_code( rhs._response_code ),
 _parts( rhs._parts ),
 _mimeType( rhs._mimeType ),
 _canceled( rhs._canceled ),
-_duration_s(0.0),
-_lastModified(0u)
+_duration_s( rhs._duration_s ),
+_lastModified( rhs._lastModified ),
+_message( rhs._message )
 {
     //nop
 }
@@ -353,6 +382,8 @@ HTTPResponse::getPartHeader( unsigned int n, const std::string& name ) const {
 
 std::istream&
 HTTPResponse::getPartStream( unsigned int n ) const {
+    if (_parts[n]->_bufferStream)
+        return *_parts[n]->_bufferStream.get();
     return _parts[n]->_stream;
 }
 
@@ -360,10 +391,20 @@ std::string
 HTTPResponse::getPartAsString( unsigned int n ) const {
     std::string streamStr;
     if (n < _parts.size())
-        streamStr = _parts[n]->_stream.str();
+    {
+        if (_parts[n]->_buffer.valid())
+            streamStr = _parts[n]->_buffer->data();
+        else
+            streamStr = _parts[n]->_stream.str();
+    }
     return streamStr;
 }
 
+const ByteBuffer*
+HTTPResponse::getPartBuffer( unsigned int n ) const {
+    return n < _parts.size() ? _parts[n]->_buffer.get() : 0L;
+}
+
 const std::string&
 HTTPResponse::getMimeType() const {
     return _mimeType;
@@ -414,6 +455,79 @@ namespace
     static osg::ref_ptr< URLRewriter > s_rewriter;
 
     static osg::ref_ptr< ConfigHandler > s_curlConfigHandler;
+
+    static unsigned                    s_maxAsyncRequests = 64u;
+
+    // Settings shared by every initialized implementation; the
+    // environment overrides whatever the application has set.
+    std::string resolveUserAgent()
+    {
+        const char* userAgentEnv = getenv("OSGEARTH_USERAGENT");
+        return userAgentEnv ? std::string(userAgentEnv) : s_userAgent;
+    }
+
+    long resolveTimeout()
+    {
+        const char* timeoutEnv = getenv("OSGEARTH_HTTP_TIMEOUT");
+        return timeoutEnv ? osgEarth::as<long>(std::string(timeoutEnv), 0) : s_timeout;
+    }
+
+    long resolveConnectTimeout()
+    {
+        const char* connectTimeoutEnv = getenv("OSGEARTH_HTTP_CONNECTTIMEOUT");
+        return connectTimeoutEnv ? osgEarth::as<long>(std::string(connectTimeoutEnv), 0) : s_connectTimeout;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x070a03
+    // Process-wide curl share handle. Easy handles attached to it share
+    // the DNS cache, TLS sessions and (curl 7.57+) live connections,
+    // regardless of which thread they run on.
+    class CurlShare
+    {
+    public:
+        static CURLSH* get()
+        {
+            static CurlShare s_share;
+            return s_share._share;
+        }
+
+    private:
+        CurlShare()
+        {
+            _share = curl_share_init();
+            if (_share)
+            {
+                curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, &CurlShare::lock);
+                curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, &CurlShare::unlock);
+                curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+                curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+#if LIBCURL_VERSION_NUM >= 0x071003
+                curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x073900
+                curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+            }
+        }
+
+        // Handles still attached at exit would make cleanup fail,
+        // so the share lives for the life of the process.
+        ~CurlShare() { }
+
+        static void lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr)
+        {
+            static_cast<CurlShare*>(userptr)->_mutexes[data % CURL_LOCK_DATA_LAST].lock();
+        }
+
+        static void unlock(CURL*, curl_lock_data data, void* userptr)
+        {
+            static_cast<CurlShare*>(userptr)->_mutexes[data % CURL_LOCK_DATA_LAST].unlock();
+        }
+
+        CURLSH* _share;
+        std::mutex _mutexes[CURL_LOCK_DATA_LAST];
+    };
+#endif
 }
 
 //.........................................................................
@@ -423,7 +537,12 @@ namespace
     class CURLImplementation : public HTTPClient::Implementation
     {
     public:
-        CURLImplementation() : _curl_handle(0), _previousHttpAuthentication(0) { }
+        CURLImplementation(bool shareConnections = true, bool useHTTP2 = true) :
+            _curl_handle(0),
+            _curl_multi(0),
+            _previousHttpAuthentication(0),
+            _shareConnections(shareConnections),
+            _useHTTP2(useHTTP2) { }
 
         void initialize()
         {
@@ -431,6 +550,10 @@ namespace
 
             _curl_handle = curl_easy_init();
 
+#if LIBCURL_VERSION_NUM >= 0x071c00
+            _curl_multi = curl_multi_init();
+#endif
+
             curl_easy_setopt( _curl_handle, CURLOPT_WRITEFUNCTION, StreamObjectReadCallback );
             curl_easy_setopt( _curl_handle, CURLOPT_HEADERFUNCTION, StreamObjectHeaderCallback );
             curl_easy_setopt( _curl_handle, CURLOPT_FOLLOWLOCATION, (void*)1 );
@@ -443,6 +566,23 @@ namespace
             // Note that you must have curl built against zlib to support gzip or deflate encoding.
             curl_easy_setopt( _curl_handle, CURLOPT_ENCODING, "");
 
+#if LIBCURL_VERSION_NUM >= 0x070a03
+            if (_shareConnections && CurlShare::get())
+            {
+                curl_easy_setopt( _curl_handle, CURLOPT_SHARE, CurlShare::get() );
+            }
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x072f00
+            if (_useHTTP2)
+            {
+                // HTTP/2 over TLS when the server offers it (falls back on HTTP/1.1),
+                // and wait for a connection that can multiplex rather than opening another.
+                curl_easy_setopt( _curl_handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS );
+                curl_easy_setopt( _curl_handle, CURLOPT_PIPEWAIT, 1L );
+            }
+#endif
+
             osg::ref_ptr< ConfigHandler > curlConfigHandler = HTTPClient::getConfigHandler();
             if (curlConfigHandler.valid()) {
                 curlConfigHandler->onInitialize(_curl_handle);
@@ -451,17 +591,131 @@ namespace
 
         ~CURLImplementation()
         {
+#if LIBCURL_VERSION_NUM >= 0x071c00
+            if (_curl_multi)
+                curl_multi_cleanup( _curl_multi );
+            _curl_multi = 0;
+#endif
             if (_curl_handle)
                 curl_easy_cleanup( _curl_handle );
             _curl_handle = 0;
         }
 
+        //! Runs the transfer set up on the easy handle. When possible this
+        //! drives the transfer through a multi handle and polls the progress
+        //! callback every few milliseconds, because curl only invokes its own
+        //! progress function about once per second while waiting on a server;
+        //! that way an abandoned request frees its thread almost immediately.
+        CURLcode perform(ProgressCallback* progress) const
+        {
+#if LIBCURL_VERSION_NUM >= 0x071c00
+            if (progress && _curl_multi)
+            {
+                if (curl_multi_add_handle(_curl_multi, _curl_handle) != CURLM_OK)
+                    return curl_easy_perform(_curl_handle);
+
+                CURLcode result = CURLE_OK;
+                bool done = false;
+                while (!done)
+                {
+                    int running = 0;
+                    CURLMcode mc = curl_multi_perform(_curl_multi, &running);
+                    if (mc != CURLM_OK && mc != CURLM_CALL_MULTI_PERFORM)
+                    {
+                        result = CURLE_RECV_ERROR;
+                        break;
+                    }
+
+                    int queued = 0;
+                    while (CURLMsg* msg = curl_multi_info_read(_curl_multi, &queued))
+                    {
+                        if (msg->msg == CURLMSG_DONE && msg->easy_handle == _curl_handle)
+                        {
+                            result = msg->data.result;
+                            done = true;
+                        }
+                    }
+
+                    if (!done)
+                    {
+                        if (running == 0)
+                        {
+                            break;
+                        }
+                        if (progress->isCanceled())
+                        {
+                            result = CURLE_ABORTED_BY_CALLBACK;
+                            break;
+                        }
+                        curl_multi_wait(_curl_multi, NULL, 0, 10, NULL);
+                    }
+                }
+
+                curl_multi_remove_handle(_curl_multi, _curl_handle);
+                return result;
+            }
+#endif
+            return curl_easy_perform(_curl_handle);
+        }
+
+        //! State of a single transfer between begin() and finish().
+        //! curl holds pointers into this object while the transfer
+        //! is running, so it must not move until finish() returns.
+        struct Transfer
+        {
+            Transfer(const HTTPRequest& request) :
+                _request(request),
+                _headers(NULL),
+                _part(new HTTPResponse::Part()),
+                _sp((ByteBuffer*)0L),
+                _start(0)
+            {
+                // curl writes the payload straight into the part's buffer,
+                // unless the caller wants it as it arrives
+                _part->_buffer = new ByteBuffer();
+                _sp._buffer = _part->_buffer.get();
+                _sp._dataCallback = request.getDataCallback();
+                _errorBuf[0] = 0;
+            }
+
+            ~Transfer()
+            {
+                if (_headers)
+                    curl_slist_free_all(_headers);
+            }
+
+            HTTPRequest _request;
+            std::string _url;
+            std::string _proxy_addr;
+            struct curl_slist* _headers;
+            osg::ref_ptr<HTTPResponse::Part> _part;
+            StreamObject _sp;
+            char _errorBuf[CURL_ERROR_SIZE];
+            osg::Timer_t _start;
+
+        private:
+            Transfer(const Transfer&);
+            Transfer& operator=(const Transfer&);
+        };
+
         HTTPResponse doGet(
             const HTTPRequest&    request,
             const osgDB::Options* options,
             ProgressCallback*     progress ) const
-        {            
-            OE_START_TIMER(http_get);
+        {
+            Transfer transfer(request);
+            begin(options, progress, transfer);
+            CURLcode res = perform(progress);
+            return finish(res, transfer);
+        }
+
+        //! Configures the easy handle for the transfer's GET without running it.
+        void begin(
+            const osgDB::Options* options,
+            ProgressCallback*     progress,
+            Transfer&             transfer) const
+        {
+            const HTTPRequest& request = transfer._request;
 
             std::string url = request.getURL();
 
@@ -524,7 +778,7 @@ namespace
             }
 
             // Set up proxy server:
-            std::string proxy_addr;
+            std::string& proxy_addr = transfer._proxy_addr;
             if ( !proxy_host.empty() )
             {
                 std::stringstream buf;
@@ -567,6 +821,8 @@ namespace
                 OE_DEBUG << LC << "Rewrote URL " << oldURL << " to " << url << std::endl;
             }
 
+            transfer._url = url;
+
             const osgDB::AuthenticationDetails* details = authenticationMap ?
                 authenticationMap->getAuthenticationDetails( url ) :
                 0;
@@ -609,7 +865,7 @@ namespace
 
 
             // Set any headers
-            struct curl_slist *headers=NULL;
+            struct curl_slist*& headers = transfer._headers;
             if (!request.getHeaders().empty())
             {
                 for (HTTPRequest::Parameters::const_iterator itr = request.getHeaders().begin(); itr != request.getHeaders().end(); ++itr)
@@ -624,9 +880,6 @@ namespace
             headers = curl_slist_append(headers, "pragma: ");
             curl_easy_setopt(_curl_handle, CURLOPT_HTTPHEADER, headers);
 
-            osg::ref_ptr<HTTPResponse::Part> part = new HTTPResponse::Part();
-            StreamObject sp( &part->_stream );
-
             //Take a temporary ref to the callback (why? dangerous.)
             //osg::ref_ptr<ProgressCallback> progressCallback = callback;
             curl_easy_setopt( _curl_handle, CURLOPT_URL, url.c_str() );
@@ -635,18 +888,13 @@ namespace
                 curl_easy_setopt(_curl_handle, CURLOPT_PROGRESSDATA, progress);
             }
 
-            CURLcode res;
-            long response_code = 0L;
-
-            OE_START_TIMER(get_duration);
+            transfer._start = osg::Timer::instance()->tick();
 
             //if ( _simResponseCode < 0 )
             //{
-            char errorBuf[CURL_ERROR_SIZE];
-            errorBuf[0] = 0;
-            curl_easy_setopt( _curl_handle, CURLOPT_ERRORBUFFER, (void*)errorBuf );
-            curl_easy_setopt( _curl_handle, CURLOPT_WRITEDATA, (void*)&sp);
-            curl_easy_setopt( _curl_handle, CURLOPT_HEADERDATA, (void*)&sp);
+            curl_easy_setopt( _curl_handle, CURLOPT_ERRORBUFFER, (void*)transfer._errorBuf );
+            curl_easy_setopt( _curl_handle, CURLOPT_WRITEDATA, (void*)&transfer._sp);
+            curl_easy_setopt( _curl_handle, CURLOPT_HEADERDATA, (void*)&transfer._sp);
 
             //Disable peer certificate verification to allow us to access in https servers where the peer certificate cannot be verified.
             curl_easy_setopt( _curl_handle, CURLOPT_SSL_VERIFYPEER, (void*)0 );
@@ -655,26 +903,29 @@ namespace
             if (configHandler.valid()) {
                 configHandler->onGet(_curl_handle);
             }
+        }
 
-            res = curl_easy_perform(_curl_handle);
+        //! Collects the response of a transfer started with begin().
+        HTTPResponse finish(CURLcode res, Transfer& transfer) const
+        {
+            const std::string& url = transfer._url;
+            const HTTPRequest& request = transfer._request;
+            osg::ref_ptr<HTTPResponse::Part>& part = transfer._part;
+            StreamObject& sp = transfer._sp;
+            long response_code = 0L;
 
             curl_easy_setopt( _curl_handle, CURLOPT_WRITEDATA, (void*)0 );
+            curl_easy_setopt( _curl_handle, CURLOPT_HEADERDATA, (void*)0 );
+            curl_easy_setopt( _curl_handle, CURLOPT_ERRORBUFFER, (void*)0 );
             curl_easy_setopt( _curl_handle, CURLOPT_PROGRESSDATA, (void*)0);
 
-            if (!proxy_addr.empty())
+            if (!transfer._proxy_addr.empty())
             {
                 long connect_code = 0L;
                 CURLcode r = curl_easy_getinfo(_curl_handle, CURLINFO_HTTP_CONNECTCODE, &connect_code);
                 if ( r != CURLE_OK )
                 {
                     OE_WARN << LC << "Proxy connect error: " << curl_easy_strerror(r) << std::endl;
-
-                    // Free the headers
-                    if (headers)
-                    {
-                        curl_slist_free_all(headers);
-                    }
-
                     return HTTPResponse(0);
                 }
             }
@@ -714,7 +965,8 @@ namespace
                     OE_DEBUG << LC << "detected multipart data; decoding..." << std::endl;
 
                     //TODO: parse out the "wcs" -- this is WCS-specific
-                    if ( !decodeMultipartStream( "wcs", part.get(), response.getParts() ) )
+                    ByteBufferStream input(part->_buffer.get());
+                    if ( !decodeMultipartStream( "wcs", input, response.getParts() ) )
                     {
                         // error decoding an invalid multipart stream.
                         // should we do anything, or just leave the response empty?
@@ -727,6 +979,9 @@ namespace
                         part->_headers[itr->first] = itr->second;
                     }
 
+                    part->_size = part->_buffer->size();
+                    part->_bufferStream.reset(new ByteBufferStream(part->_buffer.get()));
+
                     // Write the headers to the metadata
                     response.getParts().push_back( part.get() );
                 }
@@ -748,7 +1003,7 @@ namespace
                 }
             }
 
-            response.setDuration(OE_STOP_TIMER(get_duration));
+            response.setDuration(osg::Timer::instance()->delta_s(transfer._start, osg::Timer::instance()->tick()));
 
             if ( s_HTTP_DEBUG )
             {
@@ -807,12 +1062,6 @@ namespace
 #endif
             }
 
-            // Free the headers
-            if (headers)
-            {
-                curl_slist_free_all(headers);
-            }            
-
             return response;
         }
         
@@ -858,17 +1107,308 @@ namespace
             }
         }
 
+        bool sharesConnections() const { return _shareConnections; }
+        bool usesHTTP2() const { return _useHTTP2; }
+
     private:
         void* _curl_handle;
+        void* _curl_multi;
         mutable std::string _previousPassword;
         mutable long _previousHttpAuthentication;
+        bool _shareConnections;
+        bool _useHTTP2;
     };
 }
 
+CURLHTTPImplementationFactory::CURLHTTPImplementationFactory() :
+    _shareConnections(true),
+    _useHTTP2(true)
+{
+    if (::getenv("OSGEARTH_HTTP_NO_SHARING"))
+        _shareConnections = false;
+
+    if (::getenv("OSGEARTH_HTTP_NO_HTTP2"))
+        _useHTTP2 = false;
+}
+
 HTTPClient::Implementation*
 CURLHTTPImplementationFactory::create() const
 {
-    return new CURLImplementation();
+    return new CURLImplementation(_shareConnections, _useHTTP2);
+}
+
+//.........................................................................
+
+namespace
+{
+    // payload size of a response, charged against the host's bandwidth budget
+    unsigned long getResponseBytes(const HTTPResponse& response)
+    {
+        unsigned long bytes = 0u;
+        for (unsigned i = 0; i < response.getNumParts(); ++i)
+            bytes += response.getPartSize(i);
+        return bytes;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x071c00
+    //! Services every asynchronous GET from one curl multi handle and a
+    //! single I/O thread. Each transfer borrows an easy handle from a pool
+    //! of CURLImplementations, so a few threads of application code can
+    //! keep hundreds of requests in flight.
+    class AsyncHTTP
+    {
+    public:
+        struct Request
+        {
+            Request(const HTTPRequest& request) :
+                _request(request),
+                _host(NetworkMonitor::getHost(request.getURL())),
+                _shareConnections(true),
+                _useHTTP2(true) { }
+            HTTPRequest _request;
+            std::string _host;
+            bool _shareConnections;
+            bool _useHTTP2;
+            osg::ref_ptr<const osgDB::Options> _options;
+            osg::ref_ptr<ProgressCallback> _progress;
+            HTTPClient::ResponseCallback _callback;
+        };
+
+        static AsyncHTTP& instance()
+        {
+            static AsyncHTTP s_instance;
+            return s_instance;
+        }
+
+        void submit(const Request& request)
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            if (!_thread.joinable())
+            {
+                _thread = std::thread([this]() { run(); });
+            }
+            _pending.push_back(request);
+            _cv.notify_one();
+        }
+
+    private:
+        struct Active
+        {
+            Active(const Request& request) : _request(request), _transfer(request._request) { }
+            Request _request;
+            osg::ref_ptr<CURLImplementation> _impl;
+            CURLImplementation::Transfer _transfer;
+        };
+
+        typedef std::pair<HTTPClient::ResponseCallback, HTTPResponse> Completion;
+
+        AsyncHTTP() : _mutex("AsyncHTTP(OE)"), _done(false) { }
+
+        ~AsyncHTTP()
+        {
+            {
+                Threading::ScopedMutexLock lock(_mutex);
+                _done = true;
+                _cv.notify_all();
+            }
+            if (_thread.joinable())
+            {
+                _thread.join();
+            }
+        }
+
+        void run()
+        {
+            Threading::setThreadName("oe.http.async");
+
+            CURLM* multi = curl_multi_init();
+
+#if LIBCURL_VERSION_NUM >= 0x072b00
+            // multiplex concurrent HTTP/2 requests to the same host
+            curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+            std::unordered_map<CURL*, std::unique_ptr<Active>> active;
+            std::vector< osg::ref_ptr<CURLImplementation> > idle;
+            std::vector<Request> incoming;
+            std::vector<Completion> completed;
+
+            bool throttled = false;
+
+            while (true)
+            {
+                // collect new requests, up to the limit of concurrent transfers.
+                // Requests for hosts that are at their limits stay queued.
+                {
+                    std::unique_lock<Threading::Mutex> lock(_mutex);
+                    if (active.empty())
+                    {
+                        if (throttled)
+                            _cv.wait_for(lock, std::chrono::milliseconds(10));
+                        else
+                            _cv.wait(lock, [this]() { return _done || !_pending.empty(); });
+                    }
+                    if (_done)
+                    {
+                        break;
+                    }
+                    throttled = false;
+                    for (auto i = _pending.begin();
+                        i != _pending.end() && active.size() + incoming.size() < s_maxAsyncRequests; )
+                    {
+                        if (i->_progress.valid() && i->_progress->isCanceled())
+                        {
+                            HTTPResponse response(0);
+                            response.setCanceled(true);
+                            completed.push_back(Completion(i->_callback, response));
+                            i = _pending.erase(i);
+                        }
+                        else if (NetworkMonitor::tryAcquire(i->_host))
+                        {
+                            incoming.push_back(*i);
+                            i = _pending.erase(i);
+                        }
+                        else
+                        {
+                            throttled = true;
+                            ++i;
+                        }
+                    }
+                }
+
+                for (auto& request : incoming)
+                {
+
+                    std::unique_ptr<Active> a(new Active(request));
+
+                    // pooled handles configured differently are of no use any more
+                    while (!idle.empty() && (
+                        idle.back()->sharesConnections() != request._shareConnections ||
+                        idle.back()->usesHTTP2() != request._useHTTP2))
+                    {
+                        idle.pop_back();
+                    }
+
+                    if (idle.empty())
+                    {
+                        a->_impl = new CURLImplementation(request._shareConnections, request._useHTTP2);
+                        a->_impl->initialize();
+                        a->_impl->setUserAgent(resolveUserAgent());
+                        a->_impl->setTimeout(resolveTimeout());
+                        a->_impl->setConnectTimeout(resolveConnectTimeout());
+                    }
+                    else
+                    {
+                        a->_impl = idle.back();
+                        idle.pop_back();
+                    }
+
+                    a->_impl->begin(request._options.get(), request._progress.get(), a->_transfer);
+
+                    CURL* handle = a->_impl->getHandle();
+                    curl_multi_add_handle(multi, handle);
+                    active[handle] = std::move(a);
+                }
+                incoming.clear();
+
+                int running = 0;
+                curl_multi_perform(multi, &running);
+
+                int queued = 0;
+                while (CURLMsg* msg = curl_multi_info_read(multi, &queued))
+                {
+                    if (msg->msg == CURLMSG_DONE)
+                    {
+                        retire(multi, msg->easy_handle, msg->data.result, active, idle, completed);
+                    }
+                }
+
+                // abort anything the requester has abandoned:
+                std::vector<CURL*> canceled;
+                for (auto& i : active)
+                {
+                    if (i.second->_request._progress.valid() && i.second->_request._progress->isCanceled())
+                    {
+                        canceled.push_back(i.first);
+                    }
+                }
+                for (auto handle : canceled)
+                {
+                    retire(multi, handle, CURLE_ABORTED_BY_CALLBACK, active, idle, completed);
+                }
+
+                // callbacks run outside the loop's bookkeeping
+                for (auto& c : completed)
+                {
+                    if (c.first)
+                    {
+                        c.first(c.second);
+                    }
+                }
+                completed.clear();
+
+                if (!active.empty())
+                {
+                    curl_multi_wait(multi, NULL, 0, 10, NULL);
+                }
+            }
+
+            for (auto& i : active)
+            {
+                curl_multi_remove_handle(multi, i.first);
+            }
+            active.clear();
+            idle.clear();
+            curl_multi_cleanup(multi);
+        }
+
+        void retire(
+            CURLM* multi,
+            CURL* handle,
+            CURLcode result,
+            std::unordered_map<CURL*, std::unique_ptr<Active>>& active,
+            std::vector< osg::ref_ptr<CURLImplementation> >& idle,
+            std::vector<Completion>& completed)
+        {
+            auto i = active.find(handle);
+            if (i == active.end())
+                return;
+
+            curl_multi_remove_handle(multi, handle);
+
+            Active* a = i->second.get();
+            HTTPResponse response = a->_impl->finish(result, a->_transfer);
+            if (result == CURLE_ABORTED_BY_CALLBACK)
+            {
+                response.setCanceled(true);
+            }
+            completed.push_back(Completion(a->_request._callback, response));
+
+            NetworkMonitor::release(a->_request._host, getResponseBytes(response));
+
+            idle.push_back(a->_impl);
+            active.erase(i);
+        }
+
+        Threading::Mutex _mutex;
+        std::condition_variable_any _cv;
+        std::deque<Request> _pending;
+        std::thread _thread;
+        bool _done;
+    };
+#endif
+
+    //! The curl factory, if asynchronous requests can use the shared curl
+    //! multi handle. A custom implementation factory opts out, since its
+    //! transfers cannot be split into begin() and finish().
+    const CURLHTTPImplementationFactory* asyncTransferFactory(HTTPClient::ImplementationFactory* factory)
+    {
+#if LIBCURL_VERSION_NUM >= 0x071c00 && !defined(OSGEARTH_USE_WININET_FOR_HTTP)
+        return dynamic_cast<CURLHTTPImplementationFactory*>(factory);
+#else
+        return nullptr;
+#endif
+    }
 }
 
 #ifdef OSGEARTH_USE_WININET_FOR_HTTP
@@ -1096,9 +1636,19 @@ namespace
                 osg::ref_ptr<HTTPResponse::Part> part = new HTTPResponse::Part();
 
                 DWORD numBytesRead = 0;
+                const HTTPRequest::DataCallback& onData = request.getDataCallback();
+
                 while( InternetReadFile(hRequest, buffer, 4096, &numBytesRead) && numBytesRead )
                 {
-                    part->_stream << std::string(buffer, numBytesRead);
+                    if (onData)
+                    {
+                        if (!onData(buffer, numBytesRead))
+                            break;
+                    }
+                    else
+                    {
+                        part->_stream << std::string(buffer, numBytesRead);
+                    }
                 }
 
                 response.getParts().push_back( part.get() );
@@ -1227,12 +1777,7 @@ HTTPClient::initializeImpl()
     _previousHttpAuthentication = 0;
 
     //Get the user agent
-    std::string userAgent = s_userAgent;
-    const char* userAgentEnv = getenv("OSGEARTH_USERAGENT");
-    if (userAgentEnv)
-    {
-        userAgent = std::string(userAgentEnv);
-    }
+    std::string userAgent = resolveUserAgent();
     OE_DEBUG << LC << "HTTPClient setting userAgent=" << userAgent << std::endl;
 
     //Check for a response-code simulation (for testing)
@@ -1258,20 +1803,10 @@ HTTPClient::initializeImpl()
         OE_WARN << LC << "HTTP debugging enabled" << std::endl;
     }
 
-    long timeout = s_timeout;
-    const char* timeoutEnv = getenv("OSGEARTH_HTTP_TIMEOUT");
-    if (timeoutEnv)
-    {
-        timeout = osgEarth::as<long>(std::string(timeoutEnv), 0);
-    }
+    long timeout = resolveTimeout();
     OE_DEBUG << LC << "Setting timeout to " << timeout << std::endl;
 
-    long connectTimeout = s_connectTimeout;
-    const char* connectTimeoutEnv = getenv("OSGEARTH_HTTP_CONNECTTIMEOUT");
-    if (connectTimeoutEnv)
-    {
-        connectTimeout = osgEarth::as<long>(std::string(connectTimeoutEnv), 0);
-    }
+    long connectTimeout = resolveConnectTimeout();
     OE_DEBUG << LC << "Setting connect timeout to " << connectTimeout << std::endl;
 
     const char* retryDelayEnv = getenv("OSGEARTH_HTTP_RETRY_DELAY");
@@ -1281,6 +1816,23 @@ HTTPClient::initializeImpl()
     }
     OE_DEBUG << LC << "Setting retry delay to " << s_retryDelay_s << std::endl;
 
+    const char* asyncMaxEnv = getenv("OSGEARTH_HTTP_ASYNC_MAX");
+    if (asyncMaxEnv)
+    {
+        s_maxAsyncRequests = osgEarth::as<unsigned>(std::string(asyncMaxEnv), s_maxAsyncRequests);
+    }
+
+    // per-host throttling, to stay within the usage policies of public tile servers
+    const char* hostMaxRequestsEnv = getenv("OSGEARTH_HTTP_HOST_MAX_REQUESTS");
+    const char* hostMaxBytesEnv = getenv("OSGEARTH_HTTP_HOST_MAX_BYTES_PER_SECOND");
+    if (hostMaxRequestsEnv || hostMaxBytesEnv)
+    {
+        unsigned maxRequests = hostMaxRequestsEnv ? osgEarth::as<unsigned>(std::string(hostMaxRequestsEnv), 0u) : 0u;
+        double maxBytes = hostMaxBytesEnv ? osgEarth::as<double>(std::string(hostMaxBytesEnv), 0.0) : 0.0;
+        OE_INFO << LC << "Per-host limits: " << maxRequests << " requests, " << maxBytes << " bytes/s" << std::endl;
+        NetworkMonitor::setDefaultHostLimits(maxRequests, maxBytes);
+    }
+
     _impl->initialize();
 
     _impl->setUserAgent(userAgent.c_str());
@@ -1445,6 +1997,81 @@ HTTPClient::readString(const HTTPRequest&    request,
     return getClient().doReadString( request, options, progress );
 }
 
+void
+HTTPClient::getAsync(const HTTPRequest&      request,
+                     const osgDB::Options*   options,
+                     ProgressCallback*       progress,
+                     const ResponseCallback& callback)
+{
+    // parses the environment on first use, just like a blocking request
+    getClient().initialize();
+
+#if LIBCURL_VERSION_NUM >= 0x071c00
+    const CURLHTTPImplementationFactory* factory = asyncTransferFactory(_implFactory);
+    if (factory)
+    {
+        AsyncHTTP::Request r(request);
+        r._shareConnections = factory->getShareConnections();
+        r._useHTTP2 = factory->getUseHTTP2();
+        r._options = options;
+        r._progress = progress;
+        r._callback = callback;
+        AsyncHTTP::instance().submit(r);
+        return;
+    }
+#endif
+
+    // no multi handle available; fall back on a blocking GET in a job.
+    osg::ref_ptr<const osgDB::Options> options_ref(options);
+    osg::ref_ptr<ProgressCallback> progress_ref(progress);
+
+    Threading::Job(Threading::JobArena::get(ARENA_HTTP)).dispatch(
+        [request, options_ref, progress_ref, callback](Threading::Cancelable*)
+        {
+            HTTPResponse response = HTTPClient::get(request, options_ref.get(), progress_ref.get());
+            if (callback)
+                callback(response);
+        }
+    );
+}
+
+void
+HTTPClient::readImageAsync(const HTTPRequest&    request,
+                           const osgDB::Options* options,
+                           ProgressCallback*     progress,
+                           const ReadCallback&   callback)
+{
+    osg::ref_ptr<const osgDB::Options> options_ref(options);
+    osg::ref_ptr<ProgressCallback> progress_ref(progress);
+
+    getAsync(request, options, progress,
+        [request, options_ref, progress_ref, callback](const HTTPResponse& response)
+        {
+            // decode in a job so the I/O thread can get back to its transfers
+            Threading::Job(Threading::JobArena::get(ARENA_HTTP_DECODE)).dispatch(
+                [request, options_ref, progress_ref, callback, response](Threading::Cancelable*)
+                {
+                    ReadResult result = decodeImage(request, response, options_ref.get(), progress_ref.get());
+                    if (callback)
+                        callback(result);
+                }
+            );
+        }
+    );
+}
+
+void
+HTTPClient::setMaxAsyncRequests(unsigned value)
+{
+    s_maxAsyncRequests = value > 0u ? value : 1u;
+}
+
+unsigned
+HTTPClient::getMaxAsyncRequests()
+{
+    return s_maxAsyncRequests;
+}
+
 bool
 HTTPClient::download(const std::string& uri,
                      const std::string& localPath)
@@ -1462,8 +2089,19 @@ HTTPClient::doGet(const HTTPRequest&    request,
 
     initialize();
 
+    // wait for the host to accept another request:
+    std::string host = NetworkMonitor::getHost(request.getURL());
+    if (!NetworkMonitor::acquire(host, progress))
+    {
+        HTTPResponse response(0);
+        response.setCanceled(true);
+        return response;
+    }
+
     HTTPResponse response = _impl->doGet(request, options, progress);
 
+    NetworkMonitor::release(host, getResponseBytes(response));
+
     OE_PROFILING_ZONE_TEXT(Stringify() << "response_code " << response.getCode());
     if (response.isCanceled())
     {
@@ -1486,11 +2124,19 @@ HTTPClient::doDownload(const std::string& url, const std::string& filename)
             return false;
 
         unsigned int part_num = response.getNumParts() > 1? 1 : 0;
-        std::istream& input_stream = response.getPartStream( part_num );
 
         std::ofstream fout;
         fout.open(filename.c_str(), std::ios::out | std::ios::binary);
 
+        const ByteBuffer* payload = response.getPartBuffer( part_num );
+        if (payload)
+        {
+            fout.write(payload->ptr(), payload->size());
+            fout.close();
+            return true;
+        }
+
+        std::istream& input_stream = response.getPartStream( part_num );
         input_stream.seekg (0, std::ios::end);
         int length = input_stream.tellg();
         input_stream.seekg (0, std::ios::beg);
@@ -1557,10 +2203,19 @@ HTTPClient::doReadImage(const HTTPRequest&    request,
 {
     initialize();
 
-    ReadResult result;
-
     HTTPResponse response = this->doGet(request, options, callback);
 
+    return decodeImage(request, response, options, callback);
+}
+
+ReadResult
+HTTPClient::decodeImage(const HTTPRequest&    request,
+                        const HTTPResponse&   response,
+                        const osgDB::Options* options,
+                        ProgressCallback*     callback)
+{
+    ReadResult result;
+
     if (response.isOK())
     {
         osgDB::ReaderWriter* reader = getReader(request.getURL(), response);
@@ -0,0 +1,508 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/HeatmapLayer>
+#include <osgEarth/TileRasterizer>
+#include <osgEarth/VirtualProgram>
+#include <osgEarth/Metrics>
+#include <osgEarth/Map>
+#include <osg/BlendFunc>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#define LC "[HeatmapLayer] "
+
+using namespace osgEarth;
+
+REGISTER_OSGEARTH_LAYER(heatmap, HeatmapLayer);
+
+namespace
+{
+    // Each kernel is a quad with its corners at (-1,-1)..(1,1) in texture
+    // space; the weight rides along in the third texture coordinate.
+    const char* kernelVS =
+        "#version " GLSL_VERSION_STR "\n"
+        "out vec3 oe_heatmap_kernel; \n"
+        "void oe_heatmap_kernel_VS(inout vec4 vertex) { \n"
+        "    oe_heatmap_kernel = gl_MultiTexCoord0.xyz; \n"
+        "}\n";
+
+    const char* kernelFS =
+        "#version " GLSL_VERSION_STR "\n"
+        "in vec3 oe_heatmap_kernel; \n"
+        "void oe_heatmap_kernel_FS(inout vec4 color) { \n"
+        "    float d2 = dot(oe_heatmap_kernel.xy, oe_heatmap_kernel.xy); \n"
+        "    if (d2 >= 1.0) discard; \n"
+        "    float k = 1.0 - d2; \n"
+        "    color = vec4(oe_heatmap_kernel.z * k * k, 0.0, 0.0, 1.0); \n"
+        "}\n";
+
+    osg::Node* createKernelsNode(
+        const std::vector<osg::Vec3d>& points,
+        const std::vector<float>& weights,
+        float radius,
+        osg::StateSet* stateSet)
+    {
+        osg::ref_ptr<osg::Vec3Array> verts = new osg::Vec3Array();
+        osg::ref_ptr<osg::Vec3Array> texcoords = new osg::Vec3Array();
+        osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+
+        verts->reserve(points.size() * 4u);
+        texcoords->reserve(points.size() * 4u);
+        triangles->reserve(points.size() * 6u);
+
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            float x = points[i].x(), y = points[i].y(), w = weights[i];
+            unsigned base = verts->size();
+
+            verts->push_back(osg::Vec3(x - radius, y - radius, 0.0f));
+            verts->push_back(osg::Vec3(x + radius, y - radius, 0.0f));
+            verts->push_back(osg::Vec3(x + radius, y + radius, 0.0f));
+            verts->push_back(osg::Vec3(x - radius, y + radius, 0.0f));
+
+            texcoords->push_back(osg::Vec3(-1.0f, -1.0f, w));
+            texcoords->push_back(osg::Vec3( 1.0f, -1.0f, w));
+            texcoords->push_back(osg::Vec3( 1.0f,  1.0f, w));
+            texcoords->push_back(osg::Vec3(-1.0f,  1.0f, w));
+
+            triangles->push_back(base + 0);
+            triangles->push_back(base + 1);
+            triangles->push_back(base + 2);
+            triangles->push_back(base + 0);
+            triangles->push_back(base + 2);
+            triangles->push_back(base + 3);
+        }
+
+        osg::Geometry* geom = new osg::Geometry();
+        geom->setUseVertexBufferObjects(true);
+        geom->setUseDisplayList(false);
+        geom->setVertexArray(verts.get());
+        geom->setTexCoordArray(0, texcoords.get());
+        geom->addPrimitiveSet(triangles.get());
+        geom->setStateSet(stateSet);
+        return geom;
+    }
+
+    // Same kernel as the shader, for when there's no graphics context
+    void accumulateKernels(
+        const std::vector<osg::Vec3d>& points,
+        const std::vector<float>& weights,
+        float radius,
+        unsigned size,
+        std::vector<float>& heat)
+    {
+        float invR2 = 1.0f / (radius*radius);
+
+        for (unsigned i = 0; i < points.size(); ++i)
+        {
+            float x = points[i].x(), y = points[i].y(), w = weights[i];
+
+            int sMin = osg::maximum((int)std::floor(x - radius), 0);
+            int sMax = osg::minimum((int)std::ceil(x + radius), (int)size - 1);
+            int tMin = osg::maximum((int)std::floor(y - radius), 0);
+            int tMax = osg::minimum((int)std::ceil(y + radius), (int)size - 1);
+
+            for (int t = tMin; t <= tMax; ++t)
+            {
+                float dy = (float)t + 0.5f - y;
+                for (int s = sMin; s <= sMax; ++s)
+                {
+                    float dx = (float)s + 0.5f - x;
+                    float d2 = (dx*dx + dy*dy) * invR2;
+                    if (d2 < 1.0f)
+                    {
+                        float k = 1.0f - d2;
+                        heat[t*size + s] += w * k * k;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//........................................................................
+
+Config
+HeatmapLayer::Options::getMetadata()
+{
+    return Config::readJSON(OE_MULTILINE(
+        { "name" : "Heatmap",
+          "properties" : [
+            { "name": "features", "description" : "Feature source with the points to heat map", "type" : "layer", "default" : "" },
+            { "name": "weight_attribute", "description" : "Attribute holding each feature's weight", "type" : "string", "default" : "" },
+            { "name": "radius", "description" : "Radius of each feature's kernel in pixels", "type" : "float", "default" : "16" },
+            { "name": "max_heat", "description" : "Heat that maps to the last color of the ramp", "type" : "float", "default" : "10" },
+            { "name": "use_gpu", "description" : "Accumulate the kernels on the GPU when possible", "type" : "bool", "default" : "true" },
+          ]
+        }
+    ));
+}
+
+Config
+HeatmapLayer::Options::getConfig() const
+{
+    Config conf = ImageLayer::Options::getConfig();
+    featureSource().set(conf, "features");
+    conf.set("weight_attribute", weightAttribute());
+    conf.set("radius", radius());
+    conf.set("max_heat", maxHeat());
+    conf.set("use_gpu", useGPU());
+    if (!colors().empty())
+    {
+        Config colorsConf("colors");
+        for (auto& color : colors())
+        {
+            colorsConf.add("color", color.toHTML());
+        }
+        conf.add(colorsConf);
+    }
+    return conf;
+}
+
+void
+HeatmapLayer::Options::fromConfig(const Config& conf)
+{
+    radius().setDefault(16.0f);
+    maxHeat().setDefault(10.0f);
+    useGPU().setDefault(true);
+    colors().clear();
+
+    featureSource().get(conf, "features");
+    conf.get("weight_attribute", weightAttribute());
+    conf.get("radius", radius());
+    conf.get("max_heat", maxHeat());
+    conf.get("use_gpu", useGPU());
+    const ConfigSet colorsConf = conf.child("colors").children();
+    for (ConfigSet::const_iterator i = colorsConf.begin(); i != colorsConf.end(); ++i)
+    {
+        colors().push_back(Color(i->value()));
+    }
+}
+
+//........................................................................
+
+OE_LAYER_PROPERTY_IMPL(HeatmapLayer, std::string, WeightAttribute, weightAttribute);
+OE_LAYER_PROPERTY_IMPL(HeatmapLayer, float, Radius, radius);
+OE_LAYER_PROPERTY_IMPL(HeatmapLayer, float, MaxHeat, maxHeat);
+
+void
+HeatmapLayer::setColors(const std::vector<Color>& value)
+{
+    options().colors() = value;
+}
+
+const std::vector<Color>&
+HeatmapLayer::getColors() const
+{
+    return options().colors();
+}
+
+void
+HeatmapLayer::setFeatureSource(FeatureSource* value)
+{
+    if (value != getFeatureSource())
+    {
+        bool is_open = isOpen();
+        if (is_open) close();
+        options().featureSource().setLayer(value);
+        if (is_open) open();
+    }
+}
+
+FeatureSource*
+HeatmapLayer::getFeatureSource() const
+{
+    return options().featureSource().getLayer();
+}
+
+void
+HeatmapLayer::init()
+{
+    ImageLayer::init();
+
+    // Default profile (WGS84) if not set
+    if (!getProfile())
+    {
+        setProfile(Profile::create("global-geodetic"));
+    }
+}
+
+Status
+HeatmapLayer::openImplementation()
+{
+    Status parent = ImageLayer::openImplementation();
+    if (parent.isError())
+        return parent;
+
+    Status fsStatus = options().featureSource().open(getReadOptions());
+    if (fsStatus.isError())
+        return fsStatus;
+
+    // Build the color lookup table
+    std::vector<Color> colors = options().colors();
+    if (colors.empty())
+    {
+        colors.push_back(Color(0.0f, 0.0f, 1.0f, 0.0f));
+        colors.push_back(Color(0.0f, 0.0f, 1.0f, 0.5f));
+        colors.push_back(Color(0.0f, 1.0f, 1.0f, 0.7f));
+        colors.push_back(Color(0.0f, 1.0f, 0.0f, 0.8f));
+        colors.push_back(Color(1.0f, 1.0f, 0.0f, 0.9f));
+        colors.push_back(Color(1.0f, 0.0f, 0.0f, 1.0f));
+    }
+    else if (colors.size() == 1)
+    {
+        // fade in from transparent
+        Color clear = colors.front();
+        clear.a() = 0.0f;
+        colors.insert(colors.begin(), clear);
+    }
+
+    _ramp.resize(256);
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        float t = (float)i / 255.0f * (float)(colors.size() - 1);
+        unsigned k = osg::minimum((unsigned)t, (unsigned)colors.size() - 2u);
+        float f = t - (float)k;
+        osg::Vec4f c = colors[k]*(1.0f - f) + colors[k + 1]*f;
+        _ramp[i].set(
+            (unsigned char)(c.r()*255.0f + 0.5f),
+            (unsigned char)(c.g()*255.0f + 0.5f),
+            (unsigned char)(c.b()*255.0f + 0.5f),
+            (unsigned char)(c.a()*255.0f + 0.5f));
+    }
+
+    if (options().useGPU() == true && _rasterizer == nullptr)
+    {
+        // A float target so the kernels can add up past 1.0
+        _rasterizer = std::make_shared<TileRasterizer>(getTileSize(), getTileSize(), 0u, GL_R32F);
+
+        _kernelStateSet = new osg::StateSet();
+        _kernelStateSet->setAttributeAndModes(new osg::BlendFunc(GL_ONE, GL_ONE), 1);
+        VirtualProgram* vp = VirtualProgram::getOrCreate(_kernelStateSet.get());
+        vp->setName("HeatmapLayer kernels");
+        vp->setFunction("oe_heatmap_kernel_VS", kernelVS, ShaderComp::LOCATION_VERTEX_MODEL);
+        vp->setFunction("oe_heatmap_kernel_FS", kernelFS, ShaderComp::LOCATION_FRAGMENT_COLORING);
+    }
+
+    return Status::NoError;
+}
+
+Status
+HeatmapLayer::closeImplementation()
+{
+    _rasterizer = nullptr;
+    _kernelStateSet = nullptr;
+    return ImageLayer::closeImplementation();
+}
+
+void
+HeatmapLayer::addedToMap(const Map* map)
+{
+    ImageLayer::addedToMap(map);
+    options().featureSource().addedToMap(map);
+}
+
+void
+HeatmapLayer::removedFromMap(const Map* map)
+{
+    options().featureSource().removedFromMap(map);
+    ImageLayer::removedFromMap(map);
+}
+
+bool
+HeatmapLayer::getPoints(
+    const TileKey& key,
+    std::vector<osg::Vec3d>& points,
+    std::vector<float>& weights,
+    ProgressCallback* progress) const
+{
+    FeatureSource* fs = getFeatureSource();
+    const FeatureProfile* fp = fs->getFeatureProfile();
+    const SpatialReference* featureSRS = fp->getSRS();
+
+    const GeoExtent& extent = key.getExtent();
+    unsigned size = getTileSize();
+    float radius = osg::maximum(options().radius().get(), 1.0f);
+
+    // Features within the kernel radius of the tile contribute to it
+    double bufferX = extent.width() * radius / (double)size;
+    double bufferY = extent.height() * radius / (double)size;
+
+    osg::ref_ptr<FeatureCursor> cursor;
+    Query query;
+
+    if (fp->isTiled())
+    {
+        // tiled sources need a key; ask for the neighbors too
+        cursor = fs->createFeatureCursor(
+            key,
+            Distance(osg::maximum(bufferX, bufferY), extent.getSRS()->getUnits()),
+            progress);
+    }
+    else
+    {
+        GeoExtent queryExtent(
+            extent.getSRS(),
+            extent.xMin() - bufferX, extent.yMin() - bufferY,
+            extent.xMax() + bufferX, extent.yMax() + bufferY);
+
+        GeoExtent localExtent = queryExtent.transform(featureSRS);
+        if (!localExtent.isValid())
+            return false;
+
+        query.bounds() = localExtent.bounds();
+
+        if (options().weightAttribute().isSet())
+        {
+            cursor = fs->createFeatureCursor(query, progress);
+        }
+        else
+        {
+            // Only the locations are needed, so skip building the features
+            FeatureSource::FeatureBoundsList list;
+            if (!fs->getFeatureBounds(query, list, progress))
+                return false;
+
+            points.reserve(list.size());
+            for (auto& entry : list)
+            {
+                osg::Vec2d center = entry.bounds.center2d();
+                points.push_back(osg::Vec3d(center.x(), center.y(), 0.0));
+            }
+            weights.assign(points.size(), 1.0f);
+        }
+    }
+
+    if (cursor.valid())
+    {
+        const std::string& attr = options().weightAttribute().get();
+        bool weighted = options().weightAttribute().isSet();
+
+        while (cursor->hasMore())
+        {
+            Feature* feature = cursor->nextFeature();
+            if (feature && feature->getGeometry())
+            {
+                osg::Vec2d center = feature->getGeometry()->getBounds().center2d();
+                points.push_back(osg::Vec3d(center.x(), center.y(), 0.0));
+                weights.push_back(weighted ? (float)feature->getDouble(attr, 1.0) : 1.0f);
+            }
+        }
+    }
+
+    if (progress && progress->isCanceled())
+        return false;
+
+    // to pixel coordinates of the tile
+    featureSRS->transform(points, extent.getSRS());
+
+    double scaleX = (double)size / extent.width();
+    double scaleY = (double)size / extent.height();
+    for (auto& p : points)
+    {
+        p.set((p.x() - extent.xMin()) * scaleX, (p.y() - extent.yMin()) * scaleY, 0.0);
+    }
+
+    return true;
+}
+
+GeoImage
+HeatmapLayer::createImageImplementation(const TileKey& key, ProgressCallback* progress) const
+{
+    OE_PROFILING_ZONE;
+
+    if (getStatus().isError())
+    {
+        return GeoImage::INVALID;
+    }
+
+    if (!getFeatureSource())
+    {
+        setStatus(Status::ServiceUnavailable, "No feature source");
+        return GeoImage::INVALID;
+    }
+
+    if (!getFeatureSource()->getFeatureProfile())
+    {
+        setStatus(Status::ConfigurationError, "Feature profile is missing");
+        return GeoImage::INVALID;
+    }
+
+    std::vector<osg::Vec3d> points;
+    std::vector<float> weights;
+    if (!getPoints(key, points, weights, progress))
+    {
+        return GeoImage::INVALID;
+    }
+
+    unsigned size = getTileSize();
+    float radius = osg::maximum(options().radius().get(), 1.0f);
+
+    std::vector<float> heat(size*size, 0.0f);
+
+    if (!points.empty())
+    {
+        // The GPU rasterizer needs a live graphics context; without one
+        // (e.g. when seeding headless) sum the kernels here.
+        if (_rasterizer != nullptr && TileRasterizer::isAvailable())
+        {
+            OE_PROFILING_ZONE_NAMED("Rasterize");
+
+            osg::ref_ptr<osg::Node> node = createKernelsNode(points, weights, radius, _kernelStateSet.get());
+
+            Future<osg::ref_ptr<osg::Image>> result = _rasterizer->render(
+                node.get(),
+                osg::Matrix::ortho2D(0.0, size, 0.0, size));
+
+            osg::ref_ptr<osg::Image> rendered = result.get(progress);
+
+            if (progress && progress->isCanceled())
+                return GeoImage::INVALID;
+
+            // a null result means nothing was drawn
+            if (rendered.valid())
+            {
+                ::memcpy(&heat[0], rendered->data(), size*size*sizeof(float));
+            }
+        }
+        else
+        {
+            OE_PROFILING_ZONE_NAMED("Accumulate");
+            accumulateKernels(points, weights, radius, size, heat);
+        }
+    }
+
+    // apply the color ramp
+    osg::ref_ptr<osg::Image> image = new osg::Image();
+    image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    osg::Vec4ub* pixels = reinterpret_cast<osg::Vec4ub*>(image->data());
+    float scale = 255.0f / osg::maximum(options().maxHeat().get(), FLT_MIN);
+
+    for (unsigned i = 0; i < size*size; ++i)
+    {
+        if (heat[i] > 0.0f)
+            pixels[i] = _ramp[(unsigned)osg::minimum(heat[i] * scale, 255.0f)];
+        else
+            pixels[i].set(0, 0, 0, 0);
+    }
+
+    return GeoImage(image.get(), key.getExtent());
+}
@@ -19,6 +19,7 @@
  */
 
 #include <osgEarth/HeightFieldUtils>
+#include <osgEarth/RasterPool>
 #include <osgEarth/CullingUtils>
 
 using namespace osgEarth;
@@ -426,8 +427,7 @@ HeightFieldUtils::createSubSample(const osg::HeightField* input,
     double dy = div * yInterval;
 
 
-    osg::HeightField* dest = new osg::HeightField();
-    dest->allocate( numCols, numRows );
+    osg::HeightField* dest = RasterPool::createHeightField( numCols, numRows );
     dest->setXInterval( dx );
     dest->setYInterval( dy );
     dest->setBorderWidth( input->getBorderWidth() );
@@ -474,8 +474,7 @@ HeightFieldUtils::resampleHeightField(osg::HeightField*      input,
     double stepX = spanX/(double)(newColumns-1);
     double stepY = spanY/(double)(newRows-1);
 
-    osg::HeightField* output = new osg::HeightField();
-    output->allocate( newColumns, newRows );
+    osg::HeightField* output = RasterPool::createHeightField( newColumns, newRows );
     output->setXInterval( stepX );
     output->setYInterval( stepY );
     output->setOrigin( origin );
@@ -494,6 +493,24 @@ HeightFieldUtils::resampleHeightField(osg::HeightField*      input,
     return output;
 }
 
+bool
+HeightFieldUtils::isUniform(const osg::HeightField* hf, float& out_height)
+{
+    if (!hf || hf->getHeightList().empty())
+        return false;
+
+    const osg::HeightField::HeightList& heights = hf->getHeightList();
+    float first = heights.front();
+    for (osg::HeightField::HeightList::const_iterator i = heights.begin(); i != heights.end(); ++i)
+    {
+        if (*i != first)
+            return false;
+    }
+
+    out_height = first;
+    return true;
+}
+
 
 osg::HeightField*
 HeightFieldUtils::createReferenceHeightField(const GeoExtent& ex,
@@ -502,9 +519,7 @@ HeightFieldUtils::createReferenceHeightField(const GeoExtent& ex,
                                              unsigned         border,
                                              bool             expressAsHAE)
 {
-    osg::HeightField* hf = new osg::HeightField();
-
-    hf->allocate( numCols + 2*border, numRows + 2*border );
+    osg::HeightField* hf = RasterPool::createHeightField( numCols + 2*border, numRows + 2*border );
 
     hf->setXInterval( ex.width() / (double)(numCols-1) );
     hf->setYInterval( ex.height() / (double)(numRows-1) );
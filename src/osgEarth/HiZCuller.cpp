@@ -0,0 +1,398 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/HiZCuller>
+#include <osgEarth/CullingUtils>
+#include <osgEarth/GLUtils>
+#include <osgEarth/Utils>
+#include <osgEarth/Metrics>
+#include <osgUtil/CullVisitor>
+#include <osg/ColorMask>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+#ifndef GL_DEPTH_COMPONENT32F
+#define GL_DEPTH_COMPONENT32F 0x8CAC
+#endif
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[HiZCuller] "
+
+namespace
+{
+    // frames of matrices to keep while waiting for their depth
+    const unsigned MAX_PENDING_FRAMES = 8u;
+}
+
+// Reads the depth texture back through a pair of PBOs, so the draw
+// thread never waits for the GPU (same scheme as the RTTPicker).
+struct HiZCuller::Readback : public osg::Camera::DrawCallback
+{
+    Readback(HiZCuller* culler, osg::Texture2D* tex) :
+        _culler(culler),
+        _tex(tex)
+    {
+        _size = tex->getTextureWidth() * tex->getTextureHeight();
+        _depth.resize(_size);
+    }
+
+    osg::observer_ptr<HiZCuller> _culler;
+    osg::ref_ptr<osg::Texture2D> _tex;
+    unsigned _size;
+    mutable std::vector<float> _depth;
+
+    struct Slot
+    {
+        Slot() : _pbo(0), _sync(0), _frame(0u), _pending(false) { }
+        GLuint _pbo;
+        GLsync _sync;
+        unsigned _frame;
+        bool _pending;
+    };
+
+    struct GLObjects
+    {
+        GLObjects() : _next(0u) { }
+        Slot _slots[2];
+        unsigned _next;
+    };
+    mutable osg::buffered_object<GLObjects> _gl;
+
+    void operator () (osg::RenderInfo& renderInfo) const
+    {
+        osg::State* state = renderInfo.getState();
+        osg::GLExtensions* ext = osg::GLExtensions::Get(state->getContextID(), true);
+        GLFunctions& gl = GLFunctions::get(*state);
+        unsigned frame = state->getFrameStamp() ? state->getFrameStamp()->getFrameNumber() : 0u;
+
+        state->setActiveTextureUnit(0);
+        state->applyTextureAttribute(0, _tex.get());
+
+        // without PBOs or fences, reading back would stall every frame
+        if (!ext->isPBOSupported || !gl.glFenceSync || !gl.glClientWaitSync || !gl.glDeleteSync)
+            return;
+
+        GLObjects& glo = _gl[state->getContextID()];
+        std::size_t bytes = _size * sizeof(float);
+
+        // collect finished transfers, oldest first, without waiting
+        for (unsigned k = 0; k < 2; ++k)
+        {
+            Slot& slot = glo._slots[(glo._next + k) % 2];
+            if (!slot._pending)
+                continue;
+
+            GLenum status = gl.glClientWaitSync(slot._sync, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+                break;
+
+            gl.glDeleteSync(slot._sync);
+            slot._sync = 0;
+            slot._pending = false;
+
+            if (status != GL_WAIT_FAILED)
+            {
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+                const void* pixels = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+                if (pixels)
+                {
+                    ::memcpy(_depth.data(), pixels, bytes);
+                    ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+
+                    osg::ref_ptr<HiZCuller> culler;
+                    if (_culler.lock(culler))
+                        culler->setDepth(slot._frame, _depth.data());
+                }
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+            }
+        }
+
+        // start this frame's transfer, unless both buffers are still in flight
+        Slot& slot = glo._slots[glo._next];
+        if (!slot._pending)
+        {
+            if (slot._pbo == 0)
+            {
+                ext->glGenBuffers(1, &slot._pbo);
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+                ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, bytes, 0, GL_STREAM_READ);
+            }
+
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+            slot._sync = gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            slot._frame = frame;
+            slot._pending = true;
+            glo._next = (glo._next + 1) % 2;
+        }
+    }
+};
+
+HiZCuller*
+HiZCuller::install(osg::Camera* camera, osg::Node* occluders, unsigned size)
+{
+    if (!camera || !occluders)
+        return NULL;
+
+    uninstall(camera);
+
+    HiZCuller* culler = new HiZCuller(camera, occluders, size);
+    camera->addCullCallback(culler);
+    ObjectStorage::set(camera, culler);
+    return culler;
+}
+
+void
+HiZCuller::uninstall(osg::Camera* camera)
+{
+    osg::ref_ptr<HiZCuller> culler;
+    if (camera && ObjectStorage::get(camera, culler))
+    {
+        camera->removeCullCallback(culler.get());
+    }
+}
+
+HiZCuller*
+HiZCuller::get(osgUtil::CullVisitor* cv)
+{
+    osg::Camera* camera = cv ? cv->getCurrentCamera() : NULL;
+    osg::ref_ptr<HiZCuller> culler;
+    // the camera's cull callback chain holds the reference
+    return ObjectStorage::get(camera, culler) ? culler.get() : NULL;
+}
+
+HiZCuller::HiZCuller(osg::Camera* camera, osg::Node* occluders, unsigned size) :
+    _size(osg::maximum(osg::Image::computeNearestPowerOfTwo(size), 4)),
+    _maxAge(4u),
+    _camera(camera)
+{
+    _depthTex = new osg::Texture2D();
+    _depthTex->setTextureSize(_size, _size);
+    _depthTex->setInternalFormat(GL_DEPTH_COMPONENT32F);
+    _depthTex->setSourceFormat(GL_DEPTH_COMPONENT);
+    _depthTex->setSourceType(GL_FLOAT);
+    _depthTex->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    _depthTex->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    _depthTex->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _depthTex->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+
+    // The occluder camera gets the host camera's matrices every frame in
+    // the cull callback, so it uses them as-is rather than computing its
+    // own near and far planes.
+    _depthCamera = new osg::Camera();
+    _depthCamera->setName("osgEarth::HiZCuller");
+    _depthCamera->addChild(occluders);
+    _depthCamera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+    _depthCamera->setClearDepth(1.0);
+    _depthCamera->setClearMask(GL_DEPTH_BUFFER_BIT);
+    _depthCamera->setViewport(0, 0, _size, _size);
+    _depthCamera->setRenderOrder(osg::Camera::PRE_RENDER);
+    _depthCamera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    _depthCamera->attach(osg::Camera::DEPTH_BUFFER, _depthTex.get());
+    _depthCamera->setDrawBuffer(GL_NONE);
+    _depthCamera->setReadBuffer(GL_NONE);
+    _depthCamera->setInheritanceMask(
+        _depthCamera->getInheritanceMask() & ~osg::CullSettings::COMPUTE_NEAR_FAR_MODE);
+    _depthCamera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+    _depthCamera->setPostDrawCallback(new Readback(this, _depthTex.get()));
+
+    // depth only
+    _depthCamera->getOrCreateStateSet()->setAttributeAndModes(
+        new osg::ColorMask(false, false, false, false),
+        osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+}
+
+void
+HiZCuller::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    osgUtil::CullVisitor* cv = Culling::asCullVisitor(nv);
+    osg::Camera* camera = dynamic_cast<osg::Camera*>(node);
+
+    if (cv && camera && nv->getFrameStamp())
+    {
+        OE_PROFILING_ZONE;
+
+        unsigned frame = nv->getFrameStamp()->getFrameNumber();
+        const osg::Matrixd& view = camera->getViewMatrix();
+        const osg::Matrixd& proj = camera->getProjectionMatrix();
+
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            _matrices.push_back(std::make_pair(frame, view * proj));
+            while (_matrices.size() > MAX_PENDING_FRAMES)
+                _matrices.pop_front();
+        }
+
+        _depthCamera->setViewMatrix(view);
+        _depthCamera->setProjectionMatrix(proj);
+        _depthCamera->setCullMask(camera->getCullMask());
+        _depthCamera->accept(*nv);
+    }
+
+    traverse(node, nv);
+}
+
+void
+HiZCuller::setDepth(unsigned frame, const float* depth)
+{
+    std::shared_ptr<Pyramid> p = std::make_shared<Pyramid>();
+    p->_frame = frame;
+    p->_size = _size;
+
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        while (!_matrices.empty() && _matrices.front().first < frame)
+            _matrices.pop_front();
+        if (_matrices.empty() || _matrices.front().first != frame)
+            return;
+        p->_viewProjection = _matrices.front().second;
+    }
+
+    // level 0 is the depth itself; each level above holds the farthest
+    // depth of the 2x2 texels below it
+    p->_levels.emplace_back(depth, depth + _size*_size);
+    for (unsigned s = _size / 2u; s >= 1u; s /= 2u)
+    {
+        const std::vector<float>& below = p->_levels.back();
+        std::vector<float> level(s*s);
+        unsigned bs = s * 2u;
+        for (unsigned y = 0; y < s; ++y)
+        {
+            for (unsigned x = 0; x < s; ++x)
+            {
+                const float* r0 = &below[(2u*y)*bs + 2u*x];
+                const float* r1 = r0 + bs;
+                level[y*s + x] = osg::maximum(
+                    osg::maximum(r0[0], r0[1]),
+                    osg::maximum(r1[0], r1[1]));
+            }
+        }
+        p->_levels.push_back(std::move(level));
+    }
+
+    Threading::ScopedMutexLock lock(_mutex);
+    _pyramid = p;
+}
+
+bool
+HiZCuller::isOccluded(
+    osgUtil::CullVisitor* cv,
+    const osg::BoundingBoxd& box,
+    const osg::Matrixd* localToModel) const
+{
+    if (!box.valid() || !cv->getFrameStamp())
+        return false;
+
+    std::shared_ptr<const Pyramid> p;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        p = _pyramid;
+    }
+
+    if (!p || cv->getFrameStamp()->getFrameNumber() > p->_frame + _maxAge)
+        return false;
+
+    // box coordinates -> world -> clip space of the frame the depth came from
+    osg::Matrixd m = (*cv->getModelViewMatrix()) * cv->getCurrentCamera()->getInverseViewMatrix();
+    if (localToModel)
+        m.preMult(*localToModel);
+    m.postMult(p->_viewProjection);
+
+    double xmin = DBL_MAX, ymin = DBL_MAX, xmax = -DBL_MAX, ymax = -DBL_MAX, zmin = DBL_MAX;
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        osg::Vec4d clip = osg::Vec4d(box.corner(i), 1.0) * m;
+
+        // crosses the near plane, so it's up close and visible
+        if (clip.w() <= 1e-6)
+            return false;
+
+        double x = clip.x() / clip.w(), y = clip.y() / clip.w(), z = clip.z() / clip.w();
+        xmin = osg::minimum(xmin, x), xmax = osg::maximum(xmax, x);
+        ymin = osg::minimum(ymin, y), ymax = osg::maximum(ymax, y);
+        zmin = osg::minimum(zmin, z);
+    }
+
+    // off screen is for the frustum to decide
+    if (xmax < -1.0 || xmin > 1.0 || ymax < -1.0 || ymin > 1.0 || zmin < -1.0)
+        return false;
+
+    // NDC -> texels of level 0
+    double size = (double)p->_size;
+    double x0 = (osg::clampBetween(xmin, -1.0, 1.0)*0.5 + 0.5) * size;
+    double x1 = (osg::clampBetween(xmax, -1.0, 1.0)*0.5 + 0.5) * size;
+    double y0 = (osg::clampBetween(ymin, -1.0, 1.0)*0.5 + 0.5) * size;
+    double y1 = (osg::clampBetween(ymax, -1.0, 1.0)*0.5 + 0.5) * size;
+    float depth = (float)(zmin*0.5 + 0.5);
+
+    // the level where the rectangle spans about two texels
+    unsigned level = 0u;
+    double extent = osg::maximum(x1 - x0, y1 - y0);
+    while (extent > 2.0 && level + 1u < p->_levels.size())
+    {
+        extent *= 0.5;
+        ++level;
+    }
+
+    // The occluders were drawn at one sample per texel, so the rectangle
+    // grows by a texel to cover depth between the samples.
+    int s = (int)(p->_size >> level);
+    double scale = 1.0 / (double)(1u << level);
+    int ix0 = osg::clampBetween((int)std::floor(x0*scale) - 1, 0, s - 1);
+    int ix1 = osg::clampBetween((int)std::floor(x1*scale) + 1, 0, s - 1);
+    int iy0 = osg::clampBetween((int)std::floor(y0*scale) - 1, 0, s - 1);
+    int iy1 = osg::clampBetween((int)std::floor(y1*scale) + 1, 0, s - 1);
+
+    const std::vector<float>& texels = p->_levels[level];
+    for (int y = iy0; y <= iy1; ++y)
+    {
+        for (int x = ix0; x <= ix1; ++x)
+        {
+            if (depth <= texels[y*s + x])
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void
+HiZCullCallback::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    osgUtil::CullVisitor* cv = Culling::asCullVisitor(nv);
+    HiZCuller* culler = cv ? HiZCuller::get(cv) : NULL;
+    if (culler)
+    {
+        const osg::BoundingSphere& bs = node->getBound();
+        if (bs.valid())
+        {
+            osg::Vec3d c(bs.center());
+            double r = bs.radius();
+            osg::BoundingBoxd box(c.x() - r, c.y() - r, c.z() - r, c.x() + r, c.y() + r, c.z() + r);
+            if (culler->isOccluded(cv, box))
+                return;
+        }
+    }
+    traverse(node, nv);
+}
@@ -51,6 +51,56 @@ void StringObject::setString( const std::string& value )
 
 //----------------------------------------------------------------------------
 
+ByteBufferStream::StreamBuf::StreamBuf(const ByteBuffer* buffer) :
+    _buffer(buffer)
+{
+    // std::streambuf wants mutable pointers, but only ever reads through the get area
+    char* begin = _buffer.valid() ? const_cast<char*>(_buffer->ptr()) : 0L;
+    char* end = begin ? begin + _buffer->size() : 0L;
+    setg(begin, begin, end);
+}
+
+std::streambuf::pos_type
+ByteBufferStream::StreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if ((which & std::ios_base::in) == 0)
+        return pos_type(off_type(-1));
+
+    off_type base =
+        dir == std::ios_base::beg ? 0 :
+        dir == std::ios_base::cur ? gptr() - eback() :
+                                    egptr() - eback();
+
+    off_type pos = base + off;
+    if (pos < 0 || pos > egptr() - eback())
+        return pos_type(off_type(-1));
+
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+}
+
+std::streambuf::pos_type
+ByteBufferStream::StreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+ByteBufferStream::ByteBufferStream(const ByteBuffer* buffer) :
+    std::istream(0L),
+    _streamBuf(buffer)
+{
+    rdbuf(&_streamBuf);
+}
+
+const ByteBuffer*
+ByteBufferStream::getBuffer(std::istream& in)
+{
+    StreamBuf* buf = dynamic_cast<StreamBuf*>(in.rdbuf());
+    return buf ? buf->_buffer.get() : 0L;
+}
+
+//----------------------------------------------------------------------------
+
 ProxySettings::ProxySettings( const Config& conf )
 {
     mergeConfig( conf );
@@ -18,6 +18,7 @@
  */
 #include <osgEarth/ImageLayer>
 #include <osgEarth/ImageMosaic>
+#include <osgEarth/ImageUtils>
 #include <osgEarth/Registry>
 #include <osgEarth/Progress>
 #include <osgEarth/Capabilities>
@@ -26,13 +27,45 @@
 #include <cinttypes>
 
 using namespace osgEarth;
+using namespace osgEarth::Threading;
 
 #define LC "[ImageLayer] \"" << getName() << "\" "
 
+#define ARENA_ASYNC_LAYER "oe.layer.async"
+
+// Cache metadata field marking a tile the source has no data for
+#define EMPTY_TILE_FIELD "oe.empty_tile"
+#define EMPTY_TILE_MISSING "missing"
+#define EMPTY_TILE_TRANSPARENT "transparent"
+#define EMPTY_TILE_UNIFORM "uniform"
+#define UNIFORM_TILE_WIDTH "oe.uniform_width"
+#define UNIFORM_TILE_HEIGHT "oe.uniform_height"
+
 // TESTING
 //#undef  OE_DEBUG
 //#define OE_DEBUG OE_INFO
 
+namespace
+{
+    // Progress for an asynchronous image request. Reports cancelation
+    // once nobody is waiting on the result any longer.
+    struct AsyncImageRequest : public ProgressCallback
+    {
+        AsyncImageRequest(ProgressCallback* progress) : _progress(progress) { }
+
+        bool isCanceled() const override
+        {
+            return
+                ProgressCallback::isCanceled() ||
+                _promise.isAbandoned() ||
+                (_progress.valid() && _progress->isCanceled());
+        }
+
+        Promise<GeoImage> _promise;
+        osg::ref_ptr<ProgressCallback> _progress;
+    };
+}
+
 //------------------------------------------------------------------------
 
 void
@@ -42,6 +75,8 @@ ImageLayer::Options::fromConfig(const Config& conf)
     _minFilter.setDefault( osg::Texture::LINEAR_MIPMAP_LINEAR );
     _magFilter.setDefault( osg::Texture::LINEAR );
     _textureCompression.setDefault("");
+    _cacheCompressed.setDefault(false);
+    _cacheEmptyTiles.setDefault(true);
     _shared.setDefault( false );
     _coverage.setDefault( false );
     _reprojectedTileSize.setDefault( 256 );
@@ -77,6 +112,8 @@ ImageLayer::Options::fromConfig(const Config& conf)
     conf.get("min_filter","NEAREST_MIPMAP_NEAREST",_minFilter,osg::Texture::NEAREST_MIPMAP_NEAREST);
 
     conf.get("texture_compression", textureCompression());
+    conf.get("cache_compressed", cacheCompressed());
+    conf.get("cache_empty_tiles", cacheEmptyTiles());
 
     // uniform names
     conf.get("shared_sampler", _shareTexUniformName);
@@ -124,6 +161,8 @@ ImageLayer::Options::getConfig() const
     conf.set("min_filter","NEAREST_MIPMAP_NEAREST",_minFilter,osg::Texture::NEAREST_MIPMAP_NEAREST);
 
     conf.set("texture_compression", textureCompression());
+    conf.set("cache_compressed", cacheCompressed());
+    conf.set("cache_empty_tiles", cacheEmptyTiles());
 
     // uniform names
     conf.set("shared_sampler", _shareTexUniformName);
@@ -198,6 +237,30 @@ ImageLayer::getAsyncLoading() const
     return options().async().get();
 }
 
+void
+ImageLayer::setCacheCompressed(bool value)
+{
+    options().cacheCompressed() = value;
+}
+
+bool
+ImageLayer::getCacheCompressed() const
+{
+    return options().cacheCompressed().get();
+}
+
+void
+ImageLayer::setCacheEmptyTiles(bool value)
+{
+    options().cacheEmptyTiles() = value;
+}
+
+bool
+ImageLayer::getCacheEmptyTiles() const
+{
+    return options().cacheEmptyTiles().get();
+}
+
 ImageLayer*
 ImageLayer::create(const ConfigOptions& options)
 {
@@ -237,6 +300,9 @@ ImageLayer::init()
 
     _useCreateTexture = false;
 
+    // holds sibling images fetched as part of a meta-tile block
+    _metaTileCache = std::make_shared<MetaTileCache>(true, 64u);
+
     // image layers render as a terrain texture.
     setRenderType(RENDERTYPE_TERRAIN_SURFACE);
 
@@ -368,6 +434,8 @@ ImageLayer::createImage(
         return GeoImage::INVALID;
     }
 
+    _stats.count(_stats._requests);
+
     NetworkMonitor::ScopedRequestLayer layerRequest(getName());
 
     // prevents 2 threads from creating the same object at the same time
@@ -404,29 +472,147 @@ ImageLayer::createImageInKeyProfile(
     OE_DEBUG << LC << "create image for \"" << key.str() << "\", ext= "
         << key.getExtent().toString() << std::endl;
 
+    osg::ref_ptr< osg::Image > cachedImage;
+
+    if (readCachedImage(key, result, cachedImage))
+    {
+        return result;
+    }
+
+    std::chrono::steady_clock::time_point sourceStart = std::chrono::steady_clock::now();
+
+    if (key.getProfile()->isHorizEquivalentTo(getProfile()))
+    {
+        if (getMetaTileSize() > 1u)
+            result = createImageFromMetaTile(key, progress);
+        else
+            result = createImageImplementation(key, progress);
+    }
+    else
+    {
+        // If the profiles are different, use a compositing method to assemble the tile.
+        result = assembleImage( key, progress );
+    }
+
+    // Check for cancelation before writing to a cache:
+    if (progress && progress->isCanceled())
+    {
+        return GeoImage::INVALID;
+    }
+
+    _stats.sourceRead(
+        sourceStart,
+        result.valid(),
+        result.getStatus(),
+        result.valid() ? result.getImage()->getTotalSizeInBytes() : 0u);
+
+    return completeImage(key, result, cachedImage.get());
+}
+
+GeoImage
+ImageLayer::createImageFromMetaTile(
+    const TileKey& key,
+    ProgressCallback* progress)
+{
+    unsigned size = getMetaTileSize();
+    unsigned lod = key.getLOD();
+
+    unsigned tx, ty;
+    key.getTileXY(tx, ty);
+
+    unsigned numCols, numRows;
+    key.getProfile()->getNumTiles(lod, numCols, numRows);
+
+    // the block of tiles containing this key:
+    unsigned x0 = tx - (tx % size), y0 = ty - (ty % size);
+    unsigned x1 = osg::minimum(x0 + size, numCols);
+    unsigned y1 = osg::minimum(y0 + size, numRows);
+
+    // Only one request per block at a time. Siblings that arrive while
+    // the block is loading wait here and then find their image below.
+    std::string blockName = Stringify() << getRevision() << "/" << lod << "/" << x0 << "/" << y0;
+    ScopedGate<std::string> lockBlock(_metaTileGate, blockName);
+
+    std::string tileName = Stringify() << getRevision() << "/" << key.str();
+    MetaTileCache::Record rec;
+    if (_metaTileCache->get(tileName, rec))
+    {
+        // each sibling is requested once, so there's no reason to keep it.
+        _metaTileCache->erase(tileName);
+        return rec.value();
+    }
+
+    std::vector<TileKey> keys;
+    for (unsigned y = y0; y < y1; ++y)
+        for (unsigned x = x0; x < x1; ++x)
+            keys.push_back(TileKey(lod, x, y, key.getProfile()));
+
+    std::vector<GeoImage> images;
+    if (!createImageBlockImplementation(keys, images, progress) ||
+        images.size() != keys.size())
+    {
+        return createImageImplementation(key, progress);
+    }
+
+    if (progress && progress->isCanceled())
+    {
+        return GeoImage::INVALID;
+    }
+
+    GeoImage result;
+    for (unsigned i = 0; i < keys.size(); ++i)
+    {
+        if (keys[i] == key)
+            result = images[i];
+        else if (images[i].valid())
+            _metaTileCache->insert(Stringify() << getRevision() << "/" << keys[i].str(), images[i]);
+    }
+    return result;
+}
+
+void
+ImageLayer::writeEmptyTileRecord(
+    CacheBin* bin,
+    const CacheBin::TileRecordKey& key,
+    const std::string& reason)
+{
+    // A single transparent pixel stands in for the tile, so every cache
+    // driver can store it; the metadata field is what marks it.
+    Config meta;
+    meta.set(EMPTY_TILE_FIELD, reason);
+    bin->write(key, ImageUtils::createEmptyImage(), meta, 0L);
+}
+
+bool
+ImageLayer::readCachedImage(
+    const TileKey& key,
+    GeoImage& result,
+    osg::ref_ptr<osg::Image>& cachedImage)
+{
     // the cache key combines the Key and the horizontal profile.
-    std::string cacheKey = Cache::makeCacheKey(
-        Stringify() << key.str() << "-" << std::hex << key.getProfile()->getHorizSignature(),
-        "image");
+    CacheBin::TileRecordKey cacheKey(key, "image");
 
     // The L2 cache key includes the layer revision of course!
-    char memCacheKey[64];
+    char memCacheKey[96];
 
     const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
 
     // Check the layer L2 cache first
     if ( _memCache.valid() )
     {
-        sprintf(memCacheKey, "%d/%s/%s", 
-            getRevision(), 
+        sprintf(memCacheKey, "%d/%u/%s/%s",
+            getRevision(),
+            getDirtyRegionRevision(key),
             key.str().c_str(), 
             key.getProfile()->getHorizSignature().c_str());
 
         CacheBin* bin = _memCache->getOrCreateDefaultBin();
-        ReadResult result = bin->readObject(memCacheKey, 0L);
-        if (result.succeeded())
+        ReadResult r = bin->readObject(memCacheKey, 0L);
+        if (r.succeeded())
         {
-            return GeoImage(static_cast<osg::Image*>(result.releaseObject()), key.getExtent());
+            _stats.count(_stats._memCacheHits);
+            result = GeoImage(static_cast<osg::Image*>(r.releaseObject()), key.getExtent());
+            return true;
         }
     }
 
@@ -438,24 +624,59 @@ ImageLayer::createImageInKeyProfile(
     if ( !policy.isCacheOnly() && !getProfile() )
     {
         disable("Could not establish a valid profile");
-        return GeoImage::INVALID;
+        result = GeoImage::INVALID;
+        return true;
     }
 
-    osg::ref_ptr< osg::Image > cachedImage;
-
     // First, attempt to read from the cache. Since the cached data is stored in the
     // map profile, we can try this first.
     if ( cacheBin && policy.isCacheReadable() )
     {
-        ReadResult r = cacheBin->readImage(cacheKey, 0L);
-        if ( r.succeeded() )
+        ReadResult r;
+        {
+            ScopedCacheTimer timeRead(_stats._cacheReadTime);
+            r = cacheBin->readImage(cacheKey, 0L);
+        }
+        _stats.count(r.succeeded() ? _stats._cacheHits : _stats._cacheMisses);
+        if (r.succeeded() && r.getImage())
+            _stats.count(_stats._cacheBytes, r.getImage()->getTotalSizeInBytes());
+        if ( r.succeeded() && r.metadata().value(EMPTY_TILE_FIELD) == EMPTY_TILE_UNIFORM )
+        {
+            // One pixel stands in for a single-color tile; rebuild the
+            // full tile so callers see the same image they cached.
+            cachedImage = ImageUtils::expandUniformImage(
+                r.getImage(),
+                r.metadata().value<unsigned>(UNIFORM_TILE_WIDTH, getTileSize()),
+                r.metadata().value<unsigned>(UNIFORM_TILE_HEIGHT, getTileSize()));
+
+            if (cachedImage.valid() && !isCachedTileExpired(key, r.lastModifiedTime()))
+            {
+                result = GeoImage( cachedImage.get(), key.getExtent() );
+                return true;
+            }
+        }
+        else if ( r.succeeded() && r.metadata().hasValue(EMPTY_TILE_FIELD) )
+        {
+            // The source had nothing for this tile last time; unless the
+            // record has expired, don't ask again.
+            if (!isCachedTileExpired(key, r.lastModifiedTime()))
+            {
+                if (r.metadata().value(EMPTY_TILE_FIELD) == EMPTY_TILE_TRANSPARENT)
+                    result = GeoImage(ImageUtils::createEmptyImage(getTileSize(), getTileSize()), key.getExtent());
+                else
+                    result = GeoImage::INVALID;
+                return true;
+            }
+        }
+        else if ( r.succeeded() )
         {
             cachedImage = r.releaseImage();
-            bool expired = policy.isExpired(r.lastModifiedTime());
+            bool expired = isCachedTileExpired(key, r.lastModifiedTime());
             if (!expired)
             {
                 OE_DEBUG << "Got cached image for " << key.str() << std::endl;
-                return GeoImage( cachedImage.get(), key.getExtent() );
+                result = GeoImage( cachedImage.get(), key.getExtent() );
+                return true;
             }
             else
             {
@@ -470,43 +691,81 @@ ImageLayer::createImageInKeyProfile(
         // If it's cache only and we have an expired but cached image, just return it.
         if (cachedImage.valid())
         {
-            return GeoImage( cachedImage.get(), key.getExtent() );
+            result = GeoImage( cachedImage.get(), key.getExtent() );
         }
         else
         {
-            return GeoImage::INVALID;
+            result = GeoImage::INVALID;
         }
+        return true;
     }
 
-    if (key.getProfile()->isHorizEquivalentTo(getProfile()))
-    {
-        result = createImageImplementation(key, progress);
-    }
-    else
-    {
-        // If the profiles are different, use a compositing method to assemble the tile.
-        result = assembleImage( key, progress );
-    }
+    return false;
+}
 
-    // Check for cancelation before writing to a cache:
-    if (progress && progress->isCanceled())
-    {
-        return GeoImage::INVALID;
-    }
+GeoImage
+ImageLayer::completeImage(
+    const TileKey& key,
+    const GeoImage& image,
+    osg::Image* cachedImage)
+{
+    GeoImage result = image;
 
     if (result.valid())
     {
         // invoke user callbacks
         invoke_onCreate(key, result);
 
+        // check before compressing, while the pixels are easy to read
+        bool transparent =
+            getCacheEmptyTiles() &&
+            !isCoverage() &&
+            ImageUtils::isEmptyImage(result.getImage());
+
+        // a single-color tile only needs one pixel in the cache
+        osg::ref_ptr<osg::Image> uniform;
+        if (!transparent && getDetectUniformTiles() && result.getImage()->r() == 1)
+            uniform = ImageUtils::reduceUniformImage(result.getImage());
+
+        // compress (and mipmap) now so the caches hold the upload-ready image
+        if (getCacheCompressed() == true)
+        {
+            std::string method = getCompressionMethod();
+            if (method.empty())
+                method = "auto";
+
+            const osg::Image* image = result.getImage();
+
+            if (method != "none" && method != "gpu" &&
+                image && image->r() == 1 && !image->isCompressed())
+            {
+                osg::ref_ptr<const osg::Image> compressed = ImageUtils::compressImage(image, method);
+                if (compressed.valid() && compressed->isCompressed())
+                {
+                    compressed = ImageUtils::mipmapImage(compressed.get());
+                    result = GeoImage(compressed.get(), result.getExtent());
+                }
+            }
+        }
+
         if (_memCache.valid())
         {
+            char memCacheKey[96];
+            sprintf(memCacheKey, "%d/%u/%s/%s",
+                getRevision(),
+                getDirtyRegionRevision(key),
+                key.str().c_str(), 
+                key.getProfile()->getHorizSignature().c_str());
+
             CacheBin* bin = _memCache->getOrCreateDefaultBin();
             bin->write(memCacheKey, result.getImage(), 0L);
         }
 
         // If we got a result, the cache is valid and we are caching in the map profile,
         // write to the map cache.
+        CacheBin* cacheBin = getCacheBin( key.getProfile() );
+        const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+
         if (cacheBin        &&
             policy.isCacheWriteable())
         {
@@ -515,7 +774,24 @@ ImageLayer::createImageInKeyProfile(
                 OE_INFO << LC << "WARNING! mismatched extents." << std::endl;
             }
 
-            cacheBin->write(cacheKey, result.getImage(), 0L);
+            CacheBin::TileRecordKey cacheKey(key, "image");
+
+            ScopedCacheTimer timeWrite(_stats._cacheWriteTime);
+
+            if (transparent)
+            {
+                writeEmptyTileRecord(cacheBin, cacheKey, EMPTY_TILE_TRANSPARENT);
+            }
+            else if (uniform.valid())
+            {
+                Config meta;
+                meta.set(EMPTY_TILE_FIELD, EMPTY_TILE_UNIFORM);
+                meta.set(UNIFORM_TILE_WIDTH, result.getImage()->s());
+                meta.set(UNIFORM_TILE_HEIGHT, result.getImage()->t());
+                cacheBin->write(cacheKey, uniform.get(), meta, 0L);
+            }
+            else
+                cacheBin->write(cacheKey, result.getImage(), Config(), 0L);
         }
     }
 
@@ -523,16 +799,107 @@ ImageLayer::createImageInKeyProfile(
     {
         OE_DEBUG << LC << key.str() << "result INVALID" << std::endl;
         // We couldn't get an image from the source.  So see if we have an expired cached image
-        if (cachedImage.valid())
+        if (cachedImage)
         {
             OE_DEBUG << LC << "Using cached but expired image for " << key.str() << std::endl;
-            result = GeoImage( cachedImage.get(), key.getExtent());
+            result = GeoImage( cachedImage, key.getExtent());
+        }
+
+        // The source says it has no such tile (e.g. HTTP 404), as opposed
+        // to failing to get it, so remember that in the cache.
+        else if (
+            getCacheEmptyTiles() &&
+            result.getStatus().code() == Status::ResourceUnavailable)
+        {
+            CacheBin* cacheBin = getCacheBin( key.getProfile() );
+            const CachePolicy& policy = getCacheSettings()->cachePolicy().get();
+
+            if (cacheBin && policy.isCacheWriteable())
+            {
+                writeEmptyTileRecord(cacheBin, CacheBin::TileRecordKey(key, "image"), EMPTY_TILE_MISSING);
+            }
         }
     }
 
     return result;
 }
 
+Future<GeoImage>
+ImageLayer::createImageAsync(
+    const TileKey& key,
+    ProgressCallback* progress)
+{
+    osg::ref_ptr<AsyncImageRequest> request = new AsyncImageRequest(progress);
+    Future<GeoImage> future = request->_promise.getFuture();
+
+    if (!isOpen() || !isKeyInLegalRange(key))
+    {
+        request->_promise.resolve(GeoImage::INVALID);
+        return future;
+    }
+
+    NetworkMonitor::ScopedRequestLayer layerRequest(getName());
+
+    // caches are local, so check them right away:
+    GeoImage cached;
+    osg::ref_ptr<osg::Image> expiredImage;
+    if (readCachedImage(key, cached, expiredImage))
+    {
+        request->_promise.resolve(cached);
+        return future;
+    }
+
+    osg::observer_ptr<ImageLayer> layer_ptr(this);
+
+    // meta-tiled layers group sibling requests in createImage instead.
+    if (key.getProfile()->isHorizEquivalentTo(getProfile()) &&
+        getMetaTileSize() <= 1u)
+    {
+        bool started = createImageImplementationAsync(
+            key,
+            [layer_ptr, key, request, expiredImage](const GeoImage& image)
+            {
+                GeoImage result;
+                osg::ref_ptr<ImageLayer> layer;
+                if (!request->isCanceled() && layer_ptr.lock(layer))
+                {
+                    result = layer->completeImage(key, image, expiredImage.get());
+                }
+                request->_promise.resolve(result);
+            },
+            request.get());
+
+        if (started)
+        {
+            return future;
+        }
+    }
+
+    // No asynchronous support for this request; create it normally in a job.
+    // Jobs for layers whose server is throttling us run last, so they don't
+    // tie up the arena while layers from other servers wait.
+    Job job(JobArena::get(ARENA_ASYNC_LAYER));
+    std::string layerName = getName();
+    job.setPriorityFunction([layerName]() -> float
+    {
+        return -NetworkMonitor::getLayerThrottle(layerName);
+    });
+    job.dispatch(
+        [layer_ptr, key, request](Cancelable*)
+        {
+            GeoImage result;
+            osg::ref_ptr<ImageLayer> layer;
+            if (!request->isCanceled() && layer_ptr.lock(layer))
+            {
+                result = layer->createImage(key, request.get());
+            }
+            request->_promise.resolve(result);
+        }
+    );
+
+    return future;
+}
+
 GeoImage
 ImageLayer::assembleImage(
     const TileKey& key,
@@ -28,6 +28,8 @@
 #include <osgEarth/ImageUtils>
 #include <osgEarth/DrapeableNode>
 #include <osgEarth/VirtualProgram>
+#include <osgEarth/GDAL>
+#include <osgEarth/SimplePager>
 #include <osg/Geode>
 #include <osg/ShapeDrawable>
 #include <osg/Texture2D>
@@ -66,6 +68,123 @@ namespace
         "    color.a *= oe_ImageOverlay_alpha; \n"
         "} \n";
 
+    // Pages the tiles of a tiled overlay in and out by their distance
+    // to the camera, the way the terrain pages its own tiles.
+    class TilePager : public Util::SimplePager
+    {
+    public:
+        TilePager(ImageLayer* source, const SpatialReference* mapSRS,
+                  osg::Texture::FilterMode minFilter, osg::Texture::FilterMode magFilter) :
+            Util::SimplePager(source->getProfile()),
+            _source(source),
+            _mapSRS(mapSRS),
+            _minFilter(minFilter),
+            _magFilter(magFilter)
+        {
+            // stop subdividing where the raster runs out of resolution
+            optional<unsigned> maxLevel;
+            for (auto& de : source->getDataExtents())
+            {
+                if (de.maxLevel().isSet())
+                    maxLevel = osg::maximum(maxLevel.get(), de.maxLevel().get());
+            }
+            if (maxLevel.isSet())
+                setMaxLevel(maxLevel.get());
+        }
+
+        osg::ref_ptr<osg::Node> createNode(const TileKey& key, ProgressCallback* progress) override
+        {
+            if (!_source->getDataExtentsUnion().intersects(key.getExtent()))
+                return nullptr;
+
+            GeoImage image = _source->createImage(key, progress);
+            if (!image.valid())
+                return nullptr;
+
+            // a grid of vertices so the tile follows the curve of the earth
+            const unsigned size = 9u;
+            const GeoExtent& extent = image.getExtent();
+            std::vector<osg::Vec3d> points;
+            points.reserve(size*size);
+            for (unsigned r = 0; r < size; ++r)
+            {
+                for (unsigned c = 0; c < size; ++c)
+                {
+                    points.emplace_back(
+                        extent.xMin() + extent.width() * (double)c / (double)(size - 1),
+                        extent.yMin() + extent.height() * (double)r / (double)(size - 1),
+                        0.0);
+                }
+            }
+
+            if (!extent.getSRS()->transform(points, _mapSRS.get()) ||
+                !_mapSRS->transformToWorld(points))
+            {
+                return nullptr;
+            }
+
+            osg::Vec3d anchor = points[points.size() / 2];
+
+            bool flip = image.getImage()->getOrigin() == osg::Image::TOP_LEFT;
+
+            osg::Vec3Array* verts = new osg::Vec3Array();
+            osg::Vec2Array* texcoords = new osg::Vec2Array();
+            verts->reserve(points.size());
+            texcoords->reserve(points.size());
+            for (unsigned r = 0; r < size; ++r)
+            {
+                for (unsigned c = 0; c < size; ++c)
+                {
+                    verts->push_back(points[r*size + c] - anchor);
+                    float s = (float)c / (float)(size - 1);
+                    float t = (float)r / (float)(size - 1);
+                    texcoords->push_back(osg::Vec2(s, flip ? 1.0f - t : t));
+                }
+            }
+
+            osg::DrawElementsUShort* tris = new osg::DrawElementsUShort(GL_TRIANGLES);
+            tris->reserve((size - 1)*(size - 1) * 6);
+            for (unsigned r = 0; r < size - 1; ++r)
+            {
+                for (unsigned c = 0; c < size - 1; ++c)
+                {
+                    GLushort i = r*size + c;
+                    tris->push_back(i);
+                    tris->push_back(i + 1);
+                    tris->push_back(i + size + 1);
+                    tris->push_back(i);
+                    tris->push_back(i + size + 1);
+                    tris->push_back(i + size);
+                }
+            }
+
+            osg::Geometry* geometry = new osg::Geometry();
+            geometry->setUseVertexBufferObjects(true);
+            geometry->setVertexArray(verts);
+            geometry->setTexCoordArray(0, texcoords);
+            geometry->addPrimitiveSet(tris);
+
+            // tiles are a power of two in size, so the GPU can mipmap them
+            osg::Texture2D* texture = new osg::Texture2D(const_cast<osg::Image*>(image.getImage()));
+            texture->setWrap(texture->WRAP_S, texture->CLAMP_TO_EDGE);
+            texture->setWrap(texture->WRAP_T, texture->CLAMP_TO_EDGE);
+            texture->setResizeNonPowerOfTwoHint(false);
+            texture->setFilter(texture->MIN_FILTER, _minFilter);
+            texture->setFilter(texture->MAG_FILTER, _magFilter);
+            geometry->getOrCreateStateSet()->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+
+            osg::MatrixTransform* transform = new osg::MatrixTransform();
+            transform->setMatrix(osg::Matrixd::translate(anchor));
+            transform->addChild(geometry);
+            return transform;
+        }
+
+    private:
+        osg::ref_ptr<ImageLayer> _source;
+        osg::ref_ptr<const SpatialReference> _mapSRS;
+        osg::Texture::FilterMode _minFilter;
+        osg::Texture::FilterMode _magFilter;
+    };
 }
 
 //---------------------------------------------------------------------------
@@ -86,14 +205,21 @@ _minFilter    (osg::Texture::LINEAR_MIPMAP_LINEAR),
 _magFilter    (osg::Texture::LINEAR),
 _texture      (0),
 _geometryResolution(default_geometryResolution),
-_draped(true)
+_draped(true),
+_tiled(false),
+_tileSize(256u)
 {
     construct();
 
     conf.get( "url",   _imageURI );
+    conf.get( "tiled", _tiled );
+    conf.get( "tile_size", _tileSize );
     if ( _imageURI.isSet() )
     {
-        setImage( _imageURI->getImage(readOptions) );
+        if ( _tiled == true )
+            openTileSource( readOptions );
+        else
+            setImage( _imageURI->getImage(readOptions) );
     }
 
     optional<float> tmpAlpha;
@@ -166,6 +292,8 @@ ImageOverlay::getConfig() const
         conf.set("url", temp);
     }
 
+    conf.set("tiled", _tiled);
+    conf.set("tile_size", _tileSize);
     conf.set("alpha", _alpha);
 
     osg::ref_ptr<Geometry> g = new Polygon();
@@ -218,7 +346,9 @@ _minFilter    (osg::Texture::LINEAR_MIPMAP_LINEAR),
 _magFilter    (osg::Texture::LINEAR),
 _texture      (0),
 _geometryResolution(default_geometryResolution),
-_draped(true)
+_draped(true),
+_tiled(false),
+_tileSize(256u)
 {        
     construct();
 
@@ -269,6 +399,12 @@ ImageOverlay::compile()
 
     if (_root->getNumChildren() > 0)
     {
+        for (unsigned i = 0; i < _root->getNumChildren(); ++i)
+        {
+            Util::SimplePager* pager = dynamic_cast<Util::SimplePager*>(_root->getChild(i));
+            if (pager)
+                pager->shutdown();
+        }
         _root->removeChildren(0, _root->getNumChildren());
     }
 
@@ -276,6 +412,18 @@ ImageOverlay::compile()
     {                
         const SpatialReference* mapSRS = getMapNode()->getMapSRS();
 
+        if (_tileSource.valid())
+        {
+            osg::ref_ptr<TilePager> pager = new TilePager(
+                _tileSource.get(), mapSRS, *_minFilter, *_magFilter);
+            pager->build();
+            _root->addChild(pager.get());
+
+            _dirty = false;
+            setDefaultLighting(false);
+            return;
+        }
+
         osg::ref_ptr<Feature> f = new Feature( new Polygon(), mapSRS->getGeodeticSRS() );
         Geometry* g = f->getGeometry();
         g->push_back( osg::Vec3d(_lowerLeft.x(),  _lowerLeft.y(), 0) );
@@ -371,6 +519,65 @@ void ImageOverlay::setImage( osg::Image* image )
     }
 }
 
+void
+ImageOverlay::setTiledImageURI(const URI& uri)
+{
+    _imageURI = uri;
+    _tiled = true;
+    _image = 0L;
+    openTileSource(0L);
+    dirty();
+}
+
+void
+ImageOverlay::setTileSize(unsigned value)
+{
+    if (*_tileSize != value)
+    {
+        _tileSize = value;
+        if (_tileSource.valid())
+        {
+            osg::ref_ptr<const osgDB::Options> readOptions = _tileSource->getReadOptions();
+            openTileSource(readOptions.get());
+            dirty();
+        }
+    }
+}
+
+void
+ImageOverlay::openTileSource(const osgDB::Options* readOptions)
+{
+    _tileSource = 0L;
+
+    osg::ref_ptr<GDALImageLayer> layer = new GDALImageLayer();
+    layer->setURL(*_imageURI);
+    layer->setTileSize(*_tileSize);
+    layer->setReadOptions(readOptions);
+
+    const Status& status = layer->open();
+    if (status.isError())
+    {
+        OE_WARN << LC << "Failed to open tiled image \"" << _imageURI->full() << "\": " << status.message() << std::endl;
+        return;
+    }
+
+    // the corners come from the raster's own georeferencing
+    const GeoExtent& extent = layer->getDataExtentsUnion();
+    const SpatialReference* geoSRS = extent.getSRS()->getGeographicSRS();
+    osg::Vec3d ll, lr, ul, ur;
+    extent.getSRS()->transform(osg::Vec3d(extent.xMin(), extent.yMin(), 0), geoSRS, ll);
+    extent.getSRS()->transform(osg::Vec3d(extent.xMax(), extent.yMin(), 0), geoSRS, lr);
+    extent.getSRS()->transform(osg::Vec3d(extent.xMin(), extent.yMax(), 0), geoSRS, ul);
+    extent.getSRS()->transform(osg::Vec3d(extent.xMax(), extent.yMax(), 0), geoSRS, ur);
+    _lowerLeft.set(ll.x(), ll.y());
+    _lowerRight.set(lr.x(), lr.y());
+    _upperLeft.set(ul.x(), ul.y());
+    _upperRight.set(ur.x(), ur.y());
+    clampLatitudes();
+
+    _tileSource = layer.get();
+}
+
 osg::Texture::FilterMode
     ImageOverlay::getMinFilter() const
 {
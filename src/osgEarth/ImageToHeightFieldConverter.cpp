@@ -21,6 +21,7 @@
 */
 
 #include <osgEarth/ImageToHeightFieldConverter>
+#include <osgEarth/RasterPool>
 #include <osgEarth/GeoCommon>
 
 // not needed for GL Core. Only for GL_R32F
@@ -105,8 +106,7 @@ osg::HeightField* ImageToHeightFieldConverter::convert16(const osg::Image* image
     return NULL;
   }
 
-  osg::HeightField *hf = new osg::HeightField();
-  hf->allocate( image->s(), image->t() );
+  osg::HeightField *hf = RasterPool::createHeightField( image->s(), image->t() );
 
   osg::FloatArray* floats = hf->getFloatArray();
 
@@ -129,8 +129,7 @@ osg::HeightField* ImageToHeightFieldConverter::convert32(const osg::Image* image
     return NULL;
   }
 
-  osg::HeightField *hf = new osg::HeightField();
-  hf->allocate( image->s(), image->t() );
+  osg::HeightField *hf = RasterPool::createHeightField( image->s(), image->t() );
 
   memcpy( &hf->getFloatArray()->front(), image->data(), sizeof(float) * hf->getFloatArray()->size() );
 
@@ -18,6 +18,7 @@
  */
 
 #include <osgEarth/ImageUtils>
+#include <osgEarth/RasterPool>
 #include <osgEarth/Registry>
 #include <osgEarth/Capabilities>
 #include <osgEarth/Metrics>
@@ -27,8 +28,20 @@
 
 #include <osg/ValueObject>
 
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OE_IMAGEUTILS_SSE2
+#include <emmintrin.h>
+#endif
+
 #define LC "[ImageUtils] "
 
+#ifndef GL_RED_INTEGER
+#define GL_RED_INTEGER 0x8D94
+#endif
+
 
 #if defined(OSG_GLES1_AVAILABLE) || defined(OSG_GLES2_AVAILABLE) || defined(OSG_GLES3_AVAILABLE)
 #    define GL_RGB8_INTERNAL  GL_RGB8_OES
@@ -162,6 +175,206 @@ ImageUtils::createBumpMap(const osg::Image* input)
     return output;
 }
 
+namespace
+{
+    // Direct kernels for the common 8-bit and float formats. They work on
+    // the raw components, skipping the per-pixel reader/writer dispatch
+    // and Vec4 conversion; PixelReader/PixelWriter normalize symmetrically,
+    // so the results are the same as the generic path up to rounding.
+
+    //! Number of components if the image is one the direct kernels handle, or 0.
+    unsigned getDirectComponents(const osg::Image* image)
+    {
+        if (image->isCompressed())
+            return 0u;
+
+        GLenum type = image->getDataType();
+        if (type != GL_UNSIGNED_BYTE && type != GL_FLOAT)
+            return 0u;
+
+        switch (image->getPixelFormat())
+        {
+        case GL_RED:
+        case GL_LUMINANCE:
+        case GL_ALPHA:
+            return 1u;
+        case GL_RG:
+        case GL_LUMINANCE_ALPHA:
+            return 2u;
+        case GL_RGB:
+        case GL_BGR:
+            return 3u;
+        case GL_RGBA:
+        case GL_BGRA:
+            return 4u;
+        default:
+            return 0u;
+        }
+    }
+
+    // Source taps and weights for one output row or column, following
+    // the same sampling rules as the generic resize.
+    struct ResampleTap
+    {
+        int i0, i1;   // bilinear taps (equal when the sample is exact)
+        float w0, w1; // bilinear weights
+        int nearest;  // nearest-neighbor tap
+    };
+
+    void computeTaps(unsigned in_n, unsigned out_n, std::vector<ResampleTap>& taps)
+    {
+        taps.resize(out_n);
+        for (unsigned i = 0; i < out_n; ++i)
+        {
+            float x = ((float)i / (float)out_n) * (float)in_n;
+            if (x >= (float)in_n) x = (float)(in_n - 1);
+            else if (x < 0.0f) x = 0.0f;
+
+            ResampleTap& tap = taps[i];
+            tap.i0 = osg::maximum((int)floor(x), 0);
+            tap.i1 = osg::maximum(osg::minimum((int)ceil(x), (int)in_n - 1), 0);
+            if (tap.i0 > tap.i1) tap.i0 = tap.i1;
+
+            if (tap.i0 == tap.i1)
+            {
+                tap.w0 = 1.0f, tap.w1 = 0.0f;
+            }
+            else
+            {
+                tap.w0 = (float)tap.i1 - x;
+                tap.w1 = x - (float)tap.i0;
+            }
+
+            tap.nearest = (x - (int)x) <= (ceil(x) - x) ?
+                (int)x :
+                osg::minimum(1 + (int)x, (int)in_n - 1);
+        }
+    }
+
+    template<typename T, unsigned N>
+    void resampleRow(const T* row0, const T* row1, float v0, float v1,
+                     const std::vector<ResampleTap>& cols, T* out)
+    {
+        for (auto& c : cols)
+        {
+            const T* ll = row0 + c.i0 * N;
+            const T* lr = row0 + c.i1 * N;
+            const T* ul = row1 + c.i0 * N;
+            const T* ur = row1 + c.i1 * N;
+            for (unsigned k = 0; k < N; ++k)
+            {
+                float r1 = (float)ll[k] * c.w0 + (float)lr[k] * c.w1;
+                float r2 = (float)ul[k] * c.w0 + (float)ur[k] * c.w1;
+                *out++ = (T)(r1 * v0 + r2 * v1);
+            }
+        }
+    }
+
+#ifdef OE_IMAGEUTILS_SSE2
+    inline __m128 loadRGBA8(const GLubyte* p)
+    {
+        int v;
+        memcpy(&v, p, 4);
+        __m128i zero = _mm_setzero_si128();
+        __m128i x = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+        return _mm_cvtepi32_ps(x);
+    }
+
+    // One RGBA8 pixel per iteration, all four channels in one register.
+    template<>
+    void resampleRow<GLubyte, 4u>(const GLubyte* row0, const GLubyte* row1, float v0, float v1,
+                                   const std::vector<ResampleTap>& cols, GLubyte* out)
+    {
+        __m128 wv0 = _mm_set1_ps(v0), wv1 = _mm_set1_ps(v1);
+        for (auto& c : cols)
+        {
+            __m128 w0 = _mm_set1_ps(c.w0), w1 = _mm_set1_ps(c.w1);
+            __m128 r1 = _mm_add_ps(_mm_mul_ps(loadRGBA8(row0 + c.i0 * 4), w0), _mm_mul_ps(loadRGBA8(row0 + c.i1 * 4), w1));
+            __m128 r2 = _mm_add_ps(_mm_mul_ps(loadRGBA8(row1 + c.i0 * 4), w0), _mm_mul_ps(loadRGBA8(row1 + c.i1 * 4), w1));
+            __m128i x = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r1, wv0), _mm_mul_ps(r2, wv1)));
+            x = _mm_packs_epi32(x, x);
+            x = _mm_packus_epi16(x, x);
+            int v = _mm_cvtsi128_si32(x);
+            memcpy(out, &v, 4);
+            out += 4;
+        }
+    }
+#endif
+
+    template<typename T, unsigned N>
+    void nearestRow(const T* row, const std::vector<ResampleTap>& cols, T* out)
+    {
+        for (auto& c : cols)
+        {
+            const T* p = row + c.nearest * N;
+            for (unsigned k = 0; k < N; ++k)
+                *out++ = p[k];
+        }
+    }
+
+    template<typename T, unsigned N>
+    void resampleImage(const osg::Image* input, osg::Image* output, bool bilinear)
+    {
+        std::vector<ResampleTap> cols, rows;
+        computeTaps(input->s(), output->s(), cols);
+        computeTaps(input->t(), output->t(), rows);
+
+        for (int layer = 0; layer < input->r(); ++layer)
+        {
+            for (int t = 0; t < output->t(); ++t)
+            {
+                const ResampleTap& row = rows[t];
+                T* out = (T*)output->data(0, t, layer);
+
+                if (bilinear)
+                {
+                    resampleRow<T, N>(
+                        (const T*)input->data(0, row.i0, layer),
+                        (const T*)input->data(0, row.i1, layer),
+                        row.w0, row.w1, cols, out);
+                }
+                else
+                {
+                    nearestRow<T, N>((const T*)input->data(0, row.nearest, layer), cols, out);
+                }
+            }
+        }
+    }
+
+    template<typename T>
+    bool resampleImage(const osg::Image* input, osg::Image* output, unsigned components, bool bilinear)
+    {
+        switch (components)
+        {
+        case 1: resampleImage<T, 1u>(input, output, bilinear); return true;
+        case 2: resampleImage<T, 2u>(input, output, bilinear); return true;
+        case 3: resampleImage<T, 3u>(input, output, bilinear); return true;
+        case 4: resampleImage<T, 4u>(input, output, bilinear); return true;
+        default: return false;
+        }
+    }
+
+    //! Resizes with a direct kernel if both images share a supported format.
+    bool resizeImageDirect(const osg::Image* input, osg::Image* output, unsigned mipmapLevel, bool bilinear)
+    {
+        if (mipmapLevel != 0 ||
+            input->getPixelFormat() != output->getPixelFormat() ||
+            input->getDataType() != output->getDataType() ||
+            input->r() != output->r())
+        {
+            return false;
+        }
+
+        unsigned components = getDirectComponents(input);
+        if (components == 0u)
+            return false;
+
+        return input->getDataType() == GL_UNSIGNED_BYTE ?
+            resampleImage<GLubyte>(input, output, components, bilinear) :
+            resampleImage<GLfloat>(input, output, components, bilinear);
+    }
+}
+
 bool
 ImageUtils::resizeImage(const osg::Image* input,
                         unsigned int out_s, unsigned int out_t,
@@ -189,17 +402,15 @@ ImageUtils::resizeImage(const osg::Image* input,
 
     if ( !output.valid() )
     {
-        output = new osg::Image();
-
         if ( PixelWriter::supports(input) )
         {
-            output->allocateImage( out_s, out_t, input->r(), input->getPixelFormat(), input->getDataType(), input->getPacking() );
+            output = RasterPool::createImage( out_s, out_t, input->r(), input->getPixelFormat(), input->getDataType(), input->getPacking() );
             output->setInternalTextureFormat( input->getInternalTextureFormat() );
         }
         else
         {
             // for unsupported write formats, convert to normalized RGBA8 automatically.
-            output->allocateImage( out_s, out_t, input->r(), GL_RGBA, GL_UNSIGNED_BYTE );
+            output = RasterPool::createImage( out_s, out_t, input->r(), GL_RGBA, GL_UNSIGNED_BYTE );
             output->setInternalTextureFormat( GL_RGB8A_INTERNAL );
         }
     }
@@ -213,6 +424,10 @@ ImageUtils::resizeImage(const osg::Image* input,
     {
         memcpy( output->data(), input->data(), input->getTotalSizeInBytes() );
     }
+    else if ( resizeImageDirect(input, output.get(), mipmapLevel, bilinear) )
+    {
+        // done
+    }
     else
     {
         PixelReader read( input );
@@ -621,6 +836,41 @@ ImageUtils::mipmapImageInPlace(osg::Image* input)
     }
 }
 
+namespace
+{
+    // Name of the ImageProcessor to use for a compression method.
+    // "auto" and "cpu" pick the native block format of the platform:
+    // DXT on desktop GL, ETC2 on GLES.
+    std::string getCompressionDriver(const std::string& method)
+    {
+        if (method == "cpu" || method == "auto")
+        {
+#if defined(OSG_GLES2_AVAILABLE) || defined(OSG_GLES3_AVAILABLE)
+            return "etc2";
+#else
+            return "fastdxt";
+#endif
+        }
+
+        if (method.length() >= 3 && method.substr(0, 3) == "dxt")
+            return "fastdxt";
+
+        return method;
+    }
+
+    // Compression mode to request from the ImageProcessor
+    osg::Texture::InternalFormatMode getCompressionMode(const std::string& driver, const osg::Image* image)
+    {
+        if (driver == "etc2")
+            return osg::Texture::USE_ETC2_COMPRESSION;
+
+        // RGB uses DXT1
+        return ImageUtils::hasAlphaChannel(image) ?
+            osg::Texture::USE_S3TC_DXT5_COMPRESSION :
+            osg::Texture::USE_S3TC_DXT1_COMPRESSION;
+    }
+}
+
 const osg::Image*
 ImageUtils::compressImage(
     const osg::Image* input,
@@ -645,14 +895,7 @@ ImageUtils::compressImage(
 
     osgDB::ImageProcessor* ip = nullptr;
 
-    std::string driver(method);
-
-    if (driver == "cpu" ||
-        driver == "auto" ||
-        (driver.length() >=3 && driver.substr(0,3)=="dxt"))
-    {
-        driver = "fastdxt";
-    }
+    std::string driver = getCompressionDriver(method);
 
     ip = osgDB::Registry::instance()->getImageProcessorForExtension(driver);
 
@@ -660,12 +903,7 @@ ImageUtils::compressImage(
     {
         output = osg::clone(input, osg::CopyOp::DEEP_COPY_ALL);
 
-        // RGB uses DXT1
-        osg::Texture::InternalFormatMode mode;
-        if (hasAlphaChannel(input))
-            mode = osg::Texture::USE_S3TC_DXT5_COMPRESSION;
-        else
-            mode = osg::Texture::USE_S3TC_DXT1_COMPRESSION;
+        osg::Texture::InternalFormatMode mode = getCompressionMode(driver, input);
 
         ip->compress(
             *output,        // image to compress
@@ -695,17 +933,9 @@ ImageUtils::compressImageInPlace(
     if (method.empty() || method == "none")
         return;
 
-    // RGB uses DXT1
-    osg::Texture::InternalFormatMode mode;
+    std::string driver = getCompressionDriver(method);
 
-    if (hasAlphaChannel(input))
-    {
-        mode = osg::Texture::USE_S3TC_DXT5_COMPRESSION;
-    }
-    else
-    {
-        mode = osg::Texture::USE_S3TC_DXT1_COMPRESSION;
-    }
+    osg::Texture::InternalFormatMode mode = getCompressionMode(driver, input);
 
     if (method == "gpu")
     {
@@ -718,15 +948,6 @@ ImageUtils::compressImageInPlace(
         // return the input if nothing works
         osgDB::ImageProcessor* ip = nullptr;
 
-        std::string driver(method);
-
-        if (driver == "cpu" ||
-            driver == "auto" ||
-            (driver.length() >=3 && driver.substr(0,3)=="dxt"))
-        {
-            driver = "fastdxt";
-        }
-
         ip = osgDB::Registry::instance()->getImageProcessorForExtension(driver);
 
         if (ip)
@@ -740,9 +961,10 @@ ImageUtils::compressImageInPlace(
                 ip->FASTEST);   // quality
         }
 
-        else
+        else if (driver != "etc2")
         {
             // CPU didn't work so just use GPU. (cheating)
+            // GLES drivers won't compress to ETC2 on upload, so not there.
             input->setInternalTextureFormat(mode);
         }
     }
@@ -908,6 +1130,85 @@ namespace
     };
 }
 
+namespace
+{
+    // Alpha composite of 8-bit RGB/RGBA pixels, same math as MixImage.
+    // SN/DN are the source and destination component counts.
+    template<unsigned SN, unsigned DN>
+    void mixRow(GLubyte* dest, const GLubyte* src, unsigned count, float a)
+    {
+        for (unsigned i = 0; i < count; ++i, src += SN, dest += DN)
+        {
+            float sa = SN == 4u ? a * (float)src[3] * (1.0f / 255.0f) : a;
+            float inv = 1.0f - sa;
+            dest[0] = (GLubyte)((float)dest[0] * inv + (float)src[0] * sa);
+            dest[1] = (GLubyte)((float)dest[1] * inv + (float)src[1] * sa);
+            dest[2] = (GLubyte)((float)dest[2] * inv + (float)src[2] * sa);
+            if (DN == 4u)
+                dest[3] = (GLubyte)osg::maximum(sa * 255.0f, (float)dest[3]);
+        }
+    }
+
+#ifdef OE_IMAGEUTILS_SSE2
+    template<>
+    void mixRow<4u, 4u>(GLubyte* dest, const GLubyte* src, unsigned count, float a)
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(a * (1.0f / 255.0f));
+        const __m128i colorMask = _mm_set_epi32(0, -1, -1, -1);
+
+        for (unsigned i = 0; i < count; ++i, src += 4, dest += 4)
+        {
+            __m128 s = loadRGBA8(src);
+            __m128 d = loadRGBA8(dest);
+
+            __m128 sa = _mm_mul_ps(_mm_shuffle_ps(s, s, _MM_SHUFFLE(3, 3, 3, 3)), scale);
+            __m128 rgb = _mm_add_ps(_mm_mul_ps(d, _mm_sub_ps(one, sa)), _mm_mul_ps(s, sa));
+            __m128 alpha = _mm_max_ps(_mm_mul_ps(sa, _mm_set1_ps(255.0f)), d);
+
+            // color from the blend, alpha from the max
+            __m128 m = _mm_castsi128_ps(colorMask);
+            __m128 result = _mm_or_ps(_mm_and_ps(m, rgb), _mm_andnot_ps(m, alpha));
+
+            __m128i x = _mm_cvttps_epi32(result);
+            x = _mm_packs_epi32(x, x);
+            x = _mm_packus_epi16(x, x);
+            int v = _mm_cvtsi128_si32(x);
+            memcpy(dest, &v, 4);
+        }
+    }
+#endif
+
+    //! Mixes with a direct kernel if both images are 8-bit RGB or RGBA.
+    bool mixDirect(osg::Image* dest, const osg::Image* src, float a)
+    {
+        if (src->getDataType() != GL_UNSIGNED_BYTE || dest->getDataType() != GL_UNSIGNED_BYTE ||
+            src->isCompressed() || dest->isCompressed())
+        {
+            return false;
+        }
+
+        GLenum sf = src->getPixelFormat(), df = dest->getPixelFormat();
+        if ((sf != GL_RGB && sf != GL_RGBA) || (df != GL_RGB && df != GL_RGBA))
+            return false;
+
+        for (int r = 0; r < src->r(); ++r)
+        {
+            for (int t = 0; t < src->t(); ++t)
+            {
+                GLubyte* d = dest->data(0, t, r);
+                const GLubyte* s = src->data(0, t, r);
+
+                if (sf == GL_RGBA && df == GL_RGBA)     mixRow<4u, 4u>(d, s, src->s(), a);
+                else if (sf == GL_RGBA)                 mixRow<4u, 3u>(d, s, src->s(), a);
+                else if (df == GL_RGBA)                 mixRow<3u, 4u>(d, s, src->s(), a);
+                else                                    mixRow<3u, 3u>(d, s, src->s(), a);
+            }
+        }
+        return true;
+    }
+}
+
 bool
 ImageUtils::mix(osg::Image* dest, const osg::Image* src, float a)
 {
@@ -918,6 +1219,9 @@ ImageUtils::mix(osg::Image* dest, const osg::Image* src, float a)
         return false;
     }
 
+    if ( mixDirect(dest, src, osg::clampBetween(a, 0.0f, 1.0f)) )
+        return true;
+
     PixelVisitor<MixImage> mixer;
     mixer._a = osg::clampBetween( a, 0.0f, 1.0f );
     mixer._srcHasAlpha = hasAlphaChannel(src); //src->getPixelSizeInBits() == 32;
@@ -969,8 +1273,7 @@ ImageUtils::cropImage(const osg::Image* image,
     //OE_NOTICE << "Copying from " << windowX << ", " << windowY << ", " << windowWidth << ", " << windowHeight << std::endl;
 
     //Allocate the croppped image
-    osg::Image* cropped = new osg::Image;
-    cropped->allocateImage(windowWidth, windowHeight, image->r(), image->getPixelFormat(), image->getDataType());
+    osg::Image* cropped = RasterPool::createImage(windowWidth, windowHeight, image->r(), image->getPixelFormat(), image->getDataType());
     cropped->setInternalTextureFormat( image->getInternalTextureFormat() );
 
     for (int layer=0; layer<image->r(); ++layer)
@@ -989,8 +1292,7 @@ ImageUtils::cropImage(const osg::Image* image,
 osg::Image*
 ImageUtils::cropImage(osg::Image* image, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
 {
-    osg::Image* cropped = new osg::Image;
-    cropped->allocateImage(width, height, image->r(), image->getPixelFormat(), image->getDataType());
+    osg::Image* cropped = RasterPool::createImage(width, height, image->r(), image->getPixelFormat(), image->getDataType());
     cropped->setInternalTextureFormat(image->getInternalTextureFormat());
 
     for (int layer = 0; layer < image->r(); ++layer)
@@ -1146,6 +1448,66 @@ ImageUtils::isSingleColorImage(const osg::Image* image, float threshold)
     return true;
 }
 
+osg::Image*
+ImageUtils::reduceUniformImage(const osg::Image* image)
+{
+    if (!image || !image->data() || image->isCompressed())
+        return NULL;
+
+    unsigned bits = image->getPixelSizeInBits();
+    if (bits == 0 || (bits % 8) != 0)
+        return NULL;
+
+    // compare raw bytes, so the result is exact for any data type
+    unsigned pixelBytes = bits / 8;
+    const unsigned char* first = image->data(0, 0, 0);
+
+    for(int r=0; r<image->r(); ++r)
+    {
+        for(int t=0; t<image->t(); ++t)
+        {
+            const unsigned char* ptr = image->data(0, t, r);
+            for(int s=0; s<image->s(); ++s, ptr += pixelBytes)
+            {
+                if (::memcmp(ptr, first, pixelBytes) != 0)
+                    return NULL;
+            }
+        }
+    }
+
+    osg::Image* pixel = new osg::Image();
+    pixel->allocateImage(1, 1, 1, image->getPixelFormat(), image->getDataType(), image->getPacking());
+    pixel->setInternalTextureFormat(image->getInternalTextureFormat());
+    ::memcpy(pixel->data(), first, pixelBytes);
+    return pixel;
+}
+
+osg::Image*
+ImageUtils::expandUniformImage(const osg::Image* pixel, unsigned s, unsigned t)
+{
+    if (!pixel || !pixel->data() || pixel->isCompressed() || s == 0 || t == 0)
+        return NULL;
+
+    unsigned bits = pixel->getPixelSizeInBits();
+    if (bits == 0 || (bits % 8) != 0)
+        return NULL;
+
+    unsigned pixelBytes = bits / 8;
+    const unsigned char* value = pixel->data(0, 0, 0);
+
+    osg::Image* image = new osg::Image();
+    image->allocateImage(s, t, 1, pixel->getPixelFormat(), pixel->getDataType(), pixel->getPacking());
+    image->setInternalTextureFormat(pixel->getInternalTextureFormat());
+
+    for(unsigned row=0; row<t; ++row)
+    {
+        unsigned char* ptr = image->data(0, row, 0);
+        for(unsigned col=0; col<s; ++col, ptr += pixelBytes)
+            ::memcpy(ptr, value, pixelBytes);
+    }
+    return image;
+}
+
 bool
 ImageUtils::computeTextureCompressionMode(const osg::Image*                 image,
                                           osg::Texture::InternalFormatMode& out_mode)
@@ -1533,45 +1895,8 @@ namespace
     static const double r2 = 1.0/3.0;
 
     // The scale factors to convert from an image data type to a
-    // float. This is copied from OSG; I think the factors for the signed
-    // types are wrong, but need to investigate further.
-
-    template<typename T> struct GLTypeTraits;
-
-    template<> struct GLTypeTraits<GLbyte>
-    {
-        static double scale(bool norm) { return norm? 1.0/128.0 : 1.0; } // XXX
-    };
-
-    template<> struct GLTypeTraits<GLubyte>
-    {
-        static double scale(bool norm) { return norm? 1.0/255.0 : 1.0; }
-    };
-
-    template<> struct GLTypeTraits<GLshort>
-    {
-        static double scale(bool norm) { return norm? 1.0/32768.0 : 1.0; } // XXX
-    };
-
-    template<> struct GLTypeTraits<GLushort>
-    {
-        static double scale(bool norm) { return norm? 1.0/65535.0 : 1.0; }
-    };
-
-    template<> struct GLTypeTraits<GLint>
-    {
-        static double scale(bool norm) { return norm? 1.0/2147483648.0 : 1.0; } // XXX
-    };
-
-    template<> struct GLTypeTraits<GLuint>
-    {
-        static double scale(bool norm) { return norm? 1.0/4294967295.0 : 1.0; }
-    };
-
-    template<> struct GLTypeTraits<GLfloat>
-    {
-        static double scale(bool norm) { return 1.0; }
-    };
+    // float; shared with the typed readers in the header.
+    template<typename T> using GLTypeTraits = ImageUtils::PixelDataTraits<T>;
 
     // The Reader function that performs the read.
     template<int Format, typename T> struct ColorReader;
@@ -1979,6 +2304,7 @@ namespace
             return chooseReader<GL_LUMINANCE>(dataType);
             break;
         case GL_RED:
+        case GL_RED_INTEGER:
             return chooseReader<GL_RED>(dataType);
             break;
         case GL_ALPHA:
@@ -2471,20 +2797,25 @@ ImageUtils::PixelWriter::assign(const osg::Vec4& c)
     if (_image->valid())
     {
         for(int r=0; r<_image->r(); ++r)
-            for(int t=0; t<_image->t(); ++t)
-                for(int s=0; s<_image->s(); ++s)
-                    (*this)(c, s, t, r);
+            assign(c, r);
     }
 }
 
 void
 ImageUtils::PixelWriter::assign(const osg::Vec4& c, int layer)
 {
-    if (_image->valid())
+    if (_image->valid() && _image->s() > 0 && _image->t() > 0)
     {
-        for(int t=0; t<_image->t(); ++t)
-            for(int s=0; s<_image->s(); ++s)
-                (*this)(c, s, t, layer);
+        // encode one pixel, then replicate its bytes across the first
+        // row and the first row across the rest of the layer
+        (*this)(c, 0, 0, layer);
+
+        unsigned char* row0 = data(0, 0, layer);
+        for(int s=1; s<_image->s(); ++s)
+            memcpy(row0 + s*_colBytes, row0, _colBytes);
+
+        for(int t=1; t<_image->t(); ++t)
+            memcpy(data(0, t, layer), row0, _image->s()*_colBytes);
     }
 }
 
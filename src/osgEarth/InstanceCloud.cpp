@@ -23,11 +23,15 @@
 #include <osgEarth/ShaderLoader>
 #include <osgEarth/Math>
 #include <osgEarth/Registry>
+#include <osgEarth/ImageUtils>
 #include <osg/Program>
 #include <osg/GLExtensions>
 #include <osg/GraphicsContext>
 #include <osgUtil/Optimizer>
 #include <iterator>
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
 
 #ifndef GL_DYNAMIC_STORAGE_BIT
 #define GL_DYNAMIC_STORAGE_BIT 0x0100
@@ -41,6 +45,11 @@ using namespace osgEarth;
 #define BINDING_COMMAND_BUFFER 0
 #define BINDING_RENDER_BUFFER 1
 #define BINDING_POINTS_BUFFER 2
+#define BINDING_VISIBLE_BUFFER 3
+#define BINDING_VIEW_COMMAND_BUFFER 4
+
+// work group size of a view cull shader
+#define VIEW_CULL_GROUP_SIZE 64
 
 // pre OSG-3.6 support
 #ifndef GL_DRAW_INDIRECT_BUFFER
@@ -51,7 +60,10 @@ InstanceCloud::InstancingData::InstancingData() :
     commands(NULL),
     points(NULL),
     numTilesAllocated(0u),
-    ssboOffsetAlignment(-1)
+    tileToDraw(0u),
+    slotToDraw(0u),
+    ssboOffsetAlignment(-1),
+    view(NULL)
 {
     // polyfill for pre-OSG 3.6 support
     osg::setGLExtensionFuncPtr(_glBufferStorage, "glBufferStorage", "glBufferStorageARB");
@@ -67,7 +79,7 @@ InstanceCloud::InstancingData::~InstancingData()
     releaseGLObjects(NULL);
 }
 
-void
+bool
 InstanceCloud::InstancingData::allocateGLObjects(osg::State* state, unsigned numTiles)
 {
     if (numTilesAllocated < numTiles || commands == nullptr)
@@ -151,7 +163,9 @@ InstanceCloud::InstancingData::allocateGLObjects(osg::State* state, unsigned num
             0);     // only GPU will write to this buffer
         state->getGraphicsContext()->add(new GLBufferReleaser(renderBuffer.get()));
 #endif
+        return true;
     }
+    return false;
 }
 
 void
@@ -168,6 +182,76 @@ InstanceCloud::InstancingData::releaseGLObjects(osg::State* state) const
     numTilesAllocated = 0;
 }
 
+InstanceCloud::ViewData::ViewData() :
+    visibleBufferTileSize(0),
+    numTilesAllocated(0u),
+    instancesPerTile(0u),
+    numLODs(0u),
+    frameLastUsed(0)
+{
+    //nop
+}
+
+void
+InstanceCloud::ViewData::allocateGLObjects(osg::State* state, const InstancingData& data, unsigned numTiles)
+{
+    unsigned numInstances = data.numX * data.numY;
+
+    if (numTilesAllocated < numTiles ||
+        instancesPerTile != numInstances ||
+        numLODs != data.numLODs() ||
+        !commandBuffer.valid())
+    {
+        // never more than the generated tiles
+        unsigned size = osg::minimum(osg::maximum(numTiles, numTilesAllocated), data.numTilesAllocated);
+
+        releaseGLObjects(state);
+
+        numTilesAllocated = size;
+        instancesPerTile = numInstances;
+        numLODs = data.numLODs();
+
+        // one command per tile and LOD, drawing that LOD's index range:
+        commands.resize(numTilesAllocated * numLODs);
+        for (unsigned i = 0; i < commands.size(); ++i)
+        {
+            DrawElementsIndirectCommand& cmd = commands[i];
+            cmd.count = data.lods.empty() ? data.numIndices : data.lods[i % numLODs].count;
+            cmd.instanceCount = 0;
+            cmd.firstIndex = data.lods.empty() ? 0 : data.lods[i % numLODs].firstIndex;
+            cmd.baseVertex = 0;
+            cmd.baseInstance = 0;
+        }
+
+        commandBuffer = new GLBuffer(GL_SHADER_STORAGE_BUFFER, *state, "oe.ic.viewcmdbuffer");
+        commandBuffer->bind();
+        data._glBufferStorage(
+            GL_SHADER_STORAGE_BUFFER,
+            align(commands.size() * sizeof(DrawElementsIndirectCommand), (GLuint)data.ssboOffsetAlignment),
+            nullptr,
+            GL_DYNAMIC_STORAGE_BIT); // so we can reset each frame
+
+        // one index per instance:
+        visibleBufferTileSize = align(numInstances * sizeof(GLuint), (GLuint)data.ssboOffsetAlignment);
+
+        visibleBuffer = new GLBuffer(GL_SHADER_STORAGE_BUFFER, *state, "oe.ic.visiblebuffer");
+        visibleBuffer->bind();
+        data._glBufferStorage(
+            GL_SHADER_STORAGE_BUFFER,
+            commands.size() * visibleBufferTileSize,
+            nullptr,
+            0); // only GPU will write to this buffer
+    }
+}
+
+void
+InstanceCloud::ViewData::releaseGLObjects(osg::State* state) const
+{
+    commandBuffer = NULL;
+    visibleBuffer = NULL;
+    numTilesAllocated = 0;
+}
+
 InstanceCloud::InstanceCloud()
 {
     //nop
@@ -192,6 +276,16 @@ InstanceCloud::setGeometry(osg::Geometry* geom)
     }
 }
 
+void
+InstanceCloud::setLODs(const std::vector<LOD>& lods)
+{
+    _data.lods = lods;
+
+    // an un-culled draw shows the nearest LOD
+    if (!lods.empty())
+        _data.numIndices = lods.front().count;
+}
+
 //void
 //InstanceCloud::setPositions(osg::Vec4Array* value)
 //{
@@ -226,14 +320,14 @@ InstanceCloud::computeBoundingBox() const
     return box;
 }
 
-void
+bool
 InstanceCloud::allocateGLObjects(osg::RenderInfo& ri, unsigned numTiles)
 {
-    _data.allocateGLObjects(ri.getState(), numTiles);
+    return _data.allocateGLObjects(ri.getState(), numTiles);
 }
 
 void
-InstanceCloud::preCull(osg::RenderInfo& ri)
+InstanceCloud::preCull(osg::RenderInfo& ri, bool resetCounts)
 {
    if (!_data.commandBuffer)
    {
@@ -244,17 +338,20 @@ InstanceCloud::preCull(osg::RenderInfo& ri)
 
     // Reset all the instance counts to zero by copying the empty
     // prototype buffer to the GPU
+    if (resetCounts)
+    {
 #if 1
-    _data.commandBuffer->bind();
+        _data.commandBuffer->bind();
 #else
-    ext->glBindBuffer(GL_SHADER_STORAGE_BUFFER, _data.commandBuffer->_handle);
+        ext->glBindBuffer(GL_SHADER_STORAGE_BUFFER, _data.commandBuffer->_handle);
 #endif
 
-    ext->glBufferSubData(
-        GL_SHADER_STORAGE_BUFFER, 
-        0,
-        _data.numTilesAllocated * sizeof(DrawElementsIndirectCommand),
-        &_data.commands[0]);
+        ext->glBufferSubData(
+            GL_SHADER_STORAGE_BUFFER, 
+            0,
+            _data.numTilesAllocated * sizeof(DrawElementsIndirectCommand),
+            &_data.commands[0]);
+    }
 
     // Bind our SSBOs to their respective layout indices in the shader
     ext->glBindBufferBase(
@@ -268,6 +365,26 @@ InstanceCloud::preCull(osg::RenderInfo& ri)
         _data.renderBuffer->name());
 }
 
+void
+InstanceCloud::resetTile(osg::RenderInfo& ri, unsigned tileNum)
+{
+    if (!_data.commandBuffer || tileNum >= _data.numTilesAllocated)
+    {
+        return;
+    }
+
+    osg::GLExtensions* ext = ri.getState()->get<osg::GLExtensions>();
+
+    // Zero out the instance count of just this tile's command
+    _data.commandBuffer->bind();
+
+    ext->glBufferSubData(
+        GL_SHADER_STORAGE_BUFFER,
+        tileNum * sizeof(DrawElementsIndirectCommand),
+        sizeof(DrawElementsIndirectCommand),
+        &_data.commands[tileNum]);
+}
+
 void
 InstanceCloud::cullTile(osg::RenderInfo& ri, unsigned tileNum)
 {
@@ -276,6 +393,60 @@ InstanceCloud::cullTile(osg::RenderInfo& ri, unsigned tileNum)
     ext->glDispatchCompute(_data.numX, _data.numY, 1);
 }
 
+void
+InstanceCloud::preViewCull(osg::RenderInfo& ri, ViewData& view, unsigned numTiles)
+{
+    if (!_data.commandBuffer || numTiles > _data.numTilesAllocated)
+    {
+        return;
+    }
+
+    osg::GLExtensions* ext = ri.getState()->get<osg::GLExtensions>();
+
+    view.allocateGLObjects(ri.getState(), _data, numTiles);
+
+    // Reset the view's instance counts:
+    view.commandBuffer->bind();
+
+    ext->glBufferSubData(
+        GL_SHADER_STORAGE_BUFFER,
+        0,
+        numTiles * view.numLODs * sizeof(DrawElementsIndirectCommand),
+        &view.commands[0]);
+
+    // Generated data, read only:
+    ext->glBindBufferBase(
+        GL_SHADER_STORAGE_BUFFER,
+        BINDING_COMMAND_BUFFER,
+        _data.commandBuffer->name());
+
+    ext->glBindBufferBase(
+        GL_SHADER_STORAGE_BUFFER,
+        BINDING_RENDER_BUFFER,
+        _data.renderBuffer->name());
+
+    // Per-view results:
+    ext->glBindBufferBase(
+        GL_SHADER_STORAGE_BUFFER,
+        BINDING_VISIBLE_BUFFER,
+        view.visibleBuffer->name());
+
+    ext->glBindBufferBase(
+        GL_SHADER_STORAGE_BUFFER,
+        BINDING_VIEW_COMMAND_BUFFER,
+        view.commandBuffer->name());
+}
+
+void
+InstanceCloud::viewCullTile(osg::RenderInfo& ri)
+{
+    osg::GLExtensions* ext = ri.getState()->get<osg::GLExtensions>();
+
+    GLuint numInstances = _data.numX * _data.numY;
+
+    ext->glDispatchCompute((numInstances + VIEW_CULL_GROUP_SIZE - 1) / VIEW_CULL_GROUP_SIZE, 1, 1);
+}
+
 void
 InstanceCloud::postCull(osg::RenderInfo& ri)
 {
@@ -286,8 +457,15 @@ InstanceCloud::postCull(osg::RenderInfo& ri)
 
 void
 InstanceCloud::drawTile(osg::RenderInfo& ri, unsigned tileNum)
+{
+    drawTile(ri, tileNum, tileNum);
+}
+
+void
+InstanceCloud::drawTile(osg::RenderInfo& ri, unsigned tileNum, unsigned slot)
 {
     _data.tileToDraw = tileNum;
+    _data.slotToDraw = slot;
     _geom->draw(ri);
 }
 
@@ -318,6 +496,12 @@ InstanceCloud::Renderer::drawImplementation(osg::RenderInfo& ri, const osg::Draw
 
     osg::GLExtensions* ext = state.get<osg::GLExtensions>();
 
+    const ViewData* view = _data->view;
+    if (view && !view->commandBuffer.valid())
+    {
+        return;
+    }
+
     if (_data->tileToDraw == 0)
     {
         const osg::Geometry* geom = drawable->asGeometry();
@@ -328,13 +512,49 @@ InstanceCloud::Renderer::drawImplementation(osg::RenderInfo& ri, const osg::Draw
         osg::GLBufferObject* ebo = geom->getPrimitiveSet(0)->getOrCreateGLBufferObject(state.getContextID());
         state.bindElementBufferObject(ebo);
 
-        ext->glBindBufferBase(
-            GL_SHADER_STORAGE_BUFFER, 
-            BINDING_COMMAND_BUFFER, 
-            _data->commandBuffer->name());
+        if (view)
+        {
+            // culled instances index into the whole render buffer
+            ext->glBindBufferBase(
+                GL_SHADER_STORAGE_BUFFER,
+                BINDING_RENDER_BUFFER,
+                _data->renderBuffer->name());
 
-        _data->commandBuffer->bind(GL_DRAW_INDIRECT_BUFFER);
-        //ext->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _data->commandBuffer->_handle);
+            view->commandBuffer->bind(GL_DRAW_INDIRECT_BUFFER);
+        }
+        else
+        {
+            ext->glBindBufferBase(
+                GL_SHADER_STORAGE_BUFFER, 
+                BINDING_COMMAND_BUFFER, 
+                _data->commandBuffer->name());
+
+            _data->commandBuffer->bind(GL_DRAW_INDIRECT_BUFFER);
+            //ext->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _data->commandBuffer->_handle);
+        }
+    }
+
+    if (view)
+    {
+        // one draw per LOD, each from the "nth" tile's visible list for that LOD:
+        for (unsigned lod = 0; lod < view->numLODs; ++lod)
+        {
+            unsigned index = _data->tileToDraw * view->numLODs + lod;
+
+            ext->glBindBufferRange(
+                GL_SHADER_STORAGE_BUFFER,
+                BINDING_VISIBLE_BUFFER,
+                view->visibleBuffer->name(),
+                index * view->visibleBufferTileSize,
+                view->visibleBufferTileSize);
+
+            _glDrawElementsIndirect(
+                _data->mode,
+                _data->dataType,
+                (const void*)(index * sizeof(DrawElementsIndirectCommand)) );
+        }
+
+        return;
     }
 
     // activate the "nth" tile in the render buffer:
@@ -342,13 +562,13 @@ InstanceCloud::Renderer::drawImplementation(osg::RenderInfo& ri, const osg::Draw
         GL_SHADER_STORAGE_BUFFER, 
         BINDING_RENDER_BUFFER,
         _data->renderBuffer->name(), 
-        _data->tileToDraw * _data->renderBufferTileSize,
+        _data->slotToDraw * _data->renderBufferTileSize,
         _data->renderBufferTileSize);
 
     _glDrawElementsIndirect(
         _data->mode,
         _data->dataType,
-        (const void*)(_data->tileToDraw * sizeof(DrawElementsIndirectCommand)) );
+        (const void*)(_data->slotToDraw * sizeof(DrawElementsIndirectCommand)) );
 }
 
 
@@ -397,8 +617,10 @@ InstanceCloud::ModelCruncher::ModelCruncher() :
     _texcoords = new osg::Vec3Array(osg::Array::BIND_PER_VERTEX);
     _geom->setTexCoordArray(7, _texcoords);
 
-    _primset = new osg::DrawElementsUShort(GL_TRIANGLES);
+    _primset = new osg::DrawElementsUInt(GL_TRIANGLES);
     _geom->addPrimitiveSet(_primset);
+
+    _impostorLOD = -1;
 }
 
 void
@@ -415,6 +637,223 @@ InstanceCloud::ModelCruncher::add(osg::Node* node)
     node->accept(*this);
 }
 
+void
+InstanceCloud::ModelCruncher::addLOD(osg::Node* node)
+{
+    LOD lod;
+    lod.firstIndex = _primset->size();
+    add(node);
+    lod.count = _primset->size() - lod.firstIndex;
+
+    if (lod.count > 0)
+    {
+        _lods.push_back(lod);
+    }
+}
+
+namespace
+{
+    // Hemi-octahedral mapping of the upper hemisphere onto [-1..1]^2.
+    // GroundCover.Model.glsl has the GLSL version of these; keep them in sync.
+    osg::Vec3f impostorDirection(const osg::Vec2f& uv)
+    {
+        osg::Vec2f p((uv.x() + uv.y())*0.5f, (uv.x() - uv.y())*0.5f);
+        osg::Vec3f dir(p.x(), p.y(), 1.0f - fabs(p.x()) - fabs(p.y()));
+        dir.normalize();
+        return dir;
+    }
+
+    // View basis of the impostor frame looking back along "dir"
+    void impostorBasis(const osg::Vec3f& dir, osg::Vec3f& right, osg::Vec3f& up)
+    {
+        osg::Vec3f ref = fabs(dir.z()) > 0.999f ? osg::Vec3f(0, 1, 0) : osg::Vec3f(0, 0, 1);
+        right = ref ^ dir;
+        right.normalize();
+        up = dir ^ right;
+    }
+
+    osg::BoundingSphere boundOfLOD(
+        const osg::Vec3Array* verts,
+        const osg::DrawElementsUInt* primset,
+        const InstanceCloud::LOD& lod)
+    {
+        osg::BoundingBox box;
+        for (GLuint i = lod.firstIndex; i < lod.firstIndex + lod.count; ++i)
+            box.expandBy((*verts)[(*primset)[i]]);
+        return osg::BoundingSphere(box);
+    }
+}
+
+osg::Image*
+InstanceCloud::ModelCruncher::bakeImpostor(unsigned frames, unsigned frameSize) const
+{
+    if (_lods.empty() || frames == 0u || frameSize == 0u)
+        return NULL;
+
+    const LOD& lod = _lods.front();
+    osg::BoundingSphere bs = boundOfLOD(_verts, _primset, lod);
+    if (!bs.valid() || bs.radius() <= 0.0f)
+        return NULL;
+
+    unsigned size = frames * frameSize;
+
+    osg::ref_ptr<osg::Image> atlas = new osg::Image();
+    atlas->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    ::memset(atlas->data(), 0, atlas->getTotalSizeInBytes());
+
+    std::vector<ImageUtils::PixelReader> readers(_imagesToAdd.size());
+    for (unsigned i = 0; i < _imagesToAdd.size(); ++i)
+    {
+        readers[i].setImage(_imagesToAdd[i].get());
+        readers[i].setBilinear(true);
+        readers[i].setSampleAsRepeatingTexture(true);
+    }
+
+    std::vector<float> depth(frameSize * frameSize);
+
+    for (unsigned j = 0; j < frames; ++j)
+    {
+        for (unsigned i = 0; i < frames; ++i)
+        {
+            osg::Vec2f uv(
+                (float(i) + 0.5f) / float(frames) * 2.0f - 1.0f,
+                (float(j) + 0.5f) / float(frames) * 2.0f - 1.0f);
+
+            osg::Vec3f dir = impostorDirection(uv);
+            osg::Vec3f right, up;
+            impostorBasis(dir, right, up);
+
+            std::fill(depth.begin(), depth.end(), -FLT_MAX);
+
+            // orthographic projection of the model into this frame:
+            for (GLuint k = lod.firstIndex; k + 2 < lod.firstIndex + lod.count; k += 3)
+            {
+                GLuint index[3] = { (*_primset)[k], (*_primset)[k+1], (*_primset)[k+2] };
+                osg::Vec3f screen[3];
+                for (int v = 0; v < 3; ++v)
+                {
+                    osg::Vec3f p = (*_verts)[index[v]] - bs.center();
+                    screen[v].set(
+                        ((p * right) / bs.radius() * 0.5f + 0.5f) * frameSize,
+                        ((p * up) / bs.radius() * 0.5f + 0.5f) * frameSize,
+                        p * dir);
+                }
+
+                float area =
+                    (screen[1].x() - screen[0].x()) * (screen[2].y() - screen[0].y()) -
+                    (screen[2].x() - screen[0].x()) * (screen[1].y() - screen[0].y());
+                if (fabs(area) < 1e-6f)
+                    continue;
+
+                int x0 = osg::clampBetween((int)floor(osg::minimum(screen[0].x(), osg::minimum(screen[1].x(), screen[2].x()))), 0, (int)frameSize - 1);
+                int x1 = osg::clampBetween((int)ceil (osg::maximum(screen[0].x(), osg::maximum(screen[1].x(), screen[2].x()))), 0, (int)frameSize - 1);
+                int y0 = osg::clampBetween((int)floor(osg::minimum(screen[0].y(), osg::minimum(screen[1].y(), screen[2].y()))), 0, (int)frameSize - 1);
+                int y1 = osg::clampBetween((int)ceil (osg::maximum(screen[0].y(), osg::maximum(screen[1].y(), screen[2].y()))), 0, (int)frameSize - 1);
+
+                for (int y = y0; y <= y1; ++y)
+                {
+                    for (int x = x0; x <= x1; ++x)
+                    {
+                        // barycentric coordinates of the pixel center:
+                        float px = float(x) + 0.5f, py = float(y) + 0.5f;
+                        float w0 = ((screen[1].x() - px) * (screen[2].y() - py) - (screen[2].x() - px) * (screen[1].y() - py)) / area;
+                        float w1 = ((screen[2].x() - px) * (screen[0].y() - py) - (screen[0].x() - px) * (screen[2].y() - py)) / area;
+                        float w2 = 1.0f - w0 - w1;
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                            continue;
+
+                        float z = w0*screen[0].z() + w1*screen[1].z() + w2*screen[2].z();
+                        float& zbuf = depth[y*frameSize + x];
+                        if (z <= zbuf)
+                            continue;
+
+                        osg::Vec4f color(1, 1, 1, 1);
+
+                        if (index[0] < _texcoords->size() && index[1] < _texcoords->size() && index[2] < _texcoords->size())
+                        {
+                            osg::Vec3f tc =
+                                (*_texcoords)[index[0]] * w0 +
+                                (*_texcoords)[index[1]] * w1 +
+                                (*_texcoords)[index[2]] * w2;
+
+                            int layer = (int)((*_texcoords)[index[0]].z() + 0.5f);
+                            if (layer >= 0 && layer < (int)readers.size())
+                                color = readers[layer](tc.x(), tc.y());
+                        }
+
+                        if (index[0] < _colors->size() && index[1] < _colors->size() && index[2] < _colors->size())
+                        {
+                            osg::Vec4f vc =
+                                (*_colors)[index[0]] * w0 +
+                                (*_colors)[index[1]] * w1 +
+                                (*_colors)[index[2]] * w2;
+                            color.set(color.r()*vc.r(), color.g()*vc.g(), color.b()*vc.b(), color.a()*vc.a());
+                        }
+
+                        // alpha-tested, like the model's own fragment shader
+                        if (color.a() < 0.5f)
+                            continue;
+
+                        zbuf = z;
+
+                        unsigned char* out = atlas->data(i*frameSize + x, j*frameSize + y);
+                        out[0] = (unsigned char)(osg::clampBetween(color.r(), 0.0f, 1.0f) * 255.0f);
+                        out[1] = (unsigned char)(osg::clampBetween(color.g(), 0.0f, 1.0f) * 255.0f);
+                        out[2] = (unsigned char)(osg::clampBetween(color.b(), 0.0f, 1.0f) * 255.0f);
+                        out[3] = 255;
+                    }
+                }
+            }
+        }
+    }
+
+    return atlas.release();
+}
+
+void
+InstanceCloud::ModelCruncher::addImpostor(osg::Image* atlas, unsigned frames)
+{
+    if (!atlas || frames == 0u || _lods.empty())
+        return;
+
+    _impostorBound = boundOfLOD(_verts, _primset, _lods.front());
+
+    // keep the vertex attributes aligned with the vertices
+    unsigned numVerts = _verts->size();
+    _normals->resize(numVerts, osg::Vec3f(0, 0, 1));
+    _colors->resize(numVerts, osg::Vec4f(1, 1, 1, 1));
+    _texcoords->resize(numVerts, osg::Vec3f(0, 0, 0));
+
+    float layer = (float)_imagesToAdd.size();
+    _imagesToAdd.push_back(atlas);
+
+    // The vertex shader turns these into a camera-facing quad and
+    // picks the atlas frame; the texture coordinates hold the quad corners.
+    const osg::Vec2f corners[4] = { {0,0}, {1,0}, {0,1}, {1,1} };
+    for (int i = 0; i < 4; ++i)
+    {
+        _verts->push_back(_impostorBound.center());
+        _normals->push_back(osg::Vec3f(0, 0, 1));
+        _colors->push_back(osg::Vec4f(1, 1, 1, 1));
+        _texcoords->push_back(osg::Vec3f(corners[i].x(), corners[i].y(), layer));
+    }
+
+    LOD lod;
+    lod.firstIndex = _primset->size();
+    const GLuint quad[6] = { 0, 1, 2, 2, 1, 3 };
+    for (int i = 0; i < 6; ++i)
+        _primset->addElement(numVerts + quad[i]);
+    lod.count = 6;
+
+    _impostorLOD = _lods.size();
+    _lods.push_back(lod);
+
+    osg::StateSet* ss = _geom->getOrCreateStateSet();
+    ss->addUniform(new osg::Uniform("oe_gc_impostor", osg::Vec4f(_impostorBound.center(), _impostorBound.radius())));
+    ss->addUniform(new osg::Uniform("oe_gc_impostorFrames", (int)frames));
+    ss->addUniform(new osg::Uniform("oe_gc_impostorLOD", _impostorLOD));
+}
+
 namespace
 {
     template<typename T> void append(T* dest, const osg::Array* src, int numVerts)
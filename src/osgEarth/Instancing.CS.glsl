@@ -0,0 +1,82 @@
+#version 430
+
+// Per-instance culling for DrawInstanced. Each invocation tests one
+// instance against the view frustum and the LOD range of the drawable
+// being rendered, and appends the survivors to the visible list that
+// Instancing.glsl reads in place of gl_InstanceID.
+
+#define WORK_GROUP_SIZE 64
+layout(local_size_x=WORK_GROUP_SIZE, local_size_y=1, local_size_z=1) in;
+
+// One per primitive set. Arrays commands only use the first four
+// fields, but share the stride so both kinds can live in one buffer.
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseVertex;
+    uint baseInstance;
+};
+
+layout(binding=0, std430) buffer DrawCommandBuffer {
+    DrawCommand cmd[];
+};
+
+layout(binding=3, std430) writeonly buffer VisibleBuffer {
+    uint visible[];
+};
+
+// instance matrices, same layout the vertex shader reads
+uniform samplerBuffer oe_di_postex_TBO;
+
+uniform int oe_di_numInstances;
+uniform int oe_di_numCommands;
+
+// all of these are in the drawable's model space
+uniform vec4 oe_di_frustum[6];  // inward-facing unit planes
+uniform vec4 oe_di_bound;       // un-instanced bounding sphere: center, radius
+uniform vec3 oe_di_eye;         // view point
+uniform vec3 oe_di_lodCenter;   // un-instanced LOD center
+uniform vec2 oe_di_lodRange;    // [min, max) instance range, LOD scale applied
+
+void main()
+{
+    // large instance counts dispatch more than one row of work groups
+    uint i = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * WORK_GROUP_SIZE + gl_GlobalInvocationID.x;
+    if (i >= uint(oe_di_numInstances))
+        return;
+
+    int index = 4 * int(i);
+    vec4 m0 = texelFetch(oe_di_postex_TBO, index);
+    vec4 m1 = texelFetch(oe_di_postex_TBO, index+1);
+    vec4 m2 = texelFetch(oe_di_postex_TBO, index+2);
+
+    // transposed, as in Instancing.glsl
+    mat4 xform = mat4(m0, m1, m2, vec4(0,0,0,1));
+
+    vec3 center = (vec4(oe_di_bound.xyz, 1.0) * xform).xyz;
+
+    float scale = max(
+        length(vec3(m0.x, m1.x, m2.x)),
+        max(length(vec3(m0.y, m1.y, m2.y)), length(vec3(m0.z, m1.z, m2.z))));
+
+    float radius = oe_di_bound.w * scale;
+
+    for (int p = 0; p < 6; ++p)
+    {
+        if (dot(oe_di_frustum[p].xyz, center) + oe_di_frustum[p].w < -radius)
+            return;
+    }
+
+    vec3 lodCenter = (vec4(oe_di_lodCenter, 1.0) * xform).xyz;
+    float range = distance(lodCenter, oe_di_eye);
+    if (range < oe_di_lodRange[0] || range >= oe_di_lodRange[1])
+        return;
+
+    // every command draws the same survivors
+    uint slot = atomicAdd(cmd[0].instanceCount, 1u);
+    for (int c = 1; c < oe_di_numCommands; ++c)
+        atomicAdd(cmd[c].instanceCount, 1u);
+
+    visible[slot] = i;
+}
@@ -8,6 +8,22 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma vp_location   vertex_model
 #pragma vp_order      0.0
 
+#pragma import_defines(OE_DI_GPU_CULL)
+
+#ifdef OE_DI_GPU_CULL
+#extension GL_ARB_shader_storage_buffer_object : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+// instances that survived Instancing.CS.glsl, in draw order
+layout(binding=3, std430) readonly buffer oe_di_VisibleBuffer
+{
+    uint oe_di_visible[];
+};
+#define OE_DI_INSTANCE int(oe_di_visible[gl_InstanceID])
+#else
+#define OE_DI_INSTANCE gl_InstanceID
+#endif
+
 uniform samplerBuffer oe_di_postex_TBO;
 
 // Stage-global containing object ID
@@ -16,7 +32,7 @@ vec3 vp_Normal;
 
 void oe_di_setInstancePosition(inout vec4 VertexMODEL)
 { 
-    int index = 4 * gl_InstanceID;
+    int index = 4 * OE_DI_INSTANCE;
 
     vec4 m0 = texelFetch(oe_di_postex_TBO, index);
     vec4 m1 = texelFetch(oe_di_postex_TBO, index+1); 
@@ -3527,3 +3527,123 @@ std::ostream& operator<<( std::ostream &sout, const Value &root )
    return sout;
 }
 
+
+//........................................................................
+
+#include <rapidjson/reader.h>
+#include <rapidjson/error/en.h>
+
+namespace
+{
+    // Builds a Json::Value from rapidjson's parse events
+    struct ValueHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, ValueHandler>
+    {
+        std::vector<Value*> stack_;
+        std::string key_;
+
+        ValueHandler(Value& root) { stack_.push_back(&root); }
+
+        // The value the next event fills in
+        Value& next()
+        {
+            Value& top = *stack_.back();
+            if (top.isArray())
+                return top.append(Value());
+            else if (top.isObject())
+                return top[key_];
+            else
+                return top;
+        }
+
+        bool Null() { next() = Value(); return true; }
+        bool Bool(bool b) { next() = b; return true; }
+        bool Int(int i) { next() = Value::Int(i); return true; }
+
+        // Same types Reader gives a number
+        bool Uint(unsigned u)
+        {
+            if (u <= Value::UInt(Value::maxInt))
+                next() = Value::Int(u);
+            else
+                next() = Value::UInt(u);
+            return true;
+        }
+        bool Int64(int64_t i) { next() = double(i); return true; }
+        bool Uint64(uint64_t u) { next() = double(u); return true; }
+        bool Double(double d) { next() = d; return true; }
+
+        bool String(const char* str, rapidjson::SizeType length, bool)
+        {
+            next() = std::string(str, length);
+            return true;
+        }
+
+        bool StartObject()
+        {
+            Value& v = next();
+            v = Value(objectValue);
+            stack_.push_back(&v);
+            return true;
+        }
+        bool Key(const char* str, rapidjson::SizeType length, bool)
+        {
+            key_.assign(str, length);
+            return true;
+        }
+        bool EndObject(rapidjson::SizeType) { stack_.pop_back(); return true; }
+
+        bool StartArray()
+        {
+            Value& v = next();
+            v = Value(arrayValue);
+            stack_.push_back(&v);
+            return true;
+        }
+        bool EndArray(rapidjson::SizeType) { stack_.pop_back(); return true; }
+    };
+}
+
+namespace osgEarth { namespace Util { namespace Json
+{
+    FastReader::FastReader()
+    {
+    }
+
+    bool
+    FastReader::parse(const std::string& document, Value& root)
+    {
+        error_.clear();
+        root = Value();
+
+        // parse a copy in place, so strings are not copied twice
+        std::vector<char> buffer(document.begin(), document.end());
+        buffer.push_back('\0');
+
+        ValueHandler handler(root);
+        rapidjson::Reader reader;
+        rapidjson::InsituStringStream stream(&buffer[0]);
+        rapidjson::ParseResult ok = reader.Parse<rapidjson::kParseInsituFlag | rapidjson::kParseCommentsFlag>(stream, handler);
+        if (!ok)
+        {
+            std::stringstream buf;
+            buf << rapidjson::GetParseError_En(ok.Code()) << " at offset " << ok.Offset();
+            error_ = buf.str();
+            return false;
+        }
+        return true;
+    }
+
+    bool
+    FastReader::parse(std::istream& is, Value& root)
+    {
+        std::stringstream buffer;
+        buffer << is.rdbuf();
+        return parse(buffer.str(), root);
+    }
+
+    std::string
+    FastReader::getFormatedErrorMessages() const
+    {
+        return error_;
+    }
+} } }
@@ -21,6 +21,13 @@
 #include <osgEarth/Registry>
 #include <osg/Texture2D>
 
+#ifndef GL_RED_INTEGER
+#define GL_RED_INTEGER 0x8D94
+#endif
+#ifndef GL_R8UI
+#define GL_R8UI 0x8232
+#endif
+
 #define LC "[LandCover] "
 
 using namespace osgEarth;
@@ -235,16 +242,193 @@ LandCoverDictionary::getClassByUV(const GeoImage& tile, double u, double v) cons
     if (!tile.valid())
         return 0L;
 
-    ImageUtils::PixelReader read(tile.getImage());
-    read.setBilinear(false); // nearest neighbor only!
-    read.setDenormalize(false);
-    float value = read(u, v).r();
+    const osg::Image* image = tile.getImage();
+    float value;
+
+    typedef ImageUtils::TypedPixelReader<GL_RED, GLfloat> CodeReader;
+    if (CodeReader::supports(image))
+    {
+        // native land cover tile: NN sample of the raw code, with the
+        // same clamp-to-edge as PixelReader
+        CodeReader read(image);
+        const float umin = 1.0f / (2.0f * (float)image->s());
+        const float vmin = 1.0f / (2.0f * (float)image->t());
+        int s = u<umin? 0 : u>(1.0f-umin)? image->s()-1 : (int)floorf(u*(float)image->s());
+        int t = v<vmin? 0 : v>(1.0f-vmin)? image->t()-1 : (int)floorf(v*(float)image->t());
+        value = read.value(s, t);
+    }
+    else
+    {
+        ImageUtils::PixelReader read(image);
+        read.setBilinear(false); // nearest neighbor only!
+        read.setDenormalize(false);
+        value = read(u, v).r();
+    }
 
     return getClassByValue((int)value);
 }
 
 //...........................................................................
 
+#undef  LC
+#define LC "[LandCoverPalette] "
+
+namespace
+{
+    inline bool isNoData(float code)
+    {
+        return code == NO_DATA_VALUE || code != code;
+    }
+}
+
+LandCoverPalette::LandCoverPalette() :
+_warnedFull(false)
+{
+    _codes = new osg::Image();
+    _codes->allocateImage(256, 1, 1, GL_RED, GL_FLOAT);
+    _codes->setInternalTextureFormat(GL_R32F);
+    GLfloat* ptr = (GLfloat*)_codes->data();
+    for (unsigned i = 0; i < 256; ++i)
+        ptr[i] = NO_DATA_VALUE;
+
+    _codeTexture = new osg::Texture2D(_codes.get());
+    _codeTexture->setName("oe land cover palette");
+    _codeTexture->setDataVariance(osg::Object::DYNAMIC);
+    _codeTexture->setInternalFormat(GL_R32F);
+    _codeTexture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    _codeTexture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    _codeTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _codeTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    _codeTexture->setResizeNonPowerOfTwoHint(false);
+    // new codes are appended after the first upload:
+    _codeTexture->setUnRefImageDataAfterApply(false);
+}
+
+void
+LandCoverPalette::addClasses(const LandCoverDictionary* dictionary)
+{
+    if (!dictionary)
+        return;
+
+    Threading::ScopedMutexLock lock(_mutex);
+    unsigned before = _indices.size();
+
+    for (const auto& lcc : dictionary->getClasses())
+    {
+        if (lcc.valid())
+            addCodeUnderLock((float)lcc->getValue());
+    }
+
+    if (_indices.size() != before)
+        _codes->dirty();
+}
+
+GLubyte
+LandCoverPalette::getIndex(float code)
+{
+    if (isNoData(code))
+        return 0;
+
+    Threading::ScopedMutexLock lock(_mutex);
+    unsigned before = _indices.size();
+    GLubyte index = addCodeUnderLock(code);
+    if (_indices.size() != before)
+        _codes->dirty();
+    return index;
+}
+
+GLubyte
+LandCoverPalette::addCodeUnderLock(float code)
+{
+    int key = (int)code;
+    std::unordered_map<int, GLubyte>::const_iterator i = _indices.find(key);
+    if (i != _indices.end())
+        return i->second;
+
+    if (_indices.size() >= 255)
+    {
+        if (!_warnedFull)
+        {
+            OE_WARN << LC << "More than 255 land cover codes in use; "
+                "extra codes will render as no-data" << std::endl;
+            _warnedFull = true;
+        }
+        return 0;
+    }
+
+    GLubyte index = (GLubyte)(_indices.size() + 1);
+    _indices[key] = index;
+    ((GLfloat*)_codes->data())[index] = (GLfloat)key;
+    return index;
+}
+
+float
+LandCoverPalette::getCode(unsigned index) const
+{
+    if (index == 0 || index > 255)
+        return NO_DATA_VALUE;
+
+    Threading::ScopedMutexLock lock(_mutex);
+    return ((const GLfloat*)_codes->data())[index];
+}
+
+osg::Image*
+LandCoverPalette::createIndexedImage(const osg::Image* landCover)
+{
+    if (!LandCover::isLandCover(landCover))
+        return NULL;
+
+    osg::Image* image = new osg::Image();
+    image->allocateImage(landCover->s(), landCover->t(), landCover->r(), GL_RED_INTEGER, GL_UNSIGNED_BYTE);
+    image->setInternalTextureFormat(getTextureFormat());
+
+    Threading::ScopedMutexLock lock(_mutex);
+    unsigned before = _indices.size();
+
+    // tiles are mostly runs of the same code, so remember the last one
+    float lastCode = NO_DATA_VALUE;
+    GLubyte lastIndex = 0;
+
+    for (int r = 0; r < landCover->r(); ++r)
+    {
+        for (int t = 0; t < landCover->t(); ++t)
+        {
+            const GLfloat* in = (const GLfloat*)landCover->data(0, t, r);
+            GLubyte* out = image->data(0, t, r);
+
+            for (int s = 0; s < landCover->s(); ++s)
+            {
+                float code = in[s];
+                if (code != lastCode)
+                {
+                    lastCode = code;
+                    lastIndex = isNoData(code) ? 0 : addCodeUnderLock(code);
+                }
+                out[s] = lastIndex;
+            }
+        }
+    }
+
+    if (_indices.size() != before)
+        _codes->dirty();
+
+    return image;
+}
+
+GLint
+LandCoverPalette::getTextureFormat()
+{
+    return GL_R8UI;
+}
+
+bool
+LandCoverPalette::isIndexed(const osg::Image* image)
+{
+    return image && image->getPixelFormat() == GL_RED_INTEGER && image->getDataType() == GL_UNSIGNED_BYTE;
+}
+
+//...........................................................................
+
 #undef  LC
 #define LC "[LandCoverValueMapping] "
 
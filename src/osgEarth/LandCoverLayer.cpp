@@ -720,25 +720,56 @@ LandCoverLayerVector::populateLandCoverImage(
 
         // now composite this image under the previous one, 
         // accumulating a count of NO_DATA values along the way.
-        ImageUtils::PixelReader readOutput(output.get());
-        ImageUtils::PixelWriter writeOutput(output.get());
-
         numNoDataValues = 0u;
 
-        for(int t=0; t<readOutput.t(); ++t)
+        typedef ImageUtils::TypedPixelReader<GL_RED, GLfloat> CodeReader;
+        typedef ImageUtils::TypedPixelWriter<GL_RED, GLfloat> CodeWriter;
+
+        if (CodeWriter::supports(output.get()) && CodeReader::supports(comp.getImage()))
         {
-            for(int s=0; s<readOutput.s(); ++s)
+            // Both are native land cover tiles, so compare the raw codes
+            // instead of going through a color for every pixel.
+            CodeReader readCodes(comp.getImage());
+            CodeWriter writeCodes(output.get());
+
+            for(int t=0; t<writeCodes.t(); ++t)
             {
-                readOutput(value, s, t);
+                for(int s=0; s<writeCodes.s(); ++s)
+                {
+                    GLfloat* code = writeCodes.data(s, t);
+
+                    if (*code == NO_DATA_VALUE)
+                    {
+                        GLfloat input = readCodes.value((int)(s*scale+sbias), (int)(t*scale+tbias));
+
+                        if (input == NO_DATA_VALUE)
+                            numNoDataValues++;
+                        else
+                            *code = input;
+                    }
+                }
+            }
+        }
+        else
+        {
+            ImageUtils::PixelReader readOutput(output.get());
+            ImageUtils::PixelWriter writeOutput(output.get());
 
-                if (value.r() == NO_DATA_VALUE)
+            for(int t=0; t<readOutput.t(); ++t)
+            {
+                for(int s=0; s<readOutput.s(); ++s)
                 {
-                    readInput(value, (int)(s*scale+sbias), (int)(t*scale+tbias));
+                    readOutput(value, s, t);
 
                     if (value.r() == NO_DATA_VALUE)
-                        numNoDataValues++;
-                    else
-                        writeOutput(value, s, t);
+                    {
+                        readInput(value, (int)(s*scale+sbias), (int)(t*scale+tbias));
+
+                        if (value.r() == NO_DATA_VALUE)
+                            numNoDataValues++;
+                        else
+                            writeOutput(value, s, t);
+                    }
                 }
             }
         }
@@ -18,6 +18,7 @@
  */
 #include <osgEarth/Layer>
 #include <osgEarth/Cache>
+#include <osgEarth/EncodingCacheBin>
 #include <osgEarth/Registry>
 #include <osgEarth/SceneGraphCallback>
 #include <osgEarth/ShaderLoader>
@@ -41,12 +42,14 @@ Layer::Options::getConfig() const
     conf.set("cacheid", cacheId());
     if (cachePolicy().isSet() && !cachePolicy()->empty())
         conf.set("cache_policy", cachePolicy());
+    conf.set("cache_encoding", cacheEncoding());
     conf.set("shader_define", shaderDefine());
     conf.set("attribution", attribution());
     conf.set("terrain", terrainPatch());
     conf.set("proxy", _proxySettings );
     conf.set("osg_options", osgOptionString());
     conf.set("l2_cache_size", l2CacheSize());
+    conf.set("l2_cache_max_mb", l2CacheMaxMB());
 
     for(std::vector<ShaderOptions>::const_iterator i = shaders().begin();
         i != shaders().end();
@@ -71,7 +74,9 @@ Layer::Options::fromConfig(const Config& conf)
     conf.get("cacheid", cacheId());
     conf.get("attribution", attribution());
     conf.get("cache_policy", cachePolicy());
+    conf.get("cache_encoding", cacheEncoding());
     conf.get("l2_cache_size", l2CacheSize());
+    conf.get("l2_cache_max_mb", l2CacheMaxMB());
 
     // legacy support:
     if (!cachePolicy().isSet())
@@ -273,6 +278,18 @@ Layer::getCachePolicy() const
     return options().cachePolicy().get();
 }
 
+void
+Layer::setCacheEncoding(const std::string& value)
+{
+    setOptionThatRequiresReopen(options().cacheEncoding(), value);
+}
+
+const std::string&
+Layer::getCacheEncoding() const
+{
+    return options().cacheEncoding().get();
+}
+
 void
 Layer::init()
 {
@@ -292,6 +309,7 @@ Layer::init()
     }
 
     _mutex = new Threading::Mutex(options().name().isSet() ? options().name().get() : "Unnamed Layer(OE)");
+    _openMutex.setName("oe.Layer.open");
 }
 
 Status
@@ -303,6 +321,15 @@ Layer::open()
         return getStatus();
     }
 
+    // The map opens layers in parallel, so another thread may be opening
+    // this one already (a layer opening the layer it references, say).
+    // Wait for it and use its result.
+    Threading::ScopedRecursiveMutexLock lock(_openMutex);
+    if (isOpen())
+    {
+        return getStatus();
+    }
+
     // be optimistic :)
     _status.set(Status::NoError);
 
@@ -358,6 +385,19 @@ Layer::openImplementation()
 
         // make our cacheing bin!
         CacheBin* bin = _cacheSettings->getCache()->addBin(_runtimeCacheId);
+
+        // compress records on their way into the bin
+        if (bin && options().cacheEncoding().isSet() && !options().cacheEncoding()->empty())
+        {
+            bin = new EncodingCacheBin(bin, options().cacheEncoding().get());
+        }
+
+        // queue writes so slow storage doesn't hold up tile loading
+        if (bin && _cacheSettings->getCache()->getCacheOptions().writeBehind() == true)
+        {
+            bin = _cacheSettings->getCache()->getWriteBehindBin(bin);
+        }
+
         if (bin)
         {
             OE_INFO << LC << "Cache bin is [" << _runtimeCacheId << "]\n";
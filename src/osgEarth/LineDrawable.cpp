@@ -277,9 +277,88 @@ LineGroup::import(osg::Node* node, bool removePrimitiveSets)
     }
 }
 
+namespace
+{
+    // The width and stipple settings of a GPU line, as a per-vertex style
+    // (width, stipple factor, stipple pattern + 1). A zero means "inherit",
+    // just as a missing uniform would.
+    osg::Vec3 getLineStyle(LineDrawable* line)
+    {
+        osg::Vec3 style(0, 0, 0);
+        const osg::StateSet* ss = line->getStateSet();
+        if (ss)
+        {
+            if (ss->getUniform("oe_GL_LineWidth"))
+            {
+                style[0] = line->getLineWidth();
+            }
+            if (ss->getUniform("oe_GL_LineStipplePattern") || ss->getUniform("oe_GL_LineStippleFactor"))
+            {
+                style[1] = (float)line->getStippleFactor();
+                style[2] = (float)line->getStipplePattern() + 1.0f;
+            }
+        }
+        return style;
+    }
+
+    // Removes the width and stipple settings from a line's stateset.
+    void removeLineStyle(osg::StateSet* ss)
+    {
+        ss->removeUniform("oe_GL_LineWidth");
+        ss->removeUniform("oe_GL_LineStippleFactor");
+        ss->removeUniform("oe_GL_LineStipplePattern");
+        ss->removeAttribute(osg::StateAttribute::LINEWIDTH);
+        ss->removeAttribute(osg::StateAttribute::LINESTIPPLE);
+        ss->setDefine("OE_LINE_ATTRIB_STYLE");
+    }
+}
+
 void
 LineGroup::optimize()
 {
+    // Take the width and stippling out of the GPU lines' statesets, so that
+    // lines with different styles can share state and merge into the same
+    // drawable. Lines that limit their range with setFirst/setCount keep
+    // their own state and don't merge.
+    std::vector<LineDrawable*> batchable;
+    for (unsigned i = 0; i < getNumChildren(); ++i)
+    {
+        LineDrawable* line = getLineDrawable(i);
+        if (line &&
+            line->getUseGPU() &&
+            line->getDataVariance() != osg::Object::DYNAMIC &&
+            line->getVertexArray() != 0L &&
+            line->getVertexAttribArray(LineDrawable::StyleVertexAttrLocation) == 0L &&
+            (line->getStateSet() == 0L || line->getStateSet()->getUniform("oe_LineDrawable_limits") == 0L))
+        {
+            batchable.push_back(line);
+        }
+    }
+
+    if (batchable.size() > 1)
+    {
+        // read every style before touching any state, since lines may
+        // share statesets
+        std::vector<osg::Vec3> styles(batchable.size());
+        for (unsigned i = 0; i < batchable.size(); ++i)
+        {
+            styles[i] = getLineStyle(batchable[i]);
+        }
+
+        for (unsigned i = 0; i < batchable.size(); ++i)
+        {
+            LineDrawable* line = batchable[i];
+
+            unsigned numVerts = line->getVertexArray()->getNumElements();
+            osg::Vec3Array* style = new osg::Vec3Array(osg::Array::BIND_PER_VERTEX, numVerts);
+            style->assign(numVerts, styles[i]);
+            style->setNormalize(false);
+            line->setVertexAttribArray(LineDrawable::StyleVertexAttrLocation, style);
+
+            removeLineStyle(line->getOrCreateStateSet());
+        }
+    }
+
     // Optimize state sharing so the MergeGeometryVisitor can work better.
     // Without this step, the #defines used for width and stippling will
     // hold up the merge.
@@ -327,6 +406,7 @@ namespace osgEarth { namespace Serializers { namespace LineDrawable
 // static attribute binding locations. Changable by the user.
 int LineDrawable::PreviousVertexAttrLocation = 9;
 int LineDrawable::NextVertexAttrLocation = 10;
+int LineDrawable::StyleVertexAttrLocation = 11;
 
 LineDrawable::LineDrawable() :
 osg::Geometry(),
@@ -1258,6 +1338,7 @@ LineDrawable::setupShaders()
                 shaders.load(vp, shaders.LineDrawable);
                 vp->addBindAttribLocation("oe_LineDrawable_prev", LineDrawable::PreviousVertexAttrLocation);
                 vp->addBindAttribLocation("oe_LineDrawable_next", LineDrawable::NextVertexAttrLocation);
+                vp->addBindAttribLocation("oe_LineDrawable_style", LineDrawable::StyleVertexAttrLocation);
                 s_gpuStateSet->getOrCreateUniform("oe_LineDrawable_limits", osg::Uniform::FLOAT_VEC2)->set(osg::Vec2f(-1, -1));
                 s_gpuStateSet->setMode(GL_CULL_FACE, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE | osg::StateAttribute::PROTECTED);
             }
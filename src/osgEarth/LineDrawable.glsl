@@ -47,7 +47,7 @@ void oe_LineDrawable_VS_VIEW(inout vec4 currView)
 #pragma vp_name GPU Lines Screen Projected Clip
 #pragma vp_entryPoint oe_LineDrawable_VS_CLIP
 #pragma vp_location vertex_clip
-#pragma import_defines(OE_LINE_SMOOTH)
+#pragma import_defines(OE_LINE_SMOOTH, OE_LINE_ATTRIB_STYLE)
 
 // Set by the InstallCameraUniform callback
 uniform vec3 oe_Camera;
@@ -63,6 +63,13 @@ in vec3 oe_LineDrawable_next;
 flat out int oe_LineDrawable_draw;
 flat out vec2 oe_LineDrawable_rv;
 
+#ifdef OE_LINE_ATTRIB_STYLE
+// Per-vertex line style for batched lines: (width, stipple factor, stipple pattern+1).
+// Zero means "use the uniform".
+in vec3 oe_LineDrawable_style;
+flat out ivec2 oe_LineDrawable_stipple;
+#endif
+
 // Shared stage globals
 vec4 oe_LineDrawable_prevView;
 vec4 oe_LineDrawable_nextView;
@@ -87,10 +94,24 @@ void oe_LineDrawable_VS_CLIP(inout vec4 currClip)
     vec2 currPixel = ((currClip.xy/currClip.w)+1.0) * 0.5*oe_Camera.xy;
     vec2 nextPixel = ((nextClip.xy/nextClip.w)+1.0) * 0.5*oe_Camera.xy;
 
+    float lineWidth = oe_GL_LineWidth;
+    int stipplePattern = oe_GL_LineStipplePattern;
+
+#ifdef OE_LINE_ATTRIB_STYLE
+    if (oe_LineDrawable_style[0] > 0.0)
+        lineWidth = oe_LineDrawable_style[0];
+    oe_LineDrawable_stipple = ivec2(0, 0);
+    if (oe_LineDrawable_style[2] > 0.0)
+    {
+        stipplePattern = int(oe_LineDrawable_style[2]) - 1;
+        oe_LineDrawable_stipple = ivec2(int(oe_LineDrawable_style[1]), stipplePattern + 1);
+    }
+#endif
+
 #ifdef OE_LINE_SMOOTH
-    float thickness = floor(oe_GL_LineWidth + 1.0);
+    float thickness = floor(lineWidth + 1.0);
 #else
-    float thickness = max(0.5, floor(oe_GL_LineWidth));
+    float thickness = max(0.5, floor(lineWidth));
 #endif
 
     float len = thickness;
@@ -163,7 +184,7 @@ void oe_LineDrawable_VS_CLIP(inout vec4 currClip)
     currClip.xy += offset;
 
     // prepare for stippling:
-    if (oe_GL_LineStipplePattern != 0xffff)
+    if (stipplePattern != 0xffff)
     {
         // Line creation is done. Now, calculate a rotation angle
         // for use by out fragment shader to do GPU stippling. 
@@ -196,7 +217,7 @@ void oe_LineDrawable_VS_CLIP(inout vec4 currClip)
 #pragma vp_name GPU Lines Screen Projected FS
 #pragma vp_entryPoint oe_LineDrawable_Stippler_FS
 #pragma vp_location fragment_coloring
-#pragma import_defines(OE_LINE_SMOOTH)
+#pragma import_defines(OE_LINE_SMOOTH, OE_LINE_ATTRIB_STYLE)
 
 uniform int oe_GL_LineStippleFactor;
 uniform int oe_GL_LineStipplePattern;
@@ -204,6 +225,10 @@ uniform int oe_GL_LineStipplePattern;
 flat in vec2 oe_LineDrawable_rv;
 flat in int oe_LineDrawable_draw;
 
+#ifdef OE_LINE_ATTRIB_STYLE
+flat in ivec2 oe_LineDrawable_stipple;
+#endif
+
 #ifdef OE_LINE_SMOOTH
 in float oe_LineDrawable_lateral;
 #endif
@@ -213,7 +238,18 @@ void oe_LineDrawable_Stippler_FS(inout vec4 color)
     if (oe_LineDrawable_draw == 0)
         discard;
 
-    if (oe_GL_LineStipplePattern != 0xffff)
+    int stippleFactor = oe_GL_LineStippleFactor;
+    int stipplePattern = oe_GL_LineStipplePattern;
+
+#ifdef OE_LINE_ATTRIB_STYLE
+    if (oe_LineDrawable_stipple[1] > 0)
+    {
+        stippleFactor = oe_LineDrawable_stipple[0];
+        stipplePattern = oe_LineDrawable_stipple[1] - 1;
+    }
+#endif
+
+    if (stipplePattern != 0xffff)
     {
         // coordinate of the fragment, shifted to 0:
         vec2 coord = (gl_FragCoord.xy - 0.5);
@@ -226,8 +262,8 @@ void oe_LineDrawable_Stippler_FS(inout vec4 color)
             * coord;
 
         // sample the stippling pattern (16-bits repeating)
-        int ci = int(mod(coordProj.x, 16.0 * float(oe_GL_LineStippleFactor))) / oe_GL_LineStippleFactor;
-        int pattern16 = 0xffff & (oe_GL_LineStipplePattern & (1 << ci));
+        int ci = int(mod(coordProj.x, 16.0 * float(stippleFactor))) / stippleFactor;
+        int pattern16 = 0xffff & (stipplePattern & (1 << ci));
         if (pattern16 == 0)
             discard; 
 
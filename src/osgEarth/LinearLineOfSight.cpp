@@ -251,21 +251,40 @@ LinearLineOfSightNode::compute(osg::Node* node, bool backgroundThread)
       }
 
 
-      osgUtil::LineSegmentIntersector* lsi = new osgUtil::LineSegmentIntersector(_startWorld, _endWorld);
-      osgUtil::IntersectionVisitor iv( lsi );
-
-      node->accept( iv );
-
-      osgUtil::LineSegmentIntersector::Intersections& hits = lsi->getIntersections();
-      if ( hits.size() > 0 )
+      if (_terrainOnly)
       {
-          _hasLOS = false;
-          _hitWorld = hits.begin()->getWorldIntersectPoint();
-          _hit.fromWorld( mapSRS, _hitWorld );
+          // march through the elevation data instead of the terrain geometry
+          const Map* map = getMapNode()->getMap();
+          if (!_pyramid.valid() || _pyramid->getMap() != map)
+              _pyramid = new ElevationPyramid(map);
+
+          double length = (_endWorld - _startWorld).length();
+          Distance resolution(osg::maximum(length / 512.0, 1.0), Units::METERS);
+
+          _hasLOS = !_pyramid->intersect(_startWorld, _endWorld, resolution, _hitWorld);
+          if (!_hasLOS)
+          {
+              _hit.fromWorld( mapSRS, _hitWorld );
+          }
       }
       else
       {
-          _hasLOS = true;
+          osgUtil::LineSegmentIntersector* lsi = new osgUtil::LineSegmentIntersector(_startWorld, _endWorld);
+          osgUtil::IntersectionVisitor iv( lsi );
+
+          node->accept( iv );
+
+          osgUtil::LineSegmentIntersector::Intersections& hits = lsi->getIntersections();
+          if ( hits.size() > 0 )
+          {
+              _hasLOS = false;
+              _hitWorld = hits.begin()->getWorldIntersectPoint();
+              _hit.fromWorld( mapSRS, _hitWorld );
+          }
+          else
+          {
+              _hasLOS = true;
+          }
       }
     }
 
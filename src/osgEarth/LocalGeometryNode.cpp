@@ -34,6 +34,42 @@
 
 using namespace osgEarth;
 
+#define ARENA_ANNOTATION "oe.annotation"
+
+namespace
+{
+    // Tessellates and compiles geometry into a node, ready to install.
+    // Touches nothing but its arguments, so it's safe on any thread.
+    osg::ref_ptr<osg::Node> compileNode(Geometry* geom, const Style& style, Map* map)
+    {
+        osg::ref_ptr<Session> session;
+        if ( map )
+        {
+            session = new Session(map, 0L);
+        }
+
+        const AltitudeSymbol* alt = style.get<AltitudeSymbol>();
+
+        GeometryCompilerOptions options;
+        if (alt == NULL ||
+            alt->technique().isSet() == false ||
+            alt->technique().isSetTo(alt->TECHNIQUE_SCENE))
+        {        
+            options.ignoreAltitudeSymbol() = true;
+        }
+
+        GeometryCompiler gc(options);
+
+        osg::ref_ptr<osg::Node> node = gc.compile( geom, style, FilterContext(session.get()) );
+        if ( node.valid() )
+        {
+            // deal with draping or gpu-clamping settings
+            node = AnnotationUtils::installOverlayParent( node.get(), style );
+        }
+        return node;
+    }
+}
+
 
 LocalGeometryNode::LocalGeometryNode() :
 GeoPositionNode()
@@ -56,6 +92,8 @@ LocalGeometryNode::construct()
     _geom = 0L;
     _clampInUpdateTraversal = false;
     _perVertexClampingEnabled = false;
+    _backgroundCompile = false;
+    _compilePending = false;
 }
 
 void
@@ -68,8 +106,64 @@ LocalGeometryNode::setMapNode(MapNode* mapNode)
     }
 }
 
+void
+LocalGeometryNode::setBackgroundCompile(bool value)
+{
+    _backgroundCompile = value;
+}
+
+void
+LocalGeometryNode::rebuild()
+{
+    compileGeometry();
+}
+
 void
 LocalGeometryNode::compileGeometry()
+{
+    if ( _backgroundCompile && _geom.valid() )
+    {
+        // compile copies, so later changes can't reach the job
+        osg::ref_ptr<Geometry> geom = _geom->clone();
+        Style style = _style;
+        osg::ref_ptr<Map> map = getMapNode() ? getMapNode()->getMap() : 0L;
+
+        if ( !_compilePending )
+        {
+            _compilePending = true;
+            ADJUST_UPDATE_TRAV_COUNT(this, +1);
+        }
+
+        // replacing the future abandons any compile still in flight
+        Job job(JobArena::get(ARENA_ANNOTATION));
+        job.setName("oe.annotation.compile");
+        _compileResult = job.dispatch<osg::ref_ptr<osg::Node>>(
+            [geom, style, map](Cancelable* progress)
+            {
+                osg::ref_ptr<osg::Node> result;
+                if (progress == 0L || !progress->isCanceled())
+                    result = compileNode(geom.get(), style, map.get());
+                return result;
+            }
+        );
+    }
+    else
+    {
+        // a newer synchronous compile wins over one in flight
+        _compileResult.abandon();
+
+        osg::ref_ptr<osg::Node> node;
+        if ( _geom.valid() )
+        {
+            Map* map = getMapNode() ? getMapNode()->getMap() : 0L;
+            node = compileNode( _geom.get(), _style, map );
+        }
+        installNode( node.get() );
+    }
+}
+
+void
+LocalGeometryNode::installNode(osg::Node* node)
 {
     // clear out existing geometry first
     if (_node.valid())
@@ -81,43 +175,19 @@ LocalGeometryNode::compileGeometry()
     _clamperData.clear();
     _perVertexClampingEnabled = false;
     _clampCallback = NULL;
-    
-    if ( _geom.valid() )
-    {
-        osg::ref_ptr<Session> session;
-        if ( getMapNode() )
-        {
-            session = new Session(getMapNode()->getMap(), 0L);
-        }
 
-        AltitudeSymbol* alt = _style.get<AltitudeSymbol>();
-
-        GeometryCompilerOptions options;
-        if (alt == NULL ||
-            alt->technique().isSet() == false ||
-            alt->technique().isSetTo(alt->TECHNIQUE_SCENE))
-        {        
-            options.ignoreAltitudeSymbol() = true;
-        }
-
-        GeometryCompiler gc(options);
-
-        _node = gc.compile( _geom.get(), getStyle(), FilterContext(session.get()) );
-        if ( _node.valid() )
-        {
-            // deal with draping or gpu-clamping settings
-            _node = AnnotationUtils::installOverlayParent( _node.get(), getStyle() );
-
-            // install the new geometry under the geotransforms
-            getPositionAttitudeTransform()->addChild( _node.get() );
+    _node = node;
+    if ( _node.valid() )
+    {
+        // install the new geometry under the geotransforms
+        getPositionAttitudeTransform()->addChild( _node.get() );
 
-            // re-assess support for per vertex clamping
-            togglePerVertexClamping();
+        // re-assess support for per vertex clamping
+        togglePerVertexClamping();
 
-            // apply current style
-            setDefaultLighting( getStyle().has<ExtrusionSymbol>() );
-            applyRenderSymbology( getStyle() );
-        }
+        // apply current style
+        setDefaultLighting( getStyle().has<ExtrusionSymbol>() );
+        applyRenderSymbology( getStyle() );
     }
 }
 
@@ -125,14 +195,14 @@ void
 LocalGeometryNode::setStyle( const Style& style )
 {
     _style = style;
-    compileGeometry();
+    requestRebuild();
 }
 
 void
 LocalGeometryNode::setGeometry( Geometry* geom )
 {
     _geom = geom;
-    compileGeometry();
+    requestRebuild();
 }
 
 // GeoPositionNode override
@@ -292,6 +362,23 @@ LocalGeometryNode::traverse(osg::NodeVisitor& nv)
         _clampInUpdateTraversal = false;
         ADJUST_UPDATE_TRAV_COUNT(this, -1);
     }
+
+    // swap in a background compile once it's done
+    if (nv.getVisitorType() == nv.UPDATE_VISITOR && _compilePending)
+    {
+        if (_compileResult.isAvailable())
+        {
+            installNode(_compileResult.get().get());
+            _compileResult.abandon();
+        }
+
+        if (!_compileResult.isAvailable() && _compileResult.isAbandoned())
+        {
+            _compilePending = false;
+            ADJUST_UPDATE_TRAV_COUNT(this, -1);
+        }
+    }
+
     GeoPositionNode::traverse(nv);
 }
 
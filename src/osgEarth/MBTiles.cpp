@@ -34,6 +34,12 @@ using namespace osgEarth::MBTiles;
 #undef LC
 #define LC "[MBTiles] " << getName() << " : "
 
+// Most tiles the writer thread commits in one transaction
+#define MAX_TILES_PER_TRANSACTION 4096u
+
+// Most encoded tiles to hold for the writer before write() blocks
+#define MAX_PENDING_TILES 2048u
+
 //......................................................................
 
 namespace
@@ -50,6 +56,101 @@ namespace
         }
         return rw;
     }
+
+    // SQLite URI for a read-only connection to a file nobody will change
+    // while we have it open, so SQLite can skip file locking entirely.
+    std::string immutableURI(const std::string& filename)
+    {
+        std::string path = filename;
+        std::replace(path.begin(), path.end(), '\\', '/');
+
+        std::ostringstream buf;
+        buf << "file:";
+        if (path.size() > 1 && path[1] == ':')
+            buf << '/'; // windows drive letter
+        for (auto c : path)
+        {
+            if (c == '%' || c == '?' || c == '#')
+                buf << '%' << std::hex << std::setw(2) << std::setfill('0') << (int)(unsigned char)c << std::dec;
+            else
+                buf << c;
+        }
+        buf << "?mode=ro&immutable=1";
+        return buf.str();
+    }
+
+    // Runs a prepared tile SELECT and copies out the blob.
+    // Returns the result of sqlite3_step.
+    int selectTile(sqlite3_stmt* select, int z, int x, int y, std::string& out)
+    {
+        sqlite3_bind_int(select, 1, z);
+        sqlite3_bind_int(select, 2, x);
+        sqlite3_bind_int(select, 3, y);
+
+        int rc = sqlite3_step(select);
+        if (rc == SQLITE_ROW)
+        {
+            // the pointer returned from _blob gets freed internally by sqlite, supposedly
+            const char* data = (const char*)sqlite3_column_blob(select, 0);
+            int dataLen = sqlite3_column_bytes(select, 0);
+            out.assign(data, dataLen);
+        }
+
+        sqlite3_reset(select);
+        sqlite3_clear_bindings(select);
+        return rc;
+    }
+
+    // One 64-bit key for a tile's database address
+    unsigned long long packTileKey(int z, int x, int y)
+    {
+        return ((unsigned long long)z << 56) |
+            ((unsigned long long)(x & 0x0FFFFFFF) << 28) |
+            (unsigned long long)(y & 0x0FFFFFFF);
+    }
+
+    void unpackTileKey(unsigned long long key, int& z, int& x, int& y)
+    {
+        z = (int)(key >> 56);
+        x = (int)((key >> 28) & 0x0FFFFFFF);
+        y = (int)(key & 0x0FFFFFFF);
+    }
+
+    // Content ID for a tile blob in the images table. Two independent
+    // 64-bit hashes plus the length make an accidental match between
+    // different tiles vanishingly unlikely.
+    std::string blobID(const std::string& blob)
+    {
+        unsigned long long fnv = 14695981039346656037ull;
+        for (auto c : blob)
+        {
+            fnv ^= (unsigned char)c;
+            fnv *= 1099511628211ull;
+        }
+        std::ostringstream buf;
+        buf << std::hex << std::setfill('0')
+            << std::setw(16) << fnv
+            << std::setw(16) << (unsigned long long)std::hash<std::string>()(blob)
+            << '-' << std::dec << blob.size();
+        return buf.str();
+    }
+
+    // Runs a prepared insert, retrying while the database is busy
+    int stepInsert(sqlite3_stmt* insert)
+    {
+        int rc;
+        int tries = 0;
+        do {
+            rc = sqlite3_step(insert);
+        } while (++tries < 100 && (rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
+
+        sqlite3_reset(insert);
+        sqlite3_clear_bindings(insert);
+        return rc;
+    }
+
+    const char* SELECT_TILE_SQL =
+        "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
 }
 
 //...................................................................
@@ -139,6 +240,13 @@ MBTilesImageLayer::openImplementation()
     return Status::NoError;
 }
 
+Status
+MBTilesImageLayer::closeImplementation()
+{
+    _driver.close();
+    return ImageLayer::closeImplementation();
+}
+
 void
 MBTilesImageLayer::setDataExtents(const DataExtentList& values)
 {
@@ -252,6 +360,13 @@ MBTilesElevationLayer::openImplementation()
     return Status::NoError;
 }
 
+Status
+MBTilesElevationLayer::closeImplementation()
+{
+    _driver.close();
+    return ElevationLayer::closeImplementation();
+}
+
 void
 MBTilesElevationLayer::setDataExtents(const DataExtentList& values)
 {
@@ -322,16 +437,135 @@ bool MBTilesElevationLayer::putMetaData(const std::string& name, const std::stri
 #undef LC
 #define LC "[MBTiles] Layer \"" << _name << "\" "
 
+struct MBTiles::Driver::Connection
+{
+    sqlite3* _db;
+    sqlite3_stmt* _selectTile;
+
+    Connection() : _db(NULL), _selectTile(NULL) { }
+
+    ~Connection()
+    {
+        if (_selectTile)
+            sqlite3_finalize(_selectTile);
+        if (_db)
+            sqlite3_close(_db);
+    }
+};
+
 MBTiles::Driver::Driver() :
     _minLevel(0),
     _maxLevel(19),
     _forceRGB(false),
     _database(NULL),
-    _mutex("MBTiles Driver(OE)")
+    _readOnly(false),
+    _mutex("MBTiles Driver(OE)"),
+    _readersMutex("MBTiles Readers(OE)"),
+    _pendingMutex("MBTiles Pending(OE)"),
+    _batchesInFlight(0u),
+    _stopWriter(false),
+    _dedup(false)
 {
     //nop
 }
 
+MBTiles::Driver::~Driver()
+{
+    close();
+}
+
+void
+MBTiles::Driver::close()
+{
+    {
+        // the writer commits everything still queued before it exits
+        Threading::ScopedMutexLock lock(_pendingMutex);
+        _stopWriter = true;
+        _queued.notify_all();
+    }
+    if (_writer.joinable())
+    {
+        _writer.join();
+    }
+    _stopWriter = false;
+
+    {
+        Threading::ScopedMutexLock lock(_readersMutex);
+        for (auto reader : _readers)
+            delete reader;
+        _readers.clear();
+    }
+
+    Threading::ScopedMutexLock lock(_mutex);
+    if (_database)
+    {
+        sqlite3_close((sqlite3*)_database);
+        _database = NULL;
+    }
+}
+
+MBTiles::Driver::Connection*
+MBTiles::Driver::acquireReader() const
+{
+    {
+        Threading::ScopedMutexLock lock(_readersMutex);
+        if (!_readers.empty())
+        {
+            Connection* reader = _readers.back();
+            _readers.pop_back();
+            return reader;
+        }
+    }
+
+    // None idle, so open another. NOMUTEX is safe because a connection
+    // is only ever used by the one thread that acquired it.
+    Connection* reader = new Connection();
+
+    int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+    int rc = SQLITE_CANTOPEN;
+
+#if SQLITE_VERSION_NUMBER >= 3015000
+    // an immutable connection would ignore anything not yet checkpointed
+    // out of a write-ahead log, so only use one when there isn't a log.
+    if (!osgDB::fileExists(_fullFilename + "-wal"))
+    {
+        rc = sqlite3_open_v2(immutableURI(_fullFilename).c_str(), &reader->_db, flags | SQLITE_OPEN_URI, 0L);
+        if (rc != SQLITE_OK && reader->_db)
+        {
+            sqlite3_close(reader->_db);
+            reader->_db = NULL;
+        }
+    }
+#endif
+
+    if (rc != SQLITE_OK)
+    {
+        rc = sqlite3_open_v2(_fullFilename.c_str(), &reader->_db, flags, 0L);
+    }
+
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_prepare_v2(reader->_db, SELECT_TILE_SQL, -1, &reader->_selectTile, 0L);
+    }
+
+    if (rc != SQLITE_OK)
+    {
+        OE_WARN << LC << "Failed to open a reader for \"" << _fullFilename << "\": "
+            << (reader->_db ? sqlite3_errmsg(reader->_db) : "out of memory") << std::endl;
+        delete reader;
+        return NULL;
+    }
+
+    return reader;
+}
+
+void
+MBTiles::Driver::releaseReader(Connection* reader) const
+{
+    Threading::ScopedMutexLock lock(_readersMutex);
+    _readers.push_back(reader);
+}
+
 Status
 MBTiles::Driver::open(
     const std::string& name,
@@ -356,6 +590,9 @@ MBTiles::Driver::open(
 
     bool readWrite = isWritingRequested;
 
+    _fullFilename = fullFilename;
+    _readOnly = !readWrite;
+
     bool isNewDatabase = readWrite && !osgDB::fileExists(fullFilename);
 
     if (isNewDatabase)
@@ -405,6 +642,7 @@ MBTiles::Driver::open(
 
         // create necessary db tables:
         createTables();
+        _dedup = true;
 
         // write profile to metadata:
         std::string profileJSON = inout_profile->toProfileOptions().getConfig().toJSON(false);
@@ -432,6 +670,18 @@ MBTiles::Driver::open(
     // If the database pre-existed, read in the information from the metadata.
     else // !isNewDatabase
     {
+        // write into the images/map tables if the database has them
+        if (readWrite)
+        {
+            sqlite3_stmt* select = NULL;
+            std::string query = "SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name IN ('images', 'map')";
+            if (sqlite3_prepare_v2((sqlite3*)_database, query.c_str(), -1, &select, 0L) == SQLITE_OK)
+            {
+                _dedup = sqlite3_step(select) == SQLITE_ROW && sqlite3_column_int(select, 0) == 2;
+                sqlite3_finalize(select);
+            }
+        }
+
         computeLevels();
         OE_INFO << LC << "Got levels from database " << _minLevel << ", " << _maxLevel << std::endl;
 
@@ -612,8 +862,6 @@ MBTiles::Driver::read(
     ProgressCallback* progress,
     const osgDB::Options* readOptions) const
 {
-    Threading::ScopedMutexLock exclusiveLock(_mutex);
-
     int z = key.getLevelOfDetail();
     int x = key.getTileX();
     int y = key.getTileY();
@@ -633,70 +881,74 @@ MBTiles::Driver::read(
     key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
     y  = numRows - y - 1;
 
-    sqlite3* database = (sqlite3*)_database;
+    std::string dataBuffer;
+    int rc;
 
-    //Get the image
-    sqlite3_stmt* select = NULL;
-    std::string query = "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
-    int rc = sqlite3_prepare_v2( database, query.c_str(), -1, &select, 0L );
-    if ( rc != SQLITE_OK )
+    if (_readOnly)
     {
-        OE_WARN << LC << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database) << std::endl;
-        return ReadResult::RESULT_READER_ERROR;
-    }
-
-    bool valid = true;
-
-    sqlite3_bind_int( select, 1, z );
-    sqlite3_bind_int( select, 2, x );
-    sqlite3_bind_int( select, 3, y );
+        // a private connection, so no locking
+        Connection* reader = acquireReader();
+        if (!reader)
+        {
+            return ReadResult::RESULT_READER_ERROR;
+        }
 
-    osg::Image* result = NULL;
-    rc = sqlite3_step( select );
-    if ( rc == SQLITE_ROW)
+        rc = selectTile(reader->_selectTile, z, x, y, dataBuffer);
+        releaseReader(reader);
+    }
+    else if (findPending(packTileKey(z, x, y), dataBuffer))
+    {
+        // written but not committed yet
+        rc = SQLITE_ROW;
+    }
+    else
     {
-        // the pointer returned from _blob gets freed internally by sqlite, supposedly
-        const char* data = (const char*)sqlite3_column_blob( select, 0 );
-        int dataLen = sqlite3_column_bytes( select, 0 );
+        // The writer thread holds this while it commits, so a tile that
+        // has left the queue is always in the database by the time we look.
+        Threading::ScopedMutexLock exclusiveLock(_mutex);
 
-        std::string dataBuffer( data, dataLen );
+        sqlite3* database = (sqlite3*)_database;
 
-        // decompress if necessary:
-        if ( _compressor.valid() )
+        sqlite3_stmt* select = NULL;
+        rc = sqlite3_prepare_v2( database, SELECT_TILE_SQL, -1, &select, 0L );
+        if ( rc != SQLITE_OK )
         {
-            std::istringstream inputStream(dataBuffer);
-            std::string value;
-            if ( !_compressor->decompress(inputStream, value) )
-            {
-                OE_WARN << LC << "Decompression failed" << std::endl;
-                valid = false;
-            }
-            else
-            {
-                dataBuffer = value;
-            }
+            OE_WARN << LC << "Failed to prepare SQL: " << SELECT_TILE_SQL << "; " << sqlite3_errmsg(database) << std::endl;
+            return ReadResult::RESULT_READER_ERROR;
         }
 
-        // decode the raw image data:
-        if ( valid )
+        rc = selectTile(select, z, x, y, dataBuffer);
+        sqlite3_finalize( select );
+    }
+
+    if (rc != SQLITE_ROW)
+    {
+        OE_DEBUG << LC << "SQL QUERY failed for " << SELECT_TILE_SQL << ": " << std::endl;
+        return ReadResult(NULL);
+    }
+
+    // decompress if necessary:
+    if ( _compressor.valid() )
+    {
+        std::istringstream inputStream(dataBuffer);
+        std::string value;
+        if ( !_compressor->decompress(inputStream, value) )
         {
-            std::istringstream inputStream(dataBuffer);
-            result = ImageUtils::readStream(inputStream, _dbOptions.get());
-            // If we couldn't load the image automatically try the reader instead.
-            if (!result && _rw.valid())
-            {
-                result = _rw->readImage(inputStream, _dbOptions.get()).takeImage();
-            }
+            OE_WARN << LC << "Decompression failed" << std::endl;
+            return ReadResult(NULL);
         }
+        dataBuffer = value;
     }
-    else
+
+    // decode the raw image data:
+    std::istringstream inputStream(dataBuffer);
+    osg::Image* result = ImageUtils::readStream(inputStream, _dbOptions.get());
+    // If we couldn't load the image automatically try the reader instead.
+    if (!result && _rw.valid())
     {
-        OE_DEBUG << LC << "SQL QUERY failed for " << query << ": " << std::endl;
-        valid = false;
+        result = _rw->readImage(inputStream, _dbOptions.get()).takeImage();
     }
 
-    sqlite3_finalize( select );
-
     return ReadResult(result);
 }
 
@@ -710,8 +962,6 @@ MBTiles::Driver::write(
     if (!key.valid() || !image)
         return Status::AssertionFailure;
 
-    Threading::ScopedMutexLock exclusiveLock(_mutex);
-
     // encode the data stream:
     std::stringstream buf;
     osgDB::ReaderWriter::WriteResult wr;
@@ -753,44 +1003,23 @@ MBTiles::Driver::write(
     key.getProfile()->getNumTiles(key.getLevelOfDetail(), numCols, numRows);
     y = numRows - y - 1;
 
-    sqlite3* database = (sqlite3*)_database;
+    unsigned long long tileKey = packTileKey(z, x, y);
 
-    // Prep the insert statement:
-    sqlite3_stmt* insert = NULL;
-    std::string query = "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)";
-    int rc = sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L);
-    if (rc != SQLITE_OK)
+    std::unique_lock<Threading::Mutex> lock(_pendingMutex);
+
+    // wait for the writer to catch up, unless this replaces a queued tile
+    if (_pending.find(tileKey) == _pending.end())
     {
-        return Status(Status::GeneralError, Stringify()
-            << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        _committed.wait(lock, [this]() { return _pending.size() < MAX_PENDING_TILES; });
     }
 
-    // bind parameters:
-    sqlite3_bind_int(insert, 1, z);
-    sqlite3_bind_int(insert, 2, x);
-    sqlite3_bind_int(insert, 3, y);
-
-    // bind the data blob:
-    sqlite3_bind_blob(insert, 4, value.c_str(), value.length(), SQLITE_STATIC);
-
-    // run the sql.
-    bool ok = true;
-    int tries = 0;
-    do {
-        rc = sqlite3_step(insert);
-    } while (++tries < 100 && (rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
-
-    if (SQLITE_OK != rc && SQLITE_DONE != rc)
+    if (!_writer.joinable())
     {
-#if SQLITE_VERSION_NUMBER >= 3007015
-        return Status(Status::GeneralError, Stringify()<<"Failed query: " << query << "(" << rc << ")" << sqlite3_errstr(rc) << "; " << sqlite3_errmsg(database));
-#else
-        return Status(Status::GeneralError, Stringify()<< "Failed query: " << query << "(" << rc << ")" << rc << "; " << sqlite3_errmsg(database));
-#endif
-        ok = false;
+        _writer = std::thread([this]() { runWriter(); });
     }
 
-    sqlite3_finalize(insert);
+    _pending[tileKey].swap(value);
+    _queued.notify_one();
 
     // adjust the max level if necessary
     if (key.getLOD() > _maxLevel)
@@ -807,6 +1036,166 @@ MBTiles::Driver::write(
     return Status::NoError;
 }
 
+bool
+MBTiles::Driver::findPending(unsigned long long key, std::string& out) const
+{
+    Threading::ScopedMutexLock lock(_pendingMutex);
+    auto i = _pending.find(key);
+    if (i == _pending.end())
+        return false;
+    out = i->second;
+    return true;
+}
+
+void
+MBTiles::Driver::flush()
+{
+    std::unique_lock<Threading::Mutex> lock(_pendingMutex);
+    _committed.wait(lock, [this]() { return _pending.empty() && _batchesInFlight == 0u; });
+}
+
+void
+MBTiles::Driver::runWriter()
+{
+    Threading::setThreadName("oe.mbtiles.writer");
+
+    sqlite3* database = (sqlite3*)_database;
+
+    // statements live as long as the thread; close() joins it before
+    // closing the database.
+    sqlite3_stmt* insertTile = NULL;
+    sqlite3_stmt* insertImage = NULL;
+    sqlite3_stmt* insertMap = NULL;
+    {
+        Threading::ScopedMutexLock dbLock(_mutex);
+        if (_dedup)
+        {
+            sqlite3_prepare_v2(database,
+                "INSERT OR IGNORE INTO images (tile_id, tile_data) VALUES (?, ?)",
+                -1, &insertImage, 0L);
+            sqlite3_prepare_v2(database,
+                "INSERT OR REPLACE INTO map (zoom_level, tile_column, tile_row, tile_id) VALUES (?, ?, ?, ?)",
+                -1, &insertMap, 0L);
+        }
+        else
+        {
+            sqlite3_prepare_v2(database,
+                "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)",
+                -1, &insertTile, 0L);
+        }
+    }
+
+    bool prepared = _dedup ? (insertImage && insertMap) : (insertTile != NULL);
+    if (!prepared)
+    {
+        OE_WARN << LC << "Failed to prepare SQL for writing: " << sqlite3_errmsg(database) << std::endl;
+    }
+
+    std::map<unsigned long long, std::string> batch;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<Threading::Mutex> lock(_pendingMutex);
+            _queued.wait(lock, [this]() { return _stopWriter || !_pending.empty(); });
+            if (_pending.empty() && _stopWriter)
+                break;
+        }
+
+        // Hold the database across the hand-off, so readers never find a
+        // tile that's neither queued nor committed.
+        Threading::ScopedMutexLock dbLock(_mutex);
+        {
+            Threading::ScopedMutexLock lock(_pendingMutex);
+            while (!_pending.empty() && batch.size() < MAX_TILES_PER_TRANSACTION)
+            {
+                batch[_pending.begin()->first].swap(_pending.begin()->second);
+                _pending.erase(_pending.begin());
+            }
+            ++_batchesInFlight;
+
+            // room in the queue for blocked producers
+            _committed.notify_all();
+        }
+
+        unsigned failed = 0u;
+
+        if (prepared)
+        {
+            sqlite3_exec(database, "BEGIN TRANSACTION", 0L, 0L, 0L);
+
+            for (auto& tile : batch)
+            {
+                int z, x, y;
+                unpackTileKey(tile.first, z, x, y);
+                const std::string& value = tile.second;
+                int rc;
+
+                if (_dedup)
+                {
+                    // identical tiles (all ocean, say) share one image row
+                    std::string id = blobID(value);
+
+                    sqlite3_bind_text(insertImage, 1, id.c_str(), id.length(), SQLITE_STATIC);
+                    sqlite3_bind_blob(insertImage, 2, value.c_str(), value.length(), SQLITE_STATIC);
+                    rc = stepInsert(insertImage);
+
+                    if (rc == SQLITE_DONE)
+                    {
+                        sqlite3_bind_int(insertMap, 1, z);
+                        sqlite3_bind_int(insertMap, 2, x);
+                        sqlite3_bind_int(insertMap, 3, y);
+                        sqlite3_bind_text(insertMap, 4, id.c_str(), id.length(), SQLITE_STATIC);
+                        rc = stepInsert(insertMap);
+                    }
+                }
+                else
+                {
+                    sqlite3_bind_int(insertTile, 1, z);
+                    sqlite3_bind_int(insertTile, 2, x);
+                    sqlite3_bind_int(insertTile, 3, y);
+                    sqlite3_bind_blob(insertTile, 4, value.c_str(), value.length(), SQLITE_STATIC);
+                    rc = stepInsert(insertTile);
+                }
+
+                if (rc != SQLITE_DONE)
+                {
+                    ++failed;
+                    OE_DEBUG << LC << "Failed to write tile " << z << "/" << x << "/" << y << ": " << sqlite3_errmsg(database) << std::endl;
+                }
+            }
+
+            if (sqlite3_exec(database, "COMMIT TRANSACTION", 0L, 0L, 0L) != SQLITE_OK)
+            {
+                OE_WARN << LC << "Failed to commit " << batch.size() << " tiles: " << sqlite3_errmsg(database) << std::endl;
+                sqlite3_exec(database, "ROLLBACK TRANSACTION", 0L, 0L, 0L);
+            }
+        }
+        else
+        {
+            failed = batch.size();
+        }
+
+        if (failed > 0u)
+        {
+            OE_WARN << LC << failed << " of " << batch.size() << " tile writes failed" << std::endl;
+        }
+
+        batch.clear();
+
+        {
+            Threading::ScopedMutexLock lock(_pendingMutex);
+            --_batchesInFlight;
+            _committed.notify_all();
+        }
+    }
+
+    Threading::ScopedMutexLock dbLock(_mutex);
+    if (insertTile) sqlite3_finalize(insertTile);
+    if (insertImage) sqlite3_finalize(insertImage);
+    if (insertMap) sqlite3_finalize(insertMap);
+}
+
 bool
 MBTiles::Driver::getMetaData(const std::string& key, std::string& value)
 {
@@ -931,33 +1320,63 @@ MBTiles::Driver::createTables()
         return false;
     }
 
+    // Tiles are stored once per distinct blob in [images] and addressed
+    // through [map]; the [tiles] view joins them back up for readers.
     query =
-        "CREATE TABLE IF NOT EXISTS tiles ("
+        "CREATE TABLE IF NOT EXISTS images ("
+        " tile_data blob,"
+        " tile_id text)";
+
+    char* errorMsg = 0L;
+
+    if (SQLITE_OK != sqlite3_exec(database, query.c_str(), 0L, 0L, &errorMsg))
+    {
+        OE_WARN << LC << "Failed to create table [images]: " << errorMsg << std::endl;
+        sqlite3_free( errorMsg );
+        return false;
+    }
+
+    query =
+        "CREATE TABLE IF NOT EXISTS map ("
         " zoom_level integer,"
         " tile_column integer,"
         " tile_row integer,"
-        " tile_data blob)";
-
-    char* errorMsg = 0L;
+        " tile_id text)";
 
     if (SQLITE_OK != sqlite3_exec(database, query.c_str(), 0L, 0L, &errorMsg))
     {
-        OE_WARN << LC << "Failed to create table [tiles]: " << errorMsg << std::endl;
+        OE_WARN << LC << "Failed to create table [map]: " << errorMsg << std::endl;
         sqlite3_free( errorMsg );
         return false;
     }
 
-    // create an index
+    // create the indexes; the unique ones are what make INSERT OR IGNORE
+    // and INSERT OR REPLACE work
     query =
-        "CREATE UNIQUE INDEX tile_index ON tiles ("
+        "CREATE UNIQUE INDEX IF NOT EXISTS images_id ON images (tile_id);"
+        "CREATE UNIQUE INDEX IF NOT EXISTS map_index ON map ("
         " zoom_level, tile_column, tile_row)";
 
     if (SQLITE_OK != sqlite3_exec(database, query.c_str(), 0L, 0L, &errorMsg))
     {
-        OE_WARN << LC << "Failed to create index on table [tiles]: " << errorMsg << std::endl;
+        OE_WARN << LC << "Failed to create indexes: " << errorMsg << std::endl;
+        sqlite3_free( errorMsg );
+        return false;
+    }
+
+    query =
+        "CREATE VIEW IF NOT EXISTS tiles AS SELECT"
+        " map.zoom_level AS zoom_level,"
+        " map.tile_column AS tile_column,"
+        " map.tile_row AS tile_row,"
+        " images.tile_data AS tile_data"
+        " FROM map JOIN images ON images.tile_id = map.tile_id";
+
+    if (SQLITE_OK != sqlite3_exec(database, query.c_str(), 0L, 0L, &errorMsg))
+    {
+        OE_WARN << LC << "Failed to create view [tiles]: " << errorMsg << std::endl;
         sqlite3_free( errorMsg );
-        // keep going...
-        // return false;
+        return false;
     }
 
     // TODO: support "grids" and "grid_data" tables if necessary.
@@ -61,6 +61,7 @@ MGRSGraticule::Options::getConfig() const
     Config conf = VisibleLayer::Options::getConfig();
     conf.set("sqid_data", sqidData() );
     conf.set("use_default_styles", useDefaultStyles() );
+    conf.set("cache_size", cacheSize() );
     styleSheet().set(conf, "styles");
     return conf;
 }
@@ -69,9 +70,11 @@ void
 MGRSGraticule::Options::fromConfig(const Config& conf)
 {
     useDefaultStyles().init(true);
+    cacheSize().init(512u);
     sqidData().init(URI("../data/mgrs_sqid.bin", conf.referrer()));
     conf.get("sqid_data", sqidData() );
     conf.get("use_default_styles", useDefaultStyles() );
+    conf.get("cache_size", cacheSize() );
     styleSheet().get(conf, "styles");
 }
 
@@ -305,6 +308,33 @@ MGRSGraticule::getStyleSheet() const
     return options().styleSheet().getLayer();
 }
 
+void
+MGRSGraticule::setCacheSize(const unsigned& value)
+{
+    options().cacheSize() = value;
+    if (_cellCache)
+        _cellCache->setMaxSize(value);
+}
+
+const unsigned&
+MGRSGraticule::getCacheSize() const
+{
+    return options().cacheSize().get();
+}
+
+osg::ref_ptr<osg::Node>
+MGRSGraticule::loadCell(const std::string& key, const std::function<osg::Node*()>& build) const
+{
+    CellCache::Record record;
+    if (_cellCache->get(key, record))
+        return record.value();
+
+    osg::ref_ptr<osg::Node> node = build();
+    if (node.valid())
+        _cellCache->insert(key, node);
+    return node;
+}
+
 void
 MGRSGraticule::dirty()
 {
@@ -334,6 +364,8 @@ MGRSGraticule::init()
 
     _root = new LocalRoot();
 
+    _cellCache = std::make_shared<CellCache>(true, options().cacheSize().get());
+
     GLUtils::setLighting(_root->getOrCreateStateSet(), osg::StateAttribute::OFF);
 
     // install the range callback for clip plane activation
@@ -410,6 +442,7 @@ namespace
     struct GeomCell : public PagedNode2
     {
         double _size;        
+        std::string _key;
         osg::ref_ptr<Feature> _feature;
         Style _style;
         bool _hasChild;
@@ -429,6 +462,7 @@ namespace
     struct GeomGrid : public PagedNode2
     {
         double _size;
+        std::string _key;
         const MGRSGraticule* _parent;
         osg::ref_ptr<Feature> _feature;
         Style _style;
@@ -459,7 +493,9 @@ namespace
                 setLoadFunction([o](Cancelable*) mutable
                     {
                         osg::ref_ptr<GeomGrid> safe(o);
-                        return safe.valid() ? safe->loadChild() : nullptr;
+                        return safe.valid() ?
+                            safe->_parent->loadCell(safe->_key, [&]() { return safe->loadChild(); }) :
+                            osg::ref_ptr<osg::Node>();
                     });
             }
         }
@@ -493,6 +529,7 @@ namespace
                         f->set("easting", x);
                         f->set("northing", y);
                         GeomCell* child = new GeomCell(interval);
+                        child->_key = Stringify() << _key << '/' << (long long)x << ',' << (long long)y;
                         child->setupData(f.get(), _parent);
                         //child->setupPaging();
                         group->addChild(child);
@@ -599,7 +636,9 @@ namespace
             setLoadFunction([o](Cancelable*) mutable
                 {
                     osg::ref_ptr<GeomCell> safe(o);
-                    return safe.valid() ? safe->loadChild() : nullptr;
+                    return safe.valid() ?
+                        safe->_parent->loadCell(safe->_key, [&]() { return safe->loadChild(); }) :
+                        osg::ref_ptr<osg::Node>();
                 });
         }
     }
@@ -607,6 +646,7 @@ namespace
     osg::Node* GeomCell::loadChild()
     {
         GeomGrid* child = new GeomGrid(_size);
+        child->_key = _key + "/grid";
         child->setupData(_feature.get(), _parent);
         return child;
     }
@@ -645,6 +685,7 @@ namespace
     //! Geometry for a single SQID 100km cell and its children
     struct SQID100kmCell : public PagedNode2
     {
+        std::string _key;
         osg::ref_ptr<Feature> _feature;
         const MGRSGraticule* _parent;
         Style _style;
@@ -673,7 +714,9 @@ namespace
                 setLoadFunction([o](Cancelable* c) mutable
                     {
                         osg::ref_ptr< SQID100kmCell> safe(o);
-                        return safe.valid() ? safe->loadChild() : nullptr;
+                        return safe.valid() ?
+                            safe->_parent->loadCell(safe->_key, [&]() { return safe->loadChild(); }) :
+                            osg::ref_ptr<osg::Node>();
                     });
             }
         }
@@ -681,6 +724,7 @@ namespace
         osg::Node* loadChild()
         {
             GeomGrid* child = new GeomGrid(100000.0);
+            child->_key = _key + "/grid";
             child->setupData(_feature.get(), _parent);
             //child->setupPaging();
             return child;
@@ -711,6 +755,7 @@ namespace
     //! All SQID 100km goemetry from a single UTM GZD cell combined into one geometry
     struct SQID100kmGrid : public PagedNode2
     {
+        std::string _key;
         osg::BoundingSphere _bs;
         FeatureList _sqidFeatures;
         Style _style;
@@ -744,7 +789,9 @@ namespace
             setLoadFunction([o](Cancelable*) mutable
                 {
                     osg::ref_ptr< SQID100kmGrid> safe(o);
-                    return safe.valid() ? safe->loadChild() : nullptr;
+                    return safe.valid() ?
+                        safe->_parent->loadCell(safe->_key, [&]() { return safe->loadChild(); }) :
+                        osg::ref_ptr<osg::Node>();
                 });
         }
 
@@ -756,6 +803,7 @@ namespace
             {
                 Feature* feature = f->get();
                 SQID100kmCell* geom = new SQID100kmCell(feature->getString("sqid"));
+                geom->_key = _key + '/' + geom->getName();
                 geom->setupData(feature, _parent);
                 group->addChild(geom);
                 
@@ -781,6 +829,7 @@ namespace
 
     struct GZDGeom : public PagedNode2
     {
+        std::string _key;
         Style _sqidStyle;
         FeatureList _sqidFeatures;
         const MGRSGraticule* _parent;
@@ -799,6 +848,7 @@ namespace
         osg::Node* loadChild()
         {
             SQID100kmGrid* child = new SQID100kmGrid(getName(), getBound());
+            child->_key = _key + "/sqid";
             child->setupData(_sqidFeatures, _parent);
             return child;
         }
@@ -828,7 +878,9 @@ namespace
                 setLoadFunction([o](Cancelable*) mutable
                     {
                         osg::ref_ptr<GZDGeom> safe(o);
-                        return safe.valid() ? safe->loadChild() : nullptr;
+                        return safe.valid() ?
+                            safe->_parent->loadCell(safe->_key, [&]() { return safe->loadChild(); }) :
+                            osg::ref_ptr<osg::Node>();
                     });
             }
         }
@@ -1060,6 +1112,7 @@ MGRSGraticule::rebuild()
     
     // clear everything out and start over
     _root->removeChildren( 0, _root->getNumChildren() );
+    _cellCache->clear();
 
     if (getStyleSheet() == NULL)
         return;
@@ -1092,13 +1145,20 @@ MGRSGraticule::rebuild()
     writeSQIDfile(options().sqidData().get());
 #endif
     
-    FeatureList sqids;
-    if (readSQIDfile(options().sqidData().get(), sqids))
+    // the SQID table only needs reading once
+    if (_sqidFeatures.empty() || !(_sqidURI == options().sqidData().get()))
+    {
+        _sqidURI = options().sqidData().get();
+        readSQIDfile(_sqidURI, _sqidFeatures);
+    }
+
+    const FeatureList& sqids = _sqidFeatures;
+    if (!sqids.empty())
     {        
         typedef std::map<std::string, FeatureList> Table;
         Table table;
 
-        for (FeatureList::iterator i = sqids.begin(); i != sqids.end(); ++i)
+        for (FeatureList::const_iterator i = sqids.begin(); i != sqids.end(); ++i)
         {
             table[i->get()->getString("gzd")].push_back(i->get());
 
@@ -1185,6 +1245,7 @@ MGRSGraticule::rebuild()
             if (!gzd.empty())
             {
                 GZDGeom* geom = new GZDGeom(gzd);
+                geom->_key = gzd;
                 geom->setupData(feature.get(), table[gzd], this, _featureProfile.get(), map.get());
                 //geom->setupPaging();
                 geomTop->addChild(geom);
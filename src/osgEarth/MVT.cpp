@@ -28,7 +28,8 @@
 #include <list>
 #include <stdio.h>
 #include <stdlib.h>
-#include "vector_tile.pb.h"
+#include <cstdint>
+#include <cstring>
 
 #ifdef OSGEARTH_HAVE_SQLITE3
 #include <sqlite3.h>
@@ -46,12 +47,12 @@ using namespace osgEarth::MVT;
 
 namespace osgEarth { namespace MVT
 {
-    // https://github.com/mapbox/mapnik-vector-tile/blob/master/examples/c%2B%2B/tileinfo.cpp
-    enum CommandType {
-        SEG_END    = 0,
-        SEG_MOVETO = 1,
-        SEG_LINETO = 2,
-        SEG_CLOSE = (0x40 | 0x0f)
+    // Protobuf wire types used by the vector tile spec
+    enum WireType {
+        PBF_VARINT  = 0,
+        PBF_FIXED64 = 1,
+        PBF_LENGTH  = 2,
+        PBF_FIXED32 = 5
     };
 
     enum eGeomType {
@@ -61,395 +62,525 @@ namespace osgEarth { namespace MVT
         Polygon = 3
     };
 
-    int zig_zag_decode(int n)
+    /**
+     * Minimal reader for the protobuf wire format. It reads fields straight
+     * out of the tile buffer, so decoding a tile never materializes the
+     * protobuf message objects; sub-messages are just views into the same
+     * buffer. Any malformed input puts the reader in a failed state.
+     */
+    class PbfReader
     {
-        return (n >> 1) ^ (-(n & 1));
-    }
+    public:
+        PbfReader() : _ptr(nullptr), _end(nullptr), _tag(0u), _wireType(0), _ok(false) { }
 
-    Geometry* decodeLine(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
-    {
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
+        PbfReader(const char* data, std::size_t length) :
+            _ptr(data), _end(data + length), _tag(0u), _wireType(0), _ok(true) { }
 
-        int x = 0;
-        int y = 0;
+        //! Advances to the next field; false at the end or on bad data
+        bool next()
+        {
+            if (!_ok || _ptr >= _end)
+                return false;
+            std::uint64_t key = getVarint();
+            _tag = (unsigned)(key >> 3);
+            _wireType = (int)(key & 0x7);
+            return _ok;
+        }
+
+        //! Whether the current field has this tag and wire type
+        bool is(unsigned tag, int wireType) const { return _tag == tag && _wireType == wireType; }
 
-        std::vector< osg::ref_ptr< osgEarth::LineString > > lines;
-        osg::ref_ptr< osgEarth::LineString > currentLine;
+        bool ok() const { return _ok; }
+        bool atEnd() const { return _ptr >= _end; }
 
-        for (int k = 0; k < feature.geometry_size();)
+        std::uint64_t getVarint()
         {
-            if (!length)
+            std::uint64_t result = 0;
+            for (unsigned shift = 0; shift < 64 && _ptr < _end; shift += 7)
             {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
+                std::uint8_t b = (std::uint8_t)*_ptr++;
+                result |= (std::uint64_t)(b & 0x7f) << shift;
+                if ((b & 0x80) == 0)
+                    return result;
             }
-            if (length > 0)
-            {
-                length--;
-
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
-                {
-                    if (cmd == SEG_MOVETO)
-                    {
-                        currentLine = new osgEarth::LineString;
-                        lines.push_back( currentLine.get() );
-                    }
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
+            _ok = false;
+            return 0;
+        }
 
-                    x += px;
-                    y += py;
+        std::int64_t getSVarint()
+        {
+            std::uint64_t n = getVarint();
+            return (std::int64_t)(n >> 1) ^ -(std::int64_t)(n & 1);
+        }
 
-                    double width = key.getExtent().width();
-                    double height = key.getExtent().height();
+        float getFloat()
+        {
+            float value = 0.0f;
+            if (read(&value, sizeof(value)))
+                return value;
+            return 0.0f;
+        }
 
-                    double geoX = key.getExtent().xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
+        double getDouble()
+        {
+            double value = 0.0;
+            if (read(&value, sizeof(value)))
+                return value;
+            return 0.0;
+        }
 
-                    if (currentLine.valid())
-                    {
-                        currentLine->push_back(geoX, geoY, 0);
-                    }
-                }
+        //! Length-delimited field (sub-message or packed array) as a reader
+        PbfReader getMessage()
+        {
+            std::uint64_t length = getVarint();
+            if (!_ok || length > (std::uint64_t)(_end - _ptr))
+            {
+                _ok = false;
+                return PbfReader();
             }
+            PbfReader sub(_ptr, (std::size_t)length);
+            _ptr += length;
+            return sub;
         }
 
-        currentLine = 0;
-
-        if (lines.size() == 0)
+        std::string getString()
         {
-            return 0;
+            PbfReader sub = getMessage();
+            return sub._ok ? std::string(sub._ptr, sub._end - sub._ptr) : std::string();
         }
-        else if (lines.size() == 1)
+
+        //! Skips the current field
+        void skip()
         {
-            // Just return a simple LineString
-            return lines[0].release();
+            switch (_wireType)
+            {
+            case PBF_VARINT:  getVarint(); break;
+            case PBF_FIXED64: read(nullptr, 8); break;
+            case PBF_LENGTH:  getMessage(); break;
+            case PBF_FIXED32: read(nullptr, 4); break;
+            default:          _ok = false; break;
+            }
         }
-        else
+
+    private:
+        const char* _ptr;
+        const char* _end;
+        unsigned _tag;
+        int _wireType;
+        bool _ok;
+
+        bool read(void* out, std::size_t size)
         {
-            // Return a multilinestring
-            MultiGeometry* multi = new MultiGeometry;
-            for (unsigned int i = 0; i < lines.size(); i++)
+            if (size > (std::size_t)(_end - _ptr))
             {
-                multi->add(lines[i].get());
+                _ok = false;
+                return false;
             }
-            return multi;
+            if (out)
+                ::memcpy(out, _ptr, size);
+            _ptr += size;
+            return true;
         }
-    }
+    };
 
-    Geometry* decodePoint(const mapnik::vector::tile_feature& feature, const TileKey& key, unsigned int tileres)
+    // Maps tile-local integer coordinates to the tile key's extent.
+    struct TileTransform
     {
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
+        TileTransform(const TileKey& key, unsigned tileres)
+        {
+            const GeoExtent& ex = key.getExtent();
+            _x0 = ex.xMin();
+            _y0 = ex.yMax();
+            _sx = ex.width() / (double)tileres;
+            _sy = ex.height() / (double)tileres;
+        }
 
+        osg::Vec3d operator()(int x, int y) const
+        {
+            return osg::Vec3d(_x0 + _sx*(double)x, _y0 - _sy*(double)y, 0.0);
+        }
+
+        double _x0, _y0, _sx, _sy;
+    };
+
+    // Runs a packed geometry command stream, handing each vertex and
+    // close-path to the handler.
+    // https://github.com/mapbox/vector-tile-spec/tree/master/2.1#43-geometry-encoding
+    template<typename HANDLER>
+    void decodeCommands(PbfReader geometry, const TileTransform& xform, HANDLER& handler)
+    {
         int x = 0;
         int y = 0;
 
-        osgEarth::PointSet *geometry = new osgEarth::PointSet();
-
-        for (int k = 0; k < feature.geometry_size();)
+        while (geometry.ok() && !geometry.atEnd())
         {
-            if (!length)
-            {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
-            }
-            if (length > 0)
+            unsigned cmdLength = (unsigned)geometry.getVarint();
+            unsigned cmd = cmdLength & ((1 << CMD_BITS) - 1);
+            unsigned count = cmdLength >> CMD_BITS;
+
+            if (cmd == CMD_MOVETO || cmd == CMD_LINETO)
             {
-                length--;
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
+                for (unsigned i = 0; i < count && geometry.ok() && !geometry.atEnd(); ++i)
                 {
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
-
-                    x += px;
-                    y += py;
-
-                    double width = key.getExtent().width();
-                    double height = key.getExtent().height();
-
-                    double geoX = key.getExtent().xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
-                    geometry->push_back(geoX, geoY, 0);
+                    x += (int)geometry.getSVarint();
+                    y += (int)geometry.getSVarint();
+                    handler.vertex(cmd == CMD_MOVETO, xform(x, y));
                 }
             }
+            else if (cmd == CMD_CLOSEPATH)
+            {
+                handler.close();
+            }
+            else
+            {
+                // unknown command; the rest of the stream can't be trusted
+                return;
+            }
         }
-
-        return geometry;
     }
 
-    Geometry* decodePolygon(const mapnik::vector::tile_feature& feature, const  TileKey& key, unsigned int tileres)
+    struct PointDecoder
     {
-        /*
-         https://github.com/mapbox/vector-tile-spec/tree/master/2.1
-         Decoding polygons is a bit more difficult than lines or points.
-         A Polygon geometry is either a single polygon or a multipolygon.  Each polygon has one exterior ring and zero or more interior rings.
-         The rings are in sequence and you must check the orientation of the ring to know if it's an exterior ring (new polygon) or an
-         interior ring (inner polygon of the current polygon).
-         */
+        osg::ref_ptr<PointSet> _points;
 
+        PointDecoder() : _points(new PointSet()) { }
 
-        unsigned int length = 0;
-        int cmd = -1;
-        const int cmd_bits = 3;
+        void vertex(bool, const osg::Vec3d& p) { _points->push_back(p); }
+        void close() { }
 
-        int x = 0;
-        int y = 0;
+        Geometry* result() { return _points.release(); }
+    };
 
-        // The list of polygons we've collected
-        std::vector< osg::ref_ptr< osgEarth::Polygon > > polygons;
+    struct LineDecoder
+    {
+        std::vector<osg::ref_ptr<osgEarth::LineString> > _lines;
 
-        osg::ref_ptr< osgEarth::Polygon > currentPolygon;
+        void vertex(bool moveTo, const osg::Vec3d& p)
+        {
+            if (moveTo)
+                _lines.push_back(new osgEarth::LineString());
+            if (!_lines.empty())
+                _lines.back()->push_back(p);
+        }
 
-        osg::ref_ptr< osgEarth::Ring > currentRing;
+        void close() { }
 
-        for (int k = 0; k < feature.geometry_size();)
+        Geometry* result()
         {
-            if (!length)
-            {
-                unsigned int cmd_length = feature.geometry(k++);
-                cmd = cmd_length & ((1 << cmd_bits) - 1);
-                length = cmd_length >> cmd_bits;
-            }
-            if (length > 0)
-            {
-                length--;
-                if (cmd == SEG_MOVETO || cmd == SEG_LINETO)
-                {
-                    if (!currentRing)
-                    {
-                        currentRing = new osgEarth::Ring();
-                    }
+            if (_lines.empty())
+                return 0L;
 
-                    int px = feature.geometry(k++);
-                    int py = feature.geometry(k++);
-                    px = zig_zag_decode(px);
-                    py = zig_zag_decode(py);
+            // Just return a simple LineString
+            if (_lines.size() == 1)
+                return _lines[0].release();
 
-                    x += px;
-                    y += py;
+            // Return a multilinestring
+            MultiGeometry* multi = new MultiGeometry();
+            for (auto& line : _lines)
+                multi->add(line.get());
+            return multi;
+        }
+    };
 
-                    double width = key.getExtent().width();
-                    double height = key.getExtent().height();
+    /*
+     Decoding polygons is a bit more difficult than lines or points.
+     A Polygon geometry is either a single polygon or a multipolygon. Each polygon has one exterior ring and zero or more interior rings.
+     The rings are in sequence and you must check the orientation of the ring to know if it's an exterior ring (new polygon) or an
+     interior ring (inner polygon of the current polygon).
+     */
+    struct PolygonDecoder
+    {
+        std::vector<osg::ref_ptr<osgEarth::Polygon> > _polygons;
+        osg::ref_ptr<osgEarth::Ring> _ring;
 
-                    double geoX = key.getExtent().xMin() + (width/(double)tileres) * (double)x;
-                    double geoY = key.getExtent().yMax() - (height/(double)tileres) * (double)y;
-                    currentRing->push_back(geoX, geoY, 0);
-                }
-                else if (cmd == (SEG_CLOSE & ((1 << cmd_bits) - 1)))
-                {
-                    // The orientation is the opposite of what we want for features.  clockwise means exterior ring, counter clockwise means interior
+        void vertex(bool, const osg::Vec3d& p)
+        {
+            if (!_ring.valid())
+                _ring = new osgEarth::Ring();
+            _ring->push_back(p);
+        }
 
-                    // Figure out what to do with the ring based on the orientation of the ring
-                    Geometry::Orientation orientation = currentRing->getOrientation();
-                    // Close the ring.
-                    currentRing->close();
+        void close()
+        {
+            if (!_ring.valid())
+                return;
 
-                    // Clockwise means exterior ring.  Start a new polygon and add the ring.
-                    if (orientation == Geometry::ORIENTATION_CW)
-                    {
-                        // osgearth orientations are reversed from mvt
-                        currentRing->rewind(Geometry::ORIENTATION_CCW);
+            // The orientation is the opposite of what we want for features.  clockwise means exterior ring, counter clockwise means interior
+            Geometry::Orientation orientation = _ring->getOrientation();
+            _ring->close();
 
-                        currentPolygon = new osgEarth::Polygon(&currentRing->asVector());
-                        polygons.push_back(currentPolygon.get());
-                    }
-                    else if (orientation == Geometry::ORIENTATION_CCW)
-                    // Counter clockwise means a hole, add it to the existing polygon.
-                    {
-                        if (currentPolygon.valid())
-                        {
-                            // osgearth orientations are reversed from mvt
-                            currentRing->rewind(Geometry::ORIENTATION_CW);
-                            currentPolygon->getHoles().push_back( currentRing );
-                        }
-                        else
-                        {
-                            // this means we encountered a "hole" without a parent outer ring,
-                            // discard for now -gw
-                            OE_INFO << LC << "Discarding improperly wound polygon (hole without an outer ring)\n";
-                        }
-                    }
+            // Clockwise means exterior ring.  Start a new polygon and add the ring.
+            if (orientation == Geometry::ORIENTATION_CW)
+            {
+                // osgearth orientations are reversed from mvt
+                _ring->rewind(Geometry::ORIENTATION_CCW);
+                _polygons.push_back(new osgEarth::Polygon(&_ring->asVector()));
+            }
 
-                    // Start a new ring
-                    currentRing = 0;
+            // Counter clockwise means a hole, add it to the existing polygon.
+            else if (orientation == Geometry::ORIENTATION_CCW)
+            {
+                if (!_polygons.empty())
+                {
+                    // osgearth orientations are reversed from mvt
+                    _ring->rewind(Geometry::ORIENTATION_CW);
+                    _polygons.back()->getHoles().push_back(_ring.get());
+                }
+                else
+                {
+                    // this means we encountered a "hole" without a parent outer ring,
+                    // discard for now -gw
+                    OE_INFO << LC << "Discarding improperly wound polygon (hole without an outer ring)\n";
                 }
             }
-        }
-
-        currentRing = 0;
-        currentPolygon = 0;
 
-        if (polygons.size() == 0)
-        {
-            return 0;
+            // Start a new ring
+            _ring = 0L;
         }
-        else if (polygons.size() == 1)
+
+        Geometry* result()
         {
+            if (_polygons.empty())
+                return 0L;
+
             // Just return a simple polygon
-            return polygons[0].release();
-        }
-        else
-        {
+            if (_polygons.size() == 1)
+                return _polygons[0].release();
+
             // Return a multipolygon
-            MultiGeometry* multi = new MultiGeometry;
-            for (unsigned int i = 0; i < polygons.size(); i++)
-            {
-                multi->add(polygons[i].get());
-            }
+            MultiGeometry* multi = new MultiGeometry();
+            for (auto& polygon : _polygons)
+                multi->add(polygon.get());
             return multi;
         }
+    };
+
+    template<typename DECODER>
+    Geometry* decodeGeometry(const PbfReader& geometry, const TileTransform& xform)
+    {
+        DECODER decoder;
+        decodeCommands(geometry, xform, decoder);
+        return decoder.result();
     }
 
-    bool readTile(std::istream& in, const TileKey& key, FeatureList& features)
+    // Decodes a tile_value message; type is left unspecified if it holds nothing we know
+    void readValue(PbfReader value, AttributeValue& out)
     {
-        features.clear();
+        out.first = ATTRTYPE_UNSPECIFIED;
+        out.second.set = true;
 
-        // Get the compressor
-        osg::ref_ptr< osgDB::BaseCompressor> compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
-        if (!compressor.valid())
+        while (value.next())
         {
-            return false;
+            if (value.is(1, PBF_LENGTH)) {
+                out.first = ATTRTYPE_STRING;
+                out.second.stringValue = value.getString();
+            }
+            else if (value.is(2, PBF_FIXED32)) {
+                out.first = ATTRTYPE_DOUBLE;
+                out.second.doubleValue = value.getFloat();
+            }
+            else if (value.is(3, PBF_FIXED64)) {
+                out.first = ATTRTYPE_DOUBLE;
+                out.second.doubleValue = value.getDouble();
+            }
+            else if (value.is(4, PBF_VARINT) || value.is(5, PBF_VARINT)) {
+                out.first = ATTRTYPE_INT;
+                out.second.intValue = (long long)value.getVarint();
+            }
+            else if (value.is(6, PBF_VARINT)) {
+                out.first = ATTRTYPE_INT;
+                out.second.intValue = (long long)value.getSVarint();
+            }
+            else if (value.is(7, PBF_VARINT)) {
+                out.first = ATTRTYPE_BOOL;
+                out.second.boolValue = value.getVarint() != 0;
+            }
+            else {
+                value.skip();
+            }
         }
+    }
 
-        // Decompress the tile
-        std::string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-        in.seekg (0, std::ios::beg);
-        std::string value;
-        if (!compressor->decompress(in, value))
+    bool readLayer(PbfReader layer, const TileKey& key, FeatureList& features)
+    {
+        // Keys and values are shared by all the features in a layer, so decode
+        // each one once. They may come after the features in the stream, so
+        // the features wait until the whole layer has been scanned.
+        std::string name;
+        unsigned tileres = 4096u;
+        std::vector<std::string> keys;
+        std::vector<AttributeValue> values;
+        std::vector<PbfReader> featureMessages;
+
+        while (layer.next())
         {
-            value = original;
+            if (layer.is(1, PBF_LENGTH))
+            {
+                name = layer.getString();
+            }
+            else if (layer.is(2, PBF_LENGTH))
+            {
+                featureMessages.push_back(layer.getMessage());
+            }
+            else if (layer.is(3, PBF_LENGTH))
+            {
+                keys.push_back(layer.getString());
+            }
+            else if (layer.is(4, PBF_LENGTH))
+            {
+                values.push_back(AttributeValue());
+                readValue(layer.getMessage(), values.back());
+            }
+            else if (layer.is(5, PBF_VARINT))
+            {
+                tileres = (unsigned)layer.getVarint();
+            }
+            else
+            {
+                layer.skip();
+            }
         }
 
+        if (!layer.ok() || tileres == 0u)
+            return false;
 
-        mapnik::vector::tile tile;
+        TileTransform xform(key, tileres);
+        const SpatialReference* srs = key.getProfile()->getSRS();
 
-        if (tile.ParseFromString(value))
+        for (auto& message : featureMessages)
         {
-            for (int i = 0; i < tile.layers().size(); i++)
+            PbfReader feature = message;
+            PbfReader tags;
+            PbfReader geometry;
+            eGeomType geomType = Unknown;
+
+            while (feature.next())
+            {
+                if (feature.is(2, PBF_LENGTH))
+                    tags = feature.getMessage();
+                else if (feature.is(3, PBF_VARINT))
+                    geomType = static_cast<eGeomType>(feature.getVarint());
+                else if (feature.is(4, PBF_LENGTH))
+                    geometry = feature.getMessage();
+                else
+                    feature.skip();
+            }
+
+            if (!feature.ok() || !geometry.ok())
+                continue;
+
+            osg::ref_ptr<osgEarth::Geometry> geom;
+
+            if (geomType == MVT::Polygon)
+            {
+                geom = decodeGeometry<PolygonDecoder>(geometry, xform);
+            }
+            else if (geomType == MVT::Point)
             {
-                const mapnik::vector::tile_layer &layer = tile.layers().Get(i);
+                geom = decodeGeometry<PointDecoder>(geometry, xform);
 
-                for (int j = 0; j < layer.features().size(); j++)
+                // This is a bit of a hack, but if a point is outside of the extents we remove it.
+                // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
+                // extent.  Should probably make this an option somewhere.
+                if (geom.valid() && !key.getExtent().contains(geom->getBounds().center()))
                 {
-                    const mapnik::vector::tile_feature &feature = layer.features().Get(j);
+                    geom = 0L;
+                }
+            }
+            else
+            {
+                geom = decodeGeometry<LineDecoder>(geometry, xform);
+            }
 
-                    osg::ref_ptr< Feature > oeFeature = new Feature(0, key.getProfile()->getSRS());
+            if (!geom.valid())
+                continue;
 
-                    // Set the layer name as "mvt_layer" so we can filter it later
-                    oeFeature->set("mvt_layer", layer.name());
+            osg::ref_ptr<Feature> oeFeature = new Feature(geom.get(), srs);
 
-                    // Read attributes
-                    for (int k = 0; k < feature.tags().size(); k+=2)
-                    {
-                        std::string key = layer.keys().Get(feature.tags().Get(k));
-                        mapnik::vector::tile_value value = layer.values().Get(feature.tags().Get(k+1));
+            // Set the layer name as "mvt_layer" so we can filter it later
+            oeFeature->set("mvt_layer", name);
 
-                        if (value.has_bool_value())
-                        {
-                            oeFeature->set(key, value.bool_value());
-                        }
-                        else if (value.has_double_value())
-                        {
-                            oeFeature->set(key, value.double_value());
-                        }
-                        else if (value.has_float_value())
-                        {
-                            oeFeature->set(key, value.float_value());
-                        }
-                        else if (value.has_int_value())
-                        {
-                            oeFeature->set(key, (long long)value.int_value());
-                        }
-                        else if (value.has_sint_value())
-                        {
-                            oeFeature->set(key, (long long)value.sint_value());
-                        }
-                        else if (value.has_string_value())
-                        {
-                            oeFeature->set(key, value.string_value());
-                        }
-                        else if (value.has_uint_value())
-                        {
-                            oeFeature->set(key, (long long)value.uint_value());
-                        }
+            // Read attributes
+            while (tags.ok() && !tags.atEnd())
+            {
+                std::uint64_t k = tags.getVarint();
+                std::uint64_t v = tags.getVarint();
+                if (!tags.ok() || k >= keys.size() || v >= values.size())
+                    break;
+
+                const std::string& attrName = keys[k];
+                const AttributeValue& value = values[v];
+                if (value.first != ATTRTYPE_UNSPECIFIED)
+                {
+                    oeFeature->set(attrName, value);
+                }
 
-                        // Special path for getting heights from our test dataset.
-                        if (key == "other_tags")
+                // Special path for getting heights from our test dataset.
+                if (attrName == "other_tags")
+                {
+                    StringTokenizer tok("=>");
+                    StringVector tized;
+                    tok.tokenize(value.second.stringValue, tized);
+                    if (tized.size() == 3)
+                    {
+                        if (tized[0] == "height")
                         {
-                            std::string other_tags = value.string_value();
-
-                            StringTokenizer tok("=>");
-                            StringVector tized;
-                            tok.tokenize(other_tags, tized);
-                            if (tized.size() == 3)
+                            // Remove quotes from the height
+                            float height = as<float>(tized[2], FLT_MAX);
+                            if (height != FLT_MAX)
                             {
-                                if (tized[0] == "height")
-                                {
-                                    std::string value = tized[2];
-                                    // Remove quotes from the height
-                                    float height = as<float>(value, FLT_MAX);
-                                    if (height != FLT_MAX)
-                                    {
-                                        oeFeature->set("height", height);
-                                    }
-                                }
+                                oeFeature->set("height", height);
                             }
                         }
                     }
+                }
+            }
 
+            features.push_back(oeFeature.get());
+        }
 
+        return true;
+    }
 
-                    osg::ref_ptr< osgEarth::Geometry > geometry;
-
-                    eGeomType geomType = static_cast<eGeomType>(feature.type());
-                    if (geomType == MVT::Polygon)
-                    {
-                        geometry = decodePolygon(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::LineString)
-                    {
-                        geometry = decodeLine(feature, key, layer.extent());
-                    }
-                    else if (geomType == MVT::Point)
-                    {
-                        geometry = decodePoint(feature, key, layer.extent());
+    bool readTile(const char* data, std::size_t length, const TileKey& key, FeatureList& features)
+    {
+        features.clear();
 
-                        // This is a bit of a hack, but if a point is outside of the extents we remove it.
-                        // Lines and Polygons that extend outside of the tileset we keep though b/c we assume that they are just slightly going outside of the
-                        // extent.  Should probably make this an option somewhere.
-                        if (geometry)
-                        {
-                            if (!key.getExtent().contains(geometry->getBounds().center()))
-                            {
-                                geometry = NULL;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        geometry = decodeLine(feature, key, layer.extent());
-                    }
+        // Tiles are usually compressed. An uncompressed tile starts with a
+        // layer field (tag 3, length-delimited), so only try to inflate
+        // when it doesn't.
+        std::string inflated;
+        if (length > 0 && (unsigned char)data[0] != 0x1a)
+        {
+            osg::ref_ptr< osgDB::BaseCompressor> compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor("zlib");
+            if (!compressor.valid())
+            {
+                return false;
+            }
 
-                    if (geometry)
-                    {
-                        oeFeature->setGeometry( geometry.get() );
-                        features.push_back(oeFeature.get());
-                    }
+            std::stringstream in(std::string(data, length));
+            if (compressor->decompress(in, inflated))
+            {
+                data = inflated.data();
+                length = inflated.size();
+            }
+        }
 
-                }
+        PbfReader tile(data, length);
+        while (tile.next())
+        {
+            if (tile.is(3, PBF_LENGTH))
+            {
+                if (!readLayer(tile.getMessage(), key, features))
+                    break;
+            }
+            else
+            {
+                tile.skip();
             }
         }
-        else
+
+        if (!tile.ok())
         {
             OE_WARN << "Failed to parse mvt" << key.str() << std::endl;
             return false;
@@ -458,6 +589,12 @@ namespace osgEarth { namespace MVT
         return true;
     }
 
+    bool readTile(std::istream& in, const TileKey& key, FeatureList& features)
+    {
+        std::string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return readTile(buffer.data(), buffer.size(), key, features);
+    }
+
 }} // namespace osgEarth::MVT
 
 //........................................................................
@@ -565,9 +702,7 @@ MVTFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
         // the pointer returned from _blob gets freed internally by sqlite, supposedly
         const char* data = (const char*)sqlite3_column_blob(select, 0);
         int dataLen = sqlite3_column_bytes(select, 0);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
-        MVT::readTile(in, key, features);
+        MVT::readTile(data, dataLen, key, features);
     }
     else
     {
@@ -655,8 +790,6 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
         // the pointer returned from _blob gets freed internally by sqlite, supposedly
         const char* data = (const char*)sqlite3_column_blob(select, 3);
         int dataLen = sqlite3_column_bytes(select, 3);
-        std::string dataBuffer(data, dataLen);
-        std::stringstream in(dataBuffer);
 
         FeatureList features;
 
@@ -673,7 +806,7 @@ MVTFeatureSource::iterateTiles(int zoomLevel, int limit, int offset, const GeoEx
         }
 
 
-        MVT::readTile(in, key, features);
+        MVT::readTile(data, dataLen, key, features);
 
         // apply filters before returning.
         applyFilters(features, key.getExtent());
@@ -19,11 +19,41 @@
 #include <osgEarth/Map>
 #include <osgEarth/MapModelChange>
 #include <osgEarth/Registry>
+#include <algorithm>
+#include <chrono>
 
 using namespace osgEarth;
 
 #define LC "[Map] "
 
+#define ARENA_LAYER_OPEN "oe.layeropen"
+
+namespace
+{
+    // Layer opens are mostly waiting on the network or the disk,
+    // so use a few more threads than there are cores.
+    JobArena* getLayerOpenArena()
+    {
+        static JobArena* arena = []()
+        {
+            JobArena::setConcurrency(ARENA_LAYER_OPEN, std::max(4u, 2u * Threading::getConcurrency()));
+            return JobArena::get(ARENA_LAYER_OPEN);
+        }();
+        return arena;
+    }
+
+    // Cancels a wait once a point in time has passed
+    struct Deadline : public Threading::Cancelable
+    {
+        std::chrono::steady_clock::time_point _time;
+        Deadline(float seconds) : _time(std::chrono::steady_clock::now() +
+            std::chrono::microseconds((long long)(seconds * 1e6f))) { }
+        bool isCanceled() const override {
+            return std::chrono::steady_clock::now() >= _time;
+        }
+    };
+}
+
 //...................................................................
 
 Map::LayerCB::LayerCB(Map* map) : _map(map) { }
@@ -60,6 +90,7 @@ Map::Options::getConfig() const
     conf.set( "elevation_interpolation", "triangulate", elevationInterpolation(), INTERP_TRIANGULATE);
 
     conf.set( "profile_layer", profileLayer() );
+    conf.set( "layer_open_timeout", layerOpenTimeout() );
 
     return conf;
 }
@@ -87,6 +118,7 @@ Map::Options::fromConfig(const Config& conf)
     conf.get( "elevation_interpolation", "triangulate", elevationInterpolation(), INTERP_TRIANGULATE);
 
     conf.get( "profile_layer", profileLayer() );
+    conf.get( "layer_open_timeout", layerOpenTimeout() );
 }
 
 //...................................................................
@@ -513,6 +545,22 @@ Map::removeLayer(Layer* layer)
     osg::ref_ptr<Layer> layerToRemove(layer);
     Revision newRevision;
 
+    // let a background open finish before closing the layer
+    Threading::Future<Status> opening;
+    {
+        Threading::ScopedMutexLock lock(_pendingLayersMutex);
+        for (auto i = _pendingLayers.begin(); i != _pendingLayers.end(); ++i)
+        {
+            if (i->_layer.get() == layer)
+            {
+                opening = i->_status;
+                _pendingLayers.erase(i);
+                break;
+            }
+        }
+    }
+    opening.join();
+
     uninstallLayerCallbacks(layerToRemove.get());
 
     layer->removedFromMap(this);
@@ -603,31 +651,70 @@ void
 Map::addLayers(const LayerVector& layers)
 {
     // This differs from addLayer() in a loop because it will
-    // (a) call addedToMap only after all the layers are added, and
-    // (b) invoke all the MapModelChange callbacks with the same 
+    // (a) open the layers in parallel,
+    // (b) call addedToMap only after all the layers are added, and
+    // (c) invoke all the MapModelChange callbacks with the same 
     // new revision number.
 
     //osgEarth::Registry::instance()->clearBlacklist();
 
-    for(LayerVector::const_iterator layerRef = layers.begin();
-        layerRef != layers.end();
-        ++layerRef)
+    // Open the layers, but don't call addedToMap(layer) yet.
+    // Layers don't need to open in any order: a layer finds the layers
+    // it references by name in addedToMap, and a layer that opens one
+    // it was given directly waits for any other thread opening it.
+    std::vector<Threading::Future<Status>> opening(layers.size());
+    std::vector<bool> pending(layers.size(), false);
+
+    Job job(getLayerOpenArena());
+
+    for(unsigned i = 0; i < layers.size(); ++i)
     {
-        Layer* layer = layerRef->get();
+        Layer* layer = layers[i].get();
         if ( !layer )
             continue;
 
         layer->setReadOptions(getReadOptions());
 
-        // open, but don't call addedToMap(layer) yet.
-        layer->open();
+        if (layers.size() > 1)
+        {
+            osg::ref_ptr<Layer> layerRef(layer);
+            job.setName(layer->getName());
+            opening[i] = job.dispatch<Status>([layerRef](Cancelable*) {
+                return layerRef->open();
+            });
+        }
+        else
+        {
+            layer->open();
+        }
+    }
+
+    if (layers.size() > 1)
+    {
+        if (options().layerOpenTimeout().isSet())
+        {
+            Deadline deadline(options().layerOpenTimeout().get());
+            for(unsigned i = 0; i < layers.size(); ++i)
+            {
+                if (layers[i].valid())
+                {
+                    opening[i].join(&deadline);
+                    pending[i] = !opening[i].isAvailable();
+                }
+            }
+        }
+        else
+        {
+            for (auto& status : opening)
+                status.join();
+        }
     }
 
     unsigned firstIndex;
-    unsigned count = 0;
-    int newRevision;
+    Revision newRevision;
 
-    // Add the layers to the map.
+    // Add the layers to the map. Pending layers take their place in the
+    // order now, but no one hears about them until they finish opening.
     {
         Threading::ScopedWriteLock lock( _mapDataMutex );
 
@@ -649,31 +736,100 @@ Map::addLayers(const LayerVector& layers)
     // call addedToMap on each new layer in turn:
     unsigned index = firstIndex;
 
-    for(LayerVector::const_iterator layerRef = layers.begin();
-        layerRef != layers.end();
-        ++layerRef)
+    for(unsigned i = 0; i < layers.size(); ++i)
     {
-        Layer* layer = layerRef->get();
+        Layer* layer = layers[i].get();
         if ( !layer )
             continue;
 
-        if (layer->isOpen() && getProfile() != NULL)
+        if (pending[i])
         {
-            layer->addedToMap(this);
+            OE_INFO << LC << "Layer \"" << layer->getName() << "\" is still opening; continuing without it" << std::endl;
+            Threading::ScopedMutexLock lock(_pendingLayersMutex);
+            PendingLayer p;
+            p._layer = layer;
+            p._status = opening[i];
+            _pendingLayers.push_back(p);
+            ++index;
         }
+        else
+        {
+            finishAddingLayer(layer, index++, newRevision);
+        }
+    }
+}
 
-        // Set up callbacks.
-        installLayerCallbacks(layer);
+void
+Map::finishAddingLayer(Layer* layer, unsigned index, Revision revision)
+{
+    if (layer->isOpen() && getProfile() != NULL)
+    {
+        layer->addedToMap(this);
+    }
 
-        // a separate block b/c we don't need the mutex
-        for( MapCallbackList::iterator i = _mapCallbacks.begin(); i != _mapCallbacks.end(); i++ )
+    // Set up callbacks.
+    installLayerCallbacks(layer);
+
+    // a separate block b/c we don't need the mutex
+    for( MapCallbackList::iterator i = _mapCallbacks.begin(); i != _mapCallbacks.end(); i++ )
+    {
+        i->get()->onMapModelChanged(MapModelChange(
+            MapModelChange::ADD_LAYER, revision, layer, index));
+    }
+}
+
+void
+Map::updatePendingLayers()
+{
+    std::vector<osg::ref_ptr<Layer>> ready;
+    {
+        Threading::ScopedMutexLock lock(_pendingLayersMutex);
+        if (_pendingLayers.empty())
+            return;
+
+        for (auto i = _pendingLayers.begin(); i != _pendingLayers.end(); )
+        {
+            if (i->_status.isAvailable() || i->_status.isAbandoned())
+            {
+                ready.push_back(i->_layer);
+                i = _pendingLayers.erase(i);
+            }
+            else ++i;
+        }
+    }
+
+    for (auto& layer : ready)
+    {
+        unsigned index = getIndexOfLayer(layer.get());
+
+        // removed from the map while it was opening
+        if (index == getNumLayers())
+            continue;
+
+        Revision newRevision;
+        {
+            Threading::ScopedWriteLock lock(_mapDataMutex);
+            newRevision = ++_dataModelRevision;
+        }
+
+        if (dynamic_cast<ElevationLayer*>(layer.get()) ||
+            dynamic_cast<TerrainConstraintLayer*>(layer.get()))
         {
-            i->get()->onMapModelChanged(MapModelChange(
-                MapModelChange::ADD_LAYER, newRevision, layer, index++));
+            _elevationPool->clear();
         }
+
+        OE_INFO << LC << "Layer \"" << layer->getName() << "\" finished opening" << std::endl;
+        finishAddingLayer(layer.get(), index, newRevision);
     }
 }
 
+unsigned
+Map::getNumPendingLayers() const
+{
+    Threading::ScopedMutexLock lock(_pendingLayersMutex);
+    return _pendingLayers.size();
+}
+
 void
 Map::installLayerCallbacks(Layer* layer)
 {
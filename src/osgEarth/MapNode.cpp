@@ -839,6 +839,12 @@ MapNode::traverse( osg::NodeVisitor& nv )
         }
     }
 
+    // add any layers that finished opening in the background
+    if (nv.getVisitorType() == nv.UPDATE_VISITOR)
+    {
+        _map->updatePendingLayers();
+    }
+
     if ( nv.getVisitorType() == nv.EVENT_VISITOR )
     {
         unsigned int numBlacklist = Registry::instance()->getNumBlacklistedFilenames();
@@ -17,6 +17,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/MemCache>
+#include <osgEarth/IOTypes>
+#include <osgEarth/Memory>
+#include <osg/Image>
+#include <osg/Shape>
+#include <list>
+#include <memory>
+#include <unordered_map>
 
 using namespace osgEarth;
 
@@ -26,35 +33,184 @@ using namespace osgEarth;
 
 //------------------------------------------------------------------------
 
+// Never split a bin into more shards than this
+#define MAX_SHARDS 16u
+
+// Fewest entries a shard should hold before adding another shard
+#define MIN_ENTRIES_PER_SHARD 8u
+
 namespace
 {
-    typedef std::pair<osg::ref_ptr<const osg::Object>, Config> MemCacheEntry;
-    typedef LRUCache<std::string, MemCacheEntry> MemCacheLRU;
+    // Estimated memory held by a cached object
+    std::size_t getEstimatedSize(const osg::Object* object)
+    {
+        std::size_t bytes = sizeof(osg::Object) + sizeof(Config);
+
+        const osg::Image* image = dynamic_cast<const osg::Image*>(object);
+        if (image)
+            return bytes + image->getTotalSizeInBytesIncludingMipmaps();
+
+        const osg::HeightField* hf = dynamic_cast<const osg::HeightField*>(object);
+        if (hf && hf->getFloatArray())
+            return bytes + hf->getFloatArray()->getTotalDataSize();
+
+        const StringObject* str = dynamic_cast<const StringObject*>(object);
+        if (str)
+            return bytes + str->getString().size();
+
+        // anything else (nodes, mostly) gets a nominal size
+        return bytes + 1024u;
+    }
+
+    struct MemCacheEntry
+    {
+        std::string _key;
+        osg::ref_ptr<const osg::Object> _object;
+        Config _meta;
+        std::size_t _bytes;
+    };
+
+    typedef std::list<MemCacheEntry> MemCacheLRU;
+
+    // One lock-striped slice of a bin, with its own LRU list and budget
+    struct MemCacheShard
+    {
+        MemCacheShard(unsigned maxEntries, std::size_t maxBytes) :
+            _maxEntries(maxEntries),
+            _maxBytes(maxBytes),
+            _mutex("MemCacheShard(OE)"),
+            _memory(Memory::CACHE) { }
+
+        unsigned _maxEntries;
+        std::size_t _maxBytes;
+        Threading::Mutex _mutex;
+        MemCacheLRU _lru;
+        std::unordered_map<std::string, MemCacheLRU::iterator> _map;
+        MemCache::Stats _stats;
+        Memory::Tracked _memory;
+
+        bool get(const std::string& key, osg::ref_ptr<const osg::Object>& object, Config& meta)
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            auto i = _map.find(key);
+            if (i == _map.end())
+            {
+                ++_stats._misses;
+                return false;
+            }
+            ++_stats._hits;
+            _lru.splice(_lru.begin(), _lru, i->second);
+            object = i->second->_object;
+            meta = i->second->_meta;
+            return true;
+        }
+
+        bool insert(const std::string& key, const osg::Object* object, const Config& meta)
+        {
+            std::size_t bytes = getEstimatedSize(object);
+
+            // an entry this big would flush the entire shard; don't keep it
+            if (_maxBytes > 0u && bytes > _maxBytes)
+                return false;
+
+            Threading::ScopedMutexLock lock(_mutex);
+
+            auto i = _map.find(key);
+            if (i != _map.end())
+            {
+                _stats._bytes -= i->second->_bytes;
+                _lru.erase(i->second);
+                _map.erase(i);
+            }
+
+            MemCacheEntry entry;
+            entry._key = key;
+            entry._object = object;
+            entry._meta = meta;
+            entry._bytes = bytes;
+            _lru.push_front(entry);
+            _map[key] = _lru.begin();
+            _stats._bytes += bytes;
+
+            while (!_lru.empty() && (
+                _lru.size() > _maxEntries ||
+                (_maxBytes > 0u && _stats._bytes > _maxBytes)))
+            {
+                _stats._bytes -= _lru.back()._bytes;
+                _map.erase(_lru.back()._key);
+                _lru.pop_back();
+                ++_stats._evictions;
+            }
+
+            _stats._entries = _lru.size();
+            _memory.set(_stats._bytes);
+            return true;
+        }
+
+        bool has(const std::string& key)
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            return _map.find(key) != _map.end();
+        }
+
+        void erase(const std::string& key)
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            auto i = _map.find(key);
+            if (i != _map.end())
+            {
+                _stats._bytes -= i->second->_bytes;
+                _lru.erase(i->second);
+                _map.erase(i);
+                _stats._entries = _lru.size();
+                _memory.set(_stats._bytes);
+            }
+        }
+
+        void clear()
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            _lru.clear();
+            _map.clear();
+            _stats._entries = 0u;
+            _stats._bytes = 0u;
+            _memory.set(0u);
+        }
+    };
 
     struct MemCacheBin : public CacheBin
     {
-        MemCacheBin( const std::string& id, unsigned maxSize )
-            : CacheBin( id ),
-              _lru    ( true /* MT-safe */, maxSize )
+        MemCacheBin( const std::string& id, unsigned maxSize, std::size_t maxBytes )
+            : CacheBin( id )
+        {
+            unsigned numShards = osg::clampBetween(maxSize / MIN_ENTRIES_PER_SHARD, 1u, MAX_SHARDS);
+            unsigned maxShardSize = (maxSize + numShards - 1u) / numShards;
+            std::size_t maxShardBytes = (maxBytes + numShards - 1u) / numShards;
+
+            for (unsigned i = 0; i < numShards; ++i)
+                _shards.emplace_back(new MemCacheShard(maxShardSize, maxShardBytes));
+        }
+
+        MemCacheShard& shard(const std::string& key)
         {
-            //nop
+            return *_shards[std::hash<std::string>()(key) % _shards.size()];
         }
 
         ReadResult readObject(const std::string& key, const osgDB::Options*)
         {
-            MemCacheLRU::Record rec;
-            _lru.get(key, rec);
+            osg::ref_ptr<const osg::Object> object;
+            Config meta;
 
             // clone required since the cache is in memory
 
-            if ( rec.valid() )
+            if ( shard(key).get(key, object, meta) )
             {
 #ifdef CLONE_DATA
                 return ReadResult( 
-                   osg::clone(rec.value().first.get(), osg::CopyOp::DEEP_COPY_ALL),
-                   rec.value().second );
+                   osg::clone(object.get(), osg::CopyOp::DEEP_COPY_ALL),
+                   meta );
 #else
-                return ReadResult(const_cast<osg::Object*>(rec.value().first.get()), rec.value().second);
+                return ReadResult(const_cast<osg::Object*>(object.get()), meta);
 #endif
             }
             else
@@ -79,38 +235,62 @@ namespace
             {
 #ifdef CLONE_DATA
                 osg::ref_ptr<const osg::Object> cloned = osg::clone(object, osg::CopyOp::DEEP_COPY_ALL);
-                _lru.insert( key, std::make_pair(cloned.get(), meta) );
+                return shard(key).insert( key, cloned.get(), meta );
 #else
-                _lru.insert( key, std::make_pair(object, meta) );
+                return shard(key).insert( key, object, meta );
 #endif
-                return true;
             }
             else
                 return false;
         }
 
+        // Tile records live under their binary keys; no need for the
+        // formatted and hashed string key in memory.
+
+        ReadResult readObject(const TileRecordKey& key, const osgDB::Options* readOptions)
+        {
+            return readObject(key.bytes(), readOptions);
+        }
+
+        ReadResult readImage(const TileRecordKey& key, const osgDB::Options* readOptions)
+        {
+            return readObject(key.bytes(), readOptions);
+        }
+
+        bool write(const TileRecordKey& key, const osg::Object* object, const Config& meta, const osgDB::Options* writeOptions)
+        {
+            return write(key.bytes(), object, meta, writeOptions);
+        }
+
+        RecordStatus getRecordStatus(const TileRecordKey& key)
+        {
+            return getRecordStatus(key.bytes());
+        }
+
         bool remove(const std::string& key)
         {
-            _lru.erase(key);
+            shard(key).erase(key);
             return true;
         }
 
         bool touch(const std::string& key)
         {
             // just doing a get will put it at the front of the LRU list
-            MemCacheLRU::Record dummy;
-            return _lru.get(key, dummy);
+            osg::ref_ptr<const osg::Object> object;
+            Config meta;
+            return shard(key).get(key, object, meta);
         }
 
         RecordStatus getRecordStatus( const std::string& key )
         {
             // ignore minTime; MemCache does not support expiration
-            return _lru.has(key) ? STATUS_OK : STATUS_NOT_FOUND;
+            return shard(key).has(key) ? STATUS_OK : STATUS_NOT_FOUND;
         }
 
         bool purge()
         {
-            _lru.clear();
+            for (auto& s : _shards)
+                s->clear();
             return true;
         }
 
@@ -119,7 +299,22 @@ namespace
             return key;
         }
 
-        MemCacheLRU _lru;
+        MemCache::Stats getStats()
+        {
+            MemCache::Stats total;
+            for (auto& s : _shards)
+            {
+                Threading::ScopedMutexLock lock(s->_mutex);
+                total._entries += s->_stats._entries;
+                total._bytes += s->_stats._bytes;
+                total._hits += s->_stats._hits;
+                total._misses += s->_stats._misses;
+                total._evictions += s->_stats._evictions;
+            }
+            return total;
+        }
+
+        std::vector<std::unique_ptr<MemCacheShard>> _shards;
     };
     
 
@@ -128,8 +323,9 @@ namespace
 
 //------------------------------------------------------------------------
 
-MemCache::MemCache( unsigned maxBinSize ) :
-_maxBinSize( osg::maximum(maxBinSize, 1u) )
+MemCache::MemCache( unsigned maxBinSize, std::size_t maxBinBytes ) :
+_maxBinSize( osg::maximum(maxBinSize, 1u) ),
+_maxBinBytes( maxBinBytes )
 {
     //nop
 }
@@ -137,7 +333,7 @@ _maxBinSize( osg::maximum(maxBinSize, 1u) )
 CacheBin*
 MemCache::addBin( const std::string& binID )
 {
-    return _bins.getOrCreate( binID, new MemCacheBin(binID, _maxBinSize) );
+    return _bins.getOrCreate( binID, new MemCacheBin(binID, _maxBinSize, _maxBinBytes) );
 }
 
 CacheBin*
@@ -158,18 +354,29 @@ MemCache::getOrCreateDefaultBin()
         // double check
         if ( !_defaultBin.valid() )
         {
-            _defaultBin = new MemCacheBin("__default", _maxBinSize);
+            _defaultBin = new MemCacheBin("__default", _maxBinSize, _maxBinBytes);
         }
     }
 
     return _defaultBin.get();
 }
 
+MemCache::Stats
+MemCache::getStats(const std::string& binID)
+{
+    MemCacheBin* bin = static_cast<MemCacheBin*>(getBin(binID));
+    return bin ? bin->getStats() : Stats();
+}
 
 void
 MemCache::dumpStats(const std::string& binID)
 {
-    MemCacheBin* bin = static_cast<MemCacheBin*>(getBin(binID));
-    CacheStats stats = bin->_lru.getStats();
-    OE_INFO << LC << "hit ratio = " << stats._hitRatio << std::endl;
+    Stats stats = getStats(binID);
+    std::uint64_t queries = stats._hits + stats._misses;
+    OE_INFO << LC 
+        << "entries = " << stats._entries
+        << ", bytes = " << stats._bytes
+        << ", hit ratio = " << (queries > 0u ? (float)stats._hits / (float)queries : 0.0f)
+        << ", evictions = " << stats._evictions
+        << std::endl;
 }
@@ -20,6 +20,10 @@
 * along with this program.  If not, see <http://www.gnu.org/licenses/>
 */
 #include <osgEarth/Memory>
+#include <osgEarth/Stats>
+#include <osg/Observer>
+#include <atomic>
+#include <new>
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
@@ -174,3 +178,142 @@ Memory::getProcessPeakPrivateUsage()
     return (size_t)0L;
 #endif
 }
+
+//....................................................................
+
+namespace
+{
+    const char* s_subsystemNames[Memory::NUM_SUBSYSTEMS] = {
+        "tile_textures",
+        "elevation",
+        "feature_geometry",
+        "cache",
+        "label_glyphs",
+        "other"
+    };
+
+    struct SubsystemUsage
+    {
+        Stats::Gauge* _usage;
+        std::atomic<std::int64_t> _peak;
+    };
+
+    // never destroyed, so tracked objects deleted during static
+    // destruction can still release their charge
+    SubsystemUsage* getSubsystems()
+    {
+        static SubsystemUsage* s_usage = []() {
+            SubsystemUsage* usage = new SubsystemUsage[Memory::NUM_SUBSYSTEMS];
+            for (int i = 0; i < Memory::NUM_SUBSYSTEMS; ++i)
+            {
+                usage[i]._usage = &Stats::gauge(
+                    "osgearth_memory_bytes",
+                    std::string("subsystem=\"") + s_subsystemNames[i] + "\"");
+                usage[i]._peak = 0;
+            }
+            return usage;
+        }();
+        return s_usage;
+    }
+
+    std::atomic<Memory::Allocator*> s_allocator(nullptr);
+
+    // Releases a charge when the object it observes is deleted
+    struct TrackedObserver : public osg::Observer
+    {
+        Memory::Tracked _tracked;
+        TrackedObserver(Memory::Subsystem subsystem) : _tracked(subsystem) { }
+        void objectDeleted(void*) override { delete this; }
+    };
+}
+
+void
+Memory::Tracked::set(std::size_t bytes)
+{
+    if (bytes != _bytes)
+    {
+        Memory::add(_subsystem, (std::int64_t)bytes - (std::int64_t)_bytes);
+        _bytes = bytes;
+    }
+}
+
+const char*
+Memory::getSubsystemName(Subsystem subsystem)
+{
+    return subsystem >= 0 && subsystem < NUM_SUBSYSTEMS ? s_subsystemNames[subsystem] : "unknown";
+}
+
+void
+Memory::add(Subsystem subsystem, std::int64_t bytes)
+{
+    if (subsystem < 0 || subsystem >= NUM_SUBSYSTEMS || bytes == 0)
+        return;
+
+    SubsystemUsage& s = getSubsystems()[subsystem];
+    s._usage->add(bytes);
+
+    std::int64_t usage = s._usage->get();
+    std::int64_t peak = s._peak.load(std::memory_order_relaxed);
+    while (usage > peak && !s._peak.compare_exchange_weak(peak, usage, std::memory_order_relaxed));
+}
+
+std::int64_t
+Memory::getUsage(Subsystem subsystem)
+{
+    return subsystem >= 0 && subsystem < NUM_SUBSYSTEMS ? getSubsystems()[subsystem]._usage->get() : 0;
+}
+
+std::int64_t
+Memory::getPeakUsage(Subsystem subsystem)
+{
+    return subsystem >= 0 && subsystem < NUM_SUBSYSTEMS ? getSubsystems()[subsystem]._peak.load() : 0;
+}
+
+void
+Memory::track(osg::Referenced* object, Subsystem subsystem, std::size_t bytes)
+{
+    if (object == nullptr || bytes == 0u)
+        return;
+
+    TrackedObserver* observer = new TrackedObserver(subsystem);
+    observer->_tracked.set(bytes);
+    object->addObserver(observer);
+}
+
+void*
+Memory::allocate(std::size_t bytes, Subsystem subsystem)
+{
+    Allocator* allocator = s_allocator.load();
+    void* ptr = allocator ? allocator->allocate(bytes, subsystem) : ::operator new(bytes);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    add(subsystem, (std::int64_t)bytes);
+    return ptr;
+}
+
+void
+Memory::deallocate(void* ptr, std::size_t bytes, Subsystem subsystem)
+{
+    if (ptr == nullptr)
+        return;
+
+    add(subsystem, -(std::int64_t)bytes);
+
+    Allocator* allocator = s_allocator.load();
+    if (allocator)
+        allocator->deallocate(ptr, bytes, subsystem);
+    else
+        ::operator delete(ptr);
+}
+
+void
+Memory::setAllocator(Allocator* allocator)
+{
+    s_allocator = allocator;
+}
+
+Memory::Allocator*
+Memory::getAllocator()
+{
+    return s_allocator.load();
+}
@@ -22,6 +22,7 @@
 
 #include <osgEarth/MeshConsolidator>
 #include <osgEarth/StringUtils>
+#include <osgEarth/Threading>
 #include <osg/TriangleFunctor>
 #include <osg/TriangleIndexFunctor>
 #include <osg/Version>
@@ -30,12 +31,17 @@
 #include <limits>
 #include <map>
 #include <iterator>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
 
 #define LC "[MeshConsolidator] "
 
+#define ARENA_MESH_CONSOLIDATOR "oe.meshconsolidator"
+
 //------------------------------------------------------------------------
 
 namespace
@@ -386,6 +392,274 @@ typedef std::vector<osg::ref_ptr<osg::Drawable> > DrawableList;
 
 namespace
 {
+    // Orders vertices by the values of all their arrays, so that vertices
+    // that can share an index compare equal.
+    struct VertexLess
+    {
+        const std::vector<osg::Array*>& _arrays;
+        VertexLess(const std::vector<osg::Array*>& arrays) : _arrays(arrays) { }
+        bool operator()(unsigned lhs, unsigned rhs) const
+        {
+            for( unsigned a=0; a<_arrays.size(); ++a )
+            {
+                int c = _arrays[a]->compare(lhs, rhs);
+                if ( c < 0 ) return true;
+                if ( c > 0 ) return false;
+            }
+            return false;
+        }
+    };
+
+    // Moves each kept vertex down to its new slot. Kept vertices are numbered in
+    // order of first use, so a vertex never moves up and this can work in place.
+    template<typename ARRAY>
+    bool compact( osg::Array* array, const std::vector<unsigned>& newToOld )
+    {
+        ARRAY* typed = dynamic_cast<ARRAY*>(array);
+        if ( !typed )
+            return false;
+        for( unsigned j=0; j<newToOld.size(); ++j )
+            (*typed)[j] = (*typed)[newToOld[j]];
+        typed->resize( newToOld.size() );
+        typed->dirty();
+        return true;
+    }
+
+    // Collapses vertices whose position, color, normal and texture coordinates
+    // all match into one, and remaps the primitive sets to match.
+    void weld( osg::Geometry& geom )
+    {
+        unsigned numVerts = geom.getVertexArray()->getNumElements();
+        if ( numVerts < 2 )
+            return;
+
+        std::vector<osg::Array*> arrays;
+        arrays.push_back( geom.getVertexArray() );
+        if ( geom.getColorArray() )  arrays.push_back( geom.getColorArray() );
+        if ( geom.getNormalArray() ) arrays.push_back( geom.getNormalArray() );
+        for( unsigned u=0; u<geom.getNumTexCoordArrays(); ++u )
+            if ( geom.getTexCoordArray(u) )
+                arrays.push_back( geom.getTexCoordArray(u) );
+
+        // merge() makes every array per-vertex and one of these types, but
+        // don't trust anything else
+        for( unsigned a=0; a<arrays.size(); ++a )
+        {
+            if ( arrays[a]->getNumElements() != numVerts )
+                return;
+
+            if ( !dynamic_cast<osg::Vec3Array*>(arrays[a]) &&
+                 !dynamic_cast<osg::Vec4Array*>(arrays[a]) &&
+                 !dynamic_cast<osg::Vec2Array*>(arrays[a]) )
+                return;
+        }
+
+        std::vector<unsigned> sorted( numVerts );
+        for( unsigned i=0; i<numVerts; ++i )
+            sorted[i] = i;
+        std::stable_sort( sorted.begin(), sorted.end(), VertexLess(arrays) );
+
+        // every vertex points at the first of its equals:
+        std::vector<unsigned> firstOf( numVerts );
+        VertexLess less( arrays );
+        for( unsigned i=0; i<numVerts; ++i )
+        {
+            if ( i > 0 && !less(sorted[i-1], sorted[i]) )
+                firstOf[sorted[i]] = firstOf[sorted[i-1]];
+            else
+                firstOf[sorted[i]] = sorted[i];
+        }
+
+        std::vector<unsigned> oldToNew( numVerts );
+        std::vector<unsigned> newToOld;
+        newToOld.reserve( numVerts );
+        for( unsigned i=0; i<numVerts; ++i )
+        {
+            if ( firstOf[i] == i )
+            {
+                oldToNew[i] = newToOld.size();
+                newToOld.push_back( i );
+            }
+            else
+            {
+                oldToNew[i] = oldToNew[firstOf[i]];
+            }
+        }
+
+        if ( newToOld.size() == numVerts )
+            return;
+
+        for( unsigned a=0; a<arrays.size(); ++a )
+        {
+            compact<osg::Vec3Array>( arrays[a], newToOld ) ||
+            compact<osg::Vec4Array>( arrays[a], newToOld ) ||
+            compact<osg::Vec2Array>( arrays[a], newToOld );
+        }
+
+        for( unsigned j=0; j<geom.getNumPrimitiveSets(); ++j )
+        {
+            osg::DrawElements* de = geom.getPrimitiveSet(j)->getDrawElements();
+            if ( de )
+            {
+                for( unsigned k=0; k<de->getNumIndices(); ++k )
+                    de->setElement( k, oldToNew[de->getElement(k)] );
+                de->dirty();
+            }
+        }
+
+        OE_DEBUG << LC << "Welded " << numVerts << " verts down to " << newToOld.size() << std::endl;
+    }
+
+    // Reorders the triangles in a GL_TRIANGLES set so that consecutive triangles
+    // reuse the vertices still in the GPU's post-transform cache. This is
+    // Tom Forsyth's "Linear-Speed Vertex Cache Optimisation". The triangles stay
+    // in the same primitive set, so any user data on the set is still valid.
+    void optimizeTriangleOrder( osg::DrawElements* de, unsigned numVerts )
+    {
+        const int cacheSize = 32;
+
+        const unsigned numTris = de->getNumIndices() / 3;
+        if ( numTris < 2 )
+            return;
+
+        std::vector<unsigned> indices( numTris*3 );
+        for( unsigned k=0; k<indices.size(); ++k )
+        {
+            indices[k] = de->getElement(k);
+            if ( indices[k] >= numVerts )
+                return;
+        }
+
+        // triangles using each vertex; the first remaining[v] entries are the
+        // ones not yet emitted.
+        std::vector<unsigned> remaining( numVerts, 0u );
+        for( unsigned k=0; k<indices.size(); ++k )
+            ++remaining[indices[k]];
+
+        std::vector<unsigned> adjStart( numVerts+1, 0u );
+        for( unsigned v=0; v<numVerts; ++v )
+            adjStart[v+1] = adjStart[v] + remaining[v];
+
+        std::vector<unsigned> adj( indices.size() );
+        std::vector<unsigned> fill( adjStart.begin(), adjStart.end()-1 );
+        for( unsigned k=0; k<indices.size(); ++k )
+            adj[fill[indices[k]]++] = k/3;
+
+        std::vector<int>   cachePos( numVerts, -1 );
+        std::vector<float> vertScore( numVerts );
+        std::vector<float> triScore( numTris, 0.0f );
+        std::vector<bool>  emitted( numTris, false );
+
+        auto score = [cacheSize](int cachePos, unsigned remaining) -> float
+        {
+            if ( remaining == 0 )
+                return -1.0f;
+            float s = 0.0f;
+            if ( cachePos >= 0 )
+            {
+                // the last triangle's verts score the same, so the order
+                // within it doesn't matter
+                s = cachePos < 3 ? 0.75f :
+                    powf( 1.0f - (float)(cachePos-3) / (float)(cacheSize-3), 1.5f );
+            }
+            // favor verts with few triangles left, to finish them off
+            return s + 2.0f * powf( (float)remaining, -0.5f );
+        };
+
+        for( unsigned v=0; v<numVerts; ++v )
+            vertScore[v] = score( -1, remaining[v] );
+
+        int best = -1;
+        float bestScore = -1.0f;
+        for( unsigned t=0; t<numTris; ++t )
+        {
+            triScore[t] = vertScore[indices[3*t]] + vertScore[indices[3*t+1]] + vertScore[indices[3*t+2]];
+            if ( triScore[t] > bestScore )
+                best = t, bestScore = triScore[t];
+        }
+
+        std::vector<unsigned> out;
+        out.reserve( indices.size() );
+
+        std::vector<unsigned> cache, newCache;
+        cache.reserve( cacheSize+3 );
+        newCache.reserve( cacheSize+3 );
+
+        unsigned scan = 0u;
+
+        for( unsigned n=0; n<numTris; ++n )
+        {
+            if ( best < 0 )
+            {
+                // nothing in the cache connects to an unemitted triangle; take
+                // the next one in the original order.
+                while( emitted[scan] )
+                    ++scan;
+                best = scan;
+            }
+
+            const unsigned* tri = &indices[3*best];
+            emitted[best] = true;
+
+            newCache.clear();
+            for( unsigned i=0; i<3; ++i )
+            {
+                unsigned v = tri[i];
+                out.push_back( v );
+                newCache.push_back( v );
+
+                // take the triangle out of the vertex's remaining list
+                unsigned* list = &adj[adjStart[v]];
+                for( unsigned r=0; r<remaining[v]; ++r )
+                {
+                    if ( list[r] == (unsigned)best )
+                    {
+                        list[r] = list[remaining[v]-1];
+                        break;
+                    }
+                }
+                --remaining[v];
+            }
+
+            for( unsigned c=0; c<cache.size(); ++c )
+            {
+                unsigned v = cache[c];
+                if ( v != tri[0] && v != tri[1] && v != tri[2] )
+                    newCache.push_back( v );
+            }
+
+            // rescore everything that moved in, along or out of the cache
+            for( unsigned c=0; c<newCache.size(); ++c )
+            {
+                unsigned v = newCache[c];
+                cachePos[v] = (int)c < cacheSize ? (int)c : -1;
+                vertScore[v] = score( cachePos[v], remaining[v] );
+            }
+
+            best = -1;
+            bestScore = -1.0f;
+            for( unsigned c=0; c<newCache.size(); ++c )
+            {
+                unsigned v = newCache[c];
+                for( unsigned r=0; r<remaining[v]; ++r )
+                {
+                    unsigned t = adj[adjStart[v]+r];
+                    triScore[t] = vertScore[indices[3*t]] + vertScore[indices[3*t+1]] + vertScore[indices[3*t+2]];
+                    if ( triScore[t] > bestScore )
+                        best = t, bestScore = triScore[t];
+                }
+            }
+
+            if ( newCache.size() > (unsigned)cacheSize )
+                newCache.resize( cacheSize );
+            cache.swap( newCache );
+        }
+
+        for( unsigned k=0; k<out.size(); ++k )
+            de->setElement( k, out[k] );
+        de->dirty();
+    }
+
     void merge( 
         DrawableList::iterator&       start, 
         DrawableList::iterator&       end,
@@ -394,6 +668,8 @@ namespace
         unsigned                      numNormals,
         const std::vector<unsigned>&  texCoordArrayUnits,
         bool                          useVBOs,
+        bool                          weldVertices,
+        bool                          optimizeVertexCache,
         DrawableList&                 results )
     {
         osg::Array::Binding newColorsBinding, newNormalsBinding;
@@ -470,7 +746,7 @@ namespace
             // merge in the stateset:
             if ( unifiedStateSet == 0L )
                 unifiedStateSet = geom->getStateSet();
-            else if ( geom->getStateSet() )
+            else if ( geom->getStateSet() && geom->getStateSet() != unifiedStateSet )
                 unifiedStateSet->merge( *geom->getStateSet() );            
 
             // copy over the verts:
@@ -618,6 +894,20 @@ namespace
         newGeom->setUseVertexBufferObjects( useVBOs );
         newGeom->setUseDisplayList( !useVBOs );
 
+        if ( weldVertices )
+            weld( *newGeom );
+
+        if ( optimizeVertexCache )
+        {
+            unsigned numGeomVerts = newGeom->getVertexArray()->getNumElements();
+            for( unsigned j=0; j < newGeom->getNumPrimitiveSets(); ++j )
+            {
+                osg::DrawElements* de = newGeom->getPrimitiveSet(j)->getDrawElements();
+                if ( de && de->getMode() == GL_TRIANGLES )
+                    optimizeTriangleOrder( de, numGeomVerts );
+            }
+        }
+
         results.push_back( newGeom );
 
         //GeometryValidator().apply( *newGeom );
@@ -625,8 +915,72 @@ namespace
 }
 
 
+namespace
+{
+    JobArena* getConsolidatorArena()
+    {
+        static JobArena* arena = []()
+        {
+            JobArena::setConcurrency(ARENA_MESH_CONSOLIDATOR, Threading::getConcurrency());
+            return JobArena::get(ARENA_MESH_CONSOLIDATOR);
+        }();
+        return arena;
+    }
+
+    // Runs of geometries to merge, shared with the jobs that merge them.
+    // A job that starts after all the runs are taken just returns.
+    struct MergeState
+    {
+        struct Run
+        {
+            DrawableList::iterator _start, _end;
+            unsigned _numVerts, _numColors, _numNormals;
+            DrawableList _results;
+        };
+
+        MergeState() : _next(0u), _done(0u), _mutex("OE.MeshConsolidator") { }
+
+        std::vector<Run> _runs;
+        std::vector<unsigned> _texCoordArrayUnits;
+        bool _useVBOs, _weldVertices, _optimizeVertexCache;
+        std::atomic<unsigned> _next;
+        std::atomic<unsigned> _done;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _finished;
+
+        void work()
+        {
+            for (;;)
+            {
+                unsigned r = _next++;
+                if (r >= _runs.size())
+                    break;
+
+                Run& run = _runs[r];
+
+                OE_DEBUG << LC << "Merging " << ((unsigned)(run._end-run._start)) << " geoms with " << run._numVerts << " verts." << std::endl;
+
+                merge(run._start, run._end, run._numVerts, run._numColors, run._numNormals,
+                      _texCoordArrayUnits, _useVBOs, _weldVertices, _optimizeVertexCache, run._results);
+
+                if (++_done == _runs.size())
+                {
+                    Threading::ScopedMutexLock lock(_mutex);
+                    _finished.notify_all();
+                }
+            }
+        }
+    };
+}
+
 void
 MeshConsolidator::run( osg::Geode& geode )
+{
+    run( geode, false, false );
+}
+
+void
+MeshConsolidator::run( osg::Geode& geode, bool weldVertices, bool optimizeVertexCache )
 {
     bool useVBOs = false;
     
@@ -637,11 +991,12 @@ MeshConsolidator::run( osg::Geode& geode )
     //geode.accept(mesher);
 
     // trivial bailout:
-    if ( geode.getNumDrawables() <= 1 )
+    if ( geode.getNumDrawables() <= 1 && !weldVertices && !optimizeVertexCache )
         return;
 
-    // list of geometries to consolidate and not to consolidate.
-    DrawableList consolidate, dontConsolidate;
+    // geometries to consolidate, grouped by stateset, and not to consolidate.
+    std::map<osg::StateSet*, DrawableList> consolidate;
+    DrawableList dontConsolidate;
 
     // list of texture coordinate array image units in use
     std::vector<unsigned> texCoordArrayUnits;
@@ -670,7 +1025,7 @@ MeshConsolidator::run( osg::Geode& geode )
                         useVBOs = true;
                 }
 
-                consolidate.push_back(geom);
+                consolidate[geom->getStateSet()].push_back(geom);
             }
             else
             {
@@ -679,42 +1034,76 @@ MeshConsolidator::run( osg::Geode& geode )
         }
     }
 
-    // start consolidating the geometries.
-    unsigned targetNumVertsPerGeom = 100000; //TODO: configurable?
-    DrawableList results;
+    // split each group into runs of geometries to merge together.
+    std::shared_ptr<MergeState> state = std::make_shared<MergeState>();
+    state->_texCoordArrayUnits = texCoordArrayUnits;
+    state->_useVBOs = useVBOs;
+    state->_weldVertices = weldVertices;
+    state->_optimizeVertexCache = optimizeVertexCache;
 
-    unsigned numVerts = 0, numColors = 0, numNormals = 0;
-    DrawableList::iterator start = consolidate.begin();
+    unsigned targetNumVertsPerGeom = 100000; //TODO: configurable?
 
-    for( DrawableList::iterator end = consolidate.begin(); end != consolidate.end(); )
+    for( std::map<osg::StateSet*, DrawableList>::iterator group = consolidate.begin(); group != consolidate.end(); ++group )
     {
-        osg::Geometry* geom = end->get()->asGeometry(); // already type-checked this earlier.
-        unsigned geomNumVerts = geom->getVertexArray()->getNumElements();
-
-        ++end;
+        DrawableList& list = group->second;
 
-        numVerts += geomNumVerts;
-        if ( geom->getColorArray() )
-            numColors += geom->getColorArray()->getNumElements();
-        if ( geom->getNormalArray() )
-            numNormals += geom->getNormalArray()->getNumElements();
+        unsigned numVerts = 0, numColors = 0, numNormals = 0;
+        DrawableList::iterator start = list.begin();
 
-        if ( numVerts > targetNumVertsPerGeom || end == consolidate.end() )
+        for( DrawableList::iterator end = list.begin(); end != list.end(); )
         {
-            OE_DEBUG << LC << "Merging " << ((unsigned)(end-start)) << " geoms with " << numVerts << " verts." << std::endl;
+            osg::Geometry* geom = end->get()->asGeometry(); // already type-checked this earlier.
+            unsigned geomNumVerts = geom->getVertexArray()->getNumElements();
 
-            merge( start, end, numVerts, numColors, numNormals, texCoordArrayUnits, useVBOs, results );
+            ++end;
 
-            start = end;
-            numVerts = 0, numColors = 0, numNormals = 0;
+            numVerts += geomNumVerts;
+            if ( geom->getColorArray() )
+                numColors += geom->getColorArray()->getNumElements();
+            if ( geom->getNormalArray() )
+                numNormals += geom->getNormalArray()->getNumElements();
+
+            if ( numVerts > targetNumVertsPerGeom || end == list.end() )
+            {
+                MergeState::Run run;
+                run._start = start, run._end = end;
+                run._numVerts = numVerts, run._numColors = numColors, run._numNormals = numNormals;
+                state->_runs.push_back( run );
+
+                start = end;
+                numVerts = 0, numColors = 0, numNormals = 0;
+            }
         }
     }
 
+    // Merge the runs. They share nothing, so they can run in parallel. The
+    // calling thread takes runs too, so this finishes even when it's called
+    // from a job in a busy arena.
+    unsigned numJobs = std::min( (unsigned)state->_runs.size(), Threading::getConcurrency() );
+    if ( numJobs > 1u )
+    {
+        JobArena* arena = getConsolidatorArena();
+        for( unsigned j=0; j<numJobs-1u; ++j )
+        {
+            Job job(arena);
+            job.setName("oe.meshconsolidator");
+            job.dispatch([state](Cancelable*) { state->work(); });
+        }
+    }
+
+    state->work();
+
+    {
+        std::unique_lock<Threading::Mutex> lock(state->_mutex);
+        state->_finished.wait(lock, [&state]() { return state->_done == state->_runs.size(); });
+    }
+
     // re-build the geode:
     geode.removeDrawables( 0, geode.getNumDrawables() );
 
-    for( DrawableList::iterator i = results.begin(); i != results.end(); ++i )
-        geode.addDrawable( i->get() );
+    for( unsigned r=0; r<state->_runs.size(); ++r )
+        for( DrawableList::iterator i = state->_runs[r]._results.begin(); i != state->_runs[r]._results.end(); ++i )
+            geode.addDrawable( i->get() );
 
     for( DrawableList::iterator i = dontConsolidate.begin(); i != dontConsolidate.end(); ++i )
         geode.addDrawable( i->get() );
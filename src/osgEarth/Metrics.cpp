@@ -22,6 +22,8 @@
 #include <osgViewer/ViewerBase>
 #include <osgViewer/View>
 #include <osgEarth/Memory>
+#include <osgEarth/Threading>
+#include <unordered_map>
 
 using namespace osgEarth::Util;
 
@@ -39,8 +41,52 @@ void Metrics::setEnabled(bool enabled)
     s_metricsEnabled = enabled;
 }
 
+namespace
+{
+#ifdef OSGEARTH_PROFILING
+    // Plot the state of each job arena. Tracy identifies plots by
+    // the name pointer, so the names must persist.
+    void plotJobArenas()
+    {
+        struct PlotNames {
+            std::string pending, running, canceled, wait, run;
+        };
+        static std::unordered_map<std::string, PlotNames> s_names;
+
+        const osgEarth::Threading::JobArena::Metrics& m = osgEarth::Threading::JobArena::metrics();
+        for (int i = 0; i <= m.maxArenaIndex; ++i)
+        {
+            const osgEarth::Threading::JobArena::Metrics::Arena& arena = m.arena(i);
+            if (arena.active)
+            {
+                PlotNames& names = s_names[arena.arenaName];
+                if (names.pending.empty())
+                {
+                    names.pending = arena.arenaName + " pending";
+                    names.running = arena.arenaName + " running";
+                    names.canceled = arena.arenaName + " canceled";
+                    names.wait = arena.arenaName + " avg wait (ms)";
+                    names.run = arena.arenaName + " avg run (ms)";
+                }
+                OE_PROFILING_PLOT(names.pending.c_str(), (float)arena.numJobsPending);
+                OE_PROFILING_PLOT(names.running.c_str(), (float)arena.numJobsRunning);
+                OE_PROFILING_PLOT(names.canceled.c_str(), (float)arena.numJobsCanceled);
+                OE_PROFILING_PLOT(names.wait.c_str(), (float)(arena.waitTime.average() * 0.001));
+                OE_PROFILING_PLOT(names.run.c_str(), (float)(arena.runTime.average() * 0.001));
+            }
+        }
+    }
+#endif
+}
+
 void Metrics::frame()
 {
+#ifdef OSGEARTH_PROFILING
+    if (enabled())
+    {
+        plotJobArenas();
+    }
+#endif
     OE_PROFILING_FRAME_MARK;
 }
 
@@ -84,7 +130,16 @@ int Metrics::run(osgViewer::ViewerBase& viewer)
         {         
             OE_PROFILING_PLOT("WorkingSet", (float)(Memory::getProcessPhysicalUsage() / 1048576));
             OE_PROFILING_PLOT("PrivateBytes", (float)(Memory::getProcessPrivateUsage() / 1048576));
-            OE_PROFILING_PLOT("PeakPrivateBytes", (float)(Memory::getProcessPeakPrivateUsage() / 1048576));                                                                                                 
+            OE_PROFILING_PLOT("PeakPrivateBytes", (float)(Memory::getProcessPeakPrivateUsage() / 1048576));
+
+            static std::string s_subsystemPlots[Memory::NUM_SUBSYSTEMS];
+            for (int i = 0; i < Memory::NUM_SUBSYSTEMS; ++i)
+            {
+                Memory::Subsystem subsystem = (Memory::Subsystem)i;
+                if (s_subsystemPlots[i].empty())
+                    s_subsystemPlots[i] = std::string("Memory ") + Memory::getSubsystemName(subsystem) + " (MB)";
+                OE_PROFILING_PLOT(s_subsystemPlots[i].c_str(), (float)(Memory::getUsage(subsystem) / 1048576));
+            }
         }
 
         frame();
@@ -20,7 +20,9 @@
 #include <osgEarth/NetworkMonitor>
 #include <osgEarth/Threading>
 #include <osgDB/fstream>
+#include <osgDB/FileNameUtils>
 #include <iomanip>
+#include <unordered_map>
 
 using namespace osgEarth;
 
@@ -31,12 +33,114 @@ namespace
     static unsigned long s_requestId = 0;
     static bool s_enabled = false;
     static std::map<unsigned int, std::string> s_requestLayer;
+
+    // Per-host throttling state. Concurrency is a simple counter; bandwidth
+    // is a token bucket holding up to one second of transfer, charged after
+    // each response completes (the size is not known up front).
+    struct HostState
+    {
+        HostState() :
+            maxRequests(0u),
+            maxBytesPerSecond(0.0),
+            hasOwnLimits(false),
+            active(0u),
+            waiting(0u),
+            tokens(0.0),
+            lastRefill(osg::Timer::instance()->tick()) { }
+
+        void setLimits(unsigned requests, double bytesPerSecond)
+        {
+            maxRequests = requests;
+            maxBytesPerSecond = bytesPerSecond;
+            tokens = bytesPerSecond;
+        }
+
+        void refill()
+        {
+            osg::Timer_t now = osg::Timer::instance()->tick();
+            if (maxBytesPerSecond > 0.0)
+            {
+                tokens += maxBytesPerSecond * osg::Timer::instance()->delta_s(lastRefill, now);
+                if (tokens > maxBytesPerSecond)
+                    tokens = maxBytesPerSecond;
+            }
+            lastRefill = now;
+        }
+
+        bool available() const
+        {
+            return
+                (maxRequests == 0u || active < maxRequests) &&
+                (maxBytesPerSecond <= 0.0 || tokens > 0.0);
+        }
+
+        float saturation() const
+        {
+            float s = 0.0f;
+            if (maxRequests > 0u)
+                s += (float)(active + waiting) / (float)maxRequests;
+            if (maxBytesPerSecond > 0.0 && tokens <= 0.0)
+                s += 1.0f + (float)(-tokens / maxBytesPerSecond);
+            return s;
+        }
+
+        unsigned maxRequests;
+        double maxBytesPerSecond;
+        bool hasOwnLimits;
+        unsigned active;
+        unsigned waiting;
+        double tokens;
+        osg::Timer_t lastRefill;
+    };
+
+    osgEarth::Threading::Mutex s_hostsMutex("NetworkMonitor hosts(OE)");
+    std::condition_variable_any s_hostsChanged;
+    std::unordered_map<std::string, HostState> s_hosts;
+    std::unordered_map<std::string, std::string> s_layerHost;
+    unsigned s_defaultMaxRequests = 0u;
+    double s_defaultMaxBytesPerSecond = 0.0;
+    std::atomic_bool s_throttling(false);
+
+    // call with s_hostsMutex locked
+    HostState& getHostState(const std::string& host)
+    {
+        auto i = s_hosts.find(host);
+        if (i == s_hosts.end())
+        {
+            i = s_hosts.emplace(host, HostState()).first;
+            i->second.setLimits(s_defaultMaxRequests, s_defaultMaxBytesPerSecond);
+        }
+        return i->second;
+    }
+
+    // remember which host a layer reads from, for getLayerThrottle
+    void noteLayerHost(const std::string& uri)
+    {
+        std::string layer;
+        {
+            osgEarth::Threading::ScopedReadLock lock(s_requestsMutex);
+            auto i = s_requestLayer.find(osgEarth::Threading::getCurrentThreadId());
+            if (i != s_requestLayer.end())
+                layer = i->second;
+        }
+        if (!layer.empty())
+        {
+            std::string host = NetworkMonitor::getHost(uri);
+            osgEarth::Threading::ScopedMutexLock lock(s_hostsMutex);
+            s_layerHost[layer] = host;
+        }
+    }
 }
 
 #define LC "[NetworkMonitor] "
 
 unsigned long NetworkMonitor::begin(const std::string& uri, const std::string& status, const std::string& type)
 {
+    if (s_throttling)
+    {
+        noteLayerHost(uri);
+    }
+
     if (s_enabled)
     {
         osgEarth::Threading::ScopedWriteLock lock(s_requestsMutex);
@@ -137,3 +241,114 @@ std::string NetworkMonitor::getRequestLayer()
     return s_requestLayer[osgEarth::Threading::getCurrentThreadId()];
 }
 
+
+void NetworkMonitor::setDefaultHostLimits(unsigned maxRequests, double maxBytesPerSecond)
+{
+    osgEarth::Threading::ScopedMutexLock lock(s_hostsMutex);
+    s_defaultMaxRequests = maxRequests;
+    s_defaultMaxBytesPerSecond = maxBytesPerSecond;
+    for (auto& i : s_hosts)
+    {
+        if (!i.second.hasOwnLimits)
+            i.second.setLimits(maxRequests, maxBytesPerSecond);
+    }
+    if (maxRequests > 0u || maxBytesPerSecond > 0.0)
+        s_throttling = true;
+    s_hostsChanged.notify_all();
+}
+
+void NetworkMonitor::setHostLimits(const std::string& host, unsigned maxRequests, double maxBytesPerSecond)
+{
+    osgEarth::Threading::ScopedMutexLock lock(s_hostsMutex);
+    HostState& state = getHostState(host);
+    state.setLimits(maxRequests, maxBytesPerSecond);
+    state.hasOwnLimits = true;
+    if (maxRequests > 0u || maxBytesPerSecond > 0.0)
+        s_throttling = true;
+    s_hostsChanged.notify_all();
+}
+
+std::string NetworkMonitor::getHost(const std::string& url)
+{
+    std::string host = osgDB::getServerAddress(url);
+    std::string::size_type colon = host.find(':');
+    return colon != std::string::npos ? host.substr(0, colon) : host;
+}
+
+bool NetworkMonitor::acquire(const std::string& host, Threading::Cancelable* cancelable)
+{
+    if (!s_throttling)
+        return true;
+
+    std::unique_lock<osgEarth::Threading::Mutex> lock(s_hostsMutex);
+    HostState& state = getHostState(host);
+    state.refill();
+
+    if (!state.available())
+    {
+        ++state.waiting;
+        while (!state.available())
+        {
+            if (cancelable && cancelable->isCanceled())
+            {
+                --state.waiting;
+                return false;
+            }
+            // wake periodically to refill the bucket and check for cancelation
+            s_hostsChanged.wait_for(lock, std::chrono::milliseconds(10));
+            state.refill();
+        }
+        --state.waiting;
+    }
+
+    ++state.active;
+    return true;
+}
+
+bool NetworkMonitor::tryAcquire(const std::string& host)
+{
+    if (!s_throttling)
+        return true;
+
+    osgEarth::Threading::ScopedMutexLock lock(s_hostsMutex);
+    HostState& state = getHostState(host);
+    state.refill();
+    if (!state.available())
+        return false;
+
+    ++state.active;
+    return true;
+}
+
+void NetworkMonitor::release(const std::string& host, unsigned long bytes)
+{
+    if (!s_throttling)
+        return;
+
+    osgEarth::Threading::ScopedMutexLock lock(s_hostsMutex);
+    HostState& state = getHostState(host);
+
+    // limits may have been switched on while this request was running
+    if (state.active > 0u)
+        --state.active;
+
+    state.refill();
+    if (state.maxBytesPerSecond > 0.0)
+        state.tokens -= (double)bytes;
+
+    s_hostsChanged.notify_all();
+}
+
+float NetworkMonitor::getLayerThrottle(const std::string& layer)
+{
+    if (!s_throttling)
+        return 0.0f;
+
+    osgEarth::Threading::ScopedMutexLock lock(s_hostsMutex);
+    auto i = s_layerHost.find(layer);
+    if (i == s_layerHost.end())
+        return 0.0f;
+
+    auto h = s_hosts.find(i->second);
+    return h != s_hosts.end() ? h->second.saturation() : 0.0f;
+}
@@ -91,7 +91,9 @@ OGR::OGRFeatureCursor::OGRFeatureCursor(OGRDataSourceH              dsHandle,
                                         const Query&                query,
                                         const FeatureFilterChain*   filters,
                                         ProgressCallback*           progress,
-                                        bool                        rewindPolygons
+                                        bool                        rewindPolygons,
+                                        const OGRFeatureSource*     handlesOwner,
+                                        unsigned                    handlesGeneration
                                         ) :
 FeatureCursor     ( progress ),
 _source           ( source ),
@@ -105,7 +107,9 @@ _nextHandleToQueue( 0L ),
 _resultSetEndReached(false),
 _profile          ( profile ),
 _filters          ( filters ),
-_rewindPolygons   (rewindPolygons)
+_rewindPolygons   (rewindPolygons),
+_handlesOwner     (handlesOwner),
+_handlesGeneration(handlesGeneration)
 {
     std::string expr;
     std::string from = OGR_FD_GetName(OGR_L_GetLayerDefn(_layerHandle));
@@ -206,7 +210,8 @@ OGR::OGRFeatureCursor::OGRFeatureCursor(OGRLayerH resultSetHandle, const Feature
     _spatialFilter(0L),
     _chunkSize(500),
     _nextHandleToQueue(0L),
-    _resultSetEndReached(false)
+    _resultSetEndReached(false),
+    _handlesGeneration(0u)
 {
     if (_resultSetHandle)
     {
@@ -228,7 +233,20 @@ OGR::OGRFeatureCursor::~OGRFeatureCursor()
         OGR_G_DestroyGeometry( _spatialFilter );
 
     if ( _dsHandle )
-        OGRReleaseDataSource( _dsHandle );
+    {
+        if ( _handlesOwner.valid() )
+        {
+            OGRFeatureSource::CursorHandles handles;
+            handles._dsHandle = _dsHandle;
+            handles._layerHandle = _layerHandle;
+            handles._generation = _handlesGeneration;
+            _handlesOwner->releaseCursorHandles( handles );
+        }
+        else
+        {
+            OGRReleaseDataSource( _dsHandle );
+        }
+    }
 }
 
 bool
@@ -395,11 +413,16 @@ OGRFeatureSource::init()
     _needsSync = false;
     _writable = false;
     _geometryType = Geometry::TYPE_UNKNOWN;
+    _cursorHandlesMutex.setName("OE.OGRFeatureSource.CursorHandles");
+    _cursorHandlesGeneration = 0u;
+    _maxIdleCursorHandles = Threading::getConcurrency();
 }
 
 Status
 OGRFeatureSource::closeImplementation()
 {
+    closeIdleCursorHandles();
+
     if (_layerHandle)
     {
         if (_needsSync)
@@ -422,11 +445,80 @@ OGRFeatureSource::closeImplementation()
         _dsHandle = 0L;
     }
 
+    // keep the generation going so cursors still out there won't hand
+    // their handles back to the pool once it reopens
+    unsigned generation = _cursorHandlesGeneration;
     init();
+    _cursorHandlesGeneration = generation;
 
     return FeatureSource::closeImplementation();
 }
 
+bool
+OGRFeatureSource::acquireCursorHandles(CursorHandles& out) const
+{
+    {
+        Threading::ScopedMutexLock lock(_cursorHandlesMutex);
+        if (!_idleCursorHandles.empty())
+        {
+            out = _idleCursorHandles.back();
+            _idleCursorHandles.pop_back();
+            return true;
+        }
+        out._generation = _cursorHandlesGeneration;
+    }
+
+    // Each cursor needs its own DS handle so that multi-threaded access will
+    // work, so don't use a shared open here.
+    OGRSFDriverH driver = 0L;
+    out._dsHandle = OGROpen(_source.c_str(), 0, &driver);
+    if (!out._dsHandle)
+        return false;
+
+    out._layerHandle = OGR::openLayer(out._dsHandle, options().layer().get());
+    if (!out._layerHandle)
+    {
+        OGRReleaseDataSource(out._dsHandle);
+        out._dsHandle = 0L;
+        return false;
+    }
+
+    return true;
+}
+
+void
+OGRFeatureSource::releaseCursorHandles(const CursorHandles& handles) const
+{
+    {
+        Threading::ScopedMutexLock lock(_cursorHandlesMutex);
+        if (!_writable &&
+            handles._generation == _cursorHandlesGeneration &&
+            _idleCursorHandles.size() < _maxIdleCursorHandles)
+        {
+            _idleCursorHandles.push_back(handles);
+            return;
+        }
+    }
+
+    OGRReleaseDataSource(handles._dsHandle);
+}
+
+void
+OGRFeatureSource::closeIdleCursorHandles()
+{
+    std::vector<CursorHandles> idle;
+    {
+        Threading::ScopedMutexLock lock(_cursorHandlesMutex);
+        ++_cursorHandlesGeneration;
+        idle.swap(_idleCursorHandles);
+    }
+
+    for (auto& handles : idle)
+    {
+        OGRReleaseDataSource(handles._dsHandle);
+    }
+}
+
 OGRFeatureSource::~OGRFeatureSource()
 {
     close();
@@ -795,19 +887,11 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
     }
     else
     {
-        OGRDataSourceH dsHandle = 0L;
-        OGRLayerH layerHandle = 0L;
-
-        // open the handles safely:
-        // Each cursor requires its own DS handle so that multi-threaded access will work.
-        // The cursor impl will dispose of the new DS handle.
-        dsHandle = OGROpenShared(_source.c_str(), 0, &_ogrDriverHandle);
-        if (dsHandle)
-        {
-            layerHandle = OGR::openLayer(dsHandle, options().layer().get());
-        }
+        // The cursor returns the handles to the pool when it's done with them.
+        CursorHandles handles;
+        bool haveHandles = acquireCursorHandles(handles);
 
-        if (dsHandle && layerHandle)
+        if (haveHandles)
         {
             Query newQuery(query);
             if (options().query().isSet())
@@ -819,26 +903,108 @@ OGRFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
 
             // cursor is responsible for the OGR handles.
             return new OGR::OGRFeatureCursor(
-                dsHandle,
-                layerHandle,
+                handles._dsHandle,
+                handles._layerHandle,
                 this,
                 getFeatureProfile(),
                 newQuery,
                 getFilters(),
                 progress,
-                *_options->rewindPolygons()
+                *_options->rewindPolygons(),
+                this,
+                handles._generation
                 );
         }
         else
         {
-            if (dsHandle)
+            return 0L;
+        }
+    }
+}
+
+bool
+OGRFeatureSource::getFeatureBoundsImplementation(const Query& query, FeatureBoundsList& output, ProgressCallback* progress)
+{
+    Query newQuery(query);
+    if (options().query().isSet())
+    {
+        newQuery = options().query()->combineWith(query);
+    }
+
+    // SQL needs the full result set, so let the cursor handle it
+    if (_geometry.valid() || newQuery.expression().isSet() || newQuery.orderby().isSet())
+    {
+        return FeatureSource::getFeatureBoundsImplementation(query, output, progress);
+    }
+
+    CursorHandles handles;
+    if (!acquireCursorHandles(handles))
+        return false;
+
+    OGRLayerH layer = handles._layerHandle;
+
+    // if the tilekey is set, convert it to feature profile coords
+    if (newQuery.tileKey().isSet() && !newQuery.bounds().isSet() && getFeatureProfile())
+    {
+        GeoExtent localEx = newQuery.tileKey()->getExtent().transform(getFeatureProfile()->getSRS());
+        newQuery.bounds() = localEx.bounds();
+    }
+
+    if (newQuery.bounds().isSet())
+    {
+        const Bounds& b = newQuery.bounds().get();
+        OGR_L_SetSpatialFilterRect(layer, b.xMin(), b.yMin(), b.xMax(), b.yMax());
+    }
+
+    // Only the geometry is needed, so don't let OGR read any attributes
+    OGRFeatureDefnH defn = OGR_L_GetLayerDefn(layer);
+    std::vector<const char*> ignoredFields;
+    for (int i = 0; i < OGR_FD_GetFieldCount(defn); ++i)
+    {
+        ignoredFields.push_back(OGR_Fld_GetNameRef(OGR_FD_GetFieldDefn(defn, i)));
+    }
+    ignoredFields.push_back("OGR_STYLE");
+    ignoredFields.push_back(0L);
+    OGR_L_SetIgnoredFields(layer, &ignoredFields[0]);
+
+    OGR_L_ResetReading(layer);
+
+    bool canceled = false;
+    OGRFeatureH handle;
+    while ((handle = OGR_L_GetNextFeature(layer)) != 0L)
+    {
+        OGRGeometryH geom = OGR_F_GetGeometryRef(handle);
+        if (geom && !OGR_G_IsEmpty(geom))
+        {
+            FeatureID fid = OGR_F_GetFID(handle);
+            if (!isBlacklisted(fid))
             {
-                OGRReleaseDataSource(dsHandle);
+                OGREnvelope env;
+                OGR_G_GetEnvelope(geom, &env);
+
+                FeatureBounds entry;
+                entry.fid = fid;
+                entry.bounds = Bounds(env.MinX, env.MinY, env.MaxX, env.MaxY);
+                output.push_back(entry);
             }
+        }
+        OGR_F_Destroy(handle);
 
-            return 0L;
+        if (progress && progress->isCanceled())
+        {
+            canceled = true;
+            break;
         }
     }
+
+    // put the layer back the way the cursors expect it before pooling it
+    OGR_L_SetIgnoredFields(layer, 0L);
+    OGR_L_SetSpatialFilter(layer, 0L);
+    OGR_L_ResetReading(layer);
+
+    releaseCursorHandles(handles);
+
+    return !canceled;
 }
 
 bool
@@ -846,9 +1012,14 @@ OGRFeatureSource::deleteFeature(FeatureID fid)
 {
     if (_writable && _layerHandle)
     {
+        // so users of the source know where the feature was
+        osg::ref_ptr<Feature> feature = getFeature(fid);
+        GeoExtent extent = feature.valid() ? feature->getExtent() : GeoExtent::INVALID;
+
         if (OGR_L_DeleteFeature(_layerHandle, fid) == OGRERR_NONE)
         {
             _needsSync = true;
+            featuresChanged(std::vector<FeatureID>(1, fid), extent);
             return true;
         }
     }
@@ -961,7 +1132,7 @@ OGRFeatureSource::insertFeature(Feature* feature)
         return false;
     }
 
-    dirty();
+    featuresChanged(std::vector<FeatureID>(), feature->getExtent());
 
     return true;
 }
@@ -31,7 +31,8 @@ using namespace osgEarth;
 //#undef OE_DEBUG
 //#define OE_DEBUG OE_NOTICE
 
-// Object IDs under this reserved
+// Object IDs under this reserved. (Every generated ID has a non-zero
+// generation in its high bits, so it's always larger than this.)
 #define STARTING_OBJECT_ID 10
 
 namespace
@@ -60,9 +61,13 @@ namespace
 }
 
 ObjectIndex::ObjectIndex() :
-_idGen( STARTING_OBJECT_ID ),
-_mutex("ObjectIndex(OE)")
+_freeMutex("ObjectIndex(OE)"),
+_numSlots( 0u ),
+_size( 0u )
 {
+    for (unsigned i = 0; i < MAX_CHUNKS; ++i)
+        _chunks[i] = NULL;
+
     _attribName     = "oe_index_objectid_attr";
     _attribLocation = osg::Drawable::SECONDARY_COLORS;
     _oidUniformName = "oe_index_objectid_uniform";
@@ -71,6 +76,12 @@ _mutex("ObjectIndex(OE)")
     _shaders.add( "ObjectIndex.vert.glsl", indexVertexInit );
 }
 
+ObjectIndex::~ObjectIndex()
+{
+    for (unsigned i = 0; i < MAX_CHUNKS; ++i)
+        delete _chunks[i].load();
+}
+
 bool
 ObjectIndex::loadShaders(VirtualProgram* vp) const
 {
@@ -85,7 +96,7 @@ ObjectIndex::loadShaders(VirtualProgram* vp) const
 void
 ObjectIndex::setObjectIDAtrribLocation(int value)
 {
-    if ( _index.size() == 0 )
+    if ( _size == 0u )
     {
         _attribLocation = value;
     } 
@@ -98,48 +109,109 @@ ObjectIndex::setObjectIDAtrribLocation(int value)
 ObjectID
 ObjectIndex::insert(osg::Referenced* object)
 {
-    Threading::ScopedMutexLock excl( _mutex );
     return insertImpl( object );
 }
 
 ObjectID
 ObjectIndex::insertImpl(osg::Referenced* object)
 {
-    // internal: assume mutex is locked
-    ObjectID id = ++_idGen;
-    _index[id] = object;
-    OE_DEBUG << LC << "Insert " << id << "; size = " << _index.size() << "\n";
+    unsigned slot;
+    Chunk* chunk;
+    {
+        Threading::ScopedMutexLock lock(_freeMutex);
+
+        if (!_freeSlots.empty())
+        {
+            // reuse the oldest free slot, so a slot's generations wrap around
+            // as slowly as possible
+            slot = _freeSlots.front();
+            _freeSlots.pop_front();
+        }
+        else if (_numSlots <= SLOT_MASK)
+        {
+            slot = _numSlots++;
+        }
+        else
+        {
+            OE_WARN << LC << "Index is full" << std::endl;
+            return OSGEARTH_OBJECTID_EMPTY;
+        }
+
+        chunk = _chunks[slot >> CHUNK_BITS].load(std::memory_order_acquire);
+        if (!chunk)
+        {
+            chunk = new Chunk();
+            _chunks[slot >> CHUNK_BITS].store(chunk, std::memory_order_release);
+        }
+    }
+
+    ObjectID id;
+    {
+        Threading::ScopedWriteLock lock(chunk->_mutex);
+        Slot& s = chunk->_slots[slot & (CHUNK_SIZE - 1u)];
+        s._object = object;
+        id = (s._generation << SLOT_BITS) | slot;
+    }
+
+    ++_size;
+    OE_DEBUG << LC << "Insert " << id << "; size = " << _size << "\n";
     return id;
 }
 
-osg::Referenced*
+osg::ref_ptr<osg::Referenced>
 ObjectIndex::getImpl(ObjectID id) const
 {
-    // assume the mutex is locked
-    IndexMap::const_iterator i = _index.find(id);
-    return i != _index.end() ? i->second.get() : 0L;
+    osg::ref_ptr<osg::Referenced> object;
+
+    unsigned slot = id & SLOT_MASK;
+    const Chunk* chunk = _chunks[slot >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk)
+    {
+        Threading::ScopedReadLock lock(chunk->_mutex);
+        const Slot& s = chunk->_slots[slot & (CHUNK_SIZE - 1u)];
+        if (s._generation == (id >> SLOT_BITS))
+            s._object.lock(object);
+    }
+    return object;
 }
 
 void
 ObjectIndex::remove(ObjectID id)
 {
-    Threading::ScopedMutexLock excl(_mutex);
     removeImpl(id);
 }
 
 void
 ObjectIndex::removeImpl(ObjectID id)
 {
-    // internal - assume mutex is locked
-    _index.erase( id );
-    OE_DEBUG << "Remove " << id << "; size = " << _index.size() << "\n";
+    unsigned slot = id & SLOT_MASK;
+    Chunk* chunk = _chunks[slot >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (!chunk)
+        return;
 
+    {
+        Threading::ScopedWriteLock lock(chunk->_mutex);
+        Slot& s = chunk->_slots[slot & (CHUNK_SIZE - 1u)];
+        if (s._generation != (id >> SLOT_BITS))
+            return;
+
+        // retire the ID; generation 0 is never used
+        s._object = NULL;
+        s._generation = s._generation >= MAX_GENERATION ? 1u : s._generation + 1u;
+    }
+
+    {
+        Threading::ScopedMutexLock lock(_freeMutex);
+        _freeSlots.push_back(slot);
+    }
+
+    --_size;
+    OE_DEBUG << "Remove " << id << "; size = " << _size << "\n";
 }
 
 ObjectID
 ObjectIndex::tagDrawable(osg::Drawable* drawable, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
     ObjectID oid = insertImpl(object);
     tagDrawable(drawable, oid);
     return oid;
@@ -167,6 +239,46 @@ ObjectIndex::tagDrawable(osg::Drawable* drawable, ObjectID id) const
     ids->assign( geom->getVertexArray()->getNumElements(), id );
 }
 
+ObjectID
+ObjectIndex::tagRange(osg::Drawable* drawable, osg::Referenced* object, unsigned first, unsigned count)
+{
+    ObjectID oid = insertImpl(object);
+    tagRange(drawable, oid, first, count);
+    return oid;
+}
+
+void
+ObjectIndex::tagRange(osg::Drawable* drawable, ObjectID id, unsigned first, unsigned count) const
+{
+    if ( drawable == 0L )
+        return;
+
+    osg::Geometry* geom = drawable->asGeometry();
+    if ( !geom || !geom->getVertexArray() )
+        return;
+
+    // reuse the existing ID array so earlier ranges keep their tags:
+    ObjectIDArray* ids = dynamic_cast<ObjectIDArray*>(geom->getVertexAttribArray(_attribLocation));
+    if ( !ids )
+    {
+        ids = new ObjectIDArray();
+        ids->setBinding(osg::Array::BIND_PER_VERTEX);
+        ids->setNormalize(false);
+        geom->setVertexAttribArray(_attribLocation, ids);
+        ids->setPreserveDataType(true);
+    }
+
+    unsigned numVerts = geom->getVertexArray()->getNumElements();
+    if ( ids->size() < numVerts )
+        ids->resize( numVerts, OSGEARTH_OBJECTID_EMPTY );
+
+    unsigned last = osg::minimum(first + count, (unsigned)ids->size());
+    for(unsigned i = first; i < last; ++i)
+        (*ids)[i] = id;
+
+    ids->dirty();
+}
+
 namespace
 {
     struct FindAndTagDrawables : public osg::NodeVisitor
@@ -191,7 +303,6 @@ namespace
 ObjectID
 ObjectIndex::tagAllDrawables(osg::Node* node, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
     ObjectID oid = insertImpl(object);
     tagAllDrawables(node, oid);
     return oid;
@@ -210,7 +321,6 @@ ObjectIndex::tagAllDrawables(osg::Node* node, ObjectID id) const
 ObjectID
 ObjectIndex::tagNode(osg::Node* node, osg::Referenced* object)
 {
-    Threading::ScopedMutexLock lock(_mutex);
     ObjectID oid = insertImpl(object);
     tagNode(node, oid);
     return oid;
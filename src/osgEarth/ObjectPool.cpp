@@ -0,0 +1,124 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ObjectPool>
+#include <osgEarth/Threading>
+#include <new>
+#include <vector>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[ObjectPool] "
+
+#define GRANULARITY 16u
+#define NUM_CLASSES (ObjectPool::MAX_SIZE / GRANULARITY)
+
+namespace
+{
+    struct SizeClass
+    {
+        Threading::Mutex _mutex;
+        std::vector<void*> _free;
+    };
+
+    // never destroyed, so objects released during static
+    // destruction can still return their blocks
+    SizeClass* getClasses()
+    {
+        static SizeClass* s_classes = new SizeClass[NUM_CLASSES];
+        return s_classes;
+    }
+
+    inline unsigned getClassIndex(std::size_t size)
+    {
+        return (unsigned)((size + GRANULARITY - 1u) / GRANULARITY) - 1u;
+    }
+}
+
+void*
+ObjectPool::allocate(std::size_t size)
+{
+    if (size == 0u || size > MAX_SIZE)
+        return ::operator new(size);
+
+    unsigned index = getClassIndex(size);
+    SizeClass& c = getClasses()[index];
+    {
+        Threading::ScopedMutexLock lock(c._mutex);
+        if (!c._free.empty())
+        {
+            void* ptr = c._free.back();
+            c._free.pop_back();
+            return ptr;
+        }
+    }
+
+    // always allocate the full class size so the block can be
+    // reused by any object in the class
+    return ::operator new((index + 1u) * GRANULARITY);
+}
+
+void
+ObjectPool::deallocate(void* ptr, std::size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    if (size > 0u && size <= MAX_SIZE)
+    {
+        SizeClass& c = getClasses()[getClassIndex(size)];
+        Threading::ScopedMutexLock lock(c._mutex);
+        if (c._free.size() < MAX_FREE)
+        {
+            c._free.push_back(ptr);
+            return;
+        }
+    }
+
+    ::operator delete(ptr);
+}
+
+std::size_t
+ObjectPool::getNumFreeBlocks()
+{
+    std::size_t count = 0u;
+    SizeClass* classes = getClasses();
+    for (unsigned i = 0; i < NUM_CLASSES; ++i)
+    {
+        Threading::ScopedMutexLock lock(classes[i]._mutex);
+        count += classes[i]._free.size();
+    }
+    return count;
+}
+
+void
+ObjectPool::trim()
+{
+    SizeClass* classes = getClasses();
+    for (unsigned i = 0; i < NUM_CLASSES; ++i)
+    {
+        std::vector<void*> blocks;
+        {
+            Threading::ScopedMutexLock lock(classes[i]._mutex);
+            blocks.swap(classes[i]._free);
+        }
+        for (void* ptr : blocks)
+            ::operator delete(ptr);
+    }
+}
@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/PagedNode>
+#include <osgEarth/PagingBudget>
 #include <osgEarth/Utils>
 #include <osgEarth/GLUtils>
 #include <osgEarth/NodeUtils>
@@ -24,6 +25,7 @@
 #include <osgEarth/Registry>
 
 #include <osgDB/Registry>
+#include <osg/KdTree>
 #include <osgDB/FileNameUtils>
 
 #define LC "[PagedNode] "
@@ -180,12 +182,15 @@ PagedNode2::PagedNode2() :
     _compileTriggered(false),
     _mergeTriggered(false),
     _merged(false),
+    _kdTreesBuilt(false),
     _minRange(0.0f),
     _maxRange(FLT_MAX),
     _minPixels(0.0f),
     _maxPixels(FLT_MAX),
     _useRange(true),
     _priorityScale(1.0f),
+    _screenPriority(0.0f),
+    _uploadBytes(0u),
     _refinePolicy(REFINE_REPLACE),
     _preCompile(true)
 {
@@ -215,11 +220,13 @@ PagedNode2::reset()
     }
     _compiled.abandon();    
     _loaded.abandon();
+    _uploadBytes = 0u;
     _token = nullptr;
     _loadTriggered = false;
     _compileTriggered = false;
     _mergeTriggered = false;
     _merged = false;
+    _kdTreesBuilt = false;
 
     // prevents a node in the PagingManager's merge queue from 
     // being merged with old data.
@@ -251,6 +258,13 @@ PagedNode2::traverse(osg::NodeVisitor& nv)
     {
         bool inRange = false;
         float priority = 0.0f;
+        float pixels = 0.0f;
+
+        osg::CullStack* cullStack = nv.asCullStack();
+        if (cullStack != nullptr && cullStack->getLODScale() > 0.0f)
+        {
+            pixels = cullStack->clampedPixelSize(getBound()) / cullStack->getLODScale();
+        }
 
         if (_useRange) // meters
         {
@@ -260,56 +274,65 @@ PagedNode2::traverse(osg::NodeVisitor& nv)
         }
         else // pixels
         {
-            osg::CullStack* cullStack = nv.asCullStack();
             if (cullStack != nullptr && cullStack->getLODScale() > 0.0f)
             {
-                float pixels = cullStack->clampedPixelSize(getBound()) / cullStack->getLODScale();
                 inRange = (pixels >= _minPixels && pixels <= _maxPixels);
                 priority = pixels * _priorityScale;
             }
         }
 
+        // the paging budget compares everyone in screen space
+        _screenPriority = pixels * _priorityScale;
+
         // check that range > 0 to avoid trouble from some visitors
         if (inRange)
         {
-            if (_load != nullptr && 
-                _loadTriggered.exchange(true) == false)
+            if (_load != nullptr && _loadTriggered == false)
             {
-                // Load the asynchronous node.
-                Loader load(_load);
-                osg::ref_ptr<SceneGraphCallbacks> callbacks(_callbacks);
-                bool preCompile = _preCompile;
+                // Wait for room in the paging budget before loading
+                unsigned frame = nv.getFrameStamp() ? nv.getFrameStamp()->getFrameNumber() : 0u;
+                PagingBudget::TicketPtr ticket = PagingBudget::instance()->startJob(frame, _screenPriority);
 
-                _job.setPriority(priority);
+                if (ticket != nullptr && _loadTriggered.exchange(true) == false)
+                {
+                    // Load the asynchronous node.
+                    Loader load(_load);
+                    osg::ref_ptr<SceneGraphCallbacks> callbacks(_callbacks);
+                    bool preCompile = _preCompile;
 
-                _loaded = _job.dispatch<Loaded>(
-                    [load, callbacks, preCompile](Cancelable* c)
-                    {
-                        Loaded result;
+                    _job.setPriority(priority);
 
-                        osg::ref_ptr<ProgressCallback> progress = new ProgressCallback(c);
+                    _loaded = _job.dispatch<Loaded>(
+                        [load, callbacks, preCompile, ticket](Cancelable* c)
+                        {
+                            Loaded result;
 
-                        // invoke the loader function
-                        result._node = load(progress.get());
+                            osg::ref_ptr<ProgressCallback> progress = new ProgressCallback(c);
 
-                        // Fire any pre-merge callbacks
-                        if (result._node.valid())
-                        {
-                            if (callbacks.valid())
-                                callbacks->firePreMergeNode(result._node.get());
+                            // invoke the loader function
+                            result._node = load(progress.get());
 
-                            if (preCompile)
+                            // Fire any pre-merge callbacks
+                            if (result._node.valid())
                             {
+                                if (callbacks.valid())
+                                    callbacks->firePreMergeNode(result._node.get());
+
                                 // Collect the GL objects for later compilation.
                                 // Don't waste precious ICO time doing this later
                                 GLObjectsCompiler compiler;
-                                result._state = compiler.collectState(result._node.get());
+                                osg::ref_ptr<osgUtil::StateToCompile> state = compiler.collectState(result._node.get());
+
+                                if (preCompile)
+                                    result._state = state;
+                                else if (state.valid())
+                                    result._uploadBytes = PagingBudget::estimateUploadBytes(*state.get());
                             }
-                        }
 
-                        return result;
-                    }
-                );
+                            return result;
+                        }
+                    );
+                }
             }
 
             else if (
@@ -319,6 +342,8 @@ PagedNode2::traverse(osg::NodeVisitor& nv)
             {
                 dirtyBound();
 
+                _uploadBytes = _loaded.get()._uploadBytes;
+
                 if (_preCompile)
                 {
                     // Compile the loaded node.
@@ -357,6 +382,19 @@ PagedNode2::traverse(osg::NodeVisitor& nv)
                 _pagingManager->merge(this);
             }
 
+            // the first intersection against merged data builds KdTrees,
+            // so picking and LOS don't test every triangle from then on
+            if (_merged && !_kdTreesBuilt && nv.getVisitorType() == nv.INTERSECTION_VISITOR)
+            {
+                ScopedMutexLock lock(_mutex);
+                if (!_kdTreesBuilt)
+                {
+                    osg::KdTreeBuilder builder;
+                    _compiled.get()->accept(builder);
+                    _kdTreesBuilt = true;
+                }
+            }
+
             // finally, traverse children and paged data.
             if (_merged && _refinePolicy == REFINE_REPLACE)
             {
@@ -495,13 +533,19 @@ PagingManager::traverse(osg::NodeVisitor& nv)
         {
             ScopedMutexLock lock(_mergeMutex);
 
+            unsigned frame = nv.getFrameStamp() ? nv.getFrameStamp()->getFrameNumber() : 0u;
+
             unsigned count = 0u;
             while (_mergeQueue.empty() == false && count < _mergesPerFrame)
             {
                 ToMerge& front = _mergeQueue.front();
                 osg::ref_ptr<PagedNode2> next;
-                if (front._node.lock(next))
+                if (front._node.lock(next) && front._revision == next->_revision)
                 {
+                    // share the frame with the terrain and other pagers
+                    if (!PagingBudget::instance()->startMerge(frame, front._uploadBytes, front._priority))
+                        break;
+
                     if (next->merge(front._revision))
                         ++count;
                 }
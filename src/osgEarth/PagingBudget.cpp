@@ -0,0 +1,182 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/PagingBudget>
+#include <osgEarth/Notify>
+#include <osg/Texture>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+#define LC "[PagingBudget] "
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    unsigned envLimit(const char* name)
+    {
+        const char* value = ::getenv(name);
+        return value ? (unsigned)std::strtoul(value, nullptr, 10) : 0u;
+    }
+}
+
+PagingBudget*
+PagingBudget::instance()
+{
+    // never destroyed, since tickets may outlive static destruction
+    static PagingBudget* s_instance = new PagingBudget();
+    return s_instance;
+}
+
+PagingBudget::PagingBudget() :
+    _mutex(OE_MUTEX_NAME),
+    _maxJobs(envLimit("OSGEARTH_PAGING_MAX_JOBS")),
+    _maxMerges(envLimit("OSGEARTH_PAGING_MERGES_PER_FRAME")),
+    _maxBytes(envLimit("OSGEARTH_PAGING_BYTES_PER_FRAME")),
+    _jobsInFlight(0u),
+    _bytesThisFrame(0u)
+{
+    if (_maxJobs > 0u || _maxMerges > 0u || _maxBytes > 0u)
+    {
+        OE_INFO << LC << "jobs in flight=" << _maxJobs
+            << ", merges per frame=" << _maxMerges
+            << ", bytes per frame=" << _maxBytes << std::endl;
+    }
+}
+
+void
+PagingBudget::setMaxJobsInFlight(unsigned value)
+{
+    ScopedMutexLock lock(_mutex);
+    _maxJobs = value;
+}
+
+void
+PagingBudget::setMaxMergesPerFrame(unsigned value)
+{
+    ScopedMutexLock lock(_mutex);
+    _maxMerges = value;
+}
+
+void
+PagingBudget::setMaxBytesPerFrame(unsigned value)
+{
+    ScopedMutexLock lock(_mutex);
+    _maxBytes = value;
+}
+
+void
+PagingBudget::Gate::advance(unsigned frame, unsigned capacity)
+{
+    if (frame == _frame)
+        return;
+
+    // Let in as many of last frame's rejects as there is room for now;
+    // anything newer has to beat the worst of them.
+    if (capacity > 0u && _denied.size() > capacity)
+    {
+        std::nth_element(_denied.begin(), _denied.begin() + (capacity - 1u), _denied.end(), std::greater<float>());
+        _threshold = _denied[capacity - 1u];
+    }
+    else
+    {
+        _threshold = -FLT_MAX;
+    }
+
+    _denied.clear();
+    _used = 0u;
+    _frame = frame;
+}
+
+PagingBudget::TicketPtr
+PagingBudget::startJob(unsigned frame, float priority)
+{
+    ScopedMutexLock lock(_mutex);
+
+    if (_maxJobs > 0u)
+    {
+        unsigned capacity = _jobsInFlight < _maxJobs ? _maxJobs - _jobsInFlight : 0u;
+        _jobs.advance(frame, capacity);
+
+        if (_jobsInFlight >= _maxJobs || priority < _jobs._threshold)
+        {
+            _jobs._denied.push_back(priority);
+            return nullptr;
+        }
+    }
+
+    ++_jobsInFlight;
+    return TicketPtr(new Ticket(this));
+}
+
+void
+PagingBudget::finishJob()
+{
+    ScopedMutexLock lock(_mutex);
+    if (_jobsInFlight > 0u)
+        --_jobsInFlight;
+}
+
+PagingBudget::Ticket::~Ticket()
+{
+    _budget->finishJob();
+}
+
+bool
+PagingBudget::startMerge(unsigned frame, unsigned bytes, float priority)
+{
+    ScopedMutexLock lock(_mutex);
+
+    if (frame != _merges._frame)
+        _bytesThisFrame = 0u;
+
+    _merges.advance(frame, _maxMerges);
+
+    bool allowed =
+        (_maxMerges == 0u || _merges._used < _maxMerges) &&
+        (_maxBytes == 0u || _merges._used == 0u || _bytesThisFrame + bytes <= _maxBytes) &&
+        (priority >= _merges._threshold);
+
+    if (!allowed)
+    {
+        _merges._denied.push_back(priority);
+        return false;
+    }
+
+    ++_merges._used;
+    _bytesThisFrame += bytes;
+    return true;
+}
+
+unsigned
+PagingBudget::estimateUploadBytes(const osgUtil::StateToCompile& state)
+{
+    unsigned total = 0u;
+    for (auto& texture : state._textures)
+    {
+        for (unsigned i = 0; i < texture->getNumImages(); ++i)
+        {
+            const osg::Image* image = texture->getImage(i);
+            if (image)
+                total += image->getTotalSizeInBytesIncludingMipmaps();
+        }
+    }
+    return total;
+}
@@ -0,0 +1,603 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/PointCloudNode>
+#include <osgEarth/FeatureCursor>
+#include <osgEarth/Feature>
+#include <osgEarth/Color>
+#include <osgEarth/CullingUtils>
+#include <osgEarth/GLUtils>
+#include <osgEarth/NodeUtils>
+#include <osgEarth/Metrics>
+#include <osgUtil/CullVisitor>
+#include <fstream>
+#include <queue>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+#define LC "[PointCloudNode] "
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+namespace
+{
+    // Cells this deep keep all their points, so that piles of
+    // coincident points can't recurse forever
+    const unsigned MAX_DEPTH = 24u;
+
+    const char     FILE_MAGIC[4] = { 'O', 'E', 'P', 'C' };
+    const unsigned FILE_VERSION = 1u;
+
+    // one point in a binary point file
+    struct FileRecord
+    {
+        float x, y, z;
+        unsigned char r, g, b, a;
+    };
+
+    typedef PointCloudNode::Cell Cell;
+
+    struct CellBuilder
+    {
+        const std::vector<osg::Vec3f>& _points;
+        const std::vector<osg::Vec4ub>& _colors;
+        osg::Vec4 _color;
+        unsigned _maxPoints;
+        Cancelable* _progress;
+
+        CellBuilder(
+            const std::vector<osg::Vec3f>& points,
+            const std::vector<osg::Vec4ub>& colors,
+            const osg::Vec4& color,
+            unsigned maxPoints,
+            Cancelable* progress) :
+            _points(points), _colors(colors), _color(color), _maxPoints(maxPoints), _progress(progress) { }
+
+        // Builds the cell for a cube. Consumes the indices.
+        Cell* build(std::vector<unsigned>& indices, const osg::BoundingBoxf& box, unsigned depth)
+        {
+            if (_progress && _progress->isCanceled())
+                return NULL;
+
+            float size = box.xMax() - box.xMin();
+            osg::Vec3f center = box.center();
+
+            std::vector<unsigned> keep;
+            std::vector<unsigned> rest[8];
+            float spacing;
+
+            if (indices.size() <= _maxPoints || depth >= MAX_DEPTH)
+            {
+                keep.swap(indices);
+                spacing = size / osg::maximum(1.0f, std::cbrt((float)keep.size()));
+            }
+            else
+            {
+                // keep the first point in each cell of a regular grid, which
+                // gives an evenly spaced sample; the rest go to the children.
+                unsigned res = (unsigned)std::ceil(std::cbrt((float)_maxPoints));
+                std::vector<bool> taken(res*res*res, false);
+                float toGrid = (float)res / size;
+
+                keep.reserve(_maxPoints);
+                for (unsigned i : indices)
+                {
+                    const osg::Vec3f& p = _points[i];
+                    unsigned x = osg::clampBetween((int)((p.x() - box.xMin())*toGrid), 0, (int)res-1);
+                    unsigned y = osg::clampBetween((int)((p.y() - box.yMin())*toGrid), 0, (int)res-1);
+                    unsigned z = osg::clampBetween((int)((p.z() - box.zMin())*toGrid), 0, (int)res-1);
+                    unsigned k = (x*res + y)*res + z;
+
+                    if (!taken[k] && keep.size() < _maxPoints)
+                    {
+                        taken[k] = true;
+                        keep.push_back(i);
+                    }
+                    else
+                    {
+                        unsigned octant =
+                            (p.x() >= center.x() ? 1 : 0) |
+                            (p.y() >= center.y() ? 2 : 0) |
+                            (p.z() >= center.z() ? 4 : 0);
+                        rest[octant].push_back(i);
+                    }
+                }
+                spacing = size / (float)res;
+            }
+
+            std::vector<unsigned>().swap(indices);
+
+            osg::ref_ptr<Cell> cell = new Cell();
+            cell->_spacing = spacing;
+            cell->_bound = osg::BoundingSphere(box);
+
+            cell->_drawable = new PointDrawable();
+            cell->_drawable->reserve(keep.size());
+            for (unsigned i : keep)
+            {
+                cell->_drawable->pushVertex(_points[i]);
+                if (!_colors.empty())
+                {
+                    const osg::Vec4ub& c = _colors[i];
+                    cell->_drawable->setColor(
+                        cell->_drawable->getNumVerts() - 1,
+                        osg::Vec4(c.r() / 255.0f, c.g() / 255.0f, c.b() / 255.0f, c.a() / 255.0f));
+                }
+                else
+                {
+                    cell->_drawable->setColor(cell->_drawable->getNumVerts() - 1, _color);
+                }
+            }
+            cell->_drawable->setPointAttenuation(spacing);
+            cell->_drawable->finish();
+
+            for (unsigned octant = 0; octant < 8; ++octant)
+            {
+                if (rest[octant].empty())
+                    continue;
+
+                osg::BoundingBoxf childBox(
+                    (octant & 1) ? center.x() : box.xMin(),
+                    (octant & 2) ? center.y() : box.yMin(),
+                    (octant & 4) ? center.z() : box.zMin(),
+                    (octant & 1) ? box.xMax() : center.x(),
+                    (octant & 2) ? box.yMax() : center.y(),
+                    (octant & 4) ? box.zMax() : center.z());
+
+                Cell* child = build(rest[octant], childBox, depth + 1);
+                if (!child)
+                    return NULL;
+
+                cell->_children.push_back(child);
+            }
+
+            return cell.release();
+        }
+    };
+
+    void forEachCell(PointCloudNode::Cell* cell, const std::function<void(PointCloudNode::Cell*)>& func)
+    {
+        func(cell);
+        for (auto& child : cell->_children)
+            forEachCell(child.get(), func);
+    }
+}
+
+//...................................................................
+
+PointCloudNode::PointCloudNode() :
+    _maxPointsPerCell(16384u),
+    _maxScreenSpaceError(2.0f),
+    _pointBudget(5000000u),
+    _pointSize(4.0f),
+    _pointSmooth(false),
+    _color(1, 1, 1, 1),
+    _numPoints(0u)
+{
+    GLUtils::setPointSize(getOrCreateStateSet(), _pointSize, osg::StateAttribute::ON);
+
+    // to install finished octrees
+    ADJUST_UPDATE_TRAV_COUNT(this, +1);
+}
+
+PointCloudNode::~PointCloudNode()
+{
+    //nop
+}
+
+void
+PointCloudNode::setMaxPointsPerCell(unsigned value)
+{
+    _maxPointsPerCell = osg::maximum(value, 1u);
+}
+
+void
+PointCloudNode::setPointSize(float value)
+{
+    _pointSize = value;
+    GLUtils::setPointSize(getOrCreateStateSet(), value, osg::StateAttribute::ON);
+}
+
+void
+PointCloudNode::setPointSmooth(bool value)
+{
+    _pointSmooth = value;
+    GLUtils::setPointSmooth(getOrCreateStateSet(), value ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+}
+
+void
+PointCloudNode::setPoints(
+    const std::vector<osg::Vec3d>& points,
+    const std::vector<osg::Vec4ub>* colors)
+{
+    std::vector<osg::Vec4ub> copy;
+    if (colors && colors->size() == points.size())
+        copy = *colors;
+
+    build([points, copy](std::vector<osg::Vec3d>& outPoints, std::vector<osg::Vec4ub>& outColors, Cancelable*)
+    {
+        outPoints = points;
+        outColors = copy;
+        return true;
+    });
+}
+
+void
+PointCloudNode::setFeatureSource(
+    FeatureSource* features,
+    const SpatialReference* mapSRS,
+    const std::string& colorAttribute)
+{
+    osg::ref_ptr<FeatureSource> fs = features;
+    osg::ref_ptr<const SpatialReference> srs = mapSRS;
+
+    build([fs, srs, colorAttribute](std::vector<osg::Vec3d>& points, std::vector<osg::Vec4ub>& colors, Cancelable* progress)
+    {
+        if (!fs.valid() || !srs.valid() || !fs->getFeatureProfile())
+        {
+            OE_WARN << LC << "Feature source is not open" << std::endl;
+            return false;
+        }
+
+        const SpatialReference* featureSRS = fs->getFeatureProfile()->getSRS();
+
+        osg::ref_ptr<FeatureCursor> cursor = fs->createFeatureCursor(Query(), NULL);
+        while (cursor.valid() && cursor->hasMore())
+        {
+            if (progress && progress->isCanceled())
+                return false;
+
+            osg::ref_ptr<Feature> feature = cursor->nextFeature();
+            if (!feature.valid() || !feature->getGeometry())
+                continue;
+
+            osg::Vec4ub color(255, 255, 255, 255);
+            bool hasColor = !colorAttribute.empty() && feature->hasAttr(colorAttribute);
+            if (hasColor)
+            {
+                Color c(feature->getString(colorAttribute));
+                color.set(
+                    (unsigned char)(c.r()*255.0f), (unsigned char)(c.g()*255.0f),
+                    (unsigned char)(c.b()*255.0f), (unsigned char)(c.a()*255.0f));
+            }
+
+            unsigned first = points.size();
+            GeometryIterator parts(feature->getGeometry(), false);
+            while (parts.hasMore())
+            {
+                Geometry* part = parts.next();
+                if (part->isPointSet())
+                {
+                    points.insert(points.end(), part->begin(), part->end());
+                }
+            }
+
+            if (hasColor)
+            {
+                // fill in white for uncolored points that came before
+                colors.resize(first, osg::Vec4ub(255, 255, 255, 255));
+                colors.resize(points.size(), color);
+            }
+        }
+
+        // to world coordinates
+        if (!featureSRS->transform(points, srs.get()))
+        {
+            OE_WARN << LC << "Failed to transform some points to the map SRS" << std::endl;
+        }
+        osg::Vec3d world;
+        for (auto& p : points)
+        {
+            if (srs->transformToWorld(p, world))
+                p = world;
+        }
+
+        if (!colors.empty())
+            colors.resize(points.size(), osg::Vec4ub(255, 255, 255, 255));
+
+        return true;
+    });
+}
+
+void
+PointCloudNode::setURL(const URI& uri)
+{
+    build([uri](std::vector<osg::Vec3d>& points, std::vector<osg::Vec4ub>& colors, Cancelable* progress)
+    {
+        // note: assumes a little-endian host, like the file
+        std::ifstream in(uri.full().c_str(), std::ios::binary);
+        if (!in.is_open())
+        {
+            OE_WARN << LC << "Failed to open " << uri.full() << std::endl;
+            return false;
+        }
+
+        char magic[4];
+        unsigned version = 0u;
+        unsigned long long count = 0ull;
+        double origin[3];
+
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        in.read(reinterpret_cast<char*>(origin), sizeof(origin));
+
+        if (!in.good() || ::memcmp(magic, FILE_MAGIC, 4) != 0 || version != FILE_VERSION)
+        {
+            OE_WARN << LC << uri.full() << " is not a point cloud file" << std::endl;
+            return false;
+        }
+
+        points.reserve(count);
+        colors.reserve(count);
+
+        std::vector<FileRecord> chunk(65536);
+        while (points.size() < count)
+        {
+            if (progress && progress->isCanceled())
+                return false;
+
+            std::size_t n = (std::size_t)osg::minimum((unsigned long long)chunk.size(), count - points.size());
+            in.read(reinterpret_cast<char*>(chunk.data()), n * sizeof(FileRecord));
+            if (!in.good())
+            {
+                OE_WARN << LC << uri.full() << " is truncated" << std::endl;
+                break;
+            }
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const FileRecord& r = chunk[i];
+                points.push_back(osg::Vec3d(origin[0] + r.x, origin[1] + r.y, origin[2] + r.z));
+                colors.push_back(osg::Vec4ub(r.r, r.g, r.b, r.a));
+            }
+        }
+
+        return true;
+    });
+}
+
+bool
+PointCloudNode::write(
+    const std::string& filename,
+    const std::vector<osg::Vec3d>& points,
+    const std::vector<osg::Vec4ub>* colors)
+{
+    std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    osg::BoundingBoxd box;
+    for (auto& p : points)
+        box.expandBy(p);
+
+    unsigned long long count = points.size();
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    if (box.valid())
+    {
+        origin[0] = box.center().x(), origin[1] = box.center().y(), origin[2] = box.center().z();
+    }
+
+    out.write(FILE_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(&FILE_VERSION), sizeof(FILE_VERSION));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(origin), sizeof(origin));
+
+    bool hasColors = colors && colors->size() == points.size();
+    for (unsigned i = 0; i < points.size(); ++i)
+    {
+        FileRecord r;
+        r.x = (float)(points[i].x() - origin[0]);
+        r.y = (float)(points[i].y() - origin[1]);
+        r.z = (float)(points[i].z() - origin[2]);
+        osg::Vec4ub c = hasColors ? (*colors)[i] : osg::Vec4ub(255, 255, 255, 255);
+        r.r = c.r(), r.g = c.g(), r.b = c.b(), r.a = c.a();
+        out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+    }
+
+    return out.good();
+}
+
+void
+PointCloudNode::build(const std::function<bool(std::vector<osg::Vec3d>&, std::vector<osg::Vec4ub>&, Cancelable*)>& reader)
+{
+    unsigned maxPoints = _maxPointsPerCell;
+    osg::Vec4 color = _color;
+
+    // replacing the future cancels any build still running
+    _pending = Job(JobArena::get("oe.pointcloud")).dispatch<Octree>(
+        [reader, maxPoints, color](Cancelable* progress)
+        {
+            OE_PROFILING_ZONE_NAMED("PointCloudNode::build");
+
+            Octree result;
+
+            std::vector<osg::Vec3d> worldPoints;
+            std::vector<osg::Vec4ub> colors;
+            if (!reader(worldPoints, colors, progress) || worldPoints.empty())
+                return result;
+
+            if (!colors.empty() && colors.size() != worldPoints.size())
+                colors.clear();
+
+            // work in single precision around the middle of the cloud
+            osg::BoundingBoxd worldBox;
+            for (auto& p : worldPoints)
+                worldBox.expandBy(p);
+
+            osg::Vec3d origin = worldBox.center();
+            result._localToWorld.makeTranslate(origin);
+
+            std::vector<osg::Vec3f> points(worldPoints.size());
+            osg::BoundingBoxf box;
+            for (unsigned i = 0; i < worldPoints.size(); ++i)
+            {
+                points[i] = worldPoints[i] - origin;
+                box.expandBy(points[i]);
+            }
+            std::vector<osg::Vec3d>().swap(worldPoints);
+
+            // octree cells are cubes
+            float half = 0.5f * osg::maximum(
+                box.xMax() - box.xMin(),
+                osg::maximum(box.yMax() - box.yMin(), box.zMax() - box.zMin()));
+            half = osg::maximum(half, 1e-3f) * 1.001f;
+            osg::Vec3f c = box.center();
+            osg::BoundingBoxf cube(c - osg::Vec3f(half, half, half), c + osg::Vec3f(half, half, half));
+
+            std::vector<unsigned> indices(points.size());
+            for (unsigned i = 0; i < indices.size(); ++i)
+                indices[i] = i;
+
+            CellBuilder builder(points, colors, color, maxPoints, progress);
+            result._root = builder.build(indices, cube, 0u);
+            if (result._root.valid())
+            {
+                result._numPoints = points.size();
+                OE_INFO << LC << "Built octree for " << points.size() << " points" << std::endl;
+            }
+
+            return result;
+        });
+}
+
+void
+PointCloudNode::traverse(osg::NodeVisitor& nv)
+{
+    if (nv.getVisitorType() == nv.UPDATE_VISITOR)
+    {
+        if (_pending.isAvailable())
+        {
+            Octree octree = _pending.get();
+            _pending.abandon();
+
+            _root = octree._root;
+            _localToWorld = octree._localToWorld;
+            _numPoints = octree._numPoints;
+            dirtyBound();
+        }
+    }
+
+    else if (nv.getVisitorType() == nv.CULL_VISITOR && _root.valid())
+    {
+        osgUtil::CullVisitor* cv = Culling::asCullVisitor(nv);
+        if (cv)
+            cull(cv);
+    }
+
+    osg::Group::traverse(nv);
+}
+
+void
+PointCloudNode::cull(osgUtil::CullVisitor* cv)
+{
+    OE_PROFILING_ZONE;
+
+    osg::ref_ptr<osg::RefMatrix> mv = new osg::RefMatrix(*cv->getModelViewMatrix());
+    mv->preMult(_localToWorld);
+    cv->pushModelViewMatrix(mv.get(), osg::Transform::RELATIVE_RF);
+
+    // pixels covered by one unit at a distance of one
+    const osg::Matrix& proj = *cv->getProjectionMatrix();
+    bool ortho = osg::equivalent(proj(3, 3), 1.0);
+    double height = cv->getViewport() ? cv->getViewport()->height() : 1.0;
+    double pixelScale = 0.5 * height * proj(1, 1) / osg::maximum(cv->getLODScale(), 1e-6f);
+    osg::Vec3 eye = cv->getEyeLocal();
+
+    auto screenSpacing = [&](const Cell* cell)
+    {
+        double pixels = cell->_spacing * pixelScale;
+        if (!ortho)
+        {
+            double d = (cell->_bound.center() - eye).length() - cell->_bound.radius();
+            pixels /= osg::maximum(d, 1e-3);
+        }
+        return pixels;
+    };
+
+    // visit cells in order of on-screen spacing so a tight point budget
+    // still fills the whole view with the coarse levels first
+    typedef std::pair<double, Cell*> Entry;
+    std::priority_queue<Entry> queue;
+    queue.push(Entry(screenSpacing(_root.get()), _root.get()));
+
+    unsigned drawn = 0u;
+    while (!queue.empty())
+    {
+        Entry entry = queue.top();
+        queue.pop();
+
+        Cell* cell = entry.second;
+        if (cv->isCulled(cell->_bound))
+            continue;
+
+        unsigned count = cell->_drawable->getNumVerts();
+        if (_pointBudget > 0u && drawn + count > _pointBudget)
+            break;
+
+        cell->_drawable->accept(*cv);
+        drawn += count;
+
+        if (entry.first > _maxScreenSpaceError)
+        {
+            for (auto& child : cell->_children)
+                queue.push(Entry(screenSpacing(child.get()), child.get()));
+        }
+    }
+
+    cv->popModelViewMatrix();
+}
+
+osg::BoundingSphere
+PointCloudNode::computeBound() const
+{
+    osg::BoundingSphere bs = osg::Group::computeBound();
+    if (_root.valid())
+    {
+        bs.expandBy(osg::BoundingSphere(
+            _root->_bound.center() * _localToWorld,
+            _root->_bound.radius()));
+    }
+    return bs;
+}
+
+void
+PointCloudNode::resizeGLObjectBuffers(unsigned maxSize)
+{
+    osg::Group::resizeGLObjectBuffers(maxSize);
+    if (_root.valid())
+    {
+        forEachCell(_root.get(), [maxSize](Cell* cell) {
+            cell->_drawable->resizeGLObjectBuffers(maxSize);
+        });
+    }
+}
+
+void
+PointCloudNode::releaseGLObjects(osg::State* state) const
+{
+    osg::Group::releaseGLObjects(state);
+    if (_root.valid())
+    {
+        forEachCell(_root.get(), [state](Cell* cell) {
+            cell->_drawable->releaseGLObjects(state);
+        });
+    }
+}
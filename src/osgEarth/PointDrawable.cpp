@@ -306,6 +306,7 @@ _gpu(false),
 _color(1, 1, 1, 1),
 _width(1.0f),
 _smooth(false),
+_attenuation(0.0f),
 _first(0u),
 _count(0u),
 _current(NULL),
@@ -324,6 +325,7 @@ _gpu(rhs._gpu),
 _color(rhs._color),
 _width(rhs._width),
 _smooth(rhs._smooth),
+_attenuation(rhs._attenuation),
 _first(rhs._first),
 _count(rhs._count),
 _current(NULL),
@@ -384,6 +386,26 @@ PointDrawable::setPointSmooth(bool value)
     }
 }
 
+void
+PointDrawable::setPointAttenuation(float value)
+{
+    if (_attenuation != value)
+    {
+        _attenuation = value;
+        osg::StateSet* ss = getOrCreateStateSet();
+        if (_attenuation > 0.0f)
+        {
+            ss->setDefine("OE_POINT_ATTENUATION");
+            ss->getOrCreateUniform("oe_PointDrawable_worldSize", osg::Uniform::FLOAT)->set(_attenuation);
+        }
+        else
+        {
+            ss->removeDefine("OE_POINT_ATTENUATION");
+            ss->removeUniform("oe_PointDrawable_worldSize");
+        }
+    }
+}
+
 void
 PointDrawable::setColor(const osg::Vec4& color)
 {
@@ -3,12 +3,26 @@
 #pragma vp_entryPoint oe_PointDrawable_VS_VIEW
 #pragma vp_location vertex_view
 #pragma vp_order last
+#pragma import_defines(OE_POINT_ATTENUATION)
 
 uniform float oe_GL_PointSize;
 
+#ifdef OE_POINT_ATTENUATION
+uniform vec3 oe_Camera;
+uniform float oe_PointDrawable_worldSize;
+#endif
+
 void oe_PointDrawable_VS_VIEW(inout vec4 vertexView)
 {
+#ifdef OE_POINT_ATTENUATION
+    // project the point's world size; the point size is the upper limit
+    float pixels = oe_PointDrawable_worldSize * 0.5 * oe_Camera.y * gl_ProjectionMatrix[1][1];
+    if (gl_ProjectionMatrix[3][3] == 0.0)
+        pixels /= max(-vertexView.z, 1e-6);
+    gl_PointSize = clamp(pixels, 1.0, oe_GL_PointSize);
+#else
     gl_PointSize = oe_GL_PointSize;
+#endif
 }
 
 [break]
@@ -27,6 +27,7 @@
 #include <osgEarth/GeometryUtils>
 #include <osgEarth/Network>
 #include <osgEarth/Math>
+#include <osgEarth/Containers>
 
 #include <algorithm>
 #include <iterator>
@@ -97,8 +98,10 @@ PowerlineLayer::Options::Options(const ConfigOptions& options)
 void PowerlineLayer::Options::fromConfig(const Config& conf)
 {
     _point_features.init(false);
+    _tileCacheSize.init(64u);
 
     conf.get("point_features", point_features());
+    conf.get("tile_cache_size", tileCacheSize());
     lineSource().get(conf, "line_features");
     FeatureDisplayLayout layout = _layout.get();
     layout.cropFeatures() = true;
@@ -115,6 +118,7 @@ PowerlineLayer::Options::getConfig() const
 {
     Config conf = FeatureModelLayer::Options::getConfig();
     lineSource().set(conf, "line_features");
+    conf.set("tile_cache_size", tileCacheSize());
     for (std::vector<ModelOptions>::const_iterator i = towerModels().begin();
         i != towerModels().end();
         ++i)
@@ -149,6 +153,9 @@ private:
     osg::ref_ptr<StyleSheet> _styles;
     bool _point_features;
     float _maxSag;
+    bool _cacheTiles;
+    // finished tiles by tile key, feature revision and style
+    LRUCache<std::string, osg::ref_ptr<osg::Node> > _tileCache;
 };
 
 PowerlineFeatureNodeFactory::PowerlineFeatureNodeFactory(const PowerlineLayer::Options& options, StyleSheet* styles)
@@ -157,7 +164,9 @@ PowerlineFeatureNodeFactory::PowerlineFeatureNodeFactory(const PowerlineLayer::O
       _lineSource(options.lineSourceEmbeddedOptions().get()),
       _styles(styles),
       _point_features(true),
-      _maxSag(6.0)
+      _maxSag(6.0),
+      _cacheTiles(options.tileCacheSize().get() > 0u),
+      _tileCache(true, options.tileCacheSize().get())
 {
     if (options.towerModels().empty())
         return;
@@ -626,6 +635,9 @@ FeatureList PowerlineFeatureNodeFactory::makeCableFeatures(FeatureList& powerFea
         targetSRS = featureSRS->getGeocentricSRS();
     }
 
+    const SpatialReference* geoSRS = featureSRS->getGeographicSRS();
+    const float tessellationSize = cableStyle.get<LineSymbol>()->tessellationSize()->as(Units::METERS);
+
     for (FeatureList::iterator i = powerFeatures.begin(); i != powerFeatures.end(); ++i)
     {
         Feature* feature = i->get();
@@ -687,8 +699,7 @@ FeatureList PowerlineFeatureNodeFactory::makeCableFeatures(FeatureList& powerFea
                         for (int i = 0; i < cablePoints.size() -1; ++i)
                         {
                             makeCatenary(cablePoints[i], cablePoints[i + 1], towerMats[i], 1.002, _maxSag,
-                                         catenaryPoints,
-                                         cableStyle.get<LineSymbol>()->tessellationSize()->as(Units::METERS));
+                                         catenaryPoints, tessellationSize);
                         }
                         cableSource = &catenaryPoints;
                     }
@@ -696,15 +707,17 @@ FeatureList PowerlineFeatureNodeFactory::makeCableFeatures(FeatureList& powerFea
                     {
                         cableSource = &cablePoints;
                     }
+                    // back to the feature SRS, reprojecting the whole cable in one call
+                    newGeom->reserve(cableSource->size());
                     for (std::vector<osg::Vec3d>::iterator itr = cableSource->begin();
                          itr != cableSource->end();
                          ++itr)
                     {
-                        osg::Vec3d wgs84, mapAttach;
-                        featureSRS->getGeographicSRS()->transformFromWorld(*itr, wgs84);
-                        featureSRS->getGeographicSRS()->transform(wgs84, featureSRS.get(), mapAttach);
-                        newGeom->push_back(mapAttach);
+                        osg::Vec3d wgs84;
+                        geoSRS->transformFromWorld(*itr, wgs84);
+                        newGeom->push_back(wgs84);
                     }
+                    geoSRS->transform(newGeom->asVector(), featureSRS.get());
                     newFeature->setGeometry(newGeom);
                     result.push_back(newFeature);
                 }
@@ -719,6 +732,26 @@ bool PowerlineFeatureNodeFactory::createOrUpdateNode(FeatureCursor* cursor, cons
                                                      osg::ref_ptr<osg::Node>& node,
                                                      const Query& query)
 {
+    // A tile that paged out comes back as it was, unless its features
+    // changed. Indexed tiles are always built, since the index needs
+    // to see each feature.
+    std::string cacheKey;
+    if (_cacheTiles && query.tileKey().isSet() && context.featureIndex() == 0L)
+    {
+        const FeatureSource* source = context.getSession() ? context.getSession()->getFeatureSource() : 0L;
+        cacheKey = Stringify()
+            << query.tileKey()->str() << ':'
+            << (source ? source->getRevision() : 0) << ':'
+            << style.getName();
+
+        LRUCache<std::string, osg::ref_ptr<osg::Node> >::Record record;
+        if (_tileCache.get(cacheKey, record))
+        {
+            node = record.value().get();
+            return true;
+        }
+    }
+
     FilterContext sharedCX = context;
     FeatureList workingSet; 
     cursor->fill(workingSet);
@@ -791,5 +824,12 @@ bool PowerlineFeatureNodeFactory::createOrUpdateNode(FeatureCursor* cursor, cons
     osg::Node* cables = compiler.compile(cableFeatures, cableStyle, localCX);
     results->addChild(cables);
     node = results;
+
+    // a canceled build may be missing features
+    if (!cacheKey.empty() &&
+        (cursor->getProgress() == 0L || !cursor->getProgress()->isCanceled()))
+    {
+        _tileCache.insert(cacheKey, node.get());
+    }
     return true;
 }
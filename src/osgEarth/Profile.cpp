@@ -21,6 +21,8 @@
 #include <osgEarth/Registry>
 #include <osgEarth/TileKey>
 #include <osgEarth/Math>
+#include <osgEarth/Threading>
+#include <unordered_map>
 
 using namespace osgEarth;
 
@@ -327,7 +329,8 @@ Profile::Profile(const SpatialReference* srs,
                  unsigned int numTilesWideAtLod0,
                  unsigned int numTilesHighAtLod0) :
 
-    _extent(srs, xmin, ymin, xmax, ymax)
+    _extent(srs, xmin, ymin, xmax, ymax),
+    _horizID(0u)
 {
     OE_SOFT_ASSERT(srs!=nullptr, __func__);
 
@@ -344,7 +347,8 @@ Profile::Profile(const SpatialReference* srs,
     std::string fullJSON = temp.getConfig().toJSON();
     _fullSignature =  Stringify() << std::hex << hashString(fullJSON);
     temp.vsrsString() = "";
-    _horizSignature = Stringify() << std::hex << hashString( temp.getConfig().toJSON() );
+    _horizSignatureHash = hashString( temp.getConfig().toJSON() );
+    _horizSignature = Stringify() << std::hex << _horizSignatureHash;
 
     _hash = std::hash<std::string>()(fullJSON);
 }
@@ -355,7 +359,8 @@ Profile::Profile(const SpatialReference* srs,
                  unsigned int numTilesWideAtLod0,
                  unsigned int numTilesHighAtLod0 ) :
 
-    _extent(srs, xmin, ymin, xmax, ymax)
+    _extent(srs, xmin, ymin, xmax, ymax),
+    _horizID(0u)
 {
     OE_SOFT_ASSERT(srs!=nullptr, __func__);
 
@@ -371,11 +376,87 @@ Profile::Profile(const SpatialReference* srs,
     std::string fullJSON = temp.getConfig().toJSON();
     _fullSignature =  Stringify() << std::hex << hashString(fullJSON);
     temp.vsrsString() = "";
-    _horizSignature = Stringify() << std::hex << hashString( temp.getConfig().toJSON() );
+    _horizSignatureHash = hashString( temp.getConfig().toJSON() );
+    _horizSignature = Stringify() << std::hex << _horizSignatureHash;
 
     _hash = std::hash<std::string>()(fullJSON);
 }
 
+namespace
+{
+    // Registry of horizontal profile IDs for PackedTileKey. ID zero means
+    // "no profile." The registry holds a reference to the first profile
+    // seen with each signature, so getByHorizID never dangles, and the
+    // lookup table is lock-free so unpacking a key never waits.
+    struct HorizIDRegistry
+    {
+        enum { MAX_IDS = 4096 };
+
+        Threading::Mutex _mutex;
+        std::unordered_map<std::string, unsigned> _ids;
+        std::vector<osg::ref_ptr<const Profile>> _profiles;
+        std::atomic<const Profile*> _byID[MAX_IDS];
+        bool _warned;
+
+        HorizIDRegistry() : _mutex("Profile HorizIDs(OE)"), _warned(false)
+        {
+            for (unsigned i = 0; i < MAX_IDS; ++i)
+                _byID[i] = nullptr;
+        }
+    };
+
+    HorizIDRegistry& horizIDRegistry()
+    {
+        static HorizIDRegistry s_registry;
+        return s_registry;
+    }
+}
+
+unsigned
+Profile::getHorizID() const
+{
+    unsigned id = _horizID;
+    if (id == 0u)
+    {
+        HorizIDRegistry& registry = horizIDRegistry();
+        Threading::ScopedMutexLock lock(registry._mutex);
+
+        auto i = registry._ids.find(_horizSignature);
+        if (i != registry._ids.end())
+        {
+            id = i->second;
+        }
+        else if (registry._profiles.size() + 1 < HorizIDRegistry::MAX_IDS)
+        {
+            registry._profiles.push_back(this);
+            id = (unsigned)registry._profiles.size();
+            registry._byID[id] = this;
+            registry._ids[_horizSignature] = id;
+        }
+        else
+        {
+            if (!registry._warned)
+            {
+                OE_WARN << LC << "Out of horizontal profile IDs; tile keys for "
+                    << toString() << " cannot be packed" << std::endl;
+                registry._warned = true;
+            }
+            return 0u;
+        }
+
+        _horizID = id;
+    }
+    return id;
+}
+
+const Profile*
+Profile::getByHorizID(unsigned id)
+{
+    return id > 0u && id < HorizIDRegistry::MAX_IDS ?
+        horizIDRegistry()._byID[id].load() :
+        nullptr;
+}
+
 Profile::ProfileType
 Profile::getProfileType() const
 {
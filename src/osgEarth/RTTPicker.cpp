@@ -23,6 +23,8 @@
 #include <osgEarth/GLUtils>
 
 #include <osg/BlendFunc>
+#include <algorithm>
+#include <cstring>
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
@@ -54,6 +56,128 @@ namespace
     };
 }
 
+namespace
+{
+    // Picks that never see a readback (e.g., the pick camera isn't being
+    // drawn) give up after this many frames
+    const unsigned MAX_PICK_WAIT_FRAMES = 8u;
+}
+
+struct RTTPicker::Readback : public osg::Camera::DrawCallback
+{
+    Readback(osg::Texture2D* tex) :
+        _tex(tex),
+        _frame(0u),
+        _valid(false)
+    {
+        _image = new osg::Image();
+        _image->allocateImage(tex->getTextureWidth(), tex->getTextureHeight(), 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        ::memset(_image->data(), 0, _image->getTotalSizeInBytes());
+    }
+
+    osg::ref_ptr<osg::Texture2D> _tex;
+
+    // latest pixels back from the GPU, and the frame they were drawn in
+    mutable osg::ref_ptr<osg::Image> _image;
+    mutable unsigned _frame;
+    mutable bool _valid;
+    mutable Threading::Mutex _mutex;
+
+    // One in-flight transfer
+    struct Slot
+    {
+        Slot() : _pbo(0), _sync(0), _frame(0u), _pending(false) { }
+        GLuint _pbo;
+        GLsync _sync;
+        unsigned _frame;
+        bool _pending;
+    };
+
+    struct GLObjects
+    {
+        GLObjects() : _next(0u) { }
+        Slot _slots[2];
+        unsigned _next;
+    };
+    mutable osg::buffered_object<GLObjects> _gl;
+
+    void operator () (osg::RenderInfo& renderInfo) const
+    {
+        osg::State* state = renderInfo.getState();
+        osg::GLExtensions* ext = osg::GLExtensions::Get(state->getContextID(), true);
+        GLFunctions& gl = GLFunctions::get(*state);
+        unsigned frame = state->getFrameStamp() ? state->getFrameStamp()->getFrameNumber() : 0u;
+
+        // make the pick texture current so we can read it back
+        state->setActiveTextureUnit(0);
+        state->applyTextureAttribute(0, _tex.get());
+
+        if (!ext->isPBOSupported || !gl.glFenceSync || !gl.glClientWaitSync || !gl.glDeleteSync)
+        {
+            // no asynchronous path; this waits for the GPU
+            Threading::ScopedMutexLock lock(_mutex);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, _image->data());
+            _frame = frame;
+            _valid = true;
+            return;
+        }
+
+        GLObjects& glo = _gl[state->getContextID()];
+
+        // collect finished transfers, oldest first, without waiting
+        for (unsigned k = 0; k < 2; ++k)
+        {
+            Slot& slot = glo._slots[(glo._next + k) % 2];
+            if (!slot._pending)
+                continue;
+
+            GLenum status = gl.glClientWaitSync(slot._sync, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+                break;
+
+            gl.glDeleteSync(slot._sync);
+            slot._sync = 0;
+            slot._pending = false;
+
+            if (status != GL_WAIT_FAILED)
+            {
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+                const void* pixels = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+                if (pixels)
+                {
+                    Threading::ScopedMutexLock lock(_mutex);
+                    ::memcpy(_image->data(), pixels, _image->getTotalSizeInBytes());
+                    _frame = slot._frame;
+                    _valid = true;
+                    ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+                }
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+            }
+        }
+
+        // start this frame's transfer, unless both buffers are still in flight
+        Slot& slot = glo._slots[glo._next];
+        if (!slot._pending)
+        {
+            if (slot._pbo == 0)
+            {
+                ext->glGenBuffers(1, &slot._pbo);
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+                ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, _image->getTotalSizeInBytes(), 0, GL_STREAM_READ);
+            }
+
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot._pbo);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+            slot._sync = gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            slot._frame = frame;
+            slot._pending = true;
+            glo._next = (glo._next + 1) % 2;
+        }
+    }
+};
+
 VirtualProgram* 
 RTTPicker::createRTTProgram()
 {    
@@ -114,16 +238,8 @@ RTTPicker::~RTTPicker()
 osg::Texture2D*
 RTTPicker::getOrCreateTexture(osg::View* view)
 {
+    // the pick camera renders to a texture, so just share it
     PickContext& pc = getOrCreatePickContext(view);
-    if ( !pc._tex.valid() )
-    {
-        pc._tex = new osg::Texture2D( pc._image.get() );
-        pc._tex->setTextureSize(pc._image->s(), pc._image->t());
-        pc._tex->setUnRefImageDataAfterApply(false);
-        pc._tex->setFilter(pc._tex->MIN_FILTER, pc._tex->NEAREST); // no filtering
-        pc._tex->setFilter(pc._tex->MAG_FILTER, pc._tex->NEAREST); // no filtering
-        pc._tex->setMaxAnisotropy(1.0f); // no filtering
-    }
     return pc._tex.get();
 }
 
@@ -171,11 +287,18 @@ RTTPicker::getOrCreatePickContext(osg::View* view)
 
     c._view = view;
 
-    c._image = new osg::Image();
-    c._image->allocateImage(_rttSize, _rttSize, 1, GL_RGBA, GL_UNSIGNED_BYTE);    
-    memset(c._image->data(), 0, _rttSize * _rttSize * 4);
+    c._tex = new osg::Texture2D();
+    c._tex->setTextureSize(_rttSize, _rttSize);
+    c._tex->setInternalFormat(GL_RGBA8);
+    c._tex->setSourceFormat(GL_RGBA);
+    c._tex->setSourceType(GL_UNSIGNED_BYTE);
+    c._tex->setFilter(c._tex->MIN_FILTER, c._tex->NEAREST); // no filtering
+    c._tex->setFilter(c._tex->MAG_FILTER, c._tex->NEAREST); // no filtering
+    c._tex->setMaxAnisotropy(1.0f); // no filtering
+
+    c._readback = new Readback(c._tex.get());
     
-    // Make an RTT camera and bind it to our image.
+    // Make an RTT camera and bind it to our texture.
     // Note: don't use RF_INHERIT_VIEWPOINT because it's unnecessary and
     //       doesn't work with a slave camera anyway
     // Note: NESTED_RENDER mode makes the RTT camera track the clip planes
@@ -189,7 +312,8 @@ RTTPicker::getOrCreatePickContext(osg::View* view)
     c._pickCamera->setViewport( 0, 0, _rttSize, _rttSize );
     c._pickCamera->setRenderOrder( osg::Camera::NESTED_RENDER );
     c._pickCamera->setRenderTargetImplementation( osg::Camera::FRAME_BUFFER_OBJECT );
-    c._pickCamera->attach( osg::Camera::COLOR_BUFFER0, c._image.get() );
+    c._pickCamera->attach( osg::Camera::COLOR_BUFFER0, c._tex.get() );
+    c._pickCamera->setPostDrawCallback( c._readback.get() );
     c._pickCamera->setSmallFeatureCullingPixelSize( -1.0f );
     c._pickCamera->setCullMask( _cullMask );
 
@@ -282,6 +406,12 @@ RTTPicker::pick(osg::View* view, float mouseX, float mouseY)
 
 bool
 RTTPicker::pick(osg::View* view, float mouseX, float mouseY, Callback* callback)
+{
+    return pick(view, std::vector<osg::Vec2f>(1, osg::Vec2f(mouseX, mouseY)), callback);
+}
+
+bool
+RTTPicker::pick(osg::View* view, const std::vector<osg::Vec2f>& mouseXY, Callback* callback)
 {
     if ( !view )
         return false;
@@ -298,12 +428,20 @@ RTTPicker::pick(osg::View* view, float mouseX, float mouseY, Callback* callback)
     if ( !vp )
         return false;
 
-    // normalize the input cooridnates [0..1]
-    float u = (mouseX - (float)vp->x())/(float)vp->width();
-    float v = (mouseY - (float)vp->y())/(float)vp->height();
+    std::vector<osg::Vec2f> uv;
+    uv.reserve(mouseXY.size());
+    for (auto& mouse : mouseXY)
+    {
+        // normalize the input cooridnates [0..1]
+        float u = (mouse.x() - (float)vp->x())/(float)vp->width();
+        float v = (mouse.y() - (float)vp->y())/(float)vp->height();
 
-    // check the bounds:
-    if ( u < 0.0f || u >= 1.0f || v < 0.0f || v >= 1.0f )
+        // check the bounds:
+        if ( u >= 0.0f && u < 1.0f && v >= 0.0f && v < 1.0f )
+            uv.push_back(osg::Vec2f(u, v));
+    }
+
+    if ( uv.empty() )
         return false;
 
     // install the RTT pick camera under this view's camera if it's not already:
@@ -312,8 +450,7 @@ RTTPicker::pick(osg::View* view, float mouseX, float mouseY, Callback* callback)
     // Create a new pick
     Pick pick;
     pick._context  = &context;
-    pick._u        = u;
-    pick._v        = v;
+    pick._uv       = uv;
     pick._callback = callbackToUse;
     pick._frame    = view->getFrameStamp() ? view->getFrameStamp()->getFrameNumber() : 0u;
    
@@ -425,42 +562,69 @@ namespace
 bool
 RTTPicker::checkForPickResult(Pick& pick, unsigned frameNumber)
 {
-    // decode the results
-    osg::Image* image = pick._context->_image.get();
-    ImageUtils::PixelReader read( image );
-
-    // uncomment to see the RTT image.
-    //osg::ref_ptr<osgDB::Options> o = new osgDB::Options();
-    //osgDB::writeImageFile(*image, "out.tif", o.get());
-
-    bool hit = false;
-    osg::Vec4f value;
-    SpiralIterator iter(image->s(), image->t(), osg::maximum(_buffer,1), pick._u, pick._v);
-    while (iter.next() && (hit == false))
+    Readback* readback = pick._context->_readback.get();
+
+    std::vector<ObjectID> hits;
+    bool haveNewPixels = false;
+    unsigned pixelFrame = 0u;
     {
-        read(value, iter.s(), iter.t());
+        Threading::ScopedMutexLock lock(readback->_mutex);
 
-        ObjectID id = (ObjectID)(
-            ((unsigned)(value.r()*255.0) << 24) +
-            ((unsigned)(value.g()*255.0) << 16) +
-            ((unsigned)(value.b()*255.0) <<  8) +
-            ((unsigned)(value.a()*255.0)));
+        // only pixels drawn since the pick was queued can answer it
+        haveNewPixels = readback->_valid && readback->_frame >= pick._frame;
+        pixelFrame = readback->_frame;
 
-        if ( id > 0 )
+        if (haveNewPixels)
         {
-            pick._callback->onHit( id );
-            hit = true;
+            // decode the results
+            osg::Image* image = readback->_image.get();
+            ImageUtils::PixelReader read( image );
+
+            // uncomment to see the RTT image.
+            //osg::ref_ptr<osgDB::Options> o = new osgDB::Options();
+            //osgDB::writeImageFile(*image, "out.tif", o.get());
+
+            osg::Vec4f value;
+            for (auto& uv : pick._uv)
+            {
+                SpiralIterator iter(image->s(), image->t(), osg::maximum(_buffer,1), uv.x(), uv.y());
+                while (iter.next())
+                {
+                    read(value, iter.s(), iter.t());
+
+                    ObjectID id = (ObjectID)(
+                        ((unsigned)(value.r()*255.0) << 24) +
+                        ((unsigned)(value.g()*255.0) << 16) +
+                        ((unsigned)(value.b()*255.0) <<  8) +
+                        ((unsigned)(value.a()*255.0)));
+
+                    if ( id > 0 )
+                    {
+                        if (std::find(hits.begin(), hits.end(), id) == hits.end())
+                            hits.push_back(id);
+                        break;
+                    }
+                }
+            }
         }
     }
 
+    // callbacks run outside the lock
+    for (auto id : hits)
+    {
+        pick._callback->onHit( id );
+    }
+
+    bool hit = !hits.empty();
+
     // A pick expires if (a) it registers a hit, or (b) is registers a miss
-    // for 2 frames in a row. Why 2? Because the RTT picker itself delays 
-    // pick results by one frame, and the osgEarth draping/clamping systems
-    // also delay drawing by one frame. So we need 2 frames to positively
+    // in 2 rendered frames in a row. Why 2? Because the osgEarth draping/clamping
+    // systems delay drawing by one frame, so we need 2 frames to positively
     // register a hit on draped/clamped geometry.
     bool pickExpired =
         hit == true ||
-        frameNumber - pick._frame >= 2u;
+        (haveNewPixels && pixelFrame >= pick._frame + 1u) ||
+        frameNumber - pick._frame >= MAX_PICK_WAIT_FRAMES;
 
     if ((hit == false) && (pickExpired == true))
     {
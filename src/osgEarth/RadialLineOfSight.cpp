@@ -23,6 +23,8 @@
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/GLUtils>
 
+#define ARENA_RADIAL_LOS "oe.radiallos"
+
 using namespace osgEarth;
 using namespace osgEarth::Contrib;
 
@@ -50,6 +52,16 @@ namespace
         }   
         return center;
     }
+
+    JobArena* getRadialLOSArena()
+    {
+        static JobArena* arena = []()
+        {
+            JobArena::setConcurrency(ARENA_RADIAL_LOS, Threading::getConcurrency());
+            return JobArena::get(ARENA_RADIAL_LOS);
+        }();
+        return arena;
+    }
 }
 
 //------------------------------------------------------------------------
@@ -86,7 +98,9 @@ _outlineColor( 1.0f, 1.0f, 1.0f, 1.0f),
 _displayMode( LineOfSight::MODE_SPLIT ),
 //_altitudeMode( ALTMODE_ABSOLUTE ),
 _fill(false),
-_terrainOnly( false )
+_terrainOnly( false ),
+_spokesDirty( false ),
+_geometryDirty( false )
 {
     //compute(getNode());
     _terrainChangedCallback = new RadialLineOfSightNodeTerrainChangedCallback( this );
@@ -121,7 +135,10 @@ RadialLineOfSightNode::setMapNode( MapNode* mapNode )
             _mapNode->getTerrain()->addTerrainCallback( _terrainChangedCallback.get() );
         }
 
-        compute( getNode() );
+        // spokes still in flight belong to the old map
+        _pendingResults.clear();
+        _pending.reset();
+        dirtySpokes();
     }
 }
 
@@ -137,7 +154,7 @@ RadialLineOfSightNode::setFill( bool fill)
     if (_fill != fill)
     {
         _fill = fill;
-        compute(getNode() );
+        dirtyGeometry();
     }
 }
 
@@ -153,7 +170,7 @@ RadialLineOfSightNode::setRadius(double radius)
     if (_radius != radius)
     {
         _radius = osg::clampAbove(radius, 1.0);
-        compute(getNode());
+        dirtySpokes();
     }
 }
 
@@ -168,7 +185,7 @@ void RadialLineOfSightNode::setNumSpokes(int numSpokes)
     if (numSpokes != _numSpokes)
     {
         _numSpokes = osg::clampAbove(numSpokes, 1);
-        compute(getNode());
+        dirtySpokes();
     }
 }
 
@@ -192,7 +209,7 @@ RadialLineOfSightNode::setCenter(const GeoPoint& center)
     if (_center != center)
     {
         _center = center;
-        compute(getNode());
+        dirtySpokes();
     }
 }
 
@@ -207,7 +224,7 @@ void RadialLineOfSightNode::setTerrainOnly( bool terrainOnly )
     if (_terrainOnly != terrainOnly)
     {
         _terrainOnly = terrainOnly;
-        compute(getNode());
+        dirtySpokes();
     }
 }
 
@@ -224,34 +241,99 @@ void
 RadialLineOfSightNode::terrainChanged( const osgEarth::TileKey& tileKey, osg::Node* terrain )
 {
     OE_DEBUG << "RadialLineOfSightNode::terrainChanged" << std::endl;
-    compute( getNode() );    
+
+    // terrain-only spokes come from the elevation data, not the tiles
+    if (_terrainOnly)
+        return;
+
+    // skip tiles that can't reach any of the spokes
+    if (terrain && !_current._spokes.empty())
+    {
+        const osg::BoundingSphere& bs = terrain->getBound();
+        if (bs.valid() && (osg::Vec3d(bs.center()) - _current._centerWorld).length() > bs.radius() + _radius)
+            return;
+    }
+
+    dirtySpokes();
 }
 
 void
-RadialLineOfSightNode::compute(osg::Node* node )
+RadialLineOfSightNode::dirtySpokes()
 {
-    if (_fill)
-    {
-        compute_fill( node );
-    }
-    else
+    _spokesDirty = true;
+}
+
+void
+RadialLineOfSightNode::dirtyGeometry()
+{
+    _geometryDirty = true;
+}
+
+void
+RadialLineOfSightNode::traverse(osg::NodeVisitor& nv)
+{
+    if (nv.getVisitorType() == nv.UPDATE_VISITOR)
     {
-        compute_line( node );
+        // pick up the spokes once every job is done
+        if (!_pendingResults.empty())
+        {
+            bool done = true;
+            bool ok = true;
+            for (auto& result : _pendingResults)
+            {
+                if (result.isAvailable())
+                    ok = ok && result.get();
+                else if (result.isAbandoned())
+                    ok = false;
+                else
+                    done = false;
+            }
+
+            if (done)
+            {
+                if (ok)
+                {
+                    _current = std::move(*_pending);
+                    _geometryDirty = true;
+                }
+                _pendingResults.clear();
+                _pending.reset();
+            }
+        }
+
+        // a change that comes in while jobs are running waits for them,
+        // so a moving center still shows results along the way
+        if (_spokesDirty && _pendingResults.empty())
+        {
+            _spokesDirty = false;
+            compute(getNode());
+        }
+
+        if (_geometryDirty)
+        {
+            _geometryDirty = false;
+            buildGeometry();
+        }
     }
+
+    LineOfSightNode::traverse(nv);
 }
 
 void
-RadialLineOfSightNode::compute_line(osg::Node* node)
-{    
+RadialLineOfSightNode::compute(osg::Node* node )
+{
     if ( !getMapNode() )
         return;
 
+    std::shared_ptr<SpokeSet> set = std::make_shared<SpokeSet>();
+
     GeoPoint centerMap;
-    _center.transform( getMapNode()->getMapSRS(), centerMap );
-    centerMap.toWorld( _centerWorld, getMapNode()->getTerrain() );
+    if (!_center.transform( getMapNode()->getMapSRS(), centerMap ))
+        return;
+    centerMap.toWorld( set->_centerWorld, getMapNode()->getTerrain() );
 
     bool isProjected = getMapNode()->getMapSRS()->isProjected();
-    osg::Vec3d up = isProjected ? osg::Vec3d(0,0,1) : osg::Vec3d(_centerWorld);
+    osg::Vec3d up = isProjected ? osg::Vec3d(0,0,1) : osg::Vec3d(set->_centerWorld);
     up.normalize();
 
     //Get the "side" vector
@@ -259,31 +341,82 @@ RadialLineOfSightNode::compute_line(osg::Node* node)
 
     //Get the number of spokes
     double delta = osg::PI * 2.0 / (double)_numSpokes;
-    
-    osg::Geometry* geometry = new osg::Geometry;
-    geometry->setUseVertexBufferObjects(true);
 
-    osg::Vec3Array* verts = new osg::Vec3Array();
-    verts->reserve(_numSpokes * 5);
-    geometry->setVertexArray( verts );
+    set->_spokes.resize(_numSpokes);
 
-    osg::Vec4Array* colors = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX);
-    colors->reserve( _numSpokes * 5 );
+    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+    {
+        double angle = delta * (double)i;
+        osg::Quat quat(angle, up );
+        osg::Vec3d spoke = quat * (side * _radius);
+        set->_spokes[i]._end = set->_centerWorld + spoke;
+    }
 
-    geometry->setColorArray( colors );
+    if (_terrainOnly)
+    {
+        dispatchSpokes(set);
+    }
+    else
+    {
+        computeSpokes(node, *set);
+        _current = std::move(*set);
+        _geometryDirty = true;
+    }
+}
 
-    osg::Vec3d previousEnd;
-    osg::Vec3d firstEnd;
+void
+RadialLineOfSightNode::dispatchSpokes(std::shared_ptr<SpokeSet> set)
+{
+    // Terrain only: march the spokes through the elevation data,
+    // which is much faster than intersecting the terrain geometry
+    // and safe to do off the update thread.
+    const Map* map = getMapNode()->getMap();
+    if (!_pyramid.valid() || _pyramid->getMap() != map)
+        _pyramid = new ElevationPyramid(map);
+
+    osg::ref_ptr<ElevationPyramid> pyramid = _pyramid;
+    Distance resolution(osg::maximum(_radius / 512.0, 1.0), Units::METERS);
+
+    // one chunk of spokes per thread
+    unsigned numSpokes = set->_spokes.size();
+    unsigned numChunks = osg::clampBetween(Threading::getConcurrency(), 1u, numSpokes);
+    unsigned chunkSize = (numSpokes + numChunks - 1) / numChunks;
+
+    _pending = set;
+
+    for (unsigned begin = 0; begin < numSpokes; begin += chunkSize)
+    {
+        unsigned end = osg::minimum(begin + chunkSize, numSpokes);
+
+        Job job(getRadialLOSArena());
+        job.setName("oe.radiallos.spokes");
+        _pendingResults.push_back(job.dispatch<bool>(
+            [set, pyramid, resolution, begin, end](Cancelable* progress)
+            {
+                for (unsigned i = begin; i < end; ++i)
+                {
+                    if (progress && progress->isCanceled())
+                        return false;
+
+                    Spoke& spoke = set->_spokes[i];
+                    spoke._hasLOS = !pyramid->intersect(set->_centerWorld, spoke._end, resolution, spoke._hit);
+                }
+                return true;
+            }
+        ));
+    }
+}
+
+void
+RadialLineOfSightNode::computeSpokes(osg::Node* node, SpokeSet& set)
+{
+    std::vector<Spoke>& spokes = set._spokes;
 
     osg::ref_ptr<osgUtil::IntersectorGroup> ivGroup = new osgUtil::IntersectorGroup();
 
-    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+    for (unsigned int i = 0; i < spokes.size(); i++)
     {
-        double angle = delta * (double)i;
-        osg::Quat quat(angle, up );
-        osg::Vec3d spoke = quat * (side * _radius);
-        osg::Vec3d end = _centerWorld + spoke;
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> dplsi = new osgUtil::LineSegmentIntersector( _centerWorld, end );
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> dplsi = new osgUtil::LineSegmentIntersector( set._centerWorld, spokes[i]._end );
         ivGroup->addIntersector( dplsi.get() );
     }
 
@@ -292,23 +425,73 @@ RadialLineOfSightNode::compute_line(osg::Node* node)
 
     node->accept( iv );
 
-    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+    for (unsigned int i = 0; i < spokes.size(); i++)
     {
-        osgUtil::LineSegmentIntersector* los = dynamic_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[i].get());
-        if ( !los )
-            continue;
-
+        osgUtil::LineSegmentIntersector* los = static_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[i].get());
         osgUtil::LineSegmentIntersector::Intersections& hits = los->getIntersections();
 
-        osg::Vec3d start = los->getStart();
-        osg::Vec3d end = los->getEnd();
-
-        osg::Vec3d hit;
-        bool hasLOS = hits.empty();
-        if (!hasLOS)
+        spokes[i]._hasLOS = hits.empty();
+        if (!spokes[i]._hasLOS)
         {
-            hit = hits.begin()->getWorldIntersectPoint();
+            spokes[i]._hit = hits.begin()->getWorldIntersectPoint();
         }
+    }
+}
+
+void
+RadialLineOfSightNode::buildGeometry()
+{
+    if (_current._spokes.empty())
+        return;
+
+    _centerWorld = _current._centerWorld;
+
+    if (_fill)
+    {
+        compute_fill();
+    }
+    else
+    {
+        compute_line();
+    }
+
+    // only report results that are up to date with the settings
+    if (_spokesDirty || !_pendingResults.empty())
+        return;
+
+    for( LOSChangedCallbackList::iterator i = _changedCallbacks.begin(); i != _changedCallbacks.end(); i++ )
+    {
+        i->get()->onChanged();
+    }
+}
+
+void
+RadialLineOfSightNode::compute_line()
+{
+    const std::vector<Spoke>& spokes = _current._spokes;
+    unsigned int numSpokes = spokes.size();
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setUseVertexBufferObjects(true);
+
+    osg::Vec3Array* verts = new osg::Vec3Array();
+    verts->reserve(numSpokes * 5);
+    geometry->setVertexArray( verts );
+
+    osg::Vec4Array* colors = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX);
+    colors->reserve( numSpokes * 5 );
+
+    geometry->setColorArray( colors );
+
+    osg::Vec3d previousEnd;
+    osg::Vec3d firstEnd;
+
+    for (unsigned int i = 0; i < numSpokes; i++)
+    {
+        osg::Vec3d start = _centerWorld;
+        osg::Vec3d end = spokes[i]._end;
+        osg::Vec3d hit = spokes[i]._hit;
+        bool hasLOS = spokes[i]._hasLOS;
 
         if (hasLOS)
         {
@@ -377,86 +560,40 @@ RadialLineOfSightNode::compute_line(osg::Node* node)
     //Remove all the children
     removeChildren(0, getNumChildren());
     addChild( mt );  
-
-    for( LOSChangedCallbackList::iterator i = _changedCallbacks.begin(); i != _changedCallbacks.end(); i++ )
-    {
-        i->get()->onChanged();
-    }	
 }
 
 void
-RadialLineOfSightNode::compute_fill(osg::Node* node)
+RadialLineOfSightNode::compute_fill()
 {
-    if ( !getMapNode() )
-        return;
-
-    GeoPoint centerMap;
-    _center.transform( getMapNode()->getMapSRS(), centerMap );
-    centerMap.toWorld( _centerWorld, getMapNode()->getTerrain() );
-
-    bool isProjected = getMapNode()->getMapSRS()->isProjected();
+    const std::vector<Spoke>& spokes = _current._spokes;
+    unsigned int numSpokes = spokes.size();
 
-    osg::Vec3d up = isProjected ? osg::Vec3d(0,0,1) : osg::Vec3d(_centerWorld);
-    up.normalize();
-
-    //Get the "side" vector
-    osg::Vec3d side = isProjected ? osg::Vec3d(1,0,0) : up ^ osg::Vec3d(0,0,1);
-
-    //Get the number of spokes
-    double delta = osg::PI * 2.0 / (double)_numSpokes;
-    
     osg::Geometry* geometry = new osg::Geometry;
     geometry->setUseVertexBufferObjects(true);
 
     osg::Vec3Array* verts = new osg::Vec3Array();
-    verts->reserve(_numSpokes * 2);
+    verts->reserve(numSpokes * 2);
     geometry->setVertexArray( verts );
 
     osg::Vec4Array* colors = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX);
-    colors->reserve( _numSpokes * 2 );
+    colors->reserve( numSpokes * 2 );
 
     geometry->setColorArray( colors );
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> ivGroup = new osgUtil::IntersectorGroup();
-
-    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
-    {
-        double angle = delta * (double)i;
-        osg::Quat quat(angle, up );
-        osg::Vec3d spoke = quat * (side * _radius);
-        osg::Vec3d end = _centerWorld + spoke;        
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> dplsi = new osgUtil::LineSegmentIntersector( _centerWorld, end );
-        if (dplsi)
-            ivGroup->addIntersector( dplsi.get() );
-    }
-
-    osgUtil::IntersectionVisitor iv;
-    iv.setIntersector( ivGroup.get() );
-
-    node->accept( iv );
-
-    for (unsigned int i = 0; i < (unsigned int)_numSpokes; i++)
+    for (unsigned int i = 0; i < numSpokes; i++)
     {
         //Get the current hit
-        osgUtil::LineSegmentIntersector* los = dynamic_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[i].get());
-        if ( !los )
-            continue;
-
-        osgUtil::LineSegmentIntersector::Intersections& hits = los->getIntersections();
-
-        osg::Vec3d currEnd = los->getEnd();
-        bool currHasLOS = hits.empty();
-        osg::Vec3d currHit = currHasLOS ? osg::Vec3d() : hits.begin()->getWorldIntersectPoint();
+        osg::Vec3d currEnd = spokes[i]._end;
+        bool currHasLOS = spokes[i]._hasLOS;
+        osg::Vec3d currHit = spokes[i]._hit;
 
         //Get the next hit
         unsigned int nextIndex = i + 1;
-        if (nextIndex == _numSpokes) nextIndex = 0;
-        osgUtil::LineSegmentIntersector* losNext = static_cast<osgUtil::LineSegmentIntersector*>(ivGroup->getIntersectors()[nextIndex].get());
-        osgUtil::LineSegmentIntersector::Intersections& hitsNext = losNext->getIntersections();
+        if (nextIndex == numSpokes) nextIndex = 0;
 
-        osg::Vec3d nextEnd = losNext->getEnd();
-        bool nextHasLOS = hitsNext.empty();
-        osg::Vec3d nextHit = nextHasLOS ? osg::Vec3d() : hitsNext.begin()->getWorldIntersectPoint();
+        osg::Vec3d nextEnd = spokes[nextIndex]._end;
+        bool nextHasLOS = spokes[nextIndex]._hasLOS;
+        osg::Vec3d nextHit = spokes[nextIndex]._hit;
         
         if (currHasLOS && nextHasLOS)
         {
@@ -568,11 +705,6 @@ RadialLineOfSightNode::compute_fill(osg::Node* node)
     //Remove all the children
     removeChildren(0, getNumChildren());
     addChild( mt );  
-
-    for( LOSChangedCallbackList::iterator i = _changedCallbacks.begin(); i != _changedCallbacks.end(); i++ )
-    {
-        i->get()->onChanged();
-    }	
 }
 
 
@@ -582,7 +714,7 @@ RadialLineOfSightNode::setGoodColor( const osg::Vec4f &color )
     if (_goodColor != color)
     {
         _goodColor = color;
-        compute(getNode());
+        dirtyGeometry();
     }
 }
 
@@ -598,7 +730,7 @@ RadialLineOfSightNode::setBadColor( const osg::Vec4f &color )
     if (_badColor != color)
     {
         _badColor = color;
-        compute(getNode());
+        dirtyGeometry();
     }
 }
 
@@ -614,7 +746,7 @@ RadialLineOfSightNode::setOutlineColor( const osg::Vec4f &color )
     if (_outlineColor != color)
     {
         _outlineColor = color;
-        compute(getNode());
+        dirtyGeometry();
     }
 }
 
@@ -636,7 +768,7 @@ RadialLineOfSightNode::setDisplayMode( LineOfSight::DisplayMode displayMode )
     if (_displayMode != displayMode)
     {
         _displayMode = displayMode;
-        compute(getNode());
+        dirtyGeometry();
     }
 }
 
@@ -0,0 +1,248 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/RasterPool>
+#include <osgEarth/Memory>
+#include <osgEarth/Stats>
+#include <osgEarth/Threading>
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[RasterPool] "
+
+namespace
+{
+    struct Storage
+    {
+        Threading::Mutex _mutex;
+        std::unordered_map<std::size_t, std::vector<unsigned char*>> _buffers;
+        std::unordered_map<std::size_t, std::vector<osg::ref_ptr<osg::FloatArray>>> _heights;
+        std::size_t _freeBytes;
+        std::size_t _maxFreeBytes;
+
+        Stats::Counter& _hits;
+        Stats::Counter& _misses;
+
+        Storage() :
+            _mutex("RasterPool(OE)"),
+            _freeBytes(0u),
+            _maxFreeBytes(64u * 1048576u),
+            _hits(Stats::counter("osgearth_raster_pool_hits")),
+            _misses(Stats::counter("osgearth_raster_pool_misses"))
+        {
+            const char* mb = ::getenv("OSGEARTH_RASTER_POOL_MB");
+            if (mb)
+                _maxFreeBytes = (std::size_t)std::max(0, atoi(mb)) * 1048576u;
+        }
+    };
+
+    // never destroyed, so rasters deleted during static
+    // destruction can still return their buffers
+    Storage& storage()
+    {
+        static Storage* s_storage = new Storage();
+        return *s_storage;
+    }
+
+    unsigned char* acquireBuffer(std::size_t bytes)
+    {
+        Storage& s = storage();
+        {
+            Threading::ScopedMutexLock lock(s._mutex);
+            auto i = s._buffers.find(bytes);
+            if (i != s._buffers.end() && !i->second.empty())
+            {
+                unsigned char* buffer = i->second.back();
+                i->second.pop_back();
+                s._freeBytes -= bytes;
+                Memory::add(Memory::OTHER, -(std::int64_t)bytes);
+                s._hits.add();
+                return buffer;
+            }
+        }
+        s._misses.add();
+        return new unsigned char[bytes];
+    }
+
+    void releaseBuffer(unsigned char* buffer, std::size_t bytes)
+    {
+        Storage& s = storage();
+        {
+            Threading::ScopedMutexLock lock(s._mutex);
+            if (s._freeBytes + bytes <= s._maxFreeBytes)
+            {
+                s._buffers[bytes].push_back(buffer);
+                s._freeBytes += bytes;
+                Memory::add(Memory::OTHER, (std::int64_t)bytes);
+                return;
+            }
+        }
+        delete [] buffer;
+    }
+
+    osg::FloatArray* acquireHeights(std::size_t count)
+    {
+        Storage& s = storage();
+        {
+            Threading::ScopedMutexLock lock(s._mutex);
+            auto i = s._heights.find(count);
+            if (i != s._heights.end() && !i->second.empty())
+            {
+                osg::FloatArray* heights = i->second.back().release();
+                i->second.pop_back();
+                s._freeBytes -= count * sizeof(float);
+                Memory::add(Memory::OTHER, -(std::int64_t)(count * sizeof(float)));
+                s._hits.add();
+                return heights;
+            }
+        }
+        s._misses.add();
+        return nullptr;
+    }
+
+    void releaseHeights(osg::FloatArray* heights)
+    {
+        Storage& s = storage();
+        std::size_t bytes = heights->size() * sizeof(float);
+
+        Threading::ScopedMutexLock lock(s._mutex);
+        if (s._freeBytes + bytes <= s._maxFreeBytes)
+        {
+            s._heights[heights->size()].push_back(heights);
+            s._freeBytes += bytes;
+            Memory::add(Memory::OTHER, (std::int64_t)bytes);
+        }
+    }
+
+    // Image that returns its original buffer to the pool. The buffer is
+    // set with NO_DELETE, so osg::Image never frees it. If the image is
+    // reallocated later, the original buffer is returned when it dies.
+    class PooledImage : public osg::Image
+    {
+    public:
+        PooledImage(unsigned char* buffer, std::size_t bytes) :
+            _buffer(buffer), _bytes(bytes) { }
+
+    protected:
+        virtual ~PooledImage()
+        {
+            releaseBuffer(_buffer, _bytes);
+        }
+
+        unsigned char* _buffer;
+        std::size_t _bytes;
+    };
+
+    // Heightfield that returns its height array to the pool, unless
+    // something else still holds a reference to it.
+    class PooledHeightField : public osg::HeightField
+    {
+    public:
+        void setHeights(osg::FloatArray* heights) { _heights = heights; }
+
+    protected:
+        virtual ~PooledHeightField()
+        {
+            if (_heights.valid() && _heights->referenceCount() == 1)
+                releaseHeights(_heights.get());
+        }
+    };
+}
+
+osg::Image*
+RasterPool::createImage(int s, int t, int r, GLenum pixelFormat, GLenum dataType, int packing)
+{
+    std::size_t bytes = osg::Image::computeImageSizeInBytes(s, t, r, pixelFormat, dataType, packing);
+    if (bytes == 0u)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(s, t, r, pixelFormat, dataType, packing);
+        return image;
+    }
+
+    unsigned char* buffer = acquireBuffer(bytes);
+    PooledImage* image = new PooledImage(buffer, bytes);
+    image->setImage(s, t, r, pixelFormat, pixelFormat, dataType, buffer, osg::Image::NO_DELETE, packing);
+    return image;
+}
+
+osg::HeightField*
+RasterPool::createHeightField(unsigned numColumns, unsigned numRows)
+{
+    PooledHeightField* hf = new PooledHeightField();
+
+    osg::FloatArray* heights = acquireHeights(numColumns * numRows);
+    if (heights)
+    {
+        std::fill(heights->begin(), heights->end(), 0.0f);
+        hf->setHeights(heights);
+        hf->allocate(numColumns, numRows); // sizes match, so no resize
+    }
+    else
+    {
+        hf->allocate(numColumns, numRows);
+    }
+    return hf;
+}
+
+std::size_t
+RasterPool::getFreeBytes()
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    return s._freeBytes;
+}
+
+void
+RasterPool::setMaxFreeBytes(std::size_t value)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    s._maxFreeBytes = value;
+}
+
+std::size_t
+RasterPool::getMaxFreeBytes()
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    return s._maxFreeBytes;
+}
+
+void
+RasterPool::trim()
+{
+    Storage& s = storage();
+    std::unordered_map<std::size_t, std::vector<unsigned char*>> buffers;
+    std::unordered_map<std::size_t, std::vector<osg::ref_ptr<osg::FloatArray>>> heights;
+    {
+        Threading::ScopedMutexLock lock(s._mutex);
+        buffers.swap(s._buffers);
+        heights.swap(s._heights);
+        Memory::add(Memory::OTHER, -(std::int64_t)s._freeBytes);
+        s._freeBytes = 0u;
+    }
+    for (auto& i : buffers)
+        for (unsigned char* buffer : i.second)
+            delete [] buffer;
+}
@@ -96,7 +96,7 @@ RectangleNode::setSize( const Linear& width, const Linear& height)
     {
         _width = width;
         _height = height;
-        compile();
+        requestRebuild();
     }
 }
 
@@ -110,7 +110,7 @@ void
 RectangleNode::setStyle( const Style& style )
 {
     _style = style;
-    compile();
+    requestRebuild();
 }
 
 
@@ -347,6 +347,12 @@ RectangleNode::setCorner( Corner corner, const GeoPoint& location)
 }
 
 
+void
+RectangleNode::rebuild()
+{
+    compile();
+}
+
 void
 RectangleNode::compile()
 {    
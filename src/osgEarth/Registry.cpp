@@ -244,9 +244,7 @@ Registry::releaseGLObjects(osg::State* state) const
     }
 
     // Clear out the VirtualProgram shared program repository
-    _programRepo.lock();
     _programRepo.releaseGLObjects(state);
-    _programRepo.unlock();
 }
 
 void
@@ -17,6 +17,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 #include <osgEarth/ResourceCache>
+#include <osgEarth/Registry>
+#include <osgEarth/StateSetCache>
 #include <osg/Texture2D>
 
 using namespace osgEarth;
@@ -56,6 +58,16 @@ ResourceCache::getOrCreateLineTexture(const URI& uri, osg::ref_ptr<osg::Texture>
             tex->setMaxAnisotropy( 4.0f );
             tex->setResizeNonPowerOfTwoHint( false );
             output = tex;
+
+            // different URIs often resolve to the same image
+            StateSetCache* sscache = Registry::stateSetCache();
+            if (sscache)
+            {
+                osg::ref_ptr<osg::StateAttribute> in = tex, shared;
+                if (sscache->share(in, shared))
+                    output = static_cast<osg::Texture*>(shared.get());
+            }
+
             _texCache.insert(uri.full(), output.get());
         }
     }
@@ -93,6 +105,16 @@ ResourceCache::getOrCreateStateSet(SkinResource*                skin,
             output = skin->createStateSet(readOptions);
             if ( output.valid() )
             {
+                // intern it so skins that resolve to the same state,
+                // across all layers, draw with a single stateset
+                StateSetCache* sscache = Registry::stateSetCache();
+                if (sscache)
+                {
+                    osg::ref_ptr<osg::StateSet> shared;
+                    if (sscache->share(output, shared))
+                        output = shared.get();
+                }
+
                 _skinCache.insert( key, output.get() );
             }
         }
@@ -19,6 +19,7 @@
 #include <osgEarth/ResourceReleaser>
 #include <osgEarth/Metrics>
 #include <osgEarth/StringUtils>
+#include <osg/Timer>
 #if OSG_VERSION_GREATER_OR_EQUAL(3,5,0)
 #include <osg/ContextData>
 #endif
@@ -30,7 +31,8 @@ using namespace osgEarth::Util;
 
 
 ResourceReleaser::ResourceReleaser() :
-    _mutex("ResourceReleaser(OE)")
+    _mutex("ResourceReleaser(OE)"),
+    _maxReleaseTime(2.0)
 {
     // ensure this node always gets traversed:
     this->setCullingActive(false);
@@ -60,14 +62,27 @@ ResourceReleaser::push(const ObjectList& objects)
         _toRelease.push_back(objects[i].get());
 }
 
+unsigned
+ResourceReleaser::getNumPending() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _toRelease.size();
+}
+
 void
 ResourceReleaser::drawImplementation(osg::RenderInfo& ri) const
 {
-    releaseGLObjects(ri.getState());
+    release(ri.getState(), _maxReleaseTime);
 }
 
 void
 ResourceReleaser::releaseGLObjects(osg::State* state) const
+{
+    release(state, 0.0);
+}
+
+void
+ResourceReleaser::release(osg::State* state, double maxTime) const
 {
     OE_PROFILING_ZONE;
     if (!_toRelease.empty())
@@ -75,14 +90,25 @@ ResourceReleaser::releaseGLObjects(osg::State* state) const
         Threading::ScopedMutexLock lock(_mutex);
         if (!_toRelease.empty())
         {
-            for (ObjectList::const_iterator i = _toRelease.begin(); i != _toRelease.end(); ++i)
+            const osg::Timer* timer = osg::Timer::instance();
+            osg::Timer_t start = timer->tick();
+
+            // oldest first; always release at least one so the queue drains
+            ObjectList::iterator i = _toRelease.begin();
+            do
             {
-                osg::Object* object = i->get();
-                object->releaseGLObjects(state);
+                (*i)->releaseGLObjects(state);
+                ++i;
             }
-            OE_PROFILING_ZONE_TEXT(Stringify() << "Released " << _toRelease.size());
-            OE_DEBUG << LC << "Released " << _toRelease.size() << " objects\n";
-            _toRelease.clear();
+            while (
+                i != _toRelease.end() &&
+                (maxTime <= 0.0 || timer->delta_m(start, timer->tick()) < maxTime));
+
+            unsigned count = (unsigned)(i - _toRelease.begin());
+            _toRelease.erase(_toRelease.begin(), i);
+
+            OE_PROFILING_ZONE_TEXT(Stringify() << "Released " << count);
+            OE_DEBUG << LC << "Released " << count << " objects, " << _toRelease.size() << " pending\n";
         }
     }
 }
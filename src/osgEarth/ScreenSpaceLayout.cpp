@@ -26,6 +26,7 @@
 #include <osgEarth/Text>
 #include <osgEarth/LineDrawable>
 #include <osgEarth/GLUtils>
+#include <osgEarth/GPUTimer>
 #include "ScreenSpaceLayoutDeclutter"
 #include "ScreenSpaceLayoutCallout"
 
@@ -61,6 +62,9 @@ ScreenSpaceLayoutOptions::fromConfig( const Config& conf )
     conf.get( "leader_line_max_length", _leaderLineMaxLen );
     conf.get( "leader_line_color", _leaderLineColor );
     conf.get( "leader_line_width", _leaderLineWidth );
+    conf.get( "temporal_coherence", _temporalCoherence );
+    conf.get( "coherence_threshold", _coherenceThreshold );
+    conf.get( "batch_text", _batchText );
 }
 
 Config
@@ -81,6 +85,9 @@ ScreenSpaceLayoutOptions::getConfig() const
     conf.set( "leader_line_max_length", _leaderLineMaxLen );
     conf.set( "leader_line_color", _leaderLineColor );
     conf.set( "leader_line_width", _leaderLineWidth );
+    conf.set( "temporal_coherence", _temporalCoherence );
+    conf.set( "coherence_threshold", _coherenceThreshold );
+    conf.set( "batch_text", _batchText );
     return conf;
 }
 
@@ -163,6 +170,12 @@ namespace
             setSortingFunctor(_f.get());
         }
 
+        void draw(osg::RenderInfo& ri, osgUtil::RenderLeaf*& previous) override
+        {
+            GPUTimer::Scope gpuTime(*ri.getState(), "screen space layout");
+            osgUtil::RenderBin::draw(ri, previous);
+        }
+
         osg::ref_ptr<DeclutterSortFunctor> _f;
         osg::ref_ptr<ScreenSpaceLayoutContext> _context;
         static Threading::Mutex _vpMutex;
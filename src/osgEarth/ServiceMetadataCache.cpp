@@ -0,0 +1,167 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ServiceMetadataCache>
+#include <osgEarth/Cache>
+#include <osgEarth/CacheBin>
+#include <osgEarth/Registry>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Threading>
+#include <unordered_map>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+using namespace osgEarth::Threading;
+
+#define LC "[ServiceMetadataCache] "
+
+namespace
+{
+    struct Entry
+    {
+        std::string _value;
+        TimeStamp _time;
+    };
+
+    struct Entries
+    {
+        Mutex _mutex;
+        std::unordered_map<std::string, Entry> _entries;
+        Gate<std::string> _gate;
+
+        Entries() : _mutex(OE_MUTEX_NAME), _gate(OE_MUTEX_NAME) { }
+    };
+
+    Entries& entries()
+    {
+        static Entries s_entries;
+        return s_entries;
+    }
+
+    // The key covers the headers too, since a token may travel in one.
+    // Hashed, so the cache never holds a token in plain text.
+    std::string makeKey(const URI& uri)
+    {
+        std::stringstream buf;
+        buf << uri.full();
+        for (auto& header : uri.context().getHeaders())
+            buf << '\n' << header.first << ':' << header.second;
+        return "metadata/" + hashToString(buf.str());
+    }
+
+    ReadResult makeResult(const std::string& value, TimeStamp time, bool fromCache)
+    {
+        ReadResult r(new StringObject(value));
+        r.setLastModifiedTime(time);
+        r.setIsFromCache(fromCache);
+        return r;
+    }
+}
+
+ReadResult
+ServiceMetadataCache::readString(
+    const URI& uri,
+    TimeSpan maxAge,
+    CacheSettings* cacheSettings,
+    const osgDB::Options* readOptions,
+    ProgressCallback* progress)
+{
+    std::string key = makeKey(uri);
+    TimeStamp now = DateTime().asTimeStamp();
+    Entries& e = entries();
+
+    // one request per endpoint at a time; the others wait and take its result
+    ScopedGate<std::string> gate(e._gate, key);
+
+    {
+        ScopedMutexLock lock(e._mutex);
+        auto i = e._entries.find(key);
+        if (i != e._entries.end() && now - i->second._time < maxAge)
+            return makeResult(i->second._value, i->second._time, true);
+    }
+
+    osg::ref_ptr<CacheBin> bin;
+    optional<CachePolicy> policy;
+    if (cacheSettings && cacheSettings->isCacheEnabled())
+    {
+        bin = cacheSettings->getCacheBin();
+        policy = cacheSettings->cachePolicy();
+    }
+
+    if (bin.valid() && policy->isCacheReadable())
+    {
+        ReadResult cached = bin->readString(key, nullptr);
+        if (cached.succeeded() &&
+            (now - cached.lastModifiedTime() < maxAge || policy->usage() == CachePolicy::USAGE_CACHE_ONLY))
+        {
+            ScopedMutexLock lock(e._mutex);
+            Entry& entry = e._entries[key];
+            entry._value = cached.getString();
+            entry._time = cached.lastModifiedTime();
+            return makeResult(entry._value, entry._time, true);
+        }
+    }
+
+    if (policy.isSet() && policy->usage() == CachePolicy::USAGE_CACHE_ONLY)
+    {
+        return ReadResult(ReadResult::RESULT_NOT_FOUND);
+    }
+
+    // bypass the URI cache; it would keep the response past its lifetime
+    osg::ref_ptr<osgDB::Options> options = Registry::instance()->cloneOrCreateOptions(readOptions);
+    osg::ref_ptr<CacheSettings> noCache = new CacheSettings();
+    noCache->cachePolicy() = CachePolicy::NO_CACHE;
+    noCache->store(options.get());
+
+    ReadResult r = uri.readString(options.get(), progress);
+    if (r.failed())
+        return r;
+
+    {
+        ScopedMutexLock lock(e._mutex);
+        Entry& entry = e._entries[key];
+        entry._value = r.getString();
+        entry._time = now;
+    }
+
+    if (bin.valid() && policy->isCacheWriteable())
+    {
+        bin->write(key, r.getObject(), Config(), nullptr);
+    }
+
+    OE_DEBUG << LC << "Read " << uri.base() << std::endl;
+
+    return makeResult(r.getString(), now, false);
+}
+
+void
+ServiceMetadataCache::remove(const URI& uri, CacheSettings* cacheSettings)
+{
+    std::string key = makeKey(uri);
+    Entries& e = entries();
+
+    {
+        ScopedMutexLock lock(e._mutex);
+        e._entries.erase(key);
+    }
+
+    if (cacheSettings && cacheSettings->isCacheEnabled() && cacheSettings->getCacheBin())
+    {
+        cacheSettings->getCacheBin()->remove(key);
+    }
+}
@@ -81,10 +81,11 @@ Session::init()
 {
     setStyles(_styles.get());
 
-    // A new cache to optimize state changes. Since the cache lives in the Session, any
-    // geometry created under this session takes advantage of it. That's reasonable since
-    // tiles in a particular "layer" will tend to share state.
-    _stateSetCache = new StateSetCache();
+    // Share the global cache to optimize state changes. It only holds weak references,
+    // so geometry created under any session can share state with any other layer's.
+    _stateSetCache = Registry::stateSetCache();
+    if (!_stateSetCache.valid())
+        _stateSetCache = new StateSetCache();
 
     _name = "Session (unnamed)";
 
@@ -56,6 +56,9 @@
 // profile, and if so, promote that VP to the Geode's state set.
 #define PROMOTE_EQUIVALENT_DRAWABLE_VP_TO_GEODE 1
 
+// Number of inserts between sweeps for expired cache entries
+#define CACHE_PRUNE_INTERVAL 256u
+
 using namespace osgEarth;
 using namespace osgEarth::Util;
 
@@ -311,6 +314,126 @@ namespace
     }
 }
 
+namespace
+{
+    std::size_t cacheHash(bool text, const osg::StateSet* original, const osg::StateSet* current)
+    {
+        std::size_t seed = StateSetCache::hash(original);
+        seed ^= StateSetCache::hash(current) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed ^ (text ? 1u : 0u);
+    }
+
+    bool sameState(const osg::StateSet* lhs, const osg::StateSet* rhs)
+    {
+        if (lhs == rhs) return true;
+        if (!lhs || !rhs) return false;
+        return lhs->compare(*rhs, true) == 0;
+    }
+}
+
+//...........................................................................
+
+ShaderGenerator::Cache::Cache() :
+    _mutex("ShaderGenerator Cache(OE)"),
+    _size(0u),
+    _insertsSincePrune(0u),
+    _enabled(true)
+{
+    //nop
+}
+
+unsigned
+ShaderGenerator::Cache::size() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _size;
+}
+
+void
+ShaderGenerator::Cache::clear()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    _table.clear();
+    _size = 0u;
+    _insertsSincePrune = 0u;
+}
+
+bool
+ShaderGenerator::Cache::get(std::size_t hash, bool text,
+                            const osg::StateSet* original, const osg::StateSet* current,
+                            osg::ref_ptr<osg::StateSet>& replacement)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    Table::iterator bucket = _table.find(hash);
+    if (bucket != _table.end())
+    {
+        for (auto& entry : bucket->second)
+        {
+            if (entry._text == text &&
+                sameState(entry._original.get(), original) &&
+                sameState(entry._current.get(), current) &&
+                entry._replacement.lock(replacement))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void
+ShaderGenerator::Cache::insert(std::size_t hash, bool text,
+                               const osg::StateSet* original, osg::StateSet* current,
+                               osg::StateSet* replacement)
+{
+    Entry entry;
+    entry._text = text;
+    // copy the input, since the generator may change it afterwards
+    entry._original = original ? osg::clone(original, osg::CopyOp::SHALLOW_COPY) : 0L;
+    entry._current = current;
+    entry._replacement = replacement;
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    _table[hash].push_back(entry);
+    ++_size;
+
+    if (++_insertsSincePrune >= CACHE_PRUNE_INTERVAL)
+    {
+        prune();
+        _insertsSincePrune = 0u;
+    }
+}
+
+void
+ShaderGenerator::Cache::prune()
+{
+    // ASSUME LOCKED
+
+    // Entries hold the input state, textures and all, so drop them as soon
+    // as nothing uses the state set they return.
+    for (Table::iterator bucket = _table.begin(); bucket != _table.end(); )
+    {
+        std::vector<Entry>& entries = bucket->second;
+        for (unsigned i = 0; i < entries.size(); )
+        {
+            if (!entries[i]._replacement.valid())
+            {
+                entries[i] = entries.back();
+                entries.pop_back();
+                --_size;
+            }
+            else ++i;
+        }
+
+        if (entries.empty())
+            bucket = _table.erase(bucket);
+        else
+            ++bucket;
+    }
+}
+
 //...........................................................................
 
 ShaderGenerator::GenBuffers::GenBuffers() :
@@ -345,12 +468,14 @@ ShaderGenerator::ShaderGenerator()
     _state = new StateEx();
     _active = true;
     _duplicateSharedSubgraphs = false;
+    _cache = new Cache();
 }
 
 ShaderGenerator::ShaderGenerator(const ShaderGenerator& rhs, const osg::CopyOp& copy) :
 osg::NodeVisitor         (rhs, copy),
 _active                  (rhs._active),
-_duplicateSharedSubgraphs(rhs._duplicateSharedSubgraphs)
+_duplicateSharedSubgraphs(rhs._duplicateSharedSubgraphs),
+_cache                   (rhs._cache)
 {
     _state = new StateEx();
 }
@@ -381,6 +506,7 @@ void
 ShaderGenerator::addAcceptCallback(AcceptCallback* cb)
 {
     _acceptCallbacks.push_back( cb );
+    _cache = new Cache();
 }
 
 bool
@@ -754,7 +880,29 @@ ShaderGenerator::processText(const osg::StateSet* ss, osg::ref_ptr<osg::StateSet
     // Capture the active current state:
     osg::ref_ptr<osg::StateSet> current = static_cast<StateEx*>(_state.get())->capture();
 
+    // Same input as before? Reuse what we generated then.
+    std::size_t hash = 0u;
+    bool useCache = _cache.valid() && _cache->getEnabled();
+    if (useCache)
+    {
+        hash = cacheHash(true, ss, current.get());
+        if (_cache->get(hash, true, ss, current.get(), replacement))
+            return true;
+    }
+
+    bool result = generateText(ss, current.get(), replacement);
 
+    if (useCache && result)
+    {
+        _cache->insert(hash, true, ss, current.get(), replacement.get());
+    }
+
+    return result;
+}
+
+bool
+ShaderGenerator::generateText(const osg::StateSet* ss, osg::StateSet* current, osg::ref_ptr<osg::StateSet>& replacement)
+{
     // We ignore an existing program if the version is < 3.6.0 which is when the new osg text shaders with sdf were introduced.
 #if OSG_VERSION_LESS_THAN(3,6,0)
     // check for a real osg::Program. If it exists, bail out so that OSG
@@ -822,6 +970,31 @@ ShaderGenerator::processGeometry(const osg::StateSet*         original,
     // capture the active current state:
     osg::ref_ptr<osg::StateSet> current = static_cast<StateEx*>(_state.get())->capture();
 
+    // Same input as before? Reuse what we generated then.
+    std::size_t hash = 0u;
+    bool useCache = _cache.valid() && _cache->getEnabled();
+    if (useCache)
+    {
+        hash = cacheHash(false, original, current.get());
+        if (_cache->get(hash, false, original, current.get(), replacement))
+            return true;
+    }
+
+    bool result = generateGeometry(original, current.get(), replacement);
+
+    if (useCache && result)
+    {
+        _cache->insert(hash, false, original, current.get(), replacement.get());
+    }
+
+    return result;
+}
+
+bool
+ShaderGenerator::generateGeometry(const osg::StateSet*         original,
+                                  osg::StateSet*               current,
+                                  osg::ref_ptr<osg::StateSet>& replacement)
+{
     // check for a real osg::Program in the whole state stack. If it exists, bail out
     // so that OSG can use the program already in the graph. We never override a
     // full Program.
@@ -53,7 +53,11 @@ _size         ( 2048 ),
 _texImageUnit ( 7 ),
 _blurFactor   ( 0.001f ),
 _color        ( 0.4f ),
-_traversalMask( ~0 )
+_traversalMask( ~0 ),
+_numCachedSlices( 0u ),
+_cacheCellSize( 0.0f ),
+_cacheAngle   ( 0.5f ),
+_cacheDirty   ( true )
 {
     _castingGroup = new osg::Group();
 
@@ -111,6 +115,26 @@ ShadowCaster::setShadowColor(float value)
         _shadowColorUniform->set(value);
 }
 
+void
+ShadowCaster::setNumCachedSlices(unsigned value)
+{
+    _numCachedSlices = value;
+    _cacheDirty = true;
+}
+
+void
+ShadowCaster::setCacheCellSize(float value)
+{
+    _cacheCellSize = value;
+    _cacheDirty = true;
+}
+
+void
+ShadowCaster::setCacheAngle(float value)
+{
+    _cacheAngle = value;
+}
+
 void
 ShadowCaster::reinitialize()
 {
@@ -119,6 +143,8 @@ ShadowCaster::reinitialize()
 
     _shadowmap = 0L;
     _rttCameras.clear();
+    _sliceTexGen.clear();
+    _cacheDirty = true;
 
     int numSlices = (int)_ranges.size() - 1;
     if ( numSlices < 1 )
@@ -155,6 +181,8 @@ ShadowCaster::reinitialize()
         _rttCameras.push_back(rtt);
     }
 
+    _sliceTexGen.resize(numSlices);
+
     _rttStateSet = new osg::StateSet();
 
     // only draw back faces to the shadow depth map
@@ -258,6 +286,44 @@ ShadowCaster::traverse(osg::NodeVisitor& nv)
             osg::Vec3d lightPosWorld = osg::Vec3d(0,0,0) * inverseMV;
             //osg::Vec3d lightPosWorld( lp4.x(), lp4.y(), lp4.z() ); // jitter..
 
+            // The farthest slices may be cached. Those are centered on the cell
+            // holding the camera, so they stay valid while the camera moves
+            // within it; put the light there too, so every slice rendered
+            // this frame shares a light view matrix.
+            int numSlices = (int)_ranges.size() - 1;
+            int firstCached = numSlices - (int)osg::minimum(_numCachedSlices, (unsigned)numSlices);
+            bool renderCached = false;
+            double cachePadding = 0.0;
+
+            if (firstCached < numSlices)
+            {
+                double cellSize = _cacheCellSize > 0.0f ?
+                    (double)_cacheCellSize :
+                    0.1 * (double)_ranges[firstCached+1];
+
+                osg::Vec3d cell(
+                    floor(lightPosWorld.x() / cellSize),
+                    floor(lightPosWorld.y() / cellSize),
+                    floor(lightPosWorld.z() / cellSize));
+
+                lightPosWorld = (cell + osg::Vec3d(0.5, 0.5, 0.5)) * cellSize;
+
+                // the camera can be this far from the cell center
+                cachePadding = cellSize * 0.5 * sqrt(3.0);
+
+                renderCached =
+                    _cacheDirty ||
+                    cell != _cacheCell ||
+                    lightVectorWorld * _cacheLightVector < cos(osg::DegreesToRadians((double)_cacheAngle));
+
+                if (renderCached)
+                {
+                    _cacheCell = cell;
+                    _cacheLightVector = lightVectorWorld;
+                    _cacheDirty = false;
+                }
+            }
+
             // construct the view matrix for the light. The up vector doesn't really
             // matter so we'll just use the camera's.
             osg::Matrix lightViewMat;
@@ -274,9 +340,34 @@ ShadowCaster::traverse(osg::NodeVisitor& nv)
             osg::Matrix lightViewMatInv = osg::Matrix::inverse(lightViewMat);
             _shadowToPrimaryMatrix->set( lightViewMatInv * MV);
             
+            // this xforms from clip [-1..1] to texture [0..1] space
+            static osg::Matrix s_scaleBiasMat = 
+                osg::Matrix::translate(1.0,1.0,1.0) * 
+                osg::Matrix::scale(0.5,0.5,0.5);
+
             int i;
-            for(i=0; i < (int) _ranges.size()-1; ++i)
+            for(i=0; i < numSlices; ++i)
             {
+                if (i >= firstCached)
+                {
+                    if (renderCached)
+                    {
+                        // fit the slice to a sphere around the cell, in light space
+                        // the light sits at its center
+                        double r = (double)_ranges[i+1] + cachePadding;
+                        osg::Matrix lightProjMat;
+                        lightProjMat.makeOrtho(-r, r, -r, r, -r, r);
+
+                        _rttCameras[i]->setViewMatrix( lightViewMat );
+                        _rttCameras[i]->setProjectionMatrix( lightProjMat );
+                        _sliceTexGen[i] = lightViewMat * lightProjMat * s_scaleBiasMat;
+                    }
+
+                    // the last rendering still holds; only the view moved
+                    _shadowMapTexGenUniform->setElement(i, inverseMV * _sliceTexGen[i]);
+                    continue;
+                }
+
                 double n = _ranges[i];
                 double f = _ranges[i+1];
 
@@ -312,28 +403,25 @@ ShadowCaster::traverse(osg::NodeVisitor& nv)
                 // configure the RTT camera for this slice:
                 _rttCameras[i]->setViewMatrix( lightViewMat );
                 _rttCameras[i]->setProjectionMatrix( lightProjMat );
-
-                // this xforms from clip [-1..1] to texture [0..1] space
-                static osg::Matrix s_scaleBiasMat = 
-                    osg::Matrix::translate(1.0,1.0,1.0) * 
-                    osg::Matrix::scale(0.5,0.5,0.5);
                 
                 // set the texture coordinate generation matrix that the shadow
                 // receiver will use to sample the shadow map. Doing this on the CPU
                 // prevents nasty precision issues!
-                osg::Matrix VPS = lightViewMat * lightProjMat * s_scaleBiasMat;
-                _shadowMapTexGenUniform->setElement(i, inverseMV * VPS);
+                _sliceTexGen[i] = lightViewMat * lightProjMat * s_scaleBiasMat;
+                _shadowMapTexGenUniform->setElement(i, inverseMV * _sliceTexGen[i]);
             }
 
             // install the shadow-casting traversal mask:
             unsigned saveMask = cv->getTraversalMask();
             cv->setTraversalMask( _traversalMask & saveMask );
 
-            // render the shadow maps.
+            // render the shadow maps. A cached slice that isn't rendered keeps
+            // its layer of the shadow map from the last time it was.
             cv->pushStateSet( _rttStateSet.get() );
             for(i=0; i < (int) _rttCameras.size(); ++i)
             {
-                _rttCameras[i]->accept( nv );
+                if (i < firstCached || renderCached)
+                    _rttCameras[i]->accept( nv );
             }
             cv->popStateSet();
 
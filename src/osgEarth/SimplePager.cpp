@@ -15,6 +15,8 @@ using namespace osgEarth::Util;
 
 #define USE_PAGING_MANAGER
 
+#define SIMPLEPAGER_ARENA_NAME "oe.simplepager"
+
 namespace
 {
     /**
@@ -162,6 +164,9 @@ _maxLevel(30),
 _priorityScale(1.0f),
 _priorityOffset(0.0f),
 _canCancel(true),
+_asyncCreation(false),
+_cacheSize(0u),
+_nodeCache(true, 1u),
 _mutex("SimplePager(OE)")
 {
     // required in order to pass our "this" pointer to the pseudo loader:
@@ -182,6 +187,18 @@ bool SimplePager::getEnableCancalation() const
     return static_cast<ProgressMaster*>(_progressMaster.get())->_canCancel;
 }
 
+void SimplePager::setCacheSize(unsigned value)
+{
+    _cacheSize = value;
+    _nodeCache.clear();
+    _nodeCache.setMaxSize(osg::maximum(value, 1u));
+}
+
+void SimplePager::clearCache()
+{
+    _nodeCache.clear();
+}
+
 void SimplePager::build()
 {
     addChild( buildRootNode() );
@@ -230,11 +247,13 @@ osg::ref_ptr<osg::Node> SimplePager::buildRootNode()
 
     std::vector<TileKey> keys;
     _profile->getRootKeys( keys );
-    for (unsigned int i = 0; i < keys.size(); i++)
+
+    std::vector<osg::ref_ptr<osg::Node>> nodes;
+    createPagedNodes(keys, nullptr, nodes);
+    for (unsigned int i = 0; i < nodes.size(); i++)
     {
-        osg::ref_ptr<osg::Node> node = createPagedNode( keys[i], 0L );
-        if ( node.valid() )
-            root->addChild( node );
+        if ( nodes[i].valid() )
+            root->addChild( nodes[i] );
     }
 
     return root;
@@ -254,6 +273,83 @@ osg::ref_ptr<osg::Node> SimplePager::createNode(const TileKey& key, ProgressCall
     return mt;
 }
 
+osg::ref_ptr<osg::Node> SimplePager::createNodeCached(const TileKey& key, ProgressCallback* progress, bool& fromCache)
+{
+    fromCache = false;
+
+    if (_cacheSize > 0u)
+    {
+        LRUCache<TileKey, osg::ref_ptr<osg::Node>>::Record record;
+        if (_nodeCache.get(key, record))
+        {
+            fromCache = true;
+            return record.value();
+        }
+    }
+
+    osg::ref_ptr<osg::Node> node = createNode(key, progress);
+
+    // don't remember a result that may be incomplete
+    if (_cacheSize > 0u && !(progress && progress->isCanceled()))
+    {
+        _nodeCache.insert(key, node);
+    }
+
+    return node;
+}
+
+void SimplePager::createPagedNodes(const std::vector<TileKey>& keys, ProgressCallback* progress, std::vector<osg::ref_ptr<osg::Node>>& output)
+{
+    output.resize(keys.size());
+
+    if (!_asyncCreation || keys.size() < 2u)
+    {
+        for (unsigned i = 0; i < keys.size(); ++i)
+            output[i] = createPagedNode(keys[i], progress);
+        return;
+    }
+
+    // A separate arena, since we are usually running in a paging job
+    // ourselves and must not wait on jobs queued behind us.
+    static JobArena* arena = []()
+    {
+        JobArena::setConcurrency(SIMPLEPAGER_ARENA_NAME, osg::maximum(4u, Threading::getConcurrency()));
+        return JobArena::get(SIMPLEPAGER_ARENA_NAME);
+    }();
+
+    bool canCancel = progress != nullptr;
+
+    JobGroup group;
+    std::vector<Future<osg::ref_ptr<osg::Node>>> results;
+    for (auto& key : keys)
+    {
+        results.push_back(Job(arena, &group).dispatch<osg::ref_ptr<osg::Node>>(
+            [this, key, canCancel](Cancelable* c)
+            {
+                // canceled when the caller abandons the future
+                osg::ref_ptr<ProgressCallback> p = canCancel ? new ProgressCallback(c) : nullptr;
+                return createPagedNode(key, p.get());
+            }
+        ));
+    }
+
+    for (unsigned i = 0; i < results.size(); ++i)
+    {
+        output[i] = results[i].get(progress);
+
+        // tile left view; abandon the rest. Jobs that haven't started
+        // will skip, and we wait for the running ones to notice.
+        if (progress && progress->isCanceled())
+        {
+            for (auto& result : results)
+                result.abandon();
+            group.join();
+            output.clear();
+            return;
+        }
+    }
+}
+
 #ifdef USE_PAGING_MANAGER
 
 osg::ref_ptr<osg::Node>
@@ -269,9 +365,10 @@ SimplePager::createPagedNode(const TileKey& key, ProgressCallback* progress)
     osg::ref_ptr<osg::Node> node;
 
     // only create real node if we are at least at the min LOD:
+    bool fromCache = false;
     if (key.getLOD() >= _minLevel)
     {
-        node = createNode(key, progress);
+        node = createNodeCached(key, progress, fromCache);
         hasChildren = node.valid();
     }
 
@@ -281,7 +378,8 @@ SimplePager::createPagedNode(const TileKey& key, ProgressCallback* progress)
     if (node.valid())
     {
         pagedNode->addChild(node);
-        fire_onCreateNode(key, node.get());
+        if (!fromCache)
+            fire_onCreateNode(key, node.get());
     }
 
     tileRadius = osg::maximum(
@@ -337,10 +435,16 @@ SimplePager::createPagedNode(const TileKey& key, ProgressCallback* progress)
         pagedNode->setPriorityScale(_priorityScale);
         //pager->setPriorityOffset(_priorityOffset);
 
+        osg::ref_ptr<ProgressMaster> master = static_cast<ProgressMaster*>(_progressMaster.get());
+
         pagedNode->setLoadFunction(
-            [this, key](Cancelable* progress)
+            [this, key, master](Cancelable* c)
             {
-                return loadKey(key, nullptr); // tracker);
+                // the PagedNode2 cancels its job when the tile leaves view
+                osg::ref_ptr<ProgressCallback> progress =
+                    master->_canCancel ? new ProgressCallback(c) : nullptr;
+
+                return loadChildren(key, progress.get());
             }
         );
 
@@ -369,9 +473,10 @@ osg::ref_ptr<osg::Node> SimplePager::createPagedNode(const TileKey& key, Progres
     osg::ref_ptr<osg::Node> node;
 
     // only create real node if we are at least at the min LOD:
+    bool fromCache = false;
     if ( key.getLevelOfDetail() >= _minLevel )
     {
-        node = createNode( key, progress );
+        node = createNodeCached( key, progress, fromCache );
 
         if ( node.valid())
         {      
@@ -390,7 +495,8 @@ osg::ref_ptr<osg::Node> SimplePager::createPagedNode(const TileKey& key, Progres
     }
 
     // notify any callbacks.
-    fire_onCreateNode(key, node.get());
+    if ( !fromCache )
+        fire_onCreateNode(key, node.get());
 
     tileRadius = osg::maximum(tileBounds.radius(), static_cast<osg::BoundingSphere::value_type>(tileRadius));
 
@@ -490,16 +596,29 @@ osg::ref_ptr<osg::Node> SimplePager::createPagedNode(const TileKey& key, Progres
 osg::ref_ptr<osg::Node>
 SimplePager::loadKey(const TileKey& key, ProgressTracker* tracker)
 {       
-    osg::ref_ptr< osg::Group >  group = new osg::Group;
+    return loadChildren(key, nullptr); // tracker->_progress[i].get() );
+}
 
+osg::ref_ptr<osg::Node>
+SimplePager::loadChildren(const TileKey& key, ProgressCallback* progress)
+{
+    std::vector<TileKey> childKeys;
     for (unsigned int i = 0; i < 4; i++)
-    {
-        TileKey childKey = key.createChildKey( i );
+        childKeys.push_back(key.createChildKey(i));
+
+    std::vector<osg::ref_ptr<osg::Node>> plods;
+    createPagedNodes(childKeys, progress, plods);
+
+    if (progress && progress->isCanceled())
+        return nullptr;
 
-        osg::ref_ptr<osg::Node> plod = createPagedNode(childKey, nullptr); // tracker->_progress[i].get() );
-        if (plod.valid())
+    osg::ref_ptr< osg::Group >  group = new osg::Group;
+
+    for (unsigned int i = 0; i < plods.size(); i++)
+    {
+        if (plods[i].valid())
         {
-            group->addChild( plod );
+            group->addChild( plods[i] );
         }
     }
     if (group->getNumChildren() > 0)
@@ -19,10 +19,19 @@
 
 #include <osgEarth/SimplexNoise>
 #include <osgEarth/ImageUtils>
+#include <osgEarth/Threading>
 #include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OE_SIMPLEX_SSE2
+#include <emmintrin.h>
+#endif
 
 #define POW2(x) ((double)(x==0 ? 1 : (2 << (x-1))))
 
+#define NOISE_ARENA_NAME "oe.noise"
+
 using namespace osgEarth;
 using namespace osgEarth::Util;
 using namespace osgEarth::Util;
@@ -229,6 +238,95 @@ double SimplexNoise::getTiledValueWithTurbulence(double x, double y, double F) c
     return n;
 }
 
+void SimplexNoise::getTiledValues(unsigned dim, float* output) const
+{
+    if (dim == 0 || output == 0L)
+        return;
+
+    const double TwoPI = 2.0 * osg::PI;
+    unsigned o = osg::maximum(1u, _octaves);
+
+    // the two ortho circles, as in getTiledValue
+    std::vector<double> c(dim), sn(dim);
+    for (unsigned i = 0; i < dim; ++i)
+    {
+        double a = ((double)i / (double)dim) * TwoPI;
+        c[i] = cos(a) / TwoPI;
+        sn[i] = sin(a) / TwoPI;
+    }
+
+    std::vector<double> freqs(o), amps(o);
+    double freq = _freq, amp = 1.0, maxamp = 0.0;
+    for (unsigned k = 0; k < o; ++k)
+    {
+        freqs[k] = freq, amps[k] = amp;
+        maxamp += amp;
+        amp *= _pers;
+        freq *= _lacunarity;
+    }
+
+    auto rows = [&, this](unsigned first, unsigned last)
+    {
+        std::vector<float> x(dim), y(dim), z(dim), w(dim), n(dim);
+        for (unsigned t = first; t < last; ++t)
+        {
+            float* row = output + t * dim;
+            std::fill(row, row + dim, 0.0f);
+
+            for (unsigned k = 0; k < o; ++k)
+            {
+                double f = freqs[k];
+                std::fill(y.begin(), y.end(), (float)(c[t] * f));
+                std::fill(w.begin(), w.end(), (float)(sn[t] * f));
+                for (unsigned s = 0; s < dim; ++s)
+                {
+                    x[s] = (float)(c[s] * f);
+                    z[s] = (float)(sn[s] * f);
+                }
+
+                NoiseRow(&x[0], &y[0], &z[0], &w[0], dim, &n[0]);
+
+                float a = (float)amps[k];
+                for (unsigned s = 0; s < dim; ++s)
+                    row[s] += n[s] * a;
+            }
+
+            if (_normalize)
+            {
+                float scale = (float)((_high - _low) / 2.0 / maxamp);
+                float bias = (float)((_high + _low) / 2.0);
+                for (unsigned s = 0; s < dim; ++s)
+                    row[s] = row[s] * scale + bias;
+            }
+        }
+    };
+
+    unsigned bands = osg::minimum(Threading::getConcurrency(), dim / 32u);
+    if (bands <= 1u)
+    {
+        rows(0u, dim);
+        return;
+    }
+
+    static JobArena* arena = []()
+    {
+        JobArena::setConcurrency(NOISE_ARENA_NAME, Threading::getConcurrency());
+        return JobArena::get(NOISE_ARENA_NAME);
+    }();
+
+    JobGroup group;
+    unsigned perBand = (dim + bands - 1u) / bands;
+    for (unsigned first = 0; first < dim; first += perBand)
+    {
+        unsigned last = osg::minimum(first + perBand, dim);
+        Job(arena, &group).dispatch([&rows, first, last](Cancelable*)
+        {
+            rows(first, last);
+        });
+    }
+    group.join();
+}
+
 double SimplexNoise::getValue(double xin, double yin) const
 {
     double freq = _freq;
@@ -656,6 +754,136 @@ double SimplexNoise::Noise(double x, double y, double z, double w) const
     return 27.0 * (n0 + n1 + n2 + n3 + n4);
 }
 
+#ifdef OE_SIMPLEX_SSE2
+namespace
+{
+    // floor() of four floats, like FastFloor
+    inline __m128i floor4(__m128 v)
+    {
+        __m128i t = _mm_cvttps_epi32(v);
+        __m128 below = _mm_cmplt_ps(v, _mm_cvtepi32_ps(t));
+        return _mm_add_epi32(t, _mm_castps_si128(below));
+    }
+}
+#endif
+
+// Same algorithm as Noise(x,y,z,w), four points per pass. The skewing,
+// ranking and falloff are all done with masks instead of branches; only
+// the permutation lookups are per point.
+void SimplexNoise::NoiseRow(const float* x, const float* y, const float* z, const float* w, unsigned count, float* out) const
+{
+    unsigned i = 0;
+
+#ifdef OE_SIMPLEX_SSE2
+    const __m128 f4 = _mm_set1_ps((float)F4);
+    const __m128 g4 = _mm_set1_ps((float)G4);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 radius = _mm_set1_ps(0.6f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 pw = _mm_loadu_ps(w + i);
+
+        // Skew to find the simplex cell, and unskew its origin
+        __m128 s = _mm_mul_ps(_mm_add_ps(_mm_add_ps(px, py), _mm_add_ps(pz, pw)), f4);
+        __m128i ci = floor4(_mm_add_ps(px, s));
+        __m128i cj = floor4(_mm_add_ps(py, s));
+        __m128i ck = floor4(_mm_add_ps(pz, s));
+        __m128i cl = floor4(_mm_add_ps(pw, s));
+        __m128 fi = _mm_cvtepi32_ps(ci);
+        __m128 fj = _mm_cvtepi32_ps(cj);
+        __m128 fk = _mm_cvtepi32_ps(ck);
+        __m128 fl = _mm_cvtepi32_ps(cl);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(fi, fj), _mm_add_ps(fk, fl)), g4);
+
+        __m128 x0 = _mm_sub_ps(px, _mm_sub_ps(fi, t));
+        __m128 y0 = _mm_sub_ps(py, _mm_sub_ps(fj, t));
+        __m128 z0 = _mm_sub_ps(pz, _mm_sub_ps(fk, t));
+        __m128 w0 = _mm_sub_ps(pw, _mm_sub_ps(fl, t));
+
+        // Rank the coordinates with the same six comparisons as Noise()
+        __m128 xy = _mm_cmpgt_ps(x0, y0), xz = _mm_cmpgt_ps(x0, z0), xw = _mm_cmpgt_ps(x0, w0);
+        __m128 yz = _mm_cmpgt_ps(y0, z0), yw = _mm_cmpgt_ps(y0, w0), zw = _mm_cmpgt_ps(z0, w0);
+        __m128 rankx = _mm_add_ps(_mm_add_ps(_mm_and_ps(xy, one), _mm_and_ps(xz, one)), _mm_and_ps(xw, one));
+        __m128 ranky = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(xy, one), _mm_and_ps(yz, one)), _mm_and_ps(yw, one));
+        __m128 rankz = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(xz, one), _mm_andnot_ps(yz, one)), _mm_and_ps(zw, one));
+        __m128 rankw = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(xw, one), _mm_andnot_ps(yw, one)), _mm_andnot_ps(zw, one));
+
+        // Offsets of the five corners, largest coordinate first
+        __m128 cx[5], cy[5], cz[5], cw[5];
+        cx[0] = x0, cy[0] = y0, cz[0] = z0, cw[0] = w0;
+        const __m128 thresholds[3] = { three, two, one };
+        for (int c = 1; c <= 3; ++c)
+        {
+            __m128 g = _mm_mul_ps(_mm_set1_ps((float)c), g4);
+            __m128 th = thresholds[c - 1];
+            cx[c] = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(_mm_cmpge_ps(rankx, th), one)), g);
+            cy[c] = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(_mm_cmpge_ps(ranky, th), one)), g);
+            cz[c] = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(_mm_cmpge_ps(rankz, th), one)), g);
+            cw[c] = _mm_add_ps(_mm_sub_ps(w0, _mm_and_ps(_mm_cmpge_ps(rankw, th), one)), g);
+        }
+        __m128 g4x4 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.0f), g4), one);
+        cx[4] = _mm_add_ps(x0, g4x4), cy[4] = _mm_add_ps(y0, g4x4);
+        cz[4] = _mm_add_ps(z0, g4x4), cw[4] = _mm_add_ps(w0, g4x4);
+
+        // Hash the corners to gradients one lane at a time
+        alignas(16) int li[4], lj[4], lk[4], ll[4];
+        alignas(16) float rx[4], ry[4], rz[4], rw[4];
+        _mm_store_si128((__m128i*)li, ci);
+        _mm_store_si128((__m128i*)lj, cj);
+        _mm_store_si128((__m128i*)lk, ck);
+        _mm_store_si128((__m128i*)ll, cl);
+        _mm_store_ps(rx, rankx);
+        _mm_store_ps(ry, ranky);
+        _mm_store_ps(rz, rankz);
+        _mm_store_ps(rw, rankw);
+
+        alignas(16) float gx[5][4], gy[5][4], gz[5][4], gw[5][4];
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            int ii = li[lane] & 255, jj = lj[lane] & 255, kk = lk[lane] & 255, l = ll[lane] & 255;
+            int ri = (int)rx[lane], rj = (int)ry[lane], rk = (int)rz[lane], rl = (int)rw[lane];
+            for (int c = 0; c < 5; ++c)
+            {
+                // corner 0 has no offset, corners 1-3 follow the ranks, corner 4 is all ones
+                int o = c == 0 ? 4 : 4 - c;
+                int i1 = ri >= o ? 1 : 0, j1 = rj >= o ? 1 : 0, k1 = rk >= o ? 1 : 0, l1 = rl >= o ? 1 : 0;
+                const Grad& g = grad4[perm[ii + i1 + perm[jj + j1 + perm[kk + k1 + perm[l + l1]]]] % 32];
+                gx[c][lane] = (float)g.x, gy[c][lane] = (float)g.y, gz[c][lane] = (float)g.z, gw[c][lane] = (float)g.w;
+            }
+        }
+
+        // Sum the contributions of the five corners
+        __m128 n = zero;
+        for (int c = 0; c < 5; ++c)
+        {
+            __m128 tc = _mm_sub_ps(radius, _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx[c], cx[c]), _mm_mul_ps(cy[c], cy[c])),
+                _mm_add_ps(_mm_mul_ps(cz[c], cz[c]), _mm_mul_ps(cw[c], cw[c]))));
+            __m128 dot = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[c]), cx[c]), _mm_mul_ps(_mm_load_ps(gy[c]), cy[c])),
+                _mm_add_ps(_mm_mul_ps(_mm_load_ps(gz[c]), cz[c]), _mm_mul_ps(_mm_load_ps(gw[c]), cw[c])));
+            __m128 t2 = _mm_mul_ps(tc, tc);
+            __m128 contrib = _mm_mul_ps(_mm_mul_ps(t2, t2), dot);
+            n = _mm_add_ps(n, _mm_and_ps(_mm_cmpgt_ps(tc, zero), contrib));
+        }
+
+        _mm_storeu_ps(out + i, _mm_mul_ps(n, _mm_set1_ps(27.0f)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = (float)Noise(x[i], y[i], z[i], w[i]);
+    }
+}
+
 osg::Image*
 SimplexNoise::createSeamlessImage(unsigned dim) const
 {
@@ -666,48 +894,36 @@ SimplexNoise::createSeamlessImage(unsigned dim) const
     noise.setRange(0.0, 1.0);
     noise.setNormalize(true);
 
-    osg::Image* image = new osg::Image();
-    image->allocateImage(dim, dim, 1, GL_RED, GL_UNSIGNED_BYTE);
-    ImageUtils::PixelWriter write(image);
+    std::vector<float> values(dim * dim);
+    noise.getTiledValues(dim, &values[0]);
 
-    float minN =  FLT_MAX;
-    float maxN = -FLT_MAX;
-
-    // populate the image, tracking the min and max noise readings:
-    osg::Vec4f value;
-    for (unsigned s = 0; s < dim; ++s)
-    {
-        double u = (double)s / (double)dim;
-        for (unsigned t = 0; t < dim; ++t)
-        {
-            double v = (double)t / (double)dim;
-            value.r() = noise.getTiledValue(u, v);
-            minN = osg::minimum(minN, value.r());
-            maxN = osg::maximum(maxN, value.r());
-            write(value, s, t);
-        }        
-    }
+    float scale = 1.0f;
+    float bias = 0.0f;
 
     if (getNormalize())
     {
         // Histogram stretch to [0..1]
-        float scale = 1.0/(maxN-minN);
-        float bias = -minN;
+        auto minmax = std::minmax_element(values.begin(), values.end());
+        float minN = *minmax.first;
+        float maxN = *minmax.second;
+        if (maxN > minN)
+        {
+            scale = 1.0f / (maxN - minN);
+            bias = -minN;
+        }
 
         OE_INFO << "minN=" << minN << "; maxN=" << maxN << "; scale=" << scale << "; bias=" << bias << "\n";
+    }
 
-        ImageUtils::PixelReader read(image);
-        read.setBilinear(false);
+    osg::Image* image = new osg::Image();
+    image->allocateImage(dim, dim, 1, GL_RED, GL_UNSIGNED_BYTE);
 
-        for (unsigned s = 0; s < dim; ++s)
-        {
-            for (unsigned t = 0; t < dim; ++t)
-            {
-                read(value, s, t);
-                value.r() = (value.r()+bias)*scale;
-                write(value, s, t);
-            }
-        }
+    // values are row-major in t, same as the image
+    unsigned char* data = image->data();
+    for (unsigned i = 0; i < dim * dim; ++i)
+    {
+        float v = osg::clampBetween((values[i] + bias) * scale, 0.0f, 1.0f);
+        data[i] = (unsigned char)(v * 255.0f);
     }
 
     return image;
@@ -0,0 +1,310 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/SimplifyFilter>
+#include <osgEarth/FilterContext>
+#include <osgEarth/Math>
+#include <unordered_map>
+#include <algorithm>
+
+#define LC "[SimplifyFilter] "
+
+using namespace osgEarth;
+
+OSGEARTH_REGISTER_SIMPLE_FEATUREFILTER(simplify, SimplifyFilter );
+
+namespace
+{
+    // 2D location of a vertex, compared exactly; vertices shared by neighboring
+    // features are copies of one another.
+    struct Key
+    {
+        double x, y;
+        Key() : x(0.0), y(0.0) { }
+        Key(const osg::Vec3d& p) : x(p.x()), y(p.y()) { }
+        bool operator == (const Key& rhs) const { return x == rhs.x && y == rhs.y; }
+        bool operator < (const Key& rhs) const { return x < rhs.x || (x == rhs.x && y < rhs.y); }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& k) const {
+            return hash_value_unsigned(std::hash<double>()(k.x), std::hash<double>()(k.y));
+        }
+    };
+
+    // The neighbors a vertex had the first time we saw it, and whether it's
+    // a junction: a vertex seen later with other neighbors, or the end of a line.
+    struct Usage
+    {
+        Key a, b;
+        bool junction;
+        Usage() : junction(false) { }
+    };
+
+    typedef std::unordered_map<Key, Usage, KeyHash> UsageMap;
+
+    void recordUse(UsageMap& usage, const Key& k, const Key* prev, const Key* next)
+    {
+        std::pair<UsageMap::iterator, bool> r = usage.insert(std::make_pair(k, Usage()));
+        Usage& u = r.first->second;
+
+        if (prev == 0L || next == 0L)
+        {
+            u.junction = true;
+            return;
+        }
+
+        Key a = *prev, b = *next;
+        if (b < a)
+            std::swap(a, b);
+
+        if (r.second)
+        {
+            u.a = a, u.b = b;
+        }
+        else if (!(u.a == a && u.b == b))
+        {
+            u.junction = true;
+        }
+    }
+
+    void recordParts(UsageMap& usage, Geometry* geom)
+    {
+        GeometryIterator iter(geom, true);
+        while (iter.hasMore())
+        {
+            Geometry* part = iter.next();
+            if (part->isPointSet() || part->size() < 2)
+                continue;
+
+            bool ring = part->isRing();
+            unsigned n = part->size();
+            if (ring && n > 1 && (*part)[0] == (*part)[n-1])
+                --n;
+
+            for (unsigned i = 0; i < n; ++i)
+            {
+                Key k((*part)[i]);
+                if (ring)
+                {
+                    Key prev((*part)[(i+n-1)%n]), next((*part)[(i+1)%n]);
+                    recordUse(usage, k, &prev, &next);
+                }
+                else
+                {
+                    Key prev(i > 0 ? (*part)[i-1] : osg::Vec3d()), next(i+1 < n ? (*part)[i+1] : osg::Vec3d());
+                    recordUse(usage, k, i > 0 ? &prev : 0L, i+1 < n ? &next : 0L);
+                }
+            }
+        }
+    }
+
+    // squared 2D distance from p to the segment ab
+    double distance2(const osg::Vec3d& p, const osg::Vec3d& a, const osg::Vec3d& b)
+    {
+        double dx = b.x()-a.x(), dy = b.y()-a.y();
+        double len2 = dx*dx + dy*dy;
+        double t = len2 > 0.0 ? ((p.x()-a.x())*dx + (p.y()-a.y())*dy) / len2 : 0.0;
+        t = osg::clampBetween(t, 0.0, 1.0);
+        double ex = a.x() + t*dx - p.x(), ey = a.y() + t*dy - p.y();
+        return ex*ex + ey*ey;
+    }
+
+    // Douglas-Peucker over the vertices pts[stretch[0..n-1]], marking the ones to keep.
+    void douglasPeucker(const std::vector<osg::Vec3d>& pts,
+                        const std::vector<unsigned>& stretch,
+                        double tolerance2,
+                        std::vector<bool>& keep)
+    {
+        std::vector<std::pair<unsigned, unsigned> > stack;
+        stack.push_back(std::make_pair(0u, (unsigned)stretch.size()-1u));
+
+        while (!stack.empty())
+        {
+            std::pair<unsigned, unsigned> r = stack.back();
+            stack.pop_back();
+
+            if (r.second <= r.first + 1u)
+                continue;
+
+            const osg::Vec3d& a = pts[stretch[r.first]];
+            const osg::Vec3d& b = pts[stretch[r.second]];
+
+            double farthest = -1.0;
+            unsigned f = r.first;
+            for (unsigned i = r.first+1u; i < r.second; ++i)
+            {
+                double d = distance2(pts[stretch[i]], a, b);
+                if (d > farthest)
+                    farthest = d, f = i;
+            }
+
+            if (farthest > tolerance2)
+            {
+                keep[stretch[f]] = true;
+                stack.push_back(std::make_pair(r.first, f));
+                stack.push_back(std::make_pair(f, r.second));
+            }
+        }
+    }
+
+    void simplifyPart(Geometry* part, const UsageMap* usage, double tolerance2)
+    {
+        bool ring = part->isRing();
+
+        std::vector<osg::Vec3d> pts(part->begin(), part->end());
+        bool closed = ring && pts.size() > 1 && pts.front() == pts.back();
+        if (closed)
+            pts.pop_back();
+
+        unsigned n = pts.size();
+        unsigned minSize = ring ? 3u : 2u;
+        if (n <= minSize)
+            return;
+
+        // find the vertices that can't move: line ends and junctions.
+        std::vector<unsigned> anchors;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            bool anchor = !ring && (i == 0 || i == n-1);
+            if (!anchor && usage)
+            {
+                UsageMap::const_iterator u = usage->find(Key(pts[i]));
+                anchor = u != usage->end() && u->second.junction;
+            }
+            if (anchor)
+                anchors.push_back(i);
+        }
+
+        // a ring touching nothing else still needs a start, and anyone else
+        // with the same ring has to pick the same one.
+        if (anchors.empty())
+        {
+            unsigned lowest = 0;
+            for (unsigned i = 1; i < n; ++i)
+                if (Key(pts[i]) < Key(pts[lowest]))
+                    lowest = i;
+            anchors.push_back(lowest);
+        }
+
+        std::vector<bool> keep(n, false);
+        for (unsigned k = 0; k < anchors.size(); ++k)
+            keep[anchors[k]] = true;
+
+        std::vector<unsigned> stretch;
+        unsigned numStretches = ring ? anchors.size() : anchors.size()-1u;
+        for (unsigned k = 0; k < numStretches; ++k)
+        {
+            unsigned from = anchors[k];
+            unsigned to = anchors[(k+1) % anchors.size()];
+
+            stretch.clear();
+            unsigned i = from;
+            do {
+                stretch.push_back(i);
+                i = (i+1) % n;
+            } while (i != to);
+            stretch.push_back(to);
+
+            if (stretch.size() <= 2)
+                continue;
+
+            // simplify each stretch in a canonical direction, so a border walked
+            // the other way by a neighbor comes out the same.
+            Key first(pts[stretch.front()]), last(pts[stretch.back()]);
+            if (last < first ||
+                (last == first && Key(pts[stretch[stretch.size()-2]]) < Key(pts[stretch[1]])))
+            {
+                std::reverse(stretch.begin(), stretch.end());
+            }
+
+            douglasPeucker(pts, stretch, tolerance2, keep);
+        }
+
+        std::vector<osg::Vec3d> output;
+        output.reserve(n+1);
+        for (unsigned i = 0; i < n; ++i)
+            if (keep[i])
+                output.push_back(pts[i]);
+
+        if (output.size() < minSize || output.size() == n)
+            return;
+
+        if (closed)
+            output.push_back(output.front());
+
+        part->swap(output);
+    }
+}
+
+SimplifyFilter::SimplifyFilter() :
+SimplifyFilterOptions()
+{
+    //NOP
+}
+
+SimplifyFilter::SimplifyFilter( double tolerance ) :
+SimplifyFilterOptions()
+{
+    _tolerance = tolerance;
+}
+
+SimplifyFilter::SimplifyFilter( const Config& conf ):
+SimplifyFilterOptions( conf )
+{
+    //nop
+}
+
+FilterContext
+SimplifyFilter::push( FeatureList& input, FilterContext& context )
+{
+    if ( tolerance().get() <= 0.0 )
+        return context;
+
+    // find the junctions between all the features first, so that every
+    // feature sharing a border splits it in the same places.
+    UsageMap usage;
+    if ( preserveTopology() == true )
+    {
+        for( FeatureList::iterator i = input.begin(); i != input.end(); ++i )
+            if ( i->valid() && i->get()->getGeometry() )
+                recordParts( usage, i->get()->getGeometry() );
+    }
+
+    double tolerance2 = tolerance().get() * tolerance().get();
+
+    for( FeatureList::iterator i = input.begin(); i != input.end(); ++i )
+    {
+        Feature* feature = i->get();
+        if ( !feature || !feature->getGeometry() )
+            continue;
+
+        GeometryIterator iter( feature->getGeometry(), true );
+        while( iter.hasMore() )
+        {
+            Geometry* part = iter.next();
+            if ( !part->isPointSet() )
+            {
+                simplifyPart( part, preserveTopology() == true ? &usage : 0L, tolerance2 );
+            }
+        }
+    }
+
+    return context;
+}
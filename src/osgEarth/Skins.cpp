@@ -76,6 +76,7 @@ SkinResource::mergeConfig( const Config& conf )
 
     conf.get( "atlas", _atlasHint );
     conf.get( "read_options", _readOptions );
+    conf.get( "compression", _compression );
 }
 
 Config
@@ -106,6 +107,7 @@ SkinResource::getConfig() const
     
     conf.set( "atlas", _atlasHint );
     conf.set( "read_options", _readOptions );
+    conf.set( "compression", _compression );
 
     return conf;
 }
@@ -145,6 +147,12 @@ SkinResource::createTexture(osg::Image* image) const
         ImageUtils::flattenImage(image, layers);
         for (unsigned i = 0; i < layers.size(); ++i)
         {
+            // The flattened layers are private copies, so it's safe to
+            // mipmap (and optionally compress) them here, once per atlas.
+            ImageUtils::mipmapImageInPlace(layers[i].get());
+            if (compression().isSet())
+                ImageUtils::compressImageInPlace(layers[i].get(), compression().get());
+
             tex->setImage(i, const_cast<osg::Image*>(layers[i].get()));
         }
         tex->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
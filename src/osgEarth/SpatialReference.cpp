@@ -21,8 +21,10 @@
 #include <osgEarth/Registry>
 #include <osgEarth/Cube>
 #include <osgEarth/LocalTangentPlane>
+#include <osgEarth/StartupCache>
 #include <ogr_spatialref.h>
 #include <cpl_conv.h>
+#include <atomic>
 
 #define LC "[SpatialReference] "
 
@@ -30,6 +32,16 @@ using namespace osgEarth;
 
 namespace
 {
+    std::atomic<std::uint64_t> s_nextUID(0u);
+
+    // This thread's ThreadLocal for each SRS it has used, keyed by SRS uid.
+    // Entries are owned by their SRS; an entry whose SRS is gone is never
+    // looked up again, since uids aren't reused.
+    thread_local std::unordered_map<std::uint64_t, void*> t_srsLocals;
+
+    // past this many entries, start over so dead ones don't pile up
+    const std::size_t MAX_THREAD_LOCAL_SRS = 4096u;
+
     std::string
     getOGRAttrValue( void* _handle, const std::string& name, int child_num, bool lowercase =false)
     {
@@ -154,6 +166,7 @@ SpatialReference::SpatialReference(void* handle) :
     _is_spherical_mercator(false),
     _ellipsoidId(0u),
     _local("OE.SRS.Local"),
+    _uid(s_nextUID++),
     _mutex("OE.SRS")
 {
     _setup.srcHandle = handle;
@@ -175,6 +188,7 @@ SpatialReference::SpatialReference(const Key& key) :
     _is_spherical_mercator(false),
     _ellipsoidId(0u),
     _local("OE.SRS.Local"),
+    _uid(s_nextUID++),
     _mutex("OE.SRS")
 {
     // shortcut for spherical-mercator:
@@ -283,6 +297,20 @@ SpatialReference::SpatialReference(const Key& key) :
         _setup.horiz = key.horiz;
     }
 
+    // EPSG codes and user strings are looked up in the PROJ database,
+    // which is slow; use the WKT they resolved to on an earlier run.
+    bool resolve =
+        (_setup.type == INIT_USER && !_is_cube) ||
+        (_setup.type == INIT_PROJ && _setup.horiz.find("+init=") == 0);
+
+    std::string resolvedWKT;
+    if (resolve && StartupCache::getSRS(key.horizLower, resolvedWKT))
+    {
+        _setup.type = INIT_WKT;
+        _setup.horiz = resolvedWKT;
+        resolve = false;
+    }
+
     // next, resolve the vertical SRS:
     if ( !key.vert.empty() && !ciEquals(key.vert, "geodetic") )
     {
@@ -297,13 +325,33 @@ SpatialReference::SpatialReference(const Key& key) :
 
     // create a handle for this thread and establish validity.
     init();
+
+    if (resolve && _valid && !_wkt.empty() && _wkt.length() < 8192)
+    {
+        StartupCache::putSRS(key.horizLower, _wkt);
+    }
 }
 
 SpatialReference::ThreadLocal&
 SpatialReference::getLocal() const
 {
+    // Check this thread's own cache first so the common case never takes
+    // the PerThread lock, which every thread using this SRS contends on.
+    auto cached = t_srsLocals.find(_uid);
+    if (cached != t_srsLocals.end())
+    {
+        ThreadLocal& local = *static_cast<ThreadLocal*>(cached->second);
+        if (local._handle != nullptr)
+            return local;
+    }
+
     ThreadLocal& local = _local.get();
 
+    if (t_srsLocals.size() >= MAX_THREAD_LOCAL_SRS)
+        t_srsLocals.clear();
+
+    t_srsLocals[_uid] = &local;
+
     if (local._handle == nullptr)
     {
         local._threadId = std::this_thread::get_id();
@@ -915,7 +963,14 @@ SpatialReference::transform(std::vector<osg::Vec3d>& points,
     // trivial equivalency:
     if ( isEquivalentTo(outputSRS) )
         return true;
-    
+
+    return transformPoints(points, outputSRS);
+}
+
+bool
+SpatialReference::transformPoints(std::vector<osg::Vec3d>& points,
+                                  const SpatialReference*  outputSRS) const
+{
     bool success = false;
 
     // do the pre-transformation pass:
@@ -1067,6 +1122,8 @@ SpatialReference::transformXYPointArrays(
 
             return false;
         }
+
+        initFastPath(xform.mutable_value(), out_srs);
     }
 
     if (xform->_failed)
@@ -1074,9 +1131,94 @@ SpatialReference::transformXYPointArrays(
         return false;
     }
 
+    const double R = xform->_radius;
+
+    if (xform->_fastPath == FAST_PATH_GEOGRAPHIC_TO_SPHERICAL_MERCATOR)
+    {
+        // the poles project to infinity; let OGR decide what to do with them
+        bool inRange = true;
+        for (unsigned i = 0; i < count && inRange; ++i)
+            inRange = fabs(y[i]) < 89.9999;
+
+        if (inRange)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                x[i] = R * osg::DegreesToRadians(x[i]);
+                y[i] = R * log(tan(osg::PI_4 + 0.5*osg::DegreesToRadians(y[i])));
+            }
+            return true;
+        }
+    }
+
+    else if (xform->_fastPath == FAST_PATH_SPHERICAL_MERCATOR_TO_GEOGRAPHIC)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            x[i] = osg::RadiansToDegrees(x[i] / R);
+            y[i] = osg::RadiansToDegrees(2.0*atan(exp(y[i] / R)) - osg::PI_2);
+        }
+        return true;
+    }
+
     return OCTTransform(xform->_handle, count, x, y, 0L) > 0;
 }
 
+void
+SpatialReference::initFastPath(TransformInfo& xform, const SpatialReference* out_srs) const
+{
+    // Geographic <-> spherical mercator is closed-form, so skip OGR for it
+    // (it is by far the most common transform during feature compilation).
+    // Only do so if OGR agrees with the formulas; that rules out datum shifts,
+    // false origins and axis order surprises without having to parse any WKT.
+    if (isGeographic() && out_srs->isSphericalMercator())
+    {
+        xform._fastPath = FAST_PATH_GEOGRAPHIC_TO_SPHERICAL_MERCATOR;
+        xform._radius = out_srs->getEllipsoid()->getRadiusEquator();
+    }
+    else if (isSphericalMercator() && out_srs->isGeographic())
+    {
+        xform._fastPath = FAST_PATH_SPHERICAL_MERCATOR_TO_GEOGRAPHIC;
+        xform._radius = getEllipsoid()->getRadiusEquator();
+    }
+    else
+    {
+        return;
+    }
+
+    // probe points, lon/lat
+    const unsigned N = 4;
+    double lon[N] = { 0.0, -120.5, 170.25, 33.0 };
+    double lat[N] = { 0.0, 45.125, -60.5, 84.0 };
+
+    double x[N], y[N], fx[N], fy[N];
+    const double R = xform._radius;
+
+    for (unsigned i = 0; i < N; ++i)
+    {
+        double mx = R * osg::DegreesToRadians(lon[i]);
+        double my = R * log(tan(osg::PI_4 + 0.5*osg::DegreesToRadians(lat[i])));
+
+        if (xform._fastPath == FAST_PATH_GEOGRAPHIC_TO_SPHERICAL_MERCATOR)
+            x[i] = lon[i], y[i] = lat[i], fx[i] = mx, fy[i] = my;
+        else
+            x[i] = mx, y[i] = my, fx[i] = lon[i], fy[i] = lat[i];
+    }
+
+    double tolerance = xform._fastPath == FAST_PATH_GEOGRAPHIC_TO_SPHERICAL_MERCATOR ? 1e-4 : 1e-9;
+
+    bool agrees = OCTTransform(xform._handle, N, x, y, 0L) > 0;
+    for (unsigned i = 0; i < N && agrees; ++i)
+    {
+        agrees = fabs(x[i] - fx[i]) < tolerance && fabs(y[i] - fy[i]) < tolerance;
+    }
+
+    if (!agrees)
+    {
+        xform._fastPath = FAST_PATH_NONE;
+    }
+}
+
 
 bool
 SpatialReference::transformZ(std::vector<osg::Vec3d>& points,
@@ -1172,6 +1314,33 @@ SpatialReference::transformToWorld(const osg::Vec3d& input,
     }
 }
 
+bool
+SpatialReference::transformToWorld(std::vector<osg::Vec3d>& points) const
+{
+    if (!valid())
+        return false;
+
+    if ( isGeographic() || isCube() )
+    {
+        return transform(points, getGeocentricSRS());
+    }
+    else // isProjected
+    {
+        if ( _vdatum.valid() )
+        {
+            std::vector<osg::Vec3d> geo(points);
+            if ( !transform(geo, getGeographicSRS()) )
+                return false;
+
+            for (unsigned i = 0; i < points.size(); ++i)
+            {
+                points[i].z() = _vdatum->msl2hae( geo[i].y(), geo[i].x(), points[i].z() );
+            }
+        }
+        return true;
+    }
+}
+
 bool 
 SpatialReference::transformFromWorld(const osg::Vec3d& world,
                                      osg::Vec3d&       output,
@@ -1552,3 +1721,68 @@ SpatialReference::init()
     }
 }
 
+//------------------------------------------------------------------------
+
+#undef  LC
+#define LC "[SRSTransformer] "
+
+SRSTransformer::SRSTransformer() :
+    _equivalent(false)
+{
+    //nop
+}
+
+SRSTransformer::SRSTransformer(const SpatialReference* from, const SpatialReference* to) :
+    _from(from),
+    _to(to),
+    _equivalent(false)
+{
+    if (_from.valid() && _to.valid() && (!_from->valid() || !_to->valid()))
+    {
+        _from = nullptr, _to = nullptr;
+    }
+
+    if (valid())
+    {
+        _equivalent = _from->isEquivalentTo(_to.get());
+    }
+}
+
+bool
+SRSTransformer::transform(osg::Vec3d& inout) const
+{
+    return transform(inout, inout);
+}
+
+bool
+SRSTransformer::transform(const osg::Vec3d& input, osg::Vec3d& output) const
+{
+    if (!valid())
+        return false;
+
+    if (_equivalent)
+    {
+        output = input;
+        return true;
+    }
+
+    std::vector<osg::Vec3d> v(1, input);
+    if (_from->transformPoints(v, _to.get()))
+    {
+        output = v[0];
+        return true;
+    }
+    return false;
+}
+
+bool
+SRSTransformer::transform(std::vector<osg::Vec3d>& points) const
+{
+    if (!valid())
+        return false;
+
+    if (_equivalent || points.empty())
+        return true;
+
+    return _from->transformPoints(points, _to.get());
+}
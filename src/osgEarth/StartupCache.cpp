@@ -0,0 +1,375 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/StartupCache>
+#include <osgEarth/Threading>
+#include <osgEarth/Notify>
+#include <osgDB/FileUtils>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[StartupCache] "
+
+#define MAGIC "OESTARTUP1\n"
+
+// Past these sizes a table starts over, so the file can't grow forever
+#define MAX_CONFIGS 32u
+#define MAX_SRS 1024u
+
+namespace
+{
+    struct Storage
+    {
+        Threading::Mutex _mutex;
+        std::string _path;
+        bool _loaded = false;
+        bool _dirty = false;
+        std::unordered_map<std::uint64_t, Config> _configs;
+        std::unordered_map<std::string, std::string> _srs;
+
+        Storage()
+        {
+            const char* path = ::getenv("OSGEARTH_STARTUP_CACHE");
+            if (path)
+            {
+                _path = path;
+            }
+            else
+            {
+                const char* folder = ::getenv("OSGEARTH_CACHE_PATH");
+                if (folder)
+                    _path = std::string(folder) + "/startup_cache.bin";
+            }
+        }
+    };
+
+    // never destroyed, so it can be used during static destruction;
+    // the Saver writes it at exit instead
+    Storage& storage()
+    {
+        static Storage* s_storage = new Storage();
+        return *s_storage;
+    }
+
+    struct Saver
+    {
+        ~Saver() { StartupCache::save(); }
+    };
+    Saver s_saver;
+
+    // FNV-1a, 64 bits: the key of a document is its contents
+    std::uint64_t hash64(const std::string& input)
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : input)
+        {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h ^ (std::uint64_t)input.size();
+    }
+
+    struct Writer
+    {
+        std::string _buf;
+
+        void u8(std::uint8_t v) { _buf.push_back((char)v); }
+        void u32(std::uint32_t v) { _buf.append((const char*)&v, sizeof(v)); }
+        void u64(std::uint64_t v) { _buf.append((const char*)&v, sizeof(v)); }
+        void str(const std::string& v) { u32(v.size()); _buf.append(v); }
+
+        void config(const Config& conf)
+        {
+            str(conf.key());
+            str(conf.value());
+            str(conf.externalRef());
+            u8(conf.isLocation() ? 1u : 0u);
+            u32(conf.children().size());
+            for (auto& child : conf.children())
+                config(child);
+        }
+    };
+
+    struct Reader
+    {
+        const std::string& _buf;
+        std::size_t _pos;
+        bool _ok;
+
+        Reader(const std::string& buf, std::size_t pos) : _buf(buf), _pos(pos), _ok(true) { }
+
+        bool take(void* out, std::size_t n)
+        {
+            if (!_ok || _buf.size() - _pos < n)
+                return _ok = false;
+            ::memcpy(out, _buf.data() + _pos, n);
+            _pos += n;
+            return true;
+        }
+
+        std::uint8_t u8() { std::uint8_t v = 0; take(&v, sizeof(v)); return v; }
+        std::uint32_t u32() { std::uint32_t v = 0; take(&v, sizeof(v)); return v; }
+        std::uint64_t u64() { std::uint64_t v = 0; take(&v, sizeof(v)); return v; }
+
+        std::string str()
+        {
+            std::uint32_t n = u32();
+            if (!_ok || _buf.size() - _pos < n)
+            {
+                _ok = false;
+                return std::string();
+            }
+            std::string v(_buf, _pos, n);
+            _pos += n;
+            return v;
+        }
+
+        Config config(unsigned depth)
+        {
+            // a corrupt file can't send us into a deep recursion
+            if (depth > 256u)
+            {
+                _ok = false;
+                return Config();
+            }
+
+            std::string key = str();
+            std::string value = str();
+            Config conf(key, value);
+            conf.setExternalRef(str());
+            conf.setIsLocation(u8() != 0u);
+
+            std::uint32_t numChildren = u32();
+            for (std::uint32_t i = 0; i < numChildren && _ok; ++i)
+            {
+                conf.add(config(depth + 1u));
+            }
+            return conf;
+        }
+    };
+
+    // Reads the whole file in one go on first use
+    void loadLocked(Storage& s)
+    {
+        if (s._loaded)
+            return;
+        s._loaded = true;
+
+        if (s._path.empty())
+            return;
+
+        std::ifstream in(s._path.c_str(), std::ios::binary);
+        if (!in.is_open())
+            return;
+
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string data = buffer.str();
+
+        if (data.compare(0, ::strlen(MAGIC), MAGIC) != 0)
+        {
+            OE_INFO << LC << "Ignoring \"" << s._path << "\"; not a startup cache" << std::endl;
+            return;
+        }
+
+        Reader r(data, ::strlen(MAGIC));
+
+        std::uint32_t numConfigs = r.u32();
+        for (std::uint32_t i = 0; i < numConfigs && r._ok; ++i)
+        {
+            std::uint64_t key = r.u64();
+            s._configs[key] = r.config(0u);
+        }
+
+        std::uint32_t numSRS = r.u32();
+        for (std::uint32_t i = 0; i < numSRS && r._ok; ++i)
+        {
+            std::string init = r.str();
+            s._srs[init] = r.str();
+        }
+
+        if (!r._ok)
+        {
+            OE_WARN << LC << "\"" << s._path << "\" is damaged; starting over" << std::endl;
+            s._configs.clear();
+            s._srs.clear();
+            s._dirty = true;
+            return;
+        }
+
+        OE_INFO << LC << "Read " << s._configs.size() << " documents and "
+            << s._srs.size() << " SRS definitions from \"" << s._path << "\"" << std::endl;
+    }
+
+    void saveLocked(Storage& s)
+    {
+        if (!s._dirty || s._path.empty())
+            return;
+        s._dirty = false;
+
+        Writer w;
+        w._buf = MAGIC;
+
+        w.u32(s._configs.size());
+        for (auto& i : s._configs)
+        {
+            w.u64(i.first);
+            w.config(i.second);
+        }
+
+        w.u32(s._srs.size());
+        for (auto& i : s._srs)
+        {
+            w.str(i.first);
+            w.str(i.second);
+        }
+
+        // write a temporary file and swap it in, so that a crash or a
+        // second process never leaves a half-written cache behind
+        osgDB::makeDirectoryForFile(s._path);
+        std::string temp = s._path + ".tmp";
+        {
+            std::ofstream out(temp.c_str(), std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+                return;
+            out.write(w._buf.data(), w._buf.size());
+            if (!out.good())
+                return;
+        }
+
+        if (::rename(temp.c_str(), s._path.c_str()) != 0)
+        {
+            ::remove(s._path.c_str());
+            ::rename(temp.c_str(), s._path.c_str());
+        }
+    }
+}
+
+bool
+StartupCache::enabled()
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    return !s._path.empty();
+}
+
+void
+StartupCache::setPath(const std::string& path)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    s._path = path;
+    s._loaded = false;
+    s._dirty = false;
+    s._configs.clear();
+    s._srs.clear();
+}
+
+std::string
+StartupCache::getPath()
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    return s._path;
+}
+
+bool
+StartupCache::getConfig(const std::string& contents, Config& output)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    loadLocked(s);
+
+    auto i = s._configs.find(hash64(contents));
+    if (i == s._configs.end())
+        return false;
+
+    output = i->second;
+    return true;
+}
+
+void
+StartupCache::putConfig(const std::string& contents, const Config& conf)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    if (s._path.empty())
+        return;
+    loadLocked(s);
+
+    if (s._configs.size() >= MAX_CONFIGS)
+        s._configs.clear();
+
+    // store what the file will hold, without the referrers, so
+    // a copy of the document somewhere else gets its own
+    Writer w;
+    w.config(conf);
+    Reader r(w._buf, 0u);
+    s._configs[hash64(contents)] = r.config(0u);
+    s._dirty = true;
+}
+
+bool
+StartupCache::getSRS(const std::string& init, std::string& wkt)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    loadLocked(s);
+
+    auto i = s._srs.find(init);
+    if (i == s._srs.end())
+        return false;
+
+    wkt = i->second;
+    return true;
+}
+
+void
+StartupCache::putSRS(const std::string& init, const std::string& wkt)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    if (s._path.empty())
+        return;
+    loadLocked(s);
+
+    if (s._srs.size() >= MAX_SRS)
+        s._srs.clear();
+
+    std::string& entry = s._srs[init];
+    if (entry != wkt)
+    {
+        entry = wkt;
+        s._dirty = true;
+    }
+}
+
+void
+StartupCache::save()
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+    saveLocked(s);
+}
@@ -20,6 +20,9 @@
 #include <osg/NodeVisitor>
 #include <osg/BufferIndexBinding>
 #include <osg/ProxyNode>
+#include <osg/Texture>
+#include <typeinfo>
+#include <algorithm>
 
 #define LC "[StateSetCache] "
 
@@ -33,6 +36,106 @@ using namespace osgEarth;
 
 namespace
 {
+    // same as boost hash_combine
+    inline void hashCombine(std::size_t& seed, std::size_t value)
+    {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    // Hashes only what compare() also looks at, so that equal
+    // attributes always land in the same bucket.
+    std::size_t hashAttribute(const osg::StateAttribute* attr)
+    {
+        std::size_t hash = typeid(*attr).hash_code();
+        hashCombine(hash, (std::size_t)attr->getType());
+
+        const osg::Texture* tex = attr->asTexture();
+        if (tex)
+        {
+            hashCombine(hash, tex->getFilter(osg::Texture::MIN_FILTER));
+            hashCombine(hash, tex->getFilter(osg::Texture::MAG_FILTER));
+            hashCombine(hash, tex->getWrap(osg::Texture::WRAP_S));
+            hashCombine(hash, tex->getWrap(osg::Texture::WRAP_T));
+            for (unsigned i = 0; i < tex->getNumImages(); ++i)
+            {
+                const osg::Image* image = tex->getImage(i);
+                if (image)
+                {
+                    hashCombine(hash, image->s());
+                    hashCombine(hash, image->t());
+                    hashCombine(hash, image->r());
+                    hashCombine(hash, image->getPixelFormat());
+                    hashCombine(hash, image->getDataType());
+                }
+            }
+        }
+        return hash;
+    }
+
+    void hashAttributeList(std::size_t& hash, const osg::StateSet::AttributeList& attrs)
+    {
+        hashCombine(hash, attrs.size());
+        for (osg::StateSet::AttributeList::const_iterator i = attrs.begin(); i != attrs.end(); ++i)
+        {
+            hashCombine(hash, (std::size_t)i->first.first);
+            hashCombine(hash, (std::size_t)i->first.second);
+            hashCombine(hash, (std::size_t)i->second.second);
+            if (i->second.first.valid())
+                hashCombine(hash, hashAttribute(i->second.first.get()));
+        }
+    }
+
+    void hashModeList(std::size_t& hash, const osg::StateSet::ModeList& modes)
+    {
+        hashCombine(hash, modes.size());
+        for (osg::StateSet::ModeList::const_iterator i = modes.begin(); i != modes.end(); ++i)
+        {
+            hashCombine(hash, (std::size_t)i->first);
+            hashCombine(hash, (std::size_t)i->second);
+        }
+    }
+
+    std::size_t hashStateSet(const osg::StateSet* stateSet)
+    {
+        std::size_t hash = 0;
+        hashCombine(hash, stateSet->getRenderingHint());
+        hashCombine(hash, stateSet->getRenderBinMode());
+        hashCombine(hash, stateSet->getBinNumber());
+        hashCombine(hash, std::hash<std::string>()(stateSet->getBinName()));
+
+        hashAttributeList(hash, stateSet->getAttributeList());
+        hashModeList(hash, stateSet->getModeList());
+
+        const osg::StateSet::TextureAttributeList& texAttrs = stateSet->getTextureAttributeList();
+        for (unsigned unit = 0; unit < texAttrs.size(); ++unit)
+        {
+            if (!texAttrs[unit].empty())
+            {
+                hashCombine(hash, unit);
+                hashAttributeList(hash, texAttrs[unit]);
+            }
+        }
+
+        const osg::StateSet::TextureModeList& texModes = stateSet->getTextureModeList();
+        for (unsigned unit = 0; unit < texModes.size(); ++unit)
+        {
+            if (!texModes[unit].empty())
+            {
+                hashCombine(hash, unit);
+                hashModeList(hash, texModes[unit]);
+            }
+        }
+
+        const osg::StateSet::UniformList& uniforms = stateSet->getUniformList();
+        hashCombine(hash, uniforms.size());
+        for (osg::StateSet::UniformList::const_iterator i = uniforms.begin(); i != uniforms.end(); ++i)
+        {
+            hashCombine(hash, std::hash<std::string>()(i->first));
+        }
+
+        return hash;
+    }
+
     bool isEligible(osg::StateAttribute* attr)
     {
         if ( !attr )
@@ -144,6 +247,11 @@ namespace
         // assume: stateSet is safely referenced by caller
         void applyStateSet(osg::StateSet* stateSet)
         {
+            // Held by anyone besides its node and the caller? Then it may
+            // be a shared stateset in the live graph, so leave it alone.
+            if (stateSet->referenceCount() > 2)
+                return;
+
             osg::StateSet::AttributeList& attrs = stateSet->getAttributeList();
             for( osg::StateSet::AttributeList::iterator i = attrs.begin(); i != attrs.end(); ++i )
             {
@@ -247,42 +355,43 @@ namespace
 //------------------------------------------------------------------------
 
 StateSetCache::StateSetCache() :
-    _pruneCount       ( 0 ),
     _maxSize          ( DEFAULT_PRUNE_ACCESS_COUNT ),
     _attrShareAttempts( 0 ),
     _attrsIneligible  ( 0 ),
     _attrShareHits    ( 0 ),
-    _attrShareMisses  ( 0 ),
-    _mutex            ("StateSetCache(OE)")
+    _attrShareMisses  ( 0 )
 {
-    //nop
+    for (unsigned i = 0; i < NUM_SHARDS; ++i)
+        _shards[i]._mutex.setName("StateSetCache(OE)");
 }
 
 StateSetCache::~StateSetCache()
 {
-    Threading::ScopedMutexLock lock( _mutex );
-    prune();
+    //nop
 }
 
 void
 StateSetCache::releaseGLObjects(osg::State* state) const
 {
-    Threading::ScopedMutexLock lock( _mutex );
-    for(StateSetSet::const_iterator i = _stateSetCache.begin(); i != _stateSetCache.end(); ++i)
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
     {
-        i->get()->releaseGLObjects(state);
+        Threading::ScopedMutexLock lock(_shards[s]._mutex);
+        for (StateSetBuckets::const_iterator b = _shards[s]._stateSets.begin(); b != _shards[s]._stateSets.end(); ++b)
+        {
+            for (StateSetBucket::const_iterator i = b->second.begin(); i != b->second.end(); ++i)
+            {
+                osg::ref_ptr<osg::StateSet> stateSet;
+                if (i->lock(stateSet))
+                    stateSet->releaseGLObjects(state);
+            }
+        }
     }
-
 }
 
 void
 StateSetCache::setMaxSize(unsigned value)
 {
     _maxSize = value;
-    {
-        Threading::ScopedMutexLock lock( _mutex );
-        pruneIfNecessary();
-    }
 }
 
 void
@@ -337,46 +446,41 @@ StateSetCache::share(osg::ref_ptr<osg::StateSet>& input,
     osg::ref_ptr<osg::StateSet>& output,
     bool                         checkEligible)
 {
-    bool shared     = false;
-    //bool shareattrs = true;
-
-    if ( !checkEligible || eligible(input.get()) )
+    if ( input.valid() && (!checkEligible || eligible(input.get())) )
     {
-        Threading::ScopedMutexLock lock( _mutex );
+        std::size_t hash = hashStateSet(input.get());
+        Shard& shard = _shards[hash % NUM_SHARDS];
 
-        pruneIfNecessary();
+        Threading::ScopedMutexLock lock( shard._mutex );
 
-        //shareattrs = false;
+        pruneIfNecessary(shard);
 
-        std::pair<StateSetSet::iterator,bool> result = _stateSetCache.insert( input );
-        if ( result.second )
+        StateSetBucket& bucket = shard._stateSets[hash];
+        for (StateSetBucket::iterator i = bucket.begin(); i != bucket.end(); )
         {
-            // first use
-            output = input.get();
-            //shareattrs = true;
-            shared = false;
-        }
-        else
-        {
-            // found a share!
-            output = result.first->get();
-            shared = true;
+            osg::ref_ptr<osg::StateSet> cached;
+            if (i->lock(cached) == false)
+            {
+                i = bucket.erase(i);
+            }
+            else if (cached.get() == input.get() || cached->compare(*input.get(), true) == 0)
+            {
+                // found a share!
+                output = cached.get();
+                return cached.get() != input.get();
+            }
+            else
+            {
+                ++i;
+            }
         }
-    }
-    else
-    {
-        output = input.get();
-        shared = false;
-    }
 
-    // OBE.
-    //if ( shareattrs )
-    //{
-    //    ShareStateAttributes sa(this);
-    //    sa.applyStateSet( input.get() );
-    //}
+        // first use
+        bucket.push_back(input.get());
+    }
 
-    return shared;
+    output = input.get();
+    return false;
 }
 
 
@@ -388,27 +492,41 @@ StateSetCache::share(osg::ref_ptr<osg::StateAttribute>& input,
 {
     _attrShareAttempts++;
 
-    if ( !checkEligible || eligible(input.get()) )
+    if ( input.valid() && (!checkEligible || eligible(input.get())) )
     {
-        Threading::ScopedMutexLock lock( _mutex );
+        std::size_t hash = hashAttribute(input.get());
+        Shard& shard = _shards[hash % NUM_SHARDS];
 
-        pruneIfNecessary();
+        Threading::ScopedMutexLock lock( shard._mutex );
 
-        std::pair<StateAttributeSet::iterator,bool> result = _stateAttributeCache.insert( input );
-        if ( result.second )
-        {
-            // first use
-            output = input.get();
-            _attrShareMisses++;
-            return false;
-        }
-        else
+        pruneIfNecessary(shard);
+
+        StateAttributeBucket& bucket = shard._stateAttributes[hash];
+        for (StateAttributeBucket::iterator i = bucket.begin(); i != bucket.end(); )
         {
-            // found a share!
-            output = result.first->get();
-            _attrShareHits++;
-            return true;
+            osg::ref_ptr<osg::StateAttribute> cached;
+            if (i->lock(cached) == false)
+            {
+                i = bucket.erase(i);
+            }
+            else if (cached.get() == input.get() || cached->compare(*input.get()) == 0)
+            {
+                // found a share!
+                output = cached.get();
+                _attrShareHits++;
+                return cached.get() != input.get();
+            }
+            else
+            {
+                ++i;
+            }
         }
+
+        // first use
+        bucket.push_back(input.get());
+        output = input.get();
+        _attrShareMisses++;
+        return false;
     }
     else
     {
@@ -419,71 +537,104 @@ StateSetCache::share(osg::ref_ptr<osg::StateAttribute>& input,
 }
 
 void
-StateSetCache::pruneIfNecessary()
+StateSetCache::pruneIfNecessary(Shard& shard)
 {
-    // assume an exclusve mutex is taken
-    if ( _pruneCount++ >= _maxSize )
+    // assume the shard's mutex is taken. Sweeping in proportion to the
+    // table size keeps the cost per access constant.
+    unsigned entries = shard._stateSets.size() + shard._stateAttributes.size();
+    if ( ++shard._accesses >= std::max(_maxSize, entries) )
     {
-        prune();
-        _pruneCount = 0;
+        prune(shard);
+        shard._accesses = 0;
     }
 }
 
 void
-StateSetCache::prune()
+StateSetCache::prune(Shard& shard)
 {
-    // assume an exclusive mutex is taken.
+    // assume the shard's mutex is taken.
 
     unsigned ss_count = 0, sa_count = 0;
 
-    for( StateSetSet::iterator i = _stateSetCache.begin(); i != _stateSetCache.end(); )
+    for (StateSetBuckets::iterator b = shard._stateSets.begin(); b != shard._stateSets.end(); )
     {
-        if ( i->get()->referenceCount() <= 1 )
+        StateSetBucket& bucket = b->second;
+        for (StateSetBucket::iterator i = bucket.begin(); i != bucket.end(); )
         {
-            // do not call releaseGLObjects since the attrs themselves might still be shared
-            _stateSetCache.erase( i++ );
-            ss_count++;
+            if (i->valid()) ++i;
+            else { i = bucket.erase(i); ss_count++; }
         }
+
+        if (bucket.empty())
+            b = shard._stateSets.erase(b);
         else
-        {
-            ++i;
-        }
+            ++b;
     }
 
-    for( StateAttributeSet::iterator i = _stateAttributeCache.begin(); i != _stateAttributeCache.end(); )
+    for (StateAttributeBuckets::iterator b = shard._stateAttributes.begin(); b != shard._stateAttributes.end(); )
     {
-        if ( i->get()->referenceCount() <= 1 )
+        StateAttributeBucket& bucket = b->second;
+        for (StateAttributeBucket::iterator i = bucket.begin(); i != bucket.end(); )
         {
-            i->get()->releaseGLObjects( 0L );
-            _stateAttributeCache.erase( i++ );
-            sa_count++;
+            if (i->valid()) ++i;
+            else { i = bucket.erase(i); sa_count++; }
         }
+
+        if (bucket.empty())
+            b = shard._stateAttributes.erase(b);
         else
-        {
-            ++i;
-        }
+            ++b;
     }
 
     OE_DEBUG << LC << "Pruned " << sa_count << " attributes, " << ss_count << " statesets" << std::endl;
 }
 
+unsigned
+StateSetCache::size() const
+{
+    unsigned count = 0u;
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
+    {
+        Threading::ScopedMutexLock lock(_shards[s]._mutex);
+        for (StateSetBuckets::const_iterator b = _shards[s]._stateSets.begin(); b != _shards[s]._stateSets.end(); ++b)
+            count += b->second.size();
+    }
+    return count;
+}
+
+std::size_t
+StateSetCache::hash(const osg::StateSet* stateSet)
+{
+    return stateSet ? hashStateSet(stateSet) : 0u;
+}
+
 void
 StateSetCache::clear()
 {
-    Threading::ScopedMutexLock lock( _mutex );
-
-    prune();
-    _stateAttributeCache.clear();
-    _stateSetCache.clear();
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
+    {
+        Threading::ScopedMutexLock lock(_shards[s]._mutex);
+        _shards[s]._stateAttributes.clear();
+        _shards[s]._stateSets.clear();
+        _shards[s]._accesses = 0;
+    }
 }
 
 void
 StateSetCache::protect()
 {
-    Threading::ScopedMutexLock lock( _mutex );
-    for(auto i : _stateSetCache)
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
     {
-        i->setDataVariance(osg::Object::DYNAMIC);
+        Threading::ScopedMutexLock lock(_shards[s]._mutex);
+        for (StateSetBuckets::iterator b = _shards[s]._stateSets.begin(); b != _shards[s]._stateSets.end(); ++b)
+        {
+            for (StateSetBucket::iterator i = b->second.begin(); i != b->second.end(); ++i)
+            {
+                osg::ref_ptr<osg::StateSet> stateSet;
+                if (i->lock(stateSet))
+                    stateSet->setDataVariance(osg::Object::DYNAMIC);
+            }
+        }
     }
 }
 
@@ -491,9 +642,8 @@ StateSetCache::protect()
 void
 StateSetCache::dumpStats()
 {
-    Threading::ScopedMutexLock lock( _mutex );
-
     OE_NOTICE << LC << "StateSetCache Dump:" << std::endl
+        << "    statesets         = " << size() << std::endl
         << "    attr attempts     = " << _attrShareAttempts << std::endl
         << "    ineligibles attrs = " << _attrsIneligible << std::endl
         << "    attr share hits   = " << _attrShareHits << std::endl
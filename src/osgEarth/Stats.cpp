@@ -0,0 +1,290 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/Stats>
+#include <osgEarth/Threading>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+#define LC "[Stats] "
+
+namespace
+{
+    using Key = std::pair<std::string, std::string>;
+
+    struct Exporting
+    {
+        UID _id;
+        Stats::Exporter _exporter;
+        unsigned _interval;
+        unsigned _lastFrame;
+    };
+
+    struct Storage
+    {
+        Threading::Mutex _mutex;
+        std::map<Key, std::unique_ptr<Stats::Counter>> _counters;
+        std::map<Key, std::unique_ptr<Stats::Gauge>> _gauges;
+        std::map<Key, std::unique_ptr<Stats::Timer>> _timers;
+
+        Threading::Mutex _exportersMutex;
+        std::vector<Exporting> _exporters;
+        UID _nextID = 0;
+
+        std::atomic<unsigned> _frame;
+        std::atomic<bool> _enabled;
+
+        Storage() : _frame(0u), _enabled(true) { }
+    };
+
+    // never destroyed, so statistics held in static references
+    // stay valid during static destruction
+    Storage& storage()
+    {
+        static Storage* s_storage = new Storage();
+        return *s_storage;
+    }
+
+    template<typename T>
+    T& getOrCreate(std::map<Key, std::unique_ptr<T>>& table, const std::string& name, const std::string& labels)
+    {
+        Storage& s = storage();
+        Threading::ScopedMutexLock lock(s._mutex);
+        std::unique_ptr<T>& ptr = table[Key(name, labels)];
+        if (!ptr)
+            ptr.reset(new T());
+        return *ptr;
+    }
+
+    std::string escapeJSON(const std::string& in)
+    {
+        std::string out;
+        for (char c : in)
+        {
+            if (c == '"' || c == '\\') out.push_back('\\');
+            out.push_back(c);
+        }
+        return out;
+    }
+
+    void writePrometheus(std::ostream& out, const std::string& name, const std::string& labels, double value)
+    {
+        out << name;
+        if (!labels.empty())
+            out << '{' << labels << '}';
+        out << ' ' << value << '\n';
+    }
+}
+
+void
+Stats::Timer::record(std::chrono::nanoseconds duration)
+{
+    std::uint64_t ns = duration.count() > 0 ? (std::uint64_t)duration.count() : 0u;
+    _count.fetch_add(1u, std::memory_order_relaxed);
+    _sumNs.fetch_add(ns, std::memory_order_relaxed);
+    std::uint64_t prev = _maxNs.load(std::memory_order_relaxed);
+    while (ns > prev && !_maxNs.compare_exchange_weak(prev, ns, std::memory_order_relaxed));
+}
+
+Stats::Counter&
+Stats::counter(const std::string& name, const std::string& labels)
+{
+    return getOrCreate(storage()._counters, name, labels);
+}
+
+Stats::Gauge&
+Stats::gauge(const std::string& name, const std::string& labels)
+{
+    return getOrCreate(storage()._gauges, name, labels);
+}
+
+Stats::Timer&
+Stats::timer(const std::string& name, const std::string& labels)
+{
+    return getOrCreate(storage()._timers, name, labels);
+}
+
+void
+Stats::snapshot(Snapshot& output)
+{
+    output.clear();
+
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._mutex);
+
+    output.reserve(s._counters.size() + s._gauges.size() + s._timers.size());
+
+    for (auto& i : s._counters)
+    {
+        Sample sample = { i.first.first, i.first.second, TYPE_COUNTER, (double)i.second->get(), 0u, 0.0 };
+        output.push_back(sample);
+    }
+    for (auto& i : s._gauges)
+    {
+        Sample sample = { i.first.first, i.first.second, TYPE_GAUGE, (double)i.second->get(), 0u, 0.0 };
+        output.push_back(sample);
+    }
+    for (auto& i : s._timers)
+    {
+        Sample sample = { i.first.first, i.first.second, TYPE_TIMER, i.second->sumMs(), i.second->count(), i.second->maxMs() };
+        output.push_back(sample);
+    }
+
+    std::stable_sort(output.begin(), output.end(), [](const Sample& lhs, const Sample& rhs) {
+        return lhs.name < rhs.name || (lhs.name == rhs.name && lhs.labels < rhs.labels);
+    });
+}
+
+UID
+Stats::addExporter(const Exporter& exporter, unsigned interval)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._exportersMutex);
+    Exporting e;
+    e._id = s._nextID++;
+    e._exporter = exporter;
+    e._interval = std::max(interval, 1u);
+    e._lastFrame = s._frame;
+    s._exporters.push_back(e);
+    return e._id;
+}
+
+void
+Stats::removeExporter(UID id)
+{
+    Storage& s = storage();
+    Threading::ScopedMutexLock lock(s._exportersMutex);
+    for (auto i = s._exporters.begin(); i != s._exporters.end(); ++i)
+    {
+        if (i->_id == id)
+        {
+            s._exporters.erase(i);
+            break;
+        }
+    }
+}
+
+void
+Stats::frame(unsigned frameNumber)
+{
+    Storage& s = storage();
+
+    unsigned prev = s._frame.load();
+    do {
+        if (frameNumber <= prev)
+            return;
+    } while (!s._frame.compare_exchange_weak(prev, frameNumber));
+
+    // copy the due exporters so they can add or remove exporters
+    std::vector<Exporter> due;
+    {
+        Threading::ScopedMutexLock lock(s._exportersMutex);
+        for (auto& e : s._exporters)
+        {
+            if (frameNumber - e._lastFrame >= e._interval)
+            {
+                e._lastFrame = frameNumber;
+                due.push_back(e._exporter);
+            }
+        }
+    }
+
+    if (!due.empty())
+    {
+        Snapshot snap;
+        snapshot(snap);
+        for (auto& exporter : due)
+            exporter(snap, frameNumber);
+    }
+}
+
+bool
+Stats::enabled()
+{
+    return storage()._enabled;
+}
+
+void
+Stats::setEnabled(bool value)
+{
+    storage()._enabled = value;
+}
+
+std::string
+Stats::layerLabel(const std::string& layerName)
+{
+    return "layer=\"" + escapeJSON(layerName) + "\"";
+}
+
+std::string
+Stats::toJSON(const Snapshot& snapshot)
+{
+    std::ostringstream out;
+    out << std::setprecision(6) << "{\"stats\":[";
+    for (unsigned i = 0; i < snapshot.size(); ++i)
+    {
+        const Sample& s = snapshot[i];
+        out << (i > 0 ? "," : "")
+            << "{\"name\":\"" << escapeJSON(s.name) << "\"";
+        if (!s.labels.empty())
+            out << ",\"labels\":\"" << escapeJSON(s.labels) << "\"";
+        if (s.type == TYPE_COUNTER)
+            out << ",\"type\":\"counter\",\"value\":" << s.value;
+        else if (s.type == TYPE_GAUGE)
+            out << ",\"type\":\"gauge\",\"value\":" << s.value;
+        else
+            out << ",\"type\":\"timer\",\"count\":" << s.count << ",\"sum_ms\":" << s.value << ",\"max_ms\":" << s.max;
+        out << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+std::string
+Stats::toPrometheus(const Snapshot& snapshot)
+{
+    std::ostringstream out;
+    out << std::setprecision(6);
+    std::string lastName;
+    for (auto& s : snapshot)
+    {
+        if (s.name != lastName)
+        {
+            out << "# TYPE " << s.name << (s.type == TYPE_COUNTER ? " counter" : s.type == TYPE_GAUGE ? " gauge" : " summary") << '\n';
+            lastName = s.name;
+        }
+
+        if (s.type == TYPE_TIMER)
+        {
+            writePrometheus(out, s.name + "_count", s.labels, (double)s.count);
+            writePrometheus(out, s.name + "_sum", s.labels, s.value * 0.001);
+            writePrometheus(out, s.name + "_max", s.labels, s.max * 0.001);
+        }
+        else
+        {
+            writePrometheus(out, s.name, s.labels, s.value);
+        }
+    }
+    return out.str();
+}
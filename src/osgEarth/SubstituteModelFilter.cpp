@@ -98,6 +98,7 @@ SubstituteModelFilter::SubstituteModelFilter( const Style& style ) :
 _style                ( style ),
 _cluster              ( false ),
 _useDrawInstanced     ( true ),
+_useGPUCulling        ( true ),
 _merge                ( true ),
 _normalScalingRequired( false ),
 _instanceCache        ( false )     // cache per object so MT not required
@@ -511,7 +512,7 @@ SubstituteModelFilter::process(const FeatureList&           features,
     // active DrawInstanced if required:
     if ( _useDrawInstanced )
     {
-        DrawInstanced::convertGraphToUseDrawInstanced( attachPoint );
+        DrawInstanced::convertGraphToUseDrawInstanced( attachPoint, _useGPUCulling );
 
         // install a shader program to render draw-instanced.
         DrawInstanced::install( attachPoint->getOrCreateStateSet() );
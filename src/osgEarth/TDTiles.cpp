@@ -26,12 +26,20 @@
 #include <osgEarth/NetworkMonitor>
 #include <osgEarth/Threading>
 #include <osgEarth/GLUtils>
+#include <osgEarth/HiZCuller>
 #include <osgDB/FileNameUtils>
 #include <osgDB/Registry>
 #include <osgUtil/IncrementalCompileOperation>
 #include <osg/ShapeDrawable>
+#include <osg/Geometry>
+#include <osg/Texture>
 #include <osg/PolygonMode>
 #include <osgEarth/LineDrawable>
+#include <rapidjson/reader.h>
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include <set>
+#include <cstring>
 
 using namespace osgEarth;
 using namespace osgEarth::Threading;
@@ -162,23 +170,28 @@ BoundingVolume::fromJSON(const Json::Value& value)
                 values[index] = (*j).asDouble();
                 index++;
             }
-            Json::Value::const_iterator i = a.begin();
-            osg::Vec3d center(values[0], values[1], values[2]);
-            osg::Vec3d xvec(values[3], values[4], values[5]);
-            osg::Vec3d yvec(values[6], values[7], values[8]);
-            osg::Vec3d zvec(values[9], values[10], values[11]);
-
-            box()->expandBy(center+xvec);
-            box()->expandBy(center-xvec);
-            box()->expandBy(center+yvec);
-            box()->expandBy(center-yvec);
-            box()->expandBy(center+zvec);
-            box()->expandBy(center-zvec);
+            setBox(values);
         }
         else OE_WARN << "Invalid box array" << std::endl;
     }
 }
 
+void
+BoundingVolume::setBox(const double* values)
+{
+    osg::Vec3d center(values[0], values[1], values[2]);
+    osg::Vec3d xvec(values[3], values[4], values[5]);
+    osg::Vec3d yvec(values[6], values[7], values[8]);
+    osg::Vec3d zvec(values[9], values[10], values[11]);
+
+    box()->expandBy(center+xvec);
+    box()->expandBy(center-xvec);
+    box()->expandBy(center+yvec);
+    box()->expandBy(center-yvec);
+    box()->expandBy(center+zvec);
+    box()->expandBy(center-zvec);
+}
+
 Json::Value
 BoundingVolume::getJSON() const
 {
@@ -425,18 +438,714 @@ Tileset::getJSON() const
     return value;
 }
 
+namespace
+{
+    /**
+     * SAX handler that builds a Tileset directly from the JSON text, so
+     * that no document tree exists alongside the tile tree. Members that
+     * the Tileset doesn't model are skipped without being stored.
+     */
+    class TilesetHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, TilesetHandler>
+    {
+    public:
+        TilesetHandler(Tileset* tileset, const URIContext& uc) :
+            _tileset(tileset),
+            _uc(uc),
+            _volumeTarget(nullptr)
+        {
+            //nop
+        }
+
+        bool Null() { return true; }
+
+        bool Bool(bool b) { return true; }
+
+        bool Int(int i) { return Double((double)i); }
+        bool Uint(unsigned u) { return Double((double)u); }
+        bool Int64(int64_t i) { return Double((double)i); }
+        bool Uint64(uint64_t u) { return Double((double)u); }
+
+        bool Double(double d)
+        {
+            switch (top())
+            {
+            case CX_NUMBERS: _numbers.push_back(d); break;
+            case CX_TILESET: if (_key == "geometricError") _tileset->geometricError() = d; break;
+            case CX_TILE: if (_key == "geometricError") tile()->geometricError() = d; break;
+            case CX_IMPLICIT:
+                if (_key == "subtreeLevels") implicit()->_subtreeLevels = (unsigned)d;
+                else if (_key == "availableLevels") implicit()->_availableLevels = (unsigned)d;
+                else if (_key == "maximumLevel") implicit()->_availableLevels = (unsigned)d + 1u;
+                break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool String(const char* str, rapidjson::SizeType length, bool copy)
+        {
+            std::string value(str, length);
+            switch (top())
+            {
+            case CX_ASSET:
+                if (_key == "version") _asset.version() = value;
+                else if (_key == "tilesetVersion") _asset.tilesetVersion() = value;
+                else if (_key == "gltfUpAxis") _asset.gltfUpAxis() = value;
+                break;
+            case CX_TILE:
+                if (_key == "refine") tile()->refine() = osgEarth::ciEquals(value, "ADD") ? REFINE_ADD : REFINE_REPLACE;
+                break;
+            case CX_CONTENT:
+                if (_key == "uri" || _key == "url") _content.uri() = URI(value, _uc);
+                break;
+            case CX_IMPLICIT:
+                if (_key == "subdivisionScheme") implicit()->_octree = osgEarth::ciEquals(value, "OCTREE");
+                break;
+            case CX_SUBTREES:
+                if (_key == "uri" || _key == "url") implicit()->_subtreeTemplate = value;
+                break;
+            default: break;
+            }
+            return true;
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, bool copy)
+        {
+            _key.assign(str, length);
+            return true;
+        }
+
+        bool StartObject()
+        {
+            switch (top())
+            {
+            case CX_NONE:
+                push(CX_TILESET);
+                break;
+            case CX_TILESET:
+                if (_key == "asset") push(CX_ASSET);
+                else if (_key == "boundingVolume") beginVolume(&_tileset->boundingVolume());
+                else if (_key == "root") beginTile();
+                else push(CX_SKIP);
+                break;
+            case CX_TILE:
+                if (_key == "boundingVolume") beginVolume(&tile()->boundingVolume());
+                else if (_key == "viewerRequestVolume") beginVolume(&tile()->viewerRequestVolume());
+                else if (_key == "content") { _content = TileContent(); push(CX_CONTENT); }
+                else if (_key == "implicitTiling") beginImplicit();
+                else if (_key == "extensions") push(CX_TILE_EXTENSIONS);
+                else push(CX_SKIP);
+                break;
+            case CX_TILE_EXTENSIONS:
+                if (_key == "3DTILES_implicit_tiling") beginImplicit();
+                else push(CX_SKIP);
+                break;
+            case CX_CHILDREN:
+                beginTile();
+                break;
+            case CX_CONTENT:
+                if (_key == "boundingVolume") beginVolume(&_content.boundingVolume());
+                else push(CX_SKIP);
+                break;
+            case CX_IMPLICIT:
+                if (_key == "subtrees") push(CX_SUBTREES);
+                else push(CX_SKIP);
+                break;
+            default:
+                push(CX_SKIP);
+                break;
+            }
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType memberCount)
+        {
+            Context cx = top();
+            pop();
+
+            switch (cx)
+            {
+            case CX_ASSET:
+                _tileset->asset() = _asset;
+                break;
+            case CX_VOLUME:
+                *_volumeTarget = _volume;
+                _volumeTarget = nullptr;
+                break;
+            case CX_CONTENT:
+                tile()->content() = _content;
+                break;
+            case CX_TILE:
+                endTile();
+                break;
+            default:
+                break;
+            }
+            return true;
+        }
+
+        bool StartArray()
+        {
+            switch (top())
+            {
+            case CX_VOLUME:
+                if (_key == "region" || _key == "sphere" || _key == "box") beginNumbers();
+                else push(CX_SKIP);
+                break;
+            case CX_TILE:
+                if (_key == "children") push(CX_CHILDREN);
+                else if (_key == "transform") beginNumbers();
+                else push(CX_SKIP);
+                break;
+            default:
+                push(CX_SKIP);
+                break;
+            }
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType elementCount)
+        {
+            Context cx = top();
+            pop();
+
+            if (cx == CX_NUMBERS)
+            {
+                endNumbers();
+            }
+            return true;
+        }
+
+    private:
+        enum Context
+        {
+            CX_NONE,
+            CX_TILESET,         // the top-level object
+            CX_ASSET,
+            CX_VOLUME,          // a boundingVolume or viewerRequestVolume
+            CX_NUMBERS,         // an array of numbers (volume or transform)
+            CX_TILE,
+            CX_TILE_EXTENSIONS,
+            CX_CHILDREN,
+            CX_CONTENT,
+            CX_IMPLICIT,
+            CX_SUBTREES,
+            CX_SKIP
+        };
+
+        struct TileState
+        {
+            osg::ref_ptr<Tile> _tile;
+            osg::ref_ptr<ImplicitTiling> _implicit;
+            std::vector<double> _box; // raw oriented box, for implicit tiling
+        };
+
+        Tileset* _tileset;
+        URIContext _uc;
+
+        std::vector<Context> _stack;
+        std::string _key;
+
+        std::vector<TileState> _tiles;
+        Asset _asset;
+        TileContent _content;
+        BoundingVolume _volume;
+        optional<BoundingVolume>* _volumeTarget;
+        std::string _numbersKey;
+        std::vector<double> _numbers;
+
+        Context top() const { return _stack.empty() ? CX_NONE : _stack.back(); }
+        void push(Context cx) { _stack.push_back(cx); }
+        void pop() { _stack.pop_back(); }
+
+        Tile* tile() { return _tiles.back()._tile.get(); }
+        ImplicitTiling* implicit() { return _tiles.back()._implicit.get(); }
+
+        void beginTile()
+        {
+            osg::ref_ptr<Tile> tile = new Tile();
+            if (_tiles.empty())
+                _tileset->root() = tile;
+            else
+                _tiles.back()._tile->children().push_back(tile);
+
+            _tiles.emplace_back();
+            _tiles.back()._tile = tile;
+            push(CX_TILE);
+        }
+
+        void endTile()
+        {
+            TileState& state = _tiles.back();
+
+            if (state._implicit.valid())
+            {
+                // The tile itself becomes a placeholder for its root subtree
+                ImplicitTiling* implicit = state._implicit.get();
+                Tile* tile = state._tile.get();
+
+                if (tile->content().isSet() && tile->content()->uri().isSet())
+                    implicit->_contentTemplate = tile->content()->uri()->base();
+                implicit->_context = _uc;
+                implicit->_rootGeometricError = tile->geometricError().get();
+
+                if (tile->boundingVolume()->region().isSet())
+                {
+                    implicit->_rootRegion = tile->boundingVolume()->region().get();
+                }
+                else if (state._box.size() == 12)
+                {
+                    std::copy(state._box.begin(), state._box.end(), implicit->_rootBox);
+                    implicit->_hasRootBox = true;
+                }
+
+                if (implicit->_subtreeTemplate.empty() || implicit->_subtreeLevels == 0u ||
+                    (!implicit->_rootRegion.isSet() && !implicit->_hasRootBox))
+                {
+                    OE_WARN << LC << "Invalid implicit tiling; tile will have no descendants" << std::endl;
+                }
+                else
+                {
+                    tile->content() = TileContent();
+                    tile->content()->uri() = implicit->getSubtreeURI(0, 0, 0, 0);
+                    tile->implicitTiling() = implicit;
+                }
+            }
+
+            _tiles.pop_back();
+        }
+
+        void beginVolume(optional<BoundingVolume>* target)
+        {
+            _volume = BoundingVolume();
+            _volumeTarget = target;
+            push(CX_VOLUME);
+        }
+
+        void beginImplicit()
+        {
+            _tiles.back()._implicit = new ImplicitTiling();
+            push(CX_IMPLICIT);
+        }
+
+        void beginNumbers()
+        {
+            _numbersKey = _key;
+            _numbers.clear();
+            push(CX_NUMBERS);
+        }
+
+        void endNumbers()
+        {
+            const std::vector<double>& n = _numbers;
+
+            if (top() == CX_TILE)
+            {
+                if (_numbersKey == "transform" && n.size() == 16)
+                    tile()->transform() = osg::Matrix(n.data());
+                return;
+            }
+
+            // volume arrays
+            if (_numbersKey == "region")
+            {
+                if (n.size() == 6)
+                {
+                    _volume.region()->xMin() = n[0];
+                    _volume.region()->yMin() = n[1];
+                    _volume.region()->xMax() = n[2];
+                    _volume.region()->yMax() = n[3];
+                    _volume.region()->zMin() = n[4];
+                    _volume.region()->zMax() = n[5];
+                }
+                else OE_WARN << "Invalid region array" << std::endl;
+            }
+            else if (_numbersKey == "sphere")
+            {
+                if (n.size() == 4)
+                {
+                    _volume.sphere()->center().set(n[0], n[1], n[2]);
+                    _volume.sphere()->radius() = n[3];
+                }
+            }
+            else if (_numbersKey == "box")
+            {
+                if (n.size() == 12)
+                {
+                    _volume.setBox(n.data());
+                    if (!_tiles.empty() && _volumeTarget == &tile()->boundingVolume())
+                        _tiles.back()._box = n;
+                }
+                else OE_WARN << "Invalid box array" << std::endl;
+            }
+        }
+    };
+}
+
 Tileset*
 Tileset::create(const std::string& json, const URIContext& uc)
 {
-    Json::Reader reader;
-    Json::Value root(Json::objectValue);
-    if (!reader.parse(json, root, false))
+    OE_PROFILING_ZONE;
+
+    osg::ref_ptr<Tileset> tileset = new Tileset();
+    TilesetHandler handler(tileset.get(), uc);
+
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(json.c_str());
+    rapidjson::ParseResult ok = reader.Parse(stream, handler);
+    if (!ok)
+    {
+        OE_WARN << LC << "Failed to parse tileset: " << rapidjson::GetParseError_En(ok.Code())
+            << " at offset " << ok.Offset() << std::endl;
         return NULL;
+    }
+
+    return tileset.release();
+}
+
+//........................................................................
+
+namespace
+{
+    std::string expandTemplate(const std::string& t, unsigned level, unsigned x, unsigned y, unsigned z)
+    {
+        std::string r = t;
+        replaceIn(r, "{level}", std::to_string(level));
+        replaceIn(r, "{x}", std::to_string(x));
+        replaceIn(r, "{y}", std::to_string(y));
+        replaceIn(r, "{z}", std::to_string(z));
+        return r;
+    }
+
+    // Morton (Z-order) index of a tile within its level
+    uint64_t morton(unsigned x, unsigned y, unsigned z, bool octree)
+    {
+        uint64_t m = 0;
+        unsigned dims = octree ? 3u : 2u;
+        for (unsigned b = 0; b < 21u; ++b)
+        {
+            m |= (uint64_t)((x >> b) & 1u) << (b * dims);
+            m |= (uint64_t)((y >> b) & 1u) << (b * dims + 1u);
+            if (octree)
+                m |= (uint64_t)((z >> b) & 1u) << (b * dims + 2u);
+        }
+        return m;
+    }
+
+    // Index of the first tile of a level within a subtree's availability
+    uint64_t levelOffset(unsigned level, bool octree)
+    {
+        uint64_t n = octree ? 8u : 4u;
+        uint64_t p = 1u;
+        for (unsigned i = 0; i < level; ++i)
+            p *= n;
+        return (p - 1u) / (n - 1u);
+    }
+
+    // One availability bitstream (or constant) from a subtree file
+    struct Availability
+    {
+        Availability() : _constant(true), _value(false), _bits(nullptr), _size(0u) { }
+        bool _constant;
+        bool _value;
+        const unsigned char* _bits;
+        std::size_t _size;
+
+        bool get(uint64_t index) const
+        {
+            if (_constant)
+                return _value;
+            if ((index >> 3) >= _size)
+                return false;
+            return ((_bits[index >> 3] >> (index & 7u)) & 1u) != 0u;
+        }
+    };
+
+    // The parsed contents of a subtree file
+    struct Subtree
+    {
+        std::vector<std::string> _buffers;
+        struct View { unsigned _buffer; std::size_t _offset, _length; };
+        std::vector<View> _views;
+        Availability _tiles, _content, _childSubtrees;
+
+        bool parseAvailability(const rapidjson::Value& v, Availability& out) const
+        {
+            if (!v.IsObject())
+                return false;
+
+            if (v.HasMember("constant") && v["constant"].IsNumber())
+            {
+                out._constant = true;
+                out._value = v["constant"].GetInt() != 0;
+                return true;
+            }
+
+            const char* key = v.HasMember("bitstream") ? "bitstream" : "bufferView";
+            if (!v.HasMember(key) || !v[key].IsUint() || v[key].GetUint() >= _views.size())
+                return false;
+
+            const View& view = _views[v[key].GetUint()];
+            if (view._buffer >= _buffers.size() || view._offset + view._length > _buffers[view._buffer].size())
+                return false;
+
+            out._constant = false;
+            out._bits = (const unsigned char*)_buffers[view._buffer].data() + view._offset;
+            out._size = view._length;
+            return true;
+        }
+
+        bool parse(const std::string& data, const URI& uri, const osgDB::Options* options)
+        {
+            std::string json;
+            std::string binary;
+
+            if (data.size() >= 24 && data.compare(0, 4, "subt") == 0)
+            {
+                uint64_t jsonLength, binaryLength;
+                memcpy(&jsonLength, data.data() + 8, 8);
+                memcpy(&binaryLength, data.data() + 16, 8);
+                if (24u + jsonLength + binaryLength > data.size())
+                    return false;
+                json = data.substr(24, jsonLength);
+                binary = data.substr(24 + jsonLength, binaryLength);
+            }
+            else
+            {
+                json = data;
+            }
+
+            rapidjson::Document doc;
+            doc.Parse(json.c_str(), json.size());
+            if (doc.HasParseError() || !doc.IsObject())
+                return false;
+
+            if (doc.HasMember("buffers") && doc["buffers"].IsArray())
+            {
+                for (auto& b : doc["buffers"].GetArray())
+                {
+                    if (b.HasMember("uri") && b["uri"].IsString())
+                    {
+                        URI bufferURI(b["uri"].GetString(), URIContext(uri.full()));
+                        osgEarth::ReadResult rr = bufferURI.readString(options);
+                        if (rr.failed())
+                            return false;
+                        _buffers.push_back(rr.getString());
+                    }
+                    else
+                    {
+                        _buffers.push_back(binary);
+                    }
+                }
+            }
+
+            if (doc.HasMember("bufferViews") && doc["bufferViews"].IsArray())
+            {
+                for (auto& v : doc["bufferViews"].GetArray())
+                {
+                    View view;
+                    view._buffer = v.HasMember("buffer") ? v["buffer"].GetUint() : 0u;
+                    view._offset = v.HasMember("byteOffset") ? (std::size_t)v["byteOffset"].GetUint64() : 0u;
+                    view._length = v.HasMember("byteLength") ? (std::size_t)v["byteLength"].GetUint64() : 0u;
+                    _views.push_back(view);
+                }
+            }
+
+            if (!doc.HasMember("tileAvailability") || !parseAvailability(doc["tileAvailability"], _tiles))
+                return false;
+
+            // 1.1 has an array (one per content); the extension has one object
+            if (doc.HasMember("contentAvailability"))
+            {
+                const rapidjson::Value& c = doc["contentAvailability"];
+                if (c.IsArray() && c.Size() > 0)
+                    parseAvailability(c[0], _content);
+                else
+                    parseAvailability(c, _content);
+            }
+
+            if (doc.HasMember("childSubtreeAvailability"))
+                parseAvailability(doc["childSubtreeAvailability"], _childSubtrees);
+
+            return true;
+        }
+    };
+}
+
+ImplicitTiling::ImplicitTiling() :
+    _octree(false),
+    _subtreeLevels(0u),
+    _availableLevels(0u),
+    _hasRootBox(false),
+    _rootGeometricError(0.0)
+{
+    //nop
+}
+
+URI
+ImplicitTiling::getSubtreeURI(unsigned level, unsigned x, unsigned y, unsigned z) const
+{
+    return URI(expandTemplate(_subtreeTemplate, level, x, y, z), _context);
+}
+
+Tile*
+ImplicitTiling::createTile(unsigned level, unsigned x, unsigned y, unsigned z) const
+{
+    Tile* tile = new Tile();
+
+    double n = (double)(1u << level);
+    tile->geometricError() = _rootGeometricError / n;
+
+    BoundingVolume volume;
+    if (_rootRegion.isSet())
+    {
+        const osg::BoundingBoxd& r = _rootRegion.get();
+        double dx = (r.xMax() - r.xMin()) / n;
+        double dy = (r.yMax() - r.yMin()) / n;
+        volume.region()->xMin() = r.xMin() + dx * (double)x;
+        volume.region()->xMax() = r.xMin() + dx * (double)(x + 1u);
+        volume.region()->yMin() = r.yMin() + dy * (double)y;
+        volume.region()->yMax() = r.yMin() + dy * (double)(y + 1u);
+        if (_octree)
+        {
+            double dz = (r.zMax() - r.zMin()) / n;
+            volume.region()->zMin() = r.zMin() + dz * (double)z;
+            volume.region()->zMax() = r.zMin() + dz * (double)(z + 1u);
+        }
+        else
+        {
+            volume.region()->zMin() = r.zMin();
+            volume.region()->zMax() = r.zMax();
+        }
+    }
+    else
+    {
+        // subdivide the oriented box along its half-axes
+        const double* b = _rootBox;
+        osg::Vec3d center(b[0], b[1], b[2]);
+        osg::Vec3d xaxis(b[3], b[4], b[5]), yaxis(b[6], b[7], b[8]), zaxis(b[9], b[10], b[11]);
+
+        center += xaxis * ((2.0 * x + 1.0) / n - 1.0);
+        center += yaxis * ((2.0 * y + 1.0) / n - 1.0);
+        xaxis /= n;
+        yaxis /= n;
+        if (_octree)
+        {
+            center += zaxis * ((2.0 * z + 1.0) / n - 1.0);
+            zaxis /= n;
+        }
+
+        double values[12] = {
+            center.x(), center.y(), center.z(),
+            xaxis.x(), xaxis.y(), xaxis.z(),
+            yaxis.x(), yaxis.y(), yaxis.z(),
+            zaxis.x(), zaxis.y(), zaxis.z() };
+        volume.setBox(values);
+    }
+    tile->boundingVolume() = volume;
+
+    return tile;
+}
+
+Tile*
+ImplicitTiling::createSubtreeTile(unsigned level, unsigned x, unsigned y, unsigned z) const
+{
+    Tile* tile = createTile(level, x, y, z);
+    tile->content() = TileContent();
+    tile->content()->uri() = getSubtreeURI(level, x, y, z);
+    tile->implicitTiling() = const_cast<ImplicitTiling*>(this);
+    tile->_implicitLevel = level;
+    tile->_implicitX = x;
+    tile->_implicitY = y;
+    tile->_implicitZ = z;
+    return tile;
+}
+
+namespace
+{
+    Tile* materialize(
+        const ImplicitTiling& tiling, const Subtree& subtree,
+        unsigned localLevel, unsigned lx, unsigned ly, unsigned lz,
+        unsigned rootLevel, unsigned rx, unsigned ry, unsigned rz)
+    {
+        uint64_t index = levelOffset(localLevel, tiling._octree) + morton(lx, ly, lz, tiling._octree);
+        if (!subtree._tiles.get(index))
+            return nullptr;
+
+        unsigned level = rootLevel + localLevel;
+        unsigned x = (rx << localLevel) + lx;
+        unsigned y = (ry << localLevel) + ly;
+        unsigned z = (rz << localLevel) + lz;
+
+        osg::ref_ptr<Tile> tile = tiling.createTile(level, x, y, z);
+
+        if (subtree._content.get(index) && !tiling._contentTemplate.empty())
+        {
+            tile->content() = TileContent();
+            tile->content()->uri() = URI(expandTemplate(tiling._contentTemplate, level, x, y, z), tiling._context);
+        }
+
+        unsigned numChildren = tiling._octree ? 8u : 4u;
+        for (unsigned c = 0; c < numChildren; ++c)
+        {
+            unsigned cx = (lx << 1) + (c & 1u);
+            unsigned cy = (ly << 1) + ((c >> 1) & 1u);
+            unsigned cz = (lz << 1) + ((c >> 2) & 1u);
+
+            osg::ref_ptr<Tile> child;
+            if (localLevel + 1u < tiling._subtreeLevels)
+            {
+                child = materialize(tiling, subtree, localLevel + 1u, cx, cy, cz, rootLevel, rx, ry, rz);
+            }
+            else if (level + 1u < tiling._availableLevels &&
+                subtree._childSubtrees.get(morton(cx, cy, cz, tiling._octree)))
+            {
+                child = tiling.createSubtreeTile(
+                    level + 1u, (x << 1) + (c & 1u), (y << 1) + ((c >> 1) & 1u), (z << 1) + ((c >> 2) & 1u));
+            }
+
+            if (child.valid())
+            {
+                tile->children().push_back(child.get());
+            }
+        }
+
+        return tile.release();
+    }
+}
+
+Tileset*
+ImplicitTiling::readSubtree(
+    const URI& uri,
+    unsigned level, unsigned x, unsigned y, unsigned z,
+    const osgDB::Options* options) const
+{
+    OE_PROFILING_ZONE;
+
+    osgEarth::ReadResult rr = uri.readString(options);
+    if (rr.failed())
+    {
+        OE_WARN << LC << "Failed to read subtree " << uri.full() << ": " << rr.errorDetail() << std::endl;
+        return nullptr;
+    }
 
-    LoadContext lc;
-    lc._uc = uc;
+    Subtree subtree;
+    if (!subtree.parse(rr.getString(), uri, options))
+    {
+        OE_WARN << LC << "Invalid subtree " << uri.full() << std::endl;
+        return nullptr;
+    }
 
-    return new Tileset(root, lc);
+    osg::ref_ptr<Tile> root = materialize(*this, subtree, 0u, 0u, 0u, 0u, level, x, y, z);
+    if (!root.valid())
+    {
+        return nullptr;
+    }
+
+    Tileset* tileset = new Tileset();
+    tileset->root() = root;
+    tileset->geometricError() = root->geometricError().get();
+    return tileset;
 }
 
 static VirtualProgram* getOrCreateDebugVirtualProgram()
@@ -476,10 +1185,11 @@ namespace
 {
     struct LoadTilesetOperation
     {
-        LoadTilesetOperation(ThreeDTilesetNode* parentTileset, const URI& uri, osgDB::Options* options) : 
+        LoadTilesetOperation(ThreeDTilesetNode* parentTileset, const URI& uri, const Tile* implicitTile, osgDB::Options* options) :
             _uri(uri),
             _options(options),
-            _parentTileset(parentTileset)
+            _parentTileset(parentTileset),
+            _implicitTile(implicitTile)
         {
             // Get the currently active request layer and reuse it when the operator actually occurs, which will probably be on a different thread.
             _requestLayer = NetworkMonitor::getRequestLayer();
@@ -497,15 +1207,28 @@ namespace
             osg::ref_ptr<ThreeDTilesetNode> parentTileset;
             if (_parentTileset.lock(parentTileset))
             {
-                // load the tile set:
-                ReadResult rr = _uri.readString(_options.get());
+                osg::ref_ptr<Tileset> tileset;
 
-                if (rr.failed())
+                if (_implicitTile.valid())
+                {
+                    // load and materialize an implicit tiling subtree:
+                    const Tile* t = _implicitTile.get();
+                    tileset = t->implicitTiling()->readSubtree(
+                        _uri, t->_implicitLevel, t->_implicitX, t->_implicitY, t->_implicitZ, _options.get());
+                }
+                else
                 {
-                    OE_WARN << "Fail to read tileset \"" << _uri.full() << ": " << rr.errorDetail() << std::endl;
+                    // load the tile set:
+                    ReadResult rr = _uri.readString(_options.get());
+
+                    if (rr.failed())
+                    {
+                        OE_WARN << "Fail to read tileset \"" << _uri.full() << ": " << rr.errorDetail() << std::endl;
+                    }
+
+                    tileset = Tileset::create(rr.getString(), _uri.full());
                 }
 
-                osg::ref_ptr<Tileset> tileset = Tileset::create(rr.getString(), _uri.full());
                 if (tileset.valid())
                 {
                     if (progress && progress->isCanceled())
@@ -520,11 +1243,108 @@ namespace
 
         osg::ref_ptr< osgDB::Options > _options;
         osg::observer_ptr<ThreeDTilesetNode> _parentTileset;
+        osg::ref_ptr<const Tile> _implicitTile;
         URI _uri;
         std::string _requestLayer;
     };
 
 
+    // Estimates the memory held by a tile's content. Tiles nested in the
+    // content (from an external tileset) account for their own content,
+    // except for ones loaded immediately, which live and die with this one.
+    struct ComputeTileMemoryVisitor : public osg::NodeVisitor
+    {
+        ComputeTileMemoryVisitor() :
+            osg::NodeVisitor(TRAVERSE_ALL_CHILDREN),
+            _gpuBytes(0u),
+            _cpuBytes(0u) { }
+
+        void apply(osg::Node& node)
+        {
+            applyStateSet(node.getStateSet());
+            traverse(node);
+        }
+
+        void apply(osg::Transform& node)
+        {
+            ThreeDTileNode* tile = dynamic_cast<ThreeDTileNode*>(&node);
+            if (tile)
+            {
+                if (tile->getImmediateLoad() && tile->getContent())
+                {
+                    tile->getContent()->accept(*this);
+                }
+                return;
+            }
+            apply(static_cast<osg::Node&>(node));
+        }
+
+        void apply(osg::Drawable& drawable)
+        {
+            applyStateSet(drawable.getStateSet());
+
+            osg::Geometry* geom = drawable.asGeometry();
+            if (geom)
+            {
+                std::size_t bytes = 0u;
+
+                osg::Geometry::ArrayList arrays;
+                geom->getArrayList(arrays);
+                for (auto& array : arrays)
+                    bytes += array->getTotalDataSize();
+
+                for (unsigned i = 0; i < geom->getNumPrimitiveSets(); ++i)
+                    bytes += geom->getPrimitiveSet(i)->getTotalDataSize();
+
+                // OSG keeps the client-side copy of vertex data
+                _gpuBytes += bytes;
+                _cpuBytes += bytes;
+            }
+        }
+
+        void applyStateSet(osg::StateSet* stateSet)
+        {
+            if (!stateSet)
+                return;
+
+            for (unsigned unit = 0; unit < stateSet->getTextureAttributeList().size(); ++unit)
+            {
+                osg::Texture* tex = dynamic_cast<osg::Texture*>(
+                    stateSet->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+
+                if (!tex || !_textures.insert(tex).second)
+                    continue;
+
+                for (unsigned i = 0; i < tex->getNumImages(); ++i)
+                {
+                    const osg::Image* image = tex->getImage(i);
+                    if (!image)
+                        continue;
+
+                    std::size_t bytes = image->getTotalSizeInBytesIncludingMipmaps();
+                    _gpuBytes += bytes;
+
+                    // the driver builds the mipmaps the image doesn't carry
+                    if (!image->isMipmap() &&
+                        tex->getFilter(osg::Texture::MIN_FILTER) != osg::Texture::LINEAR &&
+                        tex->getFilter(osg::Texture::MIN_FILTER) != osg::Texture::NEAREST)
+                    {
+                        _gpuBytes += bytes / 3u;
+                    }
+
+                    if (!tex->getUnRefImageDataAfterApply())
+                    {
+                        _cpuBytes += bytes;
+                    }
+                }
+            }
+        }
+
+        std::set<const osg::Texture*> _textures;
+        std::size_t _gpuBytes;
+        std::size_t _cpuBytes;
+    };
+
     using ReadTileData = osg::ref_ptr<osg::Node>;
     using ReadTileResult = Future<ReadTileData>;
     //typedef Job<osg::ref_ptr<osg::Node>> AsyncTileJob;
@@ -532,22 +1352,27 @@ namespace
     osg::ref_ptr<osg::Node> readTilesetSync(
         ThreeDTilesetNode* parentTileset,
         const URI& uri,
+        const Tile* implicitTile,
         osgDB::Options* options)
     {
-        LoadTilesetOperation operation(parentTileset, uri, options);
+        LoadTilesetOperation operation(parentTileset, uri, implicitTile, options);
         return operation.loadTileSet(nullptr);
     }
 
     ReadTileResult readTilesetAsync(
-        ThreeDTilesetNode* parentTileset, 
-        const URI& uri, 
-        osgDB::Options* options)
+        ThreeDTilesetNode* parentTileset,
+        const URI& uri,
+        const Tile* implicitTile,
+        osgDB::Options* options,
+        std::shared_ptr<std::atomic<float>> priority)
     {
         std::shared_ptr<LoadTilesetOperation> operation = std::make_shared<LoadTilesetOperation>(
-            parentTileset, uri, options);
+            parentTileset, uri, implicitTile, options);
 
-        JobArena* arena = JobArena::get("oe.3dtiles");
-        return Job(arena).dispatch<ReadTileData>(
+        Job job(JobArena::get("oe.3dtiles"));
+        job.setName(uri.base());
+        job.setPriorityFunction([priority]() { return priority->load(); });
+        return job.dispatch<ReadTileData>(
             [operation, options](Cancelable* progress)
             {
                 return operation->loadTileSet(progress);
@@ -571,11 +1396,13 @@ namespace
 
     ReadTileResult readTileContentAsync(
         const URI& uri,
-        osg::ref_ptr<const osgDB::Options> options)
+        osg::ref_ptr<const osgDB::Options> options,
+        std::shared_ptr<std::atomic<float>> priority)
     {
-        JobArena* arena = JobArena::get("oe.3dtiles");
-
-        return Job(arena).dispatch<ReadTileData>(
+        Job job(JobArena::get("oe.3dtiles"));
+        job.setName(uri.base());
+        job.setPriorityFunction([priority]() { return priority->load(); });
+        return job.dispatch<ReadTileData>(
             [uri, options](Cancelable* progress)
             {
                 osg::ref_ptr<osg::Node> node = uri.getNode(options.get(), nullptr);
@@ -595,12 +1422,15 @@ ThreeDTileNode::ThreeDTileNode(ThreeDTilesetNode* tileset, Tile* tile, bool imme
     _tileset(tileset),
     _tile(tile),
     _requestedContent(false),
+    _requestPriority(std::make_shared<std::atomic<float>>(0.0f)),
     _immediateLoad(immediateLoad),
     _firstVisit(true),
     _options(options),
     _trackerItrValid(false),
     _lastCulledFrameNumber(0),
-    _lastCulledFrameTime(0.0f)
+    _lastCulledFrameTime(0.0f),
+    _gpuBytes(0u),
+    _cpuBytes(0u)
 {
     OE_PROFILING_ZONE;
     if (_tile->content().isSet())
@@ -639,9 +1469,13 @@ ThreeDTileNode::ThreeDTileNode(ThreeDTilesetNode* tileset, Tile* tile, bool imme
         URI uri(_tile->content()->uri()->base(), context);
 
 
-        if (osgEarth::Strings::endsWith(_tile->content()->uri()->base(), ".json"))
+        if (_tile->implicitTiling().valid())
         {
-            _content = readTilesetSync(_tileset, uri, options).get();
+            _content = readTilesetSync(_tileset, uri, _tile.get(), options).get();
+        }
+        else if (osgEarth::Strings::endsWith(_tile->content()->uri()->base(), ".json"))
+        {
+            _content = readTilesetSync(_tileset, uri, nullptr, options).get();
         }
         else
         {
@@ -896,6 +1730,12 @@ void ThreeDTileNode::resolveContent()
 
             _tileset->runPreMergeOperations(_content.get());
             _tileset->runPostMergeOperations(_content.get());
+
+            ComputeTileMemoryVisitor memory;
+            _content->accept(memory);
+            _gpuBytes = memory._gpuBytes;
+            _cpuBytes = memory._cpuBytes;
+            _tileset->addResidentBytes(_gpuBytes, _cpuBytes);
         }
     }
 }
@@ -927,21 +1767,68 @@ void ThreeDTileNode::requestContent(ICO* ico)
 
         NetworkMonitor::ScopedRequestLayer layerRequest(_tileset->getOwnerName());
 
-        if (osgEarth::Strings::endsWith(_tile->content()->uri()->base(), ".json"))
+        if (_tile->implicitTiling().valid())
+        {
+            // implicit tiling subtree, materialized like an external tileset:
+            _contentFuture = readTilesetAsync(_tileset, uri, _tile.get(), localOptions.get(), _requestPriority);
+        }
+        else if (osgEarth::Strings::endsWith(_tile->content()->uri()->base(), ".json"))
         {
             // "json" extension = external tileset:
-            _contentFuture = readTilesetAsync(_tileset, uri, localOptions.get());
+            _contentFuture = readTilesetAsync(_tileset, uri, nullptr, localOptions.get(), _requestPriority);
         }
         else
         {
             // else, actual content:
-            _contentFuture = readTileContentAsync(uri, localOptions);
+            _contentFuture = readTileContentAsync(uri, localOptions, _requestPriority);
         }
 
         _requestedContent = true;
+
+        _tileset->addPendingRequest(this);
     }
 }
 
+void ThreeDTileNode::cancelRequest()
+{
+    if (isRequestPending())
+    {
+        _contentFuture.abandon();
+        _requestedContent = false;
+    }
+}
+
+bool ThreeDTileNode::isRequestPending() const
+{
+    return _requestedContent && !_content.valid() && !_contentFuture.isAvailable();
+}
+
+void ThreeDTileNode::setRequestPriority(double screenSpaceError, double distance)
+{
+    // Screen-space error decides the order, scaled down with distance (in
+    // tile radii) so that among tiles of similar error the nearest go first.
+    double radius = osg::maximum((double)_localBoundingSphere.radius(), 1.0);
+    double priority = screenSpaceError * radius / (radius + osg::maximum(distance, 0.0));
+    _requestPriority->store((float)priority);
+}
+
+bool ThreeDTileNode::canSkip() const
+{
+    // Additive content is part of the final picture and external tilesets
+    // (or implicit subtrees) are where the children come from, so neither
+    // can be skipped.
+    if (_immediateLoad || _refine != REFINE_REPLACE || !_children.valid() || _children->getNumChildren() == 0)
+        return false;
+
+    if (_tile->implicitTiling().valid())
+        return false;
+
+    return
+        !_tile->content().isSet() ||
+        !_tile->content()->uri().isSet() ||
+        !osgEarth::Strings::endsWith(_tile->content()->uri()->base(), ".json");
+}
+
 double ThreeDTileNode::getDistanceToTile(osgUtil::CullVisitor* cv)
 {
     osg::BoundingSphere bs = _localBoundingSphere;
@@ -979,6 +1866,10 @@ bool ThreeDTileNode::unloadContent()
     {
         _content->releaseGLObjects();
         _content = nullptr;
+
+        _tileset->addResidentBytes(-(std::ptrdiff_t)_gpuBytes, -(std::ptrdiff_t)_cpuBytes);
+        _gpuBytes = 0u;
+        _cpuBytes = 0u;
     }
 
     _firstVisit = true;
@@ -1063,6 +1954,13 @@ void ThreeDTileNode::traverse(osg::NodeVisitor& nv)
             }
         }
 
+        // Hidden behind the terrain (or other occluders) as of a frame ago?
+        HiZCuller* hiz = HiZCuller::get(cv);
+        if (hiz && _boundingBox.valid() && hiz->isOccluded(cv, _boundingBox, &_boundingBoxLocalToWorld))
+        {
+            return;
+        }
+
         // Get the ICO so we can do incremental compiliation
         ICO* ico = 0;
         osgViewer::View* osgView = dynamic_cast<osgViewer::View*>(cv->getCurrentCamera()->getView());
@@ -1071,15 +1969,35 @@ void ThreeDTileNode::traverse(osg::NodeVisitor& nv)
             ico = osgView->getDatabasePager()->getIncrementalCompileOperation();
         }
 
-        // This allows nodes to reload themselves
-        requestContent(ico);
-        resolveContent();
-
         // Compute the SSE
         double error = computeScreenSpaceError(cv);
 
         updateTracking(cv);
 
+        // Skip LOD: a tile far too coarse for the view isn't worth loading,
+        // so go straight to its children. Content that's already loaded
+        // still draws until the children are ready.
+        if (_tileset->getSkipLevelOfDetail() &&
+            error > _tileset->getMaximumScreenSpaceError() * _tileset->getSkipScreenSpaceErrorFactor() &&
+            canSkip() &&
+            !isContentReady())
+        {
+            cancelRequest();
+
+            if (_tileset->getShowBoundingVolumes() && _boundsDebug.valid())
+            {
+                _boundsDebug->accept(nv);
+            }
+
+            _children->accept(nv);
+            return;
+        }
+
+        // This allows nodes to reload themselves
+        setRequestPriority(error, getDistanceToTile(cv));
+        requestContent(ico);
+        resolveContent();
+
         bool areChildrenReady = true;
         if (_children.valid())
         {
@@ -1093,6 +2011,9 @@ void ThreeDTileNode::traverse(osg::NodeVisitor& nv)
                     // Can we traverse the child?
                     if (childTile->hasContent() && !childTile->isContentReady())
                     {
+                        childTile->setRequestPriority(
+                            childTile->computeScreenSpaceError(cv),
+                            childTile->getDistanceToTile(cv));
                         childTile->requestContent(ico);
                         areChildrenReady = false;
                     }
@@ -1202,6 +2123,13 @@ ThreeDTilesetNode::ThreeDTilesetNode(Tileset* tileset, const std::string& author
     _showBoundingVolumes(false),
     _showColorPerTile(false),
     _maxAge(5.0f),
+    _maxGPUBytes(0u),
+    _maxCPUBytes(0u),
+    _gpuBytes(0u),
+    _cpuBytes(0u),
+    _skipLevelOfDetail(false),
+    _skipScreenSpaceErrorFactor(16.0f),
+    _cancelRequestFrames(2u),
     _lastExpiredFrame(0),
     _authorizationHeader(authorizationHeader),
     _sgCallbacks(sceneGraphCallbacks),
@@ -1220,6 +2148,18 @@ ThreeDTilesetNode::ThreeDTilesetNode(Tileset* tileset, const std::string& author
         setMaxAge((float)atof(c));
     }
 
+    c = ::getenv("OSGEARTH_3DTILES_MAX_GPU_MB");
+    if (c)
+    {
+        setMaxGPUBytes((std::size_t)atoi(c) * 1048576u);
+    }
+
+    c = ::getenv("OSGEARTH_3DTILES_MAX_CPU_MB");
+    if (c)
+    {
+        setMaxCPUBytes((std::size_t)atoi(c) * 1048576u);
+    }
+
     _tracker.push_back(0);
     // Pointer to last element
     _sentryItr = --_tracker.end();
@@ -1321,6 +2261,129 @@ void ThreeDTilesetNode::setColorPerTile(bool colorPerTile)
     }
 }
 
+std::size_t ThreeDTilesetNode::getMaxGPUBytes() const
+{
+    return _maxGPUBytes;
+}
+
+void ThreeDTilesetNode::setMaxGPUBytes(std::size_t value)
+{
+    _maxGPUBytes = value;
+}
+
+std::size_t ThreeDTilesetNode::getMaxCPUBytes() const
+{
+    return _maxCPUBytes;
+}
+
+void ThreeDTilesetNode::setMaxCPUBytes(std::size_t value)
+{
+    _maxCPUBytes = value;
+}
+
+void ThreeDTilesetNode::addResidentBytes(std::ptrdiff_t gpuBytes, std::ptrdiff_t cpuBytes)
+{
+    _gpuBytes += (std::size_t)gpuBytes;
+    _cpuBytes += (std::size_t)cpuBytes;
+}
+
+bool ThreeDTilesetNode::isOverBudget() const
+{
+    if (_maxGPUBytes == 0u && _maxCPUBytes == 0u)
+    {
+        return _tracker.size() > _maxTiles;
+    }
+
+    return
+        (_maxGPUBytes > 0u && _gpuBytes > _maxGPUBytes) ||
+        (_maxCPUBytes > 0u && _cpuBytes > _maxCPUBytes);
+}
+
+bool ThreeDTilesetNode::getSkipLevelOfDetail() const
+{
+    return _skipLevelOfDetail;
+}
+
+void ThreeDTilesetNode::setSkipLevelOfDetail(bool value)
+{
+    _skipLevelOfDetail = value;
+}
+
+float ThreeDTilesetNode::getSkipScreenSpaceErrorFactor() const
+{
+    return _skipScreenSpaceErrorFactor;
+}
+
+void ThreeDTilesetNode::setSkipScreenSpaceErrorFactor(float value)
+{
+    _skipScreenSpaceErrorFactor = osg::maximum(value, 1.0f);
+}
+
+unsigned ThreeDTilesetNode::getCancelRequestFrames() const
+{
+    return _cancelRequestFrames;
+}
+
+void ThreeDTilesetNode::setCancelRequestFrames(unsigned value)
+{
+    _cancelRequestFrames = value;
+}
+
+void ThreeDTilesetNode::addPendingRequest(ThreeDTileNode* node)
+{
+    ScopedMutexLock lock(_mutex);
+    _pendingRequests.push_back(node);
+}
+
+unsigned ThreeDTilesetNode::getNumPendingRequests() const
+{
+    ScopedMutexLock lock(_mutex);
+    return _pendingRequests.size();
+}
+
+void ThreeDTilesetNode::cancelStaleRequests(const osg::NodeVisitor& nv)
+{
+    OE_PROFILING_ZONE;
+
+    unsigned int frameNumber = nv.getFrameStamp()->getFrameNumber();
+
+    ScopedMutexLock lock(_mutex);
+
+    unsigned numCanceled = 0u;
+
+    for (unsigned i = 0; i < _pendingRequests.size(); )
+    {
+        osg::ref_ptr<ThreeDTileNode> tile;
+        bool keep = _pendingRequests[i].lock(tile) && tile->isRequestPending();
+
+        // A tile that no cull has visited lately has scrolled out of view
+        // or been refined past, so its load would only delay the ones we need.
+        if (keep && frameNumber > tile->getLastCulledFrameNumber() + _cancelRequestFrames)
+        {
+            tile->cancelRequest();
+            ++numCanceled;
+            keep = false;
+        }
+
+        if (keep)
+        {
+            ++i;
+        }
+        else
+        {
+            _pendingRequests[i] = _pendingRequests.back();
+            _pendingRequests.pop_back();
+        }
+    }
+
+    OE_PROFILING_PLOT("3DTiles pending requests", (float)_pendingRequests.size());
+
+    if (numCanceled > 0)
+    {
+        OE_DEBUG << LC << "Canceled " << numCanceled << " stale requests" << std::endl;
+    }
+}
+
 double ThreeDTilesetNode::getSSEDenominator() const
 {
 	return _sseDenominator;
@@ -1386,7 +2449,7 @@ void ThreeDTilesetNode::expireTiles(const osg::NodeVisitor& nv)
 
     unsigned int numErased = 0;
     unsigned int numSkipped = 0;
-    while (_tracker.size() > _maxTiles && itr != _sentryItr)
+    while (isOverBudget() && itr != _sentryItr)
     {
         osg::ref_ptr< ThreeDTileNode > tile = dynamic_cast<ThreeDTileNode*>(itr->get());
         if (tile.valid())
@@ -1421,6 +2484,9 @@ void ThreeDTilesetNode::expireTiles(const osg::NodeVisitor& nv)
     OE_NOTICE << "Tiles in memory " << _tracker.size() << " max tiles=" << _maxTiles << std::endl;
 #endif
 
+    OE_PROFILING_PLOT("3DTiles GPU MB", (float)(_gpuBytes / 1048576.0));
+    OE_PROFILING_PLOT("3DTiles CPU MB", (float)(_cpuBytes / 1048576.0));
+
     // Erase the sentry and stick it at the end of the list
     _tracker.erase(_sentryItr);
     _tracker.push_back(0);
@@ -1435,7 +2501,12 @@ void ThreeDTilesetNode::traverse(osg::NodeVisitor& nv)
         // This can happen if the node has multiple parents.
         if (nv.getFrameStamp()->getFrameNumber() > _lastExpiredFrame)
         {
+            cancelStaleRequests(nv);
             expireTiles(nv);
+
+            // Culling has updated the request priorities
+            JobArena::get("oe.3dtiles")->advancePriorityEpoch();
+
             _lastExpiredFrame = nv.getFrameStamp()->getFrameNumber();
         }
     }
@@ -28,6 +28,7 @@
 #include <osgEarth/ScaleFilter>
 #include <osgEarth/MVT>
 #include <osgEarth/OgrUtils>
+#include <osgEarth/GeoJSON>
 #include <osgEarth/FeatureCursor>
 #include <osgEarth/Metrics>
 
@@ -271,27 +272,54 @@ TFSFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
     OE_DEBUG << LC << url << std::endl;
     URI uri(url, options().url()->context());
 
-    // read the data:
-    ReadResult r = uri.readString(getReadOptions(), progress);
-
-    const std::string& buffer = r.getString();
-    const Config&      meta = r.metadata();
-
     bool dataOK = false;
 
     FeatureList features;
-    if (!buffer.empty())
+
+    if (options().format().value() == "json")
+    {
+        // GeoJSON is parsed while the response downloads
+        ReadResult r = GeoJSON::readFeatures(
+            uri,
+            getFeatureProfile(),
+            options().rewindPolygons().get(),
+            features,
+            getReadOptions(),
+            progress);
+
+        dataOK = (r.code() == ReadResult::RESULT_OK);
+        if (!dataOK && r.code() != ReadResult::RESULT_NOT_FOUND)
+        {
+            OE_WARN << LC << "Error reading TFS response: " << r.errorDetail() << std::endl;
+        }
+
+        for (FeatureList::iterator i = features.begin(); i != features.end(); )
+        {
+            if (isBlacklisted(i->get()->getFID()))
+                i = features.erase(i);
+            else
+                ++i;
+        }
+    }
+    else
     {
-        // Get the mime-type from the metadata record if possible
-        std::string mimeType = r.metadata().value(IOMetadata::CONTENT_TYPE);
-        //If the mimetype is empty then try to set it from the format specification
-        if (mimeType.empty())
+        // read the data:
+        ReadResult r = uri.readString(getReadOptions(), progress);
+
+        const std::string& buffer = r.getString();
+        if (!buffer.empty())
         {
-            if (options().format().value() == "json") mimeType = "json";
-            else if (options().format().value().compare("gml") == 0) mimeType = "text/xml";
-            else if (options().format().value().compare("pbf") == 0) mimeType = "application/x-protobuf";
+            // Get the mime-type from the metadata record if possible
+            std::string mimeType = r.metadata().value(IOMetadata::CONTENT_TYPE);
+            //If the mimetype is empty then try to set it from the format specification
+            if (mimeType.empty())
+            {
+                if (options().format().value() == "json") mimeType = "json";
+                else if (options().format().value().compare("gml") == 0) mimeType = "text/xml";
+                else if (options().format().value().compare("pbf") == 0) mimeType = "application/x-protobuf";
+            }
+            dataOK = getFeatures(buffer, *query.tileKey(), mimeType, features);
         }
-        dataOK = getFeatures(buffer, *query.tileKey(), mimeType, features);
     }
 
     if (dataOK)
@@ -22,10 +22,19 @@
 #include <osgEarth/TFSPackager>
 #include <osgEarth/FileUtils>
 #include <osgEarth/TFS>
+#include <osgEarth/OgrUtils>
+#include <osgEarth/Threading>
 #include <osgDB/FileUtils>
+#include <fstream>
+#include <set>
+#include <unordered_map>
 
 #define LC "[TFSPackager] "
 
+// Streaming mode spools this much feature data in memory before
+// appending it to the partition files
+#define STREAM_BUFFER_BYTES (64u * 1024u * 1024u)
+
 using namespace osgEarth;
 using namespace osgEarth::Contrib;
 
@@ -37,6 +46,8 @@ namespace
 
     typedef std::list< osgEarth::FeatureID > FeatureIDList;
 
+    typedef std::unordered_map< FeatureID, osg::ref_ptr<Feature> > FeatureMap;
+
     class FeatureTile : public osg::Referenced
     {
     public:
@@ -212,11 +223,12 @@ namespace
     class WriteFeaturesVisitor : public FeatureTileVisitor
     {
     public:
-        WriteFeaturesVisitor(FeatureSource* features, const std::string& dest, CropFilter::Method cropMethod, const SpatialReference* srs):
+        WriteFeaturesVisitor(FeatureSource* features, const std::string& dest, CropFilter::Method cropMethod, const SpatialReference* srs, const FeatureMap* lookup =0L):
           _dest( dest ),
               _features( features ),
               _cropMethod( cropMethod ),
-              _srs( srs )
+              _srs( srs ),
+              _lookup( lookup )
           {
 
           }
@@ -229,7 +241,18 @@ namespace
                   FeatureList features;
                   for (FeatureIDList::const_iterator i = tile->getFeatures().begin(); i != tile->getFeatures().end(); i++)
                   {
-                      Feature* f = _features->getFeature( *i );                  
+                      Feature* f = 0L;
+                      if (_lookup)
+                      {
+                          // streaming: the features are already in memory
+                          FeatureMap::const_iterator found = _lookup->find( *i );
+                          if (found != _lookup->end())
+                              f = new Feature( *found->second.get(), osg::CopyOp::DEEP_COPY_ALL );
+                      }
+                      else
+                      {
+                          f = _features->getFeature( *i );
+                      }
 
                       if (f)
                       {
@@ -282,7 +305,154 @@ namespace
           std::string _dest;      
           CropFilter::Method _cropMethod;
           osg::ref_ptr< const SpatialReference > _srs;
+          const FeatureMap* _lookup;
     };
+
+    /******************************************************************************************/
+
+    /**
+     * Spools features, as lines of GeoJSON, to one file per partition tile.
+     * Writes are buffered and appended to the files in batches so we never
+     * hold more than one open file or STREAM_BUFFER_BYTES of features.
+     */
+    class Partitioner
+    {
+    public:
+        Partitioner(const Profile* profile, unsigned level, const std::string& folder) :
+            _profile( profile ),
+            _level( level ),
+            _folder( folder ),
+            _buffered( 0u )
+        {
+            _profile->getNumTiles(_level, _cols, _rows);
+        }
+
+        // Adds the feature to every partition tile it belongs in
+        void add( const Feature* feature, CropFilter::Method method )
+        {
+            const Bounds& b = feature->getGeometry()->getBounds();
+            const GeoExtent& e = _profile->getExtent();
+            double tw = e.width() / (double)_cols;
+            double th = e.height() / (double)_rows;
+
+            unsigned xmin, xmax, ymin, ymax;
+            if (method == CropFilter::METHOD_CENTROID)
+            {
+                osg::Vec3d c = b.center();
+                xmin = xmax = clampCol( (c.x() - e.xMin()) / tw );
+                ymin = ymax = clampRow( (e.yMax() - c.y()) / th );
+            }
+            else
+            {
+                xmin = clampCol( (b.xMin() - e.xMin()) / tw );
+                xmax = clampCol( (b.xMax() - e.xMin()) / tw );
+                ymin = clampRow( (e.yMax() - b.yMax()) / th );
+                ymax = clampRow( (e.yMax() - b.yMin()) / th );
+            }
+
+            std::string json = feature->getGeoJSON();
+            for (unsigned y = ymin; y <= ymax; ++y)
+            {
+                for (unsigned x = xmin; x <= xmax; ++x)
+                {
+                    std::string& buf = _buffers[ (std::uint64_t)y * _cols + x ];
+                    buf.append( json );
+                    _buffered += json.size();
+                }
+            }
+
+            if (_buffered >= STREAM_BUFFER_BYTES)
+            {
+                flush();
+            }
+        }
+
+        // Appends all the buffered features to their files
+        void flush()
+        {
+            for (auto& i : _buffers)
+            {
+                if (i.second.empty())
+                    continue;
+
+                std::ofstream out( getFilename(i.first).c_str(), std::ios::binary | std::ios::app );
+                out.write( i.second.data(), i.second.size() );
+                _partitions.insert( i.first );
+                std::string().swap( i.second );
+            }
+            _buffered = 0u;
+        }
+
+        TileKey getKey( std::uint64_t index ) const
+        {
+            return TileKey( _level, (unsigned)(index % _cols), (unsigned)(index / _cols), _profile.get() );
+        }
+
+        std::string getFilename( std::uint64_t index ) const
+        {
+            return Stringify() << _folder << "/" << index << ".json";
+        }
+
+        const std::set<std::uint64_t>& getPartitions() const { return _partitions; }
+
+    private:
+        unsigned clampCol( double x ) const { return (unsigned)osg::clampBetween( x, 0.0, (double)(_cols - 1) ); }
+        unsigned clampRow( double y ) const { return (unsigned)osg::clampBetween( y, 0.0, (double)(_rows - 1) ); }
+
+        osg::ref_ptr< const Profile > _profile;
+        unsigned _level;
+        unsigned _cols, _rows;
+        std::string _folder;
+        std::unordered_map< std::uint64_t, std::string > _buffers;
+        std::set< std::uint64_t > _partitions;
+        std::size_t _buffered;
+    };
+
+    // Reads the features that the Partitioner spooled to a file
+    void readPartition( const std::string& filename, const SpatialReference* srs, FeatureList& output )
+    {
+        std::ifstream in( filename.c_str(), std::ios::binary );
+        if (!in.is_open())
+            return;
+
+        std::string buffer = "{\"type\": \"FeatureCollection\", \"features\": [";
+        std::string line;
+        bool first = true;
+        while (std::getline( in, line ))
+        {
+            if (line.empty())
+                continue;
+            if (!first)
+                buffer.push_back( ',' );
+            buffer.append( line );
+            first = false;
+        }
+        buffer.append( "]}" );
+
+        OGRSFDriverH ogrDriver = OGRGetDriverByName( "GeoJSON" );
+        OGRDataSourceH ds = OGROpen( buffer.c_str(), FALSE, &ogrDriver );
+        if (!ds)
+        {
+            OE_WARN << LC << "Failed to read partition " << filename << std::endl;
+            return;
+        }
+
+        OGRLayerH layer = OGR_DS_GetLayer( ds, 0 );
+        if (layer)
+        {
+            OGR_L_ResetReading( layer );
+            OGRFeatureH handle;
+            while ((handle = OGR_L_GetNextFeature( layer )) != NULL)
+            {
+                osg::ref_ptr< Feature > f = OgrUtils::createFeature( handle, srs, false );
+                if (f.valid())
+                    output.push_back( f.get() );
+                OGR_F_Destroy( handle );
+            }
+        }
+
+        OGR_DS_Destroy( ds );
+    }
 }
 
 
@@ -292,10 +462,112 @@ TFSPackager::TFSPackager():
 _firstLevel( 0 ),
     _maxLevel( 10 ),
     _maxFeatures( 300 ),
-    _method( CropFilter::METHOD_CENTROID )
+    _method( CropFilter::METHOD_CENTROID ),
+    _streaming( false ),
+    _numWriters( Threading::getConcurrency() )
 {
 }
 
+int
+TFSPackager::packageStreaming( FeatureSource* features, const Profile* profile, const std::string& destination )
+{
+    std::string folder = osgDB::concatPaths( destination, ".partitions" );
+    osgDB::makeDirectory( folder );
+
+    Partitioner partitioner( profile, _firstLevel, folder );
+
+    // Pass 1: spool each feature to its partition tile(s)
+    osg::ref_ptr< FeatureCursor > cursor = features->createFeatureCursor( _query, 0L );
+    int added = 0;
+    int skipped = 0;
+
+    while (cursor.valid() && cursor->hasMore())
+    {
+        osg::ref_ptr< Feature > feature = cursor->nextFeature();
+
+        if (!feature->getSRS()->isEquivalentTo( _srs.get() ) )
+        {
+            feature->transform( _srs.get() );
+        }
+
+        if (feature->getGeometry() && feature->getGeometry()->getBounds().valid() && feature->getGeometry()->isValid())
+        {
+            partitioner.add( feature.get(), _method );
+            added++;
+        }
+        else
+        {
+            OE_NOTICE << "Skipping feature " << feature->getFID() << " with null or invalid geometry" << std::endl;
+            skipped++;
+        }
+    }
+    cursor = 0L;
+    partitioner.flush();
+
+    OE_NOTICE << "Spooled=" << added << " Skipped=" << skipped
+        << " into " << partitioner.getPartitions().size() << " partitions" << std::endl;
+
+    // Pass 2: build and write the quadtree under each partition tile
+    JobArena arena( "oe.tfspackager", osg::maximum( _numWriters, 1u ) );
+    JobGroup group;
+
+    Threading::Mutex mutex( "TFSPackager(OE)" );
+    int highestLevel = (int)_firstLevel;
+    int failed = 0;
+
+    const std::set<std::uint64_t>& partitions = partitioner.getPartitions();
+    for (std::set<std::uint64_t>::const_iterator p = partitions.begin(); p != partitions.end(); ++p)
+    {
+        TileKey key = partitioner.getKey( *p );
+        std::string filename = partitioner.getFilename( *p );
+
+        auto delegate = [this, key, filename, &destination, &mutex, &highestLevel, &failed](Cancelable*)
+        {
+            FeatureList list;
+            readPartition( filename, _srs.get(), list );
+            ::remove( filename.c_str() );
+
+            FeatureMap lookup;
+            for (FeatureList::iterator i = list.begin(); i != list.end(); ++i)
+            {
+                lookup[ (*i)->getFID() ] = *i;
+            }
+
+            osg::ref_ptr< FeatureTile > root = new FeatureTile( key );
+            int localHighest = (int)key.getLevelOfDetail();
+            int localFailed = 0;
+
+            for (FeatureList::iterator i = list.begin(); i != list.end(); ++i)
+            {
+                AddFeatureVisitor v(i->get(), _maxFeatures, _firstLevel, _maxLevel, _method);
+                root->accept( &v );
+                if (!v._added)
+                    localFailed++;
+                else if (localHighest < v._levelAdded)
+                    localHighest = v._levelAdded;
+            }
+
+            WriteFeaturesVisitor write(0L, destination, _method, _srs.get(), &lookup);
+            root->accept( &write );
+
+            Threading::ScopedMutexLock lock( mutex );
+            highestLevel = osg::maximum( highestLevel, localHighest );
+            failed += localFailed;
+        };
+
+        Job job( &arena, &group );
+        job.setName( "TFSPackager" );
+        job.dispatch( delegate );
+    }
+
+    group.join();
+
+    ::remove( folder.c_str() );
+
+    OE_NOTICE << "Failed=" << failed << std::endl;
+    return highestLevel;
+}
+
 void
 TFSPackager::package( FeatureSource* features, const std::string& destination, const std::string& layername, const std::string& description )
 {   
@@ -321,67 +593,75 @@ TFSPackager::package( FeatureSource* features, const std::string& destination, c
     osg::ref_ptr< const osgEarth::Profile > profile = osgEarth::Profile::create(extent.getSRS(), extent.xMin(), extent.yMin(), extent.xMax(), extent.yMax(), 1, 1);
 
 
-    TileKey rootKey = TileKey(0, 0, 0, profile.get() );    
-
-
-    osg::ref_ptr< FeatureTile > root = new FeatureTile( rootKey );
-    //Loop through all the features and try to insert them into the quadtree
-    osg::ref_ptr< FeatureCursor > cursor = features->createFeatureCursor( _query, 0L ); // TODO: progress.
-    int added = 0;
-    int failed = 0;
-    int skipped = 0;
     int highestLevel = 0;
 
-    while (cursor.valid() && cursor->hasMore())
-    {        
-        osg::ref_ptr< Feature > feature = cursor->nextFeature();
+    if (_streaming)
+    {
+        highestLevel = packageStreaming( features, profile.get(), destination );
+    }
+    else
+    {
+        TileKey rootKey = TileKey(0, 0, 0, profile.get() );    
 
-        //Reproject the feature to the dest SRS if it's not already
-        if (!feature->getSRS()->isEquivalentTo( _srs.get() ) )
-        {
-            feature->transform( _srs.get() );
-        }
 
-        if (feature->getGeometry() && feature->getGeometry()->getBounds().valid() && feature->getGeometry()->isValid())
-        {
+        osg::ref_ptr< FeatureTile > root = new FeatureTile( rootKey );
+        //Loop through all the features and try to insert them into the quadtree
+        osg::ref_ptr< FeatureCursor > cursor = features->createFeatureCursor( _query, 0L ); // TODO: progress.
+        int added = 0;
+        int failed = 0;
+        int skipped = 0;
 
-            AddFeatureVisitor v(feature.get(), _maxFeatures, _firstLevel, _maxLevel, _method);
-            root->accept( &v );
-            if (!v._added)
+        while (cursor.valid() && cursor->hasMore())
+        {        
+            osg::ref_ptr< Feature > feature = cursor->nextFeature();
+
+            //Reproject the feature to the dest SRS if it's not already
+            if (!feature->getSRS()->isEquivalentTo( _srs.get() ) )
             {
-                OE_NOTICE << "Failed to add feature " << feature->getFID() << std::endl;
-                failed++;
+                feature->transform( _srs.get() );
             }
-            else
-            {                
-                if (highestLevel < v._levelAdded)
+
+            if (feature->getGeometry() && feature->getGeometry()->getBounds().valid() && feature->getGeometry()->isValid())
+            {
+
+                AddFeatureVisitor v(feature.get(), _maxFeatures, _firstLevel, _maxLevel, _method);
+                root->accept( &v );
+                if (!v._added)
                 {
-                    highestLevel = v._levelAdded;
+                    OE_NOTICE << "Failed to add feature " << feature->getFID() << std::endl;
+                    failed++;
                 }
-                added++;
-                OE_DEBUG << "Added " << added << std::endl;
-            }   
-        }
-        else
-        {
-            OE_NOTICE << "Skipping feature " << feature->getFID() << " with null or invalid geometry" << std::endl;
-            skipped++;
-        }
-    }   
-    OE_NOTICE << "Added=" << added << " Skipped=" << skipped << " Failed=" << failed << std::endl;
+                else
+                {                
+                    if (highestLevel < v._levelAdded)
+                    {
+                        highestLevel = v._levelAdded;
+                    }
+                    added++;
+                    OE_DEBUG << "Added " << added << std::endl;
+                }   
+            }
+            else
+            {
+                OE_NOTICE << "Skipping feature " << feature->getFID() << " with null or invalid geometry" << std::endl;
+                skipped++;
+            }
+        }   
+        OE_NOTICE << "Added=" << added << " Skipped=" << skipped << " Failed=" << failed << std::endl;
 
 #if 1
-    // Print the width of tiles at each level
-    for (int i = 0; i <= highestLevel; ++i)
-    {
-        TileKey tileKey(i, 0, 0, profile.get());
-        GeoExtent tileExtent = tileKey.getExtent();
-        OE_NOTICE << "Level " << i << " tile size: " << tileExtent.width() << std::endl;
-    }
+        // Print the width of tiles at each level
+        for (int i = 0; i <= highestLevel; ++i)
+        {
+            TileKey tileKey(i, 0, 0, profile.get());
+            GeoExtent tileExtent = tileKey.getExtent();
+            OE_NOTICE << "Level " << i << " tile size: " << tileExtent.width() << std::endl;
+        }
 #endif
 
-    WriteFeaturesVisitor write(features, destination, _method, _srs.get());
-    root->accept( &write );
+        WriteFeaturesVisitor write(features, destination, _method, _srs.get());
+        root->accept( &write );
+    }
 
     //Write out the meta doc
     TFS::Layer layer;
@@ -919,39 +919,27 @@ TMS::Driver::open(const URI& uri,
     return STATUS_OK;
 }
 
-osgEarth::ReadResult
-TMS::Driver::read(const URI& uri,
-                  const TileKey& key,
-                  bool invertY,
-                  ProgressCallback* progress,
-                  const osgDB::Options* readOptions) const
+namespace
 {
-    if (_tileMap.valid() && key.getLevelOfDetail() <= _tileMap->getMaxLevel())
+    // Post-processes a tile fetched from a tile map: supplies an empty
+    // image where the map has no data, and converts coverage images.
+    ReadResult processTile(
+        TMS::TileMap* tileMap,
+        bool isCoverage,
+        const TileKey& key,
+        const std::string& image_url,
+        osg::ref_ptr<osg::Image> image)
     {
-        std::string image_url = _tileMap->getURL(key, invertY);
-
-        osg::ref_ptr<osg::Image> image;
-
-        if (!image_url.empty())
-        {
-            URI uri(image_url, uri.context());
-            osgEarth::ReadResult rr = uri.readImage(readOptions, progress);
-            if (rr.failed())
-                return rr;
-
-            image = rr.getImage();
-        }
-
         if (!image.valid())
         {
-            if (image_url.empty() || !_tileMap->intersectsKey(key))
+            if (image_url.empty() || !tileMap->intersectsKey(key))
             {
                 //We couldn't read the image from the URL or the cache, so check to see if the given key is less than the max level
                 //of the tilemap and create a transparent image.
-                if (key.getLevelOfDetail() <= _tileMap->getMaxLevel())
+                if (key.getLevelOfDetail() <= tileMap->getMaxLevel())
                 {
                     OE_DEBUG << LC << "Returning empty image " << std::endl;
-                    if (_isCoverage)
+                    if (isCoverage)
                         return LandCover::createEmptyImage();
                     else
                         return ImageUtils::createEmptyImage();
@@ -961,7 +949,7 @@ TMS::Driver::read(const URI& uri,
 
         if (image.valid())
         {
-            if (_isCoverage && !LandCover::isLandCover(image.get()))
+            if (isCoverage && !LandCover::isLandCover(image.get()))
             {
                 osg::Image* dest = LandCover::createImage(image->s(), image->t());
                 ImageUtils::PixelReader read(image.get());
@@ -983,12 +971,76 @@ TMS::Driver::read(const URI& uri,
 
         return image.release();
     }
+}
+
+osgEarth::ReadResult
+TMS::Driver::read(const URI& uri,
+                  const TileKey& key,
+                  bool invertY,
+                  ProgressCallback* progress,
+                  const osgDB::Options* readOptions) const
+{
+    if (_tileMap.valid() && key.getLevelOfDetail() <= _tileMap->getMaxLevel())
+    {
+        std::string image_url = _tileMap->getURL(key, invertY);
+
+        osg::ref_ptr<osg::Image> image;
+
+        if (!image_url.empty())
+        {
+            URI uri(image_url, uri.context());
+            osgEarth::ReadResult rr = uri.readImage(readOptions, progress);
+            if (rr.failed())
+                return rr;
+
+            image = rr.getImage();
+        }
+
+        return processTile(_tileMap.get(), _isCoverage, key, image_url, image);
+    }
     else
     {
         return ReadResult::RESULT_NOT_FOUND;
     }
 }
 
+void
+TMS::Driver::readAsync(const URI& uri,
+                       const TileKey& key,
+                       bool invertY,
+                       ProgressCallback* progress,
+                       const osgDB::Options* readOptions,
+                       const HTTPClient::ReadCallback& callback) const
+{
+    if (_tileMap.valid() && key.getLevelOfDetail() <= _tileMap->getMaxLevel())
+    {
+        std::string image_url = _tileMap->getURL(key, invertY);
+
+        if (image_url.empty())
+        {
+            callback(processTile(_tileMap.get(), _isCoverage, key, image_url, nullptr));
+            return;
+        }
+
+        // the tile map may be replaced before the read completes; hold on to this one.
+        osg::ref_ptr<TMS::TileMap> tileMap = _tileMap;
+        bool isCoverage = _isCoverage;
+
+        URI(image_url, uri.context()).readImageAsync(readOptions, progress,
+            [tileMap, isCoverage, key, image_url, callback](const ReadResult& rr)
+            {
+                if (rr.failed())
+                    callback(rr);
+                else
+                    callback(processTile(tileMap.get(), isCoverage, key, image_url, rr.getImage()));
+            });
+    }
+    else
+    {
+        callback(ReadResult::RESULT_NOT_FOUND);
+    }
+}
+
 bool
 TMS::Driver::write(const URI& uri,
                    const TileKey& key,
@@ -1141,6 +1193,10 @@ TMSImageLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     ScopedWriteLock lock(_mutex);
 
     osg::ref_ptr<const Profile> profile = getProfile();
@@ -1188,7 +1244,35 @@ TMSImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
     if (r.succeeded())
         return GeoImage(r.releaseImage(), key.getExtent());
     else
-        return GeoImage(Status(r.errorDetail()));
+        return GeoImage(Status(
+            r.code() == ReadResult::RESULT_NOT_FOUND ? Status::ResourceUnavailable : Status::GeneralError,
+            r.errorDetail()));
+}
+
+bool
+TMSImageLayer::createImageImplementationAsync(const TileKey& key,
+                                              const std::function<void(const GeoImage&)>& onComplete,
+                                              ProgressCallback* progress) const
+{
+    ScopedReadLock lock(_mutex);
+
+    _driver.readAsync(
+        options().url().get(),
+        key,
+        options().tmsType().get() == "google",
+        progress,
+        getReadOptions(),
+        [key, onComplete](const ReadResult& r)
+        {
+            if (r.succeeded())
+                onComplete(GeoImage(r.getImage(), key.getExtent()));
+            else
+                onComplete(GeoImage(Status(
+                    r.code() == ReadResult::RESULT_NOT_FOUND ? Status::ResourceUnavailable : Status::GeneralError,
+                    r.errorDetail())));
+        });
+
+    return true;
 }
 
 Status
@@ -1254,6 +1338,10 @@ TMSElevationLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     ScopedWriteLock lock(_mutex);
 
     // Create an image layer under the hood. TMS fetch is the same for image and
@@ -22,20 +22,133 @@
 #include <osgEarth/TMSBackFiller>
 #include <osgEarth/FileUtils>
 #include <osgEarth/ImageMosaic>
+#include <osgEarth/Threading>
 
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <map>
 
 #define LC "[TMSBackFiller] "
 
 using namespace osgEarth;
 using namespace osgEarth::Contrib;
 
+namespace
+{
+    // 2x2 box filter of one child's rows into a quadrant of the parent.
+    // Fixed channel counts keep the inner loops free of divisions, so
+    // the compiler can vectorize them.
+    template<unsigned N>
+    void boxFilter8(const osg::Image* src, osg::Image* dst, int s0, int t0)
+    {
+        int w = src->s() / 2, h = src->t() / 2;
+        for (int t = 0; t < h; ++t)
+        {
+            const unsigned char* a = src->data(0, t * 2);
+            const unsigned char* b = src->data(0, t * 2 + 1);
+            unsigned char* out = dst->data(s0, t0 + t);
+
+            for (int s = 0; s < w; ++s)
+            {
+                for (unsigned c = 0; c < N; ++c)
+                {
+                    unsigned sum =
+                        a[(2 * s) * N + c] + a[(2 * s + 1) * N + c] +
+                        b[(2 * s) * N + c] + b[(2 * s + 1) * N + c];
+                    out[s * N + c] = (unsigned char)((sum + 2u) >> 2);
+                }
+            }
+        }
+    }
+
+    template<unsigned N>
+    void boxFilterFloat(const osg::Image* src, osg::Image* dst, int s0, int t0)
+    {
+        int w = src->s() / 2, h = src->t() / 2;
+        for (int t = 0; t < h; ++t)
+        {
+            const float* a = reinterpret_cast<const float*>(src->data(0, t * 2));
+            const float* b = reinterpret_cast<const float*>(src->data(0, t * 2 + 1));
+            float* out = reinterpret_cast<float*>(dst->data(s0, t0 + t));
+
+            for (int s = 0; s < w; ++s)
+            {
+                for (unsigned c = 0; c < N; ++c)
+                {
+                    out[s * N + c] = 0.25f * (
+                        a[(2 * s) * N + c] + a[(2 * s + 1) * N + c] +
+                        b[(2 * s) * N + c] + b[(2 * s + 1) * N + c]);
+                }
+            }
+        }
+    }
+
+    template<unsigned N>
+    void boxFilter(const osg::Image* src, osg::Image* dst, int s0, int t0)
+    {
+        if (src->getDataType() == GL_FLOAT)
+            boxFilterFloat<N>(src, dst, s0, t0);
+        else
+            boxFilter8<N>(src, dst, s0, t0);
+    }
+
+    // Downsamples four equal children (UL, UR, LL, LR) into a parent of the
+    // same size, or returns NULL if the fast path doesn't apply.
+    osg::Image* downsample(osg::Image* children[4])
+    {
+        const osg::Image* ul = children[0];
+        for (unsigned i = 1; i < 4; ++i)
+        {
+            const osg::Image* c = children[i];
+            if (c->s() != ul->s() || c->t() != ul->t() || c->r() != 1 ||
+                c->getPixelFormat() != ul->getPixelFormat() ||
+                c->getDataType() != ul->getDataType() ||
+                c->getPacking() != ul->getPacking())
+            {
+                return 0L;
+            }
+        }
+
+        if ((ul->s() & 1) || (ul->t() & 1))
+            return 0L;
+
+        if (ul->getDataType() != GL_UNSIGNED_BYTE && ul->getDataType() != GL_FLOAT)
+            return 0L;
+
+        unsigned channels = osg::Image::computeNumComponents(ul->getPixelFormat());
+        if (channels < 1 || channels > 4)
+            return 0L;
+
+        osg::ref_ptr<osg::Image> parent = new osg::Image();
+        parent->allocateImage(ul->s(), ul->t(), 1, ul->getPixelFormat(), ul->getDataType(), ul->getPacking());
+        parent->setInternalTextureFormat(ul->getInternalTextureFormat());
+
+        // t runs south to north, so the upper children fill the top half
+        int hw = ul->s() / 2, hh = ul->t() / 2;
+        int s0[4] = { 0, hw, 0, hw };
+        int t0[4] = { hh, hh, 0, 0 };
+
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            switch (channels)
+            {
+            case 1: boxFilter<1>(children[i], parent.get(), s0[i], t0[i]); break;
+            case 2: boxFilter<2>(children[i], parent.get(), s0[i], t0[i]); break;
+            case 3: boxFilter<3>(children[i], parent.get(), s0[i], t0[i]); break;
+            case 4: boxFilter<4>(children[i], parent.get(), s0[i], t0[i]); break;
+            }
+        }
+
+        return parent.release();
+    }
+}
+
 TMSBackFiller::TMSBackFiller() :
 _minLevel(0u),
 _maxLevel(0u),
+_numThreads(Threading::getConcurrency()),
 _verbose(false)
 {
     //nop
@@ -52,36 +165,86 @@ void TMSBackFiller::process( const std::string& tms, osgDB::Options* options )
     if (_tileMap)
     {                        
         //The max level is where we are going to read data from, so we need to start one level up.
-        osg::ref_ptr< const Profile> profile = _tileMap->createProfile();           
+        _profile = _tileMap->createProfile();           
 
         //If the bounds aren't valid just use the full extent of the profile.
         if (!_bounds.valid())
         {                
-            _bounds = profile->getExtent().bounds();
+            _bounds = _profile->getExtent().bounds();
         }
 
+        if (_maxLevel <= _minLevel)
+            return;
 
         int firstLevel = _maxLevel-1;            
 
-        GeoExtent extent( profile->getSRS(), _bounds );           
+        _extent = GeoExtent( _profile->getSRS(), _bounds );           
+
+        // Find the first level with enough tiles to keep all the threads
+        // busy; each of its tiles is an independent subtree.
+        unsigned int numThreads = osg::maximum(_numThreads, 1u);
+        unsigned int splitLevel = _minLevel;
+        std::vector<TileKey> splitKeys;
+        for (; splitLevel < (unsigned)firstLevel; ++splitLevel)
+        {
+            getKeys( splitLevel, splitKeys );
+            if (splitKeys.size() >= 4u * numThreads)
+                break;
+        }
+        getKeys( splitLevel, splitKeys );
+
+        if (_verbose) OE_NOTICE << "Processing " << splitKeys.size() << " subtrees from level " << splitLevel << std::endl;
 
-        //Process each level in it's entirety
-        for (int level = firstLevel; level >= static_cast<int>(_minLevel); level--)
+        // Build the subtrees in parallel
+        std::map< TileKey, osg::ref_ptr<osg::Image> > tiles;
+        {
+            JobArena arena( "oe.tmsbackfiller", numThreads );
+            std::vector< Future< osg::ref_ptr<osg::Image> > > results;
+
+            for (std::vector<TileKey>::const_iterator i = splitKeys.begin(); i != splitKeys.end(); ++i)
+            {
+                TileKey key = *i;
+                results.push_back( Job(&arena).dispatch< osg::ref_ptr<osg::Image> >(
+                    [this, key](Cancelable*)
+                    {
+                        return osg::ref_ptr<osg::Image>( processSubtree( key ) );
+                    }) );
+            }
+
+            for (unsigned int i = 0; i < results.size(); ++i)
+            {
+                const osg::ref_ptr<osg::Image>& image = results[i].get();
+                if (image.valid())
+                    tiles[ splitKeys[i] ] = image;
+            }
+        }
+
+        // Finish the few levels above the subtrees from the tiles in memory
+        for (int level = (int)splitLevel - 1; level >= static_cast<int>(_minLevel); level--)
         {
             if (_verbose) OE_NOTICE << "Processing level " << level << std::endl;                
 
-            TileKey ll = profile->createTileKey(extent.xMin(), extent.yMin(), level);
-            TileKey ur = profile->createTileKey(extent.xMax(), extent.yMax(), level);
+            std::vector<TileKey> keys;
+            getKeys( level, keys );
 
-            for (unsigned int x = ll.getTileX(); x <= ur.getTileX(); x++)
+            std::map< TileKey, osg::ref_ptr<osg::Image> > parents;
+            for (std::vector<TileKey>::const_iterator i = keys.begin(); i != keys.end(); ++i)
             {
-                for (unsigned int y = ur.getTileY(); y <= ll.getTileY(); y++)
+                osg::ref_ptr<osg::Image> refs[4];
+                osg::Image* children[4];
+                for (unsigned int c = 0; c < 4; ++c)
                 {
-                    TileKey key = TileKey(level, x, y, profile.get());
-                    processKey( key );
+                    TileKey childKey = i->createChildKey( c );
+                    std::map< TileKey, osg::ref_ptr<osg::Image> >::iterator found = tiles.find( childKey );
+                    refs[c] = found != tiles.end() ? found->second.get() : readTile( childKey );
+                    children[c] = refs[c].get();
                 }
-            }                
 
+                osg::ref_ptr<osg::Image> image = processKey( *i, children );
+                if (image.valid())
+                    parents[ *i ] = image;
+            }
+            tiles.swap( parents );
         }            
     }
     else
@@ -90,40 +253,76 @@ void TMSBackFiller::process( const std::string& tms, osgDB::Options* options )
     }
 }
 
-void TMSBackFiller::processKey( const TileKey& key )
+void TMSBackFiller::getKeys( unsigned int level, std::vector<TileKey>& keys ) const
+{
+    keys.clear();
+
+    TileKey ll = _profile->createTileKey(_extent.xMin(), _extent.yMin(), level);
+    TileKey ur = _profile->createTileKey(_extent.xMax(), _extent.yMax(), level);
+
+    for (unsigned int x = ll.getTileX(); x <= ur.getTileX(); x++)
+    {
+        for (unsigned int y = ur.getTileY(); y <= ll.getTileY(); y++)
+        {
+            keys.push_back( TileKey(level, x, y, _profile.get()) );
+        }
+    }
+}
+
+osg::Image* TMSBackFiller::processSubtree( const TileKey& key )
+{
+    osg::ref_ptr<osg::Image> refs[4];
+    osg::Image* children[4];
+
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+        TileKey childKey = key.createChildKey( c );
+
+        // Children above the source level that are in the bounds get rebuilt;
+        // everything else comes from the repository as is.
+        if (childKey.getLevelOfDetail() < _maxLevel && _extent.intersects( childKey.getExtent() ))
+            refs[c] = processSubtree( childKey );
+        else
+            refs[c] = readTile( childKey );
+
+        children[c] = refs[c].get();
+    }
+
+    return processKey( key, children );
+}
+
+osg::Image* TMSBackFiller::processKey( const TileKey& key, osg::Image* children[4] )
 {
     if (_verbose) OE_NOTICE << "Processing key " << key.str() << std::endl;
 
-    //Get all of the child tiles for this key, load them and mosaic them into a new tile
-    TileKey ulKey = key.createChildKey( 0 );
-    TileKey urKey = key.createChildKey( 1 );
-    TileKey llKey = key.createChildKey( 2 );
-    TileKey lrKey = key.createChildKey( 3 );
+    if (!children[0] || !children[1] || !children[2] || !children[3])
+        return 0L;
 
-    osg::ref_ptr< osg::Image > ul = readTile( ulKey );
-    osg::ref_ptr< osg::Image > ur = readTile( urKey );
-    osg::ref_ptr< osg::Image > ll = readTile( llKey );
-    osg::ref_ptr< osg::Image > lr = readTile( lrKey );
+    osg::ref_ptr< osg::Image > resized = downsample( children );
 
-    if (ul.valid() && ur.valid() && ll.valid() && lr.valid())
-    {            
+    if (!resized.valid())
+    {
         //Merge them together
         ImageMosaic mosaic;
-        mosaic.getImages().push_back( TileImage( ul.get(), ulKey ) );
-        mosaic.getImages().push_back( TileImage( ur.get(), urKey ) );
-        mosaic.getImages().push_back( TileImage( ll.get(), llKey ) );
-        mosaic.getImages().push_back( TileImage( lr.get(), lrKey ) );            
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            mosaic.getImages().push_back( TileImage( children[c], key.createChildKey( c ) ) );
+        }
 
         osg::ref_ptr< osg::Image> merged = mosaic.createImage();
         if (merged.valid())
         {
             //Resize the image so it's the same size as one of the input files
-            osg::ref_ptr<osg::Image> resized;
-            ImageUtils::resizeImage( merged.get(), ul->s(), ul->t(), resized );
-            std::string outputFilename = getFilename( key );                
-            writeTile( key, resized.get() );
+            ImageUtils::resizeImage( merged.get(), children[0]->s(), children[0]->t(), resized );
         }
-    }                
+    }
+
+    if (resized.valid())
+    {
+        writeTile( key, resized.get() );
+    }
+
+    return resized.release();
 }    
 
 std::string TMSBackFiller::getFilename( const TileKey& key )
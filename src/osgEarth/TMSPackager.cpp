@@ -21,15 +21,144 @@
 #include <osgEarth/ImageToHeightFieldConverter>
 #include <osgEarth/FileUtils>
 #include <osgEarth/ImageLayer>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/Threading>
+#include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
+#include <osgDB/Registry>
 #include <osgDB/WriteFile>
-
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
 
 #define LC "[TMSPackager] "
 
 using namespace osgEarth;
 using namespace osgEarth::Contrib;
 
+namespace
+{
+    // FNV-1a, 64 bits
+    std::uint64_t hashBytes(const std::string& data)
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : data)
+        {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // Whether the file at path already holds exactly these bytes
+    bool sameContents(const std::string& path, const std::string& data)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!in.is_open() || (std::size_t)in.tellg() != data.size())
+            return false;
+
+        in.seekg(0, std::ios::beg);
+        std::stringstream buf;
+        buf << in.rdbuf();
+        return hashBytes(buf.str()) == hashBytes(data);
+    }
+
+    // Clears the alpha of every pixel outside all of the extents
+    void applyAlphaMask(osg::Image* image, const GeoExtent& imageExtent, const std::vector<GeoExtent>& extents)
+    {
+        std::vector<GeoExtent> masks;
+        for (auto& extent : extents)
+            masks.push_back(extent.transform(imageExtent.getSRS()));
+
+        double dx = imageExtent.width() / (double)image->s();
+        double dy = imageExtent.height() / (double)image->t();
+
+        for (int t = 0; t < image->t(); ++t)
+        {
+            double y = imageExtent.yMin() + dy * ((double)t + 0.5);
+            for (int s = 0; s < image->s(); ++s)
+            {
+                double x = imageExtent.xMin() + dx * ((double)s + 0.5);
+
+                bool inside = false;
+                for (unsigned i = 0; i < masks.size() && !inside; ++i)
+                    inside = masks[i].contains(x, y);
+
+                if (!inside)
+                    image->data(s, t)[3] = 0;
+            }
+        }
+    }
+
+    /**
+     * Pipeline stage: a pool of threads fed from a queue that holds
+     * at most "capacity" tasks. push() blocks while the queue is full.
+     */
+    class Stage
+    {
+    public:
+        Stage(const std::string& name, unsigned concurrency, unsigned capacity) :
+            _arena(name, osg::maximum(concurrency, 1u)),
+            _capacity(osg::maximum(capacity, 1u)),
+            _queued(0u),
+            _mutex(name)
+        {
+        }
+
+        void push(const std::function<void()>& task)
+        {
+            {
+                std::unique_lock<Threading::Mutex> lock(_mutex);
+                _cv.wait(lock, [this]() { return _queued < _capacity; });
+                ++_queued;
+            }
+
+            Job job(&_arena, &_group);
+            job.dispatch([this, task](Cancelable*)
+                {
+                    task();
+                    {
+                        std::unique_lock<Threading::Mutex> lock(_mutex);
+                        --_queued;
+                    }
+                    _cv.notify_one();
+                });
+        }
+
+        void join()
+        {
+            _group.join();
+        }
+
+    private:
+        JobArena _arena;
+        JobGroup _group;
+        unsigned _capacity;
+        unsigned _queued;
+        Threading::Mutex _mutex;
+        std::condition_variable_any _cv;
+    };
+}
+
+struct TMSPackager::Pipeline
+{
+    Stage _encode;
+    Stage _write;
+
+    Pipeline(unsigned encodeThreads, unsigned writeThreads, unsigned queueSize) :
+        _encode("oe.tmspackager.encode", encodeThreads, queueSize),
+        _write("oe.tmspackager.write", writeThreads, queueSize)
+    {
+    }
+
+    // Encode first, since encoding feeds the write stage
+    void join()
+    {
+        _encode.join();
+        _write.join();
+    }
+};
+
 WriteTMSTileHandler::WriteTMSTileHandler(TileLayer* layer,  Map* map, TMSPackager* packager):
     _layer( layer ),
     _map(map),
@@ -79,36 +208,26 @@ bool WriteTMSTileHandler::handleTile(const TileKey& key, const TileVisitor& tv)
                 return false;
             }
 
-            if (_packager->getApplyAlphaMask())
-            {
-                // Convert the image to RGBA if necessary
-                if (!ImageUtils::hasAlphaChannel(geoImage.getImage()))
-                {
-                    osg::ref_ptr< osg::Image > rgba = ImageUtils::convertToRGBA8(geoImage.getImage());
-                    geoImage = GeoImage(rgba.get(), geoImage.getExtent());
-                }
+            // OE_NOTICE << "Created image for " << key.str() << std::endl;
+            osg::ref_ptr< const osg::Image > finalImage = geoImage.getImage();
 
-                // mask out areas not included in the request:
-                for(std::vector<GeoExtent>::const_iterator g = tv.getExtents().begin();
-                    g != tv.getExtents().end();
-                    ++g)
-                {
-                    geoImage.applyAlphaMask( *g );
-                }
+            if (_packager->getApplyAlphaMask() && !tv.getExtents().empty())
+            {
+                // mask out areas not included in the request (on a copy,
+                // since the layer may cache the image it returned):
+                osg::ref_ptr< osg::Image > rgba = ImageUtils::convertToRGBA8(finalImage.get());
+                applyAlphaMask(rgba.get(), geoImage.getExtent(), tv.getExtents());
+                finalImage = rgba.get();
             }
 
-            // OE_NOTICE << "Created image for " << key.str() << std::endl;
-            osg::ref_ptr< osg::Image > finalImage = geoImage.getImage();
-
             // convert to RGB if necessary
             if ( _packager->getExtension() == "jpg" && finalImage->getPixelFormat() != GL_RGB )
             {
                 finalImage = ImageUtils::convertToRGB8( finalImage.get() );
             }
 
-            // attempt to create the output folder:
-            osgEarth::makeDirectoryForFile( path );
-            return osgDB::writeImageFile(*finalImage.get(), path, _packager->getOptions());
+            _packager->write(finalImage.get(), path);
+            return true;
         }
     }
     else if (elevationLayer )
@@ -120,9 +239,8 @@ bool WriteTMSTileHandler::handleTile(const TileKey& key, const TileVisitor& tv)
             ImageToHeightFieldConverter conv;
             osg::ref_ptr< osg::Image > image = conv.convert( hf.getHeightField(), _packager->getElevationPixelDepth() );
 
-            // attempt to create the output folder:
-            osgEarth::makeDirectoryForFile( path );
-            return osgDB::writeImageFile(*image.get(), path, _packager->getOptions());
+            _packager->write(image.get(), path);
+            return true;
         }
     }
 
@@ -214,7 +332,10 @@ _visitor(new TileVisitor()),
     _overwrite(false),
     _keepEmpties(false),
     _applyAlphaMask(false),
-    _tileSource(0L)
+    _numEncodeThreads(Threading::getConcurrency()),
+    _numWriteThreads(4u),
+    _queueSize(256u),
+    _skipUnchanged(true)
 {
 }
 
@@ -258,14 +379,44 @@ void TMSPackager::setWriteOptions( osgDB::Options* options )
     _writeOptions = options;
 }
 
-void TMSPackager::setTileSource( osgEarth::TileSource* source )
+void TMSPackager::setNumEncodeThreads(unsigned value)
+{
+    _numEncodeThreads = value;
+}
+
+unsigned TMSPackager::getNumEncodeThreads() const
+{
+    return _numEncodeThreads;
+}
+
+void TMSPackager::setNumWriteThreads(unsigned value)
+{
+    _numWriteThreads = value;
+}
+
+unsigned TMSPackager::getNumWriteThreads() const
+{
+    return _numWriteThreads;
+}
+
+void TMSPackager::setQueueSize(unsigned value)
 {
-    _tileSource = source;
+    _queueSize = value;
 }
 
-osgEarth::TileSource* TMSPackager::getTileSource() const
+unsigned TMSPackager::getQueueSize() const
 {
-    return _tileSource.get();
+    return _queueSize;
+}
+
+bool TMSPackager::getSkipUnchanged() const
+{
+    return _skipUnchanged;
+}
+
+void TMSPackager::setSkipUnchanged(bool value)
+{
+    _skipUnchanged = value;
 }
 
 const std::string& TMSPackager::getLayerName() const
@@ -390,9 +541,80 @@ void TMSPackager::run( TileLayer* layer,  Map* map  )
     }
 
 
+    if (_numEncodeThreads > 0u)
+    {
+        _pipeline = std::make_shared<Pipeline>(_numEncodeThreads, _numWriteThreads, _queueSize);
+    }
+
     _handler = new WriteTMSTileHandler(layer, map, this);
     _visitor->setTileHandler( _handler.get() );
     _visitor->run( map->getProfile() );
+
+    // finish the tiles still in the pipeline
+    if (_pipeline)
+    {
+        _pipeline->join();
+        _pipeline = nullptr;
+    }
+}
+
+void TMSPackager::write(const osg::Image* image, const std::string& path)
+{
+    osg::ref_ptr<const osg::Image> input(image);
+    osg::ref_ptr<osgDB::Options> options(_writeOptions.get());
+    bool skipUnchanged = _skipUnchanged;
+
+    auto writeStage = [path, skipUnchanged](const std::string& data)
+    {
+        if (skipUnchanged && sameContents(path, data))
+            return;
+
+        // attempt to create the output folder:
+        osgEarth::makeDirectoryForFile( path );
+
+        std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+        if (!out.good())
+        {
+            OE_WARN << LC << "Failed to write " << path << std::endl;
+        }
+    };
+
+    std::shared_ptr<Pipeline> pipeline = _pipeline;
+
+    auto encodeStage = [input, options, path, pipeline, writeStage]()
+    {
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(
+            osgDB::getLowerCaseFileExtension(path));
+        if (!rw)
+        {
+            OE_WARN << LC << "No plugin to write " << path << std::endl;
+            return;
+        }
+
+        std::stringstream buf;
+        osgDB::ReaderWriter::WriteResult r = rw->writeImage(*input.get(), buf, options.get());
+        if (!r.success())
+        {
+            OE_WARN << LC << "Failed to encode " << path << ": " << r.message() << std::endl;
+            return;
+        }
+
+        if (pipeline)
+        {
+            std::shared_ptr<std::string> data = std::make_shared<std::string>(buf.str());
+            pipeline->_write.push([data, writeStage]() { writeStage(*data); });
+        }
+        else
+        {
+            writeStage(buf.str());
+        }
+    };
+
+    if (pipeline)
+        pipeline->_encode.push(encodeStage);
+    else
+        encodeStage();
 }
 
 void TMSPackager::writeXML(TileLayer* layer, Map* map)
@@ -22,6 +22,7 @@
 #include <osgEarth/Map>
 #include <osgEarth/Progress>
 #include <osgEarth/AltitudeFilter>
+#include <osgEarth/Cache>
 
 using namespace osgEarth;
 
@@ -30,6 +31,28 @@ REGISTER_OSGEARTH_LAYER(terrainconstraint, TerrainConstraintLayer);
 REGISTER_OSGEARTH_LAYER(featuremask, TerrainConstraintLayer);
 REGISTER_OSGEARTH_LAYER(mask, TerrainConstraintLayer);
 
+// Past this many dirty regions, mark the whole layer dirty instead
+// of testing every tile against all of them
+#define MAX_DIRTY_REGIONS 64u
+
+namespace
+{
+    // forwards feature source edits to the layer
+    struct FeatureChangeCallback : public FeatureSource::ChangeCallback
+    {
+        osg::observer_ptr<TerrainConstraintLayer> _layer;
+
+        FeatureChangeCallback(TerrainConstraintLayer* layer) : _layer(layer) { }
+
+        void onFeaturesChanged(const std::vector<FeatureID>& fids, const GeoExtent& extent) override
+        {
+            osg::ref_ptr<TerrainConstraintLayer> layer;
+            if (_layer.lock(layer))
+                layer->dirty(extent);
+        }
+    };
+}
+
 //........................................................................
 
 void
@@ -83,6 +106,14 @@ TerrainConstraintLayer::getFeatureSource() const
     return options().featureSource().getLayer();
 }
 
+void
+TerrainConstraintLayer::init()
+{
+    VisibleLayer::init();
+    _regionRevision = 0;
+    _baseRevision = 0;
+}
+
 Status
 TerrainConstraintLayer::openImplementation()
 {
@@ -94,9 +125,37 @@ TerrainConstraintLayer::openImplementation()
     if (fsStatus.isError())
         return fsStatus;
 
+    // the features may differ from the last time the layer was open
+    bumpRevision();
+
+    // listen for edits so the terrain can re-edit just the tiles they touch
+    if (getFeatureSource())
+    {
+        _featureChangeCallback = new FeatureChangeCallback(this);
+        getFeatureSource()->addChangeCallback(_featureChangeCallback.get());
+    }
+
     return Status::NoError;
 }
 
+Status
+TerrainConstraintLayer::closeImplementation()
+{
+    if (_featureChangeCallback.valid())
+    {
+        if (getFeatureSource())
+            getFeatureSource()->removeChangeCallback(_featureChangeCallback.get());
+        _featureChangeCallback = nullptr;
+    }
+
+    {
+        Threading::ScopedMutexLock lock(_dirtyRegionsMutex);
+        _dirtyRegions.clear();
+    }
+
+    return VisibleLayer::closeImplementation();
+}
+
 const GeoExtent&
 TerrainConstraintLayer::getExtent() const
 {
@@ -114,6 +173,91 @@ TerrainConstraintLayer::setVisible(bool value)
         close();
 }
 
+void
+TerrainConstraintLayer::dirty(const GeoExtent& extent)
+{
+    bool wholeLayer = !extent.isValid();
+    {
+        Threading::ScopedMutexLock lock(_dirtyRegionsMutex);
+
+        if (!wholeLayer && _dirtyRegions.size() >= MAX_DIRTY_REGIONS)
+            wholeLayer = true;
+
+        if (wholeLayer)
+        {
+            _dirtyRegions.clear();
+            _baseRevision = ++_regionRevision;
+        }
+        else
+        {
+            DirtyRegion region;
+            region._extent = extent;
+            region._revision = ++_regionRevision;
+            _dirtyRegions.push_back(region);
+        }
+    }
+
+    // copy so a callback can remove itself
+    Callbacks temp;
+    _callbacks.lock();
+    temp = _callbacks;
+    _callbacks.unlock();
+
+    for (auto& callback : temp)
+    {
+        callback->onConstraintsChanged(this, wholeLayer ? GeoExtent::INVALID : extent);
+    }
+}
+
+int
+TerrainConstraintLayer::getConstraintRevision(const GeoExtent& extent) const
+{
+    Threading::ScopedMutexLock lock(_dirtyRegionsMutex);
+
+    int revision = _baseRevision;
+    for (auto& region : _dirtyRegions)
+    {
+        if (region._revision > revision && region._extent.intersects(extent))
+            revision = region._revision;
+    }
+    return revision;
+}
+
+void
+TerrainConstraintLayer::addCallback(TerrainConstraintLayer::Callback* c)
+{
+    _callbacks.lock();
+    _callbacks.push_back(c);
+    _callbacks.unlock();
+}
+
+void
+TerrainConstraintLayer::removeCallback(TerrainConstraintLayer::Callback* c)
+{
+    _callbacks.lock();
+    Callbacks::iterator i = std::find(_callbacks.begin(), _callbacks.end(), c);
+    if (i != _callbacks.end())
+        _callbacks.erase(i);
+    _callbacks.unlock();
+}
+
+CacheBin*
+TerrainConstraintLayer::getMeshCacheBin()
+{
+    CacheSettings* cacheSettings = getCacheSettings();
+    if (!cacheSettings || !cacheSettings->isCacheEnabled())
+        return nullptr;
+
+    return cacheSettings->getCacheBin();
+}
+
+const CachePolicy&
+TerrainConstraintLayer::getMeshCachePolicy() const
+{
+    const CacheSettings* cacheSettings = getCacheSettings();
+    return cacheSettings ? cacheSettings->cachePolicy().get() : CachePolicy::NO_CACHE;
+}
+
 void
 TerrainConstraintLayer::addedToMap(const Map* map)
 {
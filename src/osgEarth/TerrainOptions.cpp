@@ -66,6 +66,20 @@ TerrainOptions::getConfig() const
     conf.set( "priority_scale", priorityScale() );
     conf.set( "texture_compression", textureCompression());
     conf.set( "concurrency", concurrency());
+    conf.set( "use_multi_draw_indirect", useMultiDrawIndirect());
+    conf.set( "cull_concurrency", cullConcurrency());
+    conf.set( "use_geometry_arena", useGeometryArena());
+    conf.set( "merge_target_frame_time", mergeTargetFrameTime());
+    conf.set( "use_texture_pages", useTexturePages());
+    conf.set( "prefetch_lookahead", prefetchLookahead());
+    conf.set( "gpu_culling", gpuCulling());
+    conf.set( "gpu_memory_budget", gpuMemoryBudget());
+    conf.set( "indexed_land_cover", indexedLandCover());
+    conf.set( "share_tile_data", shareTileData());
+    conf.set( "dynamic_resolution", dynamicResolution());
+    conf.set( "target_frame_time", targetFrameTime());
+    conf.set( "max_dynamic_lod_scale", maxDynamicLODScale());
+    conf.set( "compact_tessellation_mesh", compactTessellationMesh());
 
     return conf;
 }
@@ -105,6 +119,20 @@ TerrainOptions::fromConfig(const Config& conf)
     priorityScale().init(1.0f);
     textureCompression().setDefault("");
     concurrency().setDefault(4u);
+    useMultiDrawIndirect().init(false);
+    cullConcurrency().init(1u);
+    useGeometryArena().init(false);
+    mergeTargetFrameTime().init(0.0f);
+    useTexturePages().init(false);
+    prefetchLookahead().init(0.0f);
+    gpuCulling().init(false);
+    gpuMemoryBudget().init(0u);
+    indexedLandCover().init(false);
+    shareTileData().init(false);
+    dynamicResolution().init(false);
+    targetFrameTime().init(16.67f);
+    maxDynamicLODScale().init(4.0f);
+    compactTessellationMesh().init(false);
 
 
     conf.get( "tile_size", _tileSize );
@@ -141,6 +169,20 @@ TerrainOptions::fromConfig(const Config& conf)
     conf.get( "priority_scale", priorityScale());
     conf.get( "texture_compression", textureCompression());
     conf.get( "concurrency", concurrency());
+    conf.get( "use_multi_draw_indirect", useMultiDrawIndirect());
+    conf.get( "cull_concurrency", cullConcurrency());
+    conf.get( "use_geometry_arena", useGeometryArena());
+    conf.get( "merge_target_frame_time", mergeTargetFrameTime());
+    conf.get( "use_texture_pages", useTexturePages());
+    conf.get( "prefetch_lookahead", prefetchLookahead());
+    conf.get( "gpu_culling", gpuCulling());
+    conf.get( "gpu_memory_budget", gpuMemoryBudget());
+    conf.get( "indexed_land_cover", indexedLandCover());
+    conf.get( "share_tile_data", shareTileData());
+    conf.get( "dynamic_resolution", dynamicResolution());
+    conf.get( "target_frame_time", targetFrameTime());
+    conf.get( "max_dynamic_lod_scale", maxDynamicLODScale());
+    conf.get( "compact_tessellation_mesh", compactTessellationMesh());
 
     // report on deprecated usage
     const std::string deprecated_keys[] = {
@@ -198,6 +240,20 @@ OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, MergesPerFrame, mergesPerFrame);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, float, PriorityScale, priorityScale);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, std::string, TextureCompressionMethod, textureCompression);
 OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, Concurrency, concurrency);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, UseMultiDrawIndirect, useMultiDrawIndirect);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, CullConcurrency, cullConcurrency);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, UseGeometryArena, useGeometryArena);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, float, MergeTargetFrameTime, mergeTargetFrameTime);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, UseTexturePages, useTexturePages);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, float, PrefetchLookahead, prefetchLookahead);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, GPUCulling, gpuCulling);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, unsigned, GPUMemoryBudget, gpuMemoryBudget);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, IndexedLandCover, indexedLandCover);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, ShareTileData, shareTileData);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, DynamicResolution, dynamicResolution);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, float, TargetFrameTime, targetFrameTime);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, float, MaxDynamicLODScale, maxDynamicLODScale);
+OE_PROPERTY_IMPL(TerrainOptionsAPI, bool, CompactTessellationMesh, compactTessellationMesh);
 
 void
 TerrainOptionsAPI::setDriver(const std::string& value)
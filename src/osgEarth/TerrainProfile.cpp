@@ -22,10 +22,103 @@
 #include <osgEarth/TerrainProfile>
 #include <osgEarth/MapNode>
 #include <osgEarth/TerrainEngineNode>
+#include <osgEarth/GeoMath>
+#include <osgEarth/Map>
 
 using namespace osgEarth;
 using namespace osgEarth::Contrib;
 
+// Resolution of the immediate coarse profile, as a fraction of the path length
+#define COARSE_DIVISIONS 32.0
+
+namespace
+{
+    // Delivers the background refinements on the update thread
+    struct ProfileUpdateCallback : public osg::NodeCallback
+    {
+        osg::observer_ptr<TerrainProfileCalculator> _calculator;
+
+        ProfileUpdateCallback(TerrainProfileCalculator* calculator) :
+            _calculator(calculator) { }
+
+        void operator()(osg::Node* node, osg::NodeVisitor* nv) override
+        {
+            osg::ref_ptr<TerrainProfileCalculator> calculator;
+            if (_calculator.lock(calculator))
+                calculator->update();
+            traverse(node, nv);
+        }
+    };
+
+    // Samples the path between two points in map coordinates, following
+    // the great circle on a geographic map. Returns the distance of each
+    // sample from the start, in meters.
+    bool buildPath(
+        const GeoPoint& start,
+        const GeoPoint& end,
+        const SpatialReference* mapSRS,
+        unsigned numSamples,
+        std::vector<osg::Vec4d>& path,
+        std::vector<double>& distances)
+    {
+        GeoPoint a, b;
+        if (!start.transform(mapSRS, a) || !end.transform(mapSRS, b))
+            return false;
+
+        path.resize(numSamples);
+        distances.resize(numSamples);
+
+        double length;
+        if (mapSRS->isGeographic())
+        {
+            double lat1 = osg::DegreesToRadians(a.y()), lon1 = osg::DegreesToRadians(a.x());
+            double lat2 = osg::DegreesToRadians(b.y()), lon2 = osg::DegreesToRadians(b.x());
+            length = GeoMath::distance(lat1, lon1, lat2, lon2);
+            double bearing = GeoMath::bearing(lat1, lon1, lat2, lon2);
+
+            for (unsigned i = 0; i < numSamples; ++i)
+            {
+                double d = length * (double)i / (double)(numSamples - 1);
+                double lat, lon;
+                GeoMath::destination(lat1, lon1, bearing, d, lat, lon);
+                path[i].set(osg::RadiansToDegrees(lon), osg::RadiansToDegrees(lat), 0.0, 0.0);
+                distances[i] = d;
+            }
+        }
+        else
+        {
+            osg::Vec3d delta = b.vec3d() - a.vec3d();
+            delta.z() = 0.0;
+            double toMeters = Distance(1.0, mapSRS->getUnits()).as(Units::METERS);
+            length = delta.length() * toMeters;
+
+            for (unsigned i = 0; i < numSamples; ++i)
+            {
+                double t = (double)i / (double)(numSamples - 1);
+                osg::Vec3d p = a.vec3d() + delta * t;
+                path[i].set(p.x(), p.y(), 0.0, 0.0);
+                distances[i] = length * t;
+            }
+        }
+
+        return length > 0.0;
+    }
+
+    // Writes the sampling resolution (in meters) into W, in map units
+    void setResolution(
+        std::vector<osg::Vec4d>& path,
+        double resolution,
+        const SpatialReference* mapSRS)
+    {
+        for (auto& p : path)
+        {
+            p.z() = 0.0;
+            p.w() = SpatialReference::transformUnits(
+                Distance(resolution, Units::METERS), mapSRS, p.y());
+        }
+    }
+}
+
 /***************************************************/
 TerrainProfile::TerrainProfile():
 _spacing( 1.0 )
@@ -93,36 +186,80 @@ TerrainProfile::getElevationRanges(double &min, double &max ) const
 TerrainProfileCalculator::TerrainProfileCalculator(MapNode* mapNode, const GeoPoint& start, const GeoPoint& end):
 _mapNode( mapNode ),
 _start( start),
-_end( end )
+_end( end ),
+_numSamples( 256u ),
+_refinementNeeded( false )
 {        
     _mapNode->getTerrain()->addTerrainCallback( this );        
+    installUpdateCallback();
     recompute();
 }
 
 TerrainProfileCalculator::TerrainProfileCalculator(MapNode* mapNode):
-_mapNode( mapNode )
+_mapNode( mapNode ),
+_numSamples( 256u ),
+_refinementNeeded( false )
 {
     _mapNode->getTerrain()->addTerrainCallback( this );
+    installUpdateCallback();
 }
 
 TerrainProfileCalculator::~TerrainProfileCalculator()
 {
-    _mapNode->getTerrain()->removeTerrainCallback( this );
+    _refinement.abandon();
+    if (_mapNode.valid())
+    {
+        removeUpdateCallback();
+        _mapNode->getTerrain()->removeTerrainCallback( this );
+    }
 }
 
 void TerrainProfileCalculator::setMapNode( osgEarth::MapNode* mapNode )
 {
   if (_mapNode.valid())
+  {
+      removeUpdateCallback();
       _mapNode->getTerrain()->removeTerrainCallback( this );
+  }
+
+  _refinement.abandon();
+  _sampler.reset();
+  _workingSet.clear();
 
   _mapNode = mapNode;
   if (_mapNode.valid())
   {
       _mapNode->getTerrain()->addTerrainCallback( this );
+      installUpdateCallback();
       recompute();
   }
 }
 
+void TerrainProfileCalculator::installUpdateCallback()
+{
+    _updateCallback = new ProfileUpdateCallback(this);
+    _mapNode->addUpdateCallback( _updateCallback.get() );
+}
+
+void TerrainProfileCalculator::removeUpdateCallback()
+{
+    if (_updateCallback.valid())
+    {
+        _mapNode->removeUpdateCallback( _updateCallback.get() );
+        _updateCallback = nullptr;
+    }
+}
+
+void TerrainProfileCalculator::setNumSamples(unsigned value)
+{
+    value = osg::maximum(value, 2u);
+    if (value != _numSamples)
+    {
+        _numSamples = value;
+        recompute();
+    }
+}
+
 void TerrainProfileCalculator::addChangedCallback( ChangedCallback* callback )
 {
     _changedCallbacks.push_back( callback );
@@ -186,7 +323,7 @@ void TerrainProfileCalculator::setStartEnd(const GeoPoint& start, const GeoPoint
 
 void TerrainProfileCalculator::onTileUpdate(const osgEarth::TileKey& tileKey, osg::Node* graph, TerrainCallbackContext&)
 {
-    if (_start.isValid() && _end.isValid())
+    if (_start.isValid() && _end.isValid() && !_path.empty())
     {
         GeoExtent extent( _start.getSRS());
         extent.expandToInclude(_start.x(), _start.y());
@@ -194,26 +331,95 @@ void TerrainProfileCalculator::onTileUpdate(const osgEarth::TileKey& tileKey, os
 
         if (tileKey.getExtent().intersects( extent ))
         {
-            recompute();
+            // coalesce bursts of tile updates into one refinement
+            _refinementNeeded = true;
         }
     }
 }
 
 void TerrainProfileCalculator::recompute()
 {
-    if (_start.isValid() && _end.isValid())
+    _refinement.abandon();
+    _refinementNeeded = false;
+    _profile.clear();
+    _path.clear();
+
+    if (_start.isValid() && _end.isValid() && _mapNode.valid())
+    {
+        const Map* map = _mapNode->getMap();
+
+        if (buildPath(_start, _end, map->getSRS(), _numSamples, _path, _distances))
+        {
+            // Coarse pass right away, from low-resolution data that is
+            // likely already resident in the pool's working set:
+            std::vector<osg::Vec4d> points(_path);
+            setResolution(points, _distances.back() / COARSE_DIVISIONS, map->getSRS());
+            map->getElevationPool()->sampleMapCoords(points, &_workingSet, nullptr);
+
+            for (unsigned i = 0; i < points.size(); ++i)
+            {
+                if (points[i].z() != NO_DATA_VALUE)
+                    _profile.addElevation(_distances[i], points[i].z());
+            }
+
+            // Full resolution in the background:
+            refine();
+        }
+        else
+        {
+            _path.clear();
+        }
+
+        fireChanged();
+    }
+}
+
+void TerrainProfileCalculator::refine()
+{
+    if (!_sampler)
+        _sampler.reset(new AsyncElevationSampler(_mapNode->getMap()));
+
+    // sample at the spacing of the path itself
+    double spacing = _distances.back() / (double)(_path.size() - 1);
+    std::vector<osg::Vec4d> points(_path);
+    setResolution(points, spacing, _mapNode->getMap()->getSRS());
+
+    _refinementNeeded = false;
+    _refinement = _sampler->getSamples(points);
+}
+
+void TerrainProfileCalculator::update()
+{
+    if (_refinement.isAvailable())
     {
-        computeTerrainProfile( _mapNode.get(), _start, _end, _profile);
+        const std::vector<osg::Vec4d>& points = _refinement.get();
 
-        for( ChangedCallbackList::iterator i = _changedCallbacks.begin(); i != _changedCallbacks.end(); i++ )
+        if (points.size() == _distances.size())
         {
-            if ( i->get() )
-                i->get()->onChanged(this);
+            _profile.clear();
+            for (unsigned i = 0; i < points.size(); ++i)
+            {
+                if (points[i].z() != NO_DATA_VALUE)
+                    _profile.addElevation(_distances[i], points[i].z());
+            }
         }
+
+        _refinement.abandon();
+        fireChanged();
     }
-    else
+
+    if (_refinementNeeded && !isRefining() && !_path.empty())
+    {
+        refine();
+    }
+}
+
+void TerrainProfileCalculator::fireChanged()
+{
+    for( ChangedCallbackList::iterator i = _changedCallbacks.begin(); i != _changedCallbacks.end(); i++ )
     {
-        _profile.clear();
+        if ( i->get() )
+            i->get()->onChanged(this);
     }
 }
 
@@ -29,12 +29,44 @@
 
 #define LC "[TerrainTileModelFactory] "
 
-#define ARENA_ASYNC_LAYER "oe.layer.async"
 
 using namespace osgEarth;
 
 namespace
 {
+    // Layer list that reuses a per-thread vector, so that assembling a
+    // tile model doesn't allocate a new list on every pass over the map.
+    // Falls back on a local vector if the thread's list is already in use.
+    template<typename V>
+    struct ScratchLayers
+    {
+        V _local;
+        V* _layers;
+        bool* _inUse;
+
+        ScratchLayers() : _layers(&_local), _inUse(nullptr)
+        {
+            thread_local V t_layers;
+            thread_local bool t_inUse = false;
+            if (!t_inUse)
+            {
+                t_inUse = true;
+                _inUse = &t_inUse;
+                _layers = &t_layers;
+            }
+        }
+
+        ~ScratchLayers()
+        {
+            // drop the layer references but keep the capacity
+            _layers->clear();
+            if (_inUse)
+                *_inUse = false;
+        }
+
+        V& get() { return *_layers; }
+    };
+
     class FutureImage : public osg::Image
     {
     public:
@@ -43,22 +75,9 @@ namespace
             _layer = layer;
             _key = key;
 
-            osg::observer_ptr<ImageLayer> layer_ptr(_layer);
-
-            Job job(JobArena::get(ARENA_ASYNC_LAYER));
-
-            _result = job.dispatch<GeoImage>(
-                [layer_ptr, key](Cancelable* progress) mutable
-                {
-                    GeoImage result;
-                    osg::ref_ptr<ImageLayer> safe(layer_ptr);
-                    if (safe.valid())
-                    {
-                        result = safe->createImage(key, new ProgressCallback(progress));
-                    }
-                    return result;
-                }
-            );
+            // Layers with an asynchronous read path won't tie up a thread
+            // while they wait on the network; the rest run in a job.
+            _result = _layer->createImageAsync(key);
         }
 
         bool requiresUpdateCall() const override
@@ -101,6 +120,79 @@ namespace
         TileKey _key;
         Future<GeoImage> _result;
     };
+
+    // Process-wide table of image layer textures, shared by every terrain
+    // engine that sets the shareTileData option. Entries are weak, so a
+    // texture lives only as long as some engine's tiles still use it.
+    class SharedTextures
+    {
+    public:
+        static SharedTextures& get()
+        {
+            static SharedTextures s_instance;
+            return s_instance;
+        }
+
+        // layer UID, tile key, layer revision and dirty region revision,
+        // plus the compression method since that changes the texture.
+        static std::string makeKey(
+            const ImageLayer* layer,
+            const TileKey& key,
+            const std::string& compression)
+        {
+            return Stringify()
+                << layer->getUID() << '/'
+                << layer->getRevision() << '/'
+                << layer->getDirtyRegionRevision(key) << '/'
+                << key.str() << '/'
+                << key.getProfile()->getHorizSignature() << '/'
+                << compression;
+        }
+
+        osg::Texture* find(const std::string& key)
+        {
+            ScopedMutexLock lock(_mutex);
+            auto i = _textures.find(key);
+            if (i != _textures.end())
+            {
+                osg::ref_ptr<osg::Texture> tex;
+                if (i->second.lock(tex))
+                    return tex.release();
+                _textures.erase(i);
+            }
+            return nullptr;
+        }
+
+        void insert(const std::string& key, osg::Texture* tex)
+        {
+            ScopedMutexLock lock(_mutex);
+            _textures[key] = tex;
+
+            // sweep out textures nobody uses anymore
+            if (++_insertsSinceSweep >= 1024u)
+            {
+                for (auto i = _textures.begin(); i != _textures.end(); )
+                {
+                    if (i->second.valid())
+                        ++i;
+                    else
+                        i = _textures.erase(i);
+                }
+                _insertsSinceSweep = 0u;
+            }
+        }
+
+        // serializes the loads of one tile so that engines asking for it
+        // at the same time load it once
+        Gate<std::string> _loadGate;
+
+    private:
+        SharedTextures() : _insertsSinceSweep(0u), _loadGate("SharedTextures(OE)") { }
+
+        Mutex _mutex;
+        std::unordered_map<std::string, osg::observer_ptr<osg::Texture> > _textures;
+        unsigned _insertsSinceSweep;
+    };
 }
 
 //.........................................................................
@@ -217,11 +309,15 @@ _options( options )
     _emptyColorTexture = new osg::Texture2D(ImageUtils::createEmptyImage());
     _emptyColorTexture->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
 
-    osg::Image* landCoverImage = LandCover::createImage(1u);
-    ImageUtils::PixelWriter writeLC(landCoverImage);
+    if (_options.indexedLandCover() == true)
+    {
+        _landCoverPalette = new LandCoverPalette();
+    }
+
+    osg::ref_ptr<osg::Image> landCoverImage = LandCover::createImage(1u);
+    ImageUtils::PixelWriter writeLC(landCoverImage.get());
     writeLC(osg::Vec4(0,0,0,0), 0, 0);
-    _emptyLandCoverTexture = new osg::Texture2D(landCoverImage);
-    _emptyLandCoverTexture->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
+    _emptyLandCoverTexture = createCoverageTexture(landCoverImage.get());
 }
 
 TerrainTileModel*
@@ -299,6 +395,7 @@ TerrainTileModelFactory::addImageLayer(
 
     TerrainTileImageLayerModel* layerModel = NULL;
     osg::Texture* tex = 0L;
+    bool sharedTexture = false;
     TextureWindow window;
     osg::Matrix scaleBiasMatrix;
 
@@ -330,6 +427,44 @@ TerrainTileModelFactory::addImageLayer(
             tex->setDataVariance(osg::Object::DYNAMIC);
         }
 
+        else if (_options.shareTileData() == true && !imageLayer->isDynamic())
+        {
+            static Stats::Counter& s_sharedHits = Stats::counter("osgearth_shared_tile_textures_reused");
+
+            SharedTextures& shared = SharedTextures::get();
+            std::string sharedKey = SharedTextures::makeKey(imageLayer, key, _options.textureCompression().get());
+
+            ScopedGate<std::string> lockTile(shared._loadGate, sharedKey);
+
+            tex = shared.find(sharedKey);
+            if (tex)
+            {
+                // loaded by another engine; it's already named and set up
+                sharedTexture = true;
+                s_sharedHits.add();
+            }
+            else
+            {
+                GeoImage geoImage = imageLayer->createImage(key, progress);
+
+                if (geoImage.valid())
+                {
+                    if (imageLayer->isCoverage())
+                        tex = createCoverageTexture(geoImage.getImage());
+                    else
+                        tex = createImageTexture(geoImage.getImage(), imageLayer);
+                }
+
+                // don't share a tile that was canceled part way
+                if (tex && !(progress && progress->isCanceled()))
+                {
+                    // other contexts may still need to upload it
+                    tex->setUnRefImageDataAfterApply(false);
+                    shared.insert(sharedKey, tex);
+                }
+            }
+        }
+
         else
         {
             GeoImage geoImage = imageLayer->createImage(key, progress);
@@ -355,9 +490,12 @@ TerrainTileModelFactory::addImageLayer(
 
     if (tex)
     {
-        tex->setName(
-            model->getKey().str() + ":" +
-            (imageLayer->getName().empty() ? "(unnamed image layer)" : imageLayer->getName()));
+        if (!sharedTexture)
+        {
+            tex->setName(
+                model->getKey().str() + ":" +
+                (imageLayer->getName().empty() ? "(unnamed image layer)" : imageLayer->getName()));
+        }
 
         layerModel = new TerrainTileImageLayerModel();
 
@@ -429,7 +567,8 @@ TerrainTileModelFactory::addColorLayers(
 
     int order = 0;
 
-    LayerVector layers;
+    ScratchLayers<LayerVector> scratch;
+    LayerVector& layers = scratch.get();
     map->getLayers(layers);
 
     for (LayerVector::const_iterator i = layers.begin(); i != layers.end(); ++i)
@@ -520,7 +659,8 @@ TerrainTileModelFactory::addElevation(
     OE_PROFILING_ZONE_TEXT("Elevation");
 
     bool needElevation = manifest.includesElevation();
-    ElevationLayerVector layers;
+    ScratchLayers<ElevationLayerVector> scratch;
+    ElevationLayerVector& layers = scratch.get();
     map->getLayers(layers);
 
     int combinedRevision = map->getDataModelRevision();
@@ -638,7 +778,8 @@ TerrainTileModelFactory::addLandCover(
     TerrainTileLandCoverModel* landCoverModel = NULL;
 
     // Note. We only support one land cover layer...
-    LandCoverLayerVector layers;
+    ScratchLayers<LandCoverLayerVector> scratch;
+    LandCoverLayerVector& layers = scratch.get();
     map->getLayers(layers);
     int combinedRevision = map->getDataModelRevision();
 
@@ -671,6 +812,11 @@ TerrainTileModelFactory::addLandCover(
 
     osg::ref_ptr<osg::Texture> tex;
 
+    if (_landCoverPalette.valid())
+    {
+        _landCoverPalette->addClasses(map->getLayer<LandCoverDictionary>());
+    }
+
     if (layers.populateLandCoverImage(coverageImage, key, progress))
     {
         tex = createCoverageTexture(coverageImage.get());
@@ -761,7 +907,21 @@ TerrainTileModelFactory::createImageTexture(const osg::Image* image,
         else if (pixelFormat == GL_RED) internalFormat = GL_R8;
     }
 
-    if (image->r() == 1)
+    // A tile that is one solid color (ocean, empty sky, clear alpha)
+    // samples the same from a single texel, so don't upload the rest.
+    osg::ref_ptr<osg::Image> uniform;
+    if (image->r() == 1 && layer->getDetectUniformTiles())
+    {
+        uniform = ImageUtils::reduceUniformImage(image);
+    }
+
+    if (uniform.valid())
+    {
+        tex = new osg::Texture2D(uniform.get());
+        tex->setInternalFormat(internalFormat);
+    }
+
+    else if (image->r() == 1)
     {
         osg::ref_ptr<const osg::Image> compressed = ImageUtils::compressImage(image, compressionMethod);
         const osg::Image* mipmapped = ImageUtils::mipmapImage(compressed.get());
@@ -846,10 +1006,22 @@ TerrainTileModelFactory::createImageTexture(const osg::Image* image,
 osg::Texture*
 TerrainTileModelFactory::createCoverageTexture(const osg::Image* image) const
 {
-    osg::Texture2D* tex = new osg::Texture2D(const_cast<osg::Image*>(image));
-    tex->setDataVariance(osg::Object::STATIC);
+    osg::Texture2D* tex;
+
+    if (_landCoverPalette.valid())
+    {
+        // one byte per texel; the shader maps indices back to codes
+        tex = new osg::Texture2D(_landCoverPalette->createIndexedImage(image));
+        tex->setInternalFormat(LandCoverPalette::getTextureFormat());
+        tex->setUserData(_landCoverPalette.get());
+    }
+    else
+    {
+        tex = new osg::Texture2D(const_cast<osg::Image*>(image));
+        tex->setInternalFormat(LandCover::getTextureFormat());
+    }
 
-    tex->setInternalFormat(LandCover::getTextureFormat());
+    tex->setDataVariance(osg::Object::STATIC);
 
     tex->setWrap( osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE );
     tex->setWrap( osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE );
@@ -320,43 +320,60 @@ Tessellator::tessellateGeometry(osg::Geometry &geom)
     }
     return success;
 #else
-    // Create array
-    std::vector< std::vector< osg::Vec2 > > polygon;
-    osg::Vec3Array* verts = static_cast<osg::Vec3Array*>(geom.getVertexArray());
+    osg::Vec3Array* verts = dynamic_cast<osg::Vec3Array*>(geom.getVertexArray());
+    if (!verts || verts->size() < 3 || geom.getNumPrimitiveSets() == 0)
+        return false;
+
+    // Earcut takes the rings as arrays of points; the first ring is the
+    // outline and the rest are holes. Its indices address the points of
+    // all the rings in order, which is the order of the vertex array as
+    // long as every primitive set is a DrawArrays over consecutive verts.
+    std::vector< std::vector< osg::Vec2 > > polygon(geom.getNumPrimitiveSets());
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < geom.getNumPrimitiveSets(); i++)
+    {
+        osg::PrimitiveSet* pset = geom.getPrimitiveSet(i);
+        if (pset->getType() != osg::PrimitiveSet::DrawArraysPrimitiveType)
+            return false;
+
+        osg::DrawArrays* drawArray = static_cast<osg::DrawArrays*>(pset);
+        if (drawArray->getFirst() != next || next + drawArray->getCount() > verts->size())
+            return false;
+
+        next += drawArray->getCount();
+    }
+
     int areaPlane = polygonPlane(*verts);
 
     for (unsigned int i = 0; i < geom.getNumPrimitiveSets(); i++)
     {
-        std::vector< osg::Vec2 > ring;
-        osg::PrimitiveSet* pset = geom.getPrimitiveSet(i);
-        if (pset->getType() == osg::PrimitiveSet::DrawArraysPrimitiveType)
+        osg::DrawArrays* drawArray = static_cast<osg::DrawArrays*>(geom.getPrimitiveSet(i));
+        unsigned int first = drawArray->getFirst();
+        unsigned int last = first + drawArray->getCount();
+
+        std::vector< osg::Vec2 >& ring = polygon[i];
+        ring.reserve(drawArray->getCount());
+        for (unsigned int j = first; j < last; j++)
         {
-            osg::DrawArrays* drawArray = static_cast<osg::DrawArrays*>(pset);
-            unsigned int first = drawArray->getFirst();
-            unsigned int last = first + drawArray->getCount();
-            ring.reserve(drawArray->getCount());
-            for (unsigned int j = first; j < last; j++)
-            {
-                const osg::Vec3& v = verts->at(j);
-                switch (areaPlane) {
-                    case AREA_PLANE_XY: ring.push_back(osg::Vec2(v.x(), v.y())); break;
-                    case AREA_PLANE_XZ: ring.push_back(osg::Vec2(v.x(), v.z())); break;
-                    case AREA_PLANE_YZ: ring.push_back(osg::Vec2(v.y(), v.z())); break;
-                }
+            const osg::Vec3& v = (*verts)[j];
+            switch (areaPlane) {
+                case AREA_PLANE_XY: ring.push_back(osg::Vec2(v.x(), v.y())); break;
+                case AREA_PLANE_XZ: ring.push_back(osg::Vec2(v.x(), v.z())); break;
+                case AREA_PLANE_YZ: ring.push_back(osg::Vec2(v.y(), v.z())); break;
             }
         }
-        polygon.push_back(ring);
     }
 
     // The index type. Defaults to uint32_t, but you can also pass uint16_t if you know that your
     // data won't have more than 65536 vertices.
     std::vector<uint32_t> indices = mapbox::earcut<uint32_t>(polygon);
+
     // Remove the existing primitive sets
     geom.removePrimitiveSet(0, geom.getNumPrimitiveSets());
-    osg::DrawElementsUInt* drawElements = new osg::DrawElementsUInt(GL_TRIANGLES);
-    drawElements->reserve(indices.size());
-    std::copy(indices.begin(), indices.end(), std::back_inserter(*drawElements));
-    geom.addPrimitiveSet(drawElements);
+    if (!indices.empty())
+    {
+        geom.addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, indices.size(), &indices[0]));
+    }
     return true;
 #endif
 }
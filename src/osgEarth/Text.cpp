@@ -47,7 +47,8 @@ REGISTER_OBJECT_WRAPPER( osgEarth_Text,
 //....................................................................
 
 Text::Text() : 
-osgText::Text()
+osgText::Text(),
+_glyphMemory(Memory::LABEL_GLYPHS)
 {
 #if OSG_VERSION_GREATER_OR_EQUAL(3,5,8)
     if (osg::DisplaySettings::instance()->getTextShaderTechnique().empty())
@@ -58,7 +59,8 @@ osgText::Text()
 }
 
 Text::Text(const std::string& str) :
-osgText::Text()
+osgText::Text(),
+_glyphMemory(Memory::LABEL_GLYPHS)
 {
 #if OSG_VERSION_GREATER_OR_EQUAL(3,5,8)
     if (osg::DisplaySettings::instance()->getTextShaderTechnique().empty())
@@ -71,7 +73,8 @@ osgText::Text()
 }
 
 Text::Text(const Text& rhs, const osg::CopyOp& copy) :
-osgText::Text(rhs, copy)
+osgText::Text(rhs, copy),
+_glyphMemory(Memory::LABEL_GLYPHS)
 {
     //nop
 }
@@ -81,6 +84,25 @@ Text::~Text()
     //nop
 }
 
+void
+Text::computeGlyphRepresentation()
+{
+    osgText::Text::computeGlyphRepresentation();
+
+    // charge the glyph quads to the label subsystem; the glyph
+    // textures themselves belong to the shared fonts
+    std::size_t bytes = 0u;
+#if OSG_VERSION_GREATER_OR_EQUAL(3,5,8)
+    if (_coords.valid()) bytes += _coords->getTotalDataSize();
+    if (_normals.valid()) bytes += _normals->getTotalDataSize();
+    if (_colorCoords.valid()) bytes += _colorCoords->getTotalDataSize();
+    if (_texcoords.valid()) bytes += _texcoords->getTotalDataSize();
+#else
+    bytes = _text.size() * 4u * (sizeof(osg::Vec3) + sizeof(osg::Vec2));
+#endif
+    _glyphMemory.set(bytes);
+}
+
 osg::StateSet*
 Text::createStateSet()
 {
@@ -264,3 +286,179 @@ Text::setFont(osg::ref_ptr<osgText::Font> font)
     osgText::TextBase::setFont(font);
 #endif
 }
+
+bool
+Text::isBatchable() const
+{
+#if OSG_VERSION_GREATER_OR_EQUAL(3,5,8)
+    // The batch only reproduces the glyph pass of drawImplementation,
+    // with positions taken as-is from the coordinate array.
+    return
+        getShaderTechnique() != osgText::NO_TEXT_SHADER &&
+        getCharacterSizeMode() == OBJECT_COORDS &&
+        getAutoRotateToScreen() == false &&
+        getDrawMode() == TEXT &&
+        getEnableDepthWrites() == false &&
+        _textureGlyphQuadMap.size() == 1u &&
+        _coords.valid() &&
+        _texcoords.valid() &&
+        _coords->size() == _texcoords->size() &&
+        _coords->size() % 4u == 0u;
+#else
+    return false;
+#endif
+}
+
+//....................................................................
+
+TextBatch::TextBatch() :
+_numSlots(0u),
+_numVerts(0u),
+_dirty(false)
+{
+    _verts = new osg::Vec3Array();
+    _verts->setBinding(osg::Array::BIND_PER_VERTEX);
+
+    _colors = new osg::Vec4Array();
+    _colors->setBinding(osg::Array::BIND_PER_VERTEX);
+
+    _texcoords = new osg::Vec2Array();
+    _texcoords->setBinding(osg::Array::BIND_PER_VERTEX);
+
+    _primset = new osg::DrawArrays(GL_TRIANGLES, 0, 0);
+
+    _geom = new osg::Geometry();
+    _geom->setName("osgEarth::TextBatch");
+    _geom->setDataVariance(osg::Object::DYNAMIC);
+    _geom->setUseDisplayList(false);
+    _geom->setUseVertexBufferObjects(true);
+    _geom->setVertexArray(_verts.get());
+    _geom->setColorArray(_colors.get());
+    _geom->setTexCoordArray(0, _texcoords.get());
+    _geom->addPrimitiveSet(_primset.get());
+}
+
+void
+TextBatch::reset()
+{
+    _numSlots = 0u;
+    _numVerts = 0u;
+    _texture = NULL;
+}
+
+bool
+TextBatch::add(const Text* text, const osg::Matrix& modelview, float fade)
+{
+#if OSG_VERSION_GREATER_OR_EQUAL(3,5,8)
+    if (text == NULL || !text->isBatchable())
+        return false;
+
+    osg::Texture* texture = text->_textureGlyphQuadMap.begin()->first.get();
+    if (_texture.valid() && _texture.get() != texture)
+        return false;
+
+    _texture = texture;
+
+    const osg::Vec3Array& coords = *text->_coords.get();
+    const osg::Vec2Array& texcoords = *text->_texcoords.get();
+    const osg::Vec4Array* colors = text->_colorCoords.get();
+    if (colors && colors->size() != coords.size())
+        colors = NULL;
+
+    // two triangles per glyph quad
+    unsigned count = (coords.size() / 4u) * 6u;
+
+    unsigned coordsRev = coords.getModifiedCount();
+    unsigned texcoordsRev = texcoords.getModifiedCount();
+    unsigned colorsRev = colors ? colors->getModifiedCount() : 0u;
+
+    if (_numSlots < _slots.size())
+    {
+        // same text in the same place as last time? Leave it alone.
+        const Slot& slot = _slots[_numSlots];
+        if (slot._text == text &&
+            slot._first == _numVerts &&
+            slot._count == count &&
+            slot._fade == fade &&
+            slot._coordsRev == coordsRev &&
+            slot._texcoordsRev == texcoordsRev &&
+            slot._colorsRev == colorsRev &&
+            slot._modelview == modelview)
+        {
+            ++_numSlots;
+            _numVerts += count;
+            return true;
+        }
+    }
+    else
+    {
+        _slots.resize(_numSlots + 1u);
+    }
+
+    Slot& slot = _slots[_numSlots++];
+    slot._text = text;
+    slot._modelview = modelview;
+    slot._fade = fade;
+    slot._first = _numVerts;
+    slot._count = count;
+    slot._coordsRev = coordsRev;
+    slot._texcoordsRev = texcoordsRev;
+    slot._colorsRev = colorsRev;
+
+    if (_verts->size() < _numVerts + count)
+    {
+        _verts->resize(_numVerts + count);
+        _colors->resize(_numVerts + count);
+        _texcoords->resize(_numVerts + count);
+    }
+
+    osg::Vec4 color = text->getColor();
+    static const unsigned corners[6] = { 0, 1, 2, 0, 2, 3 };
+
+    unsigned v = _numVerts;
+    for (unsigned q = 0; q < coords.size(); q += 4u)
+    {
+        for (unsigned c = 0; c < 6u; ++c, ++v)
+        {
+            unsigned i = q + corners[c];
+            (*_verts)[v] = coords[i] * modelview;
+            (*_texcoords)[v] = texcoords[i];
+            (*_colors)[v] = colors ? (*colors)[i] : color;
+            (*_colors)[v].a() *= fade;
+        }
+    }
+
+    _numVerts += count;
+    _dirty = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+TextBatch::draw(osg::RenderInfo& renderInfo)
+{
+    if (empty())
+        return;
+
+    // later texts may have been dropped since the last draw
+    if (_numSlots < _slots.size())
+    {
+        _slots.resize(_numSlots);
+    }
+
+    if (_dirty)
+    {
+        _verts->dirty();
+        _colors->dirty();
+        _texcoords->dirty();
+        _dirty = false;
+    }
+
+    _primset->setCount(_numVerts);
+
+    renderInfo.getState()->applyTextureAttribute(0, _texture.get());
+
+    _geom->draw(renderInfo);
+}
@@ -21,6 +21,7 @@
 #include "Utils"
 #include "Metrics"
 #include <cstdlib>
+#include <algorithm>
 
 #ifdef _WIN32
 #   include <Windows.h>
@@ -537,17 +538,43 @@ JobGroup::join(Cancelable* cancelable)
 Mutex JobArena::_arenas_mutex("OE:JobArena");
 std::unordered_map<std::string, std::shared_ptr<JobArena>> JobArena::_arenas;
 std::unordered_map<std::string, unsigned> JobArena::_arenaSizes;
+std::unordered_map<std::string, JobArena::Type> JobArena::_arenaTypes;
 std::string JobArena::_defaultArenaName = "oe.default";
 JobArena::Metrics JobArena::_allMetrics;
 
 #define OE_ARENA_DEFAULT_SIZE 2u
 
-JobArena::JobArena(const std::string& name, unsigned concurrency) :
+namespace
+{
+    // worker-queue index of the current thread, if it belongs to a
+    // WORK_STEALING arena; so jobs dispatched from a job stay local.
+    thread_local const JobArena* t_workerArena = nullptr;
+    thread_local unsigned t_workerQueue = 0u;
+}
+
+JobArena::JobArena(const std::string& name, unsigned concurrency, const Type& type) :
     _name(name),
+    _type(type),
     _targetConcurrency(concurrency),
     _done(false),
-    _queueMutex("OE.JobArena[" + name + "]")
+    _queueMutex("OE.JobArena[" + name + "]"),
+    _nextWorkerQueue(0u),
+    _numWorkerJobs(0),
+    _numIdleWorkers(0),
+    _priorityEpoch(0u)
 {
+    if (_type == WORK_STEALING)
+    {
+        // Queue count is fixed for the life of the arena so workers can
+        // scan it without locking. Extra threads share queues.
+        unsigned numQueues = std::max(concurrency, getConcurrency());
+        for (unsigned i = 0; i < numQueues; ++i)
+        {
+            _workerQueues.emplace_back(new WorkerQueue());
+            _workerQueues.back()->_mutex.setName("OE.JobArena[" + name + "].worker");
+        }
+    }
+
     // find a slot in the stats
     int new_index = -1;
     for (int i = 0; i < 512 && new_index < 0; ++i)
@@ -599,8 +626,11 @@ JobArena::get(const std::string& name)
     {
         auto iter = _arenaSizes.find(name);
         unsigned numThreads = iter != _arenaSizes.end() ? iter->second : OE_ARENA_DEFAULT_SIZE;
+
+        auto typeIter = _arenaTypes.find(name);
+        Type type = typeIter != _arenaTypes.end() ? typeIter->second : THREAD_POOL;
         
-        arena = std::make_shared<JobArena>(name, numThreads);
+        arena = std::make_shared<JobArena>(name, numThreads, type);
     }
     return arena.get();
 }
@@ -635,6 +665,20 @@ JobArena::setConcurrency(const std::string& name, unsigned value)
     }
 }
 
+void
+JobArena::setType(const std::string& name, const Type& type)
+{
+    ScopedMutexLock lock(_arenas_mutex);
+    _arenaTypes[name] = type;
+
+    auto iter = _arenas.find(name);
+    if (iter != _arenas.end() && iter->second->getType() != type)
+    {
+        OE_WARN << LC << "Arena \"" << name << "\" already exists; "
+            << "type change will not take effect" << std::endl;
+    }
+}
+
 void
 JobArena::dispatch(
     const Job& job,
@@ -648,10 +692,35 @@ JobArena::dispatch(
         sema->acquire();
     }
 
-    if (_targetConcurrency > 0)
+    if (_targetConcurrency > 0 && _type == WORK_STEALING)
+    {
+        // jobs dispatched from one of our own workers stay on that
+        // worker's queue; others are spread round-robin.
+        unsigned index = t_workerArena == this ?
+            t_workerQueue :
+            _nextWorkerQueue++ % _workerQueues.size();
+
+        WorkerQueue& wq = *_workerQueues[index];
+        {
+            std::lock_guard<Mutex> lock(wq._mutex);
+            wq._queue.push(QueuedJob(job, delegate, sema));
+            wq._size++;
+        }
+        _metrics->numJobsPending++;
+        _numWorkerJobs++;
+
+        // only touch the shared mutex if someone is actually asleep
+        if (_numIdleWorkers > 0)
+        {
+            std::lock_guard<Mutex> lock(_queueMutex);
+            _block.notify_one();
+        }
+    }
+
+    else if (_targetConcurrency > 0)
     {
         std::lock_guard<Mutex> lock(_queueMutex);
-        _queue.emplace(job, delegate, sema);
+        _queue.push(QueuedJob(job, delegate, sema));
         _metrics->numJobsPending++;
         _block.notify_one();
     }
@@ -678,18 +747,46 @@ JobArena::startThreads()
     // Not enough? Start up more
     while(_metrics->concurrency < _targetConcurrency)
     {
-        _threads.push_back(std::thread([this]
+        unsigned threadIndex = _threads.size();
+
+        _threads.push_back(std::thread([this, threadIndex]
             {
                 //OE_INFO << LC << "Arena \"" << _name << "\" starting thread " << std::this_thread::get_id() << std::endl;
                 _metrics->concurrency++;
 
                 OE_THREAD_NAME(_name.c_str());
 
+                unsigned home = 0u;
+                if (_type == WORK_STEALING)
+                {
+                    home = threadIndex % _workerQueues.size();
+                    t_workerArena = this;
+                    t_workerQueue = home;
+                }
+
                 while (!_done)
                 {
                     QueuedJob next;
 
                     bool have_next = false;
+
+                    if (_type == WORK_STEALING)
+                    {
+                        have_next = takeWork(home, next);
+
+                        if (!have_next)
+                        {
+                            // Increment the idle count BEFORE checking for work
+                            // so that dispatch() cannot miss us.
+                            std::unique_lock<Mutex> lock(_queueMutex);
+                            _numIdleWorkers++;
+                            _block.wait(lock, [this] {
+                                return _numWorkerJobs > 0 || _done == true;
+                            });
+                            _numIdleWorkers--;
+                        }
+                    }
+                    else
                     {
                         std::unique_lock<Mutex> lock(_queueMutex);
 
@@ -699,9 +796,7 @@ JobArena::startThreads()
 
                         if (!_queue.empty() && !_done)
                         {
-                            next = std::move(_queue.top());
-                            have_next = true;
-                            _queue.pop();
+                            have_next = _queue.pop(next, _priorityEpoch);
                         }
                     }
 
@@ -710,9 +805,18 @@ JobArena::startThreads()
                         _metrics->numJobsRunning++;
                         _metrics->numJobsPending--;
 
+                        auto start = std::chrono::steady_clock::now();
+                        _metrics->waitTime.record(
+                            std::chrono::duration_cast<std::chrono::microseconds>(start - next._queuedAt).count());
+
                         bool job_executed = next._delegate();
 
-                        if (!job_executed)
+                        if (job_executed)
+                        {
+                            _metrics->runTime.record(
+                                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+                        }
+                        else
                         {
                             _metrics->numJobsCanceled++;
                             //OE_INFO << LC << "Job canceled" << std::endl;
@@ -763,6 +867,21 @@ void JobArena::stopThreads()
             _queue.pop();
         }
 
+        for (auto& wq : _workerQueues)
+        {
+            std::lock_guard<Mutex> wqLock(wq->_mutex);
+            while (wq->_queue.empty() == false)
+            {
+                if (wq->_queue.top()._groupsema != nullptr)
+                {
+                    wq->_queue.top()._groupsema->reset();
+                }
+                wq->_queue.pop();
+            }
+            wq->_size = 0;
+        }
+        _numWorkerJobs = 0;
+
         // wake up all threads so they can exit
         _block.notify_all();
     }
@@ -779,6 +898,86 @@ void JobArena::stopThreads()
     _threads.clear();
 }
 
+bool
+JobArena::takeWork(unsigned home, QueuedJob& out)
+{
+    if (_numWorkerJobs == 0)
+        return false;
+
+    // Check our own queue first, then visit the others in order.
+    // Use try_lock when stealing so that idle workers never stall
+    // a busy queue's owner; retry with a full lock if nothing turned up.
+    const unsigned numQueues = _workerQueues.size();
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (unsigned i = 0; i < numQueues; ++i)
+        {
+            WorkerQueue& wq = *_workerQueues[(home + i) % numQueues];
+            if (wq._size == 0)
+                continue;
+
+            std::unique_lock<Mutex> lock(wq._mutex, std::defer_lock);
+            if (i == 0 || pass > 0)
+                lock.lock();
+            else if (!lock.try_lock())
+                continue;
+
+            if (!wq._queue.empty() && !_done)
+            {
+                wq._queue.pop(out, _priorityEpoch);
+                wq._size--;
+                _numWorkerJobs--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void
+JobArena::JobQueue::push(QueuedJob&& job)
+{
+    _heap.emplace_back(std::move(job));
+    std::push_heap(_heap.begin(), _heap.end());
+}
+
+void
+JobArena::JobQueue::pop()
+{
+    std::pop_heap(_heap.begin(), _heap.end());
+    _heap.pop_back();
+}
+
+bool
+JobArena::JobQueue::pop(QueuedJob& out, unsigned epoch)
+{
+    if (_heap.empty())
+        return false;
+
+    if (_epoch != epoch)
+    {
+        bool rekeyed = false;
+        for (auto& entry : _heap)
+        {
+            if (entry._job._priorityFunc != nullptr)
+            {
+                entry._priority = entry._job.getPriority();
+                rekeyed = true;
+            }
+        }
+        if (rekeyed)
+        {
+            std::make_heap(_heap.begin(), _heap.end());
+        }
+        _epoch = epoch;
+    }
+
+    std::pop_heap(_heap.begin(), _heap.end());
+    out = std::move(_heap.back());
+    _heap.pop_back();
+    return true;
+}
+
 const JobArena::Metrics::Arena&
 JobArena::Metrics::arena(int index) const
 {
@@ -38,6 +38,7 @@ ThreeDTilesLayer::Options::getConfig() const
     Config conf = VisibleLayer::Options::getConfig();
     conf.set("url", _url);
     conf.set("max_sse", _maximumScreenSpaceError);
+    conf.set("skip_lod", _skipLevelOfDetail);
     return conf;
 }
 
@@ -45,8 +46,10 @@ void
 ThreeDTilesLayer::Options::fromConfig( const Config& conf )
 {
     _maximumScreenSpaceError.init(15.0f);
+    _skipLevelOfDetail.init(false);
     conf.get("url", _url);
     conf.get("max_sse", _maximumScreenSpaceError);
+    conf.get("skip_lod", _skipLevelOfDetail);
 }
 
 //........................................................................
@@ -93,6 +96,7 @@ ThreeDTilesLayer::openImplementation()
 
     _tilesetNode = new ThreeDTilesetNode(tileset, "", getSceneGraphCallbacks(), readOptions.get());
     _tilesetNode->setMaximumScreenSpaceError(*options().maximumScreenSpaceError());
+    _tilesetNode->setSkipLevelOfDetail(*options().skipLevelOfDetail());
     _tilesetNode->setOwnerName(getName());
 
     return STATUS_OK;
@@ -114,6 +118,22 @@ ThreeDTilesLayer::setMaximumScreenSpaceError(float maximumScreenSpaceError)
     }
 }
 
+bool
+ThreeDTilesLayer::getSkipLevelOfDetail() const
+{
+    return *options().skipLevelOfDetail();
+}
+
+void
+ThreeDTilesLayer::setSkipLevelOfDetail(bool value)
+{
+    options().skipLevelOfDetail() = value;
+    if (_tilesetNode)
+    {
+        _tilesetNode->setSkipLevelOfDetail(value);
+    }
+}
+
 osg::Node*
 ThreeDTilesLayer::getNode() const
 {
@@ -27,6 +27,7 @@
 
 #include <osgEarth/OgrUtils>
 #include <osgEarth/OGRFeatureSource>
+#include <osgEarth/rtree.h>
 
 #include <osgDB/FileUtils>
 
@@ -34,15 +35,36 @@ using namespace osgEarth;
 using namespace osgEarth::Contrib;
 using namespace std;
 
+#define LC "[TileIndex] "
+
 #define OGR_SCOPED_LOCK GDAL_SCOPED_LOCK
 
-TileIndex::TileIndex()
+// Entries are indexes into _locations
+struct TileIndex::SpatialIndex : public RTree<unsigned, double, 2>
+{
+};
+
+namespace
 {
+    std::string getSpatialIndexFilename(const std::string& filename)
+    {
+        return filename + ".rtree";
+    }
 }
 
-TileIndex::~TileIndex()
+TileIndex::TileIndex() :
+_indexMutex("TileIndex(OE)"),
+_index(new SpatialIndex()),
+_dirty(false),
+_poolMutex("TileIndex Pool(OE)"),
+_numOpen(0u),
+_maxOpenDatasets(64u)
 {
+}
 
+TileIndex::~TileIndex()
+{
+    save();
 }
 
 TileIndex*
@@ -68,9 +90,114 @@ TileIndex::load(const std::string& filename)
     TileIndex* index = new TileIndex();
     index->_features = features.get();
     index->_filename = filename;
+
+    if (!index->loadSpatialIndex())
+    {
+        index->buildSpatialIndex();
+        index->save();
+    }
+
     return index;
 }
 
+bool
+TileIndex::loadSpatialIndex()
+{
+    std::string indexFilename = getSpatialIndexFilename(_filename);
+
+    // A shapefile changed after the R-tree was written invalidates it
+    if (!osgDB::fileExists(indexFilename) ||
+        getLastModifiedTime(indexFilename) < getLastModifiedTime(_filename))
+    {
+        return false;
+    }
+
+    RTFileStream stream;
+    if (!stream.OpenRead(indexFilename.c_str()))
+        return false;
+
+    if (!_index->Load(stream))
+        return false;
+
+    // The locations follow the tree
+    unsigned count = 0u;
+    bool ok = stream.Read(count) == 1;
+    _locations.resize(ok ? count : 0u);
+    for (unsigned i = 0; ok && i < count; ++i)
+    {
+        unsigned length = 0u;
+        ok = stream.Read(length) == 1 && length < 65536u;
+        if (ok && length > 0u)
+        {
+            _locations[i].resize(length);
+            ok = stream.ReadArray(&_locations[i][0], length) == 1;
+        }
+    }
+
+    if (!ok || _index->Count() != (int)_locations.size())
+    {
+        OE_WARN << LC << "Rebuilding damaged spatial index " << indexFilename << std::endl;
+        _index->RemoveAll();
+        _locations.clear();
+        return false;
+    }
+
+    OE_INFO << LC << "Read " << _locations.size() << " files from " << indexFilename << std::endl;
+    return true;
+}
+
+void
+TileIndex::buildSpatialIndex()
+{
+    _index->RemoveAll();
+    _locations.clear();
+
+    osg::ref_ptr< osgEarth::FeatureCursor > cursor = _features->createFeatureCursor( Query(), 0L );
+    while (cursor.valid() && cursor->hasMore())
+    {
+        osg::ref_ptr< osgEarth::Feature > feature = cursor->nextFeature();
+        if (feature.valid() && feature->getGeometry())
+        {
+            Bounds b = feature->getGeometry()->getBounds();
+            double a_min[2] = { b.xMin(), b.yMin() };
+            double a_max[2] = { b.xMax(), b.yMax() };
+            _index->Insert(a_min, a_max, _locations.size());
+            _locations.push_back(feature->getString("location"));
+        }
+    }
+
+    _dirty = true;
+}
+
+bool
+TileIndex::save()
+{
+    Threading::ScopedMutexLock lock(_indexMutex);
+
+    if (!_dirty || _filename.empty())
+        return true;
+
+    std::string indexFilename = getSpatialIndexFilename(_filename);
+
+    RTFileStream stream;
+    if (!stream.OpenWrite(indexFilename.c_str()) || !_index->Save(stream))
+    {
+        OE_WARN << LC << "Failed to write " << indexFilename << std::endl;
+        return false;
+    }
+
+    stream.Write((unsigned)_locations.size());
+    for (unsigned i = 0; i < _locations.size(); ++i)
+    {
+        stream.Write((unsigned)_locations[i].size());
+        if (!_locations[i].empty())
+            stream.WriteArray(_locations[i].data(), _locations[i].size());
+    }
+
+    _dirty = false;
+    return true;
+}
+
 TileIndex*
 TileIndex::create( const std::string& filename, const osgEarth::SpatialReference* srs )
 {
@@ -106,21 +233,26 @@ void
 TileIndex::getFiles(const osgEarth::GeoExtent& extent, std::vector< std::string >& files)
 {            
     files.clear();
-    osgEarth::Query query;    
 
     GeoExtent transformed = extent.transform( _features->getFeatureProfile()->getSRS() );
-    query.bounds() = transformed.bounds();
-    osg::ref_ptr< osgEarth::FeatureCursor> cursor = _features->createFeatureCursor( query, 0L );
+    if (!transformed.isValid())
+        return;
+
+    double a_min[2] = { transformed.xMin(), transformed.yMin() };
+    double a_max[2] = { transformed.xMax(), transformed.yMax() };
+
+    Threading::ScopedMutexLock lock(_indexMutex);
+
+    std::vector< unsigned > hits;
+    _index->Search(a_min, a_max, &hits, std::numeric_limits<int>::max());
+
+    // Keep the order files were added in, as the shapefile query did
+    std::sort(hits.begin(), hits.end());
 
-    while (cursor->hasMore())
+    for (unsigned i = 0; i < hits.size(); ++i)
     {
-        osg::ref_ptr< osgEarth::Feature> feature = cursor->nextFeature();
-        if (feature.valid())
-        {
-            std::string location = getFullPath(_filename, feature->getString("location"));
-            files.push_back( location );
-        }
-    }    
+        files.push_back( getFullPath(_filename, _locations[hits[i]]) );
+    }
 }
 
 bool TileIndex::add( const std::string& filename, const GeoExtent& extent )
@@ -138,6 +270,118 @@ bool TileIndex::add( const std::string& filename, const GeoExtent& extent )
     const SpatialReference* wgs84 = SpatialReference::create("epsg:4326");
     feature->transform( wgs84 );
 
-    return _features->insertFeature( feature.get() );    
+    if (!_features->insertFeature( feature.get() ))
+        return false;
+
+    Bounds b = feature->getGeometry()->getBounds();
+    double a_min[2] = { b.xMin(), b.yMin() };
+    double a_max[2] = { b.xMax(), b.yMax() };
+
+    Threading::ScopedMutexLock lock(_indexMutex);
+    _index->Insert(a_min, a_max, _locations.size());
+    _locations.push_back(filename);
+    _dirty = true;
     return true;
 }
+
+void
+TileIndex::setMaxOpenDatasets(unsigned value)
+{
+    Threading::ScopedMutexLock lock(_poolMutex);
+    _maxOpenDatasets = osg::maximum(value, 1u);
+
+    while (_numOpen > _maxOpenDatasets && !_idle.empty())
+    {
+        _idle.pop_back();
+        --_numOpen;
+    }
+}
+
+std::shared_ptr<GDAL::Driver>
+TileIndex::getDriver(const std::string& location,
+                     const GDAL::Options& options,
+                     unsigned tileSize,
+                     const osgDB::Options* readOptions)
+{
+    osg::ref_ptr<GDAL::Driver> driver;
+    {
+        std::unique_lock<Threading::Mutex> lock(_poolMutex);
+
+        if (_failed.find(location) != _failed.end())
+            return nullptr;
+
+        while (!driver.valid())
+        {
+            // Reuse an idle dataset for this file
+            IdleDrivers::iterator i = _idle.begin();
+            while (i != _idle.end() && i->first != location)
+                ++i;
+
+            if (i != _idle.end())
+            {
+                driver = i->second;
+                _idle.erase(i);
+                break;
+            }
+
+            // Open a new one, making room by closing the least recently used
+            if (_numOpen >= _maxOpenDatasets && !_idle.empty())
+            {
+                _idle.pop_back();
+                --_numOpen;
+            }
+
+            if (_numOpen < _maxOpenDatasets)
+            {
+                ++_numOpen;
+                break;
+            }
+
+            _poolAvailable.wait(lock);
+        }
+    }
+
+    if (!driver.valid())
+    {
+        GDAL::Options gdalOptions = options;
+        gdalOptions.url() = URI(location);
+
+        driver = new GDAL::Driver();
+        Status status = driver->open(location, gdalOptions, tileSize, NULL, readOptions);
+        if (status.isError())
+        {
+            OE_WARN << LC << "Failed to open " << location << ": " << status.message() << std::endl;
+
+            Threading::ScopedMutexLock lock(_poolMutex);
+            _failed.insert(location);
+            --_numOpen;
+            _poolAvailable.notify_one();
+            return nullptr;
+        }
+    }
+
+    // The deleter holds the index so the pool outlives its drivers
+    osg::ref_ptr<TileIndex> index = this;
+    osg::ref_ptr<GDAL::Driver> ref = driver;
+    return std::shared_ptr<GDAL::Driver>(
+        driver.get(),
+        [index, location, ref](GDAL::Driver*) { index->release(location, ref.get()); });
+}
+
+void
+TileIndex::release(const std::string& location, GDAL::Driver* driver)
+{
+    Threading::ScopedMutexLock lock(_poolMutex);
+
+    if (_numOpen > _maxOpenDatasets)
+    {
+        // The pool shrank while this one was out
+        --_numOpen;
+    }
+    else
+    {
+        _idle.push_front(std::make_pair(location, osg::ref_ptr<GDAL::Driver>(driver)));
+    }
+
+    _poolAvailable.notify_one();
+}
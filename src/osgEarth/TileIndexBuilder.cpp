@@ -24,13 +24,15 @@
 #include <osgEarth/FileUtils>
 #include <osgEarth/Progress>
 #include <osgEarth/GDAL>
+#include <osgEarth/Threading>
 #include <osgDB/FileUtils>
 
 using namespace osgDB;
 using namespace osgEarth;
 using namespace osgEarth::Contrib;
 
-TileIndexBuilder::TileIndexBuilder()
+TileIndexBuilder::TileIndexBuilder() :
+_numThreads(Threading::getConcurrency())
 {
 }
 
@@ -49,32 +51,58 @@ void TileIndexBuilder::build(const std::string& indexFilename, const SpatialRefe
     }
 
     osg::ref_ptr< TileIndex > index = TileIndex::create( indexFilename, srs );
+    if (!index.valid())
+    {
+        return;
+    }
 
     _indexFilename = indexFilename;
     std::string indexDir = getFilePath( _indexFilename );
     
     unsigned int total = _expandedFilenames.size();
 
-    for (unsigned int i = 0; i < _expandedFilenames.size(); i++)
-    {   
+    // Opening the files is the slow part, so read their extents in parallel
+    // and only write the shapefile, which isn't thread safe, from here.
+    JobArena arena( "oe.tileindexbuilder", osg::maximum(_numThreads, 1u) );
+    std::vector< Future< DataExtentList > > results;
+    results.reserve( total );
+
+    for (unsigned int i = 0; i < total; i++)
+    {
+        std::string filename = _expandedFilenames[ i ];
+        results.push_back( Job(&arena).dispatch< DataExtentList >(
+            [filename](Cancelable*)
+            {
+                DataExtentList extents;
+                GDAL::Options options;
+                options.url() = URI(filename);
+
+                osg::ref_ptr< GDAL::Driver > driver = new GDAL::Driver();
+                if (driver->open( filename, options, 256u, &extents, 0L ).isError())
+                    extents.clear();
+
+                return extents;
+            }) );
+    }
+
+    for (unsigned int i = 0; i < total; i++)
+    {
         std::string filename = _expandedFilenames[ i ];
 
-        // Who deletes this?
-        GDALImageLayer* layer = new GDALImageLayer();
-        layer->setURL(filename);
+        const DataExtentList& extents = results[ i ].get();
 
         bool ok = false;
-                
-        if ( layer->open().isOK() )
+
+        for (DataExtentList::const_iterator itr = extents.begin(); itr != extents.end(); ++itr)
         {
-            for (DataExtentList::const_iterator itr = layer->getDataExtents().begin(); itr != layer->getDataExtents().end(); ++itr)
-            {
-                // We want the filename as it is relative to the index file                
-                std::string relative = getPathRelative(indexDir, filename);
-                index->add(relative, *itr);
-                ok = true;
-            }
-        }        
+            // We want the filename as it is relative to the index file                
+            std::string relative = getPathRelative(indexDir, filename);
+            index->add(relative, *itr);
+            ok = true;
+        }
+
+        // Let go of the extents as we go; there may be a great many files
+        results[ i ] = Future< DataExtentList >();
 
         if (_progress.valid())
         {
@@ -93,7 +121,7 @@ void TileIndexBuilder::build(const std::string& indexFilename, const SpatialRefe
         }
     }
 
-    osg::Timer_t end = osg::Timer::instance()->tick();    
+    index->save();
 }
 
 void TileIndexBuilder::expandFilenames()
@@ -258,3 +258,39 @@ TileKey::mapResolution(unsigned targetSize,
         targetSizePOT *= 2;        
     }
 }
+
+//------------------------------------------------------------------------
+
+PackedTileKey::PackedTileKey(const TileKey& key) :
+    _xy(0),
+    _lodProfile(0),
+    _hash(0)
+{
+    if (key.valid())
+    {
+        unsigned id = key.getProfile()->getHorizID();
+        if (id != 0u)
+        {
+            _xy = ((std::uint64_t)key.getTileX() << 32) | (std::uint64_t)key.getTileY();
+            _lodProfile = (key.getLOD() << 24) | (id & 0xFFFFFF);
+            _hash = osgEarth::hash_value_unsigned(
+                (std::size_t)key.getLOD(),
+                (std::size_t)key.getTileX(),
+                (std::size_t)key.getTileY(),
+                (std::size_t)id);
+        }
+    }
+}
+
+TileKey
+PackedTileKey::unpack() const
+{
+    if (!valid())
+        return TileKey::INVALID;
+
+    return TileKey(
+        getLOD(),
+        getTileX(),
+        getTileY(),
+        Profile::getByHorizID(_lodProfile & 0xFFFFFF));
+}
@@ -22,6 +22,7 @@
 #include <osgEarth/URI>
 #include <osgEarth/Map>
 #include <osgEarth/MemCache>
+#include <osgEarth/DateTime>
 
 using namespace osgEarth;
 
@@ -44,6 +45,7 @@ TileLayer::Options::getConfig() const
     conf.set("no_data_value", _noDataValue);
     conf.set("profile", _profile);
     conf.set("tile_size", _tileSize);
+    conf.set("detect_uniform_tiles", _detectUniformTiles);
 
     return conf;
 }
@@ -58,6 +60,7 @@ TileLayer::Options::fromConfig(const Config& conf)
     _noDataValue.init( -32767.0f ); // SHRT_MIN
     _minValidValue.init( -32766.0f ); // -(2^15 - 2)
     _maxValidValue.init( 32767.0f );
+    _detectUniformTiles.init( true );
 
     conf.get( "min_level", _minLevel );
     conf.get( "max_level", _maxLevel );
@@ -70,6 +73,7 @@ TileLayer::Options::fromConfig(const Config& conf)
     conf.get( "nodata_value", _noDataValue); // back compat
     conf.get( "min_valid_value", _minValidValue);
     conf.get( "max_valid_value", _maxValidValue);
+    conf.get( "detect_uniform_tiles", _detectUniformTiles);
 }
 
 //------------------------------------------------------------------------
@@ -284,6 +288,16 @@ float TileLayer::getMaxValidValue() const
     return options().maxValidValue().get();
 }
 
+void TileLayer::setDetectUniformTiles(bool value)
+{
+    options().detectUniformTiles() = value;
+}
+
+bool TileLayer::getDetectUniformTiles() const
+{
+    return options().detectUniformTiles().get();
+}
+
 void TileLayer::setTileSize(unsigned value)
 {
     setOptionThatRequiresReopen(options().tileSize(), value);
@@ -301,7 +315,10 @@ TileLayer::init()
     Layer::init();
 
     _writingRequested = false;
+    _openedFromCache = false;
     _profileMatchesMapProfile = true;
+    _metaTileSize = 1u;
+    _numDirtyRegions = 0u;
 
     // If the user asked for a custom profile, install it now
     if (options().profile().isSet())
@@ -310,6 +327,85 @@ TileLayer::init()
     }
 }
 
+void
+TileLayer::setMetaTileSize(unsigned value)
+{
+    _metaTileSize = osg::maximum(value, 1u);
+}
+
+void
+TileLayer::LayerStats::bind(const std::string& layerName)
+{
+    std::string labels = Util::Stats::layerLabel(layerName);
+    _requests = &Util::Stats::counter("osgearth_layer_requests", labels);
+    _memCacheHits = &Util::Stats::counter("osgearth_layer_memcache_hits", labels);
+    _cacheHits = &Util::Stats::counter("osgearth_layer_cache_hits", labels);
+    _cacheMisses = &Util::Stats::counter("osgearth_layer_cache_misses", labels);
+    _errors = &Util::Stats::counter("osgearth_layer_errors", labels);
+    _sourceBytes = &Util::Stats::counter("osgearth_layer_source_bytes", labels);
+    _cacheBytes = &Util::Stats::counter("osgearth_layer_cache_bytes", labels);
+    _sourceTime = &Util::Stats::timer("osgearth_layer_source", labels);
+    _cacheReadTime = &Util::Stats::timer("osgearth_layer_cache_read", labels);
+    _cacheWriteTime = &Util::Stats::timer("osgearth_layer_cache_write", labels);
+}
+
+void
+TileLayer::LayerStats::sourceRead(
+    std::chrono::steady_clock::time_point start,
+    bool valid,
+    const Status& status,
+    std::uint64_t bytes) const
+{
+    if (_sourceTime)
+    {
+        _sourceTime->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start));
+    }
+
+    if (valid)
+    {
+        count(_sourceBytes, bytes);
+    }
+
+    // no data for a tile (e.g. HTTP 404) is an answer, not an error
+    else if (status.isError() && status.code() != Status::ResourceUnavailable)
+    {
+        count(_errors);
+    }
+}
+
+double
+TileLayer::Statistics::cacheHitRatio() const
+{
+    std::uint64_t lookups = cacheHits + cacheMisses;
+    return lookups > 0u ? (double)cacheHits / (double)lookups : 0.0;
+}
+
+double
+TileLayer::Statistics::averageSourceMs() const
+{
+    return sourceReads > 0u ? sourceMs / (double)sourceReads : 0.0;
+}
+
+TileLayer::Statistics
+TileLayer::getStatistics() const
+{
+    Statistics s;
+    s.requests = _stats._requests ? _stats._requests->get() : 0u;
+    s.memCacheHits = _stats._memCacheHits ? _stats._memCacheHits->get() : 0u;
+    s.cacheHits = _stats._cacheHits ? _stats._cacheHits->get() : 0u;
+    s.cacheMisses = _stats._cacheMisses ? _stats._cacheMisses->get() : 0u;
+    s.errors = _stats._errors ? _stats._errors->get() : 0u;
+    s.sourceBytes = _stats._sourceBytes ? _stats._sourceBytes->get() : 0u;
+    s.cacheBytes = _stats._cacheBytes ? _stats._cacheBytes->get() : 0u;
+    s.sourceReads = _stats._sourceTime ? _stats._sourceTime->count() : 0u;
+    s.sourceMs = _stats._sourceTime ? _stats._sourceTime->sumMs() : 0.0;
+    s.sourceMaxMs = _stats._sourceTime ? _stats._sourceTime->maxMs() : 0.0;
+    s.cacheReadMs = _stats._cacheReadTime ? _stats._cacheReadTime->sumMs() : 0.0;
+    s.cacheWriteMs = _stats._cacheWriteTime ? _stats._cacheWriteTime->sumMs() : 0.0;
+    return s;
+}
+
 void
 TileLayer::addedToMap(const Map* map)
 {
@@ -366,11 +462,24 @@ TileLayer::setUpL2Cache(unsigned minSize)
         l2CacheSize = 0;
     }
 
+    // Optional byte budget, since entries vary a lot in size
+    unsigned l2CacheMaxMB = options().l2CacheMaxMB().getOrUse(0u);
+
+    char const* l2MaxEnv = ::getenv("OSGEARTH_L2_CACHE_MAX_MB");
+    if (l2MaxEnv)
+    {
+        l2CacheMaxMB = as<unsigned>(std::string(l2MaxEnv), 0u);
+        OE_INFO << LC << "L2 cache budget set from environment = " << l2CacheMaxMB << " MB\n";
+    }
+
     // Initialize the l2 cache if it's size is > 0
     if (l2CacheSize > 0)
     {
-        _memCache = new MemCache(l2CacheSize);
-        OE_INFO << LC << "L2 cache size = " << l2CacheSize << std::endl;
+        _memCache = new MemCache(l2CacheSize, (std::size_t)l2CacheMaxMB * 1024u * 1024u);
+        OE_INFO << LC << "L2 cache size = " << l2CacheSize;
+        if (l2CacheMaxMB > 0u)
+            OE_INFO << ", budget = " << l2CacheMaxMB << " MB";
+        OE_INFO << std::endl;
     }
 }
 
@@ -387,9 +496,63 @@ TileLayer::openImplementation()
     if (_memCache.valid())
         _memCache->clear();
 
+    _stats.bind(getName());
+
+    // In cache-only mode the data source is never read, so try to get the
+    // profile and extents from the cache instead of from the source.
+    _openedFromCache = false;
+    if (getCacheSettings() && getCacheSettings()->cachePolicy()->isCacheOnly())
+    {
+        _openedFromCache = openFromCacheMetadata();
+    }
+
     return getStatus();
 }
 
+bool
+TileLayer::openFromCacheMetadata()
+{
+    CacheBin* bin = getCacheSettings()->getCacheBin();
+    if (!bin)
+        return false;
+
+    std::string metaKey = getMetadataKey(0L);
+
+    ReadResult rr = bin->readString(metaKey, getReadOptions());
+    if (!rr.succeeded())
+    {
+        OE_INFO << LC << "No layer metadata in the cache; opening the data source" << std::endl;
+        return false;
+    }
+
+    Config conf;
+    conf.fromJSON(rr.getString());
+    osg::ref_ptr<CacheBinMetadata> meta = new CacheBinMetadata(conf);
+    if (!meta->isOK())
+    {
+        OE_WARN << LC << "Layer metadata in the cache appears to be corrupt" << std::endl;
+        return false;
+    }
+
+    if (!_profile.valid())
+    {
+        setProfile(Profile::create(meta->_sourceProfile.get()));
+        options().tileSize().init(meta->_sourceTileSize.get());
+    }
+
+    if (!_profile.valid())
+        return false;
+
+    {
+        Threading::ScopedMutexLock lock(layerMutex());
+        _cacheBinMetadata[metaKey] = meta.get();
+    }
+    dirtyDataExtents();
+
+    OE_INFO << LC << "Opened from cache metadata" << std::endl;
+    return true;
+}
+
 
 const Status&
 TileLayer::openForWriting()
@@ -563,6 +726,26 @@ TileLayer::getCacheBin(const Profile* profile)
             }
         }
 
+        // Keep a profile-independent copy of the metadata as well, so a
+        // cache-only layer can open without touching its data source.
+        if (meta.valid() &&
+            getProfile() &&
+            cacheSettings->cachePolicy()->isCacheWriteable() &&
+            !cacheSettings->cachePolicy()->isCacheOnly())
+        {
+            std::string layerMetaKey = getMetadataKey(0L);
+            if (bin->getRecordStatus(layerMetaKey) == CacheBin::STATUS_NOT_FOUND)
+            {
+                CacheBinMetadata layerMeta(*meta.get());
+                layerMeta._cacheProfile = getProfile()->toProfileOptions();
+                layerMeta._dataExtents = getDataExtents();
+
+                std::string data = layerMeta.getConfig().toJSON(false);
+                osg::ref_ptr<StringObject> temp = new StringObject(data);
+                bin->write(layerMetaKey, temp.get(), getReadOptions());
+            }
+        }
+
         // If we loaded a profile from the cache metadata, apply the overrides:
         applyProfileOverrides(_profile);
 
@@ -582,6 +765,145 @@ TileLayer::disable(const std::string& msg)
     setStatus(Status::Error(msg));
 }
 
+void
+TileLayer::addChangeCallback(ChangeCallback* cb)
+{
+    if (cb)
+    {
+        Threading::ScopedMutexLock lock(_changeCallbacksMutex);
+        _changeCallbacks.push_back(cb);
+    }
+}
+
+void
+TileLayer::removeChangeCallback(ChangeCallback* cb)
+{
+    Threading::ScopedMutexLock lock(_changeCallbacksMutex);
+    auto i = std::find(_changeCallbacks.begin(), _changeCallbacks.end(), cb);
+    if (i != _changeCallbacks.end())
+        _changeCallbacks.erase(i);
+}
+
+void
+TileLayer::dirtyRegion(const GeoExtent& extent, unsigned minLevel, unsigned maxLevel)
+{
+    TimeStamp now = DateTime().asTimeStamp();
+
+    if (extent.isInvalid())
+    {
+        // the whole layer changed; a single record now covers every tile,
+        // and bumping the revision invalidates the L2 cache as well.
+        {
+            Threading::ScopedMutexLock lock(_dirtyRegionsMutex);
+            DirtyRegion region;
+            region._extent = GeoExtent::INVALID;
+            region._minLevel = 0u;
+            region._maxLevel = ~0u;
+            region._time = now;
+            region._revision = 1u;
+            _dirtyRegions.clear();
+            _dirtyRegions.push_back(region);
+            _numDirtyRegions = 1u;
+        }
+
+        bumpRevision();
+    }
+    else
+    {
+        Threading::ScopedMutexLock lock(_dirtyRegionsMutex);
+
+        // repeated updates to the same area reuse the existing record
+        // so the list stays as short as the number of distinct areas.
+        bool found = false;
+        for (auto& region : _dirtyRegions)
+        {
+            if (region._extent.isValid() &&
+                region._minLevel == minLevel &&
+                region._maxLevel == maxLevel &&
+                region._extent.contains(extent))
+            {
+                region._time = now;
+                ++region._revision;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            DirtyRegion region;
+            region._extent = extent;
+            region._minLevel = minLevel;
+            region._maxLevel = maxLevel;
+            region._time = now;
+            region._revision = 1u;
+            _dirtyRegions.push_back(region);
+            _numDirtyRegions = _dirtyRegions.size();
+        }
+    }
+
+    OE_DEBUG << LC << "Dirty region " << extent.toString()
+        << " levels " << minLevel << "-" << maxLevel << std::endl;
+
+    // notify listeners (e.g. the terrain engine) outside the lock:
+    std::vector<osg::ref_ptr<ChangeCallback> > callbacks;
+    {
+        Threading::ScopedMutexLock lock(_changeCallbacksMutex);
+        callbacks = _changeCallbacks;
+    }
+
+    for (auto& cb : callbacks)
+    {
+        cb->onDataChanged(this, extent, minLevel, maxLevel);
+    }
+}
+
+bool
+TileLayer::isCachedTileExpired(const TileKey& key, TimeStamp lastModified) const
+{
+    if (getCacheSettings() && getCacheSettings()->cachePolicy()->isExpired(lastModified))
+        return true;
+
+    if (_numDirtyRegions == 0u)
+        return false;
+
+    Threading::ScopedMutexLock lock(_dirtyRegionsMutex);
+    for (auto& region : _dirtyRegions)
+    {
+        // records written at the same second as the change are suspect too
+        if (lastModified <= region._time &&
+            key.getLOD() >= region._minLevel &&
+            key.getLOD() <= region._maxLevel &&
+            (region._extent.isInvalid() || region._extent.intersects(key.getExtent())))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned
+TileLayer::getDirtyRegionRevision(const TileKey& key) const
+{
+    if (_numDirtyRegions == 0u)
+        return 0u;
+
+    unsigned revision = 0u;
+
+    Threading::ScopedMutexLock lock(_dirtyRegionsMutex);
+    for (auto& region : _dirtyRegions)
+    {
+        if (key.getLOD() >= region._minLevel &&
+            key.getLOD() <= region._maxLevel &&
+            region._extent.isValid() &&
+            region._extent.intersects(key.getExtent()))
+        {
+            revision += region._revision;
+        }
+    }
+    return revision;
+}
+
 TileLayer::CacheBinMetadata*
 TileLayer::getCacheBinMetadata(const Profile* profile)
 {
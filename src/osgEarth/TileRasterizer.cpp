@@ -23,154 +23,297 @@
 #include <osgEarth/Metrics>
 #include <osgViewer/Renderer>
 #include <osgViewer/Viewer>
+#include <algorithm>
+#include <iterator>
 
 #define LC "[TileRasterizer] "
 
-#ifndef GL_ANY_SAMPLES_PASSED
-#define GL_ANY_SAMPLES_PASSED 0x8C2F
-#endif
-
 #ifndef GL_READ_ONLY
 #define GL_READ_ONLY 0x88B8
 #endif
 
-#ifndef GL_COLOR_ATTACHMENT0
-#define GL_COLOR_ATTACHMENT0 0x8CE0
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
 #endif
 
-// Set this to use a Pixel Buffer Object for DMA readback.
-#define USE_PBO
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+
+// Largest atlas (in either dimension) to render a batch into
+#define MAX_ATLAS_SIZE 2048u
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
 
-TileRasterizer::RenderOperation::RenderOperation(
-    osg::Node* node, 
-    const GeoExtent& extent,
-    std::shared_ptr<TileRasterizer::RenderData> renderData) :
+struct TileRasterizer::Batch
+{
+    Batch() : _pbo(0), _sync(0) { }
+
+    std::vector<Request> _requests;
+    GLuint _pbo;
+    GLsync _sync;
+    osg::ref_ptr<osg::Image> _atlas; // synchronous readback, when there are no PBOs
+};
 
-    _node(node),
-    _extent(extent),
-    _rd(renderData)
+namespace
 {
-    //nop
+    // Copies one cell of the atlas into its own image. Returns nullptr
+    // if nothing was drawn there.
+    osg::ref_ptr<osg::Image> extractCell(
+        const GLubyte* atlas,
+        unsigned atlasWidth,
+        unsigned col, unsigned row,
+        unsigned width, unsigned height,
+        unsigned pixelSize,
+        const osg::Texture2D* tex)
+    {
+        osg::ref_ptr<osg::Image> image = new osg::Image();
+        image->allocateImage(width, height, 1, tex->getSourceFormat(), tex->getSourceType());
+        image->setInternalTextureFormat(tex->getInternalFormat());
+
+        bool empty = true;
+        unsigned rowBytes = width * pixelSize;
+        for (unsigned t = 0; t < height; ++t)
+        {
+            const GLubyte* src = atlas + ((row * height + t) * atlasWidth + col * width) * pixelSize;
+            GLubyte* dst = image->data(0, t);
+            memcpy(dst, src, rowBytes);
+
+            if (empty)
+            {
+                for (unsigned b = 0; b < rowBytes && empty; ++b)
+                    empty = (src[b] == 0);
+            }
+        }
+
+        return empty ? nullptr : image;
+    }
 }
 
-osg::ref_ptr<osg::Image>
-TileRasterizer::RenderOperation::run(osg::State* state)
+void
+TileRasterizer::flush(std::shared_ptr<RenderData> rd, osg::State* state)
 {
-    OE_PROFILING_ZONE_NAMED("TileRasterizer:RenderOperation");
+    OE_PROFILING_ZONE_NAMED("TileRasterizer:flush");
 
-    // lock the weak pointer to make sure the TileRasterizer still exists
-    // and didn't disappear out from under us
-    std::shared_ptr<RenderData> rd = _rd.lock();
-    if (rd == nullptr)
+    auto batch = std::make_shared<Batch>();
     {
-        return nullptr;
+        ScopedMutexLock lock(rd->_queueMutex);
+
+        unsigned count = osg::minimum((unsigned)rd->_queue.size(), rd->_maxBatchSize);
+        batch->_requests.assign(
+            std::make_move_iterator(rd->_queue.begin()),
+            std::make_move_iterator(rd->_queue.begin() + count));
+        rd->_queue.erase(rd->_queue.begin(), rd->_queue.begin() + count);
+
+        // anything left over goes in the next pass
+        rd->_flushScheduled = !rd->_queue.empty();
+        if (rd->_flushScheduled)
+        {
+            std::weak_ptr<RenderData> rd_weak(rd);
+            GPUJobArena::Delegate next = [rd_weak](osg::State* state)
+            {
+                std::shared_ptr<RenderData> rd = rd_weak.lock();
+                if (rd)
+                    flush(rd, state);
+            };
+            GPUJobArena::arena().dispatch(next);
+        }
     }
 
-    osg::Camera* camera = rd->_sv->getCamera();
+    // drop requests nobody is waiting for anymore
+    batch->_requests.erase(
+        std::remove_if(batch->_requests.begin(), batch->_requests.end(),
+            [](const Request& r) { return r._promise.isAbandoned(); }),
+        batch->_requests.end());
 
-    //unsigned id = gc->getState()->getContextID();
-    unsigned id = state->getContextID();
-    osg::GLExtensions* ext = osg::GLExtensions::Get(id, true);
+    if (batch->_requests.empty())
+        return;
 
-#ifdef USE_PBO
-    if (rd->_pbo == 0 && ext->isPBOSupported)
+    // lay out one cell per request
+    rd->_root->removeChildren(0, rd->_root->getNumChildren());
+    for (unsigned i = 0; i < batch->_requests.size(); ++i)
     {
-        // Allocate a pixel buffer object for DMA readback
-        unsigned size = rd->_width * rd->_height * 4u;
-        ext->glGenBuffers(1, &rd->_pbo);
-        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, rd->_pbo);
-        ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size, 0, GL_STREAM_READ);
+        osg::Camera* cell = rd->_cells[i].get();
+        cell->setProjectionMatrix(batch->_requests[i]._projection);
+        cell->removeChildren(0, cell->getNumChildren());
+        cell->addChild(batch->_requests[i]._node.get());
+        rd->_root->addChild(cell);
     }
-#endif
 
-    // Set up the projection to match the geo extents
-    camera->setProjectionMatrixAsOrtho2D(
-        _extent.xMin(), _extent.xMax(),
-        _extent.yMin(), _extent.yMax());
-
-    rd->_sv->setSceneData(_node.get());
+    rd->_sv->setSceneData(rd->_root.get());
+    rd->_sv->cull();
+    rd->_sv->draw();
 
-    if (rd->_samplesQuery == 0)
+    // release the graphs; the images are all we need from here on
+    for (unsigned i = 0; i < batch->_requests.size(); ++i)
     {
-        // Allocate a sample-counting query
-        ext->glGenQueries(1, &rd->_samplesQuery);
+        rd->_cells[i]->removeChildren(0, rd->_cells[i]->getNumChildren());
+        batch->_requests[i]._node = nullptr;
     }
+    rd->_root->removeChildren(0, rd->_root->getNumChildren());
+    rd->_sv->setSceneData(nullptr);
 
-    rd->_sv->cull();
+    OE_PROFILING_ZONE_NAMED("Readback");
 
-    // initiate a query for samples passing the fragment shader
-    // to see whether we drew anything.
-    GLuint samples = 0u;
-    ext->glBeginQuery(GL_ANY_SAMPLES_PASSED, rd->_samplesQuery);
+    unsigned id = state->getContextID();
+    osg::GLExtensions* ext = osg::GLExtensions::Get(id, true);
+    GLFunctions& gl = GLFunctions::get(*state);
 
-    rd->_sv->draw();
+    // make the target texture current so we can read it back.
+    rd->_tex->apply(*state);
 
+    if (ext->isPBOSupported && gl.glFenceSync && gl.glClientWaitSync && gl.glDeleteSync)
     {
-        OE_PROFILING_ZONE_NAMED("glEndQuery/glGet");
-        ext->glEndQuery(GL_ANY_SAMPLES_PASSED);
-        ext->glGetQueryObjectuiv(rd->_samplesQuery, GL_QUERY_RESULT, &samples);
-    }
+        if (rd->_freePBOs.empty())
+        {
+            // Allocate a pixel buffer object for DMA readback
+            GLuint pbo;
+            unsigned size = rd->_tex->getTextureWidth() * rd->_tex->getTextureHeight() * rd->_pixelSize;
+            ext->glGenBuffers(1, &pbo);
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo);
+            ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size, 0, GL_STREAM_READ);
+            rd->_freePBOs.push_back(pbo);
+        }
 
-    osg::ref_ptr<osg::Image> image;
+        batch->_pbo = rd->_freePBOs.back();
+        rd->_freePBOs.pop_back();
 
-    // if we rendered any samples, allocate an image and copy it over.
-    if (samples > 0u)
+        // start the transfer and fence it; collect() picks it up once the
+        // GPU is done, without blocking this thread
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, batch->_pbo);
+        glGetTexImage(GL_TEXTURE_2D, 0, rd->_tex->getSourceFormat(), rd->_tex->getSourceType(), 0);
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+        batch->_sync = gl.glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    else
     {
-        // create our new target image:
-        image = new osg::Image();
-        image->allocateImage(rd->_width, rd->_height, 1, rd->_tex->getSourceFormat(), rd->_tex->getSourceType());
-        image->setInternalTextureFormat(rd->_tex->getInternalFormat());
+        batch->_atlas = new osg::Image();
+        batch->_atlas->readImageFromCurrentTexture(id, false);
+    }
+
+    collect(batch, rd, state);
+}
+
+void
+TileRasterizer::collect(std::shared_ptr<Batch> batch, std::weak_ptr<RenderData> rd_weak, osg::State* state)
+{
+    std::shared_ptr<RenderData> rd = rd_weak.lock();
+    if (rd == nullptr)
+        return;
 
-        OE_PROFILING_ZONE_NAMED("Readback");
+    osg::GLExtensions* ext = osg::GLExtensions::Get(state->getContextID(), true);
+    GLFunctions& gl = GLFunctions::get(*state);
 
-        // make the target texture current so we can read it back.
-        rd->_tex->apply(*state);
+    const GLubyte* atlas = nullptr;
 
-        if (rd->_pbo > 0)
+    if (batch->_pbo > 0)
+    {
+        GLenum status = gl.glClientWaitSync(batch->_sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
         {
-            // Use the PBO to perform a DMA transfer (faster than straight glReadPixels)
-            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, rd->_pbo);
-            glGetTexImage(GL_TEXTURE_2D, 0, rd->_tex->getSourceFormat(), rd->_tex->getSourceType(), 0);
-            GLubyte* src = (GLubyte*)ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
-            if (src)
+            // not there yet; check again on the next job
+            GPUJobArena::Delegate retry = [batch, rd_weak](osg::State* state)
             {
-                memcpy(image->data(), src, image->getTotalSizeInBytes());
-                ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
-            }
-            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+                collect(batch, rd_weak, state);
+            };
+            GPUJobArena::arena().dispatch(retry);
+            return;
         }
-        else
+
+        gl.glDeleteSync(batch->_sync);
+        batch->_sync = 0;
+
+        if (status != GL_WAIT_FAILED)
         {
-            image->readImageFromCurrentTexture(id, false);
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, batch->_pbo);
+            atlas = (const GLubyte*)ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
         }
     }
-    else
+    else if (batch->_atlas.valid())
     {
-        //OE_INFO << "No data" << std::endl;
+        atlas = batch->_atlas->data();
     }
 
-    return image;
+    OE_PROFILING_ZONE_NAMED("TileRasterizer:collect");
+
+    unsigned atlasWidth = rd->_tex->getTextureWidth();
+    for (unsigned i = 0; i < batch->_requests.size(); ++i)
+    {
+        Request& request = batch->_requests[i];
+        if (request._promise.isAbandoned())
+            continue;
+
+        osg::ref_ptr<osg::Image> image;
+        if (atlas)
+        {
+            image = extractCell(atlas, atlasWidth, i % rd->_cols, i / rd->_cols,
+                                rd->_width, rd->_height, rd->_pixelSize, rd->_tex.get());
+        }
+        request._promise.resolve(image);
+    }
+
+    if (batch->_pbo > 0)
+    {
+        if (atlas)
+        {
+            ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+        }
+        rd->_freePBOs.push_back(batch->_pbo);
+    }
 }
 
 
-TileRasterizer::TileRasterizer(unsigned width, unsigned height)
+TileRasterizer::TileRasterizer(unsigned width, unsigned height, unsigned samples, GLenum internalFormat)
 {
     _renderData = std::make_shared<RenderData>();
 
-    _renderData->_initialized = false;
     _renderData->_width = width;
     _renderData->_height = height;
 
+    // arrange batches in a grid that fits the atlas
+    _renderData->_cols = osg::clampBetween(MAX_ATLAS_SIZE / osg::maximum(width, 1u), 1u, 4u);
+    _renderData->_rows = osg::clampBetween(MAX_ATLAS_SIZE / osg::maximum(height, 1u), 1u, 4u);
+    _renderData->_maxBatchSize = _renderData->_cols * _renderData->_rows;
+
+    unsigned atlasWidth = width * _renderData->_cols;
+    unsigned atlasHeight = height * _renderData->_rows;
+
     _renderData->_tex = new osg::Texture2D();
-    _renderData->_tex->setTextureSize(_renderData->_width, _renderData->_height);
-    _renderData->_tex->setSourceFormat(GL_RGBA);
-    _renderData->_tex->setInternalFormat(GL_RGBA8);
-    _renderData->_tex->setSourceType(GL_UNSIGNED_BYTE);
+    _renderData->_tex->setTextureSize(atlasWidth, atlasHeight);
+    if (internalFormat == GL_R32F)
+    {
+        _renderData->_tex->setSourceFormat(GL_RED);
+        _renderData->_tex->setInternalFormat(GL_R32F);
+        _renderData->_tex->setSourceType(GL_FLOAT);
+    }
+    else if (internalFormat == GL_RGBA32F_ARB)
+    {
+        _renderData->_tex->setSourceFormat(GL_RGBA);
+        _renderData->_tex->setInternalFormat(GL_RGBA32F_ARB);
+        _renderData->_tex->setSourceType(GL_FLOAT);
+    }
+    else
+    {
+        _renderData->_tex->setSourceFormat(GL_RGBA);
+        _renderData->_tex->setInternalFormat(GL_RGBA8);
+        _renderData->_tex->setSourceType(GL_UNSIGNED_BYTE);
+    }
 
-    // set up the FBO camera
+    _renderData->_pixelSize = osg::Image::computePixelSizeInBits(
+        _renderData->_tex->getSourceFormat(),
+        _renderData->_tex->getSourceType()) / 8u;
+
+    // set up the FBO camera; it clears the whole atlas once per batch
     osg::Camera* rtt = new osg::Camera();
     rtt->setCullingActive(false);
     rtt->setClearColor(osg::Vec4(0,0,0,0));
@@ -181,8 +324,9 @@ TileRasterizer::TileRasterizer(unsigned width, unsigned height)
     rtt->setImplicitBufferAttachmentMask(0, 0);
     rtt->setSmallFeatureCullingPixelSize(0.0f);
     rtt->setViewMatrix(osg::Matrix::identity());
-    rtt->setViewport(0, 0, width, height);
-    rtt->attach(rtt->COLOR_BUFFER, _renderData->_tex.get());
+    rtt->setProjectionMatrix(osg::Matrix::identity());
+    rtt->setViewport(0, 0, atlasWidth, atlasHeight);
+    rtt->attach(rtt->COLOR_BUFFER, _renderData->_tex.get(), 0u, 0u, false, samples, 0u);
 
     osg::StateSet* ss = rtt->getOrCreateStateSet();
     ss->setMode(GL_BLEND, 1);
@@ -194,9 +338,27 @@ TileRasterizer::TileRasterizer(unsigned width, unsigned height)
     vp->setName("TileRasterizer");
     vp->setInheritShaders(false);
 
-    // GL objects
-    _renderData->_samplesQuery = 0;
-    _renderData->_pbo = 0;
+    // one nested camera per cell of the atlas, each with its own
+    // viewport and projection, so a whole batch draws in one pass
+    _renderData->_root = new osg::Group();
+    for (unsigned i = 0; i < _renderData->_maxBatchSize; ++i)
+    {
+        osg::Camera* cell = new osg::Camera();
+        cell->setCullingActive(false);
+        cell->setClearMask(0);
+        cell->setReferenceFrame(cell->ABSOLUTE_RF);
+        cell->setRenderOrder(cell->NESTED_RENDER);
+        cell->setViewMatrix(osg::Matrix::identity());
+
+        osg::Viewport* vp = new osg::Viewport(
+            (i % _renderData->_cols) * width,
+            (i / _renderData->_cols) * height,
+            width, height);
+        cell->setViewport(vp);
+        cell->getOrCreateStateSet()->setAttribute(vp);
+
+        _renderData->_cells.push_back(cell);
+    }
 
     // set up a sceneview to render the graph
     _renderData->_sv = new osgUtil::SceneView();
@@ -214,6 +376,25 @@ TileRasterizer::valid() const
     return _renderData->_sv.valid();
 }
 
+bool
+TileRasterizer::isAvailable()
+{
+    return GPUJobArena::arena().getGraphicsContext().valid();
+}
+
+void
+TileRasterizer::setMaxBatchSize(unsigned value)
+{
+    ScopedMutexLock lock(_renderData->_queueMutex);
+    _renderData->_maxBatchSize = osg::clampBetween(value, 1u, (unsigned)_renderData->_cells.size());
+}
+
+unsigned
+TileRasterizer::getMaxBatchSize() const
+{
+    return _renderData->_maxBatchSize;
+}
+
 TileRasterizer::~TileRasterizer()
 {
     //nop
@@ -222,21 +403,42 @@ TileRasterizer::~TileRasterizer()
 Future<osg::ref_ptr<osg::Image>>
 TileRasterizer::render(osg::Node* node, const GeoExtent& extent)
 {
-    using ImageJob = GPUJob<osg::ref_ptr<osg::Image>>;
+    // Set up the projection to match the geo extents
+    return render(node, osg::Matrix::ortho2D(
+        extent.xMin(), extent.xMax(),
+        extent.yMin(), extent.yMax()));
+}
+
+Future<osg::ref_ptr<osg::Image>>
+TileRasterizer::render(osg::Node* node, const osg::Matrix& projection)
+{
+    Request request;
+    request._node = node;
+    request._projection = projection;
+    Future<osg::ref_ptr<osg::Image>> result = request._promise.getFuture();
 
-    ImageJob::Result result;
+    if (!_renderData->_sv.valid())
+    {
+        request._promise.resolve(nullptr);
+        return result;
+    }
+
+    ScopedMutexLock lock(_renderData->_queueMutex);
+    _renderData->_queue.emplace_back(std::move(request));
 
-    if (_renderData->_sv.valid())
+    // requests that arrive before the flush runs all go in its batch
+    if (!_renderData->_flushScheduled)
     {
-        std::shared_ptr<RenderOperation> op = std::make_shared<RenderOperation>(
-            node, extent, _renderData);
+        _renderData->_flushScheduled = true;
 
-        result = ImageJob::dispatch(
-            [op](osg::State* state, Cancelable* progress)
-            {
-                return op->run(state);
-            }
-        );
+        std::weak_ptr<RenderData> rd_weak(_renderData);
+        GPUJobArena::Delegate job = [rd_weak](osg::State* state)
+        {
+            std::shared_ptr<RenderData> rd = rd_weak.lock();
+            if (rd)
+                flush(rd, state);
+        };
+        GPUJobArena::arena().dispatch(job);
     }
 
     return result;
@@ -19,6 +19,11 @@
 #include <osgEarth/TileVisitor>
 #include <osgEarth/CacheEstimator>
 #include <osgEarth/FileUtils>
+#include <osgEarth/WriteBehindCacheBin>
+#include <osgDB/FileUtils>
+#include <osg/Timer>
+#include <cstdio>
+#include <fstream>
 #include <thread>
 
 #if OSG_VERSION_GREATER_OR_EQUAL(3,5,10)
@@ -31,6 +36,163 @@
 using namespace osgEarth;
 using namespace osgEarth::Util;
 
+#define LC "[TileVisitor] "
+
+TileCheckpoint::TileCheckpoint(const std::string& filename, const std::string& signature) :
+_filename(filename),
+_signature(signature),
+_lastSave(osg::Timer::instance()->time_s()),
+_dirty(false),
+_mutex("TileCheckpoint(OE)")
+{
+}
+
+bool TileCheckpoint::load()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    _completed.clear();
+    _dirty = false;
+
+    std::ifstream in( _filename.c_str(), std::ios::in );
+    if (!in.is_open())
+        return false;
+
+    std::string line;
+    if (!getline(in, line) || line != "# " + _signature)
+    {
+        OE_WARN << LC << "Checkpoint " << _filename << " is for a different run; starting over" << std::endl;
+        return false;
+    }
+
+    while( getline(in, line) )
+    {
+        std::vector< std::string > parts;
+        StringTokenizer(line, parts, "," );
+
+        if (parts.size() >= 3)
+        {
+            Record r;
+            r._lod = as<unsigned int>(parts[0], 0u);
+            r._x = as<unsigned int>(parts[1], 0u);
+            r._y = as<unsigned int>(parts[2], 0u);
+            _completed.insert(r);
+        }
+    }
+
+    OE_INFO << LC << "Resuming from " << _filename << " with " << _completed.size() << " completed subtrees" << std::endl;
+    return true;
+}
+
+bool TileCheckpoint::save()
+{
+    std::set<Record> completed;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+
+        _lastSave = osg::Timer::instance()->time_s();
+
+        if (!_dirty)
+            return true;
+
+        completed = _completed;
+        _dirty = false;
+    }
+
+    // Every tile in the copy is handled; make sure its record is written.
+    WriteBehindCacheBin* queue = dynamic_cast<WriteBehindCacheBin*>(_bin.get());
+    if (queue)
+    {
+        queue->flush();
+    }
+
+    osgDB::makeDirectoryForFile(_filename);
+
+    // Write a new file and swap it in, so a crash while saving
+    // leaves the previous checkpoint intact.
+    std::string temp = _filename + ".tmp";
+    bool ok = true;
+    {
+        std::ofstream out( temp.c_str() );
+        out << "# " << _signature << std::endl;
+        for (std::set<Record>::const_iterator i = completed.begin(); i != completed.end(); ++i)
+        {
+            out << i->_lod << ", " << i->_x << ", " << i->_y << std::endl;
+        }
+        ok = out.good();
+    }
+
+    if (ok && ::rename(temp.c_str(), _filename.c_str()) != 0)
+    {
+        // Windows won't rename over an existing file
+        ::remove(_filename.c_str());
+        ok = ::rename(temp.c_str(), _filename.c_str()) == 0;
+    }
+
+    if (!ok)
+    {
+        OE_WARN << LC << "Failed to write checkpoint " << _filename << std::endl;
+
+        Threading::ScopedMutexLock lock(_mutex);
+        _dirty = true;
+    }
+
+    return ok;
+}
+
+void TileCheckpoint::saveIfDue(double seconds)
+{
+    bool due;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        due = _dirty && osg::Timer::instance()->time_s() - _lastSave >= seconds;
+    }
+    if (due)
+    {
+        save();
+    }
+}
+
+bool TileCheckpoint::isComplete(const TileKey& key) const
+{
+    Record r;
+    r._lod = key.getLOD();
+    key.getTileXY(r._x, r._y);
+
+    Threading::ScopedMutexLock lock(_mutex);
+    return _completed.find(r) != _completed.end();
+}
+
+void TileCheckpoint::setComplete(const TileKey& key)
+{
+    Record r;
+    r._lod = key.getLOD();
+    key.getTileXY(r._x, r._y);
+
+    Threading::ScopedMutexLock lock(_mutex);
+
+    // The parent record now covers the children.
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        Record child;
+        child._lod = r._lod + 1;
+        child._x = r._x * 2 + (i & 1);
+        child._y = r._y * 2 + (i >> 1);
+        _completed.erase(child);
+    }
+
+    _completed.insert(r);
+    _dirty = true;
+}
+
+unsigned TileCheckpoint::getNumCompleted() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _completed.size();
+}
+
+/*****************************************************************************************/
+
 TileVisitor::TileVisitor():
 _total(0),
 _processed(0),
@@ -137,6 +299,11 @@ void TileVisitor::run( const Profile* mapProfile )
     {
         processKey( keys[i] );
     }
+
+    if (_checkpoint.valid())
+    {
+        _checkpoint->save();
+    }
 }
 
 void TileVisitor::estimate()
@@ -171,6 +338,31 @@ void TileVisitor::processKey( const TileKey& key )
         return;
     }
 
+    // Skip subtrees that an earlier run already finished.
+    SubtreePtr subtree;
+    SubtreePtr parent = _subtree;
+    if (_checkpoint.valid())
+    {
+        if (_checkpoint->isComplete(key))
+        {
+            return;
+        }
+
+        _checkpoint->saveIfDue(30.0);
+
+        // Hold the subtree open until this traversal and every tile
+        // handled under it are done.
+        subtree = std::make_shared<Subtree>();
+        subtree->_key = key;
+        subtree->_pending = 1;
+        subtree->_parent = parent;
+        if (parent)
+        {
+            ++parent->_pending;
+        }
+        _subtree = subtree;
+    }
+
     bool traverseChildren = false;
 
     // If the key intersects the extent attempt to traverse
@@ -197,6 +389,25 @@ void TileVisitor::processKey( const TileKey& key )
             processKey( k );
         }
     }
+
+    if (subtree)
+    {
+        _subtree = parent;
+        releaseSubtree(subtree);
+    }
+}
+
+void TileVisitor::releaseSubtree(SubtreePtr subtree)
+{
+    while (subtree && --subtree->_pending == 0)
+    {
+        // A canceled run may have skipped tiles, so don't trust it.
+        if (_progress.valid() && _progress->isCanceled())
+            return;
+
+        _checkpoint->setComplete(subtree->_key);
+        subtree = subtree->_parent;
+    }
 }
 
 void TileVisitor::incrementProgress(unsigned int amount)
@@ -269,6 +480,12 @@ void MultithreadedTileVisitor::run(const Profile* mapProfile)
     TileVisitor::run( mapProfile );
 
     _group.join();
+
+    // Subtrees completed while joining
+    if (_checkpoint.valid())
+    {
+        _checkpoint->save();
+    }
     
     //// Wait for everything to finish
     //Mutex _doneMx;
@@ -289,8 +506,15 @@ bool MultithreadedTileVisitor::handleTile(const TileKey& key)
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 
+    // Keep the key's subtree open until the job finishes.
+    SubtreePtr subtree = _subtree;
+    if (subtree)
+    {
+        ++subtree->_pending;
+    }
+
     // Add the tile to the task queue.
-    auto delegate = [this, key](Cancelable*)
+    auto delegate = [this, key, subtree](Cancelable*)
     {
         if ((_tileHandler.valid()) &&
             (!_progress.valid() || !_progress->isCanceled()))
@@ -298,6 +522,11 @@ bool MultithreadedTileVisitor::handleTile(const TileKey& key)
             _tileHandler->handleTile(key, *this);
             this->incrementProgress(1);
         }
+
+        if (subtree)
+        {
+            releaseSubtree(subtree);
+        }
     };
 
     Job job(_arena.get(), &_group);
@@ -0,0 +1,51 @@
+#version $GLSL_VERSION_STR
+#pragma vp_name TrackSet Icon VS
+#pragma vp_entryPoint oe_TrackSet_icon_VS
+#pragma vp_location vertex_model
+
+// two texels per track: (x, y, z, heading) and (icon, scale, visible, 0)
+uniform samplerBuffer oe_TrackSet_tracks;
+uniform float oe_TrackSet_iconSize;
+
+out vec2 oe_TrackSet_texcoord;
+flat out float oe_TrackSet_icon;
+out vec2 oe_TrackSet_offset;
+out float oe_TrackSet_visible;
+
+void oe_TrackSet_icon_VS(inout vec4 vertex)
+{
+    vec4 position = texelFetch(oe_TrackSet_tracks, gl_InstanceID*2);
+    vec4 data = texelFetch(oe_TrackSet_tracks, gl_InstanceID*2+1);
+
+    // the quad's corners are +/-0.5
+    vec2 corner = vertex.xy;
+    oe_TrackSet_texcoord = corner + 0.5;
+    oe_TrackSet_icon = data.x;
+    oe_TrackSet_visible = data.z;
+
+    // heading turns the icon clockwise on the screen
+    float a = -radians(position.w);
+    vec2 c = corner * oe_TrackSet_iconSize * data.y;
+    oe_TrackSet_offset = vec2(c.x*cos(a) - c.y*sin(a), c.x*sin(a) + c.y*cos(a));
+
+    vertex = vec4(position.xyz, 1.0);
+}
+
+[break]
+
+#version $GLSL_VERSION_STR
+#pragma vp_name TrackSet Icon FS
+#pragma vp_entryPoint oe_TrackSet_icon_FS
+#pragma vp_location fragment_coloring
+
+uniform sampler2DArray oe_TrackSet_icons;
+
+in vec2 oe_TrackSet_texcoord;
+flat in float oe_TrackSet_icon;
+
+void oe_TrackSet_icon_FS(inout vec4 color)
+{
+    color = texture(oe_TrackSet_icons, vec3(oe_TrackSet_texcoord, oe_TrackSet_icon));
+    if (color.a < 0.05)
+        discard;
+}
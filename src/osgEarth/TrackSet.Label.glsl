@@ -0,0 +1,54 @@
+#version $GLSL_VERSION_STR
+#pragma vp_name TrackSet Label VS
+#pragma vp_entryPoint oe_TrackSet_label_VS
+#pragma vp_location vertex_model
+
+// two texels per track: (x, y, z, heading) and (icon, scale, visible, 0)
+uniform samplerBuffer oe_TrackSet_tracks;
+
+// two texels per glyph: (track, x offset, y offset, used) and (s0, t0, s1, t1)
+uniform samplerBuffer oe_TrackSet_glyphs;
+uniform sampler2D oe_TrackSet_atlas;
+
+out vec2 oe_TrackSet_texcoord;
+out vec2 oe_TrackSet_offset;
+out float oe_TrackSet_visible;
+
+void oe_TrackSet_label_VS(inout vec4 vertex)
+{
+    vec4 glyph = texelFetch(oe_TrackSet_glyphs, gl_InstanceID*2);
+    vec4 tc = texelFetch(oe_TrackSet_glyphs, gl_InstanceID*2+1);
+
+    int track = int(glyph.x);
+    vec4 position = texelFetch(oe_TrackSet_tracks, track*2);
+    vec4 data = texelFetch(oe_TrackSet_tracks, track*2+1);
+
+    // glyphs map 1:1 from atlas texels to pixels
+    vec2 uv = vertex.xy + 0.5;
+    vec2 size = (tc.zw - tc.xy) * vec2(textureSize(oe_TrackSet_atlas, 0));
+    oe_TrackSet_texcoord = mix(tc.xy, tc.zw, uv);
+    oe_TrackSet_offset = glyph.yz + uv*size;
+    oe_TrackSet_visible = glyph.w * data.z;
+
+    vertex = vec4(position.xyz, 1.0);
+}
+
+[break]
+
+#version $GLSL_VERSION_STR
+#pragma vp_name TrackSet Label FS
+#pragma vp_entryPoint oe_TrackSet_label_FS
+#pragma vp_location fragment_coloring
+
+uniform sampler2D oe_TrackSet_atlas;
+uniform vec4 oe_TrackSet_labelColor;
+
+in vec2 oe_TrackSet_texcoord;
+
+void oe_TrackSet_label_FS(inout vec4 color)
+{
+    float coverage = texture(oe_TrackSet_atlas, oe_TrackSet_texcoord).a;
+    color = vec4(oe_TrackSet_labelColor.rgb, oe_TrackSet_labelColor.a * coverage);
+    if (color.a < 0.05)
+        discard;
+}
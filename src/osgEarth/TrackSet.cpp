@@ -0,0 +1,666 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <osgEarth/TrackSet>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/Lighting>
+#include <osgEarth/Registry>
+#include <osgEarth/ShaderGenerator>
+#include <osgEarth/Shaders>
+#include <osgEarth/TextureBuffer>
+#include <osgEarth/VirtualProgram>
+#include <osg/BlendFunc>
+#include <osg/Depth>
+#include <osgText/String>
+#include <cstring>
+
+#define LC "[TrackSet] "
+
+using namespace osgEarth;
+
+// Resolution of each icon in the icon texture array
+#define ICON_RESOLUTION 64
+
+// Glyph slots reserved for each track's label
+#define MAX_LABEL_GLYPHS 16u
+
+// Size of the glyph atlas
+#define ATLAS_SIZE 1024
+
+// Texture units
+#define ICON_UNIT 0
+#define ATLAS_UNIT 0
+#define TRACK_UNIT 1
+#define GLYPH_UNIT 2
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    // Texels of a track in the track buffer: (x, y, z, heading) and
+    // (icon, scale, visible, 0). Texels of a glyph slot in the glyph
+    // buffer: (track, x offset, y offset, used) and (s0, t0, s1, t1).
+    inline float* texel(osg::Image* image, unsigned index)
+    {
+        return reinterpret_cast<float*>(image->data()) + 4u * index;
+    }
+
+    osg::Image* createBuffer(unsigned texels)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(osg::maximum(texels, 1u), 1, 1, GL_RGBA, GL_FLOAT);
+        ::memset(image->data(), 0, image->getTotalSizeInBytes());
+        return image;
+    }
+
+    osg::TextureBuffer* createTBO(osg::Image* image)
+    {
+        osg::TextureBuffer* tbo = new osgEarth::TextureBuffer();
+        tbo->setImage(image);
+        tbo->setInternalFormat(GL_RGBA32F_ARB);
+        tbo->setUnRefImageDataAfterApply(false);
+        ShaderGenerator::setIgnoreHint(tbo, true);
+        return tbo;
+    }
+
+    // A dot, for tracks drawn before any icon was added
+    osg::Image* createDotIcon()
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(ICON_RESOLUTION, ICON_RESOLUTION, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        ImageUtils::PixelWriter write(image);
+        const float r = 0.5f * (float)ICON_RESOLUTION;
+        for (int t = 0; t < ICON_RESOLUTION; ++t)
+        {
+            for (int s = 0; s < ICON_RESOLUTION; ++s)
+            {
+                float dx = (float)s + 0.5f - r, dy = (float)t + 0.5f - r;
+                float d = sqrtf(dx*dx + dy*dy) / r;
+                float a = osg::clampBetween((1.0f - d) * 8.0f, 0.0f, 1.0f);
+                write(osg::Vec4f(1, 1, 1, a), s, t);
+            }
+        }
+        return image;
+    }
+
+    // One quad with corners at +/-0.5, drawn once per instance
+    osg::Geometry* createQuad(const std::string& name)
+    {
+        osg::Geometry* geom = new osg::Geometry();
+        geom->setName(name);
+        geom->setUseVertexBufferObjects(true);
+        geom->setUseDisplayList(false);
+
+        osg::Vec3Array* verts = new osg::Vec3Array();
+        verts->push_back(osg::Vec3(-0.5f, -0.5f, 0.0f));
+        verts->push_back(osg::Vec3( 0.5f, -0.5f, 0.0f));
+        verts->push_back(osg::Vec3(-0.5f,  0.5f, 0.0f));
+        verts->push_back(osg::Vec3( 0.5f,  0.5f, 0.0f));
+        geom->setVertexArray(verts);
+
+        geom->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLE_STRIP, 0, 0));
+        return geom;
+    }
+}
+
+// Bounds of the world positions of all tracks, since the geometries
+// themselves are one small quad each
+struct TrackSetBounds : public osg::Drawable::ComputeBoundingBoxCallback
+{
+    osg::BoundingBox _box;
+    osg::BoundingBox computeBound(const osg::Drawable&) const override { return _box; }
+};
+
+//------------------------------------------------------------------------
+
+TrackSet::TrackSet(const SpatialReference* mapSRS, const SpatialReference* positionSRS) :
+    _mapSRS(mapSRS),
+    _positionSRS(positionSRS ? positionSRS : (mapSRS ? mapSRS->getGeographicSRS() : nullptr)),
+    _nextID(0u),
+    _capacity(0u),
+    _hasIcons(false),
+    _iconSize(32.0f),
+    _labelSize(14u),
+    _labelOffsetSet(false),
+    _shelfX(0u),
+    _shelfY(0u),
+    _shelfHeight(0u),
+    _atlasFull(false)
+{
+    // This class makes its own shaders
+    ShaderGenerator::setIgnoreHint(this, true);
+
+    _font = Registry::instance()->getDefaultFont();
+    _labelOffset.set(0.5f*_iconSize + 2.0f, -0.5f*(float)_labelSize);
+
+    _bounds = new TrackSetBounds();
+
+    // Both geometries draw over the scene, icons first
+    osg::StateSet* stateset = getOrCreateStateSet();
+    stateset->setAttributeAndModes(new osg::Depth(osg::Depth::ALWAYS, 0, 1, false), 1);
+    stateset->setAttributeAndModes(new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), 1);
+    Lighting::set(stateset, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED);
+
+    const SpatialReference* worldSRS = _mapSRS.valid() ? _mapSRS->getGeocentricSRS() : nullptr;
+    if (_mapSRS.valid() && _mapSRS->isGeographic() && worldSRS)
+    {
+        stateset->setDefine("OE_TRACKSET_HORIZON");
+        stateset->addUniform(new osg::Uniform("oe_TrackSet_horizonRadius",
+            (float)worldSRS->getEllipsoid()->getRadiusPolar()));
+    }
+
+    osg::Uniform* tracks = new osg::Uniform(osg::Uniform::SAMPLER_BUFFER, "oe_TrackSet_tracks");
+    tracks->set(TRACK_UNIT);
+    stateset->addUniform(tracks);
+
+    _iconGeom = createQuad("TrackSet icons");
+    _iconGeom->setComputeBoundingBoxCallback(_bounds.get());
+    osg::StateSet* iconSS = _iconGeom->getOrCreateStateSet();
+    iconSS->setDataVariance(osg::Object::DYNAMIC);
+    iconSS->setRenderBinDetails(100, "RenderBin");
+    VirtualProgram* iconVP = VirtualProgram::getOrCreate(iconSS);
+    iconVP->setName("TrackSet icons");
+    Shaders shaders;
+    shaders.load(iconVP, shaders.TrackSet);
+    shaders.load(iconVP, shaders.TrackSetIcon);
+    osg::Uniform* icons = new osg::Uniform(osg::Uniform::SAMPLER_2D_ARRAY, "oe_TrackSet_icons");
+    icons->set(ICON_UNIT);
+    iconSS->addUniform(icons);
+    _iconSizeUniform = new osg::Uniform("oe_TrackSet_iconSize", _iconSize);
+    iconSS->addUniform(_iconSizeUniform.get());
+    addChild(_iconGeom.get());
+
+    _labelGeom = createQuad("TrackSet labels");
+    _labelGeom->setComputeBoundingBoxCallback(_bounds.get());
+    osg::StateSet* labelSS = _labelGeom->getOrCreateStateSet();
+    labelSS->setDataVariance(osg::Object::DYNAMIC);
+    labelSS->setRenderBinDetails(101, "RenderBin");
+    VirtualProgram* labelVP = VirtualProgram::getOrCreate(labelSS);
+    labelVP->setName("TrackSet labels");
+    shaders.load(labelVP, shaders.TrackSet);
+    shaders.load(labelVP, shaders.TrackSetLabel);
+    osg::Uniform* glyphs = new osg::Uniform(osg::Uniform::SAMPLER_BUFFER, "oe_TrackSet_glyphs");
+    glyphs->set(GLYPH_UNIT);
+    labelSS->addUniform(glyphs);
+    labelSS->addUniform(new osg::Uniform("oe_TrackSet_atlas", ATLAS_UNIT));
+    _labelColorUniform = new osg::Uniform("oe_TrackSet_labelColor", osg::Vec4f(1, 1, 1, 1));
+    labelSS->addUniform(_labelColorUniform.get());
+    addChild(_labelGeom.get());
+
+    reserve(1024u);
+    createIconTexture();
+    resetAtlas();
+}
+
+TrackSet::~TrackSet()
+{
+    //nop
+}
+
+void
+TrackSet::reserve(unsigned capacity)
+{
+    if (capacity <= _capacity)
+        return;
+
+    osg::ref_ptr<osg::Image> trackData = createBuffer(capacity * 2u);
+    osg::ref_ptr<osg::Image> glyphData = createBuffer(capacity * MAX_LABEL_GLYPHS * 2u);
+
+    if (_trackData.valid())
+    {
+        ::memcpy(trackData->data(), _trackData->data(), _trackData->getTotalSizeInBytes());
+        ::memcpy(glyphData->data(), _glyphData->data(), _glyphData->getTotalSizeInBytes());
+    }
+
+    _trackData = trackData;
+    _glyphData = glyphData;
+    _capacity = capacity;
+
+    // a texture buffer can't change size, so make new ones
+    _trackTBO = createTBO(_trackData.get());
+    _glyphTBO = createTBO(_glyphData.get());
+    getOrCreateStateSet()->setTextureAttribute(TRACK_UNIT, _trackTBO.get());
+    _labelGeom->getOrCreateStateSet()->setTextureAttribute(GLYPH_UNIT, _glyphTBO.get());
+}
+
+void
+TrackSet::createIconTexture()
+{
+    if (_icons.empty())
+        _icons.push_back(createDotIcon());
+
+    // the layer count is fixed when the texture is created
+    _iconTexture = new osg::Texture2DArray();
+    _iconTexture->setTextureSize(ICON_RESOLUTION, ICON_RESOLUTION, _icons.size());
+    for (unsigned i = 0; i < _icons.size(); ++i)
+        _iconTexture->setImage(i, _icons[i].get());
+    _iconTexture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR_MIPMAP_LINEAR);
+    _iconTexture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    _iconTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _iconTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    _iconTexture->setResizeNonPowerOfTwoHint(false);
+    ShaderGenerator::setIgnoreHint(_iconTexture.get(), true);
+
+    _iconGeom->getOrCreateStateSet()->setTextureAttribute(ICON_UNIT, _iconTexture.get());
+}
+
+int
+TrackSet::addIcon(osg::Image* image)
+{
+    if (!image)
+        return -1;
+
+    osg::ref_ptr<osg::Image> rgba = ImageUtils::convertToRGBA8(image);
+    osg::ref_ptr<osg::Image> icon;
+    if (!rgba.valid() || !ImageUtils::resizeImage(rgba.get(), ICON_RESOLUTION, ICON_RESOLUTION, icon))
+    {
+        OE_WARN << LC << "Failed to prepare icon \"" << image->getFileName() << "\"" << std::endl;
+        return -1;
+    }
+
+    // the first real icon replaces the dot
+    if (!_hasIcons)
+    {
+        _icons.clear();
+        _hasIcons = true;
+    }
+
+    _icons.push_back(icon);
+    createIconTexture();
+    return _icons.size() - 1;
+}
+
+void
+TrackSet::resetAtlas()
+{
+    _atlas = new osg::Image();
+    _atlas->allocateImage(ATLAS_SIZE, ATLAS_SIZE, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    ::memset(_atlas->data(), 0, _atlas->getTotalSizeInBytes());
+
+    _glyphs.clear();
+    _shelfX = _shelfY = _shelfHeight = 0u;
+    _atlasFull = false;
+
+    _atlasTexture = new osg::Texture2D(_atlas.get());
+    _atlasTexture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    _atlasTexture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    _atlasTexture->setResizeNonPowerOfTwoHint(false);
+    _atlasTexture->setUnRefImageDataAfterApply(false);
+    ShaderGenerator::setIgnoreHint(_atlasTexture.get(), true);
+
+    _labelGeom->getOrCreateStateSet()->setTextureAttribute(ATLAS_UNIT, _atlasTexture.get());
+}
+
+const TrackSet::Glyph&
+TrackSet::getGlyph(unsigned charcode)
+{
+    auto i = _glyphs.find(charcode);
+    if (i != _glyphs.end())
+        return i->second;
+
+    Glyph& g = _glyphs[charcode];
+    g._valid = false;
+    g._advance = 0.3f * (float)_labelSize;
+
+    osgText::Glyph* glyph = _font.valid() ?
+        _font->getGlyph(osgText::FontResolution(_labelSize, _labelSize), charcode) :
+        nullptr;
+
+    if (!glyph || glyph->s() <= 0 || glyph->t() <= 0)
+        return g; // blank, like a space
+
+    g._advance = (float)glyph->s() + 1.0f;
+
+    // pack the glyph into the next spot on the current shelf
+    unsigned w = glyph->s(), h = glyph->t();
+    if (_shelfX + w + 1u > ATLAS_SIZE)
+    {
+        _shelfX = 0u;
+        _shelfY += _shelfHeight + 1u;
+        _shelfHeight = 0u;
+    }
+    if (_shelfY + h + 1u > ATLAS_SIZE || w + 1u > ATLAS_SIZE)
+    {
+        if (!_atlasFull)
+            OE_WARN << LC << "Glyph atlas is full; some label characters won't draw" << std::endl;
+        _atlasFull = true;
+        return g;
+    }
+
+    // for one-channel glyphs, use the RED channel, otherwise ALPHA
+    ImageUtils::PixelReader read(glyph);
+    unsigned chan = glyph->getPixelFormat() == GL_RED || glyph->getPixelFormat() == GL_LUMINANCE ? 0 : 3;
+    osg::Vec4f value;
+    for (unsigned t = 0; t < h; ++t)
+    {
+        unsigned char* dst = _atlas->data(_shelfX, _shelfY + t);
+        for (unsigned s = 0; s < w; ++s, dst += 4)
+        {
+            read(value, s, t);
+            dst[0] = dst[1] = dst[2] = 255;
+            dst[3] = (unsigned char)(osg::clampBetween(value[chan], 0.0f, 1.0f) * 255.0f);
+        }
+    }
+    _atlas->dirty();
+
+    g._s0 = (float)_shelfX / (float)ATLAS_SIZE;
+    g._t0 = (float)_shelfY / (float)ATLAS_SIZE;
+    g._s1 = (float)(_shelfX + w) / (float)ATLAS_SIZE;
+    g._t1 = (float)(_shelfY + h) / (float)ATLAS_SIZE;
+    g._valid = true;
+
+    _shelfX += w + 1u;
+    _shelfHeight = osg::maximum(_shelfHeight, h);
+
+    return g;
+}
+
+void
+TrackSet::layoutLabel(unsigned index)
+{
+    osgText::String text(_labels[index], osgText::String::ENCODING_UTF8);
+
+    float x = _labelOffset.x(), y = _labelOffset.y();
+    unsigned slot = 0u;
+
+    for (unsigned i = 0; i < text.size() && slot < MAX_LABEL_GLYPHS; ++i)
+    {
+        const Glyph& g = getGlyph(text[i]);
+        if (g._valid)
+        {
+            float* t = texel(_glyphData.get(), 2u * (index * MAX_LABEL_GLYPHS + slot));
+            t[0] = (float)index, t[1] = x, t[2] = y, t[3] = 1.0f;
+            t[4] = g._s0, t[5] = g._t0, t[6] = g._s1, t[7] = g._t1;
+            ++slot;
+        }
+        x += g._advance;
+    }
+
+    // mark the rest unused
+    for (; slot < MAX_LABEL_GLYPHS; ++slot)
+    {
+        float* t = texel(_glyphData.get(), 2u * (index * MAX_LABEL_GLYPHS + slot));
+        t[0] = (float)index, t[3] = 0.0f;
+    }
+
+    _glyphData->dirty();
+}
+
+void
+TrackSet::writePositions(const unsigned* indices, std::vector<osg::Vec3d>& points, const float* headings)
+{
+    // one pass through the transform machinery for the whole batch
+    if (_positionSRS.valid() && _mapSRS.valid())
+    {
+        if (!_positionSRS->isHorizEquivalentTo(_mapSRS.get()))
+            _positionSRS->transform(points, _mapSRS.get());
+        _mapSRS->transformToWorld(points);
+    }
+
+    for (unsigned i = 0; i < points.size(); ++i)
+    {
+        float* t = texel(_trackData.get(), 2u * indices[i]);
+        t[0] = (float)points[i].x();
+        t[1] = (float)points[i].y();
+        t[2] = (float)points[i].z();
+        if (headings)
+            t[3] = headings[i];
+    }
+}
+
+void
+TrackSet::dirtyTracks()
+{
+    _trackData->dirty();
+
+    // recompute the bounds from every position; cheap next to the upload
+    osg::BoundingBox box;
+    for (unsigned i = 0; i < _ids.size(); ++i)
+    {
+        const float* t = texel(_trackData.get(), 2u * i);
+        box.expandBy(t[0], t[1], t[2]);
+    }
+    static_cast<TrackSetBounds*>(_bounds.get())->_box = box;
+    _iconGeom->dirtyBound();
+    _labelGeom->dirtyBound();
+}
+
+void
+TrackSet::dirtyCounts()
+{
+    unsigned n = _ids.size();
+
+    // zero instances would mean a normal, single draw
+    osg::DrawArrays* icons = static_cast<osg::DrawArrays*>(_iconGeom->getPrimitiveSet(0));
+    icons->setCount(n > 0u ? 4 : 0);
+    icons->setNumInstances(n);
+
+    osg::DrawArrays* glyphs = static_cast<osg::DrawArrays*>(_labelGeom->getPrimitiveSet(0));
+    glyphs->setCount(n > 0u ? 4 : 0);
+    glyphs->setNumInstances(n * MAX_LABEL_GLYPHS);
+}
+
+TrackSet::TrackID
+TrackSet::add(const osg::Vec3d& position, int icon, const std::string& label)
+{
+    unsigned index = _ids.size();
+    if (index == _capacity)
+        reserve(_capacity * 2u);
+
+    TrackID id = _nextID++;
+    _ids.push_back(id);
+    _labels.push_back(label);
+    _indices[id] = index;
+
+    std::vector<osg::Vec3d> points(1, position);
+    float heading = 0.0f;
+    writePositions(&index, points, &heading);
+
+    float* data = texel(_trackData.get(), 2u * index + 1u);
+    data[0] = (float)osg::clampBetween(icon, 0, (int)_icons.size() - 1);
+    data[1] = 1.0f;
+    data[2] = 1.0f;
+    data[3] = 0.0f;
+
+    layoutLabel(index);
+    dirtyTracks();
+    dirtyCounts();
+    return id;
+}
+
+void
+TrackSet::moveTrack(unsigned from, unsigned to)
+{
+    ::memcpy(texel(_trackData.get(), 2u * to), texel(_trackData.get(), 2u * from), 8u * sizeof(float));
+
+    ::memcpy(
+        texel(_glyphData.get(), 2u * to * MAX_LABEL_GLYPHS),
+        texel(_glyphData.get(), 2u * from * MAX_LABEL_GLYPHS),
+        8u * MAX_LABEL_GLYPHS * sizeof(float));
+
+    // the glyphs point back at their track
+    for (unsigned slot = 0; slot < MAX_LABEL_GLYPHS; ++slot)
+        texel(_glyphData.get(), 2u * (to * MAX_LABEL_GLYPHS + slot))[0] = (float)to;
+
+    _ids[to] = _ids[from];
+    _labels[to].swap(_labels[from]);
+    _indices[_ids[to]] = to;
+}
+
+void
+TrackSet::remove(TrackID id)
+{
+    auto i = _indices.find(id);
+    if (i == _indices.end())
+        return;
+
+    // keep the arrays packed by moving the last track into the hole
+    unsigned index = i->second;
+    _indices.erase(i);
+
+    unsigned last = _ids.size() - 1u;
+    if (index != last)
+        moveTrack(last, index);
+
+    _ids.pop_back();
+    _labels.pop_back();
+
+    _glyphData->dirty();
+    dirtyTracks();
+    dirtyCounts();
+}
+
+bool
+TrackSet::contains(TrackID id) const
+{
+    return _indices.find(id) != _indices.end();
+}
+
+void
+TrackSet::update(const Update* updates, unsigned count)
+{
+    std::vector<unsigned> indices;
+    std::vector<osg::Vec3d> points;
+    std::vector<float> headings;
+    indices.reserve(count);
+    points.reserve(count);
+    headings.reserve(count);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        auto index = _indices.find(updates[i].id);
+        if (index != _indices.end())
+        {
+            indices.push_back(index->second);
+            points.push_back(updates[i].position);
+            headings.push_back(updates[i].heading);
+        }
+    }
+
+    if (indices.empty())
+        return;
+
+    writePositions(&indices[0], points, &headings[0]);
+    dirtyTracks();
+}
+
+void
+TrackSet::setIcon(TrackID id, int icon)
+{
+    auto i = _indices.find(id);
+    if (i != _indices.end())
+    {
+        texel(_trackData.get(), 2u * i->second + 1u)[0] = (float)osg::clampBetween(icon, 0, (int)_icons.size() - 1);
+        _trackData->dirty();
+    }
+}
+
+void
+TrackSet::setScale(TrackID id, float scale)
+{
+    auto i = _indices.find(id);
+    if (i != _indices.end())
+    {
+        texel(_trackData.get(), 2u * i->second + 1u)[1] = scale;
+        _trackData->dirty();
+    }
+}
+
+void
+TrackSet::setVisible(TrackID id, bool value)
+{
+    auto i = _indices.find(id);
+    if (i != _indices.end())
+    {
+        texel(_trackData.get(), 2u * i->second + 1u)[2] = value ? 1.0f : 0.0f;
+        _trackData->dirty();
+    }
+}
+
+void
+TrackSet::setLabel(TrackID id, const std::string& text)
+{
+    auto i = _indices.find(id);
+    if (i != _indices.end() && _labels[i->second] != text)
+    {
+        _labels[i->second] = text;
+        layoutLabel(i->second);
+    }
+}
+
+const std::string&
+TrackSet::getLabel(TrackID id) const
+{
+    static const std::string s_empty;
+    auto i = _indices.find(id);
+    return i != _indices.end() ? _labels[i->second] : s_empty;
+}
+
+void
+TrackSet::setIconSize(float pixels)
+{
+    _iconSize = pixels;
+    _iconSizeUniform->set(pixels);
+
+    if (!_labelOffsetSet)
+    {
+        _labelOffset.set(0.5f*_iconSize + 2.0f, -0.5f*(float)_labelSize);
+        for (unsigned i = 0; i < _ids.size(); ++i)
+            layoutLabel(i);
+    }
+}
+
+void
+TrackSet::setFont(osgText::Font* font)
+{
+    _font = font;
+    resetAtlas();
+    for (unsigned i = 0; i < _ids.size(); ++i)
+        layoutLabel(i);
+}
+
+void
+TrackSet::setLabelSize(unsigned pixels)
+{
+    _labelSize = osg::maximum(pixels, 1u);
+    if (!_labelOffsetSet)
+        _labelOffset.set(0.5f*_iconSize + 2.0f, -0.5f*(float)_labelSize);
+
+    resetAtlas();
+    for (unsigned i = 0; i < _ids.size(); ++i)
+        layoutLabel(i);
+}
+
+void
+TrackSet::setLabelColor(const osg::Vec4f& color)
+{
+    _labelColorUniform->set(color);
+}
+
+void
+TrackSet::setLabelOffset(const osg::Vec2f& pixels)
+{
+    _labelOffset = pixels;
+    _labelOffsetSet = true;
+    for (unsigned i = 0; i < _ids.size(); ++i)
+        layoutLabel(i);
+}
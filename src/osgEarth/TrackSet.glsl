@@ -0,0 +1,52 @@
+#version $GLSL_VERSION_STR
+#pragma vp_name TrackSet Horizon
+#pragma vp_entryPoint oe_TrackSet_VS_VIEW
+#pragma vp_location vertex_view
+#pragma import_defines(OE_TRACKSET_HORIZON)
+
+out float oe_TrackSet_visible;
+
+#ifdef OE_TRACKSET_HORIZON
+uniform float oe_TrackSet_horizonRadius;
+#endif
+
+void oe_TrackSet_VS_VIEW(inout vec4 vertexView)
+{
+#ifdef OE_TRACKSET_HORIZON
+    // hide the track if the earth is between it and the eye
+    vec3 center = (gl_ModelViewMatrix * vec4(0.0, 0.0, 0.0, 1.0)).xyz;
+    vec3 p = vertexView.xyz;
+    float t = dot(center, p) / dot(p, p);
+    if (t > 0.0 && t < 1.0)
+    {
+        vec3 q = p*t - center;
+        if (dot(q, q) < oe_TrackSet_horizonRadius*oe_TrackSet_horizonRadius)
+            oe_TrackSet_visible = 0.0;
+    }
+#endif
+}
+
+[break]
+
+#version $GLSL_VERSION_STR
+#pragma vp_name TrackSet Screen Offset
+#pragma vp_entryPoint oe_TrackSet_VS_CLIP
+#pragma vp_location vertex_clip
+
+uniform vec3 oe_Camera;
+
+// set by the model stage
+out vec2 oe_TrackSet_offset;
+out float oe_TrackSet_visible;
+
+void oe_TrackSet_VS_CLIP(inout vec4 vertexClip)
+{
+    if (oe_TrackSet_visible < 0.5)
+    {
+        // outside the frustum, so the quad is clipped away
+        vertexClip = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    vertexClip.xy += oe_TrackSet_offset * 2.0 / oe_Camera.xy * vertexClip.w;
+}
@@ -29,6 +29,7 @@
 #include <osgDB/Archive>
 #include <osgUtil/IncrementalCompileOperation>
 #include <typeinfo>
+#include <unordered_map>
 
 #define LC "[URI] "
 
@@ -672,6 +673,92 @@ namespace
     }
 }
 
+namespace
+{
+    // Remote reads in progress, keyed by kind and URI. Concurrent requests
+    // for the same resource (a layer shared by several views, say) wait
+    // on the first one's fetch instead of each going to the server.
+    Threading::Mutex s_inFlightMutex("URI.inFlight(OE)");
+    std::unordered_map<std::string, Threading::Future<ReadResult>> s_inFlight;
+
+    // Followers get a copy of a shared image, since consumers are
+    // free to modify what they receive.
+    ReadResult shareResult(const ReadResult& r)
+    {
+        if (r.getImage() == 0L)
+            return r;
+
+        ReadResult copy(
+            osg::clone(r.getImage(), osg::CopyOp::DEEP_COPY_ALL),
+            r.metadata());
+        copy.setIsFromCache(r.isFromCache());
+        copy.setLastModifiedTime(r.lastModifiedTime());
+        copy.setDuration(r.duration());
+        return copy;
+    }
+
+    template<typename READ_FUNCTOR>
+    ReadResult doCoalescedRead(
+        const std::string&    kind,
+        const URI&            inputURI,
+        const osgDB::Options* dbOptions,
+        ProgressCallback*     progress)
+    {
+        if (!inputURI.isRemote())
+        {
+            return doRead<READ_FUNCTOR>(inputURI, dbOptions, progress);
+        }
+
+        std::string key = kind + ":" + inputURI.full();
+
+        Threading::Promise<ReadResult> promise;
+        Threading::Future<ReadResult> pending;
+        bool leader = false;
+        {
+            Threading::ScopedMutexLock lock(s_inFlightMutex);
+            auto i = s_inFlight.find(key);
+            if (i == s_inFlight.end())
+            {
+                s_inFlight[key] = promise.getFuture();
+                leader = true;
+            }
+            else
+            {
+                pending = i->second;
+            }
+        }
+
+        if (!leader)
+        {
+            const ReadResult& shared = pending.get(progress);
+
+            if (progress && progress->isCanceled())
+            {
+                return ReadResult(ReadResult::RESULT_CANCELED);
+            }
+
+            // Only share successes; a failure may have been the other
+            // caller's cancelation, so try again ourselves.
+            if (pending.isAvailable() && shared.succeeded())
+            {
+                return shareResult(shared);
+            }
+
+            return doRead<READ_FUNCTOR>(inputURI, dbOptions, progress);
+        }
+
+        ReadResult result = doRead<READ_FUNCTOR>(inputURI, dbOptions, progress);
+
+        {
+            Threading::ScopedMutexLock lock(s_inFlightMutex);
+            s_inFlight.erase(key);
+        }
+        promise.resolve(result);
+
+        return result;
+    }
+}
+
 ReadResult
 URI::readObject(const osgDB::Options* dbOptions,
                 ProgressCallback*     progress ) const
@@ -679,6 +766,145 @@ URI::readObject(const osgDB::Options* dbOptions,
     return doRead<ReadObject>( *this, dbOptions, progress );
 }
 
+void
+URI::readImageAsync(const osgDB::Options*           dbOptions,
+                    ProgressCallback*               progress,
+                    const HTTPClient::ReadCallback& callback) const
+{
+    osg::ref_ptr<const osgDB::Options> localOptions = dbOptions ? dbOptions : Registry::instance()->getDefaultOptions();
+
+    // Anything other than a plain remote fetch goes down the normal path.
+    if (empty() ||
+        !isRemote() ||
+        optionString().isSet() ||
+        Registry::instance()->getURIReadCallback() != 0L ||
+        URIAliasMap::from(localOptions.get()) != 0L ||
+        URIResultCache::from(localOptions.get()) != 0L ||
+        Registry::instance()->isBlacklisted(full()))
+    {
+        callback(readImage(dbOptions, progress));
+        return;
+    }
+
+    unsigned long handle = NetworkMonitor::begin(full(), "pending", "URI");
+
+    optional<CachePolicy> cp;
+    osg::ref_ptr<CacheBin> bin;
+
+    CacheSettings* cacheSettings = CacheSettings::get(localOptions.get());
+    if (cacheSettings)
+    {
+        cp = cacheSettings->cachePolicy();
+        if (cp->isCacheEnabled())
+        {
+            bin = cacheSettings->getCacheBin();
+        }
+    }
+
+    // The cache is local, so consult it right here.
+    ReadImage reader;
+    ReadResult cached;
+    if (bin && cp->isCacheReadable())
+    {
+        cached = reader.fromCache(bin.get(), cacheKey());
+        if (cached.succeeded())
+        {
+            cached.setIsFromCache(true);
+            if (!cp->isExpired(cached.lastModifiedTime()))
+            {
+                NetworkMonitor::end(handle, "OK (from cache)");
+                callback(cached);
+                return;
+            }
+        }
+    }
+
+    if (cp->usage() == CachePolicy::USAGE_CACHE_ONLY)
+    {
+        NetworkMonitor::end(handle, cached.getResultCodeString());
+        callback(cached);
+        return;
+    }
+
+    // Need to do this to support nested PLODs and Proxynodes.
+    osg::ref_ptr<osgDB::Options> remoteOptions =
+        Registry::instance()->cloneOrCreateOptions(localOptions.get());
+    remoteOptions->getDatabasePathList().push_front(osgDB::getFilePath(full()));
+
+    HTTPRequest req(full());
+    req.getHeaders() = context().getHeaders();
+    if (cached.lastModifiedTime() > 0)
+    {
+        req.setLastModified(cached.lastModifiedTime());
+    }
+
+    URI uri(*this);
+    osg::ref_ptr<ProgressCallback> progress_ref(progress);
+    osg::ref_ptr<const osgDB::Options> callerOptions(dbOptions);
+
+    HTTPClient::readImageAsync(req, remoteOptions.get(), progress,
+        [uri, cp, bin, cached, remoteOptions, progress_ref, callerOptions, handle, callback](const ReadResult& remote)
+        {
+            ReadResult result = cached;
+
+            if (remote.code() == ReadResult::RESULT_NOT_MODIFIED)
+            {
+                // Touch the cached item so it doesn't expire again immediately.
+                if (bin)
+                    bin->touch(uri.cacheKey());
+            }
+            else
+            {
+                result = remote;
+                if (result.getImage())
+                    result.getImage()->setFileName(uri.full());
+            }
+
+            // Check for cancelation before a cache write
+            if (progress_ref.valid() && progress_ref->isCanceled())
+            {
+                NetworkMonitor::end(handle, "Canceled");
+                callback(ReadResult(ReadResult::RESULT_CANCELED));
+                return;
+            }
+
+            if (result.succeeded() && !result.isFromCache() && bin && cp->isCacheWriteable())
+            {
+                OE_DEBUG << LC << "Writing " << uri.cacheKey() << " to cache" << std::endl;
+                bin->write(uri.cacheKey(), result.getObject(), result.metadata(), remoteOptions.get());
+            }
+
+            if (result.getObject())
+            {
+                result.getObject()->setName(uri.base());
+            }
+
+            // If the request failed with an unrecoverable error,
+            // blacklist so we don't waste time on it again
+            if (result.failed())
+            {
+                osgEarth::Registry::instance()->blacklist(uri.full());
+            }
+
+            URIPostReadCallback* post = URIPostReadCallback::from(callerOptions.get());
+            if (post)
+            {
+                (*post)(result);
+            }
+
+            std::stringstream buf;
+            buf << result.getResultCodeString();
+            if (result.isFromCache() && result.succeeded())
+            {
+                buf << " (from cache)";
+            }
+            NetworkMonitor::end(handle, buf.str());
+
+            callback(result);
+        }
+    );
+}
+
 ReadResult
 URI::readNode(const osgDB::Options* dbOptions,
               ProgressCallback*     progress ) const
@@ -690,14 +916,14 @@ ReadResult
 URI::readImage(const osgDB::Options* dbOptions,
                ProgressCallback*     progress ) const
 {
-    return doRead<ReadImage>( *this, dbOptions, progress );
+    return doCoalescedRead<ReadImage>( "image", *this, dbOptions, progress );
 }
 
 ReadResult
 URI::readString(const osgDB::Options* dbOptions,
                 ProgressCallback*     progress ) const
 {
-    return doRead<ReadString>( *this, dbOptions, progress );
+    return doCoalescedRead<ReadString>( "string", *this, dbOptions, progress );
 }
 
 //------------------------------------------------------------------------
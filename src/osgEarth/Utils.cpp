@@ -21,6 +21,7 @@
 #include <osgEarth/ImageUtils>
 #include <osgEarth/Metrics>
 #include <osgUtil/MeshOptimizers>
+#include <unordered_map>
 
 using namespace osgEarth;
 using namespace osgEarth::Threading;
@@ -28,6 +29,24 @@ using namespace osgEarth::Util;
 
 //------------------------------------------------------------------------
 
+unsigned
+ObjectStorage::getSlotIndex(const char* typeName)
+{
+    static Mutex s_mutex(OE_MUTEX_NAME);
+    static std::unordered_map<std::string, unsigned> s_indices;
+
+    ScopedMutexLock lock(s_mutex);
+    auto i = s_indices.find(typeName);
+    if (i != s_indices.end())
+        return i->second;
+
+    unsigned index = s_indices.size();
+    s_indices[typeName] = index;
+    return index;
+}
+
+//------------------------------------------------------------------------
+
 #ifdef OE_HAVE_PIXEL_AUTO_TRANSFORM
 
 #undef LC
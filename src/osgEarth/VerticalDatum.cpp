@@ -152,17 +152,41 @@ VerticalDatum::transform(const VerticalDatum* from,
         ystep = (ne.y()-sw.y()) / double(rows-1);
     }
 
-    for( unsigned c=0; c<cols; ++c)
+    // sample each geoid over the whole grid at once, instead of
+    // converting one height at a time
+    std::vector<float> fromOffsets, toOffsets;
+
+    const Geoid* fromGeoid = from ? from->getGeoid() : 0L;
+    if ( fromGeoid )
+    {
+        fromOffsets.resize(cols*rows);
+        fromGeoid->getHeights(sw.y(), sw.x(), ystep, xstep, cols, rows, &fromOffsets[0]);
+    }
+
+    const Geoid* toGeoid = to ? to->getGeoid() : 0L;
+    if ( toGeoid )
+    {
+        toOffsets.resize(cols*rows);
+        toGeoid->getHeights(sw.y(), sw.x(), ystep, xstep, cols, rows, &toOffsets[0]);
+    }
+
+    Units fromUnits = from ? from->getUnits() : Units::METERS;
+    Units toUnits = to ? to->getUnits() : Units::METERS;
+    double scale = fromUnits.convertTo(toUnits, 1.0);
+
+    osg::HeightField::HeightList& heights = hf->getHeightList();
+    for( unsigned i=0; i<cols*rows; ++i )
     {
-        double lon = sw.x() + xstep*double(c);
-        for( unsigned r=0; r<rows; ++r)
+        float& h = heights[i];
+        if (h != NO_DATA_VALUE)
         {
-            double lat = sw.y() + ystep*double(r);
-            float& h = hf->getHeight(c, r);
-            if (h != NO_DATA_VALUE)
-            {
-                VerticalDatum::transform( from, to, lat, lon, h );
-            }
+            double z = h;
+            if ( fromGeoid )
+                z += fromOffsets[i];
+            z *= scale;
+            if ( toGeoid )
+                z -= toOffsets[i];
+            h = float(z);
         }
     }
 
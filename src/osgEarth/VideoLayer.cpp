@@ -18,7 +18,9 @@
 */
 #include <osgEarth/VideoLayer>
 #include <osg/ImageStream>
+#include <osg/BufferObject>
 #include <osgEarth/Registry>
+#include <osgEarth/GLUtils>
 
 using namespace osgEarth;
 
@@ -29,13 +31,133 @@ VideoLayer::Options::getConfig() const
 {
     Config conf = ImageLayer::Options::getConfig();
     conf.set("url", _url);
+    conf.set("upload_buffers", _uploadBuffers);
     return conf;
 }
 
 void
 VideoLayer::Options::fromConfig( const Config& conf )
 {
+    _uploadBuffers.init(3u);
     conf.get("url", _url );
+    conf.get("upload_buffers", _uploadBuffers);
+}
+
+//-------------------------------------------------------------
+
+namespace
+{
+    /**
+     * Texture that streams new video frames through a ring of pixel
+     * buffer objects. The CPU only copies a frame into the next buffer;
+     * the driver moves it to the texture asynchronously, and the copy of
+     * the frame after that goes to another buffer, so neither waits on
+     * the other. A frame that hasn't changed isn't uploaded at all.
+     */
+    class StreamingTexture : public osg::Texture2D
+    {
+    public:
+        StreamingTexture(osg::Image* image, unsigned numBuffers) :
+            osg::Texture2D(image),
+            _numBuffers(numBuffers) { }
+
+        void apply(osg::State& state) const override
+        {
+            const osg::Image* image = getImage();
+            unsigned contextID = state.getContextID();
+            osg::Texture::TextureObject* to = getTextureObject(contextID);
+
+            // Let OSG allocate the texture and handle anything unusual
+            if (!to ||
+                !image ||
+                !image->data() ||
+                !image->isDataContiguous() ||
+                image->isCompressed() ||
+                image->isMipmap() ||
+                image->s() != (int)getTextureWidth() ||
+                image->t() != (int)getTextureHeight())
+            {
+                osg::Texture2D::apply(state);
+                return;
+            }
+
+            to->bind();
+
+            unsigned& modifiedCount = getModifiedCount(contextID);
+            if (modifiedCount == image->getModifiedCount())
+                return;
+
+            osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+            PerContext& pc = _pc[contextID];
+
+            if (pc._buffers.size() != _numBuffers)
+            {
+                pc._buffers.clear();
+                for (unsigned i = 0; i < _numBuffers; ++i)
+                    pc._buffers.push_back(new GLBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, state, "oe.video"));
+                pc._next = 0u;
+            }
+
+            GLBuffer* buffer = pc._buffers[pc._next].get();
+            pc._next = (pc._next + 1u) % _numBuffers;
+
+            GLsizeiptr size = image->getTotalSizeInBytes();
+            buffer->bind();
+
+            // orphan the old storage so mapping never waits for the
+            // transfer still reading from it
+            ext->glBufferData(GL_PIXEL_UNPACK_BUFFER_ARB, size, nullptr, GL_STREAM_DRAW_ARB);
+            void* ptr = ext->glMapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+            if (ptr)
+            {
+                ::memcpy(ptr, image->data(), size);
+                ext->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB);
+
+                glPixelStorei(GL_UNPACK_ALIGNMENT, image->getPacking());
+                if (image->getRowLength() > 0 && image->getRowLength() != (unsigned)image->s())
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, image->getRowLength());
+
+                // source is the bound buffer, starting at offset 0
+                glTexSubImage2D(
+                    GL_TEXTURE_2D, 0, 0, 0,
+                    image->s(), image->t(),
+                    (GLenum)image->getPixelFormat(),
+                    (GLenum)image->getDataType(),
+                    nullptr);
+
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            }
+
+            ext->glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+
+            modifiedCount = image->getModifiedCount();
+        }
+
+        void resizeGLObjectBuffers(unsigned maxSize) override
+        {
+            _pc.resize(maxSize);
+            osg::Texture2D::resizeGLObjectBuffers(maxSize);
+        }
+
+        void releaseGLObjects(osg::State* state) const override
+        {
+            if (state)
+                _pc[state->getContextID()]._buffers.clear();
+            else
+                _pc.clear();
+            osg::Texture2D::releaseGLObjects(state);
+        }
+
+    private:
+        struct PerContext
+        {
+            std::vector<osg::ref_ptr<GLBuffer> > _buffers;
+            unsigned _next = 0u;
+        };
+
+        unsigned _numBuffers;
+        mutable osg::buffered_object<PerContext> _pc;
+    };
 }
 
 //-------------------------------------------------------------
@@ -43,6 +165,7 @@ VideoLayer::Options::fromConfig( const Config& conf )
 REGISTER_OSGEARTH_LAYER(video, VideoLayer);
 
 OE_LAYER_PROPERTY_IMPL(VideoLayer, URI, URL, url);
+OE_LAYER_PROPERTY_IMPL(VideoLayer, unsigned, UploadBuffers, uploadBuffers);
 
 void
 VideoLayer::init()
@@ -77,7 +200,10 @@ VideoLayer::openImplementation()
                 is->play();                 
             }
 
-            _texture = new osg::Texture2D( image );
+            if (options().uploadBuffers() > 0u)
+                _texture = new StreamingTexture( image.get(), options().uploadBuffers().get() );
+            else
+                _texture = new osg::Texture2D( image );
             _texture->setResizeNonPowerOfTwoHint( false );
             _texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture2D::LINEAR);
             _texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture2D::LINEAR);
@@ -0,0 +1,35 @@
+#version $GLSL_VERSION_STR
+$GLSL_DEFAULT_PRECISION_FLOAT
+
+#pragma vp_name       Viewshed RTT Vertex Shader
+#pragma vp_entryPoint oe_viewshed_rtt_vertex
+#pragma vp_location   vertex_view
+#pragma vp_order      last
+
+// the observer is at the origin of view space
+out vec3 oe_viewshed_eye;
+
+void oe_viewshed_rtt_vertex(inout vec4 vertex)
+{
+    oe_viewshed_eye = vertex.xyz / vertex.w;
+}
+
+
+[break]
+
+#version $GLSL_VERSION_STR
+$GLSL_DEFAULT_PRECISION_FLOAT
+
+#pragma vp_name       Viewshed RTT Fragment Shader
+#pragma vp_entryPoint oe_viewshed_rtt_fragment
+#pragma vp_location   fragment_output
+#pragma vp_order      last
+
+in vec3 oe_viewshed_eye;
+
+out vec4 fragColor;
+
+void oe_viewshed_rtt_fragment(inout vec4 color)
+{
+    fragColor = vec4(length(oe_viewshed_eye));
+}
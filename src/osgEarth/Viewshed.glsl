@@ -0,0 +1,89 @@
+#version $GLSL_VERSION_STR
+$GLSL_DEFAULT_PRECISION_FLOAT
+
+#pragma vp_name       Viewshed Vertex Shader
+#pragma vp_entryPoint oe_viewshed_vertex
+#pragma vp_location   vertex_view
+
+out vec3 oe_viewshed_view;
+
+void oe_viewshed_vertex(inout vec4 vertex)
+{
+    oe_viewshed_view = vertex.xyz / vertex.w;
+}
+
+
+[break]
+
+#version $GLSL_VERSION_STR
+$GLSL_DEFAULT_PRECISION_FLOAT
+
+#pragma vp_name       Viewshed Fragment Shader
+#pragma vp_entryPoint oe_viewshed_fragment
+#pragma vp_location   fragment_coloring
+
+uniform sampler2DArray oe_viewshed_map;
+uniform mat4  oe_viewshed_matrix[$OE_VIEWSHED_MAX_OBSERVERS];
+uniform float oe_viewshed_range[$OE_VIEWSHED_MAX_OBSERVERS];
+uniform int   oe_viewshed_count;
+uniform vec4  oe_viewshed_visibleColor;
+uniform vec4  oe_viewshed_hiddenColor;
+
+in vec3 oe_viewshed_view;
+
+// Cube face a vector in the observer's local frame points into, and where
+// it lands on that face. Must match the face cameras in ViewshedLayer.cpp.
+vec3 oe_viewshed_faceCoord(in vec3 p)
+{
+    vec3 a = abs(p);
+    vec3 dir, up;
+    float face;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = p.x > 0.0 ? 0.0 : 1.0;
+        dir = vec3(p.x > 0.0 ? 1.0 : -1.0, 0, 0);
+        up = vec3(0, 0, 1);
+    }
+    else if (a.y >= a.z) {
+        face = p.y > 0.0 ? 2.0 : 3.0;
+        dir = vec3(0, p.y > 0.0 ? 1.0 : -1.0, 0);
+        up = vec3(0, 0, 1);
+    }
+    else {
+        face = p.z > 0.0 ? 4.0 : 5.0;
+        dir = vec3(0, 0, p.z > 0.0 ? 1.0 : -1.0);
+        up = vec3(0, 1, 0);
+    }
+
+    // same basis as osg::Matrix::lookAt
+    vec3 side = normalize(cross(dir, up));
+    vec3 camUp = cross(side, dir);
+    vec2 uv = vec2(dot(side, p), dot(camUp, p)) / dot(dir, p);
+    return vec3(uv*0.5 + 0.5, face);
+}
+
+void oe_viewshed_fragment(inout vec4 color)
+{
+    bool inRange = false;
+    bool visible = false;
+
+    for(int i=0; i < oe_viewshed_count && !visible; ++i)
+    {
+        vec3 p = (oe_viewshed_matrix[i] * vec4(oe_viewshed_view, 1.0)).xyz;
+        float dist = length(p);
+        if (dist > oe_viewshed_range[i])
+            continue;
+
+        inRange = true;
+
+        vec3 coord = oe_viewshed_faceCoord(p);
+        float nearest = texture(oe_viewshed_map, vec3(coord.xy, float(i)*6.0 + coord.z)).r;
+
+        // a little slack, so the surface doesn't hide itself
+        visible = dist <= nearest*1.005 + 1.0;
+    }
+
+    if (!inRange)
+        discard;
+
+    color = visible ? oe_viewshed_visibleColor : oe_viewshed_hiddenColor;
+}
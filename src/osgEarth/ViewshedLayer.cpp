@@ -0,0 +1,616 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/ViewshedLayer>
+#include <osgEarth/Shaders>
+#include <osgEarth/VirtualProgram>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Registry>
+#include <osgEarth/Capabilities>
+#include <osgEarth/TerrainEngineNode>
+#include <osgEarth/Terrain>
+#include <osgEarth/CullingUtils>
+#include <osgEarth/NodeUtils>
+#include <osgEarth/GPUTimer>
+#include <osg/PolygonMode>
+
+#define LC "[ViewshedLayer] "
+
+using namespace osgEarth;
+
+//........................................................................
+
+ViewshedObserver::ViewshedObserver() :
+    _range(Distance(5000.0, Units::METERS)),
+    _revision(0u)
+{
+    //nop
+}
+
+ViewshedObserver::ViewshedObserver(const Config& conf) :
+    _range(Distance(5000.0, Units::METERS)),
+    _revision(0u)
+{
+    conf.get("position", position());
+    conf.get("range", range());
+}
+
+Config
+ViewshedObserver::getConfig() const
+{
+    Config conf("observer");
+    conf.set("position", position());
+    conf.set("range", range());
+    return conf;
+}
+
+void
+ViewshedObserver::setPosition(const GeoPoint& value)
+{
+    _position = value;
+    ++_revision;
+}
+
+void
+ViewshedObserver::setRange(const Distance& value)
+{
+    _range = value;
+    ++_revision;
+}
+
+//........................................................................
+
+namespace
+{
+    // Direction and up vector of each cube face, in the observer's local
+    // tangent frame. The fragment shader in Viewshed.glsl picks faces the
+    // same way, so these must match.
+    const osg::Vec3d s_faceDir[6] = {
+        osg::Vec3d( 1, 0, 0), osg::Vec3d(-1, 0, 0),
+        osg::Vec3d( 0, 1, 0), osg::Vec3d( 0,-1, 0),
+        osg::Vec3d( 0, 0, 1), osg::Vec3d( 0, 0,-1) };
+
+    const osg::Vec3d s_faceUp[6] = {
+        osg::Vec3d(0, 0, 1), osg::Vec3d(0, 0, 1),
+        osg::Vec3d(0, 0, 1), osg::Vec3d(0, 0, 1),
+        osg::Vec3d(0, 1, 0), osg::Vec3d(0, 1, 0) };
+
+    // what a face's texel holds when nothing is in the way
+    const float NOTHING_IN_THE_WAY = 1e10f;
+
+    // An observer's place in the distance map array
+    struct ObserverSlot
+    {
+        osg::ref_ptr<ViewshedObserver> _observer;
+        unsigned _revision = ~0u;       // observer revision the cameras match
+        bool _valid = false;            // cameras are positioned
+        bool _dirty = false;            // maps need rendering
+        osg::Matrixd _worldToLocal;
+        osg::Vec3d _world;
+        double _range = 0.0;
+        osg::ref_ptr<osg::Camera> _cameras[6];
+    };
+
+    // Positions the face cameras in the update traversal, and renders
+    // the ones that changed in the cull traversal.
+    class ViewshedNode : public osg::Group
+    {
+    public:
+        ViewshedNode() : _ready(false)
+        {
+            _occluders = new osg::Group();
+            ADJUST_UPDATE_TRAV_COUNT(this, +1);
+        }
+
+        void setup(
+            TerrainEngine* engine,
+            osg::Texture2DArray* maps,
+            osg::StateSet* layerStateSet,
+            unsigned maxObservers,
+            unsigned size);
+
+        void update();
+
+        void cull(osgUtil::CullVisitor* cv);
+
+        void dirty()
+        {
+            for (auto& slot : _slots)
+                slot._dirty = slot._valid;
+        }
+
+        // TerrainCallbackAdapter
+        void onTileUpdate(const TileKey& key, osg::Node* tile, TerrainCallbackContext&)
+        {
+            if (tile == nullptr)
+                return;
+
+            // new terrain data within an observer's range changes what it sees
+            const osg::BoundingSphere& bs = tile->getBound();
+            for (auto& slot : _slots)
+            {
+                if (slot._valid && bs.valid() &&
+                    (osg::Vec3d(bs.center()) - slot._world).length() <= bs.radius() + slot._range)
+                {
+                    slot._dirty = true;
+                }
+            }
+        }
+
+    public: // osg::Node
+
+        void traverse(osg::NodeVisitor& nv) override
+        {
+            if (_ready)
+            {
+                if (nv.getVisitorType() == nv.UPDATE_VISITOR)
+                {
+                    update();
+                }
+                else if (nv.getVisitorType() == nv.CULL_VISITOR)
+                {
+                    cull(Culling::asCullVisitor(nv));
+                }
+            }
+            osg::Group::traverse(nv);
+        }
+
+        void resizeGLObjectBuffers(unsigned maxSize) override
+        {
+            osg::Group::resizeGLObjectBuffers(maxSize);
+            if (_rttStateSet.valid())
+                _rttStateSet->resizeGLObjectBuffers(maxSize);
+            for (auto& slot : _slots)
+                for (unsigned f = 0; f < 6; ++f)
+                    slot._cameras[f]->resizeGLObjectBuffers(maxSize);
+        }
+
+        void releaseGLObjects(osg::State* state) const override
+        {
+            osg::Group::releaseGLObjects(state);
+            if (_rttStateSet.valid())
+                _rttStateSet->releaseGLObjects(state);
+            for (auto& slot : _slots)
+                for (unsigned f = 0; f < 6; ++f)
+                    slot._cameras[f]->releaseGLObjects(state);
+        }
+
+        std::vector<osg::ref_ptr<ViewshedObserver> > _observers;
+        osg::ref_ptr<osg::Group> _occluders;
+
+    private:
+        bool _ready;
+        std::vector<ObserverSlot> _slots;
+        osg::observer_ptr<Terrain> _terrain;
+        osg::ref_ptr<osg::StateSet> _rttStateSet;
+        osg::ref_ptr<osg::Uniform> _matrixUniform;
+        osg::ref_ptr<osg::Uniform> _rangeUniform;
+        osg::ref_ptr<osg::Uniform> _countUniform;
+    };
+
+    void
+    ViewshedNode::setup(
+        TerrainEngine* engine,
+        osg::Texture2DArray* maps,
+        osg::StateSet* layerStateSet,
+        unsigned maxObservers,
+        unsigned size)
+    {
+        _terrain = engine->getTerrain();
+        engine->getTerrain()->addTerrainCallback(new TerrainCallbackAdapter<ViewshedNode>(this));
+
+        // the terrain and occluders, from each observer's point of view
+        _rttStateSet = new osg::StateSet();
+
+        // tells the terrain to skip its color layers, and to morph
+        // tiles by the distance from the observer
+        _rttStateSet->setDefine("OE_IS_DEPTH_CAMERA");
+        _rttStateSet->addUniform(new osg::Uniform("oe_shadowToPrimaryMatrix", osg::Matrixf()));
+
+        _rttStateSet->setMode(
+            GL_BLEND,
+            osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+
+        _rttStateSet->setAttributeAndModes(
+            new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL),
+            osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+
+        // write the distance from the observer instead of a color,
+        // ignoring any shaders above (log depth buffer, etc.)
+        VirtualProgram* rttVP = VirtualProgram::getOrCreate(_rttStateSet.get());
+        rttVP->setName("Viewshed RTT");
+        rttVP->setInheritShaders(false);
+        Shaders pkg;
+        pkg.load(rttVP, pkg.ViewshedRTT);
+
+        _slots.resize(maxObservers);
+        for (unsigned i = 0; i < maxObservers; ++i)
+        {
+            for (unsigned f = 0; f < 6; ++f)
+            {
+                osg::Camera* rtt = new osg::Camera();
+                rtt->setReferenceFrame(osg::Camera::ABSOLUTE_RF);
+                rtt->setClearColor(osg::Vec4(NOTHING_IN_THE_WAY, NOTHING_IN_THE_WAY, NOTHING_IN_THE_WAY, NOTHING_IN_THE_WAY));
+                rtt->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                rtt->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+                rtt->setViewport(0, 0, size, size);
+                rtt->setRenderOrder(osg::Camera::PRE_RENDER);
+                rtt->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+                rtt->setImplicitBufferAttachmentMask(0, 0);
+                rtt->attach(osg::Camera::COLOR_BUFFER, maps, 0, i * 6 + f);
+                rtt->attach(osg::Camera::DEPTH_BUFFER, GL_DEPTH_COMPONENT24);
+                rtt->setStateSet(_rttStateSet.get());
+                rtt->addChild(engine->getNode());
+                rtt->addChild(_occluders.get());
+                GPUTimer::install(rtt, "viewshed");
+                _slots[i]._cameras[f] = rtt;
+            }
+        }
+
+        // per-frame transforms from the main camera's view to each observer
+        _matrixUniform = layerStateSet->getOrCreateUniform("oe_viewshed_matrix", osg::Uniform::FLOAT_MAT4, maxObservers);
+        _rangeUniform = layerStateSet->getOrCreateUniform("oe_viewshed_range", osg::Uniform::FLOAT, maxObservers);
+        _countUniform = layerStateSet->getOrCreateUniform("oe_viewshed_count", osg::Uniform::INT);
+        _countUniform->set(0);
+
+        _ready = true;
+    }
+
+    void
+    ViewshedNode::update()
+    {
+        osg::ref_ptr<Terrain> terrain;
+        if (!_terrain.lock(terrain))
+            return;
+
+        for (unsigned i = 0; i < _slots.size(); ++i)
+        {
+            ObserverSlot& slot = _slots[i];
+            ViewshedObserver* observer = i < _observers.size() ? _observers[i].get() : nullptr;
+
+            if (observer != slot._observer.get())
+            {
+                slot._observer = observer;
+                slot._revision = ~0u;
+                slot._valid = false;
+                slot._dirty = false;
+            }
+
+            if (observer == nullptr || observer->getRevision() == slot._revision)
+                continue;
+
+            GeoPoint position = observer->getPosition().transform(terrain->getSRS());
+            if (!position.isValid())
+                continue;
+
+            // a relative observer waits until the terrain under it exists
+            if (position.altitudeMode() == ALTMODE_RELATIVE && !position.makeAbsolute(terrain.get()))
+                continue;
+
+            osg::Matrixd localToWorld;
+            position.createLocalToWorld(localToWorld);
+            slot._worldToLocal.invert(localToWorld);
+            slot._world = localToWorld.getTrans();
+            slot._range = osg::maximum(observer->getRange().as(Units::METERS), 1.0);
+
+            // keep the near plane as far out as we can, for depth precision
+            double zNear = osg::clampBetween(slot._range * 0.001, 1.0, 100.0);
+
+            for (unsigned f = 0; f < 6; ++f)
+            {
+                osg::Camera* rtt = slot._cameras[f].get();
+                rtt->setViewMatrix(slot._worldToLocal * osg::Matrixd::lookAt(osg::Vec3d(0, 0, 0), s_faceDir[f], s_faceUp[f]));
+                rtt->setProjectionMatrixAsPerspective(90.0, 1.0, zNear, slot._range);
+            }
+
+            slot._revision = observer->getRevision();
+            slot._valid = true;
+            slot._dirty = true;
+        }
+    }
+
+    void
+    ViewshedNode::cull(osgUtil::CullVisitor* cv)
+    {
+        if (cv == nullptr)
+            return;
+
+        // main camera's view space to each observer's local frame.
+        // Doing this on the CPU prevents nasty precision issues.
+        osg::Matrixd inverseMV;
+        inverseMV.invert(*cv->getModelViewMatrix());
+
+        int count = 0;
+        for (unsigned i = 0; i < _slots.size(); ++i)
+        {
+            ObserverSlot& slot = _slots[i];
+            if (slot._valid)
+            {
+                _matrixUniform->setElement(i, osg::Matrixf(inverseMV * slot._worldToLocal));
+                _rangeUniform->setElement(i, (float)slot._range);
+                count = i + 1;
+            }
+            else
+            {
+                _rangeUniform->setElement(i, 0.0f);
+            }
+        }
+        _countUniform->set(count);
+
+        // render the maps of the observers that changed
+        for (auto& slot : _slots)
+        {
+            if (slot._valid && slot._dirty)
+            {
+                for (unsigned f = 0; f < 6; ++f)
+                {
+                    slot._cameras[f]->accept(*cv);
+                }
+                slot._dirty = false;
+            }
+        }
+    }
+}
+
+//........................................................................
+
+Config
+ViewshedLayer::Options::getMetadata()
+{
+    return Config::readJSON(OE_MULTILINE(
+        { "name" : "Viewshed",
+          "properties" : [
+            { "name": "max_observers", "description" : "Maximum number of observers rendered at once", "type" : "unsigned", "default" : "8" },
+            { "name": "texture_size", "description" : "Size of each face of an observer's distance cube", "type" : "unsigned", "default" : "512" },
+            { "name": "visible_color", "description" : "Color of terrain an observer can see", "type" : "color", "default" : "#00FF007F" },
+            { "name": "hidden_color", "description" : "Color of terrain in range that no observer can see", "type" : "color", "default" : "#FF00007F" },
+          ]
+        }
+    ));
+}
+
+Config
+ViewshedLayer::Options::getConfig() const
+{
+    Config conf = VisibleLayer::Options::getConfig();
+    conf.set("max_observers", maxObservers());
+    conf.set("texture_size", textureSize());
+    conf.set("visible_color", visibleColor());
+    conf.set("hidden_color", hiddenColor());
+    if (!observers().empty())
+    {
+        Config observersConf("observers");
+        for (auto& observer : observers())
+        {
+            observersConf.add("observer", observer->getConfig());
+        }
+        conf.add(observersConf);
+    }
+    return conf;
+}
+
+void
+ViewshedLayer::Options::fromConfig(const Config& conf)
+{
+    maxObservers().setDefault(8u);
+    textureSize().setDefault(512u);
+    visibleColor().setDefault(Color(0.0f, 1.0f, 0.0f, 0.5f));
+    hiddenColor().setDefault(Color(1.0f, 0.0f, 0.0f, 0.5f));
+    observers().clear();
+
+    conf.get("max_observers", maxObservers());
+    conf.get("texture_size", textureSize());
+    conf.get("visible_color", visibleColor());
+    conf.get("hidden_color", hiddenColor());
+    const ConfigSet observersConf = conf.child("observers").children();
+    for (ConfigSet::const_iterator i = observersConf.begin(); i != observersConf.end(); ++i)
+    {
+        observers().push_back(new ViewshedObserver(*i));
+    }
+}
+
+//........................................................................
+
+REGISTER_OSGEARTH_LAYER(viewshed, ViewshedLayer);
+
+OE_LAYER_PROPERTY_IMPL(ViewshedLayer, unsigned, MaxObservers, maxObservers);
+OE_LAYER_PROPERTY_IMPL(ViewshedLayer, unsigned, TextureSize, textureSize);
+
+void
+ViewshedLayer::setVisibleColor(const Color& value)
+{
+    options().visibleColor() = value;
+    _visibleColorUniform->set(value);
+}
+
+const Color&
+ViewshedLayer::getVisibleColor() const
+{
+    return options().visibleColor().get();
+}
+
+void
+ViewshedLayer::setHiddenColor(const Color& value)
+{
+    options().hiddenColor() = value;
+    _hiddenColorUniform->set(value);
+}
+
+const Color&
+ViewshedLayer::getHiddenColor() const
+{
+    return options().hiddenColor().get();
+}
+
+void
+ViewshedLayer::addObserver(ViewshedObserver* observer)
+{
+    if (observer)
+    {
+        static_cast<ViewshedNode*>(_node.get())->_observers.push_back(observer);
+    }
+}
+
+void
+ViewshedLayer::removeObserver(ViewshedObserver* observer)
+{
+    std::vector<osg::ref_ptr<ViewshedObserver> >& observers =
+        static_cast<ViewshedNode*>(_node.get())->_observers;
+
+    for (auto i = observers.begin(); i != observers.end(); ++i)
+    {
+        if (i->get() == observer)
+        {
+            observers.erase(i);
+            break;
+        }
+    }
+}
+
+void
+ViewshedLayer::setOccluders(osg::Node* node)
+{
+    osg::Group* occluders = static_cast<ViewshedNode*>(_node.get())->_occluders.get();
+    occluders->removeChildren(0, occluders->getNumChildren());
+    if (node)
+        occluders->addChild(node);
+    dirty();
+}
+
+osg::Node*
+ViewshedLayer::getOccluders() const
+{
+    osg::Group* occluders = static_cast<ViewshedNode*>(_node.get())->_occluders.get();
+    return occluders->getNumChildren() > 0 ? occluders->getChild(0) : nullptr;
+}
+
+void
+ViewshedLayer::dirty()
+{
+    static_cast<ViewshedNode*>(_node.get())->dirty();
+}
+
+void
+ViewshedLayer::init()
+{
+    VisibleLayer::init();
+
+    setRenderType(RENDERTYPE_TERRAIN_SURFACE);
+
+    // Never cache viewsheds
+    layerHints().cachePolicy() = CachePolicy::NO_CACHE;
+
+    _node = new ViewshedNode();
+
+    osg::StateSet* stateset = getOrCreateStateSet();
+    stateset->setDataVariance(stateset->DYNAMIC);
+
+    _visibleColorUniform = stateset->getOrCreateUniform("oe_viewshed_visibleColor", osg::Uniform::FLOAT_VEC4);
+    _visibleColorUniform->set(options().visibleColor().get());
+
+    _hiddenColorUniform = stateset->getOrCreateUniform("oe_viewshed_hiddenColor", osg::Uniform::FLOAT_VEC4);
+    _hiddenColorUniform->set(options().hiddenColor().get());
+
+    for (auto& observer : options().observers())
+    {
+        addObserver(observer.get());
+    }
+
+    // activate opacity support
+    installDefaultOpacityShader();
+}
+
+Status
+ViewshedLayer::openImplementation()
+{
+    if (!Registry::capabilities().supportsGLSL() ||
+        !Registry::capabilities().supportsTextureArrays())
+    {
+        return Status(Status::ResourceUnavailable, "ViewshedLayer requires GLSL and texture arrays");
+    }
+
+    return VisibleLayer::openImplementation();
+}
+
+void
+ViewshedLayer::prepareForRendering(TerrainEngine* engine)
+{
+    VisibleLayer::prepareForRendering(engine);
+
+    // already set up for this terrain
+    if (_distanceMaps.valid())
+        return;
+
+    if (!engine->getResources()->reserveTextureImageUnitForLayer(_reservation, this, "Viewshed"))
+    {
+        setStatus(Status::ResourceUnavailable, "No texture image units available");
+        return;
+    }
+
+    unsigned maxObservers = osg::maximum(options().maxObservers().get(), 1u);
+    unsigned size = osg::maximum(options().textureSize().get(), 16u);
+
+    // six faces of distance from the observer, in meters, per observer
+    _distanceMaps = new osg::Texture2DArray();
+    _distanceMaps->setTextureSize(size, size, maxObservers * 6);
+    _distanceMaps->setInternalFormat(GL_R32F);
+    _distanceMaps->setSourceFormat(GL_RED);
+    _distanceMaps->setSourceType(GL_FLOAT);
+    _distanceMaps->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    _distanceMaps->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    _distanceMaps->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _distanceMaps->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+
+    osg::StateSet* stateset = getOrCreateStateSet();
+    stateset->setTextureAttribute(_reservation.unit(), _distanceMaps.get(), osg::StateAttribute::ON);
+    stateset->addUniform(new osg::Uniform("oe_viewshed_map", _reservation.unit()));
+
+    VirtualProgram* vp = VirtualProgram::getOrCreate(stateset);
+    vp->setName("Viewshed");
+    Shaders pkg;
+    pkg.replace("$OE_VIEWSHED_MAX_OBSERVERS", Stringify() << maxObservers);
+    pkg.load(vp, pkg.Viewshed);
+
+    static_cast<ViewshedNode*>(_node.get())->setup(engine, _distanceMaps.get(), stateset, maxObservers, size);
+}
+
+osg::Node*
+ViewshedLayer::getNode() const
+{
+    return _node.get();
+}
+
+void
+ViewshedLayer::releaseGLObjects(osg::State* state) const
+{
+    VisibleLayer::releaseGLObjects(state);
+    if (_node.valid())
+        _node->releaseGLObjects(state);
+    if (_distanceMaps.valid())
+        _distanceMaps->releaseGLObjects(state);
+}
+
+void
+ViewshedLayer::resizeGLObjectBuffers(unsigned maxSize)
+{
+    VisibleLayer::resizeGLObjectBuffers(maxSize);
+    if (_node.valid())
+        _node->resizeGLObjectBuffers(maxSize);
+    if (_distanceMaps.valid())
+        _distanceMaps->resizeGLObjectBuffers(maxSize);
+}
@@ -117,13 +117,31 @@ namespace
 #undef  LC
 #define LC "[ProgramRepo] "
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
 ProgramRepo::ProgramRepo() :
-    Threading::Mutexed<osg::Referenced>("ProgramRepo(OE)"),
-    _releaseUnusedPrograms(true)
+    _releaseUnusedPrograms(true),
+    _binariesMutex("ProgramRepo Binaries(OE)"),
+    _asyncLinking(false),
+    _asyncMutex("ProgramRepo Async(OE)")
 {
+    for (unsigned i = 0; i < NUM_SHARDS; ++i)
+        _shards[i]._mutex.setName("ProgramRepo(OE)");
+
     const char* value = ::getenv("OSGEARTH_PROGRAM_BINARY_CACHE_PATH");
     if (value)
         setProgramBinaryCacheLocation(value);
+
+    if (::getenv("OSGEARTH_PROGRAM_ASYNC_LINK"))
+        setAsyncLinking(true);
 }
 
 ProgramRepo::~ProgramRepo()
@@ -134,41 +152,102 @@ ProgramRepo::~ProgramRepo()
 void
 ProgramRepo::setReleaseUnusedPrograms(bool value)
 {
-    lock();
     _releaseUnusedPrograms = value;
-    unlock();
 }
 
 void
 ProgramRepo::setProgramBinaryCacheLocation(const std::string& folder)
 {
-    lock();
     if (osgDB::makeDirectory(folder) == true)
     {
-        _programBinaryCacheFolder = folder;
+        {
+            Threading::ScopedMutexLock lock(_binariesMutex);
+            _programBinaryCacheFolder = folder;
+            _binaries.clear();
+        }
+        readProgramBinaries();
     }
     else
     {
         OE_WARN << LC << "Failed to access program binary cache location " << folder << std::endl;
     }
-    unlock();
+}
+
+void
+ProgramRepo::setAsyncLinking(bool value)
+{
+    _asyncLinking = value;
 }
 
 bool
 ProgramRepo::isProgramBinaryCachingActive() const
 {
+    Threading::ScopedMutexLock lock(_binariesMutex);
     return _programBinaryCacheFolder.empty() == false;
 }
 
+void
+ProgramRepo::readProgramBinaries()
+{
+    OE_PROFILING_ZONE;
+
+    std::string folder;
+    {
+        Threading::ScopedMutexLock lock(_binariesMutex);
+        folder = _programBinaryCacheFolder;
+    }
+
+    unsigned count = 0u;
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(folder);
+    for (osgDB::DirectoryContents::const_iterator i = contents.begin(); i != contents.end(); ++i)
+    {
+        if (osgDB::getLowerCaseFileExtension(*i) != "bin")
+            continue;
+
+        std::string path = osgDB::concatPaths(folder, *i);
+        std::ifstream fin(path.c_str(), std::ios::in | std::ios::binary);
+        if (!fin.is_open())
+            continue;
+
+        fin.seekg(0, fin.end);
+        int length = fin.tellg();
+        fin.seekg(0, fin.beg);
+        if (length <= (int)sizeof(GLenum))
+            continue;
+
+        GLenum format;
+        fin.read((char*)&format, sizeof(GLenum));
+        unsigned char* buffer = new unsigned char[length - sizeof(GLenum)];
+        fin.read((char*)buffer, length - sizeof(GLenum));
+
+        osg::ref_ptr<osg::Program::ProgramBinary> binary = new osg::Program::ProgramBinary();
+        binary->setFormat(format);
+        binary->assign(length - sizeof(GLenum), buffer);
+        delete [] buffer;
+
+        Threading::ScopedMutexLock lock(_binariesMutex);
+        _binaries[path] = binary.get();
+        ++count;
+    }
+
+    OE_INFO << LC << "Read " << count << " program binaries from " << folder << std::endl;
+}
+
 osg::ref_ptr<osg::Program>
 ProgramRepo::use(const ProgramKey& key, unsigned frameNumber, UID user)
 {
-    ProgramMap::iterator i = _db.find(key);
-    if (i != _db.end())
+    Shard& s = shard(key);
+    Threading::ScopedReadLock lock(s._mutex);
+
+    ProgramMap::iterator i = s._db.find(key);
+    if (i != s._db.end())
     {
         Entry* e = i->second.get();
         e->_frameLastUsed = frameNumber;
-        e->_users.insert(user);
+        {
+            Threading::ScopedMutexLock usersLock(e->_usersMutex);
+            e->_users.insert(user);
+        }
 
         //OE_TEST << LC << "PR USE prog=" << e->_program.get() << " user=" << (user) << " total=" << e->_users.size() << std::endl;
 
@@ -183,77 +262,95 @@ ProgramRepo::release(UID user, osg::State* state)
     if (user <= 0 || _releaseUnusedPrograms == false)
         return;
 
-    for (ProgramMap::iterator i = _db.begin(); i != _db.end(); )
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
     {
-        Entry* e = i->second.get();
-        bool increment = true;
+        Shard& sh = _shards[s];
+        Threading::ScopedWriteLock lock(sh._mutex);
 
-        if (e->_users.find(user) != e->_users.end())
+        for (ProgramMap::iterator i = sh._db.begin(); i != sh._db.end(); )
         {
-            // remove "user" from the users list:
-            e->_users.erase(user);
+            Entry* e = i->second.get();
+            bool unused;
+            {
+                // remove "user" from the users list:
+                Threading::ScopedMutexLock usersLock(e->_usersMutex);
+                e->_users.erase(user);
+                unused = e->_users.empty();
+            }
 
             //OE_TEST << LC << "PR REL prog=" << (e->_program.get()) << " user=" << (user) << " total=" << e->_users.size() << std::endl;
 
-            if (e->_users.empty())
+            // an entry shared by several keys is empty for all of them
+            // once its last user is gone
+            if (unused)
             {
                 // release the GL memory
                 e->_program->releaseGLObjects(state);
 
-                OE_TEST << LC << "Released program " << e->_program->getName() << "; dbsize=" << _db.size() - 1 << std::endl;
+                OE_TEST << LC << "Released program " << e->_program->getName() << std::endl;
 
                 // remove from the repo
-                _db.erase(i++);
-                increment = false;
+                i = sh._db.erase(i);
+            }
+            else
+            {
+                ++i;
             }
         }
-
-        if (increment)
-            ++i;
     }
 }
 
 void
 ProgramRepo::add(const ProgramKey& key, osg::ref_ptr<osg::Program>& in_out, unsigned frameNumber, UID user)
 {
-    // First try to find an entry with an equivalent program:
-    for (ProgramMap::iterator i = _db.begin(); i != _db.end(); ++i)
+    // First try to find an entry with an equivalent program.
+    // Another thread may have added one since our lookup.
+    osg::ref_ptr<Entry> shared;
+    for (unsigned s = 0; s < NUM_SHARDS && !shared.valid(); ++s)
     {
-        osg::ref_ptr<Entry>& e = i->second;
-
-        // same pointer? do nothing but update the user
-        if (e->_program.get() == in_out.get())
+        Threading::ScopedReadLock lock(_shards[s]._mutex);
+        for (ProgramMap::iterator i = _shards[s]._db.begin(); i != _shards[s]._db.end(); ++i)
         {
-            osg::ref_ptr<Entry>& newEntry = _db[key];
-            newEntry = e.get();
-            in_out = e->_program.get();
-            e->_users.insert(user);
+            osg::ref_ptr<Entry>& e = i->second;
 
-            OE_TEST << LC << "PR SHR1 prog=" << e->_program.get() << " user=" << (user) << " total=" << e->_users.size() << std::endl;
-
-            return;
+            // same pointer, or different pointer but equivalent?
+            // replace input with output and let input go out of scope
+            if (e->_program.get() == in_out.get() ||
+                e->_program->compare(*in_out.get()) == 0)
+            {
+                shared = e.get();
+                break;
+            }
         }
+    }
 
-        // different pointer but equivalent? replace input with output
-        // and let input go out of scope
-        else if (e->_program->compare(*in_out.get()) == 0)
-        {
-            osg::ref_ptr<Entry>& newEntry = _db[key];
-            newEntry = e.get();
-            in_out = e->_program.get();
-            e->_users.insert(user);
-
-            OE_TEST << LC << "PR SHR2 prog=" << e->_program.get() << " user=" << (user) << " total=" << e->_users.size() << std::endl;
+    Shard& s = shard(key);
+    Threading::ScopedWriteLock lock(s._mutex);
 
-            return;
-        }
+    osg::ref_ptr<Entry>& newEntry = s._db[key];
+    if (newEntry.valid())
+    {
+        // lost a race with another thread building the same program
+        shared = newEntry.get();
     }
 
-    osg::ref_ptr<Entry>& newEntry = _db[key];
-    newEntry = new Entry();
-    newEntry->_program = in_out.get();
-    newEntry->_frameLastUsed = frameNumber;
-    newEntry->_users.insert(user);
+    if (shared.valid())
+    {
+        newEntry = shared.get();
+        in_out = shared->_program.get();
+
+        Threading::ScopedMutexLock usersLock(shared->_usersMutex);
+        shared->_users.insert(user);
+
+        OE_TEST << LC << "PR SHR prog=" << shared->_program.get() << " user=" << (user) << " total=" << shared->_users.size() << std::endl;
+    }
+    else
+    {
+        newEntry = new Entry();
+        newEntry->_program = in_out.get();
+        newEntry->_frameLastUsed = frameNumber;
+        newEntry->_users.insert(user);
+    }
 }
 
 void
@@ -265,24 +362,65 @@ ProgramRepo::prune(unsigned frameNumber, osg::State* state)
 void
 ProgramRepo::resizeGLObjectBuffers(unsigned maxSize)
 {
-    for (ProgramMap::iterator i = _db.begin(); i != _db.end(); ++i)
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
     {
-        i->second->_program->resizeGLObjectBuffers(maxSize);
+        Threading::ScopedReadLock lock(_shards[s]._mutex);
+        for (ProgramMap::iterator i = _shards[s]._db.begin(); i != _shards[s]._db.end(); ++i)
+        {
+            i->second->_program->resizeGLObjectBuffers(maxSize);
+        }
     }
 }
 
 void
 ProgramRepo::releaseGLObjects(osg::State* state) const
 {
-    OE_TEST << LC << "Main release, size=" << _db.size() << std::endl;
-    // First try to find an entry with an equivalent program:
-    for (ProgramMap::iterator i = _db.begin(); i != _db.end(); ++i)
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
+    {
+        Threading::ScopedWriteLock lock(_shards[s]._mutex);
+        OE_TEST << LC << "Main release, size=" << _shards[s]._db.size() << std::endl;
+        for (ProgramMap::iterator i = _shards[s]._db.begin(); i != _shards[s]._db.end(); ++i)
+        {
+            osg::ref_ptr<Entry>& e = i->second;
+            e->_program->releaseGLObjects(state);
+            OE_TEST << LC << "...released program " << e->_program->getName() << std::endl;
+        }
+        _shards[s]._db.clear();
+    }
+}
+
+std::string
+ProgramRepo::getProgramBinaryCacheName(
+    const ProgramKey& key,
+    osg::Program* program,
+    osg::Program::PerContextProgram* pcp,
+    osg::State& state) const
+{
+    // hash the program metadata
+    std::stringstream programCacheNameStream;
+    programCacheNameStream << program->getName();
+    unsigned int hash = 0;
+    for (int i = 0; i < key.size(); i++)
     {
-        osg::ref_ptr<Entry>& e = i->second;
-        e->_program->releaseGLObjects(state);
-        OE_TEST << LC << "...released program " << e->_program->getName() << std::endl;
+        //same as boost hash_combine
+        hash ^= key[i] + 0x9e3779b9 + (hash << 6) + (hash >> 2);
     }
-    _db.clear();
+    programCacheNameStream << "_" << hash;
+
+#if OSG_VERSION_LESS_THAN(3,7,0)
+    const std::string& defineStr = state.getDefineString(program->getShaderDefines());
+#else
+    const std::string& defineStr = pcp->getDefineString();
+#endif
+
+    unsigned defineHash = osgEarth::hashString(defineStr);
+    programCacheNameStream << "_" << defineHash;
+    programCacheNameStream << ".bin";
+
+    Threading::ScopedMutexLock lock(_binariesMutex);
+    return osgDB::concatPaths(
+        _programBinaryCacheFolder, 
+        osgEarth::toLegalFileName(programCacheNameStream.str(), false, "-"));
 }
 
 void
@@ -290,121 +428,329 @@ ProgramRepo::linkProgram(
     const ProgramKey& key, 
     osg::Program* program, 
     osg::Program::PerContextProgram* pcp, 
-    osg::State& state)
+    osg::State& state,
+    osg::Program::ProgramBinary* linked)
 {
     OE_PROFILING_ZONE_NAMED("link");
 
-    if (isProgramBinaryCachingActive())
+    bool caching = isProgramBinaryCachingActive();
+    bool readFromCache = false;
+    std::string programCacheName;
+    osg::ref_ptr<osg::Program::ProgramBinary> binary = linked;
+
+    if (caching)
     {
-        bool readFromCache = false;
-        std::fstream fStream;
-        std::string programCacheName;
+        programCacheName = getProgramBinaryCacheName(key, program, pcp, state);
 
-        // hash the program metadata
-        std::stringstream programCacheNameStream;
-        programCacheNameStream << program->getName();
-        unsigned int hash = 0;
-        for (int i = 0; i < key.size(); i++)
+        if (!binary.valid())
         {
-            //same as boost hash_combine
-            hash ^= key[i] + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            // binaries in the cache folder were all read at startup
+            Threading::ScopedMutexLock lock(_binariesMutex);
+            BinaryMap::const_iterator i = _binaries.find(programCacheName);
+            if (i != _binaries.end())
+            {
+                binary = i->second.get();
+                readFromCache = true;
+            }
         }
-        programCacheNameStream << "_" << hash;
+    }
 
-#if OSG_VERSION_LESS_THAN(3,7,0)
-        const std::string& defineStr = state.getDefineString(program->getShaderDefines());
-#else
-        const std::string& defineStr = pcp->getDefineString();
-#endif
+    if (binary.valid())
+    {
+        OE_PROFILING_ZONE_NAMED("LoadShaderProgramBinary");
+        OE_PROFILING_ZONE_TEXT(programCacheName);
+        program->setProgramBinary(binary.get());
+        OE_DEBUG << LC << "Using a program binary (" << programCacheName << ")" << std::endl;
+    }
+    else if (caching)
+    {
+        OE_PROFILING_ZONE_NAMED("LoadShaderNotFound");
+        OE_PROFILING_ZONE_TEXT(programCacheName);
 
-        unsigned defineHash = osgEarth::hashString(defineStr);
-        programCacheNameStream << "_" << defineHash;
-        programCacheNameStream << ".bin";
+        //If there is not a programBinary then we need to add one
+        // This sets an openGL hint so we can grab it later.
+        program->setProgramBinary(new osg::Program::ProgramBinary());
+    }
 
-        programCacheName = osgDB::concatPaths(
-            _programBinaryCacheFolder, 
-            osgEarth::toLegalFileName(programCacheNameStream.str(), false, "-"));
+    program->compileGLObjects(state);
 
-        //currently set to be able to read and write to the binary file so only need to open file once.
-        fStream.open(programCacheName.c_str(), std::fstream::in | std::fstream::out | std::fstream::app | std::fstream::binary);
-        if (fStream.is_open())
+    if (binary.valid() && !pcp->isLinked())
+    {
+        // stale binary (new driver?) so forget it and link from source
+        OE_INFO << LC << "Discarding a program binary that failed to link (" << programCacheName << ")" << std::endl;
+        if (readFromCache)
         {
-            // get length of file:
-            fStream.seekg(0, fStream.end);
-            int length = fStream.tellg();
-            fStream.seekg(0, fStream.beg);
-
-            if (length > 1)
             {
-                OE_PROFILING_ZONE_NAMED("LoadShaderProgramBinary");
-                OE_PROFILING_ZONE_TEXT(programCacheName);
-                unsigned char* buffer = new unsigned char[length];
-
-                // read data as a block:
-                GLenum format;
-                fStream.read((char*)&format, sizeof(GLenum));
-                fStream.read((char*)buffer, length - sizeof(GLenum));
-
-                osg::Program::ProgramBinary* binary = new osg::Program::ProgramBinary();
-                binary->setFormat(format);
-                binary->assign(length - sizeof(GLenum), buffer);
-                program->setProgramBinary(binary);
-                readFromCache = true;
-                OE_DEBUG << LC << "Read a program binary from the cache (" << programCacheName << ")" << std::endl;
-            }
-            else
-            {
-                OE_PROFILING_ZONE_NAMED("LoadShaderNotFound");
-                OE_PROFILING_ZONE_TEXT(programCacheName);
-            }
-
-            //If there is not a programBinary then we need to add one
-            // This sets an openGL hint so we can grab it later.
-            if (program->getProgramBinary() == NULL)
-            {
-                program->setProgramBinary(new osg::Program::ProgramBinary());
+                Threading::ScopedMutexLock lock(_binariesMutex);
+                _binaries.erase(programCacheName);
             }
+            remove(programCacheName.c_str());
         }
 
+        binary = NULL;
+        readFromCache = false;
+        program->setProgramBinary(caching ? new osg::Program::ProgramBinary() : NULL);
+        pcp->requestLink();
         program->compileGLObjects(state);
+    }
 
-        if (fStream.is_open())
+    if (caching)
+    {
+        if (pcp->isLinked())
         {
-            if (pcp->isLinked())
+            if (!readFromCache)
             {
-                if (!readFromCache)
+                if (!binary.valid())
+                    binary = pcp->compileProgramBinary(state);
+
+                if (binary.valid() && binary->getSize() > 0)
                 {
-                    osg::ref_ptr<osg::Program::ProgramBinary> binary = pcp->compileProgramBinary(state);
-                    if (binary && binary->getSize() > 0)
+                    OE_PROFILING_ZONE_NAMED("SaveShaderProgramBinary");
+                    std::ofstream fStream(programCacheName.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+                    if (fStream.is_open())
                     {
-                        OE_PROFILING_ZONE_NAMED("SaveShaderProgramBinary");
                         GLenum format = binary->getFormat();
                         fStream.write((char*)&format, sizeof(GLenum));
                         fStream.write((char*)binary->getData(), binary->getSize());
                         fStream.close();
-                        OE_DEBUG << LC << "Wrote a shader binary from the cache (" << programCacheName << ")" << std::endl;
-                    }
-                    else
-                    {
-                        //Should we save off something so we know it is a bad shader instead of just deleting the empty cache file?
-                        fStream.close();
-                        OE_WARN << LC << "Failed to compile program binary (" << programCacheName << ")" << std::endl;
-                        remove(programCacheName.c_str());
+                        OE_DEBUG << LC << "Wrote a shader binary to the cache (" << programCacheName << ")" << std::endl;
                     }
+
+                    Threading::ScopedMutexLock lock(_binariesMutex);
+                    _binaries[programCacheName] = binary.get();
+                }
+                else
+                {
+                    OE_WARN << LC << "Failed to compile program binary (" << programCacheName << ")" << std::endl;
                 }
             }
+        }
+        else
+        {
+            OE_WARN << LC << "Failed to link program binary (" << programCacheName << ")" << std::endl;
+        }
+    }
+}
+
+bool
+ProgramRepo::isParallelCompileSupported(osg::State& state)
+{
+    typedef void (GL_APIENTRY * MaxShaderCompilerThreadsProc)(GLuint);
+
+    unsigned contextID = state.getContextID();
+
+    Threading::ScopedMutexLock lock(_asyncMutex);
+
+    if (_parallelCompile.size() <= contextID)
+        _parallelCompile.resize(contextID + 1, -1);
+
+    if (_parallelCompile[contextID] < 0)
+    {
+        bool khr = osg::isGLExtensionSupported(contextID, "GL_KHR_parallel_shader_compile");
+        bool arb = !khr && osg::isGLExtensionSupported(contextID, "GL_ARB_parallel_shader_compile");
+
+        const osg::GLExtensions* ext = osg::GLExtensions::Get(contextID, true);
+        bool supported =
+            (khr || arb) &&
+            ext->glGetProgramBinary != NULL &&
+            ext->glProgramParameteri != NULL;
+
+        if (supported)
+        {
+            // let the driver use as many threads as it likes
+            MaxShaderCompilerThreadsProc maxThreads = NULL;
+            osg::setGLExtensionFuncPtr(maxThreads, khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+            if (maxThreads)
+                maxThreads(0xFFFFFFFFu);
+
+            OE_INFO << LC << "Linking programs in the background on context " << contextID << std::endl;
+        }
+
+        _parallelCompile[contextID] = supported ? 1 : 0;
+    }
+
+    return _parallelCompile[contextID] == 1;
+}
+
+namespace
+{
+    // Shader source as osg::Shader would hand it to the driver
+    std::string getContextShaderSource(const osg::Shader* shader, osg::State& state)
+    {
+        std::string source = shader->getShaderSource();
+
+        if (shader->getType() == osg::Shader::VERTEX &&
+            (state.getUseVertexAttributeAliasing() || state.getUseModelViewAndProjectionUniforms()))
+        {
+            state.convertVertexShaderSourceToOsgBuiltIns(source);
+        }
+
+        std::string defines = state.getDefineString(shader->getShaderDefines());
+        if (!defines.empty())
+        {
+            // defines go right after the #version line
+            std::string::size_type pos = source.find("#version");
+            if (pos == std::string::npos)
+            {
+                source.insert(0, defines);
+            }
             else
             {
-                OE_WARN << LC << "Failed to link program binary (" << programCacheName << ")" << std::endl;
-                fStream.close();
-                remove(programCacheName.c_str());
+                std::string::size_type eol = source.find('\n', pos);
+                if (eol == std::string::npos)
+                    source.append("\n" + defines);
+                else
+                    source.insert(eol + 1, defines);
             }
         }
+
+        return source;
     }
-    else
+}
+
+bool
+ProgramRepo::startAsyncLink(osg::Program* program, osg::State& state, AsyncLink& link)
+{
+    if (!isParallelCompileSupported(state))
+        return false;
+
+    // transform feedback and precompiled shaders are left to OSG
+    if (program->getNumTransformFeedBackVaryings() > 0u)
+        return false;
+
+    for (unsigned s = 0; s < program->getNumShaders(); ++s)
     {
-        program->compileGLObjects(state);
+        if (program->getShader(s)->getShaderSource().empty())
+            return false;
     }
+
+    const osg::GLExtensions* ext = osg::GLExtensions::Get(state.getContextID(), true);
+
+    link._program = program;
+    link._handle = ext->glCreateProgram();
+
+    // none of these calls wait on the driver
+    for (unsigned s = 0; s < program->getNumShaders(); ++s)
+    {
+        const osg::Shader* shader = program->getShader(s);
+        std::string source = getContextShaderSource(shader, state);
+        const GLchar* text = source.c_str();
+
+        GLuint handle = ext->glCreateShader((GLenum)shader->getType());
+        ext->glShaderSource(handle, 1, &text, NULL);
+        ext->glCompileShader(handle);
+        ext->glAttachShader(link._handle, handle);
+        link._shaders.push_back(handle);
+    }
+
+    // same bindings OSG makes before it links, so the binary matches
+    const osg::Program::AttribBindingList& programBindings = program->getAttribBindingList();
+    for (osg::Program::AttribBindingList::const_iterator i = programBindings.begin(); i != programBindings.end(); ++i)
+        ext->glBindAttribLocation(link._handle, i->second, reinterpret_cast<const GLchar*>(i->first.c_str()));
+
+    const osg::Program::AttribBindingList& stateBindings = state.getAttributeBindingList();
+    for (osg::Program::AttribBindingList::const_iterator i = stateBindings.begin(); i != stateBindings.end(); ++i)
+        ext->glBindAttribLocation(link._handle, i->second, reinterpret_cast<const GLchar*>(i->first.c_str()));
+
+    const osg::Program::FragDataBindingList& fragBindings = program->getFragDataBindingList();
+    for (osg::Program::FragDataBindingList::const_iterator i = fragBindings.begin(); i != fragBindings.end(); ++i)
+        ext->glBindFragDataLocation(link._handle, i->second, reinterpret_cast<const GLchar*>(i->first.c_str()));
+
+    ext->glProgramParameteri(link._handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    ext->glLinkProgram(link._handle);
+
+    return true;
+}
+
+bool
+ProgramRepo::linkProgramAsync(
+    const ProgramKey& key,
+    osg::Program* program,
+    osg::Program::PerContextProgram* pcp,
+    osg::State& state)
+{
+#if OSG_VERSION_GREATER_OR_EQUAL(3,5,8) && OSG_VERSION_LESS_THAN(3,7,0)
+    std::pair<const osg::Program*, unsigned> id(program, state.getContextID());
+
+    AsyncLink link;
+    bool pending = false;
+    {
+        Threading::ScopedMutexLock lock(_asyncMutex);
+        AsyncLinkMap::const_iterator i = _asyncLinks.find(id);
+        if (i != _asyncLinks.end())
+        {
+            link = i->second;
+            pending = true;
+        }
+    }
+
+    if (!pending)
+    {
+        // a cached binary links quickly enough on its own
+        bool cached = false;
+        if (isProgramBinaryCachingActive())
+        {
+            std::string name = getProgramBinaryCacheName(key, program, pcp, state);
+            Threading::ScopedMutexLock lock(_binariesMutex);
+            cached = _binaries.find(name) != _binaries.end();
+        }
+
+        if (cached || !startAsyncLink(program, state, link))
+        {
+            linkProgram(key, program, pcp, state);
+            return true;
+        }
+
+        Threading::ScopedMutexLock lock(_asyncMutex);
+        _asyncLinks[id] = link;
+        return false;
+    }
+
+    const osg::GLExtensions* ext = osg::GLExtensions::Get(state.getContextID(), true);
+
+    GLint done = GL_FALSE;
+    ext->glGetProgramiv(link._handle, GL_COMPLETION_STATUS_KHR, &done);
+    if (done == GL_FALSE)
+        return false;
+
+    {
+        Threading::ScopedMutexLock lock(_asyncMutex);
+        _asyncLinks.erase(id);
+    }
+
+    osg::ref_ptr<osg::Program::ProgramBinary> binary;
+
+    GLint linked = GL_FALSE;
+    ext->glGetProgramiv(link._handle, GL_LINK_STATUS, &linked);
+    if (linked == GL_TRUE)
+    {
+        GLint length = 0;
+        ext->glGetProgramiv(link._handle, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0)
+        {
+            GLenum format = 0;
+            binary = new osg::Program::ProgramBinary();
+            binary->allocate(length);
+            ext->glGetProgramBinary(link._handle, length, NULL, &format, reinterpret_cast<GLvoid*>(binary->getData()));
+            binary->setFormat(format);
+        }
+    }
+
+    for (unsigned s = 0; s < link._shaders.size(); ++s)
+    {
+        ext->glDetachShader(link._handle, link._shaders[s]);
+        ext->glDeleteShader(link._shaders[s]);
+    }
+    ext->glDeleteProgram(link._handle);
+
+    // Load the result into the real program. Without a binary (a failed
+    // link, say) this links from source so OSG reports the errors.
+    linkProgram(key, program, pcp, state, binary.get());
+    return true;
+#else
+    linkProgram(key, program, pcp, state);
+    return true;
+#endif
 }
 
 //------------------------------------------------------------------------
@@ -951,6 +1297,12 @@ VirtualProgram::setProgramBinaryCacheLocation(const std::string& folder)
     Registry::programRepo().setProgramBinaryCacheLocation(folder);
 }
 
+void
+VirtualProgram::setAsyncLinking(bool value)
+{
+    Registry::programRepo().setAsyncLinking(value);
+}
+
 //------------------------------------------------------------------------
 
 VirtualProgram::VirtualProgram(unsigned mask) :
@@ -995,6 +1347,8 @@ VirtualProgram::VirtualProgram(unsigned mask) :
     _lastUsedProgram.resize(MAX_CONTEXTS);
 #endif
 
+    _lastGoodProgram.resize(MAX_CONTEXTS);
+
 #ifdef PREALLOCATE_APPLY_VARS
     _apply.resize(MAX_CONTEXTS);
 #endif
@@ -1034,6 +1388,8 @@ VirtualProgram::VirtualProgram(const VirtualProgram& rhs, const osg::CopyOp& cop
     _lastUsedProgram.resize(MAX_CONTEXTS);
 #endif
 
+    _lastGoodProgram.resize(MAX_CONTEXTS);
+
 #ifdef PREALLOCATE_APPLY_VARS
     _apply.resize(MAX_CONTEXTS);
 #endif
@@ -1049,9 +1405,7 @@ VirtualProgram::~VirtualProgram()
 #ifdef USE_PROGRAM_REPO
     if (Registry::instance())
     {
-        Registry::programRepo().lock();
         Registry::programRepo().release(_id, 0L);
-        Registry::programRepo().unlock();
     }
 #endif
 
@@ -1153,9 +1507,7 @@ void
 VirtualProgram::resizeGLObjectBuffers(unsigned maxSize)
 {
 #ifdef USE_PROGRAM_REPO
-    Registry::programRepo().lock();
     Registry::programRepo().resizeGLObjectBuffers(maxSize);
-    Registry::programRepo().unlock();
 #endif
 
     // Resize shaders in the PolyShader
@@ -1177,9 +1529,7 @@ VirtualProgram::releaseGLObjects(osg::State* state) const
     OE_TEST << LC << "VP::RGLO (" << _id << ") " << getName() << " (" << (_lastUsedProgram[0].get()) << ") state=" << (uintptr_t)state << std::endl;
 
 #ifdef USE_PROGRAM_REPO
-    Registry::programRepo().lock();
     Registry::programRepo().release(_id, state);
-    Registry::programRepo().unlock();
 #endif
 
 #ifdef USE_LAST_USED_PROGRAM
@@ -1424,9 +1774,7 @@ VirtualProgram::setInheritShaders(bool value)
 #ifdef USE_PROGRAM_REPO
         // clear the program cache please
         {
-            Registry::programRepo().lock();
             Registry::programRepo().release(_id, 0L);
-            Registry::programRepo().unlock();
         }
 #endif
 
@@ -1595,8 +1943,7 @@ VirtualProgram::apply(osg::State& state) const
         unsigned frameNumber = state.getFrameStamp() ? state.getFrameStamp()->getFrameNumber() : 0;
 
 #ifdef USE_PROGRAM_REPO
-        // LOCK the program repo to look up the program.
-        Registry::programRepo().lock();
+        // look up the program; the repo locks internally.
 
         program = Registry::programRepo().use(local.programKey, frameNumber, _id);
 #endif
@@ -1659,7 +2006,6 @@ VirtualProgram::apply(osg::State& state) const
             Registry::programRepo().prune(frameNumber, &state);
 #endif
         }
-        Registry::programRepo().unlock();
         key = local.programKey;
     }
 
@@ -1683,6 +2029,7 @@ VirtualProgram::apply(osg::State& state) const
         pcp = program->getPCP(state);
 
         bool useProgram = state.getLastAppliedProgramObject() != pcp;
+        bool usingFallback = false;
 
 #ifdef DEBUG_APPLY_COUNTS
         if (state.getFrameStamp() && state.getFrameStamp()->getFrameNumber() % 60 == 0)
@@ -1720,7 +2067,29 @@ VirtualProgram::apply(osg::State& state) const
 
             if (pcp->needsLink())
             {
-                Registry::programRepo().linkProgram(key, program.get(), pcp, state);
+                // With async linking, keep drawing with the last good program
+                // until the new one is ready. No fallback? Link it right now.
+                osg::ref_ptr<osg::Program> fallback;
+                osg::Program::PerContextProgram* fallbackPCP = 0L;
+
+                if (Registry::programRepo().isAsyncLinkingActive() &&
+                    _lastGoodProgram[contextID].lock(fallback) &&
+                    fallback.get() != program.get())
+                {
+                    fallbackPCP = fallback->getPCP(state);
+                    if (fallbackPCP->needsLink() || !fallbackPCP->isLinked())
+                        fallbackPCP = 0L;
+                }
+
+                if (fallbackPCP == 0L)
+                {
+                    Registry::programRepo().linkProgram(key, program.get(), pcp, state);
+                }
+                else if (Registry::programRepo().linkProgramAsync(key, program.get(), pcp, state) == false)
+                {
+                    usingFallback = true;
+                    pcp = fallbackPCP;
+                }
             }
 
             if (pcp->isLinked())
@@ -1730,6 +2099,9 @@ VirtualProgram::apply(osg::State& state) const
 
                 pcp->useProgram();
                 state.setLastAppliedProgramObject(pcp);
+
+                if (!usingFallback)
+                    _lastGoodProgram[contextID] = program.get();
             }
             else
             {
@@ -25,6 +25,7 @@
 
 #include <osgEarth/Filter>
 #include <osgEarth/OgrUtils>
+#include <osgEarth/GeoJSON>
 
 #include <osg/Notify>
 #include <osgDB/FileNameUtils>
@@ -514,20 +515,49 @@ WFSFeatureSource::createFeatureCursorImplementation(const Query& query, Progress
     OE_DEBUG << LC << url << std::endl;
     URI uri(url, options().url()->context());
 
-    // read the data:
-    ReadResult r = uri.readString(getReadOptions(), progress);
-
-    const std::string& buffer = r.getString();
-    const Config&      meta = r.metadata();
-
     bool dataOK = false;
 
     FeatureList features;
-    if (!buffer.empty())
+
+    std::string outputFormat = osgEarth::toLower(options().outputFormat().getOrUse("geojson"));
+    if (outputFormat == "geojson" || outputFormat == "json" || isJSON(outputFormat))
+    {
+        // GeoJSON is parsed while the response downloads
+        ReadResult r = GeoJSON::readFeatures(
+            uri,
+            getFeatureProfile(),
+            options().rewindPolygons().get(),
+            features,
+            getReadOptions(),
+            progress);
+
+        dataOK = (r.code() == ReadResult::RESULT_OK);
+        if (!dataOK && r.code() != ReadResult::RESULT_NOT_FOUND)
+        {
+            OE_WARN << LC << "Error reading WFS response: " << r.errorDetail() << std::endl;
+        }
+
+        for (FeatureList::iterator i = features.begin(); i != features.end(); )
+        {
+            if (isBlacklisted(i->get()->getFID()))
+                i = features.erase(i);
+            else
+                ++i;
+        }
+    }
+    else
     {
-        // Get the mime-type from the metadata record if possible
-        const std::string& mimeType = r.metadata().value(IOMetadata::CONTENT_TYPE);
-        dataOK = getFeatures(buffer, mimeType, features);
+        // read the data:
+        ReadResult r = uri.readString(getReadOptions(), progress);
+
+        const std::string& buffer = r.getString();
+
+        if (!buffer.empty())
+        {
+            // Get the mime-type from the metadata record if possible
+            const std::string& mimeType = r.metadata().value(IOMetadata::CONTENT_TYPE);
+            dataOK = getFeatures(buffer, mimeType, features);
+        }
     }
 
     if (dataOK)
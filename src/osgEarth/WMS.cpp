@@ -21,10 +21,13 @@
 #include <osgEarth/Registry>
 #include <osgEarth/StringUtils>
 #include <osgEarth/Registry>
+#include <osgEarth/DateTime>
+#include <osgEarth/Threading>
 #include <osg/ImageSequence>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <locale>
+#include <cctype>
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
@@ -32,6 +35,11 @@ using namespace osgEarth::Util;
 #undef LC
 #define LC "[WMS] "
 
+#define WMS_ARENA_NAME "oe.wms"
+
+// most time slices one "begin/end/period" entry expands to
+#define MAX_TIMES_PER_INTERVAL 2048u
+
 //........................................................................
 
 WMS::Style::Style()
@@ -360,7 +368,8 @@ WMS::WMSImageLayerOptions::getMetadata()
             { "name": "srs", "description", "SRS name to request", "type": "string", "default": "" },
             { "name": "crs", "description", "CRS name to request", "type": "string", "default": "" },
             { "name": "transparent", "description", "Whether to set the transparent flag in WMS requests", "type": "boolean", "default": "false" },
-            { "name": "times", "description", "List of timestamps for WMS-T", "type": "string", "default": "" },
+            { "name": "times", "description", "List of timestamps or begin/end/period intervals for WMS-T", "type": "string", "default": "" },
+            { "name": "frame_cache_size", "description", "Number of WMS-T time slices to keep in memory", "type": "unsigned", "default": "512" },
           ]
         }
     ) );
@@ -382,6 +391,7 @@ WMS::WMSImageLayerOptions::getConfig() const
     conf.set("transparent", _transparent);
     conf.set("times", _times);
     conf.set("seconds_per_frame", _secondsPerFrame);
+    conf.set("frame_cache_size", _frameCacheSize);
     return conf;
 }
 
@@ -391,6 +401,7 @@ WMS::WMSImageLayerOptions::fromConfig(const Config& conf)
     _wmsVersion.init("1.1.1");
     _transparent.init(true);
     _secondsPerFrame.init(1.0);
+    _frameCacheSize.init(512u);
 
     conf.get("url", _url);
     conf.get("capabilities_url", _capabilitiesUrl);
@@ -405,6 +416,7 @@ WMS::WMSImageLayerOptions::fromConfig(const Config& conf)
     conf.get("times", _times);
     conf.get("time", _times); // alternative
     conf.get("seconds_per_frame", _secondsPerFrame);
+    conf.get("frame_cache_size", _frameCacheSize);
 }
 
 //........................................................................
@@ -422,6 +434,80 @@ namespace osgEarth {  namespace WMS
             osg::ImageSequence::update( nv );
         }
     };
+
+    // Length of an ISO 8601 duration like "PT15M" or "P1DT12H", in hours;
+    // zero if it isn't one. Years and months have no fixed length, so
+    // they are not supported.
+    double parsePeriodHours(const std::string& input)
+    {
+        if (input.size() < 3 || (input[0] != 'P' && input[0] != 'p'))
+            return 0.0;
+
+        double hours = 0.0;
+        bool inTime = false;
+        std::string number;
+        for (unsigned i = 1; i < input.size(); ++i)
+        {
+            char c = ::toupper(input[i]);
+            if (c == 'T') { inTime = true; continue; }
+            if (::isdigit(c) || c == '.') { number.push_back(c); continue; }
+            if (number.empty()) return 0.0;
+
+            double value = as<double>(number, 0.0);
+            number.clear();
+
+            if (c == 'W' && !inTime) hours += value * 24.0 * 7.0;
+            else if (c == 'D' && !inTime) hours += value * 24.0;
+            else if (c == 'H' && inTime) hours += value;
+            else if (c == 'M' && inTime) hours += value / 60.0;
+            else if (c == 'S' && inTime) hours += value / 3600.0;
+            else return 0.0;
+        }
+        return number.empty() ? hours : 0.0;
+    }
+
+    // Adds the time slices of one entry of the "times" option: either a
+    // single timestamp, or a WMS-T interval "begin/end/period"
+    void expandTimes(const std::string& entry, std::vector<std::string>& out)
+    {
+        StringVector parts;
+        StringTokenizer(entry, parts, "/", "", false, true);
+        if (parts.size() == 3)
+        {
+            DateTime begin(parts[0]);
+            DateTime end(parts[1]);
+            double period = parsePeriodHours(parts[2]);
+
+            if (period > 0.0 && end.asTimeStamp() >= begin.asTimeStamp())
+            {
+                unsigned count = 0u;
+                for (DateTime t = begin;
+                    t.asTimeStamp() <= end.asTimeStamp() && count < MAX_TIMES_PER_INTERVAL;
+                    t = t + period, ++count)
+                {
+                    out.push_back(t.asISO8601());
+                }
+                return;
+            }
+
+            OE_WARN << LC << "WMS-T: ignoring bad time interval \"" << entry << "\"" << std::endl;
+            return;
+        }
+
+        out.push_back(entry);
+    }
+
+    // Time slice requests mostly wait on the network,
+    // so use a few more threads than there are cores.
+    JobArena* getFrameArena()
+    {
+        static JobArena* arena = []()
+        {
+            JobArena::setConcurrency(WMS_ARENA_NAME, std::max(4u, 2u * Threading::getConcurrency()));
+            return JobArena::get(WMS_ARENA_NAME);
+        }();
+        return arena;
+    }
 } } // namespace osgEarth::WMS
 
 //........................................................................
@@ -429,7 +515,8 @@ namespace osgEarth {  namespace WMS
 //! Construct the WMS driver
 WMS::Driver::Driver(const WMS::WMSImageLayerOptions& myOptions,
                     SequenceControl* sequence,
-                    const osgDB::Options* readOptions)
+                    const osgDB::Options* readOptions) :
+    _frameCache(true, osg::maximum(myOptions.frameCacheSize().get(), 1u))
 {
     _sequence = sequence;
     _options = &myOptions;
@@ -449,7 +536,11 @@ WMS::Driver::open(osg::ref_ptr<const Profile>& profile,
 {
     if (options().times().isSet())
     {
-        StringTokenizer(options().times().get(), _timesVec, ",", "", false, true);
+        StringVector entries;
+        StringTokenizer(options().times().get(), entries, ",", "", false, true);
+        for (unsigned i = 0; i < entries.size(); ++i)
+            WMS::expandTimes(entries[i], _timesVec);
+
         OE_INFO << LC << "WMS-T: found " << _timesVec.size() << " times." << std::endl;
 
         for (unsigned i = 0; i < _timesVec.size(); ++i)
@@ -611,6 +702,21 @@ WMS::Driver::open(osg::ref_ptr<const Profile>& profile,
 }
 
 //! fetch a tile image from the WMS service and report any exceptions.
+namespace
+{
+    void reportServiceException(const std::string& layerName, const std::string& uri, const ReadResult& response)
+    {
+        if (response.errorDetail().empty() == false)
+        {
+            Config conf;
+            conf.fromXML(std::istringstream(response.errorDetail()));
+            const Config* serviceEx = conf.find("serviceexception");
+            std::string msg = serviceEx ? serviceEx->value() : response.errorDetail();
+            OE_WARN << LC << layerName << ": Service Exception: " << msg << " (URI=" << uri << ")" << std::endl;
+        }
+    }
+}
+
 osg::Image*
 WMS::Driver::fetchTileImage(const TileKey&     key,
                             const std::string& extraAttrs,
@@ -619,12 +725,7 @@ WMS::Driver::fetchTileImage(const TileKey&     key,
 {
     osg::ref_ptr<osg::Image> image;
 
-    std::string uri = createURI(key);
-    if (!extraAttrs.empty())
-    {
-        std::string delim = uri.find('?') == std::string::npos ? "?" : "&";
-        uri = uri + delim + extraAttrs;
-    }
+    std::string uri = createURI(key, extraAttrs);
 
     // Try to get the image first
     out_response = URI(uri, options().url()->context()).readImage(_readOptions.get(), progress);
@@ -633,18 +734,47 @@ WMS::Driver::fetchTileImage(const TileKey&     key,
     {
         image = out_response.getImage();
     }
-    else if (out_response.errorDetail().empty() == false)
+    else
     {
-        Config conf;
-        conf.fromXML(std::istringstream(out_response.errorDetail()));
-        const Config* serviceEx = conf.find("serviceexception");
-        std::string msg = serviceEx ? serviceEx->value() : out_response.errorDetail();
-        OE_WARN << LC << _options->name().get() << ": Service Exception: " << msg << " (URI=" << uri << ")" << std::endl;
+        reportServiceException(_options->name().get(), uri, out_response);
     }
 
     return image.release();
 }
 
+bool
+WMS::Driver::createImageAsync(const TileKey& key,
+                              ProgressCallback* progress,
+                              const std::function<void(osg::Image*)>& callback) const
+{
+    // sequences need one request per frame; leave those to createImage.
+    if (_timesVec.size() > 1)
+        return false;
+
+    std::string extras;
+    if (_timesVec.size() == 1)
+        extras = std::string("TIME=") + _timesVec[0];
+
+    std::string uri = createURI(key, extras);
+    std::string layerName = _options->name().get();
+
+    URI(uri, options().url()->context()).readImageAsync(_readOptions.get(), progress,
+        [uri, layerName, callback](const ReadResult& response)
+        {
+            if (response.succeeded())
+            {
+                callback(response.getImage());
+            }
+            else
+            {
+                reportServiceException(layerName, uri, response);
+                callback(nullptr);
+            }
+        });
+
+    return true;
+}
+
 //! Queries the WMS service for an image and returns an osg::Image
 //! containing the result, or NULL if one could not be found
 osg::Image*
@@ -681,18 +811,42 @@ WMS::Driver::createImageSequence(const TileKey& key, ProgressCallback* progress)
     if (_sequence->isSequencePlaying())
         seq->play();
 
+    // Request all the time slices at once instead of one after the
+    // other, so an animated tile arrives in about the time of one request.
+    JobArena* arena = WMS::getFrameArena();
+    osg::ref_ptr<const Driver> driver(this);
+    osg::ref_ptr<ProgressCallback> progress_ref(progress);
+
+    std::vector<Future<osg::ref_ptr<osg::Image>>> frames;
+    frames.reserve(_timesVec.size());
+
     for (unsigned int r = 0; r < _timesVec.size(); ++r)
     {
-        std::string extraAttrs = std::string("TIME=") + _timesVec[r];
+        std::string time = _timesVec[r];
+        frames.push_back(Job(arena).dispatch<osg::ref_ptr<osg::Image>>(
+            [driver, key, time, progress_ref](Cancelable* c)
+            {
+                osg::ref_ptr<osg::Image> image;
+                if (!c->isCanceled())
+                    image = driver->fetchFrame(key, time, progress_ref.get());
+                return image;
+            }));
+    }
 
-        ReadResult response;
-        osg::ref_ptr<osg::Image> image = fetchTileImage(key, extraAttrs, progress, response);
-        if (image.get())
+    for (unsigned int r = 0; r < frames.size(); ++r)
+    {
+        osg::ref_ptr<osg::Image> image = frames[r].get(progress);
+        if (image.valid())
         {
-            seq->addImage(image);
+            seq->addImage(image.get());
         }
     }
 
+    if (progress && progress->isCanceled())
+    {
+        return nullptr;
+    }
+
     // Just return an empty image if we didn't get any images
     unsigned size = seq->getNumImageData();
 
@@ -704,6 +858,28 @@ WMS::Driver::createImageSequence(const TileKey& key, ProgressCallback* progress)
     return seq.release();
 }
 
+//! Fetches one time slice of a tile, from the frame cache if possible.
+//! Neighboring LODs, and the same tile after it pages out and in again,
+//! reuse slices without going back to the server.
+osg::ref_ptr<osg::Image>
+WMS::Driver::fetchFrame(const TileKey& key, const std::string& time, ProgressCallback* progress) const
+{
+    std::string extraAttrs = std::string("TIME=") + time;
+    std::string uri = createURI(key, extraAttrs);
+
+    Util::LRUCache<std::string, osg::ref_ptr<osg::Image> >::Record record;
+    if (_frameCache.get(uri, record))
+        return record.value();
+
+    ReadResult response;
+    osg::ref_ptr<osg::Image> image = fetchTileImage(key, extraAttrs, progress, response);
+
+    if (image.valid() && options().frameCacheSize().get() > 0u)
+        _frameCache.insert(uri, image);
+
+    return image;
+}
+
 //! Generates a URI for a tile key using the WMS request prototype
 std::string
 WMS::Driver::createURI(const TileKey& key) const
@@ -725,6 +901,18 @@ WMS::Driver::createURI(const TileKey& key) const
     return uri;
 }
 
+std::string
+WMS::Driver::createURI(const TileKey& key, const std::string& extraAttrs) const
+{
+    std::string uri = createURI(key);
+    if (!extraAttrs.empty())
+    {
+        std::string delim = uri.find('?') == std::string::npos ? "?" : "&";
+        uri = uri + delim + extraAttrs;
+    }
+    return uri;
+}
+
 const WMS::WMSImageLayerOptions&
 WMS::Driver::options() const
 {
@@ -782,6 +970,10 @@ WMSImageLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     WMS::Driver* driver = new WMS::Driver(options(), this, getReadOptions());
     _driver = driver;
 
@@ -814,6 +1006,22 @@ WMSImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
     return GeoImage(image.get(), key.getExtent());
 }
 
+bool
+WMSImageLayer::createImageImplementationAsync(const TileKey& key,
+                                              const std::function<void(const GeoImage&)>& onComplete,
+                                              ProgressCallback* progress) const
+{
+    if (!_driver.valid())
+        return false;
+
+    WMS::Driver* driver = static_cast<WMS::Driver*>(_driver.get());
+    return driver->createImageAsync(key, progress,
+        [key, onComplete](osg::Image* image)
+        {
+            onComplete(GeoImage(image, key.getExtent()));
+        });
+}
+
 /** Whether the implementation supports these methods */
 bool
 WMSImageLayer::supportsSequenceControl() const
@@ -1,7 +1,7 @@
 #version 430
 
-// local work matrix
-layout(local_size_x=1, local_size_y=1, local_size_z=1) in;
+// local work matrix; must match WIND_GROUP_* in WindLayer.cpp
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
 
 // output image binding
 layout(binding=0, rgba8) uniform image3D oe_wind_tex;
@@ -32,11 +32,14 @@ uniform mat4 oe_wind_texToViewMatrix;
 
 void main()
 {
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    ivec3 size = imageSize(oe_wind_tex);
+
     // coords is texture space:
     vec4 pixelNDC = vec4(
-        float(gl_WorkGroupID.x) / float(gl_NumWorkGroups.x-1),
-        float(gl_WorkGroupID.y) / float(gl_NumWorkGroups.y-1),
-        float(gl_WorkGroupID.z) / float(gl_NumWorkGroups.z-1),
+        float(texel.x) / float(size.x-1),
+        float(texel.y) / float(size.y-1),
+        float(texel.z) / float(size.z-1),
         1);
 
     vec3 totalDirection = vec3(0);
@@ -81,5 +84,5 @@ void main()
     //vec2 uv = vec2(float(pixelCoords.x)/63.0, float(pixelCoords.y)/63.0);
     //pixel.rg = uv;
 
-    imageStore(oe_wind_tex, ivec3(gl_WorkGroupID), pixel);
+    imageStore(oe_wind_tex, texel, pixel);
 }
@@ -45,6 +45,11 @@ REGISTER_OSGEARTH_LAYER(wind, WindLayer);
 #define WIND_DIM_Y 8
 #define WIND_DIM_Z 16
 
+// compute shader work group size; must match WindLayer.CS.glsl
+#define WIND_GROUP_X 8
+#define WIND_GROUP_Y 8
+#define WIND_GROUP_Z 1
+
 //........................................................................
 
 namespace 
@@ -73,8 +78,13 @@ namespace
     // Data stored per-camera
     struct CameraState
     {
-        WindData* _windData;
-        unsigned _numWindsAllocated;
+        // wind records in camera view space, plus a terminator
+        std::vector<WindData> _windData;
+        osg::Matrixf _texToView;
+
+        // changes whenever the wind texture needs computing again
+        unsigned _revision;
+        mutable osg::buffered_value<unsigned> _computedRevision;
 
         osg::ref_ptr<osg::StateSet> _computeStateSet;
         osg::ref_ptr<osg::Uniform> _viewToTexMatrix;
@@ -83,16 +93,19 @@ namespace
         osg::ref_ptr<osg::Uniform> _texToViewMatrix;
 
         CameraState() :
-            _windData(nullptr),
-            _numWindsAllocated(0) { }
+            _revision(1u) { }
 
         ~CameraState() {
-            if (_windData)
-                delete[] _windData;
             releaseGLObjects(nullptr);
         }
 
         void releaseGLObjects(osg::State* state) const {
+            // the texture goes away with the GL objects, so compute it again
+            if (state)
+                _computedRevision[state->getContextID()] = 0u;
+            else
+                _computedRevision.clear();
+
             if (_computeStateSet.valid())
                 _computeStateSet->releaseGLObjects(state);
             if (_sharedStateSet.valid())
@@ -146,8 +159,9 @@ namespace
         WindDrawable(const osgDB::Options* readOptions);
 
         void setupPerCameraState(const osg::Camera* camera);
-        void compileGLObjects(osg::RenderInfo& ri, DrawState& ds) const;
+        void compileGLObjects(osg::RenderInfo& ri, DrawState& ds, const CameraState& cs) const;
         void updateBuffers(CameraState&, const osg::Camera*);
+        void updateTexToView(CameraState&, const osg::Matrixf&);
 
         void drawImplementation(osg::RenderInfo& ri) const override;
         void releaseGLObjects(osg::State* state) const override;
@@ -243,21 +257,25 @@ namespace
         cs._sharedStateSet->setDefine("OE_WIND_TEX", "oe_wind_tex");
     }
 
-    void WindDrawable::compileGLObjects(osg::RenderInfo& ri, DrawState& ds) const
+    void WindDrawable::compileGLObjects(osg::RenderInfo& ri, DrawState& ds, const CameraState& cs) const
     {
         osg::State* state = ri.getState();
         if (state)
         {
             osg::GLExtensions* ext = state->get<osg::GLExtensions>();
 
-            CameraState& cs = _cameraState.get(ri.getCurrentCamera());
-
-            GLuint requiredBufferSize = sizeof(WindData) * (_winds.size()+1);
+            GLuint requiredBufferSize = sizeof(WindData) * cs._windData.size();
 
+            // One buffer serves every camera on this context. Grow it in
+            // powers of two so adding winds rarely reallocates it.
             if (!ds._buffer.valid() || ds._bufferSize < requiredBufferSize)
             {
+                GLuint bufferSize = sizeof(WindData) * 8u;
+                while (bufferSize < requiredBufferSize)
+                    bufferSize *= 2u;
+
                 ds._buffer = new GLBuffer(GL_SHADER_STORAGE_BUFFER, *state, "oe.wind");
-                ds._bufferSize = requiredBufferSize;
+                ds._bufferSize = bufferSize;
 
                 ds._buffer->bind();
 
@@ -269,24 +287,16 @@ namespace
                 ds._buffer->bind();
             }
 
-            // download to GPU
-            ext->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, ds._bufferSize, cs._windData);
+            // download to GPU; only the records in use
+            ext->glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, requiredBufferSize, cs._windData.data());
         }
     }
 
     void WindDrawable::updateBuffers(CameraState& cs, const osg::Camera* camera)
     {
-        if (cs._numWindsAllocated < _winds.size()+1)
-        {
-            if (cs._windData != nullptr)
-                delete [] cs._windData;
-
-            // add one for the terminator.
-            cs._windData = new WindData[_winds.size()+1];
-            ::memset(cs._windData, 0, sizeof(WindData)*(_winds.size()+1));
-
-            cs._numWindsAllocated = _winds.size()+1;
-        }
+        // add one for the terminator.
+        std::vector<WindData> windData(_winds.size()+1);
+        ::memset(windData.data(), 0, sizeof(WindData)*windData.size());
 
         size_t i;
         for(i=0; i<_winds.size(); ++i)
@@ -298,10 +308,10 @@ namespace
                 // transform from world to camera-view space
                 osg::Vec3d posView =  wind->getPointWorld() * camera->getViewMatrix();
 
-                cs._windData[i].position[0] = posView.x();
-                cs._windData[i].position[1] = posView.y();
-                cs._windData[i].position[2] = posView.z();
-                cs._windData[i].position[3] = 1.0;
+                windData[i].position[0] = posView.x();
+                windData[i].position[1] = posView.y();
+                windData[i].position[2] = posView.z();
+                windData[i].position[3] = 1.0;
             }
             else // TYPE_DIRECTIONAL
             {
@@ -312,17 +322,36 @@ namespace
                 dir = osg::Matrixf::transform3x3(dir, camera->getViewMatrix());
                 dir.normalize();
 
-                cs._windData[i].direction[0] = dir.x();
-                cs._windData[i].direction[1] = dir.y();
-                cs._windData[i].direction[2] = dir.z();
-                cs._windData[i].position[3] = 0.0f;
+                windData[i].direction[0] = dir.x();
+                windData[i].direction[1] = dir.y();
+                windData[i].direction[2] = dir.z();
+                windData[i].position[3] = 0.0f;
             }
 
-            cs._windData[i].speed = wind->speed()->as(Units::KNOTS);
+            windData[i].speed = wind->speed()->as(Units::KNOTS);
         }
 
         // terminator record: set power to negative.
-        cs._windData[i].speed = -1.0f;
+        windData[i].speed = -1.0f;
+
+        // Only compute the texture again when something changed, i.e. the
+        // camera moved or a wind did; a still camera costs nothing.
+        if (windData.size() != cs._windData.size() ||
+            ::memcmp(windData.data(), cs._windData.data(), sizeof(WindData)*windData.size()) != 0)
+        {
+            cs._windData.swap(windData);
+            ++cs._revision;
+        }
+    }
+
+    void WindDrawable::updateTexToView(CameraState& cs, const osg::Matrixf& texToView)
+    {
+        if (texToView != cs._texToView)
+        {
+            cs._texToView = texToView;
+            cs._texToViewMatrix->set(texToView);
+            ++cs._revision;
+        }
     }
 
     void WindDrawable::releaseGLObjects(osg::State* state) const
@@ -362,17 +391,29 @@ namespace
         if (ri.getCurrentCamera() == nullptr)
             return;
 
-        DrawState& ds = _ds[ri.getState()->getContextID()];
+        unsigned contextID = ri.getState()->getContextID();
+        DrawState& ds = _ds[contextID];
         osg::GLExtensions* ext = ri.getState()->get<osg::GLExtensions>();
 
+        const CameraState& cs = _cameraState.get(ri.getCurrentCamera());
+
+        // texture is still current for this camera?
+        if (cs._windData.empty() || cs._computedRevision[contextID] == cs._revision)
+            return;
+
         // update buffer with wind data
-        compileGLObjects(ri, ds);
+        compileGLObjects(ri, ds, cs);
 
         // activate layout() binding point:
         ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ds._buffer->name());
 
-        // run it
-        ext->glDispatchCompute(WIND_DIM_X, WIND_DIM_Y, WIND_DIM_Z);
+        // run it, one invocation per texel
+        ext->glDispatchCompute(
+            WIND_DIM_X / WIND_GROUP_X,
+            WIND_DIM_Y / WIND_GROUP_Y,
+            WIND_DIM_Z / WIND_GROUP_Z);
+
+        cs._computedRevision[contextID] = cs._revision;
 
         // sync the output
         ext->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
@@ -604,7 +645,7 @@ WindLayer::getSharedStateSet(osg::NodeVisitor* nv) const
     // texture to view (for the compute shader):
     osg::Matrix textureToCamView;
     textureToCamView.invert(camViewToTexture);
-    cs._texToViewMatrix->set(textureToCamView);
+    windDrawable->updateTexToView(cs, textureToCamView);
 
     windDrawable->updateBuffers(cs, camera);
 
@@ -0,0 +1,336 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include <osgEarth/WriteBehindCacheBin>
+
+using namespace osgEarth;
+
+#define LC "[WriteBehindCacheBin] "
+
+// Most records to hand the bin in one writeBatch() call
+#define MAX_BATCH_SIZE 64u
+
+WriteBehindCacheBin::WriteBehindCacheBin(CacheBin* bin, unsigned maxQueueSize) :
+    CacheBin(bin->getID()),
+    _bin(bin),
+    _maxQueueSize(osg::maximum(maxQueueSize, 1u)),
+    _mutex("WriteBehindCacheBin(OE)"),
+    _done(false)
+{
+    setHashKeys(bin->getHashKeys());
+}
+
+WriteBehindCacheBin::~WriteBehindCacheBin()
+{
+    {
+        // the thread commits everything still queued before it exits
+        Threading::ScopedMutexLock lock(_mutex);
+        _done = true;
+        _queued.notify_all();
+    }
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+void
+WriteBehindCacheBin::run()
+{
+    Threading::setThreadName("oe.cache.writebehind");
+
+    for (;;)
+    {
+        {
+            std::unique_lock<Threading::Mutex> lock(_mutex);
+
+            _queued.wait(lock, [this]() { return _done || !_queue.empty(); });
+
+            if (_queue.empty() && _done)
+                break;
+
+            while (!_queue.empty() && _batch.size() < MAX_BATCH_SIZE)
+            {
+                _index.erase(_queue.front()._key);
+                _batch.emplace_back(std::move(_queue.front()));
+                _queue.pop_front();
+            }
+
+            // room in the queue for blocked writers
+            _committed.notify_all();
+        }
+
+        // Only this thread changes the batch, and only under the lock,
+        // so readers can keep looking at it while it's being written.
+        unsigned count = _bin->writeBatch(_batch);
+        if (count < _batch.size())
+        {
+            OE_DEBUG << LC << getID() << ": " << (_batch.size() - count) << " of " << _batch.size() << " writes failed" << std::endl;
+        }
+
+        {
+            Threading::ScopedMutexLock lock(_mutex);
+            _batch.clear();
+            _committed.notify_all();
+        }
+    }
+}
+
+const CacheBin::WriteRecord*
+WriteBehindCacheBin::findQueued(const std::string& key) const
+{
+    // call with _mutex locked
+    auto i = _index.find(key);
+    if (i != _index.end())
+        return &(*i->second);
+
+    // the batch on its way to the bin; newest record last
+    for (auto r = _batch.rbegin(); r != _batch.rend(); ++r)
+    {
+        if (r->_key == key)
+            return &(*r);
+    }
+    return nullptr;
+}
+
+bool
+WriteBehindCacheBin::findQueued(const std::string& key, WriteRecord& output) const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    const WriteRecord* record = findQueued(key);
+    if (record)
+        output = *record;
+    return record != nullptr;
+}
+
+void
+WriteBehindCacheBin::flush()
+{
+    std::unique_lock<Threading::Mutex> lock(_mutex);
+    _committed.wait(lock, [this]() { return _queue.empty() && _batch.empty(); });
+}
+
+unsigned
+WriteBehindCacheBin::getQueueSize() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _queue.size() + _batch.size();
+}
+
+ReadResult
+WriteBehindCacheBin::readObject(const std::string& key, const osgDB::Options* dbo)
+{
+    WriteRecord record;
+    if (findQueued(key, record))
+        return ReadResult(const_cast<osg::Object*>(record._object.get()), record._metadata);
+
+    return _bin->readObject(key, dbo);
+}
+
+ReadResult
+WriteBehindCacheBin::readImage(const std::string& key, const osgDB::Options* dbo)
+{
+    WriteRecord record;
+    if (findQueued(key, record))
+        return ReadResult(const_cast<osg::Object*>(record._object.get()), record._metadata);
+
+    return _bin->readImage(key, dbo);
+}
+
+ReadResult
+WriteBehindCacheBin::readString(const std::string& key, const osgDB::Options* dbo)
+{
+    WriteRecord record;
+    if (findQueued(key, record))
+        return ReadResult(const_cast<osg::Object*>(record._object.get()), record._metadata);
+
+    return _bin->readString(key, dbo);
+}
+
+bool
+WriteBehindCacheBin::enqueue(WriteRecord& record)
+{
+    std::unique_lock<Threading::Mutex> lock(_mutex);
+
+    // coalesce with a record that hasn't been committed yet
+    auto i = _index.find(record._key);
+    if (i != _index.end())
+    {
+        i->second->_object = record._object;
+        i->second->_metadata = record._metadata;
+        i->second->_dbo = record._dbo;
+        return true;
+    }
+
+    _committed.wait(lock, [this]() { return _queue.size() < _maxQueueSize; });
+
+    if (!_thread.joinable())
+    {
+        _thread = std::thread([this]() { run(); });
+    }
+
+    std::string key = record._key;
+    _queue.emplace_back(std::move(record));
+    _index[key] = std::prev(_queue.end());
+
+    _queued.notify_one();
+    return true;
+}
+
+bool
+WriteBehindCacheBin::write(
+    const std::string&    key,
+    const osg::Object*    object,
+    const Config&         metadata,
+    const osgDB::Options* dbo)
+{
+    if (!object)
+        return false;
+
+    WriteRecord record;
+    record._key = key;
+    record._object = object;
+    record._metadata = metadata;
+    record._dbo = dbo;
+    return enqueue(record);
+}
+
+bool
+WriteBehindCacheBin::write(
+    const TileRecordKey&  key,
+    const osg::Object*    object,
+    const Config&         metadata,
+    const osgDB::Options* dbo)
+{
+    if (!object)
+        return false;
+
+    // queued under the binary key, which can't collide with a string key
+    WriteRecord record;
+    record._key = key.bytes();
+    record._tileKey = key;
+    record._isTileRecord = true;
+    record._object = object;
+    record._metadata = metadata;
+    record._dbo = dbo;
+    return enqueue(record);
+}
+
+ReadResult
+WriteBehindCacheBin::readObject(const TileRecordKey& key, const osgDB::Options* dbo)
+{
+    WriteRecord record;
+    if (findQueued(key.bytes(), record))
+        return ReadResult(const_cast<osg::Object*>(record._object.get()), record._metadata);
+
+    return _bin->readObject(key, dbo);
+}
+
+ReadResult
+WriteBehindCacheBin::readImage(const TileRecordKey& key, const osgDB::Options* dbo)
+{
+    WriteRecord record;
+    if (findQueued(key.bytes(), record))
+        return ReadResult(const_cast<osg::Object*>(record._object.get()), record._metadata);
+
+    return _bin->readImage(key, dbo);
+}
+
+CacheBin::RecordStatus
+WriteBehindCacheBin::getRecordStatus(const TileRecordKey& key)
+{
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (findQueued(key.bytes()))
+            return STATUS_OK;
+    }
+    return _bin->getRecordStatus(key);
+}
+
+CacheBin::RecordStatus
+WriteBehindCacheBin::getRecordStatus(const std::string& key)
+{
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (findQueued(key))
+            return STATUS_OK;
+    }
+    return _bin->getRecordStatus(key);
+}
+
+bool
+WriteBehindCacheBin::remove(const std::string& key)
+{
+    bool inBatch;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        auto i = _index.find(key);
+        if (i != _index.end())
+        {
+            _queue.erase(i->second);
+            _index.erase(i);
+            _committed.notify_all();
+        }
+        inBatch = (findQueued(key) != nullptr);
+    }
+
+    // don't let a batch in progress bring the record back
+    if (inBatch)
+        flush();
+
+    return _bin->remove(key);
+}
+
+bool
+WriteBehindCacheBin::touch(const std::string& key)
+{
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (findQueued(key))
+            return true;
+    }
+    return _bin->touch(key);
+}
+
+bool
+WriteBehindCacheBin::clear()
+{
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        _queue.clear();
+        _index.clear();
+        _committed.notify_all();
+    }
+
+    // a batch may still be on its way to the bin
+    flush();
+    return _bin->clear();
+}
+
+bool
+WriteBehindCacheBin::compact()
+{
+    flush();
+    return _bin->compact();
+}
+
+unsigned
+WriteBehindCacheBin::getStorageSize()
+{
+    return _bin->getStorageSize();
+}
@@ -65,12 +65,10 @@ XYZ::Driver::open(const URI& uri,
     return STATUS_OK;
 }
 
-osgEarth::ReadResult
-XYZ::Driver::read(const URI& uri,
-                  const TileKey& key, 
-                  bool invertY,
-                  ProgressCallback* progress,
-                  const osgDB::Options* readOptions) const
+osgEarth::URI
+XYZ::Driver::createURI(const URI& uri,
+                       const TileKey& key,
+                       bool invertY) const
 {
     unsigned x, y;
     key.getTileXY(x, y);
@@ -114,7 +112,28 @@ XYZ::Driver::read(const URI& uri,
         myUri.setCacheKey(Cache::makeCacheKey(location, "uri"));
     }
 
-    return myUri.getImage(readOptions, progress);
+    return myUri;
+}
+
+ReadResult
+XYZ::Driver::read(const URI& uri,
+                  const TileKey& key, 
+                  bool invertY,
+                  ProgressCallback* progress,
+                  const osgDB::Options* readOptions) const
+{
+    return createURI(uri, key, invertY).getImage(readOptions, progress);
+}
+
+void
+XYZ::Driver::readAsync(const URI& uri,
+                       const TileKey& key,
+                       bool invertY,
+                       ProgressCallback* progress,
+                       const osgDB::Options* readOptions,
+                       const HTTPClient::ReadCallback& callback) const
+{
+    createURI(uri, key, invertY).readImageAsync(readOptions, progress, callback);
 }
 
 //........................................................................
@@ -211,6 +230,10 @@ XYZImageLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     osg::ref_ptr<const Profile> profile = getProfile();
 
     Status status = _driver.open(
@@ -244,7 +267,33 @@ XYZImageLayer::createImageImplementation(const TileKey& key, ProgressCallback* p
     if (r.succeeded())
         return GeoImage(r.releaseImage(), key.getExtent());
     else
-        return GeoImage(Status(r.errorDetail()));
+        return GeoImage(Status(
+            r.code() == ReadResult::RESULT_NOT_FOUND ? Status::ResourceUnavailable : Status::GeneralError,
+            r.errorDetail()));
+}
+
+bool
+XYZImageLayer::createImageImplementationAsync(const TileKey& key,
+                                              const std::function<void(const GeoImage&)>& onComplete,
+                                              ProgressCallback* progress) const
+{
+    _driver.readAsync(
+        options().url().get(),
+        key,
+        options().invertY() == true,
+        progress,
+        getReadOptions(),
+        [key, onComplete](const ReadResult& r)
+        {
+            if (r.succeeded())
+                onComplete(GeoImage(r.getImage(), key.getExtent()));
+            else
+                onComplete(GeoImage(Status(
+                    r.code() == ReadResult::RESULT_NOT_FOUND ? Status::ResourceUnavailable : Status::GeneralError,
+                    r.errorDetail())));
+        });
+
+    return true;
 }
 
 //........................................................................
@@ -269,6 +318,10 @@ XYZElevationLayer::openImplementation()
     if (parent.isError())
         return parent;
 
+    // Profile and extents came from the cache; the source is not needed.
+    if (isOpenedFromCache())
+        return Status::NoError;
+
     // Create an image layer under the hood. TMS fetch is the same for image and
     // elevation; we just convert the resulting image to a heightfield
     _imageLayer = new XYZImageLayer(options());
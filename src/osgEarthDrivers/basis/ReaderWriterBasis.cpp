@@ -35,6 +35,9 @@ public:
     ReaderWriterBasis()
     {
         supportsExtension("basis", "Basis image format");
+#if BASISD_SUPPORT_KTX2
+        supportsExtension("ktx2", "KTX2 image format (Basis Universal)");
+#endif
 
         // one-time initialization at startup
         basist::basisu_transcoder_init();
@@ -53,14 +56,27 @@ public:
         return readImage(file, options);
     }
 
-    virtual ReadResult readImage(std::istream& fin, const osgDB::ReaderWriter::Options* = NULL) const
+    virtual ReadResult readImage(std::istream& fin, const osgDB::ReaderWriter::Options* options = NULL) const
     {
         // get length of file:
         fin.seekg(0, fin.end);
         int length = fin.tellg();
         fin.seekg(0, fin.beg);
-        char* data = new char[length];
-        fin.read(data, length);
+        std::vector<char> buffer(length);
+        fin.read(buffer.data(), length);
+        const char* data = buffer.data();
+
+        // Images are flipped to OSG's bottom-up convention unless the
+        // caller (e.g. glTF, which samples top-down) says otherwise
+        bool flip = !options || options->getOptionString().find("basisNoFlip") == std::string::npos;
+
+#if BASISD_SUPPORT_KTX2
+        static const unsigned char ktx2Magic[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+        if (length >= 12 && memcmp(data, ktx2Magic, 12) == 0)
+        {
+            return readKTX2(data, length, flip);
+        }
+#endif
 
         basist::basisu_transcoder transcoder(&sel_codebook);
 
@@ -146,13 +162,90 @@ public:
                 image->setMipmapLevels(mipmapDataOffsets);
             }
 
-            image->flipVertical();
+            if (flip)
+            {
+                image->flipVertical();
+            }
             return image;
         }
 
         return ReadResult::ERROR_IN_READING_FILE;
     }
 
+#if BASISD_SUPPORT_KTX2
+    //! Transcodes a KTX2 (Basis Universal supercompressed) image, with all
+    //! its mipmaps, to BC1 or BC3 for direct upload.
+    ReadResult readKTX2(const char* data, int length, bool flip) const
+    {
+        basist::ktx2_transcoder transcoder(const_cast<basist::etc1_global_selector_codebook*>(&sel_codebook));
+
+        if (!transcoder.init(data, length) || !transcoder.start_transcoding())
+        {
+            return ReadResult::ERROR_IN_READING_FILE;
+        }
+
+        basist::transcoder_texture_format transcoder_texture_format = basist::transcoder_texture_format::cTFBC1;
+        GLenum internalTextureFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        GLenum pixelFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+        if (transcoder.get_has_alpha())
+        {
+            transcoder_texture_format = basist::transcoder_texture_format::cTFBC3;
+            internalTextureFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            pixelFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        }
+
+        unsigned int bytesPerBlock = basist::basis_get_bytes_per_block(transcoder_texture_format);
+        unsigned int numLevels = transcoder.get_levels();
+
+        unsigned int totalSize = 0;
+        std::vector< unsigned int > mipmapDataOffsets;
+        std::vector< basist::ktx2_image_level_info > levels(numLevels);
+
+        for (unsigned int levelIndex = 0; levelIndex < numLevels; levelIndex++)
+        {
+            if (!transcoder.get_image_level_info(levels[levelIndex], levelIndex, 0, 0))
+            {
+                return ReadResult::ERROR_IN_READING_FILE;
+            }
+
+            if (levelIndex > 0)
+            {
+                mipmapDataOffsets.push_back(totalSize);
+            }
+
+            totalSize += bytesPerBlock * levels[levelIndex].m_total_blocks;
+        }
+
+        unsigned char* decoded = new unsigned char[totalSize];
+        memset(decoded, 0, totalSize);
+
+        for (unsigned int levelIndex = 0; levelIndex < numLevels; levelIndex++)
+        {
+            unsigned int offset = levelIndex > 0 ? mipmapDataOffsets[levelIndex - 1] : 0;
+
+            if (!transcoder.transcode_image_level(levelIndex, 0, 0, &decoded[offset], levels[levelIndex].m_total_blocks, transcoder_texture_format, 0))
+            {
+                delete[] decoded;
+                return ReadResult::ERROR_IN_READING_FILE;
+            }
+        }
+
+        osg::Image* image = new osg::Image;
+        image->setImage(transcoder.get_width(), transcoder.get_height(), 1, internalTextureFormat, pixelFormat, GL_UNSIGNED_BYTE, decoded, osg::Image::USE_NEW_DELETE);
+        if (!mipmapDataOffsets.empty())
+        {
+            image->setMipmapLevels(mipmapDataOffsets);
+        }
+
+        if (flip)
+        {
+            image->flipVertical();
+        }
+        return image;
+    }
+#endif
+
     virtual ReadResult readImage(const std::string& file, const osgDB::ReaderWriter::Options* options) const
     {
         std::string ext = osgDB::getLowerCaseFileExtension(file);
@@ -477,6 +477,43 @@ LevelDBCacheBin::getRecordStatus(const std::string& key)
     }
 }
 
+// Tile records are stored under TileRecordKey::bytes(). Caches seeded
+// before that have them under the string key, so a miss on the binary
+// key falls back on it.
+
+ReadResult
+LevelDBCacheBin::readObject(const TileRecordKey& key, const osgDB::Options* readOptions)
+{
+    ReadResult r = readObject(key.bytes(), readOptions);
+    if ( r.code() == ReadResult::RESULT_NOT_FOUND )
+        r = readObject(key.str(), readOptions);
+    return r;
+}
+
+ReadResult
+LevelDBCacheBin::readImage(const TileRecordKey& key, const osgDB::Options* readOptions)
+{
+    ReadResult r = readImage(key.bytes(), readOptions);
+    if ( r.code() == ReadResult::RESULT_NOT_FOUND )
+        r = readImage(key.str(), readOptions);
+    return r;
+}
+
+bool
+LevelDBCacheBin::write(const TileRecordKey& key, const osg::Object* object, const Config& meta, const osgDB::Options* writeOptions)
+{
+    return write(key.bytes(), object, meta, writeOptions);
+}
+
+CacheBin::RecordStatus
+LevelDBCacheBin::getRecordStatus(const TileRecordKey& key)
+{
+    RecordStatus status = getRecordStatus(key.bytes());
+    if ( status == STATUS_NOT_FOUND )
+        status = getRecordStatus(key.str());
+    return status;
+}
+
 bool
 LevelDBCacheBin::remove(const std::string& key)
 {
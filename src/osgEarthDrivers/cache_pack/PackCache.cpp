@@ -0,0 +1,988 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "PackCache"
+#include <osgEarth/Cache>
+#include <osgEarth/DateTime>
+#include <osgEarth/FileUtils>
+#include <osgEarth/Registry>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Threading>
+#include <osgEarth/URI>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers;
+using namespace osgEarth::Threading;
+
+#define LC "[PackCache] "
+
+#define OSG_FORMAT "osgb"
+#define PACK_EXT   ".oepk"
+#define BUILD_EXT  ".oepk.build"
+
+#define PACK_MAGIC   "OEPK"
+#define PACK_VERSION 1u
+
+namespace
+{
+    // On-disk layout of a pack (all values in host byte order):
+    //
+    //   PackHeader
+    //   records:  [metadata JSON][osgb data] ...
+    //   index:    PackEntry[numRecords], sorted by key
+    //   strings:  the keys of the index entries
+    //
+    // The header is written last, so an unfinished pack has no magic
+    // number and is never opened for reading.
+
+    struct PackHeader
+    {
+        char     _magic[4];
+        uint32_t _version;
+        uint64_t _numRecords;
+        uint64_t _indexOffset;
+        uint64_t _stringsOffset;
+    };
+
+    struct PackEntry
+    {
+        uint64_t _keyOffset;    // from the start of the string table
+        uint64_t _recordOffset; // from the start of the file
+        uint64_t _dataSize;
+        int64_t  _time;
+        uint32_t _keySize;
+        uint32_t _metaSize;
+    };
+
+    static_assert(sizeof(PackHeader) == 32, "PackHeader must be 32 bytes");
+    static_assert(sizeof(PackEntry) == 40, "PackEntry must be 40 bytes");
+
+    /**
+     * Index key for a record. Keys that start with a tile key (lod/x/y)
+     * sort by quadkey, so a tile's descendants follow it in the pack and
+     * neighboring tiles are close together. Other keys sort as they are.
+     */
+    std::string makeSortKey(const std::string& key)
+    {
+        unsigned lod, x, y;
+        int length = 0;
+        if (sscanf(key.c_str(), "%u/%u/%u%n", &lod, &x, &y, &length) == 3 &&
+            lod < 32u && ((uint64_t)x >> lod) == 0u && ((uint64_t)y >> lod) == 0u)
+        {
+            // only the canonical spelling, so no two keys share a sort key
+            char prefix[40];
+            snprintf(prefix, sizeof(prefix), "%u/%u/%u", lod, x, y);
+            if (key.compare(0, length, prefix) != 0)
+                return key;
+
+            // leading \x01 keeps quadkeys apart from plain keys
+            std::string sortKey(1, '\x01');
+            sortKey.reserve(1u + lod + key.size() - length);
+            for (unsigned i = lod; i > 0u; --i)
+            {
+                unsigned mask = 1u << (i - 1u);
+                sortKey.push_back('0' + ((x & mask) ? 1 : 0) + ((y & mask) ? 2 : 0));
+            }
+            sortKey.append(key, length, std::string::npos);
+            return sortKey;
+        }
+        return key;
+    }
+
+    /**
+     * Index key for a tile record: the tile's quadkey (with one extra
+     * digit for profiles with more than one tile at LOD 0), then the
+     * profile and the record prefix. A tile's descendants follow it and
+     * its neighbors are close by, whatever the profile.
+     */
+    std::string makeSortKey(const CacheBin::TileRecordKey& key)
+    {
+        uint64_t x = key._x, y = key._y;
+        if (key._lod >= 32u || (x >> (key._lod + 1u)) != 0u || (y >> (key._lod + 1u)) != 0u)
+        {
+            // doesn't fit a quadkey
+            return key.bytes();
+        }
+
+        std::size_t prefixSize = strlen(key._prefix);
+
+        // leading \x02 keeps these apart from the string keys
+        std::string sortKey(1, '\x02');
+        sortKey.reserve(7u + key._lod + prefixSize);
+        for (int i = (int)key._lod; i >= 0; --i)
+        {
+            sortKey.push_back('0' + ((x >> i) & 1) + 2 * ((y >> i) & 1));
+        }
+
+        // the zero ends the quadkey, since no digit is zero
+        sortKey.push_back('\0');
+        for (int i = 3; i >= 0; --i)
+            sortKey.push_back((char)((key._profile >> (8 * i)) & 0xff));
+        sortKey.append(key._prefix, prefixSize);
+        return sortKey;
+    }
+
+    /**
+     * Read-only view of a stream over memory, so the osgb reader can
+     * deserialize a record straight out of the mapped file.
+     */
+    class MemoryStreamBuffer : public std::streambuf
+    {
+    public:
+        MemoryStreamBuffer(const char* data, std::size_t size)
+        {
+            char* begin = const_cast<char*>(data);
+            setg(begin, begin, begin + size);
+        }
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+        {
+            if ((which & std::ios_base::in) == 0)
+                return pos_type(off_type(-1));
+
+            off_type base =
+                dir == std::ios_base::beg ? 0 :
+                dir == std::ios_base::cur ? gptr() - eback() :
+                egptr() - eback();
+
+            return seekpos(pos_type(base + off), which);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+        {
+            off_type off(pos);
+            if ((which & std::ios_base::in) == 0 || off < 0 || off > egptr() - eback())
+                return pos_type(off_type(-1));
+
+            setg(eback(), eback() + off, egptr());
+            return pos;
+        }
+    };
+
+    /**
+     * Maps a whole file into memory for reading.
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() : _data(0L), _size(0u)
+#ifdef _WIN32
+            , _file(INVALID_HANDLE_VALUE), _mapping(0L)
+#endif
+        { }
+
+        ~MappedFile() { close(); }
+
+        bool open(const std::string& path)
+        {
+            close();
+#ifdef _WIN32
+            _file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0L, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0L);
+            if (_file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size;
+            if (!::GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+            {
+                close();
+                return false;
+            }
+
+            _mapping = ::CreateFileMappingA(_file, 0L, PAGE_READONLY, 0, 0, 0L);
+            if (_mapping)
+                _data = (const char*)::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+
+            if (!_data)
+            {
+                close();
+                return false;
+            }
+            _size = (std::size_t)size.QuadPart;
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat buf;
+            if (::fstat(fd, &buf) != 0 || buf.st_size == 0)
+            {
+                ::close(fd);
+                return false;
+            }
+
+            void* data = ::mmap(0L, (std::size_t)buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+            // the mapping stays valid after the descriptor is closed
+            ::close(fd);
+
+            if (data == MAP_FAILED)
+                return false;
+
+            // lookups hop around the index and records
+            ::madvise(data, (std::size_t)buf.st_size, MADV_RANDOM);
+
+            _data = (const char*)data;
+            _size = (std::size_t)buf.st_size;
+#endif
+            return true;
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (_data)
+                ::UnmapViewOfFile(_data);
+            if (_mapping)
+                ::CloseHandle(_mapping);
+            if (_file != INVALID_HANDLE_VALUE)
+                ::CloseHandle(_file);
+            _mapping = 0L;
+            _file = INVALID_HANDLE_VALUE;
+#else
+            if (_data)
+                ::munmap(const_cast<char*>(_data), _size);
+#endif
+            _data = 0L;
+            _size = 0u;
+        }
+
+        const char* data() const { return _data; }
+        std::size_t size() const { return _size; }
+
+    private:
+        const char* _data;
+        std::size_t _size;
+#ifdef _WIN32
+        HANDLE _file;
+        HANDLE _mapping;
+#endif
+    };
+
+    /**
+     * Cache bin stored in a single pack file.
+     *
+     * In read mode the pack is memory-mapped and every lookup is a binary
+     * search of the index. In build mode records are appended to a new
+     * pack and the index is kept in memory until the pack is finished,
+     * which happens on compact() or when the bin goes away.
+     */
+    class PackCacheBin : public CacheBin
+    {
+    public:
+        PackCacheBin(const std::string& binID, const std::string& rootPath, bool build);
+
+    public: // CacheBin interface
+
+        ReadResult readObject(const std::string& key, const osgDB::Options* dbo) override;
+
+        ReadResult readImage(const std::string& key, const osgDB::Options* dbo) override;
+
+        ReadResult readString(const std::string& key, const osgDB::Options* dbo) override;
+
+        bool write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo) override;
+
+        bool remove(const std::string& key) override;
+
+        bool touch(const std::string& key) override;
+
+        RecordStatus getRecordStatus(const std::string& key) override;
+
+        ReadResult readObject(const TileRecordKey& key, const osgDB::Options* dbo) override;
+
+        ReadResult readImage(const TileRecordKey& key, const osgDB::Options* dbo) override;
+
+        bool write(const TileRecordKey& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo) override;
+
+        RecordStatus getRecordStatus(const TileRecordKey& key) override;
+
+        bool clear() override;
+
+        bool compact() override;
+
+        unsigned getStorageSize() override;
+
+    protected:
+        virtual ~PackCacheBin();
+
+        enum Type { TYPE_OBJECT, TYPE_IMAGE };
+
+        ReadResult read(const std::string& sortKey, Type type, const osgDB::Options* dbo);
+
+        bool append(const std::string& sortKey, const osg::Object* object, const Config& meta, const osgDB::Options* dbo);
+
+        RecordStatus getStatus(const std::string& sortKey);
+
+        ReadResult deserialize(const char* data, const PackEntry& entry, Type type, const osgDB::Options* dbo);
+
+        bool openPack();
+
+        bool startBuild();
+
+        bool finishBuild();
+
+        const PackEntry* find(const std::string& sortKey) const;
+
+        std::string                       _packPath;
+        std::string                       _buildPath;
+        osg::ref_ptr<osgDB::ReaderWriter> _rw;
+        Mutex                             _mutex;
+
+        // read mode
+        MappedFile                        _file;
+        const PackEntry*                  _index;
+        uint64_t                          _numRecords;
+        const char*                       _strings;
+
+        // build mode
+        bool                              _building;
+        std::fstream                      _out;
+        uint64_t                          _outSize;
+        std::unordered_map<std::string, PackEntry> _pending;
+    };
+
+    /**
+     * Cache that keeps each bin in a memory-mapped pack file.
+     */
+    class PackCache : public Cache
+    {
+    public:
+        PackCache() { } // unused
+        PackCache( const PackCache& rhs, const osg::CopyOp& op ) { } // unused
+        META_Object( osgEarth, PackCache );
+
+        PackCache( const CacheOptions& options );
+
+    public: // Cache interface
+
+        CacheBin* addBin( const std::string& binID ) override;
+
+        CacheBin* getOrCreateDefaultBin() override;
+
+        off_t getApproximateSize() const override;
+
+        bool compact() override;
+
+    protected:
+        std::string _rootPath;
+        bool _build;
+
+        // every bin handed out, so compact() can finish them all
+        mutable Mutex _packBinsMutex;
+        std::vector<osg::ref_ptr<CacheBin> > _packBins;
+    };
+}
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    PackCache::PackCache(const CacheOptions& options) :
+        Cache(options),
+        _build(false),
+        _packBinsMutex("PackCache(OE)")
+    {
+        PackCacheOptions pco( options );
+
+        // read the root path from ENV is necessary:
+        if ( !pco.rootPath().isSet())
+        {
+            const char* cachePath = ::getenv(OSGEARTH_ENV_CACHE_PATH);
+            if ( cachePath )
+                pco.rootPath() = cachePath;
+        }
+
+        _rootPath = URI( *pco.rootPath(), options.referrer() ).full();
+        _build = pco.build().get();
+
+        if (_build)
+        {
+            if (osgDB::makeDirectory(_rootPath) == false)
+            {
+                _status.set(Status::ResourceUnavailable, Stringify()
+                    << "Failed to create or access folder \"" << _rootPath << "\"");
+                return;
+            }
+            OE_INFO << LC << "Building a pack cache at \"" << _rootPath << "\"\n";
+        }
+        else
+        {
+            if (!osgDB::fileExists(_rootPath))
+            {
+                _status.set(Status::ResourceUnavailable, Stringify()
+                    << "Pack cache folder \"" << _rootPath << "\" does not exist");
+                return;
+            }
+            OE_INFO << LC << "Opened a pack cache at \"" << _rootPath << "\"\n";
+        }
+    }
+
+    CacheBin*
+    PackCache::addBin( const std::string& name )
+    {
+        if (getStatus().isError())
+            return NULL;
+
+        CacheBin* existing = _bins.get(name);
+        if (existing)
+            return existing;
+
+        osg::ref_ptr<CacheBin> bin = new PackCacheBin(name, _rootPath, _build);
+        CacheBin* result = _bins.getOrCreate(name, bin.get());
+
+        if (result == bin.get())
+        {
+            ScopedMutexLock lock(_packBinsMutex);
+            _packBins.push_back(bin.get());
+        }
+        return result;
+    }
+
+    CacheBin*
+    PackCache::getOrCreateDefaultBin()
+    {
+        if (getStatus().isError())
+            return NULL;
+
+        static Mutex s_defaultBinMutex(OE_MUTEX_NAME);
+        if ( !_defaultBin.valid() )
+        {
+            ScopedMutexLock lock( s_defaultBinMutex );
+            if ( !_defaultBin.valid() ) // double-check
+            {
+                _defaultBin = new PackCacheBin("__default", _rootPath, _build);
+
+                ScopedMutexLock binsLock(_packBinsMutex);
+                _packBins.push_back(_defaultBin.get());
+            }
+        }
+        return _defaultBin.get();
+    }
+
+    off_t
+    PackCache::getApproximateSize() const
+    {
+        off_t total = 0;
+        ScopedMutexLock lock(_packBinsMutex);
+        for (auto& bin : _packBins)
+            total += bin->getStorageSize();
+        return total;
+    }
+
+    bool
+    PackCache::compact()
+    {
+        bool ok = true;
+        ScopedMutexLock lock(_packBinsMutex);
+        for (auto& bin : _packBins)
+            ok = bin->compact() && ok;
+        return ok;
+    }
+
+    //------------------------------------------------------------------------
+
+#undef  LC
+#define LC "[PackCacheBin] "
+
+    PackCacheBin::PackCacheBin(const std::string& binID, const std::string& rootPath, bool build) :
+        CacheBin(binID),
+        _mutex("PackCacheBin(OE)"),
+        _index(0L),
+        _numRecords(0u),
+        _strings(0L),
+        _building(false),
+        _outSize(0u)
+    {
+        _packPath = osgDB::concatPaths(rootPath, binID + PACK_EXT);
+        _buildPath = osgDB::concatPaths(rootPath, binID + BUILD_EXT);
+
+        _rw = osgDB::Registry::instance()->getReaderWriterForExtension(OSG_FORMAT);
+
+        if (build)
+            startBuild();
+        else
+            openPack();
+    }
+
+    PackCacheBin::~PackCacheBin()
+    {
+        ScopedMutexLock lock(_mutex);
+        finishBuild();
+    }
+
+    bool
+    PackCacheBin::openPack()
+    {
+        // call with _mutex locked (or from the constructor)
+        _index = 0L;
+        _numRecords = 0u;
+        _strings = 0L;
+
+        if (!osgDB::fileExists(_packPath))
+            return false;
+
+        if (!_file.open(_packPath))
+        {
+            OE_WARN << LC << "Failed to map \"" << _packPath << "\"" << std::endl;
+            return false;
+        }
+
+        const PackHeader* header = (const PackHeader*)_file.data();
+        uint64_t size = _file.size();
+
+        bool ok =
+            size >= sizeof(PackHeader) &&
+            memcmp(header->_magic, PACK_MAGIC, 4) == 0 &&
+            header->_version == PACK_VERSION &&
+            header->_indexOffset % alignof(PackEntry) == 0 &&
+            header->_indexOffset <= size &&
+            header->_numRecords <= (size - header->_indexOffset) / sizeof(PackEntry) &&
+            header->_stringsOffset >= header->_indexOffset + header->_numRecords * sizeof(PackEntry) &&
+            header->_stringsOffset <= size;
+
+        if (!ok)
+        {
+            OE_WARN << LC << "\"" << _packPath << "\" is not a valid pack" << std::endl;
+            _file.close();
+            return false;
+        }
+
+        _index = (const PackEntry*)(_file.data() + header->_indexOffset);
+        _numRecords = header->_numRecords;
+        _strings = _file.data() + header->_stringsOffset;
+
+        OE_INFO << LC << "Bin " << getID() << ": " << _numRecords << " records in \"" << _packPath << "\"" << std::endl;
+        return true;
+    }
+
+    bool
+    PackCacheBin::startBuild()
+    {
+        // call with _mutex locked (or from the constructor)
+        _file.close();
+        _index = 0L;
+        _numRecords = 0u;
+        _pending.clear();
+
+        osgEarth::makeDirectoryForFile(_buildPath);
+
+        _out.open(_buildPath.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!_out.is_open())
+        {
+            OE_WARN << LC << "Failed to create \"" << _buildPath << "\"" << std::endl;
+            _building = false;
+            return false;
+        }
+
+        // room for the header, which goes in last
+        PackHeader header;
+        memset(&header, 0, sizeof(header));
+        _out.write((const char*)&header, sizeof(header));
+        _outSize = sizeof(header);
+
+        _building = _out.good();
+        return _building;
+    }
+
+    bool
+    PackCacheBin::finishBuild()
+    {
+        // call with _mutex locked
+        if (!_building)
+            return false;
+
+        _building = false;
+
+        // sort the index so readers can binary-search it
+        std::vector<std::pair<std::string, PackEntry> > entries(_pending.begin(), _pending.end());
+        _pending.clear();
+
+        std::sort(entries.begin(), entries.end(),
+            [](const std::pair<std::string, PackEntry>& lhs, const std::pair<std::string, PackEntry>& rhs) {
+                return lhs.first < rhs.first;
+            });
+
+        PackHeader header;
+        memcpy(header._magic, PACK_MAGIC, 4);
+        header._version = PACK_VERSION;
+        header._numRecords = entries.size();
+
+        // align the index so it can be used straight out of the mapping
+        uint64_t padding = (alignof(PackEntry) - _outSize % alignof(PackEntry)) % alignof(PackEntry);
+        const char zeros[alignof(PackEntry)] = { 0 };
+
+        _out.seekp(_outSize);
+        _out.write(zeros, (std::streamsize)padding);
+        header._indexOffset = _outSize + padding;
+        header._stringsOffset = header._indexOffset + entries.size() * sizeof(PackEntry);
+
+        uint64_t keyOffset = 0u;
+        for (auto& i : entries)
+        {
+            i.second._keyOffset = keyOffset;
+            i.second._keySize = i.first.size();
+            keyOffset += i.first.size();
+            _out.write((const char*)&i.second, sizeof(PackEntry));
+        }
+
+        for (auto& i : entries)
+        {
+            _out.write(i.first.data(), i.first.size());
+        }
+
+        _out.seekp(0);
+        _out.write((const char*)&header, sizeof(header));
+        _out.flush();
+
+        bool ok = _out.good();
+        _out.close();
+
+        if (!ok)
+        {
+            OE_WARN << LC << "Failed to write \"" << _buildPath << "\"" << std::endl;
+            return false;
+        }
+
+        ::remove(_packPath.c_str());
+        if (::rename(_buildPath.c_str(), _packPath.c_str()) != 0)
+        {
+            OE_WARN << LC << "Failed to rename \"" << _buildPath << "\" to \"" << _packPath << "\"" << std::endl;
+            return false;
+        }
+
+        OE_INFO << LC << "Bin " << getID() << ": wrote " << entries.size() << " records to \"" << _packPath << "\"" << std::endl;
+
+        // From here on the bin serves the finished pack.
+        return openPack();
+    }
+
+    const PackEntry*
+    PackCacheBin::find(const std::string& sortKey) const
+    {
+        // call with _mutex locked
+        const PackEntry* end = _index + _numRecords;
+        const char* strings = _strings;
+
+        const PackEntry* i = std::lower_bound(_index, end, sortKey,
+            [strings](const PackEntry& entry, const std::string& key) {
+                int c = memcmp(strings + entry._keyOffset, key.data(), std::min<std::size_t>(entry._keySize, key.size()));
+                return c < 0 || (c == 0 && entry._keySize < key.size());
+            });
+
+        if (i != end &&
+            i->_keySize == sortKey.size() &&
+            memcmp(strings + i->_keyOffset, sortKey.data(), sortKey.size()) == 0)
+        {
+            return i;
+        }
+        return 0L;
+    }
+
+    ReadResult
+    PackCacheBin::deserialize(const char* record, const PackEntry& entry, Type type, const osgDB::Options* dbo)
+    {
+        // the reader works right out of the record buffer
+        MemoryStreamBuffer sb(record + entry._metaSize, entry._dataSize);
+        std::istream in(&sb);
+
+        osgDB::ReaderWriter::ReadResult r = type == TYPE_IMAGE ?
+            _rw->readImage(in, dbo) :
+            _rw->readObject(in, dbo);
+
+        if (!r.success())
+        {
+            OE_WARN << LC << "Bin " << getID() << ": failed to read a record: " << r.message() << std::endl;
+            return ReadResult(ReadResult::RESULT_READER_ERROR);
+        }
+
+        Config meta;
+        if (entry._metaSize > 0)
+            meta.fromJSON(std::string(record, entry._metaSize));
+
+        ReadResult rr(r.getObject(), meta);
+        rr.setLastModifiedTime(entry._time);
+        return rr;
+    }
+
+    ReadResult
+    PackCacheBin::read(const std::string& sortKey, Type type, const osgDB::Options* dbo)
+    {
+        if (!_rw.valid())
+            return ReadResult(ReadResult::RESULT_NOT_FOUND);
+
+        ScopedMutexLock lock(_mutex);
+
+        if (_building)
+        {
+            auto i = _pending.find(sortKey);
+            if (i == _pending.end())
+                return ReadResult(ReadResult::RESULT_NOT_FOUND);
+
+            const PackEntry& entry = i->second;
+            std::string buf(entry._metaSize + entry._dataSize, '\0');
+            _out.flush();
+            _out.seekg(entry._recordOffset);
+            _out.read(&buf[0], buf.size());
+            if (!_out.good())
+            {
+                _out.clear();
+                return ReadResult(ReadResult::RESULT_NOT_FOUND);
+            }
+            return deserialize(buf.data(), entry, type, dbo);
+        }
+
+        const PackEntry* entry = find(sortKey);
+        if (!entry)
+            return ReadResult(ReadResult::RESULT_NOT_FOUND);
+
+        const PackHeader* header = (const PackHeader*)_file.data();
+        if (entry->_recordOffset > header->_indexOffset ||
+            entry->_metaSize + entry->_dataSize > header->_indexOffset - entry->_recordOffset)
+        {
+            OE_WARN << LC << "Bin " << getID() << ": corrupt record at offset " << entry->_recordOffset << std::endl;
+            return ReadResult(ReadResult::RESULT_READER_ERROR);
+        }
+
+        // no copy; the record is read in place from the mapping
+        return deserialize(_file.data() + entry->_recordOffset, *entry, type, dbo);
+    }
+
+    ReadResult
+    PackCacheBin::readImage(const std::string& key, const osgDB::Options* dbo)
+    {
+        return read(makeSortKey(key), TYPE_IMAGE, dbo);
+    }
+
+    ReadResult
+    PackCacheBin::readObject(const std::string& key, const osgDB::Options* dbo)
+    {
+        return read(makeSortKey(key), TYPE_OBJECT, dbo);
+    }
+
+    ReadResult
+    PackCacheBin::readString(const std::string& key, const osgDB::Options* dbo)
+    {
+        ReadResult r = readObject(key, dbo);
+        if ( r.succeeded() )
+        {
+            if ( r.get<StringObject>() )
+                return r;
+            else
+                return ReadResult();
+        }
+        else
+        {
+            return r;
+        }
+    }
+
+    bool
+    PackCacheBin::write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo)
+    {
+        return append(makeSortKey(key), object, meta, dbo);
+    }
+
+    bool
+    PackCacheBin::append(const std::string& sortKey, const osg::Object* object, const Config& meta, const osgDB::Options* dbo)
+    {
+        if (!object || !_rw.valid())
+            return false;
+
+        {
+            ScopedMutexLock lock(_mutex);
+            if (!_building)
+                return false;
+        }
+
+        // serialize outside the lock
+        osgDB::ReaderWriter::WriteResult r;
+        std::stringstream datastream;
+
+        if (dynamic_cast<const osg::Image*>(object))
+            r = _rw->writeImage(*static_cast<const osg::Image*>(object), datastream, dbo);
+        else if (dynamic_cast<const osg::Node*>(object))
+            r = _rw->writeNode(*static_cast<const osg::Node*>(object), datastream, dbo);
+        else
+            r = _rw->writeObject(*object, datastream, dbo);
+
+        if (!r.success())
+        {
+            OE_WARN << LC << "Bin " << getID() << ": FAILED to write a record; msg = \""
+                << r.message() << "\"\n";
+            return false;
+        }
+
+        std::string data = datastream.str();
+        std::string metadata = meta.empty() ? std::string() : meta.toJSON(false);
+
+        ScopedMutexLock lock(_mutex);
+        if (!_building)
+            return false;
+
+        PackEntry entry;
+        entry._keyOffset = 0u;
+        entry._keySize = 0u;
+        entry._recordOffset = _outSize;
+        entry._metaSize = metadata.size();
+        entry._dataSize = data.size();
+        entry._time = DateTime().asTimeStamp();
+
+        _out.seekp(_outSize);
+        _out.write(metadata.data(), metadata.size());
+        _out.write(data.data(), data.size());
+        if (!_out.good())
+        {
+            OE_WARN << LC << "Bin " << getID() << ": FAILED to append to \"" << _buildPath << "\"\n";
+            _out.clear();
+            return false;
+        }
+        _outSize += metadata.size() + data.size();
+
+        // a rewrite orphans the old record but replaces its index entry
+        _pending[sortKey] = entry;
+        return true;
+    }
+
+    CacheBin::RecordStatus
+    PackCacheBin::getRecordStatus(const std::string& key)
+    {
+        return getStatus(makeSortKey(key));
+    }
+
+    CacheBin::RecordStatus
+    PackCacheBin::getStatus(const std::string& sortKey)
+    {
+        ScopedMutexLock lock(_mutex);
+        if (_building)
+            return _pending.find(sortKey) != _pending.end() ? STATUS_OK : STATUS_NOT_FOUND;
+        else
+            return find(sortKey) ? STATUS_OK : STATUS_NOT_FOUND;
+    }
+
+    ReadResult
+    PackCacheBin::readObject(const TileRecordKey& key, const osgDB::Options* dbo)
+    {
+        return read(makeSortKey(key), TYPE_OBJECT, dbo);
+    }
+
+    ReadResult
+    PackCacheBin::readImage(const TileRecordKey& key, const osgDB::Options* dbo)
+    {
+        return read(makeSortKey(key), TYPE_IMAGE, dbo);
+    }
+
+    bool
+    PackCacheBin::write(const TileRecordKey& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo)
+    {
+        return append(makeSortKey(key), object, meta, dbo);
+    }
+
+    CacheBin::RecordStatus
+    PackCacheBin::getRecordStatus(const TileRecordKey& key)
+    {
+        return getStatus(makeSortKey(key));
+    }
+
+    bool
+    PackCacheBin::remove(const std::string& key)
+    {
+        // packs are read-only; a build can still drop a record
+        ScopedMutexLock lock(_mutex);
+        return _building && _pending.erase(makeSortKey(key)) > 0;
+    }
+
+    bool
+    PackCacheBin::touch(const std::string& key)
+    {
+        return false;
+    }
+
+    bool
+    PackCacheBin::clear()
+    {
+        ScopedMutexLock lock(_mutex);
+        if (!_building)
+            return false;
+
+        _out.close();
+        return startBuild();
+    }
+
+    bool
+    PackCacheBin::compact()
+    {
+        ScopedMutexLock lock(_mutex);
+        return finishBuild();
+    }
+
+    unsigned
+    PackCacheBin::getStorageSize()
+    {
+        ScopedMutexLock lock(_mutex);
+        return _building ? (unsigned)_outSize : (unsigned)_file.size();
+    }
+}
+
+//------------------------------------------------------------------------
+
+/**
+ * Read-only cache of memory-mapped tile packs, for deploying pre-seeded
+ * caches. Seed it with build=true to create the packs.
+ */
+class PackCacheDriver : public CacheDriver
+{
+public:
+    PackCacheDriver()
+    {
+        supportsExtension( "osgearth_cache_pack", "Memory-mapped pack cache for osgEarth" );
+    }
+
+    virtual const char* className() const
+    {
+        return "Memory-mapped pack cache for osgEarth";
+    }
+
+    virtual ReadResult readObject(const std::string& file_name, const Options* options) const
+    {
+        if ( !acceptsExtension(osgDB::getLowerCaseFileExtension( file_name )))
+            return ReadResult::FILE_NOT_HANDLED;
+
+        return ReadResult( new PackCache( getCacheOptions(options) ) );
+    }
+};
+
+REGISTER_OSGPLUGIN(osgearth_cache_pack, PackCacheDriver)
@@ -20,6 +20,7 @@
 #include "RocksDBCacheBin"
 #include <osgEarth/URI>
 #include <osgEarth/Threading>
+#include <osgEarth/StringUtils>
 #include <osgDB/Registry>
 #include <osgDB/ReaderWriter>
 #include <osgDB/FileUtils>
@@ -39,14 +40,37 @@
 
 #define ROCKSDB_CACHE_VERSION 1
 
+// Column family names for bins get this prefix, so no bin can
+// collide with the RocksDB "default" family.
+#define BIN_COLUMN_FAMILY_PREFIX "bin:"
+
 using namespace osgEarth;
 using namespace osgEarth::RocksDBCache;
 
+namespace
+{
+    bool parseCompression(const std::string& name, rocksdb::CompressionType& out)
+    {
+        std::string value = osgEarth::Util::toLower(name);
+        if (value == "none")        out = rocksdb::kNoCompression;
+        else if (value == "snappy") out = rocksdb::kSnappyCompression;
+        else if (value == "zlib")   out = rocksdb::kZlibCompression;
+        else if (value == "lz4")    out = rocksdb::kLZ4Compression;
+        else if (value == "lz4hc")  out = rocksdb::kLZ4HCCompression;
+        else if (value == "zstd")   out = rocksdb::kZSTD;
+        else return false;
+        return true;
+    }
+}
+
 
 RocksDBCacheImpl::RocksDBCacheImpl( const CacheOptions& options ) :
 osgEarth::Cache( options ),
 _options       ( options ),
-_active        ( true )
+_active        ( true ),
+_db            ( 0L ),
+_useColumnFamilies( false ),
+_columnFamiliesMutex( "RocksDBCache(OE)" )
 {
     // Force OSG to initialize the image wrapper. Failure to do this can result
     // in a race condition within OSG when the cache is accessed from multiple threads.
@@ -154,9 +178,18 @@ RocksDBCacheImpl::open()
 
     options.stats_dump_period_sec = 30;
 
-	table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10));
+    if (_options.bloomFilterBitsPerKey().value() > 0u)
+    {
+        table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(_options.bloomFilterBitsPerKey().value()));
+    }
     table_options.block_size = _options.blockSize().value();
 	table_options.block_cache = rocksdb::NewLRUCache(_options.blockCacheSize().value());
+
+    // Keep index and filter blocks in the block cache so their memory stays
+    // within the cache budget on very large databases; L0 ones stay pinned.
+    table_options.cache_index_and_filter_blocks = true;
+    table_options.pin_l0_filter_and_index_blocks_in_cache = true;
+
     options.table_factory.reset( NewBlockBasedTableFactory( table_options ) );
 
 	if (_options.logPath().isSet())
@@ -169,38 +202,147 @@ RocksDBCacheImpl::open()
 	options.max_bytes_for_level_base = options.write_buffer_size * options.min_write_buffer_number_to_merge * options.level0_file_num_compaction_trigger;
 	options.target_file_size_base = options.max_bytes_for_level_base / 10;
 
+    // Compaction profile: parallel background work, and pick the files that
+    // overlap the least with the next level to keep write amplification down.
+    options.IncreaseParallelism(osg::maximum((int)_options.compactionThreads().value(), 1));
+    options.compaction_pri = rocksdb::kMinOverlappingRatio;
+
+    if (_options.compression().isSet())
+    {
+        rocksdb::CompressionType compression;
+        if (parseCompression(_options.compression().value(), compression))
+        {
+            options.compression = compression;
+        }
+        else
+        {
+            OE_WARN << LC << "Unknown compression \"" << _options.compression().value() << "\"; using the default" << std::endl;
+        }
+    }
+
+    _columnFamilyOptions = rocksdb::ColumnFamilyOptions(options);
+
     rocksdb::Status status;
         
-    status = rocksdb::DB::Open(options, _rootPath, &_db);
-    if ( status.ok() )
-        return;
-
-    OE_WARN << LC << "Database problem...attempting to repair..." << std::endl;
-    status = rocksdb::RepairDB(_rootPath, options);
-    if ( status.ok() )
+    status = openDB(options);
+    if ( !status.ok() )
     {
-        status = rocksdb::DB::Open(options, _rootPath, &_db);
+        OE_WARN << LC << "Database problem...attempting to repair..." << std::endl;
+        status = rocksdb::RepairDB(_rootPath, options);
         if ( status.ok() )
         {
-            OE_WARN << LC << "...repair complete!" << std::endl;
-            return;
+            status = openDB(options);
+            if ( status.ok() )
+            {
+                OE_WARN << LC << "...repair complete!" << std::endl;
+            }
         }
     }
 
-    OE_WARN << LC << "Failed to open or create cache bin at " << _rootPath << std::endl;
-    if ( _db )
+    if ( !status.ok() )
     {
-        delete _db;
-        _db = 0L;
+        OE_WARN << LC << "Failed to open or create cache bin at " << _rootPath << std::endl;
+        if ( _db )
+        {
+            delete _db;
+            _db = 0L;
+        }
         _active = false;
+        return;
+    }
+
+    // A database that already has bin families keeps using them. One that
+    // holds records in the default family predates them, so stay with the
+    // single keyspace rather than orphaning the data.
+    bool hasBinFamilies = _columnFamilies.size() > 1u;
+    bool hasDefaultRecords = false;
+    {
+        rocksdb::Iterator* it = _db->NewIterator(rocksdb::ReadOptions());
+        it->SeekToFirst();
+        hasDefaultRecords = it->Valid();
+        delete it;
+    }
+
+    _useColumnFamilies =
+        hasBinFamilies ||
+        (_options.columnFamilies() == true && !hasDefaultRecords);
+
+    if (_options.columnFamilies() == true && !_useColumnFamilies)
+    {
+        OE_INFO << LC << "Existing cache uses a single keyspace; not using column families" << std::endl;
     }
 }
 
+rocksdb::Status
+RocksDBCacheImpl::openDB(const rocksdb::Options& options)
+{
+    std::vector<std::string> names;
+    if (!rocksdb::DB::ListColumnFamilies(options, _rootPath, &names).ok() || names.empty())
+    {
+        // new database
+        names.clear();
+        names.push_back(rocksdb::kDefaultColumnFamilyName);
+    }
+
+    std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+    for (const auto& name : names)
+    {
+        descriptors.push_back(rocksdb::ColumnFamilyDescriptor(name, _columnFamilyOptions));
+    }
+
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::Status status = rocksdb::DB::Open(rocksdb::DBOptions(options), _rootPath, descriptors, &handles, &_db);
+
+    _columnFamilies.clear();
+    if (status.ok())
+    {
+        for (unsigned i = 0; i < handles.size(); ++i)
+        {
+            _columnFamilies[names[i]] = handles[i];
+        }
+    }
+    return status;
+}
+
+rocksdb::ColumnFamilyHandle*
+RocksDBCacheImpl::getColumnFamily(const std::string& binID)
+{
+    if ( !_useColumnFamilies )
+        return _db->DefaultColumnFamily();
+
+    std::string name = BIN_COLUMN_FAMILY_PREFIX + binID;
+
+    Threading::ScopedMutexLock lock(_columnFamiliesMutex);
+
+    auto i = _columnFamilies.find(name);
+    if (i != _columnFamilies.end())
+        return i->second;
+
+    rocksdb::ColumnFamilyHandle* handle = 0L;
+    rocksdb::Status status = _db->CreateColumnFamily(_columnFamilyOptions, name, &handle);
+    if ( !status.ok() )
+    {
+        OE_WARN << LC << "Failed to create a column family for bin \"" << binID << "\": " << status.ToString() << std::endl;
+        return 0L;
+    }
+
+    _columnFamilies[name] = handle;
+    return handle;
+}
+
 CacheBin*
 RocksDBCacheImpl::addBin( const std::string& name )
 {
-    return _db ?
-        _bins.getOrCreate(name, new RocksDBCacheBin(name, _db, _tracker.get())) :
+    if ( !_db )
+        return 0L;
+
+    CacheBin* bin = _bins.get(name);
+    if ( bin )
+        return bin;
+
+    rocksdb::ColumnFamilyHandle* cf = getColumnFamily(name);
+    return cf ?
+        _bins.getOrCreate(name, new RocksDBCacheBin(name, _db, cf, _useColumnFamilies, _tracker.get())) :
         0L;
 }
 
@@ -216,7 +358,9 @@ RocksDBCacheImpl::getOrCreateDefaultBin()
         Threading::ScopedMutexLock lock( s_defaultBinMutex );
         if ( !_defaultBin.valid() ) // double-check
         {
-            _defaultBin = new RocksDBCacheBin("_default", _db, _tracker.get());
+            rocksdb::ColumnFamilyHandle* cf = getColumnFamily("_default");
+            if ( cf )
+                _defaultBin = new RocksDBCacheBin("_default", _db, cf, _useColumnFamilies, _tracker.get());
         }
     }
     return _defaultBin.get();
@@ -234,7 +378,11 @@ RocksDBCacheImpl::compact()
     if ( !_db )
         return false;
 
-    _db->CompactRange(0L, 0L);
+    Threading::ScopedMutexLock lock(_columnFamiliesMutex);
+    for (auto& cf : _columnFamilies)
+    {
+        _db->CompactRange(rocksdb::CompactRangeOptions(), cf.second, 0L, 0L);
+    }
 
     return true;
 }
@@ -245,13 +393,10 @@ RocksDBCacheImpl::clear()
     if ( !_db )
         return false;
 
-    // No WriteBatch because it doesn't seem to allow compaction to occur
-    // -- need to figure out why someday.
-
-    rocksdb::Iterator* it = _db->NewIterator(rocksdb::ReadOptions());
-    for(it->SeekToFirst(); it->Valid(); it->Next())
+    Threading::ScopedMutexLock lock(_columnFamiliesMutex);
+    for (auto& cf : _columnFamilies)
     {
-        _db->Delete(rocksdb::WriteOptions(), it->key());
+        RocksDBCacheBin::clearColumnFamily(_db, cf.second);
     }
 
     return true;
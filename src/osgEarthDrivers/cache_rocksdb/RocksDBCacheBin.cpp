@@ -79,11 +79,15 @@ namespace
 #define TIME_FIELD "rocksdb.time"
 
 
-RocksDBCacheBin::RocksDBCacheBin(const std::string& binID,
-                                 rocksdb::DB*       db,
-                                 Tracker*           tracker) :
+RocksDBCacheBin::RocksDBCacheBin(const std::string&           binID,
+                                 rocksdb::DB*                 db,
+                                 rocksdb::ColumnFamilyHandle* cf,
+                                 bool                         ownsColumnFamily,
+                                 Tracker*                     tracker) :
 osgEarth::CacheBin( binID ),
 _db               ( db ),
+_cf               ( cf ),
+_ownsColumnFamily ( ownsColumnFamily ),
 _tracker          ( tracker ),
 _debug            ( false )
 {
@@ -253,7 +257,7 @@ RocksDBCacheBin::read(const std::string& key, const Reader& reader)
 
     // first read the metadata record.
     std::string metavalue;
-    status = _db->Get( ro, metaKey(key), &metavalue );
+    status = _db->Get( ro, _cf, metaKey(key), &metavalue );
     TimeStamp lastModified = (TimeStamp)0;
     if ( status.ok() )
     {        
@@ -265,7 +269,7 @@ RocksDBCacheBin::read(const std::string& key, const Reader& reader)
     // next read the data record.
     std::string datakey = dataKey(key);
     std::string datavalue;
-    status = _db->Get( ro, datakey, &datavalue );
+    status = _db->Get( ro, _cf, datakey, &datavalue );
     if ( !status.ok() )
     {
         // main record not found for some reason.
@@ -327,11 +331,8 @@ RocksDBCacheBin::readString(const std::string& key, const osgDB::Options* readOp
 }
 
 bool
-RocksDBCacheBin::write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* writeOptions)
+RocksDBCacheBin::encode(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* writeOptions, rocksdb::WriteBatch& batch)
 {
-    if ( !binValidForWriting() || !object ) 
-        return false;
-        
     osgDB::ReaderWriter::WriteResult r;
     bool objWriteOK = false;
 
@@ -369,50 +370,107 @@ RocksDBCacheBin::write(const std::string& key, const osg::Object* object, const
         objWriteOK = r.success();
     }
 
-    if (objWriteOK)
+    if ( !objWriteOK )
     {
-        DateTime now;
-        rocksdb::WriteBatch batch;
+        OE_WARN << LC << "Bin " << getID() << ": FAILED to write (" << key << "); msg = \"" 
+            << r.message() << "\"\n";
+        return false;
+    }
 
-        // write the data:
-        data = datastream.str();
-        if ( _tracker->seed().isSet() )
-            blend(data, _tracker->seed().value());
-        batch.Put( dataKey(key), data );
+    DateTime now;
 
-        // write the timestamp index:
-        batch.Put( timeKey(now, key), binDataKeyTuple(key) );
+    // write the data:
+    data = datastream.str();
+    if ( _tracker->seed().isSet() )
+        blend(data, _tracker->seed().value());
+    batch.Put( _cf, dataKey(key), data );
 
-        // write the metadata:
-        Config metadata(meta);
-        metadata.set( TIME_FIELD, now.asCompactISO8601() );
-        encodeMeta( metadata, data );
-        batch.Put( metaKey(key), data );
+    // write the timestamp index:
+    batch.Put( _cf, timeKey(now, key), binDataKeyTuple(key) );
 
-        objWriteOK = _db->Write( rocksdb::WriteOptions(), &batch ).ok();
+    // write the metadata:
+    Config metadata(meta);
+    metadata.set( TIME_FIELD, now.asCompactISO8601() );
+    encodeMeta( metadata, data );
+    batch.Put( _cf, metaKey(key), data );
 
-        if ( objWriteOK )
-        {
-            ++_tracker->writes;
-            postWrite();
+    return true;
+}
+
+bool
+RocksDBCacheBin::write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* writeOptions)
+{
+    if ( !binValidForWriting() || !object ) 
+        return false;
+
+    rocksdb::WriteBatch batch;
+    if ( !encode(key, object, meta, writeOptions, batch) )
+        return false;
+
+    bool objWriteOK = _db->Write( rocksdb::WriteOptions(), &batch ).ok();
+
+    if ( objWriteOK )
+    {
+        ++_tracker->writes;
+        postWrite();
             
-            if ( _debug )
-            {
-                OE_NOTICE << LC << "Bin " << getID() << ": wrote (" << key << ")\n";
-            }
+        if ( _debug )
+        {
+            OE_NOTICE << LC << "Bin " << getID() << ": wrote (" << key << ")\n";
         }
     }
-
-        
-    if ( !objWriteOK )
+    else
     {
-        OE_WARN << LC << "Bin " << getID() << ": FAILED to write (" << key << "); msg = \"" 
-            << r.message() << "\"\n";
+        OE_WARN << LC << "Bin " << getID() << ": FAILED to write (" << key << ")\n";
     }
 
     return objWriteOK;
 }
 
+unsigned
+RocksDBCacheBin::writeBatch(const std::vector<WriteRecord>& records)
+{
+    if ( !binValidForWriting() )
+        return 0u;
+
+    // One WriteBatch for all the records, so they cost a single
+    // log write and memtable insert instead of one per tile.
+    rocksdb::WriteBatch batch;
+    unsigned count = 0u;
+
+    for (const auto& record : records)
+    {
+        if ( record._object.valid() &&
+             encode(record._isTileRecord ? record._tileKey.bytes() : record._key,
+                    record._object.get(), record._metadata, record._dbo.get(), batch) )
+        {
+            ++count;
+        }
+    }
+
+    if ( count == 0u )
+        return 0u;
+
+    if ( !_db->Write( rocksdb::WriteOptions(), &batch ).ok() )
+    {
+        OE_WARN << LC << "Bin " << getID() << ": FAILED to write a batch of " << count << " records\n";
+        return 0u;
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        ++_tracker->writes;
+        postWrite();
+    }
+
+    if ( _debug )
+    {
+        OE_NOTICE << LC << "Bin " << getID() << ": wrote a batch of " << count << " records\n";
+    }
+
+    return count;
+}
+
 void
 RocksDBCacheBin::postWrite()
 {
@@ -460,7 +518,7 @@ RocksDBCacheBin::getRecordStatus(const std::string& key)
 
     // read the metadata record.
     std::string metavalue;
-    status = _db->Get( ro, metaKey(key), &metavalue );
+    status = _db->Get( ro, _cf, metaKey(key), &metavalue );
     if ( status.ok() )
     {        
         return STATUS_OK;
@@ -471,6 +529,43 @@ RocksDBCacheBin::getRecordStatus(const std::string& key)
     }
 }
 
+// Tile records are stored under TileRecordKey::bytes(). Caches seeded
+// before that have them under the string key, so a miss on the binary
+// key falls back on it.
+
+ReadResult
+RocksDBCacheBin::readObject(const TileRecordKey& key, const osgDB::Options* readOptions)
+{
+    ReadResult r = readObject(key.bytes(), readOptions);
+    if ( r.code() == ReadResult::RESULT_NOT_FOUND )
+        r = readObject(key.str(), readOptions);
+    return r;
+}
+
+ReadResult
+RocksDBCacheBin::readImage(const TileRecordKey& key, const osgDB::Options* readOptions)
+{
+    ReadResult r = readImage(key.bytes(), readOptions);
+    if ( r.code() == ReadResult::RESULT_NOT_FOUND )
+        r = readImage(key.str(), readOptions);
+    return r;
+}
+
+bool
+RocksDBCacheBin::write(const TileRecordKey& key, const osg::Object* object, const Config& meta, const osgDB::Options* writeOptions)
+{
+    return write(key.bytes(), object, meta, writeOptions);
+}
+
+CacheBin::RecordStatus
+RocksDBCacheBin::getRecordStatus(const TileRecordKey& key)
+{
+    RecordStatus status = getRecordStatus(key.bytes());
+    if ( status == STATUS_NOT_FOUND )
+        status = getRecordStatus(key.str());
+    return status;
+}
+
 bool
 RocksDBCacheBin::remove(const std::string& key)
 {
@@ -479,7 +574,7 @@ RocksDBCacheBin::remove(const std::string& key)
 
     // first read in the time from the metadata record.
     std::string metavalue;
-    if ( _db->Get(rocksdb::ReadOptions(), metaKey(key), &metavalue).ok() == false )
+    if ( _db->Get(rocksdb::ReadOptions(), _cf, metaKey(key), &metavalue).ok() == false )
         return false;
 
     Config metadata;
@@ -487,9 +582,9 @@ RocksDBCacheBin::remove(const std::string& key)
     DateTime t(metadata.value(TIME_FIELD));
 
     rocksdb::WriteBatch batch;
-    batch.Delete( dataKey(key) );
-    batch.Delete( metaKey(key) );
-    batch.Delete( timeKey(t, key) );
+    batch.Delete( _cf, dataKey(key) );
+    batch.Delete( _cf, metaKey(key) );
+    batch.Delete( _cf, timeKey(t, key) );
         
     rocksdb::Status status = _db->Write(rocksdb::WriteOptions(), &batch);
     if ( !status.ok() )
@@ -513,7 +608,7 @@ RocksDBCacheBin::touch(const std::string& key)
 
     // first read in the time from the metadata record.
     std::string metavalue;
-    if ( _db->Get(rocksdb::ReadOptions(), metaKey(key), &metavalue).ok() == false )
+    if ( _db->Get(rocksdb::ReadOptions(), _cf, metaKey(key), &metavalue).ok() == false )
         return false;
 
     Config metadata;
@@ -526,13 +621,13 @@ RocksDBCacheBin::touch(const std::string& key)
     std::string newtime = DateTime().asCompactISO8601();
     metadata.set(TIME_FIELD, newtime);
     encodeMeta(metadata, metavalue);
-    batch.Put(metaKey(key), metavalue);
+    batch.Put(_cf, metaKey(key), metavalue);
 
     // ...remove the old time index record:
-    batch.Delete( timeKey(oldtime, key) );
+    batch.Delete( _cf, timeKey(oldtime, key) );
 
     // ...and write a new time index record.
-    batch.Put( timeKey(newtime, key), binDataKeyTuple(key) );
+    batch.Put( _cf, timeKey(newtime, key), binDataKeyTuple(key) );
 
     rocksdb::Status status = _db->Write(rocksdb::WriteOptions(), &batch);
     if ( !status.ok() )
@@ -546,25 +641,67 @@ RocksDBCacheBin::touch(const std::string& key)
     return status.ok();
 }
 
+bool
+RocksDBCacheBin::clearColumnFamily(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* cf)
+{
+    std::string first, last;
+    rocksdb::Iterator* i = db->NewIterator(rocksdb::ReadOptions(), cf);
+    i->SeekToFirst();
+    if ( i->Valid() )
+    {
+        first = i->key().ToString();
+        i->SeekToLast();
+        last = i->key().ToString();
+    }
+    delete i;
+
+    if ( first.empty() && last.empty() )
+        return true;
+
+    // One range tombstone instead of a delete per record;
+    // the end of the range is exclusive.
+    rocksdb::WriteOptions wo;
+    bool ok =
+        db->DeleteRange( wo, cf, first, last ).ok() &&
+        db->Delete( wo, cf, last ).ok();
+
+    // reclaim the space now
+    if ( ok )
+        db->CompactRange( rocksdb::CompactRangeOptions(), cf, 0L, 0L );
+
+    return ok;
+}
+
 bool
 RocksDBCacheBin::clear()
 {
     if ( !binValidForWriting() )
         return false;
-    
-    rocksdb::WriteOptions wo;
-    std::string binphrase = binPhrase();
-    rocksdb::WriteBatch batch;
-    rocksdb::Iterator* i = _db->NewIterator(rocksdb::ReadOptions());
-    for(i->SeekToFirst(); i->Valid(); i->Next())
+
+    if ( _ownsColumnFamily )
     {
-        std::string key = i->key().ToString();
-        if ( key.find(binphrase) != std::string::npos )
+        if ( !clearColumnFamily(_db, _cf) )
         {
-            _db->Delete( wo, i->key() );
+            OE_WARN << LC << "Failed to clear bin " << getID() << std::endl;
+            return false;
         }
     }
-    delete i;
+    else
+    {
+        // Shared keyspace: look for this bin's records one by one.
+        rocksdb::WriteOptions wo;
+        std::string binphrase = binPhrase();
+        rocksdb::Iterator* i = _db->NewIterator(rocksdb::ReadOptions(), _cf);
+        for(i->SeekToFirst(); i->Valid(); i->Next())
+        {
+            std::string key = i->key().ToString();
+            if ( key.find(binphrase) != std::string::npos )
+            {
+                _db->Delete( wo, _cf, i->key() );
+            }
+        }
+        delete i;
+    }
 
     if ( _debug )
     {
@@ -580,10 +717,10 @@ RocksDBCacheBin::compact()
     if ( !binValidForWriting() )
         return false;
 
-    // This could take a while.
-    _db->CompactRange(0L, 0L);
+    // This could take a while, unless the bin has a family of its own.
+    _db->CompactRange(rocksdb::CompactRangeOptions(), _cf, 0L, 0L);
 
-    return false;
+    return true;
 }
 
 unsigned
@@ -601,7 +738,7 @@ RocksDBCacheBin::getStorageSize()
     ranges[2] = rocksdb::Range(timeBegin(), timeEnd());
     sizes[0] = sizes[1] = sizes[2] = 0;
 
-    _db->GetApproximateSizes( ranges, 3, sizes );
+    _db->GetApproximateSizes( _cf, ranges, 3, sizes );
     return sizes[0] + sizes[1] + sizes[2];
 }
 
@@ -614,7 +751,7 @@ RocksDBCacheBin::readMetadata()
     ScopedMutexLock exclusiveLock( _rwMutex );
 
     std::string binvalue;
-    rocksdb::Status status = _db->Get(rocksdb::ReadOptions(), binKey(), &binvalue);
+    rocksdb::Status status = _db->Get(rocksdb::ReadOptions(), _cf, binKey(), &binvalue);
     if ( !status.ok() )
         return Config();
 
@@ -638,7 +775,7 @@ RocksDBCacheBin::writeMetadata(const Config& conf)
     std::string value;
     encodeMeta(mutableConf, value);
 
-    if ( _db->Put(rocksdb::WriteOptions(), binKey(), value).ok() == false )
+    if ( _db->Put(rocksdb::WriteOptions(), _cf, binKey(), value).ok() == false )
     {
         OE_WARN << LC << "Failed to write metadata record for bin (" << getID() << ")" << std::endl;
         return false;
@@ -653,12 +790,12 @@ RocksDBCacheBin::purgeOldest(unsigned maxnum)
     if ( !binValidForWriting() )
         return false;
 
-    rocksdb::Iterator* it = _db->NewIterator(rocksdb::ReadOptions());
+    rocksdb::Iterator* it = _db->NewIterator(rocksdb::ReadOptions(), _cf);
 
     unsigned count = 0;
     std::string limit = timeEndGlobal();
 
-    // note: this will delete records NOT OF THIS BIN as well!
+    // note: in a shared keyspace this will delete records NOT OF THIS BIN as well!
     for(it->Seek(timeBeginGlobal());
         count < maxnum && it->Valid() && it->key().ToString() < limit;
         it->Next(), ++count )
@@ -671,9 +808,9 @@ RocksDBCacheBin::purgeOldest(unsigned maxnum)
         // doing this in a WriteBatch did not work. The size of the
         // database would never go down.
         rocksdb::WriteOptions wo;
-        _db->Delete( wo, dataKeyFromTuple(tuple) );
-        _db->Delete( wo, metaKeyFromTuple(tuple) );
-        _db->Delete( wo, it->key() );
+        _db->Delete( wo, _cf, dataKeyFromTuple(tuple) );
+        _db->Delete( wo, _cf, metaKeyFromTuple(tuple) );
+        _db->Delete( wo, _cf, it->key() );
     }
 
     delete it;
@@ -0,0 +1,443 @@
+/* -*-c++-*- */
+/* osgEarth - Dynamic map generation toolkit for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "TieredCache"
+#include <osgEarth/Cache>
+#include <osgEarth/MemCache>
+#include <osgEarth/StringUtils>
+#include <osgEarth/Threading>
+#include <osgDB/FileNameUtils>
+#include <functional>
+
+using namespace osgEarth;
+using namespace osgEarth::Drivers;
+using namespace osgEarth::Threading;
+
+#define LC "[TieredCache] "
+
+namespace
+{
+    //! One link in the chain
+    struct Tier
+    {
+        osg::ref_ptr<Cache> _cache;
+        bool _write;
+        bool _promote;
+    };
+
+    //! A tier's bin for one TieredCacheBin
+    struct TierBin
+    {
+        osg::ref_ptr<CacheBin> _bin;
+        bool _write;
+        bool _promote;
+    };
+
+    /**
+     * Cache bin that reads through a list of bins, fastest first.
+     */
+    class TieredCacheBin : public CacheBin
+    {
+    public:
+        TieredCacheBin(const std::string& binID, const std::vector<TierBin>& bins) :
+            CacheBin(binID),
+            _bins(bins) { }
+
+    public: // CacheBin interface
+
+        ReadResult readObject(const std::string& key, const osgDB::Options* dbo) override
+        {
+            return read(
+                [&](CacheBin* bin) { return bin->readObject(key, dbo); },
+                [&](CacheBin* bin, const ReadResult& r) { bin->write(key, r.getObject(), r.metadata(), dbo); });
+        }
+
+        ReadResult readImage(const std::string& key, const osgDB::Options* dbo) override
+        {
+            return read(
+                [&](CacheBin* bin) { return bin->readImage(key, dbo); },
+                [&](CacheBin* bin, const ReadResult& r) { bin->write(key, r.getObject(), r.metadata(), dbo); });
+        }
+
+        ReadResult readString(const std::string& key, const osgDB::Options* dbo) override
+        {
+            return read(
+                [&](CacheBin* bin) { return bin->readString(key, dbo); },
+                [&](CacheBin* bin, const ReadResult& r) { bin->write(key, r.getObject(), r.metadata(), dbo); });
+        }
+
+        bool write(const std::string& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo) override
+        {
+            bool ok = false;
+            for (auto& tier : _bins)
+            {
+                if (tier._write)
+                    ok = tier._bin->write(key, object, meta, dbo) || ok;
+            }
+            return ok;
+        }
+
+        RecordStatus getRecordStatus(const std::string& key) override
+        {
+            for (auto& tier : _bins)
+            {
+                RecordStatus status = tier._bin->getRecordStatus(key);
+                if (status != STATUS_NOT_FOUND)
+                    return status;
+            }
+            return STATUS_NOT_FOUND;
+        }
+
+        ReadResult readObject(const TileRecordKey& key, const osgDB::Options* dbo) override
+        {
+            return read(
+                [&](CacheBin* bin) { return bin->readObject(key, dbo); },
+                [&](CacheBin* bin, const ReadResult& r) { bin->write(key, r.getObject(), r.metadata(), dbo); });
+        }
+
+        ReadResult readImage(const TileRecordKey& key, const osgDB::Options* dbo) override
+        {
+            return read(
+                [&](CacheBin* bin) { return bin->readImage(key, dbo); },
+                [&](CacheBin* bin, const ReadResult& r) { bin->write(key, r.getObject(), r.metadata(), dbo); });
+        }
+
+        bool write(const TileRecordKey& key, const osg::Object* object, const Config& meta, const osgDB::Options* dbo) override
+        {
+            bool ok = false;
+            for (auto& tier : _bins)
+            {
+                if (tier._write)
+                    ok = tier._bin->write(key, object, meta, dbo) || ok;
+            }
+            return ok;
+        }
+
+        RecordStatus getRecordStatus(const TileRecordKey& key) override
+        {
+            for (auto& tier : _bins)
+            {
+                RecordStatus status = tier._bin->getRecordStatus(key);
+                if (status != STATUS_NOT_FOUND)
+                    return status;
+            }
+            return STATUS_NOT_FOUND;
+        }
+
+        bool remove(const std::string& key) override
+        {
+            // only from the tiers this cache writes to
+            bool ok = false;
+            for (auto& tier : _bins)
+            {
+                if (tier._write || tier._promote)
+                    ok = tier._bin->remove(key) || ok;
+            }
+            return ok;
+        }
+
+        bool touch(const std::string& key) override
+        {
+            for (auto& tier : _bins)
+            {
+                if (tier._bin->touch(key))
+                    return true;
+            }
+            return false;
+        }
+
+        bool clear() override
+        {
+            bool ok = false;
+            for (auto& tier : _bins)
+            {
+                if (tier._write || tier._promote)
+                    ok = tier._bin->clear() || ok;
+            }
+            return ok;
+        }
+
+        bool compact() override
+        {
+            bool ok = false;
+            for (auto& tier : _bins)
+            {
+                if (tier._write || tier._promote)
+                    ok = tier._bin->compact() || ok;
+            }
+            return ok;
+        }
+
+        unsigned getStorageSize() override
+        {
+            unsigned total = 0u;
+            for (auto& tier : _bins)
+                total += tier._bin->getStorageSize();
+            return total;
+        }
+
+    protected:
+        typedef std::function<ReadResult(CacheBin*)> Reader;
+        typedef std::function<void(CacheBin*, const ReadResult&)> Promoter;
+
+        ReadResult read(const Reader& reader, const Promoter& promoter)
+        {
+            ReadResult result;
+            for (unsigned i = 0; i < _bins.size(); ++i)
+            {
+                ReadResult r = reader(_bins[i]._bin.get());
+                if (r.succeeded())
+                {
+                    // promote the record to the faster tiers that missed it.
+                    // The copies take the current time, so they expire
+                    // later than the original would.
+                    for (unsigned j = 0; j < i; ++j)
+                    {
+                        if (_bins[j]._promote)
+                            promoter(_bins[j]._bin.get(), r);
+                    }
+                    return r;
+                }
+                else if (i == 0u || r.code() != ReadResult::RESULT_NOT_FOUND)
+                {
+                    // keep the most telling failure
+                    result = r;
+                }
+            }
+            return result;
+        }
+
+        std::vector<TierBin> _bins;
+    };
+
+    /**
+     * Cache that chains other caches, fastest first.
+     */
+    class TieredCache : public Cache
+    {
+    public:
+        TieredCache() { } // unused
+        TieredCache( const TieredCache& rhs, const osg::CopyOp& op ) { } // unused
+        META_Object( osgEarth, TieredCache );
+
+        TieredCache( const CacheOptions& options );
+
+    public: // Cache interface
+
+        CacheBin* addBin( const std::string& binID ) override;
+
+        CacheBin* getOrCreateDefaultBin() override;
+
+        off_t getApproximateSize() const override;
+
+        bool compact() override;
+
+        bool clear() override;
+
+        void setNumThreads(unsigned num) override;
+
+    protected:
+        std::vector<Tier> _tiers;
+    };
+}
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    TieredCache::TieredCache(const CacheOptions& options) :
+        Cache(options)
+    {
+        TieredCacheOptions tco( options );
+
+        for (unsigned i = 0; i < tco.tiers().size(); ++i)
+        {
+            TieredCacheTierOptions& tierOptions = tco.tiers()[i];
+
+            Tier tier;
+            tier._write = tierOptions.write().get();
+            tier._promote = tierOptions.promote().get();
+
+            if (tierOptions.getDriver() == "memory")
+            {
+                tier._cache = new MemCache(
+                    tierOptions.maxEntries().get(),
+                    (std::size_t)tierOptions.maxMB().get() * 1024u * 1024u);
+            }
+            else if (tierOptions.getDriver() == "tiered")
+            {
+                OE_WARN << LC << "Tier " << i << ": a tiered cache can't be a tier; skipping" << std::endl;
+                continue;
+            }
+            else
+            {
+                tier._cache = CacheFactory::create(tierOptions);
+            }
+
+            if (!tier._cache.valid() || tier._cache->getStatus().isError())
+            {
+                OE_WARN << LC << "Tier " << i << " (" << tierOptions.getDriver() << ") is unavailable: "
+                    << (tier._cache.valid() ? tier._cache->getStatus().message() : "no driver") << std::endl;
+                continue;
+            }
+
+            OE_INFO << LC << "Tier " << i << ": " << tierOptions.getDriver()
+                << (tier._write ? "" : " (read only)") << std::endl;
+
+            _tiers.push_back(tier);
+        }
+
+        if (_tiers.empty())
+        {
+            _status.set(Status::ConfigurationError, "No usable cache tiers");
+        }
+    }
+
+    CacheBin*
+    TieredCache::addBin( const std::string& name )
+    {
+        if (getStatus().isError())
+            return NULL;
+
+        CacheBin* existing = _bins.get(name);
+        if (existing)
+            return existing;
+
+        std::vector<TierBin> bins;
+        for (auto& tier : _tiers)
+        {
+            CacheBin* bin = tier._cache->addBin(name);
+            if (bin)
+            {
+                TierBin tierBin;
+                tierBin._bin = bin;
+                tierBin._write = tier._write;
+                tierBin._promote = tier._promote;
+                bins.push_back(tierBin);
+            }
+        }
+
+        if (bins.empty())
+            return NULL;
+
+        return _bins.getOrCreate(name, new TieredCacheBin(name, bins));
+    }
+
+    CacheBin*
+    TieredCache::getOrCreateDefaultBin()
+    {
+        if (getStatus().isError())
+            return NULL;
+
+        static Mutex s_defaultBinMutex(OE_MUTEX_NAME);
+        if ( !_defaultBin.valid() )
+        {
+            ScopedMutexLock lock( s_defaultBinMutex );
+            if ( !_defaultBin.valid() ) // double-check
+            {
+                std::vector<TierBin> bins;
+                for (auto& tier : _tiers)
+                {
+                    CacheBin* bin = tier._cache->getOrCreateDefaultBin();
+                    if (bin)
+                    {
+                        TierBin tierBin;
+                        tierBin._bin = bin;
+                        tierBin._write = tier._write;
+                        tierBin._promote = tier._promote;
+                        bins.push_back(tierBin);
+                    }
+                }
+
+                if (!bins.empty())
+                    _defaultBin = new TieredCacheBin("__default", bins);
+            }
+        }
+        return _defaultBin.get();
+    }
+
+    off_t
+    TieredCache::getApproximateSize() const
+    {
+        off_t total = 0;
+        for (auto& tier : _tiers)
+            total += tier._cache->getApproximateSize();
+        return total;
+    }
+
+    bool
+    TieredCache::compact()
+    {
+        bool ok = false;
+        for (auto& tier : _tiers)
+        {
+            if (tier._write || tier._promote)
+                ok = tier._cache->compact() || ok;
+        }
+        return ok;
+    }
+
+    bool
+    TieredCache::clear()
+    {
+        bool ok = false;
+        for (auto& tier : _tiers)
+        {
+            if (tier._write || tier._promote)
+                ok = tier._cache->clear() || ok;
+        }
+        return ok;
+    }
+
+    void
+    TieredCache::setNumThreads(unsigned num)
+    {
+        for (auto& tier : _tiers)
+            tier._cache->setNumThreads(num);
+    }
+}
+
+//------------------------------------------------------------------------
+
+/**
+ * Cache that chains other caches (e.g. memory, then a local disk, then a
+ * shared network cache) with read-through and promote-on-hit.
+ */
+class TieredCacheDriver : public CacheDriver
+{
+public:
+    TieredCacheDriver()
+    {
+        supportsExtension( "osgearth_cache_tiered", "Tiered cache for osgEarth" );
+    }
+
+    virtual const char* className() const
+    {
+        return "Tiered cache for osgEarth";
+    }
+
+    virtual ReadResult readObject(const std::string& file_name, const Options* options) const
+    {
+        if ( !acceptsExtension(osgDB::getLowerCaseFileExtension( file_name )))
+            return ReadResult::FILE_NOT_HANDLED;
+
+        return ReadResult( new TieredCache( getCacheOptions(options) ) );
+    }
+};
+
+REGISTER_OSGPLUGIN(osgearth_cache_tiered, TieredCacheDriver)
@@ -20,6 +20,7 @@
 #include <osgEarth/Map>
 #include <osgEarth/MapNode>
 #include <osgEarth/Registry>
+#include <osgEarth/StartupCache>
 #include <osgEarth/XmlUtils>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
@@ -222,11 +223,35 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
             // from an "anonymous" stream here)
             URIContext uriContext( readOptions ); 
 
-            osg::ref_ptr<XmlDocument> doc = XmlDocument::load( in, uriContext );
-            if ( !doc.valid() )
-                return ReadResult::ERROR_IN_READING_FILE;
+            // An unchanged earth file can skip the XML parser, unless it
+            // includes other files, which may have changed.
+            std::stringstream buffer;
+            buffer << in.rdbuf();
+            std::string contents = buffer.str();
 
-            Config docConf = doc->getConfig();
+            bool cacheable =
+                StartupCache::enabled() &&
+                contents.find("xi:include") == std::string::npos;
+
+            Config docConf;
+            if ( cacheable && StartupCache::getConfig(contents, docConf) )
+            {
+                docConf.setReferrer( URI("", uriContext).full() );
+            }
+            else
+            {
+                std::stringstream xmlIn( contents );
+                osg::ref_ptr<XmlDocument> doc = XmlDocument::load( xmlIn, uriContext );
+                if ( !doc.valid() )
+                    return ReadResult::ERROR_IN_READING_FILE;
+
+                docConf = doc->getConfig();
+
+                if ( cacheable )
+                {
+                    StartupCache::putConfig(contents, docConf);
+                }
+            }
 
             // support both "map" and "earth" tag names at the top level
             Config conf;
@@ -296,6 +321,9 @@ class ReaderWriterEarth : public osgDB::ReaderWriter
                 }
             }
 
+            // keep what this load resolved for the next run
+            StartupCache::save();
+
             return ReadResult(node.get());
         }
 };
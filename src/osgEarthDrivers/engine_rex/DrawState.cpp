@@ -55,6 +55,8 @@ PerProgramState::refresh(osg::RenderInfo& ri, const RenderBindings* bindings)
         _layerUidUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_layer_uid"));
         _layerOrderUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_layer_order"));
         _morphConstantsUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_tile_morph"));
+        _pageState[0]._slotUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_layer_texSlot"));
+        _pageState[1]._slotUL = pcp->getUniformLocation(osg::Uniform::getNameID("oe_layer_texParentSlot"));
     }
 }
 
@@ -65,6 +67,8 @@ PerProgramState::clear()
     _morphConstants.clear();
     _parentTextureExists.clear();
     _samplerState.clear();
+    _pageState[0].clear();
+    _pageState[1].clear();
 }
 
 
@@ -86,9 +86,41 @@ DrawTileCommand::draw(osg::RenderInfo& ri, DrawState& dsMaster, osg::Referenced*
                 {
                     return;
                 }
-                
-                state.setActiveTextureUnit((*dsMaster._bindings)[s].unit());
-                sampler._texture->apply(state);
+
+                // with texture pages, a paged texture binds its page to the
+                // page unit and selects its slot; anything else binds normally
+                // and sets the slot to -1 so the shader reads the sampler2D.
+                const PagedTexture* paged = dsMaster._texturePages ?
+                    dynamic_cast<const PagedTexture*>(sampler._texture.get()) : nullptr;
+
+                if (paged)
+                {
+                    TexturePageState& pageState = ds._pageState[s];
+                    osg::Texture* page = paged->getPage()->getTexture();
+                    if (!pageState._page.isSetTo(page))
+                    {
+                        state.setActiveTextureUnit(dsMaster._texturePages->unit(s));
+                        paged->apply(state);
+                        pageState._page = page;
+                    }
+                }
+                else
+                {
+                    state.setActiveTextureUnit((*dsMaster._bindings)[s].unit());
+                    sampler._texture->apply(state);
+                }
+
+                if (dsMaster._texturePages)
+                {
+                    TexturePageState& pageState = ds._pageState[s];
+                    int slot = paged ? (int)paged->getSlot() : -1;
+                    if (pageState._slotUL >= 0 && !pageState._slot.isSetTo(slot))
+                    {
+                        ext->glUniform1i(pageState._slotUL, slot);
+                        pageState._slot = slot;
+                    }
+                }
+
                 samplerState._texture = sampler._texture.get();
             }
 
@@ -137,6 +169,7 @@ DrawTileCommand::draw(osg::RenderInfo& ri, DrawState& dsMaster, osg::Referenced*
         PatchLayer::DrawContext tileData;
 
         tileData._key = _key;
+        tileData._revision = _tileRevision;
         tileData._geomBBox = &_geom->getBoundingBox();
         tileData._tileBBox = &_tile->getBoundingBox();
         _drawCallback->drawTile(ri, tileData);
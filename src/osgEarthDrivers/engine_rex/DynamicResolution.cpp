@@ -0,0 +1,122 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2008-2014 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "DynamicResolution"
+#include <osgEarth/Notify>
+#include <osg/Math>
+
+using namespace osgEarth::REX;
+using namespace osgEarth;
+
+#undef  LC
+#define LC "[DynamicResolution] "
+
+namespace
+{
+    // Frames that run up to this much over the target still count as on
+    // target, so ordinary vsync jitter doesn't cost detail.
+    const double FRAME_TIME_TOLERANCE = 1.2;
+
+    // Weight of the newest frame in the smoothed frame time
+    const double SMOOTHING = 0.1;
+
+    // Scale change per step: quick to shed detail, slow to restore it
+    const float DECREASE_DETAIL_STEP = 1.15f;
+    const float INCREASE_DETAIL_STEP = 1.05f;
+
+    // Seconds between steps that shed detail, so one step can take
+    // effect before the next
+    const double DECREASE_DETAIL_DELAY = 0.5;
+
+    // Seconds of on-target frames before a step that restores detail,
+    // and the most that backing off may stretch it to
+    const double MIN_RECOVER_DELAY = 2.0;
+    const double MAX_RECOVER_DELAY = 32.0;
+
+    // Frames longer than this are hitches (loading, window moves) and are
+    // left out of the measurement
+    const double MAX_FRAME_TIME = 250.0;
+}
+
+DynamicResolution::DynamicResolution(float targetFrameTime, float maxScale) :
+    _target(osg::maximum(targetFrameTime, 1.0f)),
+    _maxScale(osg::maximum(maxScale, 1.0f)),
+    _scale(1.0f),
+    _frameTime(-1.0),
+    _lastFrame(-1.0),
+    _lastChange(0.0),
+    _recoverDelay(MIN_RECOVER_DELAY),
+    _lastChangeWasIncrease(false)
+{
+    OE_INFO << LC << "Target frame time = " << _target << " ms, max LOD scale = " << _maxScale << std::endl;
+}
+
+void
+DynamicResolution::update(const osg::FrameStamp* fs)
+{
+    if (fs == nullptr)
+        return;
+
+    double now = fs->getReferenceTime();
+    double last = _lastFrame;
+    _lastFrame = now;
+
+    if (last < 0.0)
+    {
+        _lastChange = now;
+        return;
+    }
+
+    double frameTime = (now - last) * 1000.0;
+    if (frameTime <= 0.0 || frameTime > MAX_FRAME_TIME)
+        return;
+
+    _frameTime = _frameTime < 0.0 ? frameTime : _frameTime + (frameTime - _frameTime) * SMOOTHING;
+
+    float scale = _scale.load();
+    double sinceChange = now - _lastChange;
+
+    if (_frameTime > _target * FRAME_TIME_TOLERANCE)
+    {
+        if (scale < _maxScale && sinceChange >= DECREASE_DETAIL_DELAY)
+        {
+            // the detail we just restored was too much; wait longer next time
+            if (_lastChangeWasIncrease && sinceChange < _recoverDelay * 2.0)
+                _recoverDelay = osg::minimum(_recoverDelay * 2.0, MAX_RECOVER_DELAY);
+
+            _scale.store(osg::minimum(scale * DECREASE_DETAIL_STEP, _maxScale));
+            _lastChange = now;
+            _lastChangeWasIncrease = false;
+        }
+    }
+    else if (scale > 1.0f && sinceChange >= _recoverDelay)
+    {
+        // the last step held, so the next one can come a little sooner
+        if (_lastChangeWasIncrease)
+            _recoverDelay = osg::maximum(_recoverDelay * 0.5, MIN_RECOVER_DELAY);
+
+        _scale.store(osg::maximum(scale / INCREASE_DETAIL_STEP, 1.0f));
+        _lastChange = now;
+        _lastChangeWasIncrease = true;
+    }
+    else if (scale <= 1.0f && sinceChange >= MAX_RECOVER_DELAY)
+    {
+        // a long stretch at full detail; forget the old back-offs
+        _recoverDelay = MIN_RECOVER_DELAY;
+    }
+}
@@ -20,6 +20,7 @@
 #include "TileNodeRegistry"
 #include <osgEarth/CullingUtils>
 #include <osgEarth/Registry>
+#include <osgEarth/Capabilities>
 
 using namespace osgEarth::REX;
 using namespace osgEarth;
@@ -54,6 +55,56 @@ _clock(clock)
 {
     _expirationRange2 = _options.minExpiryRange().get() * _options.minExpiryRange().get();
     _bboxCB = new ModifyBoundingBoxCallback(this);
+
+    // Multi-draw needs indirect draws with gl_BaseInstance, and bindless
+    // textures so that every tile in a layer can share one draw call.
+    // Tessellation shaders don't read the per-tile buffer, so no MDI there.
+    const Capabilities& caps = Registry::capabilities();
+    _useMultiDrawIndirect =
+        _options.useMultiDrawIndirect() == true &&
+        _options.gpuTessellation() == false &&
+        caps.supportsMultiDrawIndirect() &&
+        caps.supportsBindlessTexture();
+
+    if (_options.useMultiDrawIndirect() == true && !_useMultiDrawIndirect)
+    {
+        OE_INFO << LC << "Multi-draw indirect requested but not available; using per-tile draws" << std::endl;
+    }
+
+    // Scales terrain detail to hold a frame time
+    if (_options.dynamicResolution() == true)
+    {
+        _dynamicResolution = new DynamicResolution(
+            _options.targetFrameTime().get(),
+            _options.maxDynamicLODScale().get());
+    }
+
+    // Texture pages replace per-tile textures with slots in shared arrays.
+    // The MDI path already avoids per-tile binds with bindless handles.
+    if (_options.useTexturePages() == true)
+    {
+        if (caps.supportsTextureArrays() && !_useMultiDrawIndirect)
+        {
+            _texturePages = new TexturePagePool();
+        }
+        else
+        {
+            OE_INFO << LC << "Texture pages requested but not available; using per-tile textures" << std::endl;
+        }
+    }
+
+    // GPU culling works on the multi-draw command buffer, in a compute shader.
+    if (_options.gpuCulling() == true)
+    {
+        if (_useMultiDrawIndirect && caps.supportsGLSL(430u))
+        {
+            _gpuCuller = new GPUCuller(map);
+        }
+        else
+        {
+            OE_INFO << LC << "GPU culling requested but not available; culling on the CPU" << std::endl;
+        }
+    }
 }
 
 osg::ref_ptr<const Map>
@@ -0,0 +1,145 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2008-2014 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "GPUCuller"
+#include "Shaders"
+#include <osgEarth/ShaderLoader>
+#include <osgEarth/GLUtils>
+#include <osg/Polytope>
+
+using namespace osgEarth::REX;
+using namespace osgEarth;
+
+#undef  LC
+#define LC "[GPUCuller] "
+
+#define WORK_GROUP_SIZE 64u
+
+static_assert(sizeof(GPUCuller::CullTile) == 80, "CullTile must match the std430 layout of oe_rex_CullTile");
+
+GPUCuller::GPUCuller(const Map* map) :
+    _horizonRadius(0.0f)
+{
+    _locations.resize(64u);
+
+    Shaders package;
+    std::string source = ShaderLoader::load(package.ENGINE_CULL, package);
+    _program = new osg::Program();
+    _program->setName("Rex GPU Culler");
+    _program->addShader(new osg::Shader(osg::Shader::COMPUTE, source));
+
+    // Horizon culling only makes sense on a geocentric map. The smaller
+    // radius of the ellipsoid makes for a conservative occluder.
+    const SpatialReference* srs = map ? map->getSRS() : nullptr;
+    if (srs && srs->isGeographic() && srs->getEllipsoid())
+    {
+        const osg::EllipsoidModel* e = srs->getEllipsoid();
+        _horizonRadius = (float)osg::minimum(e->getRadiusEquator(), e->getRadiusPolar());
+    }
+}
+
+void
+GPUCuller::operator()(osg::State& state, GLBuffer* commands, GLsizei numCommands) const
+{
+    if (numCommands <= 0 || commands == nullptr)
+        return;
+
+    osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+
+    osg::Program::PerContextProgram* pcp = _program->getPCP(state);
+    if (pcp->needsLink())
+    {
+        pcp->linkProgram(state);
+    }
+
+    // No usable program, so draw everything; it's still correct, just slower.
+    if (!pcp->isLinked())
+    {
+        return;
+    }
+
+    Locations& loc = _locations[state.getContextID()];
+    if (!loc._valid)
+    {
+        loc._numCommands = ext->glGetUniformLocation(pcp->getHandle(), "oe_rex_cull_numCommands");
+        loc._planes = ext->glGetUniformLocation(pcp->getHandle(), "oe_rex_cull_planes");
+        loc._horizon = ext->glGetUniformLocation(pcp->getHandle(), "oe_rex_cull_horizon");
+        loc._valid = true;
+    }
+
+    // Side planes of the frustum in view space. Near and far are left out,
+    // since the near/far range isn't final until the whole scene is culled.
+    osg::Polytope frustum;
+    frustum.setToUnitFrustum(false, false);
+    frustum.transformProvidingInverse(state.getProjectionMatrix());
+
+    GLfloat planes[4 * 4];
+    unsigned p = 0;
+    for (osg::Polytope::PlaneList::iterator i = frustum.getPlaneList().begin();
+        i != frustum.getPlaneList().end() && p < 4;
+        ++i, ++p)
+    {
+        osg::Plane plane = *i;
+        plane.makeUnitLength();
+        for (unsigned j = 0; j < 4; ++j)
+            planes[p * 4 + j] = (GLfloat)plane[j];
+    }
+
+    // The surface draws under identity, so the initial view matrix
+    // takes the ellipsoid center into view space.
+    osg::Vec3d center = osg::Vec3d(0, 0, 0) * state.getInitialViewMatrix();
+    osg::Vec4f horizon(center, _horizonRadius);
+
+    pcp->useProgram();
+
+    ext->glUniform1ui(loc._numCommands, (GLuint)numCommands);
+    ext->glUniform4fv(loc._planes, 4, planes);
+    ext->glUniform4fv(loc._horizon, 1, horizon.ptr());
+
+    ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BUFFER_BINDING, commands->name());
+
+    ext->glDispatchCompute((numCommands + WORK_GROUP_SIZE - 1u) / WORK_GROUP_SIZE, 1, 1);
+
+    // The draw reads the instance counts as indirect commands.
+    ext->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    // Put back the surface program without telling osg::State it ever changed.
+    const osg::Program::PerContextProgram* last = state.getLastAppliedProgramObject();
+    if (last)
+        last->useProgram();
+    else
+        ext->glUseProgram(0);
+}
+
+void
+GPUCuller::resizeGLObjectBuffers(unsigned maxSize)
+{
+    _program->resizeGLObjectBuffers(maxSize);
+    _locations.resize(maxSize);
+}
+
+void
+GPUCuller::releaseGLObjects(osg::State* state) const
+{
+    _program->releaseGLObjects(state);
+
+    if (state)
+        _locations[state->getContextID()] = Locations();
+    else
+        _locations.setAllElementsTo(Locations());
+}
@@ -22,6 +22,9 @@
 #include <osgEarth/NodeUtils>
 #include <osgEarth/TopologyGraph>
 #include <osgEarth/Metrics>
+#include <osgEarth/Registry>
+#include <osgEarth/Capabilities>
+#include <osgEarth/Cache>
 #include <osg/Point>
 #include <osgUtil/MeshOptimizers>
 #include <cstdlib> // for getenv
@@ -31,12 +34,23 @@ using namespace osgEarth::REX;
 
 #define LC "[GeometryPool] "
 
+// pre OSG-3.6 support
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+// Number of edited tile meshes to keep around for tiles that page back in
+#define EDITED_MESH_CACHE_SIZE 256u
+
 
 GeometryPool::GeometryPool(const TerrainOptions& options) :
 _options ( options ),
 _enabled ( true ),
 _debug   ( false ),
-_geometryMapMutex("GeometryPool(OE)")
+_useArena( false ),
+_usePatchMesh( false ),
+_geometryMapMutex("GeometryPool(OE)"),
+_editedMeshes(true, EDITED_MESH_CACHE_SIZE)
 {
     ADJUST_UPDATE_TRAV_COUNT(this, +1);
 
@@ -51,6 +65,45 @@ _geometryMapMutex("GeometryPool(OE)")
         _enabled = false;
         OE_INFO << LC << "Geometry pool disabled (environment)" << std::endl;
     }
+
+    if (_enabled && _options.useGeometryArena() == true)
+    {
+        if (Registry::capabilities().supportsDrawElementsBaseVertex())
+        {
+            _useArena = true;
+            OE_INFO << LC << "Using shared geometry arenas" << std::endl;
+        }
+        else
+        {
+            OE_INFO << LC << "Geometry arenas requested but not supported by the GPU" << std::endl;
+        }
+    }
+
+    if (_options.gpuTessellation() == true && _options.compactTessellationMesh() == true)
+    {
+        _usePatchMesh = true;
+        OE_INFO << LC << "Using compact patch meshes for GPU tessellation" << std::endl;
+    }
+}
+
+unsigned
+GeometryPool::getPatchMeshSize(unsigned tileSize) const
+{
+    // One patch vertex for every four grid cells; the tessellator
+    // makes up the rest of the detail.
+    return osg::maximum((tileSize - 1u) / 4u, 1u) + 1u;
+}
+
+float
+GeometryPool::getSkirtRatio() const
+{
+    return _usePatchMesh ? 0.0f : _options.heightFieldSkirtRatio().get();
+}
+
+bool
+GeometryPool::useMorphArrays() const
+{
+    return _options.morphTerrain() == true && !_usePatchMesh;
 }
 
 void
@@ -61,25 +114,36 @@ GeometryPool::getPooledGeometry(
     osg::ref_ptr<SharedGeometry>& out,
     Cancelable* progress)
 {
+    // Unedited tiles use the coarse patch grid when it's on; an edited
+    // mesh always starts from the full tile grid.
+    unsigned meshSize = _usePatchMesh ? getPatchMeshSize(tileSize) : tileSize;
+
     // convert to a unique-geometry key:
     GeometryKey geomKey;
-    createKeyForTileKey( tileKey, tileSize, geomKey );
+    createKeyForTileKey( tileKey, meshSize, geomKey );
 
     // make our globally shared EBO if we need it
     {
         Threading::ScopedMutexLock lock(_geometryMapMutex);
         if (!_defaultPrimSet.valid())
         {
-            _defaultPrimSet = createPrimitiveSet(tileSize);
+            _defaultPrimSet = createPrimitiveSet(meshSize);
         }
     }
 
-    MeshEditor meshEditor(tileKey, tileSize, map, nullptr);
+    MeshEditor meshEditor(tileKey, tileSize, map);
 
     if ( _enabled )
     {
+        // A tile under terrain constraints can't share its mesh with other
+        // tiles, so reuse the edited mesh from the last time instead:
+        if (meshEditor.hasConstraints() &&
+            getEditedGeometry(tileKey, tileSize, meshEditor, out, progress))
+        {
+            return;
+        }
+
         // first check the sharing cache:
-        if (!meshEditor.hasEdits())
         {
             Threading::ScopedMutexLock lock(_geometryMapMutex);
             GeometryMap::iterator i = _geometryMap.find(geomKey);
@@ -92,12 +156,18 @@ GeometryPool::getPooledGeometry(
 
         if (!out.valid())
         {    
-            out = createGeometry(tileKey, tileSize, meshEditor, progress);
+            out = createGeometry(tileKey, meshSize, meshEditor, progress);
             
-            // only store as a shared geometry if there are no constraints.
-            if (out.valid() && !meshEditor.hasEdits())
+            // store as a shared geometry:
+            if (out.valid())
             {
                 Threading::ScopedMutexLock lock(_geometryMapMutex);
+
+                if (_useArena)
+                {
+                    addToArena(out.get());
+                }
+
                 _geometryMap[geomKey] = out.get();
             }
         }
@@ -105,7 +175,213 @@ GeometryPool::getPooledGeometry(
 
     else
     {
-        out = createGeometry(tileKey, tileSize, meshEditor, progress);
+        if (meshEditor.hasConstraints())
+        {
+            meshEditor.readEdits(nullptr);
+        }
+
+        out = createGeometry(
+            tileKey,
+            meshEditor.hasEdits() ? tileSize : meshSize,
+            meshEditor,
+            progress);
+    }
+}
+
+bool
+GeometryPool::getEditedGeometry(
+    const TileKey& tileKey,
+    unsigned tileSize,
+    MeshEditor& editor,
+    osg::ref_ptr<SharedGeometry>& out,
+    Cancelable* progress)
+{
+    // The revision key changes whenever the constraints on this tile do,
+    // so a stale mesh is never found here.
+    EditedMeshCache::Record record;
+    if (_editedMeshes.get(editor.getRevisionKey(), record))
+    {
+        out = record.value()._geometry.get();
+        return record.value()._hasEdits;
+    }
+
+    if (!editor.readEdits(nullptr))
+    {
+        return true;
+    }
+
+    EditedMesh mesh;
+    mesh._hasEdits = editor.hasEdits();
+
+    if (mesh._hasEdits &&
+        !readEditedGeometry(tileKey, editor, mesh._geometry))
+    {
+        mesh._geometry = createGeometry(tileKey, tileSize, editor, progress);
+
+        // don't remember a mesh that was cut short
+        if (progress && progress->isCanceled())
+        {
+            out = mesh._geometry.get();
+            return true;
+        }
+
+        writeEditedGeometry(tileKey, editor, mesh._geometry.get());
+    }
+
+    _editedMeshes.insert(editor.getRevisionKey(), mesh);
+
+    out = mesh._geometry.get();
+    return mesh._hasEdits;
+}
+
+std::string
+GeometryPool::createEditedMeshCacheKey(
+    const TileKey& tileKey,
+    const MeshEditor& editor) const
+{
+    // The content hash covers the tile and the edits, so the record is
+    // good for as long as the features are the same, even across runs.
+    return Cache::makeCacheKey(
+        Stringify() << tileKey.str() << "-" << std::hex << editor.getContentHash()
+        << "-" << getSkirtRatio()
+        << (useMorphArrays() ? "-m" : ""),
+        "mesh");
+}
+
+bool
+GeometryPool::readEditedGeometry(
+    const TileKey& tileKey,
+    MeshEditor& editor,
+    osg::ref_ptr<SharedGeometry>& out) const
+{
+    // The key covers all the edits, so any of the layers' bins would do;
+    // use the first one's.
+    TerrainConstraintLayer* layer = editor.getEdits().front()._layer.get();
+
+    CacheBin* bin = layer->getMeshCacheBin();
+    const CachePolicy& policy = layer->getMeshCachePolicy();
+    if (!bin || !policy.isCacheReadable())
+        return false;
+
+    ReadResult r = bin->readObject(createEditedMeshCacheKey(tileKey, editor), nullptr);
+    if (!r.succeeded() || policy.isExpired(r.lastModifiedTime()))
+        return false;
+
+    osg::Geometry* geom = r.get<osg::Geometry>();
+    if (!geom)
+        return false;
+
+    // an empty record marks a tile that the constraints removed entirely
+    if (geom->getVertexArray() == nullptr)
+    {
+        out = nullptr;
+        return true;
+    }
+
+    bool morphing = useMorphArrays();
+
+    osg::Vec3Array* verts = dynamic_cast<osg::Vec3Array*>(geom->getVertexArray());
+    osg::Vec3Array* normals = dynamic_cast<osg::Vec3Array*>(geom->getNormalArray());
+    osg::Vec3Array* texCoords = dynamic_cast<osg::Vec3Array*>(geom->getTexCoordArray(0));
+    osg::Vec3Array* neighbors = morphing ? dynamic_cast<osg::Vec3Array*>(geom->getTexCoordArray(1)) : nullptr;
+    osg::Vec3Array* neighborNormals = morphing ? dynamic_cast<osg::Vec3Array*>(geom->getTexCoordArray(2)) : nullptr;
+    osg::DrawElements* primSet = geom->getNumPrimitiveSets() > 0 ? geom->getPrimitiveSet(0)->getDrawElements() : nullptr;
+
+    if (!verts || !normals || !texCoords || !primSet ||
+        (morphing && (!neighbors || !neighborNormals)))
+    {
+        OE_DEBUG << LC << "Ignoring incomplete cached mesh for " << tileKey.str() << std::endl;
+        return false;
+    }
+
+    osg::ref_ptr<osg::VertexBufferObject> vbo = new osg::VertexBufferObject();
+    osg::Vec3Array* arrays[5] = { verts, normals, texCoords, neighbors, neighborNormals };
+    for (osg::Vec3Array* array : arrays)
+    {
+        if (array)
+        {
+            array->setBinding(array->BIND_PER_VERTEX);
+            array->setVertexBufferObject(vbo.get());
+        }
+    }
+
+    out = new SharedGeometry();
+    out->setVertexArray(verts);
+    out->setNormalArray(normals);
+    out->setTexCoordArray(texCoords);
+    out->setNeighborArray(neighbors);
+    out->setNeighborNormalArray(neighborNormals);
+    out->setDrawElements(primSet);
+    out->setHasConstraints(true);
+
+    return true;
+}
+
+void
+GeometryPool::writeEditedGeometry(
+    const TileKey& tileKey,
+    MeshEditor& editor,
+    SharedGeometry* sharedGeom) const
+{
+    TerrainConstraintLayer* layer = editor.getEdits().front()._layer.get();
+
+    CacheBin* bin = layer->getMeshCacheBin();
+    if (!bin || !layer->getMeshCachePolicy().isCacheWriteable())
+        return;
+
+    // Store the arrays in a plain geometry so any cache can serialize it.
+    // With no geometry (the tile was removed), the record stays empty.
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+    if (sharedGeom)
+    {
+        geom->setVertexArray(sharedGeom->getVertexArray());
+        geom->setNormalArray(sharedGeom->getNormalArray());
+        geom->setTexCoordArray(0, sharedGeom->getTexCoordArray());
+        if (sharedGeom->getNeighborArray())
+            geom->setTexCoordArray(1, sharedGeom->getNeighborArray());
+        if (sharedGeom->getNeighborNormalArray())
+            geom->setTexCoordArray(2, sharedGeom->getNeighborNormalArray());
+        if (sharedGeom->getDrawElements())
+            geom->addPrimitiveSet(sharedGeom->getDrawElements());
+    }
+
+    bin->write(createEditedMeshCacheKey(tileKey, editor), geom.get(), nullptr);
+}
+
+void
+GeometryPool::addToArena(SharedGeometry* geom)
+{
+    // Only meshes that use the shared primitive set can share an arena
+    if (geom->getDrawElements() != _defaultPrimSet.get() ||
+        geom->getVertexArray() == nullptr)
+    {
+        return;
+    }
+
+    for (auto& arena : _arenas)
+    {
+        if (arena->add(geom))
+            return;
+    }
+
+    // All arenas are full (or there are none yet); make a new one of
+    // about 8MB, but with no fewer than 16 slots.
+    const unsigned bytesPerArena = 8u * 1024u * 1024u;
+    bool morphing = geom->getNeighborArray() != nullptr;
+    unsigned verticesPerSlot = geom->getVertexArray()->getNumElements();
+    unsigned bytesPerSlot = verticesPerSlot * sizeof(osg::Vec3f) * (morphing ? 5u : 3u);
+    unsigned numSlots = osg::maximum(bytesPerArena / osg::maximum(bytesPerSlot, 1u), 16u);
+
+    osg::ref_ptr<GeometryArena> arena = new GeometryArena(
+        verticesPerSlot,
+        numSlots,
+        morphing,
+        _defaultPrimSet.get());
+
+    if (arena->add(geom))
+    {
+        _arenas.push_back(arena.get());
+        OE_DEBUG << LC << "New geometry arena with " << numSlots << " slots; total = " << _arenas.size() << std::endl;
     }
 }
 
@@ -122,7 +398,7 @@ GeometryPool::createKeyForTileKey(const TileKey& tileKey,
 int
 GeometryPool::getNumSkirtElements(unsigned tileSize) const
 {
-    return _options.heightFieldSkirtRatio().get() > 0.0 ? (tileSize-1) * 4 * 6 : 0;
+    return getSkirtRatio() > 0.0f ? (tileSize-1) * 4 * 6 : 0;
 }
 
 namespace
@@ -167,7 +443,7 @@ GeometryPool::createPrimitiveSet(
     unsigned tileSize) const
 {
     // Attempt to calculate the number of verts in the surface geometry.
-    bool needsSkirt = _options.heightFieldSkirtRatio() > 0.0f;
+    bool needsSkirt = getSkirtRatio() > 0.0f;
 
     unsigned numVertsInSurface    = (tileSize*tileSize);
     unsigned numVertsInSkirt      = needsSkirt ? (tileSize-1)*2u * 4u : 0;
@@ -245,7 +521,7 @@ GeometryPool::createGeometry(const TileKey& tileKey,
     local2world.invert( world2local );
 
     // Attempt to calculate the number of verts in the surface geometry.
-    bool needsSkirt = _options.heightFieldSkirtRatio() > 0.0f;
+    bool needsSkirt = getSkirtRatio() > 0.0f;
 
     unsigned numVertsInSurface    = (tileSize*tileSize);
     unsigned numVertsInSkirt      = needsSkirt ? (tileSize-1)*2u * 4u : 0;
@@ -281,7 +557,7 @@ GeometryPool::createGeometry(const TileKey& tileKey,
 
     osg::ref_ptr<osg::Vec3Array> neighbors = 0L;
     osg::ref_ptr<osg::Vec3Array> neighborNormals = 0L;
-    if (_options.morphTerrain() == true)
+    if (useMorphArrays())
     {
         // neighbor positions (for morphing)
         neighbors = new osg::Vec3Array();
@@ -311,7 +587,7 @@ GeometryPool::createGeometry(const TileKey& tileKey,
         bool tileHasData = editor.createTileMesh(
             geom.get(),
             tileSize,
-            _options.heightFieldSkirtRatio().get(),
+            getSkirtRatio(),
             progress);
 
         if (geom->empty())
@@ -373,7 +649,7 @@ GeometryPool::createGeometry(const TileKey& tileKey,
         if (needsSkirt)
         {
             // calculate the skirt extrusion height
-            double height = tileBound.radius() * _options.heightFieldSkirtRatio().get();
+            double height = tileBound.radius() * getSkirtRatio();
 
             // Normal tile skirt first:
             unsigned skirtIndex = verts->size();
@@ -439,6 +715,18 @@ GeometryPool::traverse(osg::NodeVisitor& nv)
         {
             _geometryMap.erase(*key);
         }
+
+        // Discard any arenas that no longer hold any geometry.
+        for (unsigned i = 0; i < _arenas.size(); )
+        {
+            if (_arenas[i]->referenceCount() == 1 && _arenas[i]->empty())
+            {
+                _arenas[i]->releaseGLObjects(NULL);
+                _arenas[i] = _arenas.back();
+                _arenas.resize(_arenas.size() - 1);
+            }
+            else ++i;
+        }
     }
 
     osg::Group::traverse(nv);
@@ -450,6 +738,8 @@ GeometryPool::clear()
     releaseGLObjects(NULL);
     Threading::ScopedMutexLock lock(_geometryMapMutex);
     _geometryMap.clear();
+    _arenas.clear();
+    _editedMeshes.clear();
 }
 
 void
@@ -465,7 +755,18 @@ GeometryPool::resizeGLObjectBuffers(unsigned maxsize)
         {
             i->second->resizeGLObjectBuffers(maxsize);
         }
+
+        for (auto& arena : _arenas)
+        {
+            arena->resizeGLObjectBuffers(maxsize);
+        }
     }
+
+    _editedMeshes.forEach([&](const std::string&, const EditedMesh& mesh)
+    {
+        if (mesh._geometry.valid())
+            mesh._geometry->resizeGLObjectBuffers(maxsize);
+    });
 }
 
 void
@@ -492,9 +793,20 @@ GeometryPool::releaseGLObjects(osg::State* state) const
             {
                 OE_DEBUG << LC << "Released " << objects.size() << " objects in the geometry pool\n";
             }
+
+            for (auto& arena : _arenas)
+            {
+                arena->releaseGLObjects(state);
+            }
         }
     }
 
+    _editedMeshes.forEach([&](const std::string&, const EditedMesh& mesh)
+    {
+        if (mesh._geometry.valid())
+            mesh._geometry->releaseGLObjects(state);
+    });
+
     // submit to the releaser.
     if (_releaser.valid() && !objects.empty())
     {
@@ -502,16 +814,178 @@ GeometryPool::releaseGLObjects(osg::State* state) const
     }
 }
 
+//.........................................................................
+
+GeometryArena::GeometryArena(unsigned verticesPerSlot,
+                             unsigned numSlots,
+                             bool morphing,
+                             osg::DrawElements* drawElements) :
+    _verticesPerSlot(verticesPerSlot),
+    _numSlots(numSlots),
+    _morphing(morphing),
+    _drawElements(drawElements),
+    _mutex("GeometryArena(OE)")
+{
+    _vbo = new osg::VertexBufferObject();
+
+    // Size everything up front; the arrays must never reallocate since
+    // other threads may be uploading them while we fill a slot.
+    unsigned numVerts = verticesPerSlot * numSlots;
+
+    _verts = new osg::Vec3Array(numVerts);
+    _normals = new osg::Vec3Array(numVerts);
+    _texcoords = new osg::Vec3Array(numVerts);
+
+    if (_morphing)
+    {
+        _neighbors = new osg::Vec3Array(numVerts);
+        _neighborNormals = new osg::Vec3Array(numVerts);
+    }
+
+    osg::Vec3Array* arrays[5] = {
+        _verts.get(), _normals.get(), _texcoords.get(), _neighbors.get(), _neighborNormals.get() };
+
+    for (auto array : arrays)
+    {
+        if (array)
+        {
+            array->setBinding(osg::Array::BIND_PER_VERTEX);
+            array->setVertexBufferObject(_vbo.get());
+        }
+    }
+
+    // hand out the low slots first
+    _freeSlots.reserve(numSlots);
+    for (unsigned i = numSlots; i > 0; --i)
+        _freeSlots.push_back(i - 1);
+}
+
+namespace
+{
+    bool fitsSlot(const osg::Array* array, unsigned numVerts)
+    {
+        return
+            array != nullptr &&
+            array->getType() == osg::Array::Vec3ArrayType &&
+            array->getNumElements() == numVerts;
+    }
+
+    void copyToSlot(osg::Array* array, osg::Vec3Array* dest, unsigned first)
+    {
+        const osg::Vec3Array* src = static_cast<const osg::Vec3Array*>(array);
+        std::copy(src->begin(), src->end(), dest->begin() + first);
+        dest->dirty();
+    }
+}
+
+bool
+GeometryArena::add(SharedGeometry* geom)
+{
+    if (geom == nullptr ||
+        geom->_arena.valid() ||
+        geom->getDrawElements() != _drawElements.get() ||
+        !fitsSlot(geom->getVertexArray(), _verticesPerSlot) ||
+        !fitsSlot(geom->getNormalArray(), _verticesPerSlot) ||
+        !fitsSlot(geom->getTexCoordArray(), _verticesPerSlot))
+    {
+        return false;
+    }
+
+    if (_morphing && (
+        !fitsSlot(geom->getNeighborArray(), _verticesPerSlot) ||
+        !fitsSlot(geom->getNeighborNormalArray(), _verticesPerSlot)))
+    {
+        return false;
+    }
+
+    if (!_morphing && geom->getNeighborArray() != nullptr)
+    {
+        return false;
+    }
+
+    unsigned slot;
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        if (_freeSlots.empty())
+            return false;
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+
+    // Nothing draws from this slot until we return, so it's safe to fill it
+    // even if another context is uploading the buffer right now. dirty()
+    // makes sure the next upload picks up the new data.
+    unsigned first = slot * _verticesPerSlot;
+    copyToSlot(geom->getVertexArray(), _verts.get(), first);
+    copyToSlot(geom->getNormalArray(), _normals.get(), first);
+    copyToSlot(geom->getTexCoordArray(), _texcoords.get(), first);
+    if (_morphing)
+    {
+        copyToSlot(geom->getNeighborArray(), _neighbors.get(), first);
+        copyToSlot(geom->getNeighborNormalArray(), _neighborNormals.get(), first);
+    }
+
+    geom->_arena = this;
+    geom->_arenaSlot = slot;
+    geom->_baseVertex = (GLint)first;
+
+    // The geometry keeps its own arrays for intersections and the like,
+    // but never renders from them, so they don't need GL buffers.
+    osg::Array* own[5] = {
+        geom->getVertexArray(), geom->getNormalArray(), geom->getTexCoordArray(),
+        geom->getNeighborArray(), geom->getNeighborNormalArray() };
+
+    for (auto array : own)
+    {
+        if (array)
+            array->setVertexBufferObject(nullptr);
+    }
+
+    return true;
+}
+
+void
+GeometryArena::remove(SharedGeometry* geom)
+{
+    if (geom && geom->_arena.get() == this)
+    {
+        Threading::ScopedMutexLock lock(_mutex);
+        _freeSlots.push_back(geom->_arenaSlot);
+    }
+}
+
+bool
+GeometryArena::empty() const
+{
+    Threading::ScopedMutexLock lock(_mutex);
+    return _freeSlots.size() == _numSlots;
+}
+
+void
+GeometryArena::resizeGLObjectBuffers(unsigned maxSize)
+{
+    _vbo->resizeGLObjectBuffers(maxSize);
+}
+
+void
+GeometryArena::releaseGLObjects(osg::State* state) const
+{
+    _vbo->releaseGLObjects(state);
+}
+
 //.........................................................................
 // Code mostly adapted from osgTerrain SharedGeometry.
 
 SharedGeometry::SharedGeometry() :
     osg::Drawable(),
-    _hasConstraints(false)
+    _hasConstraints(false),
+    _arenaSlot(0u),
+    _baseVertex(0)
 {
     _supportsVertexBufferObjects = true;
     _ptype.resize(64u);
     _ptype.setAllElementsTo(GL_TRIANGLES);
+    _indirect.resize(64u);
     _hasConstraints = false;
     setSupportsDisplayList(false);
     setUseDisplayList(false);
@@ -526,15 +1000,21 @@ SharedGeometry::SharedGeometry(const SharedGeometry& rhs,const osg::CopyOp& copy
     _neighborArray(rhs._neighborArray),
     _neighborNormalArray(rhs._neighborNormalArray),
     _drawElements(rhs._drawElements),
-    _hasConstraints(rhs._hasConstraints)
+    _hasConstraints(rhs._hasConstraints),
+    _arenaSlot(0u),
+    _baseVertex(0)
 {
     _ptype.resize(64u);
     _ptype.setAllElementsTo(GL_TRIANGLES);
+    _indirect.resize(64u);
 }
 
 SharedGeometry::~SharedGeometry()
 {
-    //nop
+    if (_arena.valid())
+    {
+        _arena->remove(this);
+    }
 }
 
 bool
@@ -545,6 +1025,29 @@ SharedGeometry::empty() const
         //(_maskElements.valid() == false || _maskElements->getNumIndices() == 0);
 }
 
+void
+SharedGeometry::drawIndirect(osg::RenderInfo& ri,
+                             DrawElementsIndirectCommand* commands,
+                             GLsizei numCommands,
+                             GLBuffer* commandBuffer,
+                             const IndirectDrawCallback* callback) const
+{
+    if (numCommands <= 0 || commandBuffer == nullptr)
+        return;
+
+    // Let osg::Drawable do the usual VAO/VBO setup, and have
+    // drawPrimitivesImplementation issue the indirect call.
+    IndirectDraw& indirect = _indirect[ri.getContextID()];
+    indirect._commands = commands;
+    indirect._numCommands = numCommands;
+    indirect._buffer = commandBuffer;
+    indirect._callback = callback;
+
+    draw(ri);
+
+    indirect = IndirectDraw();
+}
+
 #if OSG_MIN_VERSION_REQUIRED(3,5,9)
 osg::VertexArrayState* SharedGeometry::createVertexArrayStateImplementation(osg::RenderInfo& renderInfo) const
 #else
@@ -612,7 +1115,8 @@ SharedGeometry::compileGLObjects(osg::RenderInfo& renderInfo) const
     if (state.useVertexBufferObject(_supportsVertexBufferObjects && _useVertexBufferObjects))
     {
         // VBO:
-        _vertexArray->getBufferObject()->getOrCreateGLBufferObject(renderInfo.getContextID())->compileBuffer();
+        osg::Array* verts = _arena.valid() ? _arena->_verts.get() : _vertexArray.get();
+        verts->getBufferObject()->getOrCreateGLBufferObject(renderInfo.getContextID())->compileBuffer();
         _drawElements->getBufferObject()->getOrCreateGLBufferObject(renderInfo.getContextID())->compileBuffer();
 
         // VAO:
@@ -653,8 +1157,15 @@ SharedGeometry::drawVertexArraysImplementation(osg::RenderInfo& renderInfo) cons
     attributeDispatchers.reset();
     attributeDispatchers.setUseVertexAttribAlias(state.getUseVertexAttributeAliasing());
 
+    // Render from the arena's shared arrays if we have a slot in one
+    osg::Array* vertexArray = _arena.valid() ? _arena->_verts.get() : _vertexArray.get();
+    osg::Array* normalArray = _arena.valid() ? _arena->_normals.get() : _normalArray.get();
+    osg::Array* texcoordArray = _arena.valid() ? _arena->_texcoords.get() : _texcoordArray.get();
+    osg::Array* neighborArray = _arena.valid() ? _arena->_neighbors.get() : _neighborArray.get();
+    osg::Array* neighborNormalArray = _arena.valid() ? _arena->_neighborNormals.get() : _neighborNormalArray.get();
+
     // activate or dispatch any attributes that are bound overall
-    attributeDispatchers.activateNormalArray(_normalArray.get());
+    attributeDispatchers.activateNormalArray(normalArray);
     attributeDispatchers.activateColorArray(_colorArray.get());
 
     if (state.useVertexArrayObject(_useVertexArrayObject))
@@ -665,23 +1176,23 @@ SharedGeometry::drawVertexArraysImplementation(osg::RenderInfo& renderInfo) cons
     vas->lazyDisablingOfVertexAttributes();
 
     // set up arrays
-    if (_vertexArray.valid())
-        vas->setVertexArray(state, _vertexArray.get());
+    if (vertexArray)
+        vas->setVertexArray(state, vertexArray);
 
-    if (_normalArray.valid() && _normalArray->getBinding() == osg::Array::BIND_PER_VERTEX)
-        vas->setNormalArray(state, _normalArray.get());
+    if (normalArray && normalArray->getBinding() == osg::Array::BIND_PER_VERTEX)
+        vas->setNormalArray(state, normalArray);
 
     if (_colorArray.valid() && _colorArray->getBinding() == osg::Array::BIND_PER_VERTEX)
         vas->setColorArray(state, _colorArray.get());
 
-    if (_texcoordArray.valid() && _texcoordArray->getBinding() == osg::Array::BIND_PER_VERTEX)
-        vas->setTexCoordArray(state, 0, _texcoordArray.get());
+    if (texcoordArray && texcoordArray->getBinding() == osg::Array::BIND_PER_VERTEX)
+        vas->setTexCoordArray(state, 0, texcoordArray);
 
-    if (_neighborArray.valid() && _neighborArray->getBinding() == osg::Array::BIND_PER_VERTEX)
-        vas->setTexCoordArray(state, 1, _neighborArray.get());
+    if (neighborArray && neighborArray->getBinding() == osg::Array::BIND_PER_VERTEX)
+        vas->setTexCoordArray(state, 1, neighborArray);
 
-    if (_neighborNormalArray.valid() && _neighborNormalArray->getBinding() == osg::Array::BIND_PER_VERTEX)
-        vas->setTexCoordArray(state, 2, _neighborNormalArray.get());
+    if (neighborNormalArray && neighborNormalArray->getBinding() == osg::Array::BIND_PER_VERTEX)
+        vas->setTexCoordArray(state, 2, neighborNormalArray);
 
     vas->applyDisablingOfVertexAttributes(state);
 }
@@ -699,13 +1210,82 @@ SharedGeometry::drawPrimitivesImplementation(osg::RenderInfo& renderInfo) const
 
         GLenum primitiveType = _ptype[state.getContextID()];
 
-        if (usingVertexArrayObjects || !usingVertexBufferObjects)
+        const IndirectDraw& indirect = _indirect[state.getContextID()];
+        if (indirect._commands != nullptr)
         {
-            glDrawElements(
+            // Indirect draws always source indices from the EBO.
+            osg::GLBufferObject* ebo = _drawElements->getOrCreateGLBufferObject(state.getContextID());
+            if (!ebo)
+                return;
+
+            state.getCurrentVertexArrayState()->bindElementBufferObject(ebo);
+
+            GLenum dataType = _drawElements->getDataType();
+            GLuint indexSize =
+                dataType == GL_UNSIGNED_INT ? 4u :
+                dataType == GL_UNSIGNED_SHORT ? 2u :
+                1u;
+
+            GLuint firstIndex = (GLuint)(ebo->getOffset(_drawElements->getBufferIndex()) / indexSize);
+
+            for (GLsizei i = 0; i < indirect._numCommands; ++i)
+            {
+                DrawElementsIndirectCommand& cmd = indirect._commands[i];
+                cmd.count = _drawElements->getNumIndices();
+                cmd.instanceCount = 1;
+                cmd.firstIndex = firstIndex;
+            }
+
+            // Orphan and refill the command buffer each time to avoid stalls
+            osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+            indirect._buffer->bind(GL_DRAW_INDIRECT_BUFFER);
+            ext->glBufferData(
+                GL_DRAW_INDIRECT_BUFFER,
+                indirect._numCommands * sizeof(DrawElementsIndirectCommand),
+                indirect._commands,
+                GL_STREAM_DRAW_ARB);
+
+            if (indirect._callback)
+            {
+                (*indirect._callback)(state, indirect._buffer, indirect._numCommands);
+            }
+
+            GLFunctions::get(state).glMultiDrawElementsIndirect(
                 primitiveType,
-                _drawElements->getNumIndices(),
-                _drawElements->getDataType(),
-                _drawElements->getDataPointer());
+                dataType,
+                (const GLvoid*)0,
+                indirect._numCommands,
+                0);
+
+            return;
+        }
+
+        // Arena geometries index into the shared arrays from their base vertex
+        GLFunctions& gl = GLFunctions::get(state);
+        auto drawElements = [&](const GLvoid* indices)
+        {
+            if (_arena.valid())
+            {
+                gl.glDrawElementsBaseVertex(
+                    primitiveType,
+                    _drawElements->getNumIndices(),
+                    _drawElements->getDataType(),
+                    indices,
+                    _baseVertex);
+            }
+            else
+            {
+                glDrawElements(
+                    primitiveType,
+                    _drawElements->getNumIndices(),
+                    _drawElements->getDataType(),
+                    indices);
+            }
+        };
+
+        if (usingVertexArrayObjects || !usingVertexBufferObjects)
+        {
+            drawElements(_drawElements->getDataPointer());
         }
         else
         {
@@ -715,21 +1295,13 @@ SharedGeometry::drawPrimitivesImplementation(osg::RenderInfo& renderInfo) const
             {
                 state.getCurrentVertexArrayState()->bindElementBufferObject(ebo);
 
-                glDrawElements(
-                    primitiveType,
-                    _drawElements->getNumIndices(),
-                    _drawElements->getDataType(),
-                    (const GLvoid *)(ebo->getOffset(_drawElements->getBufferIndex())));
+                drawElements((const GLvoid *)(ebo->getOffset(_drawElements->getBufferIndex())));
             }
             else
             {
                 state.getCurrentVertexArrayState()->unbindElementBufferObject();
 
-                glDrawElements(
-                    primitiveType, 
-                    _drawElements->getNumIndices(), 
-                    _drawElements->getDataType(), 
-                    _drawElements->getDataPointer());
+                drawElements(_drawElements->getDataPointer());
             }
         }
     }
@@ -19,13 +19,24 @@
 #include "LayerDrawable"
 #include "TerrainRenderData"
 #include <osgEarth/Metrics>
+#include <osgEarth/GLUtils>
+#include <osgEarth/GPUTimer>
 #include <sstream>
+#include <unordered_map>
 
 using namespace osgEarth::REX;
 
 #undef  LC
 #define LC "[LayerDrawable] "
 
+// pre OSG-3.6 support
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+// layout(binding) of oe_rex_TileBuffer in RexEngine.GL4.glsl
+#define TILE_BUFFER_BINDING 5
+
 
 LayerDrawable::LayerDrawable() :
 _renderType(Layer::RENDERTYPE_TERRAIN_SURFACE),
@@ -97,6 +108,128 @@ namespace
     };
 }
 
+namespace
+{
+    // Per-tile data for the multi-draw path.
+    // Must match the oe_rex_Tile struct in RexEngine.GL4.glsl (std430).
+    struct TileData
+    {
+        osg::Matrixf _modelViewMatrix;
+        osg::Matrixf _colorMatrix;
+        osg::Matrixf _parentMatrix;
+        osg::Matrixf _elevationMatrix;
+        osg::Matrixf _normalMatrix;
+        osg::Vec4f   _tileKey;
+        osg::Vec2f   _elevTexelCoeff;
+        osg::Vec2f   _morphConstants;
+        GLuint64     _colorHandle;
+        GLuint64     _parentHandle;
+        GLuint64     _elevationHandle;
+        GLuint64     _normalHandle;
+        GLfloat      _parentExists;
+        GLint        _layerOrder;
+        GLfloat      _padding[2];
+    };
+    static_assert(sizeof(TileData) == 400, "TileData must match the std430 layout of oe_rex_Tile");
+
+    // GL objects and scratch space for the multi-draw path, one per graphics context.
+    // These outlive the per-frame DrawState and LayerDrawables.
+    struct MultiDrawGL
+    {
+        MultiDrawGL() : _lastPruneFrame(0u) { }
+
+        osg::ref_ptr<GLBuffer> _tileBuffer;
+        osg::ref_ptr<GLBuffer> _commandBuffer;
+        osg::ref_ptr<osg::RefMatrix> _identity;
+
+        std::vector<TileData> _tileData;
+        std::vector<const DrawTileCommand*> _tiles;
+
+        // Tile bounds for GPU culling, parallel to _tileData
+        osg::ref_ptr<GLBuffer> _cullBuffer;
+        std::vector<GPUCuller::CullTile> _cullData;
+
+        typedef std::pair<const SharedGeometry*, std::vector<DrawElementsIndirectCommand> > Group;
+        std::vector<Group> _groups;
+        std::unordered_map<const void*, unsigned> _groupIndex;
+
+        // Bindless handles we know to be resident, with the frame each was last used
+        std::unordered_map<GLuint64, unsigned> _resident;
+        unsigned _lastPruneFrame;
+    };
+
+    osg::buffered_object<MultiDrawGL> s_multiDrawGL(64u);
+
+    // Returns a resident bindless handle for a texture, compiling it first if necessary.
+    GLuint64 getResidentHandle(osg::Texture* tex, int unit, osg::State& state, MultiDrawGL& gl, unsigned frame)
+    {
+        if (tex == nullptr)
+            return 0ULL;
+
+        osg::Texture::TextureObject* to = tex->getTextureObject(state.getContextID());
+        if (to == nullptr)
+        {
+            state.setActiveTextureUnit(unit);
+            tex->apply(state);
+            to = tex->getTextureObject(state.getContextID());
+            if (to == nullptr)
+                return 0ULL;
+        }
+
+        osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+        GLuint64 handle = ext->glGetTextureHandle(to->id());
+        if (handle == 0ULL)
+            return 0ULL;
+
+        std::unordered_map<GLuint64, unsigned>::iterator i = gl._resident.find(handle);
+        if (i == gl._resident.end())
+        {
+            // The handle may still be resident from before it was pruned from our table.
+            GLFunctions& f = GLFunctions::get(state);
+            if (f.glIsTextureHandleResident == nullptr || f.glIsTextureHandleResident(handle) == GL_FALSE)
+            {
+                ext->glMakeTextureHandleResident(handle);
+            }
+            gl._resident[handle] = frame;
+        }
+        else
+        {
+            i->second = frame;
+        }
+
+        return handle;
+    }
+
+    // Forget handles that haven't been used in a while so the table doesn't
+    // grow without bound as tiles page in and out. Deleted textures take
+    // their handles with them, so there is nothing to release here.
+    void pruneResidentHandles(MultiDrawGL& gl, unsigned frame)
+    {
+        const unsigned maxAge = 120u;
+        if (frame - gl._lastPruneFrame < maxAge)
+            return;
+
+        for (std::unordered_map<GLuint64, unsigned>::iterator i = gl._resident.begin(); i != gl._resident.end(); )
+        {
+            if (frame - i->second > maxAge)
+                i = gl._resident.erase(i);
+            else
+                ++i;
+        }
+        gl._lastPruneFrame = frame;
+    }
+
+    // Whether a texture is a placeholder whose image is not yet available.
+    inline bool isPlaceholder(const osg::Texture* tex)
+    {
+        return
+            tex != nullptr &&
+            tex->getNumImages() > 0 &&
+            tex->getImage(0) != nullptr &&
+            tex->getImage(0)->valid() == false;
+    }
+}
+
 void
 LayerDrawable::drawTiles(osg::RenderInfo& ri) const
 {
@@ -110,6 +243,13 @@ LayerDrawable::drawTiles(osg::RenderInfo& ri) const
         ext->glUniform1i(pps._layerUidUL, uid);
     }
 
+    // Surface shaders read per-tile data from the tile buffer in this mode.
+    if (_drawState->_useMultiDrawIndirect && _renderType == Layer::RENDERTYPE_TERRAIN_SURFACE)
+    {
+        drawTilesIndirect(ri);
+        return;
+    }
+
     for (DrawTileCommands::const_iterator tile = _tiles.begin(); tile != _tiles.end(); ++tile)
     {
         //_drawState->getPPS(ri).refresh(ri, _drawState->_bindings);
@@ -117,6 +257,242 @@ LayerDrawable::drawTiles(osg::RenderInfo& ri) const
     }
 }
 
+void
+LayerDrawable::drawTilesIndirect(osg::RenderInfo& ri) const
+{
+    osg::State& state = *ri.getState();
+    osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+    const RenderBindings& bindings = *_drawState->_bindings;
+    MultiDrawGL& gl = s_multiDrawGL[state.getContextID()];
+    unsigned frame = state.getFrameStamp() ? state.getFrameStamp()->getFrameNumber() : 0u;
+
+    const SamplerBinding& colorBinding = bindings[SamplerBinding::COLOR];
+    const SamplerBinding& parentBinding = bindings[SamplerBinding::COLOR_PARENT];
+    const SamplerBinding& elevationBinding = bindings[SamplerBinding::ELEVATION];
+    const SamplerBinding& normalBinding = bindings[SamplerBinding::NORMAL];
+
+    const GPUCuller* culler = _drawState->_gpuCuller;
+
+    gl._tileData.clear();
+    gl._tiles.clear();
+    gl._cullData.clear();
+
+    // Samplers beyond the core set (land cover, shared layers) are still
+    // bound by texture unit, which forces one draw per tile.
+    bool perTileSamplers = false;
+
+    for (DrawTileCommands::const_iterator tile = _tiles.begin(); tile != _tiles.end(); ++tile)
+    {
+        if (!tile->_geom.valid() || tile->_geom->empty())
+            continue;
+
+        TileData data;
+        data._modelViewMatrix = osg::Matrixf(*tile->_modelViewMatrix.get());
+        data._tileKey = tile->_keyValue;
+        data._elevTexelCoeff = tile->_elevTexelCoeff;
+        data._morphConstants = tile->_morphConstants;
+        data._layerOrder = (GLint)tile->_layerOrder;
+
+        osg::Texture* color = colorBinding.getDefaultTexture();
+        osg::Texture* parent = nullptr;
+        osg::Texture* elevation = elevationBinding.getDefaultTexture();
+        osg::Texture* normal = normalBinding.getDefaultTexture();
+
+        if (tile->_colorSamplers)
+        {
+            const Sampler& colorSampler = (*tile->_colorSamplers)[SamplerBinding::COLOR];
+            const Sampler& parentSampler = (*tile->_colorSamplers)[SamplerBinding::COLOR_PARENT];
+
+            // Render nothing for a tile whose imagery isn't available yet.
+            if (isPlaceholder(colorSampler._texture.get()) || isPlaceholder(parentSampler._texture.get()))
+                continue;
+
+            if (colorSampler._texture.valid())
+            {
+                color = colorSampler._texture.get();
+                data._colorMatrix = colorSampler._matrix;
+            }
+            if (parentSampler._texture.valid())
+            {
+                parent = parentSampler._texture.get();
+                data._parentMatrix = parentSampler._matrix;
+            }
+        }
+
+        if (tile->_sharedSamplers)
+        {
+            const Samplers& shared = *tile->_sharedSamplers;
+
+            if (shared[SamplerBinding::ELEVATION]._texture.valid())
+            {
+                elevation = shared[SamplerBinding::ELEVATION]._texture.get();
+                data._elevationMatrix = shared[SamplerBinding::ELEVATION]._matrix;
+            }
+            if (shared[SamplerBinding::NORMAL]._texture.valid())
+            {
+                normal = shared[SamplerBinding::NORMAL]._texture.get();
+                data._normalMatrix = shared[SamplerBinding::NORMAL]._matrix;
+            }
+
+            for (unsigned s = SamplerBinding::LANDCOVER; s < shared.size() && !perTileSamplers; ++s)
+            {
+                if (shared[s]._texture.valid() && s < bindings.size() && bindings[s].isActive())
+                    perTileSamplers = true;
+            }
+        }
+
+        // Every handle must be valid, even when the shader ignores it,
+        // so an absent parent falls back on the color texture.
+        data._colorHandle = getResidentHandle(color, colorBinding.unit(), state, gl, frame);
+        data._parentHandle = parent ? getResidentHandle(parent, parentBinding.unit(), state, gl, frame) : data._colorHandle;
+        data._parentExists = parent ? 1.0f : 0.0f;
+        data._elevationHandle = getResidentHandle(elevation, elevationBinding.unit(), state, gl, frame);
+        data._normalHandle = getResidentHandle(normal, normalBinding.unit(), state, gl, frame);
+
+        gl._tileData.push_back(data);
+        gl._tiles.push_back(&(*tile));
+
+        if (culler)
+        {
+            const osg::BoundingBox& box = tile->_tile ? tile->_tile->getBoundingBox() : tile->_geom->getBoundingBox();
+            osg::BoundingSphere bs(box);
+            GPUCuller::CullTile cull;
+            cull._modelViewMatrix = data._modelViewMatrix;
+            cull._bound.set(bs.center().x(), bs.center().y(), bs.center().z(), bs.radius());
+            gl._cullData.push_back(cull);
+        }
+    }
+
+    pruneResidentHandles(gl, frame);
+
+    if (gl._tileData.empty())
+        return;
+
+    // Upload the tile data, orphaning the previous contents.
+    if (!gl._tileBuffer.valid() || gl._tileBuffer->name() == ~0U)
+    {
+        gl._tileBuffer = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.rex.tiles");
+    }
+    gl._tileBuffer->bind();
+    ext->glBufferData(
+        GL_SHADER_STORAGE_BUFFER,
+        gl._tileData.size() * sizeof(TileData),
+        &gl._tileData[0],
+        GL_STREAM_DRAW_ARB);
+    ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TILE_BUFFER_BINDING, gl._tileBuffer->name());
+
+    // Tile bounds for the compute culler, which reads them by base instance.
+    if (culler)
+    {
+        if (!gl._cullBuffer.valid() || gl._cullBuffer->name() == ~0U)
+        {
+            gl._cullBuffer = new GLBuffer(GL_SHADER_STORAGE_BUFFER, state, "oe.rex.cull");
+        }
+        gl._cullBuffer->bind();
+        ext->glBufferData(
+            GL_SHADER_STORAGE_BUFFER,
+            gl._cullData.size() * sizeof(GPUCuller::CullTile),
+            &gl._cullData[0],
+            GL_STREAM_DRAW_ARB);
+        ext->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPUCuller::CULL_BUFFER_BINDING, gl._cullBuffer->name());
+    }
+
+    if (!gl._commandBuffer.valid() || gl._commandBuffer->name() == ~0U)
+    {
+        gl._commandBuffer = new GLBuffer(GL_DRAW_INDIRECT_BUFFER, state, "oe.rex.commands");
+    }
+
+    // The shaders apply each tile's own modelview matrix, so the
+    // layer draws under identity.
+    if (!gl._identity.valid())
+    {
+        gl._identity = new osg::RefMatrix();
+    }
+    state.applyModelViewMatrix(gl._identity.get());
+    if (state.getUseModelViewAndProjectionUniforms())
+    {
+        state.applyModelViewAndProjectionUniformsIfRequired();
+    }
+
+    if (perTileSamplers)
+    {
+        PerProgramState& pps = _drawState->getPPS(ri);
+
+        for (unsigned i = 0; i < gl._tiles.size(); ++i)
+        {
+            const DrawTileCommand& tile = *gl._tiles[i];
+
+            if (tile._sharedSamplers)
+            {
+                for (unsigned s = SamplerBinding::LANDCOVER; s < tile._sharedSamplers->size(); ++s)
+                {
+                    const Sampler& sampler = (*tile._sharedSamplers)[s];
+                    SamplerState& samplerState = pps._samplerState._samplers[s];
+
+                    if (sampler._texture.valid() && !samplerState._texture.isSetTo(sampler._texture.get()))
+                    {
+                        state.setActiveTextureUnit(bindings[s].unit());
+                        sampler._texture->apply(state);
+                        samplerState._texture = sampler._texture.get();
+                    }
+
+                    if (samplerState._matrixUL >= 0 && !samplerState._matrix.isSetTo(sampler._matrix))
+                    {
+                        ext->glUniformMatrix4fv(samplerState._matrixUL, 1, GL_FALSE, sampler._matrix.ptr());
+                        samplerState._matrix = sampler._matrix;
+                    }
+                }
+            }
+
+            DrawElementsIndirectCommand cmd;
+            cmd.baseVertex = tile._geom->getBaseVertex();
+            cmd.baseInstance = i;
+            tile._geom->_ptype[state.getContextID()] = tile._geom->getDrawElements()->getMode();
+            tile._geom->drawIndirect(ri, &cmd, 1, gl._commandBuffer.get(), culler);
+        }
+    }
+    else
+    {
+        // Group the tiles by shared geometry; each group is one multi-draw.
+        // Geometries in the same arena share vertex arrays and differ
+        // only by base vertex, so they all go in the same group.
+        gl._groupIndex.clear();
+        unsigned numGroups = 0u;
+
+        for (unsigned i = 0; i < gl._tiles.size(); ++i)
+        {
+            const SharedGeometry* geom = gl._tiles[i]->_geom.get();
+            const void* groupKey = geom->getArena() ? (const void*)geom->getArena() : (const void*)geom;
+
+            std::pair<std::unordered_map<const void*, unsigned>::iterator, bool> result =
+                gl._groupIndex.emplace(groupKey, numGroups);
+
+            if (result.second)
+            {
+                if (gl._groups.size() <= numGroups)
+                    gl._groups.resize(numGroups + 1);
+                gl._groups[numGroups].first = geom;
+                gl._groups[numGroups].second.clear();
+                ++numGroups;
+            }
+
+            DrawElementsIndirectCommand cmd;
+            cmd.baseVertex = geom->getBaseVertex();
+            cmd.baseInstance = i;
+            gl._groups[result.first->second].second.push_back(cmd);
+        }
+
+        for (unsigned g = 0; g < numGroups; ++g)
+        {
+            MultiDrawGL::Group& group = gl._groups[g];
+            group.first->_ptype[state.getContextID()] = group.first->getDrawElements()->getMode();
+            group.first->drawIndirect(ri, &group.second[0], (GLsizei)group.second.size(), gl._commandBuffer.get(), culler);
+        }
+    }
+
+    ext->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
 void
 LayerDrawable::drawImplementation(osg::RenderInfo& ri) const
 {
@@ -125,6 +501,11 @@ LayerDrawable::drawImplementation(osg::RenderInfo& ri) const
     sprintf(buf, "%.36s (%zd tiles)", _layer ? _layer->getName().c_str() : "unknown layer", _tiles.size());
     OE_PROFILING_ZONE_TEXT(buf);
 
+    // time each layer on the GPU; don't build the pass name unless timing
+    bool gpuTiming = GPUTimer::enabled();
+    if (gpuTiming)
+        GPUTimer::begin(*ri.getState(), _layer ? "terrain/" + _layer->getName() : "terrain");
+
     if (_patchLayer && _patchLayer->getDrawCallback())
     {        
         _patchLayer->getDrawCallback()->draw(ri, this);
@@ -158,6 +539,9 @@ LayerDrawable::drawImplementation(osg::RenderInfo& ri) const
         // current MVM, which will by definition be wrong!)
         //ri.getState()->apply();
     }
+
+    if (gpuTiming)
+        GPUTimer::end(*ri.getState());
 }
 
 void LayerDrawable::accept(osg::PrimitiveFunctor& functor) const
@@ -24,6 +24,7 @@
 #include <osgEarth/TerrainEngineNode>
 #include <osgEarth/Terrain>
 #include <osgEarth/Metrics>
+#include <osgEarth/Stats>
 #include <osg/NodeVisitor>
 
 using namespace osgEarth::REX;
@@ -38,9 +39,11 @@ LoadTileDataOperation::LoadTileDataOperation(
     _tilenode(tilenode),
     _enableCancel(true),
     _dispatched(false),
-    _merged(false)
+    _merged(false),
+    _screenPriority(0.0f)
 {
     _engine = context->getEngine();
+    _texturePages = context->getTexturePages();
     _name = tilenode->getKey().str();
 }
 
@@ -53,9 +56,11 @@ LoadTileDataOperation::LoadTileDataOperation(
     _tilenode(tilenode),
     _enableCancel(true),
     _dispatched(false),
-    _merged(false)
+    _merged(false),
+    _screenPriority(0.0f)
 {
     _engine = context->getEngine();
+    _texturePages = context->getTexturePages();
     _name = tilenode->getKey().str();
 }
 
@@ -68,7 +73,7 @@ LoadTileDataOperation::~LoadTileDataOperation()
 }
 
 bool
-LoadTileDataOperation::dispatch(bool async)
+LoadTileDataOperation::dispatch(bool async, Util::PagingBudget::TicketPtr ticket)
 {
     // Make local copies that we want to pass to the lambda
     osg::ref_ptr<TerrainEngineNode> engine;
@@ -86,7 +91,9 @@ LoadTileDataOperation::dispatch(bool async)
 
     TileKey key(_tilenode->getKey());
 
-    auto load = [engine, map, key, manifest, enableCancel] (Cancelable* progress)
+    osg::ref_ptr<TexturePagePool> pages = _texturePages;
+
+    auto load = [engine, map, key, manifest, enableCancel, pages, ticket] (Cancelable* progress)
     {
         osg::ref_ptr<ProgressCallback> wrapper =
             enableCancel ? new ProgressCallback(progress) : nullptr;
@@ -97,6 +104,34 @@ LoadTileDataOperation::dispatch(bool async)
             manifest,
             wrapper.get());
 
+        if (result.valid())
+        {
+            static Stats::Counter& s_tilesLoaded = Stats::counter("osgearth_rex_tiles_loaded");
+            s_tilesLoaded.add();
+        }
+
+        // Move image layer textures into shared pages before the merger
+        // compiles them. Async and dynamic layers swap or update their
+        // textures later, and shared layers bind through their own
+        // sampler2D units, so those keep their own textures.
+        if (result.valid() && pages.valid())
+        {
+            for (auto& colorLayer : result->colorLayers())
+            {
+                TerrainTileImageLayerModel* imageModel =
+                    dynamic_cast<TerrainTileImageLayerModel*>(colorLayer.get());
+
+                if (imageModel && imageModel->getTexture() &&
+                    imageModel->getImageLayer() &&
+                    imageModel->getImageLayer()->getAsyncLoading() == false &&
+                    imageModel->getImageLayer()->isDynamic() == false &&
+                    imageModel->getImageLayer()->isShared() == false)
+                {
+                    imageModel->setTexture(pages->page(imageModel->getTexture()));
+                }
+            }
+        }
+
         return result;
     };
 
@@ -174,5 +209,8 @@ LoadTileDataOperation::merge()
     // Merge the new data into the tile.
     tilenode->merge(model.get(), _manifest);
 
+    static Stats::Counter& s_tilesMerged = Stats::counter("osgearth_rex_tiles_merged");
+    s_tilesMerged.add();
+
     return true;
 }
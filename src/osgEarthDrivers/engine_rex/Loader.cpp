@@ -27,6 +27,7 @@
 #include <osgViewer/View>
 
 #include <string>
+#include <cfloat>
 
 using namespace osgEarth;
 using namespace osgEarth::REX;
@@ -34,8 +35,23 @@ using namespace osgEarth::REX;
 #undef LC
 #define LC "[Merger] "
 
+namespace
+{
+    // Limits of the adaptive upload budget, in bytes per frame
+    const double MIN_BYTES_PER_FRAME = 1.0 * 1024.0 * 1024.0;
+    const double MAX_BYTES_PER_FRAME = 128.0 * 1024.0 * 1024.0;
+    const double BYTES_PER_FRAME_STEP = 2.0 * 1024.0 * 1024.0;
+
+    // Frames that run up to this much over the target still count as on
+    // target, so ordinary vsync jitter doesn't throttle merging.
+    const double FRAME_TIME_TOLERANCE = 1.2;
+}
+
 Merger::Merger() :
-    _mergesPerFrame(~0)
+    _mergesPerFrame(~0),
+    _targetFrameTime(0.0f),
+    _lastFrameTime(-1.0),
+    _bytesPerFrame(MAX_BYTES_PER_FRAME)
 {
     setCullingActive(false);
     setNumChildrenRequiringUpdateTraversal(+1);
@@ -53,6 +69,39 @@ Merger::setMergesPerFrame(unsigned value)
     _mergesPerFrame = value;
 }
 
+void
+Merger::setTargetFrameTime(float ms)
+{
+    _targetFrameTime = ms;
+}
+
+void
+Merger::updateBudget(const osg::FrameStamp* fs)
+{
+    if (_targetFrameTime <= 0.0f || fs == nullptr)
+        return;
+
+    double now = fs->getReferenceTime();
+
+    if (_lastFrameTime >= 0.0)
+    {
+        // The last frame's time includes drawing (and uploading) whatever
+        // we merged during its update traversal.
+        double frameTime = (now - _lastFrameTime) * 1000.0;
+
+        if (frameTime > _targetFrameTime * FRAME_TIME_TOLERANCE)
+        {
+            _bytesPerFrame = osg::maximum(_bytesPerFrame * 0.5, MIN_BYTES_PER_FRAME);
+        }
+        else
+        {
+            _bytesPerFrame = osg::minimum(_bytesPerFrame + BYTES_PER_FRAME_STEP, MAX_BYTES_PER_FRAME);
+        }
+    }
+
+    _lastFrameTime = now;
+}
+
 void
 Merger::clear()
 {
@@ -61,21 +110,28 @@ Merger::clear()
     _mergeQueue = MergeQueue();
 }
 
+unsigned
+Merger::getNumPending() const
+{
+    ScopedMutexLock lock(_mutex);
+    return _compileQueue.size() + _mergeQueue.size();
+}
+
 void
 Merger::merge(LoadTileDataOperationPtr data, osg::NodeVisitor& nv)
 {
+    GLObjectsCompiler glcompiler;
+
+    // create an empty state:
+    osg::ref_ptr<osgUtil::StateToCompile> state = glcompiler.collectState(nullptr);
+    OE_SOFT_ASSERT_AND_RETURN(state.valid(), __func__, );
+
+    // populate it with the tile model contents:
+    data->_result.get()->getStateToCompile(*state.get());
+
     osg::ref_ptr<osgUtil::IncrementalCompileOperation> ico;
     if (ObjectStorage::get(&nv, ico))
     {
-        GLObjectsCompiler glcompiler;
-
-        // create an empty state:
-        osg::ref_ptr<osgUtil::StateToCompile> state = glcompiler.collectState(nullptr);
-        OE_SOFT_ASSERT_AND_RETURN(state.valid(), __func__, );
-
-        // populate it with the tile model contents:
-        data->_result.get()->getStateToCompile(*state.get());
-        
         ScopedMutexLock lock(_mutex);
 
         if (!state->empty())
@@ -91,13 +147,16 @@ Merger::merge(LoadTileDataOperationPtr data, osg::NodeVisitor& nv)
         }
         else
         {
-            _mergeQueue.push(data);
+            _mergeQueue.emplace(data, 0u);
         }
     }
     else
     {
+        // No ICO, so the merged textures will upload during the draw.
+        unsigned bytes = Util::PagingBudget::estimateUploadBytes(*state.get());
+
         ScopedMutexLock lock(_mutex);
-        _mergeQueue.push(data);
+        _mergeQueue.emplace(data, bytes);
     }
 }
 
@@ -115,8 +174,9 @@ Merger::traverse(osg::NodeVisitor& nv)
 
             if (next._compiled.isAvailable())
             {
-                // compile finished, put it on the merge queue
-                _mergeQueue.emplace(std::move(next._data));
+                // compile finished, put it on the merge queue;
+                // there's nothing left to upload.
+                _mergeQueue.emplace(std::move(next._data), 0u);
                 _compileQueue.pop();
             }
             else if (next._compiled.isAbandoned())
@@ -131,14 +191,37 @@ Merger::traverse(osg::NodeVisitor& nv)
             }
         }
 
+        updateBudget(nv.getFrameStamp());
+
         unsigned count = 0u;
         unsigned max_count = _mergesPerFrame;
         if (max_count == 0)
             max_count = INT_MAX;
 
+        double bytes = 0.0;
+        double max_bytes = _targetFrameTime > 0.0f ? _bytesPerFrame : DBL_MAX;
+
+        unsigned frame = nv.getFrameStamp() ? nv.getFrameStamp()->getFrameNumber() : 0u;
+
         while (!_mergeQueue.empty() && count < max_count)
         {
-            LoadTileDataOperationPtr next = _mergeQueue.front();
+            ToMerge& front = _mergeQueue.front();
+
+            // Always merge at least one, so large tiles can't stall the queue
+            if (count > 0u && bytes + front._uploadBytes > max_bytes)
+                break;
+
+            // share the frame with the other pagers
+            if (front._data != nullptr &&
+                front._data->_result.isAvailable() &&
+                !Util::PagingBudget::instance()->startMerge(frame, front._uploadBytes, front._data->_screenPriority))
+            {
+                break;
+            }
+
+            bytes += front._uploadBytes;
+
+            LoadTileDataOperationPtr next = front._data;
             _mergeQueue.pop();
 
             if (next != nullptr)
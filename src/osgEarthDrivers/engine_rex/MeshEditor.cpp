@@ -9,6 +9,7 @@
 #include <osgEarth/weemesh.h>
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 
 #define LC "[MeshEditor] "
 
@@ -16,7 +17,30 @@ using namespace osgEarth;
 using namespace osgEarth::REX;
 using namespace weemesh;
 
-MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, ProgressCallback* progress) :
+namespace
+{
+    // FNV-1a, 64 bits, fed a field at a time
+    struct Hasher
+    {
+        std::uint64_t _h = 14695981039346656037ull;
+
+        void bytes(const void* data, std::size_t n)
+        {
+            const unsigned char* p = (const unsigned char*)data;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                _h ^= p[i];
+                _h *= 1099511628211ull;
+            }
+        }
+
+        template<typename T>
+        void value(const T& v) { bytes(&v, sizeof(T)); }
+    };
+}
+
+MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map) :
+    _contentHash(0u),
     _key( key ), 
     _tileSize(tileSize),
     _tileEmpty(false)
@@ -27,6 +51,9 @@ MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, Pr
 
     const GeoExtent& keyExtent = key.getExtent();
 
+    std::stringstream buf;
+    buf << key.str() << "-" << key.getProfile()->getHorizSignatureHash() << "-" << tileSize;
+
     for(auto& layer : layers)
     {
         // not to the min LOD yet?
@@ -37,6 +64,35 @@ MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, Pr
         if (!layer->getExtent().intersects(keyExtent))
             continue;
 
+        if (layer->getFeatureSource())
+        {
+            _layers.push_back(layer);
+
+            buf << "/" << layer->getUID()
+                << "." << layer->getRevision()
+                << "." << layer->getConstraintRevision(keyExtent);
+        }
+    }
+
+    _revisionKey = buf.str();
+}
+
+bool
+MeshEditor::readEdits(ProgressCallback* progress)
+{
+    _edits.clear();
+
+    const GeoExtent& keyExtent = _key.getExtent();
+
+    Hasher hash;
+    hash.value(_key.getLOD());
+    hash.value(_key.getTileX());
+    hash.value(_key.getTileY());
+    hash.value(_key.getProfile()->getHorizSignatureHash());
+    hash.value(_tileSize);
+
+    for(auto& layer : _layers)
+    {
         // For each feature, check that it intersects the tile key,
         // and then xform it to the correct SRS and clone it for
         // editing.
@@ -44,14 +100,14 @@ MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, Pr
         if (fs)
         {
             osg::ref_ptr<FeatureCursor> cursor = fs->createFeatureCursor(
-                key,
+                _key,
                 progress);
 
             Edit edit;
             while (cursor.valid() && cursor->hasMore())
             {
                 if (progress && progress->isCanceled())
-                    return;
+                    return false;
 
                 Feature* f = cursor->nextFeature();
                 if (f->getExtent().intersects(keyExtent))
@@ -65,9 +121,30 @@ MeshEditor::MeshEditor(const TileKey& key, unsigned tileSize, const Map* map, Pr
             {
                 edit._layer = layer;
                 _edits.emplace_back(edit);
+
+                // everything about the edit that the mesh depends on:
+                hash.value(layer->getRemoveInterior());
+                hash.value(layer->getHasElevation());
+                hash.value(edit._features.size());
+
+                for (auto& feature : edit._features)
+                {
+                    GeometryIterator iter(feature->getGeometry(), true);
+                    while (iter.hasMore())
+                    {
+                        const Geometry* part = iter.next();
+                        hash.value(part->getType());
+                        hash.value(part->size());
+                        if (!part->empty())
+                            hash.bytes(&(*part)[0], part->size() * sizeof(osg::Vec3d));
+                    }
+                }
             }
         }
     }
+
+    _contentHash = hash._h;
+    return true;
 }
 
 #define addSkirtDataForIndex(INDEX, HEIGHT) \
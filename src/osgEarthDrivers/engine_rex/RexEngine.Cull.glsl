@@ -0,0 +1,107 @@
+#version 430
+
+// begin: RexEngine.Cull.glsl
+//
+// GPU tile culling for the multi-draw-indirect path.
+// Runs one invocation per indirect draw command. Each command's tile
+// bound goes into view space with the tile's modelview matrix and is
+// tested against the sides of the view frustum and the ellipsoid horizon.
+// Tiles that fail get an instance count of zero, which skips the draw.
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+
+// Must match DrawElementsIndirectCommand in GeometryPool
+struct oe_rex_DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+// Must match GPUCuller::CullTile
+struct oe_rex_CullTile
+{
+    mat4 modelViewMatrix;   // 64
+    vec4 bound;             // 16 - local center (xyz), radius (w)
+};
+
+layout(binding=6, std430) readonly buffer oe_rex_CullBuffer
+{
+    oe_rex_CullTile oe_rex_cullTile[];
+};
+
+layout(binding=7, std430) buffer oe_rex_CommandBuffer
+{
+    oe_rex_DrawCommand oe_rex_command[];
+};
+
+uniform uint oe_rex_cull_numCommands;
+
+// View-space side planes of the frustum; positive distance is inside
+uniform vec4 oe_rex_cull_planes[4];
+
+// View-space ellipsoid center (xyz) and minimum radius (w); w=0 disables
+uniform vec4 oe_rex_cull_horizon;
+
+bool oe_rex_inFrustum(in vec3 center, in float radius)
+{
+    for(int i=0; i<4; ++i)
+    {
+        if (dot(oe_rex_cull_planes[i].xyz, center) + oe_rex_cull_planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+// Cone-and-plane horizon test against a sphere with the ellipsoid's
+// minimum radius, which is conservative for the ellipsoid itself.
+// ref: https://cesiumjs.org/2013/04/25/Horizon-culling/
+bool oe_rex_aboveHorizon(in vec3 center, in float radius)
+{
+    float R = oe_rex_cull_horizon.w;
+    if (R <= 0.0)
+        return true;
+
+    // viewer->ellipsoid center, in unit space
+    vec3 VC = oe_rex_cull_horizon.xyz / R;
+    float VHmag2 = dot(VC, VC) - 1.0;
+
+    // eye under the surface; no valid horizon
+    if (VHmag2 <= 0.0)
+        return true;
+
+    // move the target closer to the horizon plane by its radius
+    vec3 eyeUnit = normalize(-oe_rex_cull_horizon.xyz);
+    vec3 VT = (center + eyeUnit*radius) / R;
+
+    float VTdotVC = dot(VT, VC);
+
+    // in front of the horizon plane?
+    if (VTdotVC <= VHmag2)
+        return true;
+
+    // behind the plane, but outside the horizon cone?
+    return (VTdotVC*VTdotVC / dot(VT, VT)) < VHmag2;
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= oe_rex_cull_numCommands)
+        return;
+
+    oe_rex_CullTile tile = oe_rex_cullTile[oe_rex_command[i].baseInstance];
+
+    vec3 center = (tile.modelViewMatrix * vec4(tile.bound.xyz, 1.0)).xyz;
+    float radius = tile.bound.w * length(tile.modelViewMatrix[0].xyz);
+
+    bool visible =
+        oe_rex_inFrustum(center, radius) &&
+        oe_rex_aboveHorizon(center, radius);
+
+    oe_rex_command[i].instanceCount = visible ? 1u : 0u;
+}
+
+// end: RexEngine.Cull.glsl
@@ -0,0 +1,65 @@
+// begin: RexEngine.GL4.glsl
+//
+// Per-tile data for the multi-draw-indirect rendering path.
+// When OE_TERRAIN_USE_MDI is defined, the engine issues one indirect
+// multi-draw per layer and the per-tile uniforms come from a shader
+// storage buffer indexed by the draw's base instance. The macros below
+// map the familiar uniform names onto that buffer so the rest of the
+// terrain shaders read the same either way.
+
+#ifdef OE_TERRAIN_USE_MDI
+
+#extension GL_ARB_shader_storage_buffer_object : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_ARB_shader_draw_parameters : enable
+#extension GL_ARB_bindless_texture : enable
+
+// Must match the layout of the TileData struct in LayerDrawable.cpp
+struct oe_rex_Tile
+{
+    mat4  modelViewMatrix;  // 64
+    mat4  colorMatrix;      // 64
+    mat4  parentMatrix;     // 64
+    mat4  elevationMatrix;  // 64
+    mat4  normalMatrix;     // 64
+    vec4  tileKey;          // 16
+    vec2  elevTexelCoeff;   // 8
+    vec2  morphConstants;   // 8
+    uvec2 colorHandle;      // 8
+    uvec2 parentHandle;     // 8
+    uvec2 elevationHandle;  // 8
+    uvec2 normalHandle;     // 8
+    float parentExists;     // 4
+    int   layerOrder;       // 4
+    float _padding[2];      // 8
+};
+
+layout(binding=5, std430) readonly buffer oe_rex_TileBuffer
+{
+    oe_rex_Tile oe_rex_tile[];
+};
+
+// Index of the tile being drawn; set from gl_BaseInstance in the vertex
+// stage and passed flat to the others.
+#define OE_REX_TILE oe_rex_tile[oe_rex_tileID]
+
+#define oe_tile_key                 OE_REX_TILE.tileKey
+#define oe_tile_elevTexelCoeff      OE_REX_TILE.elevTexelCoeff
+#define oe_tile_morph               OE_REX_TILE.morphConstants
+#define oe_tile_elevationTexMatrix  OE_REX_TILE.elevationMatrix
+#define oe_tile_normalTexMatrix     OE_REX_TILE.normalMatrix
+#define oe_tile_elevationTex        sampler2D(OE_REX_TILE.elevationHandle)
+#define oe_tile_normalTex           sampler2D(OE_REX_TILE.normalHandle)
+#define oe_layer_texMatrix          OE_REX_TILE.colorMatrix
+#define oe_layer_texParentMatrix    OE_REX_TILE.parentMatrix
+#define oe_layer_tex                sampler2D(OE_REX_TILE.colorHandle)
+#define oe_layer_texParent          sampler2D(OE_REX_TILE.parentHandle)
+#define oe_layer_texParentExists    OE_REX_TILE.parentExists
+#define oe_layer_order              OE_REX_TILE.layerOrder
+
+// Tile modelview matrix, which replaces gl_ModelViewMatrix for terrain shaders
+#define oe_rex_tileModelViewMatrix  OE_REX_TILE.modelViewMatrix
+
+#endif // OE_TERRAIN_USE_MDI
+
+// end: RexEngine.GL4.glsl
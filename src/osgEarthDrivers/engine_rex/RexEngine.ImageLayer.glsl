@@ -6,13 +6,20 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma vp_location   vertex_view
 #pragma vp_order      0.4
 
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma include RexEngine.GL4.glsl
+
 // Stage globals
 vec4 oe_layer_tilec;
 vec2 oe_layer_texc;
 vec2 oe_layer_texcParent;
 
+#ifdef OE_TERRAIN_USE_MDI
+flat out int oe_rex_tileID;
+#else
 uniform mat4 oe_layer_texMatrix;
 uniform mat4 oe_layer_texParentMatrix;
+#endif
 
 void oe_rex_imageLayer_VS(inout vec4 vertexView)
 {
@@ -39,14 +46,34 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma import_defines(OE_IS_PICK_CAMERA)
 #pragma import_defines(OE_IS_SHADOW_CAMERA)
 #pragma import_defines(OE_IS_DEPTH_CAMERA)
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma import_defines(OE_TERRAIN_USE_TEXTURE_PAGES)
+#pragma include RexEngine.GL4.glsl
 
-uniform sampler2D oe_layer_tex;
 uniform int       oe_layer_uid;
+#ifdef OE_TERRAIN_USE_MDI
+flat in int oe_rex_tileID;
+#else
+uniform sampler2D oe_layer_tex;
 uniform int       oe_layer_order;
+#endif
+
+// With texture pages, a tile's texture may instead live in a slot
+// of a shared array; slot < 0 means use the regular sampler.
+#ifdef OE_TERRAIN_USE_TEXTURE_PAGES
+uniform sampler2DArray oe_layer_texPage;
+uniform int oe_layer_texSlot;
+#endif
 
 #ifdef OE_TERRAIN_MORPH_IMAGERY
+#ifndef OE_TERRAIN_USE_MDI
 uniform sampler2D oe_layer_texParent;
 uniform float oe_layer_texParentExists;
+#endif
+#ifdef OE_TERRAIN_USE_TEXTURE_PAGES
+uniform sampler2DArray oe_layer_texParentPage;
+uniform int oe_layer_texParentSlot;
+#endif
 in vec2 oe_layer_texcParent;
 in float oe_rex_morphFactor;
 #endif
@@ -114,13 +141,24 @@ void oe_rex_imageLayer_FS(inout vec4 color)
 
     if (isTexelLayer)
     {
+#ifdef OE_TERRAIN_USE_TEXTURE_PAGES
+        if (oe_layer_texSlot >= 0)
+            texel = texture(oe_layer_texPage, vec3(oe_layer_texc, oe_layer_texSlot));
+        else
+#endif
         texel = texture(oe_layer_tex, oe_layer_texc);
 
 #ifdef OE_TERRAIN_MORPH_IMAGERY
         // sample the main texture:
 
         // sample the parent texture:
-        vec4 texelParent = texture(oe_layer_texParent, oe_layer_texcParent);
+        vec4 texelParent;
+#ifdef OE_TERRAIN_USE_TEXTURE_PAGES
+        if (oe_layer_texParentSlot >= 0)
+            texelParent = texture(oe_layer_texParentPage, vec3(oe_layer_texcParent, oe_layer_texParentSlot));
+        else
+#endif
+        texelParent = texture(oe_layer_texParent, oe_layer_texcParent);
 
         // if the parent texture does not exist, use the current texture with alpha=0 as the parent
         // so we can "fade in" an image layer that starts at LOD > 0:
@@ -11,6 +11,8 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma import_defines(OE_IS_DEPTH_CAMERA)
 #pragma import_defines(OE_ELEVATION_CONSTRAINT_TEX)
 #pragma import_defines(OE_ELEVATION_CONSTRAINT_TEX_MATRIX)
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma include RexEngine.GL4.glsl
 
 // stage
 vec3 vp_Normal;
@@ -21,7 +23,11 @@ out float oe_rex_morphFactor;
 
 flat out int oe_terrain_vertexMarker;
 
+#ifdef OE_TERRAIN_USE_MDI
+flat out int oe_rex_tileID;
+#else
 uniform vec2  oe_tile_morph;
+#endif
 uniform float oe_tile_size;
 
 // Constraint stuff
@@ -29,7 +35,9 @@ uniform float oe_tile_size;
 uniform sampler2DArray OE_ELEVATION_CONSTRAINT_TEX;
 uniform mat4 OE_ELEVATION_CONSTRAINT_TEX_MATRIX;
 #endif 
+#ifndef OE_TERRAIN_USE_MDI
 uniform vec2 oe_tile_elevTexelCoeff;
+#endif
 
 #ifdef OE_IS_DEPTH_CAMERA
 uniform mat4 oe_shadowToPrimaryMatrix;
@@ -98,7 +106,11 @@ float oe_rex_ComputeMorphFactor(in vec4 position, in vec3 up)
 		wouldBePosition.xyz += up*elev;
 #endif
 
+#ifdef OE_TERRAIN_USE_MDI
+    vec4 wouldBePositionView = oe_rex_tileModelViewMatrix * wouldBePosition;
+#else
     vec4 wouldBePositionView = gl_ModelViewMatrix * wouldBePosition;
+#endif
 
 #ifdef OE_IS_DEPTH_CAMERA
     // For a depth camera, we have to compute the morphed position
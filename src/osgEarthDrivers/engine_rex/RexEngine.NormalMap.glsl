@@ -6,11 +6,17 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma vp_order      0.5
 
 #pragma import_defines(OE_TERRAIN_RENDER_NORMAL_MAP)
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma include RexEngine.GL4.glsl
 
+#ifdef OE_TERRAIN_USE_MDI
+flat out int oe_rex_tileID;
+#else
 uniform mat4 oe_tile_normalTexMatrix;
 uniform vec2 oe_tile_elevTexelCoeff;
 
 uniform mat4 oe_tile_elevationTexMatrix;
+#endif
 
 // stage globals
 vec4 oe_layer_tilec;
@@ -38,7 +44,11 @@ void oe_rex_normalMapVS(inout vec4 unused)
         + oe_tile_elevTexelCoeff.y;
 
     // send the bi-normal to the fragment shader
+#ifdef OE_TERRAIN_USE_MDI
+    oe_normalMapBinormal = normalize(mat3(oe_rex_tileModelViewMatrix) * vec3(0,1,0));
+#else
     oe_normalMapBinormal = normalize(gl_NormalMatrix * vec3(0,1,0));
+#endif
 }
 
 
@@ -54,11 +64,17 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma import_defines(OE_DEBUG_NORMALS)
 #pragma import_defines(OE_DEBUG_CURVATURE)
 #pragma import_defines(OE_COMPRESSED_NORMAL_MAP)
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma include RexEngine.GL4.glsl
 
 // import terrain SDK
 vec4 oe_terrain_getNormalAndCurvature(in vec2);
 
+#ifdef OE_TERRAIN_USE_MDI
+flat in int oe_rex_tileID;
+#else
 uniform sampler2D oe_tile_normalTex;
+#endif
 
 in vec3 vp_Normal;
 in vec3 oe_UpVectorView;
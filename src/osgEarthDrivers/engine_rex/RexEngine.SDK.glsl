@@ -3,11 +3,18 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 
 #pragma vp_name Rex Terrain SDK
 
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma include RexEngine.GL4.glsl
+
 /**
  * SDK functions for the Rex engine.
  * Declare and call these from any shader that runs on the terrain.
  */
 
+#ifdef OE_TERRAIN_USE_MDI
+// Stage global: per-tile data comes from the tile buffer
+int oe_rex_tileID;
+#else
 // uniforms from terrain engine
 uniform sampler2D oe_tile_elevationTex;
 uniform mat4 oe_tile_elevationTexMatrix;
@@ -17,6 +24,7 @@ uniform sampler2D oe_tile_normalTex;
 uniform mat4 oe_tile_normalTexMatrix;
 
 uniform vec4 oe_tile_key;
+#endif
 
 // Stage global
 vec4 oe_layer_tilec;
@@ -14,6 +14,11 @@ uniform vec3 oe_Camera;
 
 uniform float oe_terrain_sse; // screen space error (pixels)
 
+#ifdef OE_TERRAIN_COMPACT_MESH
+in vec4 oe_layer_tilec;
+void VP_LoadVertex(in int);
+#endif
+
 // inspired by:
 // http://codeflow.org/entries/2010/nov/07/opengl-4-tessellation/
 
@@ -42,6 +47,31 @@ void oe_rex_tessellate()
         float e1 = tessLevel(ss2, ss0);
         float e2 = tessLevel(ss0, ss1);
 
+#ifdef OE_TERRAIN_COMPACT_MESH
+        // There are no skirts on the patch mesh. Snap each tile-edge level to
+        // a power of two so a neighbor that splits the same edge into two
+        // patches (one LOD finer) lands its vertices on ours.
+        vec2 tc[3];
+        for(int i=0; i<3; ++i)
+        {
+            VP_LoadVertex(i);
+            tc[i] = oe_layer_tilec.st;
+        }
+        VP_LoadVertex(gl_InvocationID);
+
+        vec3 level = vec3(e0, e1, e2);
+        for(int k=0; k<3; ++k)
+        {
+            vec2 a = tc[(k+1)%3], b = tc[(k+2)%3];
+            bool onEdge =
+                (a.s == 0.0 && b.s == 0.0) || (a.s == 1.0 && b.s == 1.0) ||
+                (a.t == 0.0 && b.t == 0.0) || (a.t == 1.0 && b.t == 1.0);
+            if (onEdge)
+                level[k] = exp2(round(log2(level[k])));
+        }
+        e0 = level[0]; e1 = level[1]; e2 = level[2];
+#endif
+
         oe_terrain_tessLevel = vec4(e0, e1, e2, (e0+e1+e2)/3.0);
     }
 }
@@ -6,6 +6,9 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma vp_location   vertex_model
 #pragma vp_order      first
 
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma include RexEngine.GL4.glsl
+
 // uniforms
 uniform vec4 oe_terrain_color;
 
@@ -17,8 +20,17 @@ out vec4 oe_terrain_tessLevel;
 out float oe_rex_morphFactor;
 flat out int oe_terrain_vertexMarker;
 
+#ifdef OE_TERRAIN_USE_MDI
+flat out int oe_rex_tileID;
+#endif
+
 void oe_rex_init_model(inout vec4 vertexModel)
 {
+#ifdef OE_TERRAIN_USE_MDI
+    // Each indirect draw command carries its tile's index as the base instance
+    oe_rex_tileID = gl_BaseInstanceARB;
+#endif
+
     // Texture coordinate for the tile (always 0..1)
     oe_layer_tilec = gl_MultiTexCoord0;
 
@@ -36,6 +48,37 @@ void oe_rex_init_model(inout vec4 vertexModel)
 }
 
 
+[break]
+#version $GLSL_VERSION_STR
+$GLSL_DEFAULT_PRECISION_FLOAT
+
+#pragma vp_name       REX Engine - Tile Transform
+#pragma vp_entryPoint oe_rex_tile_transform
+#pragma vp_location   vertex_model
+#pragma vp_order      last
+
+#pragma import_defines(OE_TERRAIN_USE_MDI)
+#pragma include RexEngine.GL4.glsl
+
+#ifdef OE_TERRAIN_USE_MDI
+flat out int oe_rex_tileID;
+#endif
+
+// stage
+vec3 vp_Normal;
+
+void oe_rex_tile_transform(inout vec4 vertexModel)
+{
+#ifdef OE_TERRAIN_USE_MDI
+    // With multi-draw the engine applies an identity modelview matrix for the
+    // whole layer, so move the vertex into view space with the tile's own
+    // matrix here. Terrain tile matrices are rigid, so mat3() is fine for normals.
+    vertexModel = oe_rex_tileModelViewMatrix * vertexModel;
+    vp_Normal = mat3(oe_rex_tileModelViewMatrix) * vp_Normal;
+#endif
+}
+
+
 [break]
 #version $GLSL_VERSION_STR
 $GLSL_DEFAULT_PRECISION_FLOAT
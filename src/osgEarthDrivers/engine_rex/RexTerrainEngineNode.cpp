@@ -33,8 +33,10 @@
 #include <osgEarth/Utils>
 #include <osgEarth/ObjectIndex>
 #include <osgEarth/Metrics>
+#include <osgEarth/Stats>
 #include <osgEarth/Elevation>
 #include <osgEarth/LandCover>
+#include <osgEarth/Shadowing>
 
 #include <osg/Version>
 #include <osg/BlendFunc>
@@ -51,6 +53,9 @@ using namespace osgEarth;
 
 #define DEFAULT_MAX_LOD 19u
 
+// default screen space error (pixels) for GPU tessellation
+#define TESSELLATION_ERROR 50.0f
+
 //------------------------------------------------------------------------
 
 namespace
@@ -68,6 +73,31 @@ namespace
         }
     };
 
+    // adapter that lets RexTerrainEngineNode listen to constraint edits
+    struct RexTerrainEngineNodeConstraintCallbackProxy : public TerrainConstraintLayer::Callback
+    {
+        RexTerrainEngineNodeConstraintCallbackProxy(RexTerrainEngineNode* node) : _node(node) { }
+        osg::observer_ptr<RexTerrainEngineNode> _node;
+
+        void onConstraintsChanged(TerrainConstraintLayer* layer, const GeoExtent& extent) override {
+            osg::ref_ptr<RexTerrainEngineNode> node;
+            if ( _node.lock(node) )
+                node->onConstraintsChanged( layer, extent );
+        }
+    };
+
+    struct RexTerrainEngineNodeDataChangeCallbackProxy : public TileLayer::ChangeCallback
+    {
+        RexTerrainEngineNodeDataChangeCallbackProxy(RexTerrainEngineNode* node) : _node(node) { }
+        osg::observer_ptr<RexTerrainEngineNode> _node;
+
+        void onDataChanged(TileLayer* layer, const GeoExtent& extent, unsigned minLevel, unsigned maxLevel) override {
+            osg::ref_ptr<RexTerrainEngineNode> node;
+            if ( _node.lock(node) )
+                node->onDataChanged( layer, extent, minLevel, maxLevel );
+        }
+    };
+
 
     /**
     * Run this visitor whenever you remove a layer, so that each
@@ -132,6 +162,7 @@ RexTerrainEngineNode::RexTerrainEngineNode() :
     _stateUpdateRequired  ( false ),
     _renderModelUpdateRequired( false ),
     _morphTerrainSupported(true),
+    _textureMemory(Memory::TILE_TEXTURES),
     _frameLastUpdated(0u)
 {
     // Necessary for pager object data
@@ -186,6 +217,16 @@ RexTerrainEngineNode::resizeGLObjectBuffers(unsigned maxSize)
 
     _imageLayerStateSet.get()->resizeGLObjectBuffers(maxSize);
 
+    if (_engineContext.valid() && _engineContext->getTexturePages())
+    {
+        _engineContext->getTexturePages()->resizeGLObjectBuffers(maxSize);
+    }
+
+    if (_engineContext.valid() && _engineContext->getGPUCuller())
+    {
+        _engineContext->getGPUCuller()->resizeGLObjectBuffers(maxSize);
+    }
+
     // TODO: where should this live? MapNode?
     LayerVector layers;
     getMap()->getLayers(layers);
@@ -205,6 +246,16 @@ RexTerrainEngineNode::releaseGLObjects(osg::State* state) const
         _imageLayerStateSet.get()->releaseGLObjects(state);
     }
 
+    if (_engineContext.valid() && _engineContext->getTexturePages())
+    {
+        _engineContext->getTexturePages()->releaseGLObjects(state);
+    }
+
+    if (_engineContext.valid() && _engineContext->getGPUCuller())
+    {
+        _engineContext->getGPUCuller()->releaseGLObjects(state);
+    }
+
     TerrainEngineNode::releaseGLObjects(state);
 }
 
@@ -250,6 +301,13 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
         _morphTerrainSupported = false;
     }
 
+    // The compact patch mesh has no neighbor arrays to morph toward;
+    // the tessellator matches the tile edges instead.
+    if (options().gpuTessellation() == true && options().compactTessellationMesh() == true)
+    {
+        _morphTerrainSupported = false;
+    }
+
     // Check for normals debugging.
     if (::getenv("OSGEARTH_DEBUG_NORMALS"))
         getOrCreateStateSet()->setDefine("OE_DEBUG_NORMALS");
@@ -290,6 +348,7 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
     // Geometry compiler/merger
     _merger = new Merger();
     _merger->setMergesPerFrame(options().mergesPerFrame().get());
+    _merger->setTargetFrameTime(options().mergeTargetFrameTime().get());
     this->addChild(_merger.get());
 
     // Loader concurrency (size of the thread pool)
@@ -299,12 +358,19 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
         concurrency = Strings::as<unsigned>(concurrency_str, concurrency);
     JobArena::setConcurrency(ARENA_LOAD_TILE, concurrency);
 
+    // Cull concurrency; the cull thread itself handles one share of the
+    // work, so the arena only needs the remainder.
+    unsigned cullConcurrency = options().cullConcurrency().get();
+    if (cullConcurrency > 1u)
+        JobArena::setConcurrency(ARENA_CULL, cullConcurrency-1u);
+
     // Make a tile unloader
     _unloader = new UnloaderGroup( _liveTiles.get() );
     _unloader->setFrameClock(&_clock);
     _unloader->setMaxAge(options().minExpiryTime().get());
     _unloader->setMaxTilesToUnloadPerFrame(options().maxTilesToUnloadPerFrame().get());
     _unloader->setMinimumRange(options().minExpiryRange().get());
+    _unloader->setMemoryBudget((std::size_t)options().gpuMemoryBudget().get() * 1024u * 1024u);
     this->addChild( _unloader.get() );
 
     // Initialize the core render bindings.
@@ -335,6 +401,30 @@ RexTerrainEngineNode::setMap(const Map* map, const TerrainOptions& inOptions)
         _selectionInfo,
         &_clock);
 
+    // Texture pages get their own units, since a sampler2DArray
+    // can't share a unit with the per-tile sampler2D.
+    TexturePagePool* pages = _engineContext->getTexturePages();
+    if (pages)
+    {
+        bool needParent = _renderBindings[SamplerBinding::COLOR_PARENT].isActive();
+
+        if (getResources()->reserveTextureImageUnit(pages->unit(0), "Terrain Color Page") &&
+            (!needParent || getResources()->reserveTextureImageUnit(pages->unit(1), "Terrain Parent Color Page")))
+        {
+            osg::StateSet* terrainSS = _terrain->getOrCreateStateSet();
+            terrainSS->addUniform(new osg::Uniform("oe_layer_texPage", pages->unit(0)));
+            if (needParent)
+                terrainSS->addUniform(new osg::Uniform("oe_layer_texParentPage", pages->unit(1)));
+        }
+        else
+        {
+            OE_WARN << LC << "No texture image units left for texture pages; using per-tile textures" << std::endl;
+            if (pages->unit(0) >= 0)
+                getResources()->releaseTextureImageUnit(pages->unit(0));
+            _engineContext->_texturePages = nullptr;
+        }
+    }
+
     // Calculate the LOD morphing parameters:
     unsigned maxLOD = options().maxLOD().getOrUse(DEFAULT_MAX_LOD);
 
@@ -504,13 +594,47 @@ RexTerrainEngineNode::setupRenderBindings()
     landCover.usage()       = SamplerBinding::LANDCOVER;
     landCover.samplerName() = "oe_tile_landCoverTex";
     landCover.matrixName()  = "oe_tile_landCoverTexMatrix";
-    landCover.setDefaultTexture(LandCover::createEmptyTexture());
+    LandCoverPalette* landCoverPalette = getTileModelFactory() ?
+        getTileModelFactory()->getLandCoverPalette() : NULL;
+    if (landCoverPalette)
+    {
+        osg::ref_ptr<osg::Image> emptyLC = landCoverPalette->createIndexedImage(LandCover::createEmptyImage());
+        osg::Texture2D* emptyLCTex = new osg::Texture2D(emptyLC.get());
+        emptyLCTex->setInternalFormat(LandCoverPalette::getTextureFormat());
+        emptyLCTex->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+        emptyLCTex->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+        emptyLCTex->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
+        landCover.setDefaultTexture(emptyLCTex);
+    }
+    else
+    {
+        landCover.setDefaultTexture(LandCover::createEmptyTexture());
+    }
     landCover.getDefaultTexture()->setName("rex default landcover");
     if (this->landCoverTexturesRequired())
         getResources()->reserveTextureImageUnit(landCover.unit(), "Terrain Land Cover");
     getOrCreateStateSet()->setDefine("OE_LANDCOVER_TEX", landCover.samplerName());
     getOrCreateStateSet()->setDefine("OE_LANDCOVER_TEX_MATRIX", landCover.matrixName());
 
+    // Indexed land cover: the tile textures hold palette indices, and one
+    // shared lookup texture maps them back to land cover codes.
+    if (landCoverPalette && this->landCoverTexturesRequired())
+    {
+        int codesUnit;
+        if (getResources()->reserveTextureImageUnit(codesUnit, "Terrain Land Cover Palette"))
+        {
+            osg::StateSet* ss = getOrCreateStateSet();
+            ss->setTextureAttribute(codesUnit, landCoverPalette->getCodeTexture());
+            ss->addUniform(new osg::Uniform("oe_tile_landCoverCodes", codesUnit));
+            ss->setDefine("OE_LANDCOVER_INDEXED");
+            ss->setDefine("OE_LANDCOVER_CODES", "oe_tile_landCoverCodes");
+        }
+        else
+        {
+            OE_WARN << LC << "No texture image unit available for the land cover palette" << std::endl;
+        }
+    }
+
     // Apply a default, empty texture to each render binding.
     OE_DEBUG << LC << "Render Bindings:\n";
     osg::StateSet* terrainSS = _terrain->getOrCreateStateSet();
@@ -625,7 +749,23 @@ RexTerrainEngineNode::cull_traverse(osg::NodeVisitor& nv)
     culler.setup(getMap(), _cachedLayerExtents, this->getEngineContext()->getRenderBindings());
 
     // Assemble the terrain drawables:
-    _terrain->accept(culler);
+    unsigned cullConcurrency = options().cullConcurrency().get();
+    if (cullConcurrency > 1u && _terrain->getNumChildren() > 1u)
+        cullTerrainInParallel(culler, cv, cullConcurrency);
+    else
+        _terrain->accept(culler);
+
+    // Start loading the tiles the camera is heading towards.
+    if (options().prefetchLookahead().get() > 0.0f)
+        prefetch(culler, cv);
+
+    // Record the tiles drawn by on-screen cameras; RTT cameras (shadows,
+    // overlays) would make the number jump around.
+    if (cv->getCurrentCamera()->getRenderTargetImplementation() == osg::Camera::FRAME_BUFFER)
+    {
+        static Stats::Gauge& s_tilesVisible = Stats::gauge("osgearth_rex_tiles_visible");
+        s_tilesVisible.set(culler._numTilesVisible);
+    }
 
     // If we're using geometry pooling, optimize the drawable for shared state
     // by sorting the draw commands.
@@ -761,6 +901,135 @@ RexTerrainEngineNode::cull_traverse(osg::NodeVisitor& nv)
     _releaser->accept(nv);
 }
 
+void
+RexTerrainEngineNode::cullTerrainInParallel(TerrainCuller& culler, osgUtil::CullVisitor* cv, unsigned concurrency)
+{
+    OE_PROFILING_ZONE;
+
+    const unsigned numRoots = _terrain->getNumChildren();
+    const unsigned numChunks = osg::minimum(concurrency, numRoots);
+
+    // Every culler, including the primary one, culls against its own
+    // cull stack so none of them touch the shared CullVisitor. The primary
+    // culler handles the first chunk of root tiles on this thread.
+    culler.setIsolated(true);
+
+    std::vector<osg::ref_ptr<TerrainCuller>> workers;
+    for (unsigned c = 1; c < numChunks; ++c)
+    {
+        TerrainCuller* worker = new TerrainCuller(cv, getEngineContext());
+        worker->setup(culler);
+        worker->setIsolated(true);
+        workers.push_back(worker);
+    }
+
+    // Contiguous chunks, so merging in chunk order reproduces the
+    // draw command order of a serial cull.
+    osg::Group* terrain = _terrain.get();
+    auto cullChunk = [terrain, numRoots, numChunks](TerrainCuller* c, unsigned chunk)
+    {
+        unsigned first = (chunk * numRoots) / numChunks;
+        unsigned last = ((chunk + 1) * numRoots) / numChunks;
+        for (unsigned i = first; i < last; ++i)
+        {
+            terrain->getChild(i)->accept(*c);
+        }
+    };
+
+    JobGroup group;
+    Job job(JobArena::get(ARENA_CULL), &group);
+    job.setName("oe.rex.cull");
+
+    for (unsigned c = 1; c < numChunks; ++c)
+    {
+        TerrainCuller* worker = workers[c - 1].get();
+        job.dispatch([cullChunk, worker, c](Cancelable*)
+            {
+                cullChunk(worker, c);
+            });
+    }
+
+    cullChunk(&culler, 0u);
+
+    group.join();
+
+    for (auto& worker : workers)
+    {
+        culler.merge(*worker.get());
+    }
+
+    culler.setIsolated(false);
+
+    // Debug nodes were collected during the parallel cull; they must
+    // go through the real CullVisitor.
+    for (auto node : culler._deferredDebugNodes)
+    {
+        node->accept(*cv);
+    }
+    culler._deferredDebugNodes.clear();
+}
+
+void
+RexTerrainEngineNode::prefetch(TerrainCuller& culler, osgUtil::CullVisitor* cv)
+{
+    OE_PROFILING_ZONE;
+
+    const osg::Camera* camera = cv->getCurrentCamera();
+    const osg::FrameStamp* stamp = cv->getFrameStamp();
+
+    // Only cameras that drive tile loading of their own
+    if (camera == nullptr ||
+        stamp == nullptr ||
+        culler._isSpy ||
+        camera->getReferenceFrame() == osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT ||
+        osgEarth::Util::Shadowing::isShadowCamera(camera))
+    {
+        return;
+    }
+
+    // Track the eye's velocity, smoothed a bit so one uneven frame
+    // doesn't throw the prediction off. A long pause resets it.
+    osg::Vec3d eye = camera->getInverseViewMatrix().getTrans();
+    double time = stamp->getReferenceTime();
+
+    CameraMotion& motion = _cameraMotion.get(camera);
+    double dt = time - motion._time;
+
+    if (motion._time < 0.0 || dt > 1.0)
+    {
+        motion._velocity.set(0, 0, 0);
+    }
+    else if (dt > 0.0)
+    {
+        motion._velocity = motion._velocity*0.5 + ((eye - motion._eye) / dt)*0.5;
+    }
+
+    motion._eye = eye;
+    motion._time = time;
+
+    // Predicted eye offset; skip it if the camera is barely moving,
+    // since the regular cull already covers that view.
+    osg::Vec3d offset = motion._velocity * options().prefetchLookahead().get();
+
+    const SelectionInfo& si = getEngineContext()->getSelectionInfo();
+    if (si.getNumLODs() == 0u)
+        return;
+    double minOffset = 0.25 * si.getLOD(si.getNumLODs() - 1)._visibilityRange;
+
+    if (offset.length() < minOffset)
+        return;
+
+    // Same orientation, eye moved along the velocity. Replace the view
+    // portion of the current modelview with the predicted one.
+    osg::Matrixd predictedView = osg::Matrixd::translate(-offset) * camera->getViewMatrix();
+    osg::Matrixd modelView = *cv->getModelViewMatrix() * camera->getInverseViewMatrix() * predictedView;
+
+    TerrainCuller prefetcher(cv, getEngineContext());
+    prefetcher.setup(culler);
+    prefetcher.setPrefetch(modelView);
+    _terrain->accept(prefetcher);
+}
+
 void
 RexTerrainEngineNode::event_traverse(osg::NodeVisitor& nv)
 {
@@ -798,6 +1067,31 @@ RexTerrainEngineNode::update_traverse(osg::NodeVisitor& nv)
         // advance the frame clock for this new frame.
         _clock.update();
 
+        // publish the engine statistics and run the stats exporters
+        static Stats::Gauge& s_tilesResident = Stats::gauge("osgearth_rex_tiles_resident");
+        static Stats::Gauge& s_gpuBytes = Stats::gauge("osgearth_rex_texture_bytes");
+        s_tilesResident.set(_liveTiles->size());
+        s_gpuBytes.set(_liveTiles->getGPUMemoryUsage());
+        _textureMemory.set(_liveTiles->getGPUMemoryUsage());
+        Stats::frame(osgFrame);
+
+        // tile load priorities depend on the camera, so let the
+        // loading arena know they need re-evaluation.
+        JobArena::get(ARENA_LOAD_TILE)->advancePriorityEpoch();
+
+        // measure the last frame and rescale terrain detail to the target
+        DynamicResolution* dynamicResolution = _engineContext.valid() ? _engineContext->getDynamicResolution() : nullptr;
+        if (dynamicResolution)
+        {
+            dynamicResolution->update(nv.getFrameStamp());
+
+            static Stats::Gauge& s_lodScale = Stats::gauge("osgearth_rex_dynamic_lod_scale_percent");
+            s_lodScale.set((std::int64_t)(dynamicResolution->getLODScale() * 100.0f));
+
+            if (_tessellationErrorUniform.valid())
+                _tessellationErrorUniform->set(TESSELLATION_ERROR * dynamicResolution->getLODScale());
+        }
+
         if (_renderModelUpdateRequired)
         {
             PurgeOrphanedLayers visitor(getMap(), _renderBindings);
@@ -805,6 +1099,51 @@ RexTerrainEngineNode::update_traverse(osg::NodeVisitor& nv)
             _renderModelUpdateRequired = false;
         }
 
+        // re-edit the tiles under any terrain constraints that changed
+        if (!_constraintChanges.empty()) // not thread-safe but that's ok
+        {
+            std::vector<ConstraintChange> changes;
+            _constraintChanges.lock();
+            changes.swap(_constraintChanges);
+            _constraintChanges.unlock();
+
+            for (auto& change : changes)
+            {
+                osg::ref_ptr<TerrainConstraintLayer> layer;
+                if (change._layer.lock(layer))
+                {
+                    std::vector<const Layer*> layers;
+                    layers.push_back(layer.get());
+                    invalidateRegion(layers, change._extent, layer->getMinLevel(), INT_MAX);
+                }
+            }
+        }
+
+        // reload only the tiles under any tile layer data that changed;
+        // each tile keeps its old data until the replacement merges.
+        if (!_dataChanges.empty()) // not thread-safe but that's ok
+        {
+            std::vector<DataChange> changes;
+            _dataChanges.lock();
+            changes.swap(_dataChanges);
+            _dataChanges.unlock();
+
+            for (auto& change : changes)
+            {
+                osg::ref_ptr<TileLayer> layer;
+                if (change._layer.lock(layer) && layer->isOpen())
+                {
+                    std::vector<const Layer*> layers;
+                    layers.push_back(layer.get());
+                    invalidateRegion(
+                        layers,
+                        change._extent,
+                        change._minLevel,
+                        osg::minimum(change._maxLevel, (unsigned)INT_MAX));
+                }
+            }
+        }
+
         // Called once on the first update pass to ensure that all existing
         // layers have their extents cached properly
         if (_cachedLayerExtentsComputeRequired)
@@ -1095,6 +1434,8 @@ RexTerrainEngineNode::addTileLayer(Layer* tileLayer)
             // non-image tile layer.
         }
 
+        listenForDataChanges(tileLayer, true);
+
         if (_terrain)
         {
             // Update the existing render models, and trigger a data reload.
@@ -1114,6 +1455,8 @@ RexTerrainEngineNode::removeImageLayer( ImageLayer* layerRemoved )
 {
     if ( layerRemoved )
     {
+        listenForDataChanges(layerRemoved, false);
+
         // for a shared layer, release the shared image unit.
         if ( layerRemoved->getEnabled() && layerRemoved->isShared() )
         {
@@ -1156,11 +1499,68 @@ RexTerrainEngineNode::removeImageLayer( ImageLayer* layerRemoved )
     //OE_INFO << LC << " Updated " << updater._count << " tiles\n";
 }
 
+void
+RexTerrainEngineNode::onConstraintsChanged(TerrainConstraintLayer* layer, const GeoExtent& extent)
+{
+    // may come from any thread, so wait for the update traversal
+    ConstraintChange change;
+    change._layer = layer;
+    change._extent = extent;
+
+    _constraintChanges.lock();
+    _constraintChanges.push_back(change);
+    _constraintChanges.unlock();
+}
+
+void
+RexTerrainEngineNode::onDataChanged(TileLayer* layer, const GeoExtent& extent, unsigned minLevel, unsigned maxLevel)
+{
+    // may come from any thread, so wait for the update traversal
+    DataChange change;
+    change._layer = layer;
+    change._extent = extent;
+    change._minLevel = minLevel;
+    change._maxLevel = maxLevel;
+
+    _dataChanges.lock();
+    _dataChanges.push_back(change);
+    _dataChanges.unlock();
+}
+
+void
+RexTerrainEngineNode::listenForDataChanges(Layer* layer, bool listen)
+{
+    TileLayer* tileLayer = dynamic_cast<TileLayer*>(layer);
+    if (tileLayer)
+    {
+        if (!_dataChangeCallback.valid())
+            _dataChangeCallback = new RexTerrainEngineNodeDataChangeCallbackProxy(this);
+
+        // a layer that opens again is already listening
+        tileLayer->removeChangeCallback(_dataChangeCallback.get());
+        if (listen)
+            tileLayer->addChangeCallback(_dataChangeCallback.get());
+    }
+}
+
 void
 RexTerrainEngineNode::addElevationLayer(Layer* layer )
 {
     if (layer && layer->getEnabled())
     {
+        TerrainConstraintLayer* constraintLayer = dynamic_cast<TerrainConstraintLayer*>(layer);
+        if (constraintLayer)
+        {
+            if (!_constraintCallback.valid())
+                _constraintCallback = new RexTerrainEngineNodeConstraintCallbackProxy(this);
+
+            // a layer that opens again is already listening
+            constraintLayer->removeCallback(_constraintCallback.get());
+            constraintLayer->addCallback(_constraintCallback.get());
+        }
+
+        listenForDataChanges(layer, true);
+
         std::vector<const Layer*> layers;
         layers.push_back(layer);
         invalidateRegion(layers, GeoExtent::INVALID, 0u, INT_MAX);
@@ -1173,6 +1573,14 @@ RexTerrainEngineNode::removeElevationLayer( Layer* layer)
     // only need to refresh is the elevation layer is visible.
     if (layer)
     {
+        TerrainConstraintLayer* constraintLayer = dynamic_cast<TerrainConstraintLayer*>(layer);
+        if (constraintLayer && _constraintCallback.valid())
+        {
+            constraintLayer->removeCallback(_constraintCallback.get());
+        }
+
+        listenForDataChanges(layer, false);
+
         std::vector<const Layer*> layers;
         layers.push_back(layer);
         invalidateRegion(layers, GeoExtent::INVALID, 0u, INT_MAX);
@@ -1241,7 +1649,13 @@ RexTerrainEngineNode::updateState()
             //package.load(surfaceVP, package.ENGINE_GEOM);
 
             // Default screen space error = 50 pixels
-            surfaceStateSet->addUniform(new osg::Uniform("oe_terrain_sse", 50.0f));
+            _tessellationErrorUniform = new osg::Uniform("oe_terrain_sse", TESSELLATION_ERROR);
+            surfaceStateSet->addUniform(_tessellationErrorUniform.get());
+
+            if (options().compactTessellationMesh() == true)
+            {
+                surfaceStateSet->setDefine("OE_TERRAIN_COMPACT_MESH");
+            }
 
 #ifdef HAVE_PATCH_PARAMETER
             // backwards compatibility
@@ -1299,6 +1713,18 @@ RexTerrainEngineNode::updateState()
             surfaceStateSet->setDefine("OE_TERRAIN_CAST_SHADOWS");
         }
 
+        // Indirect multi-draw? Per-tile data then comes from a storage buffer.
+        if (_engineContext.valid() && _engineContext->getUseMultiDrawIndirect())
+        {
+            surfaceStateSet->setDefine("OE_TERRAIN_USE_MDI");
+        }
+
+        // Texture pages? Image layers may then sample from an array slot.
+        if (_engineContext.valid() && _engineContext->getTexturePages())
+        {
+            surfaceStateSet->setDefine("OE_TERRAIN_USE_TEXTURE_PAGES");
+        }
+
         // assemble color filter code snippets.
         bool haveColorFilters = false;
         {
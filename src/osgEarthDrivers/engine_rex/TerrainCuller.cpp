@@ -32,9 +32,13 @@ TerrainCuller::TerrainCuller(osgUtil::CullVisitor* cullVisitor, EngineContext* c
 _camera(0L),
 _currentTileNode(0L),
 _orphanedPassesDetected(0u),
+_numTilesVisible(0u),
 _cv(cullVisitor),
 _context(context),
-_layerExtents(nullptr)
+_layerExtents(nullptr),
+_cullStack(cullVisitor),
+_isPrefetch(false),
+_dynamicLODScale(1.0f)
 {
     setVisitorType(CULL_VISITOR);
     setTraversalMode(TRAVERSE_ALL_CHILDREN);
@@ -46,7 +50,10 @@ _layerExtents(nullptr)
     pushViewport(_cv->getViewport());
     pushProjectionMatrix(_cv->getProjectionMatrix());
     pushModelViewMatrix(_cv->getModelViewMatrix(), _cv->getCurrentCamera()->getReferenceFrame());
-    setLODScale(_cv->getLODScale());
+    // dynamic resolution scales the camera's LOD ranges for terrain only
+    if (context->getDynamicResolution())
+        _dynamicLODScale = context->getDynamicResolution()->getLODScale();
+    setLODScale(_cv->getLODScale() * _dynamicLODScale);
     setUserDataContainer(_cv->getUserDataContainer());
     _camera = _cv->getCurrentCamera();
     bool temp;
@@ -64,13 +71,68 @@ TerrainCuller::setup(const Map* map, LayerExtentMap& layerExtents, const RenderB
     unsigned frameNum = getFrameStamp() ? getFrameStamp()->getFrameNumber() : 0u;
     _layerExtents = &layerExtents;
     _terrain.setup(map, bindings, frameNum, _cv);
+    _terrain._drawState->_useMultiDrawIndirect = _context->getUseMultiDrawIndirect();
+    _terrain._drawState->_texturePages = _context->getTexturePages();
+    _terrain._drawState->_gpuCuller = _context->getGPUCuller();
+}
+
+void
+TerrainCuller::setup(const TerrainCuller& prototype)
+{
+    _layerExtents = prototype._layerExtents;
+    _terrain.setup(prototype._terrain);
+
+    // the scale may have moved since the prototype was made
+    _dynamicLODScale = prototype._dynamicLODScale;
+    setLODScale(prototype.getLODScale());
+}
+
+void
+TerrainCuller::setIsolated(bool value)
+{
+    if (value)
+        _cullStack = this;
+    else
+        _cullStack = _cv;
+}
+
+void
+TerrainCuller::merge(TerrainCuller& other)
+{
+    _terrain.merge(other._terrain);
+    _orphanedPassesDetected += other._orphanedPassesDetected;
+    _numTilesVisible += other._numTilesVisible;
+    _deferredDebugNodes.insert(
+        _deferredDebugNodes.end(),
+        other._deferredDebugNodes.begin(),
+        other._deferredDebugNodes.end());
+}
+
+void
+TerrainCuller::setPrefetch(const osg::Matrix& modelViewMatrix)
+{
+    _isPrefetch = true;
+
+    // the predicted view must not disturb the CullVisitor's stack
+    setIsolated(true);
+    popModelViewMatrix();
+    pushModelViewMatrix(createOrReuseMatrix(modelViewMatrix), _camera->getReferenceFrame());
 }
 
 float
 TerrainCuller::getDistanceToViewPoint(const osg::Vec3& pos, bool withLODScale) const
 {
+    // An isolated culler cannot touch the CullVisitor, so compute the
+    // distance the same way osgUtil::CullVisitor does, against our own stack.
+    if (isIsolated())
+    {
+        float d = (pos - getViewPointLocal()).length();
+        return withLODScale ? d * getLODScale() : d;
+    }
+
     // pass through, in case developer has overridden the method in the prototype CV
-    return _cv->getDistanceToViewPoint(pos, withLODScale);
+    float d = _cv->getDistanceToViewPoint(pos, withLODScale);
+    return withLODScale ? d * _dynamicLODScale : d;
 }
 
 DrawTileCommand*
@@ -99,11 +161,13 @@ TerrainCuller::addDrawCommand(UID uid, const TileRenderModel* model, const Rende
         if (drawable->_draw)
         {
             // Cull based on the layer extent.
+            // (Use find() so concurrent cullers never insert into the shared map.)
             if (drawable->_layer)
             {
-                const LayerExtent& le = (*_layerExtents)[drawable->_layer->getUID()];
-                if (le._extent.isValid() &&
-                    ! le._extent.intersects(tileNode->getKey().getExtent(), false))
+                LayerExtentMap::const_iterator le = _layerExtents->find(drawable->_layer->getUID());
+                if (le != _layerExtents->end() &&
+                    le->second._extent.isValid() &&
+                    ! le->second._extent.intersects(tileNode->getKey().getExtent(), false))
                 {
                     // culled out!
                     //OE_DEBUG << LC << "Skippping " << drawable->_layer->getName() 
@@ -119,7 +183,7 @@ TerrainCuller::addDrawCommand(UID uid, const TileRenderModel* model, const Rende
             // install everything we need in the Draw Command:
             tile->_colorSamplers = pass ? &(pass->samplers()) : 0L;
             tile->_sharedSamplers = &model->_sharedSamplers;
-            tile->_modelViewMatrix = _cv->getModelViewMatrix();
+            tile->_modelViewMatrix = _cullStack->getModelViewMatrix();
             tile->_keyValue = tileNode->getTileKeyValue();
             tile->_geom = surface->getDrawable()->_geom.get();
             tile->_tile = surface->getDrawable();
@@ -196,11 +260,11 @@ TerrainCuller::apply(osg::Node& node)
 bool
 TerrainCuller::isCulledToBBox(osg::Transform* node, const osg::BoundingBox& box)
 {
-    osg::RefMatrix* matrix = createOrReuseMatrix(*_cv->getModelViewMatrix());
+    osg::RefMatrix* matrix = createOrReuseMatrix(*_cullStack->getModelViewMatrix());
     node->computeLocalToWorldMatrix(*matrix, this);
-    _cv->pushModelViewMatrix(matrix, node->getReferenceFrame());
-    bool culled = _cv->isCulled(box);
-    _cv->popModelViewMatrix();
+    _cullStack->pushModelViewMatrix(matrix, node->getReferenceFrame());
+    bool culled = _cullStack->isCulled(box);
+    _cullStack->popModelViewMatrix();
     return culled;
 }
 
@@ -213,6 +277,10 @@ TerrainCuller::apply(TileNode& node)
     // we can set it's "layerOrder" member to zero at the end, so the rendering engine
     // knows to blend it with the terrain geometry color.
     _firstDrawCommandForTile = 0L;
+
+    // prefetching draws nothing
+    if (_isPrefetch)
+        return;
         
     if (!_terrain.patchLayers().empty() && node.getSurfaceNode() && !node.isEmpty())
     {
@@ -231,7 +299,7 @@ TerrainCuller::apply(TileNode& node)
                 continue;
 
             // is the tile in visible range?
-            float range = _cv->getDistanceToViewPoint(node.getBound().center(), true) - node.getBound().radius();
+            float range = getDistanceToViewPoint(node.getBound().center(), true) - node.getBound().radius();
             if (layer->getMaxVisibleRange() < range)
                 continue;
 
@@ -243,11 +311,11 @@ TerrainCuller::apply(TileNode& node)
             SurfaceNode* surface = node.getSurfaceNode();
                     
             // push the surface matrix:
-            osg::RefMatrix* matrix = createOrReuseMatrix(*_cv->getModelViewMatrix());
+            osg::RefMatrix* matrix = createOrReuseMatrix(*_cullStack->getModelViewMatrix());
             surface->computeLocalToWorldMatrix(*matrix,this);
-            _cv->pushModelViewMatrix(matrix, surface->getReferenceFrame());
+            _cullStack->pushModelViewMatrix(matrix, surface->getReferenceFrame());
 
-            if (!_cv->isCulled(surface->getAlignedBoundingBox()))
+            if (!_cullStack->isCulled(surface->getAlignedBoundingBox()))
             {
                 // Add the draw command:
                 for(std::vector<PatchLayer*>::iterator i = _patchLayers.begin();
@@ -265,7 +333,7 @@ TerrainCuller::apply(TileNode& node)
                 }
             }
 
-           _cv->popModelViewMatrix();
+           _cullStack->popModelViewMatrix();
         }
     }
 }
@@ -273,17 +341,22 @@ TerrainCuller::apply(TileNode& node)
 void
 TerrainCuller::apply(SurfaceNode& node)
 {
+    // prefetching only drives subdivision and loading in the TileNodes
+    if (_isPrefetch)
+        return;
+
     TileRenderModel& renderModel = _currentTileNode->renderModel();
 
-    float range = _cv->getDistanceToViewPoint(node.getBound().center(), true) - node.getBound().radius();
+    float range = getDistanceToViewPoint(node.getBound().center(), true) - node.getBound().radius();
 
     // push the surface matrix:
-    osg::RefMatrix* matrix = createOrReuseMatrix(*getModelViewMatrix());
+    osg::RefMatrix* matrix = createOrReuseMatrix(*_cullStack->getModelViewMatrix());
     node.computeLocalToWorldMatrix(*matrix,this);
-    _cv->pushModelViewMatrix(matrix, node.getReferenceFrame());
+    _cullStack->pushModelViewMatrix(matrix, node.getReferenceFrame());
 
-    // now test against the local bounding box for tighter culling:
-    if (!_cv->isCulled(node.getAlignedBoundingBox()))
+    // now test against the local bounding box for tighter culling,
+    // unless the GPU culls the surface draws for us:
+    if (_terrain._drawState->_gpuCuller || !_cullStack->isCulled(node.getAlignedBoundingBox()))
     {
         if (!_isSpy)
         {
@@ -293,6 +366,8 @@ TerrainCuller::apply(SurfaceNode& node)
         int order = 0;
         unsigned count = 0;
 
+        ++_numTilesVisible;
+
         // First go through any legit rendering pass data in the Tile and
         // and add a DrawCommand for each.
         for (unsigned p = 0; p < renderModel._passes.size(); ++p)
@@ -345,11 +420,14 @@ TerrainCuller::apply(SurfaceNode& node)
     }
                 
     // pop the matrix from the cull stack
-    _cv->popModelViewMatrix();
+    _cullStack->popModelViewMatrix();
 
     if (node.getDebugNode())
     {
-        node.accept(*_cv);
+        if (isIsolated())
+            _deferredDebugNodes.push_back(&node);
+        else
+            node.accept(*_cv);
     }
 }
 
@@ -115,6 +115,47 @@ TerrainRenderData::setup(const Map* map,
     LayerDrawable* blank = addLayerDrawable(0L);
 }
 
+void
+TerrainRenderData::setup(const TerrainRenderData& prototype)
+{
+    _bindings = prototype._bindings;
+
+    _drawState = new DrawState();
+    _drawState->_bindings = prototype._drawState->_bindings;
+    _drawState->_useMultiDrawIndirect = prototype._drawState->_useMultiDrawIndirect;
+    _drawState->_texturePages = prototype._drawState->_texturePages;
+    _drawState->_gpuCuller = prototype._drawState->_gpuCuller;
+
+    _patchLayers = prototype._patchLayers;
+
+    // Mirror the prototype's layer list exactly, so that merge() can
+    // match layers by index.
+    for (LayerDrawableList::const_iterator i = prototype._layerList.begin(); i != prototype._layerList.end(); ++i)
+    {
+        LayerDrawable* ld = addLayerDrawable(i->get()->_layer);
+        ld->_draw = i->get()->_draw;
+    }
+}
+
+void
+TerrainRenderData::merge(const TerrainRenderData& other)
+{
+    OE_SOFT_ASSERT_AND_RETURN(other._layerList.size() == _layerList.size(), __func__, );
+
+    for (unsigned i = 0; i < _layerList.size(); ++i)
+    {
+        const DrawTileCommands& src = other._layerList[i]->_tiles;
+        DrawTileCommands& dst = _layerList[i]->_tiles;
+        dst.insert(dst.end(), src.begin(), src.end());
+    }
+
+    if (other._drawState->_bs.valid())
+    {
+        _drawState->_bs.expandBy(other._drawState->_bs);
+        _drawState->_box.expandBy(_drawState->_bs);
+    }
+}
+
 namespace
 {
     struct DebugCallback : public osg::Drawable::DrawCallback
@@ -0,0 +1,405 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2008-2014 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "TexturePage"
+#include <osgEarth/GLUtils>
+#include <osg/GLExtensions>
+#include <osg/State>
+#include <tuple>
+
+using namespace osgEarth::REX;
+using namespace osgEarth;
+
+#define LC "[TexturePage] "
+
+// Approximate size of a new page; each page holds at least MIN_SLOTS
+// and at most MAX_SLOTS images (256 is the GL3 minimum layer count).
+#define PAGE_TARGET_BYTES (32u * 1024u * 1024u)
+#define PAGE_MIN_SLOTS 16u
+#define PAGE_MAX_SLOTS 256u
+
+namespace
+{
+    // glTexStorage requires a sized internal format. Returns 0 for
+    // legacy formats that have no sized equivalent we can use.
+    GLenum getSizedFormat(GLint internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case 3:
+        case GL_RGB:  return GL_RGB8;
+        case 4:
+        case GL_RGBA: return GL_RGBA8;
+        case GL_RED:  return GL_R8;
+        case GL_RG:   return GL_RG8;
+        case 1:
+        case 2:
+        case GL_ALPHA:
+        case GL_LUMINANCE:
+        case GL_LUMINANCE_ALPHA:
+            return 0;
+        default:
+            return internalFormat;
+        }
+    }
+
+    // Size in bytes of one mipmap level of an image
+    GLsizei getLevelSize(const osg::Image* image, unsigned level)
+    {
+        unsigned next = level + 1 < image->getNumMipmapLevels() ?
+            image->getMipmapOffset(level + 1) :
+            image->getTotalSizeInBytesIncludingMipmaps();
+
+        return next - image->getMipmapOffset(level);
+    }
+
+    // Uploads every mipmap level of an image into one layer of the currently
+    // bound texture array.
+    void uploadLayer(osg::State& state, const osg::Image* image, unsigned layer, unsigned levels)
+    {
+        osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+        GLint internalFormat = image->getInternalTextureFormat();
+        bool compressed = osg::Texture::isCompressedInternalFormat(internalFormat);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, image->getPacking());
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, image->getRowLength());
+
+        for (unsigned level = 0; level < levels; ++level)
+        {
+            GLsizei width = osg::maximum(image->s() >> level, 1);
+            GLsizei height = osg::maximum(image->t() >> level, 1);
+
+            if (compressed)
+            {
+                ext->glCompressedTexSubImage3D(
+                    GL_TEXTURE_2D_ARRAY, level,
+                    0, 0, layer,
+                    width, height, 1,
+                    internalFormat,
+                    getLevelSize(image, level),
+                    image->getMipmapData(level));
+            }
+            else
+            {
+                ext->glTexSubImage3D(
+                    GL_TEXTURE_2D_ARRAY, level,
+                    0, 0, layer,
+                    width, height, 1,
+                    image->getPixelFormat(),
+                    image->getDataType(),
+                    image->getMipmapData(level));
+            }
+        }
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+}
+
+//........................................................................
+
+PagedTexture::PagedTexture(const osg::Texture2D& source, TexturePage* page, unsigned slot) :
+    osg::Texture2D(source, osg::CopyOp::SHALLOW_COPY),
+    _page(page),
+    _slot(slot)
+{
+    //nop
+}
+
+PagedTexture::~PagedTexture()
+{
+    _page->remove(_slot);
+}
+
+void
+PagedTexture::apply(osg::State& state) const
+{
+    _page->getTexture()->apply(state);
+}
+
+//........................................................................
+
+// Allocates the page's storage and uploads each slot as it changes.
+// We do this ourselves instead of setting images on the Texture2DArray
+// because OSG only re-uploads a layer when its image's modified count
+// changes, which a recycled slot's new image won't reliably do.
+struct TexturePage::Upload : public osg::Texture2DArray::SubloadCallback
+{
+    TexturePage* _page;
+
+    Upload(TexturePage* page) : _page(page) { }
+
+    void load(const osg::Texture2DArray& texture, osg::State& state) const override
+    {
+        GLFunctions& gl = GLFunctions::get(state);
+        osg::GLExtensions* ext = state.get<osg::GLExtensions>();
+
+        GLint internalFormat = texture.getInternalFormat();
+        GLenum sizedFormat = getSizedFormat(internalFormat);
+        unsigned levels = osg::maximum(texture.getNumMipmapLevels(), 1u);
+        GLsizei width = texture.getTextureWidth();
+        GLsizei height = texture.getTextureHeight();
+        GLsizei depth = texture.getTextureDepth();
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+        if (gl.glTexStorage3D && sizedFormat != 0)
+        {
+            gl.glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, sizedFormat, width, height, depth);
+        }
+        else
+        {
+            for (unsigned level = 0; level < levels; ++level)
+            {
+                GLsizei w = osg::maximum(width >> level, 1);
+                GLsizei h = osg::maximum(height >> level, 1);
+
+                if (osg::Texture::isCompressedInternalFormat(internalFormat))
+                {
+                    ext->glCompressedTexImage3D(
+                        GL_TEXTURE_2D_ARRAY, level, internalFormat,
+                        w, h, depth, 0,
+                        _page->_levelSizes[level] * depth,
+                        nullptr);
+                }
+                else
+                {
+                    ext->glTexImage3D(
+                        GL_TEXTURE_2D_ARRAY, level, internalFormat,
+                        w, h, depth, 0,
+                        texture.getSourceFormat(), texture.getSourceType(),
+                        nullptr);
+                }
+            }
+        }
+
+        // New storage, so every slot in use needs uploading:
+        UploadState& uploaded = _page->_uploaded[state.getContextID()];
+        uploaded._slots.assign(depth, 0u);
+        uploaded._revision = 0u;
+
+        subload(texture, state);
+    }
+
+    void subload(const osg::Texture2DArray& texture, osg::State& state) const override
+    {
+        UploadState& uploaded = _page->_uploaded[state.getContextID()];
+
+        // Collect the slots that changed since the last upload to this
+        // context. Upload outside the lock so loaders aren't held up.
+        std::vector<std::pair<unsigned, osg::ref_ptr<const osg::Image> > > pending;
+        {
+            ScopedMutexLock lock(_page->_mutex);
+
+            if (uploaded._revision == _page->_revision)
+                return;
+
+            for (unsigned i = 0; i < _page->_slots.size(); ++i)
+            {
+                const Slot& slot = _page->_slots[i];
+                if (slot._image.valid() && uploaded._slots[i] != slot._revision)
+                {
+                    pending.emplace_back(i, slot._image);
+                    uploaded._slots[i] = slot._revision;
+                }
+            }
+
+            uploaded._revision = _page->_revision;
+        }
+
+        unsigned levels = osg::maximum(texture.getNumMipmapLevels(), 1u);
+
+        for (auto& p : pending)
+        {
+            uploadLayer(state, p.second.get(), p.first, levels);
+        }
+    }
+};
+
+TexturePage::TexturePage(const osg::Texture2D& prototype, unsigned numSlots) :
+    _revision(0u),
+    _mutex("TexturePage(OE)")
+{
+    const osg::Image* image = prototype.getImage();
+
+    // remember the level sizes for allocating compressed storage
+    for (unsigned level = 0; level < image->getNumMipmapLevels(); ++level)
+        _levelSizes.push_back(getLevelSize(image, level));
+
+    _texture = new osg::Texture2DArray();
+    _texture->setName("rex texture page");
+    _texture->setTextureSize(image->s(), image->t(), numSlots);
+    _texture->setInternalFormat(image->getInternalTextureFormat());
+    _texture->setSourceFormat(image->getPixelFormat());
+    _texture->setSourceType(image->getDataType());
+    _texture->setNumMipmapLevels(image->getNumMipmapLevels());
+    _texture->setFilter(osg::Texture::MIN_FILTER, prototype.getFilter(osg::Texture::MIN_FILTER));
+    _texture->setFilter(osg::Texture::MAG_FILTER, prototype.getFilter(osg::Texture::MAG_FILTER));
+    _texture->setWrap(osg::Texture::WRAP_S, prototype.getWrap(osg::Texture::WRAP_S));
+    _texture->setWrap(osg::Texture::WRAP_T, prototype.getWrap(osg::Texture::WRAP_T));
+    _texture->setMaxAnisotropy(prototype.getMaxAnisotropy());
+    _texture->setSwizzle(prototype.getSwizzle());
+    _texture->setResizeNonPowerOfTwoHint(false);
+    _texture->setSubloadCallback(new Upload(this));
+
+    _slots.resize(numSlots);
+
+    // hand out low slots first
+    _freeSlots.reserve(numSlots);
+    for (unsigned i = numSlots; i > 0; --i)
+        _freeSlots.push_back(i - 1);
+}
+
+PagedTexture*
+TexturePage::add(const osg::Texture2D& texture)
+{
+    ScopedMutexLock lock(_mutex);
+
+    if (_freeSlots.empty())
+        return nullptr;
+
+    unsigned slot = _freeSlots.back();
+    _freeSlots.pop_back();
+
+    _slots[slot]._image = texture.getImage();
+    _slots[slot]._revision = ++_revision;
+
+    return new PagedTexture(texture, this, slot);
+}
+
+void
+TexturePage::remove(unsigned slot)
+{
+    ScopedMutexLock lock(_mutex);
+    _slots[slot]._image = nullptr;
+    _freeSlots.push_back(slot);
+}
+
+void
+TexturePage::resizeGLObjectBuffers(unsigned maxSize)
+{
+    _texture->resizeGLObjectBuffers(maxSize);
+    _uploaded.resize(maxSize);
+}
+
+void
+TexturePage::releaseGLObjects(osg::State* state) const
+{
+    // the next apply will re-allocate and re-upload through load().
+    _texture->releaseGLObjects(state);
+}
+
+//........................................................................
+
+bool
+TexturePagePool::Key::operator < (const Key& rhs) const
+{
+    return
+        std::tie(_s, _t, _internalFormat, _pixelFormat, _dataType, _mipmapLevels, _minFilter, _magFilter, _wrapS, _wrapT, _maxAnisotropy, _swizzle) <
+        std::tie(rhs._s, rhs._t, rhs._internalFormat, rhs._pixelFormat, rhs._dataType, rhs._mipmapLevels, rhs._minFilter, rhs._magFilter, rhs._wrapS, rhs._wrapT, rhs._maxAnisotropy, rhs._swizzle);
+}
+
+TexturePagePool::TexturePagePool() :
+    _mutex("TexturePagePool(OE)")
+{
+    _units[0] = -1;
+    _units[1] = -1;
+}
+
+osg::Texture*
+TexturePagePool::page(osg::Texture* texture)
+{
+    // Only plain, single-image, static 2D textures can go into a page.
+    // A texture referenced from elsewhere (like a shared "empty" texture)
+    // stays put, since paging would copy it once per tile.
+    osg::Texture2D* tex2d = dynamic_cast<osg::Texture2D*>(texture);
+    if (tex2d == nullptr ||
+        dynamic_cast<PagedTexture*>(tex2d) != nullptr ||
+        tex2d->referenceCount() > 1 ||
+        tex2d->getSubloadCallback() != nullptr ||
+        tex2d->getInternalFormatMode() != osg::Texture::USE_IMAGE_DATA_FORMAT)
+    {
+        return texture;
+    }
+
+    const osg::Image* image = tex2d->getImage();
+    if (image == nullptr ||
+        image->valid() == false ||
+        image->r() != 1 ||
+        image->requiresUpdateCall())
+    {
+        return texture;
+    }
+
+    Key key;
+    key._s = image->s();
+    key._t = image->t();
+    key._internalFormat = image->getInternalTextureFormat();
+    key._pixelFormat = image->getPixelFormat();
+    key._dataType = image->getDataType();
+    key._mipmapLevels = image->getNumMipmapLevels();
+    key._minFilter = tex2d->getFilter(osg::Texture::MIN_FILTER);
+    key._magFilter = tex2d->getFilter(osg::Texture::MAG_FILTER);
+    key._wrapS = tex2d->getWrap(osg::Texture::WRAP_S);
+    key._wrapT = tex2d->getWrap(osg::Texture::WRAP_T);
+    key._maxAnisotropy = tex2d->getMaxAnisotropy();
+    key._swizzle = tex2d->getSwizzle();
+
+    ScopedMutexLock lock(_mutex);
+
+    Pages& pages = _pages[key];
+    for (auto& page : pages)
+    {
+        PagedTexture* paged = page->add(*tex2d);
+        if (paged)
+            return paged;
+    }
+
+    unsigned bytes = osg::maximum(image->getTotalSizeInBytesIncludingMipmaps(), 1u);
+    unsigned numSlots = osg::clampBetween(PAGE_TARGET_BYTES / bytes, PAGE_MIN_SLOTS, PAGE_MAX_SLOTS);
+
+    OE_DEBUG << LC << "New page: " << numSlots << " x " << key._s << "x" << key._t
+        << " (" << pages.size() + 1 << " pages of this format)" << std::endl;
+
+    pages.push_back(new TexturePage(*tex2d, numSlots));
+    return pages.back()->add(*tex2d);
+}
+
+void
+TexturePagePool::clear()
+{
+    ScopedMutexLock lock(_mutex);
+    _pages.clear();
+}
+
+void
+TexturePagePool::resizeGLObjectBuffers(unsigned maxSize)
+{
+    ScopedMutexLock lock(_mutex);
+    for (auto& pages : _pages)
+        for (auto& page : pages.second)
+            page->resizeGLObjectBuffers(maxSize);
+}
+
+void
+TexturePagePool::releaseGLObjects(osg::State* state) const
+{
+    ScopedMutexLock lock(_mutex);
+    for (auto& pages : _pages)
+        for (auto& page : pages.second)
+            page->releaseGLObjects(state);
+}
@@ -152,9 +152,42 @@ TileDrawable::setElevationRaster(const osg::Image*   image,
         std::copy(verts.begin(), verts.end(), _mesh.begin());
     }
 
+    // the mesh moved, so any KdTree over it is stale
+    if (getShape())
+    {
+        Threading::ScopedMutexLock lock(_kdTreeMutex);
+        setShape(nullptr);
+    }
+
     dirtyBound();
 }
 
+void
+TileDrawable::buildIntersectionTree()
+{
+    if (getShape() || _mesh.empty() || !_geom.valid())
+        return;
+
+    Threading::ScopedMutexLock lock(_kdTreeMutex);
+    if (getShape())
+        return;
+
+    // KdTree builds from a Geometry, so wrap the elevated mesh in one;
+    // the tree keeps the vertex copy and the shared index list.
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+    geom->setUseDisplayList(false);
+    geom->setUseVertexBufferObjects(false); // leaves the shared indices' GL buffers alone
+    geom->setVertexArray(new osg::Vec3Array(_mesh.begin(), _mesh.end()));
+    geom->addPrimitiveSet(_geom->getDrawElements());
+
+    osg::ref_ptr<osg::KdTree> kdTree = new osg::KdTree();
+    osg::KdTree::BuildOptions options;
+    if (kdTree->build(options, geom.get()))
+    {
+        setShape(kdTree.get());
+    }
+}
+
 // Functor supplies triangles to things like IntersectionVisitor, ComputeBoundsVisitor, etc.
 void
 TileDrawable::accept(osg::PrimitiveFunctor& f) const
@@ -56,6 +56,86 @@ namespace
         osg::Matrixf(0.5f,0,0,0, 0,0.5f,0,0, 0,0,1.0f,0, 0.5f,0.0f,0,1.0f)
     };
 
+    // Bytes a texture occupies on the GPU, including its mipmaps
+    std::size_t getTextureGPUMemoryUsage(const osg::Texture* tex)
+    {
+        if (!tex)
+            return 0u;
+
+        std::size_t bytes = 0u;
+        bool hasMipmaps = false;
+
+        for (unsigned i = 0; i < tex->getNumImages(); ++i)
+        {
+            const osg::Image* image = tex->getImage(i);
+            if (image && image->valid())
+            {
+                bytes += image->getTotalSizeInBytesIncludingMipmaps();
+                hasMipmaps = hasMipmaps || image->isMipmap();
+            }
+        }
+
+        // Image data may be gone already (unref after apply), so
+        // fall back on the allocated size of the texture itself.
+        if (bytes == 0u && tex->getTextureWidth() > 0)
+        {
+            bytes = osg::Image::computeImageSizeInBytes(
+                tex->getTextureWidth(),
+                osg::maximum(tex->getTextureHeight(), 1),
+                osg::maximum(tex->getTextureDepth(), 1),
+                tex->getInternalFormat(),
+                GL_UNSIGNED_BYTE,
+                1);
+        }
+
+        // Mipmaps generated on the GPU add another third.
+        GLint minFilter = tex->getFilter(osg::Texture::MIN_FILTER);
+        if (!hasMipmaps && minFilter != GL_LINEAR && minFilter != GL_NEAREST)
+        {
+            bytes += bytes / 3u;
+        }
+
+        return bytes;
+    }
+
+    // Bytes of vertex and index data a geometry uploads
+    std::size_t getGeometryGPUMemoryUsage(const SharedGeometry* geom)
+    {
+        std::size_t bytes = 0u;
+        const osg::Array* arrays[5] = {
+            geom->getVertexArray(),
+            geom->getNormalArray(),
+            geom->getTexCoordArray(),
+            geom->getNeighborArray(),
+            geom->getNeighborNormalArray() };
+
+        for (unsigned i = 0; i < 5; ++i)
+        {
+            if (arrays[i])
+                bytes += arrays[i]->getTotalDataSize();
+        }
+
+        if (geom->getDrawElements())
+            bytes += geom->getDrawElements()->getTotalDataSize();
+
+        return bytes;
+    }
+
+    // Finest sample resolution in an elevation texture. Samples that came
+    // from no data at all carry FLT_MAX.
+    float getFinestResolution(const ElevationTexture* tex)
+    {
+        const float* res = tex->getResolutions();
+        if (res == nullptr)
+            return 0.0f;
+
+        float finest = FLT_MAX;
+        unsigned count = tex->reader().s() * tex->reader().t();
+        for (unsigned i = 0; i < count; ++i)
+            finest = osg::minimum(finest, res[i]);
+        return finest;
+    }
+
     struct ObserverProgress : public ProgressCallback
     {
         osg::observer_ptr< osg::Referenced> _host;
@@ -79,9 +159,14 @@ _mutex("TileNode(OE)"),
 _loadQueue("TileNode LoadQueue(OE)"),
 _createChildAsync(true),
 _nextLoadManifestPtr(nullptr),
-_loadPriority(0.0f)
+_loadPriority(0.0f),
+_loadPriorityFrame(~0u),
+_gpuMemoryUsage(0u)
 {
-    //nop
+    // not visited yet, so the registry won't expire it
+    _tracking._lastTime = DBL_MAX;
+    _tracking._lastFrame = ~0u;
+    _tracking._lastRange = FLT_MAX;
 }
 
 TileNode::~TileNode()
@@ -253,6 +338,7 @@ TileNode::initializeData()
     }
 
     // register me.
+    updateGPUMemoryUsage();
     _context->liveTiles()->add( this );
 
     // signal the tile to start loading data:
@@ -391,7 +477,11 @@ TileNode::shouldSubDivide(TerrainCuller* culler, const SelectionInfo& selectionI
 
             if (context->getEngine()->getComputeRangeCallback())
             {
-                tileSizeInPixels = (*context->getEngine()->getComputeRangeCallback())(this, *culler->_cv);
+                // an isolated (parallel) culler must not expose the shared CullVisitor
+                osg::NodeVisitor& nv = culler->isIsolated() ?
+                    static_cast<osg::NodeVisitor&>(*culler) :
+                    static_cast<osg::NodeVisitor&>(*culler->_cv);
+                tileSizeInPixels = (*context->getEngine()->getComputeRangeCallback())(this, nv);
             }    
 
             if (tileSizeInPixels <= 0.0)
@@ -744,6 +834,12 @@ TileNode::traverse(osg::NodeVisitor& nv)
         // Otherwise traverse the surface.
         else if (_surface.valid())
         {
+            // intersect against a KdTree instead of every triangle
+            if (nv.getVisitorType() == nv.INTERSECTION_VISITOR && _surface->getDrawable())
+            {
+                _surface->getDrawable()->buildIntersectionTree();
+            }
+
             _surface->accept( nv );
         }
     }
@@ -993,9 +1089,39 @@ TileNode::merge(
 
     // Elevation data:
     const SamplerBinding& elevation = bindings[SamplerBinding::ELEVATION];
+    bool inheritElevation = false;
     if (elevation.isActive())
     {
+        // A child past the end of the real data gets a grid resampled from
+        // its ancestors. It adds no detail, so share the ancestor's texture
+        // through a scale/bias matrix instead of uploading a copy.
         if (model->elevationModel().valid() && model->elevationModel()->getTexture())
+        {
+            TileNode* parent = getParentTile();
+            const ElevationTexture* etex = dynamic_cast<const ElevationTexture*>(
+                model->elevationModel()->getTexture());
+            const ElevationTexture* ptex = parent ? dynamic_cast<const ElevationTexture*>(
+                parent->_renderModel._sharedSamplers[SamplerBinding::ELEVATION]._texture.get()) : nullptr;
+
+            if (etex && ptex && etex != ptex &&
+                getFinestResolution(etex) >= getFinestResolution(ptex))
+            {
+                inheritElevation = true;
+            }
+        }
+
+        if (inheritElevation)
+        {
+            if (_renderModel._sharedSamplers[SamplerBinding::ELEVATION].ownsTexture() ||
+                _renderModel._sharedSamplers[SamplerBinding::ELEVATION]._texture.valid() == false)
+            {
+                inheritSharedSampler(SamplerBinding::ELEVATION);
+                updateElevationRaster();
+                newElevationData = true;
+            }
+        }
+
+        else if (model->elevationModel().valid() && model->elevationModel()->getTexture())
         {
             osg::Texture* tex = model->elevationModel()->getTexture();
             int revision = model->elevationModel()->getRevision();
@@ -1026,7 +1152,18 @@ TileNode::merge(
     const SamplerBinding& normals = bindings[SamplerBinding::NORMAL];
     if (normals.isActive())
     {
-        if (model->elevationModel().valid() && model->elevationModel()->getTexture())
+        // the normal map follows the elevation it came from
+        if (inheritElevation)
+        {
+            if (_renderModel._sharedSamplers[SamplerBinding::NORMAL].ownsTexture() ||
+                _renderModel._sharedSamplers[SamplerBinding::NORMAL]._texture.valid() == false)
+            {
+                inheritSharedSampler(SamplerBinding::NORMAL);
+                updateNormalMap();
+            }
+        }
+
+        else if (model->elevationModel().valid() && model->elevationModel()->getTexture())
         {
             ElevationTexture* etex = static_cast<ElevationTexture*>(model->elevationModel()->getTexture());
             if (etex->getNormalMapTexture())
@@ -1174,6 +1311,8 @@ TileNode::merge(
 
     // Bump the data revision for the tile.
     ++_revision;
+
+    updateGPUMemoryUsage();
 }
 
 void TileNode::inheritSharedSampler(int binding)
@@ -1232,6 +1371,8 @@ TileNode::refreshSharedSamplers(const RenderBindings& bindings)
             _renderModel.clearSharedSampler(i);
         }
     }
+
+    updateGPUMemoryUsage();
 }
 
 void
@@ -1412,8 +1553,23 @@ TileNode::load(TerrainCuller* culler)
     // (because of the biggest range), and second by distance.
     float priority = lodPriority + distPriority;
 
-    // set atomically
-    _loadPriority = priority;
+    // Prefetched tiles go behind everything that's actually visible,
+    // but never demote a tile the regular cull already saw this frame.
+    unsigned frame = _context->getClock()->getFrame();
+    if (culler->isPrefetch())
+    {
+        if (_loadPriorityFrame != frame)
+        {
+            // set atomically
+            _loadPriority = priority - (float)(numLods + 1);
+        }
+    }
+    else
+    {
+        // set atomically
+        _loadPriority = priority;
+        _loadPriorityFrame = frame;
+    }
 
     // Check the status of the load
     ScopedMutexLock lock(_loadQueue);
@@ -1422,18 +1578,33 @@ TileNode::load(TerrainCuller* culler)
     {
         LoadTileDataOperationPtr& op = _loadQueue.front();
 
+        // Screen-space priority shared with the other pagers; prefetched
+        // tiles go behind anything on screen.
+        float pixels = -1.0f;
+        if (!culler->isPrefetch() && culler->getLODScale() > 0.0f)
+        {
+            pixels = culler->clampedPixelSize(getBound()) / culler->getLODScale();
+        }
+
         if (op->_result.isAbandoned())
         {
             // Actually this means that the task has not yet been dispatched,
-            // so assign the priority and do it now.
+            // so assign the priority and do it now, if the paging budget
+            // has room for it. If not, try again next frame.
             //op->_priority = priority;
-            op->dispatch();
+            unsigned osgFrame = culler->getFrameStamp() ? culler->getFrameStamp()->getFrameNumber() : 0u;
+            Util::PagingBudget::TicketPtr ticket = Util::PagingBudget::instance()->startJob(osgFrame, pixels);
+            if (ticket != nullptr)
+            {
+                op->dispatch(true, ticket);
+            }
         }
 
         else if (op->_result.isAvailable())
         {
             // The task completed, so submit it to the merger.
             // (We can't merge here in the CULL traversal)
+            op->_screenPriority = pixels;
             _context->getMerger()->merge(op, *culler);
             _loadQueue.pop();
             _loadsInQueue = _loadQueue.size();
@@ -1578,6 +1749,42 @@ TileNode::updateNormalMap()
     //OE_INFO << LC << _key.str() << " : updated normal map.\n";
 }
 
+void
+TileNode::updateGPUMemoryUsage()
+{
+    std::size_t bytes = 0u;
+
+    // Only count textures this tile owns; inherited ones belong to an ancestor.
+    for (const RenderingPass& pass : _renderModel._passes)
+    {
+        const Sampler& color = pass.sampler(SamplerBinding::COLOR);
+        if (color.ownsTexture())
+            bytes += getTextureGPUMemoryUsage(color._texture.get());
+    }
+
+    for (unsigned s = 0; s < _renderModel._sharedSamplers.size(); ++s)
+    {
+        const Sampler& sampler = _renderModel._sharedSamplers[s];
+        if (sampler.ownsTexture())
+            bytes += getTextureGPUMemoryUsage(sampler._texture.get());
+    }
+
+    // Pooled geometry is shared by every tile with the same layout, so only
+    // geometry unique to this tile (i.e. cut by constraints) counts.
+    if (_surface.valid() && _surface->getDrawable())
+    {
+        const SharedGeometry* geom = _surface->getDrawable()->_geom.get();
+        if (geom && (!_context->getGeometryPool()->isEnabled() || geom->hasConstraints()))
+        {
+            bytes += getGeometryGPUMemoryUsage(geom);
+        }
+    }
+
+    _gpuMemoryUsage = bytes;
+
+    _context->liveTiles()->setGPUMemoryUsage(this, bytes);
+}
+
 const TerrainOptions&
 TileNode::options() const
 {
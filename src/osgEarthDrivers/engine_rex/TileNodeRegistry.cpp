@@ -19,6 +19,8 @@
 #include "TileNodeRegistry"
 
 #include <osgEarth/Metrics>
+#include <osgEarth/Stats>
+#include <algorithm>
 
 using namespace osgEarth::REX;
 using namespace osgEarth;
@@ -28,8 +30,6 @@ using namespace osgEarth;
 #define OE_TEST OE_NULL
 //#define OE_TEST OE_INFO
 
-#define SENTRY_VALUE NULL
-
 #define PROFILING_REX_TILES "Live Terrain Tiles"
 
 //----------------------------------------------------------------------------
@@ -39,10 +39,12 @@ _name              ( name ),
 _revisioningEnabled( false ),
 _notifyNeighbors   ( false ),
 _firstLOD          ( 0u ),
-_mutex("TileNodeRegistry(OE)")
+_numTiles          ( 0u ),
+_gpuMemoryUsage    ( 0u ),
+_lastCollectFrame  ( 0u ),
+_notifiersMutex("TileNodeRegistry Notifiers(OE)")
 {
-    _tracker.push_front(SENTRY_VALUE);
-    _sentryptr = _tracker.begin();
+    //nop
 }
 
 TileNodeRegistry::~TileNodeRegistry()
@@ -70,22 +72,20 @@ TileNodeRegistry::setMapRevision(const Revision& rev,
     {
         if ( _maprev != rev || setToDirty )
         {
-            _mutex.lock();
+            _maprev = rev;
 
-            if ( _maprev != rev || setToDirty )
+            if ( setToDirty )
             {
-                _maprev = rev;
-
-                for( TileTable::iterator i = _tiles.begin(); i != _tiles.end(); ++i )
+                for (unsigned s = 0; s < NUM_SHARDS; ++s)
                 {
-                    if ( setToDirty )
+                    ScopedMutexLock lock(_shards[s]._mutex);
+
+                    for( TileTable::iterator i = _shards[s]._tiles.begin(); i != _shards[s]._tiles.end(); ++i )
                     {
                         i->second._tile->refreshAllLayers();
                     }
                 }
             }
-
-            _mutex.unlock();
         }
     }
 }
@@ -96,27 +96,37 @@ TileNodeRegistry::setDirty(const GeoExtent& extent,
                            unsigned         maxLevel,
                            const CreateTileManifest& manifest)
 {
-    _mutex.lock();
-    
-    for( TileTable::iterator i = _tiles.begin(); i != _tiles.end(); ++i )
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
     {
-        const TileKey& key = i->first;
+        ScopedMutexLock lock(_shards[s]._mutex);
 
-        if (minLevel <= key.getLOD() && 
-            maxLevel >= key.getLOD() &&
-            (extent.isInvalid() || extent.intersects(key.getExtent())))
+        for( TileTable::iterator i = _shards[s]._tiles.begin(); i != _shards[s]._tiles.end(); ++i )
         {
-            i->second._tile->refreshLayers(manifest);
+            const TileKey& key = i->second._tile->getKey();
+
+            if (minLevel <= key.getLOD() && 
+                maxLevel >= key.getLOD() &&
+                (extent.isInvalid() || extent.intersects(key.getExtent())))
+            {
+                i->second._tile->refreshLayers(manifest);
+            }
         }
     }
-
-    _mutex.unlock();
 }
 
 void
 TileNodeRegistry::add(TileNode* tile)
 {
-    _mutex.lock();
+    static Stats::Counter& s_tilesCreated = Stats::counter("osgearth_rex_tiles_created");
+    s_tilesCreated.add();
+
+    const TileKey& key = tile->getKey();
+
+    // not visited yet, so it can't expire until it is
+    TileNode::Tracking& tracking = tile->tracking();
+    tracking._lastTime = DBL_MAX;
+    tracking._lastFrame = ~0u;
+    tracking._lastRange = FLT_MAX;
 
     // It is possible that a Tile with the same key is already in the registry. 
     // This can happen when a Tile's ancestor gets unloaded, orphaning
@@ -124,41 +134,35 @@ TileNodeRegistry::add(TileNode* tile)
     // not yet itself been removed by the Unloader. So we have to check!
 
     bool recyclingOrphan = false;
-    TrackerEntry* se;
-    TableEntry* te;
-
-    TileTable::iterator i = _tiles.find(tile->getKey());
-    if (i != _tiles.end())
     {
-        // found an orphan! Reuse and overwrite it.
-        recyclingOrphan = true;
-        te = &i->second;
-        se = (*te->_trackerptr);
-        _tracker.erase(te->_trackerptr); // since we need to move it to the front
-        OE_DEBUG << "Reused orphaned tile record " << tile->getKey().str() << std::endl;
-    }
-    else
-    {
-        te = &_tiles[tile->getKey()];
-        se = new TrackerEntry();
-    }
+        PackedTileKey packed(key);
+        Shard& shard = getShard(packed);
+        ScopedMutexLock lock(shard._mutex);
 
-    // init the tracker entry and place it at the front of the tracker:
-    se->_tile = tile;
-    se->_lastTime = DBL_MAX;
-    se->_lastFrame = ~0;
-    se->_lastRange = FLT_MAX;
-    _tracker.push_front(se);
+        TileTable::iterator i = shard._tiles.find(packed);
+        if (i != shard._tiles.end())
+        {
+            // found an orphan! Reuse and overwrite it.
+            recyclingOrphan = true;
+            _gpuMemoryUsage -= i->second._gpuMemoryUsage;
+            OE_DEBUG << "Reused orphaned tile record " << key.str() << std::endl;
+        }
+        else
+        {
+            ++_numTiles;
+        }
 
-    // init the table entry:
-    te->_tile = tile;
-    te->_trackerptr = _tracker.begin();
+        TableEntry& te = shard._tiles[packed];
+        te._tile = tile;
+        te._gpuMemoryUsage = tile->getGPUMemoryUsage();
+        _gpuMemoryUsage += te._gpuMemoryUsage;
+    }
     
     // Start waiting on our neighbors.
     // (If we're recycling and orphaned record, we need to remove old listeners first)
     if (_notifyNeighbors)
     {
-        const TileKey& key = tile->getKey();
+        ScopedMutexLock lock(_notifiersMutex);
 
         // If we're recycling, we need to remove the old listeners first
         if (recyclingOrphan)
@@ -171,15 +175,18 @@ TileNodeRegistry::add(TileNode* tile)
         startListeningFor(key.createNeighborKey(0, 1), tile);
 
         // check for tiles that are waiting on this tile, and notify them!
-        TileKeyOneToMany::iterator notifier = _notifiers.find( tile->getKey() );
+        TileKeyOneToMany::iterator notifier = _notifiers.find( key );
         if ( notifier != _notifiers.end() )
         {
             TileKeySet& listeners = notifier->second;
 
             for(TileKeySet::iterator listener = listeners.begin(); listener != listeners.end(); ++listener)
             {
-                TileTable::iterator i = _tiles.find( *listener );
-                if ( i != _tiles.end())
+                Shard& shard = getShard(*listener);
+                ScopedMutexLock shardLock(shard._mutex);
+
+                TileTable::iterator i = shard._tiles.find( *listener );
+                if ( i != shard._tiles.end())
                 {
                     i->second._tile->notifyOfArrival( tile );
                 }
@@ -188,28 +195,24 @@ TileNodeRegistry::add(TileNode* tile)
         }
 
         OE_DEBUG << LC << _name 
-            << ": tiles=" << _tiles.size()
+            << ": tiles=" << _numTiles
             << ", notifiers=" << _notifiers.size()
             << std::endl;
     }
-
-    _mutex.unlock();
 }
 
 void
 TileNodeRegistry::startListeningFor(const TileKey& tileToWaitFor, TileNode* waiter)
 {
-    // ASSUME EXCLUSIVE LOCK
+    // ASSUME EXCLUSIVE NOTIFIERS LOCK
 
-    TileTable::iterator i = _tiles.find(tileToWaitFor);
-    if (i != _tiles.end())
+    osg::ref_ptr<TileNode> tile = get(tileToWaitFor);
+    if (tile.valid())
     {
-        TileNode* tile = i->second._tile.get();
-
         OE_DEBUG << LC << waiter->getKey().str() << " listened for " << tileToWaitFor.str()
             << ", but it was already in the repo.\n";
 
-        waiter->notifyOfArrival( tile );
+        waiter->notifyOfArrival( tile.get() );
     }
     else
     {
@@ -221,7 +224,7 @@ TileNodeRegistry::startListeningFor(const TileKey& tileToWaitFor, TileNode* wait
 void
 TileNodeRegistry::stopListeningFor(const TileKey& tileToWaitFor, const TileKey& waiterKey)
 {
-    // ASSUME EXCLUSIVE LOCK
+    // ASSUME EXCLUSIVE NOTIFIERS LOCK
 
     TileKeyOneToMany::iterator i = _notifiers.find(tileToWaitFor);
     if (i != _notifiers.end())
@@ -242,32 +245,30 @@ TileNodeRegistry::releaseAll(ResourceReleaser* releaser)
 {
     ResourceReleaser::ObjectList objects;
 
-    _mutex.lock();
-
-    if (releaser)
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
     {
-        for (TileTable::iterator i = _tiles.begin(); i != _tiles.end(); ++i)
+        ScopedMutexLock lock(_shards[s]._mutex);
+
+        if (releaser)
         {
-            objects.push_back(i->second._tile.get());
+            for (TileTable::iterator i = _shards[s]._tiles.begin(); i != _shards[s]._tiles.end(); ++i)
+            {
+                objects.push_back(i->second._tile.get());
+            }
         }
+
+        _numTiles -= (unsigned)_shards[s]._tiles.size();
+        _shards[s]._tiles.clear();
     }
 
-    _tiles.clear();
+    _gpuMemoryUsage = 0u;
 
-    for (Tracker::iterator i = _tracker.begin(); i != _tracker.end(); ++i)
     {
-        TrackerEntry* e = *i;
-        delete e;
+        ScopedMutexLock lock(_notifiersMutex);
+        _notifiers.clear();
     }
-    _tracker.clear();
-    _tracker.push_front(SENTRY_VALUE);
-    _sentryptr = _tracker.begin();
-
-    _notifiers.clear();
 
-    OE_PROFILING_PLOT(PROFILING_REX_TILES, (float)(_tiles.size()));
-
-    _mutex.unlock();
+    OE_PROFILING_PLOT(PROFILING_REX_TILES, (float)(_numTiles));
 
     if (releaser)
     {
@@ -278,34 +279,19 @@ TileNodeRegistry::releaseAll(ResourceReleaser* releaser)
 void
 TileNodeRegistry::update(TileNode* tile, osg::NodeVisitor& nv)
 {
-    _mutex.lock();
-
-    // Find the tracker for this tile and update its timestamp
-    TileTable::iterator i = _tiles.find(tile->getKey());
-    if (i != _tiles.end())
-    {
-        TableEntry& e = i->second;
-        TrackerEntry* se = (*e._trackerptr);
-        se->_lastTime = _clock->getTime();
-        se->_lastFrame = _clock->getFrame();
-
-        const osg::BoundingSphere& bs = tile->getBound();
-        float range = nv.getDistanceToViewPoint(bs.center(), true) - bs.radius();
-        se->_lastRange = osg::minimum(se->_lastRange, range);
-
-        // Move the tracker to the front of the list (ahead of the sentry).
-        // Once a cull traversal is complete, all visited tiles will be
-        // in front of the sentry, leaving all non-visited tiles behind it.
-        _tracker.erase(e._trackerptr);
-        _tracker.push_front(se);
-        e._trackerptr = _tracker.begin();
-    }
-    else
-    {
-        OE_WARN << LC << "UPDATE FAILED - TILE " << tile->getKey().str() << " not in TILE TABLE!" << std::endl;
-    }
-
-    _mutex.unlock();
+    // Stamp the tile so the unloader knows it's still in use. These are
+    // atomics on the tile itself, so cull never waits on the loader or
+    // the unloader, and never looks anything up.
+    TileNode::Tracking& tracking = tile->tracking();
+    tracking._lastTime = _clock->getTime();
+    tracking._lastFrame = _clock->getFrame();
+
+    const osg::BoundingSphere& bs = tile->getBound();
+    float range = nv.getDistanceToViewPoint(bs.center(), true) - bs.radius();
+
+    // keep the closest range if several cameras visit the tile
+    float lastRange = tracking._lastRange;
+    while (range < lastRange && !tracking._lastRange.compare_exchange_weak(lastRange, range));
 }
 
 void
@@ -317,65 +303,190 @@ TileNodeRegistry::collectDormantTiles(
     unsigned maxTiles,
     std::vector<osg::observer_ptr<TileNode> >& output)
 {
-    _mutex.lock();
-
     unsigned count = 0u;
+    std::vector<TileKey> removed;
 
-    // After cull, all visited tiles are in front of the sentry, and all
-    // non-visited tiles are behind it. Start at the sentry position and
-    // iterate over the non-visited tiles, checking them for deletion.
-    Tracker::iterator i = _sentryptr;
-    Tracker::iterator tmp;
-    for(++i; i != _tracker.end() && count < maxTiles; ++i)
+    // Only consider tiles that cull has not visited since the last pass.
+    // (Tiles that were never visited have a frame stamp of ~0, and are
+    // skipped as well.)
+    unsigned visitedSince = _lastCollectFrame;
+    _lastCollectFrame = _clock->getFrame();
+
+    for (unsigned s = 0; s < NUM_SHARDS && count < maxTiles; ++s)
     {
-        TrackerEntry* se = *i;
+        ScopedMutexLock lock(_shards[s]._mutex);
+        TileTable& tiles = _shards[s]._tiles;
+
+        for (TileTable::iterator i = tiles.begin(); i != tiles.end() && count < maxTiles; )
+        {
+            TileNode* tile = i->second._tile.get();
+            TileNode::Tracking& tracking = tile->tracking();
 
-        const TileKey& key = se->_tile->getKey();
+            unsigned lastFrame = tracking._lastFrame;
+            if (lastFrame >= visitedSince)
+            {
+                ++i;
+                continue;
+            }
+
+            if (tile->getDoNotExpire() == false &&
+                tracking._lastTime < oldestAllowableTime &&
+                lastFrame < oldestAllowableFrame &&
+                tracking._lastRange > farthestAllowableRange &&
+                tile->areSiblingsDormant())
+            {
+                if (_notifyNeighbors)
+                {
+                    removed.push_back(tile->getKey());
+                }
 
-        if (se->_tile->getDoNotExpire() == false &&
-            se->_lastTime < oldestAllowableTime &&
-            se->_lastFrame < oldestAllowableFrame &&
-            se->_lastRange > farthestAllowableRange &&
-            se->_tile->areSiblingsDormant())
+                // put the tile on the output list:
+                output.push_back(tile);
+
+                // remove it from the main tile table:
+                _gpuMemoryUsage -= i->second._gpuMemoryUsage;
+                --_numTiles;
+                i = tiles.erase(i);
+
+                ++count;
+            }
+            else
+            {
+                // reset the range in preparation for the next frame.
+                tracking._lastRange = FLT_MAX;
+                ++i;
+            }
+        }
+    }
+
+    // remove neighbor listeners:
+    if (!removed.empty())
+    {
+        ScopedMutexLock lock(_notifiersMutex);
+        for (auto& key : removed)
         {
-            if (_notifyNeighbors)
+            stopListeningFor(key.createNeighborKey(1, 0), key);
+            stopListeningFor(key.createNeighborKey(0, 1), key);
+        }
+    }
+
+    OE_PROFILING_PLOT(PROFILING_REX_TILES, (float)(_numTiles));
+}
+
+void
+TileNodeRegistry::collectTilesOverBudget(
+    std::size_t budget,
+    unsigned oldestAllowableFrame,
+    std::size_t maxBytes,
+    unsigned maxTiles,
+    std::vector<osg::observer_ptr<TileNode> >& output)
+{
+    struct Candidate {
+        osg::ref_ptr<TileNode> _tile;
+        unsigned _lastFrame;
+        double _lastTime;
+    };
+    std::vector<Candidate> candidates;
+
+    // gather the tiles that haven't been visited recently:
+    for (unsigned s = 0; s < NUM_SHARDS; ++s)
+    {
+        ScopedMutexLock lock(_shards[s]._mutex);
+
+        for (auto& i : _shards[s]._tiles)
+        {
+            TileNode* tile = i.second._tile.get();
+            unsigned lastFrame = tile->tracking()._lastFrame;
+
+            if (tile->getDoNotExpire() == false &&
+                lastFrame < oldestAllowableFrame &&
+                tile->areSiblingsDormant())
             {
-                // remove neighbor listeners:
-                stopListeningFor(key.createNeighborKey(1, 0), key);
-                stopListeningFor(key.createNeighborKey(0, 1), key);
+                Candidate c;
+                c._tile = tile;
+                c._lastFrame = lastFrame;
+                c._lastTime = tile->tracking()._lastTime;
+                candidates.push_back(c);
             }
+        }
+    }
+
+    // least-recently-visible tiles first:
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Candidate& lhs, const Candidate& rhs) {
+            return
+                lhs._lastFrame < rhs._lastFrame ||
+                (lhs._lastFrame == rhs._lastFrame && lhs._lastTime < rhs._lastTime);
+        });
 
-            // back up the iterator so we can safely erase the tracker entry:
-            tmp = i;
-            --i;
+    unsigned count = 0u;
+    std::size_t collected = 0u;
+    std::vector<TileKey> removed;
 
-            // put the tile on the output list:
-            output.push_back(se->_tile);
+    for (auto& c : candidates)
+    {
+        if (_gpuMemoryUsage <= budget || collected >= maxBytes || count >= maxTiles)
+            break;
 
-            // remove it from the main tile table:
-            _tiles.erase(key);
+        const TileKey& key = c._tile->getKey();
+        PackedTileKey packed(key);
+        Shard& shard = getShard(packed);
+        ScopedMutexLock lock(shard._mutex);
 
-            // remove it from the tracker list:
-            _tracker.erase(tmp);
-            delete se;
+        // make sure the tile wasn't replaced in the meantime
+        TileTable::iterator i = shard._tiles.find(packed);
+        if (i == shard._tiles.end() || i->second._tile != c._tile)
+            continue;
 
-            ++count;
+        if (_notifyNeighbors)
+        {
+            removed.push_back(key);
         }
-        else
+
+        output.push_back(c._tile.get());
+
+        collected += i->second._gpuMemoryUsage;
+        _gpuMemoryUsage -= i->second._gpuMemoryUsage;
+        --_numTiles;
+
+        shard._tiles.erase(i);
+
+        ++count;
+    }
+
+    if (!removed.empty())
+    {
+        ScopedMutexLock lock(_notifiersMutex);
+        for (auto& key : removed)
         {
-            // reset the range in preparation for the next frame.
-            se->_lastRange = FLT_MAX;
+            stopListeningFor(key.createNeighborKey(1, 0), key);
+            stopListeningFor(key.createNeighborKey(0, 1), key);
         }
     }
 
-    // reset the sentry.
-    _tracker.erase(_sentryptr);
-    _tracker.push_front(SENTRY_VALUE);
-    _sentryptr =_tracker.begin();
+    OE_PROFILING_PLOT(PROFILING_REX_TILES, (float)(_numTiles));
+}
+
+void
+TileNodeRegistry::setGPUMemoryUsage(TileNode* tile, std::size_t bytes)
+{
+    PackedTileKey packed(tile->getKey());
+    Shard& shard = getShard(packed);
+    ScopedMutexLock lock(shard._mutex);
 
-    _mutex.unlock();
+    TileTable::iterator i = shard._tiles.find(packed);
+    if (i != shard._tiles.end() && i->second._tile.get() == tile)
+    {
+        _gpuMemoryUsage -= i->second._gpuMemoryUsage;
+        i->second._gpuMemoryUsage = bytes;
+        _gpuMemoryUsage += bytes;
+    }
+}
 
-    OE_PROFILING_PLOT(PROFILING_REX_TILES, (float)(_tiles.size()));
+std::size_t
+TileNodeRegistry::getGPUMemoryUsage() const
+{
+    return _gpuMemoryUsage;
 }
 
 osg::ref_ptr<TileNode>
@@ -383,10 +494,12 @@ TileNodeRegistry::get(const TileKey& key) const
 {
     osg::ref_ptr<TileNode> result;
 
-    ScopedMutexLock scopelock(_mutex);
+    PackedTileKey packed(key);
+    const Shard& shard = getShard(packed);
+    ScopedMutexLock scopelock(shard._mutex);
 
-    auto iter = _tiles.find(key);
-    if (iter != _tiles.end())
+    auto iter = shard._tiles.find(packed);
+    if (iter != shard._tiles.end())
     {
         result = iter->second._tile.get();
     }
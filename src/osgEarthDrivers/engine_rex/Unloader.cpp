@@ -21,11 +21,15 @@
 #include "TileNodeRegistry"
 
 #include <osgEarth/Metrics>
+#include <osgEarth/Stats>
 #include <osgEarth/NodeUtils>
 
 #undef  LC
 #define LC "[UnloaderGroup] "
 
+// Fraction (1/N) of the memory budget to evict per frame when over budget
+#define BUDGET_SLICES_PER_FRAME 32u
+
 using namespace osgEarth::REX;
 
 
@@ -35,6 +39,7 @@ _cacheSize(0u),
 _maxAge(0.1),
 _minRange(0.0f),
 _maxTilesToUnloadPerFrame(~0),
+_memoryBudget(0u),
 _frameLastUpdated(0u)
 {
     ADJUST_UPDATE_TRAV_COUNT(this, +1);
@@ -63,13 +68,26 @@ UnloaderGroup::traverse(osg::NodeVisitor& nv)
             double oldestAllowableTime = now - _maxAge;
             unsigned oldestAllowableFrame = osg::maximum(frame, 3u) - 3u;
 
+            // Over the memory budget? Evict the least-recently-visible tiles,
+            // freeing no more than a slice of the budget per frame so the
+            // GL releases spread out instead of landing on a single frame.
+            if (_memoryBudget > 0u && _tiles->getGPUMemoryUsage() > _memoryBudget)
+            {
+                _tiles->collectTilesOverBudget(
+                    _memoryBudget,
+                    oldestAllowableFrame,
+                    osg::maximum(_memoryBudget / BUDGET_SLICES_PER_FRAME, (std::size_t)1u),
+                    _maxTilesToUnloadPerFrame,
+                    _deadpool);
+            }
+
             // Remove them from the registry:
             _tiles->collectDormantTiles(
                 nv, 
                 oldestAllowableTime,
                 oldestAllowableFrame,
                 _minRange,
-                _maxTilesToUnloadPerFrame, _deadpool);
+                _maxTilesToUnloadPerFrame - (unsigned)_deadpool.size(), _deadpool);
 
             // Remove them from the scene graph:
             for(std::vector<osg::observer_ptr<TileNode> >::iterator i = _deadpool.begin();
@@ -94,6 +112,9 @@ UnloaderGroup::traverse(osg::NodeVisitor& nv)
                 }
             }
 
+            static Stats::Counter& s_tilesUnloaded = Stats::counter("osgearth_rex_tiles_unloaded");
+            s_tilesUnloaded.add(count);
+
             if (_deadpool.empty() == false)
             {
                 OE_DEBUG << LC << "Unloaded " << count << " of " << _deadpool.size() << " dormant tiles; " << _tiles->size() << " remain active." << std::endl;
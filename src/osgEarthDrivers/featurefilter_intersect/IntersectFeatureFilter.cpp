@@ -28,6 +28,7 @@
 #include <osgEarth/FilterContext>
 
 #include <osgEarth/Geometry>
+#include <osgEarth/GeometryIndex>
 
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
@@ -109,58 +110,51 @@ public: // FeatureFilter
             }
             else
             {
-                // Transform the boundaries into the coordinate system of the features
+                // Index the boundaries in the coordinate system of the features
+                GeometryIndex index;
                 for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
                 {
                     itr->get()->transform( context.profile()->getSRS() );
+                    index.insert( itr->get()->getGeometry() );
                 }
 
-                for(FeatureList::const_iterator f = input.begin(); f != input.end(); ++f)
+                const GeoExtent& sourceExtent = _featureSource->getFeatureProfile()->getExtent();
+
+                std::vector<Feature*> features;
+                features.reserve(input.size());
+                for (FeatureList::const_iterator f = input.begin(); f != input.end(); ++f)
+                    features.push_back(f->get());
+
+                // Test the centroids in parallel; each feature only needs
+                // one boundary that contains it.
+                std::vector<char> accept(features.size(), 0);
+                bool wantContained = (contains() == true);
+
+                GeometryIndex::parallelFor(features.size(), [&](unsigned i)
                 {
-                    Feature* feature = f->get();
+                    Feature* feature = features[i];
                     if ( feature && feature->getGeometry() )
                     {
                         osg::Vec2d c = feature->getGeometry()->getBounds().center2d();
 
-                        if ( contains() == true )
+                        bool contained = false;
+
+                        // coarsest:
+                        if (sourceExtent.contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
                         {
-                            // coarsest:
-                            if (_featureSource->getFeatureProfile()->getExtent().contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
-                            {
-                                for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
-                                {
-                                    Ring* ring = dynamic_cast< Ring*>(itr->get()->getGeometry());
-                                    if (ring && ring->contains2D(c.x(), c.y()))
-                                    {
-                                        output.push_back( feature );
-                                    }
-                                }                        
-                            }
+                            std::vector<unsigned> hits;
+                            index.findContaining(c.x(), c.y(), hits, true);
+                            contained = !hits.empty();
                         }
 
-                        else
-                        {    
-                            bool contained = false;
-
-                            // coarsest:
-                            if (_featureSource->getFeatureProfile()->getExtent().contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
-                            {
-                                for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
-                                {
-                                    Ring* ring = dynamic_cast< Ring*>(itr->get()->getGeometry());
-                                    if (ring && ring->contains2D(c.x(), c.y()))
-                                    {                             
-                                        contained = true;
-                                        break;
-                                    }
-                                }
-                            }
-                            if ( !contained )
-                            {
-                                output.push_back( feature );
-                            }
-                        }
+                        accept[i] = (contained == wantContained) ? 1 : 0;
                     }
+                });
+
+                for (unsigned i = 0; i < features.size(); ++i)
+                {
+                    if (accept[i])
+                        output.push_back(features[i]);
                 }
             }
 
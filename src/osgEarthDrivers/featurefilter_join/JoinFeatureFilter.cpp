@@ -28,6 +28,7 @@
 #include <osgEarth/FeatureSource>
 #include <osgEarth/FilterContext>
 #include <osgEarth/Geometry>
+#include <osgEarth/GeometryIndex>
 #include <osgEarth/Metrics>
 
 #define LC "[Intersect FeatureFilter] "
@@ -91,39 +92,50 @@ public: // FeatureFilter
     {
         OE_PROFILING_ZONE;
 
-        // Transform the boundaries into the coordinate system of the features
+        // Index the boundaries in the coordinate system of the features
+        GeometryIndex index;
+        std::vector<Feature*> boundaryList;
         for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
         {
             itr->get()->transform(context.profile()->getSRS());
+            index.insert(itr->get()->getGeometry());
+            boundaryList.push_back(itr->get());
         }
 
+        const GeoExtent& sourceExtent = featureSource().getLayer()->getFeatureProfile()->getExtent();
+
+        std::vector<Feature*> features;
+        features.reserve(input.size());
         for (FeatureList::const_iterator f = input.begin(); f != input.end(); ++f)
+            features.push_back(f->get());
+
+        // Each feature takes the attributes of the first boundary it
+        // intersects; features are independent, so join them in parallel.
+        GeometryIndex::parallelFor(features.size(), [&](unsigned i)
         {
-            Feature* feature = f->get();
+            Feature* feature = features[i];
             if (feature && feature->getGeometry())
             {
                 osg::Vec2d c = feature->getGeometry()->getBounds().center2d();
 
-                if (featureSource().getLayer()->getFeatureProfile()->getExtent().contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
+                if (sourceExtent.contains(GeoPoint(feature->getSRS(), c.x(), c.y())))
                 {
-                    for (FeatureList::iterator itr = boundaries.begin(); itr != boundaries.end(); ++itr)
+                    std::vector<unsigned> hits;
+                    index.findIntersecting(feature->getGeometry(), hits, true);
+                    if (!hits.empty())
                     {
-                        //if (ring && ring->contains2D(c.x(), c.y()))
-                        if (itr->get()->getGeometry()->intersects(feature->getGeometry()))
+                        // Copy the attributes in the boundary to the feature
+                        const AttributeTable& attrs = boundaryList[hits.front()]->getAttrs();
+                        for (AttributeTable::const_iterator attrItr = attrs.begin();
+                            attrItr != attrs.end();
+                            attrItr++)
                         {
-                            // Copy the attributes in the boundary to the feature
-                            for (AttributeTable::const_iterator attrItr = itr->get()->getAttrs().begin();
-                                attrItr != itr->get()->getAttrs().end();
-                                attrItr++)
-                            {
-                                feature->set(attrItr->first, attrItr->second);
-                            }
-                            break;
+                            feature->set(attrItr->first, attrItr->second);
                         }
                     }
                 }
             }
-        }
+        });
     }
 
 
@@ -40,6 +40,14 @@
 #include <osgEarth/ShaderUtils>
 #include <osgEarth/InstanceBuilder>
 #include <osgEarth/StateTransition>
+#include <osgEarth/Threading>
+#include <osgEarth/Metrics>
+#include <algorithm>
+#include <sstream>
+
+#ifdef OSGEARTH_HAVE_MESHOPTIMIZER
+#include <meshoptimizer.h>
+#endif
 
 using namespace osgEarth;
 using namespace osgEarth::Util;
@@ -70,8 +78,199 @@ public:
         Env(const std::string& loc, const osgDB::Options* opt) : referrer(loc), readOptions(opt) { }
         const std::string referrer;
         const osgDB::Options* readOptions;
+        std::vector< osg::ref_ptr<osg::Image> > images; // decoded, parallel to model.images
     };
 
+    //! Image loader callback that keeps the encoded bytes, so that
+    //! decodeImages() can decode all the images at once after parsing.
+    static bool DeferImageData(tinygltf::Image* image, const int image_idx, std::string* err, std::string* warn,
+                               int req_width, int req_height, const unsigned char* bytes, int size, void* user_data)
+    {
+        image->as_is = true;
+        image->image.assign(bytes, bytes + size);
+        return true;
+    }
+
+    //! Decodes one encoded image. KTX2 (Basis Universal) images go to the
+    //! basis plugin, which transcodes them to a GPU-compressed format with
+    //! mipmaps that is uploaded as-is; everything else goes to stb_image.
+    static osg::Image* decodeImage(const tinygltf::Image& image, const osgDB::Options* readOptions)
+    {
+        static const unsigned char ktx2Magic[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        const unsigned char* bytes = image.image.data();
+        int size = (int)image.image.size();
+
+        if (image.mimeType == "image/ktx2" ||
+            (size >= 12 && memcmp(bytes, ktx2Magic, 12) == 0))
+        {
+            osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("ktx2");
+            if (!rw)
+                return nullptr;
+
+            // glTF images are top-down already, like the stb path below
+            osg::ref_ptr<osgDB::Options> options = readOptions ?
+                osg::clone(readOptions, osg::CopyOp::SHALLOW_COPY) : new osgDB::Options;
+            options->setOptionString(options->getOptionString() + " basisNoFlip");
+
+            std::istringstream in(std::string((const char*)bytes, size));
+            osgDB::ReaderWriter::ReadResult rr = rw->readImage(in, options.get());
+            return rr.success() ? rr.takeImage() : nullptr;
+        }
+
+        int width, height, comp;
+        if (!stbi_info_from_memory(bytes, size, &width, &height, &comp))
+            return nullptr;
+
+        int req = comp == 3 ? 3 : 4;
+        unsigned char* data = stbi_load_from_memory(bytes, size, &width, &height, &comp, req);
+        if (!data)
+            return nullptr;
+
+        osg::Image* result = new osg::Image();
+        result->setImage(
+            width, height, 1,
+            req == 3 ? GL_RGB8 : GL_RGBA8,
+            req == 3 ? GL_RGB : GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            data,
+            osg::Image::USE_MALLOC_FREE);
+        return result;
+    }
+
+    //! Decodes the model's embedded images concurrently, one job per image,
+    //! and releases the encoded bytes.
+    static void decodeImages(tinygltf::Model& model, Env& env)
+    {
+        OE_PROFILING_ZONE;
+
+        env.images.resize(model.images.size());
+
+        std::vector<Threading::Future<osg::ref_ptr<osg::Image>>> results(model.images.size());
+        unsigned numEncoded = 0u;
+        for (auto& image : model.images)
+        {
+            if (image.as_is && !image.image.empty())
+                ++numEncoded;
+        }
+
+        for (unsigned i = 0; i < model.images.size(); ++i)
+        {
+            const tinygltf::Image& image = model.images[i];
+            if (!image.as_is || image.image.empty())
+                continue;
+
+            if (numEncoded == 1u)
+            {
+                env.images[i] = decodeImage(image, env.readOptions);
+            }
+            else
+            {
+                const osgDB::Options* readOptions = env.readOptions;
+                Threading::Job job(Threading::JobArena::get("oe.gltf"));
+                job.setName("gltf image");
+                results[i] = job.dispatch<osg::ref_ptr<osg::Image>>(
+                    [&image, readOptions](Threading::Cancelable*)
+                    {
+                        return osg::ref_ptr<osg::Image>(decodeImage(image, readOptions));
+                    });
+            }
+        }
+
+        for (unsigned i = 0; i < model.images.size(); ++i)
+        {
+            tinygltf::Image& image = model.images[i];
+            if (!image.as_is || image.image.empty())
+                continue;
+
+            if (numEncoded > 1u)
+            {
+                env.images[i] = results[i].get();
+            }
+
+            if (!env.images[i].valid())
+            {
+                OE_WARN << LC << "Failed to decode image " << i << " (" << image.mimeType << ") in " << env.referrer << std::endl;
+            }
+
+            std::vector<unsigned char>().swap(image.image);
+        }
+    }
+
+    //! Decodes buffer views compressed with EXT_meshopt_compression into
+    //! new buffers, and points the views at them.
+    static bool decodeMeshopt(tinygltf::Model& model, const std::string& location)
+    {
+#ifdef OSGEARTH_HAVE_MESHOPTIMIZER
+        for (auto& view : model.bufferViews)
+        {
+            auto ext = view.extensions.find("EXT_meshopt_compression");
+            if (ext == view.extensions.end())
+                ext = view.extensions.find("KHR_meshopt_compression");
+            if (ext == view.extensions.end())
+                continue;
+
+            const tinygltf::Value& v = ext->second;
+            int buffer = (int)v.Get("buffer").GetNumberAsInt();
+            size_t byteOffset = v.Has("byteOffset") ? (size_t)v.Get("byteOffset").GetNumberAsInt() : 0u;
+            size_t byteLength = (size_t)v.Get("byteLength").GetNumberAsInt();
+            size_t byteStride = (size_t)v.Get("byteStride").GetNumberAsInt();
+            size_t count = (size_t)v.Get("count").GetNumberAsInt();
+            std::string mode = v.Get("mode").IsString() ? v.Get("mode").Get<std::string>() : "";
+            std::string filter = v.Has("filter") ? v.Get("filter").Get<std::string>() : "NONE";
+
+            if (buffer < 0 || buffer >= (int)model.buffers.size() ||
+                byteOffset + byteLength > model.buffers[buffer].data.size() ||
+                byteStride == 0u)
+            {
+                OE_WARN << LC << "Bad EXT_meshopt_compression buffer view in " << location << std::endl;
+                return false;
+            }
+
+            tinygltf::Buffer decoded;
+            decoded.data.resize(count * byteStride);
+            const unsigned char* src = model.buffers[buffer].data.data() + byteOffset;
+
+            int rc = -1;
+            if (mode == "ATTRIBUTES")
+                rc = meshopt_decodeVertexBuffer(decoded.data.data(), count, byteStride, src, byteLength);
+            else if (mode == "TRIANGLES")
+                rc = meshopt_decodeIndexBuffer(decoded.data.data(), count, byteStride, src, byteLength);
+            else if (mode == "INDICES")
+                rc = meshopt_decodeIndexSequence(decoded.data.data(), count, byteStride, src, byteLength);
+
+            if (rc != 0)
+            {
+                OE_WARN << LC << "Failed to decode EXT_meshopt_compression (" << mode << ") in " << location << std::endl;
+                return false;
+            }
+
+            if (filter == "OCTAHEDRAL")
+                meshopt_decodeFilterOct(decoded.data.data(), count, byteStride);
+            else if (filter == "QUATERNION")
+                meshopt_decodeFilterQuat(decoded.data.data(), count, byteStride);
+            else if (filter == "EXPONENTIAL")
+                meshopt_decodeFilterExp(decoded.data.data(), count, byteStride);
+
+            model.buffers.push_back(std::move(decoded));
+            view.buffer = (int)model.buffers.size() - 1;
+            view.byteOffset = 0u;
+            view.byteLength = count * byteStride;
+        }
+        return true;
+#else
+        bool required =
+            std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), "EXT_meshopt_compression") != model.extensionsRequired.end() ||
+            std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), "KHR_meshopt_compression") != model.extensionsRequired.end();
+
+        if (required)
+        {
+            OE_WARN << LC << location << " requires EXT_meshopt_compression, but osgEarth was built without meshoptimizer" << std::endl;
+        }
+        return !required;
+#endif
+    }
+
 public:
     mutable TextureCache* _texCache;
 
@@ -100,6 +299,7 @@ public:
         fs.WriteWholeFile = &tinygltf::WriteWholeFile;
         fs.user_data = (void*)&location;
         loader.SetFsCallbacks(fs);
+        loader.SetImageLoader(&GLTFReader::DeferImageData, nullptr);
 
         tinygltf::Options opt;
         opt.skip_imagery = readOptions && readOptions->getOptionString().find("gltfSkipImagery") != std::string::npos;
@@ -141,7 +341,13 @@ public:
             return osgDB::ReaderWriter::ReadResult::ERROR_IN_READING_FILE;
         }
 
+        if (!decodeMeshopt(model, location))
+        {
+            return osgDB::ReaderWriter::ReadResult::ERROR_IN_READING_FILE;
+        }
+
         Env env(location, readOptions);
+        decodeImages(model, env);
         return makeNodeFromModel(model, env);
     }
 
@@ -158,6 +364,7 @@ public:
         fs.WriteWholeFile = &tinygltf::WriteWholeFile;
         fs.user_data = (void*)&location;
         loader.SetFsCallbacks(fs);
+        loader.SetImageLoader(&GLTFReader::DeferImageData, nullptr);
 
         tinygltf::Options opt;
         opt.skip_imagery = readOptions && readOptions->getOptionString().find("gltfSkipImagery") != std::string::npos;
@@ -183,7 +390,13 @@ public:
             return 0;
         }
 
+        if (!decodeMeshopt(model, location))
+        {
+            return 0;
+        }
+
         Env env(location, readOptions);
+        decodeImages(model, env);
         return makeNodeFromModel(model, env);
     }
 
@@ -377,13 +590,34 @@ public:
             return top;
         }
 
+        //! Index of the image a texture samples: its KHR_texture_basisu
+        //! source if that one decoded, otherwise the regular source.
+        int getImageSource(const tinygltf::Texture& texture) const
+        {
+            auto ext = texture.extensions.find("KHR_texture_basisu");
+            if (ext != texture.extensions.end() && ext->second.Has("source"))
+            {
+                int source = (int)ext->second.Get("source").GetNumberAsInt();
+                if (source >= 0 && source < (int)env.images.size() && env.images[source].valid())
+                {
+                    return source;
+                }
+            }
+            return texture.source;
+        }
+
+        //! Whether an image is stored in the glTF itself rather than in a file
+        static bool isEmbedded(const tinygltf::Image& image)
+        {
+            return tinygltf::IsDataURI(image.uri) || image.bufferView >= 0 || image.image.size() > 0;
+        }
+
         osg::Texture2D* makeTextureFromModel(const tinygltf::Texture& texture) const
 
         {
-            const tinygltf::Image& image = model.images[texture.source];
-            bool imageEmbedded =
-                tinygltf::IsDataURI(image.uri) ||
-                image.image.size() > 0;
+            int source = getImageSource(texture);
+            const tinygltf::Image& image = model.images[source];
+            bool imageEmbedded = isEmbedded(image);
 
             osgEarth::URI imageURI(image.uri, env.referrer);
 
@@ -394,7 +628,12 @@ public:
             // First load the image
             osg::ref_ptr<osg::Image> img;
 
-            if (image.image.size() > 0)
+            if (source < (int)env.images.size() && env.images[source].valid())
+            {
+                img = env.images[source].get();
+            }
+
+            else if (image.image.size() > 0)
             {
                 GLenum format = GL_RGB, texFormat = GL_RGB8;
                 if (image.component == 4) format = GL_RGBA, texFormat = GL_RGBA8;
@@ -535,11 +774,12 @@ public:
                             {
                                 int index = i->second;
                                 const tinygltf::Texture& texture = model.textures[index];
-                                const tinygltf::Image& image = model.images[texture.source];
+                                int source = getImageSource(texture);
+                                if (source < 0 || source >= (int)model.images.size())
+                                    continue;
+                                const tinygltf::Image& image = model.images[source];
                                 // don't cache embedded textures!
-                                bool imageEmbedded =
-                                    tinygltf::IsDataURI(image.uri) ||
-                                    image.image.size() > 0;
+                                bool imageEmbedded = isEmbedded(image);
                                 osgEarth::URI imageURI(image.uri, env.referrer);
                                 osg::ref_ptr<osg::Texture2D> tex;
                                 bool cachedTex = false;
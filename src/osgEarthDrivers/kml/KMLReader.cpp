@@ -24,6 +24,9 @@
 #include <osgEarth/XmlUtils>
 #include <osgEarth/VirtualProgram>
 #include <osgEarth/ScreenSpaceLayout>
+#include <osgEarth/NodeUtils>
+#include <osgEarth/Threading>
+#include <osg/Timer>
 #include <stack>
 #include <iterator>
 
@@ -33,6 +36,122 @@ using namespace osgEarth;
 #undef LC
 #define LC "[KMLReader] "
 
+namespace
+{
+    // Runs the three passes over a parsed document into cx._groupStack.top()
+    void buildDocument( xml_document<>& doc, KMLContext& cx )
+    {
+        //const Config* top = conf.hasChild("kml" ) ? conf.child_ptr("kml") : &conf;
+        xml_node<> *top = doc.first_node("kml", 0, false);
+
+        if ( top)
+        {
+            KML_Root kmlRoot;
+
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            kmlRoot.scan ( top, cx );    // first pass
+            osg::Timer_t end = osg::Timer::instance()->tick();
+            OE_INFO << LC << "  Scan1 took " << osg::Timer::instance()->delta_s(start, end) << std::endl;
+
+            start = osg::Timer::instance()->tick();
+            kmlRoot.scan2( top, cx );   // second pass
+            end = osg::Timer::instance()->tick();
+            OE_INFO << LC << "  Scan2 took " << osg::Timer::instance()->delta_s(start, end) << std::endl;
+
+            start = osg::Timer::instance()->tick();
+            kmlRoot.build( top, cx );   // third pass.
+            end = osg::Timer::instance()->tick();
+            OE_INFO << LC << "  build took " << osg::Timer::instance()->delta_s(start, end) << std::endl;
+        }
+
+        URIResultCache* cacheUsed = URIResultCache::from(cx._dbOptions.get());
+        CacheStats stats = cacheUsed->getStats();
+        OE_INFO << LC << "  URI Cache: " << stats._queries << " reads, " << (stats._hitRatio*100.0) << "% hits" << std::endl;
+    }
+
+    void initContext( KMLContext& cx, MapNode* mapNode, const KMLOptions* options, osg::Group* root,
+                      const osgDB::Options* dbOptions, URIResultCache& defaultUriCache )
+    {
+        URIContext context(dbOptions);
+
+        cx._mapNode   = mapNode;
+        cx._sheet     = new StyleSheet();
+        cx._options   = options;
+        //cx._srs      = SpatialReference::create( "wgs84", "egm96" );
+        // Use the geographic srs of the map so that clamping will occur against the correct vertical datum.
+        cx._srs = mapNode->getMapSRS()->getGeographicSRS();
+        cx._referrer = context.referrer();
+        cx._groupStack.push( root );
+
+        // clone the dbOptions, and install a resource cache if there isn't one already:
+        if ( !URIResultCache::from(dbOptions) )
+        {
+            osgDB::Options* newOptions = Registry::instance()->cloneOrCreateOptions();
+            defaultUriCache.apply( newOptions );
+            cx._dbOptions = newOptions;
+        }
+        else
+        {
+            cx._dbOptions = dbOptions;
+        }
+    }
+
+    /**
+     * Root of a KML document loaded in the background. It owns what the
+     * loading job needs, and adds one batch of the nodes that job has
+     * built per update traversal until the job is done.
+     */
+    class AsyncKMLGroup : public osg::Group
+    {
+    public:
+        AsyncKMLGroup( const KMLOptions& options ) :
+            _options( options ),
+            _pending( new KMLPending() ),
+            _merging( true )
+        {
+            ADJUST_UPDATE_TRAV_COUNT(this, +1);
+        }
+
+        void traverse( osg::NodeVisitor& nv ) override
+        {
+            if ( _merging && nv.getVisitorType() == nv.UPDATE_VISITOR )
+            {
+                KMLPending::Batch batch;
+                bool done = false;
+                {
+                    Threading::ScopedMutexLock lock( _pending->_mutex );
+                    if ( !_pending->_batches.empty() )
+                    {
+                        batch.swap( _pending->_batches.front() );
+                        _pending->_batches.pop_front();
+                    }
+                    done = _pending->_done && _pending->_batches.empty();
+                }
+
+                for (KMLPending::Batch::const_iterator i = batch.begin(); i != batch.end(); ++i)
+                {
+                    i->first->addChild( i->second.get() );
+                }
+
+                if ( done )
+                {
+                    _merging = false;
+                    ADJUST_UPDATE_TRAV_COUNT(this, -1);
+                }
+            }
+
+            osg::Group::traverse( nv );
+        }
+
+        KMLOptions               _options;
+        URIResultCache           _uriCache;
+        osg::ref_ptr<KMLPending> _pending;
+
+    private:
+        bool _merging;
+    };
+}
+
 KMLReader::KMLReader( MapNode* mapNode, const KMLOptions* options ) :
 _mapNode( mapNode ),
 _options( options )
@@ -43,6 +162,11 @@ _options( options )
 osg::Node*
 KMLReader::read( std::istream& in, const osgDB::Options* dbOptions )
 {
+    if ( _options && _options->asynchronous() == true )
+    {
+        return readAsync( in, dbOptions );
+    }
+
     OE_INFO << LC << "Loading KML.." << std::endl;
     // pull the URI context out of the DB options:
     URIContext context(dbOptions);
@@ -65,6 +189,58 @@ KMLReader::read( std::istream& in, const osgDB::Options* dbOptions )
 	return node;
 }
 
+osg::Node*
+KMLReader::readAsync( std::istream& in, const osgDB::Options* dbOptions )
+{
+    URIContext context(dbOptions);
+
+    // The stream belongs to the caller, so it is read here; parsing and
+    // building the nodes happen on the job.
+    std::shared_ptr<std::string> xmlStr = std::make_shared<std::string>();
+    {
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        *xmlStr = buffer.str();
+    }
+
+    osg::ref_ptr<AsyncKMLGroup> root = new AsyncKMLGroup( *_options );
+    root->setName( context.referrer() );
+
+    // Make sure the KML gets rendered after the terrain.
+    root->getOrCreateStateSet()->setRenderBinDetails(2, "RenderBin");
+
+    osg::observer_ptr<MapNode> mapNode = _mapNode;
+    osg::ref_ptr<const osgDB::Options> options = dbOptions;
+
+    Job(JobArena::get("oe.kml")).dispatch(
+        [root, mapNode, options, xmlStr](Cancelable*)
+        {
+            osg::ref_ptr<MapNode> map;
+            if ( mapNode.lock(map) )
+            {
+                osg::Timer_t start = osg::Timer::instance()->tick();
+
+                xml_document<> doc;
+                doc.parse<0>(&(*xmlStr)[0]);
+
+                KMLContext cx;
+                initContext( cx, map.get(), &root->_options, root.get(), options.get(), root->_uriCache );
+                cx._pending = root->_pending;
+
+                buildDocument( doc, cx );
+                cx.flush();
+
+                osg::Timer_t end = osg::Timer::instance()->tick();
+                OE_INFO << LC << "Loaded KML in " << osg::Timer::instance()->delta_s(start, end) << " (background)" << std::endl;
+            }
+
+            Threading::ScopedMutexLock lock( root->_pending->_mutex );
+            root->_pending->_done = true;
+        });
+
+    return root.release();
+}
+
 osg::Node*
 KMLReader::read( xml_document<>& doc, const osgDB::Options* dbOptions )
 {
@@ -75,66 +251,21 @@ KMLReader::read( xml_document<>& doc, const osgDB::Options* dbOptions )
 
 	root->setName( context.referrer() );
 
-    KMLContext cx;
-    cx._mapNode   = _mapNode;
-    cx._sheet     = new StyleSheet();
-    cx._options   = _options;
-    //cx._srs      = SpatialReference::create( "wgs84", "egm96" );
-    // Use the geographic srs of the map so that clamping will occur against the correct vertical datum.
-    cx._srs = _mapNode->getMapSRS()->getGeographicSRS();
-    cx._referrer = context.referrer();
-    cx._groupStack.push( root );
-
+    // initialize the KML options with the defaults if necessary:
+    KMLOptions blankOptions;
 
-    // clone the dbOptions, and install a resource cache if there isn't one already:
+    // install a resource cache if there isn't one already:
     URIResultCache defaultUriCache;
-    if ( !URIResultCache::from(dbOptions) )
-    {
-        osgDB::Options* newOptions = Registry::instance()->cloneOrCreateOptions();
-        defaultUriCache.apply( newOptions );
-        cx._dbOptions = newOptions;
-    }
-    else
-    {
-        cx._dbOptions = dbOptions;
-    }
 
-    // initialize the KML options with the defaults if necessary:
-    KMLOptions blankOptions;
-    if ( cx._options == 0L )
-        cx._options = &blankOptions;
+    KMLContext cx;
+    initContext( cx, _mapNode, _options ? _options : &blankOptions, root, dbOptions, defaultUriCache );
 
     //if ( cx._options->iconAndLabelGroup().valid() && cx._options->declutter() == true )
     //{
     //    Decluttering::setEnabled( cx._options->iconAndLabelGroup()->getOrCreateStateSet(), true );
     //}
 
-    //const Config* top = conf.hasChild("kml" ) ? conf.child_ptr("kml") : &conf;
-	xml_node<> *top = doc.first_node("kml", 0, false);
-
-    if ( top)
-    {
-        KML_Root kmlRoot;
-
-        osg::Timer_t start = osg::Timer::instance()->tick();
-        kmlRoot.scan ( top, cx );    // first pass
-        osg::Timer_t end = osg::Timer::instance()->tick();
-        OE_INFO << LC << "  Scan1 took " << osg::Timer::instance()->delta_s(start, end) << std::endl;
-
-        start = osg::Timer::instance()->tick();
-        kmlRoot.scan2( top, cx );   // second pass
-        end = osg::Timer::instance()->tick();
-        OE_INFO << LC << "  Scan2 took " << osg::Timer::instance()->delta_s(start, end) << std::endl;
-
-        start = osg::Timer::instance()->tick();
-        kmlRoot.build( top, cx );   // third pass.
-        end = osg::Timer::instance()->tick();
-        OE_INFO << LC << "  build took " << osg::Timer::instance()->delta_s(start, end) << std::endl;
-    }
-
-    URIResultCache* cacheUsed = URIResultCache::from(cx._dbOptions.get());
-    CacheStats stats = cacheUsed->getStats();
-    OE_INFO << LC << "  URI Cache: " << stats._queries << " reads, " << (stats._hitRatio*100.0) << "% hits" << std::endl;
+    buildDocument( doc, cx );
 
     // Make sure the KML gets rendered after the terrain.
     root->getOrCreateStateSet()->setRenderBinDetails(2, "RenderBin");
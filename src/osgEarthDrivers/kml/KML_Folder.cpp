@@ -46,7 +46,7 @@ KML_Folder::build( xml_node<>* node, KMLContext& cx )
 {
     // creates an empty group and pushes it on the stack.
     osg::Group* group = new osg::Group();
-    cx._groupStack.top()->addChild( group );
+    cx.addChild( cx._groupStack.top().get(), group );
     cx._groupStack.push( group );
 
     KML_Container::build(node, cx, group);
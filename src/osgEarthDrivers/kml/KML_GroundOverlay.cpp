@@ -68,7 +68,7 @@ KML_GroundOverlay::build( xml_node<>* node, KMLContext& cx )
 
         im = new ImageOverlay( cx._mapNode, image.get() );
         im->setBoundsAndRotation( Bounds(west, south, east, north), rotation );
-        cx._groupStack.top()->addChild( im );
+        cx.addChild( cx._groupStack.top().get(), im );
     }
     else if (llab)
     {
@@ -87,7 +87,7 @@ KML_GroundOverlay::build( xml_node<>* node, KMLContext& cx )
 
         im = new ImageOverlay(cx._mapNode, image.get());
         im->setBoundsAndRotation(Bounds(west, south, east, north), rotation);
-        cx._groupStack.top()->addChild(im);
+        cx.addChild( cx._groupStack.top().get(), im );
     }
 
     else if ( llq )
@@ -111,7 +111,7 @@ KML_GroundOverlay::build( xml_node<>* node, KMLContext& cx )
                 osg::Vec2d( p[1].x(), p[1].y() ),
                 osg::Vec2d( p[3].x(), p[3].y() ),
                 osg::Vec2d( p[2].x(), p[2].y() ) );
-            cx._groupStack.top()->addChild( im );
+            cx.addChild( cx._groupStack.top().get(), im );
         }
     }
 
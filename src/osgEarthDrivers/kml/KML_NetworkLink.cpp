@@ -105,7 +105,7 @@ KML_NetworkLink::build( xml_node<>* node, KMLContext& cx )
         OE_DEBUG << LC << 
             "PLOD: radius = " << d << ", minRange=" << minRange << ", maxRange=" << maxRange << std::endl;
 
-        cx._groupStack.top()->addChild( plod );
+        cx.addChild( cx._groupStack.top().get(), plod );
     }
 
     else 
@@ -117,7 +117,7 @@ KML_NetworkLink::build( xml_node<>* node, KMLContext& cx )
         options->setPluginData( "osgEarth::MapNode", cx._mapNode );
         proxy->setDatabaseOptions( options );
 
-        cx._groupStack.top()->addChild( proxy );
+        cx.addChild( cx._groupStack.top().get(), proxy );
     }
 
 }
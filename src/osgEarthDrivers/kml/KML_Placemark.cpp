@@ -33,6 +33,25 @@
 using namespace osgEarth_kml;
 using namespace osgEarth;
 
+namespace
+{
+    // Placemarks usually share a handful of icons; load each one once
+    osg::Image* getIcon( const IconSymbol* icon, KMLContext& cx )
+    {
+        if ( !icon->url().isSet() )
+            return 0L;
+
+        URI uri = icon->url()->evalURI();
+
+        std::map<std::string, osg::ref_ptr<osg::Image> >::iterator i = cx._icons.find( uri.full() );
+        if ( i == cx._icons.end() )
+        {
+            i = cx._icons.insert( std::make_pair(uri.full(), osg::ref_ptr<osg::Image>(uri.getImage( cx._dbOptions.get() ))) ).first;
+        }
+        return i->second.get();
+    }
+}
+
 void 
 KML_Placemark::build( xml_node<>* node, KMLContext& cx )
 {
@@ -41,12 +60,19 @@ KML_Placemark::build( xml_node<>* node, KMLContext& cx )
 	std::string styleUrl = getValue(node, "styleurl");
 
 	if (!styleUrl.empty())
-	{	// process a "stylesheet" style
-		const Style* ref_style = cx._sheet->getStyle( styleUrl, false );
-		if (ref_style)
+	{	// process a "stylesheet" style, resolving each styleUrl only once
+		std::map<std::string, Style>::const_iterator i = cx._styleUrls.find( styleUrl );
+		if (i == cx._styleUrls.end())
 		{
-			masterStyle = masterStyle.combineWith(*ref_style);
+			Style resolved;
+			const Style* ref_style = cx._sheet->getStyle( styleUrl, false );
+			if (ref_style)
+			{
+				resolved = resolved.combineWith(*ref_style);
+			}
+			i = cx._styleUrls.insert( std::make_pair(styleUrl, resolved) ).first;
 		}
+		masterStyle = i->second;
 	}
 
 	xml_node<>* style = node->first_node("style", 0, false);
@@ -159,9 +185,17 @@ KML_Placemark::build( xml_node<>* node, KMLContext& cx )
                     // is there an icon?
                     if ( icon )
                     {
-                        PlaceNode* placeNode = new PlaceNode( position );
-                        placeNode->setStyle(style, cx._dbOptions.get());
-                        iconNode = placeNode;
+                        osg::Image* image = getIcon( icon, cx );
+                        if ( image )
+                        {
+                            iconNode = new PlaceNode( position, std::string(), style, image );
+                        }
+                        else
+                        {
+                            PlaceNode* placeNode = new PlaceNode( position );
+                            placeNode->setStyle(style, cx._dbOptions.get());
+                            iconNode = placeNode;
+                        }
                     }
 
                     else if ( !model && text && !name.empty() )
@@ -215,7 +249,7 @@ KML_Placemark::build( xml_node<>* node, KMLContext& cx )
                     if ( modelNode )
                         group->addChild( modelNode );
 
-                    cx._groupStack.top()->addChild( group );
+                    cx.addChild( cx._groupStack.top().get(), group );
 
                     if ( iconNode )
                         KML_Feature::build( node, cx, iconNode );
@@ -231,17 +265,17 @@ KML_Placemark::build( xml_node<>* node, KMLContext& cx )
                     {
                         if ( cx._options->iconAndLabelGroup().valid() )
                         {
-                            cx._options->iconAndLabelGroup()->addChild( iconNode );
+                            cx.addChild( cx._options->iconAndLabelGroup().get(), iconNode );
                         }
                         else
                         {
-                            cx._groupStack.top()->addChild( iconNode );
+                            cx.addChild( cx._groupStack.top().get(), iconNode );
                         }
                         KML_Feature::build( node, cx, iconNode );
                     }
                     if ( modelNode )
                     {
-                        cx._groupStack.top()->addChild( modelNode );
+                        cx.addChild( cx._groupStack.top().get(), modelNode );
                         KML_Feature::build( node, cx, modelNode );
                     }
                     if ( featureNode )
@@ -257,7 +291,7 @@ KML_Placemark::build( xml_node<>* node, KMLContext& cx )
                             child = g;
                         }
                 
-                        cx._groupStack.top()->addChild( child );
+                        cx.addChild( cx._groupStack.top().get(), child );
                         KML_Feature::build( node, cx, featureNode );
                     }
                 }
@@ -24,6 +24,7 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgEarth/Notify>
+#include <osgEarth/IOTypes>
 // For internal format definitions.
 #include <osg/Texture>
 
@@ -59,12 +60,27 @@ public:
 
     virtual ReadResult readImage(std::istream& fin, const osgDB::ReaderWriter::Options* = NULL) const
     {
-        // get length of file:
-        fin.seekg(0, fin.end);
-        int length = fin.tellg();
-        fin.seekg(0, fin.beg);
-        char* data = new char[length];
-        fin.read(data, length);
+        const char* data = NULL;
+        int length = 0;
+        std::vector<char> copy;
+
+        // decode an in-memory payload (e.g. an HTTP response) where it lies
+        const osgEarth::ByteBuffer* payload = osgEarth::ByteBufferStream::getBuffer(fin);
+        if (payload)
+        {
+            data = payload->ptr();
+            length = (int)payload->size();
+        }
+        else
+        {
+            // get length of file:
+            fin.seekg(0, fin.end);
+            length = fin.tellg();
+            fin.seekg(0, fin.beg);
+            copy.resize(length);
+            fin.read(&copy[0], length);
+            data = &copy[0];
+        }
 
         uint32 infoArr[8];
 
@@ -23,6 +23,7 @@
 #include <osgEarth/Feature>
 #include <osgEarth/Style>
 #include <osgEarth/Geometry>
+#include <iomanip>
 
 using namespace osgEarth;
 using namespace osgEarth::MapInspector;
@@ -31,9 +32,41 @@ namespace ui = osgEarth::Util::Controls;
 
 #define LC "[MapInspectorUI] "
 
+namespace
+{
+    // Refreshes the layer statistics twice a second or so.
+    struct UpdateStats : public osg::NodeCallback
+    {
+        void operator()(osg::Node* node, osg::NodeVisitor* nv)
+        {
+            if (nv->getFrameStamp() && nv->getFrameStamp()->getFrameNumber() % 30 == 0)
+                static_cast<MapInspectorUI*>(node)->updateStats();
+            traverse(node, nv);
+        }
+    };
+}
+
 MapInspectorUI::MapInspectorUI()
 {
-    //nop
+    setUpdateCallback(new UpdateStats());
+}
+
+void
+MapInspectorUI::updateStats()
+{
+    for (auto& i : _statsLabels)
+    {
+        osg::ref_ptr<TileLayer> layer;
+        if (i.first.lock(layer))
+        {
+            TileLayer::Statistics s = layer->getStatistics();
+            i.second->setText(Stringify()
+                << s.requests << " req, "
+                << (int)(100.0 * s.cacheHitRatio()) << "% cache hit, "
+                << std::fixed << std::setprecision(1) << s.averageSourceMs() << " ms/read, "
+                << s.errors << " errors");
+        }
+    }
 }
 
 void
@@ -45,6 +78,7 @@ MapInspectorUI::reinit(MapNode* mapNode)
     _annos->removeChildren(0, _annos->getNumChildren());
 
     this->clearControls();
+    _statsLabels.clear();
 
     if ( mapNode )
     {
@@ -154,6 +188,10 @@ MapInspectorUI::addTileLayer(TileLayer* layer,
 
         unsigned r = this->getNumRows();
         setControl(0, r, new ui::LabelControl(text, color));
+
+        ui::LabelControl* stats = new ui::LabelControl("", color);
+        setControl(1, r, stats);
+        _statsLabels.push_back(StatsLabel(layer, stats));
     }
 }
 
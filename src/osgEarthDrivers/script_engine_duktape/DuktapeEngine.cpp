@@ -380,7 +380,11 @@ DuktapeEngine::run(
     for (auto& feature : features)
     {
         // Load the next feature into the global object:
-        setFeature(c._ctx, feature.get(), complete);
+        if (feature.get() != c._feature.get())
+        {
+            setFeature(c._ctx, feature.get(), complete);
+            c._feature = feature.get();
+        }
 
         // Duplicate the function on the top since we'll be calling it multiple times
         duk_dup_top(ctx); // [function function]
@@ -39,6 +39,7 @@
 #include <osgEarth/GLUtils>
 #include <osgEarth/Lighting>
 #include <osgEarth/PointDrawable>
+#include <osgEarth/StringUtils>
 
 #include <osg/MatrixTransform>
 #include <osg/ShapeDrawable>
@@ -56,6 +57,7 @@
 #include <osg/Quat>
 
 #include <sstream>
+#include <unordered_map>
 #include <time.h>
 
 #define LC "[SimpleSkyNode] "
@@ -198,6 +200,7 @@ namespace
 
 SimpleSkyNode::SimpleSkyNode(const SimpleSkyOptions& options) :
 SkyNode ( options ),
+_dateTimeInterval( -1.0 ),
 _options( options )
 {
     construct();
@@ -345,6 +348,7 @@ void
 SimpleSkyNode::onSetEphemeris()
 {
     // trigger the date/time update.
+    _dateTimeInterval = -1.0;
     onSetDateTime();
 }
 
@@ -353,9 +357,16 @@ SimpleSkyNode::onSetDateTime()
 {
     if ( _ellipsoidModel.valid() )
     {
-        osg::View* view = 0L;
         const DateTime& dt = getDateTime();
 
+        // Nothing moves until the time leaves the ephemeris' current
+        // interval, so skip the updates for small steps.
+        double resolution = getEphemeris()->getTimeResolution();
+        double interval = resolution > 0.0 ? floor((double)dt.asTimeStamp() / resolution) : -1.0;
+        if (interval >= 0.0 && interval == _dateTimeInterval)
+            return;
+        _dateTimeInterval = interval;
+
         CelestialBody sun = getEphemeris()->getSunPosition(dt);
         setSunPosition( sun.geocentric );
 
@@ -409,13 +420,7 @@ SimpleSkyNode::setSunPosition(const osg::Vec3d& pos)
     if ( _sunXform.valid() )
     {
         _sunXform->setMatrix( osg::Matrix::translate(pos) );
-
-        if (_moonXform.valid())
-        {
-            osg::Vec3d moonToSun = _sunXform->getMatrix().getTrans() - _moonXform->getMatrix().getTrans();
-            moonToSun.normalize();
-            _moonXform->getOrCreateStateSet()->getOrCreateUniform("moonToSun", osg::Uniform::FLOAT_VEC3)->set(osg::Vec3f(moonToSun));
-        }
+        updateMoonToSun();
     }
 }
 
@@ -425,13 +430,24 @@ SimpleSkyNode::setMoonPosition(const osg::Vec3d& pos)
     if (_moonXform.valid())
     {
         _moonXform->setMatrix(osg::Matrixd::translate(pos));
-        
-        if (_sunXform.valid())
+        updateMoonToSun();
+    }
+}
+
+void
+SimpleSkyNode::updateMoonToSun()
+{
+    if (_sunXform.valid() && _moonXform.valid())
+    {
+        if (!_moonToSunUniform.valid())
         {
-            osg::Vec3d moonToSun = _sunXform->getMatrix().getTrans() - _moonXform->getMatrix().getTrans();
-            moonToSun.normalize();
-            _moonXform->getOrCreateStateSet()->getOrCreateUniform("moonToSun", osg::Uniform::FLOAT_VEC3)->set(osg::Vec3f(moonToSun));
+            _moonToSunUniform = _moonXform->getOrCreateStateSet()->getOrCreateUniform(
+                "moonToSun", osg::Uniform::FLOAT_VEC3);
         }
+
+        osg::Vec3d moonToSun = _sunXform->getMatrix().getTrans() - _moonXform->getMatrix().getTrans();
+        moonToSun.normalize();
+        _moonToSunUniform->set(osg::Vec3f(moonToSun));
     }
 }
 
@@ -805,24 +821,41 @@ SimpleSkyNode::makeStars()
 
     _starRadius = 20000.0 * (_sunDistance > 0.0 ? _sunDistance : _outerRadius);
 
-    std::vector<StarData> stars;
+    // The star field never changes after it's built, so every sky with
+    // the same star settings shares one copy (and skips parsing the data).
+    static Threading::Mutex s_starsMutex(OE_MUTEX_NAME);
+    static std::unordered_map<std::string, osg::observer_ptr<osg::Node> > s_starsCache;
+
+    std::string starsKey = Stringify()
+        << _options.starFile().value() << ';' << _minStarMagnitude << ';'
+        << _options.starSize().get() << ';' << _starRadius;
 
-    if( _options.starFile().isSet() )
+    Threading::ScopedMutexLock lock(s_starsMutex);
+
+    s_starsCache[starsKey].lock(_stars);
+
+    if (!_stars.valid())
     {
-        if ( parseStarFile(*_options.starFile(), stars) == false )
+        std::vector<StarData> stars;
+
+        if( _options.starFile().isSet() )
         {
-            OE_WARN << LC 
-                << "Unable to use star field defined in \"" << *_options.starFile()
-                << "\", using default star data instead." << std::endl;
+            if ( parseStarFile(*_options.starFile(), stars) == false )
+            {
+                OE_WARN << LC 
+                    << "Unable to use star field defined in \"" << *_options.starFile()
+                    << "\", using default star data instead." << std::endl;
+            }
         }
-    }
 
-    if ( stars.empty() )
-    {
-        getDefaultStars( stars );
-    }
+        if ( stars.empty() )
+        {
+            getDefaultStars( stars );
+        }
 
-    _stars = buildStarGeometry(stars);
+        _stars = buildStarGeometry(stars);
+        s_starsCache[starsKey] = _stars.get();
+    }
 
     // make the stars' transform:
     _starsXform = new osg::MatrixTransform();
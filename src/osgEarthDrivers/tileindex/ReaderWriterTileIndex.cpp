@@ -25,7 +25,8 @@
 #include <osgEarth/ImageUtils>
 #include <osgEarth/URI>
 
-#include <osgEarthUtil/TileIndex>
+#include <osgEarth/TileIndex>
+#include <osgEarth/GDAL>
 
 
 #include <osgDB/FileNameUtils>
@@ -38,7 +39,6 @@
 #include <stdlib.h>
 #include <memory.h>
 
-#include <osgEarthDrivers/gdal/GDALOptions>
 #include "TileIndexOptions"
 
 
@@ -47,15 +47,14 @@
 using namespace std;
 using namespace osgEarth;
 using namespace osgEarth::Drivers;
-using namespace osgEarth::Util;
+using namespace osgEarth::Contrib;
 
 class TileIndexSource : public TileSource
 {
 public:
     TileIndexSource( const TileSourceOptions& options ):
       TileSource( options ),
-      _options( options ),
-	  _tileSourceCache( true )
+      _options( options )
     {
     }
 
@@ -67,6 +66,7 @@ public:
             _index = TileIndex::load( _options.url()->full() );        
             if (_index.valid() )
             {
+                _index->setMaxOpenDatasets( _options.maxOpenFiles().get() );
                 setProfile( osgEarth::Registry::instance()->getGlobalGeodeticProfile() );
                 return STATUS_OK;
             }
@@ -88,44 +88,13 @@ public:
         
         for (unsigned int i = 0; i < files.size(); i++)
         {            
-            osg::ref_ptr< TileSource> source;
-            {
-                //Try to get the TileSource from the cache
-                TileSourceCache::Record record;
-                if (_tileSourceCache.get( files[i], record ))
-                {
-                    source = record.value().get();                    
-                }
-                else
-                {
-                    // Couldn't get it from the cache so open it.                    
-                    GDALOptions opt;
-                    opt.url() = files[i];
-                    //Just force it to render so we don't have to worry about falling back
-                    opt.maxDataLevelOverride() = 23;           
-                    //Disable the l2 cache so that we don't run out of RAM so easily.
-                    opt.L2CacheSize() = 0;
-
-                    start = osg::Timer::instance()->tick();
-                    source = osgEarth::TileSourceFactory::create( opt );                               
-                    Status compStatus = source->open();
-                    if (compStatus.isOK())
-                    {
-                        _tileSourceCache.insert( files[i], source.get() );                                                
-                    }
-                    else
-                    {
-                        OE_WARN << "Failed to open " << files[i] << std::endl;
-                    }
-                    end = osg::Timer::instance()->tick();
-                    //OE_NOTICE << "init took " << osg::Timer::instance()->delta_m( start, end) << "ms" << std::endl;
-                }               
-            }
+            // Borrow an open dataset from the index's pool
+            std::shared_ptr<GDAL::Driver> driver = _index->getDriver( files[i], GDAL::Options(), getPixelsPerTile(), _dbOptions.get() );
+            if (!driver)
+                continue;
 
-            
-            
             start = osg::Timer::instance()->tick();
-            osg::ref_ptr< osg::Image > image = source->createImage( key);
+            osg::ref_ptr< osg::Image > image = driver->createImage( key, getPixelsPerTile(), false, progress );
             end = osg::Timer::instance()->tick();
             OE_DEBUG << "createImage " << osg::Timer::instance()->delta_m( start, end) << "ms" << std::endl;
             if (image)
@@ -150,10 +119,6 @@ public:
         return result;
     }
 
-    //std::map< std::string, osg::ref_ptr< TileSource> > _tileSourceCache;
-    typedef LRUCache< std::string, osg::ref_ptr< TileSource> > TileSourceCache;
-    TileSourceCache _tileSourceCache;
-
     osg::ref_ptr< TileIndex > _index;
     TileIndexOptions _options;
     osg::ref_ptr<osgDB::Options> _dbOptions;
@@ -28,6 +28,8 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 
+#include <osgEarth/IOTypes>
+
 #include <string>
 #include <sstream>
 #include <vector>
@@ -94,20 +96,40 @@ public:
   {
     Image *image = NULL;
     unsigned long size_of_vp8_image_data = 0;
-    char *vp8_buffer = NULL;
+    const char *vp8_buffer = NULL;
+    std::vector<char> vp8_copy;
 
-    fin.seekg(0, std::ios::end);
-    size_t stream_size = fin.tellg();
-    fin.seekg(0, std::ios::beg);
+    // decode an in-memory payload (e.g. an HTTP response) where it lies
+    const osgEarth::ByteBuffer *payload = osgEarth::ByteBufferStream::getBuffer(fin);
+
+    size_t stream_size = 0;
+    if (payload)
+    {
+      stream_size = payload->size();
+    }
+    else
+    {
+      fin.seekg(0, std::ios::end);
+      stream_size = fin.tellg();
+      fin.seekg(0, std::ios::beg);
+    }
 
     if (stream_size > 0)
     {
 
       size_of_vp8_image_data = stream_size;
-      vp8_buffer = new char[stream_size];
 
       int version = WebPGetEncoderVersion();
-      size_of_vp8_image_data = fin.read(vp8_buffer, size_of_vp8_image_data).gcount();
+      if (payload)
+      {
+        vp8_buffer = payload->ptr();
+      }
+      else
+      {
+        vp8_copy.resize(stream_size);
+        size_of_vp8_image_data = fin.read(&vp8_copy[0], size_of_vp8_image_data).gcount();
+        vp8_buffer = &vp8_copy[0];
+      }
 
       WebPDecoderConfig config;
       WebPInitDecoderConfig(&config);
@@ -149,7 +171,6 @@ public:
 
         status = WebPDecode((const uint8_t *)vp8_buffer, (uint32_t)size_of_vp8_image_data, &config);
       }
-      delete[] vp8_buffer;
     }
     else
     {
@@ -27,6 +27,11 @@ layout(binding=1, std430) readonly buffer RenderBuffer {
     RenderData render[];
 };
 
+// Indices of the instances that survived the per-view cull
+layout(binding=3, std430) readonly buffer VisibleBuffer {
+    uint visible[];
+};
+
 // Noise texture:
 uniform sampler2D oe_GroundCover_noiseTex;
 #define NOISE_SMOOTH   0
@@ -94,11 +99,13 @@ vec4 texture2D_bilinear_mesa(in sampler2D sampler, in vec2 tex_coord)
 // MAIN ENTRY POINT  
 void oe_GroundCover_VS(inout vec4 vertex_view)
 {
+    uint instance = visible[gl_InstanceID] & 0x0FFFFFFFu;
+
     // intialize with a "no draw" value (consider using a compute/gs cull instead)
     oe_GroundCover_atlasIndex = -1.0;
 
-    vertex_view = gl_ModelViewMatrix * render[gl_InstanceID].vertex;
-    oe_layer_tilec = vec4(render[gl_InstanceID].tilec, 0, 1);
+    vertex_view = gl_ModelViewMatrix * render[instance].vertex;
+    oe_layer_tilec = vec4(render[instance].tilec, 0, 1);
 
     vec4 noise = textureLod(oe_GroundCover_noiseTex, oe_layer_tilec.st, 0);
 
@@ -110,16 +117,17 @@ void oe_GroundCover_VS(inout vec4 vertex_view)
     float maxRange = oe_VisibleLayer_ranges[1] / oe_Camera.z;
     float nRange = clamp(-vertex_view.z / maxRange, 0.0, 1.0);
 
-    // cull verts that are out of range. Sadly we can't do this in COMPUTE.
+    // cull verts that are out of range. (The per-view compute cull already
+    // dropped most of these; this catches the rest.)
     if (nRange >= 0.99)
         return;
 
-    oe_GroundCover_atlasIndex = float(render[gl_InstanceID].sideIndex);
+    oe_GroundCover_atlasIndex = float(render[instance].sideIndex);
 
     // push the falloff closer to the max distance.
     float falloff = 1.0 - (nRange*nRange*nRange);
-    float width = render[gl_InstanceID].width * falloff;
-    float height = render[gl_InstanceID].width * falloff;
+    float width = render[instance].width * falloff;
+    float height = render[instance].width * falloff;
 
     int which = gl_VertexID & 7; // mod8 - there are 8 verts per instance
 
@@ -166,7 +174,7 @@ void oe_GroundCover_VS(inout vec4 vertex_view)
     float topDownAmount = rescale(d, 0.4, 0.6);
     float billboardAmount = rescale(1.0 - d, 0.0, 0.25);
 
-    if (which < 4 && render[gl_InstanceID].sideIndex >= 0 && billboardAmount > 0.0) // Front-facing billboard
+    if (which < 4 && render[instance].sideIndex >= 0 && billboardAmount > 0.0) // Front-facing billboard
     {
         vertex_view =
             which == 0 ? vec4(vertex_view.xyz - halfWidthTangentVector, 1.0) :
@@ -196,13 +204,13 @@ void oe_GroundCover_VS(inout vec4 vertex_view)
                 which == 0 || which == 2 ? mix(-tangentVector, faceNormalVector, blend) :
                 mix(tangentVector, faceNormalVector, blend);
 
-            oe_GroundCover_atlasIndex = float(render[gl_InstanceID].sideIndex);
+            oe_GroundCover_atlasIndex = float(render[instance].sideIndex);
         }
     }
 
-    else if (which >= 4 && render[gl_InstanceID].topIndex >= 0 && topDownAmount > 0.0) // top-down billboard
+    else if (which >= 4 && render[instance].topIndex >= 0 && topDownAmount > 0.0) // top-down billboard
     {
-        oe_GroundCover_atlasIndex = float(render[gl_InstanceID].topIndex);
+        oe_GroundCover_atlasIndex = float(render[instance].topIndex);
 
         // estiblish the local tangent plane:
         vec3 Z = mat3(osg_ViewMatrix) * vec3(0, 0, 1); //north pole
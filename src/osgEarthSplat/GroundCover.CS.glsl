@@ -67,7 +67,14 @@ uniform float oe_GroundCover_colorMinSaturation;
 
 #pragma import_defines(OE_LANDCOVER_TEX)
 #pragma import_defines(OE_LANDCOVER_TEX_MATRIX)
+#pragma import_defines(OE_LANDCOVER_INDEXED)
+#pragma import_defines(OE_LANDCOVER_CODES)
+#ifdef OE_LANDCOVER_INDEXED
+uniform usampler2D OE_LANDCOVER_TEX;
+uniform sampler2D OE_LANDCOVER_CODES;
+#else
 uniform sampler2D OE_LANDCOVER_TEX;
+#endif
 uniform mat4 OE_LANDCOVER_TEX_MATRIX;
 
 #pragma import_defines(OE_GROUNDCOVER_MASK_SAMPLER)
@@ -164,7 +171,12 @@ void main()
 #endif
 
     // sample the landcover data
-    int code = int(textureLod(OE_LANDCOVER_TEX, (OE_LANDCOVER_TEX_MATRIX*tilec4).st, 0).r);    
+#ifdef OE_LANDCOVER_INDEXED
+    uint lcIndex = textureLod(OE_LANDCOVER_TEX, (OE_LANDCOVER_TEX_MATRIX*tilec4).st, 0).r;
+    int code = int(texelFetch(OE_LANDCOVER_CODES, ivec2(int(lcIndex), 0), 0).r);
+#else
+    int code = int(textureLod(OE_LANDCOVER_TEX, (OE_LANDCOVER_TEX_MATRIX*tilec4).st, 0).r);
+#endif
     oe_gc_LandCoverGroup group;
     if (oe_gc_getLandCoverGroup(oe_gc_zone, code, group) == false)
         return;
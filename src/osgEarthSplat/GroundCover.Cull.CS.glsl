@@ -0,0 +1,106 @@
+#version 430
+
+// Per-view culling of generated ground cover. The generator (GroundCover.CS.glsl)
+// runs once per tile and its output is shared by all cameras; this pass runs
+// per camera and tile, testing each generated instance against the view
+// frustum and the maximum range, picks a level of detail by distance, and
+// appends the survivors to the tile's visible list for that LOD. The vertex
+// shaders read that list in place of gl_InstanceID. Each entry holds the
+// instance index in its low 28 bits and the LOD in its high 4 bits.
+
+#define WORK_GROUP_SIZE 64
+layout(local_size_x=WORK_GROUP_SIZE, local_size_y=1, local_size_z=1) in;
+
+struct DrawElementsIndirectCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint baseInstance;
+};
+
+// generated instances per tile slot
+layout(binding=0, std430) readonly buffer DrawCommandsBuffer
+{
+    DrawElementsIndirectCommand generated[];
+};
+
+struct RenderData
+{
+    vec4 vertex;      // 16
+    vec2 tilec;       // 8
+    int sideIndex;    // 4
+    int  topIndex;    // 4
+    float width;      // 4
+    float height;     // 4
+    float fillEdge;   // 4
+    float _padding;   // 4
+};
+
+layout(binding=1, std430) readonly buffer RenderBuffer
+{
+    RenderData render[];
+};
+
+layout(binding=3, std430) writeonly buffer VisibleBuffer
+{
+    uint visible[];
+};
+
+// one per tile and LOD in the batch
+layout(binding=4, std430) buffer ViewCommandsBuffer
+{
+    DrawElementsIndirectCommand cmd[];
+};
+
+uniform mat4 oe_gc_cullMVP;
+uniform mat4 oe_gc_cullMV;
+uniform float oe_gc_cullMaxRange;
+
+// (slot, tile number in batch, instances per slot, visible list stride)
+uniform ivec4 oe_gc_cullTile;
+
+// farthest distance at which to draw each LOD, nearest LOD first
+#define MAX_LODS 4
+uniform int oe_gc_numLODs;
+uniform float oe_gc_lodRange[MAX_LODS];
+
+void main()
+{
+    uint slot = uint(oe_gc_cullTile[0]);
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= generated[slot].instanceCount)
+        return;
+
+    uint index = slot * uint(oe_gc_cullTile[2]) + i;
+
+    // bounding sphere of the instance in the tile's model space; +Z is up
+    float height = render[index].height;
+    float radius = max(render[index].width, height);
+    vec4 center = vec4(render[index].vertex.xyz + vec3(0.0, 0.0, 0.5*height), 1.0);
+
+    vec4 center_view = oe_gc_cullMV * center;
+    if (-center_view.z > oe_gc_cullMaxRange + radius)
+        return;
+
+    // frustum planes from the rows of the MVP (skipping the far plane,
+    // which the range test covers):
+    mat4 m = transpose(oe_gc_cullMVP);
+    vec4 planes[5] = vec4[5](m[3]+m[0], m[3]-m[0], m[3]+m[1], m[3]-m[1], m[3]+m[2]);
+    for (int p = 0; p < 5; ++p)
+    {
+        if (dot(planes[p], center) < -radius * length(planes[p].xyz))
+            return;
+    }
+
+    int numLODs = clamp(oe_gc_numLODs, 1, MAX_LODS);
+    float range = length(center_view.xyz);
+    int lod = 0;
+    while (lod < numLODs-1 && range > oe_gc_lodRange[lod])
+        ++lod;
+
+    uint list = uint(oe_gc_cullTile[1]) * uint(numLODs) + uint(lod);
+    uint n = atomicAdd(cmd[list].instanceCount, 1u);
+    visible[list * uint(oe_gc_cullTile[3]) + n] = index | (uint(lod) << 28);
+}
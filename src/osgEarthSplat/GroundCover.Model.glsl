@@ -25,6 +25,11 @@ layout(binding=1, std430) readonly buffer RenderBuffer
     RenderData render[];
 };
 
+// Indices of the instances that survived the per-view cull
+layout(binding=3, std430) readonly buffer VisibleBuffer {
+    uint visible[];
+};
+
 // Noise texture:
 uniform sampler2D oe_GroundCover_noiseTex;
 #define NOISE_SMOOTH   0
@@ -46,23 +51,70 @@ out float oe_GroundCover_falloff;
 
 vec3 vp_Normal;
 
+// Octahedral impostor, drawn as the farthest LOD (see InstanceCloud::ModelCruncher)
+uniform vec4 oe_gc_impostor;       // model bound: center, radius
+uniform int oe_gc_impostorFrames;  // frames across the atlas; 0 = no impostor
+uniform int oe_gc_impostorLOD;
+
+// hemi-octahedral mapping; matches InstanceCloud.cpp
+vec2 oe_gc_impostorEncode(in vec3 dir)
+{
+    vec2 p = dir.xy / (abs(dir.x) + abs(dir.y) + dir.z);
+    return vec2(p.x + p.y, p.x - p.y);
+}
+
+vec3 oe_gc_impostorDecode(in vec2 uv)
+{
+    vec2 p = vec2(uv.x + uv.y, uv.x - uv.y) * 0.5;
+    return normalize(vec3(p, 1.0 - abs(p.x) - abs(p.y)));
+}
+
 // MAIN ENTRY POINT  
 void oe_GroundCover_Model_VS(inout vec4 vertex)
 {
+    uint entry = visible[gl_InstanceID];
+    uint instance = entry & 0x0FFFFFFFu;
+    int lod = int(entry >> 28);
+
+    oe_GroundCover_texCoord = gl_MultiTexCoord7.xyz;
+
     // intialize with a "no draw" value
     //oe_GroundCover_atlasIndex = 0.0;
 
-    vec4 noise = texture(oe_GroundCover_noiseTex, render[gl_InstanceID].tilec);
+    vec4 noise = texture(oe_GroundCover_noiseTex, render[instance].tilec);
 
     float a = 3.1415927 * 2.0 * noise[2];
     float s = sin(a), c = cos(a);
     mat2 rot = mat2(c, -s, s, c);
+
+    if (oe_gc_impostorFrames > 0 && lod == oe_gc_impostorLOD)
+    {
+        // direction to the camera in the instance's own (unrotated) frame:
+        vec3 eye = (gl_ModelViewMatrixInverse * vec4(0,0,0,1)).xyz - render[instance].vertex.xyz;
+        eye.xy = transpose(rot) * eye.xy;
+        vec3 dir = eye - oe_gc_impostor.xyz;
+        dir = normalize(vec3(dir.xy, max(dir.z, 0.001*length(dir))));
+
+        // nearest baked frame, and the view basis it was baked with:
+        float frames = float(oe_gc_impostorFrames);
+        vec2 frame = clamp(floor((oe_gc_impostorEncode(dir)*0.5+0.5)*frames), 0.0, frames-1.0);
+        vec3 frameDir = oe_gc_impostorDecode((frame+0.5)/frames*2.0-1.0);
+        vec3 ref = abs(frameDir.z) > 0.999 ? vec3(0,1,0) : vec3(0,0,1);
+        vec3 right = normalize(cross(ref, frameDir));
+        vec3 up = cross(frameDir, right);
+
+        vec2 corner = gl_MultiTexCoord7.xy;
+        vertex.xyz = oe_gc_impostor.xyz + (right*(corner.x*2.0-1.0) + up*(corner.y*2.0-1.0)) * oe_gc_impostor.w;
+        vp_Normal = frameDir;
+        oe_GroundCover_texCoord = vec3((frame + corner) / frames, gl_MultiTexCoord7.z);
+    }
+
     vertex.xy = rot * vertex.xy;
 
     vp_Normal.xy = rot * vp_Normal.xy;
 
     // add anchor vertex to current vertex:
-    vertex.xyz += render[gl_InstanceID].vertex.xyz;
+    vertex.xyz += render[instance].vertex.xyz;
 
     // Calculate the normalized camera range (oe_Camera.z = LOD Scale)
     float maxRange = oe_GroundCover_maxDistance / oe_Camera.z;
@@ -74,10 +126,8 @@ void oe_GroundCover_Model_VS(inout vec4 vertex)
 
     // push the falloff closer to the max distance.
     oe_GroundCover_falloff = 1.0-(nRange*nRange);
-    //float width = render[gl_InstanceID].width * falloff;
-    //float height = render[gl_InstanceID].width * falloff;
-
-    oe_GroundCover_texCoord = gl_MultiTexCoord7.xyz;
+    //float width = render[instance].width * falloff;
+    //float height = render[instance].width * falloff;
 
 #ifdef OE_IS_SHADOW_CAMERA
 
@@ -319,23 +319,7 @@ GroundCoverFeatureGenerator::getFeatures(const GeoExtent& extent, FeatureList& o
 const BiomeZone&
 GroundCoverFeatureGenerator::selectZone(const GeoPoint& p) const
 {
-    if (p.isValid() == false)
-    {
-        return _gclayer->getZones()[0];
-    }
-
-    // reverse iteration:
-    for(int i=_gclayer->getZones().size()-1; i >= 0; --i)
-    {
-        const BiomeZone& zone = _gclayer->getZones()[i];
-
-        if (zone.contains(p))
-        {
-            return zone;
-        }
-    }
-
-    return _gclayer->getZones()[0];
+    return _gclayer->getZones()[_gclayer->getZoneIndex(p)];
 }
 
 Status
@@ -398,6 +382,12 @@ GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output
     ImageUtils::PixelReader lcSampler;
     lcSampler.setTexture(lcTex);
 
+    // indexed land cover textures carry the palette that decodes them
+    const LandCoverPalette* lcPalette = lcTex ?
+        dynamic_cast<const LandCoverPalette*>(lcTex->getUserData()) : NULL;
+    if (lcPalette)
+        lcSampler.setDenormalize(false);
+
     // elevation
     osg::Texture* elevTex = NULL;
     osg::Matrix elevMat;
@@ -469,7 +459,8 @@ GroundCoverFeatureGenerator::getFeatures(const TileKey& key, FeatureList& output
         if (lcTex)
         {
             sample(landCover, lcSampler, lcMat, tilec.x(), tilec.y());
-            lcclass = _lcdict->getClassByValue((int)landCover.r());
+            float code = lcPalette ? lcPalette->getCode((unsigned)landCover.r()) : landCover.r();
+            lcclass = _lcdict->getClassByValue((int)code);
             if (lcclass == NULL)
                 continue;
             group = zone.getLandCoverGroup(lcclass);
@@ -31,15 +31,20 @@
 #include <osgEarth/Capabilities>
 #include <osgEarth/Math>
 #include <osgEarth/TerrainEngineNode>
+#include <osgEarth/Cache>
+#include <osgEarth/StringUtils>
+#include <osgEarth/GPUTimer>
 #include <osg/BlendFunc>
 #include <osg/Multisample>
 #include <osg/Texture2D>
 #include <osg/Depth>
 #include <osg/Version>
+#include <osg/Timer>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgUtil/CullVisitor>
 #include <osgUtil/Optimizer>
+#include <osgUtil/Simplifier>
 #include <cstdlib> // getenv
 
 #define LC "[GroundCoverLayer] " << getName() << ": "
@@ -76,6 +81,7 @@ GroundCoverLayer::Options::getConfig() const
     conf.set("max_alpha", maxAlpha());
     conf.set("alpha_to_coverage", alphaToCoverage());
     conf.set("wind_scale", windScale());
+    conf.set("instance_cache_size", instanceCacheSize());
 
     Config zones("zones");
     for (int i = 0; i < _biomeZones.size(); ++i) {
@@ -97,6 +103,7 @@ GroundCoverLayer::Options::fromConfig(const Config& conf)
     maxAlpha().setDefault(0.15f);
     alphaToCoverage().setDefault(true);
     windScale().setDefault(1.0f);
+    instanceCacheSize().setDefault(128u);
 
     maskLayer().get(conf, "mask_layer");
     colorLayer().get(conf, "color_layer");
@@ -106,6 +113,7 @@ GroundCoverLayer::Options::fromConfig(const Config& conf)
     conf.get("max_alpha", maxAlpha());
     conf.get("alpha_to_coverage", alphaToCoverage());
     conf.get("wind_scale", windScale());
+    conf.get("instance_cache_size", instanceCacheSize());
 
     const Config* zones = conf.child_ptr("zones");
     if (zones)
@@ -186,17 +194,12 @@ GroundCoverLayer::ZoneSelector::operator()(osg::Node* node, osg::NodeVisitor* nv
             int zoneIndex = 0;
             osg::Vec3d vp = cv->getViewPoint();
 
-            const SpatialReference* wgs84 = SpatialReference::get("wgs84");
-            GeoPoint p;
-            p.fromWorld(wgs84, vp);
-                
-            for(int z=_layer->getZones().size()-1; z > 0 && zoneIndex == 0; --z)
+            if (_layer->getZones().size() > 1)
             {
-                if ( _layer->getZones()[z].contains(p) )
-                {
-                    zoneIndex = z;
-                    //OE_INFO << p.toString() << ", zoneIndex=" << zoneIndex << std::endl;
-                }
+                const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+                GeoPoint p;
+                p.fromWorld(wgs84, vp);
+                zoneIndex = _layer->getZoneIndex(p);
             }
 
             osg::StateSet* zoneStateSet = _layer->getZoneStateSet(zoneIndex);
@@ -257,6 +260,18 @@ GroundCoverLayer::~GroundCoverLayer()
 Status
 GroundCoverLayer::openImplementation()
 {
+    // index the zone boundaries for fast zone selection
+    _zoneGrid.clear();
+    for (unsigned z = 0; z < getZones().size(); ++z)
+    {
+        const BiomeZone::Boundaries& boundaries = getZones()[z].getBoundaries();
+        for (unsigned b = 0; b < boundaries.size(); ++b)
+        {
+            _zoneGrid.addBoundary(z, boundaries[b].extent);
+        }
+    }
+    _zoneGrid.build();
+
     // GL version requirement
     if (Registry::capabilities().getGLSLVersion() < 4.3f)
     {
@@ -384,6 +399,29 @@ GroundCoverLayer::getUseAlphaToCoverage() const
     return options().alphaToCoverage().get();
 }
 
+void
+GroundCoverLayer::setInstanceCacheSize(unsigned value)
+{
+    options().instanceCacheSize() = value;
+}
+
+unsigned
+GroundCoverLayer::getInstanceCacheSize() const
+{
+    return options().instanceCacheSize().get();
+}
+
+int
+GroundCoverLayer::getZoneIndex(const GeoPoint& point) const
+{
+    if (!point.isValid())
+        return 0;
+
+    const std::vector<BiomeZone>& zones = getZones();
+    return _zoneGrid.find(point.x(), point.y(),
+        [&zones, &point](int z) { return zones[z].contains(point); });
+}
+
 void
 GroundCoverLayer::update(osg::NodeVisitor& nv)
 {
@@ -718,17 +756,6 @@ namespace
         return geom;
     }
 
-    osg::Geometry* loadShape()
-    {
-        //osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile("D:/data/models/rockinsoil/RockSoil.3DS.osg");
-        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile("D:/data/models/OakTree/redoak.osgb");
-        
-        InstanceCloud::ModelCruncher cruncher;
-        cruncher.add(node.get());
-        cruncher.finalize();
-        
-        return cruncher._geom.release();
-    }
 }
 
 osg::Geometry*
@@ -736,9 +763,10 @@ GroundCoverLayer::createGeometry() const
 {
     osg::Geometry* out_geom = NULL;
 
-    if (_isModel)
+    if (_isModel && _modelGeometry.valid())
     {
-        out_geom = loadShape();
+        // shallow copy; every instancer shares the arrays and the atlas
+        out_geom = new osg::Geometry(*_modelGeometry.get());
         out_geom->setUseVertexBufferObjects(true);
         out_geom->setUseDisplayList(false);
         return out_geom;
@@ -767,10 +795,72 @@ GroundCoverLayer::Renderer::UniformState::UniformState()
     // when the program is active
     _computeDataUL = -1;
     _A2CUL = -1;
+    _cullMVPUL = -1;
+    _cullMVUL = -1;
+    _cullTileUL = -1;
+    _cullMaxRangeUL = -1;
+    _cullNumLODsUL = -1;
+    _cullLODRangeUL = -1;
     _tileCounter = 0;
     _numInstances1D = 0;
 }
 
+GroundCoverLayer::Renderer::InstanceCache::InstanceCache() :
+    _capacity(0u),
+    _layerRevision(-1),
+    _lastTileBatchID(-1)
+{
+    //nop
+}
+
+unsigned
+GroundCoverLayer::Renderer::InstanceCache::getSlot(const TileKey& key, unsigned tileRevision, bool& generate)
+{
+    Entries::iterator i = _entries.find(key);
+    if (i != _entries.end())
+    {
+        Entry& entry = i->second;
+        _lru.splice(_lru.begin(), _lru, entry._lru);
+        generate = (entry._tileRevision != tileRevision);
+        entry._tileRevision = tileRevision;
+        return entry._slot;
+    }
+
+    generate = true;
+    unsigned slot;
+
+    if (_entries.size() < _capacity)
+    {
+        slot = _entries.size();
+    }
+    else
+    {
+        // Recycle the least recently used tile. The capacity is never less
+        // than the batch size, so this is never a tile in the current batch.
+        Entries::iterator victim = _entries.find(_lru.back());
+        slot = victim->second._slot;
+        _entries.erase(victim);
+        _lru.pop_back();
+    }
+
+    _lru.push_front(key);
+    Entry& entry = _entries[key];
+    entry._slot = slot;
+    entry._tileRevision = tileRevision;
+    entry._lru = _lru.begin();
+    return slot;
+}
+
+void
+GroundCoverLayer::Renderer::InstanceCache::clear()
+{
+    _entries.clear();
+    _lru.clear();
+    _batchSlots.clear();
+    _views.clear();
+    _lastTileBatchID = -1;
+}
+
 GroundCoverLayer::Renderer::Renderer(GroundCoverLayer* layer)
 {
     _layer = layer;
@@ -778,6 +868,12 @@ GroundCoverLayer::Renderer::Renderer(GroundCoverLayer* layer)
     // create uniform IDs for each of our uniforms
     _A2CName = osg::Uniform::getNameID("oe_GroundCover_A2C");
     _computeDataUName = osg::Uniform::getNameID("oe_tile");
+    _cullMVPName = osg::Uniform::getNameID("oe_gc_cullMVP");
+    _cullMVName = osg::Uniform::getNameID("oe_gc_cullMV");
+    _cullTileName = osg::Uniform::getNameID("oe_gc_cullTile");
+    _cullMaxRangeName = osg::Uniform::getNameID("oe_gc_cullMaxRange");
+    _cullNumLODsName = osg::Uniform::getNameID("oe_gc_numLODs");
+    _cullLODRangeName = osg::Uniform::getNameID("oe_gc_lodRange");
 
     _drawStateBuffer.resize(256u);
 
@@ -794,6 +890,13 @@ GroundCoverLayer::Renderer::Renderer(GroundCoverLayer* layer)
     _computeProgram->addShader(s);
     _computeStateSet->setAttribute(_computeProgram, osg::StateAttribute::ON);
 
+    // And the per-view cull shader
+    source = ShaderLoader::load(shaders.GroundCover_Cull_CS, shaders, layer->getReadOptions());
+    _cullStateSet = new osg::StateSet();
+    osg::Program* cullProgram = new osg::Program();
+    cullProgram->addShader(new osg::Shader(osg::Shader::COMPUTE, source));
+    _cullStateSet->setAttribute(cullProgram, osg::StateAttribute::ON);
+
     _counter = 0;
 
     _frameLastActive = ~0U;
@@ -816,68 +919,115 @@ GroundCoverLayer::Renderer::draw(osg::RenderInfo& ri, const PatchLayer::TileBatc
     // Push the pre-gen culling shader and run it:
     const ZoneSA* sa = ZoneSA::extract(ri.getState());
     osg::ref_ptr<InstanceCloud>& instancer = ds._instancers[sa->_obj];
+    InstanceCache& cache = ds._caches[sa->_obj];
     if (!instancer.valid())
     {
         instancer = new InstanceCloud();
-        ds._lastTileBatchID = -1;
+        cache.clear();
         ds._uniforms.clear();
     }
 
-    // Pull the per-camera data
-    PerCameraData& pcd = _layer->_perCamera.get(ri.getCurrentCamera());
+    // Anything that changes the generator's output invalidates the cache
+    int revision = getGeneratorRevision();
+    if (cache._layerRevision != revision)
+    {
+        cache.clear();
+        cache._layerRevision = revision;
+    }
 
-    // Only run the compute shader when the tile batch has changed:
-    bool needsCompute = sa != pcd._previousZoneSA;
-    pcd._previousZoneSA = sa;
+    // Run the compute pass when the tile batch has changed. Tiles that are
+    // still in the cache (from earlier frames or other cameras) are skipped.
+    bool needsCompute = false;
 
-    if (ds._lastTileBatchID != tiles->getBatchID())
+    // this can happen for a new instancer or after releaseGLobjects is called:
+    if (instancer->_data.commands == nullptr)
     {
-        ds._lastTileBatchID = tiles->getBatchID();
+        cache.clear();
         needsCompute = true;
     }
 
-    // this can happen for a new instancer or after releaseGLobjects is called:
-    if (instancer->_data.commands == nullptr)
+    if (cache._lastTileBatchID != tiles->getBatchID())
     {
+        cache._lastTileBatchID = tiles->getBatchID();
         needsCompute = true;
     }
 
+    // I'm not sure why we have to push the layer's stateset here.
+    // It should have bee applied already in the render bin.
+    // I am missing something. -gw 4/20/20
+    state->pushStateSet(_layer->getStateSet());
+
     if (needsCompute)
     {
-        // I'm not sure why we have to push the layer's stateset here.
-        // It should have bee applied already in the render bin.
-        // I am missing something. -gw 4/20/20
-        
-        state->pushStateSet(_layer->getStateSet());
-
-        // First pass: render with compute shader
+        // First pass: generate the tiles that aren't in the cache.
+        // This is shared by all the cameras drawing on this context.
         state->apply(_computeStateSet.get());
         applyLocalState(ri, ds);
 
-        instancer->allocateGLObjects(ri, tiles->size());
-        instancer->preCull(ri);
+        // the cache must hold at least the whole batch:
+        cache._capacity = osg::maximum(
+            osg::maximum(cache._capacity, _layer->getInstanceCacheSize()),
+            (unsigned)tiles->size());
+
+        if (instancer->allocateGLObjects(ri, cache._capacity))
+        {
+            cache.clear();
+            cache._lastTileBatchID = tiles->getBatchID();
+        }
+
+        cache._batchSlots.clear();
+
+        GPUTimer::Scope gpuTime(*state, "groundcover/generate");
+        instancer->preCull(ri, false);
         _pass = 0;
         tiles->drawTiles(ri);
         instancer->postCull(ri);
+    }
 
-        // restore previous program
-        state->apply();
+    // Second pass: cull the generated instances for this camera only.
+    int frame = state->getFrameStamp()->getFrameNumber();
+    InstanceCloud::ViewData& view = cache._views[ri.getCurrentCamera()];
+    view.frameLastUsed = frame;
+    ds._view = &view;
 
-        // rendering pass:
+    {
+        GPUTimer::Scope gpuTime(*state, "groundcover/cull");
+        state->apply(_cullStateSet.get());
         applyLocalState(ri, ds);
-        _pass = 1;
+        instancer->preViewCull(ri, view, tiles->size());
+        _pass = 2;
         tiles->drawTiles(ri);
-
-        state->popStateSet();
+        instancer->postCull(ri);
     }
 
-    else
+    // restore previous program
+    state->apply();
+
+    // rendering pass:
     {
+        GPUTimer::Scope gpuTime(*state, "groundcover/draw");
         applyLocalState(ri, ds);
+        instancer->setView(&view);
         _pass = 1;
         tiles->drawTiles(ri);
+        instancer->setView(NULL);
+        ds._view = NULL;
+    }
 
-        instancer->endFrame(ri);
+    state->popStateSet();
+
+    instancer->endFrame(ri);
+
+    // forget cameras that stopped drawing this zone
+    if (needsCompute)
+    {
+        for (auto i = cache._views.begin(); i != cache._views.end(); )
+        {
+            if (frame - i->second.frameLastUsed > 120)
+                i = cache._views.erase(i);
+            else
+                ++i;
+        }
     }
 
     // Clean up and finish
@@ -890,6 +1040,24 @@ GroundCoverLayer::Renderer::draw(osg::RenderInfo& ri, const PatchLayer::TileBatc
 #endif
 }
 
+int
+GroundCoverLayer::Renderer::getGeneratorRevision() const
+{
+    int revision = _layer->getRevision();
+
+    const Layer* inputs[3] = {
+        _layer->getLandCoverLayer(),
+        _layer->getMaskLayer(),
+        _layer->getColorLayer() };
+
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        revision = revision * 31 + (inputs[i] ? inputs[i]->getRevision() : 0);
+    }
+
+    return revision;
+}
+
 void
 GroundCoverLayer::Renderer::applyLocalState(osg::RenderInfo& ri, DrawState& ds)
 {
@@ -905,6 +1073,38 @@ GroundCoverLayer::Renderer::applyLocalState(osg::RenderInfo& ri, DrawState& ds)
     {
         u._computeDataUL = pcp->getUniformLocation(_computeDataUName);
         u._A2CUL = pcp->getUniformLocation(_A2CName);
+        u._cullMVPUL = pcp->getUniformLocation(_cullMVPName);
+        u._cullMVUL = pcp->getUniformLocation(_cullMVName);
+        u._cullTileUL = pcp->getUniformLocation(_cullTileName);
+        u._cullMaxRangeUL = pcp->getUniformLocation(_cullMaxRangeName);
+        u._cullNumLODsUL = pcp->getUniformLocation(_cullNumLODsName);
+        u._cullLODRangeUL = pcp->getUniformLocation(_cullLODRangeName);
+    }
+
+    // same range the vertex shaders fade out at
+    float lodScale = ri.getCurrentCamera() ? ri.getCurrentCamera()->getLODScale() : 1.0f;
+    float maxRange = _layer->getMaxVisibleRange() / lodScale;
+
+    if (u._cullMaxRangeUL >= 0)
+    {
+        ext->glUniform1f(u._cullMaxRangeUL, maxRange);
+    }
+
+    if (u._cullNumLODsUL >= 0)
+    {
+        // The mesh LODs switch at fixed fractions of the visible range,
+        // and the last LOD (the impostor, if there is one) runs out to it.
+        const std::vector<InstanceCloud::LOD>& lods = _layer->_modelLODs;
+        GLint numLODs = osg::clampBetween((GLint)lods.size(), 1, 4);
+        // (with fewer LODs, the first fractions drop out)
+        const float fractions[4] = { 0.1f, 0.25f, 0.5f, 1.0f };
+        GLfloat ranges[4];
+        for (GLint i = 0; i < numLODs; ++i)
+            ranges[i] = maxRange * fractions[4 - numLODs + i];
+
+        ext->glUniform1i(u._cullNumLODsUL, numLODs);
+        if (u._cullLODRangeUL >= 0)
+            ext->glUniform1fv(u._cullLODRangeUL, numLODs, ranges);
     }
 
     u._tileCounter = 0;
@@ -932,6 +1132,8 @@ GroundCoverLayer::Renderer::applyLocalState(osg::RenderInfo& ri, DrawState& ds)
         {
             instancer->setGeometry(_layer->createGeometry());
             instancer->setNumInstances(u._numInstances1D, u._numInstances1D);
+            if (_layer->_isModel && !_layer->_modelLODs.empty())
+                instancer->setLODs(_layer->_modelLODs);
 
             // TODO: review this. I don't like it but have no good reason. -gw
             // This is here to integrate the model's texture atlas into the stateset
@@ -969,30 +1171,63 @@ GroundCoverLayer::Renderer::drawTile(osg::RenderInfo& ri, const PatchLayer::Draw
 
     UniformState& u = ds._uniforms[pcp];
 
+    InstanceCache& cache = ds._caches[sa->_obj];
+
     if (_pass == 0) // COMPUTE shader
     {
         osg::GLExtensions* ext = osg::GLExtensions::Get(ri.getContextID(), true);
 
-        if (u._computeDataUL >= 0)
+        bool generate;
+        unsigned slot = cache.getSlot(*tile._key, tile._revision, generate);
+        cache._batchSlots.push_back(slot);
+
+        if (generate && u._computeDataUL >= 0)
         {
             u._computeData[0] = tile._tileBBox->xMin();
             u._computeData[1] = tile._tileBBox->yMin();
             u._computeData[2] = tile._tileBBox->xMax();
             u._computeData[3] = tile._tileBBox->yMax();
 
-            u._computeData[4] = (float)u._tileCounter;
+            u._computeData[4] = (float)slot;
 
             // TODO: check whether this changed before calling it
             ext->glUniform1fv(u._computeDataUL, 5, &u._computeData[0]);
 
-            instancer->cullTile(ri, u._tileCounter);
+            instancer->resetTile(ri, slot);
+            instancer->cullTile(ri, slot);
+        }
+    }
+
+    else if (_pass == 2) // view CULL shader
+    {
+        if (ds._view && u._cullTileUL >= 0 && u._tileCounter < cache._batchSlots.size())
+        {
+            osg::GLExtensions* ext = osg::GLExtensions::Get(ri.getContextID(), true);
+
+            // tile's model space to this camera's view and clip space:
+            const osg::Matrix& mv = ri.getState()->getModelViewMatrix();
+            osg::Matrixf mvf(mv);
+            osg::Matrixf mvpf(mv * ri.getState()->getProjectionMatrix());
+            ext->glUniformMatrix4fv(u._cullMVUL, 1, GL_FALSE, mvf.ptr());
+            ext->glUniformMatrix4fv(u._cullMVPUL, 1, GL_FALSE, mvpf.ptr());
+
+            ext->glUniform4i(
+                u._cullTileUL,
+                (GLint)cache._batchSlots[u._tileCounter],
+                (GLint)u._tileCounter,
+                (GLint)(instancer->_data.numX * instancer->_data.numY),
+                (GLint)(ds._view->visibleBufferTileSize / sizeof(GLuint)));
+
+            instancer->viewCullTile(ri);
         }
     }
 
     else // DRAW shader
     {
-        // check valid flag
-        instancer->drawTile(ri, u._tileCounter);
+        if (u._tileCounter < cache._batchSlots.size())
+        {
+            instancer->drawTile(ri, u._tileCounter, cache._batchSlots[u._tileCounter]);
+        }
     }
 
     ++u._tileCounter;
@@ -1012,7 +1247,11 @@ GroundCoverLayer::Renderer::releaseGLObjects(osg::State* state) const
         DrawState& ds = _drawStateBuffer[state->getContextID()];
 
         ds._uniforms.clear();
-        ds._lastTileBatchID = -1;
+
+        for (auto& i : ds._caches)
+        {
+            i.second.clear();
+        }
 
         for (const auto& i : ds._instancers)
         {
@@ -1030,7 +1269,11 @@ GroundCoverLayer::Renderer::releaseGLObjects(osg::State* state) const
             DrawState& ds = _drawStateBuffer[i];
 
             ds._uniforms.clear();
-            ds._lastTileBatchID = -1;
+
+            for (auto& c : ds._caches)
+            {
+                c.second.clear();
+            }
 
             for (const auto& i : ds._instancers)
             {
@@ -1044,6 +1287,7 @@ GroundCoverLayer::Renderer::releaseGLObjects(osg::State* state) const
     }
 
     _computeStateSet->releaseGLObjects(state);
+    _cullStateSet->releaseGLObjects(state);
     _a2cBlending->releaseGLObjects(state);
 }
 
@@ -1214,6 +1458,115 @@ GroundCoverLayer::loadAssets()
         OE_WARN << LC << "Failed to load any assets!" << std::endl;
         // TODO: something?
     }
+
+    // The layer instances models only when every asset is a model;
+    // otherwise it draws billboards.
+    bool allModels = !_liveAssets.empty();
+    for (unsigned i = 0; i < _liveAssets.size() && allModels; ++i)
+    {
+        if (!_liveAssets[i]->_model.valid() || _liveAssets[i]->_sideImage.valid())
+            allModels = false;
+    }
+
+    if (allModels)
+    {
+        buildModelGeometry();
+        _isModel = _modelGeometry.valid();
+    }
+}
+
+namespace
+{
+    const char* MODEL_LODS_KEY = "lods";
+}
+
+void
+GroundCoverLayer::buildModelGeometry()
+{
+    // Only one model per layer for now
+    const AssetData* asset = _liveAssets.front().get();
+    const URI& uri = asset->_asset->options().modelURI().get();
+
+    _modelLODs.clear();
+
+    std::string cacheKey = Stringify() << "groundcover_model_" << std::hex << hashString(uri.full());
+
+    CacheBin* cacheBin = getCacheSettings() ? getCacheSettings()->getCacheBin() : NULL;
+    const CachePolicy& policy = getCacheSettings() ? getCacheSettings()->cachePolicy().get() : CachePolicy::NO_CACHE;
+
+    // The baked impostor and the simplified LODs are expensive to make,
+    // so try the cache first
+    if (cacheBin && policy.isCacheReadable())
+    {
+        ReadResult rr = cacheBin->readObject(cacheKey, getReadOptions());
+        osg::Geometry* geom = rr.succeeded() ? dynamic_cast<osg::Geometry*>(rr.getNode()) : NULL;
+        if (geom && rr.metadata().hasChild(MODEL_LODS_KEY))
+        {
+            const ConfigSet lods = rr.metadata().child(MODEL_LODS_KEY).children();
+            for (ConfigSet::const_iterator i = lods.begin(); i != lods.end(); ++i)
+            {
+                InstanceCloud::LOD lod;
+                lod.firstIndex = i->value<unsigned>("first", 0u);
+                lod.count = i->value<unsigned>("count", 0u);
+                _modelLODs.push_back(lod);
+            }
+            _modelGeometry = geom;
+            OE_INFO << LC << "Loaded model \"" << uri.base() << "\" from the cache" << std::endl;
+            return;
+        }
+    }
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    InstanceCloud::ModelCruncher cruncher;
+    cruncher.addLOD(asset->_model.get());
+
+    // Progressively simplified copies share the original's textures
+    const float ratios[2] = { 0.5f, 0.2f };
+    for (int i = 0; i < 2; ++i)
+    {
+        osg::ref_ptr<osg::Node> simplified = osg::clone(
+            asset->_model.get(),
+            osg::CopyOp::DEEP_COPY_NODES |
+            osg::CopyOp::DEEP_COPY_DRAWABLES |
+            osg::CopyOp::DEEP_COPY_ARRAYS |
+            osg::CopyOp::DEEP_COPY_PRIMITIVES);
+
+        osgUtil::Simplifier simplifier(ratios[i]);
+        simplified->accept(simplifier);
+        cruncher.addLOD(simplified.get());
+    }
+
+    osg::ref_ptr<osg::Image> impostor = cruncher.bakeImpostor(8u, 128u);
+    cruncher.addImpostor(impostor.get(), 8u);
+    cruncher.finalize();
+
+    if (cruncher._lods.empty())
+    {
+        OE_WARN << LC << "Model \"" << uri.base() << "\" has no triangles" << std::endl;
+        return;
+    }
+
+    _modelGeometry = cruncher._geom.get();
+    _modelLODs = cruncher._lods;
+
+    OE_INFO << LC << "Built " << _modelLODs.size() << " LODs for model \"" << uri.base() << "\" in "
+        << osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()) << "s" << std::endl;
+
+    if (cacheBin && policy.isCacheWriteable())
+    {
+        Config meta;
+        Config lods(MODEL_LODS_KEY);
+        for (unsigned i = 0; i < _modelLODs.size(); ++i)
+        {
+            Config lod("lod");
+            lod.set("first", _modelLODs[i].firstIndex);
+            lod.set("count", _modelLODs[i].count);
+            lods.add(lod);
+        }
+        meta.add(lods);
+        cacheBin->writeNode(cacheKey, _modelGeometry.get(), meta, getReadOptions());
+    }
 }
 
 osg::Texture*
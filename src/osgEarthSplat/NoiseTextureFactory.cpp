@@ -21,9 +21,13 @@
 #include <osgEarth/ImageUtils>
 #include <osgEarth/Random>
 #include <osgEarth/SimplexNoise>
-#include <osgEarth/Registry>
 #include <osgEarth/Metrics>
+#include <osgEarth/Threading>
 #include <osg/Texture2D>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
 
 using namespace osgEarth;
 using namespace osgEarth::Splat;
@@ -32,99 +36,109 @@ using namespace osgEarth::Util;
 
 #define LC "[NoiseTextureFactory] "
 
-osg::Texture*
-NoiseTextureFactory::create(unsigned dim, unsigned chans) const
+namespace
 {
-    OE_PROFILING_ZONE;
-    chans = osg::clampBetween(chans, 1u, 4u);
+    // The images only depend on their size and channel count, so every
+    // layer that asks for the same noise shares one copy
+    Threading::Mutex s_imagesMutex("NoiseTextureFactory(OE)");
+    std::map<std::pair<unsigned, unsigned>, osg::ref_ptr<osg::Image>> s_images;
 
-    GLenum type = chans >= 2u ? GL_RGBA : GL_RED;
-    GLenum textureFormat = chans >= 2u ? GL_RGBA8 : GL_R8;
-    
-    osg::Image* image = new osg::Image();
-    image->allocateImage(dim, dim, 1, type, GL_UNSIGNED_BYTE);
-    image->setInternalTextureFormat(textureFormat);
-
-    // 0 = SMOOTH
-    // 1 = NOISE
-    // 2 = NOISE2
-    // 3 = CLUMPY
-    const float F[4] = { 4.0f, 64.0f, 33.0f, 1.2f };
-    const float P[4] = { 0.8f,  1.0f,  0.9f, 0.9f };
-    const float L[4] = { 2.2f,  1.0f,  1.0f, 4.0f };
-
-    Random random(0, Random::METHOD_FAST);
-    
-    for(unsigned k=0; k<chans; ++k)
+    osg::Image* createImage(unsigned dim, unsigned chans)
     {
-        // Configure the noise function:
-        Util::SimplexNoise noise;
-        noise.setNormalize( true );
-        noise.setRange( 0.0, 1.0 );
-        noise.setFrequency( F[k] );
-        noise.setPersistence( P[k] );
-        noise.setLacunarity( L[k] );
-        noise.setOctaves( 8 );
-
-        float nmin = 10.0f;
-        float nmax = -10.0f;
-
-        // write repeating noise to the image:
-        ImageUtils::PixelReader read ( image );
-        ImageUtils::PixelWriter write( image );
-        osg::Vec4f v;
-
-        for(int t=0; t<(int)dim; ++t)
+        GLenum type = chans >= 2u ? GL_RGBA : GL_RED;
+        GLenum textureFormat = chans >= 2u ? GL_RGBA8 : GL_R8;
+        unsigned stride = chans >= 2u ? 4u : 1u;
+
+        osg::Image* image = new osg::Image();
+        image->allocateImage(dim, dim, 1, type, GL_UNSIGNED_BYTE);
+        image->setInternalTextureFormat(textureFormat);
+        ::memset(image->data(), 0, image->getTotalSizeInBytes());
+
+        // 0 = SMOOTH
+        // 1 = NOISE
+        // 2 = NOISE2
+        // 3 = CLUMPY
+        const float F[4] = { 4.0f, 64.0f, 33.0f, 1.2f };
+        const float P[4] = { 0.8f,  1.0f,  0.9f, 0.9f };
+        const float L[4] = { 2.2f,  1.0f,  1.0f, 4.0f };
+
+        Random random(0, Random::METHOD_FAST);
+
+        std::vector<float> values(dim * dim);
+        unsigned char* data = image->data();
+
+        for(unsigned k=0; k<chans; ++k)
         {
-            double rt = (double)t/(double)dim;
-            for(int s=0; s<(int)dim; ++s)
+            if ( k == 1 || k == 2 )
+            {
+                // white noise, in the same order as always
+                for(unsigned i=0; i<dim*dim; ++i)
+                    values[i] = (float)random.next();
+            }
+            else
             {
-                double rs = (double)s/(double)dim;
-                read(v, s, t);
-                double n;
+                // Configure the noise function:
+                Util::SimplexNoise noise;
+                noise.setNormalize( true );
+                noise.setRange( 0.0, 1.0 );
+                noise.setFrequency( F[k] );
+                noise.setPersistence( P[k] );
+                noise.setLacunarity( L[k] );
+                noise.setOctaves( 8 );
+                noise.getTiledValues(dim, &values[0]);
 
-                if ( k == 1 || k == 2 )
-                {
-                    n = (float)random.next();
-                }
-                else
+                // histogram stretch to [0..1] for simplex noise
+                for(unsigned i=0; i<dim*dim; ++i)
+                    values[i] = osg::clampBetween(values[i], 0.0f, 1.0f);
+
+                auto minmax = std::minmax_element(values.begin(), values.end());
+                float nmin = *minmax.first;
+                float range = *minmax.second - nmin;
+                if (range > 0.0f)
                 {
-                    n = noise.getTiledValue(rs, rt);
-                    n = osg::clampBetween(n, 0.0, 1.0);
+                    for(unsigned i=0; i<dim*dim; ++i)
+                        values[i] = (values[i]-nmin)/range;
                 }
-
-                if ( n < nmin ) nmin = n;
-                if ( n > nmax ) nmax = n;
-                
-                v[k] = n;
-                write(v, s, t);
-            }
-        }
-   
-        // histogram stretch to [0..1] for simplex noise
-        if ( k != 1 && k != 2 )
-        {
-            for(int x=0; x<(int)(dim*dim); ++x)
-            {
-                int s = x%int(dim), t = x/(int)dim;
-                read(v, s, t);
-                v[k] = osg::clampBetween((v[k]-nmin)/(nmax-nmin), 0.0f, 1.0f);
-                write(v, s, t);
             }
+
+            // write repeating noise to the image:
+            for(unsigned i=0; i<dim*dim; ++i)
+                data[i*stride + k] = (unsigned char)(values[i] * 255.0f);
         }
-    }    
-    
-    // create mipmaps
-    ImageUtils::mipmapImageInPlace(image);
+
+        // create mipmaps
+        ImageUtils::mipmapImageInPlace(image);
+
+        return image;
+    }
+}
+
+osg::Texture*
+NoiseTextureFactory::create(unsigned dim, unsigned chans) const
+{
+    OE_PROFILING_ZONE;
+    chans = osg::clampBetween(chans, 1u, 4u);
+
+    osg::ref_ptr<osg::Image> image;
+    {
+        Threading::ScopedMutexLock lock(s_imagesMutex);
+        osg::ref_ptr<osg::Image>& entry = s_images[std::make_pair(dim, chans)];
+        if (!entry.valid())
+            entry = createImage(dim, chans);
+        image = entry;
+    }
 
     // make a texture:
-    osg::Texture2D* tex = new osg::Texture2D( image );
+    osg::Texture2D* tex = new osg::Texture2D( image.get() );
     tex->setWrap(tex->WRAP_S, tex->REPEAT);
     tex->setWrap(tex->WRAP_T, tex->REPEAT);
     tex->setFilter(tex->MIN_FILTER, tex->LINEAR_MIPMAP_LINEAR);
     tex->setFilter(tex->MAG_FILTER, tex->LINEAR);
     tex->setMaxAnisotropy( 1.0f );
-    tex->setUnRefImageDataAfterApply(Registry::instance()->unRefImageDataAfterApply().get());
+
+    // the image is shared with every other texture of this size,
+    // so it can't be released
+    tex->setUnRefImageDataAfterApply(false);
 
     return tex;
 }
@@ -10,8 +10,25 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 #pragma vp_order      0.2
 
 #pragma import_defines(OE_LANDCOVER_TEX);
-
+#pragma import_defines(OE_LANDCOVER_INDEXED);
+#pragma import_defines(OE_LANDCOVER_CODES);
+
+#ifdef OE_LANDCOVER_INDEXED
+// palette indices, mapped back to land cover codes by lookup
+uniform usampler2D OE_LANDCOVER_TEX;
+uniform sampler2D OE_LANDCOVER_CODES;
+float oe_splat_readCoverage(in vec2 uv)
+{
+    uint index = texture(OE_LANDCOVER_TEX, uv).r;
+    return texelFetch(OE_LANDCOVER_CODES, ivec2(int(index), 0), 0).r;
+}
+#else
 uniform sampler2D OE_LANDCOVER_TEX;
+float oe_splat_readCoverage(in vec2 uv)
+{
+    return texture(OE_LANDCOVER_TEX, uv).r;
+}
+#endif
 
 //uniform sampler2D oe_splat_coverageTex;
 in vec2 oe_splat_covtc;
@@ -44,10 +61,10 @@ void oe_splat_sampleCoverage(inout vec4 unused)
     vec2 se = vec2(ne.x, sw.y);
 
     oe_LandCover_coverage = vec4(
-        texture(OE_LANDCOVER_TEX, sw).r,
-        texture(OE_LANDCOVER_TEX, se).r,
-        texture(OE_LANDCOVER_TEX, nw).r,
-        texture(OE_LANDCOVER_TEX, ne).r );
+        oe_splat_readCoverage(sw),
+        oe_splat_readCoverage(se),
+        oe_splat_readCoverage(nw),
+        oe_splat_readCoverage(ne) );
 
     //return vec4(
     //    texture(oe_splat_coverageTex, clamp(sw, 0.0, 1.0)).r,
@@ -103,6 +120,13 @@ vec4 oe_LandCover_coverage;
 
 // from SplatLayerFactory:
 uniform sampler2DArray oe_splatTex;
+
+#ifdef OE_SPLAT_RESIDENCY
+// full-resolution textures streamed in by SplatTextureResidency, and the
+// slot holding each texture index (-1 = not resident; use oe_splatTex)
+uniform sampler2DArray oe_splatTexResident;
+uniform int oe_splat_resident[256];
+#endif
 uniform int oe_splat_scaleOffsetInt;
 
 uniform float oe_splat_detailRange;
@@ -183,15 +207,29 @@ void oe_splat_getRenderInfo(in float value, in oe_SplatEnv env, out oe_SplatRend
 //............................................................................
 // Sample a texel from the splatting texture catalog
 
+vec4 oe_splat_sampleTex(in float index, in vec2 tc)
+{
+#ifdef OE_SPLAT_RESIDENCY
+    // Residency varies per texel, so supply the gradients explicitly
+    vec2 dx = dFdx(tc), dy = dFdy(tc);
+    int slot = oe_splat_resident[int(index)];
+    return slot >= 0 ?
+        textureGrad(oe_splatTexResident, vec3(tc, float(slot)), dx, dy) :
+        textureGrad(oe_splatTex, vec3(tc, index), dx, dy);
+#else
+    return texture(oe_splatTex, vec3(tc, index));
+#endif
+}
+
 void oe_splat_getTexel(in float index, in vec2 tc, out vec4 texel)
 {
-    texel = index >= 0.0 ? texture(oe_splatTex, vec3(tc, index)) : vec4(1,0,0,0);
+    texel = index >= 0.0 ? oe_splat_sampleTex(index, tc) : vec4(1,0,0,0);
 }
 
 #ifdef OE_SPLAT_USE_MATERIALS
 void oe_splat_getMaterial(in float index, in vec2 tc, out vec4 material)
 {
-    material = index >= 0.0 ? texture(oe_splatTex, vec3(tc, index)) : vec4(.5,.5,1,0);
+    material = index >= 0.0 ? oe_splat_sampleTex(index, tc) : vec4(.5,.5,1,0);
 }
 #endif
 
@@ -8,12 +8,17 @@ $GLSL_DEFAULT_PRECISION_FLOAT
 
 #pragma import_defines(OE_LANDCOVER_TEX)
 #pragma import_defines(OE_LANDCOVER_TEX_MATRIX)
+#pragma import_defines(OE_LANDCOVER_INDEXED)
 
 out vec4 oe_layer_tilec;
 out float oe_splat_range;
 out vec2 oe_splat_covtc;
 
+#ifdef OE_LANDCOVER_INDEXED
+uniform usampler2D OE_LANDCOVER_TEX;
+#else
 uniform sampler2D OE_LANDCOVER_TEX;
+#endif
 uniform mat4 OE_LANDCOVER_TEX_MATRIX;
 
 flat out float oe_splat_coverageTexSize;
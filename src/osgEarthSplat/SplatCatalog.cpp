@@ -23,6 +23,8 @@
 #include <osgEarth/Containers>
 #include <osgEarth/URI>
 #include <osgEarth/Metrics>
+#include <osgEarth/Cache>
+#include <osgEarth/StringUtils>
 #include <osg/Texture2DArray>
 
 using namespace osgEarth;
@@ -32,6 +34,8 @@ using namespace osgEarth::Splat;
 
 #define SPLAT_CATALOG_CURRENT_VERSION 1
 
+#define ARENA_SPLAT_RESIDENCY "oe.splat.residency"
+
 
 //............................................................................
 
@@ -195,7 +199,7 @@ SplatCatalog::getConfig() const
 
 namespace
 {
-    osg::Image* loadImage(const URI& uri, const osgDB::Options* dbOptions, osg::Image* firstImage)
+    osg::Image* loadImage(const URI& uri, const osgDB::Options* dbOptions, const osg::Image* firstImage)
     {
         // try to load the image:
         ReadResult result = uri.readImage(dbOptions);
@@ -249,11 +253,51 @@ namespace
 
         return result.releaseImage();
     }
+
+    // Mip levels the streamed catalog leaves out of the tails
+    const unsigned TAIL_LEVELS_DROPPED = 3u;
+    const int MIN_TAIL_SIZE = 16;
+
+    // Mip tail of a full-resolution image. It halves the image repeatedly,
+    // so each step averages 2x2 texels the way mipmap generation would.
+    osg::Image* createTail(osg::Image* image)
+    {
+        osg::ref_ptr<osg::Image> tail = image;
+        for (unsigned i = 0; i < TAIL_LEVELS_DROPPED; ++i)
+        {
+            if (tail->s() / 2 < MIN_TAIL_SIZE || tail->t() / 2 < MIN_TAIL_SIZE)
+                break;
+
+            osg::ref_ptr<osg::Image> half;
+            if (!ImageUtils::resizeImage(tail.get(), tail->s() / 2, tail->t() / 2, half))
+                break;
+
+            half->setInternalTextureFormat(image->getInternalTextureFormat());
+            tail = half.get();
+        }
+        return tail.release();
+    }
+
+    // Image with the size and format of another but no data, for
+    // compatibility checks against images that aren't loaded yet
+    osg::Image* describe(unsigned s, unsigned t, const osg::Image* format)
+    {
+        osg::Image* image = new osg::Image();
+        image->setImage(
+            s, t, 1,
+            format->getInternalTextureFormat(),
+            format->getPixelFormat(),
+            format->getDataType(),
+            NULL,
+            osg::Image::NO_DELETE);
+        return image;
+    }
 }
 
 bool
 SplatCatalog::createSplatTextureDef(const osgDB::Options* dbOptions,
-                                    SplatTextureDef&      out)
+                                    SplatTextureDef&      out,
+                                    unsigned              maxResidentTextures)
 {
     OE_PROFILING_ZONE;
     // Reset all texture indices to default
@@ -271,11 +315,95 @@ SplatCatalog::createSplatTextureDef(const osgDB::Options* dbOptions,
         }
     }
 
+    bool streaming = (maxResidentTextures > 0u);
+
+    // When streaming, the tails go in the cache so that later runs
+    // don't have to decode the full-resolution images at startup.
+    osg::ref_ptr<CacheBin> cacheBin;
+    CachePolicy policy = CachePolicy::NO_CACHE;
+    CacheSettings* cacheSettings = CacheSettings::get(dbOptions);
+    if (streaming && cacheSettings && cacheSettings->isCacheEnabled())
+    {
+        cacheBin = cacheSettings->getCacheBin();
+        policy = cacheSettings->cachePolicy().get();
+    }
+
     typedef UnorderedMap<URI, int> ImageIndexTable; // track images to prevent dupes
     ImageIndexTable imageIndices;
     std::vector< osg::ref_ptr<osg::Image> > imagesInOrder;
-    int index = 0;
-    osg::Image* firstImage  = 0L;
+    std::vector<URI> urisInOrder;
+
+    // First full-resolution image; the others must match it
+    osg::ref_ptr<osg::Image> firstImage;
+
+    // Loads the image (or its tail) the first time a URI appears
+    // and assigns it the next index.
+    auto getTextureIndex = [&](const URI& uri) -> int
+    {
+        ImageIndexTable::iterator k = imageIndices.find(uri);
+        if (k != imageIndices.end())
+            return k->second;
+
+        osg::ref_ptr<osg::Image> image;
+        std::string cacheKey = "splat_tail_" + hashToString(uri.full());
+
+        if (cacheBin.valid() && policy.isCacheReadable())
+        {
+            ReadResult rr = cacheBin->readImage(cacheKey, dbOptions);
+            if (rr.succeeded() && !policy.isExpired(rr.lastModifiedTime()))
+            {
+                osg::Image* tail = rr.getImage();
+                unsigned s = rr.metadata().value<unsigned>("full_s", 0u);
+                unsigned t = rr.metadata().value<unsigned>("full_t", 0u);
+
+                if (!firstImage.valid() && s > 0u && t > 0u)
+                {
+                    firstImage = describe(s, t, tail);
+                }
+
+                if (firstImage.valid() &&
+                    (unsigned)firstImage->s() == s &&
+                    (unsigned)firstImage->t() == t &&
+                    (imagesInOrder.empty() || ImageUtils::textureArrayCompatible(tail, imagesInOrder.front().get())))
+                {
+                    image = tail;
+                }
+            }
+        }
+
+        if (!image.valid())
+        {
+            osg::ref_ptr<osg::Image> full = loadImage(uri, dbOptions, firstImage.get());
+            if (!full.valid())
+                return -1;
+
+            if (!firstImage.valid())
+                firstImage = full.get();
+
+            if (streaming)
+            {
+                image = createTail(full.get());
+
+                if (cacheBin.valid() && policy.isCacheWriteable())
+                {
+                    Config meta;
+                    meta.set("full_s", full->s());
+                    meta.set("full_t", full->t());
+                    cacheBin->write(cacheKey, image.get(), meta, dbOptions);
+                }
+            }
+            else
+            {
+                image = full.get();
+            }
+        }
+
+        int index = imagesInOrder.size();
+        imageIndices[uri] = index;
+        imagesInOrder.push_back(image.get());
+        urisInOrder.push_back(uri);
+        return index;
+    };
 
     // Load all referenced images in the catalog, and assign each a unique index.
     for(SplatClassMap::iterator i = _classes.begin(); i != _classes.end(); ++i)
@@ -287,76 +415,20 @@ SplatCatalog::createSplatTextureDef(const osgDB::Options* dbOptions,
             // Load the main image and assign it an index:
             if (range->_imageURI.isSet())
             {
-                int texIndex = -1;
-                ImageIndexTable::iterator k = imageIndices.find(range->_imageURI.get());
-                if ( k == imageIndices.end() )
-                {
-                    osg::ref_ptr<osg::Image> image = loadImage( range->_imageURI.get(), dbOptions, firstImage );
-                    if ( image.valid() )
-                    {
-                        if ( !firstImage )
-                            firstImage = image.get();
-
-                        imageIndices[range->_imageURI.get()] = texIndex = index++;
-                        imagesInOrder.push_back( image.get() );
-                    }
-                }
-                else
-                {
-                    texIndex = k->second;
-                }
-                range->_diffuseTextureIndex = texIndex;
+                range->_diffuseTextureIndex = getTextureIndex(range->_imageURI.get());
             }
 
-#if 1
             // Load the material texture(s) and assign to an index:
             if (range->_normalURI.isSet())
             {
-                int texIndex = -1;
-                ImageIndexTable::iterator k = imageIndices.find(range->_normalURI.get());
-                if ( k == imageIndices.end() )
-                {
-                    osg::ref_ptr<osg::Image> image = loadImage( range->_normalURI.get(), dbOptions, firstImage );
-                    if ( image.valid() )
-                    {
-                        if ( !firstImage )
-                            firstImage = image.get();
-
-                        imageIndices[range->_normalURI.get()] = texIndex = index++;
-                        imagesInOrder.push_back( image.get() );
-                    }
-                }
-                else
-                {
-                    texIndex = k->second;
-                }
-                range->_materialTextureIndex = texIndex;
+                range->_materialTextureIndex = getTextureIndex(range->_normalURI.get());
             }
-#endif
 
             // Load the detail texture if it exists:
             if (range->_detail.isSet() &&
                 range->_detail->_imageURI.isSet())
             {
-                int texIndex = -1;
-                ImageIndexTable::iterator k = imageIndices.find(range->_detail->_imageURI.get());
-                if ( k == imageIndices.end() )
-                {
-                    osg::ref_ptr<osg::Image> image = loadImage( range->_detail->_imageURI.get(), dbOptions, firstImage );
-                    if ( image.valid() )
-                    {
-                        if ( !firstImage )
-                            firstImage = image.get();
-            
-                        imageIndices[range->_detail->_imageURI.get()] = texIndex = index++;
-                        imagesInOrder.push_back( image.get() );
-                    }
-                }
-                else
-                {
-                    texIndex = k->second;
-                }
-                range->_detail->_textureIndex = texIndex;
+                range->_detail->_textureIndex = getTextureIndex(range->_detail->_imageURI.get());
             }
         }
     }
@@ -369,10 +441,12 @@ SplatCatalog::createSplatTextureDef(const osgDB::Options* dbOptions,
     }
 
     // Create the texture array.
-    if ( imagesInOrder.size() > 0 && firstImage )
+    if ( imagesInOrder.size() > 0 && firstImage.valid() )
     {
+        const osg::Image* layer0 = imagesInOrder.front().get();
+
         out._texture = new osg::Texture2DArray();
-        out._texture->setTextureSize( firstImage->s(), firstImage->t(), imagesInOrder.size() );
+        out._texture->setTextureSize( layer0->s(), layer0->t(), imagesInOrder.size() );
         out._texture->setWrap( osg::Texture::WRAP_S, osg::Texture::REPEAT );
         out._texture->setWrap( osg::Texture::WRAP_T, osg::Texture::REPEAT );
         out._texture->setFilter( osg::Texture::MIN_FILTER, osg::Texture::LINEAR_MIPMAP_LINEAR );
@@ -389,8 +463,21 @@ SplatCatalog::createSplatTextureDef(const osgDB::Options* dbOptions,
         //ImageUtils::generateMipmaps(out._texture.get());
         out._texture->setUseHardwareMipMapGeneration(true);
 
+        if (streaming)
+        {
+            // don't hold on to a full-resolution image just for its format
+            osg::ref_ptr<osg::Image> prototype = describe(firstImage->s(), firstImage->t(), firstImage.get());
+
+            out._residency = new SplatTextureResidency(
+                urisInOrder,
+                prototype.get(),
+                osg::minimum(maxResidentTextures, (unsigned)imagesInOrder.size()),
+                dbOptions);
+        }
+
         OE_INFO << LC << "Catalog \"" << this->name().get()
             << "\" texture size = "<< imagesInOrder.size()
+            << (streaming ? " (streamed)" : "")
             << std::endl;
     }
 
@@ -430,12 +517,165 @@ SplatCatalog::read(const URI&            uri,
 
 //...................................................................
 
+#undef  LC
+#define LC "[SplatTextureResidency] "
+
+SplatTextureResidency::SplatTextureResidency(
+    const std::vector<URI>& uris,
+    const osg::Image* prototype,
+    unsigned numSlots,
+    const osgDB::Options* readOptions) :
+
+    _uris(uris),
+    _prototype(prototype),
+    _readOptions(readOptions),
+    _requestCount(0u)
+{
+    _mutex.setName("oe.SplatTextureResidency");
+
+    numSlots = osg::minimum(numSlots, MAX_TEXTURES);
+    _slots.resize(numSlots);
+    _slotOfIndex.assign(_uris.size(), -1);
+
+    // Allocated empty; the layers fill in as textures arrive
+    _texture = new osg::Texture2DArray();
+    _texture->setTextureSize(prototype->s(), prototype->t(), numSlots);
+    _texture->setInternalFormat(prototype->getInternalTextureFormat());
+    _texture->setSourceFormat(prototype->getPixelFormat());
+    _texture->setSourceType(prototype->getDataType());
+    _texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+    _texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+    _texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR_MIPMAP_LINEAR);
+    _texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    _texture->setUseHardwareMipMapGeneration(true);
+
+    _slotUniform = new osg::Uniform(osg::Uniform::INT, "oe_splat_resident", MAX_TEXTURES);
+    for (unsigned i = 0; i < MAX_TEXTURES; ++i)
+        _slotUniform->setElement(i, -1);
+}
+
+SplatTextureResidency::~SplatTextureResidency()
+{
+    //nop
+}
+
+void
+SplatTextureResidency::request(const std::vector<int>& textureIndices)
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    ++_requestCount;
+
+    // Keep whatever is already resident (or on its way), and
+    // collect the rest, up to the number of slots
+    std::vector<int> missing;
+    unsigned count = 0;
+    for (unsigned i = 0; i < textureIndices.size() && count < _slots.size(); ++i)
+    {
+        int index = textureIndices[i];
+        if (index < 0 || index >= (int)_slotOfIndex.size())
+            continue;
+
+        ++count;
+        int slot = _slotOfIndex[index];
+        if (slot >= 0)
+            _slots[slot]._lastRequest = _requestCount;
+        else
+            missing.push_back(index);
+    }
+
+    for (unsigned i = 0; i < missing.size(); ++i)
+    {
+        // Evict the slot that was requested least recently,
+        // but never one this request asked for
+        int victim = -1;
+        for (unsigned s = 0; s < _slots.size(); ++s)
+        {
+            if (_slots[s]._lastRequest != _requestCount &&
+                (victim < 0 || _slots[s]._lastRequest < _slots[victim]._lastRequest))
+            {
+                victim = s;
+            }
+        }
+        if (victim < 0)
+            break;
+
+        Slot& slot = _slots[victim];
+        if (slot._index >= 0)
+        {
+            // back to the tail until the slot's new texture arrives
+            _slotOfIndex[slot._index] = -1;
+            _slotUniform->setElement(slot._index, -1);
+        }
+
+        int index = missing[i];
+        slot._index = index;
+        slot._loaded = false;
+        slot._lastRequest = _requestCount;
+        _slotOfIndex[index] = victim;
+
+        URI uri = _uris[index];
+        osg::ref_ptr<const osg::Image> prototype = _prototype;
+        osg::ref_ptr<const osgDB::Options> readOptions = _readOptions;
+
+        Threading::Job job(Threading::JobArena::get(ARENA_SPLAT_RESIDENCY));
+        job.setName(uri.base());
+
+        // replacing the future cancels the slot's previous load, if any
+        slot._pending = job.dispatch<osg::ref_ptr<osg::Image> >(
+            [uri, prototype, readOptions](Threading::Cancelable* progress)
+            {
+                osg::ref_ptr<osg::Image> image;
+                if (progress == nullptr || !progress->isCanceled())
+                    image = loadImage(uri, readOptions.get(), prototype.get());
+                return image;
+            }
+        );
+    }
+}
+
+void
+SplatTextureResidency::update()
+{
+    Threading::ScopedMutexLock lock(_mutex);
+
+    for (unsigned s = 0; s < _slots.size(); ++s)
+    {
+        Slot& slot = _slots[s];
+        if (slot._index < 0 || slot._loaded || !slot._pending.isAvailable())
+            continue;
+
+        osg::ref_ptr<osg::Image> image = slot._pending.get();
+        slot._pending.abandon();
+
+        // A texture that fails to load keeps its slot, so it isn't
+        // retried every request; the shader keeps using its tail.
+        slot._loaded = true;
+
+        if (image.valid())
+        {
+            _texture->setImage(s, image.get());
+
+            // setImage resets the layer's modified count; this makes
+            // the texture subload only this layer
+            image->dirty();
+
+            _slotUniform->setElement(slot._index, (int)s);
+        }
+    }
+}
+
+//...................................................................
+
 void
 SplatTextureDef::resizeGLObjectBuffers(unsigned maxSize)
 {
     if (_texture.valid())
         _texture->resizeGLObjectBuffers(maxSize);
 
+    if (_residency.valid())
+        _residency->getTexture()->resizeGLObjectBuffers(maxSize);
+
     if (_splatLUTBuffer.valid())
         _splatLUTBuffer->resizeGLObjectBuffers(maxSize);
 }
@@ -454,6 +694,15 @@ SplatTextureDef::releaseGLObjects(osg::State* state) const
                 _texture->getImage(i)->dirty();
     }
 
+    if (_residency.valid())
+    {
+        osg::Texture2DArray* resident = _residency->getTexture();
+        resident->releaseGLObjects(state);
+        for (unsigned i = 0; i < resident->getNumImages(); ++i)
+            if (resident->getImage(i))
+                resident->getImage(i)->dirty();
+    }
+
     if (_splatLUTBuffer.valid())
         _splatLUTBuffer->releaseGLObjects(state);
 }
@@ -24,9 +24,14 @@
 #include "NoiseTextureFactory"
 #include <osgEarth/VirtualProgram>
 #include <osgEarth/TerrainEngineNode>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/Map>
 #include <osgUtil/CullVisitor>
 #include <osg/BlendFunc>
 #include <osg/Drawable>
+#include <algorithm>
+#include <map>
+#include <set>
 #include <cstdlib> // getenv
 
 #define LC "[SplatLayer] " << getName() << ": "
@@ -34,6 +39,12 @@
 #define SPLAT_SAMPLER    "oe_splatTex"
 #define NOISE_SAMPLER    "oe_splat_noiseTex"
 #define LUT_SAMPLER      "oe_splat_coverageLUT"
+#define RESIDENT_SAMPLER "oe_splatTexResident"
+
+#define ARENA_SPLAT_RESIDENCY "oe.splat.residency"
+
+// LOD of the land cover tiles read to decide which textures are resident
+#define RESIDENCY_LOD 12u
 
 using namespace osgEarth::Splat;
 
@@ -48,6 +59,7 @@ SplatLayer::Options::getConfig() const
 {
     Config conf = VisibleLayer::Options::getConfig();
     conf.set("land_cover_layer", landCoverLayer() );
+    conf.set("max_resident_textures", maxResidentTextures() );
 
     Config zones("zones");
     for (int i = 0; i < _zones.size(); ++i) {
@@ -63,7 +75,10 @@ SplatLayer::Options::getConfig() const
 void
 SplatLayer::Options::fromConfig(const Config& conf)
 {
+    maxResidentTextures().setDefault(0u);
+
     conf.get("land_cover_layer", landCoverLayer() );
+    conf.get("max_resident_textures", maxResidentTextures() );
 
     const Config* zones = conf.child_ptr("zones");
     if (zones) {
@@ -99,12 +114,19 @@ SplatLayer::ZoneSelector::operator()(osg::Node* node, osg::NodeVisitor* nv) cons
             int zoneIndex = 0;
             osg::Vec3d vp = cv->getViewPoint();
 
-            for(int z=_layer->_zones.size()-1; z > 0 && zoneIndex == 0; --z)
+            if (_layer->_zones.size() > 1)
             {
-                if ( _layer->_zones[z]->contains(vp) )
-                {
-                    zoneIndex = z;
-                }
+                // the grid narrows the search to the zones near the camera
+                GeoPoint p;
+                p.fromWorld(SpatialReference::get("wgs84"), vp);
+                const Zones& zones = _layer->_zones;
+                zoneIndex = _layer->_zoneGrid.find(p.x(), p.y(),
+                    [&zones, &vp](int z) { return zones[z]->contains(vp); });
+            }
+
+            if (_layer->getMaxResidentTextures() > 0u)
+            {
+                _layer->updateResidency(vp, zoneIndex);
             }
 
             osg::StateSet* zoneStateSet = 0L;
@@ -140,6 +162,8 @@ SplatLayer::init()
     VisibleLayer::init();
 
     _zonesConfigured = false;
+    _residencyZone = -1;
+    _residencyMutex.setName("oe.SplatLayer.residency");
 
     _editMode = (::getenv("OSGEARTH_SPLAT_EDIT") != 0L); // TODO deprecate
     _gpuNoise = (::getenv("OSGEARTH_SPLAT_GPU_NOISE") != 0L); // TODO deprecate
@@ -174,21 +198,43 @@ SplatLayer::setLandCoverLayer(LandCoverLayer* layer)
     }
 }
 
+void
+SplatLayer::setMaxResidentTextures(unsigned value)
+{
+    options().maxResidentTextures() = value;
+}
+
+unsigned
+SplatLayer::getMaxResidentTextures() const
+{
+    return options().maxResidentTextures().get();
+}
+
 void
 SplatLayer::addedToMap(const Map* map)
 {
     VisibleLayer::addedToMap(map);
 
+    _mapProfile = map->getProfile();
+
     if (!getLandCoverDictionary())
         setLandCoverDictionary(map->getLayer<LandCoverDictionary>());
 
     if (!getLandCoverLayer())
         setLandCoverLayer(map->getLayer<LandCoverLayer>());
 
-    for (Zones::iterator zone = _zones.begin(); zone != _zones.end(); ++zone)
+    _zoneGrid.clear();
+    for (unsigned z = 0; z < _zones.size(); ++z)
     {
-        zone->get()->configure(map, getReadOptions());
+        Zone* zone = _zones[z].get();
+        zone->configure(map, getReadOptions());
+
+        for (unsigned b = 0; b < zone->getBoundaries().size(); ++b)
+        {
+            _zoneGrid.addBoundary(z, zone->getBoundaries()[b].extent);
+        }
     }
+    _zoneGrid.build();
 
     _zonesConfigured = true;
     
@@ -236,6 +282,14 @@ SplatLayer::prepareForRendering(TerrainEngine* engine)
             }
         }
 
+        if (getMaxResidentTextures() > 0u && _residentBinding.valid() == false)
+        {
+            if (res->reserveTextureImageUnitForLayer(_residentBinding, this, "Splat resident texture") == false)
+            {
+                OE_WARN << LC << "No texture unit available for resident splat textures; streaming disabled\n";
+            }
+        }
+
         if (_splatBinding.valid() && _lutBinding.valid())
         {
             buildStateSets();
@@ -267,6 +321,9 @@ SplatLayer::buildStateSets()
     //    return;
     //}
 
+    // Stream the textures only if there's a unit for the resident ones
+    unsigned maxResidentTextures = _residentBinding.valid() ? getMaxResidentTextures() : 0u;
+
     // Load all the splatting textures
     for (Zones::iterator z = _zones.begin(); z != _zones.end(); ++z)
     {
@@ -277,7 +334,7 @@ SplatLayer::buildStateSets()
             OE_WARN << LC << "No surface defined for zone " << zone->getName() << std::endl;
             return;
         }
-        if (surface->loadTextures(getLandCoverDictionary(), getReadOptions()) == false)
+        if (surface->loadTextures(getLandCoverDictionary(), getReadOptions(), maxResidentTextures) == false)
         {
             OE_WARN << LC << "Texture load failed for zone " << zone->getName() << "\n";
             return;
@@ -301,6 +358,13 @@ SplatLayer::buildStateSets()
         // apply the buffer containing the coverage-to-splat LUT:
         zoneStateset->setTextureAttribute(_lutBinding.unit(), texdef._splatLUTBuffer.get());
 
+        // full-resolution textures, when streaming:
+        if (texdef._residency.valid())
+        {
+            zoneStateset->setTextureAttribute(_residentBinding.unit(), texdef._residency->getTexture());
+            zoneStateset->addUniform(texdef._residency->getSlotUniform());
+        }
+
         OE_DEBUG << LC << "Installed getRenderInfo for zone \"" << zone->getName() << "\" (uid=" << zone->getUID() << ")\n";
     }
 
@@ -312,6 +376,16 @@ SplatLayer::buildStateSets()
 
     // install the uniform for the splat LUT.
     stateset->addUniform(new osg::Uniform(LUT_SAMPLER, _lutBinding.unit()));
+
+    if (maxResidentTextures > 0u)
+    {
+        stateset->addUniform(new osg::Uniform(RESIDENT_SAMPLER, _residentBinding.unit()));
+        stateset->setDefine("OE_SPLAT_RESIDENCY");
+    }
+    else
+    {
+        stateset->removeDefine("OE_SPLAT_RESIDENCY");
+    }
         
     if (_noiseBinding.valid())
     {
@@ -345,6 +419,124 @@ SplatLayer::buildStateSets()
     OE_DEBUG << LC << "Statesets built!! Ready!\n";
 }
 
+void
+SplatLayer::updateResidency(const osg::Vec3d& viewPoint, int zoneIndex)
+{
+    Surface* surface = _zones[zoneIndex]->getSurface();
+    SplatTextureResidency* residency = surface ? surface->getTextureDef()._residency.get() : 0L;
+    if (!residency || !_mapProfile.valid() || !getLandCoverLayer() || !getLandCoverDictionary())
+        return;
+
+    GeoPoint point;
+    if (!point.fromWorld(_mapProfile->getSRS(), viewPoint))
+        return;
+
+    TileKey key = _mapProfile->createTileKey(point.x(), point.y(), RESIDENCY_LOD);
+    if (!key.valid())
+        return;
+
+    Threading::ScopedMutexLock lock(_residencyMutex);
+
+    // Runs for every camera, every frame; only rescan on a new tile.
+    if (key == _residencyKey && zoneIndex == _residencyZone)
+        return;
+
+    _residencyKey = key;
+    _residencyZone = zoneIndex;
+
+    osg::ref_ptr<LandCoverLayer> landCover = getLandCoverLayer();
+    osg::ref_ptr<LandCoverDictionary> dictionary = getLandCoverDictionary();
+    osg::ref_ptr<Surface> surfaceRef = surface;
+
+    Threading::Job job(Threading::JobArena::get(ARENA_SPLAT_RESIDENCY));
+    job.setName("oe.splat.scan");
+
+    // replacing the future cancels the previous scan, if it's still going
+    _residencyScan = job.dispatch<bool>(
+        [key, landCover, dictionary, surfaceRef](Threading::Cancelable* progress)
+        {
+            // Count the land cover classes in the camera's tile and its neighbors
+            typedef std::map<int, unsigned> Counts;
+            Counts counts;
+            osg::Vec4f pixel;
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    if (progress && progress->isCanceled())
+                        return false;
+
+                    GeoImage tile = landCover->createImage(key.createNeighborKey(dx, dy), 0L);
+                    if (!tile.valid())
+                        continue;
+
+                    ImageUtils::PixelReader read(tile.getImage());
+                    for (int t = 0; t < tile.getImage()->t(); ++t)
+                    {
+                        for (int s = 0; s < tile.getImage()->s(); ++s)
+                        {
+                            read(pixel, s, t);
+                            ++counts[(int)pixel.r()];
+                        }
+                    }
+                }
+            }
+
+            // most common classes first
+            std::vector<std::pair<unsigned, int> > classes;
+            for (Counts::const_iterator i = counts.begin(); i != counts.end(); ++i)
+                classes.push_back(std::make_pair(i->second, i->first));
+            std::sort(classes.rbegin(), classes.rend());
+
+            // Textures those classes use. The ranges go from far to near,
+            // so ask for the near ones first.
+            const SplatTextureDef& texdef = surfaceRef->getTextureDef();
+            std::vector<int> indices;
+            std::set<int> seen;
+            for (unsigned c = 0; c < classes.size(); ++c)
+            {
+                const LandCoverClass* lcClass = dictionary->getClassByValue(classes[c].second);
+                if (!lcClass)
+                    continue;
+
+                SplatLUT::const_iterator k = texdef._splatLUT.find(lcClass->getName());
+                if (k == texdef._splatLUT.end())
+                    continue;
+
+                const SplatRangeDataVector& ranges = k->second;
+                for (SplatRangeDataVector::const_reverse_iterator r = ranges.rbegin(); r != ranges.rend(); ++r)
+                {
+                    int textures[3] = {
+                        r->_diffuseTextureIndex,
+                        r->_materialTextureIndex,
+                        r->_detail.isSet() ? r->_detail->_textureIndex : -1 };
+
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        if (textures[i] >= 0 && seen.insert(textures[i]).second)
+                            indices.push_back(textures[i]);
+                    }
+                }
+            }
+
+            texdef._residency->request(indices);
+            return true;
+        }
+    );
+}
+
+void
+SplatLayer::update(osg::NodeVisitor& nv)
+{
+    for (Zones::const_iterator z = _zones.begin(); z != _zones.end(); ++z)
+    {
+        Surface* surface = z->get()->getSurface();
+        if (surface && surface->getTextureDef()._residency.valid())
+        {
+            surface->getTextureDef()._residency->update();
+        }
+    }
+}
 
 void
 SplatLayer::resizeGLObjectBuffers(unsigned maxSize)
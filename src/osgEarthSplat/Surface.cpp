@@ -66,14 +66,14 @@ Surface::getOrCreateStateSet()
 }
 
 bool
-Surface::loadTextures(const LandCoverDictionary* landCoverDict, const osgDB::Options* dbo)
+Surface::loadTextures(const LandCoverDictionary* landCoverDict, const osgDB::Options* dbo, unsigned maxResidentTextures)
 {
     int numValidTextures = 0;
 
     if ( landCoverDict == 0L || !_catalog.valid() )
         return false;
 
-    if ( _catalog->createSplatTextureDef(dbo, _textureDef) )
+    if ( _catalog->createSplatTextureDef(dbo, _textureDef, maxResidentTextures) )
     {
         _textureDef._splatLUTBuffer = createLUTBuffer(landCoverDict);
     }
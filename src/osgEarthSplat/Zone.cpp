@@ -56,6 +56,7 @@ Zone::configure(const Map* map, const osgDB::Options* readOptions)
             osg::clampBetween(static_cast<float>(box.xMax()), -180.0f, 180.0f),
             osg::clampBetween(static_cast<float>(box.yMax()),  -90.0f,  90.0f));
 
+        b.extent = extent;
         extent.createPolytope( b.tope );
         b.zmin2 = box.zMin() > -FLT_MAX ? box.zMin()*box.zMin() : box.zMin();
         b.zmax2 = box.zMax() <  FLT_MAX ? box.zMax()*box.zMax() : box.zMax();
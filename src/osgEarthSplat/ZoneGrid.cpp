@@ -0,0 +1,144 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+ * Copyright 2020 Pelican Mapping
+ * http://osgearth.org
+ *
+ * osgEarth is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "ZoneGrid"
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#define LC "[ZoneGrid] "
+
+using namespace osgEarth;
+using namespace osgEarth::Splat;
+
+bool
+ZoneGrid::Entry::operator < (const Entry& rhs) const
+{
+    // by cell, then by zone from highest to lowest
+    if (_cell != rhs._cell) return _cell < rhs._cell;
+    return _zone > rhs._zone;
+}
+
+ZoneGrid::ZoneGrid(double cellSize) :
+    _cellSize(osg::clampBetween(cellSize, 0.01, 90.0))
+{
+    _cols = (int)ceil(360.0 / _cellSize);
+    _rows = (int)ceil(180.0 / _cellSize);
+}
+
+void
+ZoneGrid::clear()
+{
+    _entries.clear();
+    _offsets.clear();
+    _zones.clear();
+    _global.clear();
+}
+
+int
+ZoneGrid::getCell(double lon, double lat) const
+{
+    int col = osg::clampBetween((int)floor((lon + 180.0) / _cellSize), 0, _cols - 1);
+    int row = osg::clampBetween((int)floor((lat + 90.0) / _cellSize), 0, _rows - 1);
+    return row * _cols + col;
+}
+
+void
+ZoneGrid::addCells(int zoneIndex, double west, double south, double east, double north)
+{
+    int c0 = getCell(west, south);
+    int c1 = getCell(east, north);
+    int col0 = c0 % _cols, row0 = c0 / _cols;
+    int col1 = c1 % _cols, row1 = c1 / _cols;
+
+    for (int row = row0; row <= row1; ++row)
+    {
+        for (int col = col0; col <= col1; ++col)
+        {
+            Entry e;
+            e._cell = row * _cols + col;
+            e._zone = zoneIndex;
+            _entries.push_back(e);
+        }
+    }
+}
+
+void
+ZoneGrid::addBoundary(int zoneIndex, const GeoExtent& input)
+{
+    if (!input.isValid() || input.isWholeEarth())
+    {
+        _global.push_back(zoneIndex);
+        return;
+    }
+
+    GeoExtent extent = input;
+    const SpatialReference* wgs84 = SpatialReference::get("wgs84");
+    if (!extent.getSRS()->isHorizEquivalentTo(wgs84))
+    {
+        extent = extent.transform(wgs84);
+        if (!extent.isValid())
+        {
+            // can't place it, so test it everywhere
+            _global.push_back(zoneIndex);
+            return;
+        }
+    }
+
+    GeoExtent first, second;
+    if (extent.crossesAntimeridian() && extent.splitAcrossAntimeridian(first, second))
+    {
+        addCells(zoneIndex, first.west(), first.south(), first.east(), first.north());
+        addCells(zoneIndex, second.west(), second.south(), second.east(), second.north());
+    }
+    else
+    {
+        addCells(zoneIndex, extent.west(), extent.south(), extent.east(), extent.north());
+    }
+}
+
+void
+ZoneGrid::build()
+{
+    std::sort(_entries.begin(), _entries.end());
+    _entries.erase(
+        std::unique(_entries.begin(), _entries.end(),
+            [](const Entry& a, const Entry& b) { return a._cell == b._cell && a._zone == b._zone; }),
+        _entries.end());
+
+    std::sort(_global.begin(), _global.end(), std::greater<int>());
+    _global.erase(std::unique(_global.begin(), _global.end()), _global.end());
+
+    int numCells = _cols * _rows;
+    _offsets.assign(numCells + 1, 0u);
+    _zones.resize(_entries.size());
+
+    // count zones per cell, then turn the counts into offsets
+    for (unsigned i = 0; i < _entries.size(); ++i)
+        ++_offsets[_entries[i]._cell + 1];
+
+    for (int c = 0; c < numCells; ++c)
+        _offsets[c + 1] += _offsets[c];
+
+    // entries are sorted by cell, so their zones are already in place order
+    for (unsigned i = 0; i < _entries.size(); ++i)
+        _zones[i] = _entries[i]._zone;
+
+    OE_DEBUG << LC << "Indexed " << _entries.size() << " cells, "
+        << _global.size() << " global zones" << std::endl;
+}
@@ -0,0 +1,113 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef OSGEARTH_BENCHMARK_H
+#define OSGEARTH_BENCHMARK_H 1
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal benchmark harness.
+ *
+ * A benchmark file declares cases with OE_BENCHMARK. Each case sets up its
+ * data and then calls Runner::measure() once per operation it times. The
+ * runner repeats the operation in samples long enough to time reliably,
+ * and reports the per-operation time of each measurement.
+ *
+ *   OE_BENCHMARK("Thing")
+ *   {
+ *       Thing thing;
+ *       runner.measure("Thing/doIt", [&]() { thing.doIt(); });
+ *   }
+ */
+namespace osgEarth { namespace Benchmark
+{
+    //! Per-operation timing of one measurement, in nanoseconds
+    struct Result
+    {
+        std::string name;
+        unsigned long long iterations; // per sample
+        unsigned samples;
+        double minNs, medianNs, meanNs, maxNs;
+        double itemsPerOp;             // 0 unless the case reports throughput
+    };
+
+    class Runner
+    {
+    public:
+        Runner(unsigned samples, double minSampleSeconds, const std::string& filter);
+
+        //! Times an operation. itemsPerOp is the number of items (points,
+        //! pixels, jobs...) one call processes, for throughput reporting.
+        void measure(
+            const std::string& name,
+            const std::function<void()>& op,
+            double itemsPerOp = 0.0);
+
+        //! Records that a measurement couldn't run (e.g. a missing driver)
+        void skip(const std::string& name, const std::string& reason);
+
+        //! Whether the filter selects a measurement
+        bool selected(const std::string& name) const;
+
+        const std::vector<Result>& results() const { return _results; }
+
+    private:
+        unsigned _samples;
+        double _minSampleSeconds;
+        std::string _filter;
+        std::vector<Result> _results;
+    };
+
+    //! Registers a benchmark case at static init time
+    struct Registrar
+    {
+        Registrar(const char* name, void(*func)(Runner&));
+    };
+
+    struct Case
+    {
+        const char* name;
+        void(*func)(Runner&);
+    };
+
+    std::vector<Case>& cases();
+
+    //! Keeps the compiler from optimizing away a result
+    template<typename T>
+    inline void doNotOptimize(const T& value)
+    {
+        static volatile const void* sink;
+        sink = &value;
+    }
+} }
+
+#define OE_BENCHMARK_CAT2(A, B) A ## B
+#define OE_BENCHMARK_CAT(A, B) OE_BENCHMARK_CAT2(A, B)
+
+#define OE_BENCHMARK(NAME) \
+    static void OE_BENCHMARK_CAT(oe_benchmark_, __LINE__)(osgEarth::Benchmark::Runner& runner); \
+    static osgEarth::Benchmark::Registrar OE_BENCHMARK_CAT(oe_benchmark_reg_, __LINE__)(NAME, &OE_BENCHMARK_CAT(oe_benchmark_, __LINE__)); \
+    static void OE_BENCHMARK_CAT(oe_benchmark_, __LINE__)(osgEarth::Benchmark::Runner& runner)
+
+#endif // OSGEARTH_BENCHMARK_H
@@ -0,0 +1,125 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmark.h"
+#include <osgEarth/Cache>
+#include <osgEarth/CacheBin>
+#include <osgEarth/MemCache>
+#include <osgEarth/FileUtils>
+#include <osgEarth/StringUtils>
+#include <osgDB/FileUtils>
+#include <osg/Image>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    void measureBin(Benchmark::Runner& runner, const std::string& driver, Cache* cache)
+    {
+        osg::ref_ptr<CacheBin> bin = cache->addBin("benchmark");
+        if (!bin.valid())
+        {
+            runner.skip("CacheBin/" + driver, "failed to open bin");
+            return;
+        }
+
+        osg::ref_ptr<osg::Image> image = new osg::Image();
+        image->allocateImage(256, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for (unsigned i = 0; i < image->getTotalSizeInBytes(); ++i)
+            image->data()[i] = (unsigned char)(i * 31u);
+
+        osg::ref_ptr<StringObject> str = new StringObject(std::string(4096, 'x'));
+
+        const unsigned numKeys = 256u;
+        std::vector<std::string> stringKeys, imageKeys, missingKeys;
+        for (unsigned i = 0; i < numKeys; ++i)
+        {
+            stringKeys.push_back(Stringify() << "s" << i);
+            imageKeys.push_back(Stringify() << "i" << i);
+            missingKeys.push_back(Stringify() << "missing" << i);
+        }
+        unsigned k = 0u;
+
+        runner.measure("CacheBin/" + driver + "/write/string-4k", [&]() {
+            bin->write(stringKeys[k++ % numKeys], str.get(), nullptr);
+        });
+
+        // every key present, however many writes the timing took
+        for (auto& key : stringKeys)
+            bin->write(key, str.get(), nullptr);
+
+        runner.measure("CacheBin/" + driver + "/read/string-4k", [&]() {
+            ReadResult r = bin->readString(stringKeys[k++ % numKeys], nullptr);
+            Benchmark::doNotOptimize(r);
+        });
+
+        runner.measure("CacheBin/" + driver + "/write/image-256", [&]() {
+            bin->write(imageKeys[k++ % numKeys], image.get(), nullptr);
+        });
+
+        for (auto& key : imageKeys)
+            bin->write(key, image.get(), nullptr);
+
+        runner.measure("CacheBin/" + driver + "/read/image-256", [&]() {
+            ReadResult r = bin->readImage(imageKeys[k++ % numKeys], nullptr);
+            Benchmark::doNotOptimize(r);
+        });
+
+        runner.measure("CacheBin/" + driver + "/read/miss", [&]() {
+            ReadResult r = bin->readString(missingKeys[k++ % numKeys], nullptr);
+            Benchmark::doNotOptimize(r);
+        });
+
+        bin->clear();
+    }
+}
+
+OE_BENCHMARK("CacheBin")
+{
+    if (!runner.selected("CacheBin/"))
+        return;
+
+    osg::ref_ptr<Cache> memCache = new MemCache(1024u);
+    measureBin(runner, "memory", memCache.get());
+
+    // the plugin drivers, each in a scratch folder
+    const char* drivers[] = { "filesystem", "leveldb", "rocksdb" };
+    for (const char* driver : drivers)
+    {
+        if (!runner.selected(std::string("CacheBin/") + driver))
+            continue;
+
+        std::string path = osgDB::concatPaths(getTempPath(), Stringify() << "osgearth_benchmark_cache_" << driver);
+        osgDB::makeDirectory(path);
+
+        Config conf;
+        conf.set("driver", driver);
+        conf.set("path", path);
+        osg::ref_ptr<Cache> cache = CacheFactory::create(CacheOptions(ConfigOptions(conf)));
+
+        if (cache.valid() && cache->getStatus().isOK())
+            measureBin(runner, driver, cache.get());
+        else
+            runner.skip(std::string("CacheBin/") + driver, "driver unavailable");
+    }
+}
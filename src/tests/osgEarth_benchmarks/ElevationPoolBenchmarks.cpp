@@ -0,0 +1,117 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmark.h"
+#include <osgEarth/ElevationPool>
+#include <osgEarth/ElevationLayer>
+#include <osgEarth/Map>
+#include <osgEarth/Threading>
+#include <osg/Shape>
+
+using namespace osgEarth;
+
+namespace
+{
+    // Procedural heights, so that sampling cost isn't hidden behind I/O
+    class SyntheticElevationLayer : public ElevationLayer
+    {
+    public:
+        META_Layer(osgEarth, SyntheticElevationLayer, ElevationLayer::Options, ElevationLayer, SyntheticElevation);
+
+    protected:
+        void init() override
+        {
+            ElevationLayer::init();
+            setProfile(Profile::create("global-geodetic"));
+        }
+
+        GeoHeightField createHeightFieldImplementation(const TileKey& key, ProgressCallback*) const override
+        {
+            const unsigned size = 257u;
+            const GeoExtent& e = key.getExtent();
+            osg::ref_ptr<osg::HeightField> hf = new osg::HeightField();
+            hf->allocate(size, size);
+            for (unsigned r = 0; r < size; ++r)
+            {
+                double y = e.yMin() + e.height() * (double)r / (double)(size - 1u);
+                for (unsigned c = 0; c < size; ++c)
+                {
+                    double x = e.xMin() + e.width() * (double)c / (double)(size - 1u);
+                    hf->setHeight(c, r, (float)(1000.0 * sin(osg::DegreesToRadians(x * 7.0)) * cos(osg::DegreesToRadians(y * 5.0))));
+                }
+            }
+            return GeoHeightField(hf.get(), e);
+        }
+    };
+
+    std::vector<osg::Vec4d> makePoints(unsigned count, double resolution)
+    {
+        // clustered, the way a feature or a camera path would sample
+        std::vector<osg::Vec4d> points(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            points[i].set(
+                -122.0 + 0.5 * (double)(i % 101) / 101.0,
+                37.0 + 0.5 * (double)((i / 101) % 103) / 103.0,
+                0.0,
+                resolution);
+        }
+        return points;
+    }
+}
+
+OE_BENCHMARK("ElevationPool::sampleMapCoords")
+{
+    if (!runner.selected("ElevationPool::sampleMapCoords"))
+        return;
+
+    osg::ref_ptr<Map> map = new Map();
+    osg::ref_ptr<SyntheticElevationLayer> layer = new SyntheticElevationLayer();
+    map->addLayer(layer.get());
+    if (layer->open().isError())
+    {
+        runner.skip("ElevationPool::sampleMapCoords", layer->getStatus().message());
+        return;
+    }
+
+    ElevationPool* pool = map->getElevationPool();
+    const unsigned count = 10000u;
+    const std::vector<osg::Vec4d> source = makePoints(count, 0.0001);
+    std::vector<osg::Vec4d> points;
+
+    // the working set holds the tiles, so this is the steady-state cost
+    ElevationPool::WorkingSet ws;
+    runner.measure("ElevationPool::sampleMapCoords/10k/working-set", [&]() {
+        points = source;
+        pool->sampleMapCoords(points, &ws, nullptr);
+    }, count);
+
+    runner.measure("ElevationPool::sampleMapCoords/10k/working-set/arena", [&]() {
+        points = source;
+        pool->sampleMapCoords(points, &ws, nullptr, Threading::JobArena::get("oe.benchmark.elevation"));
+    }, count);
+
+    runner.measure("ElevationPool::sampleMapCoords/10k/no-working-set", [&]() {
+        points = source;
+        pool->sampleMapCoords(points, nullptr, nullptr);
+    }, count);
+}
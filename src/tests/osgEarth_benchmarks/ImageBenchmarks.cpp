@@ -0,0 +1,100 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmark.h"
+#include <osgEarth/GeoData>
+#include <osgEarth/ImageUtils>
+#include <osgEarth/Profile>
+#include <osgEarth/TileKey>
+
+using namespace osgEarth;
+
+namespace
+{
+    osg::Image* makeImage(unsigned size)
+    {
+        osg::Image* image = new osg::Image();
+        image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        unsigned char* p = image->data();
+        for (unsigned t = 0; t < size; ++t)
+        {
+            for (unsigned s = 0; s < size; ++s, p += 4)
+            {
+                p[0] = (unsigned char)(s ^ t);
+                p[1] = (unsigned char)(s * 3u);
+                p[2] = (unsigned char)(t * 5u);
+                p[3] = 255u;
+            }
+        }
+        return image;
+    }
+}
+
+OE_BENCHMARK("ImageUtils::resizeImage")
+{
+    osg::ref_ptr<osg::Image> image = makeImage(256u);
+    osg::ref_ptr<osg::Image> output;
+
+    runner.measure("ImageUtils::resizeImage/256->128/bilinear", [&]() {
+        output = NULL;
+        ImageUtils::resizeImage(image.get(), 128u, 128u, output, 0u, true);
+    }, 128.0 * 128.0);
+
+    runner.measure("ImageUtils::resizeImage/256->512/bilinear", [&]() {
+        output = NULL;
+        ImageUtils::resizeImage(image.get(), 512u, 512u, output, 0u, true);
+    }, 512.0 * 512.0);
+
+    runner.measure("ImageUtils::resizeImage/256->512/nearest", [&]() {
+        output = NULL;
+        ImageUtils::resizeImage(image.get(), 512u, 512u, output, 0u, false);
+    }, 512.0 * 512.0);
+}
+
+OE_BENCHMARK("GeoImage::reproject")
+{
+    osg::ref_ptr<const Profile> geodetic = Profile::create("global-geodetic");
+    osg::ref_ptr<const Profile> mercator = Profile::create("spherical-mercator");
+
+    // a level 4 geodetic tile, reprojected into the mercator tile covering it
+    TileKey key(4u, 10u, 4u, geodetic.get());
+    GeoImage source(makeImage(256u), key.getExtent());
+
+    std::vector<TileKey> intersecting;
+    mercator->getIntersectingTiles(key, intersecting);
+    if (intersecting.empty())
+    {
+        runner.skip("GeoImage::reproject", "no intersecting mercator tile");
+        return;
+    }
+    GeoExtent target = intersecting.front().getExtent();
+
+    runner.measure("GeoImage::reproject/geodetic->mercator/256/bilinear", [&]() {
+        GeoImage out = source.reproject(mercator->getSRS(), &target, 256u, 256u, true);
+        Benchmark::doNotOptimize(out);
+    }, 256.0 * 256.0);
+
+    runner.measure("GeoImage::reproject/geodetic->mercator/256/nearest", [&]() {
+        GeoImage out = source.reproject(mercator->getSRS(), &target, 256u, 256u, false);
+        Benchmark::doNotOptimize(out);
+    }, 256.0 * 256.0);
+}
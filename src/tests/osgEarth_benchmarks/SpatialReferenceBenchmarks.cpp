@@ -0,0 +1,79 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmark.h"
+#include <osgEarth/SpatialReference>
+
+using namespace osgEarth;
+
+namespace
+{
+    std::vector<osg::Vec3d> makeGeodeticPoints(unsigned count)
+    {
+        std::vector<osg::Vec3d> points(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            points[i].set(-180.0 + 360.0 * (double)(i % 997) / 997.0, -80.0 + 160.0 * (double)(i % 991) / 991.0, 100.0);
+        }
+        return points;
+    }
+}
+
+OE_BENCHMARK("SpatialReference::transform")
+{
+    const unsigned count = 10000u;
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::get("wgs84");
+    osg::ref_ptr<const SpatialReference> mercator = SpatialReference::get("spherical-mercator");
+    osg::ref_ptr<const SpatialReference> ecef = wgs84->getGeocentricSRS();
+    osg::ref_ptr<const SpatialReference> utm = SpatialReference::get("+proj=utm +zone=17 +datum=WGS84");
+
+    const std::vector<osg::Vec3d> source = makeGeodeticPoints(count);
+    std::vector<osg::Vec3d> points;
+
+    runner.measure("SpatialReference::transform/single/wgs84->mercator", [&]() {
+        osg::Vec3d out;
+        wgs84->transform(source[0], mercator.get(), out);
+        Benchmark::doNotOptimize(out);
+    }, 1.0);
+
+    runner.measure("SpatialReference::transform/10k/wgs84->mercator", [&]() {
+        points = source;
+        wgs84->transform(points, mercator.get());
+    }, count);
+
+    runner.measure("SpatialReference::transform/10k/wgs84->ecef", [&]() {
+        points = source;
+        wgs84->transform(points, ecef.get());
+    }, count);
+
+    if (utm.valid())
+    {
+        runner.measure("SpatialReference::transform/10k/wgs84->utm", [&]() {
+            points = source;
+            wgs84->transform(points, utm.get());
+        }, count);
+    }
+    else
+    {
+        runner.skip("SpatialReference::transform/10k/wgs84->utm", "UTM SRS unavailable");
+    }
+}
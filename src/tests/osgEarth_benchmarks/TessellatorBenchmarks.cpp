@@ -0,0 +1,89 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmark.h"
+#include <osgEarth/Tessellator>
+#include <osgEarth/Geometry>
+#include <osgEarth/StringUtils>
+#include <cmath>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    // a star-shaped (concave) polygon with an optional hole
+    Polygon* makeStar(unsigned points, bool hole)
+    {
+        Polygon* poly = new Polygon();
+        for (unsigned i = 0; i < points; ++i)
+        {
+            double a = 2.0 * osg::PI * (double)i / (double)points;
+            double r = (i % 2u) ? 50.0 : 100.0;
+            poly->push_back(r * cos(a), r * sin(a));
+        }
+        if (hole)
+        {
+            Ring* ring = new Ring();
+            for (unsigned i = 0; i < 16u; ++i)
+            {
+                double a = -2.0 * osg::PI * (double)i / 16.0;
+                ring->push_back(20.0 * cos(a), 20.0 * sin(a));
+            }
+            poly->getHoles().push_back(ring);
+        }
+        return poly;
+    }
+}
+
+OE_BENCHMARK("Tessellator")
+{
+    Tessellator tess;
+    std::vector<uint32_t> indices;
+
+    for (unsigned n : { 16u, 256u, 4096u })
+    {
+        osg::ref_ptr<Polygon> star = makeStar(n, false);
+        runner.measure(Stringify() << "Tessellator::tessellate2D/star-" << n, [&]() {
+            indices.clear();
+            tess.tessellate2D(star.get(), indices);
+        }, n);
+    }
+
+    osg::ref_ptr<Polygon> holed = makeStar(256u, true);
+    runner.measure("Tessellator::tessellate2D/star-256-hole", [&]() {
+        indices.clear();
+        tess.tessellate2D(holed.get(), indices);
+    }, 256.0 + 16.0);
+
+    // the older geometry path used by the feature compilers
+    osg::ref_ptr<Polygon> star = makeStar(256u, false);
+    runner.measure("Tessellator::tessellateGeometry/star-256", [&]() {
+        osg::ref_ptr<osg::Geometry> geom = new osg::Geometry();
+        osg::Vec3Array* verts = new osg::Vec3Array();
+        for (auto& p : star->asVector())
+            verts->push_back(osg::Vec3(p));
+        geom->setVertexArray(verts);
+        geom->addPrimitiveSet(new osg::DrawArrays(GL_POLYGON, 0, verts->size()));
+        tess.tessellateGeometry(*geom);
+    }, 256.0);
+}
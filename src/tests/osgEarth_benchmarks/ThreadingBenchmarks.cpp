@@ -0,0 +1,75 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmark.h"
+#include <osgEarth/Threading>
+#include <atomic>
+
+using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+OE_BENCHMARK("JobArena")
+{
+    if (!runner.selected("JobArena/"))
+        return;
+
+    const unsigned count = 1000u;
+    std::atomic_int sink(0);
+
+    JobArena::setConcurrency("oe.benchmark.threadpool", 4u);
+    JobArena* pool = JobArena::get("oe.benchmark.threadpool");
+
+    JobArena::setType("oe.benchmark.workstealing", JobArena::WORK_STEALING);
+    JobArena::setConcurrency("oe.benchmark.workstealing", 4u);
+    JobArena* stealing = JobArena::get("oe.benchmark.workstealing");
+
+    // dispatch and completion overhead of empty jobs
+    for (JobArena* arena : { pool, stealing })
+    {
+        std::string type = arena == pool ? "thread-pool" : "work-stealing";
+
+        runner.measure("JobArena/" + type + "/dispatch+join/1k", [&]() {
+            JobGroup group;
+            Job job(arena, &group);
+            for (unsigned i = 0; i < count; ++i)
+                job.dispatch([&sink](Cancelable*) { sink++; });
+            group.join();
+        }, count);
+
+        runner.measure("JobArena/" + type + "/dispatch+future/1k", [&]() {
+            std::vector<Future<int>> futures;
+            futures.reserve(count);
+            Job job(arena);
+            for (unsigned i = 0; i < count; ++i)
+                futures.push_back(job.dispatch<int>([](Cancelable*) { return 1; }));
+            int total = 0;
+            for (auto& f : futures)
+                total += f.get();
+            Benchmark::doNotOptimize(total);
+        }, count);
+    }
+
+    // priority re-keying, as per-frame schedulers do
+    runner.measure("JobArena/advancePriorityEpoch", [&]() {
+        pool->advancePriorityEpoch();
+    });
+}
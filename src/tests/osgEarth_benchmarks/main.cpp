@@ -0,0 +1,250 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2020 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "Benchmark.h"
+#include <osgEarth/Common>
+#include <osgEarth/Registry>
+#include <osgEarth/Version>
+#include <osg/ArgumentParser>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace osgEarth;
+using namespace osgEarth::Benchmark;
+
+std::vector<Case>&
+osgEarth::Benchmark::cases()
+{
+    static std::vector<Case> s_cases;
+    return s_cases;
+}
+
+Registrar::Registrar(const char* name, void(*func)(Runner&))
+{
+    Case c = { name, func };
+    cases().push_back(c);
+}
+
+Runner::Runner(unsigned samples, double minSampleSeconds, const std::string& filter) :
+    _samples(std::max(samples, 1u)),
+    _minSampleSeconds(minSampleSeconds),
+    _filter(filter)
+{
+    //nop
+}
+
+bool
+Runner::selected(const std::string& name) const
+{
+    return _filter.empty() || name.find(_filter) != std::string::npos;
+}
+
+void
+Runner::measure(const std::string& name, const std::function<void()>& op, double itemsPerOp)
+{
+    if (!selected(name))
+        return;
+
+    using clock = std::chrono::steady_clock;
+
+    // warm up, then find an iteration count that makes a sample long enough
+    op();
+    unsigned long long iterations = 1u;
+    for (;;)
+    {
+        clock::time_point t0 = clock::now();
+        for (unsigned long long i = 0; i < iterations; ++i)
+            op();
+        double seconds = std::chrono::duration<double>(clock::now() - t0).count();
+        if (seconds >= _minSampleSeconds || iterations >= (1ull << 30))
+            break;
+        iterations = seconds > 0.0 ?
+            std::max(iterations * 2ull, (unsigned long long)(iterations * 1.2 * _minSampleSeconds / seconds)) :
+            iterations * 10ull;
+    }
+
+    std::vector<double> ns(_samples);
+    for (unsigned s = 0; s < _samples; ++s)
+    {
+        clock::time_point t0 = clock::now();
+        for (unsigned long long i = 0; i < iterations; ++i)
+            op();
+        ns[s] = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / (double)iterations;
+    }
+
+    std::sort(ns.begin(), ns.end());
+
+    Result r;
+    r.name = name;
+    r.iterations = iterations;
+    r.samples = _samples;
+    r.minNs = ns.front();
+    r.maxNs = ns.back();
+    r.medianNs = (_samples % 2u) ? ns[_samples / 2u] : 0.5 * (ns[_samples / 2u - 1u] + ns[_samples / 2u]);
+    double sum = 0.0;
+    for (double v : ns) sum += v;
+    r.meanNs = sum / (double)_samples;
+    r.itemsPerOp = itemsPerOp;
+    _results.push_back(r);
+
+    std::cerr << std::left << std::setw(48) << name << std::right
+        << std::setw(14) << std::fixed << std::setprecision(1) << r.medianNs << " ns/op";
+    if (itemsPerOp > 0.0)
+        std::cerr << std::setw(14) << std::setprecision(0) << (itemsPerOp * 1e9 / r.medianNs) << " items/s";
+    std::cerr << std::endl;
+}
+
+void
+Runner::skip(const std::string& name, const std::string& reason)
+{
+    if (selected(name))
+        std::cerr << std::left << std::setw(48) << name << " skipped: " << reason << std::endl;
+}
+
+namespace
+{
+    std::string escape(const std::string& s)
+    {
+        std::string r;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\') r.push_back('\\');
+            r.push_back(c);
+        }
+        return r;
+    }
+
+    void writeJSON(std::ostream& out, const std::vector<Result>& results)
+    {
+        out << std::setprecision(3) << std::fixed;
+        out << "{\n"
+            << "  \"osgearth_version\": \"" << osgEarthGetVersion() << "\",\n"
+            << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+            << "  \"results\": [";
+        for (unsigned i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            out << (i > 0 ? "," : "") << "\n    {"
+                << "\"name\": \"" << escape(r.name) << "\", "
+                << "\"iterations\": " << r.iterations << ", "
+                << "\"samples\": " << r.samples << ", "
+                << "\"min_ns\": " << r.minNs << ", "
+                << "\"median_ns\": " << r.medianNs << ", "
+                << "\"mean_ns\": " << r.meanNs << ", "
+                << "\"max_ns\": " << r.maxNs;
+            if (r.itemsPerOp > 0.0)
+                out << ", \"items_per_second\": " << (r.itemsPerOp * 1e9 / r.medianNs);
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    void writeCSV(std::ostream& out, const std::vector<Result>& results)
+    {
+        out << std::setprecision(3) << std::fixed;
+        out << "name,iterations,samples,min_ns,median_ns,mean_ns,max_ns,items_per_second\n";
+        for (auto& r : results)
+        {
+            out << r.name << ',' << r.iterations << ',' << r.samples << ','
+                << r.minNs << ',' << r.medianNs << ',' << r.meanNs << ',' << r.maxNs << ',';
+            if (r.itemsPerOp > 0.0)
+                out << (r.itemsPerOp * 1e9 / r.medianNs);
+            out << '\n';
+        }
+    }
+
+    int usage(const char* name)
+    {
+        std::cout
+            << "Usage: " << name << " [options]\n"
+            << "  --filter <text>     Only run measurements whose names contain <text>\n"
+            << "  --samples <n>       Samples per measurement (default 10)\n"
+            << "  --min-time <sec>    Minimum duration of one sample (default 0.05)\n"
+            << "  --json <file|->     Write results as JSON\n"
+            << "  --csv <file|->      Write results as CSV\n"
+            << "  --list              List the benchmark cases and exit\n"
+            << "Progress goes to stderr, so '-' writes clean results to stdout."
+            << std::endl;
+        return 0;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    osg::ArgumentParser args(&argc, argv);
+
+    if (args.read("--help") || args.read("-h"))
+        return usage(argv[0]);
+
+    std::string filter, json, csv;
+    unsigned samples = 10u;
+    double minTime = 0.05;
+    args.read("--filter", filter);
+    args.read("--samples", samples);
+    args.read("--min-time", minTime);
+    args.read("--json", json);
+    args.read("--csv", csv);
+
+    if (args.read("--list"))
+    {
+        for (auto& c : cases())
+            std::cout << c.name << std::endl;
+        return 0;
+    }
+
+    osgEarth::initialize();
+
+    Runner runner(samples, minTime, filter);
+    for (auto& c : cases())
+    {
+        c.func(runner);
+    }
+
+    if (!json.empty())
+    {
+        if (json == "-")
+            writeJSON(std::cout, runner.results());
+        else
+        {
+            std::ofstream out(json.c_str());
+            writeJSON(out, runner.results());
+        }
+    }
+
+    if (!csv.empty())
+    {
+        if (csv == "-")
+            writeCSV(std::cout, runner.results());
+        else
+        {
+            std::ofstream out(csv.c_str());
+            writeCSV(out, runner.results());
+        }
+    }
+
+    return 0;
+}
@@ -24,8 +24,12 @@
 #include <osgEarth/GeoData>
 #include <osgEarth/Registry>
 #include <osgEarth/MemCache>
+#include <osgEarth/StartupCache>
+#include <osgEarth/CacheEstimator>
+#include <cstdio>
 
 using namespace osgEarth;
+using namespace osgEarth::Util;
 
 TEST_CASE( "Cache" ) {
 
@@ -83,3 +87,87 @@ TEST_CASE( "Cache" ) {
         REQUIRE(r2.failed());
     }  
 }
+
+TEST_CASE( "StartupCache" ) {
+
+    std::string path("startup_cache_test.bin");
+    ::remove(path.c_str());
+
+    std::string oldPath = StartupCache::getPath();
+    StartupCache::setPath(path);
+
+    std::string contents("<map><image>a</image><elevation>b</elevation><image>c</image></map>");
+
+    Config map("map");
+    map.add(Config("image", std::string("a")));
+    map.add(Config("elevation", std::string("b")));
+    map.add(Config("image", std::string("c")));
+
+    Config doc;
+    doc.add(map);
+
+    StartupCache::putConfig(contents, doc);
+    StartupCache::putSRS("epsg:32615", "PROJCS[\"WGS 84 / UTM zone 15N\"]");
+    StartupCache::save();
+
+    // start over from the file
+    StartupCache::setPath(path);
+
+    SECTION("Documents keep their order")
+    {
+        Config output;
+        REQUIRE(StartupCache::getConfig(contents, output));
+        const Config& outMap = output.child("map");
+        REQUIRE(outMap.children().size() == 3u);
+        REQUIRE(outMap.children().front().key() == "image");
+        REQUIRE(outMap.children().front().value() == "a");
+        REQUIRE(outMap.children().back().value() == "c");
+        REQUIRE_FALSE(StartupCache::getConfig(contents + " ", output));
+    }
+
+    SECTION("SRS definitions")
+    {
+        std::string wkt;
+        REQUIRE(StartupCache::getSRS("epsg:32615", wkt));
+        REQUIRE(wkt == "PROJCS[\"WGS 84 / UTM zone 15N\"]");
+        REQUIRE_FALSE(StartupCache::getSRS("epsg:32616", wkt));
+    }
+
+    StartupCache::setPath(oldPath);
+    ::remove(path.c_str());
+}
+
+TEST_CASE( "CacheEstimator" ) {
+
+    const Profile* profile = Registry::instance()->getGlobalGeodeticProfile();
+    const SpatialReference* srs = profile->getSRS();
+
+    CacheEstimator est;
+    est.setProfile(profile);
+    est.setMinLevel(0);
+    est.setMaxLevel(1);
+
+    SECTION("Whole profile")
+    {
+        REQUIRE(est.getNumTiles() == 2u + 8u);
+    }
+
+    SECTION("Overlapping extents count each tile once")
+    {
+        est.addExtent(GeoExtent(srs, 0.0, 0.0, 90.0, 90.0));
+        est.addExtent(GeoExtent(srs, 0.0, 0.0, 90.0, 90.0));
+        REQUIRE(est.getNumTiles(1) == 1u);
+    }
+
+    SECTION("Data extents")
+    {
+        DataExtentList dataExtents;
+        dataExtents.push_back(DataExtent(GeoExtent(srs, -180.0, 0.0, 0.0, 90.0), 0u, 0u));
+        dataExtents.push_back(DataExtent(GeoExtent(srs, 0.0, 0.0, 90.0, 90.0), 0u, 1u));
+        est.addDataExtents(dataExtents);
+
+        REQUIRE(est.getNumTiles(0) == 2u);
+        REQUIRE(est.getNumTiles(1) == 1u);
+        REQUIRE(est.getSizeInMB() == Approx(3.0 * est.getSizeInMBPerTile()));
+    }
+}
@@ -0,0 +1,69 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Config>
+
+using namespace osgEarth;
+
+TEST_CASE( "Config" ) {
+
+    Config map("map");
+    map.add(Config("layer", Config("url", "one.tif")));
+    map.add("name", "test");
+
+    SECTION("Copies change independently") {
+        Config copy(map);
+        copy.add("extra", "value");
+        copy.mutable_child("layer")->set("url", "two.tif");
+
+        REQUIRE(map.children().size() == 2);
+        REQUIRE(map.child("layer").value("url") == "one.tif");
+        REQUIRE(copy.children().size() == 3);
+        REQUIRE(copy.child("layer").value("url") == "two.tif");
+    }
+
+    SECTION("A held children() list stays private") {
+        Config copy;
+        ConfigSet& kids = copy.children();
+        copy = map;
+        Config other(copy);
+        kids.push_back(Config("extra", "value"));
+
+        REQUIRE(copy.children().size() == 3);
+        REQUIRE(other.children().size() == 2);
+        REQUIRE(map.children().size() == 2);
+    }
+
+    SECTION("Assigning a child to its parent") {
+        Config conf(map);
+        conf = conf.child("layer");
+        REQUIRE(conf.key() == "layer");
+        REQUIRE(conf.value("url") == "one.tif");
+    }
+
+    SECTION("Referrers reach shared children") {
+        Config copy(map);
+        copy.setReferrer("/data/test.earth");
+        REQUIRE(copy.child("layer").child("url").referrer() == "/data/test.earth");
+        REQUIRE(map.child("layer").child("url").referrer().empty());
+    }
+}
@@ -24,6 +24,7 @@
 
 #include <osgEarth/Feature>
 #include <osgEarth/GeometryUtils>
+#include <osgEarth/FeatureListSource>
 
 using namespace osgEarth;
 
@@ -109,3 +110,28 @@ TEST_CASE("Feature handles attributes correctly.") {
         REQUIRE(feature->getBool("bool") == false);
     }
 }
+
+TEST_CASE("FeatureSource::getFeatureBounds returns the IDs and bounds of matching features") {
+    osg::ref_ptr<const SpatialReference> wgs84 = SpatialReference::create("wgs84");
+
+    FeatureList input;
+    input.push_back(new Feature(GeometryUtils::geometryFromWKT("POLYGON((10 10, 20 10, 20 20, 10 20))"), wgs84.get()));
+    input.push_back(new Feature(GeometryUtils::geometryFromWKT("POLYGON((-60 -40, -50 -40, -50 -30, -60 -30))"), wgs84.get()));
+
+    osg::ref_ptr<FeatureListSource> source = new FeatureListSource();
+    source->setFeatures(input);
+    REQUIRE(source->open().isOK());
+
+    FeatureSource::FeatureBoundsList all;
+    REQUIRE(source->getFeatureBounds(Query(), all, nullptr));
+    REQUIRE(all.size() == 2);
+
+    Query query;
+    query.bounds() = Bounds(0, 0, 30, 30);
+    FeatureSource::FeatureBoundsList hits;
+    REQUIRE(source->getFeatureBounds(query, hits, nullptr));
+    REQUIRE(hits.size() == 1);
+    REQUIRE(hits.front().fid == input.front()->getFID());
+    REQUIRE(hits.front().bounds.xMin() == 10.0);
+    REQUIRE(hits.front().bounds.yMax() == 20.0);
+}
@@ -0,0 +1,88 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Geoid>
+#include <osgEarth/HeightFieldUtils>
+
+using namespace osgEarth;
+
+namespace
+{
+    Geoid* createGeoid()
+    {
+        osg::HeightField* hf = new osg::HeightField();
+        hf->allocate(9, 5);
+        hf->setOrigin(osg::Vec3(-180.0f, -90.0f, 0.0f));
+        hf->setXInterval(45.0f);
+        hf->setYInterval(45.0f);
+        for (unsigned r = 0; r < hf->getNumRows(); ++r)
+            for (unsigned c = 0; c < hf->getNumColumns(); ++c)
+                hf->setHeight(c, r, (float)(c * 7 % 5) - (float)(r * 3) + 0.25f * (float)(c * r));
+
+        Geoid* geoid = new Geoid();
+        geoid->setHeightField(hf);
+        geoid->setName("test");
+        return geoid;
+    }
+}
+
+TEST_CASE("Geoid")
+{
+    osg::ref_ptr<Geoid> geoid = createGeoid();
+    REQUIRE(geoid->isValid());
+
+    SECTION("Bilinear lookup matches the heightfield interpolation") {
+        const osg::HeightField* hf = geoid->getHeightField();
+        for (double lat = -90.0; lat <= 90.0; lat += 13.7)
+        {
+            for (double lon = -180.0; lon <= 180.0; lon += 17.3)
+            {
+                float expected = HeightFieldUtils::getHeightAtNormalizedLocation(
+                    hf, (lon + 180.0) / 360.0, (lat + 90.0) / 180.0, INTERP_BILINEAR);
+                REQUIRE(geoid->getHeight(lat, lon) == Approx(expected).margin(1e-4));
+            }
+        }
+    }
+
+    SECTION("Grid lookup matches point lookup") {
+        const unsigned cols = 17, rows = 11;
+        const double south = -60.0, west = -170.0, latStep = 9.5, lonStep = 20.5;
+        std::vector<float> heights(cols*rows);
+        geoid->getHeights(south, west, latStep, lonStep, cols, rows, &heights[0]);
+
+        for (unsigned r = 0; r < rows; ++r)
+        {
+            for (unsigned c = 0; c < cols; ++c)
+            {
+                float expected = geoid->getHeight(south + latStep * (double)r, west + lonStep * (double)c);
+                REQUIRE(heights[r*cols + c] == Approx(expected).margin(1e-4));
+            }
+        }
+    }
+
+    SECTION("Points outside the geoid have no offset") {
+        std::vector<float> heights(2);
+        geoid->getHeights(0.0, 170.0, 1.0, 20.0, 2, 1, &heights[0]);
+        REQUIRE(heights[0] != 0.0f);
+        REQUIRE(heights[1] == 0.0f);
+    }
+}
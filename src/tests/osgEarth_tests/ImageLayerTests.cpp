@@ -25,6 +25,7 @@
 #include <osgEarth/ImageLayer>
 #include <osgEarth/Registry>
 #include <osgEarth/GDAL>
+#include <osgEarth/DateTime>
 
 using namespace osgEarth;
 
@@ -67,4 +68,34 @@ TEST_CASE("Attribution works")
 
     REQUIRE(status.isOK());
     REQUIRE(layer->getAttribution() == attribution);
-}
\ No newline at end of file
+}
+TEST_CASE("Dirty regions expire only intersecting tiles")
+{
+    GDALImageLayer* layer = new GDALImageLayer();
+    layer->setURL("../data/world.tif");
+    REQUIRE(layer->open().isOK());
+
+    const Profile* profile = layer->getProfile();
+    TimeStamp written = DateTime().asTimeStamp() - 10;
+
+    // a small area in the western hemisphere:
+    layer->dirtyRegion(GeoExtent(profile->getSRS(), -100, 30, -90, 40), 0u, 10u);
+
+    TileKey west(0, 0, 0, profile);
+    TileKey east(0, 1, 0, profile);
+    REQUIRE(layer->isCachedTileExpired(west, written));
+    REQUIRE_FALSE(layer->isCachedTileExpired(east, written));
+
+    SECTION("Records written after the change are current")
+    {
+        REQUIRE_FALSE(layer->isCachedTileExpired(west, written + 3600));
+    }
+
+    SECTION("Levels outside the range are untouched")
+    {
+        TileKey inside(10, 483, 312, profile);
+        TileKey tooDeep(11, 967, 625, profile);
+        REQUIRE(layer->isCachedTileExpired(inside, written));
+        REQUIRE_FALSE(layer->isCachedTileExpired(tooDeep, written));
+    }
+}
@@ -0,0 +1,72 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/catch.hpp>
+#include <osgEarth/JsonUtils>
+#include <osgEarth/Config>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE( "Json" ) {
+
+    const std::string doc =
+        "{ \"name\": \"test\", /* comment */ \"count\": 4, \"big\": 3000000000,"
+        "  \"neg\": -2, \"real\": 1.5, \"flag\": true, \"none\": null,"
+        "  \"list\": [1, \"two\", {\"three\": 3}] }";
+
+    SECTION("FastReader reads values like Reader") {
+        Json::Value fast, slow;
+        REQUIRE(Json::FastReader().parse(doc, fast));
+        REQUIRE(Json::Reader().parse(doc, slow));
+
+        REQUIRE(fast["name"].asString() == "test");
+        REQUIRE(fast["count"].type() == slow["count"].type());
+        REQUIRE(fast["big"].type() == slow["big"].type());
+        REQUIRE(fast["neg"].type() == slow["neg"].type());
+        REQUIRE(fast["real"].asDouble() == 1.5);
+        REQUIRE(fast["flag"].asBool() == true);
+        REQUIRE(fast["none"].isNull());
+        REQUIRE(fast["list"].size() == 3u);
+        REQUIRE(fast["list"][2u]["three"].asInt() == 3);
+        REQUIRE(Json::FastWriter().write(fast) == Json::FastWriter().write(slow));
+    }
+
+    SECTION("FastReader reports errors") {
+        Json::FastReader reader;
+        Json::Value root;
+        REQUIRE(reader.parse("{ \"a\": ", root) == false);
+        REQUIRE(reader.getFormatedErrorMessages().empty() == false);
+    }
+
+    SECTION("Config round trip") {
+        Config conf("map");
+        conf.set("name", "test");
+        conf.add(Config("layer", "one"));
+        conf.add(Config("layer", "two"));
+
+        Config result;
+        REQUIRE(result.fromJSON(conf.toJSON()));
+        REQUIRE(result.key() == "map");
+        REQUIRE(result.value("name") == "test");
+        REQUIRE(result.children("layer").size() == 2u);
+    }
+}
@@ -0,0 +1,140 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Memory>
+#include <osgEarth/ObjectPool>
+#include <osgEarth/RasterPool>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <vector>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+namespace
+{
+    struct CountingAllocator : public Memory::Allocator
+    {
+        int _allocations = 0, _deallocations = 0;
+        void* allocate(std::size_t bytes, Memory::Subsystem) override {
+            ++_allocations;
+            return ::operator new(bytes);
+        }
+        void deallocate(void* ptr, std::size_t, Memory::Subsystem) override {
+            ++_deallocations;
+            ::operator delete(ptr);
+        }
+    };
+}
+
+TEST_CASE( "Memory" ) {
+
+    SECTION("Tracked charges follow the object") {
+        std::int64_t base = Memory::getUsage(Memory::OTHER);
+        {
+            Memory::Tracked tracked(Memory::OTHER);
+            tracked.set(1000u);
+            REQUIRE(Memory::getUsage(Memory::OTHER) == base + 1000);
+            tracked.set(400u);
+            REQUIRE(Memory::getUsage(Memory::OTHER) == base + 400);
+            REQUIRE(Memory::getPeakUsage(Memory::OTHER) >= base + 1000);
+        }
+        REQUIRE(Memory::getUsage(Memory::OTHER) == base);
+    }
+
+    SECTION("Tracked referenced objects release their charge when deleted") {
+        std::int64_t base = Memory::getUsage(Memory::OTHER);
+        osg::ref_ptr<osg::Referenced> object = new osg::Referenced();
+        Memory::track(object.get(), Memory::OTHER, 256u);
+        REQUIRE(Memory::getUsage(Memory::OTHER) == base + 256);
+        object = nullptr;
+        REQUIRE(Memory::getUsage(Memory::OTHER) == base);
+    }
+
+    SECTION("Tagged allocations go through the installed allocator") {
+        CountingAllocator allocator;
+        Memory::setAllocator(&allocator);
+
+        std::int64_t base = Memory::getUsage(Memory::CACHE);
+        {
+            std::vector<int, Memory::StdAllocator<int, Memory::CACHE>> v(100);
+            REQUIRE(Memory::getUsage(Memory::CACHE) == base + (std::int64_t)(100 * sizeof(int)));
+        }
+        REQUIRE(Memory::getUsage(Memory::CACHE) == base);
+
+        Memory::setAllocator(nullptr);
+        REQUIRE(allocator._allocations == 1);
+        REQUIRE(allocator._deallocations == 1);
+    }
+}
+
+TEST_CASE( "ObjectPool" ) {
+
+    SECTION("Freed blocks are reused by the same size class") {
+        ObjectPool::trim();
+        void* a = ObjectPool::allocate(40);
+        ObjectPool::deallocate(a, 40);
+        REQUIRE(ObjectPool::getNumFreeBlocks() == 1u);
+        void* b = ObjectPool::allocate(48);
+        REQUIRE(a == b);
+        REQUIRE(ObjectPool::getNumFreeBlocks() == 0u);
+        ObjectPool::deallocate(b, 48);
+        ObjectPool::trim();
+        REQUIRE(ObjectPool::getNumFreeBlocks() == 0u);
+    }
+
+    SECTION("Large blocks bypass the pool") {
+        ObjectPool::trim();
+        void* a = ObjectPool::allocate(ObjectPool::MAX_SIZE + 1);
+        ObjectPool::deallocate(a, ObjectPool::MAX_SIZE + 1);
+        REQUIRE(ObjectPool::getNumFreeBlocks() == 0u);
+    }
+}
+
+TEST_CASE( "RasterPool" ) {
+
+    SECTION("Image buffers are recycled") {
+        RasterPool::trim();
+        osg::ref_ptr<osg::Image> image = RasterPool::createImage(256, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        REQUIRE(image->getTotalSizeInBytes() == 256u * 256u * 4u);
+        const unsigned char* data = image->data();
+        image = nullptr;
+        REQUIRE(RasterPool::getFreeBytes() == 256u * 256u * 4u);
+        image = RasterPool::createImage(256, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        REQUIRE(image->data() == data);
+        REQUIRE(RasterPool::getFreeBytes() == 0u);
+    }
+
+    SECTION("Recycled heightfields are zeroed") {
+        RasterPool::trim();
+        osg::ref_ptr<osg::HeightField> hf = RasterPool::createHeightField(17, 17);
+        hf->setHeight(3, 3, 100.0f);
+        hf = nullptr;
+        hf = RasterPool::createHeightField(17, 17);
+        REQUIRE(hf->getNumColumns() == 17u);
+        REQUIRE(hf->getFloatArray()->size() == 17u * 17u);
+        REQUIRE(hf->getHeight(3, 3) == 0.0f);
+        hf = nullptr;
+        RasterPool::trim();
+        REQUIRE(RasterPool::getFreeBytes() == 0u);
+    }
+}
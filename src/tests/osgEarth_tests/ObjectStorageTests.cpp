@@ -0,0 +1,81 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Utils>
+#include <osg/Group>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE( "ObjectStorage keeps typed and named objects apart" ) {
+
+    osg::ref_ptr<osg::Group> object = new osg::Group();
+    object->setUserValue("before", 1);
+
+    osg::ref_ptr<osg::Node> node = new osg::Node();
+    osg::ref_ptr<osg::Group> group = new osg::Group();
+    ObjectStorage::set(object.get(), node.get());
+    ObjectStorage::set(object.get(), group.get());
+    ObjectStorage::set(object.get(), "named", node.get());
+
+    osg::ref_ptr<osg::Node> outNode;
+    osg::ref_ptr<osg::Group> outGroup;
+    REQUIRE(ObjectStorage::get(object.get(), outNode));
+    REQUIRE(outNode.get() == node.get());
+    REQUIRE(ObjectStorage::get(object.get(), outGroup));
+    REQUIRE(outGroup.get() == group.get());
+    REQUIRE(ObjectStorage::get(object.get(), "named", outNode));
+
+    // user values set before the slots still resolve
+    int value = 0;
+    REQUIRE(object->getUserValue("before", value));
+    REQUIRE(value == 1);
+
+    // replacing an object keeps only the new one
+    osg::ref_ptr<osg::Node> other = new osg::Node();
+    ObjectStorage::set(object.get(), other.get());
+    REQUIRE(ObjectStorage::get(object.get(), outNode));
+    REQUIRE(outNode.get() == other.get());
+
+    // storage holds observers, not references
+    group = nullptr;
+    REQUIRE(!ObjectStorage::get(object.get(), outGroup));
+}
+
+TEST_CASE( "ObjectStorage slots are copied with the user data" ) {
+
+    osg::ref_ptr<osg::Node> object = new osg::Node();
+    osg::ref_ptr<osg::Group> group = new osg::Group();
+    ObjectStorage::set(object.get(), group.get());
+
+    osg::ref_ptr<osg::Node> copy = new osg::Node(*object, osg::CopyOp::DEEP_COPY_USERDATA);
+
+    // a change to the copy must not reach the original
+    osg::ref_ptr<osg::Group> other = new osg::Group();
+    ObjectStorage::set(copy.get(), other.get());
+
+    osg::ref_ptr<osg::Group> out;
+    REQUIRE(ObjectStorage::get(object.get(), out));
+    REQUIRE(out.get() == group.get());
+    REQUIRE(ObjectStorage::get(copy.get(), out));
+    REQUIRE(out.get() == other.get());
+}
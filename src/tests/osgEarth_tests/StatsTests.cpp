@@ -0,0 +1,79 @@
+/* -*-c++-*- */
+/* osgEarth - Geospatial SDK for OpenSceneGraph
+* Copyright 2018 Pelican Mapping
+* http://osgearth.org
+*
+* osgEarth is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+* IN THE SOFTWARE.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#include <osgEarth/catch.hpp>
+#include <osgEarth/Stats>
+
+using namespace osgEarth;
+using namespace osgEarth::Util;
+
+TEST_CASE( "Stats" ) {
+
+    SECTION("Lookups return the same statistic") {
+        Stats::Counter& a = Stats::counter("test_stats_counter", "layer=\"a\"");
+        Stats::Counter& b = Stats::counter("test_stats_counter", "layer=\"b\"");
+        REQUIRE(&a == &Stats::counter("test_stats_counter", "layer=\"a\""));
+        REQUIRE(&a != &b);
+        a.add(3);
+        a.add();
+        REQUIRE(a.get() == 4u);
+        REQUIRE(b.get() == 0u);
+    }
+
+    SECTION("Snapshot and export") {
+        Stats::gauge("test_stats_gauge").set(42);
+        Stats::timer("test_stats_timer").record(std::chrono::milliseconds(2));
+
+        Stats::Snapshot snap;
+        Stats::snapshot(snap);
+
+        const Stats::Sample* gauge = nullptr;
+        const Stats::Sample* timer = nullptr;
+        for (auto& s : snap)
+        {
+            if (s.name == "test_stats_gauge") gauge = &s;
+            if (s.name == "test_stats_timer") timer = &s;
+        }
+        REQUIRE(gauge != nullptr);
+        REQUIRE(gauge->value == 42.0);
+        REQUIRE(timer != nullptr);
+        REQUIRE(timer->count == 1u);
+        REQUIRE(timer->max == Approx(2.0));
+
+        std::string prom = Stats::toPrometheus(snap);
+        REQUIRE(prom.find("test_stats_gauge 42\n") != std::string::npos);
+        REQUIRE(prom.find("test_stats_timer_count 1\n") != std::string::npos);
+        REQUIRE(Stats::toJSON(snap).find("\"name\":\"test_stats_gauge\"") != std::string::npos);
+    }
+
+    SECTION("Exporters run at their interval") {
+        int calls = 0;
+        UID id = Stats::addExporter([&](const Stats::Snapshot&, unsigned) { ++calls; }, 2u);
+        for (unsigned f = 1000u; f < 1010u; ++f)
+        {
+            Stats::frame(f);
+            Stats::frame(f); // repeats are ignored
+        }
+        Stats::removeExporter(id);
+        Stats::frame(1010u);
+        REQUIRE(calls == 5);
+    }
+}
@@ -25,6 +25,83 @@
 #include <thread>
 
 using namespace osgEarth;
+using namespace osgEarth::Threading;
+
+TEST_CASE( "Work-stealing JobArena runs every job" ) {
+
+    JobArena::setType("test.workstealing", JobArena::WORK_STEALING);
+    JobArena::setConcurrency("test.workstealing", 4u);
+    JobArena* arena = JobArena::get("test.workstealing");
+    REQUIRE(arena->getType() == JobArena::WORK_STEALING);
+
+    std::atomic_int count(0);
+    JobGroup group;
+    Job job(arena, &group);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        job.setPriority((float)(i % 7));
+        job.dispatch([&count](Cancelable*) { count++; });
+    }
+
+    group.join();
+    REQUIRE(count == 1000);
+}
+
+TEST_CASE( "JobArena re-evaluates priority functions after the epoch advances" ) {
+
+    JobArena::setConcurrency("test.priority", 1u);
+    JobArena* arena = JobArena::get("test.priority");
+
+    // occupy the only thread while the other jobs queue up
+    Event started, proceed;
+    Job(arena).dispatch([&](Cancelable*) { started.set(); proceed.wait(); });
+    started.wait();
+
+    std::vector<float> priorities = { 1.0f, 2.0f, 3.0f };
+    std::vector<int> order;
+    Mutex orderMutex;
+    JobGroup group;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Job job(arena, &group);
+        job.setPriorityFunction([&priorities, i]() { return priorities[i]; });
+        job.dispatch([&order, &orderMutex, i](Cancelable*) {
+            ScopedMutexLock lock(orderMutex);
+            order.push_back(i);
+        });
+    }
+
+    // invert the priorities
+    priorities = { 3.0f, 2.0f, 1.0f };
+    arena->advancePriorityEpoch();
+    proceed.set();
+    group.join();
+
+    REQUIRE(order == std::vector<int>({ 0, 1, 2 }));
+}
+
+TEST_CASE( "JobArena metrics histograms" ) {
+
+    JobArena::Metrics::Histogram h;
+    h.record(0u);    // bucket 0: [0, 1us)
+    h.record(3u);    // bucket 2: [2, 4us)
+    h.record(1000u); // bucket 10: [512, 1024us)
+    REQUIRE(h.count == 3u);
+    REQUIRE(h.buckets[0] == 1u);
+    REQUIRE(h.buckets[2] == 1u);
+    REQUIRE(h.buckets[10] == 1u);
+    REQUIRE(h.percentile(1.0f) == 1024.0);
+
+    JobArena* arena = JobArena::get("test.metrics");
+    JobGroup group;
+    for (int i = 0; i < 10; ++i)
+        Job(arena, &group).dispatch([](Cancelable*) { });
+    group.join();
+    REQUIRE(arena->getMetrics().runTime.count == 10u);
+    REQUIRE(arena->getMetrics().waitTime.count == 10u);
+}
 
 #if 0
 namespace ReadWriteMutexTest
@@ -3848,6 +3848,19 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
   buffer->uri.clear();
   ParseStringProperty(&buffer->uri, err, o, "uri", false, "Buffer");
 
+  // A meshopt fallback buffer has no data of its own; the views that
+  // reference it are decoded from the compressed buffer after loading.
+  if (buffer->uri.empty()) {
+    ParseExtensionsProperty(&buffer->extensions, err, o);
+    if (buffer->extensions.count("EXT_meshopt_compression") > 0 ||
+        buffer->extensions.count("KHR_meshopt_compression") > 0) {
+      ParseStringProperty(&buffer->name, err, o, "name", false);
+      ParseExtrasProperty(&buffer->extras, o);
+      buffer->data.clear();
+      return true;
+    }
+  }
+
   // having an empty uri for a non embedded image should not be valid
   if (!is_binary && buffer->uri.empty()) {
     if (err) {